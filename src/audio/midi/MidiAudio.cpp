@@ -32,9 +32,38 @@ void MidiAudio::_initialize(HWND windowHandle) noexcept
     }
 }
 
+MidiAudio::~MidiAudio()
+{
+    {
+        const std::lock_guard guard{ _mutex };
+        _shutdown = true;
+        _queue.clear();
+    }
+
+    // Interrupt the note that's currently playing, if any.
+    _skip.SetEvent();
+    _queueChanged.notify_all();
+
+    if (_thread.joinable())
+    {
+        _thread.join();
+    }
+}
+
+// Drops all queued notes and cuts the current one short. Until EndSkip() is
+// called, all notes passed to PlayNote() are dropped as well.
+// This happens for Ctrl+C or during shutdown.
 void MidiAudio::BeginSkip() noexcept
 {
     _skip.SetEvent();
+
+    {
+        const std::lock_guard guard{ _mutex };
+        _queue.clear();
+    }
+
+    // Wake up producers that are waiting for space in the queue.
+    _queueChanged.notify_all();
 }
 
 void MidiAudio::EndSkip() noexcept
@@ -42,6 +71,9 @@ void MidiAudio::EndSkip() noexcept
     _skip.ResetEvent();
 }
 
+// Queues a note to be played after all previously queued notes. This returns
+// immediately, unless MaxQueuedNotes are already waiting to be played, in which
+// case it waits until there's space (or the notes are skipped).
 void MidiAudio::PlayNote(HWND windowHandle, const int noteNumber, const int velocity, const std::chrono::milliseconds duration) noexcept
 try
 {
@@ -50,9 +82,70 @@ try
         return;
     }
 
-    if (_hwnd != windowHandle)
+    std::unique_lock lock{ _mutex };
+
+    if (!_thread.joinable())
+    {
+        _thread = std::thread{ [this]() { _playbackThread(); } };
+        LOG_IF_FAILED(SetThreadDescription(_thread.native_handle(), L"MidiAudio Playback Thread"));
+    }
+
+    _queueChanged.wait(lock, [&]() {
+        return _queue.size() < MaxQueuedNotes || _shutdown || _skip.is_signaled();
+    });
+
+    if (_shutdown || _skip.is_signaled())
+    {
+        return;
+    }
+
+    _queue.push_back({ windowHandle, noteNumber, velocity, duration });
+    lock.unlock();
+    _queueChanged.notify_all();
+}
+CATCH_LOG()
+
+void MidiAudio::_playbackThread() noexcept
+{
+    for (;;)
+    {
+        Note note{};
+
+        {
+            std::unique_lock lock{ _mutex };
+            _queueChanged.wait(lock, [&]() { return !_queue.empty() || _shutdown; });
+
+            if (_shutdown)
+            {
+                return;
+            }
+
+            note = _queue.front();
+            _queue.pop_front();
+        }
+
+        // Wake up a producer that might be waiting for space in the queue.
+        _queueChanged.notify_all();
+
+        _playNote(note);
+    }
+}
+
+void MidiAudio::_playNote(const Note& note) noexcept
+try
+{
+    const auto noteNumber = note.noteNumber;
+    const auto velocity = note.velocity;
+    const auto duration = note.duration;
+
+    if (_skip.is_signaled())
+    {
+        return;
+    }
+
+    if (_hwnd != note.windowHandle)
     {
-        _initialize(windowHandle);
+        _initialize(note.windowHandle);
     }
 
     const auto& buffer = _buffers.at(_activeBufferIndex);
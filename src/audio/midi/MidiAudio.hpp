@@ -6,12 +6,17 @@ Module Name:
 - MidiAudio.hpp
 
 Abstract:
-  This modules provide basic MIDI support with blocking sound output.
+  This modules provide basic MIDI support. Notes are queued and played
+  one after another on a dedicated thread, so callers don't block on them.
   */
 
 #pragma once
 
 #include <array>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
 
 struct IDirectSound8;
 struct IDirectSoundBuffer;
@@ -19,16 +24,45 @@ struct IDirectSoundBuffer;
 class MidiAudio
 {
 public:
+    // PlayNote() only blocks once this many notes are waiting to be played.
+    static constexpr size_t MaxQueuedNotes = 64;
+
+    MidiAudio() = default;
+    ~MidiAudio();
+
+    MidiAudio(const MidiAudio&) = delete;
+    MidiAudio& operator=(const MidiAudio&) = delete;
+
     void BeginSkip() noexcept;
     void EndSkip() noexcept;
     void PlayNote(HWND windowHandle, const int noteNumber, const int velocity, const std::chrono::milliseconds duration) noexcept;
 
 private:
+    struct Note
+    {
+        HWND windowHandle;
+        int noteNumber;
+        int velocity;
+        std::chrono::milliseconds duration;
+    };
+
+    void _playbackThread() noexcept;
+    void _playNote(const Note& note) noexcept;
     void _initialize(HWND windowHandle) noexcept;
     void _createBuffers() noexcept;
 
     wil::slim_event_manual_reset _skip;
 
+    // _queue and _shutdown are protected by _mutex. _queueChanged is notified
+    // whenever a note is queued or dequeued, the queue is flushed or we shut down.
+    std::mutex _mutex;
+    std::condition_variable _queueChanged;
+    std::deque<Note> _queue;
+    std::thread _thread;
+    bool _shutdown = false;
+
+    // The remaining members are only accessed by the playback thread.
+
     HWND _hwnd = nullptr;
     wil::unique_hmodule _directSoundModule;
     wil::com_ptr<IDirectSound8> _directSound;
@@ -0,0 +1,427 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include "BufferSnapshot.hpp"
+
+#include "textBuffer.hpp"
+
+// All values are stored in little endian, the native byte order of all of our platforms.
+//
+// Header:   u32 magic, u32 version, u64 offset of the latest manifest record
+// Record:   u32 payload size, payload
+// Row:      u64 id, u16 width, u8 flags, u8 line rendition, u32 text length, u32 run count,
+//           text, runs: (u16 length, u16 hyperlink uri length, TextAttribute, hyperlink uri)
+// Manifest: u32 magic, i32 cursor x, i32 cursor y, u32 row count, u64 row record offsets
+static constexpr uint32_t FileMagic = 'SBTW';
+static constexpr uint32_t ManifestMagic = 'MSTW';
+static constexpr uint32_t FileVersion = 1;
+static constexpr uint64_t HeaderSize = 16;
+static constexpr uint64_t PrefixSize = sizeof(uint32_t);
+
+static constexpr uint8_t FlagWrapForced = 0x1;
+static constexpr uint8_t FlagDoubleBytePadded = 0x2;
+
+namespace
+{
+    struct Writer
+    {
+        template<typename T>
+        void put(const T& value)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            const auto p = reinterpret_cast<const std::byte*>(&value);
+            data.insert(data.end(), p, p + sizeof(T));
+        }
+
+        void put(const std::wstring_view& text)
+        {
+            const auto p = reinterpret_cast<const std::byte*>(text.data());
+            data.insert(data.end(), p, p + text.size() * sizeof(wchar_t));
+        }
+
+        // Overwrites the u32 at the given offset, which was reserved with put<uint32_t>(0).
+        void patch(size_t offset, uint32_t value) noexcept
+        {
+            memcpy(&til::at(data, offset), &value, sizeof(value));
+        }
+
+        std::vector<std::byte> data;
+    };
+
+    struct Reader
+    {
+        template<typename T>
+        T get()
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            THROW_HR_IF(HRESULT_FROM_WIN32(ERROR_FILE_CORRUPT), data.size() < sizeof(T));
+            T value;
+            memcpy(&value, data.data(), sizeof(T));
+            data = data.subspan(sizeof(T));
+            return value;
+        }
+
+        std::wstring_view text(size_t length)
+        {
+            THROW_HR_IF(HRESULT_FROM_WIN32(ERROR_FILE_CORRUPT), data.size() / sizeof(wchar_t) < length);
+            const std::wstring_view text{ reinterpret_cast<const wchar_t*>(data.data()), length };
+            data = data.subspan(length * sizeof(wchar_t));
+            return text;
+        }
+
+        // Returns a reader for the payload of the record at the given offset.
+        Reader record(uint64_t offset) const
+        {
+            THROW_HR_IF(HRESULT_FROM_WIN32(ERROR_FILE_CORRUPT), offset > data.size() - PrefixSize || offset < HeaderSize);
+            Reader r{ data.subspan(gsl::narrow_cast<size_t>(offset)) };
+            const auto size = r.get<uint32_t>();
+            THROW_HR_IF(HRESULT_FROM_WIN32(ERROR_FILE_CORRUPT), r.data.size() < size);
+            r.data = r.data.first(size);
+            return r;
+        }
+
+        std::span<const std::byte> data;
+    };
+}
+
+// Routine Description:
+// - Creates an empty snapshot at the given path, replacing any that already exists.
+//   Use Restore() first, if you want to restore its contents.
+BufferSnapshot::BufferSnapshot(std::filesystem::path path) :
+    _path{ std::move(path) }
+{
+    _open();
+}
+
+// Routine Description:
+// - Updates the snapshot with the contents of the buffer, up to the cursor or the last row with text, whichever is further down.
+// - Only rows that changed since the previous call are read and written.
+void BufferSnapshot::Write(const TextBuffer& buffer)
+{
+    const auto cursor = buffer.GetCursor().GetPosition();
+    const auto rowCount = std::max(cursor.y, buffer.GetLastNonSpaceCharacter().y) + 1;
+
+    Writer w;
+    std::vector<uint64_t> offsets;
+    std::unordered_map<uint64_t, Record> records;
+    offsets.reserve(rowCount);
+    records.reserve(rowCount);
+
+    std::wstring uri;
+    for (til::CoordType y = 0; y < rowCount; ++y)
+    {
+        // Cold rows are only thawed if they changed, which they rarely do.
+        const auto& peeked = buffer.PeekRowByOffset(y);
+        if (peeked.IsCold())
+        {
+            if (const auto it = _records.find(peeked.GetId()); it != _records.end() && it->second.revision == peeked.GetRevision())
+            {
+                offsets.emplace_back(it->second.offset);
+                records.emplace(it->first, it->second);
+                continue;
+            }
+        }
+
+        const auto& row = buffer.GetRowByOffset(y);
+        if (const auto it = _records.find(row.GetId()); it != _records.end())
+        {
+            // Rows that were merely overwritten with the same contents (e.g. by a TUI redrawing itself) are reused as well.
+            if (it->second.revision == row.GetRevision() || it->second.contentHash == row.GetContentHash())
+            {
+                offsets.emplace_back(it->second.offset);
+                records.emplace(it->first, Record{ it->second.offset, row.GetRevision(), it->second.contentHash, it->second.size });
+                continue;
+            }
+        }
+
+        const auto begin = w.data.size();
+        const auto text = row.GetText(0, row.MeasureRight());
+        const auto& runs = row.Attributes().runs();
+        uint8_t flags = 0;
+        WI_SetFlagIf(flags, FlagWrapForced, row.WasWrapForced());
+        WI_SetFlagIf(flags, FlagDoubleBytePadded, row.WasDoubleBytePadded());
+
+        w.put<uint32_t>(0);
+        w.put(row.GetId());
+        w.put<uint16_t>(row.size());
+        w.put(flags);
+        w.put(static_cast<uint8_t>(row.GetLineRendition()));
+        w.put(gsl::narrow<uint32_t>(text.size()));
+        w.put(gsl::narrow<uint32_t>(runs.size()));
+        w.put(text);
+        for (const auto& run : runs)
+        {
+            // Hyperlink ids are only meaningful within this buffer, so the runs carry their URI instead.
+            uri.clear();
+            if (run.value.IsHyperlink())
+            {
+                uri = buffer.GetHyperlinkUriFromId(run.value.GetHyperlinkId());
+            }
+            w.put<uint16_t>(run.length);
+            w.put(gsl::narrow<uint16_t>(uri.size()));
+            w.put(run.value);
+            w.put(std::wstring_view{ uri });
+        }
+
+        const auto size = gsl::narrow<uint32_t>(w.data.size() - begin - PrefixSize);
+        w.patch(begin, size);
+
+        const auto offset = _end + begin;
+        offsets.emplace_back(offset);
+        records.emplace(row.GetId(), Record{ offset, row.GetRevision(), row.GetContentHash(), size });
+    }
+
+    const auto manifestBegin = w.data.size();
+    w.put<uint32_t>(0);
+    w.put(ManifestMagic);
+    w.put(cursor.x);
+    w.put(cursor.y);
+    w.put(gsl::narrow<uint32_t>(offsets.size()));
+    for (const auto offset : offsets)
+    {
+        w.put(offset);
+    }
+    w.patch(manifestBegin, gsl::narrow<uint32_t>(w.data.size() - manifestBegin - PrefixSize));
+
+    const auto manifestOffset = _end + manifestBegin;
+    _append(w.data);
+
+    // The header is updated last, so that a snapshot that's interrupted halfway still points at the previous manifest.
+    Writer header;
+    header.put(FileMagic);
+    header.put(FileVersion);
+    header.put(manifestOffset);
+    OVERLAPPED overlapped{};
+    DWORD written = 0;
+    THROW_IF_WIN32_BOOL_FALSE(WriteFile(_file.get(), header.data.data(), gsl::narrow<DWORD>(header.data.size()), &written, &overlapped));
+    THROW_HR_IF(E_UNEXPECTED, written != header.data.size());
+
+    _records = std::move(records);
+    _liveBytes = HeaderSize + w.data.size() - manifestBegin;
+    for (const auto& [id, record] : _records)
+    {
+        _liveBytes += PrefixSize + record.size;
+    }
+
+    if (_end > 2 * _liveBytes)
+    {
+        _compact();
+    }
+}
+
+// Routine Description:
+// - Restores the snapshot at the given path into the top of the buffer.
+//   If the snapshot has more rows than the buffer, only the last ones are restored.
+// Return Value:
+// - The position of the cursor when the snapshot was written, relative to the restored rows.
+til::point BufferSnapshot::Restore(const std::filesystem::path& path, TextBuffer& buffer)
+{
+    const wil::unique_hfile file{ CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr) };
+    THROW_LAST_ERROR_IF(!file);
+
+    LARGE_INTEGER fileSize{};
+    THROW_IF_WIN32_BOOL_FALSE(GetFileSizeEx(file.get(), &fileSize));
+    THROW_HR_IF(HRESULT_FROM_WIN32(ERROR_FILE_CORRUPT), gsl::narrow_cast<uint64_t>(fileSize.QuadPart) < HeaderSize);
+
+    const wil::unique_handle mapping{ CreateFileMappingW(file.get(), nullptr, PAGE_READONLY, 0, 0, nullptr) };
+    THROW_LAST_ERROR_IF(!mapping);
+    const wil::unique_mapview_ptr<std::byte> view{ static_cast<std::byte*>(MapViewOfFile(mapping.get(), FILE_MAP_READ, 0, 0, 0)) };
+    THROW_LAST_ERROR_IF(!view);
+
+    const Reader snapshot{ { view.get(), gsl::narrow<size_t>(fileSize.QuadPart) } };
+    auto header = snapshot;
+    THROW_HR_IF(HRESULT_FROM_WIN32(ERROR_FILE_CORRUPT), header.get<uint32_t>() != FileMagic);
+    THROW_HR_IF(HRESULT_FROM_WIN32(ERROR_UNSUPPORTED_TYPE), header.get<uint32_t>() != FileVersion);
+
+    auto manifest = snapshot.record(header.get<uint64_t>());
+    THROW_HR_IF(HRESULT_FROM_WIN32(ERROR_FILE_CORRUPT), manifest.get<uint32_t>() != ManifestMagic);
+    til::point cursor;
+    cursor.x = manifest.get<til::CoordType>();
+    cursor.y = manifest.get<til::CoordType>();
+    const auto rowCount = gsl::narrow_cast<til::CoordType>(std::min<uint32_t>(manifest.get<uint32_t>(), gsl::narrow_cast<uint32_t>(buffer.TotalRowCount())));
+    const auto skipped = gsl::narrow_cast<til::CoordType>(manifest.data.size() / sizeof(uint64_t)) - rowCount;
+    THROW_HR_IF(HRESULT_FROM_WIN32(ERROR_FILE_CORRUPT), skipped < 0);
+    manifest.data = manifest.data.subspan(skipped * sizeof(uint64_t));
+
+    // Hyperlinks get new ids in this buffer. Runs that share a URI also share its new id.
+    std::unordered_map<std::wstring_view, uint16_t> hyperlinkIds;
+
+    for (til::CoordType y = 0; y < rowCount; ++y)
+    {
+        auto r = snapshot.record(manifest.get<uint64_t>());
+        auto& row = buffer.GetRowByOffset(y);
+        const auto attr = buffer.GetCurrentAttributes();
+        row.Reset(attr);
+
+        r.get<uint64_t>();
+        r.get<uint16_t>();
+        const auto flags = r.get<uint8_t>();
+        const auto lineRendition = r.get<uint8_t>();
+        const auto textLength = r.get<uint32_t>();
+        const auto runCount = r.get<uint32_t>();
+
+        RowWriteState state{
+            .text = r.text(textLength),
+            .columnBegin = 0,
+            .columnLimit = row.size(),
+        };
+        row.ReplaceText(state);
+
+        til::CoordType column = 0;
+        for (uint32_t i = 0; i < runCount; ++i)
+        {
+            const auto length = r.get<uint16_t>();
+            const auto uriLength = r.get<uint16_t>();
+            auto runAttr = r.get<TextAttribute>();
+            const auto uri = r.text(uriLength);
+            if (runAttr.IsHyperlink())
+            {
+                auto [it, inserted] = hyperlinkIds.emplace(uri, uint16_t{});
+                if (inserted)
+                {
+                    it->second = buffer.GetHyperlinkId(uri, {});
+                    buffer.AddHyperlinkToMap(uri, it->second);
+                }
+                runAttr.SetHyperlinkId(it->second);
+            }
+            if (column < row.size())
+            {
+                // The last run extends to the end of the row, in case the buffer is wider than the snapshot.
+                if (i + 1 == runCount)
+                {
+                    row.SetAttrToEnd(column, runAttr);
+                }
+                else
+                {
+                    row.ReplaceAttributes(column, column + length, runAttr);
+                }
+            }
+            column += length;
+        }
+
+        row.SetWrapForced(WI_IsFlagSet(flags, FlagWrapForced));
+        row.SetDoubleBytePadded(WI_IsFlagSet(flags, FlagDoubleBytePadded));
+        row.SetLineRendition(static_cast<LineRendition>(lineRendition));
+    }
+
+    cursor.y -= skipped;
+    cursor.x = std::clamp(cursor.x, 0, buffer.GetSize().Width() - 1);
+    cursor.y = std::clamp(cursor.y, 0, buffer.GetSize().Height() - 1);
+    buffer.TriggerRedrawAll();
+    return cursor;
+}
+
+// Returns the size of the snapshot file, in bytes.
+uint64_t BufferSnapshot::FileSize() const noexcept
+{
+    return _end;
+}
+
+// Returns the size of the records that the last manifest refers to, including the header, in bytes.
+uint64_t BufferSnapshot::LiveBytes() const noexcept
+{
+    return _liveBytes;
+}
+
+void BufferSnapshot::_open()
+{
+    _file.reset(CreateFileW(_path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr));
+    THROW_LAST_ERROR_IF(!_file);
+    _records.clear();
+    _end = HeaderSize;
+    _liveBytes = 0;
+}
+
+void BufferSnapshot::_append(const std::span<const std::byte>& data)
+{
+    OVERLAPPED overlapped{};
+    overlapped.Offset = gsl::narrow_cast<DWORD>(_end);
+    overlapped.OffsetHigh = gsl::narrow_cast<DWORD>(_end >> 32);
+    DWORD written = 0;
+    THROW_IF_WIN32_BOOL_FALSE(WriteFile(_file.get(), data.data(), gsl::narrow<DWORD>(data.size()), &written, &overlapped));
+    THROW_HR_IF(E_UNEXPECTED, written != data.size());
+    _end += data.size();
+}
+
+// Copies the records of the last manifest into a new file, which then replaces the current one.
+// The rows don't need to be serialized again for that, since records don't depend on their offset.
+void BufferSnapshot::_compact()
+{
+    std::vector<std::byte> contents(gsl::narrow<size_t>(_end));
+    {
+        OVERLAPPED overlapped{};
+        DWORD read = 0;
+        THROW_IF_WIN32_BOOL_FALSE(ReadFile(_file.get(), contents.data(), gsl::narrow<DWORD>(contents.size()), &read, &overlapped));
+        THROW_HR_IF(E_UNEXPECTED, read != contents.size());
+    }
+
+    const Reader file{ contents };
+    auto header = file;
+    header.get<uint32_t>();
+    header.get<uint32_t>();
+    auto manifest = file.record(header.get<uint64_t>());
+    manifest.get<uint32_t>();
+    const auto cursorX = manifest.get<til::CoordType>();
+    const auto cursorY = manifest.get<til::CoordType>();
+    const auto rowCount = manifest.get<uint32_t>();
+
+    Writer w;
+    w.put(FileMagic);
+    w.put(FileVersion);
+    w.put<uint64_t>(0);
+
+    std::unordered_map<uint64_t, uint64_t> moved;
+    std::vector<uint64_t> offsets;
+    offsets.reserve(rowCount);
+    for (uint32_t i = 0; i < rowCount; ++i)
+    {
+        const auto offset = manifest.get<uint64_t>();
+        auto [it, inserted] = moved.emplace(offset, w.data.size());
+        if (inserted)
+        {
+            const auto r = file.record(offset);
+            w.put(gsl::narrow<uint32_t>(r.data.size()));
+            w.data.insert(w.data.end(), r.data.begin(), r.data.end());
+        }
+        offsets.emplace_back(it->second);
+    }
+
+    const auto manifestBegin = w.data.size();
+    const uint64_t manifestOffset = manifestBegin;
+    w.put<uint32_t>(0);
+    w.put(ManifestMagic);
+    w.put(cursorX);
+    w.put(cursorY);
+    w.put(rowCount);
+    for (const auto offset : offsets)
+    {
+        w.put<uint64_t>(offset);
+    }
+    w.patch(manifestBegin, gsl::narrow<uint32_t>(w.data.size() - manifestBegin - PrefixSize));
+    memcpy(&til::at(w.data, 8), &manifestOffset, sizeof(uint64_t));
+
+    for (auto& [id, record] : _records)
+    {
+        record.offset = moved.at(record.offset);
+    }
+
+    // Writing the new file next to the old one and then replacing it means
+    // that there's always one intact snapshot, even if we crash halfway.
+    auto tempPath = _path;
+    tempPath += L".tmp";
+    {
+        const wil::unique_hfile temp{ CreateFileW(tempPath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr) };
+        THROW_LAST_ERROR_IF(!temp);
+        DWORD written = 0;
+        THROW_IF_WIN32_BOOL_FALSE(WriteFile(temp.get(), w.data.data(), gsl::narrow<DWORD>(w.data.size()), &written, nullptr));
+        THROW_HR_IF(E_UNEXPECTED, written != w.data.size());
+    }
+
+    _file.reset();
+    THROW_IF_WIN32_BOOL_FALSE(MoveFileExW(tempPath.c_str(), _path.c_str(), MOVEFILE_REPLACE_EXISTING));
+    _file.reset(CreateFileW(_path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr));
+    THROW_LAST_ERROR_IF(!_file);
+    _end = w.data.size();
+    _liveBytes = _end;
+}
@@ -0,0 +1,53 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- BufferSnapshot.hpp
+
+Abstract:
+- A compact binary snapshot of the contents of a TextBuffer, so that they can be restored in a later session.
+- The file is an append-only log of row records, each of which holds the text, attribute runs and flags of a row.
+  Every Write() only appends the rows that changed since the previous one (see ROW::GetRevision()
+  and ROW::GetContentHash()), followed
+  by a manifest that lists the records of all rows in order. Finally the header is pointed at that manifest.
+- Once less than half of the file is live, Write() copies the live records into a new file.
+- Restore() maps the file into memory and only reads the records that the last manifest refers to.
+--*/
+
+#pragma once
+
+class TextBuffer;
+
+class BufferSnapshot final
+{
+public:
+    explicit BufferSnapshot(std::filesystem::path path);
+
+    void Write(const TextBuffer& buffer);
+    static til::point Restore(const std::filesystem::path& path, TextBuffer& buffer);
+
+    uint64_t FileSize() const noexcept;
+    uint64_t LiveBytes() const noexcept;
+
+private:
+    struct Record
+    {
+        uint64_t offset = 0;
+        uint64_t revision = 0;
+        // The ROW::GetContentHash() at the time the record was written.
+        size_t contentHash = 0;
+        uint32_t size = 0;
+    };
+
+    void _open();
+    void _append(const std::span<const std::byte>& data);
+    void _compact();
+
+    std::filesystem::path _path;
+    wil::unique_hfile _file;
+    // The row records of the last manifest, by ROW::GetId().
+    std::unordered_map<uint64_t, Record> _records;
+    uint64_t _end = 0;
+    uint64_t _liveBytes = 0;
+};
@@ -0,0 +1,121 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include "ImageSlice.hpp"
+
+ImageSlice::ImageSlice(const til::size cellSize) noexcept :
+    _cellSize{ cellSize }
+{
+}
+
+til::size ImageSlice::CellSize() const noexcept
+{
+    return _cellSize;
+}
+
+// The first column covered by the slice.
+til::CoordType ImageSlice::ColumnOffset() const noexcept
+{
+    return _columnBegin;
+}
+
+// 1 past the last column covered by the slice.
+til::CoordType ImageSlice::ColumnEnd() const noexcept
+{
+    return _columnEnd;
+}
+
+til::CoordType ImageSlice::PixelWidth() const noexcept
+{
+    return _pixelWidth;
+}
+
+// Incremented whenever the pixels change, so that renderers can skip uploading them again.
+uint64_t ImageSlice::GetRevision() const noexcept
+{
+    return _revision;
+}
+
+size_t ImageSlice::MemoryUsage() const noexcept
+{
+    return _pixels.capacity() * sizeof(uint32_t);
+}
+
+// All lines of pixels, each PixelWidth() long, for a total of CellSize().height lines.
+std::span<const uint32_t> ImageSlice::Pixels() const noexcept
+{
+    return _pixels;
+}
+
+// Returns the line of pixels of the given column, or nullptr if the slice doesn't cover it.
+const uint32_t* ImageSlice::PixelsAt(const til::CoordType column) const noexcept
+{
+    if (column < _columnBegin || column >= _columnEnd)
+    {
+        return nullptr;
+    }
+    return _pixels.data() + static_cast<size_t>(column - _columnBegin) * _cellSize.width;
+}
+
+// Grows the slice to cover the columns [columnBegin, columnEnd) and returns the first pixel of columnBegin.
+// The lines of pixels are PixelWidth() apart. Newly covered pixels are transparent.
+uint32_t* ImageSlice::MutablePixels(const til::CoordType columnBegin, const til::CoordType columnEnd)
+{
+    if (_pixels.empty())
+    {
+        _columnBegin = columnBegin;
+        _columnEnd = columnEnd;
+        _pixelWidth = (columnEnd - columnBegin) * _cellSize.width;
+        _pixels.resize(static_cast<size_t>(_pixelWidth) * _cellSize.height);
+    }
+    else if (columnBegin < _columnBegin || columnEnd > _columnEnd)
+    {
+        const auto newBegin = std::min(columnBegin, _columnBegin);
+        const auto newEnd = std::max(columnEnd, _columnEnd);
+        const auto newPixelWidth = (newEnd - newBegin) * _cellSize.width;
+        const auto offset = static_cast<size_t>(_columnBegin - newBegin) * _cellSize.width;
+        std::vector<uint32_t> pixels(static_cast<size_t>(newPixelWidth) * _cellSize.height);
+
+        for (til::CoordType y = 0; y < _cellSize.height; ++y)
+        {
+            const auto src = _pixels.begin() + static_cast<size_t>(y) * _pixelWidth;
+            std::copy(src, src + _pixelWidth, pixels.begin() + static_cast<size_t>(y) * newPixelWidth + offset);
+        }
+
+        _pixels = std::move(pixels);
+        _columnBegin = newBegin;
+        _columnEnd = newEnd;
+        _pixelWidth = newPixelWidth;
+    }
+
+    _revision++;
+    return _pixels.data() + static_cast<size_t>(columnBegin - _columnBegin) * _cellSize.width;
+}
+
+// Makes the given columns transparent. Returns true if the slice is entirely transparent afterwards.
+bool ImageSlice::EraseCells(const til::CoordType columnBegin, const til::CoordType columnEnd) noexcept
+{
+    const auto begin = std::max(columnBegin, _columnBegin);
+    const auto end = std::min(columnEnd, _columnEnd);
+    if (begin >= end)
+    {
+        return _pixels.empty();
+    }
+    if (begin == _columnBegin && end == _columnEnd)
+    {
+        _pixels.clear();
+        _revision++;
+        return true;
+    }
+
+    const auto offset = static_cast<size_t>(begin - _columnBegin) * _cellSize.width;
+    const auto count = static_cast<size_t>(end - begin) * _cellSize.width;
+    for (til::CoordType y = 0; y < _cellSize.height; ++y)
+    {
+        std::fill_n(_pixels.begin() + static_cast<size_t>(y) * _pixelWidth + offset, count, 0u);
+    }
+
+    _revision++;
+    return false;
+}
@@ -0,0 +1,46 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- ImageSlice.hpp
+
+Abstract:
+- The part of a sixel image that overlaps one row of the text buffer.
+- Each ROW owns its slice, so images are anchored to the cells they were drawn
+  into: they scroll along with the text, and text that's written over them
+  erases the image cells underneath it.
+- The pixels are stored as 0xAABBGGRR at a fixed virtual cell size (VT340
+  compatible) and are scaled to the actual font size by the renderer.
+--*/
+
+#pragma once
+
+class ImageSlice final
+{
+public:
+    using Pointer = std::unique_ptr<ImageSlice>;
+
+    explicit ImageSlice(til::size cellSize) noexcept;
+
+    til::size CellSize() const noexcept;
+    til::CoordType ColumnOffset() const noexcept;
+    til::CoordType ColumnEnd() const noexcept;
+    til::CoordType PixelWidth() const noexcept;
+    uint64_t GetRevision() const noexcept;
+    size_t MemoryUsage() const noexcept;
+
+    std::span<const uint32_t> Pixels() const noexcept;
+    const uint32_t* PixelsAt(til::CoordType column) const noexcept;
+    uint32_t* MutablePixels(til::CoordType columnBegin, til::CoordType columnEnd);
+    bool EraseCells(til::CoordType columnBegin, til::CoordType columnEnd) noexcept;
+
+private:
+    std::vector<uint32_t> _pixels;
+    til::size _cellSize;
+    til::CoordType _columnBegin = 0;
+    til::CoordType _columnEnd = 0;
+    // The length of a line of pixels in _pixels.
+    til::CoordType _pixelWidth = 0;
+    uint64_t _revision = 0;
+};
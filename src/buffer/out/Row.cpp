@@ -4,6 +4,7 @@
 #include "precomp.h"
 #include "Row.hpp"
 
+#include <til/hash.h>
 #include <til/unicode.h>
 
 #include "textBuffer.hpp"
@@ -68,15 +69,68 @@ constexpr OutIt copy_n_small(InIt first, Diff count, OutIt dest)
     return dest;
 }
 
+// Returns the length of the leading run of ASCII characters in the given string.
+// It's vectorized, because the vast majority of all text written into a ROW is ASCII.
+#pragma warning(push)
+#pragma warning(disable : 26481) // Don't use pointer arithmetic. Use span instead (bounds.1).
+#pragma warning(disable : 26490) // Don't use reinterpret_cast (type.1).
+static size_t asciiPrefixLength(const std::wstring_view& str) noexcept
+{
+    auto it = str.data();
+    const auto end = it + str.size();
+
+#if defined(_M_AMD64) || defined(_M_IX86)
+    const auto nonAscii = _mm_set1_epi16(static_cast<short>(0xff80));
+    const auto zero = _mm_setzero_si128();
+
+    for (; end - it >= 8; it += 8)
+    {
+        const auto vec = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+        const auto ascii = _mm_cmpeq_epi16(_mm_and_si128(vec, nonAscii), zero);
+        const auto mask = static_cast<unsigned long>(_mm_movemask_epi8(ascii)) ^ 0xffff;
+        unsigned long index;
+        if (_BitScanForward(&index, mask))
+        {
+            // The mask contains 2 bits per wchar_t.
+            return static_cast<size_t>(it - str.data()) + index / 2;
+        }
+    }
+#elif defined(_M_ARM64)
+    const auto asciiMax = vdupq_n_u16(0x7f);
+
+    for (; end - it >= 8; it += 8)
+    {
+        const auto vec = vld1q_u16(reinterpret_cast<const uint16_t*>(it));
+        // Narrowing the 8 16-bit results to 8 bytes gives us a 64-bit mask with 8 bits per wchar_t.
+        const auto mask = vget_lane_u64(vreinterpret_u64_u8(vmovn_u16(vcgtq_u16(vec, asciiMax))), 0);
+        unsigned long index;
+        if (_BitScanForward64(&index, mask))
+        {
+            return static_cast<size_t>(it - str.data()) + index / 8;
+        }
+    }
+#endif
+
+    for (; it != end && *it < 0x80; ++it)
+    {
+    }
+
+    return static_cast<size_t>(it - str.data());
+}
+#pragma warning(pop)
+
 // Routine Description:
 // - constructor
 // Arguments:
+// - charsPool - where text that doesn't fit into charsBuffer gets stored. It must outlive this row.
 // - rowWidth - the width of the row, cell elements
 // - fillAttribute - the default text attribute
 // Return Value:
 // - constructed object
-ROW::ROW(wchar_t* charsBuffer, uint16_t* charOffsetsBuffer, uint16_t rowWidth, const TextAttribute& fillAttribute) :
+ROW::ROW(wchar_t* charsBuffer, uint16_t* charOffsetsBuffer, RowCharPool* charsPool, uint16_t rowWidth, const TextAttribute& fillAttribute) :
     _charsBuffer{ charsBuffer },
+    _charOffsetsBuffer{ charOffsetsBuffer },
+    _charsPool{ charsPool },
     _chars{ charsBuffer, rowWidth },
     _charOffsets{ charOffsetsBuffer, ::base::strict_cast<size_t>(rowWidth) + 1u },
     _attr{ rowWidth, fillAttribute },
@@ -88,9 +142,32 @@ ROW::ROW(wchar_t* charsBuffer, uint16_t* charOffsetsBuffer, uint16_t rowWidth, c
     }
 }
 
+// Routine Description:
+// - constructor for a lazily materialized row
+// Arguments:
+// - charsBuffer, charOffsetsBuffer - adjacent, reserved but not yet committed memory for this row.
+//   It gets committed the first time the row's text is modified (see _materialize()).
+// - charsPool - where text that doesn't fit into charsBuffer gets stored. It must outlive this row.
+// - blankTemplate - a materialized, blank row of the same width, which this row shares until then.
+//   It must outlive this row. Its memory may be read-only.
+// - fillAttribute - the default text attribute
+// Return Value:
+// - constructed object
+ROW::ROW(wchar_t* charsBuffer, uint16_t* charOffsetsBuffer, RowCharPool* charsPool, const ROW& blankTemplate, const TextAttribute& fillAttribute) :
+    _charsBuffer{ charsBuffer },
+    _charOffsetsBuffer{ charOffsetsBuffer },
+    _charsPool{ charsPool },
+    _chars{ blankTemplate._chars },
+    _charOffsets{ blankTemplate._charOffsets },
+    _attr{ blankTemplate._columnCount, fillAttribute },
+    _columnCount{ blankTemplate._columnCount }
+{
+}
+
 void ROW::SetWrapForced(const bool wrap) noexcept
 {
     _wrapForced = wrap;
+    _revision++;
 }
 
 bool ROW::WasWrapForced() const noexcept
@@ -101,6 +178,7 @@ bool ROW::WasWrapForced() const noexcept
 void ROW::SetDoubleBytePadded(const bool doubleBytePadded) noexcept
 {
     _doubleBytePadded = doubleBytePadded;
+    _revision++;
 }
 
 bool ROW::WasDoubleBytePadded() const noexcept
@@ -111,6 +189,7 @@ bool ROW::WasDoubleBytePadded() const noexcept
 void ROW::SetLineRendition(const LineRendition lineRendition) noexcept
 {
     _lineRendition = lineRendition;
+    _revision++;
 }
 
 LineRendition ROW::GetLineRendition() const noexcept
@@ -118,6 +197,154 @@ LineRendition ROW::GetLineRendition() const noexcept
     return _lineRendition;
 }
 
+// Returns the identity of the line of text this row holds. See TextBuffer::IncrementCircularBuffer().
+uint64_t ROW::GetId() const noexcept
+{
+    return _id;
+}
+
+void ROW::SetId(const uint64_t id) noexcept
+{
+    _id = id;
+}
+
+// Returns a counter that's incremented whenever the contents of this row change.
+uint64_t ROW::GetRevision() const noexcept
+{
+    return _revision;
+}
+
+// Returns a hash of the contents of this row: its text, glyph widths, attributes and flags.
+// Unlike GetRevision() this doesn't change if a row is overwritten with the same contents,
+// which happens a lot when applications redraw themselves. This allows consumers to detect
+// rows that didn't actually change by comparing it with the hash they saw the last time.
+// It's only recalculated once per revision, so calling it repeatedly costs O(1).
+// The row must be materialized, which is the case for all rows returned by TextBuffer::GetRowByOffset().
+size_t ROW::GetContentHash() const noexcept
+{
+    if (_contentHashRevision != _revision)
+    {
+        til::hasher h;
+        const uint16_t header[]{ _columnCount, static_cast<uint16_t>(_lineRendition), static_cast<uint16_t>(_wrapForced), static_cast<uint16_t>(_doubleBytePadded) };
+        h.write(&header[0], std::size(header));
+        h.write(GetText());
+        // The offsets tell the width of each glyph apart, as in "ab" vs. a wide "a" followed by "b".
+        h.write(_charOffsets.data(), _charOffsets.size());
+        for (const auto& run : _attr.runs())
+        {
+            h.write(static_cast<const void*>(&run.value), sizeof(run.value));
+            h.write(run.length);
+        }
+        _contentHash = h.finalize();
+        _contentHashRevision = _revision;
+    }
+    return _contentHash;
+}
+
+// Returns false if this row still shares the blank template it was constructed with.
+bool ROW::IsMaterialized() const noexcept
+{
+    return _charOffsets.data() == _charOffsetsBuffer;
+}
+
+// Returns true if this row's text was moved into compact storage by Freeze().
+// Its text will read as blank until it's been thawed. MeasureRight() and DbcsAttrAt() remain accurate.
+bool ROW::IsCold() const noexcept
+{
+    return _cold != nullptr;
+}
+
+// Returns the size of the heap allocation backing the run-length encoded attributes in bytes.
+// Rows with a single run (most of them) store it inline and don't allocate at all.
+size_t ROW::AttributeHeapSize() const noexcept
+{
+    const auto& runs = _attr.runs();
+    return runs.capacity() > 1 ? runs.capacity() * sizeof(runs[0]) : 0;
+}
+
+// Returns the size of the compact storage allocated by Freeze() in bytes.
+size_t ROW::ColdSize() const noexcept
+{
+    if (!_cold)
+    {
+        return 0;
+    }
+    const auto cold = _cold.get();
+    return (ColdHeaderSize + cold[1] + (cold[2] ? cold[0] + 1u : 0u)) * sizeof(uint16_t);
+}
+
+// Returns the memory that TextBuffer reserved for this row's _charsBuffer and _charOffsetsBuffer.
+std::span<const std::byte> ROW::ReservedStorage() const noexcept
+{
+    const auto beg = til::bit_cast<const std::byte*>(_charsBuffer);
+    const auto end = til::bit_cast<const std::byte*>(_charOffsetsBuffer + _columnCount + 1);
+    return { beg, end };
+}
+
+// Routine Description:
+// - Moves the text of this row into a compact heap allocation and switches the row back to the blank template,
+//   so that the memory backing it can be decommitted. The text is restored by Thaw() or the next write.
+// Arguments:
+// - blankTemplate - the same blank row that this row was constructed with.
+// Return Value:
+// - false if the row isn't materialized, or if its text doesn't fit into _charsBuffer
+//   (in which case it's stored in _charsHeap and there's nothing to gain).
+bool ROW::Freeze(const ROW& blankTemplate)
+{
+    if (!IsMaterialized() || _charsHeap)
+    {
+        return false;
+    }
+
+    const auto right = gsl::narrow_cast<uint16_t>(MeasureRight());
+    const auto length = _uncheckedCharOffset(right);
+
+    // For most rows every column contains exactly 1 narrow character and we can skip storing the offsets.
+    auto identity = length == right;
+    for (uint16_t col = 0; identity && col < right; ++col)
+    {
+        identity = til::at(_charOffsets, col) == col;
+    }
+
+    const size_t offsetCount = identity ? 0 : right + 1u;
+    auto cold = std::make_unique_for_overwrite<uint16_t[]>(ColdHeaderSize + length + offsetCount);
+    const std::span coldSpan{ cold.get(), ColdHeaderSize + length + offsetCount };
+
+    til::at(coldSpan, 0) = right;
+    til::at(coldSpan, 1) = length;
+    til::at(coldSpan, 2) = offsetCount != 0;
+    memcpy(coldSpan.subspan(ColdHeaderSize).data(), _chars.data(), length * sizeof(wchar_t));
+    std::copy_n(_charOffsets.begin(), offsetCount, coldSpan.subspan(ColdHeaderSize + length).begin());
+
+    _cold = std::move(cold);
+    _chars = blankTemplate._chars;
+    _charOffsets = blankTemplate._charOffsets;
+    return true;
+}
+
+// Restores the text of a row that was frozen with Freeze().
+void ROW::Thaw() noexcept
+{
+    if (_cold)
+    {
+        _materialize();
+    }
+}
+
+// Releases the compact storage of a frozen row, so that it can be moved elsewhere (see ScrollbackSpill).
+// The row reads as blank until the data is handed back via RestoreColdData(). Its size is given by ColdSize().
+std::unique_ptr<uint16_t[]> ROW::TakeColdData() noexcept
+{
+    return std::move(_cold);
+}
+
+// The counterpart to TakeColdData(). The row must not have been written to in the meantime.
+void ROW::RestoreColdData(std::unique_ptr<uint16_t[]> data) noexcept
+{
+    assert(!IsMaterialized());
+    _cold = std::move(data);
+}
+
 // Routine Description:
 // - Sets all properties of the ROW to default values
 // Arguments:
@@ -126,13 +353,44 @@ LineRendition ROW::GetLineRendition() const noexcept
 // - <none>
 void ROW::Reset(const TextAttribute& attr)
 {
+    _cold.reset();
+    _imageSlice.reset();
+    // A row that hasn't been materialized yet is blank already.
+    // There's no need to commit its memory just to fill it with whitespace.
+    if (IsMaterialized())
+    {
+        _charsHeap.reset();
+        _chars = { _charsBuffer, _columnCount };
+        _init();
+    }
+    _attr = { _columnCount, attr };
+    _lineRendition = LineRendition::SingleWidth;
+    _wrapForced = false;
+    _doubleBytePadded = false;
+    _revision++;
+}
+
+// Routine Description:
+// - Like Reset(), but instead of filling the row with whitespace it's switched back to the blank template
+//   it was constructed with, just like Freeze() does. The row doesn't touch its own memory until it's
+//   written to again, which allows TextBuffer to decommit it (see TextBuffer::ClearRows()).
+// Arguments:
+// - blankTemplate - the same blank row that this row was constructed with.
+// - attr - The default attribute (color) to fill
+// Return Value:
+// - <none>
+void ROW::ResetToTemplate(const ROW& blankTemplate, const TextAttribute& attr) noexcept
+{
+    _cold.reset();
+    _imageSlice.reset();
     _charsHeap.reset();
-    _chars = { _charsBuffer, _columnCount };
+    _chars = blankTemplate._chars;
+    _charOffsets = blankTemplate._charOffsets;
     _attr = { _columnCount, attr };
     _lineRendition = LineRendition::SingleWidth;
     _wrapForced = false;
     _doubleBytePadded = false;
-    _init();
+    _revision++;
 }
 
 void ROW::_init() noexcept
@@ -141,10 +399,60 @@ void ROW::_init() noexcept
     std::iota(_charOffsets.begin(), _charOffsets.end(), uint16_t{ 0 });
 }
 
+// Commits the memory reserved for this row and switches it over from the shared blank template
+// to its own buffers. All modifications of _chars and _charOffsets go through WriteHelper, which calls this.
+void ROW::_materialize() noexcept
+{
+    if (IsMaterialized()) [[likely]]
+    {
+        return;
+    }
+
+    // TextBuffer::_allocateBuffer() places the two buffers back to back.
+    // VirtualAlloc() rounds the range out to whole pages and is a no-op for those that are committed already.
+    const auto beg = til::bit_cast<uintptr_t>(_charsBuffer);
+    const auto end = til::bit_cast<uintptr_t>(_charOffsetsBuffer) + (::base::strict_cast<size_t>(_columnCount) + 1u) * sizeof(uint16_t);
+    // Running out of commit charge here is no different from failing to allocate the entire buffer upfront,
+    // except that we can't report it to the caller, as WriteHelper is noexcept.
+    FAIL_FAST_IF_NULL_ALLOC(VirtualAlloc(_charsBuffer, end - beg, MEM_COMMIT, PAGE_READWRITE));
+
+    _chars = { _charsBuffer, _columnCount };
+    _charOffsets = { _charOffsetsBuffer, ::base::strict_cast<size_t>(_columnCount) + 1u };
+    _init();
+
+    if (_cold)
+    {
+        _thaw();
+    }
+}
+
+// The counterpart to Freeze(). Must be called after _init() has filled the row with whitespace.
+void ROW::_thaw() noexcept
+{
+    const auto cold = _cold.get();
+    const size_t right = cold[0];
+    const size_t length = cold[1];
+    const auto hasOffsets = cold[2] != 0;
+    const std::span coldSpan{ cold, ColdHeaderSize + length + (hasOffsets ? right + 1 : 0) };
+
+    memcpy(_chars.data(), coldSpan.subspan(ColdHeaderSize).data(), length * sizeof(wchar_t));
+
+    if (hasOffsets)
+    {
+        std::copy_n(coldSpan.subspan(ColdHeaderSize + length).begin(), right + 1, _charOffsets.begin());
+        // Past MeasureRight() there's only whitespace, which is 1 character per column.
+        // Freeze() ensured that it all fits into _charsBuffer, which _init() filled with whitespace.
+        std::iota(_charOffsets.begin() + right + 1, _charOffsets.end(), gsl::narrow_cast<uint16_t>(length + 1));
+    }
+
+    _cold.reset();
+}
+
 void ROW::TransferAttributes(const til::small_rle<TextAttribute, uint16_t, 1>& attr, til::CoordType newWidth)
 {
     _attr = attr;
     _attr.resize_trailing_extent(gsl::narrow<uint16_t>(newWidth));
+    _revision++;
 }
 
 // Returns the previous possible cursor position, preceding the given column.
@@ -316,21 +624,49 @@ OutputCellIterator ROW::WriteCells(OutputCellIterator it, const til::CoordType c
     return it;
 }
 
+const ImageSlice* ROW::GetImageSlice() const noexcept
+{
+    return _imageSlice.get();
+}
+
+// Returns the row's image slice, creating it if necessary. If the existing one uses
+// a different cell size, it's replaced, since the two can't be combined.
+ImageSlice& ROW::GetOrCreateImageSlice(const til::size cellSize)
+{
+    if (!_imageSlice || _imageSlice->CellSize() != cellSize)
+    {
+        _imageSlice = std::make_unique<ImageSlice>(cellSize);
+    }
+    _revision++;
+    return *_imageSlice;
+}
+
+ImageSlice::Pointer ROW::TakeImageSlice() noexcept
+{
+    _revision++;
+    return std::move(_imageSlice);
+}
+
 bool ROW::SetAttrToEnd(const til::CoordType columnBegin, const TextAttribute attr)
 {
     _attr.replace(_clampedColumnInclusive(columnBegin), _attr.size(), attr);
+    _revision++;
     return true;
 }
 
 void ROW::ReplaceAttributes(const til::CoordType beginIndex, const til::CoordType endIndex, const TextAttribute& newAttr)
 {
     _attr.replace(_clampedColumnInclusive(beginIndex), _clampedColumnInclusive(endIndex), newAttr);
+    _revision++;
 }
 
 [[msvc::forceinline]] ROW::WriteHelper::WriteHelper(ROW& row, til::CoordType columnBegin, til::CoordType columnLimit, const std::wstring_view& chars) noexcept :
     row{ row },
     chars{ chars }
 {
+    row._materialize();
+    // This covers ReplaceCharacters(), ReplaceText(), CopyRangeFrom() and everything built on top of them.
+    row._revision++;
     colBeg = row._clampedColumnInclusive(columnBegin);
     colLimit = row._clampedColumnInclusive(columnLimit);
     chBegDirty = row._uncheckedCharOffset(colBeg);
@@ -422,9 +758,33 @@ catch (...)
 {
     size_t ch = chBeg;
 
-    for (const auto& s : til::utf16_iterator{ chars })
+    // Fast path: ASCII characters are always 1 column wide, so for the leading run of them the
+    // _charOffsets are simply consecutive. The characters themselves are memcpy'd by Finish().
+    if (const auto ascii = std::min<size_t>(asciiPrefixLength(chars), colLimit - colEnd))
+    {
+        iota_n(row._charOffsets.begin() + colEnd, ascii, gsl::narrow_cast<uint16_t>(ch));
+        colEnd = gsl::narrow_cast<uint16_t>(colEnd + ascii);
+        colEndDirty = colEnd;
+        ch += ascii;
+    }
+
+    while (ch - chBeg < chars.size())
     {
-        const auto wide = til::at(s, 0) < 0x80 ? false : IsGlyphFullWidth(s);
+        const auto rest = chars.substr(ch - chBeg);
+
+        // Other narrow characters (most of Latin, Greek, Cyrillic, etc.) work the same, but need a table lookup.
+        // Measuring them in runs avoids the per-glyph overhead of IsGlyphFullWidth().
+        if (const auto narrow = std::min<size_t>(GlyphNarrowPrefixLength(rest), colLimit - colEnd))
+        {
+            iota_n(row._charOffsets.begin() + colEnd, narrow, gsl::narrow_cast<uint16_t>(ch));
+            colEnd = gsl::narrow_cast<uint16_t>(colEnd + narrow);
+            colEndDirty = colEnd;
+            ch += narrow;
+            continue;
+        }
+
+        const auto s = til::utf16_next(rest);
+        const auto wide = IsGlyphFullWidth(s);
         const auto colEndNew = gsl::narrow_cast<uint16_t>(colEnd + 1u + wide);
         if (colEndNew > colLimit)
         {
@@ -445,6 +805,78 @@ catch (...)
     charsConsumed = ch - chBeg;
 }
 
+// Writes the CHAR_INFOs given to WriteConsoleOutputW() into the row, starting at columnBegin, as far as they fit.
+// Unlike WriteCells() this writes all of their text at once and converts their attributes once per run.
+// Returns false without modifying the row if the DBCS leading and trailing bytes don't form proper pairs.
+// WriteCells() has a number of legacy quirks for those and the caller needs to fall back to it.
+bool ROW::WriteCharInfos(const til::CoordType columnBegin, const std::span<const CHAR_INFO> charInfos)
+try
+{
+    if (columnBegin < 0 || columnBegin >= _columnCount || charInfos.empty())
+    {
+        return false;
+    }
+
+    const auto colBeg = gsl::narrow_cast<uint16_t>(columnBegin);
+    const auto count = std::min<size_t>(charInfos.size(), _columnCount - colBeg);
+
+    // Translate the CHAR_INFOs into the same format as _chars/_charOffsets,
+    // so that WriteHelper::CopyRangeFrom() can write them in one go.
+    til::small_vector<wchar_t, 256> chars;
+    til::small_vector<uint16_t, 257> charOffsets;
+    chars.reserve(count);
+    charOffsets.reserve(count + 1);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const auto& ci = til::at(charInfos, i);
+
+        if (WI_IsFlagSet(ci.Attributes, COMMON_LVB_TRAILING_BYTE))
+        {
+            if (i == 0 || WI_IsFlagClear(til::at(charInfos, i - 1).Attributes, COMMON_LVB_LEADING_BYTE))
+            {
+                return false;
+            }
+            charOffsets.emplace_back(gsl::narrow_cast<uint16_t>((chars.size() - 1) | CharOffsetsTrailer));
+            continue;
+        }
+
+        if (WI_IsFlagSet(ci.Attributes, COMMON_LVB_LEADING_BYTE) && (i + 1 >= count || WI_IsFlagClear(til::at(charInfos, i + 1).Attributes, COMMON_LVB_TRAILING_BYTE)))
+        {
+            return false;
+        }
+
+        charOffsets.emplace_back(gsl::narrow_cast<uint16_t>(chars.size()));
+        chars.emplace_back(ci.Char.UnicodeChar);
+    }
+
+    charOffsets.emplace_back(gsl::narrow_cast<uint16_t>(chars.size()));
+
+    const std::wstring_view text{ chars.data(), chars.size() };
+    WriteHelper h{ *this, colBeg, colBeg + gsl::narrow_cast<til::CoordType>(count), text };
+    h.CopyRangeFrom({ charOffsets.data(), charOffsets.size() });
+    h.Finish();
+
+    static constexpr WORD dbcsMask = COMMON_LVB_LEADING_BYTE | COMMON_LVB_TRAILING_BYTE;
+    for (size_t beg = 0; beg < count;)
+    {
+        const auto legacyAttributes = gsl::narrow_cast<WORD>(til::at(charInfos, beg).Attributes & ~dbcsMask);
+        auto end = beg + 1;
+        for (; end < count && (til::at(charInfos, end).Attributes & ~dbcsMask) == legacyAttributes; ++end)
+        {
+        }
+        _attr.replace(gsl::narrow_cast<uint16_t>(colBeg + beg), gsl::narrow_cast<uint16_t>(colBeg + end), TextAttribute{ legacyAttributes });
+        beg = end;
+    }
+
+    return true;
+}
+catch (...)
+{
+    Reset(TextAttribute{});
+    throw;
+}
+
 til::CoordType ROW::CopyRangeFrom(til::CoordType columnBegin, til::CoordType columnLimit, const ROW& other, til::CoordType& otherBegin, til::CoordType otherLimit)
 try
 {
@@ -489,6 +921,25 @@ catch (...)
     throw;
 }
 
+// Copies the attributes of the columns [otherBegin, otherEnd) of the other row to columnBegin, as far as they fit.
+// Unlike the copy in CopyRangeFrom() this maps columns 1:1 and copies entire runs at once. other may be this row.
+void ROW::CopyAttributesFrom(const til::CoordType columnBegin, const ROW& other, const til::CoordType otherBegin, const til::CoordType otherEnd)
+{
+    const auto colBeg = _clampedColumnInclusive(columnBegin);
+    const auto otherColBeg = other._clampedColumnInclusive(otherBegin);
+    const auto otherColEnd = other._clampedColumnInclusive(otherEnd);
+    if (otherColBeg >= otherColEnd || colBeg >= _columnCount)
+    {
+        return;
+    }
+
+    const auto length = std::min<uint16_t>(otherColEnd - otherColBeg, _columnCount - colBeg);
+    // slice() returns a copy, so this is safe even if other is this row.
+    const auto attributes = other._attr.slice(otherColBeg, gsl::narrow_cast<uint16_t>(otherColBeg + length));
+    _attr.replace(colBeg, gsl::narrow_cast<uint16_t>(colBeg + length), attributes);
+    _revision++;
+}
+
 [[msvc::forceinline]] void ROW::WriteHelper::CopyRangeFrom(const std::span<const uint16_t>& charOffsets) noexcept
 {
     // Since our `charOffsets` input is already in columns (just like the `ROW::_charOffsets`),
@@ -528,6 +979,12 @@ catch (...)
 {
     colEndDirty = row._adjustForward(colEndDirty);
 
+    // Text that's written over an image replaces it.
+    if (row._imageSlice && row._imageSlice->EraseCells(colBegDirty, colEndDirty))
+    {
+        row._imageSlice.reset();
+    }
+
     const uint16_t trailingSpaces = colEndDirty - colEnd;
     const auto chEndDirtyOld = row._uncheckedCharOffset(colEndDirty);
     const auto chEndDirty = chBegDirty + charsConsumed + leadingSpaces + trailingSpaces;
@@ -588,8 +1045,9 @@ void ROW::_resizeChars(uint16_t colEndDirty, uint16_t chBegDirty, size_t chEndDi
         const auto minCapacity = std::min<size_t>(UINT16_MAX, _chars.size() + (_chars.size() >> 1));
         const auto newCapacity = gsl::narrow<uint16_t>(std::max(newLength, minCapacity));
 
-        auto charsHeap = std::make_unique_for_overwrite<wchar_t[]>(newCapacity);
-        const std::span chars{ charsHeap.get(), newCapacity };
+        // The pool rounds the capacity up to its size class, which leaves room for the row to grow further.
+        auto charsHeap = _charsPool->Allocate(newCapacity);
+        const std::span chars{ charsHeap.get(), charsHeap.get_deleter().capacity };
 
         std::copy_n(_chars.begin(), chBegDirty, chars.begin());
         std::copy_n(_chars.begin() + chEndDirtyOld, currentLength - chEndDirtyOld, chars.begin() + chEndDirty);
@@ -608,6 +1066,8 @@ void ROW::_resizeChars(uint16_t colEndDirty, uint16_t chBegDirty, size_t chEndDi
 
 til::small_rle<TextAttribute, uint16_t, 1>& ROW::Attributes() noexcept
 {
+    // The caller is presumably about to modify the attributes.
+    _revision++;
     return _attr;
 }
 
@@ -634,6 +1094,42 @@ std::vector<uint16_t> ROW::GetHyperlinks() const
     return ids;
 }
 
+RowGlyphIterator::RowGlyphIterator(const ROW& row, til::CoordType columnBegin, til::CoordType columnEnd) noexcept :
+    _row{ row },
+    _attr{ row._attr.begin() },
+    _col{ row._clampedColumnInclusive(columnBegin) },
+    _limit{ row._clampedColumnInclusive(columnEnd) }
+{
+    _next = _col;
+    _attr += _col;
+}
+
+bool RowGlyphIterator::Next() noexcept
+{
+    if (_next >= _limit)
+    {
+        return false;
+    }
+
+    _attr += _next - _col;
+    _col = _next;
+    // This is only ever not a no-op for the first glyph, if columnBegin pointed at its trailing half.
+    _beg = _row._adjustBackward(_col);
+
+    // Safety: _col is [0, _columnCount), and the last _charOffset at index
+    // _columnCount will never get the CharOffsetsTrailer flag.
+    _next = gsl::narrow_cast<uint16_t>(_col + 1);
+    while (_row._uncheckedIsTrailer(_next))
+    {
+        ++_next;
+    }
+
+    const auto chBeg = _row._uncheckedCharOffset(_beg);
+    const auto chEnd = _row._uncheckedCharOffset(_next);
+    _text = { _row._chars.data() + chBeg, gsl::narrow_cast<size_t>(chEnd - chBeg) };
+    return true;
+}
+
 uint16_t ROW::size() const noexcept
 {
     return _columnCount;
@@ -665,6 +1161,21 @@ til::CoordType ROW::MeasureLeft() const noexcept
 
 til::CoordType ROW::MeasureRight() const noexcept
 {
+    // Freeze() stored the measurement for us, which allows TextBuffer::Reflow() to lay out cold rows without thawing them.
+    if (_cold) [[unlikely]]
+    {
+        return _cold[0];
+    }
+    // Rows that still share the blank template don't contain any text.
+    if (!IsMaterialized())
+    {
+        return 0;
+    }
+    if (_measureRightRevision == _revision)
+    {
+        return _measureRight;
+    }
+
     const auto text = GetText();
     const auto beg = text.begin();
     const auto end = text.end();
@@ -684,25 +1195,16 @@ til::CoordType ROW::MeasureRight() const noexcept
     //
     // An example: The row is 10 cells wide and `it` points to the second character.
     // `it - beg` would return 1, but it's possible it's actually 1 wide glyph and 8 whitespace.
-    return gsl::narrow_cast<til::CoordType>(_columnCount - (end - it));
+    _measureRight = gsl::narrow_cast<uint16_t>(_columnCount - (end - it));
+    _measureRightRevision = _revision;
+    return _measureRight;
 }
 
+// Returns true if the row contains anything but whitespace.
+// This is O(1) for blank, cold and unmodified rows, since MeasureRight() is.
 bool ROW::ContainsText() const noexcept
 {
-    const auto text = GetText();
-    const auto beg = text.begin();
-    const auto end = text.end();
-    auto it = beg;
-
-    for (; it != end; ++it)
-    {
-        if (*it != L' ')
-        {
-            return true;
-        }
-    }
-
-    return false;
+    return MeasureRight() != 0;
 }
 
 std::wstring_view ROW::GlyphAt(til::CoordType column) const noexcept
@@ -726,6 +1228,25 @@ DbcsAttribute ROW::DbcsAttrAt(til::CoordType column) const noexcept
 {
     const auto col = _clampedColumn(column);
 
+    // Like MeasureRight(), this is accurate for cold rows. Without stored offsets they only contain narrow glyphs.
+    if (_cold) [[unlikely]]
+    {
+        const auto cold = _cold.get();
+        const size_t right = cold[0];
+        const size_t length = cold[1];
+        if (!cold[2] || col >= right)
+        {
+            return DbcsAttribute::Single;
+        }
+
+        const auto offsets = std::span{ cold, ColdHeaderSize + length + right + 1 }.subspan(ColdHeaderSize + length);
+        if (WI_IsFlagSet(til::at(offsets, col), CharOffsetsTrailer))
+        {
+            return DbcsAttribute::Trailing;
+        }
+        return WI_IsFlagSet(til::at(offsets, col + 1u), CharOffsetsTrailer) ? DbcsAttribute::Leading : DbcsAttribute::Single;
+    }
+
     auto attr = DbcsAttribute::Single;
     // Safety: col is [0, _columnCount).
     if (_uncheckedIsTrailer(col))
@@ -746,6 +1267,61 @@ std::wstring_view ROW::GetText() const noexcept
     return { _chars.data(), _charSize() };
 }
 
+// Returns the text of all glyphs whose leading half is within the columns [columnBegin, columnEnd).
+std::wstring_view ROW::GetText(til::CoordType columnBegin, til::CoordType columnEnd) const noexcept
+{
+    size_t colBeg = _clampedColumnInclusive(columnBegin);
+    size_t colEnd = std::max<size_t>(_clampedColumnInclusive(columnEnd), colBeg);
+
+    // Safety: col cannot be incremented past _columnCount, because the last
+    // _charOffset at index _columnCount will never get the CharOffsetsTrailer flag.
+    for (; _uncheckedIsTrailer(colBeg); ++colBeg)
+    {
+    }
+    for (; _uncheckedIsTrailer(colEnd); ++colEnd)
+    {
+    }
+
+    const size_t chBeg = _uncheckedCharOffset(colBeg);
+    const size_t chEnd = _uncheckedCharOffset(std::max(colBeg, colEnd));
+    return { _chars.data() + chBeg, chEnd - chBeg };
+}
+
+// Returns the column of the glyph that contains the character at the given offset into GetText().
+// For wide glyphs this is the column of their leading half.
+til::CoordType ROW::GetLeadingColumnAtCharOffset(const ptrdiff_t offset) const noexcept
+{
+    const auto off = gsl::narrow_cast<uint16_t>(std::clamp<ptrdiff_t>(offset, 0, _charSize() - 1));
+
+    // _charOffsets is sorted (ignoring the trailer flag), so we can binary search for
+    // the last column that starts at or before the given offset. That's always the
+    // last column of a glyph, because trailers share the offset of their leading half.
+    uint16_t lo = 0;
+    uint16_t hi = _columnCount;
+    while (hi - lo > 1)
+    {
+        const auto mid = gsl::narrow_cast<uint16_t>((lo + hi) / 2);
+        if (_uncheckedCharOffset(mid) <= off)
+        {
+            lo = mid;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    return _adjustBackward(lo);
+}
+
+// Returns the column of the glyph that contains the character at the given offset into GetText().
+// For wide glyphs this is the column of their trailing half.
+til::CoordType ROW::GetTrailingColumnAtCharOffset(const ptrdiff_t offset) const noexcept
+{
+    const auto col = gsl::narrow_cast<uint16_t>(GetLeadingColumnAtCharOffset(offset));
+    return _adjustForward(gsl::narrow_cast<uint16_t>(col + 1)) - 1;
+}
+
 DelimiterClass ROW::DelimiterClassAt(til::CoordType column, const std::wstring_view& wordDelimiters) const noexcept
 {
     const auto col = _clampedColumn(column);
@@ -766,6 +1342,52 @@ DelimiterClass ROW::DelimiterClassAt(til::CoordType column, const std::wstring_v
     }
 }
 
+// Computes the DelimiterClass of all columns at once, as two bitmaps with one bit per column:
+// The bits in `regular` are set for RegularChars and those in `control` for ControlChars.
+// Columns with neither bit set are DelimiterChars. Both spans must hold (width + 63) / 64 words.
+void ROW::GetDelimiterClasses(const std::wstring_view& wordDelimiters, std::span<uint64_t> regular, std::span<uint64_t> control) const noexcept
+{
+    // Practically all delimiters are ASCII. They're looked up in this bitmap
+    // instead of searching through wordDelimiters for every single column.
+    uint64_t asciiDelimiters[2]{};
+    auto hasOtherDelimiters = false;
+    for (const auto ch : wordDelimiters)
+    {
+        if (ch < 128)
+        {
+            til::at(asciiDelimiters, ch >> 6) |= uint64_t{ 1 } << (ch & 63);
+        }
+        else
+        {
+            hasOtherDelimiters = true;
+        }
+    }
+
+    std::fill(regular.begin(), regular.end(), 0);
+    std::fill(control.begin(), control.end(), 0);
+
+    const auto columns = std::min<size_t>({ _columnCount, regular.size() * 64, control.size() * 64 });
+    for (size_t col = 0; col < columns; ++col)
+    {
+        // Safety: col is [0, _columnCount).
+        const auto glyph = _uncheckedChar(_uncheckedCharOffset(col));
+        const auto bit = uint64_t{ 1 } << (col & 63);
+
+        if (glyph <= L' ')
+        {
+            til::at(control, col >> 6) |= bit;
+        }
+        else if (glyph < 128 ? (til::at(asciiDelimiters, glyph >> 6) >> (glyph & 63)) & 1 : hasOtherDelimiters && wordDelimiters.find(glyph) != std::wstring_view::npos)
+        {
+            // DelimiterChar: neither bit is set.
+        }
+        else
+        {
+            til::at(regular, col >> 6) |= bit;
+        }
+    }
+}
+
 template<typename T>
 constexpr uint16_t ROW::_clampedUint16(T v) noexcept
 {
@@ -22,11 +22,14 @@ Revision History:
 
 #include <til/rle.h>
 
+#include "ImageSlice.hpp"
 #include "LineRendition.hpp"
 #include "OutputCell.hpp"
 #include "OutputCellIterator.hpp"
+#include "RowCharPool.hpp"
 
 class TextBuffer;
+class ROW;
 
 enum class DelimiterClass
 {
@@ -61,7 +64,8 @@ class ROW final
 {
 public:
     ROW() = default;
-    ROW(wchar_t* charsBuffer, uint16_t* charOffsetsBuffer, uint16_t rowWidth, const TextAttribute& fillAttribute);
+    ROW(wchar_t* charsBuffer, uint16_t* charOffsetsBuffer, RowCharPool* charsPool, uint16_t rowWidth, const TextAttribute& fillAttribute);
+    ROW(wchar_t* charsBuffer, uint16_t* charOffsetsBuffer, RowCharPool* charsPool, const ROW& blankTemplate, const TextAttribute& fillAttribute);
 
     ROW(const ROW& other) = delete;
     ROW& operator=(const ROW& other) = delete;
@@ -75,8 +79,22 @@ public:
     bool WasDoubleBytePadded() const noexcept;
     void SetLineRendition(const LineRendition lineRendition) noexcept;
     LineRendition GetLineRendition() const noexcept;
+    uint64_t GetId() const noexcept;
+    void SetId(const uint64_t id) noexcept;
+    uint64_t GetRevision() const noexcept;
+    size_t GetContentHash() const noexcept;
+    bool IsMaterialized() const noexcept;
+    bool IsCold() const noexcept;
+    size_t ColdSize() const noexcept;
+    size_t AttributeHeapSize() const noexcept;
+    std::span<const std::byte> ReservedStorage() const noexcept;
+    bool Freeze(const ROW& blankTemplate);
+    void Thaw() noexcept;
+    std::unique_ptr<uint16_t[]> TakeColdData() noexcept;
+    void RestoreColdData(std::unique_ptr<uint16_t[]> data) noexcept;
 
     void Reset(const TextAttribute& attr);
+    void ResetToTemplate(const ROW& blankTemplate, const TextAttribute& attr) noexcept;
     void TransferAttributes(const til::small_rle<TextAttribute, uint16_t, 1>& attr, til::CoordType newWidth);
 
     til::CoordType NavigateToPrevious(til::CoordType column) const noexcept;
@@ -88,7 +106,13 @@ public:
     void ReplaceAttributes(til::CoordType beginIndex, til::CoordType endIndex, const TextAttribute& newAttr);
     void ReplaceCharacters(til::CoordType columnBegin, til::CoordType width, const std::wstring_view& chars);
     void ReplaceText(RowWriteState& state);
+    bool WriteCharInfos(til::CoordType columnBegin, std::span<const CHAR_INFO> charInfos);
     til::CoordType CopyRangeFrom(til::CoordType columnBegin, til::CoordType columnLimit, const ROW& other, til::CoordType& otherBegin, til::CoordType otherLimit);
+    void CopyAttributesFrom(til::CoordType columnBegin, const ROW& other, til::CoordType otherBegin, til::CoordType otherEnd);
+
+    const ImageSlice* GetImageSlice() const noexcept;
+    ImageSlice& GetOrCreateImageSlice(til::size cellSize);
+    ImageSlice::Pointer TakeImageSlice() noexcept;
 
     til::small_rle<TextAttribute, uint16_t, 1>& Attributes() noexcept;
     const til::small_rle<TextAttribute, uint16_t, 1>& Attributes() const noexcept;
@@ -102,7 +126,11 @@ public:
     std::wstring_view GlyphAt(til::CoordType column) const noexcept;
     DbcsAttribute DbcsAttrAt(til::CoordType column) const noexcept;
     std::wstring_view GetText() const noexcept;
+    std::wstring_view GetText(til::CoordType columnBegin, til::CoordType columnEnd) const noexcept;
+    til::CoordType GetLeadingColumnAtCharOffset(ptrdiff_t offset) const noexcept;
+    til::CoordType GetTrailingColumnAtCharOffset(ptrdiff_t offset) const noexcept;
     DelimiterClass DelimiterClassAt(til::CoordType column, const std::wstring_view& wordDelimiters) const noexcept;
+    void GetDelimiterClasses(const std::wstring_view& wordDelimiters, std::span<uint64_t> regular, std::span<uint64_t> control) const noexcept;
 
     auto AttrBegin() const noexcept { return _attr.begin(); }
     auto AttrEnd() const noexcept { return _attr.end(); }
@@ -113,6 +141,8 @@ public:
 #endif
 
 private:
+    friend class RowGlyphIterator;
+
     // WriteHelper exists because other forms of abstracting this functionality away (like templates with lambdas)
     // where only very poorly optimized by MSVC as it failed to inline the templates.
     struct WriteHelper
@@ -162,6 +192,8 @@ private:
     // trailing half of a wide glyph. This simplifies many implementation details via _uncheckedIsTrailer.
     static constexpr uint16_t CharOffsetsTrailer = 0x8000;
     static constexpr uint16_t CharOffsetsMask = 0x7fff;
+    // The number of uint16_t at the start of _cold which describe its contents.
+    static constexpr size_t ColdHeaderSize = 3;
 
     template<typename T>
     static constexpr uint16_t _clampedUint16(T v) noexcept;
@@ -179,6 +211,8 @@ private:
     bool _uncheckedIsTrailer(size_t col) const noexcept;
 
     void _init() noexcept;
+    void _materialize() noexcept;
+    void _thaw() noexcept;
     void _resizeChars(uint16_t colEndDirty, uint16_t chBegDirty, size_t chEndDirty, uint16_t chEndDirtyOld);
 
     // These fields are a bit "wasteful", but it makes all this a bit more robust against
@@ -196,10 +230,19 @@ private:
     // a simplified chars buffer, without having to allocate any additional heap memory.
     // _charsBuffer fits _columnCount characters at most.
     wchar_t* _charsBuffer = nullptr;
+    // The backing buffer for _charOffsets, which fits _columnCount + 1 offsets.
+    //
+    // Rows created via the blankTemplate constructor don't use either of these two buffers until they're first
+    // written to, because TextBuffer only reserves the address space for them. Until then _chars and _charOffsets
+    // refer to a shared, read-only blank row, so that memory usage scales with the buffer's contents and not
+    // its capacity. A row is "materialized" once _charOffsets refers to _charOffsetsBuffer.
+    uint16_t* _charOffsetsBuffer = nullptr;
     // ...but if this ROW needs to store more than _columnCount characters
-    // then it will allocate a larger string on the heap and store it here.
-    // The capacity of this string on the heap is stored in _chars.size().
-    std::unique_ptr<wchar_t[]> _charsHeap;
+    // then it will allocate a larger string from _charsPool and store it here.
+    // The capacity of this string is stored in _chars.size().
+    RowCharPool::Pointer _charsHeap;
+    // The allocator owned by the TextBuffer this row belongs to. See RowCharPool.
+    RowCharPool* _charsPool = nullptr;
     // _chars either refers to our _charsBuffer or _charsHeap, defaulting to the former.
     // _chars.size() is NOT the length of the string, but rather its capacity.
     // _charOffsets[_columnCount] stores the length.
@@ -221,6 +264,16 @@ private:
     // In other words, _charOffsets tells us both the width in chars and width in columns.
     // See CharOffsetsTrailer for more information.
     std::span<uint16_t> _charOffsets;
+    // Rows that haven't been accessed in a while may get frozen by TextBuffer, which moves the text into this
+    // compact heap allocation, so that the memory backing _charsBuffer and _charOffsetsBuffer can be decommitted.
+    // The row shares the blank template while it's frozen and gets thawed by _materialize(). The layout is:
+    //   [0] the MeasureRight() column count, [1] the text length up to that column,
+    //   [2] whether _charOffsets is stored (it's omitted if it's the identity mapping),
+    //   followed by the text and then optionally the first MeasureRight() + 1 _charOffsets.
+    // _attr isn't moved, since it's run-length-encoded already.
+    std::unique_ptr<uint16_t[]> _cold;
+    // The part of a sixel image drawn into this row, if any. It's erased cell by cell as text is written over it.
+    ImageSlice::Pointer _imageSlice;
     // _attr is a run-length-encoded vector of TextAttribute with a decompressed
     // length equal to _columnCount (= 1 TextAttribute per column).
     til::small_rle<TextAttribute, uint16_t, 1> _attr;
@@ -232,6 +285,19 @@ private:
     bool _wrapForced = false;
     // Occurs when the user runs out of text to support a double byte character and we're forced to the next line
     bool _doubleBytePadded = false;
+    // Identifies the line of text that this row holds. TextBuffer assigns a new one whenever it
+    // recycles the row for a new line, so it stays the same while the circular buffer rotates.
+    uint64_t _id = 0;
+    // Incremented whenever the contents of this row change (text, attributes or any of the flags above).
+    // Together with _id this allows consumers to cache information that they derived from a row.
+    uint64_t _revision = 0;
+    // The result of GetContentHash() and the _revision it was calculated for.
+    mutable size_t _contentHash = 0;
+    mutable uint64_t _contentHashRevision = UINT64_MAX;
+    // The result of MeasureRight() and the _revision it was calculated for.
+    // Reflow, GetLastNonSpaceCharacter() and friends measure the same rows over and over.
+    mutable uint16_t _measureRight = 0;
+    mutable uint64_t _measureRightRevision = UINT64_MAX;
 };
 
 #ifdef UNIT_TESTING
@@ -241,3 +307,37 @@ constexpr bool operator==(const ROW& a, const ROW& b) noexcept
     return a._charsBuffer == b._charsBuffer;
 }
 #endif
+
+// Walks the glyphs of a ROW that intersect the given columns, along with the columns they occupy
+// and their attributes. Unlike TextBufferCellIterator this doesn't look up the text, width and
+// attributes of every cell, it walks _charOffsets and the attribute runs in lockstep instead.
+// The row must be materialized, which is the case for all rows returned by TextBuffer::GetRowByOffset().
+class RowGlyphIterator
+{
+public:
+    RowGlyphIterator(const ROW& row, til::CoordType columnBegin, til::CoordType columnEnd) noexcept;
+
+    // Advances to the next glyph, including the first one. Returns false once the end was reached.
+    bool Next() noexcept;
+
+    // The text of the current glyph.
+    std::wstring_view Text() const noexcept { return _text; }
+    // The columns [ColumnBegin(), ColumnEnd()) occupied by the current glyph. For wide glyphs that
+    // are cut off by the given column range, this includes the columns outside of it.
+    til::CoordType ColumnBegin() const noexcept { return _beg; }
+    til::CoordType ColumnEnd() const noexcept { return _next; }
+    // The first column of the current glyph that's within the given column range.
+    til::CoordType Column() const noexcept { return _col; }
+    // The attributes of Column().
+    const TextAttribute& Attr() const noexcept { return *_attr; }
+
+private:
+    const ROW& _row;
+    til::small_rle<TextAttribute, uint16_t, 1>::const_iterator _attr;
+    std::wstring_view _text;
+    uint16_t _beg = 0;
+    uint16_t _col = 0;
+    uint16_t _next = 0;
+    uint16_t _limit = 0;
+};
+
@@ -0,0 +1,102 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include "RowCharPool.hpp"
+
+void RowCharPool::Deleter::operator()(wchar_t* chars) const noexcept
+{
+    pool->_deallocate(chars, capacity);
+}
+
+// Returns the index of the smallest size class that fits `capacity` characters.
+size_t RowCharPool::_classOf(const size_t capacity) noexcept
+{
+    const auto blocks = (std::max<size_t>(capacity, 1) - 1) >> MinClassShift;
+    return gsl::narrow_cast<size_t>(std::bit_width(blocks));
+}
+
+// Routine Description:
+// - Returns a block of at least `minCapacity` characters. The block may be larger than requested,
+//   in which case its size is that of its size class, limited to UINT16_MAX like the rows themselves.
+// Arguments:
+// - minCapacity - the number of characters the block needs to fit.
+// Return Value:
+// - The block. Its capacity is stored in its deleter.
+RowCharPool::Pointer RowCharPool::Allocate(const size_t minCapacity)
+{
+    const auto index = _classOf(minCapacity);
+    THROW_HR_IF(E_INVALIDARG, index >= ClassCount);
+
+    const auto blockChars = size_t{ 1 } << (index + MinClassShift);
+    const auto blockBytes = blockChars * sizeof(wchar_t);
+    auto& freeList = til::at(_freeLists, index);
+
+    if (!freeList)
+    {
+        // Size classes larger than a slab get a slab of their own.
+        const auto slabBytes = std::max(SlabBytes, blockBytes);
+        _slabs.reserve(_slabs.size() + 1);
+        auto& slab = _slabs.emplace_back(std::make_unique_for_overwrite<std::byte[]>(slabBytes));
+        _allocatedBytes += slabBytes;
+
+        // Thread the slab's blocks onto the free list back to front, so that they're handed out in address order.
+        for (auto offset = slabBytes; offset != 0;)
+        {
+            offset -= blockBytes;
+            const auto block = til::bit_cast<FreeBlock*>(slab.get() + offset);
+            block->next = freeList;
+            freeList = block;
+        }
+    }
+
+    const auto block = freeList;
+    freeList = block->next;
+    _usedBytes += blockBytes;
+    return Pointer{ til::bit_cast<wchar_t*>(block), Deleter{ this, std::min<size_t>(blockChars, UINT16_MAX) } };
+}
+
+// Puts a block that was returned by Allocate() back onto its free list.
+void RowCharPool::_deallocate(wchar_t* chars, const size_t capacity) noexcept
+{
+    const auto index = _classOf(capacity);
+    assert(index < ClassCount);
+
+    auto& freeList = til::at(_freeLists, index);
+    const auto freeBlock = til::bit_cast<FreeBlock*>(chars);
+    freeBlock->next = freeList;
+    freeList = freeBlock;
+    _usedBytes -= (size_t{ 1 } << (index + MinClassShift)) * sizeof(wchar_t);
+}
+
+// Routine Description:
+// - Frees all slabs at once, provided that none of their blocks are in use anymore,
+//   for instance because all rows have been reset. Otherwise it does nothing.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void RowCharPool::Release() noexcept
+{
+    if (_usedBytes != 0)
+    {
+        return;
+    }
+
+    _slabs = {};
+    _freeLists = {};
+    _allocatedBytes = 0;
+    _usedBytes = 0;
+}
+
+// The memory held by the slabs, whether it's in use or not.
+size_t RowCharPool::AllocatedBytes() const noexcept
+{
+    return _allocatedBytes;
+}
+
+// The memory held by blocks that are currently in use by rows.
+size_t RowCharPool::UsedBytes() const noexcept
+{
+    return _usedBytes;
+}
@@ -0,0 +1,61 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- RowCharPool.hpp
+
+Abstract:
+- A size-classed slab allocator for the text of rows that doesn't fit into their
+  slot in TextBuffer's _charBuffer (surrogate pairs, combining marks, emoji, ...).
+- Each TextBuffer owns one. Blocks are carved out of 64KiB slabs, one free list per
+  power-of-two size class, so that a screenful of emoji doesn't result in a heap
+  allocation per row. ROW hands its block back when it's reset, and the slabs are
+  released all at once when the buffer is reset or destroyed (e.g. by a resize).
+--*/
+
+#pragma once
+
+class RowCharPool final
+{
+public:
+    // Hands the block back to the pool it came from. The pool must outlive it.
+    struct Deleter
+    {
+        RowCharPool* pool = nullptr;
+        size_t capacity = 0;
+
+        void operator()(wchar_t* chars) const noexcept;
+    };
+    using Pointer = std::unique_ptr<wchar_t[], Deleter>;
+
+    RowCharPool() = default;
+    RowCharPool(const RowCharPool&) = delete;
+    RowCharPool& operator=(const RowCharPool&) = delete;
+
+    Pointer Allocate(size_t minCapacity);
+    void Release() noexcept;
+
+    size_t AllocatedBytes() const noexcept;
+    size_t UsedBytes() const noexcept;
+
+private:
+    // The smallest size class holds 64 characters and each one after it twice as many as the
+    // previous one. The largest one is big enough for any row, as their length is limited to UINT16_MAX.
+    static constexpr size_t MinClassShift = 6;
+    static constexpr size_t ClassCount = 17 - MinClassShift;
+    static constexpr size_t SlabBytes = 64 * 1024;
+
+    static size_t _classOf(size_t capacity) noexcept;
+    void _deallocate(wchar_t* chars, size_t capacity) noexcept;
+
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    std::vector<std::unique_ptr<std::byte[]>> _slabs;
+    std::array<FreeBlock*, ClassCount> _freeLists{};
+    size_t _allocatedBytes = 0;
+    size_t _usedBytes = 0;
+};
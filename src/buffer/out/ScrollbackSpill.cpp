@@ -0,0 +1,156 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include "ScrollbackSpill.hpp"
+
+#include <winioctl.h>
+
+// Every record is prefixed with its length in uint16_t.
+static constexpr size_t PrefixSize = sizeof(uint32_t);
+// MapViewOfFile() requires the offset to be a multiple of the allocation granularity, which is 64KiB on all of our platforms.
+static constexpr uint64_t ViewAlignment = 64 * 1024;
+
+ScrollbackSpill::ScrollbackSpill()
+{
+    wchar_t directory[MAX_PATH + 1];
+    THROW_LAST_ERROR_IF(!GetTempPathW(ARRAYSIZE(directory), &directory[0]));
+
+    // GetTempFileNameW() creates an empty file with a unique name, which we then reopen as a temporary file.
+    wchar_t path[MAX_PATH];
+    THROW_LAST_ERROR_IF(!GetTempFileNameW(&directory[0], L"wts", 0, &path[0]));
+
+    // The file only lives as long as we do and nobody else gets to open it in the meantime.
+    _file.reset(CreateFileW(&path[0], GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr));
+    if (!_file)
+    {
+        const auto hr = HRESULT_FROM_WIN32(GetLastError());
+        DeleteFileW(&path[0]);
+        THROW_HR(hr);
+    }
+
+    // Without support for sparse files (FAT32, etc.) dead segments simply keep occupying disk space.
+    DWORD bytesReturned = 0;
+    LOG_IF_WIN32_BOOL_FALSE(DeviceIoControl(_file.get(), FSCTL_SET_SPARSE, nullptr, 0, nullptr, 0, &bytesReturned, nullptr));
+}
+
+// Routine Description:
+// - Appends a record to the end of the log.
+// Arguments:
+// - data - the contents of the record.
+// Return Value:
+// - The offset of the record, which identifies it for Take() and Discard().
+uint64_t ScrollbackSpill::Append(const std::span<const uint16_t>& data)
+{
+    const auto length = gsl::narrow<uint32_t>(data.size());
+    const auto recordSize = PrefixSize + data.size_bytes();
+
+    // Records don't straddle segments, so that a segment can be deallocated as soon as all of its records are gone.
+    auto offset = _end;
+    if (offset / SegmentSize != (offset + recordSize - 1) / SegmentSize)
+    {
+        offset = (offset / SegmentSize + 1) * SegmentSize;
+    }
+
+    const auto segment = gsl::narrow<size_t>(offset / SegmentSize);
+    if (segment >= _segments.size())
+    {
+        _segments.resize(segment + 1);
+    }
+
+    const auto write = [&](uint64_t at, const void* buffer, size_t size) {
+        OVERLAPPED overlapped{};
+        overlapped.Offset = gsl::narrow_cast<DWORD>(at);
+        overlapped.OffsetHigh = gsl::narrow_cast<DWORD>(at >> 32);
+        DWORD written = 0;
+        THROW_IF_WIN32_BOOL_FALSE(WriteFile(_file.get(), buffer, gsl::narrow<DWORD>(size), &written, &overlapped));
+        THROW_HR_IF(E_UNEXPECTED, written != size);
+    };
+    write(offset, &length, PrefixSize);
+    write(offset + PrefixSize, data.data(), data.size_bytes());
+
+    auto& s = til::at(_segments, segment);
+    s.records++;
+    s.allocated = true;
+    _end = offset + recordSize;
+    _liveBytes += recordSize;
+    _liveRecords++;
+    return offset;
+}
+
+// Routine Description:
+// - Reads a record back into memory and removes it from the log.
+// Arguments:
+// - offset - the value returned by Append().
+// Return Value:
+// - The contents of the record.
+std::unique_ptr<uint16_t[]> ScrollbackSpill::Take(uint64_t offset)
+{
+    const auto length = _readLength(offset);
+    const auto viewOffset = offset & ~(ViewAlignment - 1);
+    const auto viewSize = gsl::narrow<size_t>(offset - viewOffset + PrefixSize + length * sizeof(uint16_t));
+
+    // The mapping is created on demand, because it can't cover any data that's appended after its creation.
+    const wil::unique_handle mapping{ CreateFileMappingW(_file.get(), nullptr, PAGE_READONLY, 0, 0, nullptr) };
+    THROW_LAST_ERROR_IF(!mapping);
+    const wil::unique_mapview_ptr<std::byte> view{ static_cast<std::byte*>(MapViewOfFile(mapping.get(), FILE_MAP_READ, gsl::narrow_cast<DWORD>(viewOffset >> 32), gsl::narrow_cast<DWORD>(viewOffset), viewSize)) };
+    THROW_LAST_ERROR_IF(!view);
+
+    const std::span record{ view.get(), viewSize };
+    auto data = std::make_unique_for_overwrite<uint16_t[]>(length);
+    memcpy(data.get(), record.subspan(gsl::narrow_cast<size_t>(offset - viewOffset) + PrefixSize).data(), length * sizeof(uint16_t));
+
+    _release(offset, length);
+    return data;
+}
+
+// Removes a record from the log without reading it.
+void ScrollbackSpill::Discard(uint64_t offset)
+{
+    _release(offset, _readLength(offset));
+}
+
+// Returns the size of all records that are currently in the log, in bytes.
+size_t ScrollbackSpill::LiveBytes() const noexcept
+{
+    return _liveBytes;
+}
+
+// Returns the number of records that are currently in the log.
+size_t ScrollbackSpill::LiveRecords() const noexcept
+{
+    return _liveRecords;
+}
+
+uint32_t ScrollbackSpill::_readLength(uint64_t offset) const
+{
+    OVERLAPPED overlapped{};
+    overlapped.Offset = gsl::narrow_cast<DWORD>(offset);
+    overlapped.OffsetHigh = gsl::narrow_cast<DWORD>(offset >> 32);
+    uint32_t length = 0;
+    DWORD read = 0;
+    THROW_IF_WIN32_BOOL_FALSE(ReadFile(_file.get(), &length, PrefixSize, &read, &overlapped));
+    THROW_HR_IF(E_UNEXPECTED, read != PrefixSize);
+    return length;
+}
+
+void ScrollbackSpill::_release(uint64_t offset, uint32_t length) noexcept
+{
+    const auto segment = gsl::narrow_cast<size_t>(offset / SegmentSize);
+    auto& s = til::at(_segments, segment);
+
+    s.records--;
+    _liveBytes -= PrefixSize + length * sizeof(uint16_t);
+    _liveRecords--;
+
+    // The segment that's currently being appended to is kept around, since it'll be written to again shortly.
+    if (s.records == 0 && s.allocated && segment != _end / SegmentSize)
+    {
+        FILE_ZERO_DATA_INFORMATION zero{};
+        zero.FileOffset.QuadPart = gsl::narrow_cast<LONGLONG>(segment * SegmentSize);
+        zero.BeyondFinalZero.QuadPart = gsl::narrow_cast<LONGLONG>((segment + 1) * SegmentSize);
+        DWORD bytesReturned = 0;
+        LOG_IF_WIN32_BOOL_FALSE(DeviceIoControl(_file.get(), FSCTL_SET_ZERO_DATA, &zero, sizeof(zero), nullptr, 0, &bytesReturned, nullptr));
+        s.allocated = false;
+    }
+}
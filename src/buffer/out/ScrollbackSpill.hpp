@@ -0,0 +1,50 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- ScrollbackSpill.hpp
+
+Abstract:
+- An append-only log of frozen rows (see ROW::Freeze()) in a temporary file.
+- TextBuffer moves the compact storage of rows that are far above the cursor
+  into it, so that their text doesn't occupy any memory until it's accessed again.
+- The file is sparse and split into fixed size segments. Once all records in a
+  segment have been taken back out or discarded, its disk space is deallocated.
+- Reads only map the part of the file they need into memory.
+--*/
+
+#pragma once
+
+class ScrollbackSpill final
+{
+public:
+    ScrollbackSpill();
+
+    uint64_t Append(const std::span<const uint16_t>& data);
+    std::unique_ptr<uint16_t[]> Take(uint64_t offset);
+    void Discard(uint64_t offset);
+
+    size_t LiveBytes() const noexcept;
+    size_t LiveRecords() const noexcept;
+
+private:
+    // Records never straddle segments. A record is at most (3 + 2 * 65536) uint16_t plus the prefix,
+    // which leaves plenty of room in a segment of this size.
+    static constexpr uint64_t SegmentSize = 1024 * 1024;
+
+    struct Segment
+    {
+        uint32_t records = 0;
+        bool allocated = false;
+    };
+
+    uint32_t _readLength(uint64_t offset) const;
+    void _release(uint64_t offset, uint32_t length) noexcept;
+
+    wil::unique_hfile _file;
+    std::vector<Segment> _segments;
+    uint64_t _end = 0;
+    size_t _liveBytes = 0;
+    size_t _liveRecords = 0;
+};
@@ -0,0 +1,163 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include "SearchIndex.hpp"
+
+#include "textBuffer.hpp"
+
+// Throws E_INVALIDARG if the mode is Search::Mode::RegularExpression and the needle isn't a valid one.
+SearchIndex::SearchIndex(const std::wstring_view needle, const Search::Sensitivity sensitivity, const Search::Mode mode) :
+    _needle{ needle },
+    _sensitivity{ sensitivity },
+    _mode{ mode }
+{
+    if (mode == Search::Mode::RegularExpression)
+    {
+        _regex = std::make_unique<SearchRegex>(needle, sensitivity == Search::Sensitivity::CaseInsensitive);
+    }
+}
+
+// Returns true if this index was built for the given search term.
+bool SearchIndex::IsFor(const std::wstring_view needle, const Search::Sensitivity sensitivity, const Search::Mode mode) const noexcept
+{
+    return _needle == needle && _sensitivity == sensitivity && _mode == mode;
+}
+
+// Routine Description:
+// - Brings the index up to date with the contents of the text buffer.
+// - The first call scans the entire buffer. Afterwards, only the rows that
+//   TextBuffer::TakeDirtyRows() reports as modified are scanned again.
+// - Since this has to be called under the console lock, at most maxRows rows are
+//   scanned per call, so that the caller can release the lock in between.
+// Arguments:
+// - textBuffer - The text buffer to index. If it differs from the last call, the index is rebuilt.
+// - maxRows - The maximum number of rows to scan.
+// Return Value:
+// - True if the index is complete. False if this needs to be called again.
+bool SearchIndex::Update(TextBuffer& textBuffer, const til::CoordType maxRows)
+{
+    const auto size = textBuffer.GetSize();
+    const auto dirty = textBuffer.TakeDirtyRows();
+
+    if (&textBuffer != _textBuffer)
+    {
+        _textBuffer = &textBuffer;
+        _matches.clear();
+        _pendingBegin = 0;
+        _pendingEnd = size.Height();
+    }
+    else
+    {
+        if (dirty.scrolled > 0)
+        {
+            for (auto& match : _matches)
+            {
+                match.start.y -= dirty.scrolled;
+                match.end.y -= dirty.scrolled;
+            }
+            _matches.erase(_matches.begin(), std::find_if(_matches.begin(), _matches.end(), [](const auto& m) { return m.start.y >= 0; }));
+            _pendingBegin = std::max(_pendingBegin - dirty.scrolled, 0);
+            _pendingEnd = std::max(_pendingEnd - dirty.scrolled, 0);
+        }
+
+        if (dirty.begin < dirty.end)
+        {
+            // Matches that start above the dirty rows may continue into them. A literal match is at most
+            // 2 columns wide per character of the needle, which tells us how far up they can start.
+            // Regex matches can be of any length, but they don't extend past the wrapped line they're in.
+            const auto reach = gsl::narrow_cast<til::CoordType>(_needle.size()) * 2 / size.Width() + 1;
+            const auto begin = _regex ? Search::GetLineBegin(textBuffer, dirty.begin) : std::max(dirty.begin - reach, 0);
+            auto end = dirty.end;
+            if (_regex)
+            {
+                // Since matches can't overlap, changes may also affect those that start further down in the line.
+                for (; end < size.Height() && textBuffer.GetRowByOffset(end - 1).WasWrapForced(); ++end)
+                {
+                }
+            }
+
+            if (_pendingBegin >= _pendingEnd)
+            {
+                _pendingBegin = begin;
+                _pendingEnd = end;
+            }
+            else
+            {
+                _pendingBegin = std::min(_pendingBegin, begin);
+                _pendingEnd = std::max(_pendingEnd, end);
+            }
+        }
+    }
+
+    _pendingEnd = std::min(_pendingEnd, size.Height());
+    _matches.erase(std::find_if(_matches.begin(), _matches.end(), [&](const auto& m) { return m.start.y >= size.Height(); }), _matches.end());
+    _current = _matches.size();
+
+    if (_pendingBegin < _pendingEnd)
+    {
+        const auto end = std::min(_pendingEnd, _pendingBegin + std::max(maxRows, 1));
+        const auto found = _regex ? Search::FindAll(textBuffer, *_regex, _pendingBegin, end) : Search::FindAll(textBuffer, _needle, _sensitivity, _pendingBegin, end);
+
+        // Replace whatever we had for these rows with the new results.
+        const auto byRow = [](const til::point_span& m, const til::CoordType y) { return m.start.y < y; };
+        const auto first = std::lower_bound(_matches.begin(), _matches.end(), _pendingBegin, byRow);
+        const auto last = std::lower_bound(first, _matches.end(), end, byRow);
+        _matches.insert(_matches.erase(first, last), found.begin(), found.end());
+        _current = _matches.size();
+
+        _pendingBegin = end;
+    }
+
+    return IsComplete();
+}
+
+// Returns true if there are no rows left to scan, which means that Matches() is accurate.
+bool SearchIndex::IsComplete() const noexcept
+{
+    return _pendingBegin >= _pendingEnd;
+}
+
+// Returns all matches in the buffer, ordered by their start.
+const std::vector<til::point_span>& SearchIndex::Matches() const noexcept
+{
+    return _matches;
+}
+
+// Routine Description:
+// - Finds the match after (or before) the given position, wrapping around at the end (or start) of the buffer.
+// - If the position is the start of the match that was returned last, this only steps to its neighbor.
+// Arguments:
+// - position - The start of the current match or selection. If there's none, the search starts at the first (or last) match.
+// - goForward - The direction to search in.
+// Return Value:
+// - The match, or nullopt if there are none.
+std::optional<til::point_span> SearchIndex::Step(const std::optional<til::point> position, const bool goForward) noexcept
+{
+    const auto count = _matches.size();
+    if (count == 0)
+    {
+        return std::nullopt;
+    }
+
+    if (_current < count && position && til::at(_matches, _current).start == *position)
+    {
+        _current = goForward ? (_current + 1) % count : (_current + count - 1) % count;
+    }
+    else if (!position)
+    {
+        _current = goForward ? 0 : count - 1;
+    }
+    else if (goForward)
+    {
+        const auto it = std::upper_bound(_matches.begin(), _matches.end(), *position, [](const til::point pos, const til::point_span& m) { return pos < m.start; });
+        _current = it == _matches.end() ? 0 : gsl::narrow_cast<size_t>(it - _matches.begin());
+    }
+    else
+    {
+        const auto it = std::lower_bound(_matches.begin(), _matches.end(), *position, [](const til::point_span& m, const til::point pos) { return m.start < pos; });
+        _current = it == _matches.begin() ? count - 1 : gsl::narrow_cast<size_t>(it - _matches.begin()) - 1;
+    }
+
+    return til::at(_matches, _current);
+}
@@ -0,0 +1,45 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- SearchIndex.hpp
+
+Abstract:
+- Holds the location of all matches of a search term in a text buffer.
+- The index is built in chunks (so that callers can release the console lock in
+  between) and is then kept up to date by only rescanning the rows that the
+  text buffer reports as dirty. See TextBuffer::TakeDirtyRows().
+- Once built, stepping from one match to the next is O(1).
+--*/
+
+#pragma once
+
+#include "search.h"
+
+class SearchIndex final
+{
+public:
+    SearchIndex(const std::wstring_view needle, const Search::Sensitivity sensitivity, const Search::Mode mode = Search::Mode::Literal);
+
+    bool IsFor(const std::wstring_view needle, const Search::Sensitivity sensitivity, const Search::Mode mode = Search::Mode::Literal) const noexcept;
+    bool Update(TextBuffer& textBuffer, const til::CoordType maxRows);
+    bool IsComplete() const noexcept;
+
+    const std::vector<til::point_span>& Matches() const noexcept;
+    std::optional<til::point_span> Step(const std::optional<til::point> position, const bool goForward) noexcept;
+
+private:
+    std::wstring _needle;
+    Search::Sensitivity _sensitivity;
+    Search::Mode _mode;
+    // Compiled once for all calls to Update(), so that they share the DFA it builds.
+    std::unique_ptr<SearchRegex> _regex;
+    const TextBuffer* _textBuffer = nullptr;
+    // The rows [_pendingBegin, _pendingEnd) still need to be (re)scanned.
+    til::CoordType _pendingBegin = 0;
+    til::CoordType _pendingEnd = 0;
+    std::vector<til::point_span> _matches;
+    // The index of the match that Step() returned last, or _matches.size() if there's none.
+    size_t _current = 0;
+};
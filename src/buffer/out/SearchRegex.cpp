@@ -0,0 +1,821 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include "SearchRegex.hpp"
+
+// Patterns like "(a{1000}){1000}" would otherwise result in gigantic programs.
+static constexpr size_t MaxProgramSize = 64 * 1024;
+static constexpr int MaxRepeat = 1000;
+// Once the cached DFA states of both automatons exceed this, they're flushed before the next scan.
+// Each scan adds at most 1 state per character, so this bounds the memory usage to that of
+// MaxDfaStates plus the longest text that's been scanned.
+static constexpr size_t MaxDfaStates = 8192;
+
+static constexpr char32_t decodeSurrogatePair(const wchar_t lead, const wchar_t trail) noexcept
+{
+    return (static_cast<char32_t>(lead) << 10) + trail - ((0xD800 << 10) + 0xDC00 - 0x10000);
+}
+
+struct SearchRegex::Node
+{
+    enum class Kind : uint8_t
+    {
+        Empty,
+        Char,
+        Start,
+        End,
+        Concat,
+        Alternate,
+        Repeat,
+    };
+
+    Kind kind = Kind::Empty;
+    // For Char: The index into _classes.
+    uint32_t cls = 0;
+    // For Repeat: The number of repetitions. max is negative if it's unbounded.
+    int min = 0;
+    int max = 0;
+    std::vector<Node> children;
+};
+
+// A recursive descent parser for the pattern syntax described in SearchRegex.hpp.
+// Syntax errors throw E_INVALIDARG.
+class SearchRegex::Parser
+{
+public:
+    Parser(SearchRegex& regex, const std::wstring_view pattern) noexcept :
+        _regex{ regex },
+        _it{ pattern.data() },
+        _end{ pattern.data() + pattern.size() }
+    {
+    }
+
+    Node Parse()
+    {
+        auto node = _alternate();
+        // _alternate() only stops early at an unbalanced ")".
+        if (_it != _end)
+        {
+            _fail();
+        }
+        return node;
+    }
+
+private:
+    [[noreturn]] static void _fail()
+    {
+        THROW_HR(E_INVALIDARG);
+    }
+
+    bool _peek(const wchar_t ch) const noexcept
+    {
+        return _it != _end && *_it == ch;
+    }
+
+    char32_t _pop()
+    {
+        if (_it == _end)
+        {
+            _fail();
+        }
+        const auto ch = *_it++;
+        if (til::is_leading_surrogate(ch) && _it != _end && til::is_trailing_surrogate(*_it))
+        {
+            return decodeSurrogatePair(ch, *_it++);
+        }
+        return ch;
+    }
+
+    Node _char(CharClass cls)
+    {
+        _regex._classes.emplace_back(std::move(cls));
+        return { .kind = Node::Kind::Char, .cls = gsl::narrow_cast<uint32_t>(_regex._classes.size() - 1) };
+    }
+
+    Node _alternate()
+    {
+        Node node{ .kind = Node::Kind::Alternate };
+        node.children.emplace_back(_concat());
+        while (_peek(L'|'))
+        {
+            ++_it;
+            node.children.emplace_back(_concat());
+        }
+        if (node.children.size() == 1)
+        {
+            auto child = std::move(node.children.front());
+            return child;
+        }
+        return node;
+    }
+
+    Node _concat()
+    {
+        Node node{ .kind = Node::Kind::Concat };
+        while (_it != _end && *_it != L'|' && *_it != L')')
+        {
+            node.children.emplace_back(_repeat());
+        }
+        return node;
+    }
+
+    Node _repeat()
+    {
+        auto node = _atom();
+
+        while (_it != _end)
+        {
+            int min = 0;
+            int max = -1;
+
+            switch (*_it)
+            {
+            case L'*':
+                ++_it;
+                break;
+            case L'+':
+                ++_it;
+                min = 1;
+                break;
+            case L'?':
+                ++_it;
+                max = 1;
+                break;
+            case L'{':
+                ++_it;
+                _bounds(min, max);
+                break;
+            default:
+                return node;
+            }
+
+            // Lazy quantifiers don't change what leftmost-longest matching finds.
+            if (_peek(L'?'))
+            {
+                ++_it;
+            }
+
+            Node repeat{ .kind = Node::Kind::Repeat, .min = min, .max = max };
+            repeat.children.emplace_back(std::move(node));
+            node = std::move(repeat);
+        }
+
+        return node;
+    }
+
+    // Parses the rest of "{n}", "{n,}" or "{n,m}".
+    void _bounds(int& min, int& max)
+    {
+        min = _number();
+        max = min;
+        if (_peek(L','))
+        {
+            ++_it;
+            max = _peek(L'}') ? -1 : _number();
+        }
+        if (!_peek(L'}') || (max >= 0 && max < min))
+        {
+            _fail();
+        }
+        ++_it;
+    }
+
+    int _number()
+    {
+        auto value = 0;
+        auto digits = 0;
+        for (; _it != _end && *_it >= L'0' && *_it <= L'9'; ++_it, ++digits)
+        {
+            value = value * 10 + (*_it - L'0');
+            if (value > MaxRepeat)
+            {
+                _fail();
+            }
+        }
+        if (digits == 0)
+        {
+            _fail();
+        }
+        return value;
+    }
+
+    Node _atom()
+    {
+        const auto ch = _pop();
+
+        switch (ch)
+        {
+        case L'(':
+            if (_peek(L'?'))
+            {
+                ++_it;
+                if (!_peek(L':'))
+                {
+                    _fail();
+                }
+                ++_it;
+            }
+            {
+                auto node = _alternate();
+                if (!_peek(L')'))
+                {
+                    _fail();
+                }
+                ++_it;
+                return node;
+            }
+        case L'[':
+            return _char(_class());
+        case L'.':
+            return _char({ .ranges = { { 0, 0x10FFFF } } });
+        case L'^':
+            return { .kind = Node::Kind::Start };
+        case L'$':
+            return { .kind = Node::Kind::End };
+        case L'*':
+        case L'+':
+        case L'?':
+        case L'{':
+            // There's nothing to repeat.
+            _fail();
+        case L'\\':
+        {
+            const auto escaped = _pop();
+            CharClass cls;
+            if (!_shorthand(escaped, cls))
+            {
+                const auto lit = _escapedChar(escaped);
+                cls.ranges.push_back({ lit, lit });
+            }
+            return _char(std::move(cls));
+        }
+        default:
+            return _char({ .ranges = { { ch, ch } } });
+        }
+    }
+
+    // Parses the rest of a "[...]" class.
+    CharClass _class()
+    {
+        CharClass cls;
+        if (_peek(L'^'))
+        {
+            ++_it;
+            cls.negated = true;
+        }
+
+        // A "]" right at the start is a literal.
+        for (auto first = true;; first = false)
+        {
+            if (_it == _end)
+            {
+                _fail();
+            }
+            if (*_it == L']' && !first)
+            {
+                ++_it;
+                break;
+            }
+
+            auto lo = _pop();
+            if (lo == L'\\')
+            {
+                const auto escaped = _pop();
+                CharClass shorthand;
+                if (_shorthand(escaped, shorthand))
+                {
+                    if (shorthand.negated)
+                    {
+                        _complement(shorthand.ranges);
+                    }
+                    cls.ranges.insert(cls.ranges.end(), shorthand.ranges.begin(), shorthand.ranges.end());
+                    continue;
+                }
+                lo = _escapedChar(escaped);
+            }
+
+            auto hi = lo;
+            if (_peek(L'-') && _end - _it >= 2 && _it[1] != L']')
+            {
+                ++_it;
+                hi = _pop();
+                if (hi == L'\\')
+                {
+                    hi = _escapedChar(_pop());
+                }
+                if (hi < lo)
+                {
+                    _fail();
+                }
+            }
+
+            cls.ranges.push_back({ lo, hi });
+        }
+
+        return cls;
+    }
+
+    // \d, \w, \s and their negations \D, \W and \S.
+    static bool _shorthand(const char32_t ch, CharClass& cls)
+    {
+        switch (ch | 0x20)
+        {
+        case L'd':
+            cls.ranges = { { L'0', L'9' } };
+            break;
+        case L'w':
+            cls.ranges = { { L'0', L'9' }, { L'A', L'Z' }, { L'_', L'_' }, { L'a', L'z' } };
+            break;
+        case L's':
+            cls.ranges = { { L'\t', L'\r' }, { L' ', L' ' } };
+            break;
+        default:
+            return false;
+        }
+        cls.negated = ch < L'a';
+        return true;
+    }
+
+    // Turns the escape sequence following a backslash into the character it stands for.
+    char32_t _escapedChar(const char32_t ch)
+    {
+        switch (ch)
+        {
+        case L't':
+            return L'\t';
+        case L'n':
+            return L'\n';
+        case L'r':
+            return L'\r';
+        case L'f':
+            return L'\f';
+        case L'v':
+            return L'\v';
+        case L'x':
+            return _hex(2);
+        case L'u':
+            return _hex(4);
+        default:
+            // Any punctuation can be escaped. Letters and digits are reserved for features we don't support, like \b or \1.
+            if (ch < 0x80 && iswalnum(static_cast<wint_t>(ch)))
+            {
+                _fail();
+            }
+            return ch;
+        }
+    }
+
+    char32_t _hex(const int digits)
+    {
+        char32_t value = 0;
+        for (auto i = 0; i < digits; ++i)
+        {
+            const auto ch = _pop();
+            char32_t digit;
+            if (ch >= L'0' && ch <= L'9')
+            {
+                digit = ch - L'0';
+            }
+            else if ((ch | 0x20) >= L'a' && (ch | 0x20) <= L'f')
+            {
+                digit = (ch | 0x20) - L'a' + 10;
+            }
+            else
+            {
+                _fail();
+            }
+            value = value << 4 | digit;
+        }
+        return value;
+    }
+
+    // Replaces the given sorted, non-overlapping ranges with the ranges in between them.
+    static void _complement(std::vector<CharRange>& ranges)
+    {
+        std::vector<CharRange> result;
+        char32_t next = 0;
+        for (const auto& r : ranges)
+        {
+            if (r.lo > next)
+            {
+                result.push_back({ next, r.lo - 1 });
+            }
+            next = r.hi + 1;
+        }
+        if (next <= 0x10FFFF)
+        {
+            result.push_back({ next, 0x10FFFF });
+        }
+        ranges = std::move(result);
+    }
+
+    SearchRegex& _regex;
+    const wchar_t* _it;
+    const wchar_t* _end;
+};
+
+// Routine Description:
+// - Compiles the given pattern.
+// Arguments:
+// - pattern - The regular expression. See SearchRegex.hpp for the supported syntax.
+// - caseInsensitive - If true, the text to be searched must be case folded with towlower().
+//   The pattern itself isn't, since its classes then simply match both cases.
+// Return Value:
+// - Throws E_INVALIDARG if the pattern is invalid or too complex.
+SearchRegex::SearchRegex(const std::wstring_view pattern, const bool caseInsensitive) :
+    _pattern{ pattern },
+    _caseInsensitive{ caseInsensitive }
+{
+    const auto root = Parser{ *this, pattern }.Parse();
+
+    _compile(root, false, _forward.program);
+    _forward.program.push_back({ .op = Op::Match });
+    _compile(root, true, _reverse.program);
+    _reverse.program.push_back({ .op = Op::Match });
+    _reverse.unanchored = true;
+
+    _reset(_forward);
+    _reset(_reverse);
+}
+
+const std::wstring& SearchRegex::Pattern() const noexcept
+{
+    return _pattern;
+}
+
+bool SearchRegex::IsCaseInsensitive() const noexcept
+{
+    return _caseInsensitive;
+}
+
+// Routine Description:
+// - Finds all leftmost-longest, non-overlapping, non-empty matches in the text.
+// - This first runs the reversed pattern backwards over the entire text, which marks all positions
+//   a match can start at, and then runs the pattern forward from each of those that isn't already
+//   covered by the previous match, to find where the longest match starting there ends.
+// Arguments:
+// - text - The text to search. "^" and "$" match at its start and end.
+// Return Value:
+// - The [begin, end) offsets of the matches, ordered by their start. It's valid until the next call.
+const std::vector<std::pair<size_t, size_t>>& SearchRegex::FindAll(const std::wstring_view text)
+{
+    if (_forward.states.size() + _reverse.states.size() > MaxDfaStates)
+    {
+        _reset(_forward);
+        _reset(_reverse);
+    }
+
+    const auto data = text.data();
+    const auto size = text.size();
+
+    _matches.clear();
+    _starts.assign(size, 0);
+
+    auto state = _start(_reverse, true);
+    for (auto i = size; i > 0;)
+    {
+        auto ch = static_cast<char32_t>(til::at(data, i - 1));
+        i--;
+        if (til::is_trailing_surrogate(til::at(data, i)) && i > 0 && til::is_leading_surrogate(til::at(data, i - 1)))
+        {
+            ch = decodeSurrogatePair(til::at(data, i - 1), til::at(data, i));
+            i--;
+        }
+
+        state = _next(_reverse, state, ch);
+        const auto& s = til::at(_reverse.states, state);
+        til::at(_starts, i) = i == 0 ? s.acceptingAtEnd : s.accepting;
+    }
+
+    for (size_t beg = 0; beg < size; ++beg)
+    {
+        if (!til::at(_starts, beg))
+        {
+            continue;
+        }
+
+        auto end = beg;
+        state = _start(_forward, beg == 0);
+
+        // State 0 is the dead state, where no match is possible anymore.
+        for (auto pos = beg; pos < size && state != 0;)
+        {
+            auto ch = static_cast<char32_t>(til::at(data, pos));
+            pos++;
+            if (til::is_leading_surrogate(til::at(data, pos - 1)) && pos < size && til::is_trailing_surrogate(til::at(data, pos)))
+            {
+                ch = decodeSurrogatePair(til::at(data, pos - 1), til::at(data, pos));
+                pos++;
+            }
+
+            state = _next(_forward, state, ch);
+            const auto& s = til::at(_forward.states, state);
+            if (pos == size ? s.acceptingAtEnd : s.accepting)
+            {
+                end = pos;
+            }
+        }
+
+        // Positions where only an empty match starts are skipped.
+        if (end != beg)
+        {
+            _matches.emplace_back(beg, end);
+            beg = end - 1;
+        }
+    }
+
+    return _matches;
+}
+
+// Compiles the node into instructions for a Thompson NFA, either for the pattern
+// itself or for the reversed pattern, which matches the reversed text.
+void SearchRegex::_compile(const Node& node, const bool reverse, std::vector<Inst>& program)
+{
+    THROW_HR_IF(E_INVALIDARG, program.size() > MaxProgramSize);
+
+    const auto here = [&]() {
+        return gsl::narrow_cast<uint32_t>(program.size());
+    };
+
+    switch (node.kind)
+    {
+    case Node::Kind::Empty:
+        break;
+    case Node::Kind::Char:
+        program.push_back({ .op = Op::Char, .x = node.cls });
+        break;
+    case Node::Kind::Start:
+        program.push_back({ .op = reverse ? Op::AssertEnd : Op::AssertStart });
+        break;
+    case Node::Kind::End:
+        program.push_back({ .op = reverse ? Op::AssertStart : Op::AssertEnd });
+        break;
+    case Node::Kind::Concat:
+        if (reverse)
+        {
+            for (auto it = node.children.rbegin(); it != node.children.rend(); ++it)
+            {
+                _compile(*it, reverse, program);
+            }
+        }
+        else
+        {
+            for (const auto& child : node.children)
+            {
+                _compile(child, reverse, program);
+            }
+        }
+        break;
+    case Node::Kind::Alternate:
+    {
+        // Split(a, Split(b, c)) with each branch jumping to the end.
+        std::vector<uint32_t> jumps;
+        const auto count = node.children.size();
+        for (size_t i = 0; i < count; ++i)
+        {
+            const auto last = i + 1 == count;
+            const auto split = here();
+            if (!last)
+            {
+                program.push_back({ .op = Op::Split, .x = split + 1 });
+            }
+            _compile(til::at(node.children, i), reverse, program);
+            if (!last)
+            {
+                jumps.push_back(here());
+                program.push_back({ .op = Op::Jump });
+                til::at(program, split).y = here();
+            }
+        }
+        for (const auto jump : jumps)
+        {
+            til::at(program, jump).x = here();
+        }
+        break;
+    }
+    case Node::Kind::Repeat:
+    {
+        const auto& child = node.children.front();
+        for (auto i = 0; i < node.min; ++i)
+        {
+            _compile(child, reverse, program);
+        }
+        if (node.max < 0)
+        {
+            const auto split = here();
+            program.push_back({ .op = Op::Split, .x = split + 1 });
+            _compile(child, reverse, program);
+            program.push_back({ .op = Op::Jump, .x = split });
+            til::at(program, split).y = here();
+        }
+        else
+        {
+            std::vector<uint32_t> splits;
+            for (auto i = node.min; i < node.max; ++i)
+            {
+                splits.push_back(here());
+                program.push_back({ .op = Op::Split, .x = here() + 1 });
+                _compile(child, reverse, program);
+            }
+            for (const auto split : splits)
+            {
+                til::at(program, split).y = here();
+            }
+        }
+        break;
+    }
+    }
+}
+
+bool SearchRegex::_classContains(const uint32_t index, const char32_t ch) const noexcept
+{
+    const auto& cls = til::at(_classes, index);
+    const auto contains = [&](const char32_t c) noexcept {
+        return std::any_of(cls.ranges.begin(), cls.ranges.end(), [&](const CharRange& r) { return c >= r.lo && c <= r.hi; });
+    };
+
+    auto in = contains(ch);
+    // The text was folded to lowercase, but the pattern wasn't.
+    if (!in && _caseInsensitive && ch <= 0xFFFF)
+    {
+        const auto upper = static_cast<char32_t>(::towupper(static_cast<wint_t>(ch)));
+        in = upper != ch && contains(upper);
+    }
+    return in != cls.negated;
+}
+
+// Routine Description:
+// - Follows all instructions that don't consume a character, starting at seeds.
+// Arguments:
+// - dfa - The automaton whose program to run.
+// - seeds - The instructions to start at.
+// - atStart, atEnd - Whether the AssertStart and AssertEnd instructions may be passed.
+// - out - Receives the sorted list of reachable Char and Match instructions and of the
+//   AssertEnd instructions that couldn't be passed yet, which identifies a DFA state.
+void SearchRegex::_closure(const Dfa& dfa, std::vector<uint32_t>& seeds, const bool atStart, const bool atEnd, std::vector<uint32_t>& out)
+{
+    if (_visited.size() < dfa.program.size())
+    {
+        _visited.resize(dfa.program.size());
+    }
+    if (++_generation == 0)
+    {
+        std::fill(_visited.begin(), _visited.end(), 0);
+        _generation = 1;
+    }
+
+    out.clear();
+    _stack.assign(seeds.begin(), seeds.end());
+
+    while (!_stack.empty())
+    {
+        const auto pc = _stack.back();
+        _stack.pop_back();
+
+        auto& visited = til::at(_visited, pc);
+        if (visited == _generation)
+        {
+            continue;
+        }
+        visited = _generation;
+
+        const auto& inst = til::at(dfa.program, pc);
+        switch (inst.op)
+        {
+        case Op::Char:
+        case Op::Match:
+            out.push_back(pc);
+            break;
+        case Op::Split:
+            _stack.push_back(inst.y);
+            _stack.push_back(inst.x);
+            break;
+        case Op::Jump:
+            _stack.push_back(inst.x);
+            break;
+        case Op::AssertStart:
+            if (atStart)
+            {
+                _stack.push_back(pc + 1);
+            }
+            break;
+        case Op::AssertEnd:
+            if (atEnd)
+            {
+                _stack.push_back(pc + 1);
+            }
+            else
+            {
+                out.push_back(pc);
+            }
+            break;
+        }
+    }
+
+    std::sort(out.begin(), out.end());
+}
+
+// Returns the DFA state for the closure of the given instructions, creating it if necessary.
+int32_t SearchRegex::_state(Dfa& dfa, std::vector<uint32_t> seeds, const bool atStart)
+{
+    std::vector<uint32_t> insts;
+    _closure(dfa, seeds, atStart, false, insts);
+
+    // The only state that differs by atStart alone is the start state with a pending
+    // AssertEnd, since whether that can be passed may depend on an AssertStart behind it.
+    auto key = insts;
+    if (atStart)
+    {
+        key.push_back(UINT32_MAX);
+    }
+    if (const auto it = dfa.lookup.find(key); it != dfa.lookup.end())
+    {
+        return it->second;
+    }
+
+    DfaState state;
+    state.ascii.fill(-1);
+    state.accepting = std::any_of(insts.begin(), insts.end(), [&](const uint32_t pc) { return til::at(dfa.program, pc).op == Op::Match; });
+
+    std::vector<uint32_t> atEnd;
+    _closure(dfa, insts, atStart, true, atEnd);
+    state.acceptingAtEnd = std::any_of(atEnd.begin(), atEnd.end(), [&](const uint32_t pc) { return til::at(dfa.program, pc).op == Op::Match; });
+    state.insts = std::move(insts);
+
+    const auto index = gsl::narrow_cast<int32_t>(dfa.states.size());
+    dfa.states.emplace_back(std::move(state));
+    dfa.lookup.emplace(std::move(key), index);
+    return index;
+}
+
+int32_t SearchRegex::_start(Dfa& dfa, const bool atStart)
+{
+    auto& start = dfa.start[atStart ? 1 : 0];
+    if (start < 0)
+    {
+        start = _state(dfa, { 0 }, atStart);
+    }
+    return start;
+}
+
+// Returns the state that the DFA transitions to from the given one when it reads ch.
+int32_t SearchRegex::_next(Dfa& dfa, const int32_t state, const char32_t ch)
+{
+    {
+        const auto& s = til::at(dfa.states, state);
+        if (ch < 128)
+        {
+            if (const auto next = til::at(s.ascii, ch); next >= 0)
+            {
+                return next;
+            }
+        }
+        else if (const auto it = s.other.find(ch); it != s.other.end())
+        {
+            return it->second;
+        }
+
+        _seeds.clear();
+        for (const auto pc : s.insts)
+        {
+            const auto& inst = til::at(dfa.program, pc);
+            if (inst.op == Op::Char && _classContains(inst.x, ch))
+            {
+                _seeds.push_back(pc + 1);
+            }
+        }
+        if (dfa.unanchored)
+        {
+            _seeds.push_back(0);
+        }
+    }
+
+    // This may add a state and invalidate references into dfa.states.
+    const auto next = _state(dfa, _seeds, false);
+
+    auto& s = til::at(dfa.states, state);
+    if (ch < 128)
+    {
+        til::at(s.ascii, ch) = next;
+    }
+    else
+    {
+        s.other.emplace(ch, next);
+    }
+    return next;
+}
+
+// Discards all cached DFA states, except for the dead state 0.
+void SearchRegex::_reset(Dfa& dfa)
+{
+    dfa.states.clear();
+    dfa.lookup.clear();
+    dfa.start[0] = -1;
+    dfa.start[1] = -1;
+
+    DfaState dead;
+    dead.ascii.fill(0);
+    dfa.states.emplace_back(std::move(dead));
+    dfa.lookup.emplace(std::vector<uint32_t>{}, 0);
+}
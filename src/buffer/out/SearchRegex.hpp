@@ -0,0 +1,115 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- SearchRegex.hpp
+
+Abstract:
+- The regular expression engine behind Search::Mode::RegularExpression.
+- A pattern is compiled into a program for a Thompson NFA once, which is then
+  turned into a DFA lazily, one state at a time, as the text is being scanned.
+  Unlike std::wregex this never backtracks, so the cost of a scan is linear in
+  the length of the text, no matter the pattern, and the DFA is reused for
+  every row that's searched with the same SearchRegex.
+- Matches are leftmost-longest (like POSIX) and non-overlapping. Supported are:
+  literals, ".", "[...]" classes, \d \w \s (and \D \W \S), "(...)" and "(?:...)"
+  groups, "|", the "*", "+", "?" and "{n,m}" quantifiers and the "^" and "$"
+  anchors, which match at the start and end of the text that's scanned.
+  Since matching is leftmost-longest, lazy quantifiers like "*?" act greedy.
+--*/
+
+#pragma once
+
+class SearchRegex final
+{
+public:
+    SearchRegex(const std::wstring_view pattern, const bool caseInsensitive);
+
+    const std::wstring& Pattern() const noexcept;
+    bool IsCaseInsensitive() const noexcept;
+
+    const std::vector<std::pair<size_t, size_t>>& FindAll(const std::wstring_view text);
+
+private:
+    struct CharRange
+    {
+        char32_t lo;
+        char32_t hi;
+    };
+
+    struct CharClass
+    {
+        std::vector<CharRange> ranges;
+        bool negated = false;
+    };
+
+    enum class Op : uint8_t
+    {
+        // Consumes a character of class x and continues at pc + 1.
+        Char,
+        // Continues at both x and y.
+        Split,
+        // Continues at x.
+        Jump,
+        // Continue at pc + 1, but only at the start (or end) of the text.
+        AssertStart,
+        AssertEnd,
+        Match,
+    };
+
+    struct Inst
+    {
+        Op op;
+        uint32_t x = 0;
+        uint32_t y = 0;
+    };
+
+    struct DfaState
+    {
+        // The Char, AssertEnd and Match instructions that are reachable from this state.
+        std::vector<uint32_t> insts;
+        bool accepting = false;
+        bool acceptingAtEnd = false;
+        // Cached transitions. -1 means that it hasn't been computed yet.
+        std::array<int32_t, 128> ascii;
+        std::unordered_map<char32_t, int32_t> other;
+    };
+
+    struct Dfa
+    {
+        std::vector<Inst> program;
+        // Unanchored DFAs find matches anywhere in the text, as if the program started with ".*".
+        bool unanchored = false;
+        std::vector<DfaState> states;
+        std::map<std::vector<uint32_t>, int32_t> lookup;
+        // The start state for when the scan begins at the start of the text and for when it doesn't.
+        int32_t start[2]{ -1, -1 };
+    };
+
+    struct Node;
+    class Parser;
+
+    static void _compile(const Node& node, const bool reverse, std::vector<Inst>& program);
+    bool _classContains(const uint32_t index, const char32_t ch) const noexcept;
+    void _closure(const Dfa& dfa, std::vector<uint32_t>& seeds, const bool atStart, const bool atEnd, std::vector<uint32_t>& out);
+    int32_t _state(Dfa& dfa, std::vector<uint32_t> seeds, const bool atStart);
+    int32_t _start(Dfa& dfa, const bool atStart);
+    int32_t _next(Dfa& dfa, const int32_t state, const char32_t ch);
+    void _reset(Dfa& dfa);
+
+    std::wstring _pattern;
+    bool _caseInsensitive = false;
+    std::vector<CharClass> _classes;
+    // _forward finds the end of the match that starts at a given position and
+    // _reverse (which runs backwards over the text) tells which positions those are.
+    Dfa _forward;
+    Dfa _reverse;
+    // Scratch space, so that scanning a row doesn't allocate.
+    std::vector<uint8_t> _starts;
+    std::vector<uint32_t> _stack;
+    std::vector<uint32_t> _seeds;
+    std::vector<uint32_t> _visited;
+    uint32_t _generation = 0;
+    std::vector<std::pair<size_t, size_t>> _matches;
+};
@@ -23,6 +23,8 @@ Revision History:
 #include "TextColor.h"
 #include "../../inc/conattrs.hpp"
 
+#include <til/bit.h>
+
 #ifdef UNIT_TESTING
 #include "WexTestClass.h"
 #endif
@@ -69,14 +71,18 @@ public:
 
     void Invert() noexcept;
 
+    // Attributes are compared for every cell that the renderer and ROW::ReplaceAttributes() visit.
+    // Comparing them as 3 integers with a single branch is cheaper than a memcmp() call.
     inline bool operator==(const TextAttribute& other) const noexcept
     {
-        return memcmp(this, &other, sizeof(TextAttribute)) == 0;
+        const auto a = til::bit_cast<Words>(*this);
+        const auto b = til::bit_cast<Words>(other);
+        return ((a[0] ^ b[0]) | (a[1] ^ b[1]) | (a[2] ^ b[2])) == 0;
     }
 
     inline bool operator!=(const TextAttribute& other) const noexcept
     {
-        return memcmp(this, &other, sizeof(TextAttribute)) != 0;
+        return !(*this == other);
     }
 
     bool IsLegacy() const noexcept;
@@ -176,6 +182,8 @@ private:
     TextColor _foreground; // sizeof: 4, alignof: 1
     TextColor _background; // sizeof: 4, alignof: 1
 
+    using Words = std::array<uint32_t, 3>;
+
 #ifdef UNIT_TESTING
     friend class TextBufferTests;
     friend class TextAttributeTests;
@@ -184,6 +192,9 @@ private:
 #endif
 };
 
+static_assert(sizeof(TextAttribute) == 12);
+static_assert(std::is_trivially_copyable_v<TextAttribute>);
+
 enum class TextAttributeBehavior
 {
     Stored, // use contained text attribute
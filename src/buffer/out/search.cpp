@@ -5,10 +5,7 @@
 
 #include "search.h"
 
-#include <til/unicode.h>
-
 #include "textBuffer.hpp"
-#include "../types/inc/GlyphWidth.hpp"
 
 using namespace Microsoft::Console::Types;
 
@@ -22,15 +19,18 @@ using namespace Microsoft::Console::Types;
 // - str - The search term you want to find (the "needle")
 // - direction - The direction to search (upward or downward)
 // - sensitivity - Whether or not you care about case
+// - mode - Whether str is literal text or a regular expression. Invalid regular expressions throw E_INVALIDARG.
 Search::Search(Microsoft::Console::Render::IRenderData& renderData,
                const std::wstring_view str,
                const Direction direction,
-               const Sensitivity sensitivity) :
+               const Sensitivity sensitivity,
+               const Mode mode) :
     _direction(direction),
     _sensitivity(sensitivity),
-    _needle(s_CreateNeedleFromString(str)),
+    _needle(s_CreateNeedleFromString(str, sensitivity)),
     _renderData(renderData),
-    _coordAnchor(s_GetInitialAnchor(renderData, direction))
+    _coordAnchor(s_GetInitialAnchor(renderData, direction)),
+    _regex(mode == Mode::RegularExpression ? std::make_unique<SearchRegex>(str, sensitivity == Sensitivity::CaseInsensitive) : nullptr)
 {
     _coordNext = _coordAnchor;
 }
@@ -46,16 +46,19 @@ Search::Search(Microsoft::Console::Render::IRenderData& renderData,
 // - direction - The direction to search (upward or downward)
 // - sensitivity - Whether or not you care about case
 // - anchor - starting search location in screenInfo
+// - mode - Whether str is literal text or a regular expression. Invalid regular expressions throw E_INVALIDARG.
 Search::Search(Microsoft::Console::Render::IRenderData& renderData,
                const std::wstring_view str,
                const Direction direction,
                const Sensitivity sensitivity,
-               const til::point anchor) :
+               const til::point anchor,
+               const Mode mode) :
     _direction(direction),
     _sensitivity(sensitivity),
-    _needle(s_CreateNeedleFromString(str)),
+    _needle(s_CreateNeedleFromString(str, sensitivity)),
     _coordAnchor(anchor),
-    _renderData(renderData)
+    _renderData(renderData),
+    _regex(mode == Mode::RegularExpression ? std::make_unique<SearchRegex>(str, sensitivity == Sensitivity::CaseInsensitive) : nullptr)
 {
     _coordNext = _coordAnchor;
 }
@@ -75,21 +78,61 @@ bool Search::FindNext()
         return false;
     }
 
-    do
+    // Positions past the end of the written text can't start a match. See _UpdateNextPosition().
+    const auto bufferEndPosition = _renderData.GetTextBufferEndPosition();
+    const auto clamp = [&](const til::point pos) {
+        if (pos <= bufferEndPosition)
+        {
+            return pos;
+        }
+        return _direction == Direction::Forward ? til::point{} : bufferEndPosition;
+    };
+    const auto next = clamp(_coordNext);
+    const auto anchor = clamp(_coordAnchor);
+
+    // We visit every position once, starting at _coordNext, wrapping around
+    // at the end of the written text and stopping in front of the anchor.
+    auto found = false;
+    if (_direction == Direction::Forward)
     {
-        if (_FindNeedleInHaystackAt(_coordNext, _coordSelStart, _coordSelEnd))
+        auto last = anchor;
+        _DecrementCoord(last);
+
+        if (anchor > next)
         {
-            _UpdateNextPosition();
-            _reachedEnd = _coordNext == _coordAnchor;
-            return true;
+            found = _FindForward(next, last);
+        }
+        else
+        {
+            found = _FindForward(next, bufferEndPosition) ||
+                    (anchor > til::point{} && _FindForward({}, last));
+        }
+    }
+    else
+    {
+        auto first = anchor;
+        _IncrementCoord(first);
+
+        if (anchor < next)
+        {
+            found = _FindBackward(first, next);
         }
         else
         {
-            _UpdateNextPosition();
+            found = _FindBackward({}, next) ||
+                    (anchor < bufferEndPosition && _FindBackward(first, bufferEndPosition));
         }
+    }
 
-    } while (_coordNext != _coordAnchor);
+    if (found)
+    {
+        _coordNext = _coordSelStart;
+        _UpdateNextPosition();
+        _reachedEnd = _coordNext == _coordAnchor;
+        return true;
+    }
 
+    _coordNext = _coordAnchor;
     return false;
 }
 
@@ -177,90 +220,332 @@ til::point Search::s_GetInitialAnchor(const Microsoft::Console::Render::IRenderD
 }
 
 // Routine Description:
-// - Attempts to compare the search term (the needle) to the screen buffer (the haystack)
-//   at the given coordinate position of the screen buffer.
-// - Performs one comparison. Call again with new positions to check other spots.
+// - Finds the first match that starts within [first, last].
 // Arguments:
-// - pos - The position in the haystack (screen buffer) to compare
-// - start - If we found it, this is filled with the coordinate of the first character of the needle.
-// - end - If we found it, this is filled with the coordinate of the last character of the needle.
+// - first - The first position a match may start at.
+// - last - The last position a match may start at (inclusive).
 // Return Value:
-// - True if we found it. False if not.
-bool Search::_FindNeedleInHaystackAt(const til::point pos, til::point& start, til::point& end) const
+// - True if we found it. The match is stored in _coordSelStart and _coordSelEnd.
+bool Search::_FindForward(const til::point first, const til::point last)
 {
-    start = {};
-    end = {};
-
-    auto bufferPos = pos;
+    const auto right = _renderData.GetTextBuffer().GetSize().RightInclusive();
 
-    for (const auto& needleChars : _needle)
+    for (auto y = first.y; y <= last.y; ++y)
     {
-        // Haystack is the buffer. Needle is the string we were given.
-        const auto hayIter = _renderData.GetTextBuffer().GetTextDataAt(bufferPos);
-        const auto hayChars = *hayIter;
+        const auto columnBegin = y == first.y ? first.x : 0;
+        const auto columnEnd = y == last.y ? last.x : right;
+        if (_FindInRow(y, columnBegin, columnEnd, false))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
 
-        // If we didn't match at any point of the needle, return false.
-        if (!_CompareChars(hayChars, needleChars))
+// Routine Description:
+// - Finds the last match that starts within [first, last].
+// Arguments:
+// - first - The first position a match may start at.
+// - last - The last position a match may start at (inclusive).
+// Return Value:
+// - True if we found it. The match is stored in _coordSelStart and _coordSelEnd.
+bool Search::_FindBackward(const til::point first, const til::point last)
+{
+    const auto right = _renderData.GetTextBuffer().GetSize().RightInclusive();
+
+    for (auto y = last.y; y >= first.y; --y)
+    {
+        const auto columnBegin = y == first.y ? first.x : 0;
+        const auto columnEnd = y == last.y ? last.x : right;
+        if (_FindInRow(y, columnBegin, columnEnd, true))
         {
-            return false;
+            return true;
         }
+    }
 
-        _IncrementCoord(bufferPos);
+    return false;
+}
+
+// Routine Description:
+// - Finds all matches that start within the given rows.
+// - Unlike FindNext() this doesn't wrap around and doesn't need a IRenderData,
+//   which allows it to be used to build an index of all matches. See SearchIndex.
+// Arguments:
+// - textBuffer - The text buffer to search
+// - str - The search term you want to find
+// - sensitivity - Whether or not you care about case
+// - rowBegin - The first row to search
+// - rowEnd - The row past the last one to search
+// Return Value:
+// - The location of all matches, ordered by their start.
+std::vector<til::point_span> Search::FindAll(const TextBuffer& textBuffer, const std::wstring_view str, const Sensitivity sensitivity, const til::CoordType rowBegin, const til::CoordType rowEnd)
+{
+    const auto needle = s_CreateNeedleFromString(str, sensitivity);
+    const auto end = std::min(rowEnd, textBuffer.GetSize().Height());
+    std::wstring haystack;
+    std::vector<til::point_span> matches;
+
+    for (auto y = std::max(rowBegin, 0); y < end; ++y)
+    {
+        s_ForEachMatchInRow(textBuffer, needle, sensitivity, haystack, y, [&](const til::point_span& match) {
+            matches.emplace_back(match);
+            return true;
+        });
     }
 
-    _DecrementCoord(bufferPos);
+    return matches;
+}
+
+// Routine Description:
+// - Same as the other FindAll(), but for a regular expression.
+// - Since matches may begin in any row of a wrapped line, this searches the entire
+//   line that contains rowBegin, but only returns the matches that start in [rowBegin, rowEnd).
+// Arguments:
+// - textBuffer - The text buffer to search
+// - regex - The compiled regular expression
+// - rowBegin - The first row to search
+// - rowEnd - The row past the last one to search
+// Return Value:
+// - The location of all matches, ordered by their start.
+std::vector<til::point_span> Search::FindAll(const TextBuffer& textBuffer, SearchRegex& regex, const til::CoordType rowBegin, const til::CoordType rowEnd)
+{
+    const auto begin = std::max(rowBegin, 0);
+    const auto end = std::min(rowEnd, textBuffer.GetSize().Height());
+    std::wstring haystack;
+    std::vector<til::point_span> matches;
 
-    // If we made it the whole way through the needle, then it was in the haystack.
-    // Fill out the span that we found the result at and return true.
-    start = pos;
-    end = bufferPos;
+    if (begin >= end)
+    {
+        return matches;
+    }
 
-    return true;
+    for (auto y = GetLineBegin(textBuffer, begin); y < end;)
+    {
+        y = s_ForEachRegexMatchInLine(textBuffer, regex, haystack, y, [&](const til::point_span& match) {
+            if (match.start.y >= end)
+            {
+                return false;
+            }
+            if (match.start.y >= begin)
+            {
+                matches.emplace_back(match);
+            }
+            return true;
+        });
+    }
+
+    return matches;
 }
 
 // Routine Description:
-// - Provides an abstraction for comparing two spans of text.
-// - Internally handles case sensitivity based on object construction.
+// - Returns the first row of the wrapped line that the given row is part of.
 // Arguments:
-// - one - String view representing the first string of text
-// - two - String view representing the second string of text
+// - textBuffer - The text buffer
+// - y - Any row of the line
 // Return Value:
-// - True if they are the same. False otherwise.
-bool Search::_CompareChars(const std::wstring_view one, const std::wstring_view two) const noexcept
+// - The row of the line that isn't preceded by a row that wraps into it.
+til::CoordType Search::GetLineBegin(const TextBuffer& textBuffer, til::CoordType y) noexcept
 {
-    if (one.size() != two.size())
+    for (; y > 0 && textBuffer.GetRowByOffset(y - 1).WasWrapForced(); --y)
     {
-        return false;
     }
+    return y;
+}
 
-    for (size_t i = 0; i < one.size(); i++)
+// Routine Description:
+// - Searches the text of a single row for the needle.
+// - Instead of comparing the needle cell by cell, this scans the row's text directly,
+//   which is a lot faster, and only maps the hits back into columns.
+// - Matches may continue into the rows below, just like they could before.
+// Arguments:
+// - textBuffer - The text buffer to search
+// - needle - The search term, as returned by s_CreateNeedleFromString()
+// - sensitivity - Whether or not you care about case
+// - haystack - Scratch space for the text that's being searched
+// - y - The row to search
+// - callback - Called with each match in order. Return false to stop searching.
+template<typename Callback>
+void Search::s_ForEachMatchInRow(const TextBuffer& textBuffer, const std::wstring_view needle, const Sensitivity sensitivity, std::wstring& haystack, const til::CoordType y, Callback&& callback)
+{
+    if (needle.empty())
     {
-        if (_ApplySensitivity(one.at(i)) != _ApplySensitivity(two.at(i)))
+        return;
+    }
+
+    const auto height = textBuffer.GetSize().Height();
+    const auto& row = textBuffer.GetRowByOffset(y);
+    const auto text = row.GetText();
+
+    // The haystack is the row's text, followed by just enough of the text below it to find
+    // matches that start in this row and end in another. We remember where each row begins.
+    Segments segments;
+    haystack.clear();
+    s_AppendHaystack(haystack, text, sensitivity);
+    segments.emplace_back(y, 0);
+
+    const auto haystackSize = text.size() + needle.size() - 1;
+    for (auto next = y + 1; next < height && haystack.size() < haystackSize; ++next)
+    {
+        const auto nextText = textBuffer.GetRowByOffset(next).GetText();
+        segments.emplace_back(next, haystack.size());
+        s_AppendHaystack(haystack, nextText.substr(0, haystackSize - haystack.size()), sensitivity);
+    }
+
+    for (auto offset = s_FindNeedle(haystack, needle, 0); offset < text.size(); offset = s_FindNeedle(haystack, needle, offset + 1))
+    {
+        if (const auto match = s_MatchToSpan(textBuffer, segments, offset, offset + needle.size()))
         {
-            return false;
+            if (!callback(*match))
+            {
+                break;
+            }
+        }
+    }
+}
+
+// Routine Description:
+// - Searches the wrapped line starting at the given row for the regular expression.
+// - The line's trailing whitespace isn't part of its text, so that "$" can match at its end.
+// Arguments:
+// - textBuffer - The text buffer to search
+// - regex - The compiled regular expression
+// - haystack - Scratch space for the text that's being searched
+// - y - The first row of the line. See GetLineBegin().
+// - callback - Called with each match in order. Return false to stop searching.
+// Return Value:
+// - The row past the last one of the line.
+template<typename Callback>
+til::CoordType Search::s_ForEachRegexMatchInLine(const TextBuffer& textBuffer, SearchRegex& regex, std::wstring& haystack, const til::CoordType y, Callback&& callback)
+{
+    const auto height = textBuffer.GetSize().Height();
+    const auto sensitivity = regex.IsCaseInsensitive() ? Sensitivity::CaseInsensitive : Sensitivity::CaseSensitive;
+    Segments segments;
+    haystack.clear();
+
+    auto next = y;
+    for (auto wrapped = true; wrapped && next < height; ++next)
+    {
+        const auto& row = textBuffer.GetRowByOffset(next);
+        wrapped = row.WasWrapForced();
+        // A wide glyph that didn't fit at the end of a row leaves a padding space behind, which isn't part of the line either.
+        const auto right = wrapped ? row.size() - (row.WasDoubleBytePadded() ? 1 : 0) : row.MeasureRight();
+        segments.emplace_back(next, haystack.size());
+        s_AppendHaystack(haystack, row.GetText(0, right), sensitivity);
+    }
+
+    for (const auto& [begin, end] : regex.FindAll(haystack))
+    {
+        if (const auto match = s_MatchToSpan(textBuffer, segments, begin, end))
+        {
+            if (!callback(*match))
+            {
+                break;
+            }
         }
     }
 
-    return true;
+    return next;
 }
 
 // Routine Description:
-// - Provides an abstraction for conditionally applying case sensitivity
-//   based on object construction
+// - Converts the [begin, end) offsets of a match in the haystack into the buffer positions of its first and last cell.
 // Arguments:
-// - wch - Character to adjust if necessary
+// - textBuffer - The text buffer the haystack was assembled from
+// - segments - The rows the haystack was assembled from, ordered by their offset.
+// - begin - The offset of the first character of the match
+// - end - The offset past the last character of the match
 // Return Value:
-// - Adjusted value (or not).
-wchar_t Search::_ApplySensitivity(const wchar_t wch) const noexcept
+// - The match, or nullopt if it doesn't begin and end at glyph boundaries.
+std::optional<til::point_span> Search::s_MatchToSpan(const TextBuffer& textBuffer, const Segments& segments, const size_t begin, const size_t end)
 {
-    if (_sensitivity == Sensitivity::CaseInsensitive)
+    const auto locate = [&](const size_t offset) {
+        return std::prev(std::upper_bound(segments.begin(), segments.end(), offset, [](size_t off, const auto& s) {
+            return off < s.second;
+        }));
+    };
+
+    // A match has to start at the beginning of a glyph (and not in the middle of a surrogate pair, etc.).
+    const auto firstSegment = locate(begin);
+    const auto& firstRow = textBuffer.GetRowByOffset(firstSegment->first);
+    const auto firstRowOffset = gsl::narrow_cast<ptrdiff_t>(begin - firstSegment->second);
+    const auto column = firstRow.GetLeadingColumnAtCharOffset(firstRowOffset);
+    if (firstRow.GlyphAt(column).data() - firstRow.GetText().data() != firstRowOffset)
     {
-        return ::towlower(wch);
+        return std::nullopt;
     }
-    else
+
+    // ...and it has to end at the end of one.
+    const auto lastSegment = locate(end - 1);
+    const auto& lastRow = textBuffer.GetRowByOffset(lastSegment->first);
+    const auto lastRowOffset = gsl::narrow_cast<ptrdiff_t>(end - 1 - lastSegment->second);
+    const auto lastGlyph = lastRow.GlyphAt(lastRow.GetLeadingColumnAtCharOffset(lastRowOffset));
+    if (lastGlyph.data() - lastRow.GetText().data() + gsl::narrow_cast<ptrdiff_t>(lastGlyph.size()) != lastRowOffset + 1)
     {
-        return wch;
+        return std::nullopt;
     }
+
+    return til::point_span{
+        .start = { column, firstSegment->first },
+        .end = { lastRow.GetTrailingColumnAtCharOffset(lastRowOffset), lastSegment->first },
+    };
+}
+
+// Routine Description:
+// - Searches a single row for a match that starts within the given columns.
+// Arguments:
+// - y - The row to search.
+// - columnBegin - The first column a match may start at.
+// - columnEnd - The last column a match may start at (inclusive).
+// - findLast - If true, we look for the last match in the range instead of the first one.
+// Return Value:
+// - True if we found it. The match is stored in _coordSelStart and _coordSelEnd.
+bool Search::_FindInRow(const til::CoordType y, const til::CoordType columnBegin, const til::CoordType columnEnd, const bool findLast)
+{
+    const auto& textBuffer = _renderData.GetTextBuffer();
+    auto found = false;
+
+    const auto visit = [&](const til::point_span& match) {
+        if (match.start.x > columnEnd)
+        {
+            return false;
+        }
+        if (match.start.x >= columnBegin)
+        {
+            _coordSelStart = match.start;
+            _coordSelEnd = match.end;
+            found = true;
+            return findLast;
+        }
+        return true;
+    };
+
+    if (!_regex)
+    {
+        s_ForEachMatchInRow(textBuffer, _needle, _sensitivity, _haystack, y, visit);
+        return found;
+    }
+
+    // FindNext() visits the rows of a line one by one, but we only want to search the line once.
+    if (y < _regexLineBegin || y >= _regexLineEnd)
+    {
+        _regexLineMatches.clear();
+        _regexLineBegin = GetLineBegin(textBuffer, y);
+        _regexLineEnd = s_ForEachRegexMatchInLine(textBuffer, *_regex, _haystack, _regexLineBegin, [&](const til::point_span& match) {
+            _regexLineMatches.emplace_back(match);
+            return true;
+        });
+    }
+
+    for (const auto& match : _regexLineMatches)
+    {
+        if (match.start.y == y && !visit(match))
+        {
+            break;
+        }
+    }
+
+    return found;
 }
 
 // Routine Description:
@@ -326,18 +611,127 @@ void Search::_UpdateNextPosition()
 //   that we can use for our search
 // Arguments:
 // - wstr - String that will be our search term
+// - sensitivity - Whether or not you care about case
 // Return Value:
-// - Structured text data for comparison to screen buffer text data.
-std::vector<std::wstring> Search::s_CreateNeedleFromString(const std::wstring_view wstr)
+// - The search term, case folded if necessary, in the same way s_AppendHaystack() folds the buffer contents.
+std::wstring Search::s_CreateNeedleFromString(const std::wstring_view wstr, const Sensitivity sensitivity)
+{
+    std::wstring needle;
+    s_AppendHaystack(needle, wstr, sensitivity);
+    return needle;
+}
+
+// Routine Description:
+// - Appends text to the haystack, folding its case if the search is case insensitive.
+// - Folding maps every character to exactly one character, so offsets into the haystack are offsets into the text.
+// Arguments:
+// - haystack - The string to append to
+// - text - The text to append
+// - sensitivity - Whether or not you care about case
+#pragma warning(push)
+#pragma warning(disable : 26481) // Don't use pointer arithmetic. Use span instead (bounds.1).
+#pragma warning(disable : 26490) // Don't use reinterpret_cast (type.1).
+void Search::s_AppendHaystack(std::wstring& haystack, const std::wstring_view text, const Sensitivity sensitivity)
 {
-    std::vector<std::wstring> cells;
-    for (const auto& chars : til::utf16_iterator{ wstr })
+    if (sensitivity == Sensitivity::CaseSensitive)
+    {
+        haystack.append(text);
+        return;
+    }
+
+    const auto offset = haystack.size();
+    haystack.resize(offset + text.size());
+
+    auto in = text.data();
+    const auto end = in + text.size();
+    auto out = haystack.data() + offset;
+
+#if defined(_M_AMD64) || defined(_M_IX86)
+    // The vast majority of text in a terminal is ASCII, which we can fold 8 characters at a time.
+    const auto asciiMax = _mm_set1_epi16(0x7f);
+    const auto upperMin = _mm_set1_epi16(L'A');
+    const auto upperSpan = _mm_set1_epi16(L'Z' - L'A');
+    const auto caseBit = _mm_set1_epi16(0x20);
+    const auto zero = _mm_setzero_si128();
+
+    for (; end - in >= 8; in += 8, out += 8)
     {
-        if (IsGlyphFullWidth(chars))
+        const auto vec = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+        const auto ascii = _mm_cmpeq_epi16(_mm_subs_epu16(vec, asciiMax), zero);
+        if (_mm_movemask_epi8(ascii) != 0xffff)
         {
-            cells.emplace_back(chars);
+            for (auto i = 0; i < 8; ++i)
+            {
+                out[i] = ::towlower(in[i]);
+            }
+            continue;
         }
-        cells.emplace_back(chars);
+
+        const auto upper = _mm_cmpeq_epi16(_mm_subs_epu16(_mm_sub_epi16(vec, upperMin), upperSpan), zero);
+        const auto lower = _mm_or_si128(vec, _mm_and_si128(upper, caseBit));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), lower);
     }
-    return cells;
+#endif
+
+    for (; in != end; ++in, ++out)
+    {
+        *out = ::towlower(*in);
+    }
+}
+
+// Routine Description:
+// - Finds the first occurrence of the needle in the haystack at or after the given offset.
+// - Candidates are found by checking the first and last character of the needle against
+//   8 positions at once. Only those are then compared in full.
+// Arguments:
+// - haystack - The text to search
+// - needle - The text to find
+// - offset - The offset into the haystack to start searching at
+// Return Value:
+// - The offset of the match, or std::wstring_view::npos if there's none.
+size_t Search::s_FindNeedle(const std::wstring_view haystack, const std::wstring_view needle, size_t offset) noexcept
+{
+    if (needle.empty() || haystack.size() < needle.size())
+    {
+        return std::wstring_view::npos;
+    }
+
+    const auto beg = haystack.data();
+    const auto last = beg + (haystack.size() - needle.size());
+    const auto n = needle.size() - 1;
+    auto it = beg + std::min(offset, haystack.size() - needle.size() + 1);
+
+#if defined(_M_AMD64) || defined(_M_IX86)
+    const auto firstChar = _mm_set1_epi16(needle.front());
+    const auto lastChar = _mm_set1_epi16(needle.back());
+
+    for (; last - it >= 7; it += 8)
+    {
+        const auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+        const auto b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it + n));
+        auto mask = static_cast<unsigned long>(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi16(a, firstChar), _mm_cmpeq_epi16(b, lastChar))));
+        unsigned long index;
+        while (_BitScanForward(&index, mask))
+        {
+            // The mask contains 2 bits per wchar_t.
+            const auto candidate = it + index / 2;
+            if (n < 2 || wmemcmp(candidate + 1, needle.data() + 1, n - 1) == 0)
+            {
+                return static_cast<size_t>(candidate - beg);
+            }
+            mask &= ~(3ul << index);
+        }
+    }
+#endif
+
+    for (; it <= last; ++it)
+    {
+        if (*it == needle.front() && wmemcmp(it, needle.data(), needle.size()) == 0)
+        {
+            return static_cast<size_t>(it - beg);
+        }
+    }
+
+    return std::wstring_view::npos;
 }
+#pragma warning(pop)
@@ -19,6 +19,7 @@ Revision History:
 
 #include "TextAttribute.hpp"
 #include "textBuffer.hpp"
+#include "SearchRegex.hpp"
 #include "../renderer/inc/IRenderData.hpp"
 
 // This used to be in find.h.
@@ -39,16 +40,26 @@ public:
         CaseSensitive
     };
 
+    // RegularExpression treats the search term as a pattern for SearchRegex.
+    // Its matches may span all rows of a wrapped line, but not more than that.
+    enum class Mode
+    {
+        Literal,
+        RegularExpression
+    };
+
     Search(Microsoft::Console::Render::IRenderData& renderData,
            const std::wstring_view str,
            const Direction dir,
-           const Sensitivity sensitivity);
+           const Sensitivity sensitivity,
+           const Mode mode = Mode::Literal);
 
     Search(Microsoft::Console::Render::IRenderData& renderData,
            const std::wstring_view str,
            const Direction dir,
            const Sensitivity sensitivity,
-           const til::point anchor);
+           const til::point anchor,
+           const Mode mode = Mode::Literal);
 
     bool FindNext();
     void Select() const;
@@ -56,10 +67,17 @@ public:
 
     std::pair<til::point, til::point> GetFoundLocation() const noexcept;
 
+    static std::vector<til::point_span> FindAll(const TextBuffer& textBuffer, const std::wstring_view str, const Sensitivity sensitivity, const til::CoordType rowBegin, const til::CoordType rowEnd);
+    static std::vector<til::point_span> FindAll(const TextBuffer& textBuffer, SearchRegex& regex, const til::CoordType rowBegin, const til::CoordType rowEnd);
+    static til::CoordType GetLineBegin(const TextBuffer& textBuffer, til::CoordType y) noexcept;
+
 private:
-    wchar_t _ApplySensitivity(const wchar_t wch) const noexcept;
-    bool _FindNeedleInHaystackAt(const til::point pos, til::point& start, til::point& end) const;
-    bool _CompareChars(const std::wstring_view one, const std::wstring_view two) const noexcept;
+    // Maps offsets into a haystack back to the rows it was assembled from: { row, offset of its text }.
+    using Segments = til::small_vector<std::pair<til::CoordType, size_t>, 4>;
+
+    bool _FindForward(const til::point first, const til::point last);
+    bool _FindBackward(const til::point first, const til::point last);
+    bool _FindInRow(const til::CoordType y, const til::CoordType columnBegin, const til::CoordType columnEnd, const bool findLast);
     void _UpdateNextPosition();
 
     void _IncrementCoord(til::point& coord) const noexcept;
@@ -67,7 +85,14 @@ private:
 
     static til::point s_GetInitialAnchor(const Microsoft::Console::Render::IRenderData& renderData, const Direction dir);
 
-    static std::vector<std::wstring> s_CreateNeedleFromString(const std::wstring_view wstr);
+    static std::wstring s_CreateNeedleFromString(const std::wstring_view wstr, const Sensitivity sensitivity);
+    static void s_AppendHaystack(std::wstring& haystack, const std::wstring_view text, const Sensitivity sensitivity);
+    static size_t s_FindNeedle(const std::wstring_view haystack, const std::wstring_view needle, size_t offset) noexcept;
+    template<typename Callback>
+    static void s_ForEachMatchInRow(const TextBuffer& textBuffer, const std::wstring_view needle, const Sensitivity sensitivity, std::wstring& haystack, const til::CoordType y, Callback&& callback);
+    template<typename Callback>
+    static til::CoordType s_ForEachRegexMatchInLine(const TextBuffer& textBuffer, SearchRegex& regex, std::wstring& haystack, const til::CoordType y, Callback&& callback);
+    static std::optional<til::point_span> s_MatchToSpan(const TextBuffer& textBuffer, const Segments& segments, const size_t begin, const size_t end);
 
     bool _reachedEnd = false;
     til::point _coordNext;
@@ -75,10 +100,18 @@ private:
     til::point _coordSelEnd;
 
     const til::point _coordAnchor;
-    const std::vector<std::wstring> _needle;
     const Direction _direction;
     const Sensitivity _sensitivity;
+    const std::wstring _needle;
     Microsoft::Console::Render::IRenderData& _renderData;
+    std::wstring _haystack;
+
+    // Only set for Mode::RegularExpression. Since a regex is matched against entire wrapped
+    // lines, the matches of the line that _FindInRow() looked at last are kept around.
+    std::unique_ptr<SearchRegex> _regex;
+    til::CoordType _regexLineBegin = 0;
+    til::CoordType _regexLineEnd = 0;
+    std::vector<til::point_span> _regexLineMatches;
 
 #ifdef UNIT_TESTING
     friend class SearchTests;
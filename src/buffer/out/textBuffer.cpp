@@ -5,6 +5,8 @@
 
 #include "textBuffer.hpp"
 
+#include <execution>
+
 #include <til/hash.h>
 #include <til/unicode.h>
 
@@ -42,8 +44,10 @@ TextBuffer::TextBuffer(til::size screenBufferSize,
     // Guard against resizing the text buffer to 0 columns/rows, which would break being able to insert text.
     screenBufferSize.width = std::max(screenBufferSize.width, 1);
     screenBufferSize.height = std::max(screenBufferSize.height, 1);
-    _charBuffer = _allocateBuffer(screenBufferSize, _currentAttributes, _storage);
+    _charsPool = std::make_unique<RowCharPool>();
+    _charBuffer = _allocateBuffer(screenBufferSize, _currentAttributes, _charsPool.get(), _blankRow, _storage);
     _UpdateSize();
+    _MarkRowsDirty(0, screenBufferSize.height);
 }
 
 // Routine Description:
@@ -56,6 +60,8 @@ TextBuffer::TextBuffer(til::size screenBufferSize,
 void TextBuffer::CopyProperties(const TextBuffer& OtherBuffer) noexcept
 {
     GetCursor().CopyProperties(OtherBuffer.GetCursor());
+    _spillEnabled = OtherBuffer._spillEnabled;
+    _imageMemoryLimit = OtherBuffer._imageMemoryLimit;
 }
 
 // Routine Description:
@@ -78,9 +84,22 @@ til::CoordType TextBuffer::TotalRowCount() const noexcept
 // - const reference to the requested row. Asserts if out of bounds.
 const ROW& TextBuffer::GetRowByOffset(const til::CoordType index) const noexcept
 {
-    // Rows are stored circularly, so the index you ask for is offset by the start position and mod the total of rows.
-    const auto offsetIndex = gsl::narrow_cast<size_t>(_firstRow + index) % _storage.size();
-    return til::at(_storage, offsetIndex);
+    const auto& row = _peekRowByOffset(index);
+    if (!row.IsMaterialized()) [[unlikely]]
+    {
+        // Thawing a row doesn't change its contents, only where they're stored, and the same
+        // goes for filling in the rows that ReflowLazily() skipped.
+        // Neither this buffer nor the _storage vector are actually const, only our view of them.
+#pragma warning(suppress : 26492) // Don't use const_cast to cast away const or volatile (type.3).
+        const auto self = const_cast<TextBuffer*>(this);
+        if (_pendingReflow)
+        {
+            self->_fillPendingReflow(index, index + 1);
+        }
+#pragma warning(suppress : 26492) // Don't use const_cast to cast away const or volatile (type.3).
+        self->_thaw(const_cast<ROW&>(row));
+    }
+    return row;
 }
 
 // Routine Description:
@@ -91,12 +110,424 @@ const ROW& TextBuffer::GetRowByOffset(const til::CoordType index) const noexcept
 // Return Value:
 // - reference to the requested row. Asserts if out of bounds.
 ROW& TextBuffer::GetRowByOffset(const til::CoordType index) noexcept
+{
+    auto& row = _peekRowByOffset(index);
+    if (!row.IsMaterialized()) [[unlikely]]
+    {
+        if (_pendingReflow)
+        {
+            _fillPendingReflow(index, index + 1);
+        }
+        _thaw(row);
+    }
+    return row;
+}
+
+// Same as GetRowByOffset(), but doesn't thaw cold rows. Their text reads as blank,
+// but their attributes, flags, id and revision are intact. Use this when only those are of interest.
+const ROW& TextBuffer::PeekRowByOffset(const til::CoordType index) const noexcept
+{
+    return _peekRowByOffset(index);
+}
+
+const ROW& TextBuffer::_peekRowByOffset(const til::CoordType index) const noexcept
+{
+    // Rows are stored circularly, so the index you ask for is offset by the start position and mod the total of rows.
+    const auto offsetIndex = gsl::narrow_cast<size_t>(_firstRow + index) % _storage.size();
+    return til::at(_storage, offsetIndex);
+}
+
+ROW& TextBuffer::_peekRowByOffset(const til::CoordType index) noexcept
 {
     // Rows are stored circularly, so the index you ask for is offset by the start position and mod the total of rows.
     const auto offsetIndex = gsl::narrow_cast<size_t>(_firstRow + index) % _storage.size();
     return til::at(_storage, offsetIndex);
 }
 
+TextBuffer::MemoryUsage& TextBuffer::MemoryUsage::operator+=(const MemoryUsage& other) noexcept
+{
+    reservedBytes += other.reservedBytes;
+    committedBytes += other.committedBytes;
+    coldBytes += other.coldBytes;
+    coldRows += other.coldRows;
+    overflowBytes += other.overflowBytes;
+    spilledBytes += other.spilledBytes;
+    spilledRows += other.spilledRows;
+    attributeBytes += other.attributeBytes;
+    imageBytes += other.imageBytes;
+    hyperlinkBytes += other.hyperlinkBytes;
+    cacheBytes += other.cacheBytes;
+    return *this;
+}
+
+// An estimate of the heap memory used by a std::unordered_map: its buckets, plus a node
+// per element holding the element and the pointer to the next node (and its hash in case of MSVC).
+template<typename Map>
+static size_t mapBytes(const Map& map) noexcept
+{
+    return map.bucket_count() * 2 * sizeof(void*) + map.size() * (sizeof(typename Map::value_type) + 2 * sizeof(void*));
+}
+
+// Routine Description:
+// - Measures how much of the address space reserved for the rows' text is actually committed.
+//   It grows as rows are written to for the first time (see ROW::_materialize()).
+// - Additionally estimates the heap memory used by everything else that grows with the buffer's contents.
+// Arguments:
+// - <none>
+// Return Value:
+// - The memory usage of the buffer in bytes.
+TextBuffer::MemoryUsage TextBuffer::GetMemoryUsage() const noexcept
+{
+    MemoryUsage usage;
+    const auto base = _charBuffer.get();
+    auto address = base;
+    MEMORY_BASIC_INFORMATION info;
+
+    while (VirtualQuery(address, &info, sizeof(info)) && info.AllocationBase == base)
+    {
+        usage.reservedBytes += info.RegionSize;
+        if (info.State == MEM_COMMIT)
+        {
+            usage.committedBytes += info.RegionSize;
+        }
+        address = static_cast<std::byte*>(info.BaseAddress) + info.RegionSize;
+    }
+
+    for (const auto& row : _storage)
+    {
+        if (row.IsCold())
+        {
+            usage.coldBytes += row.ColdSize();
+            usage.coldRows++;
+        }
+        usage.attributeBytes += row.AttributeHeapSize();
+        if (const auto slice = row.GetImageSlice())
+        {
+            usage.imageBytes += slice->MemoryUsage();
+        }
+    }
+
+    usage.overflowBytes = _charsPool->AllocatedBytes();
+
+    if (_spill)
+    {
+        usage.spilledBytes = _spill->LiveBytes();
+        usage.spilledRows = gsl::narrow_cast<til::CoordType>(_spill->LiveRecords());
+    }
+
+    usage.hyperlinkBytes = _hyperlinkUris.capacity() * sizeof(wchar_t) + mapBytes(_hyperlinkMap) + mapBytes(_hyperlinkCustomIdMap);
+    for (const auto& [id, _] : _hyperlinkCustomIdMap)
+    {
+        usage.hyperlinkBytes += id.capacity() * sizeof(wchar_t);
+    }
+
+    usage.cacheBytes = mapBytes(_urlMatchCache);
+    for (const auto& [text, matches] : _urlMatchCache)
+    {
+        usage.cacheBytes += text.capacity() * sizeof(wchar_t) + matches.capacity() * sizeof(matches[0]);
+    }
+    usage.cacheBytes += (_delimiterClassCache.regular.capacity() + _delimiterClassCache.control.capacity()) * sizeof(uint64_t);
+
+    return usage;
+}
+
+// Routine Description:
+// - Enables or disables moving the text of cold rows that are more than SpillRowDistance lines above the
+//   cursor into a temporary file (see ScrollbackSpill). Their memory usage is then limited to their attributes.
+// - Disabling it reads all spilled rows back into memory. They remain cold.
+// Arguments:
+// - enable - whether to spill cold rows to disk.
+// Return Value:
+// - <none>
+void TextBuffer::EnableScrollbackSpill(const bool enable)
+{
+    _spillEnabled = enable;
+
+    if (!enable && _spill)
+    {
+        for (auto& row : _storage)
+        {
+            if (auto& entry = til::at(_spillIndex, _slotOf(row)))
+            {
+                row.RestoreColdData(_spill->Take(entry - 1));
+                entry = 0;
+            }
+        }
+
+        _spill.reset();
+        _spillIndex.clear();
+    }
+}
+
+bool TextBuffer::IsScrollbackSpillEnabled() const noexcept
+{
+    return _spillEnabled;
+}
+
+void TextBuffer::SetImageMemoryLimit(const size_t bytes) noexcept
+{
+    _imageMemoryLimit = bytes;
+}
+
+size_t TextBuffer::GetImageMemoryLimit() const noexcept
+{
+    return _imageMemoryLimit;
+}
+
+// Routine Description:
+// - Drops the image slices of the oldest rows until all of them fit into the image memory limit.
+//   This is called after an image was added, which makes scanning all rows affordable.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void TextBuffer::EnforceImageMemoryLimit()
+{
+    const auto height = TotalRowCount();
+    size_t usage = 0;
+
+    for (til::CoordType y = 0; y < height; ++y)
+    {
+        if (const auto slice = _peekRowByOffset(y).GetImageSlice())
+        {
+            usage += slice->MemoryUsage();
+        }
+    }
+
+    if (usage <= _imageMemoryLimit)
+    {
+        return;
+    }
+
+    for (til::CoordType y = 0; y < height && usage > _imageMemoryLimit; ++y)
+    {
+        if (const auto slice = _peekRowByOffset(y).TakeImageSlice())
+        {
+            usage -= slice->MemoryUsage();
+        }
+    }
+
+    TriggerRedrawAll();
+}
+
+// Routine Description:
+// - Called whenever the cursor advances into a new row. Every ColdRowCompactionInterval calls, this freezes
+//   the rows more than ColdRowDistance lines above the cursor (see ROW::Freeze()) and decommits their memory.
+//   GetRowByOffset() transparently thaws them again when they're accessed, for instance by search or selection.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void TextBuffer::CompactColdRows() noexcept
+try
+{
+    if (++_rowsSinceCompaction < ColdRowCompactionInterval)
+    {
+        return;
+    }
+
+    _rowsSinceCompaction = 0;
+
+    const auto y = _cursor.GetPosition().y;
+    if (y > ColdRowDistance)
+    {
+        _compactColdRows(y - ColdRowDistance);
+    }
+    if (_spillEnabled && y > SpillRowDistance)
+    {
+        _spillColdRows(y - SpillRowDistance);
+    }
+}
+CATCH_LOG()
+
+// Routine Description:
+// - Gives back as much memory as possible without losing any contents, because the system is low on memory:
+//   The caches of GetPatterns() and word navigation are dropped and every row more than TrimRowDistance lines
+//   above the cursor is frozen, or spilled to disk if enabled. The rows are thawed again on access, as usual.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void TextBuffer::TrimMemory() noexcept
+try
+{
+    decltype(_urlMatchCache){}.swap(_urlMatchCache);
+    _delimiterClassCache = {};
+    _rowsSinceCompaction = 0;
+
+    const auto y = _cursor.GetPosition().y;
+    if (y > TrimRowDistance)
+    {
+        _compactColdRows(y - TrimRowDistance);
+        if (_spillEnabled)
+        {
+            _spillColdRows(y - TrimRowDistance);
+        }
+    }
+}
+CATCH_LOG()
+
+// Freezes all rows above the given logical row and decommits the pages that aren't used by any row anymore.
+void TextBuffer::_compactColdRows(const til::CoordType end)
+{
+    auto frozen = false;
+    for (til::CoordType y = 0; y < end; ++y)
+    {
+        frozen |= _peekRowByOffset(y).Freeze(_blankRow);
+    }
+    if (frozen)
+    {
+        _decommitUnusedPages();
+    }
+}
+
+// Decommits the pages of _charBuffer that aren't used by any materialized row.
+void TextBuffer::_decommitUnusedPages()
+{
+    // If no row stores text in _charsPool anymore (for instance after ED 3), its slabs can go as well.
+    _charsPool->Release();
+
+    // Rows share pages with their neighbours, so we can only decommit those that no materialized row overlaps with.
+    // Since rows can be rotated around arbitrarily by ScrollRows() we can't infer that from a row's logical position.
+    const auto base = _charBuffer.get();
+    const auto pageOf = [=](const std::span<const std::byte>& storage) noexcept {
+        const auto beg = gsl::narrow_cast<size_t>(storage.data() - base) / PageSize;
+        const auto end = (gsl::narrow_cast<size_t>(storage.data() - base) + storage.size() - 1) / PageSize + 1;
+        return std::pair{ beg, end };
+    };
+
+    // The first page(s) belong to the blank row template, which is never decommitted.
+    const auto firstPage = pageOf(_blankRow.ReservedStorage()).second;
+    auto pageCount = firstPage;
+    std::vector<bool> used;
+    for (const auto rows : { std::span<const ROW>{ _storage }, std::span<const ROW>{ _spareRows } })
+    {
+        for (const auto& row : rows)
+        {
+            pageCount = std::max(pageCount, pageOf(row.ReservedStorage()).second);
+        }
+    }
+
+    used.resize(pageCount);
+    for (const auto rows : { std::span<const ROW>{ _storage }, std::span<const ROW>{ _spareRows } })
+    {
+        for (const auto& row : rows)
+        {
+            if (row.IsMaterialized())
+            {
+                const auto [beg, end] = pageOf(row.ReservedStorage());
+                std::fill(used.begin() + beg, used.begin() + end, true);
+            }
+        }
+    }
+
+    // Decommitting pages that aren't committed is fine, so we can simply decommit each run of unused pages.
+    for (auto page = firstPage; page < pageCount;)
+    {
+        if (used[page])
+        {
+            ++page;
+            continue;
+        }
+
+        auto runEnd = page + 1;
+        for (; runEnd < pageCount && !used[runEnd]; ++runEnd)
+        {
+        }
+
+#pragma warning(suppress : 26481) // Don't use pointer arithmetic. Use span instead (bounds.1).
+        LOG_IF_WIN32_BOOL_FALSE(VirtualFree(base + page * PageSize, (runEnd - page) * PageSize, MEM_DECOMMIT));
+        page = runEnd;
+    }
+}
+
+// Moves the compact storage of all cold rows above the given logical row into _spill.
+void TextBuffer::_spillColdRows(const til::CoordType end)
+{
+    if (!_spill)
+    {
+        _spill = std::make_unique<ScrollbackSpill>();
+        // _slotOf() indexes all slots in _charBuffer, including those of the spare rows.
+        _spillIndex.resize(_storage.size() + _spareRows.size());
+    }
+
+    for (til::CoordType y = 0; y < end; ++y)
+    {
+        auto& row = _peekRowByOffset(y);
+        if (!row.IsCold())
+        {
+            continue;
+        }
+
+        const auto size = row.ColdSize() / sizeof(uint16_t);
+        auto data = row.TakeColdData();
+        uint64_t offset = 0;
+
+        try
+        {
+            offset = _spill->Append({ data.get(), size });
+        }
+        catch (...)
+        {
+            row.RestoreColdData(std::move(data));
+            throw;
+        }
+
+        til::at(_spillIndex, _slotOf(row)) = offset + 1;
+    }
+}
+
+// Thaws the given row (see ROW::Thaw()), reading its contents back from _spill if necessary.
+void TextBuffer::_thaw(ROW& row) noexcept
+{
+    _unspill(row);
+    row.Thaw();
+}
+
+// Reads the contents of a spilled row back from _spill, but leaves the row cold.
+void TextBuffer::_unspill(ROW& row) noexcept
+{
+    if (!_spillIndex.empty() && !row.IsCold())
+    {
+        if (auto& entry = til::at(_spillIndex, _slotOf(row)))
+        {
+            // If the file can't be read for some reason, the row will simply be blank.
+            try
+            {
+                row.RestoreColdData(_spill->Take(entry - 1));
+            }
+            CATCH_LOG();
+            entry = 0;
+        }
+    }
+}
+
+// Forgets the spilled contents of a row that's about to be reset.
+void TextBuffer::_discardSpilledRow(const ROW& row) noexcept
+{
+    if (!_spillIndex.empty())
+    {
+        if (auto& entry = til::at(_spillIndex, _slotOf(row)))
+        {
+            try
+            {
+                _spill->Discard(entry - 1);
+            }
+            CATCH_LOG();
+            entry = 0;
+        }
+    }
+}
+
+// Returns the index of the given row's storage in _charBuffer, which is stable no matter how _storage gets rotated.
+size_t TextBuffer::_slotOf(const ROW& row) const noexcept
+{
+    const auto templateStorage = _blankRow.ReservedStorage();
+    const auto rowStride = templateStorage.size();
+    const auto templateSize = (rowStride + PageSize - 1) & ~(PageSize - 1);
+    return (gsl::narrow_cast<size_t>(row.ReservedStorage().data() - templateStorage.data()) - templateSize) / rowStride;
+}
+
 // Routine Description:
 // - Retrieves read-only text iterator at the given buffer location
 // Arguments:
@@ -298,6 +729,7 @@ void TextBuffer::ConsumeGrapheme(std::wstring_view& chars) noexcept
 {
     // This function is supposed to mirror the behavior of ROW::Write, when it reads characters off of `chars`.
     // (I know that a UTF-16 code point is not a grapheme, but that's what we're working towards.)
+    // Once ROW stores grapheme clusters, both of them can switch over to til::grapheme::cluster_pop().
     chars = til::utf16_pop(chars);
 }
 
@@ -404,43 +836,201 @@ OutputCellIterator TextBuffer::WriteLine(const OutputCellIterator givenIt,
     return newIt;
 }
 
-//Routine Description:
-// - Inserts one codepoint into the buffer at the current cursor position and advances the cursor as appropriate.
-//Arguments:
-// - chars - The codepoint to insert
-// - dbcsAttribute - Double byte information associated with the codepoint
-// - bAttr - Color data associated with the character
-//Return Value:
-// - true if we successfully inserted the character
-// - false otherwise (out of memory)
-bool TextBuffer::InsertCharacter(const std::wstring_view chars,
-                                 const DbcsAttribute dbcsAttribute,
-                                 const TextAttribute attr)
+// Routine Description:
+// - Writes a row of CHAR_INFOs, as given to WriteConsoleOutputW(), to the output buffer with ROW::WriteCharInfos().
+// - This is a lot faster than writing an OutputCellIterator with WriteLine(), which works cell by cell.
+// Arguments:
+// - target - The row/column to start writing the CHAR_INFOs to. They're written as far as they fit into the row.
+// - charInfos - The CHAR_INFOs to write.
+// Return Value:
+// - false if nothing was written, because the DBCS leading/trailing bytes in charInfos need to be written with WriteLine().
+bool TextBuffer::WriteCharInfos(const til::point target, const std::span<const CHAR_INFO> charInfos)
 {
-    // Ensure consistent buffer state for double byte characters based on the character type we're about to insert
-    auto fSuccess = _PrepareForDoubleByteSequence(dbcsAttribute);
+    if (!GetSize().IsInBounds(target))
+    {
+        return false;
+    }
 
-    if (fSuccess)
+    auto& row = GetRowByOffset(target.y);
+    if (!row.WriteCharInfos(target.x, charInfos))
     {
-        // Get the current cursor position
-        const auto iRow = GetCursor().GetPosition().y; // row stored as logical position, not array position
-        const auto iCol = GetCursor().GetPosition().x; // column logical and array positions are equal.
+        return false;
+    }
 
-        // Get the row associated with the given logical position
-        auto& Row = GetRowByOffset(iRow);
+    const auto written = std::min(gsl::narrow_cast<til::CoordType>(charInfos.size()), row.size() - target.x);
+    TriggerRedraw(Viewport::FromDimensions(target, { written, 1 }));
+    return true;
+}
 
-        // Store character and double byte data
-        try
-        {
-            switch (dbcsAttribute)
-            {
-            case DbcsAttribute::Leading:
-                Row.ReplaceCharacters(iCol, 2, chars);
-                break;
-            case DbcsAttribute::Trailing:
-                Row.ReplaceCharacters(iCol - 1, 2, chars);
-                break;
-            default:
+// Routine Description:
+// - Fills a rectangular area of the buffer with the given glyph and attributes.
+// - Unlike writing an OutputCellIterator with WriteLine(), this writes each row in one go,
+//   which matters for TUIs that erase and fill large areas of the screen all the time.
+// - Rows that are filled up to their last column are marked as not wrapped.
+// Arguments:
+// - rect - The area to fill. It's clamped to the size of the buffer.
+// - fill - The glyph to fill the area with. A wide glyph that doesn't fit into the last column is replaced with whitespace.
+// - attributes - The attributes to fill the area with.
+void TextBuffer::FillRect(const til::rect& rect, const std::wstring_view& fill, const TextAttribute& attributes)
+{
+    const auto size = GetSize().Dimensions();
+    const auto left = std::max(rect.left, 0);
+    const auto top = std::max(rect.top, 0);
+    const auto right = std::min(rect.right, size.width);
+    const auto bottom = std::min(rect.bottom, size.height);
+    if (left >= right || top >= bottom || fill.empty())
+    {
+        return;
+    }
+
+    // Repeating the glyph for the entire width allows ROW::ReplaceText() to memcpy it, if it's narrow.
+    std::wstring text;
+    text.reserve(fill.size() * (right - left));
+    for (auto x = left; x < right; ++x)
+    {
+        text.append(fill);
+    }
+
+    auto dirtyLeft = left;
+    auto dirtyRight = right;
+    for (auto y = top; y < bottom; ++y)
+    {
+        auto& row = GetRowByOffset(y);
+        RowWriteState state{
+            .text = text,
+            .columnBegin = left,
+            .columnLimit = right,
+        };
+        row.ReplaceText(state);
+        row.ReplaceAttributes(left, right, attributes);
+        if (right >= row.size())
+        {
+            row.SetWrapForced(false);
+        }
+        dirtyLeft = std::min(dirtyLeft, state.columnBeginDirty);
+        dirtyRight = std::max(dirtyRight, state.columnEndDirty);
+    }
+
+    TriggerRedraw(Viewport::FromExclusive({ dirtyLeft, top, dirtyRight, bottom }));
+}
+
+// Routine Description:
+// - Copies a rectangular area of the buffer, including its attributes, to another position.
+// - The source and target may overlap. Each row is copied with ROW::CopyRangeFrom(), instead of cell by cell.
+// - Only the columns that are visible on a source line are copied: On double-width lines that's only the left half.
+// - Wide glyphs that are cut off by the left or right edge of the source area are replaced with whitespace.
+// Arguments:
+// - source - The area to copy. It's clamped to the size of the buffer.
+// - target - The top left corner of the destination. The area is clipped if it doesn't fit there.
+void TextBuffer::CopyRect(const til::rect& source, const til::point target)
+{
+    const auto size = GetSize().Dimensions();
+    const auto left = std::max(source.left, 0);
+    const auto top = std::max(source.top, 0);
+    const auto width = std::min({ source.right, size.width, left + size.width - target.x }) - left;
+    const auto height = std::min({ source.bottom, size.height, top + size.height - target.y }) - top;
+    if (width <= 0 || height <= 0 || target.x < 0 || target.y < 0 || (left == target.x && top == target.y))
+    {
+        return;
+    }
+
+    const auto copyCells = [](ROW& dst, const til::CoordType dstX, const ROW& src, const til::CoordType srcLeft, const til::CoordType srcRight) {
+        auto srcX = srcLeft;
+        auto x = dstX;
+        // If the leading half of a wide glyph lies outside the source, the glyph is cut off.
+        if (src.DbcsAttrAt(srcX) == DbcsAttribute::Trailing)
+        {
+            dst.ReplaceCharacters(x, 1, L" ");
+            ++srcX;
+            ++x;
+        }
+        if (srcX < srcRight)
+        {
+            dst.CopyRangeFrom(x, x + srcRight - srcX, src, srcX, srcRight);
+        }
+        dst.CopyAttributesFrom(dstX, src, srcLeft, srcRight);
+    };
+
+    // A row can't be copied onto itself directly, since CopyRangeFrom() would read what it just wrote.
+    // Such rows are copied through a scratch row instead, which is allocated on first use.
+    std::vector<wchar_t> scratchChars;
+    std::vector<uint16_t> scratchCharOffsets;
+    std::optional<ROW> scratch;
+
+    // If the target is below the source we copy from the bottom up, so that we don't overwrite rows we have yet to copy.
+    const auto step = target.y > top ? -1 : 1;
+    for (auto i = 0, dy = step > 0 ? 0 : height - 1; i < height; ++i, dy += step)
+    {
+        const auto srcY = top + dy;
+        const auto dstY = target.y + dy;
+        const auto srcRight = std::min(left + width, GetLineWidth(srcY));
+        if (left >= srcRight)
+        {
+            continue;
+        }
+
+        const auto& src = GetRowByOffset(srcY);
+        auto& dst = GetRowByOffset(dstY);
+        if (&src == &dst)
+        {
+            if (!scratch)
+            {
+                const auto scratchWidth = gsl::narrow<uint16_t>(size.width);
+                scratchChars.resize(scratchWidth);
+                scratchCharOffsets.resize(scratchWidth + 1u);
+                scratch.emplace(scratchChars.data(), scratchCharOffsets.data(), scratchWidth, TextAttribute{});
+            }
+            scratch->Reset(TextAttribute{});
+            copyCells(*scratch, 0, src, left, srcRight);
+            copyCells(dst, target.x, *scratch, 0, srcRight - left);
+        }
+        else
+        {
+            copyCells(dst, target.x, src, left, srcRight);
+        }
+    }
+
+    // Cutting off wide glyphs may also modify the column on either side of the target.
+    TriggerRedraw(Viewport::FromExclusive({ std::max(target.x - 1, 0), target.y, std::min(target.x + width + 1, size.width), target.y + height }));
+}
+
+//Routine Description:
+// - Inserts one codepoint into the buffer at the current cursor position and advances the cursor as appropriate.
+//Arguments:
+// - chars - The codepoint to insert
+// - dbcsAttribute - Double byte information associated with the codepoint
+// - bAttr - Color data associated with the character
+//Return Value:
+// - true if we successfully inserted the character
+// - false otherwise (out of memory)
+bool TextBuffer::InsertCharacter(const std::wstring_view chars,
+                                 const DbcsAttribute dbcsAttribute,
+                                 const TextAttribute attr)
+{
+    // Ensure consistent buffer state for double byte characters based on the character type we're about to insert
+    auto fSuccess = _PrepareForDoubleByteSequence(dbcsAttribute);
+
+    if (fSuccess)
+    {
+        // Get the current cursor position
+        const auto iRow = GetCursor().GetPosition().y; // row stored as logical position, not array position
+        const auto iCol = GetCursor().GetPosition().x; // column logical and array positions are equal.
+
+        // Get the row associated with the given logical position
+        auto& Row = GetRowByOffset(iRow);
+
+        // Store character and double byte data
+        try
+        {
+            switch (dbcsAttribute)
+            {
+            case DbcsAttribute::Leading:
+                Row.ReplaceCharacters(iCol, 2, chars);
+                break;
+            case DbcsAttribute::Trailing:
+                Row.ReplaceCharacters(iCol - 1, 2, chars);
+                break;
+            default:
                 Row.ReplaceCharacters(iCol, 1, chars);
                 break;
             }
@@ -561,6 +1151,7 @@ bool TextBuffer::NewlineCursor()
     }
     else
     {
+        CompactColdRows();
         fSuccess = true;
     }
     return fSuccess;
@@ -592,7 +1183,11 @@ bool TextBuffer::IncrementCircularBuffer(const bool inVtMode)
         // the current background color, but with no meta attributes set.
         fillAttributes.SetStandardErase();
     }
-    GetRowByOffset(0).Reset(fillAttributes);
+    auto& recycledRow = _peekRowByOffset(0);
+    _discardSpilledRow(recycledRow);
+    recycledRow.Reset(fillAttributes);
+    // The row now holds a new line of text. The other rows keep their ids while they move up.
+    recycledRow.SetId(_NewRowId());
     {
         // Now proceed to increment.
         // Incrementing it will cause the next line down to become the new "top" of the window (the new "0" in logical coordinates)
@@ -604,6 +1199,38 @@ bool TextBuffer::IncrementCircularBuffer(const bool inVtMode)
             _firstRow = 0;
         }
     }
+
+    // Any lines that ReflowLazily() skipped move up as well. Those that scrolled out entirely don't need to be filled anymore.
+    if (_pendingReflow)
+    {
+        auto& pending = *_pendingReflow;
+        pending.scrolled++;
+        for (; pending.front < pending.back; ++pending.front)
+        {
+            auto& group = til::at(pending.groups, pending.front);
+            if (group.first + group.height > pending.scrolled)
+            {
+                break;
+            }
+            if (!group.filled)
+            {
+                group.filled = true;
+                pending.remaining--;
+            }
+        }
+        if (pending.remaining == 0)
+        {
+            _pendingReflow.reset();
+        }
+    }
+
+    // Everything moved up by one row and the recycled row is now the last one.
+    _dirtyRows.scrolled++;
+    _dirtyRows.begin = std::max(_dirtyRows.begin - 1, 0);
+    _dirtyRows.end = std::max(_dirtyRows.end - 1, 0);
+    _MarkRowsDirty(GetSize().Height() - 1, GetSize().Height());
+
+    CompactColdRows();
     return true;
 }
 
@@ -632,6 +1259,8 @@ til::point TextBuffer::GetLastNonSpaceCharacter(std::optional<const Microsoft::C
     coordEndOfText.x = currRow.MeasureRight() - 1;
 
     // If the X coordinate turns out to be -1, the row was empty, we need to search backwards for the real end of text.
+    // MeasureRight() is O(1) for rows that were never written to and for those that haven't changed since
+    // the last time they were measured, so this only scans the rows that were modified in the meantime.
     const auto viewportTop = viewport.Top();
     auto fDoBackUp = (coordEndOfText.x < 0 && coordEndOfText.y > viewportTop); // this row is empty, and we're not at the top
     while (fDoBackUp)
@@ -693,7 +1322,7 @@ const Viewport TextBuffer::GetSize() const noexcept
     return _size;
 }
 
-wil::unique_virtualalloc_ptr<std::byte> TextBuffer::_allocateBuffer(til::size sz, const TextAttribute& attributes, std::vector<ROW>& rows)
+wil::unique_virtualalloc_ptr<std::byte> TextBuffer::_allocateBuffer(til::size sz, const TextAttribute& attributes, RowCharPool* charsPool, ROW& blankRow, std::vector<ROW>& rows)
 {
     const auto w = gsl::narrow<uint16_t>(sz.width);
     const auto h = gsl::narrow<uint16_t>(sz.height);
@@ -703,27 +1332,47 @@ wil::unique_virtualalloc_ptr<std::byte> TextBuffer::_allocateBuffer(til::size sz
     // That extra column stores the past-the-end _chars pointer.
     const auto indicesBytes = w * sizeof(uint16_t) + sizeof(uint16_t);
     const auto rowStride = charsBytes + indicesBytes;
+    // The rows are preceded by a blank row, which they share until they're written to.
+    // It's padded to a whole page, so that it can be made read-only without affecting the rows.
+    const auto templateSize = (rowStride + PageSize - 1) & ~(PageSize - 1);
     // 65535*65535 cells would result in a charsAreaSize of 8GiB.
     // --> Use uint64_t so that we can safely do our calculations even on x86.
-    const auto allocSize = gsl::narrow<size_t>(::base::strict_cast<uint64_t>(rowStride) * ::base::strict_cast<uint64_t>(h));
+    const auto allocSize = gsl::narrow<size_t>(::base::strict_cast<uint64_t>(templateSize) + ::base::strict_cast<uint64_t>(rowStride) * ::base::strict_cast<uint64_t>(h));
 
-    auto buffer = wil::unique_virtualalloc_ptr<std::byte>{ static_cast<std::byte*>(VirtualAlloc(nullptr, allocSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE)) };
+    // Only the address space for the rows gets reserved here. ROW commits the memory it needs, when it needs it.
+    // A 9001 row scrollback thus costs us a single page until something actually gets written into it.
+    auto buffer = wil::unique_virtualalloc_ptr<std::byte>{ static_cast<std::byte*>(VirtualAlloc(nullptr, allocSize, MEM_RESERVE, PAGE_READWRITE)) };
     THROW_IF_NULL_ALLOC(buffer);
+    THROW_IF_NULL_ALLOC(VirtualAlloc(buffer.get(), templateSize, MEM_COMMIT, PAGE_READWRITE));
 
     auto data = std::span{ buffer.get(), allocSize }.begin();
 
+    blankRow = { til::bit_cast<wchar_t*>(&*data), til::bit_cast<uint16_t*>(&*(data + charsBytes)), charsPool, w, attributes };
+    DWORD oldProtect = 0;
+    THROW_IF_WIN32_BOOL_FALSE(VirtualProtect(buffer.get(), templateSize, PAGE_READONLY, &oldProtect));
+    data += templateSize;
+
     rows.resize(h);
     for (auto& row : rows)
     {
         const auto chars = til::bit_cast<wchar_t*>(&*data);
         const auto indices = til::bit_cast<uint16_t*>(&*(data + charsBytes));
-        row = { chars, indices, w, attributes };
+        row = { chars, indices, charsPool, blankRow, attributes };
+        row.SetId(_NewRowId());
         data += rowStride;
     }
 
     return buffer;
 }
 
+// Returns a row id (see ROW::GetId()) that's unique across all text buffers,
+// so that caches keyed by it survive switching to the alt buffer or resizing.
+uint64_t TextBuffer::_NewRowId() noexcept
+{
+    static std::atomic<uint64_t> nextId{ 1 };
+    return nextId.fetch_add(1, std::memory_order_relaxed);
+}
+
 void TextBuffer::_UpdateSize()
 {
     _size = Viewport::FromDimensions({ _storage.at(0).size(), gsl::narrow<til::CoordType>(_storage.size()) });
@@ -742,18 +1391,30 @@ void TextBuffer::ScrollRows(const til::CoordType firstRow, const til::CoordType
         return;
     }
 
-    // OK. We're about to play games by moving rows around within the deque to
-    // scroll a massive region in a faster way than copying things.
-    // To make this easier, first correct the circular buffer to have the first row be 0 again.
-    if (_firstRow != 0)
+    // The pending lines of ReflowLazily() are tracked by their position, so we fill in those that are about to move.
+    if (_pendingReflow)
     {
-        // Rotate the buffer to put the first row at the front.
-        std::rotate(_storage.begin(), _storage.begin() + _firstRow, _storage.end());
-
-        // The first row is now at the top.
-        _firstRow = 0;
+        _fillPendingReflow(std::min(firstRow, firstRow + delta), std::max(firstRow + size, firstRow + size + delta));
     }
 
+    // OK. We're about to play games by moving rows around within the storage to
+    // scroll a massive region in a faster way than copying things.
+    // The rows are stored circularly starting at _firstRow. Instead of rotating the entire storage
+    // to put the first row at the front (which touches every row in the buffer for every line feed
+    // inside the scroll margins), we only permute the affected rows via their circular offsets.
+    // This works just like std::rotate(first, mid, last), using the 3 reversals approach.
+    const auto rotate = [this](const til::CoordType first, const til::CoordType mid, const til::CoordType last) {
+        const auto reverse = [this](til::CoordType begin, til::CoordType end) {
+            for (--end; begin < end; ++begin, --end)
+            {
+                std::swap(_peekRowByOffset(begin), _peekRowByOffset(end));
+            }
+        };
+        reverse(first, mid);
+        reverse(mid, last);
+        reverse(first, last);
+    };
+
     // Rotate just the subsection specified
     if (delta < 0)
     {
@@ -790,7 +1451,7 @@ void TextBuffer::ScrollRows(const til::CoordType firstRow, const til::CoordType
         // | 10
         // | 11
         // - end
-        std::rotate(_storage.begin() + firstRow + delta, _storage.begin() + firstRow, _storage.begin() + firstRow + size);
+        rotate(firstRow + delta, firstRow, firstRow + size);
     }
     else
     {
@@ -827,7 +1488,7 @@ void TextBuffer::ScrollRows(const til::CoordType firstRow, const til::CoordType
         // | 10
         // | 11
         // - end
-        std::rotate(_storage.begin() + firstRow, _storage.begin() + firstRow + size, _storage.begin() + firstRow + size + delta);
+        rotate(firstRow, firstRow + size, firstRow + size + delta);
     }
 }
 
@@ -934,6 +1595,118 @@ void TextBuffer::Reset()
     {
         row.Reset(attr);
     }
+
+    // All rows have handed their overflow storage back, so the slabs can be freed in one go.
+    _charsPool->Release();
+    _pendingReflow.reset();
+    _spill.reset();
+    _spillIndex.clear();
+    _MarkRowsDirty(0, GetSize().Height());
+}
+
+// Routine Description:
+// - Clears the given rows, like filling them with whitespace would, but without writing to them:
+//   Each row is switched back to the blank template and the pages it had committed are decommitted.
+//   The rows are initialized lazily once they're written to again (see ROW::_materialize()).
+//   Erasing the scrollback (ED 3) covers the entire buffer, which can be 100k's of rows.
+// Arguments:
+// - begin - the first row to clear
+// - end - the row past the last one to clear
+// - attributes - the attributes to fill the rows with
+// Return Value:
+// - <none>
+void TextBuffer::ClearRows(til::CoordType begin, til::CoordType end, const TextAttribute& attributes)
+{
+    begin = std::max(begin, 0);
+    end = std::min(end, GetSize().Height());
+    if (begin >= end)
+    {
+        return;
+    }
+
+    _discardPendingReflow(begin, end);
+
+    for (auto y = begin; y < end; ++y)
+    {
+        auto& row = _peekRowByOffset(y);
+        _discardSpilledRow(row);
+        row.ResetToTemplate(_blankRow, attributes);
+    }
+
+    _decommitUnusedPages();
+    _MarkRowsDirty(begin, end);
+    TriggerRedraw(Viewport::FromExclusive({ 0, begin, GetSize().Width(), end }));
+}
+
+// Routine Description:
+// - Moves the rows [top, top + height) to the top of the buffer and clears all others (see ClearRows()).
+//   Instead of moving any rows, this rotates the circular buffer, which puts the rows above
+//   the given range at the bottom, where they're cleared along with the rest.
+// Arguments:
+// - top - the first row to keep, usually the top of the viewport
+// - height - the number of rows to keep
+// - attributes - the attributes to fill the cleared rows with
+// Return Value:
+// - <none>
+void TextBuffer::ClearScrollback(const til::CoordType top, const til::CoordType height, const TextAttribute& attributes)
+{
+    const auto totalRows = GetSize().Height();
+    if (top > 0 && top < totalRows)
+    {
+        // The pending lines of ReflowLazily() are tracked by their position, just like in IncrementCircularBuffer().
+        _discardPendingReflow(0, top);
+        if (_pendingReflow)
+        {
+            _pendingReflow->scrolled += top;
+        }
+        _SetFirstRowIndex((_firstRow + top) % totalRows);
+    }
+
+    ClearRows(height, totalRows, attributes);
+    _MarkRowsDirty(0, height);
+    TriggerRedraw(Viewport::FromExclusive({ 0, 0, GetSize().Width(), height }));
+}
+
+// Routine Description:
+// - Puts this buffer into the state of a newly constructed one, but keeps the
+//   memory of its rows. Alternate screen buffers are entered and left all the
+//   time (pagers, editors, ...) and this makes a cached one cheap to reuse.
+// Arguments:
+// - screenBufferSize - the size the buffer should have
+// - defaultAttributes - the attributes to fill the buffer with
+// - cursorSize - the size of the cursor, see Cursor::SetSize
+// Return Value:
+// - <none>
+void TextBuffer::Recycle(const til::size screenBufferSize, const TextAttribute defaultAttributes, const UINT cursorSize)
+{
+    if (GetSize().Dimensions() != screenBufferSize)
+    {
+        THROW_IF_FAILED(ResizeTraditional(screenBufferSize));
+    }
+
+    _currentAttributes = defaultAttributes;
+    _SetFirstRowIndex(0);
+    Reset();
+
+    _hyperlinkMap.clear();
+    _hyperlinkCustomIdMap.clear();
+    _hyperlinkUris.clear();
+    _hyperlinkPruneCandidates.clear();
+    _hyperlinkRowsFreed = 0;
+    _currentHyperlinkId = 1;
+    ClearPatternRecognizers();
+
+    _cursor.SetPosition({});
+    _cursor.ResetDelayEOLWrap();
+    _cursor.SetStyle(cursorSize, CursorType::Legacy);
+    _cursor.SetIsVisible(true);
+    _cursor.SetIsOn(true);
+    _cursor.SetIsDouble(false);
+    _cursor.SetBlinkingAllowed(true);
+    _cursor.SetDelay(false);
+    _cursor.SetIsConversionArea(false);
+    _cursor.SetIsPopupShown(false);
+    _cursor.SetHasMoved(false);
 }
 
 // Routine Description:
@@ -950,6 +1723,12 @@ void TextBuffer::Reset()
 
     try
     {
+        // The rows are copied as they are, so any lines that ReflowLazily() skipped have to be filled in first.
+        if (_pendingReflow)
+        {
+            _fillPendingReflow(0, GetSize().Height());
+        }
+
         til::CoordType TopRow = 0; // new top row of the screen buffer
         if (newSize.height <= GetCursor().GetPosition().y)
         {
@@ -957,8 +1736,18 @@ void TextBuffer::Reset()
         }
         const auto TopRowIndex = gsl::narrow_cast<size_t>(_firstRow + TopRow) % _storage.size();
 
+        // Fast path: If only the height changes and _charBuffer has enough row slots, the rows can be kept
+        // where they are. This is common for applications that call SetConsoleScreenBufferSize repeatedly.
+        if (newSize.width == GetSize().Width() && gsl::narrow_cast<size_t>(newSize.height) <= _storage.size() + _spareRows.size())
+        {
+            _resizeHeightInPlace(newSize.height, TopRowIndex);
+            return S_OK;
+        }
+
+        auto newCharsPool = std::make_unique<RowCharPool>();
+        ROW newBlankRow;
         std::vector<ROW> newStorage;
-        auto newBuffer = _allocateBuffer(newSize, _currentAttributes, newStorage);
+        auto newBuffer = _allocateBuffer(newSize, _currentAttributes, newCharsPool.get(), newBlankRow, newStorage);
 
         // This basically imitates a std::rotate_copy(first, mid, last), but uses ROW::CopyRangeFrom() to do the copying.
         {
@@ -984,10 +1773,15 @@ void TextBuffer::Reset()
 
             for (const auto& sourceRange : sourceRanges)
             {
-                for (const auto& oldRow : sourceRange)
+                for (auto& oldRow : sourceRange)
                 {
-                    til::CoordType begin = 0;
-                    dest->CopyRangeFrom(0, til::CoordTypeMax, oldRow, begin, til::CoordTypeMax);
+                    _thaw(oldRow);
+                    // Rows that were never written to are blank and there's no need to materialize their copy.
+                    if (oldRow.IsMaterialized())
+                    {
+                        til::CoordType begin = 0;
+                        dest->CopyRangeFrom(0, til::CoordTypeMax, oldRow, begin, til::CoordTypeMax);
+                    }
                     dest->TransferAttributes(oldRow.Attributes(), newSize.width);
                     ++dest;
                 }
@@ -995,16 +1789,63 @@ void TextBuffer::Reset()
         }
 
         _charBuffer = std::move(newBuffer);
+        _blankRow = std::move(newBlankRow);
         _storage = std::move(newStorage);
+        _spareRows.clear();
+        // The old rows are gone and with them every block of the old pool. Its slabs are freed all at once.
+        _charsPool = std::move(newCharsPool);
+        // All spilled rows have been read back by _thaw() above.
+        _spill.reset();
+        _spillIndex.clear();
 
         _SetFirstRowIndex(0);
         _UpdateSize();
+        _MarkRowsDirty(0, newSize.height);
     }
     CATCH_RETURN();
 
     return S_OK;
 }
 
+// Routine Description:
+// - The in-place variant of ResizeTraditional() for when only the height changes.
+//   The rows are rotated so that the new top row comes first, which mirrors the copy done by
+//   ResizeTraditional(). Rows past the new height are reset and kept in _spareRows, which is also
+//   where additional rows come from. Since the rows keep their storage, _spillIndex remains valid.
+// Arguments:
+// - height - The new height of the buffer. Must not exceed the number of rows plus spare rows.
+// - topRowIndex - The index in _storage of the row that becomes the first row.
+void TextBuffer::_resizeHeightInPlace(const til::CoordType height, const size_t topRowIndex)
+{
+    const auto newHeight = gsl::narrow_cast<size_t>(height);
+
+    // Reserve upfront, so that moving the rows between the two can't fail halfway through.
+    _storage.reserve(newHeight);
+    _spareRows.reserve(_storage.size() + _spareRows.size());
+
+    std::rotate(_storage.begin(), _storage.begin() + topRowIndex, _storage.end());
+
+    while (_storage.size() > newHeight)
+    {
+        auto& row = _storage.back();
+        _discardSpilledRow(row);
+        row.Reset(_currentAttributes);
+        _spareRows.emplace_back(std::move(row));
+        _storage.pop_back();
+    }
+
+    while (_storage.size() < newHeight)
+    {
+        auto& row = _storage.emplace_back(std::move(_spareRows.back()));
+        _spareRows.pop_back();
+        row.Reset(_currentAttributes);
+    }
+
+    _SetFirstRowIndex(0);
+    _UpdateSize();
+    _MarkRowsDirty(0, height);
+}
+
 void TextBuffer::SetAsActiveBuffer(const bool isActiveBuffer) noexcept
 {
     _isActiveBuffer = isActiveBuffer;
@@ -1022,12 +1863,40 @@ Microsoft::Console::Render::Renderer& TextBuffer::GetRenderer() noexcept
 
 void TextBuffer::TriggerRedraw(const Viewport& viewport)
 {
+    _MarkRowsDirty(viewport.Top(), viewport.BottomExclusive());
+
     if (_isActiveBuffer)
     {
         _renderer.TriggerRedraw(viewport);
     }
 }
 
+// Returns the rows that were modified since the last call and resets the tracking.
+// Only the row range is tracked, so a call may report more rows than were actually modified.
+TextBuffer::DirtyRows TextBuffer::TakeDirtyRows() noexcept
+{
+    return std::exchange(_dirtyRows, {});
+}
+
+void TextBuffer::_MarkRowsDirty(const til::CoordType begin, const til::CoordType end) noexcept
+{
+    if (begin >= end)
+    {
+        return;
+    }
+
+    if (_dirtyRows.begin >= _dirtyRows.end)
+    {
+        _dirtyRows.begin = begin;
+        _dirtyRows.end = end;
+    }
+    else
+    {
+        _dirtyRows.begin = std::min(_dirtyRows.begin, begin);
+        _dirtyRows.end = std::max(_dirtyRows.end, end);
+    }
+}
+
 void TextBuffer::TriggerRedrawCursor(const til::point position)
 {
     if (_isActiveBuffer)
@@ -1038,6 +1907,8 @@ void TextBuffer::TriggerRedrawCursor(const til::point position)
 
 void TextBuffer::TriggerRedrawAll()
 {
+    _MarkRowsDirty(0, GetSize().Height());
+
     if (_isActiveBuffer)
     {
         _renderer.TriggerRedrawAll();
@@ -1089,9 +1960,82 @@ ROW& TextBuffer::_GetFirstRow() noexcept
 // - the delimiter class for the given char
 DelimiterClass TextBuffer::_GetDelimiterClassAt(const til::point pos, const std::wstring_view wordDelimiters) const noexcept
 {
+    if (const auto classes = _GetDelimiterClasses(pos.y, wordDelimiters))
+    {
+        return classes->At(pos.x);
+    }
     return GetRowByOffset(pos.y).DelimiterClassAt(pos.x, wordDelimiters);
 }
 
+// Method Description:
+// - Returns the delimiter classes of all columns in the given row. They're cached
+//   until the row's contents change or another row or set of delimiters is asked for.
+// Arguments:
+// - y: the row under observation
+// - wordDelimiters: the delimiters defined as a part of the DelimiterClass::DelimiterChar
+// Return Value:
+// - the delimiter classes, or nullptr if they couldn't be computed
+const TextBuffer::DelimiterClassCache* TextBuffer::_GetDelimiterClasses(const til::CoordType y, const std::wstring_view wordDelimiters) const noexcept
+try
+{
+    const auto& row = GetRowByOffset(y);
+    auto& cache = _delimiterClassCache;
+
+    if (cache.rowId != row.GetId() || cache.rowRevision != row.GetRevision() || cache.wordDelimiters != wordDelimiters)
+    {
+        const auto columns = row.size();
+        const auto words = (gsl::narrow_cast<size_t>(columns) + 63) / 64;
+
+        // Invalidate the cache first, in case any of this throws.
+        cache.rowId = 0;
+        cache.wordDelimiters = wordDelimiters;
+        cache.regular.resize(words);
+        cache.control.resize(words);
+        row.GetDelimiterClasses(wordDelimiters, cache.regular, cache.control);
+        cache.columns = columns;
+        cache.rowId = row.GetId();
+        cache.rowRevision = row.GetRevision();
+    }
+
+    return cache.columns > 0 ? &cache : nullptr;
+}
+catch (...)
+{
+    LOG_CAUGHT_EXCEPTION();
+    return nullptr;
+}
+
+DelimiterClass TextBuffer::DelimiterClassCache::At(const til::CoordType column) const noexcept
+{
+    // Like ROW::DelimiterClassAt(), this clamps the column into the row.
+    const auto col = gsl::narrow_cast<size_t>(std::clamp(column, 0, columns - 1));
+    const auto bit = uint64_t{ 1 } << (col & 63);
+
+    if (til::at(regular, col >> 6) & bit)
+    {
+        return DelimiterClass::RegularChar;
+    }
+    if (til::at(control, col >> 6) & bit)
+    {
+        return DelimiterClass::ControlChar;
+    }
+    return DelimiterClass::DelimiterChar;
+}
+
+// Returns a bitmap of the columns [word * 64, word * 64 + 64) whose class is delimiterClass.
+uint64_t TextBuffer::DelimiterClassCache::Mask(const size_t word, const DelimiterClass delimiterClass) const noexcept
+{
+    switch (delimiterClass)
+    {
+    case DelimiterClass::RegularChar:
+        return til::at(regular, word);
+    case DelimiterClass::ControlChar:
+        return til::at(control, word);
+    default:
+        return ~(til::at(regular, word) | til::at(control, word));
+    }
+}
+
 // Method Description:
 // - Get the til::point for the beginning of the word you are on
 // Arguments:
@@ -1203,6 +2147,34 @@ til::point TextBuffer::_GetWordStartForSelection(const til::point target, const
     auto result = target;
     const auto bufferSize = GetSize();
 
+    // Find the closest column to the left of the target with a different delimiter
+    // class by scanning the row's bitmaps, instead of checking each column on its own.
+    if (const auto classes = _GetDelimiterClasses(target.y, wordDelimiters); classes && classes->columns == bufferSize.Width())
+    {
+        const auto x = gsl::narrow_cast<size_t>(std::clamp(target.x, 0, classes->columns - 1));
+        const auto initialDelimiter = classes->At(target.x);
+
+        for (auto word = x / 64 + 1; word-- > 0;)
+        {
+            auto different = ~classes->Mask(word, initialDelimiter);
+            if (word == x / 64)
+            {
+                // Only consider the columns up to and including x.
+                different &= ~uint64_t{ 0 } >> (63 - (x & 63));
+            }
+            if (different)
+            {
+                // The word starts right after the column with a different class.
+                result.x = gsl::narrow_cast<til::CoordType>(word * 64 + 63 - std::countl_zero(different) + 1);
+                return result;
+            }
+        }
+
+        // expanded all the way to the left boundary
+        result.x = bufferSize.Left();
+        return result;
+    }
+
     const auto initialDelimiter = _GetDelimiterClassAt(result, wordDelimiters);
 
     // expand left until we hit the left boundary or a different delimiter class
@@ -1330,6 +2302,37 @@ til::point TextBuffer::_GetWordEndForSelection(const til::point target, const st
     }
 
     auto result = target;
+
+    // Same as in _GetWordStartForSelection(), but scanning to the right.
+    if (const auto classes = _GetDelimiterClasses(target.y, wordDelimiters); classes && classes->columns == bufferSize.Width())
+    {
+        const auto x = gsl::narrow_cast<size_t>(std::clamp(target.x, 0, classes->columns - 1));
+        const auto initialDelimiter = classes->At(target.x);
+        const auto words = classes->regular.size();
+
+        for (auto word = x / 64; word < words; ++word)
+        {
+            auto different = ~classes->Mask(word, initialDelimiter);
+            if (word == x / 64)
+            {
+                // Only consider the columns from x onwards.
+                different &= ~uint64_t{ 0 } << (x & 63);
+            }
+            if (different)
+            {
+                // The word ends right before the column with a different class.
+                // The bits past the last column may be set, hence the clamp.
+                const auto col = gsl::narrow_cast<til::CoordType>(word * 64 + std::countr_zero(different));
+                result.x = std::min(col, bufferSize.RightInclusive() + 1) - 1;
+                return result;
+            }
+        }
+
+        // expanded all the way to the right boundary
+        result.x = bufferSize.RightInclusive();
+        return result;
+    }
+
     const auto initialDelimiter = _GetDelimiterClassAt(result, wordDelimiters);
 
     // expand right until we hit the right boundary or a different delimiter class
@@ -1349,57 +2352,126 @@ til::point TextBuffer::_GetWordEndForSelection(const til::point target, const st
 
 void TextBuffer::_PruneHyperlinks()
 {
-    // Check the old first row for hyperlink references
-    // If there are any, search the entire buffer for the same reference
-    // If the buffer does not contain the same reference, we can remove that hyperlink from our map
-    // This way, obsolete hyperlink references are cleared from our hyperlink map instead of hanging around
-    // Get all the hyperlink references in the row we're erasing
-    const auto hyperlinks = GetRowByOffset(0).GetHyperlinks();
-
-    if (!hyperlinks.empty())
-    {
-        // Move to unordered set so we can use hashed lookup of IDs instead of linear search.
-        // Only make it an unordered set now because set always heap allocates but vector
-        // doesn't when the set is empty (saving an allocation in the common case of no links.)
-        std::unordered_set<uint16_t> firstRowRefs{ hyperlinks.cbegin(), hyperlinks.cend() };
-
-        const auto total = TotalRowCount();
-        // Loop through all the rows in the buffer except the first row -
-        // we have found all hyperlink references in the first row and put them in refs,
-        // now we need to search the rest of the buffer (i.e. all the rows except the first)
-        // to see if those references are anywhere else
-        for (til::CoordType i = 1; i < total; ++i)
-        {
-            const auto nextRowRefs = GetRowByOffset(i).GetHyperlinks();
-            for (auto id : nextRowRefs)
-            {
-                if (firstRowRefs.find(id) != firstRowRefs.end())
-                {
-                    firstRowRefs.erase(id);
-                }
-            }
-            if (firstRowRefs.empty())
-            {
-                // No more hyperlink references left to search for, terminate early
-                break;
-            }
-        }
+    // Collect the hyperlink references of the old first row, which is about to be erased.
+    // Whether they're still referenced anywhere else in the buffer is only checked once half
+    // of the buffer has circled, in a single pass over all rows for all of the collected ids.
+    // Searching the entire buffer for each freed row instead would be quadratic for tools
+    // that emit a unique hyperlink on every line (ls, rg, compilers, etc.), whereas this
+    // scans 2 rows per freed row and bounds the obsolete entries to half a buffer's worth.
+    // Hyperlinks are stored in the attributes, which cold rows retain. There's no need to thaw them.
+    // The rows that ReflowLazily() skipped don't have their attributes yet, so we can't tell until they've been filled in.
+    if (_pendingReflow)
+    {
+        return;
+    }
 
-        // Now delete obsolete references from our map
-        for (auto hyperlinkReference : firstRowRefs)
+    for (const auto& run : _peekRowByOffset(0).Attributes().runs())
+    {
+        if (run.value.IsHyperlink())
         {
-            RemoveHyperlinkFromMap(hyperlinkReference);
+            _hyperlinkPruneCandidates.emplace_back(run.value.GetHyperlinkId());
         }
     }
+
+    ++_hyperlinkRowsFreed;
+    if (_hyperlinkRowsFreed >= std::max(1, TotalRowCount() / 2))
+    {
+        _SweepHyperlinks();
+    }
 }
 
-// Method Description:
-// - Update pos to be the position of the first character of the next word. This is used for accessibility
-// Arguments:
-// - pos - a til::point on the word you are currently on
-// - wordDelimiters - what characters are we considering for the separation of words
-// - limitOptional - (optional) the last possible position in the buffer that can be explored. This can be used to improve performance.
-// Return Value:
+// Removes all hyperlinks collected by _PruneHyperlinks() from the map,
+// which aren't referenced anymore by any row but the first one.
+void TextBuffer::_SweepHyperlinks()
+{
+    _hyperlinkRowsFreed = 0;
+
+    if (_hyperlinkPruneCandidates.empty())
+    {
+        return;
+    }
+
+    auto& candidates = _hyperlinkPruneCandidates;
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    // Remove every candidate that's still referenced. The first row is skipped,
+    // because IncrementCircularBuffer() is about to erase it.
+    const auto total = TotalRowCount();
+    for (til::CoordType i = 1; i < total && !candidates.empty(); ++i)
+    {
+        for (const auto& run : _peekRowByOffset(i).Attributes().runs())
+        {
+            if (run.value.IsHyperlink())
+            {
+                const auto it = std::lower_bound(candidates.begin(), candidates.end(), run.value.GetHyperlinkId());
+                if (it != candidates.end() && *it == run.value.GetHyperlinkId())
+                {
+                    candidates.erase(it);
+                }
+            }
+        }
+    }
+
+    // The current attributes may belong to a hyperlink that hasn't been written yet.
+    if (_currentAttributes.IsHyperlink())
+    {
+        const auto it = std::lower_bound(candidates.begin(), candidates.end(), _currentAttributes.GetHyperlinkId());
+        if (it != candidates.end() && *it == _currentAttributes.GetHyperlinkId())
+        {
+            candidates.erase(it);
+        }
+    }
+
+    // Now delete obsolete references from our maps. Unlike RemoveHyperlinkFromMap()
+    // this only needs a single pass over the custom ids for all of them.
+    if (!candidates.empty())
+    {
+        for (const auto id : candidates)
+        {
+            _hyperlinkMap.erase(id);
+        }
+        std::erase_if(_hyperlinkCustomIdMap, [&](const auto& pair) {
+            return std::binary_search(candidates.begin(), candidates.end(), pair.second);
+        });
+        _CompactHyperlinkUris();
+    }
+
+    candidates.clear();
+}
+
+// Rebuilds _hyperlinkUris once more than half of it belongs to removed hyperlinks.
+void TextBuffer::_CompactHyperlinkUris()
+{
+    size_t used = 0;
+    for (const auto& [id, uri] : _hyperlinkMap)
+    {
+        used += uri.length;
+    }
+
+    if (used >= _hyperlinkUris.size() / 2)
+    {
+        return;
+    }
+
+    std::wstring uris;
+    uris.reserve(used);
+    for (auto& [id, uri] : _hyperlinkMap)
+    {
+        const auto offset = uris.size();
+        uris.append(_hyperlinkUris, uri.offset, uri.length);
+        uri.offset = offset;
+    }
+    _hyperlinkUris = std::move(uris);
+}
+
+// Method Description:
+// - Update pos to be the position of the first character of the next word. This is used for accessibility
+// Arguments:
+// - pos - a til::point on the word you are currently on
+// - wordDelimiters - what characters are we considering for the separation of words
+// - limitOptional - (optional) the last possible position in the buffer that can be explored. This can be used to improve performance.
+// Return Value:
 // - true, if successfully updated pos. False, if we are unable to move (usually due to a buffer boundary)
 // - pos - The til::point for the first character on the "word" (inclusive)
 bool TextBuffer::MoveToNextWord(til::point& pos, const std::wstring_view wordDelimiters, std::optional<til::point> limitOptional) const
@@ -1895,18 +2967,111 @@ size_t TextBuffer::SpanLength(const til::point coordStart, const til::point coor
 std::wstring TextBuffer::GetPlainText(const til::point& start, const til::point& end) const
 {
     std::wstring text;
-    auto spanLength = SpanLength(start, end);
-    text.reserve(spanLength);
+    text.reserve(SpanLength(start, end));
+
+    // Instead of going cell by cell, this appends the text of each row's glyphs in bulk.
+    // ROW::GetText() skips the trailing halves of wide glyphs just like we need it to.
+    const auto size = GetSize();
+    const auto last = std::min(end.y, size.BottomInclusive());
+    for (auto y = std::max(start.y, 0); y <= last; ++y)
+    {
+        const auto columnBegin = y == start.y ? start.x : 0;
+        const auto columnEnd = y == end.y ? end.x + 1 : size.Width();
+        text.append(GetRowByOffset(y).GetText(columnBegin, columnEnd));
+    }
+
+    return text;
+}
+
+namespace
+{
+    // A row of a TextBuffer::CopyRequest.
+    struct CopyRow
+    {
+        const ROW* row = nullptr;
+        til::CoordType begin = 0;
+        til::CoordType end = 0;
+        // The selected text, with the trailing whitespace trimmed if requested.
+        std::wstring_view text;
+        // Whether the row gets a line break (if requested) and trimmed. Wrapped rows don't, unless formatWrappedRows is set.
+        bool formatted = false;
+    };
+
+    CopyRow getCopyRow(const TextBuffer& buffer, const TextBuffer::CopyRequest& req, const size_t index)
+    {
+        const auto& rect = til::at(req.selectionRects, index);
+        CopyRow copyRow;
+        copyRow.row = &buffer.GetRowByOffset(rect.top);
+        copyRow.begin = rect.left;
+        copyRow.end = rect.right + 1;
+        copyRow.text = copyRow.row->GetText(copyRow.begin, copyRow.end);
+        copyRow.formatted = req.formatWrappedRows || !copyRow.row->WasWrapForced();
+
+        if (req.trimTrailingWhitespace && copyRow.formatted)
+        {
+            const auto last = copyRow.text.find_last_not_of(UNICODE_SPACE);
+            copyRow.text = copyRow.text.substr(0, last == std::wstring_view::npos ? 0 : last + 1);
+        }
+
+        return copyRow;
+    }
+
+    // Calls func(text, attr) for each run of the row's selected text that has the same attributes.
+    template<typename Func>
+    void forEachRun(const CopyRow& copyRow, Func&& func)
+    {
+        til::CoordType x = 0;
+        for (const auto& run : copyRow.row->Attributes().runs())
+        {
+            const auto runBegin = x;
+            x += run.length;
+
+            if (x <= copyRow.begin)
+            {
+                continue;
+            }
+            if (runBegin >= copyRow.end)
+            {
+                break;
+            }
+
+            // The text of the run is a substring of copyRow.text, unless it's part of the trimmed whitespace.
+            const auto text = copyRow.row->GetText(std::max(runBegin, copyRow.begin), std::min(x, copyRow.end));
+#pragma warning(suppress : 26481) // Don't use pointer arithmetic. Use span instead (bounds.1).
+            const auto offset = gsl::narrow_cast<size_t>(text.data() - copyRow.text.data());
+            if (offset >= copyRow.text.size())
+            {
+                break;
+            }
+            if (!text.empty())
+            {
+                func(text.substr(0, copyRow.text.size() - offset), run.value);
+            }
+        }
+    }
+}
 
-    auto it = GetCellDataAt(start);
+// Routine Description:
+// - Retrieves the text of the given selection, just like concatenating the rows returned by GetText() would.
+// Arguments:
+// - req - the selection and how to format it.
+// Return Value:
+// - The text.
+std::wstring TextBuffer::GetPlainText(const CopyRequest& req) const
+{
+    std::wstring text;
+    const auto rows = req.selectionRects.size();
 
-    for (; it && spanLength > 0; ++it, --spanLength)
+    for (size_t i = 0; i < rows; i++)
     {
-        const auto& cell = *it;
-        if (cell.DbcsAttr() != DbcsAttribute::Trailing)
+        const auto copyRow = getCopyRow(*this, req, i);
+        text.append(copyRow.text);
+
+        // apply CR/LF to the end of the final string, unless we're the last line.
+        if (req.includeCRLF && copyRow.formatted && i < rows - 1)
         {
-            const auto chars = cell.Chars();
-            text.append(chars);
+            text.push_back(UNICODE_CARRIAGERETURN);
+            text.push_back(UNICODE_LINEFEED);
         }
     }
 
@@ -1914,213 +3079,193 @@ std::wstring TextBuffer::GetPlainText(const til::point& start, const til::point&
 }
 
 // Routine Description:
-// - Generates a CF_HTML compliant structure based on the passed in text and color data
+// - Copies the rows of the given selection into a new, inactive text buffer, one row per rectangle.
+// - The copy can then be serialized with GetPlainText(), GenHTML() and GenRTF() on another
+//   thread, without holding the console lock while doing so.
 // Arguments:
-// - rows - the text and color data we will format & encapsulate
-// - backgroundColor - default background color for characters, also used in padding
+// - selectionRects - the selection.
+// - snapshotRects - receives the selection, translated to the rows of the returned buffer.
+// Return Value:
+// - The copy of the rows.
+std::unique_ptr<TextBuffer> TextBuffer::SnapshotRows(const std::span<const til::inclusive_rect> selectionRects, std::vector<til::inclusive_rect>& snapshotRects) const
+{
+    const auto width = GetSize().Width();
+    const auto height = gsl::narrow<til::CoordType>(selectionRects.size());
+    auto snapshot = std::make_unique<TextBuffer>(til::size{ width, height }, _currentAttributes, _cursor.GetSize(), false, _renderer);
+
+    snapshotRects.clear();
+    snapshotRects.reserve(selectionRects.size());
+
+    for (til::CoordType y = 0; y < height; ++y)
+    {
+        const auto& rect = til::at(selectionRects, gsl::narrow_cast<size_t>(y));
+        const auto& row = GetRowByOffset(rect.top);
+        auto& dest = snapshot->GetRowByOffset(y);
+
+        til::CoordType begin = 0;
+        dest.CopyRangeFrom(0, til::CoordTypeMax, row, begin, til::CoordTypeMax);
+        dest.TransferAttributes(row.Attributes(), width);
+        dest.SetWrapForced(row.WasWrapForced());
+
+        snapshotRects.push_back({ rect.left, y, rect.right, y });
+    }
+
+    return snapshot;
+}
+
+// Routine Description:
+// - Generates a CF_HTML compliant structure for the given selection.
+// - The text is written in runs of the same color, directly from the rows of the buffer.
+// Arguments:
+// - req - the selection and how to format it.
+// - out - the HTML is appended to this string.
 // - fontHeightPoints - the unscaled font height
 // - fontFaceName - the name of the font used
-// Return Value:
-// - string containing the generated HTML
-std::string TextBuffer::GenHTML(const TextAndColor& rows,
-                                const int fontHeightPoints,
-                                const std::wstring_view fontFaceName,
-                                const COLORREF backgroundColor)
+// - backgroundColor - default background color for characters, also used in padding
+// - GetAttributeColors - function used to map TextAttribute to RGB COLORREFs.
+void TextBuffer::GenHTML(const CopyRequest& req,
+                         std::string& out,
+                         const int fontHeightPoints,
+                         const std::wstring_view fontFaceName,
+                         const COLORREF backgroundColor,
+                         const AttributeColorsFunc& GetAttributeColors) const
 {
+    const auto start = out.size();
+
     try
     {
-        std::ostringstream htmlBuilder;
+        const auto appendColor = [&](const COLORREF color) {
+            fmt::format_to(std::back_inserter(out), FMT_COMPILE("#{:02X}{:02X}{:02X}"), GetRValue(color), GetGValue(color), GetBValue(color));
+        };
+
+        // once filled with values, there will be exactly 157 bytes in the clipboard header.
+        // We reserve room for it upfront, since it contains the length of what follows.
+        constexpr size_t ClipboardHeaderSize = 157;
+        out.append(ClipboardHeaderSize, ' ');
 
         // First we have to add some standard
         // HTML boiler plate required for CF_HTML
         // as part of the HTML Clipboard format
-        const std::string htmlHeader =
-            "<!DOCTYPE><HTML><HEAD></HEAD><BODY>";
-        htmlBuilder << htmlHeader;
+        constexpr std::string_view htmlHeader = "<!DOCTYPE><HTML><HEAD></HEAD><BODY>";
+        out.append(htmlHeader);
 
-        htmlBuilder << "<!--StartFragment -->";
+        out.append("<!--StartFragment -->");
 
         // apply global style in div element
-        {
-            htmlBuilder << "<DIV STYLE=\"";
-            htmlBuilder << "display:inline-block;";
-            htmlBuilder << "white-space:pre;";
-
-            htmlBuilder << "background-color:";
-            htmlBuilder << Utils::ColorToHexString(backgroundColor);
-            htmlBuilder << ";";
-
-            htmlBuilder << "font-family:";
-            htmlBuilder << "'";
-            htmlBuilder << ConvertToA(CP_UTF8, fontFaceName);
-            htmlBuilder << "',";
-            // even with different font, add monospace as fallback
-            htmlBuilder << "monospace;";
-
-            htmlBuilder << "font-size:";
-            htmlBuilder << fontHeightPoints;
-            htmlBuilder << "pt;";
-
-            // note: MS Word doesn't support padding (in this way at least)
-            htmlBuilder << "padding:";
-            htmlBuilder << 4; // todo: customizable padding
-            htmlBuilder << "px;";
-
-            htmlBuilder << "\">";
-        }
+        out.append("<DIV STYLE=\"display:inline-block;white-space:pre;background-color:");
+        appendColor(backgroundColor);
+        out.append(";font-family:'");
+        out.append(ConvertToA(CP_UTF8, fontFaceName));
+        // even with different font, add monospace as fallback
+        out.append("',monospace;");
+        fmt::format_to(std::back_inserter(out), FMT_COMPILE("font-size:{}pt;"), fontHeightPoints);
+        // note: MS Word doesn't support padding (in this way at least)
+        out.append("padding:4px;"); // todo: customizable padding
+        out.append("\">");
 
         // copy text and info color from buffer
         auto hasWrittenAnyText = false;
-        std::optional<COLORREF> fgColor = std::nullopt;
-        std::optional<COLORREF> bkColor = std::nullopt;
-        for (size_t row = 0; row < rows.text.size(); row++)
+        std::optional<COLORREF> fgColor;
+        std::optional<COLORREF> bkColor;
+        std::string scratch;
+        for (size_t row = 0; row < req.selectionRects.size(); row++)
         {
-            size_t startOffset = 0;
-
             if (row != 0)
             {
-                htmlBuilder << "<BR>";
+                out.append("<BR>");
             }
 
-            for (size_t col = 0; col < rows.text.at(row).length(); col++)
-            {
-                const auto writeAccumulatedChars = [&](bool includeCurrent) {
-                    if (col >= startOffset)
-                    {
-                        const auto unescapedText = ConvertToA(CP_UTF8, std::wstring_view(rows.text.at(row)).substr(startOffset, col - startOffset + includeCurrent));
-                        for (const auto c : unescapedText)
-                        {
-                            switch (c)
-                            {
-                            case '<':
-                                htmlBuilder << "&lt;";
-                                break;
-                            case '>':
-                                htmlBuilder << "&gt;";
-                                break;
-                            case '&':
-                                htmlBuilder << "&amp;";
-                                break;
-                            default:
-                                htmlBuilder << c;
-                            }
-                        }
-
-                        startOffset = col;
-                    }
-                };
-
-                if (rows.text.at(row).at(col) == '\r' || rows.text.at(row).at(col) == '\n')
-                {
-                    // do not include \r nor \n as they don't have color attributes
-                    // and are not HTML friendly. For line break use '<BR>' instead.
-                    writeAccumulatedChars(false);
-                    break;
-                }
-
-                auto colorChanged = false;
-                if (!fgColor.has_value() || rows.FgAttr.at(row).at(col) != fgColor.value())
-                {
-                    fgColor = rows.FgAttr.at(row).at(col);
-                    colorChanged = true;
-                }
-
-                if (!bkColor.has_value() || rows.BkAttr.at(row).at(col) != bkColor.value())
-                {
-                    bkColor = rows.BkAttr.at(row).at(col);
-                    colorChanged = true;
-                }
-
-                if (colorChanged)
+            forEachRun(getCopyRow(*this, req, row), [&](const std::wstring_view& text, const TextAttribute& attr) {
+                const auto [fg, bk] = GetAttributeColors(attr);
+                if (fg != fgColor || bk != bkColor)
                 {
-                    writeAccumulatedChars(false);
+                    fgColor = fg;
+                    bkColor = bk;
 
                     if (hasWrittenAnyText)
                     {
-                        htmlBuilder << "</SPAN>";
+                        out.append("</SPAN>");
                     }
 
-                    htmlBuilder << "<SPAN STYLE=\"";
-                    htmlBuilder << "color:";
-                    htmlBuilder << Utils::ColorToHexString(fgColor.value());
-                    htmlBuilder << ";";
-                    htmlBuilder << "background-color:";
-                    htmlBuilder << Utils::ColorToHexString(bkColor.value());
-                    htmlBuilder << ";";
-                    htmlBuilder << "\">";
+                    out.append("<SPAN STYLE=\"color:");
+                    appendColor(fg);
+                    out.append(";background-color:");
+                    appendColor(bk);
+                    out.append(";\">");
                 }
 
                 hasWrittenAnyText = true;
-
-                // if this is the last character in the row, flush the whole row
-                if (col == rows.text.at(row).length() - 1)
-                {
-                    writeAccumulatedChars(true);
-                }
-            }
+                _AppendHTMLText(out, scratch, text);
+            });
         }
 
         if (hasWrittenAnyText)
         {
             // last opened span wasn't closed in loop above, so close it now
-            htmlBuilder << "</SPAN>";
+            out.append("</SPAN>");
         }
 
-        htmlBuilder << "</DIV>";
+        out.append("</DIV>");
 
-        htmlBuilder << "<!--EndFragment -->";
+        out.append("<!--EndFragment -->");
 
         constexpr std::string_view HtmlFooter = "</BODY></HTML>";
-        htmlBuilder << HtmlFooter;
-
-        // once filled with values, there will be exactly 157 bytes in the clipboard header
-        constexpr size_t ClipboardHeaderSize = 157;
+        out.append(HtmlFooter);
 
         // these values are byte offsets from start of clipboard
         const auto htmlStartPos = ClipboardHeaderSize;
-        const auto htmlEndPos = ClipboardHeaderSize + gsl::narrow<size_t>(htmlBuilder.tellp());
-        const auto fragStartPos = ClipboardHeaderSize + gsl::narrow<size_t>(htmlHeader.length());
+        const auto htmlEndPos = out.size() - start;
+        const auto fragStartPos = ClipboardHeaderSize + htmlHeader.length();
         const auto fragEndPos = htmlEndPos - HtmlFooter.length();
 
         // header required by HTML 0.9 format
-        std::ostringstream clipHeaderBuilder;
-        clipHeaderBuilder << "Version:0.9\r\n";
-        clipHeaderBuilder << std::setfill('0');
-        clipHeaderBuilder << "StartHTML:" << std::setw(10) << htmlStartPos << "\r\n";
-        clipHeaderBuilder << "EndHTML:" << std::setw(10) << htmlEndPos << "\r\n";
-        clipHeaderBuilder << "StartFragment:" << std::setw(10) << fragStartPos << "\r\n";
-        clipHeaderBuilder << "EndFragment:" << std::setw(10) << fragEndPos << "\r\n";
-        clipHeaderBuilder << "StartSelection:" << std::setw(10) << fragStartPos << "\r\n";
-        clipHeaderBuilder << "EndSelection:" << std::setw(10) << fragEndPos << "\r\n";
-
-        return clipHeaderBuilder.str() + htmlBuilder.str();
+        const auto clipHeader = fmt::format(FMT_COMPILE("Version:0.9\r\n"
+                                                        "StartHTML:{:010}\r\n"
+                                                        "EndHTML:{:010}\r\n"
+                                                        "StartFragment:{:010}\r\n"
+                                                        "EndFragment:{:010}\r\n"
+                                                        "StartSelection:{:010}\r\n"
+                                                        "EndSelection:{:010}\r\n"),
+                                            htmlStartPos,
+                                            htmlEndPos,
+                                            fragStartPos,
+                                            fragEndPos,
+                                            fragStartPos,
+                                            fragEndPos);
+        THROW_HR_IF(E_UNEXPECTED, clipHeader.size() != ClipboardHeaderSize);
+        out.replace(start, ClipboardHeaderSize, clipHeader);
     }
     catch (...)
     {
         LOG_HR(wil::ResultFromCaughtException());
-        return {};
+        out.resize(start);
     }
 }
 
 // Routine Description:
-// - Generates an RTF document based on the passed in text and color data
+// - Generates an RTF document for the given selection.
 //   RTF 1.5 Spec: https://www.biblioscape.com/rtf15_spec.htm
+// - The text is written in runs of the same color, directly from the rows of the buffer.
 // Arguments:
-// - rows - the text and color data we will format & encapsulate
-// - backgroundColor - default background color for characters, also used in padding
+// - req - the selection and how to format it.
+// - out - the RTF is appended to this string.
 // - fontHeightPoints - the unscaled font height
 // - fontFaceName - the name of the font used
-// - htmlTitle - value used in title tag of html header. Used to name the application
-// Return Value:
-// - string containing the generated RTF
-std::string TextBuffer::GenRTF(const TextAndColor& rows, const int fontHeightPoints, const std::wstring_view fontFaceName, const COLORREF backgroundColor)
+// - backgroundColor - default background color for characters, also used in padding
+// - GetAttributeColors - function used to map TextAttribute to RGB COLORREFs.
+void TextBuffer::GenRTF(const CopyRequest& req,
+                        std::string& out,
+                        const int fontHeightPoints,
+                        const std::wstring_view fontFaceName,
+                        const COLORREF backgroundColor,
+                        const AttributeColorsFunc& GetAttributeColors) const
 {
+    const auto start = out.size();
+
     try
     {
-        std::ostringstream rtfBuilder;
-
         // start rtf
-        rtfBuilder << "{";
+        out.append("{");
 
         // Standard RTF header.
         // This is similar to the header generated by WordPad.
@@ -2128,10 +3273,12 @@ std::string TextBuffer::GenRTF(const TextAndColor& rows, const int fontHeightPoi
         // \ansicpg1252 - represents the ANSI code page which is used to perform the Unicode to ANSI conversion when writing RTF text
         // \deff0 - specifies that the default font for the document is the one at index 0 in the font table
         // \nouicompat - ?
-        rtfBuilder << "\\rtf1\\ansi\\ansicpg1252\\deff0\\nouicompat";
+        out.append("\\rtf1\\ansi\\ansicpg1252\\deff0\\nouicompat");
 
         // font table
-        rtfBuilder << "{\\fonttbl{\\f0\\fmodern\\fcharset0 " << ConvertToA(CP_UTF8, fontFaceName) << ";}}";
+        out.append("{\\fonttbl{\\f0\\fmodern\\fcharset0 ");
+        out.append(ConvertToA(CP_UTF8, fontFaceName));
+        out.append(";}}");
 
         // map to keep track of colors:
         // keys are colors represented by COLORREF
@@ -2139,143 +3286,97 @@ std::string TextBuffer::GenRTF(const TextAndColor& rows, const int fontHeightPoi
         std::unordered_map<COLORREF, int> colorMap;
         auto nextColorIndex = 1; // leave 0 for the default color and start from 1.
 
-        // RTF color table
-        std::ostringstream colorTableBuilder;
-        colorTableBuilder << "{\\colortbl ;";
-        colorTableBuilder << "\\red" << static_cast<int>(GetRValue(backgroundColor))
-                          << "\\green" << static_cast<int>(GetGValue(backgroundColor))
-                          << "\\blue" << static_cast<int>(GetBValue(backgroundColor))
-                          << ";";
-        colorMap[backgroundColor] = nextColorIndex++;
+        // RTF color table. It precedes the content, but we only know all the colors once we're done with it.
+        // We insert it afterwards, which is much cheaper than building the content in a separate string.
+        std::string colorTable{ "{\\colortbl ;" };
+        const auto colorIndex = [&](const COLORREF color) {
+            const auto [it, inserted] = colorMap.emplace(color, nextColorIndex);
+            if (inserted)
+            {
+                // color not present in the map, so add it
+                fmt::format_to(std::back_inserter(colorTable), FMT_COMPILE("\\red{}\\green{}\\blue{};"), GetRValue(color), GetGValue(color), GetBValue(color));
+                nextColorIndex++;
+            }
+            return it->second;
+        };
+        colorIndex(backgroundColor);
+        const auto colorTablePos = out.size();
 
         // content
-        std::ostringstream contentBuilder;
-        contentBuilder << "\\viewkind4\\uc4";
+        out.append("\\viewkind4\\uc4");
 
         // paragraph styles
         // \fs specifies font size in half-points i.e. \fs20 results in a font size
         // of 10 pts. That's why, font size is multiplied by 2 here.
-        contentBuilder << "\\pard\\slmult1\\f0\\fs" << std::to_string(2 * fontHeightPoints)
-                       << "\\highlight1"
-                       << " ";
+        fmt::format_to(std::back_inserter(out), FMT_COMPILE("\\pard\\slmult1\\f0\\fs{}\\highlight1 "), 2 * fontHeightPoints);
 
-        std::optional<COLORREF> fgColor = std::nullopt;
-        std::optional<COLORREF> bkColor = std::nullopt;
-        for (size_t row = 0; row < rows.text.size(); ++row)
+        std::optional<COLORREF> fgColor;
+        std::optional<COLORREF> bkColor;
+        for (size_t row = 0; row < req.selectionRects.size(); ++row)
         {
-            size_t startOffset = 0;
-
             if (row != 0)
             {
-                contentBuilder << "\\line "; // new line
+                out.append("\\line "); // new line
             }
 
-            for (size_t col = 0; col < rows.text.at(row).length(); ++col)
-            {
-                const auto writeAccumulatedChars = [&](bool includeCurrent) {
-                    if (col >= startOffset)
-                    {
-                        const auto text = std::wstring_view{ rows.text.at(row) }.substr(startOffset, col - startOffset + includeCurrent);
-                        _AppendRTFText(contentBuilder, text);
-
-                        startOffset = col;
-                    }
-                };
-
-                if (rows.text.at(row).at(col) == '\r' || rows.text.at(row).at(col) == '\n')
-                {
-                    // do not include \r nor \n as they don't have color attributes.
-                    // For line break use \line instead.
-                    writeAccumulatedChars(false);
-                    break;
-                }
-
-                auto colorChanged = false;
-                if (!fgColor.has_value() || rows.FgAttr.at(row).at(col) != fgColor.value())
+            forEachRun(getCopyRow(*this, req, row), [&](const std::wstring_view& text, const TextAttribute& attr) {
+                const auto [fg, bk] = GetAttributeColors(attr);
+                if (fg != fgColor || bk != bkColor)
                 {
-                    fgColor = rows.FgAttr.at(row).at(col);
-                    colorChanged = true;
-                }
-
-                if (!bkColor.has_value() || rows.BkAttr.at(row).at(col) != bkColor.value())
-                {
-                    bkColor = rows.BkAttr.at(row).at(col);
-                    colorChanged = true;
-                }
-
-                if (colorChanged)
-                {
-                    writeAccumulatedChars(false);
-
-                    auto bkColorIndex = 0;
-                    if (colorMap.find(bkColor.value()) != colorMap.end())
-                    {
-                        // color already exists in the map, just retrieve the index
-                        bkColorIndex = colorMap[bkColor.value()];
-                    }
-                    else
-                    {
-                        // color not present in the map, so add it
-                        colorTableBuilder << "\\red" << static_cast<int>(GetRValue(bkColor.value()))
-                                          << "\\green" << static_cast<int>(GetGValue(bkColor.value()))
-                                          << "\\blue" << static_cast<int>(GetBValue(bkColor.value()))
-                                          << ";";
-                        colorMap[bkColor.value()] = nextColorIndex;
-                        bkColorIndex = nextColorIndex++;
-                    }
-
-                    auto fgColorIndex = 0;
-                    if (colorMap.find(fgColor.value()) != colorMap.end())
-                    {
-                        // color already exists in the map, just retrieve the index
-                        fgColorIndex = colorMap[fgColor.value()];
-                    }
-                    else
-                    {
-                        // color not present in the map, so add it
-                        colorTableBuilder << "\\red" << static_cast<int>(GetRValue(fgColor.value()))
-                                          << "\\green" << static_cast<int>(GetGValue(fgColor.value()))
-                                          << "\\blue" << static_cast<int>(GetBValue(fgColor.value()))
-                                          << ";";
-                        colorMap[fgColor.value()] = nextColorIndex;
-                        fgColorIndex = nextColorIndex++;
-                    }
+                    fgColor = fg;
+                    bkColor = bk;
 
-                    contentBuilder << "\\highlight" << bkColorIndex
-                                   << "\\cf" << fgColorIndex
-                                   << " ";
+                    const auto bkColorIndex = colorIndex(bk);
+                    const auto fgColorIndex = colorIndex(fg);
+                    fmt::format_to(std::back_inserter(out), FMT_COMPILE("\\highlight{}\\cf{} "), bkColorIndex, fgColorIndex);
                 }
 
-                // if this is the last character in the row, flush the whole row
-                if (col == rows.text.at(row).length() - 1)
-                {
-                    writeAccumulatedChars(true);
-                }
-            }
+                _AppendRTFText(out, text);
+            });
         }
 
         // end colortbl
-        colorTableBuilder << "}";
+        colorTable.append("}");
 
         // add color table to the final RTF
-        rtfBuilder << colorTableBuilder.str();
-
-        // add the text content to the final RTF
-        rtfBuilder << contentBuilder.str();
+        out.insert(colorTablePos, colorTable);
 
         // end rtf
-        rtfBuilder << "}";
-
-        return rtfBuilder.str();
+        out.append("}");
     }
     catch (...)
     {
         LOG_HR(wil::ResultFromCaughtException());
-        return {};
+        out.resize(start);
+    }
+}
+
+// Appends the text to the HTML, converted to UTF-8 and with the characters that have a meaning in HTML escaped.
+// scratch is used for the conversion, so that it doesn't need to allocate for every run of text.
+void TextBuffer::_AppendHTMLText(std::string& out, std::string& scratch, const std::wstring_view& text)
+{
+    THROW_IF_FAILED(til::u16u8(text, scratch));
+
+    for (const auto c : scratch)
+    {
+        switch (c)
+        {
+        case '<':
+            out.append("&lt;");
+            break;
+        case '>':
+            out.append("&gt;");
+            break;
+        case '&':
+            out.append("&amp;");
+            break;
+        default:
+            out.push_back(c);
+        }
     }
 }
 
-void TextBuffer::_AppendRTFText(std::ostringstream& contentBuilder, const std::wstring_view& text)
+void TextBuffer::_AppendRTFText(std::string& out, const std::wstring_view& text)
 {
     for (const auto codeUnit : text)
     {
@@ -2286,261 +3387,775 @@ void TextBuffer::_AppendRTFText(std::ostringstream& contentBuilder, const std::w
             case L'\\':
             case L'{':
             case L'}':
-                contentBuilder << "\\" << gsl::narrow<char>(codeUnit);
+                out.push_back('\\');
+                out.push_back(gsl::narrow<char>(codeUnit));
                 break;
             default:
-                contentBuilder << gsl::narrow<char>(codeUnit);
+                out.push_back(gsl::narrow<char>(codeUnit));
             }
         }
         else
         {
             // Windows uses unsigned wchar_t - RTF uses signed ones.
-            contentBuilder << "\\u" << std::to_string(til::bit_cast<int16_t>(codeUnit)) << "?";
+            fmt::format_to(std::back_inserter(out), FMT_COMPILE("\\u{}?"), til::bit_cast<int16_t>(codeUnit));
         }
     }
 }
 
-// Function Description:
-// - Reflow the contents from the old buffer into the new buffer. The new buffer
-//   can have different dimensions than the old buffer. If it does, then this
-//   function will attempt to maintain the logical contents of the old buffer,
-//   by continuing wrapped lines onto the next line in the new buffer.
-// Arguments:
-// - oldBuffer - the text buffer to copy the contents FROM
-// - newBuffer - the text buffer to copy the contents TO
-// - lastCharacterViewport - Optional. If the caller knows that the last
-//   nonspace character is in a particular Viewport, the caller can provide this
-//   parameter as an optimization, as opposed to searching the entire buffer.
-// - positionInfo - Optional. The caller can provide a pair of rows in this
-//   parameter and we'll calculate the position of the _end_ of those rows in
-//   the new buffer. The rows's new value is placed back into this parameter.
-// Return Value:
-// - S_OK if we successfully copied the contents to the new buffer, otherwise an appropriate HRESULT.
-HRESULT TextBuffer::Reflow(TextBuffer& oldBuffer,
-                           TextBuffer& newBuffer,
-                           const std::optional<Viewport> lastCharacterViewport,
-                           std::optional<std::reference_wrapper<PositionInformation>> positionInfo)
+namespace
 {
-    const auto& oldCursor = oldBuffer.GetCursor();
-    auto& newCursor = newBuffer.GetCursor();
+    // Below this many rows Reflow() isn't worth spreading across multiple threads.
+    constexpr til::CoordType ReflowParallelMinRows = 1024;
 
-    // We need to save the old cursor position so that we can
-    // place the new cursor back on the equivalent character in
-    // the new buffer.
-    const auto cOldCursorPos = oldCursor.GetPosition();
-    const auto cOldLastChar = oldBuffer.GetLastNonSpaceCharacter(lastCharacterViewport);
-
-    const auto cOldRowsTotal = cOldLastChar.y + 1;
-
-    til::point cNewCursorPos;
-    auto fFoundCursorPos = false;
-    auto foundOldMutable = false;
-    auto foundOldVisible = false;
-    auto hr = S_OK;
-    // Loop through all the rows of the old buffer and reprint them into the new buffer
-    til::CoordType iOldRow = 0;
-    for (; iOldRow < cOldRowsTotal; iOldRow++)
+    // An old row, as seen by Reflow().
+    struct ReflowSource
     {
-        // Fetch the row and its "right" which is the last printable character.
-        const auto& row = oldBuffer.GetRowByOffset(iOldRow);
-        const auto cOldColsTotal = oldBuffer.GetLineWidth(iOldRow);
-        auto iRight = row.MeasureRight();
-
-        // If we're starting a new row, try and preserve the line rendition
-        // from the row in the original buffer.
-        const auto newBufferPos = newCursor.GetPosition();
-        if (newBufferPos.x == 0)
-        {
-            auto& newRow = newBuffer.GetRowByOffset(newBufferPos.y);
-            newRow.SetLineRendition(row.GetLineRendition());
-        }
-
-        // There is a special case here. If the row has a "wrap"
-        // flag on it, but the right isn't equal to the width (one
-        // index past the final valid index in the row) then there
-        // were a bunch trailing of spaces in the row.
-        // (But the measuring functions for each row Left/Right do
-        // not count spaces as "displayable" so they're not
-        // included.)
-        // As such, adjust the "right" to be the width of the row
-        // to capture all these spaces
-        if (row.WasWrapForced())
-        {
-            iRight = cOldColsTotal;
-
-            // And a combined special case.
-            // If we wrapped off the end of the row by adding a
-            // piece of padding because of a double byte LEADING
-            // character, then remove one from the "right" to
-            // leave this padding out of the copy process.
-            if (row.WasDoubleBytePadded())
+        const ROW* row = nullptr;
+        // The buffer the row belongs to and its position in it. This isn't necessarily the old buffer,
+        // since lines that ReflowLazily() left pending are taken from the buffer they would've been copied from.
+        TextBuffer* buffer = nullptr;
+        til::CoordType y = 0;
+        // The width of the row, taking its line rendition into account.
+        til::CoordType width = 0;
+        // The column past the last one that gets copied.
+        til::CoordType right = 0;
+
+        // Calculates width and right. This doesn't require the row to be thawed.
+        void Measure() noexcept
+        {
+            width = row->LineRenditionColumns();
+            right = row->MeasureRight();
+
+            // There is a special case here. If the row has a "wrap"
+            // flag on it, but the right isn't equal to the width (one
+            // index past the final valid index in the row) then there
+            // were a bunch trailing of spaces in the row.
+            // (But the measuring functions for each row Left/Right do
+            // not count spaces as "displayable" so they're not
+            // included.)
+            // As such, adjust the "right" to be the width of the row
+            // to capture all these spaces
+            if (row->WasWrapForced())
             {
-                iRight--;
+                right = width;
+
+                // And a combined special case.
+                // If we wrapped off the end of the row by adding a
+                // piece of padding because of a double byte LEADING
+                // character, then remove one from the "right" to
+                // leave this padding out of the copy process.
+                if (row->WasDoubleBytePadded())
+                {
+                    right--;
+                }
             }
         }
 
-        // Loop through every character in the current row (up to
-        // the "right" boundary, which is one past the final valid
-        // character)
-        til::CoordType iOldCol = 0;
-        const auto copyRight = iRight;
-        for (; iOldCol < copyRight; iOldCol++)
+        // If we didn't have a full row to copy, a new line is started in the new buffer.
+        // Only if we were not forced to wrap, since the existing line break was
+        // then only because we ran out of space.
+        bool EndsLine() const noexcept
         {
-            if (iOldCol == cOldCursorPos.x && iOldRow == cOldCursorPos.y)
-            {
-                cNewCursorPos = newCursor.GetPosition();
-                fFoundCursorPos = true;
-            }
+            return right < width && !row->WasWrapForced();
+        }
+    };
 
-            try
+    // A run of old rows that ends in a hard line break (see ReflowSource::EndsLine()).
+    struct ReflowGroup
+    {
+        til::CoordType begin = 0;
+        til::CoordType end = 0;
+        // The new row the group starts in, not accounting for any rows that scrolled out of the new buffer.
+        til::CoordType first = 0;
+        // Whether ReflowLazily() leaves the group to be copied later on.
+        bool pending = false;
+        // The remaining members are relative to the first row and calculated by reflowGroup().
+        // The number of new rows until the next group starts.
+        til::CoordType height = 0;
+        // The position of the cursor after copying the group.
+        til::point position;
+        // The new position of the old cursor, if the group contains it.
+        std::optional<til::point> cursor;
+        // The new position of the end of the rows given by ReflowLayout::mutableRow/visibleRow.
+        std::optional<til::CoordType> mutableViewportTop;
+        std::optional<til::CoordType> visibleViewportTop;
+    };
+
+    struct ReflowLayout
+    {
+        std::span<const ReflowSource> sources;
+        til::CoordType newWidth = 0;
+        til::CoordType newHeight = 0;
+        til::point oldCursor;
+        til::CoordType lastRow = 0;
+        til::CoordType mutableRow = -1;
+        til::CoordType visibleRow = -1;
+    };
+
+    // Routine Description:
+    // - Lays out the old rows of a group in the new buffer, exactly like inserting them one cell at a time
+    //   with TextBuffer::InsertCharacter() would, except that runs of cells are copied in one go.
+    // Arguments:
+    // - layout - the parameters of the reflow.
+    // - group - the group to lay out. Its relative positions are updated.
+    // - newRows - the rows of the new buffer. If empty, the group is only being measured.
+    // - offset - the index into newRows of the group's first row. Rows outside of newRows are skipped.
+    void reflowGroup(const ReflowLayout& layout, ReflowGroup& group, const std::span<ROW* const> newRows, const til::CoordType offset)
+    {
+        til::point pos;
+        auto lineRendition = LineRendition::SingleWidth;
+
+        const auto target = [&]() noexcept -> ROW* {
+            const auto y = offset + pos.y;
+            return y >= 0 && gsl::narrow_cast<size_t>(y) < newRows.size() ? til::at(newRows, y) : nullptr;
+        };
+        const auto lineWidth = [&]() noexcept {
+            const auto scale = lineRendition != LineRendition::SingleWidth ? 1 : 0;
+            return std::max(layout.newWidth >> scale, 1);
+        };
+        const auto wrap = [&](const bool padded) noexcept {
+            if (const auto row = target())
             {
-                // TODO: MSFT: 19446208 - this should just use an iterator and the inserter...
-                const auto glyph = row.GlyphAt(iOldCol);
-                const auto dbcsAttr = row.DbcsAttrAt(iOldCol);
-                const auto textAttr = row.GetAttrByColumn(iOldCol);
-
-                if (!newBuffer.InsertCharacter(glyph, dbcsAttr, textAttr))
+                if (padded)
                 {
-                    hr = E_OUTOFMEMORY;
-                    break;
+                    row->SetDoubleBytePadded(true);
                 }
+                row->SetWrapForced(true);
             }
-            CATCH_RETURN();
-        }
-
-        // GH#32: Copy the attributes from the rest of the row into this new buffer.
-        // From where we are in the old buffer, to the end of the row, copy the
-        // remaining attributes.
-        // - if the old buffer is smaller than the new buffer, then just copy
-        //   what we have, as it was. We already copied all _text_ with colors,
-        //   but it's possible for someone to just put some color into the
-        //   buffer to the right of that without any text (as just spaces). The
-        //   buffer looks weird to the user when we resize and it starts losing
-        //   those colors, so we need to copy them over too... as long as there
-        //   is space. The last attr in the row will be extended to the end of
-        //   the row in the new buffer.
-        // - if the old buffer is WIDER, than we might have wrapped onto a new
-        //   line. Use the cursor's position's Y so that we know where the new
-        //   row is, and start writing at the cursor position. Again, the attr
-        //   in the last column of the old row will be extended to the end of the
-        //   row that the text was flowed onto.
-        //   - if the text in the old buffer didn't actually fill the whole
-        //     line in the new buffer, then we didn't wrap. That's fine. just
-        //     copy attributes from the old row till the end of the new row, and
-        //     move on.
-        const auto newRowY = newCursor.GetPosition().y;
-        auto& newRow = newBuffer.GetRowByOffset(newRowY);
-        auto newAttrColumn = newCursor.GetPosition().x;
-        const auto newWidth = newBuffer.GetLineWidth(newRowY);
-        // Stop when we get to the end of the buffer width, or the new position
-        // for inserting an attr would be past the right of the new buffer.
-        for (auto copyAttrCol = iOldCol;
-             copyAttrCol < cOldColsTotal && newAttrColumn < newWidth;
-             copyAttrCol++, newAttrColumn++)
-        {
-            try
+            pos = { 0, pos.y + 1 };
+            lineRendition = LineRendition::SingleWidth;
+        };
+        // Copies the attributes of the old columns [begin, end) to the cursor position. Just like the repeated
+        // calls to ROW::SetAttrToEnd() by InsertCharacter(), the last one is extended to the end of the row.
+        const auto copyAttributes = [&](const ROW& oldRow, const til::CoordType begin, const til::CoordType end) {
+            const auto row = target();
+            if (!row || begin >= end)
             {
-                // TODO: MSFT: 19446208 - this should just use an iterator and the inserter...
-                const auto textAttr = row.GetAttrByColumn(copyAttrCol);
-                if (!newRow.SetAttrToEnd(newAttrColumn, textAttr))
-                {
-                    break;
-                }
+                return;
             }
-            CATCH_LOG(); // Not worth dying over.
-        }
+            auto attributes = oldRow.Attributes().slice(gsl::narrow_cast<uint16_t>(begin), gsl::narrow_cast<uint16_t>(end));
+            attributes.resize_trailing_extent(gsl::narrow_cast<uint16_t>(row->size() - pos.x));
+            row->Attributes().replace(gsl::narrow_cast<uint16_t>(pos.x), row->size(), attributes);
+        };
 
-        // If we found the old row that the caller was interested in, set the
-        // out value of that parameter to the cursor's current Y position (the
-        // new location of the _end_ of that row in the buffer).
-        if (positionInfo.has_value())
+        for (auto y = group.begin; y < group.end; ++y)
         {
-            if (!foundOldMutable)
+            const auto& source = til::at(layout.sources, y);
+            const auto& oldRow = *source.row;
+            const auto cursorX = y == layout.oldCursor.y ? layout.oldCursor.x : -1;
+
+            // If we're starting a new row, try and preserve the line rendition
+            // from the row in the original buffer.
+            if (pos.x == 0)
             {
-                if (iOldRow >= positionInfo.value().get().mutableViewportTop)
+                lineRendition = oldRow.GetLineRendition();
+                if (const auto row = target())
                 {
-                    positionInfo.value().get().mutableViewportTop = newCursor.GetPosition().y;
-                    foundOldMutable = true;
+                    row->SetLineRendition(lineRendition);
                 }
             }
 
-            if (!foundOldVisible)
+            for (til::CoordType x = 0; x < source.right;)
             {
-                if (iOldRow >= positionInfo.value().get().visibleViewportTop)
+                const auto available = lineWidth() - pos.x;
+                auto advance = std::min(source.right - x, available);
+                auto consumed = advance;
+                auto padded = false;
+
+                // If a double byte LEADING character would end up in the last column, we add a piece of padding
+                // and move it to the next row instead. Unless it wouldn't fit into that one either.
+                if (advance == available && oldRow.DbcsAttrAt(x + advance - 1) == DbcsAttribute::Leading)
                 {
-                    positionInfo.value().get().visibleViewportTop = newCursor.GetPosition().y;
-                    foundOldVisible = true;
+                    if (advance > 1 || pos.x > 0)
+                    {
+                        --advance;
+                        --consumed;
+                        padded = true;
+                    }
+                    else
+                    {
+                        consumed = std::min(2, source.right - x);
+                    }
                 }
-            }
-        }
 
-        if (SUCCEEDED(hr))
-        {
-            // If we didn't have a full row to copy, insert a new
-            // line into the new buffer.
-            // Only do so if we were not forced to wrap. If we did
-            // force a word wrap, then the existing line break was
-            // only because we ran out of space.
-            if (iRight < cOldColsTotal && !row.WasWrapForced())
-            {
-                if (!fFoundCursorPos && (iRight == cOldCursorPos.x && iOldRow == cOldCursorPos.y))
+                if (!group.cursor && cursorX >= x && cursorX < x + consumed + (padded ? 1 : 0))
                 {
-                    cNewCursorPos = newCursor.GetPosition();
-                    fFoundCursorPos = true;
+                    group.cursor = { std::min(pos.x + cursorX - x, lineWidth() - 1), pos.y };
                 }
-                // Only do this if it's not the final line in the buffer.
-                // On the final line, we want the cursor to sit
-                // where it is done printing for the cursor
-                // adjustment to follow.
-                if (iOldRow < cOldRowsTotal - 1)
+
+                if (const auto row = target(); row && advance > 0)
                 {
-                    hr = newBuffer.NewlineCursor() ? hr : E_OUTOFMEMORY;
+                    auto begin = x;
+                    row->CopyRangeFrom(pos.x, pos.x + advance, oldRow, begin, x + consumed);
+                    copyAttributes(oldRow, x, x + consumed);
                 }
-                else
+
+                x += consumed;
+                pos.x += advance;
+
+                if (padded || pos.x >= lineWidth())
                 {
-                    // If we are on the final line of the buffer, we have one more check.
-                    // We got into this code path because we are at the right most column of a row in the old buffer
-                    // that had a hard return (no wrap was forced).
-                    // However, as we're inserting, the old row might have just barely fit into the new buffer and
-                    // caused a new soft return (wrap was forced) putting the cursor at x=0 on the line just below.
-                    // We need to preserve the memory of the hard return at this point by inserting one additional
-                    // hard newline, otherwise we've lost that information.
-                    // We only do this when the cursor has just barely poured over onto the next line so the hard return
-                    // isn't covered by the soft one.
-                    // e.g.
-                    // The old line was:
-                    // |aaaaaaaaaaaaaaaaaaa | with no wrap which means there was a newline after that final a.
-                    // The cursor was here ^
-                    // And the new line will be:
-                    // |aaaaaaaaaaaaaaaaaaa| and show a wrap at the end
-                    // |                   |
-                    //  ^ and the cursor is now there.
-                    // If we leave it like this, we've lost the newline information.
-                    // So we insert one more newline so a continued reflow of this buffer by resizing larger will
-                    // continue to look as the original output intended with the newline data.
-                    // After this fix, it looks like this:
-                    // |aaaaaaaaaaaaaaaaaaa| no wrap at the end (preserved hard newline)
-                    // |                   |
-                    //  ^ and the cursor is now here.
-                    const auto coordNewCursor = newCursor.GetPosition();
-                    if (coordNewCursor.x == 0 && coordNewCursor.y > 0)
-                    {
-                        if (newBuffer.GetRowByOffset(coordNewCursor.y - 1).WasWrapForced())
-                        {
-                            hr = newBuffer.NewlineCursor() ? hr : E_OUTOFMEMORY;
-                        }
-                    }
+                    wrap(padded);
+                }
+            }
+
+            // GH#32: Copy the attributes from the rest of the row into this new buffer.
+            // From where we are in the old buffer, to the end of the row, copy the
+            // remaining attributes.
+            // - if the old buffer is smaller than the new buffer, then just copy
+            //   what we have, as it was. We already copied all _text_ with colors,
+            //   but it's possible for someone to just put some color into the
+            //   buffer to the right of that without any text (as just spaces). The
+            //   buffer looks weird to the user when we resize and it starts losing
+            //   those colors, so we need to copy them over too... as long as there
+            //   is space. The last attr in the row will be extended to the end of
+            //   the row in the new buffer.
+            // - if the old buffer is WIDER, than we might have wrapped onto a new
+            //   line. Use the cursor's position's Y so that we know where the new
+            //   row is, and start writing at the cursor position. Again, the attr
+            //   in the last column of the old row will be extended to the end of the
+            //   row that the text was flowed onto.
+            //   - if the text in the old buffer didn't actually fill the whole
+            //     line in the new buffer, then we didn't wrap. That's fine. just
+            //     copy attributes from the old row till the end of the new row, and
+            //     move on.
+            copyAttributes(oldRow, source.right, std::min(source.width, source.right + lineWidth() - pos.x));
+
+            if (y == layout.mutableRow)
+            {
+                group.mutableViewportTop = pos.y;
+            }
+            if (y == layout.visibleRow)
+            {
+                group.visibleViewportTop = pos.y;
+            }
+
+            if (source.EndsLine())
+            {
+                if (!group.cursor && cursorX == source.right)
+                {
+                    group.cursor = pos;
+                }
+                // Only do this if it's not the final line in the buffer.
+                // On the final line, we want the cursor to sit
+                // where it is done printing for the cursor
+                // adjustment to follow.
+                if (y < layout.lastRow)
+                {
+                    pos = { 0, pos.y + 1 };
+                }
+                // If we are on the final line of the buffer, we have one more check.
+                // We got into this code path because we are at the right most column of a row in the old buffer
+                // that had a hard return (no wrap was forced).
+                // However, as we're inserting, the old row might have just barely fit into the new buffer and
+                // caused a new soft return (wrap was forced) putting the cursor at x=0 on the line just below.
+                // We need to preserve the memory of the hard return at this point by inserting one additional
+                // hard newline, otherwise we've lost that information.
+                // e.g.
+                // The old line was:
+                // |aaaaaaaaaaaaaaaaaaa | with no wrap which means there was a newline after that final a.
+                // The cursor was here ^
+                // And the new line will be:
+                // |aaaaaaaaaaaaaaaaaaa| and show a wrap at the end
+                // |                   |
+                //  ^ and the cursor is now there.
+                // If we leave it like this, we've lost the newline information.
+                // So we insert one more newline so a continued reflow of this buffer by resizing larger will
+                // continue to look as the original output intended with the newline data.
+                // After this fix, it looks like this:
+                // |aaaaaaaaaaaaaaaaaaa| no wrap at the end (preserved hard newline)
+                // |                   |
+                //  ^ and the cursor is now here.
+                // Within a group we only ever get to the next row by wrapping, so the row above is wrapped if there is one.
+                // (A buffer that's only 1 row tall can't have a row above the cursor.)
+                else if (pos.x == 0 && pos.y > 0 && layout.newHeight > 1)
+                {
+                    pos = { 0, pos.y + 1 };
+                }
+            }
+        }
+
+        group.height = pos.y;
+        group.position = pos;
+    }
+}
+
+// Function Description:
+// - Reflow the contents from the old buffer into the new buffer. The new buffer
+//   can have different dimensions than the old buffer. If it does, then this
+//   function will attempt to maintain the logical contents of the old buffer,
+//   by continuing wrapped lines onto the next line in the new buffer.
+// Arguments:
+// - oldBuffer - the text buffer to copy the contents FROM
+// - newBuffer - the text buffer to copy the contents TO
+// - lastCharacterViewport - Optional. If the caller knows that the last
+//   nonspace character is in a particular Viewport, the caller can provide this
+//   parameter as an optimization, as opposed to searching the entire buffer.
+// - positionInfo - Optional. The caller can provide a pair of rows in this
+//   parameter and we'll calculate the position of the _end_ of those rows in
+//   the new buffer. The rows's new value is placed back into this parameter.
+// Return Value:
+// - S_OK if we successfully copied the contents to the new buffer, otherwise an appropriate HRESULT.
+HRESULT TextBuffer::Reflow(TextBuffer& oldBuffer,
+                           TextBuffer& newBuffer,
+                           const std::optional<Viewport> lastCharacterViewport,
+                           std::optional<std::reference_wrapper<PositionInformation>> positionInfo)
+{
+    return _Reflow(oldBuffer, newBuffer, lastCharacterViewport, positionInfo, nullptr);
+}
+
+// Function Description:
+// - Same as Reflow(), except that only the lines from the top of the viewports given by positionInfo
+//   (or the cursor, if it's above them) to the end of the text are copied right away. All lines above
+//   are left pending and only get copied once they're accessed or by FinishPendingReflow().
+//   This way resizing the window doesn't get any slower the more scrollback there is.
+// - oldBuffer is kept alive until all of its lines have been copied. If it has pending lines of its own,
+//   they're taken from the buffer they would've been copied from instead, so that resizing repeatedly
+//   doesn't result in a chain of buffers.
+// Arguments:
+// - See Reflow().
+// Return Value:
+// - S_OK if we successfully copied the contents to the new buffer, otherwise an appropriate HRESULT.
+HRESULT TextBuffer::ReflowLazily(const std::shared_ptr<TextBuffer>& oldBuffer,
+                                 TextBuffer& newBuffer,
+                                 const std::optional<Viewport> lastCharacterViewport,
+                                 PositionInformation& positionInfo)
+{
+    return _Reflow(*oldBuffer, newBuffer, lastCharacterViewport, { positionInfo }, &oldBuffer);
+}
+
+// Returns true if ReflowLazily() left some lines pending that haven't been copied yet.
+bool TextBuffer::HasPendingReflow() const noexcept
+{
+    return _pendingReflow != nullptr;
+}
+
+// Routine Description:
+// - Copies the lines that ReflowLazily() left pending, starting with those closest to the viewport.
+// - Since this has to be called under the console lock, it stops once it copied at least maxRows rows,
+//   so that the caller can release the lock in between.
+// Arguments:
+// - maxRows - The number of rows after which to stop.
+// Return Value:
+// - True if there are no pending lines left. False if this needs to be called again.
+bool TextBuffer::FinishPendingReflow(const til::CoordType maxRows) noexcept
+{
+    for (til::CoordType rows = 0; _pendingReflow && rows < maxRows;)
+    {
+        const auto index = _pendingReflow->back - 1;
+        rows += til::at(_pendingReflow->groups, index).height;
+        _fillPendingGroup(index);
+        if (_pendingReflow->remaining == 0)
+        {
+            _pendingReflow.reset();
+        }
+    }
+    return !_pendingReflow;
+}
+
+// Copies the pending lines (see ReflowLazily()) that overlap with the rows [begin, end).
+void TextBuffer::_fillPendingReflow(const til::CoordType begin, const til::CoordType end) noexcept
+{
+    if (!_pendingReflow)
+    {
+        return;
+    }
+
+    auto& pending = *_pendingReflow;
+    const auto& groups = pending.groups;
+    // The groups are sorted by their position, which allows us to skip straight to the first one that overlaps.
+    const auto first = std::partition_point(groups.begin() + pending.front, groups.begin() + pending.back, [&](const auto& group) {
+        return group.first + group.height - pending.scrolled <= begin;
+    });
+
+    for (auto index = gsl::narrow_cast<size_t>(first - groups.begin()); index < pending.back; ++index)
+    {
+        const auto& group = til::at(groups, index);
+        if (group.first - pending.scrolled >= end)
+        {
+            break;
+        }
+        if (!group.filled)
+        {
+            _fillPendingGroup(index);
+        }
+    }
+
+    if (pending.remaining == 0)
+    {
+        _pendingReflow.reset();
+    }
+}
+
+// Drops the pending lines (see ReflowLazily()) that are entirely within the rows [begin, end), because
+// they're about to be cleared. Those that overlap with the range only partially are copied as usual.
+void TextBuffer::_discardPendingReflow(const til::CoordType begin, const til::CoordType end) noexcept
+{
+    if (!_pendingReflow)
+    {
+        return;
+    }
+
+    auto& pending = *_pendingReflow;
+    for (auto index = pending.front; index < pending.back; ++index)
+    {
+        auto& group = til::at(pending.groups, index);
+        const auto top = group.first - pending.scrolled;
+        if (group.filled || top >= end || top + group.height <= begin)
+        {
+            continue;
+        }
+
+        if (top >= begin && top + group.height <= end)
+        {
+            group.filled = true;
+            pending.remaining--;
+        }
+        else
+        {
+            _fillPendingGroup(index);
+        }
+    }
+
+    for (; pending.front < pending.back && til::at(pending.groups, pending.front).filled; ++pending.front)
+    {
+    }
+    for (; pending.back > pending.front && til::at(pending.groups, pending.back - 1).filled; --pending.back)
+    {
+    }
+
+    if (pending.remaining == 0)
+    {
+        _pendingReflow.reset();
+    }
+}
+
+// Copies a single pending group of lines (see ReflowLazily()) into its rows.
+void TextBuffer::_fillPendingGroup(const size_t index) noexcept
+{
+    auto& pending = *_pendingReflow;
+    auto& group = til::at(pending.groups, index);
+
+    // If this fails the lines simply remain blank, just like if Reflow() had failed to copy them.
+    try
+    {
+        const auto& source = *pending.source;
+        std::vector<ReflowSource> sources(gsl::narrow_cast<size_t>(group.end - group.begin));
+        for (auto y = group.begin; y < group.end; ++y)
+        {
+            auto& s = til::at(sources, y - group.begin);
+            s.row = &source.GetRowByOffset(y);
+            s.Measure();
+        }
+
+        // Rows that scrolled out of the buffer in the meantime are skipped.
+        const auto top = group.first - pending.scrolled;
+        const auto height = GetSize().Height();
+        std::vector<ROW*> rows(gsl::narrow_cast<size_t>(group.height));
+        for (til::CoordType y = 0; y < group.height; ++y)
+        {
+            if (top + y >= 0 && top + y < height)
+            {
+                til::at(rows, y) = &_peekRowByOffset(top + y);
+            }
+        }
+
+        // Pending groups never contain the cursor or the last line.
+        const ReflowLayout layout{
+            .sources = sources,
+            .newWidth = GetSize().Width(),
+            .newHeight = height,
+            .oldCursor = { -1, -1 },
+            .lastRow = til::CoordTypeMax,
+        };
+        ReflowGroup reflowed{ .begin = 0, .end = gsl::narrow_cast<til::CoordType>(sources.size()) };
+        reflowGroup(layout, reflowed, rows, 0);
+    }
+    CATCH_LOG();
+
+    group.filled = true;
+    pending.remaining--;
+    for (; pending.front < pending.back && til::at(pending.groups, pending.front).filled; ++pending.front)
+    {
+    }
+    for (; pending.back > pending.front && til::at(pending.groups, pending.back - 1).filled; --pending.back)
+    {
+    }
+}
+
+HRESULT TextBuffer::_Reflow(TextBuffer& oldBuffer,
+                            TextBuffer& newBuffer,
+                            const std::optional<Viewport> lastCharacterViewport,
+                            std::optional<std::reference_wrapper<PositionInformation>> positionInfo,
+                            const std::shared_ptr<TextBuffer>* lazySource)
+{
+    const auto& oldCursor = oldBuffer.GetCursor();
+    auto& newCursor = newBuffer.GetCursor();
+
+    // We need to save the old cursor position so that we can
+    // place the new cursor back on the equivalent character in
+    // the new buffer.
+    const auto cOldCursorPos = oldCursor.GetPosition();
+    const auto cOldLastChar = oldBuffer.GetLastNonSpaceCharacter(lastCharacterViewport);
+
+    const auto cOldRowsTotal = cOldLastChar.y + 1;
+
+    til::point cNewCursorPos;
+    auto fFoundCursorPos = false;
+    auto hr = S_OK;
+
+    const auto newWidth = newBuffer.GetSize().Width();
+    const auto newHeight = newBuffer.GetSize().Height();
+
+    // The lines from here on down are always copied right away.
+    auto eagerTop = std::min(cOldCursorPos.y, cOldRowsTotal);
+    if (positionInfo.has_value())
+    {
+        const auto& info = positionInfo.value().get();
+        eagerTop = std::min({ eagerTop, info.mutableViewportTop, info.visibleViewportTop });
+    }
+    eagerTop = std::max(eagerTop, 0);
+
+    // If the old buffer has pending lines itself, we read them from its source instead (see below).
+    // That doesn't work for the line that's partially scrolled out, or for those we need the position of.
+    oldBuffer._fillPendingReflow(0, 1);
+    oldBuffer._fillPendingReflow(eagerTop, oldBuffer.GetSize().Height());
+    const auto oldPending = oldBuffer._pendingReflow.get();
+
+    // Gather the rows to reflow. If this is the first time we access a spilled row, it's read back in, but
+    // left cold, since thawing all rows would defeat the purpose of ReflowLazily(). (It also isn't thread-safe.)
+    std::vector<ReflowSource> sources;
+    // The index into sources for each old row. The rows of a pending group all map to its first line.
+    std::vector<til::CoordType> sourceIndices;
+    sources.reserve(gsl::narrow_cast<size_t>(cOldRowsTotal));
+    sourceIndices.reserve(gsl::narrow_cast<size_t>(cOldRowsTotal));
+    const auto addSource = [&](TextBuffer& buffer, const til::CoordType y) {
+        auto& row = buffer._peekRowByOffset(y);
+        if (!row.IsMaterialized())
+        {
+            buffer._unspill(row);
+        }
+        sources.push_back({ .row = &row, .buffer = &buffer, .y = y });
+    };
+    size_t index = oldPending ? oldPending->front : 0;
+    for (til::CoordType y = 0; y < cOldRowsTotal;)
+    {
+        if (oldPending)
+        {
+            const auto& groups = oldPending->groups;
+            const auto back = oldPending->back;
+            for (; index < back && (til::at(groups, index).filled || til::at(groups, index).first - oldPending->scrolled < y); ++index)
+            {
+            }
+            if (index < back && til::at(groups, index).first - oldPending->scrolled == y)
+            {
+                const auto& group = til::at(groups, index);
+                sourceIndices.insert(sourceIndices.end(), gsl::narrow_cast<size_t>(group.height), gsl::narrow_cast<til::CoordType>(sources.size()));
+                for (auto sy = group.begin; sy < group.end; ++sy)
+                {
+                    addSource(*oldPending->source, sy);
                 }
+                y += group.height;
+                continue;
             }
         }
+
+        sourceIndices.push_back(gsl::narrow_cast<til::CoordType>(sources.size()));
+        addSource(oldBuffer, y);
+        ++y;
     }
 
+    const auto sourceCount = gsl::narrow_cast<til::CoordType>(sources.size());
+    const auto sourceIndexOf = [&](const til::CoordType y) {
+        return y < cOldRowsTotal ? til::at(sourceIndices, y) : y - cOldRowsTotal + sourceCount;
+    };
+
+    const auto parallel = sourceCount >= ReflowParallelMinRows;
+    const auto forEach = [&](auto& items, auto&& func) {
+        if (parallel)
+        {
+            std::for_each(std::execution::par, items.begin(), items.end(), func);
+        }
+        else
+        {
+            std::for_each(items.begin(), items.end(), func);
+        }
+    };
+
+    forEach(sources, [](ReflowSource& source) noexcept {
+        source.Measure();
+    });
+
+    // Split the old rows up into groups that end in a hard line break. Since each group starts at the
+    // beginning of a new row, they can be laid out and copied independently of each other.
+    std::vector<ReflowGroup> groups;
+    for (til::CoordType y = 0, begin = 0; y < sourceCount; ++y)
+    {
+        if (til::at(sources, y).EndsLine() || y == sourceCount - 1)
+        {
+            groups.push_back({ .begin = begin, .end = y + 1 });
+            begin = y + 1;
+        }
+    }
+
+    ReflowLayout layout{
+        .sources = sources,
+        .newWidth = newWidth,
+        .newHeight = newHeight,
+        .oldCursor = { cOldCursorPos.x, sourceIndexOf(cOldCursorPos.y) },
+        .lastRow = sourceCount - 1,
+    };
+    // If we find the old rows that the caller is interested in, we'll return the
+    // cursor's Y position in the new buffer after copying them (the new location
+    // of the _end_ of those rows in the buffer).
+    if (positionInfo.has_value())
+    {
+        const auto& info = positionInfo.value().get();
+        layout.mutableRow = info.mutableViewportTop < cOldRowsTotal ? sourceIndexOf(std::max(info.mutableViewportTop, 0)) : -1;
+        layout.visibleRow = info.visibleViewportTop < cOldRowsTotal ? sourceIndexOf(std::max(info.visibleViewportTop, 0)) : -1;
+    }
+
+    // First we figure out how many new rows each group needs...
+    forEach(groups, [&](ReflowGroup& group) noexcept {
+        reflowGroup(layout, group, {}, 0);
+    });
+
+    // ...which tells us where each of them starts in the new buffer.
+    til::CoordType newRowsTotal = 0;
+    for (auto& group : groups)
+    {
+        group.first = newRowsTotal;
+        newRowsTotal += group.height;
+    }
+
+    // If the text doesn't fit into the new buffer, the rows at the top are dropped,
+    // just as if we had written it all out and it had scrolled out of the buffer.
+    const auto newCursorY = groups.empty() ? 0 : groups.back().first + groups.back().position.y;
+    const auto scrolled = std::max(0, newCursorY - newHeight + 1);
+
+    // ReflowLazily() leaves the groups above eagerTop pending, as long as they can all be copied from a single
+    // buffer later on: The old one, or the source of its own pending lines. Those are never pending themselves.
+    TextBuffer* lazyBuffer = nullptr;
+    if (lazySource)
+    {
+        lazyBuffer = oldPending ? oldPending->source.get() : lazySource->get();
+    }
+    const auto eagerBegin = sourceIndexOf(eagerTop);
+    for (auto& group : groups)
+    {
+        group.pending = lazyBuffer && &group != &groups.back() && group.end <= eagerBegin &&
+                        std::all_of(sources.begin() + group.begin, sources.begin() + group.end, [&](const ReflowSource& source) {
+                            return source.buffer == lazyBuffer;
+                        });
+    }
+
+    // The last group always contains the cursor row, but ends in it (its height doesn't include it).
+    const auto copied = [&](const ReflowGroup& group) noexcept {
+        return !group.pending && (&group == &groups.back() || group.first + group.height > scrolled);
+    };
+
+    // Thawing cold rows isn't thread-safe, so we do it upfront, before reading them concurrently.
+    for (const auto& group : groups)
+    {
+        if (copied(group))
+        {
+            for (auto y = group.begin; y < group.end; ++y)
+            {
+                auto& source = til::at(sources, y);
+                source.row = &std::as_const(*source.buffer).GetRowByOffset(source.y);
+            }
+        }
+    }
+
+    std::vector<ROW*> newRows(gsl::narrow_cast<size_t>(newHeight));
+    for (til::CoordType y = 0; y < newHeight; ++y)
+    {
+        til::at(newRows, y) = &newBuffer.GetRowByOffset(y);
+    }
+
+    // Now each group can be copied into its destination rows.
+    std::atomic<HRESULT> copyResult{ S_OK };
+    forEach(groups, [&](ReflowGroup& group) noexcept {
+        if (!copied(group))
+        {
+            return;
+        }
+        try
+        {
+            reflowGroup(layout, group, newRows, group.first - scrolled);
+        }
+        catch (...)
+        {
+            LOG_CAUGHT_EXCEPTION();
+            copyResult = wil::ResultFromCaughtException();
+        }
+    });
+    RETURN_IF_FAILED(copyResult.load());
+
+    // Hand the pending groups over to the new buffer, unless they scrolled out of it anyway.
+    if (lazyBuffer)
+    {
+        auto pending = std::make_unique<PendingReflow>();
+        pending->source = oldPending ? oldPending->source : *lazySource;
+        pending->scrolled = scrolled;
+        for (const auto& group : groups)
+        {
+            if (group.pending && group.first + group.height > scrolled)
+            {
+                pending->groups.push_back({
+                    .begin = til::at(sources, group.begin).y,
+                    .end = til::at(sources, group.end - 1).y + 1,
+                    .first = group.first,
+                    .height = group.height,
+                });
+            }
+        }
+        pending->back = pending->groups.size();
+        pending->remaining = pending->groups.size();
+        if (pending->remaining != 0)
+        {
+            newBuffer._pendingReflow = std::move(pending);
+        }
+    }
+
+    // Translate the positions relative to each group into positions in the new buffer. Rows that scrolled out
+    // of the buffer are clamped to the top, since that's what scrolling the cursor down row by row would produce.
+    for (const auto& group : groups)
+    {
+        const auto newY = [&](const til::CoordType y) {
+            return std::min(group.first + y, newHeight - 1);
+        };
+
+        if (group.cursor && !fFoundCursorPos)
+        {
+            cNewCursorPos = { group.cursor->x, newY(group.cursor->y) };
+            fFoundCursorPos = true;
+        }
+        if (positionInfo.has_value())
+        {
+            if (group.mutableViewportTop)
+            {
+                positionInfo.value().get().mutableViewportTop = newY(*group.mutableViewportTop);
+            }
+            if (group.visibleViewportTop)
+            {
+                positionInfo.value().get().visibleViewportTop = newY(*group.visibleViewportTop);
+            }
+        }
+    }
+
+    if (!groups.empty())
+    {
+        newCursor.SetPosition({ groups.back().position.x, newCursorY - scrolled });
+    }
+
+    til::CoordType iOldRow = cOldRowsTotal;
+
     // Finish copying buffer attributes to remaining rows below the last
     // printable character. This is to fix the `color 2f` scenario, where you
     // change the buffer colors then resize and everything below the last
     // printable char gets reset. See GH #12567
     auto newRowY = newCursor.GetPosition().y + 1;
-    const auto newHeight = newBuffer.GetSize().Height();
     const auto oldHeight = oldBuffer.GetSize().Height();
     for (;
          iOldRow < oldHeight && newRowY < newHeight;
@@ -2555,8 +4170,7 @@ HRESULT TextBuffer::Reflow(TextBuffer& oldBuffer,
         // behavior of ATTR_ROW::Resize to trim down when narrower, or extend
         // the last attr when wider.
         auto& newRow = newBuffer.GetRowByOffset(newRowY);
-        const auto newWidth = newBuffer.GetLineWidth(newRowY);
-        newRow.TransferAttributes(row.Attributes(), newWidth);
+        newRow.TransferAttributes(row.Attributes(), newBuffer.GetLineWidth(newRowY));
 
         newRowY++;
     }
@@ -2628,6 +4242,17 @@ HRESULT TextBuffer::Reflow(TextBuffer& oldBuffer,
 
         // Set size back to real size as it will be taking over the rendering duties.
         newCursor.SetSize(ulSize);
+
+        // The rows were copied directly instead of advancing the cursor through them with NewlineCursor(),
+        // which would've compacted the rows far above the cursor along the way (see CompactColdRows()).
+        if (const auto y = newCursor.GetPosition().y; y > ColdRowDistance)
+        {
+            try
+            {
+                newBuffer._compactColdRows(y - ColdRowDistance);
+            }
+            CATCH_LOG();
+        }
     }
 
     return hr;
@@ -2639,7 +4264,24 @@ HRESULT TextBuffer::Reflow(TextBuffer& oldBuffer,
 // - The hyperlink URI, the hyperlink id (could be new or old)
 void TextBuffer::AddHyperlinkToMap(std::wstring_view uri, uint16_t id)
 {
-    _hyperlinkMap[id] = uri;
+    auto& entry = _hyperlinkMap[id];
+
+    // Custom ids are re-added every time they're opened. Reuse their existing storage if possible.
+    if (uri.size() <= entry.length && entry.length != 0)
+    {
+        const auto existing = std::wstring_view{ _hyperlinkUris }.substr(entry.offset, entry.length);
+        if (existing == uri)
+        {
+            return;
+        }
+        _hyperlinkUris.replace(entry.offset, uri.size(), uri);
+        entry.length = uri.size();
+        return;
+    }
+
+    entry.offset = _hyperlinkUris.size();
+    entry.length = uri.size();
+    _hyperlinkUris.append(uri);
 }
 
 // Method Description:
@@ -2650,7 +4292,8 @@ void TextBuffer::AddHyperlinkToMap(std::wstring_view uri, uint16_t id)
 // - The URI
 std::wstring TextBuffer::GetHyperlinkUriFromId(uint16_t id) const
 {
-    return _hyperlinkMap.at(id);
+    const auto& uri = _hyperlinkMap.at(id);
+    return _hyperlinkUris.substr(uri.offset, uri.length);
 }
 
 // Method description:
@@ -2736,6 +4379,7 @@ void TextBuffer::CopyHyperlinkMaps(const TextBuffer& other)
 {
     _hyperlinkMap = other._hyperlinkMap;
     _hyperlinkCustomIdMap = other._hyperlinkCustomIdMap;
+    _hyperlinkUris = other._hyperlinkUris;
     _currentHyperlinkId = other._currentHyperlinkId;
 }
 
@@ -2748,8 +4392,14 @@ void TextBuffer::CopyHyperlinkMaps(const TextBuffer& other)
 // - An ID that the caller should associate with the given pattern
 const size_t TextBuffer::AddPatternRecognizer(const std::wstring_view regexString)
 {
+    PatternRecognizer recognizer{ .pattern = std::wstring{ regexString } };
+    if (regexString != linkPattern)
+    {
+        recognizer.regex.emplace(recognizer.pattern);
+    }
+
     ++_currentPatternId;
-    _idsAndPatterns.emplace(std::make_pair(_currentPatternId, regexString));
+    _idsAndPatterns.emplace(_currentPatternId, std::move(recognizer));
     return _currentPatternId;
 }
 
@@ -2773,6 +4423,9 @@ void TextBuffer::CopyPatterns(const TextBuffer& OtherBuffer)
 
 // Method Description:
 // - Finds patterns within the requested region of the text buffer
+// - Matches may span multiple rows. linkPattern can't match across spaces however, which means that
+//   we can match it against each run of rows individually that's separated by a row ending in whitespace.
+//   That's usually every single row and so we can cache the results for each of them.
 // Arguments:
 // - The firstRow to start searching from
 // - The lastRow to search
@@ -2781,60 +4434,211 @@ void TextBuffer::CopyPatterns(const TextBuffer& OtherBuffer)
 PointTree TextBuffer::GetPatterns(const til::CoordType firstRow, const til::CoordType lastRow) const
 {
     PointTree::interval_vector intervals;
+    std::wstring text;
+    PatternMatches matches;
 
-    std::wstring concatAll;
-    const auto rowSize = GetRowByOffset(0).size();
-    concatAll.reserve(gsl::narrow_cast<size_t>(rowSize) * gsl::narrow_cast<size_t>(lastRow - firstRow + 1));
-
-    // to deal with text that spans multiple lines, we will first concatenate
-    // all the text into one string and find the patterns in that string
-    for (til::CoordType i = firstRow; i <= lastRow; ++i)
+    for (const auto& [id, recognizer] : _idsAndPatterns)
     {
-        auto& row = GetRowByOffset(i);
-        concatAll += row.GetText();
+        if (recognizer.regex)
+        {
+            // to deal with text that spans multiple lines, we will first concatenate
+            // all the text into one string and find the patterns in that string
+            text.clear();
+            for (auto y = firstRow; y <= lastRow; ++y)
+            {
+                text += GetRowByOffset(y).GetText();
+            }
+
+            matches.clear();
+            for (auto it = std::wcregex_iterator(text.data(), text.data() + text.size(), *recognizer.regex); it != std::wcregex_iterator(); ++it)
+            {
+                const auto begin = gsl::narrow_cast<size_t>(it->position());
+                matches.emplace_back(begin, begin + gsl::narrow_cast<size_t>(it->length()));
+            }
+            _AppendPatternIntervals(intervals, firstRow, firstRow, matches, id);
+            continue;
+        }
+
+        // Avoid growing the cache indefinitely, for instance while scrolling through long scrollbacks.
+        if (_urlMatchCache.size() > 4096)
+        {
+            _urlMatchCache.clear();
+        }
+
+        for (auto runBegin = firstRow; runBegin <= lastRow;)
+        {
+            text.clear();
+            auto runEnd = runBegin;
+            for (; runEnd <= lastRow; ++runEnd)
+            {
+                const auto rowText = GetRowByOffset(runEnd).GetText();
+                text += rowText;
+                if (rowText.empty() || rowText.back() == L' ')
+                {
+                    ++runEnd;
+                    break;
+                }
+            }
+
+            auto cached = _urlMatchCache.find(text);
+            if (cached == _urlMatchCache.end())
+            {
+                PatternMatches found;
+                _FindUrls(text, found);
+                cached = _urlMatchCache.emplace(text, std::move(found)).first;
+            }
+
+            _AppendPatternIntervals(intervals, firstRow, runBegin, cached->second, id);
+            runBegin = runEnd;
+        }
     }
 
-    // for each pattern we know of, iterate through the string
-    for (const auto& idAndPattern : _idsAndPatterns)
+    PointTree result(std::move(intervals));
+    return result;
+}
+
+// Method Description:
+// - A faster equivalent of matching linkPattern with std::regex.
+// Arguments:
+// - text: the text to search
+// - matches: receives the [begin, end) offsets of all URLs in the text
+void TextBuffer::_FindUrls(const std::wstring_view text, PatternMatches& matches)
+{
+    // Bit 0: the character may be part of the URL after the "://".
+    // Bit 1: the character may also be the URL's last character.
+    static constexpr auto charClasses = []() {
+        std::array<uint8_t, 128> classes{};
+        for (const auto ch : std::string_view{ "-?!:,.;" })
+        {
+            classes[ch] = 1;
+        }
+        for (const auto ch : std::string_view{ "+&@#/%=~_|$" })
+        {
+            classes[ch] = 3;
+        }
+        for (auto ch = '0'; ch <= '9'; ++ch)
+        {
+            classes[ch] = 3;
+        }
+        for (auto ch = 'A'; ch <= 'Z'; ++ch)
+        {
+            classes[ch] = 3;
+            classes[ch + 0x20] = 3;
+        }
+        return classes;
+    }();
+    static constexpr auto charClass = [](const wchar_t ch) noexcept {
+        return ch < 128 ? til::at(charClasses, ch) : uint8_t{ 0 };
+    };
+    // The same characters as std::regex's \w.
+    static constexpr auto isWordChar = [](const wchar_t ch) noexcept {
+        return ch == L'_' || ::iswalnum(ch);
+    };
+
+    size_t previousEnd = 0;
+
+    for (auto separator = text.find(L"://"); separator != std::wstring_view::npos; separator = text.find(L"://", separator + 1))
     {
-        std::wregex regexObj{ idAndPattern.second };
+        const auto scheme = text.substr(0, separator);
+        size_t begin;
+        if (scheme.ends_with(L"https"))
+        {
+            begin = separator - 5;
+        }
+        else if (scheme.ends_with(L"http") || scheme.ends_with(L"file"))
+        {
+            begin = separator - 4;
+        }
+        else if (scheme.ends_with(L"ftp"))
+        {
+            begin = separator - 3;
+        }
+        else
+        {
+            continue;
+        }
 
-        // search through the run with our regex object
-        auto words_begin = std::wsregex_iterator(concatAll.begin(), concatAll.end(), regexObj);
-        auto words_end = std::wsregex_iterator();
+        // Matches can't overlap and must start at a word boundary (\b).
+        if (begin < previousEnd || (begin > 0 && isWordChar(til::at(text, begin - 1))))
+        {
+            continue;
+        }
 
-        til::CoordType lenUpToThis = 0;
-        for (auto i = words_begin; i != words_end; ++i)
+        // The URL extends as far as possible, up to the last character that may end a URL.
+        size_t end = 0;
+        for (auto i = separator + 3; i < text.size(); ++i)
         {
-            // record the locations -
-            // when we find a match, the prefix is text that is between this
-            // match and the previous match, so we use the size of the prefix
-            // along with the size of the match to determine the locations
-            til::CoordType prefixSize = 0;
-            for (const auto str = i->prefix().str(); const auto& glyph : til::utf16_iterator{ str })
+            const auto c = charClass(til::at(text, i));
+            if (c == 0)
             {
-                prefixSize += IsGlyphFullWidth(glyph) ? 2 : 1;
+                break;
             }
-            const auto start = lenUpToThis + prefixSize;
-            til::CoordType matchSize = 0;
-            for (const auto str = i->str(); const auto& glyph : til::utf16_iterator{ str })
+            if (c & 2)
+            {
+                end = i + 1;
+            }
+        }
+
+        if (end != 0)
+        {
+            matches.emplace_back(begin, end);
+            previousEnd = end;
+        }
+    }
+}
+
+// Method Description:
+// - Converts the [begin, end) offsets of pattern matches into intervals.
+// Arguments:
+// - intervals: receives the intervals
+// - originRow: the row that the resulting coordinates are relative to
+// - firstRow: the row that the offsets are relative to. The text that was searched
+//   is the text of this and all following rows concatenated.
+// - matches: the matches, ordered by their begin offset
+// - id: the pattern ID to store in the intervals
+void TextBuffer::_AppendPatternIntervals(PointTree::interval_vector& intervals, const til::CoordType originRow, const til::CoordType firstRow, const PatternMatches& matches, const size_t id) const
+{
+    const auto width = GetSize().Width();
+    auto y = firstRow;
+    size_t rowOffset = 0;
+
+    // Returns the row that contains the given offset and the offset of the character within it.
+    const auto seek = [&](const size_t offset) {
+        for (;;)
+        {
+            const auto& row = GetRowByOffset(y);
+            const auto length = row.GetText().size();
+            if (offset < rowOffset + length)
             {
-                matchSize += IsGlyphFullWidth(glyph) ? 2 : 1;
+                return std::pair<const ROW&, ptrdiff_t>{ row, gsl::narrow_cast<ptrdiff_t>(offset - rowOffset) };
             }
-            const auto end = start + matchSize;
-            lenUpToThis = end;
+            rowOffset += length;
+            ++y;
+        }
+    };
+
+    for (const auto& [begin, end] : matches)
+    {
+        if (end <= begin)
+        {
+            continue;
+        }
 
-            const til::point startCoord{ start % rowSize, start / rowSize };
-            const til::point endCoord{ end % rowSize, end / rowSize };
+        const auto [startRow, startOffset] = seek(begin);
+        const til::point startCoord{ startRow.GetLeadingColumnAtCharOffset(startOffset), y - originRow };
 
-            // store the intervals
-            // NOTE: these intervals are relative to the VIEWPORT not the buffer
-            // Keeping these relative to the viewport for now because its the renderer
-            // that actually uses these locations and the renderer works relative to
-            // the viewport
-            intervals.push_back(PointTree::interval(startCoord, endCoord, idAndPattern.first));
+        const auto [endRow, endOffset] = seek(end - 1);
+        til::point endCoord{ endRow.GetTrailingColumnAtCharOffset(endOffset) + 1, y - originRow };
+        if (endCoord.x >= width)
+        {
+            endCoord = { 0, endCoord.y + 1 };
         }
+
+        // store the intervals
+        // NOTE: these intervals are relative to the VIEWPORT not the buffer
+        // Keeping these relative to the viewport for now because its the renderer
+        // that actually uses these locations and the renderer works relative to
+        // the viewport
+        intervals.push_back(PointTree::interval(startCoord, endCoord, id));
     }
-    PointTree result(std::move(intervals));
-    return result;
 }
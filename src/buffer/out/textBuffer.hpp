@@ -58,12 +58,16 @@ filling in the last row, and updating the screen.
 
 #include "../buffer/out/textBufferCellIterator.hpp"
 #include "../buffer/out/textBufferTextIterator.hpp"
+#include "../buffer/out/ScrollbackSpill.hpp"
 
 namespace Microsoft::Console::Render
 {
     class Renderer;
 }
 
+// GetPatterns() recognizes this pattern without std::regex. See TextBuffer::_FindUrls().
+inline constexpr std::wstring_view linkPattern{ LR"(\b(https?|ftp|file)://[-A-Za-z0-9+&@#/%?=~_|$!:,.;]*[A-Za-z0-9+&@#/%=~_|$])" };
+
 class TextBuffer final
 {
 public:
@@ -79,8 +83,54 @@ public:
 
     // row manipulation
     const ROW& GetRowByOffset(const til::CoordType index) const noexcept;
+    const ROW& PeekRowByOffset(const til::CoordType index) const noexcept;
     ROW& GetRowByOffset(const til::CoordType index) noexcept;
 
+    // Rows are only backed by committed memory once they've been written to.
+    // Cold rows are stored in a compact heap allocation instead. See CompactColdRows().
+    struct MemoryUsage
+    {
+        size_t reservedBytes = 0;
+        size_t committedBytes = 0;
+        size_t coldBytes = 0;
+        til::CoordType coldRows = 0;
+        // The slabs of text that doesn't fit into the rows' reserved storage (see RowCharPool).
+        size_t overflowBytes = 0;
+        size_t spilledBytes = 0;
+        til::CoordType spilledRows = 0;
+        // Run-length encoded attributes with more than one run, sixel images,
+        // hyperlink URIs and the caches of GetPatterns() and word navigation.
+        size_t attributeBytes = 0;
+        size_t imageBytes = 0;
+        size_t hyperlinkBytes = 0;
+        size_t cacheBytes = 0;
+
+        MemoryUsage& operator+=(const MemoryUsage& other) noexcept;
+    };
+    MemoryUsage GetMemoryUsage() const noexcept;
+    void CompactColdRows() noexcept;
+    void TrimMemory() noexcept;
+    void EnableScrollbackSpill(const bool enable);
+    bool IsScrollbackSpillEnabled() const noexcept;
+
+    // Sixel images are stored in the rows they were drawn into (see ImageSlice).
+    // Once they take up more than the limit, the oldest ones are dropped.
+    static constexpr size_t DefaultImageMemoryLimit = 64 * 1024 * 1024;
+    void SetImageMemoryLimit(const size_t bytes) noexcept;
+    size_t GetImageMemoryLimit() const noexcept;
+    void EnforceImageMemoryLimit();
+
+    // The rows that were modified since the last call to TakeDirtyRows(), for consumers that
+    // maintain state derived from the buffer contents, like SearchIndex. Rows that were scrolled
+    // out by IncrementCircularBuffer() are counted in `scrolled` and the range is adjusted for it.
+    struct DirtyRows
+    {
+        til::CoordType begin = 0;
+        til::CoordType end = 0;
+        til::CoordType scrolled = 0;
+    };
+    DirtyRows TakeDirtyRows() noexcept;
+
     TextBufferCellIterator GetCellDataAt(const til::point at) const;
     TextBufferCellIterator GetCellLineDataAt(const til::point at) const;
     TextBufferCellIterator GetCellDataAt(const til::point at, const Microsoft::Console::Types::Viewport limit) const;
@@ -103,6 +153,10 @@ public:
                                  const std::optional<bool> setWrap = std::nullopt,
                                  const std::optional<til::CoordType> limitRight = std::nullopt);
 
+    bool WriteCharInfos(til::point target, std::span<const CHAR_INFO> charInfos);
+    void FillRect(const til::rect& rect, const std::wstring_view& fill, const TextAttribute& attributes);
+    void CopyRect(const til::rect& source, const til::point target);
+
     bool InsertCharacter(const wchar_t wch, const DbcsAttribute dbcsAttribute, const TextAttribute attr);
     bool InsertCharacter(const std::wstring_view chars, const DbcsAttribute dbcsAttribute, const TextAttribute attr);
     bool IncrementCursor();
@@ -139,6 +193,9 @@ public:
     til::point BufferToScreenPosition(const til::point position) const noexcept;
 
     void Reset();
+    void ClearRows(til::CoordType begin, til::CoordType end, const TextAttribute& attributes);
+    void ClearScrollback(const til::CoordType top, const til::CoordType height, const TextAttribute& attributes);
+    void Recycle(const til::size screenBufferSize, const TextAttribute defaultAttributes, const UINT cursorSize);
 
     [[nodiscard]] HRESULT ResizeTraditional(const til::size newSize) noexcept;
 
@@ -192,15 +249,35 @@ public:
 
     std::wstring GetPlainText(const til::point& start, const til::point& end) const;
 
-    static std::string GenHTML(const TextAndColor& rows,
-                               const int fontHeightPoints,
-                               const std::wstring_view fontFaceName,
-                               const COLORREF backgroundColor);
+    // The selection that GetPlainText(), GenHTML() and GenRTF() serialize. Unlike GetText(), they walk
+    // the rows and their attribute runs directly, without materializing the text and colors of every cell.
+    struct CopyRequest
+    {
+        std::span<const til::inclusive_rect> selectionRects;
+        // These have the same meaning as the parameters of GetText().
+        bool includeCRLF = false;
+        bool trimTrailingWhitespace = false;
+        bool formatWrappedRows = false;
+    };
+    using AttributeColorsFunc = std::function<std::pair<COLORREF, COLORREF>(const TextAttribute&)>;
+
+    std::wstring GetPlainText(const CopyRequest& req) const;
+
+    void GenHTML(const CopyRequest& req,
+                 std::string& out,
+                 const int fontHeightPoints,
+                 const std::wstring_view fontFaceName,
+                 const COLORREF backgroundColor,
+                 const AttributeColorsFunc& GetAttributeColors) const;
 
-    static std::string GenRTF(const TextAndColor& rows,
-                              const int fontHeightPoints,
-                              const std::wstring_view fontFaceName,
-                              const COLORREF backgroundColor);
+    void GenRTF(const CopyRequest& req,
+                std::string& out,
+                const int fontHeightPoints,
+                const std::wstring_view fontFaceName,
+                const COLORREF backgroundColor,
+                const AttributeColorsFunc& GetAttributeColors) const;
+
+    std::unique_ptr<TextBuffer> SnapshotRows(const std::span<const til::inclusive_rect> selectionRects, std::vector<til::inclusive_rect>& snapshotRects) const;
 
     struct PositionInformation
     {
@@ -212,6 +289,12 @@ public:
                           TextBuffer& newBuffer,
                           const std::optional<Microsoft::Console::Types::Viewport> lastCharacterViewport,
                           std::optional<std::reference_wrapper<PositionInformation>> positionInfo);
+    static HRESULT ReflowLazily(const std::shared_ptr<TextBuffer>& oldBuffer,
+                                TextBuffer& newBuffer,
+                                const std::optional<Microsoft::Console::Types::Viewport> lastCharacterViewport,
+                                PositionInformation& positionInfo);
+    bool HasPendingReflow() const noexcept;
+    bool FinishPendingReflow(const til::CoordType maxRows) noexcept;
 
     const size_t AddPatternRecognizer(const std::wstring_view regexString);
     void ClearPatternRecognizers() noexcept;
@@ -219,7 +302,29 @@ public:
     interval_tree::IntervalTree<til::point, size_t> GetPatterns(const til::CoordType firstRow, const til::CoordType lastRow) const;
 
 private:
-    static wil::unique_virtualalloc_ptr<std::byte> _allocateBuffer(til::size sz, const TextAttribute& attributes, std::vector<ROW>& rows);
+    // The granularity at which rows get committed and decommitted.
+    static constexpr size_t PageSize = 4096;
+    // Rows more than this many lines above the cursor are considered cold.
+    static constexpr til::CoordType ColdRowDistance = 2048;
+    // CompactColdRows() only does any work every this many calls.
+    static constexpr til::CoordType ColdRowCompactionInterval = 1024;
+    // Cold rows more than this many lines above the cursor get moved to disk, if enabled.
+    static constexpr til::CoordType SpillRowDistance = 16384;
+    // TrimMemory() freezes and spills rows this many lines above the cursor already.
+    static constexpr til::CoordType TrimRowDistance = 256;
+
+    static wil::unique_virtualalloc_ptr<std::byte> _allocateBuffer(til::size sz, const TextAttribute& attributes, RowCharPool* charsPool, ROW& blankRow, std::vector<ROW>& rows);
+    static uint64_t _NewRowId() noexcept;
+    const ROW& _peekRowByOffset(const til::CoordType index) const noexcept;
+    ROW& _peekRowByOffset(const til::CoordType index) noexcept;
+    void _compactColdRows(const til::CoordType end);
+    void _decommitUnusedPages();
+    void _spillColdRows(const til::CoordType end);
+    void _thaw(ROW& row) noexcept;
+    void _resizeHeightInPlace(til::CoordType height, size_t topRowIndex);
+    void _unspill(ROW& row) noexcept;
+    void _discardSpilledRow(const ROW& row) noexcept;
+    size_t _slotOf(const ROW& row) const noexcept;
 
     void _UpdateSize();
     void _SetFirstRowIndex(const til::CoordType FirstRowIndex) noexcept;
@@ -231,26 +336,122 @@ private:
     bool _AssertValidDoubleByteSequence(const DbcsAttribute dbcsAttribute);
     ROW& _GetFirstRow() noexcept;
     void _ExpandTextRow(til::inclusive_rect& selectionRow) const;
+    struct DelimiterClassCache;
+    const DelimiterClassCache* _GetDelimiterClasses(const til::CoordType y, const std::wstring_view wordDelimiters) const noexcept;
     DelimiterClass _GetDelimiterClassAt(const til::point pos, const std::wstring_view wordDelimiters) const noexcept;
     til::point _GetWordStartForAccessibility(const til::point target, const std::wstring_view wordDelimiters) const noexcept;
     til::point _GetWordStartForSelection(const til::point target, const std::wstring_view wordDelimiters) const noexcept;
     til::point _GetWordEndForAccessibility(const til::point target, const std::wstring_view wordDelimiters, const til::point limit) const;
     til::point _GetWordEndForSelection(const til::point target, const std::wstring_view wordDelimiters) const noexcept;
     void _PruneHyperlinks();
-
-    static void _AppendRTFText(std::ostringstream& contentBuilder, const std::wstring_view& text);
+    void _SweepHyperlinks();
+    void _CompactHyperlinkUris();
+    void _MarkRowsDirty(const til::CoordType begin, const til::CoordType end) noexcept;
+
+    static HRESULT _Reflow(TextBuffer& oldBuffer,
+                           TextBuffer& newBuffer,
+                           const std::optional<Microsoft::Console::Types::Viewport> lastCharacterViewport,
+                           std::optional<std::reference_wrapper<PositionInformation>> positionInfo,
+                           const std::shared_ptr<TextBuffer>* lazySource);
+    void _fillPendingReflow(const til::CoordType begin, const til::CoordType end) noexcept;
+    void _fillPendingGroup(const size_t index) noexcept;
+    void _discardPendingReflow(const til::CoordType begin, const til::CoordType end) noexcept;
+
+    static void _AppendHTMLText(std::string& out, std::string& scratch, const std::wstring_view& text);
+    static void _AppendRTFText(std::string& out, const std::wstring_view& text);
+
+    using PatternMatches = std::vector<std::pair<size_t, size_t>>;
+    static void _FindUrls(const std::wstring_view text, PatternMatches& matches);
+    void _AppendPatternIntervals(interval_tree::IntervalTree<til::point, size_t>::interval_vector& intervals, const til::CoordType originRow, const til::CoordType firstRow, const PatternMatches& matches, const size_t id) const;
 
     Microsoft::Console::Render::Renderer& _renderer;
 
-    std::unordered_map<uint16_t, std::wstring> _hyperlinkMap;
+    // The URIs of all hyperlinks are interned into _hyperlinkUris and
+    // _hyperlinkMap only stores the location of each one in it.
+    struct HyperlinkUri
+    {
+        size_t offset = 0;
+        size_t length = 0;
+    };
+    std::unordered_map<uint16_t, HyperlinkUri> _hyperlinkMap;
     std::unordered_map<std::wstring, uint16_t> _hyperlinkCustomIdMap;
+    std::wstring _hyperlinkUris;
+    // The hyperlink ids of the rows that circled out of the buffer since the last
+    // _SweepHyperlinks(), along with the number of those rows. See _PruneHyperlinks().
+    std::vector<uint16_t> _hyperlinkPruneCandidates;
+    til::CoordType _hyperlinkRowsFreed = 0;
     uint16_t _currentHyperlinkId = 1;
 
-    std::unordered_map<size_t, std::wstring> _idsAndPatterns;
+    struct PatternRecognizer
+    {
+        std::wstring pattern;
+        // Recognizers for linkPattern don't need the regex, since they use _FindUrls() instead.
+        std::optional<std::wregex> regex;
+    };
+    std::unordered_map<size_t, PatternRecognizer> _idsAndPatterns;
     size_t _currentPatternId = 0;
+    // _FindUrls() results by the text they were found in. Most rows are matched individually
+    // (see GetPatterns()), so this allows us to skip all rows whose contents didn't change.
+    mutable std::unordered_map<std::wstring, PatternMatches> _urlMatchCache;
 
+    // The delimiter classes of the row that was last navigated by word. Double-clicks
+    // and UIA word navigation query them cell by cell, mostly within the same row.
+    struct DelimiterClassCache
+    {
+        uint64_t rowId = 0;
+        uint64_t rowRevision = 0;
+        til::CoordType columns = 0;
+        std::wstring wordDelimiters;
+        // See ROW::GetDelimiterClasses().
+        std::vector<uint64_t> regular;
+        std::vector<uint64_t> control;
+
+        DelimiterClass At(const til::CoordType column) const noexcept;
+        uint64_t Mask(const size_t word, const DelimiterClass delimiterClass) const noexcept;
+    };
+    mutable DelimiterClassCache _delimiterClassCache;
+
+    // Declared before the rows, because they hand their blocks back to it when they're destroyed.
+    std::unique_ptr<RowCharPool> _charsPool;
     wil::unique_virtualalloc_ptr<std::byte> _charBuffer;
+    // The blank, read-only row that all rows share until they're written to.
+    ROW _blankRow;
     std::vector<ROW> _storage;
+    // The rows whose storage in _charBuffer was given up by ResizeTraditional() reducing the height.
+    // Later height increases take them back, instead of reallocating the entire buffer.
+    std::vector<ROW> _spareRows;
+    til::CoordType _rowsSinceCompaction = 0;
+    // The text of cold rows that are far above the cursor can be spilled to disk. _spillIndex is indexed
+    // by _slotOf() and holds the record's offset in _spill plus 1, or 0 if that row isn't spilled.
+    std::unique_ptr<ScrollbackSpill> _spill;
+    std::vector<uint64_t> _spillIndex;
+    bool _spillEnabled = false;
+    size_t _imageMemoryLimit = DefaultImageMemoryLimit;
+    DirtyRows _dirtyRows;
+    // ReflowLazily() only copies the rows around the viewport. The other lines are copied from
+    // `source` once they're accessed via GetRowByOffset() or by FinishPendingReflow(), whichever
+    // comes first. Each group is a run of source rows that ends in a line break, and its new rows
+    // start at the row `first - scrolled`, where `scrolled` counts calls to IncrementCircularBuffer().
+    struct PendingReflow
+    {
+        struct Group
+        {
+            til::CoordType begin = 0;
+            til::CoordType end = 0;
+            til::CoordType first = 0;
+            til::CoordType height = 0;
+            bool filled = false;
+        };
+
+        std::shared_ptr<TextBuffer> source;
+        std::vector<Group> groups;
+        til::CoordType scrolled = 0;
+        // The groups outside of [front, back) have all been filled.
+        size_t front = 0;
+        size_t back = 0;
+        size_t remaining = 0;
+    };
+    std::unique_ptr<PendingReflow> _pendingReflow;
     TextAttribute _currentAttributes;
     til::CoordType _firstRow = 0; // indexes top row (not necessarily 0)
 
@@ -0,0 +1,147 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include "WexTestClass.h"
+#include "../../inc/consoletaeftemplates.hpp"
+#include "../../renderer/inc/DummyRenderer.hpp"
+
+#include "../BufferSnapshot.hpp"
+#include "../textBuffer.hpp"
+
+using namespace WEX::Common;
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+
+class BufferSnapshotTests
+{
+    TEST_CLASS(BufferSnapshotTests);
+
+    TEST_METHOD_SETUP(MethodSetup);
+    TEST_METHOD_CLEANUP(MethodCleanup);
+
+    TEST_METHOD(RoundtripRowsAndCursor);
+    TEST_METHOD(WritesOnlyChangedRows);
+    TEST_METHOD(CompactsDeadRecords);
+
+    static void write(TextBuffer& buffer, const til::CoordType y, const std::wstring_view& text, const TextAttribute& attr)
+    {
+        auto& row = buffer.GetRowByOffset(y);
+        RowWriteState state{
+            .text = text,
+            .columnBegin = 0,
+            .columnLimit = row.size(),
+        };
+        row.ReplaceText(state);
+        row.ReplaceAttributes(0, state.columnEnd, attr);
+    }
+
+    std::unique_ptr<TextBuffer> _createBuffer()
+    {
+        return std::make_unique<TextBuffer>(til::size{ 20, 50 }, TextAttribute{ 0x7 }, 0, false, _renderer);
+    }
+
+    DummyRenderer _renderer;
+    std::filesystem::path _path;
+};
+
+bool BufferSnapshotTests::MethodSetup()
+{
+    wchar_t directory[MAX_PATH + 1];
+    VERIFY_IS_TRUE(GetTempPathW(ARRAYSIZE(directory), &directory[0]) != 0);
+    _path = std::filesystem::path{ &directory[0] } / fmt::format(L"BufferSnapshotTests-{}.bin", GetCurrentProcessId());
+    return true;
+}
+
+bool BufferSnapshotTests::MethodCleanup()
+{
+    std::error_code ec;
+    std::filesystem::remove(_path, ec);
+    return true;
+}
+
+void BufferSnapshotTests::RoundtripRowsAndCursor()
+{
+    auto source = _createBuffer();
+    TextAttribute red{ FOREGROUND_RED };
+    TextAttribute link{ 0x7 };
+    link.SetHyperlinkId(source->GetHyperlinkId(L"https://example.com", {}));
+    source->AddHyperlinkToMap(L"https://example.com", link.GetHyperlinkId());
+
+    write(*source, 0, L"hello", red);
+    write(*source, 1, L"\x304b\x304b" L"wide", TextAttribute{ 0x7 });
+    write(*source, 3, L"link", link);
+    source->GetRowByOffset(1).SetWrapForced(true);
+    source->GetRowByOffset(3).SetLineRendition(LineRendition::DoubleWidth);
+    source->GetCursor().SetPosition({ 4, 5 });
+
+    BufferSnapshot{ _path }.Write(*source);
+
+    auto target = _createBuffer();
+    const auto cursor = BufferSnapshot::Restore(_path, *target);
+    VERIFY_ARE_EQUAL(til::point(4, 5), cursor);
+
+    for (til::CoordType y = 0; y < 5; ++y)
+    {
+        const auto& expected = source->GetRowByOffset(y);
+        const auto& actual = target->GetRowByOffset(y);
+        VERIFY_ARE_EQUAL(expected.GetText(), actual.GetText());
+        VERIFY_ARE_EQUAL(expected.WasWrapForced(), actual.WasWrapForced());
+        VERIFY_IS_TRUE(expected.GetLineRendition() == actual.GetLineRendition());
+    }
+
+    VERIFY_ARE_EQUAL(red, target->GetRowByOffset(0).GetAttrByColumn(0));
+    VERIFY_ARE_EQUAL(DbcsAttribute::Leading, target->GetRowByOffset(1).DbcsAttrAt(0));
+
+    const auto restoredLink = target->GetRowByOffset(3).GetAttrByColumn(0);
+    VERIFY_IS_TRUE(restoredLink.IsHyperlink());
+    VERIFY_ARE_EQUAL(L"https://example.com", target->GetHyperlinkUriFromId(restoredLink.GetHyperlinkId()));
+}
+
+void BufferSnapshotTests::WritesOnlyChangedRows()
+{
+    auto source = _createBuffer();
+    for (til::CoordType y = 0; y < 40; ++y)
+    {
+        write(*source, y, L"some text that fills", TextAttribute{ 0x7 });
+    }
+    source->GetCursor().SetPosition({ 0, 40 });
+
+    BufferSnapshot snapshot{ _path };
+    snapshot.Write(*source);
+    const auto initialSize = snapshot.FileSize();
+
+    write(*source, 10, L"changed", TextAttribute{ FOREGROUND_GREEN });
+    snapshot.Write(*source);
+    const auto growth = snapshot.FileSize() - initialSize;
+
+    Log::Comment(NoThrowString().Format(L"initial: %llu bytes, after changing 1 row: +%llu bytes", initialSize, growth));
+    // One row record, plus a manifest with 41 offsets.
+    VERIFY_IS_LESS_THAN(growth, initialSize / 4);
+
+    auto target = _createBuffer();
+    BufferSnapshot::Restore(_path, *target);
+    VERIFY_ARE_EQUAL(L"changed", target->GetRowByOffset(10).GetText().substr(0, 7));
+    VERIFY_ARE_EQUAL(L"some text that fills", target->GetRowByOffset(11).GetText());
+}
+
+void BufferSnapshotTests::CompactsDeadRecords()
+{
+    auto source = _createBuffer();
+    source->GetCursor().SetPosition({ 0, 30 });
+
+    BufferSnapshot snapshot{ _path };
+    for (auto i = 0; i < 20; ++i)
+    {
+        for (til::CoordType y = 0; y < 30; ++y)
+        {
+            write(*source, y, fmt::format(L"pass {} row {}", i, y), TextAttribute{ 0x7 });
+        }
+        snapshot.Write(*source);
+        VERIFY_IS_LESS_THAN_OR_EQUAL(snapshot.FileSize(), 2 * snapshot.LiveBytes());
+    }
+
+    auto target = _createBuffer();
+    BufferSnapshot::Restore(_path, *target);
+    VERIFY_ARE_EQUAL(L"pass 19 row 29", target->GetRowByOffset(29).GetText().substr(0, 14));
+}
@@ -840,6 +840,116 @@ class ReflowTests
             _compareTextBufferAgainstTestBuffer(*textBuffer, testBuffer);
         }
     }
+
+    TEST_METHOD(ReflowThroughput)
+    {
+        // A TextBuffer can't be taller than 32767 rows, which is as close as we can get to 100k lines of scrollback.
+        for (const til::CoordType height : { 10000, 32767 })
+        {
+            // Lines of 100 columns wrap into 2 rows at a width of 80 columns. They, and the cursor row below them, need to fit into the buffer.
+            const auto lines = (height - 1) / 2;
+            auto textBuffer = std::make_unique<TextBuffer>(til::size{ 120, height }, TextAttribute{ 0x7 }, 0, false, renderer);
+            for (til::CoordType y = 0; y < lines; ++y)
+            {
+                const auto text = fmt::format(L"{:->100}", y);
+                RowWriteState state{
+                    .text = text,
+                    .columnLimit = 120,
+                };
+                textBuffer->GetRowByOffset(y).ReplaceText(state);
+            }
+            textBuffer->GetCursor().SetPosition({ 0, lines });
+
+            const auto reflow = [&](const til::CoordType width) {
+                const auto start = std::chrono::steady_clock::now();
+                auto newBuffer = _textBufferByReflowingTextBuffer(*textBuffer, { width, height });
+                const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                Log::Comment(NoThrowString().Format(L"Reflowed %d lines to %d columns in %.3fs", lines, width, elapsed));
+                std::swap(textBuffer, newBuffer);
+            };
+            reflow(80);
+            reflow(120);
+
+            // The round trip should've restored the original text.
+            til::CoordType mismatches = 0;
+            for (til::CoordType y = 0; y < lines; ++y)
+            {
+                const auto& row = textBuffer->GetRowByOffset(y);
+                if (row.GetText().substr(0, 100) != fmt::format(L"{:->100}", y) || row.WasWrapForced())
+                {
+                    ++mismatches;
+                }
+            }
+            VERIFY_ARE_EQUAL(0, mismatches);
+            VERIFY_ARE_EQUAL(til::point(0, lines), textBuffer->GetCursor().GetPosition());
+        }
+    }
+
+    TEST_METHOD(TestLazyReflow)
+    {
+        static constexpr til::CoordType height = 1000;
+        static constexpr til::CoordType lines = 900;
+        const auto original = std::make_shared<TextBuffer>(til::size{ 120, height }, TextAttribute{ 0x7 }, 0, false, renderer);
+        for (til::CoordType y = 0; y < lines; ++y)
+        {
+            const auto text = fmt::format(L"{:->{}}", y, 20 + y % 100);
+            RowWriteState state{
+                .text = text,
+                .columnLimit = 120,
+            };
+            original->GetRowByOffset(y).ReplaceText(state);
+        }
+        original->GetCursor().SetPosition({ 0, lines });
+
+        const auto reflowLazily = [&](const std::shared_ptr<TextBuffer>& oldBuffer, const til::CoordType width) {
+            auto newBuffer = std::make_shared<TextBuffer>(til::size{ width, height }, TextAttribute{ 0x7 }, 0, false, renderer);
+            TextBuffer::PositionInformation positionInfo{
+                .mutableViewportTop = oldBuffer->GetCursor().GetPosition().y - 30,
+                .visibleViewportTop = oldBuffer->GetCursor().GetPosition().y - 30,
+            };
+            VERIFY_SUCCEEDED(TextBuffer::ReflowLazily(oldBuffer, *newBuffer, std::nullopt, positionInfo));
+            return newBuffer;
+        };
+        const auto compare = [](const TextBuffer& expected, const TextBuffer& actual) {
+            VERIFY_ARE_EQUAL(expected.GetCursor().GetPosition(), actual.GetCursor().GetPosition());
+            til::CoordType mismatches = 0;
+            for (til::CoordType y = 0; y < height; ++y)
+            {
+                const auto& expectedRow = expected.GetRowByOffset(y);
+                const auto& actualRow = actual.GetRowByOffset(y);
+                if (expectedRow.GetText() != actualRow.GetText() || expectedRow.WasWrapForced() != actualRow.WasWrapForced())
+                {
+                    ++mismatches;
+                }
+            }
+            VERIFY_ARE_EQUAL(0, mismatches);
+        };
+
+        auto eager80 = _textBufferByReflowingTextBuffer(*original, { 80, height });
+        auto eager50 = _textBufferByReflowingTextBuffer(*eager80, { 50, height });
+
+        // Only the rows around the viewport get copied right away.
+        const auto lazy80 = reflowLazily(original, 80);
+        VERIFY_IS_TRUE(lazy80->HasPendingReflow());
+        VERIFY_IS_LESS_THAN(lazy80->GetMemoryUsage().committedBytes, eager80->GetMemoryUsage().committedBytes);
+
+        // Resizing again takes the pending lines straight from the original buffer.
+        const auto lazy50 = reflowLazily(lazy80, 50);
+        VERIFY_IS_TRUE(lazy50->HasPendingReflow());
+
+        // The pending lines are filled in bit by bit...
+        til::CoordType calls = 1;
+        for (; !lazy50->FinishPendingReflow(100); ++calls)
+        {
+        }
+        VERIFY_IS_GREATER_THAN(calls, 1);
+        VERIFY_IS_FALSE(lazy50->HasPendingReflow());
+        compare(*eager50, *lazy50);
+
+        // ...or whenever they're accessed.
+        compare(*eager80, *lazy80);
+        VERIFY_IS_FALSE(lazy80->HasPendingReflow());
+    }
 };
 
 DummyRenderer ReflowTests::renderer{};
@@ -0,0 +1,272 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include "WexTestClass.h"
+#include "../../inc/consoletaeftemplates.hpp"
+
+#include "../Row.hpp"
+
+using namespace WEX::Common;
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+
+class RowTests
+{
+    TEST_CLASS(RowTests);
+
+    TEST_METHOD(ReplaceTextAscii);
+    TEST_METHOD(ReplaceTextThroughput);
+    TEST_METHOD(GetDelimiterClasses);
+    TEST_METHOD(GlyphIterator);
+    TEST_METHOD(ContentHash);
+    TEST_METHOD(MeasureRightCache);
+
+    // A ROW doesn't own its buffers in a TextBuffer. This gives it some for the duration of a test.
+    struct TestRow
+    {
+        explicit TestRow(const uint16_t width) :
+            chars(width),
+            charOffsets(width + 1u),
+            row{ chars.data(), charOffsets.data(), &pool, width, TextAttribute{} }
+        {
+        }
+
+        std::vector<wchar_t> chars;
+        std::vector<uint16_t> charOffsets;
+        RowCharPool pool;
+        ROW row;
+    };
+
+    static RowWriteState write(ROW& row, const std::wstring_view& text, const til::CoordType columnBegin)
+    {
+        RowWriteState state{
+            .text = text,
+            .columnBegin = columnBegin,
+            .columnLimit = row.size(),
+        };
+        row.ReplaceText(state);
+        return state;
+    }
+};
+
+void RowTests::ReplaceTextAscii()
+{
+    TestRow r{ 10 };
+    auto& row = r.row;
+
+    Log::Comment(L"ASCII that doesn't fit is left over");
+    auto state = write(row, L"abcdefghijkl", 0);
+    VERIFY_ARE_EQUAL(L"abcdefghij", row.GetText());
+    VERIFY_ARE_EQUAL(L"kl", state.text);
+    VERIFY_ARE_EQUAL(10, state.columnEnd);
+
+    Log::Comment(L"ASCII followed by a wide glyph and more ASCII");
+    row.Reset(TextAttribute{});
+    state = write(row, L"ab\x304b" L"c", 1);
+    VERIFY_ARE_EQUAL(L" ab\x304b" L"c    ", row.GetText());
+    VERIFY_ARE_EQUAL(6, state.columnEnd);
+    VERIFY_ARE_EQUAL(DbcsAttribute::Single, row.DbcsAttrAt(2));
+    VERIFY_ARE_EQUAL(DbcsAttribute::Leading, row.DbcsAttrAt(3));
+    VERIFY_ARE_EQUAL(DbcsAttribute::Trailing, row.DbcsAttrAt(4));
+    VERIFY_ARE_EQUAL(DbcsAttribute::Single, row.DbcsAttrAt(5));
+
+    Log::Comment(L"ASCII that overwrites the trailing half of a wide glyph replaces its leading half with whitespace");
+    state = write(row, L"x", 4);
+    VERIFY_ARE_EQUAL(L" ab xc    ", row.GetText());
+    VERIFY_ARE_EQUAL(3, state.columnBeginDirty);
+    VERIFY_ARE_EQUAL(5, state.columnEnd);
+    for (til::CoordType x = 0; x < 10; ++x)
+    {
+        VERIFY_ARE_EQUAL(DbcsAttribute::Single, row.DbcsAttrAt(x));
+        VERIFY_ARE_EQUAL(x, row.GetLeadingColumnAtCharOffset(x));
+    }
+}
+
+void RowTests::ReplaceTextThroughput()
+{
+    static constexpr uint16_t width = 120;
+    static constexpr auto iterations = 200000;
+
+    std::wstring ascii;
+    std::wstring mixed;
+    for (auto i = 0; i < width; ++i)
+    {
+        ascii.push_back(static_cast<wchar_t>(L'!' + i % 90));
+        // Every 10th glyph is wide, so that the fast path only ever covers a short run.
+        mixed.push_back(i % 10 == 9 ? L'\x304b' : static_cast<wchar_t>(L'!' + i % 90));
+    }
+
+    TestRow r{ width };
+    const auto measure = [&](const wchar_t* name, const std::wstring_view& text) {
+        const auto start = std::chrono::steady_clock::now();
+        RowWriteState state;
+        for (auto i = 0; i < iterations; ++i)
+        {
+            state = write(r.row, text, 0);
+        }
+        const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        Log::Comment(NoThrowString().Format(L"%s: %d rows in %.3fs (%.1f MB/s)", name, iterations, elapsed, iterations * text.size() * sizeof(wchar_t) / elapsed / 1e6));
+        return state;
+    };
+
+    const auto asciiState = measure(L"ASCII", ascii);
+    VERIFY_ARE_EQUAL(width, asciiState.columnEnd);
+    VERIFY_IS_TRUE(asciiState.text.empty());
+    VERIFY_ARE_EQUAL(std::wstring_view{ ascii }, r.row.GetText());
+
+    const auto mixedState = measure(L"Mixed", mixed);
+    VERIFY_ARE_EQUAL(width, mixedState.columnEnd);
+    // The wide glyphs take 2 columns each, which leaves the last 11 glyphs without room.
+    VERIFY_ARE_EQUAL(size_t{ 11 }, mixedState.text.size());
+}
+
+void RowTests::GetDelimiterClasses()
+{
+    // 70 columns, so that the bitmaps span 2 words.
+    TestRow r{ 70 };
+    auto& row = r.row;
+    static constexpr std::wstring_view delimiters{ L" /\\()\"'-.,:;<>~!@#$%^&*|+=[]{}?\x2502" };
+
+    Log::Comment(L"ASCII, delimiters, a non-ASCII delimiter and wide glyphs");
+    write(row, L"foo.bar  baz\x2502qux \x304b\x304b(x)", 0);
+    write(row, L"end\twith::tab", 55);
+
+    std::array<uint64_t, 2> regular{};
+    std::array<uint64_t, 2> control{};
+    row.GetDelimiterClasses(delimiters, regular, control);
+
+    for (til::CoordType col = 0; col < 70; ++col)
+    {
+        const auto bit = uint64_t{ 1 } << (col & 63);
+        const auto isRegular = (til::at(regular, col >> 6) & bit) != 0;
+        const auto isControl = (til::at(control, col >> 6) & bit) != 0;
+        const auto expected = row.DelimiterClassAt(col, delimiters);
+
+        VERIFY_IS_FALSE(isRegular && isControl);
+        VERIFY_ARE_EQUAL(expected == DelimiterClass::RegularChar, isRegular, NoThrowString().Format(L"column %d", col));
+        VERIFY_ARE_EQUAL(expected == DelimiterClass::ControlChar, isControl, NoThrowString().Format(L"column %d", col));
+    }
+}
+
+void RowTests::GlyphIterator()
+{
+    TestRow r{ 10 };
+    auto& row = r.row;
+
+    // " ab" followed by a wide glyph at columns 3-4 and "c", with "b" and the wide glyph in red.
+    row.Reset(TextAttribute{});
+    write(row, L"ab\x304b" L"c", 1);
+    TextAttribute red;
+    red.SetForeground(TextColor{ TextColor::DARK_RED, false });
+    row.ReplaceAttributes(2, 5, red);
+
+    struct Glyph
+    {
+        std::wstring_view text;
+        til::CoordType begin;
+        til::CoordType end;
+        til::CoordType column;
+        bool red;
+    };
+    const auto collect = [&](til::CoordType columnBegin, til::CoordType columnEnd) {
+        std::vector<Glyph> glyphs;
+        RowGlyphIterator it{ row, columnBegin, columnEnd };
+        while (it.Next())
+        {
+            glyphs.emplace_back(Glyph{ it.Text(), it.ColumnBegin(), it.ColumnEnd(), it.Column(), it.Attr() == red });
+        }
+        return glyphs;
+    };
+    const auto verify = [](const Glyph& actual, const Glyph& expected) {
+        VERIFY_ARE_EQUAL(expected.text, actual.text);
+        VERIFY_ARE_EQUAL(expected.begin, actual.begin);
+        VERIFY_ARE_EQUAL(expected.end, actual.end);
+        VERIFY_ARE_EQUAL(expected.column, actual.column);
+        VERIFY_ARE_EQUAL(expected.red, actual.red);
+    };
+
+    Log::Comment(L"The entire row yields 1 glyph per narrow and wide glyph");
+    auto glyphs = collect(0, 10);
+    VERIFY_ARE_EQUAL(size_t{ 9 }, glyphs.size());
+    verify(glyphs[0], { L" ", 0, 1, 0, false });
+    verify(glyphs[1], { L"a", 1, 2, 1, false });
+    verify(glyphs[2], { L"b", 2, 3, 2, true });
+    verify(glyphs[3], { L"\x304b", 3, 5, 3, true });
+    verify(glyphs[4], { L"c", 5, 6, 5, false });
+    verify(glyphs[8], { L" ", 9, 10, 9, false });
+
+    Log::Comment(L"Starting at a trailing half yields the whole wide glyph, but the column within the range");
+    glyphs = collect(4, 6);
+    VERIFY_ARE_EQUAL(size_t{ 2 }, glyphs.size());
+    verify(glyphs[0], { L"\x304b", 3, 5, 4, true });
+    verify(glyphs[1], { L"c", 5, 6, 5, false });
+
+    Log::Comment(L"Ending at a leading half yields the whole wide glyph");
+    glyphs = collect(2, 4);
+    VERIFY_ARE_EQUAL(size_t{ 2 }, glyphs.size());
+    verify(glyphs[1], { L"\x304b", 3, 5, 3, true });
+
+    Log::Comment(L"Empty and out of bounds ranges yield nothing");
+    VERIFY_ARE_EQUAL(size_t{ 0 }, collect(5, 5).size());
+    VERIFY_ARE_EQUAL(size_t{ 0 }, collect(10, 20).size());
+}
+
+void RowTests::ContentHash()
+{
+    TestRow r{ 10 };
+    auto& row = r.row;
+    row.Reset(TextAttribute{});
+    write(row, L"abc", 0);
+    const auto hash = row.GetContentHash();
+    const auto revision = row.GetRevision();
+
+    Log::Comment(L"Overwriting a row with the same contents changes its revision, but not its hash");
+    write(row, L"abc", 0);
+    VERIFY_ARE_NOT_EQUAL(revision, row.GetRevision());
+    VERIFY_ARE_EQUAL(hash, row.GetContentHash());
+
+    Log::Comment(L"Changes to the text, attributes and flags change the hash");
+    write(row, L"abd", 0);
+    VERIFY_ARE_NOT_EQUAL(hash, row.GetContentHash());
+    write(row, L"abc", 0);
+    VERIFY_ARE_EQUAL(hash, row.GetContentHash());
+
+    TextAttribute red;
+    red.SetForeground(TextColor{ TextColor::DARK_RED, false });
+    row.ReplaceAttributes(1, 2, red);
+    VERIFY_ARE_NOT_EQUAL(hash, row.GetContentHash());
+    row.ReplaceAttributes(1, 2, TextAttribute{});
+    VERIFY_ARE_EQUAL(hash, row.GetContentHash());
+
+    row.SetWrapForced(true);
+    VERIFY_ARE_NOT_EQUAL(hash, row.GetContentHash());
+    row.SetWrapForced(false);
+    VERIFY_ARE_EQUAL(hash, row.GetContentHash());
+}
+
+void RowTests::MeasureRightCache()
+{
+    TestRow r{ 10 };
+    auto& row = r.row;
+    row.Reset(TextAttribute{});
+    VERIFY_ARE_EQUAL(0, row.MeasureRight());
+    VERIFY_IS_FALSE(row.ContainsText());
+
+    Log::Comment(L"Every write invalidates the cached measurement");
+    write(row, L"abc", 2);
+    VERIFY_ARE_EQUAL(5, row.MeasureRight());
+    VERIFY_IS_TRUE(row.ContainsText());
+    write(row, L"\x304b", 6);
+    VERIFY_ARE_EQUAL(8, row.MeasureRight());
+    write(row, L"  ", 6);
+    VERIFY_ARE_EQUAL(5, row.MeasureRight());
+    row.ClearCell(4);
+    VERIFY_ARE_EQUAL(4, row.MeasureRight());
+
+    Log::Comment(L"Reset() makes the row blank again");
+    row.Reset(TextAttribute{});
+    VERIFY_ARE_EQUAL(0, row.MeasureRight());
+    VERIFY_IS_FALSE(row.ContainsText());
+}
+
@@ -43,6 +43,7 @@ namespace SettingsModelLocalTests
         TEST_METHOD(UnbindKeybindings);
         TEST_METHOD(LayerScancodeKeybindings);
         TEST_METHOD(TestExplicitUnbind);
+        TEST_METHOD(TestFlattenedKeyChordLookup);
         TEST_METHOD(TestArbitraryArgs);
         TEST_METHOD(TestSplitPaneArgs);
         TEST_METHOD(TestStringOverload);
@@ -267,6 +268,61 @@ namespace SettingsModelLocalTests
         VERIFY_IS_FALSE(actionMap->IsKeyChordExplicitlyUnbound(keyChord));
     }
 
+    void KeyBindingsTests::TestFlattenedKeyChordLookup()
+    {
+        const std::string parentString{ R"([
+            { "command": "copy", "keys": ["ctrl+c"] },
+            { "command": "paste", "keys": ["ctrl+v"] }
+        ])" };
+        const std::string childString{ R"([
+            { "command": "unbound", "keys": ["ctrl+v"] },
+            { "command": "newTab", "keys": ["ctrl+t"] }
+        ])" };
+
+        const auto parentJson = VerifyParseSucceeded(parentString);
+        const auto childJson = VerifyParseSucceeded(childString);
+
+        const KeyChord ctrlC{ VirtualKeyModifiers::Control, static_cast<int32_t>('C'), 0 };
+        const KeyChord ctrlV{ VirtualKeyModifiers::Control, static_cast<int32_t>('V'), 0 };
+        const KeyChord ctrlT{ VirtualKeyModifiers::Control, static_cast<int32_t>('T'), 0 };
+        const KeyChord ctrlX{ VirtualKeyModifiers::Control, static_cast<int32_t>('X'), 0 };
+
+        auto parentMap = winrt::make_self<implementation::ActionMap>();
+        parentMap->LayerJson(parentJson);
+        auto actionMap = winrt::make_self<implementation::ActionMap>();
+        actionMap->LayerJson(childJson);
+        actionMap->AddLeastImportantParent(parentMap);
+
+        for (const auto flattened : { false, true })
+        {
+            Log::Comment(flattened ? L"With the flattened lookup table" : L"Walking the inheritance chain");
+            if (flattened)
+            {
+                actionMap->_RefreshKeyChordLookup();
+            }
+            VERIFY_ARE_EQUAL(flattened, actionMap->_KeyChordLookupCache.has_value());
+
+            const auto copyCmd = actionMap->GetActionByKeyChord(ctrlC);
+            VERIFY_IS_NOT_NULL(copyCmd);
+            VERIFY_ARE_EQUAL(ShortcutAction::CopyText, copyCmd.ActionAndArgs().Action());
+
+            const auto newTabCmd = actionMap->GetActionByKeyChord(ctrlT);
+            VERIFY_IS_NOT_NULL(newTabCmd);
+            VERIFY_ARE_EQUAL(ShortcutAction::NewTab, newTabCmd.ActionAndArgs().Action());
+
+            VERIFY_IS_NULL(actionMap->GetActionByKeyChord(ctrlV));
+            VERIFY_IS_TRUE(actionMap->IsKeyChordExplicitlyUnbound(ctrlV));
+
+            VERIFY_IS_NULL(actionMap->GetActionByKeyChord(ctrlX));
+            VERIFY_IS_FALSE(actionMap->IsKeyChordExplicitlyUnbound(ctrlX));
+        }
+
+        Log::Comment(L"Adding an action invalidates the lookup table");
+        actionMap->LayerJson(parentJson);
+        VERIFY_IS_FALSE(actionMap->_KeyChordLookupCache.has_value());
+        VERIFY_IS_NOT_NULL(actionMap->GetActionByKeyChord(ctrlV));
+    }
+
     void KeyBindingsTests::TestArbitraryArgs()
     {
         const std::string bindings0String{ R"([
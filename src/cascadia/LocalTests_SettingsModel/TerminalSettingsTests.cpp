@@ -41,6 +41,7 @@ namespace SettingsModelLocalTests
         TEST_METHOD(NormalizeCommandLine);
         TEST_METHOD(GetProfileForArgsWithCommandline);
         TEST_METHOD(MakeSettingsForProfile);
+        TEST_METHOD(MakeSettingsForProfileIsCached);
         TEST_METHOD(MakeSettingsForDefaultProfileThatDoesntExist);
         TEST_METHOD(TestLayerProfileOnColorScheme);
         TEST_METHOD(TestCommandlineToTitlePromotion);
@@ -657,6 +658,47 @@ namespace SettingsModelLocalTests
         }
     }
 
+    void TerminalSettingsTests::MakeSettingsForProfileIsCached()
+    {
+        // Test that the settings resolved from a profile are shared between
+        // terminals, but that per-terminal overrides don't leak into each other.
+        static constexpr std::string_view settingsString{ R"(
+        {
+            "defaultProfile": "{6239a42c-1111-49a3-80bd-e8fdd045185c}",
+            "profiles": [
+                {
+                    "name" : "profile0",
+                    "guid": "{6239a42c-1111-49a3-80bd-e8fdd045185c}",
+                    "historySize": 1,
+                    "commandline": "cmd.exe"
+                }
+            ]
+        })" };
+        const auto settings = winrt::make_self<implementation::CascadiaSettings>(settingsString);
+        const auto profile = settings->FindProfile(::Microsoft::Console::Utils::GuidFromString(L"{6239a42c-1111-49a3-80bd-e8fdd045185c}"));
+
+        const auto terminalSettings0{ TerminalSettings::CreateWithProfile(*settings, profile, nullptr) };
+        const auto terminalSettings1{ TerminalSettings::CreateWithProfile(*settings, profile, nullptr) };
+        const auto impl0 = winrt::get_self<implementation::TerminalSettings>(terminalSettings0.DefaultSettings());
+        const auto impl1 = winrt::get_self<implementation::TerminalSettings>(terminalSettings1.DefaultSettings());
+        VERIFY_ARE_NOT_EQUAL(impl0, impl1);
+        VERIFY_ARE_EQUAL(1u, impl0->Parents().size());
+        VERIFY_ARE_EQUAL(1u, impl1->Parents().size());
+        VERIFY_ARE_EQUAL(impl0->Parents()[0], impl1->Parents()[0]);
+
+        terminalSettings0.DefaultSettings().Commandline(L"pwsh.exe");
+        VERIFY_ARE_EQUAL(L"pwsh.exe", terminalSettings0.DefaultSettings().Commandline());
+        VERIFY_ARE_EQUAL(L"cmd.exe", terminalSettings1.DefaultSettings().Commandline());
+        VERIFY_ARE_EQUAL(1, terminalSettings1.DefaultSettings().HistorySize());
+
+        Log::Comment(L"Reloading the settings must not reuse the cached settings");
+        const auto reloaded = winrt::make_self<implementation::CascadiaSettings>(settingsString);
+        const auto reloadedProfile = reloaded->FindProfile(profile.Guid());
+        const auto terminalSettings2{ TerminalSettings::CreateWithProfile(*reloaded, reloadedProfile, nullptr) };
+        const auto impl2 = winrt::get_self<implementation::TerminalSettings>(terminalSettings2.DefaultSettings());
+        VERIFY_ARE_NOT_EQUAL(impl0->Parents()[0], impl2->Parents()[0]);
+    }
+
     void TerminalSettingsTests::MakeSettingsForDefaultProfileThatDoesntExist()
     {
         // Test that MakeSettings _doesnt_ throw when we load settings with a
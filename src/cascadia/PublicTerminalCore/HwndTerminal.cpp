@@ -12,6 +12,9 @@ using namespace ::Microsoft::Terminal::Core;
 
 static LPCWSTR term_window_class = L"HwndTerminalClass";
 
+// Set through TerminalSetUseAtlasEngine() and applies to all terminals created afterwards.
+static std::atomic<bool> s_useAtlasEngine{ false };
+
 // This magic flag is "documented" at https://msdn.microsoft.com/en-us/library/windows/desktop/ms646301(v=vs.85).aspx
 // "If the high-order bit is 1, the key is down; otherwise, it is up."
 static constexpr short KeyPressed{ gsl::narrow_cast<short>(0x8000) };
@@ -106,8 +109,10 @@ try
             {
                 try
                 {
-                    const auto bufferData = termCore->RetrieveSelectedTextFromBuffer(false);
-                    LOG_IF_FAILED(terminal->_CopyTextToSystemClipboard(bufferData, true));
+                    const auto& fontData = terminal->_actualFont;
+                    const int iFontHeightPoints = fontData.GetUnscaledSize().height; // this renderer uses points already
+                    const auto data = termCore->RetrieveSelectionForClipboard(false, true, true, iFontHeightPoints, fontData.GetFaceName());
+                    LOG_IF_FAILED(terminal->_CopyTextToSystemClipboard(data, true));
                     TerminalClearSelection(terminal);
                 }
                 CATCH_LOG();
@@ -204,10 +209,18 @@ HRESULT HwndTerminal::Initialize()
     RETURN_HR_IF_NULL(E_POINTER, localPointerToThread);
     RETURN_IF_FAILED(localPointerToThread->Initialize(_renderer.get()));
 
-    auto dxEngine = std::make_unique<::Microsoft::Console::Render::DxEngine>();
-    RETURN_IF_FAILED(dxEngine->SetHwnd(_hwnd.get()));
-    RETURN_IF_FAILED(dxEngine->Enable());
-    _renderer->AddRenderEngine(dxEngine.get());
+    std::unique_ptr<::Microsoft::Console::Render::IRenderEngine> renderEngine;
+    if (s_useAtlasEngine.load(std::memory_order_relaxed))
+    {
+        renderEngine = std::make_unique<::Microsoft::Console::Render::AtlasEngine>();
+    }
+    else
+    {
+        renderEngine = std::make_unique<::Microsoft::Console::Render::DxEngine>();
+    }
+    RETURN_IF_FAILED(renderEngine->SetHwnd(_hwnd.get()));
+    RETURN_IF_FAILED(renderEngine->Enable());
+    _renderer->AddRenderEngine(renderEngine.get());
 
     _UpdateFont(USER_DEFAULT_SCREEN_DPI);
     RECT windowRect;
@@ -215,12 +228,12 @@ HRESULT HwndTerminal::Initialize()
 
     const til::size windowSize{ windowRect.right - windowRect.left, windowRect.bottom - windowRect.top };
 
-    // Fist set up the dx engine with the window size in pixels.
+    // Fist set up the render engine with the window size in pixels.
     // Then, using the font, get the number of characters that can fit.
     const auto viewInPixels = Viewport::FromDimensions({ 0, 0 }, windowSize);
-    RETURN_IF_FAILED(dxEngine->SetWindowSize({ viewInPixels.Width(), viewInPixels.Height() }));
+    RETURN_IF_FAILED(renderEngine->SetWindowSize({ viewInPixels.Width(), viewInPixels.Height() }));
 
-    _renderEngine = std::move(dxEngine);
+    _renderEngine = std::move(renderEngine);
 
     _terminal->Create({ 80, 25 }, 9001, *_renderer);
     _terminal->SetWriteInputCallback([=](std::wstring_view input) noexcept { _WriteTextToConnection(input); });
@@ -413,6 +426,34 @@ void _stdcall TerminalSendOutput(void* terminal, LPCWSTR data)
     publicTerminal->SendOutput(data);
 }
 
+/// <summary>
+/// Writes the given text to the terminal, like TerminalSendOutput, but with an explicit length.
+/// The text doesn't need to be null-terminated and may contain null characters. Callers that
+/// receive their output in many small chunks should concatenate them and send them at once,
+/// because each call acquires the terminal lock once and the renderer then paints them together.
+/// </summary>
+/// <param name="terminal">Terminal pointer.</param>
+/// <param name="data">The text to write.</param>
+/// <param name="length">The length of data in characters.</param>
+void _stdcall TerminalSendOutputBuffer(void* terminal, const wchar_t* data, size_t length)
+{
+    if (!data || !length)
+    {
+        return;
+    }
+    const auto publicTerminal = static_cast<HwndTerminal*>(terminal);
+    publicTerminal->SendOutput({ data, length });
+}
+
+/// <summary>
+/// Selects whether terminals created from now on render with AtlasEngine instead of DxEngine.
+/// </summary>
+/// <param name="useAtlasEngine">True to use AtlasEngine.</param>
+void _stdcall TerminalSetUseAtlasEngine(bool useAtlasEngine)
+{
+    s_useAtlasEngine.store(useAtlasEngine, std::memory_order_relaxed);
+}
+
 /// <summary>
 /// Triggers a terminal resize using the new width and height in pixel.
 /// </summary>
@@ -633,16 +674,9 @@ const wchar_t* _stdcall TerminalGetSelection(void* terminal)
         return nullptr;
     }
 
-    const auto bufferData = publicTerminal->_terminal->RetrieveSelectedTextFromBuffer(false);
+    const auto selectedText = publicTerminal->_terminal->RetrieveSelectionForClipboard(false, false, false, 0, {}).plain;
     publicTerminal->_ClearSelection();
 
-    // convert text: vector<string> --> string
-    std::wstring selectedText;
-    for (const auto& text : bufferData.text)
-    {
-        selectedText += text;
-    }
-
     auto returnText = wil::make_cotaskmem_string_nothrow(selectedText.c_str());
     return returnText.release();
 }
@@ -879,19 +913,13 @@ void __stdcall TerminalKillFocus(void* terminal)
 // Routine Description:
 // - Copies the text given onto the global system clipboard.
 // Arguments:
-// - rows - Rows of text data to copy
+// - data - The selection, as returned by Terminal::RetrieveSelectionForClipboard()
 // - fAlsoCopyFormatting - true if the color and formatting should also be copied, false otherwise
-HRESULT HwndTerminal::_CopyTextToSystemClipboard(const TextBuffer::TextAndColor& rows, const bool fAlsoCopyFormatting)
+HRESULT HwndTerminal::_CopyTextToSystemClipboard(const ::Microsoft::Terminal::Core::Terminal::SelectionForClipboard& data, const bool fAlsoCopyFormatting)
 try
 {
     RETURN_HR_IF_NULL(E_NOT_VALID_STATE, _terminal);
-    std::wstring finalString;
-
-    // Concatenate strings into one giant string to put onto the clipboard.
-    for (const auto& str : rows.text)
-    {
-        finalString += str;
-    }
+    const auto& finalString = data.plain;
 
     // allocate the final clipboard data
     const auto cchNeeded = finalString.size() + 1;
@@ -921,15 +949,8 @@ try
 
         if (fAlsoCopyFormatting)
         {
-            const auto& fontData = _actualFont;
-            const int iFontHeightPoints = fontData.GetUnscaledSize().height; // this renderer uses points already
-            const auto bgColor = _terminal->GetAttributeColors({}).second;
-
-            auto HTMLToPlaceOnClip = TextBuffer::GenHTML(rows, iFontHeightPoints, fontData.GetFaceName(), bgColor);
-            _CopyToSystemClipboard(HTMLToPlaceOnClip, L"HTML Format");
-
-            auto RTFToPlaceOnClip = TextBuffer::GenRTF(rows, iFontHeightPoints, fontData.GetFaceName(), bgColor);
-            _CopyToSystemClipboard(RTFToPlaceOnClip, L"Rich Text Format");
+            _CopyToSystemClipboard(data.html, L"HTML Format");
+            _CopyToSystemClipboard(data.rtf, L"Rich Text Format");
         }
     }
 
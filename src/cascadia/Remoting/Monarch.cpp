@@ -102,6 +102,7 @@ namespace winrt::Microsoft::Terminal::Remoting::implementation
             {
                 std::unique_lock lock{ _peasantsMutex };
                 _peasants[newPeasantsId] = peasant;
+                _peasantNames[newPeasantsId] = peasant.WindowName();
             }
 
             TraceLoggingWrite(g_hRemotingProvider,
@@ -206,6 +207,7 @@ namespace winrt::Microsoft::Terminal::Remoting::implementation
         {
             std::unique_lock lock{ _peasantsMutex };
             _peasants.erase(peasantId);
+            _peasantNames.erase(peasantId);
         }
         _WindowClosedHandlers(nullptr, nullptr);
     }
@@ -275,6 +277,7 @@ namespace winrt::Microsoft::Terminal::Remoting::implementation
             {
                 std::unique_lock lock{ _peasantsMutex };
                 _peasants.erase(peasantID);
+                _peasantNames.erase(peasantID);
             }
 
             if (clearMruPeasantOnFailure)
@@ -289,8 +292,9 @@ namespace winrt::Microsoft::Terminal::Remoting::implementation
 
     // Method Description:
     // - Find the ID of the peasant with the given name. If no such peasant
-    //   exists, then we'll return 0. If we encounter any peasants who have died
-    //   during this process, then we'll remove them from the set of _peasants
+    //   exists, then we'll return 0. The name is looked up in _peasantNames,
+    //   so only the peasant with that name is asked if it's still alive. If it
+    //   died, we'll remove it from the set of _peasants and return 0.
     // Arguments:
     // - name: The window name to look for
     // Return Value:
@@ -304,26 +308,27 @@ namespace winrt::Microsoft::Terminal::Remoting::implementation
         }
 
         uint64_t result = 0;
-
-        const auto callback = [&](const auto& id, const auto& p) {
-            auto otherName = p.WindowName();
-            if (otherName == name)
+        {
+            std::shared_lock lock{ _peasantsMutex };
+            for (const auto& [id, otherName] : _peasantNames)
             {
-                result = id;
-                return false;
+                if (otherName == name)
+                {
+                    result = id;
+                    break;
+                }
             }
-            return true;
-        };
+        }
 
-        const auto onError = [&](const auto& id) {
+        if (result && !_getPeasant(result))
+        {
             TraceLoggingWrite(g_hRemotingProvider,
                               "Monarch_lookupPeasantIdForName_Failed",
-                              TraceLoggingInt64(id, "peasantID", "The ID of the peasant which we could not get the name of"),
+                              TraceLoggingInt64(result, "peasantID", "The ID of the peasant with that name, which died"),
                               TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
                               TraceLoggingKeyword(TIL_KEYWORD_TRACE));
-        };
-
-        _forEachPeasant(callback, onError);
+            result = 0;
+        }
 
         TraceLoggingWrite(g_hRemotingProvider,
                           "Monarch_lookupPeasantIdForName",
@@ -837,7 +842,7 @@ namespace winrt::Microsoft::Terminal::Remoting::implementation
     //   indicating if the request was successful.
     // Return Value:
     // - <none>
-    void Monarch::_renameRequested(const winrt::Windows::Foundation::IInspectable& /*sender*/,
+    void Monarch::_renameRequested(const winrt::Windows::Foundation::IInspectable& sender,
                                    const winrt::Microsoft::Terminal::Remoting::RenameRequestArgs& args)
     {
         auto successfullyRenamed = false;
@@ -854,6 +859,16 @@ namespace winrt::Microsoft::Terminal::Remoting::implementation
                 // be renamed.
                 args.Succeeded(true);
                 successfullyRenamed = true;
+
+                if (const auto peasant = sender.try_as<Remoting::IPeasant>())
+                {
+                    const auto peasantId = peasant.GetID();
+                    std::unique_lock lock{ _peasantsMutex };
+                    if (const auto it = _peasantNames.find(peasantId); it != _peasantNames.end())
+                    {
+                        it->second = name;
+                    }
+                }
             }
 
             TraceLoggingWrite(g_hRemotingProvider,
@@ -973,7 +988,9 @@ namespace winrt::Microsoft::Terminal::Remoting::implementation
         }
 
         const auto func = [&](const auto& id, const auto& p) -> void {
-            names.push_back({ id, p.WindowName(), p.ActiveTabTitle() });
+            // _forEachPeasant calls us while holding a shared lock on _peasantsMutex.
+            const auto it = _peasantNames.find(id);
+            names.push_back({ id, it == _peasantNames.end() ? winrt::hstring{} : it->second, p.ActiveTabTitle() });
         };
 
         const auto onError = [&](const auto& id) {
@@ -991,26 +1008,7 @@ namespace winrt::Microsoft::Terminal::Remoting::implementation
 
     bool Monarch::DoesQuakeWindowExist()
     {
-        auto result = false;
-        const auto func = [&](const auto& /*id*/, const auto& p) {
-            if (p.WindowName() == QuakeWindowName)
-            {
-                result = true;
-            }
-            // continue if we didn't get a positive result
-            return !result;
-        };
-
-        const auto onError = [&](const auto& id) {
-            TraceLoggingWrite(g_hRemotingProvider,
-                              "Monarch_DoesQuakeWindowExist_Failed",
-                              TraceLoggingInt64(id, "peasantID", "The ID of the peasant which we could not ask for its name"),
-                              TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
-                              TraceLoggingKeyword(TIL_KEYWORD_TRACE));
-        };
-
-        _forEachPeasant(func, onError);
-        return result;
+        return _lookupPeasantIdForName(QuakeWindowName) != 0;
     }
 
     void Monarch::SummonAllWindows()
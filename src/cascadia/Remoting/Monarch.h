@@ -117,6 +117,9 @@ namespace winrt::Microsoft::Terminal::Remoting::implementation
         winrt::com_ptr<IVirtualDesktopManager> _desktopManager{ nullptr };
 
         std::unordered_map<uint64_t, winrt::Microsoft::Terminal::Remoting::IPeasant> _peasants;
+        // The names of the _peasants. Looking up windows by name is a lot more common than renaming them,
+        // so we keep a copy here instead of asking every single peasant for it. Protected by _peasantsMutex.
+        std::unordered_map<uint64_t, winrt::hstring> _peasantNames;
         std::vector<Remoting::WindowActivatedArgs> _mruPeasants;
         // These should not be locked at the same time to prevent deadlocks
         // unless they are both shared_locks.
@@ -212,6 +215,7 @@ namespace winrt::Microsoft::Terminal::Remoting::implementation
                     for (const auto& id : peasantsToErase)
                     {
                         _peasants.erase(id);
+                        _peasantNames.erase(id);
                     }
                 }
                 _clearOldMruEntries(peasantsToErase);
@@ -231,6 +231,35 @@ namespace winrt::Microsoft::Terminal::Remoting::implementation
         }
     }
 
+    // Method Description:
+    // - Hands the commandline to the monarch of another Terminal process, if
+    //   there is one. Unlike ProposeCommandline(), this never makes us the monarch,
+    //   so it can be called before the settings are loaded to find out whether
+    //   this process needs them at all.
+    // - A monarch is only ever registered by a process that isn't in isolated
+    //   mode, which is why we don't need to know whether we are.
+    // Arguments:
+    // - args: the commandline of this process
+    // Return Value:
+    // - true if another process took the commandline, in which case this one is done.
+    bool WindowManager::ProposeCommandlineToExistingMonarch(const Remoting::CommandlineArgs& args)
+    {
+        _createMonarch();
+        if (!_monarch)
+        {
+            return false;
+        }
+
+        TraceLoggingWrite(g_hRemotingProvider,
+                          "WindowManager_ProposeCommandlineToExistingMonarch",
+                          TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+                          TraceLoggingKeyword(TIL_KEYWORD_TRACE));
+
+        // _proposeToMonarch resets _monarch if it fails, so that
+        // ProposeCommandline() starts from scratch afterwards.
+        return _proposeToMonarch(args);
+    }
+
     // Method Description:
     // - Helper attempting to call to the monarch multiple times. If the monarch
     //   fails to respond, or we encounter any sort of error, we'll try again
@@ -263,7 +263,7 @@ namespace winrt::TerminalApp::implementation
                 // tree. This is important, because we might be leaving zoom, and if
                 // a pane is zoomed, then it's currently in the UI tree, and should
                 // be removed before it's re-added in Pane::Restore
-                _tabContent.Children().Clear();
+                _RemoveTabContent(*activeTab);
 
                 // Togging the zoom on the tab will cause the tab to inform us of
                 // the new root Content for this tab.
@@ -557,6 +557,15 @@ namespace winrt::TerminalApp::implementation
         args.Handled(res);
     }
 
+    void TerminalPage::_HandleTogglePerformanceOverlay(const IInspectable& /*sender*/,
+                                                       const ActionEventArgs& args)
+    {
+        const auto res = _ApplyToActiveControls([](auto& control) {
+            control.TogglePerformanceOverlay();
+        });
+        args.Handled(res);
+    }
+
     void TerminalPage::_HandleToggleFocusMode(const IInspectable& /*sender*/,
                                               const ActionEventArgs& args)
     {
@@ -796,6 +805,21 @@ namespace winrt::TerminalApp::implementation
         }
     }
 
+    void TerminalPage::_HandleFindInAllPanes(const IInspectable& /*sender*/,
+                                             const ActionEventArgs& args)
+    {
+        if (const auto& realArgs = args.ActionArgs().try_as<FindInAllPanesArgs>())
+        {
+            _findInAllPanesCaseSensitive = realArgs.CaseSensitive();
+            _findInAllPanesRegularExpression = realArgs.RegularExpression();
+
+            const auto p = LoadCommandPalette();
+            p.EnableFindInAllPanesMode(realArgs.Query());
+            p.Visibility(Visibility::Visible);
+            args.Handled(true);
+        }
+    }
+
     void TerminalPage::_HandleTabSearch(const IInspectable& /*sender*/,
                                         const ActionEventArgs& args)
     {
@@ -1073,14 +1097,14 @@ namespace winrt::TerminalApp::implementation
             {
                 if (const auto& realArgs = args.ActionArgs().try_as<ExportBufferArgs>())
                 {
-                    _ExportTab(*activeTab, realArgs.Path());
+                    _ExportTab(*activeTab, realArgs.Path(), realArgs.Format());
                     args.Handled(true);
                     return;
                 }
             }
 
             // If we didn't have args, or the args weren't ExportBufferArgs (somehow)
-            _ExportTab(*activeTab, L"");
+            _ExportTab(*activeTab, L"", ExportBufferFormat::Text);
             if (args)
             {
                 args.Handled(true);
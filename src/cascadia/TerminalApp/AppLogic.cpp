@@ -8,6 +8,8 @@
 #include "FindTargetWindowResult.g.cpp"
 #include "SettingsLoadEventArgs.h"
 
+#include <future>
+
 #include <LibraryResources.h>
 #include <WtExeUtils.h>
 #include <wil/token_helpers.h>
@@ -50,6 +52,9 @@ static const std::array settingsLoadErrorsLabels{
 
 static_assert(settingsLoadErrorsLabels.size() == static_cast<size_t>(SettingsLoadErrors::ERRORS_SIZE));
 
+// See AppLogic::PreloadSettings().
+static std::future<CascadiaSettings> s_preloadedSettings;
+
 // Function Description:
 // - General-purpose helper for looking up a localized string for a
 //   warning/error. First will look for the given key in the provided map of
@@ -193,17 +198,79 @@ namespace winrt::TerminalApp::implementation
             TelemetryPrivacyDataTag(PDT_ProductAndServiceUsage));
     }
 
+    // Method Description:
+    // - Starts loading the settings on a background thread, so that parsing
+    //   them overlaps with the initialization of XAML on the main thread.
+    //   The first call to _TryLoadSettings() takes the result.
+    // - This must be called before the first AppLogic loads its settings.
+    // Arguments:
+    // - <none>
+    // Return Value:
+    // - <none>
+    void AppLogic::PreloadSettings()
+    {
+        s_preloadedSettings = std::async(std::launch::async, []() {
+            return CascadiaSettings::LoadAll();
+        });
+    }
+
+    // Method Description:
+    // - Returns the settings that PreloadSettings() loaded, waiting for them if necessary.
+    //   If there are none, or they failed to load, the caller loads them itself instead,
+    //   which also gets it the error information to present to the user.
+    // Return Value:
+    // - The preloaded settings, or nullptr.
+    CascadiaSettings AppLogic::_TakePreloadedSettings() noexcept
+    try
+    {
+        if (!s_preloadedSettings.valid())
+        {
+            return nullptr;
+        }
+
+        auto settings = s_preloadedSettings.get();
+        if (settings.GetLoadingError() || !settings.GetSerializationErrorMessage().empty())
+        {
+            return nullptr;
+        }
+        return settings;
+    }
+    catch (...)
+    {
+        LOG_CAUGHT_EXCEPTION();
+        return nullptr;
+    }
+
     // Method Description:
     // - Attempt to load the settings. If we fail for any reason, returns an error.
     // Return Value:
     // - S_OK if we successfully parsed the settings, otherwise an appropriate HRESULT.
     [[nodiscard]] HRESULT AppLogic::_TryLoadSettings() noexcept
     {
+        TraceLoggingWrite(g_hTerminalAppProvider,
+                          "SettingsLoad",
+                          TraceLoggingDescription("Loading the settings"),
+                          TraceLoggingOpcode(WINEVENT_OPCODE_START),
+                          TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+                          TraceLoggingKeyword(TIL_KEYWORD_TRACE));
+        const auto stop = wil::scope_exit([]() noexcept {
+            TraceLoggingWrite(g_hTerminalAppProvider,
+                              "SettingsLoad",
+                              TraceLoggingDescription("Loading the settings"),
+                              TraceLoggingOpcode(WINEVENT_OPCODE_STOP),
+                              TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+                              TraceLoggingKeyword(TIL_KEYWORD_TRACE));
+        });
+
         auto hr = E_FAIL;
 
         try
         {
-            auto newSettings = CascadiaSettings::LoadAll();
+            auto newSettings = _TakePreloadedSettings();
+            if (!newSettings)
+            {
+                newSettings = CascadiaSettings::LoadAll();
+            }
 
             if (newSettings.GetLoadingError())
             {
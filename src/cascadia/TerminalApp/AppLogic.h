@@ -72,7 +72,8 @@ namespace winrt::TerminalApp::implementation
 
         winrt::TerminalApp::ContentManager ContentManager();
 
-        TerminalApp::ParseCommandlineResult GetParseCommandlineMessage(array_view<const winrt::hstring> args);
+        static TerminalApp::ParseCommandlineResult GetParseCommandlineMessage(array_view<const winrt::hstring> args);
+        static void PreloadSettings();
 
         TYPED_EVENT(SettingsChanged, winrt::Windows::Foundation::IInspectable, winrt::TerminalApp::SettingsLoadEventArgs);
 
@@ -108,6 +109,7 @@ namespace winrt::TerminalApp::implementation
         void _ApplyLanguageSettingChange() noexcept;
         fire_and_forget _ApplyStartupTaskStateChange();
 
+        static Microsoft::Terminal::Settings::Model::CascadiaSettings _TakePreloadedSettings() noexcept;
         [[nodiscard]] HRESULT _TryLoadSettings() noexcept;
         void _ProcessLazySettingsChanges();
         void _RegisterSettingsChange();
@@ -5,6 +5,7 @@
 #include "ActionPaletteItem.h"
 #include "TabPaletteItem.h"
 #include "CommandLinePaletteItem.h"
+#include "SearchResultPaletteItem.h"
 #include "CommandPalette.h"
 #include <LibraryResources.h>
 
@@ -36,6 +37,7 @@ namespace winrt::TerminalApp::implementation
         _allCommands = winrt::single_threaded_vector<winrt::TerminalApp::FilteredCommand>();
         _tabActions = winrt::single_threaded_vector<winrt::TerminalApp::FilteredCommand>();
         _mruTabActions = winrt::single_threaded_vector<winrt::TerminalApp::FilteredCommand>();
+        _searchResultActions = winrt::single_threaded_vector<winrt::TerminalApp::FilteredCommand>();
 
         _switchToMode(CommandPaletteMode::ActionMode);
 
@@ -535,7 +537,7 @@ namespace winrt::TerminalApp::implementation
         // We don't care about...
         // - CommandlineMode: it doesn't have any selectable items in the list view
         // - TabSwitchMode: focus and selected item are in sync
-        if (_currentMode == CommandPaletteMode::ActionMode || _currentMode == CommandPaletteMode::TabSearchMode)
+        if (_currentMode == CommandPaletteMode::ActionMode || _currentMode == CommandPaletteMode::TabSearchMode || _currentMode == CommandPaletteMode::FindInAllPanesMode)
         {
             if (auto automationPeer{ Automation::Peers::FrameworkElementAutomationPeer::FromElement(_searchBox()) })
             {
@@ -587,6 +589,7 @@ namespace winrt::TerminalApp::implementation
         else
         {
             ParentCommandName(L"");
+            _lastFilterSource = nullptr;
             _currentNestedCommands.Clear();
         }
         _updateFilteredActions();
@@ -657,6 +660,8 @@ namespace winrt::TerminalApp::implementation
             return _tabSwitcherMode == TabSwitcherMode::MostRecentlyUsed ? _mruTabActions : _tabActions;
         case CommandPaletteMode::CommandlineMode:
             return _loadRecentCommands();
+        case CommandPaletteMode::FindInAllPanesMode:
+            return _searchResultActions;
         default:
             return _allCommands;
         }
@@ -682,6 +687,11 @@ namespace winrt::TerminalApp::implementation
             _switchToTab(filteredCommand);
             _close();
         }
+        else if (_currentMode == CommandPaletteMode::FindInAllPanesMode)
+        {
+            _jumpToSearchResult(filteredCommand);
+            _close();
+        }
         else if (filteredCommand)
         {
             if (const auto actionPaletteItem{ filteredCommand.Item().try_as<winrt::TerminalApp::ActionPaletteItem>() })
@@ -774,6 +784,23 @@ namespace winrt::TerminalApp::implementation
         }
     }
 
+    // Method Description:
+    // - Dispatch a jump to the match of a "find in all panes" search.
+    // Arguments:
+    // - filteredCommand - Selected filtered command - might be null
+    // Return Value:
+    // - <none>
+    void CommandPalette::_jumpToSearchResult(const winrt::TerminalApp::FilteredCommand& filteredCommand)
+    {
+        if (filteredCommand)
+        {
+            if (const auto searchResultPaletteItem{ filteredCommand.Item().try_as<winrt::TerminalApp::SearchResultPaletteItem>() })
+            {
+                _JumpToSearchResultRequestedHandlers(*this, searchResultPaletteItem);
+            }
+        }
+    }
+
     // Method Description:
     // - Dispatch the current search text as a ExecuteCommandline action.
     // Arguments:
@@ -847,6 +874,16 @@ namespace winrt::TerminalApp::implementation
         {
             _evaluatePrefix();
         }
+        else if (_currentMode == CommandPaletteMode::FindInAllPanesMode)
+        {
+            // The search text is the query, so any change makes the matches we have outdated.
+            if (const auto query = _searchBox().Text(); query != _findInAllPanesQuery)
+            {
+                _findInAllPanesQuery = query;
+                _searchResultActions.Clear();
+                _FindInAllPanesRequestedHandlers(*this, query);
+            }
+        }
 
         // We're setting _lastFilterTextWasEmpty here, because if the user tries
         // to backspace the last character in the input, the Backspace KeyDown
@@ -944,6 +981,7 @@ namespace winrt::TerminalApp::implementation
 
     void CommandPalette::SetCommands(const Collections::IVector<Command>& actions)
     {
+        _lastFilterSource = nullptr;
         _allCommands.Clear();
         for (const auto& action : actions)
         {
@@ -999,6 +1037,14 @@ namespace winrt::TerminalApp::implementation
 
     void CommandPalette::_switchToMode(CommandPaletteMode mode)
     {
+        // Stop a "find in all panes" search that's still running.
+        _searchResultActions.Clear();
+        if (!_findInAllPanesQuery.empty())
+        {
+            _findInAllPanesQuery = {};
+            _FindInAllPanesRequestedHandlers(*this, _findInAllPanesQuery);
+        }
+
         _currentMode = mode;
 
         const auto currentlyVisible{ Visibility() == Visibility::Visible };
@@ -1010,6 +1056,7 @@ namespace winrt::TerminalApp::implementation
 
         _nestedActionStack.Clear();
         ParentCommandName(L"");
+        _lastFilterSource = nullptr;
         _currentNestedCommands.Clear();
         // Leaving this block of code outside the above if-statement
         // guarantees that the correct text is shown for the mode
@@ -1033,6 +1080,13 @@ namespace winrt::TerminalApp::implementation
             PrefixCharacter(L"");
             modeAnnouncementResourceKey = USES_RESOURCE(L"CommandPaletteModeAnnouncement_CommandlineMode");
             break;
+        case CommandPaletteMode::FindInAllPanesMode:
+            SearchBoxPlaceholderText(RS_(L"FindInAllPanes_SearchBoxText"));
+            NoMatchesText(L"");
+            ControlName(RS_(L"FindInAllPanesControlName"));
+            PrefixCharacter(L"");
+            modeAnnouncementResourceKey = USES_RESOURCE(L"CommandPaletteModeAnnouncement_FindInAllPanesMode");
+            break;
         case CommandPaletteMode::ActionMode:
         default:
             SearchBoxPlaceholderText(RS_(L"CommandPalette_SearchBox/PlaceholderText"));
@@ -1079,14 +1133,14 @@ namespace winrt::TerminalApp::implementation
 
         auto commandsToFilter = _commandsToFilter();
 
-        if (_currentMode == CommandPaletteMode::TabSwitchMode)
+        // The matches of "find in all panes" have already been filtered by the search text.
+        if (_currentMode == CommandPaletteMode::TabSwitchMode || _currentMode == CommandPaletteMode::FindInAllPanesMode)
         {
             std::copy(begin(commandsToFilter), end(commandsToFilter), std::back_inserter(actions));
         }
         else if (_currentMode == CommandPaletteMode::TabSearchMode || _currentMode == CommandPaletteMode::ActionMode || _currentMode == CommandPaletteMode::CommandlineMode)
         {
-            for (const auto& action : commandsToFilter)
-            {
+            const auto filter = [&](const auto& action) {
                 // Update filter for all commands
                 // This will modify the highlighting but will also lead to re-computation of weight (and consequently sorting).
                 // Pay attention that it already updates the highlighting in the UI
@@ -1097,6 +1151,23 @@ namespace winrt::TerminalApp::implementation
                 {
                     actions.push_back(action);
                 }
+            };
+
+            // FilteredCommand matches the search text as a subsequence of the name. Anything
+            // that matches the current search text thus also matched any prefix of it. While
+            // the user keeps typing we only need to look at the commands that matched before.
+            // Only the action mode's commands are owned by us, so that we know when they change.
+            if (_currentMode == CommandPaletteMode::ActionMode &&
+                _lastFilterSource == commandsToFilter &&
+                til::starts_with(std::wstring_view{ searchText }, std::wstring_view{ _lastFilterText }))
+            {
+                const auto candidates = std::move(_lastFilterMatches);
+                actions.reserve(candidates.size());
+                std::for_each(candidates.begin(), candidates.end(), filter);
+            }
+            else
+            {
+                std::for_each(begin(commandsToFilter), end(commandsToFilter), filter);
             }
         }
 
@@ -1104,6 +1175,10 @@ namespace winrt::TerminalApp::implementation
         if (_currentMode == CommandPaletteMode::ActionMode)
         {
             std::sort(actions.begin(), actions.end(), FilteredCommand::Compare);
+
+            _lastFilterSource = commandsToFilter;
+            _lastFilterText = searchText;
+            _lastFilterMatches = actions;
         }
 
         return actions;
@@ -1164,6 +1239,7 @@ namespace winrt::TerminalApp::implementation
     // - <none>
     void CommandPalette::_updateCurrentNestedCommands(const winrt::Microsoft::Terminal::Settings::Model::Command& parentCommand)
     {
+        _lastFilterSource = nullptr;
         _currentNestedCommands.Clear();
         for (const auto& nameAndCommand : parentCommand.NestedCommands())
         {
@@ -1198,6 +1274,7 @@ namespace winrt::TerminalApp::implementation
         _nestedActionStack.Clear();
 
         ParentCommandName(L"");
+        _lastFilterSource = nullptr;
         _currentNestedCommands.Clear();
     }
 
@@ -1216,6 +1293,44 @@ namespace winrt::TerminalApp::implementation
         _switchToMode(CommandPaletteMode::TabSearchMode);
     }
 
+    // Method Description:
+    // - Turns the search box into the query of a "find in all panes" search.
+    //   Each change raises FindInAllPanesRequested, in response to which the
+    //   page is expected to call AddSearchResults() as the matches come in.
+    // Arguments:
+    // - query: the initial text to search for
+    // Return Value:
+    // - <none>
+    void CommandPalette::EnableFindInAllPanesMode(const winrt::hstring& query)
+    {
+        _switchToMode(CommandPaletteMode::FindInAllPanesMode);
+        _searchBox().Text(query);
+        _searchBox().Select(query.size(), 0);
+    }
+
+    // Method Description:
+    // - Appends matches to the results of the current "find in all panes" search.
+    // Arguments:
+    // - results: the matches of one pane
+    // Return Value:
+    // - <none>
+    void CommandPalette::AddSearchResults(const Collections::IVector<winrt::TerminalApp::SearchResultPaletteItem>& results)
+    {
+        for (const auto& result : results)
+        {
+            _searchResultActions.Append(winrt::make<FilteredCommand>(result));
+        }
+
+        if (Visibility() == Visibility::Visible && _currentMode == CommandPaletteMode::FindInAllPanesMode)
+        {
+            _updateFilteredActions();
+            if (_filteredActionsView().SelectedIndex() < 0 && _filteredActions.Size() > 0)
+            {
+                _filteredActionsView().SelectedIndex(0);
+            }
+        }
+    }
+
     // Method Description:
     // - This event is triggered when filteredActionView is looking for item container (ListViewItem)
     // to use to present the filtered actions.
@@ -22,7 +22,8 @@ namespace winrt::TerminalApp::implementation
         ActionMode = 0,
         TabSearchMode,
         TabSwitchMode,
-        CommandlineMode
+        CommandlineMode,
+        FindInAllPanesMode
     };
 
     struct CommandPalette : CommandPaletteT<CommandPalette>
@@ -47,6 +48,9 @@ namespace winrt::TerminalApp::implementation
         void EnableCommandPaletteMode(Microsoft::Terminal::Settings::Model::CommandPaletteLaunchMode const launchMode);
         void EnableTabSwitcherMode(const uint32_t startIdx, Microsoft::Terminal::Settings::Model::TabSwitcherMode tabSwitcherMode);
         void EnableTabSearchMode();
+        void EnableFindInAllPanesMode(const winrt::hstring& query);
+
+        void AddSearchResults(const Windows::Foundation::Collections::IVector<winrt::TerminalApp::SearchResultPaletteItem>& results);
 
         WINRT_CALLBACK(PropertyChanged, Windows::UI::Xaml::Data::PropertyChangedEventHandler);
         WINRT_OBSERVABLE_PROPERTY(winrt::hstring, NoMatchesText, _PropertyChangedHandlers);
@@ -57,6 +61,8 @@ namespace winrt::TerminalApp::implementation
         WINRT_OBSERVABLE_PROPERTY(winrt::hstring, ParsedCommandLineText, _PropertyChangedHandlers);
 
         TYPED_EVENT(SwitchToTabRequested, winrt::TerminalApp::CommandPalette, winrt::TerminalApp::TabBase);
+        TYPED_EVENT(FindInAllPanesRequested, winrt::TerminalApp::CommandPalette, winrt::hstring);
+        TYPED_EVENT(JumpToSearchResultRequested, winrt::TerminalApp::CommandPalette, winrt::TerminalApp::SearchResultPaletteItem);
         TYPED_EVENT(CommandLineExecutionRequested, winrt::TerminalApp::CommandPalette, winrt::hstring);
         TYPED_EVENT(DispatchCommandRequested, winrt::TerminalApp::CommandPalette, Microsoft::Terminal::Settings::Model::Command);
         TYPED_EVENT(PreviewAction, Windows::Foundation::IInspectable, Microsoft::Terminal::Settings::Model::Command);
@@ -81,6 +87,13 @@ namespace winrt::TerminalApp::implementation
 
         bool _lastFilterTextWasEmpty{ true };
 
+        // The result of the last _collectFilteredActions() in the action mode. If the search text
+        // is extended, only these need to be filtered again. Reset _lastFilterSource whenever
+        // the contents of _allCommands or _currentNestedCommands change.
+        Windows::Foundation::Collections::IVector<winrt::TerminalApp::FilteredCommand> _lastFilterSource{ nullptr };
+        winrt::hstring _lastFilterText;
+        std::vector<winrt::TerminalApp::FilteredCommand> _lastFilterMatches;
+
         void _filterTextChanged(const Windows::Foundation::IInspectable& sender,
                                 const Windows::UI::Xaml::RoutedEventArgs& args);
         void _previewKeyDownHandler(const Windows::Foundation::IInspectable& sender,
@@ -128,6 +141,10 @@ namespace winrt::TerminalApp::implementation
         Microsoft::Terminal::Settings::Model::TabSwitcherMode _tabSwitcherMode;
         uint32_t _switcherStartIdx;
 
+        // Find in all panes: the matches stream in from the TerminalPage, while the search box holds the query.
+        Windows::Foundation::Collections::IVector<winrt::TerminalApp::FilteredCommand> _searchResultActions{ nullptr };
+        winrt::hstring _findInAllPanesQuery;
+
         void _bindTabs(const Windows::Foundation::Collections::IObservableVector<winrt::TerminalApp::TabBase>& source, const Windows::Foundation::Collections::IVector<winrt::TerminalApp::FilteredCommand>& target);
         void _anchorKeyUpHandler();
 
@@ -136,6 +153,7 @@ namespace winrt::TerminalApp::implementation
         void _dispatchCommand(const winrt::TerminalApp::FilteredCommand& command);
         void _dispatchCommandline(const winrt::TerminalApp::FilteredCommand& command);
         void _switchToTab(const winrt::TerminalApp::FilteredCommand& command);
+        void _jumpToSearchResult(const winrt::TerminalApp::FilteredCommand& command);
         static std::optional<winrt::TerminalApp::FilteredCommand> _buildCommandLineCommand(const winrt::hstring& commandLine);
 
         void _dismissPalette();
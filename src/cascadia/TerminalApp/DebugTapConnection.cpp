@@ -64,9 +64,13 @@ namespace winrt::Microsoft::TerminalApp::implementation
             _StateChangedHandlers(*this, nullptr);
         });
         _wrappedConnection = wrappedConnection;
+        _formatter = std::thread{ &DebugTapConnection::_FormatterThread, this };
     }
 
-    DebugTapConnection::~DebugTapConnection() = default;
+    DebugTapConnection::~DebugTapConnection()
+    {
+        _StopFormatter();
+    }
 
     void DebugTapConnection::Start()
     {
@@ -93,6 +97,12 @@ namespace winrt::Microsoft::TerminalApp::implementation
 
     void DebugTapConnection::Close()
     {
+        if (_lockStatisticsTimer)
+        {
+            _lockStatisticsTimer->Stop();
+            _lockStatisticsTimer.reset();
+        }
+        _StopFormatter();
         _outputRevoker.revoke();
         _stateChangedRevoker.revoke();
         _wrappedConnection = nullptr;
@@ -107,25 +117,120 @@ namespace winrt::Microsoft::TerminalApp::implementation
         return ConnectionState::Failed;
     }
 
-    void DebugTapConnection::_OutputHandler(const hstring str)
+    void DebugTapConnection::_OutputHandler(const hstring& str)
     {
-        auto output = til::visualize_control_codes(str);
-        // To make the output easier to read, we introduce a line break whenever
-        // an LF control is encountered. But at this point, the LF would have
-        // been converted to U+240A (␊), so that's what we need to search for.
-        for (size_t lfPos = 0; (lfPos = output.find(L'\u240A', lfPos)) != std::wstring::npos;)
-        {
-            output.insert(++lfPos, L"\r\n");
-        }
-        _TerminalOutputHandlers(output);
+        _Enqueue(_EntryKind::Output, str);
     }
 
     // Called by the DebugInputTapConnection to print user input
     void DebugTapConnection::_PrintInput(const hstring& str)
     {
-        auto clean{ til::visualize_control_codes(str) };
-        auto formatted{ wil::str_printf<std::wstring>(L"\x1b[91m%ls\x1b[m", clean.data()) };
-        _TerminalOutputHandlers(formatted);
+        _Enqueue(_EntryKind::Input, str);
+    }
+
+    // Method Description:
+    // - Queues up the given text for the formatter thread. This is called on the
+    //   thread of the tapped connection and must be as cheap as possible.
+    //   If the formatter thread is too far behind, the text is dropped instead.
+    void DebugTapConnection::_Enqueue(_EntryKind kind, std::wstring_view text)
+    {
+        SYSTEMTIME time;
+        GetLocalTime(&time);
+
+        {
+            const std::lock_guard guard{ _pendingMutex };
+            if (_pendingChars + text.size() > _maxPendingChars)
+            {
+                _droppedChunks++;
+                _droppedChars += text.size();
+                return;
+            }
+            _pending.emplace_back(_Entry{ kind, time, std::wstring{ text } });
+            _pendingChars += text.size();
+        }
+
+        _pendingCV.notify_one();
+    }
+
+    void DebugTapConnection::_FormatterThread()
+    {
+        std::vector<_Entry> entries;
+        std::wstring output;
+
+        for (;;)
+        {
+            size_t droppedChunks = 0;
+            size_t droppedChars = 0;
+
+            {
+                std::unique_lock lock{ _pendingMutex };
+                _pendingCV.wait(lock, [&]() { return _stopping || !_pending.empty() || _droppedChunks != 0; });
+                if (_stopping)
+                {
+                    return;
+                }
+
+                entries.swap(_pending);
+                _pendingChars = 0;
+                droppedChunks = std::exchange(_droppedChunks, 0);
+                droppedChars = std::exchange(_droppedChars, 0);
+            }
+
+            output.clear();
+
+            if (droppedChunks)
+            {
+                fmt::format_to(std::back_inserter(output), FMT_COMPILE(L"\r\n\x1b[93m[dropped {} chunks, {} characters]\x1b[m\r\n"), droppedChunks, droppedChars);
+            }
+
+            for (auto& entry : entries)
+            {
+                const auto& t = entry.time;
+                fmt::format_to(std::back_inserter(output), FMT_COMPILE(L"\x1b[90m[{:02}:{:02}:{:02}.{:03}]\x1b[m"), t.wHour, t.wMinute, t.wSecond, t.wMilliseconds);
+
+                switch (entry.kind)
+                {
+                case _EntryKind::Output:
+                {
+                    auto visualized = til::visualize_control_codes(std::move(entry.text));
+                    // To make the output easier to read, we introduce a line break whenever
+                    // an LF control is encountered. But at this point, the LF would have
+                    // been converted to U+240A (␊), so that's what we need to search for.
+                    for (size_t lfPos = 0; (lfPos = visualized.find(L'\u240A', lfPos)) != std::wstring::npos;)
+                    {
+                        visualized.insert(++lfPos, L"\r\n");
+                    }
+                    output.append(visualized);
+                    break;
+                }
+                case _EntryKind::Input:
+                    output.append(L"\x1b[91m");
+                    output.append(til::visualize_control_codes(std::move(entry.text)));
+                    output.append(L"\x1b[m");
+                    break;
+                default:
+                    output.append(entry.text);
+                    break;
+                }
+            }
+
+            entries.clear();
+            _TerminalOutputHandlers(output);
+        }
+    }
+
+    void DebugTapConnection::_StopFormatter()
+    {
+        {
+            const std::lock_guard guard{ _pendingMutex };
+            _stopping = true;
+        }
+        _pendingCV.notify_one();
+
+        if (_formatter.joinable())
+        {
+            _formatter.join();
+        }
     }
 
     // Wire us up so that we can forward input through
@@ -133,6 +238,53 @@ namespace winrt::Microsoft::TerminalApp::implementation
     {
         _inputSide = inputTap;
     }
+
+    // Periodically prints how long the given control's terminal lock was waited for and held,
+    // broken down by call site. Must be called on the UI thread.
+    void DebugTapConnection::ShowLockStatistics(const Microsoft::Terminal::Control::TermControl& control)
+    {
+        _lockStatisticsControl = control;
+
+        // The first sample enables the instrumentation.
+        std::ignore = control.SampleLockStatistics();
+
+        Windows::UI::Xaml::DispatcherTimer timer;
+        timer.Interval(std::chrono::seconds(5));
+        timer.Tick({ get_weak(), &DebugTapConnection::_LockStatisticsTimerTick });
+        timer.Start();
+        _lockStatisticsTimer.emplace(std::move(timer));
+    }
+
+    // Along with the lock statistics, the tick prints the memory used by each tab of the window.
+    // The provider is called on the UI thread.
+    void DebugTapConnection::SetMemoryUsageProvider(std::function<std::wstring()> provider)
+    {
+        _memoryUsageProvider = std::move(provider);
+    }
+
+    void DebugTapConnection::_LockStatisticsTimerTick(const Windows::Foundation::IInspectable& /*sender*/, const Windows::Foundation::IInspectable& /*e*/)
+    {
+        const auto control = _lockStatisticsControl.get();
+        if (!control)
+        {
+            if (_lockStatisticsTimer)
+            {
+                _lockStatisticsTimer->Stop();
+                _lockStatisticsTimer.reset();
+            }
+            return;
+        }
+
+        const auto statistics = control.SampleLockStatistics();
+        const auto formatted = fmt::format(FMT_COMPILE(L"\r\n\x1b[96m[terminal lock, last 5s]\r\n{}\x1b[m"), std::wstring_view{ statistics });
+        _Enqueue(_EntryKind::Preformatted, formatted);
+
+        if (_memoryUsageProvider)
+        {
+            const auto memory = _memoryUsageProvider();
+            _Enqueue(_EntryKind::Preformatted, fmt::format(FMT_COMPILE(L"\r\n\x1b[96m[memory, per tab]\r\n{}\x1b[m"), memory));
+        }
+    }
 }
 
 // Function Description
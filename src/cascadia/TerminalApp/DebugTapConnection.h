@@ -6,6 +6,8 @@
 #include <winrt/Microsoft.Terminal.TerminalConnection.h>
 #include <til/latch.h>
 
+#include <condition_variable>
+
 namespace winrt::Microsoft::TerminalApp::implementation
 {
     class DebugInputTapConnection;
@@ -22,22 +24,59 @@ namespace winrt::Microsoft::TerminalApp::implementation
         winrt::Microsoft::Terminal::TerminalConnection::ConnectionState State() const noexcept;
 
         void SetInputTap(const Microsoft::Terminal::TerminalConnection::ITerminalConnection& inputTap);
+        void ShowLockStatistics(const Microsoft::Terminal::Control::TermControl& control);
+        void SetMemoryUsageProvider(std::function<std::wstring()> provider);
 
         WINRT_CALLBACK(TerminalOutput, winrt::Microsoft::Terminal::TerminalConnection::TerminalOutputHandler);
 
         TYPED_EVENT(StateChanged, winrt::Microsoft::Terminal::TerminalConnection::ITerminalConnection, winrt::Windows::Foundation::IInspectable);
 
     private:
+        enum class _EntryKind
+        {
+            Output,
+            Input,
+            Preformatted,
+        };
+
+        struct _Entry
+        {
+            _EntryKind kind;
+            SYSTEMTIME time;
+            std::wstring text;
+        };
+
+        // The tap must never slow down the connection it's tapping. Instead of formatting
+        // the output inline, it's queued up and formatted by a background thread. If that
+        // thread can't keep up, anything beyond this many characters is dropped.
+        static constexpr size_t _maxPendingChars = 1024 * 1024;
+
         void _PrintInput(const hstring& data);
-        void _OutputHandler(const hstring str);
+        void _OutputHandler(const hstring& str);
+        void _Enqueue(_EntryKind kind, std::wstring_view text);
+        void _FormatterThread();
+        void _StopFormatter();
+        void _LockStatisticsTimerTick(const Windows::Foundation::IInspectable& sender, const Windows::Foundation::IInspectable& e);
 
         winrt::Microsoft::Terminal::TerminalConnection::ITerminalConnection::TerminalOutput_revoker _outputRevoker;
         winrt::Microsoft::Terminal::TerminalConnection::ITerminalConnection::StateChanged_revoker _stateChangedRevoker;
         winrt::weak_ref<Microsoft::Terminal::TerminalConnection::ITerminalConnection> _wrappedConnection;
         winrt::weak_ref<Microsoft::Terminal::TerminalConnection::ITerminalConnection> _inputSide;
+        winrt::weak_ref<Microsoft::Terminal::Control::TermControl> _lockStatisticsControl;
+        std::optional<Windows::UI::Xaml::DispatcherTimer> _lockStatisticsTimer;
+        std::function<std::wstring()> _memoryUsageProvider;
 
         til::latch _start{ 1 };
 
+        std::thread _formatter;
+        std::mutex _pendingMutex;
+        std::condition_variable _pendingCV;
+        std::vector<_Entry> _pending;
+        size_t _pendingChars = 0;
+        size_t _droppedChunks = 0;
+        size_t _droppedChars = 0;
+        bool _stopping = false;
+
         friend class DebugInputTapConnection;
     };
 }
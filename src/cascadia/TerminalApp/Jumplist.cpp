@@ -11,6 +11,11 @@
 
 using namespace winrt::Microsoft::Terminal::Settings::Model;
 
+// Settings are often reloaded several times in quick succession (for instance
+// when an editor saves the file in multiple steps). Only the last one of those
+// within this delay results in an update of the jumplist.
+static constexpr auto JumplistUpdateDelay = std::chrono::milliseconds(500);
+
 //  This property key isn't already defined in propkey.h, but is used by UWP Jumplist to determine the icon of the jumplist item.
 //  IShellLink's SetIconLocation isn't going to read "ms-appx://" icon paths, so we'll need to use this to set the icon.
 DEFINE_PROPERTYKEY(PKEY_AppUserModel_DestListLogoUri, 0x9F4C2855, 0x9F79, 0x4B39, 0xA8, 0xD0, 0xE1, 0xD4, 0x2D, 0xE1, 0xD5, 0xF3, 29);
@@ -78,10 +83,33 @@ winrt::fire_and_forget Jumplist::UpdateJumplist(const CascadiaSettings& settings
     // make sure to capture the settings _before_ the co_await
     const auto strongSettings = settings;
 
-    co_await winrt::resume_background();
+    // The ICustomDestinationList COM calls are slow, so we don't want to make them
+    // on the UI thread, nor more often than necessary.
+    static std::atomic<uint64_t> s_generation{ 0 };
+    const auto generation = s_generation.fetch_add(1, std::memory_order_relaxed) + 1;
+
+    co_await winrt::resume_after(JumplistUpdateDelay);
+
+    if (s_generation.load(std::memory_order_relaxed) != generation)
+    {
+        // A newer call superseded this one.
+        co_return;
+    }
 
     try
     {
+        const auto profiles = strongSettings.ActiveProfiles().GetView();
+
+        // Most settings changes don't affect the jumplist at all. Skip rebuilding
+        // it if the list of profiles is the same as the one we last committed,
+        // which may have been during a previous run of the application.
+        const auto applicationState = ApplicationState::SharedInstance();
+        const auto hash = _hashProfiles(profiles);
+        if (hash == applicationState.JumplistHash())
+        {
+            co_return;
+        }
+
         auto jumplistInstance = winrt::create_instance<ICustomDestinationList>(CLSID_DestinationList, CLSCTX_ALL);
 
         // Start the Jumplist edit transaction
@@ -90,7 +118,7 @@ winrt::fire_and_forget Jumplist::UpdateJumplist(const CascadiaSettings& settings
         jumplistItems.capture(jumplistInstance, &ICustomDestinationList::BeginList, &slots);
 
         // Update the list of profiles.
-        _updateProfiles(jumplistItems.get(), strongSettings.ActiveProfiles().GetView());
+        _updateProfiles(jumplistItems.get(), profiles);
 
         // TODO GH#1571: Add items from the future customizable new tab dropdown as well.
         // This could either replace the default profiles, or be added alongside them.
@@ -101,10 +129,38 @@ winrt::fire_and_forget Jumplist::UpdateJumplist(const CascadiaSettings& settings
         THROW_IF_FAILED(jumplistInstance->AddUserTasks(jumplistItems.get()));
 
         THROW_IF_FAILED(jumplistInstance->CommitList());
+
+        applicationState.JumplistHash(hash);
     }
     CATCH_LOG();
 }
 
+// Method Description:
+// - Computes a hash over everything that ends up in the jumplist.
+// Arguments:
+// - profiles - The profiles to add to the jumplist
+// Return Value:
+// - The hash as a hex string, suitable for ApplicationState.
+winrt::hstring Jumplist::_hashProfiles(winrt::Windows::Foundation::Collections::IVectorView<Profile> profiles)
+{
+    const auto write = [](til::hasher& h, const std::wstring_view& str) {
+        // Include the length, so that the boundaries between strings are part of the hash.
+        h.write(str.size());
+        h.write(str);
+    };
+
+    til::hasher h;
+    write(h, GetWtExePath());
+    for (const auto& profile : profiles)
+    {
+        h.write(profile.Guid());
+        write(h, profile.Name());
+        write(h, profile.Icon());
+    }
+
+    return winrt::hstring{ fmt::format(FMT_COMPILE(L"{:016x}"), h.finalize()) };
+}
+
 // Method Description:
 // - Creates and adds a ShellLink object to the Jumplist for each profile.
 // Arguments:
@@ -174,6 +174,10 @@ NewTerminalArgs Pane::GetTerminalArgsForPane(const bool asContent) const
     {
         args.ContentId(_control.ContentId());
     }
+    else if (const auto sessionId = _control.SessionId(); sessionId != winrt::guid{})
+    {
+        args.SessionId(sessionId);
+    }
 
     return args;
 }
@@ -2746,6 +2750,29 @@ std::shared_ptr<Pane> Pane::FindPane(const uint32_t id)
     return _FindPane([=](const auto& p) { return p->_IsLeaf() && p->_id == id; });
 }
 
+// Method Description:
+// - Caches the results of _GetMinSize() and _GetCellSize() of this subtree until
+//   the returned object is destroyed. If a computation further up the tree already
+//   caches them, this does nothing. The sizes can't change during a layout computation.
+// Arguments:
+// - <none>
+// Return Value:
+// - An object that clears the caches when it's destroyed.
+auto Pane::_CacheLayoutMetrics() const
+{
+    const auto enable = !_cacheLayoutMetrics;
+    if (enable)
+    {
+        _SetLayoutMetricsCaching(true);
+    }
+    return wil::scope_exit([this, enable]() noexcept {
+        if (enable)
+        {
+            _SetLayoutMetricsCaching(false);
+        }
+    });
+}
+
 // Method Description:
 // - Gets the size in pixels of each of our children, given the full size they
 //   should fill. Since these children own their own separators (borders), this
@@ -2760,6 +2787,7 @@ std::shared_ptr<Pane> Pane::FindPane(const uint32_t id)
 //   respectively.
 std::pair<float, float> Pane::_CalcChildrenSizes(const float fullSize) const
 {
+    const auto cache = _CacheLayoutMetrics();
     const auto widthOrHeight = _splitState == SplitState::Vertical;
     const auto snappedSizes = _CalcSnappedChildrenSizes(widthOrHeight, fullSize).lower;
 
@@ -2846,6 +2874,7 @@ Pane::SnapChildrenSizeResult Pane::_CalcSnappedChildrenSizes(const bool widthOrH
 // - A value corresponding to the next closest snap size for this Pane, either upward or downward
 float Pane::CalcSnappedDimension(const bool widthOrHeight, const float dimension) const
 {
+    const auto cache = _CacheLayoutMetrics();
     const auto [lower, higher] = _CalcSnappedDimension(widthOrHeight, dimension);
     return dimension - lower < higher - dimension ? lower : higher;
 }
@@ -2895,7 +2924,7 @@ Pane::SnapSizeResult Pane::_CalcSnappedDimension(const bool widthOrHeight, const
         }
         else
         {
-            const auto cellSize = _control.CharacterDimensions();
+            const auto cellSize = _GetCellSize();
             const auto higher = lower + (widthOrHeight ? cellSize.Width : cellSize.Height);
             return { lower, higher };
         }
@@ -2955,7 +2984,7 @@ void Pane::_AdvanceSnappedDimension(const bool widthOrHeight, LayoutSizeNode& si
         }
         else
         {
-            const auto cellSize = _control.CharacterDimensions();
+            const auto cellSize = _GetCellSize();
             sizeNode.size += widthOrHeight ? cellSize.Width : cellSize.Height;
         }
     }
@@ -3059,6 +3088,12 @@ void Pane::_AdvanceSnappedDimension(const bool widthOrHeight, LayoutSizeNode& si
 //   character.
 Size Pane::_GetMinSize() const
 {
+    if (_cachedMinSize)
+    {
+        return *_cachedMinSize;
+    }
+
+    Size minSize;
     if (_IsLeaf())
     {
         auto controlSize = _control.MinimumSize();
@@ -3070,7 +3105,7 @@ Size Pane::_GetMinSize() const
         newHeight += WI_IsFlagSet(_borders, Borders::Top) ? PaneBorderSize : 0;
         newHeight += WI_IsFlagSet(_borders, Borders::Bottom) ? PaneBorderSize : 0;
 
-        return { newWidth, newHeight };
+        minSize = { newWidth, newHeight };
     }
     else
     {
@@ -3084,7 +3119,54 @@ Size Pane::_GetMinSize() const
                                    firstSize.Height + secondSize.Height :
                                    std::max(firstSize.Height, secondSize.Height);
 
-        return { minWidth, minHeight };
+        minSize = { minWidth, minHeight };
+    }
+
+    if (_cacheLayoutMetrics)
+    {
+        _cachedMinSize = minSize;
+    }
+    return minSize;
+}
+
+// Method Description:
+// - Get the size of a single character cell of our control. Only valid for leaves.
+// Arguments:
+// - <none>
+// Return Value:
+// - The size of a single cell in our control.
+Size Pane::_GetCellSize() const
+{
+    if (_cachedCellSize)
+    {
+        return *_cachedCellSize;
+    }
+
+    const auto cellSize = _control.CharacterDimensions();
+    if (_cacheLayoutMetrics)
+    {
+        _cachedCellSize = cellSize;
+    }
+    return cellSize;
+}
+
+// Method Description:
+// - Enables or disables caching _GetMinSize() and _GetCellSize() for this pane
+//   and all of its descendants. The caches are cleared either way.
+// Arguments:
+// - enabled: whether to cache the layout metrics.
+// Return Value:
+// - <none>
+void Pane::_SetLayoutMetricsCaching(const bool enabled) const noexcept
+{
+    _cacheLayoutMetrics = enabled;
+    _cachedMinSize.reset();
+    _cachedCellSize.reset();
+
+    if (!_IsLeaf())
+    {
+        _firstChild->_SetLayoutMetricsCaching(enabled);
+        _secondChild->_SetLayoutMetricsCaching(enabled);
     }
 }
 
@@ -312,6 +312,9 @@ private:
     SnapSizeResult _CalcSnappedDimension(const bool widthOrHeight, const float dimension) const;
     void _AdvanceSnappedDimension(const bool widthOrHeight, LayoutSizeNode& sizeNode) const;
     winrt::Windows::Foundation::Size _GetMinSize() const;
+    winrt::Windows::Foundation::Size _GetCellSize() const;
+    [[nodiscard]] auto _CacheLayoutMetrics() const;
+    void _SetLayoutMetricsCaching(const bool enabled) const noexcept;
     LayoutSizeNode _CreateMinSizeTree(const bool widthOrHeight) const;
     float _ClampSplitPosition(const bool widthOrHeight, const float requestedValue, const float totalSize) const;
 
@@ -319,6 +322,13 @@ private:
 
     winrt::fire_and_forget _playBellSound(winrt::Windows::Foundation::Uri uri);
 
+    // Snapping a size walks the entire tree, one cell at a time, and asks each control
+    // for its sizes over and over again. For the duration of a layout computation
+    // (see _CacheLayoutMetrics) we cache the answers here.
+    mutable bool _cacheLayoutMetrics{ false };
+    mutable std::optional<winrt::Windows::Foundation::Size> _cachedMinSize;
+    mutable std::optional<winrt::Windows::Foundation::Size> _cachedCellSize;
+
     // Function Description:
     // - Returns true if the given direction can be used with the given split
     //   type.
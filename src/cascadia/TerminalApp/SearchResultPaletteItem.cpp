@@ -0,0 +1,32 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "pch.h"
+#include "SearchResultPaletteItem.h"
+
+#include "SearchResultPaletteItem.g.cpp"
+
+using namespace winrt;
+using namespace winrt::TerminalApp;
+using namespace winrt::Microsoft::Terminal::Control;
+
+namespace winrt::TerminalApp::implementation
+{
+    SearchResultPaletteItem::SearchResultPaletteItem(const winrt::TerminalApp::TabBase& tab,
+                                                     const uint32_t paneId,
+                                                     const TermControl& control,
+                                                     const SearchResult& result) :
+        _PaneId{ paneId },
+        _Result{ result },
+        _tab{ tab },
+        _control{ control }
+    {
+        // The matching line, without the indentation, which would only push the match out of view.
+        std::wstring_view text{ result.Text };
+        const auto indent = text.find_first_not_of(L' ');
+        Name(winrt::hstring{ text.substr(indent == std::wstring_view::npos ? text.size() : indent) });
+        // Tells the user which tab the line is from.
+        KeyChordText(tab.Title());
+        Icon(tab.Icon());
+    }
+}
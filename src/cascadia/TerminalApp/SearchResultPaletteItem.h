@@ -0,0 +1,42 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include "PaletteItem.h"
+#include "SearchResultPaletteItem.g.h"
+
+namespace winrt::TerminalApp::implementation
+{
+    struct SearchResultPaletteItem : SearchResultPaletteItemT<SearchResultPaletteItem, PaletteItem>
+    {
+        SearchResultPaletteItem() = default;
+        SearchResultPaletteItem(const winrt::TerminalApp::TabBase& tab,
+                                const uint32_t paneId,
+                                const winrt::Microsoft::Terminal::Control::TermControl& control,
+                                const winrt::Microsoft::Terminal::Control::SearchResult& result);
+
+        winrt::TerminalApp::TabBase Tab() const noexcept
+        {
+            return _tab.get();
+        }
+
+        winrt::Microsoft::Terminal::Control::TermControl Control() const noexcept
+        {
+            return _control.get();
+        }
+
+        WINRT_PROPERTY(uint32_t, PaneId, 0);
+        WINRT_PROPERTY(winrt::Microsoft::Terminal::Control::SearchResult, Result);
+
+    private:
+        // The palette outlives the panes it lists matches for. These don't keep them alive.
+        winrt::weak_ref<winrt::TerminalApp::TabBase> _tab;
+        winrt::weak_ref<winrt::Microsoft::Terminal::Control::TermControl> _control;
+    };
+}
+
+namespace winrt::TerminalApp::factory_implementation
+{
+    BASIC_FACTORY(SearchResultPaletteItem);
+}
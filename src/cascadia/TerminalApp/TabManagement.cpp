@@ -196,7 +196,7 @@ namespace winrt::TerminalApp::implementation
             {
                 // Passing empty string as the path to export tab will make it
                 // prompt for the path
-                page->_ExportTab(*tab, L"");
+                page->_ExportTab(*tab, L"", ExportBufferFormat::Text);
             }
         });
 
@@ -376,7 +376,9 @@ namespace winrt::TerminalApp::implementation
     // - Exports the content of the Terminal Buffer inside the tab
     // Arguments:
     // - tab: tab to export
-    winrt::fire_and_forget TerminalPage::_ExportTab(const TerminalTab& tab, winrt::hstring filepath)
+    // - filepath: the file to export to. If empty, the user is asked for it.
+    // - format: whether to export plain text or VT
+    winrt::fire_and_forget TerminalPage::_ExportTab(const TerminalTab& tab, winrt::hstring filepath, ExportBufferFormat format)
     {
         // This will be used to set up the file picker "filter", to select .txt
         // files by default.
@@ -430,8 +432,8 @@ namespace winrt::TerminalApp::implementation
 
                 if (!path.empty())
                 {
-                    const auto buffer = control.ReadEntireBuffer();
-                    CascadiaSettings::ExportFile(path, buffer);
+                    // This streams the buffer into the file in the background.
+                    co_await control.ExportBuffer(path, format);
                 }
             }
         }
@@ -505,6 +507,7 @@ namespace winrt::TerminalApp::implementation
         // Removing the tab from the collection should destroy its control and disconnect its connection,
         // but it doesn't always do so. The UI tree may still be holding the control and preventing its destruction.
         tab.Shutdown();
+        _RemoveTabContent(tab);
 
         uint32_t mruIndex{};
         if (_mruTabs.IndexOf(tab, mruIndex))
@@ -914,6 +917,103 @@ namespace winrt::TerminalApp::implementation
         }
     }
 
+    // Method Description:
+    // - Puts the content of the given tab into the UI tree, replacing that of the previous tab.
+    // - With "experimental.rendering.warmTabCount" the content of the most recently shown tabs
+    //   stays in the tree, collapsed. Removing a tab's content and adding it back unloads and
+    //   reloads each control and lays out all of its panes, while a collapsed one keeps its
+    //   swap chain attached, still showing the last frame. Its renderer is paused regardless,
+    //   because the controls are told that they're not visible.
+    // Arguments:
+    // - tab: the tab whose content should be shown
+    void TerminalPage::_ShowTabContent(const winrt::TerminalApp::TabBase& tab)
+    {
+        const auto content = tab.Content();
+        const auto children = _tabContent.Children();
+        const auto limit = gsl::narrow_cast<size_t>(std::clamp(_settings.GlobalSettings().WarmTabCount(), 0, 16));
+
+        if (limit == 0)
+        {
+            for (const auto& warm : _warmTabs)
+            {
+                warm.content.Visibility(Visibility::Visible);
+            }
+            _warmTabs.clear();
+            content.Visibility(Visibility::Visible);
+            children.Clear();
+            children.Append(content);
+            return;
+        }
+
+        // Move the tab to the front. Its content may have changed since it was
+        // last shown, for instance because a pane was zoomed or closed.
+        const auto it = std::find_if(_warmTabs.begin(), _warmTabs.end(), [&](const auto& warm) { return warm.tab == tab; });
+        if (it != _warmTabs.end())
+        {
+            _warmTabs.erase(it);
+        }
+        _warmTabs.insert(_warmTabs.begin(), WarmTab{ tab, content });
+
+        // Evict the least recently shown tabs. Their controls keep rendering into their
+        // swap chains, of course, but they'll be reattached when they're shown the next time.
+        while (_warmTabs.size() > limit + 1)
+        {
+            _warmTabs.back().content.Visibility(Visibility::Visible);
+            _warmTabs.pop_back();
+        }
+
+        // Anything that's not a warm tab's current content has to go, including the
+        // stale content of the tab we just moved to the front.
+        for (auto i = children.Size(); i-- > 0;)
+        {
+            const auto child = children.GetAt(i);
+            if (std::none_of(_warmTabs.begin(), _warmTabs.end(), [&](const auto& warm) { return warm.content == child; }))
+            {
+                child.Visibility(Visibility::Visible);
+                children.RemoveAt(i);
+            }
+        }
+
+        uint32_t index{};
+        if (!children.IndexOf(content, index))
+        {
+            children.Append(content);
+        }
+
+        for (const auto& warm : _warmTabs)
+        {
+            warm.content.Visibility(warm.content == content ? Visibility::Visible : Visibility::Collapsed);
+        }
+    }
+
+    // Method Description:
+    // - Removes the content of the given tab from the UI tree, if it's in there.
+    //   This must be done before the tab's panes are rearranged or the tab is closed.
+    // Arguments:
+    // - tab: the tab whose content should be removed
+    void TerminalPage::_RemoveTabContent(const winrt::TerminalApp::TabBase& tab)
+    {
+        const auto it = std::find_if(_warmTabs.begin(), _warmTabs.end(), [&](const auto& warm) { return warm.tab == tab; });
+        if (it == _warmTabs.end())
+        {
+            // Without warm tabs only the focused tab's content is in the tree.
+            if (_warmTabs.empty() && tab == _GetFocusedTab())
+            {
+                _tabContent.Children().Clear();
+            }
+            return;
+        }
+
+        const auto children = _tabContent.Children();
+        uint32_t index{};
+        if (children.IndexOf(it->content, index))
+        {
+            children.RemoveAt(index);
+        }
+        it->content.Visibility(Visibility::Visible);
+        _warmTabs.erase(it);
+    }
+
     void TerminalPage::_UpdatedSelectedTab(const winrt::TerminalApp::TabBase& tab)
     {
         // Unfocus all the tabs.
@@ -924,8 +1024,22 @@ namespace winrt::TerminalApp::implementation
 
         try
         {
-            _tabContent.Children().Clear();
-            _tabContent.Children().Append(tab.Content());
+            _ShowTabContent(tab);
+
+            // The controls in the other tabs aren't shown anymore. They can stop rendering until they are.
+            for (const auto& t : _tabs)
+            {
+                if (const auto terminalTab{ _GetTerminalTabImpl(t) })
+                {
+                    const auto visible = t == tab;
+                    terminalTab->GetRootPane()->WalkTree([&](auto&& pane) {
+                        if (const auto control = pane->GetTerminalControl())
+                        {
+                            control.VisibilityChanged(visible);
+                        }
+                    });
+                }
+            }
 
             // GH#7409: If the tab switcher is open, then we _don't_ want to
             // automatically focus the new tab here. The tab switcher wants
@@ -20,6 +20,7 @@
 #include "../../types/inc/utils.hpp"
 #include "ColorHelper.h"
 #include "DebugTapConnection.h"
+#include "SearchResultPaletteItem.h"
 #include "SettingsTab.h"
 #include "TabRowControl.h"
 #include "Utils.h"
@@ -288,6 +289,168 @@ namespace winrt::TerminalApp::implementation
         CATCH_LOG();
 
         ShowSetAsDefaultInfoBar();
+
+        _StartLowMemoryWatch();
+    }
+
+    // Method Description:
+    // - Starts waiting for the system to run low on memory. When it does, every
+    //   control in this window is asked to drop its caches. See _TrimMemory().
+    void TerminalPage::_StartLowMemoryWatch()
+    {
+        _weakThis = get_weak();
+
+        _lowMemoryNotification.reset(CreateMemoryResourceNotification(LowMemoryResourceNotification));
+        if (!_lowMemoryNotification)
+        {
+            LOG_LAST_ERROR();
+            return;
+        }
+
+        _lowMemoryWait.reset(CreateThreadpoolWait(&_LowMemoryCallback, this, nullptr));
+        if (!_lowMemoryWait)
+        {
+            LOG_LAST_ERROR();
+            return;
+        }
+
+        SetThreadpoolWait(_lowMemoryWait.get(), _lowMemoryNotification.get(), nullptr);
+    }
+
+    void CALLBACK TerminalPage::_LowMemoryCallback(PTP_CALLBACK_INSTANCE /*instance*/, void* context, PTP_WAIT /*wait*/, TP_WAIT_RESULT /*result*/) noexcept
+    try
+    {
+        if (const auto page = static_cast<TerminalPage*>(context)->_weakThis.get())
+        {
+            page->_LowMemoryHandler();
+        }
+    }
+    CATCH_LOG()
+
+    winrt::fire_and_forget TerminalPage::_LowMemoryHandler()
+    {
+        const auto weakThis{ get_weak() };
+
+        co_await wil::resume_foreground(Dispatcher());
+        if (const auto page{ weakThis.get() })
+        {
+            page->_TrimMemory();
+        }
+
+        co_await winrt::resume_after(LowMemoryCooldown);
+        if (const auto page{ weakThis.get() })
+        {
+            SetThreadpoolWait(page->_lowMemoryWait.get(), page->_lowMemoryNotification.get(), nullptr);
+        }
+    }
+
+    // Method Description:
+    // - Asks the control of every pane to release the memory it doesn't need right now.
+    //   The controls that aren't visible additionally release their GPU resources.
+    void TerminalPage::_TrimMemory()
+    {
+        for (const auto& t : _tabs)
+        {
+            if (const auto terminalTab{ _GetTerminalTabImpl(t) })
+            {
+                terminalTab->GetRootPane()->WalkTree([](auto&& pane) {
+                    if (const auto control = pane->GetTerminalControl())
+                    {
+                        control.TrimMemory();
+                    }
+                });
+            }
+        }
+    }
+
+    // Method Description:
+    // - (Re)starts the timer after which the window's controls are trimmed, or stops it
+    //   if the window is visible and active. A minimized window is trimmed after a few
+    //   seconds, one that merely sits in the background only after a long while, so
+    //   that switching between windows doesn't throw away the caches all the time.
+    void TerminalPage::_ScheduleIdleTrim()
+    {
+        if (_idleTrimTimer)
+        {
+            _idleTrimTimer->Stop();
+            _idleTrimTimer.reset();
+        }
+
+        if (_visible && _activated)
+        {
+            return;
+        }
+
+        DispatcherTimer timer;
+        timer.Interval(_visible ? std::chrono::seconds{ BackgroundTrimDelay } : MinimizedTrimDelay);
+        timer.Tick({ get_weak(), &TerminalPage::_IdleTrimTimerTick });
+        timer.Start();
+        _idleTrimTimer.emplace(std::move(timer));
+    }
+
+    void TerminalPage::_IdleTrimTimerTick(const IInspectable& /*sender*/, const IInspectable& /*e*/)
+    {
+        if (_idleTrimTimer)
+        {
+            _idleTrimTimer->Stop();
+            _idleTrimTimer.reset();
+        }
+
+        // The controls of a minimized window are all occluded,
+        // so this releases their swap chains and glyph atlases as well.
+        _TrimMemory();
+
+        if (!_visible)
+        {
+            // Most of what's left are pages that were touched once while the window was in use
+            // (the XAML tree, fonts, code). Let the system page them out until it's restored.
+            LOG_IF_WIN32_BOOL_FALSE(SetProcessWorkingSetSizeEx(GetCurrentProcess(), static_cast<SIZE_T>(-1), static_cast<SIZE_T>(-1), 0));
+        }
+    }
+
+    // Method Description:
+    // - Formats the memory used by the controls of each tab, one line per tab, for the debug tap.
+    std::wstring TerminalPage::_FormatMemoryUsage()
+    {
+        static constexpr auto kb = [](const uint64_t bytes) { return (bytes + 1023) / 1024; };
+
+        std::wstring str;
+        for (const auto& t : _tabs)
+        {
+            const auto terminalTab{ _GetTerminalTabImpl(t) };
+            if (!terminalTab)
+            {
+                continue;
+            }
+
+            winrt::Microsoft::Terminal::Control::MemoryUsage total{};
+            terminalTab->GetRootPane()->WalkTree([&](auto&& pane) {
+                if (const auto control = pane->GetTerminalControl())
+                {
+                    const auto usage = control.SampleMemoryUsage();
+                    total.TextBytes += usage.TextBytes;
+                    total.ScrollbackBytes += usage.ScrollbackBytes;
+                    total.SpilledBytes += usage.SpilledBytes;
+                    total.CacheBytes += usage.CacheBytes;
+                    total.RendererBytes += usage.RendererBytes;
+                    total.GlyphAtlasBytes += usage.GlyphAtlasBytes;
+                    total.OutputBytes += usage.OutputBytes;
+                }
+            });
+
+            const auto title = t.Title();
+            fmt::format_to(std::back_inserter(str),
+                           FMT_COMPILE(L"{:<24.24} text={}K scrollback={}K spilled={}K caches={}K renderer={}K atlas={}K output={}K\r\n"),
+                           std::wstring_view{ title },
+                           kb(total.TextBytes),
+                           kb(total.ScrollbackBytes),
+                           kb(total.SpilledBytes),
+                           kb(total.CacheBytes),
+                           kb(total.RendererBytes),
+                           kb(total.GlyphAtlasBytes),
+                           kb(total.OutputBytes));
+        }
+        return str;
     }
 
     // Method Description:
@@ -751,16 +914,48 @@ namespace winrt::TerminalApp::implementation
     }
 
     // Method Description:
-    // - Builds the flyout (dropdown) attached to the new tab button, and
-    //   attaches it to the button. Populates the flyout with one entry per
-    //   Profile, displaying the profile's name. Clicking each flyout item will
-    //   open a new tab with that profile.
-    //   Below the profiles are the static menu items: settings, command palette
+    // - Creates the flyout (dropdown) attached to the new tab button and
+    //   attaches it to the button. It starts out empty: most sessions never open
+    //   it, so its items (and their icons, which may have to be loaded from
+    //   disk) are only created right before it's opened for the first time,
+    //   and again after the settings changed. See _PopulateNewTabFlyout().
     void TerminalPage::_CreateNewTabFlyout()
     {
         auto newTabFlyout = WUX::Controls::MenuFlyout{};
         newTabFlyout.Placement(WUX::Controls::Primitives::FlyoutPlacementMode::BottomEdgeAlignedLeft);
 
+        // Before opening the fly-out set focus on the current tab
+        // so no matter how fly-out is closed later on the focus will return to some tab.
+        // We cannot do it on closing because if the window loses focus (alt+tab)
+        // the closing event is not fired.
+        // It is important to set the focus on the tab
+        // Since the previous focus location might be discarded in the background,
+        // e.g., the command palette will be dismissed by the menu,
+        // and then closing the fly-out will move the focus to wrong location.
+        newTabFlyout.Opening([this](const IInspectable& sender, auto&&) {
+            if (_newTabFlyoutStale)
+            {
+                _PopulateNewTabFlyout(sender.as<WUX::Controls::MenuFlyout>());
+            }
+            _FocusCurrentTab(true);
+        });
+        // Necessary for fly-out sub items to get focus on a tab before collapsing. Related to #15049
+        newTabFlyout.Closing([this](auto&&, auto&&) {
+            _FocusCurrentTab(true);
+        });
+        _newTabButton.Flyout(newTabFlyout);
+        _newTabFlyoutStale = true;
+    }
+
+    // Method Description:
+    // - Populates the new tab flyout with one entry per Profile, displaying the
+    //   profile's name. Clicking each flyout item will open a new tab with that profile.
+    //   Below the profiles are the static menu items: settings, command palette
+    void TerminalPage::_PopulateNewTabFlyout(const WUX::Controls::MenuFlyout& newTabFlyout)
+    {
+        _newTabFlyoutStale = false;
+        newTabFlyout.Items().Clear();
+
         // Create profile entries from the NewTabMenu configuration using a
         // recursive helper function. This returns a std::vector of FlyoutItemBases,
         // that we then add to our Flyout.
@@ -836,23 +1031,6 @@ namespace winrt::TerminalApp::implementation
             aboutFlyout.Click({ this, &TerminalPage::_AboutButtonOnClick });
             newTabFlyout.Items().Append(aboutFlyout);
         }
-
-        // Before opening the fly-out set focus on the current tab
-        // so no matter how fly-out is closed later on the focus will return to some tab.
-        // We cannot do it on closing because if the window loses focus (alt+tab)
-        // the closing event is not fired.
-        // It is important to set the focus on the tab
-        // Since the previous focus location might be discarded in the background,
-        // e.g., the command palette will be dismissed by the menu,
-        // and then closing the fly-out will move the focus to wrong location.
-        newTabFlyout.Opening([this](auto&&, auto&&) {
-            _FocusCurrentTab(true);
-        });
-        // Necessary for fly-out sub items to get focus on a tab before collapsing. Related to #15049
-        newTabFlyout.Closing([this](auto&&, auto&&) {
-            _FocusCurrentTab(true);
-        });
-        _newTabButton.Flyout(newTabFlyout);
     }
 
     // Method Description:
@@ -1162,10 +1340,12 @@ namespace winrt::TerminalApp::implementation
     // Arguments:
     // - the profile we want the settings from
     // - the terminal settings
+    // - sessionId: the WT_SESSION of the connection, or an empty GUID to create a new one
     // Return value:
     // - the desired connection
     TerminalConnection::ITerminalConnection TerminalPage::_CreateConnectionFromSettings(Profile profile,
-                                                                                        TerminalSettings settings)
+                                                                                        TerminalSettings settings,
+                                                                                        const winrt::guid& sessionId)
     {
         TerminalConnection::ITerminalConnection connection{ nullptr };
 
@@ -1241,12 +1421,16 @@ namespace winrt::TerminalApp::implementation
                                                                                  environment,
                                                                                  settings.InitialRows(),
                                                                                  settings.InitialCols(),
-                                                                                 winrt::guid(),
+                                                                                 sessionId,
                                                                                  profile.Guid());
 
             valueSet.Insert(L"passthroughMode", Windows::Foundation::PropertyValue::CreateBoolean(settings.VtPassthrough()));
             valueSet.Insert(L"reloadEnvironmentVariables",
                             Windows::Foundation::PropertyValue::CreateBoolean(_settings.GlobalSettings().ReloadEnvironmentVariables()));
+            if (const auto recordingDirectory = profile.RecordingDirectory(); !recordingDirectory.empty())
+            {
+                valueSet.Insert(L"recordingDirectory", Windows::Foundation::PropertyValue::CreateString(recordingDirectory));
+            }
 
             conhostConn.Initialize(valueSet);
 
@@ -1622,11 +1806,15 @@ namespace winrt::TerminalApp::implementation
                 {
                     if (*tab == page->_GetFocusedTab())
                     {
-                        page->_tabContent.Children().Clear();
-                        page->_tabContent.Children().Append(tab->Content());
+                        page->_ShowTabContent(*tab);
 
                         tab->Focus(FocusState::Programmatic);
                     }
+                    else
+                    {
+                        // A warm tab's old content may now be part of its new one.
+                        page->_RemoveTabContent(*tab);
+                    }
                 }
             }
         });
@@ -1671,7 +1859,7 @@ namespace winrt::TerminalApp::implementation
             {
                 // Remove the content from the tab first, so Pane::UnZoom can
                 // re-attach the content to the tree w/in the pane
-                _tabContent.Children().Clear();
+                _RemoveTabContent(*activeTab);
                 // In ExitZoom, we'll change the Tab's Content(), triggering the
                 // content changed event, which will re-attach the tab's new content
                 // root to the tree.
@@ -1752,11 +1940,126 @@ namespace winrt::TerminalApp::implementation
         p.DispatchCommandRequested({ this, &TerminalPage::_OnDispatchCommandRequested });
         p.CommandLineExecutionRequested({ this, &TerminalPage::_OnCommandLineExecutionRequested });
         p.SwitchToTabRequested({ this, &TerminalPage::_OnSwitchToTabRequested });
+        p.FindInAllPanesRequested({ this, &TerminalPage::_OnFindInAllPanesRequested });
+        p.JumpToSearchResultRequested({ this, &TerminalPage::_OnJumpToSearchResultRequested });
         p.PreviewAction({ this, &TerminalPage::_PreviewActionHandler });
 
         return p;
     }
 
+    // Method Description:
+    // - Called when the query of the command palette's "find in all panes" mode
+    //   changes. Cancels the previous search and searches every pane of every tab.
+    // - The panes are searched in parallel on the thread pool, each of them only
+    //   holding its terminal lock for a batch of rows at a time. The matches of
+    //   each pane are added to the command palette as soon as it's done.
+    // Arguments:
+    // - query: the text to search for. An empty one just cancels the previous search.
+    // Return Value:
+    // - <none>
+    void TerminalPage::_OnFindInAllPanesRequested(const IInspectable& /*sender*/, const winrt::hstring& query)
+    {
+        for (const auto& operation : _findInAllPanesOperations)
+        {
+            operation.Cancel();
+        }
+        _findInAllPanesOperations.clear();
+        // A search may complete right before it's canceled, while its continuation is still queued.
+        ++_findInAllPanesGeneration;
+
+        if (query.empty())
+        {
+            return;
+        }
+
+        for (const auto& tab : _tabs)
+        {
+            if (const auto terminalTab{ _GetTerminalTabImpl(tab) })
+            {
+                terminalTab->GetRootPane()->WalkTree([&](auto&& pane) {
+                    const auto id = pane->Id();
+                    if (const auto& control{ pane->GetTerminalControl() }; control && id)
+                    {
+                        auto operation = control.FindAllMatches(query, _findInAllPanesCaseSensitive, _findInAllPanesRegularExpression);
+                        _findInAllPanesOperations.emplace_back(operation);
+                        _FindInPane(_findInAllPanesGeneration, std::move(operation), tab, *id, control);
+                    }
+                });
+            }
+        }
+    }
+
+    // Method Description:
+    // - Waits for the search of a single pane and adds its matches to the command palette.
+    // Arguments:
+    // - generation: the value of _findInAllPanesGeneration when the search started
+    // - operation: the search, as returned by TermControl::FindAllMatches()
+    // - tab, paneId, control: where the search runs
+    // Return Value:
+    // - <none>
+    winrt::fire_and_forget TerminalPage::_FindInPane(const uint64_t generation,
+                                                     const Windows::Foundation::IAsyncOperation<IVector<Control::SearchResult>> operation,
+                                                     const winrt::TerminalApp::TabBase tab,
+                                                     const uint32_t paneId,
+                                                     const Control::TermControl control)
+    {
+        const auto weakThis{ get_weak() };
+
+        IVector<Control::SearchResult> results{ nullptr };
+        try
+        {
+            // This resumes on the UI thread that started the search.
+            results = co_await operation;
+        }
+        catch (...)
+        {
+            // The search was canceled, because the query changed, or the query is an invalid regular expression.
+            co_return;
+        }
+
+        const auto page{ weakThis.get() };
+        if (!page || generation != page->_findInAllPanesGeneration || results.Size() == 0)
+        {
+            co_return;
+        }
+
+        auto items = winrt::single_threaded_vector<winrt::TerminalApp::SearchResultPaletteItem>();
+        for (const auto& result : results)
+        {
+            items.Append(winrt::make<winrt::TerminalApp::implementation::SearchResultPaletteItem>(tab, paneId, control, result));
+        }
+
+        if (const auto p = page->CommandPaletteElement())
+        {
+            p.AddSearchResults(items);
+        }
+    }
+
+    // Method Description:
+    // - Called when a match of "find in all panes" was chosen in the command palette.
+    //   Focuses its tab and pane and selects the match, which scrolls it into view.
+    // Arguments:
+    // - item: the chosen match
+    // Return Value:
+    // - <none>
+    void TerminalPage::_OnJumpToSearchResultRequested(const IInspectable& /*sender*/, const winrt::TerminalApp::SearchResultPaletteItem& item)
+    {
+        const auto tab{ item.Tab() };
+        const auto control{ item.Control() };
+        uint32_t index{};
+        if (!tab || !control || !_tabs.IndexOf(tab, index))
+        {
+            return;
+        }
+
+        _SelectTab(index);
+        if (const auto terminalTab{ _GetTerminalTabImpl(tab) })
+        {
+            terminalTab->FocusPane(item.PaneId());
+        }
+        control.SelectSearchResult(item.Result());
+    }
+
     // Method Description:
     // - Warn the user that they are about to close all open windows, then
     //   signal that we want to close everything.
@@ -1777,6 +2080,40 @@ namespace winrt::TerminalApp::implementation
         }
     }
 
+    // The buffer of each pane is persisted next to the settings file, in a file named after its session id.
+    std::filesystem::path TerminalPage::_bufferSnapshotPath(const winrt::guid& sessionId)
+    {
+        std::filesystem::path path{ std::wstring_view{ CascadiaSettings::SettingsPath() } };
+        path.replace_filename(fmt::format(L"buffer_{}.wtb", ::Microsoft::Console::Utils::GuidToString(sessionId)));
+        return path;
+    }
+
+    // Method Description:
+    // - Writes the buffer of every pane into its snapshot file (see _bufferSnapshotPath()),
+    //   so that _MakePane() can restore it along with the layout that GetWindowLayout() persists.
+    void TerminalPage::_PersistBuffers()
+    {
+        for (const auto& tab : _tabs)
+        {
+            if (const auto terminalTab = _GetTerminalTabImpl(tab))
+            {
+                terminalTab->GetRootPane()->WalkTree([](const auto& pane) {
+                    if (const auto control = pane->GetTerminalControl())
+                    {
+                        if (const auto sessionId = control.SessionId(); sessionId != winrt::guid{})
+                        {
+                            try
+                            {
+                                control.PersistBuffer(_bufferSnapshotPath(sessionId).c_str());
+                            }
+                            CATCH_LOG();
+                        }
+                    }
+                });
+            }
+        }
+    }
+
     // Method Description:
     // - Saves the window position and tab layout to the application state
     // - This does not create the InitialPosition field, that needs to be
@@ -1824,6 +2161,11 @@ namespace winrt::TerminalApp::implementation
             actions.emplace_back(std::move(action));
         }
 
+        if (_settings.GlobalSettings().ShouldUsePersistedLayout())
+        {
+            _PersistBuffers();
+        }
+
         WindowLayout layout{};
         layout.TabLayout(winrt::single_threaded_vector<ActionAndArgs>(std::move(actions)));
 
@@ -2893,7 +3235,8 @@ namespace winrt::TerminalApp::implementation
             return nullptr;
         }
 
-        auto connection = existingConnection ? existingConnection : _CreateConnectionFromSettings(profile, controlSettings.DefaultSettings());
+        const auto sessionId = newTerminalArgs ? newTerminalArgs.SessionId() : winrt::guid{};
+        auto connection = existingConnection ? existingConnection : _CreateConnectionFromSettings(profile, controlSettings.DefaultSettings(), sessionId);
         if (existingConnection)
         {
             connection.Resize(controlSettings.DefaultSettings().InitialRows(), controlSettings.DefaultSettings().InitialCols());
@@ -2915,6 +3258,17 @@ namespace winrt::TerminalApp::implementation
 
         const auto control = _CreateNewControlAndContent(controlSettings, connection);
 
+        // If this pane is being restored from a persisted layout, restore its buffer as well.
+        if (sessionId != winrt::guid{} && !existingConnection && _settings.GlobalSettings().ShouldUsePersistedLayout())
+        {
+            const auto path = _bufferSnapshotPath(sessionId);
+            std::error_code ec;
+            if (std::filesystem::exists(path, ec))
+            {
+                control.RestoreBuffer(path.c_str());
+            }
+        }
+
         auto resultPane = std::make_shared<Pane>(profile, control);
 
         if (debugConnection) // this will only be set if global debugging is on and tap is active
@@ -2933,6 +3287,12 @@ namespace winrt::TerminalApp::implementation
             // Set the non-debug pane as active
             resultPane->ClearActive();
             original->SetActive();
+
+            winrt::get_self<winrt::Microsoft::TerminalApp::implementation::DebugTapConnection>(debugConnection)->ShowLockStatistics(control);
+            winrt::get_self<winrt::Microsoft::TerminalApp::implementation::DebugTapConnection>(debugConnection)->SetMemoryUsageProvider([weakThis = get_weak()]() {
+                const auto page = weakThis.get();
+                return page ? page->_FormatMemoryUsage() : std::wstring{};
+            });
         }
 
         return resultPane;
@@ -3085,9 +3445,9 @@ namespace winrt::TerminalApp::implementation
         }
 
         // repopulate the new tab button's flyout with entries for each
-        // profile, which might have changed
+        // profile, which might have changed, the next time it's opened
         _UpdateTabWidthMode();
-        _CreateNewTabFlyout();
+        _newTabFlyoutStale = true;
 
         // Reload the current value of alwaysOnTop from the settings file. This
         // will let the user hot-reload this setting, but any runtime changes to
@@ -3273,6 +3633,8 @@ namespace winrt::TerminalApp::implementation
                 });
             }
         }
+
+        _ScheduleIdleTrim();
     }
 
     // Method Description:
@@ -4495,6 +4857,7 @@ namespace winrt::TerminalApp::implementation
         // the settings, change active panes, etc.
         _activated = activated;
         _updateThemeColors();
+        _ScheduleIdleTrim();
     }
 
     void TerminalPage::_ContextMenuOpened(const IInspectable& sender,
@@ -210,12 +210,23 @@ namespace winrt::TerminalApp::implementation
         TerminalApp::TabRowControl _tabRow{ nullptr };
         Windows::UI::Xaml::Controls::Grid _tabContent{ nullptr };
         Microsoft::UI::Xaml::Controls::SplitButton _newTabButton{ nullptr };
+        bool _newTabFlyoutStale{ true };
         winrt::TerminalApp::ColorPickupFlyout _tabColorPicker{ nullptr };
 
         Microsoft::Terminal::Settings::Model::CascadiaSettings _settings{ nullptr };
 
         Windows::Foundation::Collections::IObservableVector<TerminalApp::TabBase> _tabs;
         Windows::Foundation::Collections::IObservableVector<TerminalApp::TabBase> _mruTabs;
+
+        // The tabs whose content is in _tabContent, most recently shown first. Only the first one
+        // is visible. The others are collapsed, but keep their swap chains attached and their
+        // layout intact, so that showing them again doesn't redraw anything. See _ShowTabContent().
+        struct WarmTab
+        {
+            TerminalApp::TabBase tab{ nullptr };
+            Windows::UI::Xaml::UIElement content{ nullptr };
+        };
+        std::vector<WarmTab> _warmTabs;
         static winrt::com_ptr<TerminalTab> _GetTerminalTabImpl(const TerminalApp::TabBase& tab);
 
         void _UpdateTabIndices();
@@ -227,6 +238,12 @@ namespace winrt::TerminalApp::implementation
         bool _isMaximized{ false };
         bool _isAlwaysOnTop{ false };
 
+        // The settings of the last "find in all panes" action and its searches that are still running.
+        bool _findInAllPanesCaseSensitive{ false };
+        bool _findInAllPanesRegularExpression{ false };
+        uint64_t _findInAllPanesGeneration{ 0 };
+        std::vector<Windows::Foundation::IAsyncOperation<Windows::Foundation::Collections::IVector<Microsoft::Terminal::Control::SearchResult>>> _findInAllPanesOperations;
+
         std::optional<uint32_t> _loadFromPersistedLayoutIdx{};
 
         bool _maintainStateOnTabClose{ false };
@@ -238,6 +255,20 @@ namespace winrt::TerminalApp::implementation
         bool _activated{ false };
         bool _visible{ true };
 
+        // The notification is signaled for as long as the system is low on memory.
+        // The wait is re-armed after a cooldown, so that the controls aren't trimmed over and over.
+        // It's declared after _weakThis, so that it's destroyed (and its callbacks are done) first.
+        static constexpr auto LowMemoryCooldown = std::chrono::seconds(30);
+        winrt::weak_ref<TerminalPage> _weakThis;
+        wil::unique_handle _lowMemoryNotification;
+        wil::unique_threadpool_wait _lowMemoryWait;
+
+        // Armed while the window is minimized or in the background. When it fires, the window's
+        // controls release what they can rebuild on demand. See _ScheduleIdleTrim().
+        static constexpr auto MinimizedTrimDelay = std::chrono::seconds(10);
+        static constexpr auto BackgroundTrimDelay = std::chrono::minutes(15);
+        std::optional<Windows::UI::Xaml::DispatcherTimer> _idleTrimTimer;
+
         std::vector<std::vector<Microsoft::Terminal::Settings::Model::ActionAndArgs>> _previouslyClosedPanesAndTabs{};
 
         uint32_t _systemRowsToScroll{ DefaultRowsToScroll };
@@ -286,6 +317,7 @@ namespace winrt::TerminalApp::implementation
         winrt::Windows::Foundation::IAsyncOperation<winrt::Windows::UI::Xaml::Controls::ContentDialogResult> _ShowLargePasteWarningDialog();
 
         void _CreateNewTabFlyout();
+        void _PopulateNewTabFlyout(const winrt::Windows::UI::Xaml::Controls::MenuFlyout& newTabFlyout);
         std::vector<winrt::Windows::UI::Xaml::Controls::MenuFlyoutItemBase> _CreateNewTabFlyoutItems(winrt::Windows::Foundation::Collections::IVector<Microsoft::Terminal::Settings::Model::NewTabMenuEntry> entries);
         winrt::Windows::UI::Xaml::Controls::IconElement _CreateNewTabFlyoutIcon(const winrt::hstring& icon);
         winrt::Windows::UI::Xaml::Controls::MenuFlyoutItem _CreateNewTabFlyoutProfile(const Microsoft::Terminal::Settings::Model::Profile profile, int profileIndex);
@@ -293,7 +325,9 @@ namespace winrt::TerminalApp::implementation
         void _OpenNewTabDropdown();
         HRESULT _OpenNewTab(const Microsoft::Terminal::Settings::Model::NewTerminalArgs& newTerminalArgs, winrt::Microsoft::Terminal::TerminalConnection::ITerminalConnection existingConnection = nullptr);
         void _CreateNewTabFromPane(std::shared_ptr<Pane> pane, uint32_t insertPosition = -1);
-        winrt::Microsoft::Terminal::TerminalConnection::ITerminalConnection _CreateConnectionFromSettings(Microsoft::Terminal::Settings::Model::Profile profile, Microsoft::Terminal::Settings::Model::TerminalSettings settings);
+        winrt::Microsoft::Terminal::TerminalConnection::ITerminalConnection _CreateConnectionFromSettings(Microsoft::Terminal::Settings::Model::Profile profile, Microsoft::Terminal::Settings::Model::TerminalSettings settings, const winrt::guid& sessionId = {});
+        static std::filesystem::path _bufferSnapshotPath(const winrt::guid& sessionId);
+        void _PersistBuffers();
 
         winrt::fire_and_forget _OpenNewWindow(const Microsoft::Terminal::Settings::Model::NewTerminalArgs newTerminalArgs);
 
@@ -320,7 +354,7 @@ namespace winrt::TerminalApp::implementation
         void _DuplicateTab(const TerminalTab& tab);
 
         void _SplitTab(TerminalTab& tab);
-        winrt::fire_and_forget _ExportTab(const TerminalTab& tab, winrt::hstring filepath);
+        winrt::fire_and_forget _ExportTab(const TerminalTab& tab, winrt::hstring filepath, winrt::Microsoft::Terminal::Control::ExportBufferFormat format);
 
         winrt::Windows::Foundation::IAsyncAction _HandleCloseTabRequested(winrt::TerminalApp::TabBase tab);
         void _CloseTabAtIndex(uint32_t index);
@@ -421,11 +455,20 @@ namespace winrt::TerminalApp::implementation
         void _OnTabCloseRequested(const IInspectable& sender, const Microsoft::UI::Xaml::Controls::TabViewTabCloseRequestedEventArgs& eventArgs);
         void _OnFirstLayout(const IInspectable& sender, const IInspectable& eventArgs);
         void _UpdatedSelectedTab(const winrt::TerminalApp::TabBase& tab);
+        void _ShowTabContent(const winrt::TerminalApp::TabBase& tab);
+        void _RemoveTabContent(const winrt::TerminalApp::TabBase& tab);
         void _UpdateBackground(const winrt::Microsoft::Terminal::Settings::Model::Profile& profile);
 
         void _OnDispatchCommandRequested(const IInspectable& sender, const Microsoft::Terminal::Settings::Model::Command& command);
         void _OnCommandLineExecutionRequested(const IInspectable& sender, const winrt::hstring& commandLine);
         void _OnSwitchToTabRequested(const IInspectable& sender, const winrt::TerminalApp::TabBase& tab);
+        void _OnFindInAllPanesRequested(const IInspectable& sender, const winrt::hstring& query);
+        void _OnJumpToSearchResultRequested(const IInspectable& sender, const winrt::TerminalApp::SearchResultPaletteItem& item);
+        winrt::fire_and_forget _FindInPane(const uint64_t generation,
+                                           const Windows::Foundation::IAsyncOperation<Windows::Foundation::Collections::IVector<Microsoft::Terminal::Control::SearchResult>> operation,
+                                           const winrt::TerminalApp::TabBase tab,
+                                           const uint32_t paneId,
+                                           const Microsoft::Terminal::Control::TermControl control);
 
         void _Find(const TerminalTab& tab);
 
@@ -444,6 +487,13 @@ namespace winrt::TerminalApp::implementation
         void _ClearNewTabButtonColor();
 
         void _StartInboundListener();
+        void _StartLowMemoryWatch();
+        static void CALLBACK _LowMemoryCallback(PTP_CALLBACK_INSTANCE instance, void* context, PTP_WAIT wait, TP_WAIT_RESULT result) noexcept;
+        winrt::fire_and_forget _LowMemoryHandler();
+        void _TrimMemory();
+        void _ScheduleIdleTrim();
+        void _IdleTrimTimerTick(const IInspectable& sender, const IInspectable& e);
+        std::wstring _FormatMemoryUsage();
 
         winrt::fire_and_forget _CompleteInitialization();
 
@@ -80,6 +80,18 @@ namespace winrt::TerminalApp::implementation
             _ClosedHandlers(nullptr, nullptr);
         });
 
+        _controlTitleChanged = std::make_shared<ThrottledFuncTrailing<>>(
+            winrt::Windows::System::DispatcherQueue::GetForCurrentThread(),
+            std::chrono::milliseconds{ 50 },
+            [weakThis = get_weak()]() {
+                // The title of the control changed, but not necessarily the title of the tab.
+                // Set the tab's text to the active panes' text, but only if that changed anything.
+                if (auto tab{ weakThis.get() }; tab && tab->_GetActiveTitle() != tab->Title())
+                {
+                    tab->UpdateTitle();
+                }
+            });
+
         Content(_rootPane->GetRootElement());
 
         _MakeTabViewItem();
@@ -911,14 +923,11 @@ namespace winrt::TerminalApp::implementation
         auto dispatcher = TabViewItem().Dispatcher();
         ControlEventTokens events{};
 
-        events.titleToken = control.TitleChanged([dispatcher, weakThis](auto&&, auto&&) -> winrt::fire_and_forget {
-            co_await wil::resume_foreground(dispatcher);
-            // Check if Tab's lifetime has expired
-            if (auto tab{ weakThis.get() })
+        events.titleToken = control.TitleChanged([weakTitleChanged = std::weak_ptr{ _controlTitleChanged }](auto&&, auto&&) {
+            // This is called on the output thread. The throttled function gets us back onto the UI thread.
+            if (const auto titleChanged = weakTitleChanged.lock())
             {
-                // The title of the control changed, but not necessarily the title of the tab.
-                // Set the tab's text to the active panes' text.
-                tab->UpdateTitle();
+                titleChanged->Run();
             }
         });
 
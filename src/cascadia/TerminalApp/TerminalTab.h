@@ -7,6 +7,8 @@
 #include "TabBase.h"
 #include "TerminalTab.g.h"
 
+#include <ThrottledFunc.h>
+
 // fwdecl unittest classes
 namespace TerminalAppLocalTests
 {
@@ -137,6 +139,10 @@ namespace winrt::TerminalApp::implementation
 
         winrt::event_token _rootClosedToken{};
 
+        // Shells that show timers or progress in their title may change it many times a second.
+        // The title changes of our controls are coalesced with this, before they're applied to the tab.
+        std::shared_ptr<ThrottledFuncTrailing<>> _controlTitleChanged;
+
         std::vector<uint32_t> _mruPanes;
         uint32_t _nextPaneId{ 0 };
 
@@ -237,7 +237,20 @@ namespace winrt::TerminalApp::implementation
 
             AppLogic::Current()->NotifyRootInitialized();
         });
+
+        TraceLoggingWrite(g_hTerminalAppProvider,
+                          "TerminalPageCreate",
+                          TraceLoggingDescription("Creating the TerminalPage and its startup actions"),
+                          TraceLoggingOpcode(WINEVENT_OPCODE_START),
+                          TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+                          TraceLoggingKeyword(TIL_KEYWORD_TRACE));
         _root->Create();
+        TraceLoggingWrite(g_hTerminalAppProvider,
+                          "TerminalPageCreate",
+                          TraceLoggingDescription("Creating the TerminalPage and its startup actions"),
+                          TraceLoggingOpcode(WINEVENT_OPCODE_STOP),
+                          TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+                          TraceLoggingKeyword(TIL_KEYWORD_TRACE));
 
         _RefreshThemeRoutine();
 
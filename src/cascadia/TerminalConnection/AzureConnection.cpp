@@ -187,8 +187,7 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
 
         if (_state == AzureState::TermConnected)
         {
-            auto buff{ winrt::to_string(data) };
-            WinHttpWebSocketSend(_webSocket.get(), WINHTTP_WEB_SOCKET_UTF8_MESSAGE_BUFFER_TYPE, buff.data(), gsl::narrow<DWORD>(buff.size()));
+            _QueueInput(data);
             return;
         }
 
@@ -223,6 +222,64 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
         }
     }
 
+    // Method description:
+    // - Queues up the given input to be sent to Cloud Shell.
+    // - Sending every keystroke as its own websocket message makes typing feel sluggish
+    //   on high latency links. Small inputs are thus batched up for _inputBatchingDelay,
+    //   similar to Nagle's algorithm. Large inputs (pastes) flush the queue immediately.
+    // Arguments:
+    // - the user's input
+    void AzureConnection::_QueueInput(const std::wstring_view data)
+    {
+        std::lock_guard<std::mutex> lock{ _sendMutex };
+
+        THROW_IF_FAILED(til::u16u8(data, _inputScratch));
+        _pendingInput.append(_inputScratch);
+
+        if (_pendingInput.size() >= _immediateSendThreshold || !_flushPendingInput)
+        {
+            _FlushPendingInputLocked();
+        }
+        else
+        {
+            (*_flushPendingInput)();
+        }
+    }
+
+    // Method description:
+    // - Sends all pending input to Cloud Shell. _sendMutex must be held,
+    //   which also ensures that messages are sent in order.
+    void AzureConnection::_FlushPendingInputLocked()
+    {
+        std::string_view remaining{ _pendingInput };
+
+        while (!remaining.empty() && _webSocket)
+        {
+            auto size = std::min(remaining.size(), _maxSendSize);
+
+            // Don't split a UTF-8 sequence across two messages. Continuation bytes are 0b10xxxxxx.
+            if (size < remaining.size())
+            {
+                while (size > 1 && (til::at(remaining, size) & 0xC0) == 0x80)
+                {
+                    --size;
+                }
+            }
+
+            const auto chunk = remaining.substr(0, size);
+            remaining = remaining.substr(size);
+
+            const auto status = WinHttpWebSocketSend(_webSocket.get(), WINHTTP_WEB_SOCKET_UTF8_MESSAGE_BUFFER_TYPE, const_cast<char*>(chunk.data()), gsl::narrow<DWORD>(chunk.size()));
+            if (status != NO_ERROR)
+            {
+                LOG_WIN32(status);
+                break;
+            }
+        }
+
+        _pendingInput.clear();
+    }
+
     // Method description:
     // - ascribes to the ITerminalConnection interface
     // - resizes the terminal
@@ -264,6 +321,11 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
 
             if (_state == AzureState::TermConnected)
             {
+                // Destroying the throttled_func waits for any pending flush to complete.
+                _flushPendingInput.reset();
+
+                std::lock_guard<std::mutex> lock{ _sendMutex };
+
                 // Close the websocket connection
                 std::ignore = WinHttpWebSocketClose(_webSocket.get(), WINHTTP_WEB_SOCKET_SUCCESS_CLOSE_STATUS, nullptr, 0); // throw away the error
                 _webSocket.reset();
@@ -779,6 +841,15 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
             _webSocket = std::move(socketHandle);
         }
 
+        // Capturing `this` is safe, because both Close() and our destructor
+        // destroy the throttled_func, which waits for pending callbacks.
+        _flushPendingInput = std::make_unique<til::throttled_func_trailing<>>(
+            _inputBatchingDelay,
+            [this]() {
+                std::lock_guard<std::mutex> lock{ _sendMutex };
+                _FlushPendingInputLocked();
+            });
+
         _state = AzureState::TermConnected;
 
         std::wstring queuedUserInput{};
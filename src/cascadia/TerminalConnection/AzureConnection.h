@@ -92,6 +92,22 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
 
         std::optional<std::wstring> _ReadUserInput(InputMode mode);
 
+        // Typed input is coalesced for this long before it's sent, so that a burst of
+        // keystrokes results in a single websocket message instead of one per key.
+        static constexpr auto _inputBatchingDelay = std::chrono::milliseconds(5);
+        // Input at least this large (most likely a paste) is sent right away.
+        static constexpr size_t _immediateSendThreshold = 256;
+        // Large inputs are split into websocket messages of at most this size.
+        static constexpr size_t _maxSendSize = 64 * 1024;
+
+        void _QueueInput(const std::wstring_view data);
+        void _FlushPendingInputLocked();
+
+        std::mutex _sendMutex;
+        std::string _pendingInput;
+        std::string _inputScratch;
+        std::unique_ptr<til::throttled_func_trailing<>> _flushPendingInput;
+
         winrt::Windows::Web::Http::HttpClient _httpClient{ nullptr };
         wil::unique_winhttp_hinternet _socketSessionHandle;
         wil::unique_winhttp_hinternet _socketConnectionHandle;
@@ -99,7 +115,9 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
 
         til::u8state _u8State{};
         std::wstring _u16Str;
-        std::array<char, 4096> _buffer{};
+        // Cloud Shell tends to send its output in large frames. A larger buffer results
+        // in fewer, larger chunks being passed to our output handlers.
+        std::array<char, 16 * 1024> _buffer{};
 
         static winrt::hstring _ParsePreferredShellType(const winrt::Windows::Data::Json::JsonObject& settingsResponse);
     };
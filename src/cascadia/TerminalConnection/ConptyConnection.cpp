@@ -7,11 +7,13 @@
 #include <conpty-static.h>
 #include <til/string.h>
 #include <til/env.h>
+#include <til/mutex.h>
 #include <winternl.h>
 
 #include "CTerminalHandoff.h"
 #include "LibraryResources.h"
 #include "../../types/inc/utils.hpp"
+#include "../../inc/ConptyBinaryInput.hpp"
 
 #include "ConptyConnection.g.cpp"
 
@@ -38,11 +40,13 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
     // - creates some basic anonymous pipes and passes them to CreatePseudoConsole
     // Arguments:
     // - size: The size of the conpty to create, in characters.
+    // - overlappedOutputSize: If non-zero, the output pipe will be a named pipe with this buffer size
+    //   and our end of it will be opened with FILE_FLAG_OVERLAPPED. Anonymous pipes don't support overlapped IO.
     // - phInput: Receives the handle to the newly-created anonymous pipe for writing input to the conpty.
     // - phOutput: Receives the handle to the newly-created anonymous pipe for reading the output of the conpty.
     // - phPc: Receives a token value to identify this conpty
 #pragma warning(suppress : 26430) // This statement sufficiently checks the out parameters. Analyzer cannot find this.
-    static HRESULT _CreatePseudoConsoleAndPipes(const COORD size, const DWORD dwFlags, HANDLE* phInput, HANDLE* phOutput, HPCON* phPC) noexcept
+    static HRESULT _CreatePseudoConsoleAndPipes(const COORD size, const DWORD dwFlags, const DWORD overlappedOutputSize, HANDLE* phInput, HANDLE* phOutput, HPCON* phPC) noexcept
     {
         RETURN_HR_IF(E_INVALIDARG, phPC == nullptr || phInput == nullptr || phOutput == nullptr);
 
@@ -50,13 +54,117 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
         wil::unique_hfile inPipeOurSide, inPipePseudoConsoleSide;
 
         RETURN_IF_WIN32_BOOL_FALSE(CreatePipe(&inPipePseudoConsoleSide, &inPipeOurSide, nullptr, 0));
-        RETURN_IF_WIN32_BOOL_FALSE(CreatePipe(&outPipeOurSide, &outPipePseudoConsoleSide, nullptr, 0));
+
+        if (overlappedOutputSize)
+        {
+            try
+            {
+                const auto pipeName = fmt::format(L"\\\\.\\pipe\\conpty-output-{}-{}", GetCurrentProcessId(), Utils::GuidToString(Utils::CreateGuid()));
+                outPipeOurSide.reset(CreateNamedPipeW(pipeName.c_str(),
+                                                      PIPE_ACCESS_INBOUND | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE,
+                                                      PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+                                                      1,
+                                                      0,
+                                                      overlappedOutputSize,
+                                                      0,
+                                                      nullptr));
+                RETURN_LAST_ERROR_IF(!outPipeOurSide);
+                outPipePseudoConsoleSide.reset(CreateFileW(pipeName.c_str(), GENERIC_WRITE | FILE_READ_ATTRIBUTES, 0, nullptr, OPEN_EXISTING, 0, nullptr));
+                RETURN_LAST_ERROR_IF(!outPipePseudoConsoleSide);
+            }
+            CATCH_RETURN();
+        }
+        else
+        {
+            RETURN_IF_WIN32_BOOL_FALSE(CreatePipe(&outPipeOurSide, &outPipePseudoConsoleSide, nullptr, 0));
+        }
+
         RETURN_IF_FAILED(ConptyCreatePseudoConsole(size, inPipePseudoConsoleSide.get(), outPipePseudoConsoleSide.get(), dwFlags, phPC));
         *phInput = inPipeOurSide.release();
         *phOutput = outPipeOurSide.release();
         return S_OK;
     }
 
+    static void _closeWarmPseudoConsole(HPCON hPC) noexcept
+    {
+        ::ConptyClosePseudoConsoleTimeout(hPC, 0);
+    }
+
+    // A pseudoconsole whose OpenConsole has already been started, but which doesn't have a client yet.
+    // See _takeWarmPseudoConsole().
+    struct WarmPseudoConsole
+    {
+        DWORD flags = 0;
+        DWORD overlappedOutputSize = 0;
+        wil::unique_hfile inPipe;
+        wil::unique_hfile outPipe;
+        wil::unique_any<HPCON, decltype(_closeWarmPseudoConsole), _closeWarmPseudoConsole> hPC;
+    };
+
+    // At most one warm pseudoconsole per combination of flags and output pipe size.
+    static til::shared_mutex<std::vector<WarmPseudoConsole>> s_warmPseudoConsoles;
+
+    // Function Description:
+    // - Creates a pseudoconsole with the given flags in the background and puts it into
+    //   s_warmPseudoConsoles, unless there's already one for these flags.
+    static winrt::fire_and_forget _prepareWarmPseudoConsole(const DWORD flags, const DWORD overlappedOutputSize)
+    {
+        co_await winrt::resume_background();
+
+        {
+            const auto pool = s_warmPseudoConsoles.lock_shared();
+            if (std::any_of(pool->begin(), pool->end(), [&](const auto& pc) { return pc.flags == flags && pc.overlappedOutputSize == overlappedOutputSize; }))
+            {
+                co_return;
+            }
+        }
+
+        WarmPseudoConsole pc{ flags, overlappedOutputSize };
+        // The size doesn't matter, since _takeWarmPseudoConsole() resizes it before a client is attached.
+        if (FAILED_LOG(_CreatePseudoConsoleAndPipes({ 120, 30 }, flags, overlappedOutputSize, pc.inPipe.put(), pc.outPipe.put(), pc.hPC.put())))
+        {
+            co_return;
+        }
+
+        const auto pool = s_warmPseudoConsoles.lock();
+        if (std::none_of(pool->begin(), pool->end(), [&](const auto& p) { return p.flags == flags && p.overlappedOutputSize == overlappedOutputSize; }))
+        {
+            pool->emplace_back(std::move(pc));
+        }
+    }
+
+    // Function Description:
+    // - Hands out a previously prepared pseudoconsole with the given flags, resized to the given size.
+    //   This way opening a new tab only has to wait for the shell to start and not for OpenConsole as well.
+    // Return Value:
+    // - true if a pseudoconsole was available. Otherwise the out parameters are left untouched.
+    static bool _takeWarmPseudoConsole(const COORD size, const DWORD flags, const DWORD overlappedOutputSize, HANDLE* phInput, HANDLE* phOutput, HPCON* phPC) noexcept
+    {
+        WarmPseudoConsole pc;
+
+        {
+            const auto pool = s_warmPseudoConsoles.lock();
+            const auto it = std::find_if(pool->begin(), pool->end(), [&](const auto& p) { return p.flags == flags && p.overlappedOutputSize == overlappedOutputSize; });
+            if (it == pool->end())
+            {
+                return false;
+            }
+            pc = std::move(*it);
+            pool->erase(it);
+        }
+
+        // If OpenConsole went away in the meantime, this fails and we simply create a new one.
+        if (FAILED_LOG(ConptyResizePseudoConsole(pc.hPC.get(), size)))
+        {
+            return false;
+        }
+
+        *phInput = pc.inPipe.release();
+        *phOutput = pc.outPipe.release();
+        *phPC = pc.hPC.release();
+        return true;
+    }
+
     // Function Description:
     // - launches the client application attached to the new pseudoconsole
     HRESULT ConptyConnection::_LaunchAttachedClient() noexcept
@@ -285,6 +393,31 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
             _reloadEnvironmentVariables = winrt::unbox_value_or<bool>(settings.TryLookup(L"reloadEnvironmentVariables").try_as<Windows::Foundation::IPropertyValue>(),
                                                                       _reloadEnvironmentVariables);
             _profileGuid = winrt::unbox_value_or<winrt::guid>(settings.TryLookup(L"profileGuid").try_as<Windows::Foundation::IPropertyValue>(), _profileGuid);
+
+            // With an outputBufferCount of 2 or more, the output pipe is read with overlapped IO into that many
+            // rotating buffers of outputBufferSize bytes each. This way OpenConsole can keep writing into the
+            // next buffer while we're still busy parsing the previous one. Useful for high-bandwidth sessions.
+            _outputBufferCount = winrt::unbox_value_or<uint32_t>(settings.TryLookup(L"outputBufferCount").try_as<Windows::Foundation::IPropertyValue>(), _outputBufferCount);
+            _outputBufferSize = winrt::unbox_value_or<uint32_t>(settings.TryLookup(L"outputBufferSize").try_as<Windows::Foundation::IPropertyValue>(), _outputBufferSize);
+            _outputBufferCount = std::clamp<uint32_t>(_outputBufferCount, 1, 16);
+            _outputBufferSize = std::clamp<uint32_t>(_outputBufferSize, 4 * 1024, 1024 * 1024);
+
+            // With warmPseudoConsole set, Start() takes a pseudoconsole whose OpenConsole was started ahead
+            // of time and then prepares the next one for the following connection with the same settings.
+            _warmPseudoConsole = winrt::unbox_value_or<bool>(settings.TryLookup(L"warmPseudoConsole").try_as<Windows::Foundation::IPropertyValue>(), _warmPseudoConsole);
+
+            // With maxOutputBytesPerSecond set, the output thread stops reading once a pane exceeds that rate.
+            // The output pipe then fills up and blocks the client, instead of it hogging a core for parsing
+            // and rendering and starving the other panes. 0 means unlimited.
+            _maxOutputBytesPerSecond = winrt::unbox_value_or<uint32_t>(settings.TryLookup(L"maxOutputBytesPerSecond").try_as<Windows::Foundation::IPropertyValue>(), _maxOutputBytesPerSecond);
+            if (_maxOutputBytesPerSecond)
+            {
+                _maxOutputBytesPerSecond = std::max<uint32_t>(_maxOutputBytesPerSecond, 4 * 1024);
+            }
+
+            // With recordingDirectory set, the raw output of the connection is recorded into a file in that
+            // directory, named after the session GUID. See SessionRecording.h for the format.
+            _recordingDirectory = winrt::unbox_value_or<winrt::hstring>(settings.TryLookup(L"recordingDirectory").try_as<Windows::Foundation::IPropertyValue>(), _recordingDirectory);
         }
 
         if (_guid == guid{})
@@ -326,12 +459,14 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
         _transitionToState(ConnectionState::Connecting);
 
         const til::size dimensions{ gsl::narrow<til::CoordType>(_cols), gsl::narrow<til::CoordType>(_rows) };
+        const auto visibility = _initialVisibility;
 
         // If we do not have pipes already, then this is a fresh connection... not an inbound one that is a received
         // handoff from an already-started PTY process.
         if (!_inPipe)
         {
-            DWORD flags = PSEUDOCONSOLE_RESIZE_QUIRK | PSEUDOCONSOLE_WIN32_INPUT_MODE;
+            // The Terminal understands REP, so conpty may compress runs of the same character with it.
+            DWORD flags = PSEUDOCONSOLE_RESIZE_QUIRK | PSEUDOCONSOLE_WIN32_INPUT_MODE | PSEUDOCONSOLE_REPEAT_CHARACTER;
 
             // If we're using an existing buffer, we want the new connection
             // to reuse the existing cursor. When not setting this flag, the
@@ -351,7 +486,33 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
                 }
             }
 
-            THROW_IF_FAILED(_CreatePseudoConsoleAndPipes(til::unwrap_coord_size(dimensions), flags, &_inPipe, &_outPipe, &_hPC));
+            // A recording has to contain the text itself and not just frames that refer to the shared buffer.
+            if (!WI_IsFlagSet(flags, PSEUDOCONSOLE_PASSTHROUGH_MODE) && _recordingDirectory.empty())
+            {
+                WI_SetFlag(flags, PSEUDOCONSOLE_SHARED_BUFFER);
+            }
+
+            // Inbound handoffs hand us a synchronous pipe, so this only applies to connections we create ourselves.
+            _overlappedOutput = _outputBufferCount > 1;
+
+            const auto overlappedOutputSize = _overlappedOutput ? _outputBufferSize : 0;
+
+            // PSEUDOCONSOLE_INHERIT_CURSOR makes OpenConsole wait for our reply to its cursor position
+            // request during startup, so those pseudoconsoles can't be prepared ahead of time.
+            if (_warmPseudoConsole && WI_IsFlagClear(flags, PSEUDOCONSOLE_INHERIT_CURSOR))
+            {
+                if (!_takeWarmPseudoConsole(til::unwrap_coord_size(dimensions), flags, overlappedOutputSize, &_inPipe, &_outPipe, &_hPC))
+                {
+                    THROW_IF_FAILED(_CreatePseudoConsoleAndPipes(til::unwrap_coord_size(dimensions), flags, overlappedOutputSize, &_inPipe, &_outPipe, &_hPC));
+                }
+                _prepareWarmPseudoConsole(flags, overlappedOutputSize);
+            }
+            else
+            {
+                THROW_IF_FAILED(_CreatePseudoConsoleAndPipes(til::unwrap_coord_size(dimensions), flags, overlappedOutputSize, &_inPipe, &_outPipe, &_hPC));
+            }
+
+            _attachSharedBuffer();
 
             if (_initialParentHwnd != 0)
             {
@@ -359,9 +520,9 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
             }
 
             // GH#12515: The conpty assumes it's hidden at the start. If we're visible, let it know now.
-            if (_initialVisibility)
+            if (visibility)
             {
-                THROW_IF_FAILED(ConptyShowHidePseudoConsole(_hPC.get(), _initialVisibility));
+                THROW_IF_FAILED(ConptyShowHidePseudoConsole(_hPC.get(), visibility));
             }
 
             THROW_IF_FAILED(_LaunchAttachedClient());
@@ -383,9 +544,9 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
             THROW_IF_FAILED(ConptyResizePseudoConsole(_hPC.get(), til::unwrap_coord_size(dimensions)));
             THROW_IF_FAILED(ConptyReparentPseudoConsole(_hPC.get(), reinterpret_cast<HWND>(_initialParentHwnd)));
 
-            if (_initialVisibility)
+            if (visibility)
             {
-                THROW_IF_FAILED(ConptyShowHidePseudoConsole(_hPC.get(), _initialVisibility));
+                THROW_IF_FAILED(ConptyShowHidePseudoConsole(_hPC.get(), visibility));
             }
         }
 
@@ -393,6 +554,20 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
 
         _startTime = std::chrono::high_resolution_clock::now();
 
+        // A connection that's restarted keeps appending to the same recording. It's flushed and closed on destruction.
+        if (!_recordingDirectory.empty() && !_recorder)
+        {
+            try
+            {
+                auto name = Utils::GuidToString(_guid);
+                name = name.substr(1, name.size() - 2);
+                std::filesystem::path path{ wil::ExpandEnvironmentStringsW<std::wstring>(_recordingDirectory.c_str()) };
+                path /= name + L".wtrec";
+                _recorder = std::make_unique<SessionRecorder>(path, _cols, _rows);
+            }
+            CATCH_LOG();
+        }
+
         // Create our own output handling thread
         // This must be done after the pipes are populated.
         // Each connection needs to make sure to drain the output from its backing host.
@@ -403,7 +578,7 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
                 const auto pInstance = static_cast<ConptyConnection*>(lpParameter);
                 if (pInstance)
                 {
-                    return pInstance->_OutputThread();
+                    return pInstance->_overlappedOutput ? pInstance->_OutputThreadOverlapped() : pInstance->_OutputThread();
                 }
                 return gsl::narrow_cast<DWORD>(E_INVALIDARG);
             },
@@ -416,6 +591,18 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
         LOG_IF_FAILED(SetThreadDescription(_hOutputThread.get(), L"ConptyConnection Output Thread"));
 
         _transitionToState(ConnectionState::Connected);
+
+        // ControlCore calls Start() on a background thread. Until we're connected, Resize() and ShowHide()
+        // only stash their arguments, so apply anything that arrived while we were busy starting up.
+        const til::size currentDimensions{ gsl::narrow<til::CoordType>(_cols), gsl::narrow<til::CoordType>(_rows) };
+        if (currentDimensions != dimensions)
+        {
+            LOG_IF_FAILED(ConptyResizePseudoConsole(_hPC.get(), til::unwrap_coord_size(currentDimensions)));
+        }
+        if (_initialVisibility != visibility)
+        {
+            LOG_IF_FAILED(ConptyShowHidePseudoConsole(_hPC.get(), _initialVisibility));
+        }
     }
     catch (...)
     {
@@ -478,6 +665,54 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
     }
     CATCH_LOG()
 
+    // Function Description:
+    // - Converts input from UTF-16LE to UTF-8 as ConPty expects UTF-8, except for binary input records,
+    //   which are packed into frames of up to MaxRecordsPerFrame records each. See ConptyBinaryInput.hpp.
+    // Arguments:
+    // - input: The input to encode.
+    // - out: Receives the encoded input.
+    static void _encodeInput(const std::wstring_view input, std::string& out)
+    {
+        using namespace ::Microsoft::Console::BinaryInput;
+
+        out.clear();
+        auto rest = input;
+
+        while (!rest.empty())
+        {
+            // A marker that isn't followed by a whole record can't have come from TerminalInput.
+            // It's converted like any other text then (into U+FDD0), which ConPTY will just pass along.
+            auto pos = rest.find(RecordMarker);
+            if (pos != std::wstring_view::npos && rest.size() - pos <= RecordLength)
+            {
+                pos = std::wstring_view::npos;
+            }
+
+            const auto text = rest.substr(0, pos);
+            if (!text.empty())
+            {
+                const auto offset = out.size();
+                out.resize(offset + text.size() * 3);
+                out.resize(offset + til::details::u16u8(text.data(), text.size(), out.data() + offset));
+                rest = rest.substr(text.size());
+                continue;
+            }
+
+            // A run of consecutive records turns into as few frames as possible.
+            const auto frameOffset = out.size();
+            out.push_back(FrameIntroducer);
+            out.push_back(0);
+            size_t count = 0;
+            while (count < MaxRecordsPerFrame && rest.size() > RecordLength && rest.front() == RecordMarker)
+            {
+                out.append(reinterpret_cast<const char*>(rest.data() + 1), sizeof(INPUT_RECORD));
+                rest = rest.substr(1 + RecordLength);
+                count++;
+            }
+            out[frameOffset + 1] = static_cast<char>(count);
+        }
+    }
+
     void ConptyConnection::WriteInput(const hstring& data)
     {
         if (!_isConnected())
@@ -485,9 +720,9 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
             return;
         }
 
-        // convert from UTF-16LE to UTF-8 as ConPty expects UTF-8
         // TODO GH#3378 reconcile and unify UTF-8 converters
-        auto str = winrt::to_string(data);
+        std::string str;
+        _encodeInput(data, str);
         LOG_IF_WIN32_BOOL_FALSE(WriteFile(_inPipe.get(), str.c_str(), (DWORD)str.length(), nullptr, nullptr));
     }
 
@@ -497,6 +732,11 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
         _rows = rows;
         _cols = columns;
 
+        if (_recorder)
+        {
+            _recorder->Resize(columns, rows);
+        }
+
         if (_isConnected())
         {
             THROW_IF_FAILED(ConptyResizePseudoConsole(_hPC.get(), { Utils::ClampToShortMax(columns, 1), Utils::ClampToShortMax(rows, 1) }));
@@ -564,6 +804,11 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
                 // reference UI objects like `ControlCore`. CancelSynchronousIo() allows us to have the background
                 // thread exit as fast as possible by aborting any ongoing writes coming from OpenConsole.
                 CancelSynchronousIo(_hOutputThread.get());
+                if (_overlappedOutput)
+                {
+                    // The overlapped output thread doesn't block in ReadFile(), but in GetOverlappedResult().
+                    CancelIoEx(_outPipe.get(), nullptr);
+                }
 
                 // Waiting for the output thread to exit ensures that all pending _TerminalOutputHandlers()
                 // calls have returned and won't notify our caller (ControlCore) anymore. This ensures that
@@ -656,41 +901,333 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
                 }
             }
 
-            const auto result{ til::u8u16(std::string_view{ _buffer.data(), read }, _u16Str, _u8State) };
-            if (FAILED(result))
+            const auto result = _OutputChunk({ _buffer.data(), read });
+            if (result != S_OK)
             {
-                // EXIT POINT
-                _indicateExitWithStatus(result); // print a message
-                _transitionToState(ConnectionState::Failed);
-                return gsl::narrow_cast<DWORD>(result);
+                return FAILED(result) ? gsl::narrow_cast<DWORD>(result) : 0;
             }
+        }
+
+        return 0;
+    }
+
+    // Decodes a chunk of output read from the output pipe and passes it to our registered event handlers.
+    // Shared between _OutputThread() and _OutputThreadOverlapped().
+    // Return Value:
+    // - S_OK if the output thread should keep reading, S_FALSE if it should exit gracefully,
+    //   or a failure code if the connection has been transitioned into the Failed state.
+    HRESULT ConptyConnection::_OutputChunk(const std::string_view chunk)
+    {
+#pragma warning(suppress : 26477 26485 26494 26482 26446) // We don't control TraceLoggingWrite
+        TraceLoggingWrite(g_hTerminalConnectionProvider,
+                          "ConPtyOutputRead",
+                          TraceLoggingDescription("Output was read from the output pipe"),
+                          TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+                          TraceLoggingUInt64(chunk.size(), "Bytes"),
+                          TraceLoggingKeyword(TIL_KEYWORD_TRACE));
+
+        // This is recorded before the throttling, so that a replay reproduces the rate
+        // at which the client application produced the output, not the throttled one.
+        if (_recorder)
+        {
+            _recorder->Output(chunk);
+        }
+
+        if (_maxOutputBytesPerSecond)
+        {
+            _throttleOutput(chunk.size());
+        }
+
+        const auto result{ _sharedBuffer.IsAttached() ? _decodeWithSharedBuffer(chunk) : til::u8u16(chunk, _u16Str, _u8State) };
+        if (FAILED(result))
+        {
+            // EXIT POINT
+            _indicateExitWithStatus(result); // print a message
+            _transitionToState(ConnectionState::Failed);
+            return result;
+        }
+
+        if (_u16Str.empty())
+        {
+            return S_FALSE;
+        }
+
+        if (!_receivedFirstByte)
+        {
+            const auto now = std::chrono::high_resolution_clock::now();
+            const std::chrono::duration<double> delta = now - _startTime;
+
+#pragma warning(suppress : 26477 26485 26494 26482 26446) // We don't control TraceLoggingWrite
+            TraceLoggingWrite(g_hTerminalConnectionProvider,
+                              "ReceivedFirstByte",
+                              TraceLoggingDescription("An event emitted when the connection receives the first byte"),
+                              TraceLoggingGuid(_guid, "SessionGuid", "The WT_SESSION's GUID"),
+                              TraceLoggingFloat64(delta.count(), "Duration"),
+                              TraceLoggingKeyword(MICROSOFT_KEYWORD_MEASURES),
+                              TelemetryPrivacyDataTag(PDT_ProductAndServicePerformance));
+            _receivedFirstByte = true;
+        }
 
-            if (_u16Str.empty())
+        // Pass the output to our registered event handlers.
+        // Since _u16Str is a null-terminated std::wstring, this gets turned into a
+        // winrt::param::hstring which borrows our buffer instead of allocating an HSTRING.
+        // ControlCore then parses it straight into the Terminal without another copy.
+        _TerminalOutputHandlers(_u16Str);
+        return S_OK;
+    }
+
+    // Maps the shared buffer of a pseudoconsole we created, if it has one (see PSEUDOCONSOLE_SHARED_BUFFER).
+    // Without it, or if anything goes wrong, the output simply doesn't contain any frames.
+    void ConptyConnection::_attachSharedBuffer() noexcept
+    {
+        _sharedBuffer = {};
+        _sharedBufferView.reset();
+        _sharedBufferFrameLength = 0;
+
+        wil::unique_handle section;
+        if (FAILED(ConptyGetSharedBuffer(_hPC.get(), section.put())))
+        {
+            return;
+        }
+
+        // The reader needs write access as well, since that's how it makes room in the ring.
+        _sharedBufferView.reset(static_cast<std::byte*>(MapViewOfFile(section.get(), FILE_MAP_WRITE, 0, 0, SharedBuffer::SectionSize)));
+        if (!_sharedBufferView)
+        {
+            LOG_LAST_ERROR();
+            return;
+        }
+
+        if (!_sharedBuffer.Attach({ _sharedBufferView.get(), SharedBuffer::SectionSize }, SharedBuffer::Ring::End::Reader))
+        {
+            LOG_HR(E_UNEXPECTED);
+            _sharedBufferView.reset();
+        }
+    }
+
+    // The equivalent of til::u8u16(chunk, _u16Str, _u8State) for when OpenConsole
+    // may put frames into its output, which are replaced with the text they refer to.
+    // Frames never appear in the middle of a UTF-8 sequence, since 0xFE isn't valid
+    // UTF-8, but a frame may be split across two chunks.
+    HRESULT ConptyConnection::_decodeWithSharedBuffer(std::string_view chunk) noexcept
+    try
+    {
+        _u16Str.clear();
+
+        for (;;)
+        {
+            if (_sharedBufferFrameLength)
             {
-                return 0;
+                const auto count = std::min(SharedBuffer::FrameSize - _sharedBufferFrameLength, chunk.size());
+                memcpy(&_sharedBufferFrame[_sharedBufferFrameLength], chunk.data(), count);
+                _sharedBufferFrameLength += count;
+                chunk = chunk.substr(count);
+
+                if (_sharedBufferFrameLength < SharedBuffer::FrameSize)
+                {
+                    break;
+                }
+
+                uint32_t length;
+                memcpy(&length, &_sharedBufferFrame[1], sizeof(length));
+                _sharedBufferFrameLength = 0;
+                // OpenConsole writes the text before the frame, so this only fails if the output is corrupt.
+                RETURN_HR_IF(E_UNEXPECTED, !_sharedBuffer.Read(length, _u16Str));
+            }
+
+            const auto frame = chunk.find(SharedBuffer::FrameIntroducer);
+            if (const auto text = chunk.substr(0, frame); !text.empty())
+            {
+                RETURN_IF_FAILED(til::u8u16(text, _sharedBufferScratch, _u8State));
+                _u16Str.append(_sharedBufferScratch);
             }
 
-            if (!_receivedFirstByte)
+            if (frame == std::string_view::npos)
             {
-                const auto now = std::chrono::high_resolution_clock::now();
-                const std::chrono::duration<double> delta = now - _startTime;
+                break;
+            }
+
+            _sharedBufferFrame[0] = SharedBuffer::FrameIntroducer;
+            _sharedBufferFrameLength = 1;
+            chunk = chunk.substr(frame + 1);
+        }
+
+        return S_OK;
+    }
+    CATCH_RETURN()
+
+    // A token bucket that holds up to 1s worth of _maxOutputBytesPerSecond. If the given chunk exceeds the
+    // remaining budget, this blocks the output thread until the budget has been refilled. While we're not
+    // reading, OpenConsole blocks on the full output pipe, which in turn blocks the client application.
+    void ConptyConnection::_throttleOutput(const size_t bytes) noexcept
+    {
+        const auto rate = static_cast<int64_t>(_maxOutputBytesPerSecond);
+        auto now = std::chrono::steady_clock::now();
+
+        if (_outputBudgetTime != std::chrono::steady_clock::time_point{})
+        {
+            const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(now - _outputBudgetTime).count();
+            _outputBudget = std::min(rate, _outputBudget + elapsed * rate / 1000000);
+        }
+        else
+        {
+            _outputBudget = rate;
+        }
+
+        _outputBudgetTime = now;
+        _outputBudget -= static_cast<int64_t>(bytes);
+
+        if (_outputBudget >= 0)
+        {
+            return;
+        }
 
 #pragma warning(suppress : 26477 26485 26494 26482 26446) // We don't control TraceLoggingWrite
-                TraceLoggingWrite(g_hTerminalConnectionProvider,
-                                  "ReceivedFirstByte",
-                                  TraceLoggingDescription("An event emitted when the connection receives the first byte"),
-                                  TraceLoggingGuid(_guid, "SessionGuid", "The WT_SESSION's GUID"),
-                                  TraceLoggingFloat64(delta.count(), "Duration"),
-                                  TraceLoggingKeyword(MICROSOFT_KEYWORD_MEASURES),
-                                  TelemetryPrivacyDataTag(PDT_ProductAndServicePerformance));
-                _receivedFirstByte = true;
+        TraceLoggingWrite(g_hTerminalConnectionProvider,
+                          "ConPtyOutputThrottled",
+                          TraceLoggingDescription("The output thread stopped reading because the output rate limit was exceeded"),
+                          TraceLoggingGuid(_guid, "SessionGuid", "The WT_SESSION's GUID"),
+                          TraceLoggingInt64(-_outputBudget, "Bytes"),
+                          TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+                          TraceLoggingKeyword(TIL_KEYWORD_TRACE));
+
+        // Sleep in small slices, so that Close() doesn't have to wait for us for long.
+        auto remaining = std::chrono::microseconds{ -_outputBudget * 1000000 / rate };
+        while (remaining.count() > 0 && !_isStateAtOrBeyond(ConnectionState::Closing))
+        {
+            const auto slice = std::min<std::chrono::microseconds>(remaining, std::chrono::milliseconds{ 50 });
+            Sleep(gsl::narrow_cast<DWORD>(std::max<int64_t>(1, slice.count() / 1000)));
+            remaining -= slice;
+        }
+
+        now = std::chrono::steady_clock::now();
+        _outputBudget = std::min<int64_t>(0, _outputBudget + std::chrono::duration_cast<std::chrono::microseconds>(now - _outputBudgetTime).count() * rate / 1000000);
+        _outputBudgetTime = now;
+    }
+
+    // This is the equivalent of _OutputThread() for connections with an outputBufferCount of 2 or more.
+    // All buffers are queued up for reading at once. Since reads on a pipe complete in the order
+    // they were issued, we can simply cycle through them and re-issue each read right after we're
+    // done parsing its contents, while OpenConsole keeps filling the remaining ones in the meantime.
+    DWORD ConptyConnection::_OutputThreadOverlapped()
+    {
+        // Keep us alive until the output thread terminates; the destructor
+        // won't wait for us, and the known exit points _do_.
+        auto strongThis{ get_strong() };
+
+        struct Slot
+        {
+            OVERLAPPED overlapped{};
+            wil::unique_event event;
+            DWORD error = ERROR_SUCCESS;
+            bool pending = false;
+        };
+
+        const auto count = _outputBufferCount;
+        const auto size = _outputBufferSize;
+        std::vector<Slot> slots;
+        std::unique_ptr<char[]> buffers;
+
+        try
+        {
+            slots.resize(count);
+            buffers = std::make_unique<char[]>(size_t{ count } * size);
+            for (auto& slot : slots)
+            {
+                slot.event.create(wil::EventOptions::ManualReset);
+                slot.overlapped.hEvent = slot.event.get();
             }
+        }
+        catch (...)
+        {
+            // EXIT POINT
+            const auto hr = wil::ResultFromCaughtException();
+            _indicateExitWithStatus(hr); // print a message
+            _transitionToState(ConnectionState::Failed);
+            return gsl::narrow_cast<DWORD>(hr);
+        }
 
-            // Pass the output to our registered event handlers
-            _TerminalOutputHandlers(_u16Str);
+        // The buffers and OVERLAPPED structs must outlive any reads that are still in flight.
+        const auto cancelPendingReads = wil::scope_exit([&]() noexcept {
+            for (auto& slot : slots)
+            {
+                if (slot.pending)
+                {
+                    DWORD read{};
+                    CancelIoEx(_outPipe.get(), &slot.overlapped);
+                    GetOverlappedResult(_outPipe.get(), &slot.overlapped, &read, TRUE);
+                }
+            }
+        });
+
+        const auto bufferAt = [&](const size_t i) noexcept {
+            return buffers.get() + i * size;
+        };
+        // A read that fails synchronously stores its error in the slot, so that it gets handled
+        // only after all the reads in front of it have been processed, just like a failed read would.
+        const auto issueRead = [&](Slot& slot, char* buffer) noexcept {
+            if (ReadFile(_outPipe.get(), buffer, size, nullptr, &slot.overlapped) || GetLastError() == ERROR_IO_PENDING)
+            {
+                slot.pending = true;
+                slot.error = ERROR_SUCCESS;
+            }
+            else
+            {
+                slot.error = GetLastError();
+            }
+        };
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            issueRead(slots[i], bufferAt(i));
         }
 
-        return 0;
+        // process the data of the output pipe in a loop
+        for (size_t i = 0;; i = (i + 1) % count)
+        {
+            auto& slot = slots[i];
+            auto lastError = slot.error;
+            DWORD read{};
+
+            if (slot.pending)
+            {
+                slot.pending = false;
+                if (!GetOverlappedResult(_outPipe.get(), &slot.overlapped, &read, TRUE))
+                {
+                    lastError = GetLastError();
+                }
+            }
+
+            // When we call CancelIoEx() in Close() this is the branch that's taken and gets us out of here.
+            if (_isStateAtOrBeyond(ConnectionState::Closing))
+            {
+                return 0;
+            }
+
+            if (lastError != ERROR_SUCCESS)
+            {
+                // EXIT POINT
+                if (lastError == ERROR_BROKEN_PIPE)
+                {
+                    _LastConPtyClientDisconnected();
+                    return S_OK;
+                }
+                else
+                {
+                    _indicateExitWithStatus(HRESULT_FROM_WIN32(lastError)); // print a message
+                    _transitionToState(ConnectionState::Failed);
+                    return gsl::narrow_cast<DWORD>(HRESULT_FROM_WIN32(lastError));
+                }
+            }
+
+            const auto result = _OutputChunk({ bufferAt(i), read });
+            if (result != S_OK)
+            {
+                return FAILED(result) ? gsl::narrow_cast<DWORD>(result) : 0;
+            }
+
+            issueRead(slot, bufferAt(i));
+        }
     }
 
     static winrt::event<NewConnectionHandler> _newConnectionHandlers;
@@ -5,6 +5,8 @@
 
 #include "ConptyConnection.g.h"
 #include "ConnectionStateHolder.h"
+#include "SessionRecorder.h"
+#include "../../inc/ConptySharedBuffer.hpp"
 
 #include "ITerminalHandoff.h"
 
@@ -88,8 +90,24 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
 
         til::u8state _u8State{};
         std::wstring _u16Str{};
+        // See _attachSharedBuffer(). The frame holds the start of a frame that was split across two reads.
+        wil::unique_mapview_ptr<std::byte> _sharedBufferView;
+        ::Microsoft::Console::SharedBuffer::Ring _sharedBuffer;
+        std::array<char, ::Microsoft::Console::SharedBuffer::FrameSize> _sharedBufferFrame{};
+        size_t _sharedBufferFrameLength{};
+        std::wstring _sharedBufferScratch{};
         std::array<char, 4096> _buffer{};
+        // Only used by _OutputThreadOverlapped(). See Initialize().
+        uint32_t _outputBufferCount{ 1 };
+        uint32_t _outputBufferSize{ 4096 };
+        bool _overlappedOutput{};
         bool _passthroughMode{};
+        bool _warmPseudoConsole{};
+        uint32_t _maxOutputBytesPerSecond{};
+        int64_t _outputBudget{};
+        std::chrono::steady_clock::time_point _outputBudgetTime{};
+        hstring _recordingDirectory{};
+        std::unique_ptr<SessionRecorder> _recorder;
         bool _reloadEnvironmentVariables{};
         guid _profileGuid{};
 
@@ -103,6 +121,11 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
         } _startupInfo{};
 
         DWORD _OutputThread();
+        DWORD _OutputThreadOverlapped();
+        HRESULT _OutputChunk(std::string_view chunk);
+        void _attachSharedBuffer() noexcept;
+        HRESULT _decodeWithSharedBuffer(std::string_view chunk) noexcept;
+        void _throttleOutput(size_t bytes) noexcept;
     };
 }
 
@@ -0,0 +1,108 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "pch.h"
+#include "SessionRecorder.h"
+
+using namespace ::Microsoft::Terminal::SessionRecording;
+
+// If the disk can't keep up and this much is queued up already, further output is dropped
+// instead of being buffered without bounds. The recording will then have a gap in it.
+static constexpr size_t MaxPendingSize = 64 * 1024 * 1024;
+
+namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
+{
+    // Creates (or truncates) the file at `path` and writes the header into it.
+    // Throws if the file can't be created.
+    SessionRecorder::SessionRecorder(const std::filesystem::path& path, const til::CoordType columns, const til::CoordType rows) :
+        _start{ std::chrono::steady_clock::now() }
+    {
+        _file.reset(CreateFileW(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr));
+        THROW_LAST_ERROR_IF(!_file);
+
+        FILETIME now;
+        GetSystemTimeAsFileTime(&now);
+        AppendHeader(_pending, gsl::narrow_cast<uint16_t>(columns), gsl::narrow_cast<uint16_t>(rows), (uint64_t{ now.dwHighDateTime } << 32) | now.dwLowDateTime);
+
+        _thread = std::thread{ [this]() { _writerThread(); } };
+        LOG_IF_FAILED(SetThreadDescription(_thread.native_handle(), L"SessionRecorder Writer Thread"));
+    }
+
+    // Writes whatever is still queued up and closes the file.
+    SessionRecorder::~SessionRecorder()
+    {
+        {
+            const std::lock_guard guard{ _mutex };
+            _exit = true;
+        }
+        _cv.notify_one();
+        _thread.join();
+    }
+
+    // Method Description:
+    // - Records a chunk of output, as it was read from the output pipe.
+    void SessionRecorder::Output(const std::string_view chunk) noexcept
+    {
+        _append(EventType::Output, chunk);
+    }
+
+    void SessionRecorder::Resize(const til::CoordType columns, const til::CoordType rows) noexcept
+    {
+        const ResizePayload payload{ gsl::narrow_cast<uint16_t>(columns), gsl::narrow_cast<uint16_t>(rows) };
+        _append(EventType::Resize, { reinterpret_cast<const char*>(&payload), sizeof(payload) });
+    }
+
+    void SessionRecorder::_append(const EventType type, const std::string_view payload) noexcept
+    try
+    {
+        const auto microseconds = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - _start).count();
+        bool wasEmpty;
+
+        {
+            const std::lock_guard guard{ _mutex };
+            if (_pending.size() >= MaxPendingSize)
+            {
+                return;
+            }
+            wasEmpty = _pending.empty();
+            AppendEvent(_pending, type, gsl::narrow_cast<uint64_t>(microseconds), payload);
+        }
+
+        // The writer thread only needs to be woken up if it went to sleep on an empty buffer.
+        if (wasEmpty)
+        {
+            _cv.notify_one();
+        }
+    }
+    CATCH_LOG()
+
+    void SessionRecorder::_writerThread() noexcept
+    {
+        std::string batch;
+
+        for (;;)
+        {
+            {
+                std::unique_lock lock{ _mutex };
+                _cv.wait(lock, [&]() { return _exit || !_pending.empty(); });
+                if (_pending.empty())
+                {
+                    return;
+                }
+                batch.clear();
+                _pending.swap(batch);
+            }
+
+            if (_file)
+            {
+                DWORD written;
+                if (!WriteFile(_file.get(), batch.data(), gsl::narrow_cast<DWORD>(batch.size()), &written, nullptr))
+                {
+                    // Don't retry on every chunk if the disk is full or the file went away.
+                    LOG_LAST_ERROR();
+                    _file.reset();
+                }
+            }
+        }
+    }
+}
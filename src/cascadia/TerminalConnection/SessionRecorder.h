@@ -0,0 +1,50 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- SessionRecorder.h
+
+Abstract:
+- Records the raw output of a ConptyConnection (and its resizes) into a file
+  in the format described in SessionRecording.h, so that a workload can be
+  attached to a bug report and replayed later.
+- The connection's output thread only copies each chunk into a buffer.
+  Writing that buffer to disk happens on a background thread owned by this class.
+--*/
+
+#pragma once
+
+#include <SessionRecording.h>
+
+namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
+{
+    class SessionRecorder
+    {
+    public:
+        SessionRecorder(const std::filesystem::path& path, til::CoordType columns, til::CoordType rows);
+        ~SessionRecorder();
+
+        SessionRecorder(const SessionRecorder&) = delete;
+        SessionRecorder& operator=(const SessionRecorder&) = delete;
+        SessionRecorder(SessionRecorder&&) = delete;
+        SessionRecorder& operator=(SessionRecorder&&) = delete;
+
+        void Output(std::string_view chunk) noexcept;
+        void Resize(til::CoordType columns, til::CoordType rows) noexcept;
+
+    private:
+        void _append(::Microsoft::Terminal::SessionRecording::EventType type, std::string_view payload) noexcept;
+        void _writerThread() noexcept;
+
+        wil::unique_hfile _file;
+        std::chrono::steady_clock::time_point _start;
+
+        std::mutex _mutex;
+        std::condition_variable _cv;
+        std::string _pending;
+        bool _exit = false;
+
+        std::thread _thread;
+    };
+}
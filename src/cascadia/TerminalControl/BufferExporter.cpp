@@ -0,0 +1,279 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "pch.h"
+#include "BufferExporter.h"
+
+#include <til/unicode.h>
+
+using namespace ::Microsoft::Terminal::Core;
+
+// The size of each of the two write buffers. A batch stops once its buffer is this full.
+static constexpr size_t WriteBufferSize = 1024 * 1024;
+// The maximum number of rows that are serialized per acquisition of the terminal lock.
+static constexpr til::CoordType RowsPerBatch = 1024;
+
+namespace winrt::Microsoft::Terminal::Control::implementation
+{
+    BufferExporter::BufferExporter(std::shared_ptr<Terminal> terminal, ExportBufferFormat format) :
+        _terminal{ std::move(terminal) },
+        _format{ format }
+    {
+    }
+
+    // Method Description:
+    // - Writes the text buffer to the given file, replacing it if it exists.
+    // - This blocks until the export is done and should thus be called from a background thread.
+    // - Throws if the file can't be written, or if the text buffer is replaced in the
+    //   meantime (for instance by resizing the terminal or by switching to the alt buffer).
+    // Arguments:
+    // - path: the path of the file
+    void BufferExporter::Export(const std::wstring& path)
+    {
+        _file.reset(CreateFileW(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED | FILE_FLAG_SEQUENTIAL_SCAN, nullptr));
+        THROW_LAST_ERROR_IF(!_file);
+        _event.create(wil::EventOptions::ManualReset);
+        _overlapped.hEvent = _event.get();
+
+        for (auto& buffer : _buffers)
+        {
+            buffer.reserve(WriteBufferSize);
+        }
+
+        // If we throw, we mustn't leave a write pending, since it refers to our buffers.
+        auto waitForWrite = wil::scope_exit([&]() noexcept {
+            if (_writePending)
+            {
+                DWORD written = 0;
+                GetOverlappedResult(_file.get(), &_overlapped, &written, TRUE);
+            }
+        });
+
+        for (;;)
+        {
+            const auto done = _serializeBatch();
+            if (done && _format == ExportBufferFormat::Vt)
+            {
+                _buffers[_current].append("\x1b[m");
+            }
+            if (done || _buffers[_current].size() >= WriteBufferSize)
+            {
+                _write();
+            }
+            if (done)
+            {
+                break;
+            }
+        }
+
+        _waitForWrite();
+        waitForWrite.release();
+    }
+
+    // Serializes the next rows of the text buffer into the current write buffer, while holding the lock.
+    // Returns true if the end of the buffer has been reached.
+    bool BufferExporter::_serializeBatch()
+    {
+        const auto lock = _terminal->LockForReading();
+        const auto& textBuffer = _terminal->GetTextBuffer();
+        const auto height = textBuffer.GetSize().Height();
+
+        til::CoordType y = 0;
+        if (!_textBuffer)
+        {
+            // The export ends with whatever the last line is right now. Output that arrives later isn't included.
+            _textBuffer = &textBuffer;
+            _endId = textBuffer.GetRowByOffset(textBuffer.GetLastNonSpaceCharacter().y).GetId();
+        }
+        else
+        {
+            THROW_HR_IF(E_CHANGED_STATE, &textBuffer != _textBuffer);
+
+            // Rows get ever increasing IDs when they're recycled for new output at the bottom of the buffer,
+            // so the IDs increase from top to bottom. The next row is the first one after the last one we exported.
+            // If that one scrolled out of the buffer in the meantime, all remaining rows are new to us.
+            auto low = 0;
+            auto high = height;
+            while (low < high)
+            {
+                const auto mid = low + (high - low) / 2;
+                if (textBuffer.GetRowByOffset(mid).GetId() <= *_lastId)
+                {
+                    low = mid + 1;
+                }
+                else
+                {
+                    high = mid;
+                }
+            }
+            y = low;
+        }
+
+        auto& out = _buffers[_current];
+        for (const auto end = std::min(height, y + RowsPerBatch); y < end && out.size() < WriteBufferSize; ++y)
+        {
+            const auto& row = textBuffer.GetRowByOffset(y);
+            const auto id = row.GetId();
+            if (id > _endId)
+            {
+                return true;
+            }
+
+            _serializeRow(row);
+            _lastId = id;
+
+            if (id == _endId)
+            {
+                return true;
+            }
+        }
+
+        return y >= height;
+    }
+
+    void BufferExporter::_serializeRow(const ROW& row)
+    {
+        // Just like ReadEntireBuffer() we don't export trailing whitespace, and wrapped rows aren't followed by a line break.
+        const auto right = row.MeasureRight();
+
+        if (_format == ExportBufferFormat::Vt)
+        {
+            til::CoordType x = 0;
+            for (const auto& run : row.Attributes().runs())
+            {
+                const auto begin = x;
+                x = std::min(x + run.length, right);
+                if (begin >= x)
+                {
+                    break;
+                }
+
+                if (!_attr || *_attr != run.value)
+                {
+                    _appendSGR(run.value);
+                    _attr = run.value;
+                }
+                _appendUTF8(row.GetText(begin, x));
+            }
+        }
+        else
+        {
+            _appendUTF8(row.GetText(0, right));
+        }
+
+        if (!row.WasWrapForced())
+        {
+            _buffers[_current].append("\r\n");
+        }
+    }
+
+    void BufferExporter::_appendUTF8(const std::wstring_view& text)
+    {
+        THROW_IF_FAILED(til::u16u8(text, _scratch));
+        _buffers[_current].append(_scratch);
+    }
+
+    // Appends an SGR sequence that resets all attributes and then sets those of the given one.
+    void BufferExporter::_appendSGR(const TextAttribute& attr)
+    {
+        auto& out = _buffers[_current];
+        const auto appendColor = [&](const TextColor& color, const int base) {
+            if (color.IsIndex16())
+            {
+                const auto index = color.GetIndex();
+                fmt::format_to(std::back_inserter(out), FMT_COMPILE(";{}"), index >= 8 ? base + 60 + index - 8 : base + index);
+            }
+            else if (color.IsIndex256())
+            {
+                fmt::format_to(std::back_inserter(out), FMT_COMPILE(";{}8;5;{}"), base / 10, color.GetIndex());
+            }
+            else if (color.IsRgb())
+            {
+                const auto rgb = color.GetRGB();
+                fmt::format_to(std::back_inserter(out), FMT_COMPILE(";{}8;2;{};{};{}"), base / 10, GetRValue(rgb), GetGValue(rgb), GetBValue(rgb));
+            }
+        };
+
+        out.append("\x1b[0");
+        if (attr.IsIntense())
+        {
+            out.append(";1");
+        }
+        if (attr.IsFaint())
+        {
+            out.append(";2");
+        }
+        if (attr.IsItalic())
+        {
+            out.append(";3");
+        }
+        if (attr.IsUnderlined())
+        {
+            out.append(";4");
+        }
+        if (attr.IsBlinking())
+        {
+            out.append(";5");
+        }
+        if (attr.IsReverseVideo())
+        {
+            out.append(";7");
+        }
+        if (attr.IsInvisible())
+        {
+            out.append(";8");
+        }
+        if (attr.IsCrossedOut())
+        {
+            out.append(";9");
+        }
+        if (attr.IsDoublyUnderlined())
+        {
+            out.append(";21");
+        }
+        if (attr.IsOverlined())
+        {
+            out.append(";53");
+        }
+        appendColor(attr.GetForeground(), 30);
+        appendColor(attr.GetBackground(), 40);
+        out.push_back('m');
+    }
+
+    // Starts writing the current buffer to the file and switches to the other one.
+    void BufferExporter::_write()
+    {
+        // The other buffer is reused next, so its write must be done.
+        _waitForWrite();
+
+        auto& buffer = _buffers[_current];
+        if (!buffer.empty())
+        {
+            _overlapped.Offset = gsl::narrow_cast<DWORD>(_offset);
+            _overlapped.OffsetHigh = gsl::narrow_cast<DWORD>(_offset >> 32);
+            _event.ResetEvent();
+
+            if (!WriteFile(_file.get(), buffer.data(), gsl::narrow<DWORD>(buffer.size()), nullptr, &_overlapped))
+            {
+                THROW_LAST_ERROR_IF(GetLastError() != ERROR_IO_PENDING);
+            }
+
+            _writePending = true;
+            _offset += buffer.size();
+        }
+
+        _current ^= 1;
+        _buffers[_current].clear();
+    }
+
+    void BufferExporter::_waitForWrite()
+    {
+        if (_writePending)
+        {
+            _writePending = false;
+            DWORD written = 0;
+            THROW_IF_WIN32_BOOL_FALSE(GetOverlappedResult(_file.get(), &_overlapped, &written, TRUE));
+            THROW_HR_IF(E_UNEXPECTED, written != _buffers[_current ^ 1].size());
+        }
+    }
+}
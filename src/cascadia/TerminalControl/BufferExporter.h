@@ -0,0 +1,58 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- BufferExporter.h
+
+Abstract:
+- Writes the contents of the terminal's text buffer to a file, either as plain text or as VT
+  sequences that preserve the colors and other rendition attributes (SGR) of the text.
+- The buffer is serialized in batches of rows, each under a short acquisition of the terminal lock,
+  into one of two fixed-size buffers. While one of them is written to the file with overlapped I/O,
+  the other is filled, so that the whole text never has to be held in memory at once.
+- Between batches the terminal keeps running. Rows are tracked by their ROW::GetId(), so that
+  output which scrolls the buffer in the meantime doesn't cause rows to be skipped or duplicated.
+--*/
+
+#pragma once
+
+#include "../../cascadia/TerminalCore/Terminal.hpp"
+
+namespace winrt::Microsoft::Terminal::Control::implementation
+{
+    class BufferExporter
+    {
+    public:
+        BufferExporter(std::shared_ptr<::Microsoft::Terminal::Core::Terminal> terminal, ExportBufferFormat format);
+
+        void Export(const std::wstring& path);
+
+    private:
+        bool _serializeBatch();
+        void _serializeRow(const ROW& row);
+        void _appendUTF8(const std::wstring_view& text);
+        void _appendSGR(const TextAttribute& attr);
+        void _write();
+        void _waitForWrite();
+
+        std::shared_ptr<::Microsoft::Terminal::Core::Terminal> _terminal;
+        ExportBufferFormat _format;
+
+        // The buffer that's being exported and the position within it.
+        const TextBuffer* _textBuffer = nullptr;
+        std::optional<uint64_t> _lastId;
+        uint64_t _endId = 0;
+        std::optional<TextAttribute> _attr;
+
+        wil::unique_hfile _file;
+        wil::unique_event _event;
+        OVERLAPPED _overlapped{};
+        bool _writePending = false;
+        uint64_t _offset = 0;
+        // _buffers[_current] is being filled, while the other one may be pending in a write.
+        std::array<std::string, 2> _buffers;
+        size_t _current = 0;
+        std::string _scratch;
+    };
+}
@@ -14,6 +14,7 @@
 #include <LibraryResources.h>
 
 #include "EventArgs.h"
+#include "BufferExporter.h"
 #include "../../types/inc/GlyphWidth.hpp"
 #include "../../buffer/out/search.h"
 #include "../../renderer/atlas/AtlasEngine.h"
@@ -39,6 +40,30 @@ constexpr const auto TsfRedrawInterval = std::chrono::milliseconds(100);
 // The minimum delay between updating the locations of regex patterns
 constexpr const auto UpdatePatternLocationsInterval = std::chrono::milliseconds(500);
 
+// The minimum delay between updating the index of all search matches,
+// and the number of rows it scans each time it acquires the terminal lock.
+constexpr const auto UpdateSearchIndexInterval = std::chrono::milliseconds(100);
+constexpr til::CoordType UpdateSearchIndexRowsPerLock = 2048;
+
+// The number of rows FindAllMatches() searches each time it acquires the
+// terminal lock, and the maximum number of matches it returns per buffer.
+constexpr til::CoordType FindAllMatchesRowsPerLock = 2048;
+constexpr uint32_t FindAllMatchesLimit = 1000;
+
+// How long the size has to remain unchanged before we reflow the rest of the
+// scrollback (see TextBuffer::ReflowLazily()), and the number of rows it
+// reflows each time it acquires the terminal lock.
+constexpr const auto FinishPendingReflowDelay = std::chrono::milliseconds(500);
+constexpr til::CoordType FinishPendingReflowRowsPerLock = 2048;
+
+// The minimum delay between two frames while the control isn't focused, for instance in
+// a background pane. Controls that can't be seen at all don't render. See _updateRenderThrottling().
+constexpr const auto UnfocusedFrameInterval = std::chrono::milliseconds(16);
+
+// Output that arrives this soon after a keystroke is assumed to be its echo, which
+// is written and painted right away, instead of being coalesced with other output.
+constexpr const auto EchoWindow = std::chrono::milliseconds(50);
+
 namespace winrt::Microsoft::Terminal::Control::implementation
 {
     static winrt::Microsoft::Terminal::Core::OptionalColor OptionalFromColor(const til::color& c)
@@ -63,6 +88,35 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         return result;
     }
 
+    using FontFeatureMap = std::unordered_map<std::wstring_view, uint32_t>;
+    using FontAxesMap = std::unordered_map<std::wstring_view, float>;
+
+    // The returned maps point into the strings of the given settings maps, which must outlive them.
+    static std::pair<FontFeatureMap, FontAxesMap> _fontFeaturesAndAxes(const Windows::Foundation::Collections::IMap<winrt::hstring, uint32_t>& fontFeatures,
+                                                                       const Windows::Foundation::Collections::IMap<winrt::hstring, float>& fontAxes)
+    {
+        std::pair<FontFeatureMap, FontAxesMap> result;
+        if (fontFeatures)
+        {
+            result.first.reserve(fontFeatures.Size());
+
+            for (const auto& [tag, param] : fontFeatures)
+            {
+                result.first.emplace(tag, param);
+            }
+        }
+        if (fontAxes)
+        {
+            result.second.reserve(fontAxes.Size());
+
+            for (const auto& [axis, value] : fontAxes)
+            {
+                result.second.emplace(axis, value);
+            }
+        }
+        return result;
+    }
+
     TextColor SelectionColor::AsTextColor() const noexcept
     {
         if (_IsIndex16)
@@ -153,10 +207,41 @@ namespace winrt::Microsoft::Terminal::Control::implementation
             });
 
             THROW_IF_FAILED(localPointerToThread->Initialize(_renderer.get()));
+            _terminal->SetRenderThreadId(localPointerToThread->GetThreadId());
         }
         _setupDispatcherAndCallbacks();
 
         UpdateSettings(settings, unfocusedAppearance);
+
+        _prepareRenderEngine();
+    }
+
+    // Method Description:
+    // - Creates the render engine on a background thread and has it resolve our font once.
+    //   Creating the DirectWrite and Direct2D factories and loading the system font collection takes a
+    //   while, and this way it happens in parallel with the XAML layout that precedes Initialize().
+    //   This matters most when a single action creates several panes at once, as otherwise each of
+    //   them would have to wait for the previous ones on the UI thread.
+    void ControlCore::_prepareRenderEngine()
+    {
+        _renderEnginePreparation = std::async(std::launch::async, [useAtlasEngine = _settings->UseAtlasEngine(), desiredFont = _desiredFont, actualFont = _actualFont, fontFeatures = _settings->FontFeatures(), fontAxes = _settings->FontAxes()]() mutable {
+            std::unique_ptr<::Microsoft::Console::Render::IRenderEngine> engine;
+            if (useAtlasEngine)
+            {
+                engine = std::make_unique<::Microsoft::Console::Render::AtlasEngine>();
+            }
+            else
+            {
+                engine = std::make_unique<::Microsoft::Console::Render::DxEngine>();
+            }
+
+            // Initialize() will update the font again, once the DPI is known. If it's 96 this will
+            // be a no-op and otherwise it can at least reuse the already loaded font collection.
+            const auto [featureMap, axesMap] = _fontFeaturesAndAxes(fontFeatures, fontAxes);
+            LOG_IF_FAILED(engine->UpdateDpi(USER_DEFAULT_SCREEN_DPI));
+            LOG_IF_FAILED(engine->UpdateFont(desiredFont, actualFont, featureMap, axesMap));
+            return engine;
+        });
     }
 
     void ControlCore::_setupDispatcherAndCallbacks()
@@ -177,7 +262,8 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         // * _tsfTryRedrawCanvas: When the cursor position moves, we need to
         //   inform TSF, so it can move the canvas for the composition. We
         //   throttle this so that we're not hopping across the process boundary
-        //   every time that the cursor moves.
+        //   every time that the cursor moves. It's only run while an IME
+        //   composition is in progress, see ImeCompositionActive().
         // * _updatePatternLocations: When there's new output, or we scroll the
         //   viewport, we should re-check if there are any visible hyperlinks.
         //   But we don't really need to do this every single time text is
@@ -208,6 +294,63 @@ namespace winrt::Microsoft::Terminal::Control::implementation
                 }
             });
 
+        // Like _updatePatternLocations, this runs on a background thread. It releases
+        // the lock every now and then, so that large buffers don't stall the output.
+        _updateSearchIndex = std::make_unique<til::throttled_func_trailing<>>(
+            UpdateSearchIndexInterval,
+            [weakTerminal = std::weak_ptr{ _terminal }]() {
+                while (const auto t = weakTerminal.lock())
+                {
+                    auto lock = t->LockForWriting(LockSite::Search);
+                    if (t->UpdateSearchIndexUnderLock(UpdateSearchIndexRowsPerLock))
+                    {
+                        break;
+                    }
+                }
+            });
+
+        // Any scrollback we reflow while the user is still dragging the window border would
+        // have to be reflowed again by the next resize. So we wait until they're done.
+        _finishPendingReflow = std::make_unique<til::throttled_func_trailing<>>(
+            FinishPendingReflowDelay,
+            [this, weakTerminal = std::weak_ptr{ _terminal }]() {
+                if (std::chrono::steady_clock::now() - _lastResize.load(std::memory_order_relaxed) < FinishPendingReflowDelay)
+                {
+                    if (_finishPendingReflow)
+                    {
+                        (*_finishPendingReflow)();
+                    }
+                    return;
+                }
+                while (const auto t = weakTerminal.lock())
+                {
+                    auto lock = t->LockForWriting(LockSite::Reflow);
+                    if (t->FinishPendingReflowUnderLock(FinishPendingReflowRowsPerLock))
+                    {
+                        break;
+                    }
+                }
+            });
+
+        // Batches up the connection's output while someone else holds the terminal
+        // lock, so that we don't take it for every tiny chunk under `cat hugefile`.
+        // With DedicatedParserThread, parsing moves off of the connection's thread entirely.
+        _outputCoalescer = std::make_unique<OutputCoalescer>(
+            _terminal,
+            [this]() {
+                // Start the throttled update of where our hyperlinks are.
+                if (_updatePatternLocations)
+                {
+                    (*_updatePatternLocations)();
+                }
+                // ...and of the search matches in the rows that were written to.
+                if (_searchIndexActive.load(std::memory_order_relaxed) && _updateSearchIndex)
+                {
+                    (*_updateSearchIndex)();
+                }
+            },
+            _settings->DedicatedParserThread());
+
         _updateScrollBar = std::make_shared<ThrottledFuncTrailing<Control::ScrollPositionChangedArgs>>(
             _dispatcher,
             ScrollBarUpdateInterval,
@@ -240,6 +383,8 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         // we're re-attached to a new control (on a possibly new UI thread).
         _tsfTryRedrawCanvas.reset();
         _updatePatternLocations.reset();
+        _updateSearchIndex.reset();
+        _finishPendingReflow.reset();
         _updateScrollBar.reset();
     }
 
@@ -282,14 +427,8 @@ namespace winrt::Microsoft::Terminal::Control::implementation
                 return false;
             }
 
-            if (_settings->UseAtlasEngine())
-            {
-                _renderEngine = std::make_unique<::Microsoft::Console::Render::AtlasEngine>();
-            }
-            else
-            {
-                _renderEngine = std::make_unique<::Microsoft::Console::Render::DxEngine>();
-            }
+            // This blocks only if the render engine isn't ready yet. See _prepareRenderEngine().
+            _renderEngine = _renderEnginePreparation.get();
 
             _renderer->AddRenderEngine(_renderEngine.get());
 
@@ -328,6 +467,11 @@ namespace winrt::Microsoft::Terminal::Control::implementation
 
             _terminal->CreateFromSettings(*_settings, *_renderer);
 
+            if (!_restoreBufferPath.empty())
+            {
+                _restoreBufferUnderLock();
+            }
+
             // IMPORTANT! Set this callback up sooner than later. If we do it
             // after Enable, then it'll be possible to paint the frame once
             // _before_ the warning handler is set up, and then warnings from
@@ -345,6 +489,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
             _renderEngine->SetPixelShaderPath(_settings->PixelShaderPath());
             _renderEngine->SetForceFullRepaintRendering(_settings->ForceFullRepaintRendering());
             _renderEngine->SetSoftwareRendering(_settings->SoftwareRendering());
+            _updatePixelShaderAnimationUnderLock();
 
             _updateAntiAliasingMode();
 
@@ -359,11 +504,40 @@ namespace winrt::Microsoft::Terminal::Control::implementation
 
         // Start the connection outside of lock, because it could
         // start writing output immediately.
-        _connection.Start();
+        _startConnection();
 
         return true;
     }
 
+    // Method Description:
+    // - Starts the connection. ConptyConnection::Start() has to create two processes (OpenConsole and the
+    //   client), so it's run on a background thread. This way restoring a window with many panes starts
+    //   their connections concurrently, instead of blocking the UI thread for each of them in turn.
+    void ControlCore::_startConnection()
+    {
+        if (_connection.try_as<TerminalConnection::ConptyConnection>())
+        {
+            _connectionStart = std::async(std::launch::async, [connection = _connection]() {
+                const auto coInit = wil::CoInitializeEx(COINIT_MULTITHREADED);
+                connection.Start();
+            });
+        }
+        else
+        {
+            _connection.Start();
+        }
+    }
+
+    // Method Description:
+    // - Closing or restarting the connection must not race with a Start() that's still running.
+    void ControlCore::_waitForConnectionStart() const
+    {
+        if (_connectionStart.valid())
+        {
+            _connectionStart.wait();
+        }
+    }
+
     // Method Description:
     // - Tell the renderer to start painting.
     // - !! IMPORTANT !! Make sure that we've attached our swap chain to an
@@ -395,6 +569,16 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         }
         else
         {
+            // This must happen before the input is sent, since the echo may arrive before WriteInput() returns.
+            if (_renderer)
+            {
+                _renderer->ExpediteEcho(EchoWindow);
+            }
+            if (_outputCoalescer)
+            {
+                _outputCoalescer->ExpectEcho(EchoWindow);
+            }
+
             _connection.WriteInput(wstr);
         }
     }
@@ -427,8 +611,9 @@ namespace winrt::Microsoft::Terminal::Control::implementation
 
             if (ch == Enter)
             {
+                _waitForConnectionStart();
                 _connection.Close();
-                _connection.Start();
+                _startConnection();
                 return true;
             }
         }
@@ -477,7 +662,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
             if (vkey == 'A' && !mods.IsAltPressed() && !mods.IsShiftPressed() && mods.IsCtrlPressed())
             {
                 // Ctrl + A --> Select all
-                auto lock = _terminal->LockForWriting();
+                auto lock = _terminal->LockForWriting(LockSite::Selection);
                 _terminal->SelectAll();
                 _updateSelectionUI();
                 return true;
@@ -485,7 +670,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
             else if (vkey == VK_TAB && !mods.IsAltPressed() && !mods.IsCtrlPressed() && _settings->DetectURLs())
             {
                 // [Shift +] Tab --> next/previous hyperlink
-                auto lock = _terminal->LockForWriting();
+                auto lock = _terminal->LockForWriting(LockSite::Selection);
                 const auto direction = mods.IsShiftPressed() ? ::Terminal::SearchDirection::Backward : ::Terminal::SearchDirection::Forward;
                 _terminal->SelectHyperlink(direction);
                 _updateSelectionUI();
@@ -494,7 +679,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
             else if (vkey == VK_RETURN && mods.IsCtrlPressed() && !mods.IsAltPressed() && !mods.IsShiftPressed())
             {
                 // Ctrl + Enter --> Open URL
-                auto lock = _terminal->LockForReading();
+                auto lock = _terminal->LockForReading(LockSite::Selection);
                 if (const auto uri = _terminal->GetHyperlinkAtBufferPosition(_terminal->GetSelectionAnchor()); !uri.empty())
                 {
                     _OpenHyperlinkHandlers(*this, winrt::make<OpenHyperlinkEventArgs>(winrt::hstring{ uri }));
@@ -524,7 +709,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
             else if (const auto updateSlnParams{ _terminal->ConvertKeyEventToUpdateSelectionParams(mods, vkey) })
             {
                 // try to update the selection
-                auto lock = _terminal->LockForWriting();
+                auto lock = _terminal->LockForWriting(LockSite::Selection);
                 _terminal->UpdateSelection(updateSlnParams->first, updateSlnParams->second, mods);
                 _updateSelectionUI();
                 return true;
@@ -708,8 +893,9 @@ namespace winrt::Microsoft::Terminal::Control::implementation
             newInterval = _terminal->GetHyperlinkIntervalFromViewportPosition(*terminalPosition);
         }
 
-        // If the hyperlink ID changed or the interval changed, trigger a redraw all
-        // (so this will happen both when we move onto a link and when we move off a link)
+        // If the hyperlink ID changed or the interval changed, trigger a redraw of both
+        // the old and the new link (so this will happen both when we move onto a link and
+        // when we move off a link). Moving within the same link doesn't repaint anything.
         if (newId != _lastHoveredId ||
             (newInterval != _lastHoveredInterval))
         {
@@ -720,11 +906,13 @@ namespace winrt::Microsoft::Terminal::Control::implementation
             {
                 auto lock = _terminal->LockForWriting();
 
+                _terminal->InvalidateHyperlink(_lastHoveredId, _lastHoveredInterval);
+                _terminal->InvalidateHyperlink(newId, newInterval);
+
                 _lastHoveredId = newId;
                 _lastHoveredInterval = newInterval;
                 _renderer->UpdateHyperlinkHoveredId(newId);
                 _renderer->UpdateLastHoveredInterval(newInterval);
-                _renderer->TriggerRedrawAll();
             }
 
             _HoveredHyperlinkChangedHandlers(*this, nullptr);
@@ -785,6 +973,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
 
         _renderEngine->SetForceFullRepaintRendering(_settings->ForceFullRepaintRendering());
         _renderEngine->SetSoftwareRendering(_settings->SoftwareRendering());
+        _updatePixelShaderAnimationUnderLock();
         // Inform the renderer of our opacity
         _renderEngine->EnableTransparentBackground(_isBackgroundTransparent());
 
@@ -858,26 +1047,9 @@ namespace winrt::Microsoft::Terminal::Control::implementation
 
         if (_renderEngine)
         {
-            std::unordered_map<std::wstring_view, uint32_t> featureMap;
-            if (const auto fontFeatures = _settings->FontFeatures())
-            {
-                featureMap.reserve(fontFeatures.Size());
-
-                for (const auto& [tag, param] : fontFeatures)
-                {
-                    featureMap.emplace(tag, param);
-                }
-            }
-            std::unordered_map<std::wstring_view, float> axesMap;
-            if (const auto fontAxes = _settings->FontAxes())
-            {
-                axesMap.reserve(fontAxes.Size());
-
-                for (const auto& [axis, value] : fontAxes)
-                {
-                    axesMap.emplace(axis, value);
-                }
-            }
+            const auto fontFeatures = _settings->FontFeatures();
+            const auto fontAxes = _settings->FontAxes();
+            const auto [featureMap, axesMap] = _fontFeaturesAndAxes(fontFeatures, fontAxes);
 
             // TODO: MSFT:20895307 If the font doesn't exist, this doesn't
             //      actually fail. We need a way to gracefully fallback.
@@ -999,6 +1171,12 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         if (SUCCEEDED(hr) && hr != S_FALSE)
         {
             _connection.Resize(vp.Height(), vp.Width());
+
+            _lastResize.store(std::chrono::steady_clock::now(), std::memory_order_relaxed);
+            if (_finishPendingReflow)
+            {
+                (*_finishPendingReflow)();
+            }
         }
     }
 
@@ -1044,7 +1222,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
 
     void ControlCore::SetSelectionAnchor(const til::point position)
     {
-        auto lock = _terminal->LockForWriting();
+        auto lock = _terminal->LockForWriting(LockSite::Selection);
         _terminal->SetSelectionAnchor(position);
     }
 
@@ -1055,7 +1233,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
     //    to throw it all in a struct and pass it along.
     Control::SelectionData ControlCore::SelectionInfo() const
     {
-        auto lock = _terminal->LockForReading();
+        auto lock = _terminal->LockForSharedReading(LockSite::Selection);
         Control::SelectionData info;
 
         const auto start{ _terminal->SelectionStartForRendering() };
@@ -1085,7 +1263,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
 
         // Have to take the lock because the renderer will not draw correctly if
         // you move its endpoints while it is generating a frame.
-        auto lock = _terminal->LockForWriting();
+        auto lock = _terminal->LockForWriting(LockSite::Selection);
 
         til::point terminalPosition{
             std::clamp(position.x, 0, _terminal->GetViewport().Width() - 1),
@@ -1101,6 +1279,8 @@ namespace winrt::Microsoft::Terminal::Control::implementation
     // when an OSC 52 is emitted.
     void ControlCore::_terminalCopyToClipboard(std::wstring_view wstr)
     {
+        // This supersedes any copy that's still in progress.
+        _copyGeneration->fetch_add(1, std::memory_order_relaxed);
         _CopyToClipboardHandlers(*this, winrt::make<implementation::CopyToClipboardEventArgs>(winrt::hstring{ wstr }));
     }
 
@@ -1120,64 +1300,111 @@ namespace winrt::Microsoft::Terminal::Control::implementation
             return false;
         }
 
-        // extract text from buffer
-        // RetrieveSelectedTextFromBuffer will lock while it's reading
-        const auto bufferData = _terminal->RetrieveSelectedTextFromBuffer(singleLine);
-
-        // convert text: vector<string> --> string
-        std::wstring textData;
-        for (const auto& text : bufferData.text)
-        {
-            textData += text;
-        }
-
-        const auto bgColor = _terminal->GetAttributeColors({}).second;
-
-        // convert text to HTML format
-        // GH#5347 - Don't provide a title for the generated HTML, as many
-        // web applications will paste the title first, followed by the HTML
-        // content, which is unexpected.
-        const auto htmlData = formats == nullptr || WI_IsFlagSet(formats.Value(), CopyFormat::HTML) ?
-                                  TextBuffer::GenHTML(bufferData,
-                                                      _actualFont.GetUnscaledSize().height,
-                                                      _actualFont.GetFaceName(),
-                                                      bgColor) :
-                                  "";
-
-        // convert to RTF format
-        const auto rtfData = formats == nullptr || WI_IsFlagSet(formats.Value(), CopyFormat::RTF) ?
-                                 TextBuffer::GenRTF(bufferData,
-                                                    _actualFont.GetUnscaledSize().height,
-                                                    _actualFont.GetFaceName(),
-                                                    bgColor) :
-                                 "";
-
-        // send data up for clipboard
-        _CopyToClipboardHandlers(*this,
-                                 winrt::make<CopyToClipboardEventArgs>(winrt::hstring{ textData },
-                                                                       winrt::to_hstring(htmlData),
-                                                                       winrt::to_hstring(rtfData),
-                                                                       formats));
+        // Copying the selected rows is quick, even for the entire scrollback. Turning them into
+        // the clipboard formats isn't, so that happens in the background, without the lock.
+        // SnapshotSelection will lock while it's reading
+        auto snapshot = _terminal->SnapshotSelection(singleLine);
+        const auto generation = _copyGeneration->fetch_add(1, std::memory_order_relaxed) + 1;
+        _copySelectionAsync(std::move(snapshot), formats, generation);
         return true;
     }
 
+    // Method Description:
+    // - Turns the snapshot of a selection into the clipboard formats on a background
+    //   thread and then sends them up for the clipboard on the UI thread.
+    // - The copy is abandoned as soon as another copy starts.
+    // Arguments:
+    // - snapshot: the selection, as returned by Terminal::SnapshotSelection
+    // - formats: which formats to copy. See CopySelectionToClipboard.
+    // - generation: the value of _copyGeneration that belongs to this copy
+    winrt::fire_and_forget ControlCore::_copySelectionAsync(::Microsoft::Terminal::Core::Terminal::SelectionSnapshot snapshot,
+                                                            Windows::Foundation::IReference<CopyFormat> formats,
+                                                            const uint64_t generation)
+    {
+        // We mustn't touch `this` until we're back on the UI thread and know that it's still alive.
+        const auto weakThis{ get_weak() };
+        const auto dispatcher = _dispatcher;
+        const auto copyGeneration = _copyGeneration;
+        const auto fontHeightPoints = _actualFont.GetUnscaledSize().height;
+        const std::wstring fontFaceName{ _actualFont.GetFaceName() };
+        const auto superseded = [&]() {
+            return copyGeneration->load(std::memory_order_relaxed) != generation;
+        };
+
+        co_await winrt::resume_background();
+
+        Control::CopyToClipboardEventArgs args{ nullptr };
+        try
+        {
+            const auto text = snapshot.PlainText();
+            if (superseded())
+            {
+                co_return;
+            }
+
+            // GH#5347 - Don't provide a title for the generated HTML, as many
+            // web applications will paste the title first, followed by the HTML
+            // content, which is unexpected.
+            std::string html;
+            if (formats == nullptr || WI_IsFlagSet(formats.Value(), CopyFormat::HTML))
+            {
+                html = snapshot.Html(fontHeightPoints, fontFaceName);
+                if (superseded())
+                {
+                    co_return;
+                }
+            }
+
+            std::string rtf;
+            if (formats == nullptr || WI_IsFlagSet(formats.Value(), CopyFormat::RTF))
+            {
+                rtf = snapshot.Rtf(fontHeightPoints, fontFaceName);
+                if (superseded())
+                {
+                    co_return;
+                }
+            }
+
+            args = winrt::make<CopyToClipboardEventArgs>(winrt::hstring{ text },
+                                                         winrt::to_hstring(html),
+                                                         winrt::to_hstring(rtf),
+                                                         formats);
+        }
+        catch (...)
+        {
+            LOG_CAUGHT_EXCEPTION();
+            co_return;
+        }
+
+        // The snapshot can be large. Free it here and not on the UI thread.
+        snapshot.buffer.reset();
+
+        co_await wil::resume_foreground(dispatcher);
+
+        if (auto core{ weakThis.get() }; core && !superseded())
+        {
+            // send data up for clipboard
+            core->_CopyToClipboardHandlers(*core, args);
+        }
+    }
+
     void ControlCore::SelectAll()
     {
-        auto lock = _terminal->LockForWriting();
+        auto lock = _terminal->LockForWriting(LockSite::Selection);
         _terminal->SelectAll();
         _updateSelectionUI();
     }
 
     void ControlCore::ClearSelection()
     {
-        auto lock = _terminal->LockForWriting();
+        auto lock = _terminal->LockForWriting(LockSite::Selection);
         _terminal->ClearSelection();
         _updateSelectionUI();
     }
 
     bool ControlCore::ToggleBlockSelection()
     {
-        auto lock = _terminal->LockForWriting();
+        auto lock = _terminal->LockForWriting(LockSite::Selection);
         if (_terminal->IsSelectionActive())
         {
             _terminal->SetBlockSelection(!_terminal->IsBlockSelection());
@@ -1192,7 +1419,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
 
     void ControlCore::ToggleMarkMode()
     {
-        auto lock = _terminal->LockForWriting();
+        auto lock = _terminal->LockForWriting(LockSite::Selection);
         _terminal->ToggleMarkMode();
         _updateSelectionUI();
     }
@@ -1419,8 +1646,10 @@ namespace winrt::Microsoft::Terminal::Control::implementation
     void ControlCore::_terminalCursorPositionChanged()
     {
         // When the buffer's cursor moves, start the throttled func to
-        // eventually dispatch a CursorPositionChanged event.
-        if (_tsfTryRedrawCanvas)
+        // eventually dispatch a CursorPositionChanged event. Without a
+        // composition there's no canvas that TSF needs to move, so during
+        // regular output the cursor can move as often as it likes for free.
+        if (_imeCompositionActive.load(std::memory_order_relaxed) && _tsfTryRedrawCanvas)
         {
             _tsfTryRedrawCanvas->Run();
         }
@@ -1441,7 +1670,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
     }
 
     // Method Description:
-    // - Plays a single MIDI note, blocking for the duration.
+    // - Queues a single MIDI note to be played. This only blocks if too many notes are queued already.
     // Arguments:
     // - noteNumber - The MIDI note number to be played (0 - 127).
     // - velocity - The force with which the note should be played (0 - 127).
@@ -1449,9 +1678,9 @@ namespace winrt::Microsoft::Terminal::Control::implementation
     void ControlCore::_terminalPlayMidiNote(const int noteNumber, const int velocity, const std::chrono::microseconds duration)
     {
         // The UI thread might try to acquire the console lock from time to time.
-        // --> Unlock it, so the UI doesn't hang while we're busy.
+        // --> Unlock it, so the UI doesn't hang if we have to wait for the queue.
         const auto suspension = _terminal->SuspendLock();
-        // This call will block for the duration, unless shutdown early.
+        // This call only blocks if the queue is full, until space frees up or it's shutdown early.
         _midiAudio.PlayNote(reinterpret_cast<HWND>(_owningHwnd), noteNumber, velocity, std::chrono::duration_cast<std::chrono::milliseconds>(duration));
     }
 
@@ -1491,11 +1720,14 @@ namespace winrt::Microsoft::Terminal::Control::implementation
     // - text: the text to search
     // - goForward: boolean that represents if the current search direction is forward
     // - caseSensitive: boolean that represents if the current search is case sensitive
+    // - regularExpression: boolean that represents if the text is a regular expression.
+    //   Invalid ones don't match anything.
     // Return Value:
     // - <none>
     void ControlCore::Search(const winrt::hstring& text,
                              const bool goForward,
-                             const bool caseSensitive)
+                             const bool caseSensitive,
+                             const bool regularExpression)
     {
         if (text.size() == 0)
         {
@@ -1510,19 +1742,41 @@ namespace winrt::Microsoft::Terminal::Control::implementation
                                      Search::Sensitivity::CaseSensitive :
                                      Search::Sensitivity::CaseInsensitive;
 
-        ::Search search(*GetRenderData(), text.c_str(), direction, sensitivity);
-        auto lock = _terminal->LockForWriting();
-        const auto foundMatch{ search.FindNext() };
-        if (foundMatch)
+        const auto mode = regularExpression ?
+                              Search::Mode::RegularExpression :
+                              Search::Mode::Literal;
+
+        auto lock = _terminal->LockForWriting(LockSite::Search);
+        std::optional<til::point_span> match;
+
+        if (const auto index = _terminal->GetSearchIndex(); index && index->IsFor(text, sensitivity, mode) && index->IsComplete())
         {
-            _terminal->SetBlockSelection(false);
-            search.Select();
+            // SearchAll() already knows where all the matches are, so we only need to step to the neighboring one.
+            std::optional<til::point> position;
+            if (_terminal->IsSelectionActive())
+            {
+                position = _terminal->GetTextBuffer().ScreenToBufferPosition(_terminal->GetSelectionAnchor());
+            }
+            match = index->Step(position, goForward);
+        }
+        else
+        {
+            try
+            {
+                ::Search search(*GetRenderData(), text.c_str(), direction, sensitivity, mode);
+                if (search.FindNext())
+                {
+                    const auto [start, end] = search.GetFoundLocation();
+                    match = til::point_span{ start, end };
+                }
+            }
+            CATCH_LOG();
+        }
 
-            // this is used for search,
-            // DO NOT call _updateSelectionUI() here.
-            // We don't want to show the markers so manually tell it to clear it.
-            _renderer->TriggerSelection();
-            _UpdateSelectionMarkersHandlers(*this, winrt::make<implementation::UpdateSelectionMarkersEventArgs>(true));
+        const auto foundMatch = match.has_value();
+        if (foundMatch)
+        {
+            _selectSearchMatchUnderLock(*match);
         }
 
         // Raise a FoundMatch event, which the control will use to notify
@@ -1531,6 +1785,244 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         _FoundMatchHandlers(*this, *foundResults);
     }
 
+    // Method Description:
+    // - Starts finding all matches of the given text in the background.
+    //   The matches are kept up to date as new output arrives, by only
+    //   searching the rows that have been written to. Search() uses them
+    //   to step from one match to the next, once they're complete.
+    // Arguments:
+    // - text: the text to search. An empty string is the same as ClearSearchAll().
+    // - caseSensitive: boolean that represents if the current search is case sensitive
+    // - regularExpression: boolean that represents if the text is a regular expression.
+    //   Invalid ones are the same as ClearSearchAll().
+    // Return Value:
+    // - <none>
+    void ControlCore::SearchAll(const winrt::hstring& text, const bool caseSensitive, const bool regularExpression)
+    {
+        if (text.size() == 0)
+        {
+            ClearSearchAll();
+            return;
+        }
+
+        const auto sensitivity = caseSensitive ?
+                                     Search::Sensitivity::CaseSensitive :
+                                     Search::Sensitivity::CaseInsensitive;
+
+        const auto mode = regularExpression ?
+                              Search::Mode::RegularExpression :
+                              Search::Mode::Literal;
+
+        std::unique_ptr<SearchIndex> newIndex;
+        try
+        {
+            newIndex = std::make_unique<SearchIndex>(text, sensitivity, mode);
+        }
+        catch (...)
+        {
+            LOG_CAUGHT_EXCEPTION();
+            ClearSearchAll();
+            return;
+        }
+
+        {
+            auto lock = _terminal->LockForWriting(LockSite::Search);
+            if (const auto index = _terminal->GetSearchIndex(); !index || !index->IsFor(text, sensitivity, mode))
+            {
+                _terminal->SetSearchIndex(std::move(newIndex));
+            }
+        }
+
+        _searchIndexActive.store(true, std::memory_order_relaxed);
+        if (_updateSearchIndex)
+        {
+            (*_updateSearchIndex)();
+        }
+    }
+
+    // Method Description:
+    // - Stops maintaining the matches found by SearchAll().
+    void ControlCore::ClearSearchAll()
+    {
+        _searchIndexActive.store(false, std::memory_order_relaxed);
+        auto lock = _terminal->LockForWriting(LockSite::Search);
+        _terminal->SetSearchIndex(nullptr);
+    }
+
+    // Method Description:
+    // - Returns the matches found by SearchAll(), ordered by their start.
+    //   These are buffer positions (see TextBuffer::BufferToScreenPosition()).
+    // Arguments:
+    // - complete: set to false if the search is still running in the background, in
+    //   which case the result is either incomplete or contains outdated matches.
+    // Return Value:
+    // - All known matches.
+    std::vector<til::point_span> ControlCore::SearchAllMatches(bool& complete) const
+    {
+        auto lock = _terminal->LockForSharedReading(LockSite::Search);
+        if (const auto index = _terminal->GetSearchIndex())
+        {
+            complete = index->IsComplete();
+            return index->Matches();
+        }
+        complete = true;
+        return {};
+    }
+
+    // Rows get ever increasing IDs when they're recycled for new output at the bottom of the buffer,
+    // so the IDs increase from top to bottom. Returns the first row whose ID isn't less than the given one.
+    static til::CoordType findRowById(const TextBuffer& textBuffer, const uint64_t id) noexcept
+    {
+        auto low = 0;
+        auto high = textBuffer.GetSize().Height();
+        while (low < high)
+        {
+            const auto mid = low + (high - low) / 2;
+            if (textBuffer.GetRowByOffset(mid).GetId() < id)
+            {
+                low = mid + 1;
+            }
+            else
+            {
+                high = mid;
+            }
+        }
+        return low;
+    }
+
+    // Method Description:
+    // - Finds all matches of the given text in the background. Unlike SearchAll() this
+    //   leaves the search index and the selection alone, so that it can run for many
+    //   panes in parallel (see TerminalPage's "find in all panes") without interfering
+    //   with their search boxes.
+    // - Just like the BufferExporter, the buffer is searched in batches of rows, each
+    //   under a short acquisition of the terminal lock. Rows are tracked by their
+    //   ROW::GetId(), so that output which scrolls the buffer in the meantime
+    //   doesn't cause rows to be skipped or searched twice.
+    // - The search stops early if the buffer gets replaced (for instance by a resize),
+    //   and it can be canceled in between batches.
+    // Arguments:
+    // - text: the text to search
+    // - caseSensitive: boolean that represents if the current search is case sensitive
+    // - regularExpression: boolean that represents if the text is a regular expression.
+    //   Invalid ones fail the operation with E_INVALIDARG.
+    // Return Value:
+    // - Up to FindAllMatchesLimit matches, ordered by their start.
+    Windows::Foundation::IAsyncOperation<Windows::Foundation::Collections::IVector<Control::SearchResult>> ControlCore::FindAllMatches(hstring text, bool caseSensitive, bool regularExpression)
+    {
+        // The terminal is kept alive by us, even if the control isn't.
+        const auto terminal = _terminal;
+        const auto sensitivity = caseSensitive ?
+                                     Search::Sensitivity::CaseSensitive :
+                                     Search::Sensitivity::CaseInsensitive;
+        const std::wstring_view needle{ text };
+        // Compiled once for all batches, so that they share the DFA it builds.
+        std::optional<SearchRegex> regex;
+        if (regularExpression)
+        {
+            regex.emplace(needle, !caseSensitive);
+        }
+
+        auto cancellation = co_await winrt::get_cancellation_token();
+        co_await winrt::resume_background();
+
+        auto results = winrt::single_threaded_vector<Control::SearchResult>();
+        const TextBuffer* searchedBuffer = nullptr;
+        uint64_t nextId = 0;
+
+        while (!cancellation() && results.Size() < FindAllMatchesLimit)
+        {
+            const auto lock = terminal->LockForReading(LockSite::Search);
+            const auto& textBuffer = terminal->GetTextBuffer();
+            const auto height = textBuffer.GetSize().Height();
+
+            if (!searchedBuffer)
+            {
+                searchedBuffer = &textBuffer;
+            }
+            else if (&textBuffer != searchedBuffer)
+            {
+                break;
+            }
+
+            // Both FindAll() variants return the matches that *start* in the given rows,
+            // even if they continue past them, so the batches can be split up anywhere.
+            const auto begin = findRowById(textBuffer, nextId);
+            const auto end = std::min(height, begin + FindAllMatchesRowsPerLock);
+            if (begin >= end)
+            {
+                break;
+            }
+
+            const auto matches = regex ?
+                                     Search::FindAll(textBuffer, *regex, begin, end) :
+                                     Search::FindAll(textBuffer, needle, sensitivity, begin, end);
+
+            for (const auto& match : matches)
+            {
+                if (results.Size() >= FindAllMatchesLimit)
+                {
+                    break;
+                }
+
+                const auto& row = textBuffer.GetRowByOffset(match.start.y);
+                results.Append(Control::SearchResult{
+                    row.GetId(),
+                    match.start.to_core_point(),
+                    match.end.to_core_point(),
+                    winrt::hstring{ row.GetText(0, row.MeasureRight()) },
+                });
+            }
+
+            nextId = textBuffer.GetRowByOffset(end - 1).GetId() + 1;
+        }
+
+        co_return results;
+    }
+
+    // Method Description:
+    // - Selects a match found by FindAllMatches() and scrolls it into view.
+    //   Its row is looked up by its ID, in case the buffer scrolled since.
+    // Arguments:
+    // - result: the match to select
+    // Return Value:
+    // - false if the row of the match isn't part of the buffer anymore.
+    bool ControlCore::SelectSearchResult(const Control::SearchResult& result)
+    {
+        auto lock = _terminal->LockForWriting(LockSite::Search);
+        const auto& textBuffer = _terminal->GetTextBuffer();
+
+        const auto y = findRowById(textBuffer, result.RowId);
+        if (y >= textBuffer.GetSize().Height() || textBuffer.GetRowByOffset(y).GetId() != result.RowId)
+        {
+            return false;
+        }
+
+        const auto scrolled = result.Start.Y - y;
+        _selectSearchMatchUnderLock(til::point_span{
+            til::point{ result.Start.X, y },
+            til::point{ result.End.X, result.End.Y - scrolled },
+        });
+        return true;
+    }
+
+    // Method Description:
+    // - Selects a search match, given in buffer positions, and scrolls it into view.
+    void ControlCore::_selectSearchMatchUnderLock(const til::point_span& match)
+    {
+        _terminal->SetBlockSelection(false);
+
+        // Same as Search::Select(): Convert the buffer positions into screen positions, taking line renditions into account.
+        const auto& textBuffer = _terminal->GetTextBuffer();
+        _terminal->SelectNewRegion(textBuffer.BufferToScreenPosition(match.start), textBuffer.BufferToScreenPosition(match.end));
+
+        // this is used for search,
+        // DO NOT call _updateSelectionUI() here.
+        // We don't want to show the markers so manually tell it to clear it.
+        _renderer->TriggerSelection();
+        _UpdateSelectionMarkersHandlers(*this, winrt::make<implementation::UpdateSelectionMarkersEventArgs>(true));
+    }
+
     void ControlCore::Close()
     {
         if (!_IsClosing())
@@ -1543,7 +2035,12 @@ namespace winrt::Microsoft::Terminal::Control::implementation
             // Stop accepting new output and state changes before we disconnect everything.
             _connection.TerminalOutput(_connectionOutputEventToken);
             _connectionStateChangedRevoker.revoke();
+
+            _waitForConnectionStart();
             _connection.Close();
+
+            // With the connection closed no more output can arrive. This joins the parser thread, if any.
+            _outputCoalescer.reset();
         }
     }
 
@@ -1619,6 +2116,29 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         _terminal->SetCursorOn(isCursorOn);
     }
 
+    bool ControlCore::ImeCompositionActive() const noexcept
+    {
+        return _imeCompositionActive.load(std::memory_order_relaxed);
+    }
+
+    // Method Description:
+    // - Tells us whether the TSFInputControl is in the middle of an IME
+    //   composition. Only then do cursor movements get forwarded as
+    //   CursorPositionChanged events, so the composition can follow the cursor.
+    // Arguments:
+    // - active: true when a composition started, false when it ended.
+    // Return Value:
+    // - <none>
+    void ControlCore::ImeCompositionActive(const bool active)
+    {
+        _imeCompositionActive.store(active, std::memory_order_relaxed);
+        // The cursor may have moved since the last layout that TSF asked for.
+        if (active && _tsfTryRedrawCanvas)
+        {
+            _tsfTryRedrawCanvas->Run();
+        }
+    }
+
     void ControlCore::ResumeRendering()
     {
         _renderer->ResetErrorStateAndResume();
@@ -1642,7 +2162,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
             return { 0, 0 };
         }
 
-        auto lock = _terminal->LockForReading();
+        auto lock = _terminal->LockForSharedReading();
         return _terminal->GetViewportRelativeCursorPosition().to_core_point();
     }
 
@@ -1658,7 +2178,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
                                           const bool isOnOriginalPosition,
                                           bool& selectionNeedsToBeCopied)
     {
-        auto lock = _terminal->LockForWriting();
+        auto lock = _terminal->LockForWriting(LockSite::Selection);
         // handle ALT key
         _terminal->SetBlockSelection(altEnabled);
 
@@ -1753,12 +2273,9 @@ namespace winrt::Microsoft::Terminal::Control::implementation
     {
         try
         {
-            _terminal->Write(hstr);
-
-            // Start the throttled update of where our hyperlinks are.
-            if (_updatePatternLocations)
+            if (_outputCoalescer)
             {
-                (*_updatePatternLocations)();
+                _outputCoalescer->Write(hstr);
             }
         }
         catch (...)
@@ -1768,6 +2285,11 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         }
     }
 
+    OutputCoalescer::Stats ControlCore::OutputCoalescingStats() const noexcept
+    {
+        return _outputCoalescer ? _outputCoalescer->GetStats() : OutputCoalescer::Stats{};
+    }
+
     uint64_t ControlCore::SwapChainHandle() const
     {
         // This is only ever called by TermControl::AttachContent, which occurs
@@ -1789,6 +2311,64 @@ namespace winrt::Microsoft::Terminal::Control::implementation
     // - clearType: The type of clear to perform.
     // Return Value:
     // - <none>
+    // Method Description:
+    // - Writes the contents of the main buffer into a snapshot file at the given path.
+    //   Subsequent calls with the same path only write the rows that changed in the meantime.
+    // Arguments:
+    // - path: The file to write the snapshot to. It's replaced if it already exists.
+    void ControlCore::PersistBuffer(const winrt::hstring& path)
+    {
+        const auto lock = _terminal->LockForWriting();
+
+        if (!_bufferSnapshot || _bufferSnapshotPath != std::wstring_view{ path })
+        {
+            _bufferSnapshotPath = std::wstring_view{ path };
+            _bufferSnapshot = std::make_unique<BufferSnapshot>(_bufferSnapshotPath);
+        }
+        _terminal->PersistMainBuffer(*_bufferSnapshot);
+    }
+
+    // Method Description:
+    // - Restores the main buffer from a snapshot file written by PersistBuffer().
+    //   If the terminal hasn't been initialized yet, this happens right before the connection is started.
+    //   The file is deleted afterwards.
+    // Arguments:
+    // - path: The snapshot file to restore.
+    void ControlCore::RestoreBuffer(const winrt::hstring& path)
+    {
+        const auto lock = _terminal->LockForWriting();
+
+        _restoreBufferPath = std::wstring_view{ path };
+        if (_initializedTerminal)
+        {
+            _restoreBufferUnderLock();
+        }
+    }
+
+    void ControlCore::_restoreBufferUnderLock()
+    {
+        try
+        {
+            _terminal->RestoreMainBuffer(_restoreBufferPath);
+        }
+        CATCH_LOG();
+
+        std::error_code ec;
+        std::filesystem::remove(_restoreBufferPath, ec);
+        _restoreBufferPath.clear();
+    }
+
+    // Method Description:
+    // - Returns the session id of the connection (the WT_SESSION environment variable), if it has one.
+    winrt::guid ControlCore::SessionId() const
+    {
+        if (const auto conpty = _connection.try_as<TerminalConnection::ConptyConnection>())
+        {
+            return conpty.Guid();
+        }
+        return {};
+    }
+
     void ControlCore::ClearBuffer(Control::ClearBufferType clearType)
     {
         if (clearType == Control::ClearBufferType::Scrollback || clearType == Control::ClearBufferType::All)
@@ -1808,6 +2388,115 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         }
     }
 
+    // Method Description:
+    // - Returns how long each call site waited for and held the terminal lock since
+    //   the last call, in addition to the output coalescing counters.
+    //   The first call enables the lock instrumentation, so it won't report any lock statistics yet.
+    hstring ControlCore::SampleLockStatistics() const
+    {
+        _terminal->EnableLockInstrumentation(true);
+
+        auto str = InstrumentedLock::FormatSnapshot(_terminal->TakeLockSnapshot());
+        const auto stats = OutputCoalescingStats();
+        fmt::format_to(std::back_inserter(str),
+                       FMT_COMPILE(L"Output  chunks merged={} lock acquisitions saved={} queue depth={} (peak {})\r\n"),
+                       stats.chunksMerged,
+                       stats.lockAcquisitionsSaved,
+                       stats.queueDepth,
+                       stats.peakQueueDepth);
+        return hstring{ str };
+    }
+
+    // Method Description:
+    // - Returns an estimate of the memory held by this control: its text buffers,
+    //   the renderer's per-row data and caches and the output that's queued up.
+    Control::MemoryUsage ControlCore::SampleMemoryUsage() const
+    {
+        Control::MemoryUsage usage{};
+        if (!_initializedTerminal)
+        {
+            return usage;
+        }
+
+        const auto lock = _terminal->LockForSharedReading();
+        const auto buffers = _terminal->GetMemoryUsage();
+        const auto engine = _renderEngine->GetMemoryUsage();
+
+        usage.TextBytes = buffers.committedBytes + buffers.overflowBytes + buffers.attributeBytes + buffers.hyperlinkBytes + buffers.imageBytes;
+        usage.ScrollbackBytes = buffers.coldBytes;
+        usage.SpilledBytes = buffers.spilledBytes;
+        usage.CacheBytes = buffers.cacheBytes + engine.cacheBytes;
+        usage.RendererBytes = engine.rowBytes;
+        usage.GlyphAtlasBytes = engine.glyphAtlasBytes;
+        usage.OutputBytes = _outputCoalescer ? _outputCoalescer->BufferBytesUnderLock() : 0;
+        return usage;
+    }
+
+    // Method Description:
+    // - Called when the system runs low on memory. Drops everything that can be
+    //   rebuilt on demand, compacts the scrollback and, if the control can't
+    //   be seen right now, releases its GPU resources until it's painted again.
+    void ControlCore::TrimMemory()
+    {
+        if (!_initializedTerminal)
+        {
+            return;
+        }
+
+        {
+            const auto lock = _terminal->LockForWriting();
+            _terminal->TrimMemory();
+            _renderEngine->TrimMemory();
+            if (_outputCoalescer)
+            {
+                _outputCoalescer->TrimUnderLock();
+            }
+        }
+
+        if (_isOccluded())
+        {
+            _renderer->RequestDeviceResourceRelease();
+        }
+    }
+
+    // Method Description:
+    // - Returns the counters shown by the performance overlay. They're all cumulative,
+    //   so that any number of callers can compute rates from two samples.
+    //   The first call enables the lock instrumentation, so the lock wait time starts at 0.
+    Control::PerformanceCounters ControlCore::SamplePerformanceCounters() const
+    {
+        Control::PerformanceCounters counters{};
+        counters.GlyphAtlasOccupancy = -1.0f;
+        if (!_initializedTerminal)
+        {
+            return counters;
+        }
+
+        _terminal->EnableLockInstrumentation(true);
+
+        const auto output = OutputCoalescingStats();
+        counters.OutputCharacters = output.charactersWritten;
+        counters.ParseMicroseconds = output.parseMicroseconds;
+
+        const auto frames = _renderer->GetFrameStatistics();
+        counters.PaintRequests = frames.paintRequests;
+        counters.FramesPainted = frames.framesPainted;
+        counters.PresentLatencyMicroseconds = frames.latencyMicroseconds;
+        counters.EchoFrames = frames.echoFrames;
+        counters.EchoLatencyMicroseconds = frames.echoLatencyMicroseconds;
+        counters.LockWaitMicroseconds = _terminal->LockWaitMicroseconds();
+
+        const auto lock = _terminal->LockForSharedReading();
+        const auto engine = _renderEngine->GetDiagnostics();
+        counters.DirtyRows = engine.dirtyRows;
+        counters.ShapingCacheHits = engine.shapingCacheHits;
+        counters.ShapingCacheMisses = engine.shapingCacheMisses;
+        counters.GlyphLookups = engine.glyphLookups;
+        counters.GlyphCacheMisses = engine.glyphCacheMisses;
+        counters.GlyphAtlasOccupancy = engine.glyphAtlasOccupancy;
+        return counters;
+    }
+
     hstring ControlCore::ReadEntireBuffer() const
     {
         auto terminalLock = _terminal->LockForWriting();
@@ -1835,6 +2524,21 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         return hstring{ str };
     }
 
+    // Method Description:
+    // - Writes the entire text buffer to the given file, as plain text or as VT.
+    // - Unlike ReadEntireBuffer() this never holds the whole text in memory and only holds
+    //   the lock briefly at a time. See BufferExporter for details.
+    // Arguments:
+    // - path: the file to write to. It's replaced if it exists.
+    // - format: whether to write plain text or VT sequences that preserve the text's attributes.
+    Windows::Foundation::IAsyncAction ControlCore::ExportBuffer(hstring path, ExportBufferFormat format)
+    {
+        // The terminal is kept alive by the exporter, even if we aren't.
+        BufferExporter exporter{ _terminal, format };
+        co_await winrt::resume_background();
+        exporter.Export(std::wstring{ path });
+    }
+
     Core::Scheme ControlCore::ColorScheme() const noexcept
     {
         Core::Scheme s;
@@ -1967,6 +2671,9 @@ namespace winrt::Microsoft::Terminal::Control::implementation
     // - <none>
     void ControlCore::WindowVisibilityChanged(const bool showOrHide)
     {
+        _windowVisible = showOrHide;
+        _updateRenderThrottling();
+
         if (_initializedTerminal)
         {
             // show is true, hide is false
@@ -1977,6 +2684,18 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         }
     }
 
+    // Method Description:
+    // - Called when the control is shown or hidden within its window. Unlike
+    //   WindowVisibilityChanged, this is for instance the case for the controls
+    //   in a tab when another tab gets selected. ConPTY doesn't need to know this.
+    // Arguments:
+    // - visible: True for visible; false for not visible.
+    void ControlCore::VisibilityChanged(const bool visible)
+    {
+        _visible = visible;
+        _updateRenderThrottling();
+    }
+
     // Method Description:
     // - When the control gains focus, it needs to tell ConPTY about this.
     //   Usually, these sequences are reserved for applications that
@@ -2007,6 +2726,46 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         const auto previous = std::exchange(_isReadOnly, false);
         const auto restore = wil::scope_exit([&]() { _isReadOnly = previous; });
         _terminal->FocusChanged(focused);
+
+        _focused = focused;
+        _updateRenderThrottling();
+
+        if (_initializedTerminal)
+        {
+            const auto lock = _terminal->LockForWriting();
+            _updatePixelShaderAnimationUnderLock();
+            // A paused animation doesn't request any more frames, so it needs one to get going again.
+            _renderer->NotifyPaintFrame();
+        }
+    }
+
+    // Method Description:
+    // - Applies the frame rate limit of animated pixel shaders and, if the settings
+    //   ask for it, pauses their animation while the control is unfocused.
+    // - INVARIANT: This method can only be called if the caller has the writing lock on the terminal.
+    void ControlCore::_updatePixelShaderAnimationUnderLock()
+    {
+        const auto maxFrameRate = _settings->PixelShaderMaxFrameRate();
+        _renderEngine->SetPixelShaderFrameInterval(maxFrameRate > 0 ? std::chrono::milliseconds{ 1000 / maxFrameRate } : std::chrono::milliseconds::zero());
+        _renderEngine->SetPixelShaderAnimationPaused(!_focused && _settings->PixelShaderPauseWhenUnfocused());
+    }
+
+    // Method Description:
+    // - Controls that nobody is looking at don't need to render every intermediate state of
+    //   their buffer, when a build or similar floods them with output. This limits their frame
+    //   rate, so that they stop competing with the focused control for CPU and GPU time.
+    // - Controls that can't be seen at all, because they're in a minimized window or in a
+    //   background tab, stop rendering entirely until they're shown again. A focused control
+    //   is always considered visible, in case it got moved into the current tab without us being told.
+    bool ControlCore::_isOccluded() const noexcept
+    {
+        return !_windowVisible || (!_visible && !_focused);
+    }
+
+    void ControlCore::_updateRenderThrottling()
+    {
+        _renderer->SetOccluded(_isOccluded());
+        _renderer->SetMinimumFrameInterval(_focused ? std::chrono::milliseconds::zero() : UnfocusedFrameInterval);
     }
 
     bool ControlCore::_isBackgroundTransparent()
@@ -2096,62 +2855,43 @@ namespace winrt::Microsoft::Terminal::Control::implementation
 
         std::optional<DispatchTypes::ScrollMark> tgt;
 
+        // The marks are sorted by their start, so we can binary search for the nearest one.
+        const auto byRow = [](const DispatchTypes::ScrollMark& m, const int y) { return m.start.y < y; };
+
         switch (direction)
         {
         case ScrollToMarkDirection::Last:
         {
-            int highest = currentOffset;
-            for (const auto& mark : marks)
+            if (!marks.empty() && marks.back().start.y > currentOffset)
             {
-                const auto newY = mark.start.y;
-                if (newY > highest)
-                {
-                    tgt = mark;
-                    highest = newY;
-                }
+                tgt = marks.back();
             }
             break;
         }
         case ScrollToMarkDirection::First:
         {
-            int lowest = currentOffset;
-            for (const auto& mark : marks)
+            if (!marks.empty() && marks.front().start.y < currentOffset)
             {
-                const auto newY = mark.start.y;
-                if (newY < lowest)
-                {
-                    tgt = mark;
-                    lowest = newY;
-                }
+                tgt = marks.front();
             }
             break;
         }
         case ScrollToMarkDirection::Next:
         {
-            int minDistance = INT_MAX;
-            for (const auto& mark : marks)
+            const auto it = std::lower_bound(marks.begin(), marks.end(), currentOffset + 1, byRow);
+            if (it != marks.end())
             {
-                const auto delta = mark.start.y - currentOffset;
-                if (delta > 0 && delta < minDistance)
-                {
-                    tgt = mark;
-                    minDistance = delta;
-                }
+                tgt = *it;
             }
             break;
         }
         case ScrollToMarkDirection::Previous:
         default:
         {
-            int minDistance = INT_MAX;
-            for (const auto& mark : marks)
+            const auto it = std::lower_bound(marks.begin(), marks.end(), currentOffset, byRow);
+            if (it != marks.begin())
             {
-                const auto delta = currentOffset - mark.start.y;
-                if (delta > 0 && delta < minDistance)
-                {
-                    tgt = mark;
-                    minDistance = delta;
-                }
+                tgt = *(it - 1);
             }
             break;
         }
@@ -2187,7 +2927,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         const auto bufferSize{ _terminal->GetTextBuffer().GetSize() };
         bufferSize.DecrementInBounds(s.end);
 
-        auto lock = _terminal->LockForWriting();
+        auto lock = _terminal->LockForWriting(LockSite::Selection);
         _terminal->SelectNewRegion(s.start, s.end);
         _renderer->TriggerSelection();
     }
@@ -18,6 +18,7 @@
 #include "ControlCore.g.h"
 #include "SelectionColor.g.h"
 #include "ControlSettings.h"
+#include "OutputCoalescer.h"
 #include "../../audio/midi/MidiAudio.hpp"
 #include "../../renderer/base/Renderer.hpp"
 #include "../../cascadia/TerminalCore/Terminal.hpp"
@@ -26,6 +27,8 @@
 
 #include <til/ticket_lock.h>
 
+#include <future>
+
 namespace ControlUnitTests
 {
     class ControlCoreTests;
@@ -140,6 +143,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         hstring WorkingDirectory() const;
 
         TerminalConnection::ConnectionState ConnectionState() const;
+        winrt::guid SessionId() const;
 
         int ScrollOffset();
         int ViewHeight() const;
@@ -176,6 +180,8 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         void UserScrollViewport(const int viewTop);
 
         void ClearBuffer(Control::ClearBufferType clearType);
+        void PersistBuffer(const winrt::hstring& path);
+        void RestoreBuffer(const winrt::hstring& path);
 
 #pragma endregion
 
@@ -183,6 +189,8 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         void BlinkCursor();
         bool CursorOn() const;
         void CursorOn(const bool isCursorOn);
+        bool ImeCompositionActive() const noexcept;
+        void ImeCompositionActive(const bool active);
 
         bool IsVtMouseModeEnabled() const;
         bool ShouldSendAlternateScroll(const unsigned int uiButton, const int32_t delta) const;
@@ -197,7 +205,13 @@ namespace winrt::Microsoft::Terminal::Control::implementation
 
         void Search(const winrt::hstring& text,
                     const bool goForward,
-                    const bool caseSensitive);
+                    const bool caseSensitive,
+                    const bool regularExpression);
+        void SearchAll(const winrt::hstring& text, const bool caseSensitive, const bool regularExpression);
+        void ClearSearchAll();
+        std::vector<til::point_span> SearchAllMatches(bool& complete) const;
+        Windows::Foundation::IAsyncOperation<Windows::Foundation::Collections::IVector<Control::SearchResult>> FindAllMatches(hstring text, bool caseSensitive, bool regularExpression);
+        bool SelectSearchResult(const Control::SearchResult& result);
 
         void LeftClickOnTerminal(const til::point terminalPosition,
                                  const int numberOfClicks,
@@ -214,12 +228,18 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         void SetReadOnlyMode(const bool readOnlyState);
 
         hstring ReadEntireBuffer() const;
+        Windows::Foundation::IAsyncAction ExportBuffer(hstring path, ExportBufferFormat format);
+        hstring SampleLockStatistics() const;
+        Control::MemoryUsage SampleMemoryUsage() const;
+        void TrimMemory();
+        Control::PerformanceCounters SamplePerformanceCounters() const;
 
         static bool IsVintageOpacityAvailable() noexcept;
 
         void AdjustOpacity(const double opacity, const bool relative);
 
         void WindowVisibilityChanged(const bool showOrHide);
+        void VisibilityChanged(const bool visible);
 
         uint64_t OwningHwnd();
         void OwningHwnd(uint64_t owner);
@@ -229,6 +249,8 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         bool ShouldShowSelectCommand();
         bool ShouldShowSelectOutput();
 
+        OutputCoalescer::Stats OutputCoalescingStats() const noexcept;
+
         RUNTIME_SETTING(double, Opacity, _settings->Opacity());
         RUNTIME_SETTING(bool, UseAcrylic, _settings->UseAcrylic());
 
@@ -267,6 +289,12 @@ namespace winrt::Microsoft::Terminal::Control::implementation
 
         TerminalConnection::ITerminalConnection _connection{ nullptr };
         event_token _connectionOutputEventToken;
+        std::future<void> _connectionStart;
+
+        // See PersistBuffer() and RestoreBuffer().
+        std::unique_ptr<BufferSnapshot> _bufferSnapshot;
+        std::filesystem::path _bufferSnapshotPath;
+        std::filesystem::path _restoreBufferPath;
         TerminalConnection::ITerminalConnection::StateChanged_revoker _connectionStateChangedRevoker;
 
         winrt::com_ptr<ControlSettings> _settings{ nullptr };
@@ -279,6 +307,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         // we must ensure the _renderer is deallocated first.
         // (C++ class members are destroyed in reverse order.)
         std::unique_ptr<::Microsoft::Console::Render::IRenderEngine> _renderEngine{ nullptr };
+        std::future<std::unique_ptr<::Microsoft::Console::Render::IRenderEngine>> _renderEnginePreparation;
         std::unique_ptr<::Microsoft::Console::Render::Renderer> _renderer{ nullptr };
 
         winrt::handle _lastSwapChainHandle{ nullptr };
@@ -298,6 +327,11 @@ namespace winrt::Microsoft::Terminal::Control::implementation
 
         bool _isReadOnly{ false };
 
+        // See _updateRenderThrottling().
+        bool _focused{ false };
+        bool _visible{ true };
+        bool _windowVisible{ true };
+
         std::optional<interval_tree::IntervalTree<til::point, size_t>::interval> _lastHoveredInterval{ std::nullopt };
 
         // These members represent the size of the surface that we should be
@@ -310,7 +344,16 @@ namespace winrt::Microsoft::Terminal::Control::implementation
 
         winrt::Windows::System::DispatcherQueue _dispatcher{ nullptr };
         std::shared_ptr<ThrottledFuncTrailing<>> _tsfTryRedrawCanvas;
+        std::atomic<bool> _imeCompositionActive{ false };
         std::unique_ptr<til::throttled_func_trailing<>> _updatePatternLocations;
+        std::unique_ptr<til::throttled_func_trailing<>> _updateSearchIndex;
+        std::atomic<bool> _searchIndexActive{ false };
+        std::unique_ptr<til::throttled_func_trailing<>> _finishPendingReflow;
+        std::atomic<std::chrono::steady_clock::time_point> _lastResize;
+        // Incremented by every copy to the clipboard, so that a copy that's still
+        // being serialized in the background can tell that it has been superseded.
+        std::shared_ptr<std::atomic<uint64_t>> _copyGeneration{ std::make_shared<std::atomic<uint64_t>>(0) };
+        std::unique_ptr<OutputCoalescer> _outputCoalescer;
         std::shared_ptr<ThrottledFuncTrailing<Control::ScrollPositionChangedArgs>> _updateScrollBar;
 
         til::point _contextMenuBufferPosition{ 0, 0 };
@@ -318,9 +361,14 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         void _setupDispatcherAndCallbacks();
 
         bool _setFontSizeUnderLock(float fontSize);
+        void _prepareRenderEngine();
+        void _restoreBufferUnderLock();
+        void _startConnection();
+        void _waitForConnectionStart() const;
         void _updateFont(const bool initialUpdate = false);
         void _refreshSizeUnderLock();
         void _updateSelectionUI();
+        void _selectSearchMatchUnderLock(const til::point_span& match);
         bool _shouldTryUpdateSelection(const WORD vkey);
 
         void _handleControlC();
@@ -347,6 +395,9 @@ namespace winrt::Microsoft::Terminal::Control::implementation
 #pragma region RendererCallbacks
         void _rendererWarning(const HRESULT hr);
         winrt::fire_and_forget _renderEngineSwapChainChanged(const HANDLE handle);
+        winrt::fire_and_forget _copySelectionAsync(::Microsoft::Terminal::Core::Terminal::SelectionSnapshot snapshot,
+                                                   Windows::Foundation::IReference<CopyFormat> formats,
+                                                   const uint64_t generation);
         void _rendererBackgroundColorChanged();
         void _rendererTabColorChanged();
 #pragma endregion
@@ -359,6 +410,9 @@ namespace winrt::Microsoft::Terminal::Control::implementation
 
         bool _isBackgroundTransparent();
         void _focusChanged(bool focused);
+        bool _isOccluded() const noexcept;
+        void _updateRenderThrottling();
+        void _updatePixelShaderAnimationUnderLock();
 
         void _selectSpan(til::point_span s);
 
@@ -25,6 +25,10 @@ using namespace winrt::Windows::ApplicationModel::DataTransfer;
 
 static constexpr unsigned int MAX_CLICK_COUNT = 3;
 
+// Precision touchpads send hundreds of sub-notch wheel deltas per second.
+// They're accumulated and committed to the viewport at most once per frame.
+static constexpr auto ScrollCommitInterval = std::chrono::milliseconds(8);
+
 namespace winrt::Microsoft::Terminal::Control::implementation
 {
     std::atomic<uint64_t> ControlInteractivity::_nextId{ 1 };
@@ -50,6 +54,22 @@ namespace winrt::Microsoft::Terminal::Control::implementation
 
         _core = winrt::make_self<ControlCore>(settings, unfocusedAppearance, connection);
 
+        // The viewport may only be scrolled from the thread we were created on. If there's
+        // no dispatcher on it (for instance in our unit tests), we commit every scroll directly.
+        if (const auto dispatcher = DispatcherQueue::GetForCurrentThread())
+        {
+            _commitScrollPosition = std::make_shared<ThrottledFuncTrailing<>>(
+                dispatcher,
+                ScrollCommitInterval,
+                [weakThis = get_weak()]() {
+                    if (auto self{ weakThis.get() })
+                    {
+                        self->_scrollCommitPending = false;
+                        self->UpdateScrollbar(self->_internalScrollbarPosition);
+                    }
+                });
+        }
+
         _core->Attached([weakThis = get_weak()](auto&&, auto&&) {
             if (auto self{ weakThis.get() })
             {
@@ -563,9 +583,10 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         // underneath us. We wouldn't know - we don't want the overhead of
         // another ScrollPositionChanged handler. If the scrollbar should be
         // somewhere other than where it is currently, then start from that row.
+        // While a commit is pending, the core is expected to lag behind us.
         const auto currentInternalRow = ::base::saturated_cast<int>(::std::round(_internalScrollbarPosition));
         const auto currentCoreRow = _core->ScrollOffset();
-        const auto currentOffset = currentInternalRow == currentCoreRow ?
+        const auto currentOffset = _scrollCommitPending || currentInternalRow == currentCoreRow ?
                                        _internalScrollbarPosition :
                                        currentCoreRow;
 
@@ -581,8 +602,23 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         const auto rowsToScroll{ _rowsToScroll == WHEEL_PAGESCROLL ? ::base::saturated_cast<double>(_core->ViewHeight()) : _rowsToScroll };
         auto newValue = (rowsToScroll * rowDelta) + (currentOffset);
 
+        // Deltas that aren't a whole wheel notch come from precision touchpads (or
+        // smooth scrolling mice) in quick succession. Each of them would otherwise
+        // scroll the terminal, its renderer and its UIA tree on its own, so we only
+        // accumulate them here and commit the result once per frame. Whole notches
+        // still scroll immediately, as does mouse selection, where the selection
+        // must follow the viewport.
+        if (_commitScrollPosition && !isLeftButtonPressed && mouseDelta % WHEEL_DELTA != 0)
+        {
+            _internalScrollbarPosition = std::clamp<double>(newValue, 0.0, _core->BufferHeight());
+            _scrollCommitPending = true;
+            _commitScrollPosition->Run();
+            return;
+        }
+
         // Update the Core's viewport position, and raise a
         // ScrollPositionChanged event to update the scrollbar
+        _scrollCommitPending = false;
         UpdateScrollbar(newValue);
 
         if (isLeftButtonPressed)
@@ -112,6 +112,10 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         winrt::com_ptr<ControlCore> _core{ nullptr };
         unsigned int _rowsToScroll;
         double _internalScrollbarPosition{ 0.0 };
+        // Commits the accumulated precision touchpad scrolling once per frame.
+        // Only exists if we were created on a thread with a dispatcher.
+        std::shared_ptr<ThrottledFuncTrailing<>> _commitScrollPosition;
+        bool _scrollCommitPending{ false };
 
         // If this is set, then we assume we are in the middle of panning the
         //      viewport via touch input.
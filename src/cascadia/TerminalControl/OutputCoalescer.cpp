@@ -0,0 +1,255 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "pch.h"
+#include "OutputCoalescer.h"
+
+#include <til/unicode.h>
+
+using namespace ::Microsoft::Terminal::Core;
+
+// If this many characters are queued up, the connection's thread stops queueing
+// and waits for the lock instead. This way the consumer can't fall arbitrarily far behind.
+static constexpr size_t MaxPendingSize = 256 * 1024;
+// How long to wait before the queued-up output is flushed, if no other chunk arrives in the meantime.
+static constexpr auto FlushDelay = std::chrono::milliseconds(2);
+// The capacity of the queue between the connection and the dedicated parser thread, in characters.
+// Once it's full, the connection's thread blocks until the parser thread caught up.
+static constexpr uint32_t ParserQueueCapacity = 256 * 1024;
+
+namespace winrt::Microsoft::Terminal::Control::implementation
+{
+    OutputCoalescer::OutputCoalescer(std::shared_ptr<Terminal> terminal, std::function<void()> written, const bool dedicatedThread) :
+        _terminal{ std::move(terminal) },
+        _written{ std::move(written) },
+        _scheduleFlush{ FlushDelay, [this]() { _flush(); } }
+    {
+        if (dedicatedThread)
+        {
+            auto [tx, rx] = til::spsc::channel<wchar_t>(ParserQueueCapacity);
+            _tx.emplace(std::move(tx));
+            _rx.emplace(std::move(rx));
+            _thread = std::thread{ [this]() { _parserThread(); } };
+            LOG_IF_FAILED(SetThreadDescription(_thread.native_handle(), L"ControlCore Parser Thread"));
+        }
+    }
+
+    OutputCoalescer::~OutputCoalescer()
+    {
+        if (_thread.joinable())
+        {
+            // Dropping the producer makes the consumer's pop_n() return false once the queue is empty.
+            _tx.reset();
+            _thread.join();
+        }
+    }
+
+    // Method Description:
+    // - Writes the given chunk into the terminal, or queues it up if the terminal is busy.
+    //   This must only ever be called by a single thread at a time (the connection's output thread).
+    void OutputCoalescer::Write(const std::wstring_view chunk)
+    {
+        if (_tx)
+        {
+            _tx->push_n(til::spsc::block_forever, chunk.data(), chunk.size());
+            _chunksPushed.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        auto lock = _terminal->TryLockForWriting(LockSite::Output);
+
+        // The echo of a keystroke is short and the user is waiting for it. It's worth waiting for the lock.
+        if (!lock.owns_lock() && std::chrono::steady_clock::now().time_since_epoch().count() < _echoDeadline.load(std::memory_order_relaxed))
+        {
+            lock = _terminal->LockForWriting(LockSite::Output);
+        }
+
+        if (!lock.owns_lock())
+        {
+            size_t pendingSize;
+            {
+                const auto guard = _pendingLock.lock_exclusive();
+                _pending.append(chunk);
+                _pendingChunks++;
+                pendingSize = _pending.size();
+
+                _queueDepth.store(_pendingChunks, std::memory_order_relaxed);
+                if (_pendingChunks > _peakQueueDepth.load(std::memory_order_relaxed))
+                {
+                    _peakQueueDepth.store(_pendingChunks, std::memory_order_relaxed);
+                }
+            }
+
+            _chunksMerged.fetch_add(1, std::memory_order_relaxed);
+
+            if (pendingSize < MaxPendingSize)
+            {
+                _scheduleFlush();
+                return;
+            }
+
+            // The consumer is too far behind. Apply backpressure to the connection.
+            lock = _terminal->LockForWriting(LockSite::Output);
+            _drainUnderLock();
+            return;
+        }
+
+        // Any output queued up earlier must be written first, to preserve the order.
+        // We pay for the lock with this chunk, so any queued up ones came for free.
+        const auto saved = _queueDepth.load(std::memory_order_relaxed);
+        _drainUnderLock();
+        _lockAcquisitionsSaved.fetch_add(saved, std::memory_order_relaxed);
+
+        _writeUnderLock(chunk);
+        lock.unlock();
+
+        _written();
+    }
+
+    // Method Description:
+    // - Called after a keystroke was sent to the connection. Until the window has passed,
+    //   Write() writes the output immediately, even if it has to wait for the terminal lock.
+    //   Can be called from any thread.
+    void OutputCoalescer::ExpectEcho(const std::chrono::milliseconds window) noexcept
+    {
+        _echoDeadline.store((std::chrono::steady_clock::now() + window).time_since_epoch().count(), std::memory_order_relaxed);
+    }
+
+    OutputCoalescer::Stats OutputCoalescer::GetStats() const noexcept
+    {
+        Stats stats;
+        stats.chunksMerged = _chunksMerged.load(std::memory_order_relaxed);
+        stats.lockAcquisitionsSaved = _lockAcquisitionsSaved.load(std::memory_order_relaxed);
+        stats.queueDepth = _queueDepth.load(std::memory_order_relaxed);
+        stats.peakQueueDepth = _peakQueueDepth.load(std::memory_order_relaxed);
+        stats.charactersWritten = _charactersWritten.load(std::memory_order_relaxed);
+        stats.parseMicroseconds = _parseMicroseconds.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    // Returns the capacity of the strings that queued up output passes through in bytes.
+    // They grow to the size of the largest burst of output. The caller must hold the terminal lock.
+    size_t OutputCoalescer::BufferBytesUnderLock() const noexcept
+    {
+        const auto guard = _pendingLock.lock_shared();
+        return (_pending.capacity() + _batch.capacity()) * sizeof(wchar_t);
+    }
+
+    // Frees the strings that queued up output passes through, unless they're in use.
+    // The caller must hold the terminal lock, which makes _batch unused.
+    void OutputCoalescer::TrimUnderLock() noexcept
+    {
+        std::wstring{}.swap(_batch);
+
+        const auto guard = _pendingLock.lock_exclusive();
+        if (!_pendingChunks)
+        {
+            std::wstring{}.swap(_pending);
+        }
+    }
+
+    // Called on a background thread by _scheduleFlush shortly after the first chunk got queued up.
+    void OutputCoalescer::_flush()
+    {
+        const auto lock = _terminal->LockForWriting(LockSite::Output);
+        const auto chunks = _queueDepth.load(std::memory_order_relaxed);
+        _drainUnderLock();
+        if (chunks > 1)
+        {
+            _lockAcquisitionsSaved.fetch_add(chunks - 1, std::memory_order_relaxed);
+        }
+    }
+
+    // Passes the text to the terminal and accounts for it in the Stats. The caller must hold the terminal lock.
+    void OutputCoalescer::_writeUnderLock(const std::wstring_view text)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        // Also account for the time when Write() throws, since that's when it's usually the slowest.
+        const auto cleanup = wil::scope_exit([&]() noexcept {
+            const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+            _charactersWritten.fetch_add(text.size(), std::memory_order_relaxed);
+            _parseMicroseconds.fetch_add(gsl::narrow_cast<uint64_t>(elapsed.count()), std::memory_order_relaxed);
+        });
+        _terminal->Write(text);
+    }
+
+    // Writes all queued up output into the terminal. The caller must hold the terminal lock.
+    void OutputCoalescer::_drainUnderLock()
+    {
+        {
+            const auto guard = _pendingLock.lock_exclusive();
+            if (!_pendingChunks)
+            {
+                return;
+            }
+            // If a previous Write() threw, _batch may still contain stale output.
+            _batch.clear();
+            _pending.swap(_batch);
+            _pendingChunks = 0;
+            _queueDepth.store(0, std::memory_order_relaxed);
+        }
+
+        // The Terminal lock is recursive, so this won't deadlock.
+        _writeUnderLock(_batch);
+        _written();
+    }
+
+    // The parser thread pops everything that has accumulated in the queue since the last
+    // iteration and writes it into the terminal, holding the lock only for that long.
+    void OutputCoalescer::_parserThread()
+    {
+        // Chunks may get split up across two batches. That's fine for VT sequences, because the
+        // StateMachine handles them being split across writes, but not for surrogate pairs.
+        // A trailing leading surrogate is thus carried over to the front of the next batch.
+        const auto buffer = std::make_unique<wchar_t[]>(ParserQueueCapacity + 1);
+        size_t carry = 0;
+        uint64_t chunksSeen = 0;
+
+        for (;;)
+        {
+            const auto [popped, ok] = _rx->pop_n(til::spsc::block_initially, buffer.get() + carry, ParserQueueCapacity);
+            auto count = carry + popped;
+            if (!popped)
+            {
+                break;
+            }
+
+            carry = 0;
+            if (ok && til::is_leading_surrogate(buffer[count - 1]))
+            {
+                carry = 1;
+                count--;
+            }
+
+            // Every chunk that got pushed in the meantime gets written under the same lock.
+            const auto chunksPushed = _chunksPushed.load(std::memory_order_relaxed);
+            const auto chunks = chunksPushed - chunksSeen;
+            chunksSeen = chunksPushed;
+            if (chunks > 1)
+            {
+                _chunksMerged.fetch_add(chunks, std::memory_order_relaxed);
+                _lockAcquisitionsSaved.fetch_add(chunks - 1, std::memory_order_relaxed);
+            }
+
+            try
+            {
+                {
+                    const auto lock = _terminal->LockForWriting(LockSite::Output);
+                    _writeUnderLock({ buffer.get(), count });
+                }
+                _written();
+            }
+            CATCH_LOG();
+
+            if (!ok)
+            {
+                break;
+            }
+
+            if (carry)
+            {
+                buffer[0] = buffer[count];
+            }
+        }
+    }
+}
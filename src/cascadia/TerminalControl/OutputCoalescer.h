@@ -0,0 +1,91 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- OutputCoalescer.h
+
+Abstract:
+- Sits between the connection's TerminalOutput event and Terminal::Write().
+- As long as nobody else holds the terminal lock, every chunk is written immediately,
+  so that the latency for interactive use stays as low as it used to be.
+- While the lock is contended (usually by the renderer), chunks are queued up instead
+  and later written all at once under a single lock acquisition. That happens on either the
+  next chunk that finds the lock free or a flush that's scheduled just after the first queued chunk.
+- Output that arrives shortly after a keystroke (see ExpectEcho()) is never queued up,
+  since it's most likely the echo the user is waiting for. It waits for the lock instead.
+- Alternatively, if constructed with dedicatedThread = true, all output is pushed into a lock-free
+  queue instead, and a parser thread owned by this class writes everything that has accumulated in it
+  under a single lock acquisition. The connection's thread then never touches the terminal lock at all.
+--*/
+
+#pragma once
+
+#include "../../cascadia/TerminalCore/Terminal.hpp"
+
+#include <til/spsc.h>
+
+namespace winrt::Microsoft::Terminal::Control::implementation
+{
+    class OutputCoalescer
+    {
+    public:
+        struct Stats
+        {
+            uint64_t chunksMerged = 0; // The number of chunks that were queued up instead of being written on their own.
+            uint64_t lockAcquisitionsSaved = 0; // The number of LockForWriting() calls avoided by writing queued chunks in batches.
+            uint32_t queueDepth = 0; // The number of chunks currently queued up. Not tracked with a dedicatedThread.
+            uint32_t peakQueueDepth = 0;
+            uint64_t charactersWritten = 0; // The number of characters passed to Terminal::Write().
+            uint64_t parseMicroseconds = 0; // The time spent in Terminal::Write().
+        };
+
+        OutputCoalescer(std::shared_ptr<::Microsoft::Terminal::Core::Terminal> terminal, std::function<void()> written, bool dedicatedThread = false);
+        ~OutputCoalescer();
+
+        OutputCoalescer(const OutputCoalescer&) = delete;
+        OutputCoalescer& operator=(const OutputCoalescer&) = delete;
+        OutputCoalescer(OutputCoalescer&&) = delete;
+        OutputCoalescer& operator=(OutputCoalescer&&) = delete;
+
+        void Write(std::wstring_view chunk);
+        void ExpectEcho(std::chrono::milliseconds window) noexcept;
+        Stats GetStats() const noexcept;
+        size_t BufferBytesUnderLock() const noexcept;
+        void TrimUnderLock() noexcept;
+
+    private:
+        void _flush();
+        void _writeUnderLock(std::wstring_view text);
+        void _drainUnderLock();
+        void _parserThread();
+
+        std::shared_ptr<::Microsoft::Terminal::Core::Terminal> _terminal;
+        std::function<void()> _written;
+
+        // _pending is appended to by the connection's thread while someone else holds the terminal lock.
+        // _batch is only ever accessed while holding the terminal lock and is used to swap with _pending.
+        mutable wil::srwlock _pendingLock;
+        std::wstring _pending;
+        uint32_t _pendingChunks = 0;
+        std::wstring _batch;
+
+        std::atomic<uint64_t> _chunksMerged{ 0 };
+        std::atomic<uint64_t> _lockAcquisitionsSaved{ 0 };
+        std::atomic<uint32_t> _queueDepth{ 0 };
+        std::atomic<uint32_t> _peakQueueDepth{ 0 };
+        std::atomic<uint64_t> _charactersWritten{ 0 };
+        std::atomic<uint64_t> _parseMicroseconds{ 0 };
+        // See ExpectEcho(). The steady_clock time until which output isn't queued up.
+        std::atomic<int64_t> _echoDeadline{ 0 };
+
+        // Only used with a dedicatedThread.
+        std::optional<til::spsc::producer<wchar_t>> _tx;
+        std::optional<til::spsc::consumer<wchar_t>> _rx;
+        std::atomic<uint64_t> _chunksPushed{ 0 };
+        std::thread _thread;
+
+        // This must be the last member, as its destructor waits for any pending flush to complete.
+        til::throttled_func_trailing<> _scheduleFlush;
+    };
+}
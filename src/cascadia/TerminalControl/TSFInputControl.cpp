@@ -71,6 +71,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
     // - <none>
     void TSFInputControl::NotifyFocusEnter()
     {
+        _fontInfo = nullptr;
         _editContext.NotifyFocusEnter();
         _focused = true;
     }
@@ -107,6 +108,35 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         }
     }
 
+    // Method Description:
+    // - Forgets the cached font info, so that the next redraw asks for it again.
+    //   The TermControl calls this whenever its font changes.
+    // Arguments:
+    // - <none>
+    // Return Value:
+    // - <none>
+    void TSFInputControl::InvalidateFontInfo() noexcept
+    {
+        _fontInfo = nullptr;
+    }
+
+    // Method Description:
+    // - Redraw the canvas if a composition is in progress. Without one there's
+    //   nothing on the canvas and TSF will ask for the layout by itself
+    //   (see _layoutRequestedHandler) before it needs it again, so there's
+    //   no point in tracking the cursor while the terminal is busy printing.
+    // Arguments:
+    // - <none>
+    // Return Value:
+    // - <none>
+    void TSFInputControl::TryRedrawCanvas()
+    {
+        if (_inComposition)
+        {
+            _TryRedrawCanvas();
+        }
+    }
+
     // Method Description:
     // - Redraw the canvas if certain dimensions have changed since the last
     //   redraw. This includes the Terminal cursor position, the Canvas width, and the TextBlock height.
@@ -114,7 +144,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
     // - <none>
     // Return Value:
     // - <none>
-    void TSFInputControl::TryRedrawCanvas()
+    void TSFInputControl::_TryRedrawCanvas()
     try
     {
         if (!_focused || !Canvas())
@@ -158,8 +188,12 @@ namespace winrt::Microsoft::Terminal::Control::implementation
     void TSFInputControl::_RedrawCanvas()
     {
         // Get Font Info as we use this is the pixel size for characters in the display
-        auto fontArgs = winrt::make_self<FontInfoEventArgs>();
-        _CurrentFontInfoHandlers(*this, *fontArgs);
+        if (!_fontInfo)
+        {
+            _fontInfo = winrt::make_self<FontInfoEventArgs>();
+            _CurrentFontInfoHandlers(*this, *_fontInfo);
+        }
+        const auto& fontArgs = _fontInfo;
 
         const til::size fontSize{ til::math::flooring, fontArgs->FontSize() };
 
@@ -249,7 +283,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
     {
         auto request = args.Request();
 
-        TryRedrawCanvas();
+        _TryRedrawCanvas();
 
         // Set the text block bounds
         request.LayoutBounds().TextBounds(_currentTextBounds);
@@ -269,6 +303,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
     void TSFInputControl::_compositionStartedHandler(CoreTextEditContext sender, const CoreTextCompositionStartedEventArgs& /*args*/)
     {
         _inComposition = true;
+        _CompositionActiveChangedHandlers(true);
     }
 
     // Method Description:
@@ -282,6 +317,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
     void TSFInputControl::_compositionCompletedHandler(CoreTextEditContext sender, const CoreTextCompositionCompletedEventArgs& /*args*/)
     {
         _inComposition = false;
+        _CompositionActiveChangedHandlers(false);
         _SendAndClearText();
     }
 
@@ -39,6 +39,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         void NotifyFocusLeave();
         void ClearBuffer();
         void TryRedrawCanvas();
+        void InvalidateFontInfo() noexcept;
 
         void Close();
 
@@ -46,6 +47,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         TYPED_EVENT(CurrentCursorPosition, Control::TSFInputControl, Control::CursorPositionEventArgs);
         TYPED_EVENT(CurrentFontInfo, Control::TSFInputControl, Control::FontInfoEventArgs);
         WINRT_CALLBACK(CompositionCompleted, Control::CompositionCompletedEventArgs);
+        WINRT_CALLBACK(CompositionActiveChanged, Control::CompositionActiveChangedEventArgs);
 
     private:
         void _layoutRequestedHandler(winrt::Windows::UI::Text::Core::CoreTextEditContext sender, const winrt::Windows::UI::Text::Core::CoreTextLayoutRequestedEventArgs& args);
@@ -59,6 +61,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         void _formatUpdatingHandler(winrt::Windows::UI::Text::Core::CoreTextEditContext sender, const winrt::Windows::UI::Text::Core::CoreTextFormatUpdatingEventArgs& args);
 
         void _SendAndClearText();
+        void _TryRedrawCanvas();
         void _RedrawCanvas();
 
         winrt::Windows::UI::Text::Core::CoreTextEditContext::TextRequested_revoker _textRequestedRevoker;
@@ -84,6 +87,10 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         winrt::Windows::Foundation::Rect _currentControlBounds{};
         winrt::Windows::Foundation::Rect _currentTextBounds{};
         winrt::Windows::Foundation::Rect _currentWindowBounds{};
+
+        // The font info is cached between redraws, because it only
+        // changes when the font does. See InvalidateFontInfo().
+        winrt::com_ptr<FontInfoEventArgs> _fontInfo;
     };
 }
 namespace winrt::Microsoft::Terminal::Control::factory_implementation
@@ -47,6 +47,68 @@ DEFINE_ENUM_FLAG_OPERATORS(winrt::Microsoft::Terminal::Control::MouseButtonState
 
 namespace winrt::Microsoft::Terminal::Control::implementation
 {
+    // Method Description:
+    // - Returns a BitmapImage for the given background image, shared by all
+    //   controls on this thread that use the same image. Every BitmapImage holds
+    //   its own decoded copy of the image, so with many tabs using the same
+    //   background we'd otherwise decode and hold that many copies of it.
+    // - XAML objects are bound to the thread they were created on, which is why
+    //   this cache is per thread (= per window) and not per process. The entries
+    //   are weak, so an image is released once the last control using it is.
+    // Arguments:
+    // - path: the background image path of the appearance
+    // - imageUri: the URI of that path
+    // Return Value:
+    // - the shared image
+    static Media::Imaging::BitmapImage _sharedBackgroundImage(const winrt::hstring& path, const Windows::Foundation::Uri& imageUri)
+    {
+        struct Entry
+        {
+            uint64_t lastWriteTime = 0;
+            winrt::weak_ref<Media::Imaging::BitmapImage> image;
+        };
+        static thread_local std::unordered_map<std::wstring, Entry> cache;
+
+        // Images that changed on disk must be decoded again.
+        // URIs that aren't local files get a lastWriteTime of 0.
+        uint64_t lastWriteTime = 0;
+        WIN32_FILE_ATTRIBUTE_DATA data;
+        if (GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &data))
+        {
+            lastWriteTime = til::bit_cast<uint64_t>(data.ftLastWriteTime);
+        }
+
+        const auto [it, inserted] = cache.try_emplace(std::wstring{ imageUri.AbsoluteUri() });
+        auto& entry = it->second;
+
+        if (!inserted && entry.lastWriteTime == lastWriteTime)
+        {
+            if (auto image = entry.image.get())
+            {
+                return image;
+            }
+        }
+
+        // Note that BitmapImage handles the image load asynchronously,
+        // which is especially important since the image
+        // may well be both large and somewhere out on the
+        // internet. Until then, the background color shows through.
+        Media::Imaging::BitmapImage image;
+        if (!inserted && entry.lastWriteTime != lastWriteTime)
+        {
+            // XAML has its own URI-based image cache, which would return the outdated image.
+            image.CreateOptions(Media::Imaging::BitmapCreateOptions::IgnoreImageCache);
+        }
+        image.UriSource(imageUri);
+
+        entry.lastWriteTime = lastWriteTime;
+        entry.image = winrt::make_weak(image);
+
+        // Drop the entries of images that are no longer used by anyone.
+        std::erase_if(cache, [](const auto& pair) { return !pair.second.image.get(); });
+        return image;
+    }
+
     TermControl::TermControl(IControlSettings settings,
                              Control::IControlAppearance unfocusedAppearance,
                              TerminalConnection::ITerminalConnection connection) :
@@ -358,10 +420,30 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         }
         else
         {
-            _core.Search(_searchBox->TextBox().Text(), goForward, false);
+            _core.Search(_searchBox->TextBox().Text(), goForward, false, false);
         }
     }
 
+    // Method Description:
+    // - Finds all matches of the given text in the background. See ControlCore::FindAllMatches().
+    Windows::Foundation::IAsyncOperation<Windows::Foundation::Collections::IVector<Control::SearchResult>> TermControl::FindAllMatches(const hstring& text, const bool caseSensitive, const bool regularExpression)
+    {
+        return _core.FindAllMatches(text, caseSensitive, regularExpression);
+    }
+
+    // Method Description:
+    // - Selects a match found by FindAllMatches() and scrolls it into view.
+    // Return Value:
+    // - false if the match has scrolled out of the buffer in the meantime.
+    bool TermControl::SelectSearchResult(const Control::SearchResult& result)
+    {
+        if (_IsClosing())
+        {
+            return false;
+        }
+        return _core.SelectSearchResult(result);
+    }
+
     // Method Description:
     // Find if search box text edit currently is in focus
     // Return Value:
@@ -383,13 +465,15 @@ namespace winrt::Microsoft::Terminal::Control::implementation
     // - text: the text to search
     // - goForward: boolean that represents if the current search direction is forward
     // - caseSensitive: boolean that represents if the current search is case sensitive
+    // - regularExpression: boolean that represents if the text is a regular expression
     // Return Value:
     // - <none>
     void TermControl::_Search(const winrt::hstring& text,
                               const bool goForward,
-                              const bool caseSensitive)
+                              const bool caseSensitive,
+                              const bool regularExpression)
     {
-        _core.Search(text, goForward, caseSensitive);
+        _core.Search(text, goForward, caseSensitive, regularExpression);
     }
 
     // Method Description:
@@ -476,6 +560,20 @@ namespace winrt::Microsoft::Terminal::Control::implementation
             return;
         }
 
+        _updateXamlAppearance(newAppearance);
+
+        _core.ApplyAppearance(_focused);
+    }
+
+    // Method Description:
+    // - Updates the XAML elements of this control (background, selection
+    //   markers, TSF) to match the given appearance. Unlike
+    //   _UpdateAppearanceFromUIThread, this leaves the core untouched.
+    // - INVARIANT: This method must be called from the UI thread.
+    // Arguments:
+    // - newAppearance: the appearance to apply
+    void TermControl::_updateXamlAppearance(const Control::IControlAppearance& newAppearance)
+    {
         _SetBackgroundImage(newAppearance);
 
         // Update our control settings
@@ -502,8 +600,6 @@ namespace winrt::Microsoft::Terminal::Control::implementation
             foregroundBrush.Color(static_cast<til::color>(newAppearance.DefaultForeground()));
         }
         TSFInputControl().Foreground(foregroundBrush);
-
-        _core.ApplyAppearance(_focused);
     }
 
     // Method Description:
@@ -521,11 +617,56 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         _core.ClearBuffer(clearType);
     }
 
+    void TermControl::PersistBuffer(const winrt::hstring& path)
+    {
+        _core.PersistBuffer(path);
+    }
+
+    void TermControl::RestoreBuffer(const winrt::hstring& path)
+    {
+        _core.RestoreBuffer(path);
+    }
+
     void TermControl::ToggleShaderEffects()
     {
         _core.ToggleShaderEffects();
     }
 
+    // Method Description:
+    // - Shows or hides a small overlay in the corner of the control with live
+    //   statistics about the output parser, the terminal lock and the renderer.
+    //   It's meant for triaging "my terminal is slow" reports without a trace.
+    void TermControl::TogglePerformanceOverlay()
+    {
+        const auto overlay = FindName(L"PerformanceOverlay").try_as<UIElement>();
+        if (!overlay)
+        {
+            return;
+        }
+
+        if (_performanceOverlayTimer)
+        {
+            _performanceOverlayTimer->Stop();
+            _performanceOverlayTimer.reset();
+            overlay.Visibility(Visibility::Collapsed);
+            return;
+        }
+
+        _lastPerformanceCounters = _core.SamplePerformanceCounters();
+        _lastPerformanceSample = std::chrono::steady_clock::now();
+        if (const auto text = FindName(L"PerformanceOverlayText").try_as<Controls::TextBlock>())
+        {
+            text.Text(L"Collecting...");
+        }
+        overlay.Visibility(Visibility::Visible);
+
+        DispatcherTimer timer;
+        timer.Interval(std::chrono::milliseconds(500));
+        timer.Tick({ get_weak(), &TermControl::_PerformanceOverlayTimerTick });
+        timer.Start();
+        _performanceOverlayTimer.emplace(std::move(timer));
+    }
+
     // Method Description:
     // - Style our UI elements based on the values in our settings, and set up
     //   other control-specific settings. This method will be called whenever
@@ -622,12 +763,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
             imageSource.UriSource() == nullptr ||
             !imageSource.UriSource().Equals(imageUri))
         {
-            // Note that BitmapImage handles the image load asynchronously,
-            // which is especially important since the image
-            // may well be both large and somewhere out on the
-            // internet.
-            Media::Imaging::BitmapImage image(imageUri);
-            BackgroundImage().Source(image);
+            BackgroundImage().Source(_sharedBackgroundImage(newAppearance.BackgroundImage(), imageUri));
         }
 
         // Apply stretch, opacity and alignment settings
@@ -865,6 +1001,11 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         return _core.ConnectionState();
     }
 
+    winrt::guid TermControl::SessionId() const
+    {
+        return _core.SessionId();
+    }
+
     void TermControl::RenderEngineSwapChainChanged(IInspectable /*sender*/, IInspectable args)
     {
         // This event comes in on the UI thread
@@ -1013,8 +1154,21 @@ namespace winrt::Microsoft::Terminal::Control::implementation
             _blinkTimer = std::nullopt;
         }
 
-        // Now that the renderer is set up, update the appearance for initialization
-        _UpdateAppearanceFromUIThread(_core.FocusedAppearance());
+        if (reason == InitializeReason::Create)
+        {
+            // Now that the renderer is set up, update the appearance for initialization
+            _UpdateAppearanceFromUIThread(_core.FocusedAppearance());
+        }
+        else
+        {
+            // When we're re-attaching existing content, the core, its buffer and
+            // its render engine (including the swap chain we've just attached to)
+            // are all still intact. Re-applying the appearance to the core would
+            // reset any colors the application changed at runtime and redraw the
+            // whole viewport, for no reason. Only our own XAML elements are new.
+            _updateXamlAppearance(_core.FocusedAppearance());
+            _changeBackgroundColor(til::color{ _core.BackgroundColor() });
+        }
 
         _initializedTerminal = true;
 
@@ -1896,6 +2050,12 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         }
 
         const auto newSize = e.NewSize();
+        // A collapsed control, like one in a warm background tab (see TerminalPage::_ShowTabContent),
+        // may be laid out at 0x0. Resizing the buffer to that would reflow it into a single column.
+        if (newSize.Width <= 0 || newSize.Height <= 0)
+        {
+            return;
+        }
         _core.SizeChanged(newSize.Width, newSize.Height);
 
         if (_automationPeer)
@@ -1967,6 +2127,68 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         }
     }
 
+    // Method Description:
+    // - Updates the performance overlay with the rates since the previous tick.
+    // Arguments:
+    // - sender: not used
+    // - e: not used
+    void TermControl::_PerformanceOverlayTimerTick(const Windows::Foundation::IInspectable& /* sender */,
+                                                   const Windows::Foundation::IInspectable& /* e */)
+    {
+        const auto text = FindName(L"PerformanceOverlayText").try_as<Controls::TextBlock>();
+        if (_IsClosing() || !text)
+        {
+            return;
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        const auto counters = _core.SamplePerformanceCounters();
+        const auto& last = _lastPerformanceCounters;
+        const auto seconds = std::max(std::chrono::duration<double>(now - _lastPerformanceSample).count(), 0.001);
+
+        // The counters may go backwards if the control was handed a different core.
+        static constexpr auto delta = [](const uint64_t current, const uint64_t previous) noexcept {
+            return static_cast<double>(current >= previous ? current - previous : 0);
+        };
+        static constexpr auto ratio = [](const double numerator, const double denominator) noexcept {
+            return denominator > 0 ? numerator / denominator : 0.0;
+        };
+
+        const auto frames = delta(counters.FramesPainted, last.FramesPainted);
+        const auto shapingHits = delta(counters.ShapingCacheHits, last.ShapingCacheHits);
+        const auto shapingLookups = shapingHits + delta(counters.ShapingCacheMisses, last.ShapingCacheMisses);
+        const auto glyphLookups = delta(counters.GlyphLookups, last.GlyphLookups);
+        const auto glyphMisses = std::min(delta(counters.GlyphCacheMisses, last.GlyphCacheMisses), glyphLookups);
+
+        auto str = fmt::format(FMT_COMPILE(L"input    {:>9.0f} chars/s\n"
+                                           L"parse    {:>9.2f} ms/frame\n"
+                                           L"lock     {:>9.2f} ms/s waited\n"
+                                           L"frames   {:>5.0f} / {:<5.0f} per s\n"
+                                           L"latency  {:>9.2f} ms\n"
+                                           L"echo     {:>9.2f} ms\n"
+                                           L"dirty    {:>9.1f} rows/frame\n"
+                                           L"shaping  {:>9.1f} % hits\n"
+                                           L"glyphs   {:>9.1f} % hits"),
+                               delta(counters.OutputCharacters, last.OutputCharacters) / seconds,
+                               ratio(delta(counters.ParseMicroseconds, last.ParseMicroseconds) / 1000.0, frames),
+                               delta(counters.LockWaitMicroseconds, last.LockWaitMicroseconds) / 1000.0 / seconds,
+                               frames / seconds,
+                               delta(counters.PaintRequests, last.PaintRequests) / seconds,
+                               ratio(delta(counters.PresentLatencyMicroseconds, last.PresentLatencyMicroseconds) / 1000.0, frames),
+                               ratio(delta(counters.EchoLatencyMicroseconds, last.EchoLatencyMicroseconds) / 1000.0, delta(counters.EchoFrames, last.EchoFrames)),
+                               ratio(delta(counters.DirtyRows, last.DirtyRows), frames),
+                               shapingLookups > 0 ? 100.0 * shapingHits / shapingLookups : 100.0,
+                               glyphLookups > 0 ? 100.0 * (glyphLookups - glyphMisses) / glyphLookups : 100.0);
+        if (counters.GlyphAtlasOccupancy >= 0)
+        {
+            fmt::format_to(std::back_inserter(str), FMT_COMPILE(L"\natlas    {:>9.1f} % full"), 100.0 * counters.GlyphAtlasOccupancy);
+        }
+        text.Text(str);
+
+        _lastPerformanceCounters = counters;
+        _lastPerformanceSample = now;
+    }
+
     // Method Description:
     // - Sets selection's end position to match supplied cursor position, e.g. while mouse dragging.
     // Arguments:
@@ -2117,6 +2339,11 @@ namespace winrt::Microsoft::Terminal::Control::implementation
             // Disconnect the TSF input control so it doesn't receive EditContext events.
             TSFInputControl().Close();
             _autoScrollTimer.Stop();
+            if (_performanceOverlayTimer)
+            {
+                _performanceOverlayTimer->Stop();
+                _performanceOverlayTimer.reset();
+            }
 
             if (!_detached)
             {
@@ -2380,6 +2607,16 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         _core.WindowVisibilityChanged(showOrHide);
     }
 
+    // Method Description:
+    // - Tells the control whether it's currently shown within its window, which
+    //   it isn't while it's in a background tab. Hidden controls don't render.
+    // Arguments:
+    // - visible: True for visible; false for not visible.
+    void TermControl::VisibilityChanged(const bool visible)
+    {
+        _core.VisibilityChanged(visible);
+    }
+
     // Method Description:
     // - Create XAML Thickness object based on padding props provided.
     //   Used for controlling the TermControl XAML Grid container's Padding prop.
@@ -2548,6 +2785,24 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         _core.SendInput(text);
     }
 
+    // Method Description:
+    // - CompositionActiveChanged handler for the TSFInputControl. The core
+    //   only reports cursor movements to the TSFInputControl while an IME
+    //   composition is in progress.
+    // Arguments:
+    // - active: whether a composition is in progress
+    // Return Value:
+    // - <none>
+    void TermControl::_CompositionActiveChanged(bool active)
+    {
+        if (_IsClosing())
+        {
+            return;
+        }
+
+        _core.ImeCompositionActive(active);
+    }
+
     // Method Description:
     // - CurrentCursorPosition handler for the TSFInputControl that
     //   handles returning current cursor position.
@@ -3177,6 +3432,9 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         scaleMarker(SelectionStartMarker());
         scaleMarker(SelectionEndMarker());
 
+        // The TSFInputControl caches the font info between redraws.
+        TSFInputControl().InvalidateFontInfo();
+
         // Don't try to inspect the core here. The Core is raising this while
         // it's holding its write lock. If the handlers calls back to some
         // method on the TermControl on the same thread, and that _method_ calls
@@ -3246,6 +3504,26 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         return _core.ReadEntireBuffer();
     }
 
+    Windows::Foundation::IAsyncAction TermControl::ExportBuffer(hstring path, ExportBufferFormat format)
+    {
+        return _core.ExportBuffer(path, format);
+    }
+
+    hstring TermControl::SampleLockStatistics() const
+    {
+        return _core.SampleLockStatistics();
+    }
+
+    Control::MemoryUsage TermControl::SampleMemoryUsage() const
+    {
+        return _core.SampleMemoryUsage();
+    }
+
+    void TermControl::TrimMemory()
+    {
+        _core.TrimMemory();
+    }
+
     Core::Scheme TermControl::ColorScheme() const noexcept
     {
         return _core.ColorScheme();
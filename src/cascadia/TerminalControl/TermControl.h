@@ -52,6 +52,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         float SnapDimensionToGrid(const bool widthOrHeight, const float dimension);
 
         void WindowVisibilityChanged(const bool showOrHide);
+        void VisibilityChanged(const bool visible);
 
         void ColorSelection(Control::SelectionColor fg, Control::SelectionColor bg, Core::MatchMode matchMode);
 
@@ -64,6 +65,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         hstring WorkingDirectory() const;
 
         TerminalConnection::ConnectionState ConnectionState() const;
+        winrt::guid SessionId() const;
 
         int ScrollOffset() const;
         int ViewHeight() const;
@@ -94,8 +96,11 @@ namespace winrt::Microsoft::Terminal::Control::implementation
 
         void SendInput(const winrt::hstring& input);
         void ClearBuffer(Control::ClearBufferType clearType);
+        void PersistBuffer(const winrt::hstring& path);
+        void RestoreBuffer(const winrt::hstring& path);
 
         void ToggleShaderEffects();
+        void TogglePerformanceOverlay();
 
         void RenderEngineSwapChainChanged(IInspectable sender, IInspectable args);
         void _AttachDxgiSwapChainToXaml(HANDLE swapChainHandle);
@@ -108,6 +113,8 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         void CreateSearchBoxControl();
 
         void SearchMatch(const bool goForward);
+        Windows::Foundation::IAsyncOperation<Windows::Foundation::Collections::IVector<Control::SearchResult>> FindAllMatches(const hstring& text, const bool caseSensitive, const bool regularExpression);
+        bool SelectSearchResult(const Control::SearchResult& result);
 
         bool SearchBoxEditInFocus() const;
 
@@ -137,6 +144,10 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         static Windows::UI::Xaml::Thickness ParseThicknessFromPadding(const hstring padding);
 
         hstring ReadEntireBuffer() const;
+        Windows::Foundation::IAsyncAction ExportBuffer(hstring path, ExportBufferFormat format);
+        hstring SampleLockStatistics() const;
+        Control::MemoryUsage SampleMemoryUsage() const;
+        void TrimMemory();
 
         winrt::Microsoft::Terminal::Core::Scheme ColorScheme() const noexcept;
         void ColorScheme(const winrt::Microsoft::Terminal::Core::Scheme& scheme) const noexcept;
@@ -226,6 +237,11 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         std::optional<Windows::UI::Xaml::DispatcherTimer> _cursorTimer;
         std::optional<Windows::UI::Xaml::DispatcherTimer> _blinkTimer;
 
+        // Set while the performance overlay is shown. See TogglePerformanceOverlay().
+        std::optional<Windows::UI::Xaml::DispatcherTimer> _performanceOverlayTimer;
+        Control::PerformanceCounters _lastPerformanceCounters{};
+        std::chrono::steady_clock::time_point _lastPerformanceSample{};
+
         winrt::Windows::UI::Xaml::Controls::SwapChainPanel::LayoutUpdated_revoker _layoutUpdatedRevoker;
         bool _showMarksInScrollbar{ false };
 
@@ -253,6 +269,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
 
         void _UpdateSettingsFromUIThread();
         void _UpdateAppearanceFromUIThread(Control::IControlAppearance newAppearance);
+        void _updateXamlAppearance(const Control::IControlAppearance& newAppearance);
         void _ApplyUISettings();
         winrt::fire_and_forget UpdateAppearance(Control::IControlAppearance newAppearance);
         void _SetBackgroundImage(const IControlAppearance& newAppearance);
@@ -291,6 +308,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
 
         void _CursorTimerTick(const Windows::Foundation::IInspectable& sender, const Windows::Foundation::IInspectable& e);
         void _BlinkTimerTick(const Windows::Foundation::IInspectable& sender, const Windows::Foundation::IInspectable& e);
+        void _PerformanceOverlayTimerTick(const Windows::Foundation::IInspectable& sender, const Windows::Foundation::IInspectable& e);
         void _BellLightOff(const Windows::Foundation::IInspectable& sender, const Windows::Foundation::IInspectable& e);
 
         void _SetEndSelectionPointAtCursor(const Windows::Foundation::Point& cursorPosition);
@@ -319,11 +337,12 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         const til::point _toTerminalOrigin(winrt::Windows::Foundation::Point cursorPosition);
         double _GetAutoScrollSpeed(double cursorDistanceFromBorder) const;
 
-        void _Search(const winrt::hstring& text, const bool goForward, const bool caseSensitive);
+        void _Search(const winrt::hstring& text, const bool goForward, const bool caseSensitive, const bool regularExpression);
         void _CloseSearchBoxControl(const winrt::Windows::Foundation::IInspectable& sender, const Windows::UI::Xaml::RoutedEventArgs& args);
 
         // TSFInputControl Handlers
         void _CompositionCompleted(winrt::hstring text);
+        void _CompositionActiveChanged(bool active);
         void _CurrentCursorPositionHandler(const IInspectable& sender, const CursorPositionEventArgs& eventArgs);
         void _FontInfoHandler(const IInspectable& sender, const FontInfoEventArgs& eventArgs);
 
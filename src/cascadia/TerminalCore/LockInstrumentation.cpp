@@ -0,0 +1,449 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "pch.h"
+#include "LockInstrumentation.hpp"
+
+#include "tracing.hpp"
+
+#include <bit>
+
+using namespace Microsoft::Terminal::Core;
+
+static constexpr std::array<std::wstring_view, InstrumentedLock::SiteCount> siteNames{
+    L"Other",
+    L"Renderer",
+    L"Output",
+    L"Selection",
+    L"UIA",
+    L"Search",
+    L"Reflow",
+};
+
+static size_t bucketIndex(const uint64_t us) noexcept
+{
+    // 0us -> 0, 1us -> 1, 2-3us -> 2, 4-7us -> 3, ...
+    const auto bits = static_cast<size_t>(std::bit_width(us));
+    return std::min(bits, InstrumentedLock::BucketCount - 1);
+}
+
+namespace
+{
+    // The shared acquisitions the current thread holds. There's usually just one.
+    struct SharedHold
+    {
+        const InstrumentedLock* lock = nullptr;
+        uint32_t depth = 0;
+        uint32_t readers = 0;
+        LockSite site = LockSite::Other;
+        bool timing = false;
+        std::chrono::steady_clock::time_point holdStart{};
+        std::chrono::steady_clock::duration wait{};
+    };
+
+    thread_local std::vector<SharedHold> sharedHolds;
+
+    SharedHold* findSharedHold(const InstrumentedLock* lock) noexcept
+    {
+        for (auto& hold : sharedHolds)
+        {
+            if (hold.lock == lock)
+            {
+                return &hold;
+            }
+        }
+        return nullptr;
+    }
+}
+
+InstrumentedLock::Suspension::Suspension(InstrumentedLock& lock) noexcept :
+    _restore{ lock, lock._lock.is_locked() != 0 },
+    _inner{ lock._lock.suspend() }
+{
+    if (_restore.owned)
+    {
+        _restore.lock._releaseWriter();
+    }
+}
+
+InstrumentedLock::Suspension::~Suspension()
+{
+    // Announce ourselves before _inner reacquires _lock, so that no new readers get in.
+    if (_restore.owned)
+    {
+        _restore.lock._writers.fetch_add(1);
+    }
+}
+
+InstrumentedLock::Suspension::Restore::~Restore()
+{
+    if (owned)
+    {
+        lock._waitForReaders();
+    }
+}
+
+void InstrumentedLock::lock() noexcept
+{
+    lock(LockSite::Other);
+}
+
+bool InstrumentedLock::try_lock() noexcept
+{
+    return try_lock(LockSite::Other);
+}
+
+void InstrumentedLock::unlock() noexcept
+{
+    if (_lock.recursion_depth() != 1)
+    {
+        _lock.unlock();
+        return;
+    }
+
+    if (_timing)
+    {
+        _endHold();
+    }
+    _lock.unlock();
+    _releaseWriter();
+}
+
+void InstrumentedLock::lock_shared() noexcept
+{
+    lock_shared(LockSite::Other);
+}
+
+bool InstrumentedLock::try_lock_shared() noexcept
+{
+    return try_lock_shared(LockSite::Other);
+}
+
+void InstrumentedLock::unlock_shared() noexcept
+{
+    if (_lock.is_locked())
+    {
+        unlock();
+        return;
+    }
+
+    const auto hold = findSharedHold(this);
+    assert(hold && hold->depth);
+    if (--hold->depth)
+    {
+        return;
+    }
+
+    if (hold->timing)
+    {
+        _record(hold->site, hold->wait, clock::now() - hold->holdStart, true, hold->readers);
+    }
+    sharedHolds.erase(sharedHolds.begin() + (hold - sharedHolds.data()));
+    _releaseReader();
+}
+
+void InstrumentedLock::lock(const LockSite site) noexcept
+{
+    if (_lock.is_locked())
+    {
+        _lock.lock();
+        return;
+    }
+
+    // The readers would be waiting for us and we for them.
+    assert(!findSharedHold(this));
+
+    const auto instrumenting = _isInstrumenting();
+    const auto waitStart = instrumenting ? clock::now() : clock::time_point{};
+
+    _writers.fetch_add(1);
+    _lock.lock();
+    _waitForReaders();
+
+    if (instrumenting)
+    {
+        _startHold(site, waitStart);
+    }
+}
+
+bool InstrumentedLock::try_lock(const LockSite site) noexcept
+{
+    if (_lock.is_locked())
+    {
+        _lock.lock();
+        return true;
+    }
+
+    const auto instrumenting = _isInstrumenting();
+    const auto waitStart = instrumenting ? clock::now() : clock::time_point{};
+
+    _writers.fetch_add(1);
+    if (!_lock.try_lock())
+    {
+        _releaseWriter();
+        return false;
+    }
+    if (_readers.load())
+    {
+        _lock.unlock();
+        _releaseWriter();
+        return false;
+    }
+
+    if (instrumenting)
+    {
+        _startHold(site, waitStart);
+    }
+    return true;
+}
+
+void InstrumentedLock::lock_shared(const LockSite site) noexcept
+{
+    if (_lock.is_locked())
+    {
+        lock(site);
+        return;
+    }
+    if (const auto hold = findSharedHold(this))
+    {
+        // Waiting for a pending writer here would deadlock, since it waits for us.
+        hold->depth++;
+        return;
+    }
+
+    const auto instrumenting = _isInstrumenting();
+    const auto waitStart = instrumenting ? clock::now() : clock::time_point{};
+    const auto readers = _enterShared(true);
+
+    auto& hold = sharedHolds.emplace_back();
+    hold.lock = this;
+    hold.depth = 1;
+    hold.readers = readers;
+    hold.site = site;
+    if (instrumenting)
+    {
+        hold.holdStart = clock::now();
+        hold.wait = hold.holdStart - waitStart;
+        hold.timing = true;
+    }
+}
+
+bool InstrumentedLock::try_lock_shared(const LockSite site) noexcept
+{
+    if (_lock.is_locked())
+    {
+        return try_lock(site);
+    }
+    if (const auto hold = findSharedHold(this))
+    {
+        hold->depth++;
+        return true;
+    }
+
+    const auto instrumenting = _isInstrumenting();
+    const auto waitStart = instrumenting ? clock::now() : clock::time_point{};
+    const auto readers = _enterShared(false);
+    if (!readers)
+    {
+        return false;
+    }
+
+    auto& hold = sharedHolds.emplace_back();
+    hold.lock = this;
+    hold.depth = 1;
+    hold.readers = readers;
+    hold.site = site;
+    if (instrumenting)
+    {
+        hold.holdStart = clock::now();
+        hold.wait = hold.holdStart - waitStart;
+        hold.timing = true;
+    }
+    return true;
+}
+
+InstrumentedLock::Suspension InstrumentedLock::suspend() noexcept
+{
+    // The time spent suspended shouldn't count towards the hold time.
+    // The remainder of the hold after the suspension ends isn't measured.
+    if (_timing && _lock.is_locked())
+    {
+        _endHold();
+    }
+    return Suspension{ *this };
+}
+
+uint32_t InstrumentedLock::is_locked() const noexcept
+{
+    return _lock.is_locked();
+}
+
+uint32_t InstrumentedLock::recursion_depth() const noexcept
+{
+    return _lock.recursion_depth();
+}
+
+void InstrumentedLock::EnableInstrumentation(const bool enable) noexcept
+{
+    _enabled.store(enable, std::memory_order_relaxed);
+}
+
+// Returns the statistics gathered since the last call and resets them.
+// Calling this periodically results in a rolling histogram.
+InstrumentedLock::Snapshot InstrumentedLock::TakeSnapshot() noexcept
+{
+    const std::lock_guard guard{ _statsLock };
+    return std::exchange(_stats, {});
+}
+
+// Returns the total time that any call site waited for the lock while instrumenting.
+uint64_t InstrumentedLock::TotalWaitMicroseconds() const noexcept
+{
+    return _totalWaitUs.load(std::memory_order_relaxed);
+}
+
+std::wstring InstrumentedLock::FormatSnapshot(const Snapshot& snapshot)
+{
+    static constexpr auto formatBuckets = [](std::wstring& out, const std::array<uint32_t, BucketCount>& buckets) {
+        for (size_t i = 0; i < BucketCount; ++i)
+        {
+            if (!buckets[i])
+            {
+                continue;
+            }
+            if (i == BucketCount - 1)
+            {
+                fmt::format_to(std::back_inserter(out), FMT_COMPILE(L" >={}us:{}"), 1ull << (i - 1), buckets[i]);
+            }
+            else
+            {
+                fmt::format_to(std::back_inserter(out), FMT_COMPILE(L" <{}us:{}"), 1ull << i, buckets[i]);
+            }
+        }
+    };
+
+    std::wstring out;
+    for (size_t site = 0; site < SiteCount; ++site)
+    {
+        const auto& h = snapshot[site];
+        if (!h.count)
+        {
+            continue;
+        }
+
+        fmt::format_to(std::back_inserter(out), FMT_COMPILE(L"{:<9} n={} max wait={}us max hold={}us"), til::at(siteNames, site), h.count, h.maxWaitUs, h.maxHoldUs);
+        if (h.sharedCount)
+        {
+            fmt::format_to(std::back_inserter(out), FMT_COMPILE(L" shared={} max readers={}"), h.sharedCount, h.maxReaders);
+        }
+        out.append(L"\r\n  wait:");
+        formatBuckets(out, h.wait);
+        out.append(L"\r\n  hold:");
+        formatBuckets(out, h.hold);
+        out.append(L"\r\n");
+    }
+    return out;
+}
+
+bool InstrumentedLock::_isInstrumenting() const noexcept
+{
+    return _enabled.load(std::memory_order_relaxed) || TraceLoggingProviderEnabled(g_hCTerminalCoreProvider, WINEVENT_LEVEL_VERBOSE, 0);
+}
+
+void InstrumentedLock::_waitForReaders() const noexcept
+{
+    for (auto readers = _readers.load(); readers; readers = _readers.load())
+    {
+        til::atomic_wait(_readers, readers);
+    }
+}
+
+void InstrumentedLock::_releaseWriter() noexcept
+{
+    if (_writers.fetch_sub(1) == 1)
+    {
+        til::atomic_notify_all(_writers);
+    }
+}
+
+void InstrumentedLock::_releaseReader() noexcept
+{
+    if (_readers.fetch_sub(1) == 1)
+    {
+        til::atomic_notify_all(_readers);
+    }
+}
+
+// Joins the readers, unless a writer holds or waits for the lock and `wait` is false.
+// Returns the number of readers including this one, or 0 if it failed.
+uint32_t InstrumentedLock::_enterShared(const bool wait) noexcept
+{
+    for (;;)
+    {
+        for (auto writers = _writers.load(); writers; writers = _writers.load())
+        {
+            if (!wait)
+            {
+                return 0;
+            }
+            til::atomic_wait(_writers, writers);
+        }
+
+        // A writer increments _writers and then reads _readers, while we do the opposite.
+        // With the default sequentially consistent ordering at least one of us sees the other.
+        const auto readers = _readers.fetch_add(1) + 1;
+        if (!_writers.load())
+        {
+            return readers;
+        }
+
+        // A writer snuck in. Let it go first.
+        _releaseReader();
+    }
+}
+
+void InstrumentedLock::_startHold(const LockSite site, const clock::time_point waitStart) noexcept
+{
+    _holdStart = clock::now();
+    _wait = _holdStart - waitStart;
+    _site = site;
+    _timing = true;
+}
+
+void InstrumentedLock::_endHold() noexcept
+{
+    _timing = false;
+    _record(_site, _wait, clock::now() - _holdStart, false, 0);
+}
+
+void InstrumentedLock::_record(const LockSite site, const clock::duration wait, const clock::duration hold, const bool shared, const uint32_t readers) noexcept
+{
+    const auto waitUs = gsl::narrow_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(wait).count());
+    const auto holdUs = gsl::narrow_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(hold).count());
+    _totalWaitUs.fetch_add(waitUs, std::memory_order_relaxed);
+
+    {
+        const std::lock_guard guard{ _statsLock };
+        auto& h = til::at(_stats, static_cast<size_t>(site));
+        til::at(h.wait, bucketIndex(waitUs))++;
+        til::at(h.hold, bucketIndex(holdUs))++;
+        h.count++;
+        h.maxWaitUs = std::max(h.maxWaitUs, waitUs);
+        h.maxHoldUs = std::max(h.maxHoldUs, holdUs);
+        if (shared)
+        {
+            h.sharedCount++;
+            h.maxReaders = std::max(h.maxReaders, readers);
+        }
+    }
+
+#pragma warning(suppress : 26477 26485 26494 26482 26446) // We don't control TraceLoggingWrite
+    TraceLoggingWrite(g_hCTerminalCoreProvider,
+                      "TerminalLockHeld",
+                      TraceLoggingDescription("The terminal lock was released"),
+                      TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+                      TraceLoggingWideString(til::at(siteNames, static_cast<size_t>(site)).data(), "Site"),
+                      TraceLoggingBool(shared, "Shared"),
+                      TraceLoggingUInt64(waitUs, "WaitMicroseconds"),
+                      TraceLoggingUInt64(holdUs, "HoldMicroseconds"));
+}
@@ -0,0 +1,140 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- LockInstrumentation.hpp
+
+Abstract:
+- InstrumentedLock wraps the til::recursive_ticket_lock guarding the Terminal.
+- Besides exclusive (recursive) ownership it can be acquired shared, by any number
+  of threads at once. Writers are preferred: once a writer is waiting, new shared
+  acquisitions wait until it's done, so that a steady stream of readers can't starve
+  the output thread. Shared acquisitions nest, also while a writer is waiting, and
+  a shared acquisition on the thread that owns the lock counts as a recursive one.
+  Upgrading a shared acquisition to an exclusive one isn't supported and deadlocks.
+- When enabled, it records how long each call site waited to acquire the lock
+  and for how long it held it, in log2 histograms of microseconds.
+- Only the outermost acquisition of a recursive lock is measured.
+--*/
+
+#pragma once
+
+#include <til/ticket_lock.h>
+
+namespace Microsoft::Terminal::Core
+{
+    enum class LockSite : uint8_t
+    {
+        Other,
+        Renderer,
+        Output,
+        Selection,
+        Uia,
+        Search,
+        Reflow,
+    };
+
+    class InstrumentedLock
+    {
+    public:
+        static constexpr size_t SiteCount = 7;
+        // Bucket 0 counts durations below 1us, bucket i durations in [2^(i-1), 2^i) us
+        // and the last bucket everything from 2^(BucketCount-2) us (~16ms) upwards.
+        static constexpr size_t BucketCount = 16;
+
+        struct Histogram
+        {
+            std::array<uint32_t, BucketCount> wait{};
+            std::array<uint32_t, BucketCount> hold{};
+            uint64_t count = 0;
+            uint64_t maxWaitUs = 0;
+            uint64_t maxHoldUs = 0;
+            // How many of the `count` acquisitions were shared ones and
+            // the most readers that held the lock at the same time.
+            uint64_t sharedCount = 0;
+            uint32_t maxReaders = 0;
+        };
+        using Snapshot = std::array<Histogram, SiteCount>;
+
+        // Releases an exclusive acquisition of the lock for as long as it exists,
+        // which allows readers and other writers to proceed in the meantime.
+        class Suspension
+        {
+        public:
+            explicit Suspension(InstrumentedLock& lock) noexcept;
+            ~Suspension();
+
+            Suspension(const Suspension&) = delete;
+            Suspension& operator=(const Suspension&) = delete;
+            Suspension(Suspension&&) = delete;
+            Suspension& operator=(Suspension&&) = delete;
+
+        private:
+            // The members are destroyed in reverse order: First the inner suspension
+            // reacquires _lock and then this waits for the readers to leave.
+            struct Restore
+            {
+                InstrumentedLock& lock;
+                bool owned;
+                ~Restore();
+            };
+
+            Restore _restore;
+            til::recursive_ticket_lock_suspension _inner;
+        };
+
+        // These allow the use of std::unique_lock, std::shared_lock and co. Those will be attributed to LockSite::Other.
+        void lock() noexcept;
+        bool try_lock() noexcept;
+        void unlock() noexcept;
+        void lock_shared() noexcept;
+        bool try_lock_shared() noexcept;
+        void unlock_shared() noexcept;
+
+        void lock(LockSite site) noexcept;
+        bool try_lock(LockSite site) noexcept;
+        void lock_shared(LockSite site) noexcept;
+        bool try_lock_shared(LockSite site) noexcept;
+        [[nodiscard]] Suspension suspend() noexcept;
+        uint32_t is_locked() const noexcept;
+        uint32_t recursion_depth() const noexcept;
+
+        void EnableInstrumentation(bool enable) noexcept;
+        Snapshot TakeSnapshot() noexcept;
+        uint64_t TotalWaitMicroseconds() const noexcept;
+        static std::wstring FormatSnapshot(const Snapshot& snapshot);
+
+    private:
+        using clock = std::chrono::steady_clock;
+
+        bool _isInstrumenting() const noexcept;
+        void _waitForReaders() const noexcept;
+        void _releaseWriter() noexcept;
+        void _releaseReader() noexcept;
+        uint32_t _enterShared(bool wait) noexcept;
+        void _startHold(LockSite site, clock::time_point waitStart) noexcept;
+        void _endHold() noexcept;
+        void _record(LockSite site, clock::duration wait, clock::duration hold, bool shared, uint32_t readers) noexcept;
+
+        til::recursive_ticket_lock _lock;
+        std::atomic<bool> _enabled{ false };
+        // The number of threads that hold or wait for an exclusive acquisition and
+        // the number of threads that hold a shared one. A writer that owns _lock
+        // waits for _readers to drop to 0 and new readers wait for _writers to be 0.
+        std::atomic<uint32_t> _writers{ 0 };
+        std::atomic<uint32_t> _readers{ 0 };
+
+        // Readers record their measurements concurrently with each other.
+        til::ticket_lock _statsLock;
+        Snapshot _stats{};
+        // Unlike _stats this isn't reset by TakeSnapshot(), so that multiple observers can compute deltas.
+        std::atomic<uint64_t> _totalWaitUs{ 0 };
+
+        // These are only accessed while holding _lock exclusively.
+        clock::time_point _holdStart{};
+        clock::duration _wait{};
+        LockSite _site = LockSite::Other;
+        bool _timing = false;
+    };
+}
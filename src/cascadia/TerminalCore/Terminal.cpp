@@ -6,9 +6,11 @@
 #include "../../terminal/adapter/adaptDispatch.hpp"
 #include "../../terminal/parser/OutputStateMachineEngine.hpp"
 #include "../../inc/unicode.hpp"
+#include "../../inc/ConptyBinaryInput.hpp"
 #include "../../types/inc/utils.hpp"
 #include "../../types/inc/colorTable.hpp"
 #include "../../buffer/out/search.h"
+#include "tracing.hpp"
 
 #include <winrt/Microsoft.Terminal.Core.h>
 
@@ -49,6 +51,8 @@ Terminal::Terminal()
     };
 
     _terminalInput = std::make_unique<TerminalInput>(passAlongInput);
+    // Our input ends up in ConptyConnection::WriteInput(), which turns binary input records into frames.
+    _terminalInput->SetBinaryInputSupported(true);
 
     _renderSettings.SetColorAlias(ColorAlias::DefaultForeground, TextColor::DEFAULT_FOREGROUND, RGB(255, 255, 255));
     _renderSettings.SetColorAlias(ColorAlias::DefaultBackground, TextColor::DEFAULT_BACKGROUND, RGB(0, 0, 0));
@@ -62,7 +66,7 @@ void Terminal::Create(til::size viewportSize, til::CoordType scrollbackLines, Re
                                 Utils::ClampToShortMax(viewportSize.height + scrollbackLines, 1) };
     const TextAttribute attr{};
     const UINT cursorSize = 12;
-    _mainBuffer = std::make_unique<TextBuffer>(bufferSize, attr, cursorSize, true, renderer);
+    _mainBuffer = std::make_shared<TextBuffer>(bufferSize, attr, cursorSize, true, renderer);
 
     auto dispatch = std::make_unique<AdaptDispatch>(*this, renderer, _renderSettings, *_terminalInput);
     auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
@@ -110,6 +114,7 @@ void Terminal::UpdateSettings(ICoreSettings settings)
     _startingTitle = settings.StartingTitle();
     _trimBlockSelection = settings.TrimBlockSelection();
     _autoMarkPrompts = settings.AutoMarkPrompts();
+    _mainBuffer->EnableScrollbackSpill(settings.SpillScrollbackToDisk());
 
     _terminalInput->ForceDisableWin32InputMode(settings.ForceVTInput());
 
@@ -306,7 +311,7 @@ std::wstring_view Terminal::GetWorkingDirectory() noexcept
     auto endDefer = wil::scope_exit([this]() noexcept { _mainBuffer->GetCursor().EndDeferDrawing(); });
 
     // First allocate a new text buffer to take the place of the current one.
-    std::unique_ptr<TextBuffer> newTextBuffer;
+    std::shared_ptr<TextBuffer> newTextBuffer;
     try
     {
         // GH#3848 - Stash away the current attributes the old text buffer is
@@ -315,7 +320,7 @@ std::wstring_view Terminal::GetWorkingDirectory() noexcept
         // current attributes (the ones used for printing new text) match the
         // old buffer's.
         const auto oldBufferAttributes = _mainBuffer->GetCurrentAttributes();
-        newTextBuffer = std::make_unique<TextBuffer>(bufferSize,
+        newTextBuffer = std::make_shared<TextBuffer>(bufferSize,
                                                      TextAttribute{},
                                                      0, // temporarily set size to 0 so it won't render.
                                                      _mainBuffer->IsActiveBuffer(),
@@ -339,10 +344,12 @@ std::wstring_view Terminal::GetWorkingDirectory() noexcept
         oldRows.visibleViewportTop = newVisibleTop;
 
         const std::optional oldViewStart{ oldViewportTop };
-        RETURN_IF_FAILED(TextBuffer::Reflow(*_mainBuffer.get(),
-                                            *newTextBuffer.get(),
-                                            _mutableViewport,
-                                            { oldRows }));
+        // Only the viewport is reflowed right away. The scrollback above it follows once it's
+        // accessed or when the ControlCore calls FinishPendingReflowUnderLock().
+        RETURN_IF_FAILED(TextBuffer::ReflowLazily(_mainBuffer,
+                                                  *newTextBuffer.get(),
+                                                  _mutableViewport,
+                                                  oldRows));
 
         newViewportTop = oldRows.mutableViewportTop;
         newVisibleTop = oldRows.visibleViewportTop;
@@ -480,15 +487,32 @@ std::wstring_view Terminal::GetWorkingDirectory() noexcept
 
 void Terminal::Write(std::wstring_view stringView)
 {
-    auto lock = LockForWriting();
+    auto lock = LockForWriting(LockSite::Output);
 
     const auto& cursor = _activeBuffer().GetCursor();
     const til::point cursorPosBefore{ cursor.GetPosition() };
 
-    _stateMachine->ProcessString(stringView);
+    // If a large burst of output is going to scroll its own beginning out of the buffer,
+    // we only process what's left of the beginning after stripping its text.
+    auto remaining = stringView;
+    if (const auto skip = _fastForwardLength(remaining))
+    {
+        _stateMachine->ProcessString(_fastForwardPrefix(remaining.substr(0, skip)));
+        remaining = remaining.substr(skip);
+    }
+
+    _stateMachine->ProcessString(remaining);
 
     const til::point cursorPosAfter{ cursor.GetPosition() };
 
+#pragma warning(suppress : 26477 26485 26494 26482 26446) // We don't control TraceLoggingWrite
+    TraceLoggingWrite(g_hCTerminalCoreProvider,
+                      "TerminalWrite",
+                      TraceLoggingDescription("Output was written into the text buffer"),
+                      TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+                      TraceLoggingUInt64(stringView.size(), "Length"),
+                      TraceLoggingKeyword(TIL_KEYWORD_TRACE));
+
     // Firing the CursorPositionChanged event is very expensive so we try not to
     // do that when the cursor does not need to be redrawn.
     if (cursorPosBefore != cursorPosAfter)
@@ -497,12 +521,141 @@ void Terminal::Write(std::wstring_view stringView)
     }
 }
 
+// Method Description:
+// - Returns the length of the leading part of the given output whose text is guaranteed to be scrolled out of
+//   the buffer by the rest of the output, because the latter contains more line feeds than the buffer has rows
+//   (plus a viewport's worth, in case the cursor isn't at the bottom yet). To ensure that nothing but the text
+//   itself is lost, the output must consist of nothing but text, CR, LF, TAB, BS, BEL and SGR sequences.
+//   Anything else (cursor positioning, erasing, OSCs, etc.) could keep rows alive or change other state.
+// Arguments:
+// - str: The output that's about to be written.
+// Return Value:
+// - The number of characters that can be fast-forwarded with _fastForwardPrefix(), or 0.
+size_t Terminal::_fastForwardLength(const std::wstring_view str) const noexcept
+{
+    const auto& buffer = _activeBuffer();
+    const auto required = gsl::narrow_cast<size_t>(buffer.GetSize().Height()) + gsl::narrow_cast<size_t>(_GetMutableViewport().Height());
+
+    // Every line feed takes at least 1 character, so small writes can be rejected without looking at them.
+    if (str.size() <= required ||
+        !_stateMachine->IsInGroundState() ||
+        !_stateMachine->GetParserMode(StateMachine::Mode::Ansi))
+    {
+        return 0;
+    }
+
+    const auto& engine = reinterpret_cast<const OutputStateMachineEngine&>(_stateMachine->Engine());
+    if (static_cast<const AdaptDispatch&>(engine.Dispatch()).AreScrollMarginsSet())
+    {
+        return 0;
+    }
+
+    // Count the line feeds up to the first character we can't guarantee to be safe to skip.
+    // Everything past the last line feed before it doesn't matter, as it's never skipped.
+    const auto beg = str.data();
+    const auto end = beg + str.size();
+    size_t lineFeeds = 0;
+
+    for (auto it = beg; it != end; ++it)
+    {
+        const auto ch = *it;
+        if (ch == L'\n')
+        {
+            lineFeeds++;
+        }
+        else if (ch == L'\x1b')
+        {
+            // Only accept SGR sequences: ESC [ followed by parameters and terminated by m.
+            auto seq = it + 1;
+            if (seq == end || *seq != L'[')
+            {
+                break;
+            }
+            for (++seq; seq != end && ((*seq >= L'0' && *seq <= L'9') || *seq == L';' || *seq == L':'); ++seq)
+            {
+            }
+            if (seq == end || *seq != L'm')
+            {
+                break;
+            }
+            it = seq;
+        }
+        else if (ch < L' ' && ch != L'\r' && ch != L'\t' && ch != L'\b' && ch != L'\a')
+        {
+            break;
+        }
+        else if (ch >= 0x80 && ch < 0xA0)
+        {
+            // C1 controls
+            break;
+        }
+    }
+
+    if (lineFeeds <= required)
+    {
+        return 0;
+    }
+
+    // Find the last CR LF pair, after which at least `required` line feeds follow. Cutting after
+    // a CR LF ensures that the cursor is in the first column no matter what text preceded it.
+    const auto maxSkippedLineFeeds = lineFeeds - required;
+    size_t skip = 0;
+    lineFeeds = 0;
+
+    for (auto it = beg; it != end && lineFeeds < maxSkippedLineFeeds; ++it)
+    {
+        if (*it == L'\n')
+        {
+            lineFeeds++;
+            if (it != beg && it[-1] == L'\r')
+            {
+                skip = gsl::narrow_cast<size_t>(it - beg) + 1;
+            }
+        }
+    }
+
+    return skip;
+}
+
+// Method Description:
+// - Strips the text from output that was accepted by _fastForwardLength(). Only the
+//   line feeds (so that the buffer scrolls just as much as before), SGR sequences
+//   (so that the attributes of the remaining text are correct) and BELs are kept.
+// Arguments:
+// - prefix: The output to strip.
+// Return Value:
+// - The stripped output. It's valid until the next call.
+std::wstring_view Terminal::_fastForwardPrefix(const std::wstring_view prefix)
+{
+    _fastForwardBuffer.clear();
+
+    for (size_t i = 0; i < prefix.size(); ++i)
+    {
+        const auto ch = til::at(prefix, i);
+        if (ch == L'\r' || ch == L'\n' || ch == L'\a')
+        {
+            _fastForwardBuffer.push_back(ch);
+        }
+        else if (ch == L'\x1b')
+        {
+            // _fastForwardLength() ensured that this is a complete SGR sequence.
+            const auto m = prefix.find(L'm', i);
+            _fastForwardBuffer.append(prefix.substr(i, m - i + 1));
+            i = m;
+        }
+    }
+
+    return _fastForwardBuffer;
+}
+
 void Terminal::WritePastedText(std::wstring_view stringView)
 {
     const auto option = ::Microsoft::Console::Utils::FilterOption::CarriageReturnNewline |
                         ::Microsoft::Console::Utils::FilterOption::ControlCodes;
 
     auto filtered = ::Microsoft::Console::Utils::FilterStringForPaste(stringView, option);
+    // Pasted text mustn't be able to smuggle in binary input records. The marker is a noncharacter anyway.
+    std::erase(filtered, ::Microsoft::Console::BinaryInput::RecordMarker);
     if (IsXtermBracketedPasteModeEnabled())
     {
         filtered.insert(0, L"\x1b[200~");
@@ -633,7 +786,44 @@ std::wstring Terminal::GetHyperlinkAtBufferPosition(const til::point bufferPos)
 // - The hyperlink ID
 uint16_t Terminal::GetHyperlinkIdAtViewportPosition(const til::point viewportPos)
 {
-    return _activeBuffer().GetCellDataAt(_ConvertToBufferCell(viewportPos))->TextAttr().GetHyperlinkId();
+    // This is called for every cell the pointer moves over, so we read the attribute
+    // straight from the row instead of constructing a whole cell iterator for it.
+    const auto bufferPos = _ConvertToBufferCell(viewportPos);
+    return _activeBuffer().GetRowByOffset(bufferPos.y).GetAttrByColumn(bufferPos.x).GetHyperlinkId();
+}
+
+// Method Description:
+// - Invalidates the cells whose hover underline depends on the given hyperlink,
+//   after the pointer moved onto or away from it. Instead of repainting the
+//   entire viewport, only the rows that actually contain it are invalidated.
+// Arguments:
+// - id - The ID of an OSC 8 hyperlink or 0. All of its cells in the viewport are invalidated.
+// - interval - The position of an auto-detected hyperlink, relative to the viewport.
+void Terminal::InvalidateHyperlink(const uint16_t id, const std::optional<PointTree::interval>& interval)
+{
+    const auto vis = _VisibleStartIndex();
+
+    if (interval.has_value())
+    {
+        _InvalidateFromCoords({ interval->start.x, interval->start.y + vis }, { interval->stop.x, interval->stop.y + vis });
+    }
+
+    if (id != 0)
+    {
+        auto& buffer = _activeBuffer();
+        const auto width = buffer.GetSize().Width();
+        const auto end = std::min(_VisibleEndIndex(), buffer.GetSize().BottomInclusive());
+
+        for (auto y = vis; y <= end; ++y)
+        {
+            // Rows store their attributes run-length encoded, so this is only a handful of runs per row.
+            const auto& runs = buffer.GetRowByOffset(y).Attributes().runs();
+            if (std::any_of(runs.begin(), runs.end(), [&](const auto& run) { return run.value.GetHyperlinkId() == id; }))
+            {
+                buffer.TriggerRedraw(Viewport::FromDimensions({ 0, y }, { width, 1 }));
+            }
+        }
+    }
 }
 
 // Method description:
@@ -992,12 +1182,31 @@ WORD Terminal::_TakeVirtualKeyFromLastKeyEvent(const WORD scanCode) noexcept
 
 // Method Description:
 // - Acquire a read lock on the terminal.
+// - This is an exclusive lock nonetheless, because reading the buffer isn't free
+//   of side effects: Rows are thawed and reflowed lazily when they're first
+//   accessed and the TextBuffer caches pattern and delimiter lookups.
+// Return Value:
+// - a unique_lock which can be used to unlock the terminal. The unique_lock
+//      will release this lock when it's destructed.
+[[nodiscard]] std::unique_lock<InstrumentedLock> Terminal::LockForReading(const LockSite site)
+{
+    _readWriteLock.lock(site);
+    return std::unique_lock{ _readWriteLock, std::adopt_lock };
+}
+
+// Method Description:
+// - Acquire a shared read lock on the terminal, which other readers can hold at
+//   the same time. Writers take precedence over readers that are still waiting.
+// - Only use this for state that is actually read-only, like the cursor position,
+//   the viewport or the selection anchors. Anything that accesses rows of the
+//   text buffer needs LockForReading() instead.
 // Return Value:
 // - a shared_lock which can be used to unlock the terminal. The shared_lock
 //      will release this lock when it's destructed.
-[[nodiscard]] std::unique_lock<til::recursive_ticket_lock> Terminal::LockForReading()
+[[nodiscard]] std::shared_lock<InstrumentedLock> Terminal::LockForSharedReading(const LockSite site)
 {
-    return std::unique_lock{ _readWriteLock };
+    _readWriteLock.lock_shared(site);
+    return std::shared_lock{ _readWriteLock, std::adopt_lock };
 }
 
 // Method Description:
@@ -1005,20 +1214,95 @@ WORD Terminal::_TakeVirtualKeyFromLastKeyEvent(const WORD scanCode) noexcept
 // Return Value:
 // - a unique_lock which can be used to unlock the terminal. The unique_lock
 //      will release this lock when it's destructed.
-[[nodiscard]] std::unique_lock<til::recursive_ticket_lock> Terminal::LockForWriting()
+[[nodiscard]] std::unique_lock<InstrumentedLock> Terminal::LockForWriting(const LockSite site)
+{
+    _readWriteLock.lock(site);
+    return std::unique_lock{ _readWriteLock, std::adopt_lock };
+}
+
+// Method Description:
+// - Acquire a write lock on the terminal, but only if no other thread holds it.
+// Return Value:
+// - a unique_lock which can be used to unlock the terminal. Its owns_lock()
+//      will be false if the lock couldn't be acquired immediately.
+[[nodiscard]] std::unique_lock<InstrumentedLock> Terminal::TryLockForWriting(const LockSite site)
 {
-    return std::unique_lock{ _readWriteLock };
+    if (_readWriteLock.try_lock(site))
+    {
+        return std::unique_lock{ _readWriteLock, std::adopt_lock };
+    }
+    return std::unique_lock{ _readWriteLock, std::defer_lock };
 }
 
 // Method Description:
-// - Get a reference to the terminal's read/write lock.
+// - Temporarily releases the terminal lock held by the current thread.
 // Return Value:
-// - a ticket_lock which can be used to manually lock or unlock the terminal.
-til::recursive_ticket_lock_suspension Terminal::SuspendLock() noexcept
+// - a suspension which reacquires the lock when it's destructed.
+InstrumentedLock::Suspension Terminal::SuspendLock() noexcept
 {
     return _readWriteLock.suspend();
 }
 
+// Method Description:
+// - Enables or disables recording how long each call site waits for and holds the
+//   terminal lock. This is also implicitly enabled while a verbose ETW trace is running.
+void Terminal::EnableLockInstrumentation(const bool enable) noexcept
+{
+    _readWriteLock.EnableInstrumentation(enable);
+}
+
+// Method Description:
+// - Tells us which thread is the render thread, so that LockConsole() calls
+//   coming from the renderer can be told apart from those coming from UIA.
+void Terminal::SetRenderThreadId(const DWORD threadId) noexcept
+{
+    _renderThreadId.store(threadId, std::memory_order_relaxed);
+}
+
+// Method Description:
+// - Returns the lock statistics recorded since the last call and resets them.
+InstrumentedLock::Snapshot Terminal::TakeLockSnapshot() noexcept
+{
+    return _readWriteLock.TakeSnapshot();
+}
+
+// Method Description:
+// - Returns the total time spent waiting for the terminal lock while the lock
+//   instrumentation was enabled. It's never reset, so callers compute deltas.
+uint64_t Terminal::LockWaitMicroseconds() const noexcept
+{
+    return _readWriteLock.TotalWaitMicroseconds();
+}
+
+// Method Description:
+// - Returns the combined memory usage of all text buffers: the main one, the alternate
+//   one if it's active and the spare alternate buffer kept around for reuse.
+TextBuffer::MemoryUsage Terminal::GetMemoryUsage() const noexcept
+{
+    auto usage = _mainBuffer->GetMemoryUsage();
+    for (const auto buffer : { _altBuffer.get(), _spareAltBuffer.get() })
+    {
+        if (buffer)
+        {
+            usage += buffer->GetMemoryUsage();
+        }
+    }
+    return usage;
+}
+
+// Method Description:
+// - Gives back as much memory as possible without losing any contents. See TextBuffer::TrimMemory().
+//   The spare alternate buffer is freed, since it's only kept to make entering the alternate screen cheaper.
+void Terminal::TrimMemory() noexcept
+{
+    _spareAltBuffer.reset();
+    _mainBuffer->TrimMemory();
+    if (_altBuffer)
+    {
+        _altBuffer->TrimMemory();
+    }
+}
+
 Viewport Terminal::_GetMutableViewport() const noexcept
 {
     // GH#3493: if we're in the alt buffer, then it's possible that the mutable
@@ -1238,6 +1522,69 @@ void Terminal::ClearPatternTree()
     _InvalidatePatternTree(oldTree);
 }
 
+// Method Description:
+// - Updates the snapshot with the contents of the main buffer. The alt buffer isn't
+//   persisted, since the application that uses it won't be around after a restore.
+// - The write lock should be held when calling this method, because the rows
+//   that changed since the last snapshot need to be thawed to be read.
+void Terminal::PersistMainBuffer(BufferSnapshot& snapshot) const
+{
+    snapshot.Write(*_mainBuffer);
+}
+
+// Method Description:
+// - Restores a snapshot written by PersistMainBuffer() into the main buffer and
+//   scrolls the viewport down, so that the restored cursor position is in view.
+// - The write lock should be held when calling this method.
+void Terminal::RestoreMainBuffer(const std::filesystem::path& path)
+{
+    const auto cursor = BufferSnapshot::Restore(path, *_mainBuffer);
+    _mainBuffer->GetCursor().SetPosition(cursor);
+
+    const auto viewportTop = std::max(0, cursor.y - _mutableViewport.Height() + 1);
+    _mutableViewport = Viewport::FromDimensions({ 0, viewportTop }, _mutableViewport.Dimensions());
+    _NotifyScrollEvent();
+}
+
+// Method Description:
+// - Returns the index of all search matches, if there's one. See ControlCore::SearchAll().
+SearchIndex* Terminal::GetSearchIndex() noexcept
+{
+    return _searchIndex.get();
+}
+
+// Method Description:
+// - Replaces the index of all search matches. Pass nullptr to stop maintaining one.
+void Terminal::SetSearchIndex(std::unique_ptr<SearchIndex> index) noexcept
+{
+    _searchIndex = std::move(index);
+}
+
+// Method Description:
+// - Brings the index of all search matches up to date with the active buffer.
+//   Only the rows that changed since the last call are scanned again.
+// Arguments:
+// - maxRows: the maximum number of rows to scan before returning, so that the
+//   caller can release the lock in between.
+// Return Value:
+// - true if the index is complete (or if there's none).
+bool Terminal::UpdateSearchIndexUnderLock(const til::CoordType maxRows)
+{
+    return !_searchIndex || _searchIndex->Update(_activeBuffer(), maxRows);
+}
+
+// Method Description:
+// - Reflows the part of the scrollback that UserResize() left pending (see TextBuffer::ReflowLazily()).
+// Arguments:
+// - maxRows: the number of rows to reflow before returning, so that the
+//   caller can release the lock in between.
+// Return Value:
+// - true if the main buffer is fully reflowed.
+bool Terminal::FinishPendingReflowUnderLock(const til::CoordType maxRows) noexcept
+{
+    return _mainBuffer->FinishPendingReflow(maxRows);
+}
+
 // Method Description:
 // - Returns the tab color
 // If the starting color exists, its value is preferred
@@ -1372,14 +1719,24 @@ void Terminal::AddMark(const Microsoft::Console::VirtualTerminal::DispatchTypes:
     DispatchTypes::ScrollMark m = mark;
     m.start = start;
     m.end = end;
-
-    if (fromUi)
+    _offsetScrollMark(m, _scrollMarksOffset);
+
+    // Marks with the same start stay in the order they were added in. Since the output only ever
+    // moves down, VT marks usually end up at the back, which makes this a cheap append.
+    const auto it = std::upper_bound(_scrollMarks.begin(), _scrollMarks.end(), m.start, [](const til::point& pos, const DispatchTypes::ScrollMark& other) {
+        return pos < other.start;
+    });
+    const auto index = gsl::narrow_cast<size_t>(it - _scrollMarks.begin());
+    _scrollMarks.insert(it, m);
+    _scrollMarksViewDirty = true;
+
+    if (!fromUi)
     {
-        _scrollMarks.insert(_scrollMarks.begin(), m);
+        _currentScrollMark = index;
     }
-    else
+    else if (_currentScrollMark != NoScrollMark && _currentScrollMark >= index)
     {
-        _scrollMarks.push_back(m);
+        _currentScrollMark++;
     }
 
     // Tell the control that the scrollbar has somehow changed. Used as a
@@ -1404,15 +1761,35 @@ void Terminal::ClearMark()
         start = til::point{ GetSelectionAnchor() };
         end = til::point{ GetSelectionEnd() };
     }
+    start.y += _scrollMarksOffset;
+    end.y += _scrollMarksOffset;
     auto inSelection = [&start, &end](const DispatchTypes::ScrollMark& m) {
         return (m.start >= start && m.start <= end) ||
                (m.end >= start && m.end <= end);
     };
 
-    _scrollMarks.erase(std::remove_if(_scrollMarks.begin(),
-                                      _scrollMarks.end(),
-                                      inSelection),
-                       _scrollMarks.end());
+    // Same as std::remove_if, but keeps track of where the current mark moved to.
+    size_t kept = 0;
+    auto current = NoScrollMark;
+    for (size_t i = 0; i < _scrollMarks.size(); ++i)
+    {
+        if (inSelection(_scrollMarks[i]))
+        {
+            continue;
+        }
+        if (i == _currentScrollMark)
+        {
+            current = kept;
+        }
+        if (kept != i)
+        {
+            _scrollMarks[kept] = std::move(_scrollMarks[i]);
+        }
+        ++kept;
+    }
+    _scrollMarks.resize(kept);
+    _currentScrollMark = current;
+    _scrollMarksViewDirty = true;
 
     // Tell the control that the scrollbar has somehow changed. Used as a
     // workaround to force the control to redraw any scrollbar marks
@@ -1421,19 +1798,141 @@ void Terminal::ClearMark()
 void Terminal::ClearAllMarks() noexcept
 {
     _scrollMarks.clear();
+    _scrollMarksView.clear();
+    _scrollMarksViewDirty = false;
+    _currentScrollMark = NoScrollMark;
     // Tell the control that the scrollbar has somehow changed. Used as a
     // workaround to force the control to redraw any scrollbar marks
     _NotifyScrollEvent();
 }
 
-const std::vector<DispatchTypes::ScrollMark>& Terminal::GetScrollMarks() const noexcept
+// Method Description:
+// - Returns all marks in buffer coordinates, sorted by their start.
+const std::vector<DispatchTypes::ScrollMark>& Terminal::GetScrollMarks() const
 {
     // TODO: GH#11000 - when the marks are stored per-buffer, get rid of this.
     // We want to return _no_ marks when we're in the alt buffer, to effectively
     // hide them. We need to return a reference, so we can't just ctor an empty
     // list here just for when we're in the alt buffer.
     static const std::vector<DispatchTypes::ScrollMark> _altBufferMarks{};
-    return _inAltBuffer() ? _altBufferMarks : _scrollMarks;
+    if (_inAltBuffer())
+    {
+        return _altBufferMarks;
+    }
+
+    if (_scrollMarksViewDirty)
+    {
+        _scrollMarksView.assign(_scrollMarks.begin(), _scrollMarks.end());
+        for (auto& m : _scrollMarksView)
+        {
+            _offsetScrollMark(m, -_scrollMarksOffset);
+        }
+        _scrollMarksViewDirty = false;
+    }
+
+    return _scrollMarksView;
+}
+
+// Method Description:
+// - Returns the marks that start within the given range of rows (bottom is exclusive).
+std::span<const DispatchTypes::ScrollMark> Terminal::GetScrollMarks(const til::CoordType top, const til::CoordType bottom) const
+{
+    const auto& marks = GetScrollMarks();
+    const auto beg = std::lower_bound(marks.begin(), marks.end(), top, [](const DispatchTypes::ScrollMark& m, const til::CoordType y) {
+        return m.start.y < y;
+    });
+    const auto end = std::lower_bound(beg, marks.end(), bottom, [](const DispatchTypes::ScrollMark& m, const til::CoordType y) {
+        return m.start.y < y;
+    });
+    return { beg, end };
+}
+
+// Method Description:
+// - Returns the command blocks whose prompt starts within the given range of rows (bottom is exclusive).
+std::vector<Terminal::CommandBlock> Terminal::GetCommandBlocks(const til::CoordType top, const til::CoordType bottom) const
+{
+    std::vector<CommandBlock> blocks;
+    for (const auto& mark : GetScrollMarks(top, bottom))
+    {
+        if (mark.category != DispatchTypes::MarkCategory::Info)
+        {
+            blocks.emplace_back(_commandBlockFromMark(mark));
+        }
+    }
+    return blocks;
+}
+
+// Method Description:
+// - Returns the most recent command block that has an output, i.e. the last command the shell finished running.
+// - Since the marks are sorted, this only looks at the last few of them, no matter how long the session is.
+std::optional<Terminal::CommandBlock> Terminal::GetLastCommandBlock() const
+{
+    const auto& marks = GetScrollMarks();
+    for (auto it = marks.rbegin(); it != marks.rend(); ++it)
+    {
+        if (it->category != DispatchTypes::MarkCategory::Info && it->HasOutput())
+        {
+            return _commandBlockFromMark(*it);
+        }
+    }
+    return std::nullopt;
+}
+
+// Method Description:
+// - Returns the text within the given span of a command block, with CRLFs between the lines.
+// - Only the rows of the span are serialized, just like when copying a selection.
+std::wstring Terminal::GetCommandBlockText(const til::point_span& span) const
+{
+    if (span.start >= span.end)
+    {
+        return {};
+    }
+
+    const auto& buffer = _activeBuffer();
+    auto end = span.end;
+    buffer.GetSize().DecrementInBounds(end);
+
+    const auto rects = buffer.GetTextRects(span.start, end, false, true);
+    TextBuffer::CopyRequest req{
+        .selectionRects = rects,
+        .includeCRLF = true,
+        .trimTrailingWhitespace = true,
+    };
+    return buffer.GetPlainText(req);
+}
+
+Terminal::CommandBlock Terminal::_commandBlockFromMark(const DispatchTypes::ScrollMark& mark) noexcept
+{
+    const auto commandEnd = mark.commandEnd.value_or(mark.end);
+    const auto outputEnd = mark.outputEnd.value_or(commandEnd);
+
+    CommandBlock block;
+    block.prompt = { mark.start, mark.end };
+    block.command = { block.prompt.end, commandEnd };
+    block.output = { commandEnd, outputEnd };
+    block.exitCode = mark.exitCode;
+    return block;
+}
+
+void Terminal::_offsetScrollMark(DispatchTypes::ScrollMark& mark, const til::CoordType dy) noexcept
+{
+    mark.start.y += dy;
+    mark.end.y += dy;
+    if (mark.commandEnd)
+    {
+        mark.commandEnd->y += dy;
+    }
+    if (mark.outputEnd)
+    {
+        mark.outputEnd->y += dy;
+    }
+}
+
+// Returns the mark that the FTCS sequences (MarkCommandStart(), etc.) amend, if it still exists.
+DispatchTypes::ScrollMark* Terminal::_currentMark() noexcept
+{
+    _scrollMarksViewDirty = true;
+    return _currentScrollMark < _scrollMarks.size() ? &til::at(_scrollMarks, _currentScrollMark) : nullptr;
 }
 
 til::color Terminal::GetColorForMark(const Microsoft::Console::VirtualTerminal::DispatchTypes::ScrollMark& mark) const
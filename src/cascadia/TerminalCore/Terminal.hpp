@@ -7,6 +7,8 @@
 
 #include "../../inc/DefaultSettings.h"
 #include "../../buffer/out/textBuffer.hpp"
+#include "../../buffer/out/BufferSnapshot.hpp"
+#include "../../buffer/out/SearchIndex.hpp"
 #include "../../renderer/inc/IRenderData.hpp"
 #include "../../terminal/adapter/ITerminalApi.hpp"
 #include "../../terminal/parser/StateMachine.hpp"
@@ -15,9 +17,8 @@
 #include "../../types/inc/GlyphWidth.hpp"
 #include "../../cascadia/terminalcore/ITerminalInput.hpp"
 
-#include <til/ticket_lock.h>
+#include "LockInstrumentation.hpp"
 
-inline constexpr std::wstring_view linkPattern{ LR"(\b(https?|ftp|file)://[-A-Za-z0-9+&@#/%?=~_|$!:,.;]*[A-Za-z0-9+&@#/%=~_|$])" };
 inline constexpr size_t TaskbarMinProgress{ 10 };
 
 // You have to forward decl the ICoreSettings here, instead of including the header.
@@ -49,6 +50,7 @@ namespace TerminalCoreUnitTests
     class TerminalApiTest;
     class ConptyRoundtripTests;
     class ScrollTest;
+    class SelectionTest;
 };
 #endif
 
@@ -85,9 +87,19 @@ public:
     // WritePastedText comes from our input and goes back to the PTY's input channel
     void WritePastedText(std::wstring_view stringView);
 
-    [[nodiscard]] std::unique_lock<til::recursive_ticket_lock> LockForReading();
-    [[nodiscard]] std::unique_lock<til::recursive_ticket_lock> LockForWriting();
-    til::recursive_ticket_lock_suspension SuspendLock() noexcept;
+    [[nodiscard]] std::unique_lock<Microsoft::Terminal::Core::InstrumentedLock> LockForReading(Microsoft::Terminal::Core::LockSite site = Microsoft::Terminal::Core::LockSite::Other);
+    [[nodiscard]] std::shared_lock<Microsoft::Terminal::Core::InstrumentedLock> LockForSharedReading(Microsoft::Terminal::Core::LockSite site = Microsoft::Terminal::Core::LockSite::Other);
+    [[nodiscard]] std::unique_lock<Microsoft::Terminal::Core::InstrumentedLock> LockForWriting(Microsoft::Terminal::Core::LockSite site = Microsoft::Terminal::Core::LockSite::Other);
+    [[nodiscard]] std::unique_lock<Microsoft::Terminal::Core::InstrumentedLock> TryLockForWriting(Microsoft::Terminal::Core::LockSite site = Microsoft::Terminal::Core::LockSite::Other);
+    Microsoft::Terminal::Core::InstrumentedLock::Suspension SuspendLock() noexcept;
+
+    void EnableLockInstrumentation(bool enable) noexcept;
+    void SetRenderThreadId(DWORD threadId) noexcept;
+    Microsoft::Terminal::Core::InstrumentedLock::Snapshot TakeLockSnapshot() noexcept;
+    uint64_t LockWaitMicroseconds() const noexcept;
+
+    TextBuffer::MemoryUsage GetMemoryUsage() const noexcept;
+    void TrimMemory() noexcept;
 
     til::CoordType GetBufferHeight() const noexcept;
 
@@ -97,7 +109,22 @@ public:
     RenderSettings& GetRenderSettings() noexcept { return _renderSettings; };
     const RenderSettings& GetRenderSettings() const noexcept { return _renderSettings; };
 
-    const std::vector<Microsoft::Console::VirtualTerminal::DispatchTypes::ScrollMark>& GetScrollMarks() const noexcept;
+    const std::vector<Microsoft::Console::VirtualTerminal::DispatchTypes::ScrollMark>& GetScrollMarks() const;
+    std::span<const Microsoft::Console::VirtualTerminal::DispatchTypes::ScrollMark> GetScrollMarks(til::CoordType top, til::CoordType bottom) const;
+
+    // A command and its output, as delimited by the FTCS marks of its prompt. All spans are in buffer
+    // coordinates with an exclusive end. The command and output spans are empty if the shell didn't
+    // report them (yet). Blocks whose prompt was rotated out of the buffer are gone with their mark.
+    struct CommandBlock
+    {
+        til::point_span prompt;
+        til::point_span command;
+        til::point_span output;
+        std::optional<unsigned int> exitCode;
+    };
+    std::vector<CommandBlock> GetCommandBlocks(til::CoordType top, til::CoordType bottom) const;
+    std::optional<CommandBlock> GetLastCommandBlock() const;
+    std::wstring GetCommandBlockText(const til::point_span& span) const;
     void AddMark(const Microsoft::Console::VirtualTerminal::DispatchTypes::ScrollMark& mark,
                  const til::point& start,
                  const til::point& end,
@@ -165,6 +192,7 @@ public:
     std::wstring GetHyperlinkAtBufferPosition(const til::point bufferPos);
     uint16_t GetHyperlinkIdAtViewportPosition(const til::point viewportPos);
     std::optional<interval_tree::IntervalTree<til::point, size_t>::interval> GetHyperlinkIntervalFromViewportPosition(const til::point viewportPos);
+    void InvalidateHyperlink(const uint16_t id, const std::optional<interval_tree::IntervalTree<til::point, size_t>::interval>& interval);
 #pragma endregion
 
 #pragma region IRenderData
@@ -188,7 +216,7 @@ public:
     const bool IsGridLineDrawingAllowed() noexcept override;
     const std::wstring GetHyperlinkUri(uint16_t id) const override;
     const std::wstring GetHyperlinkCustomId(uint16_t id) const override;
-    const std::vector<size_t> GetPatternId(const til::point location) const override;
+    void GetPatternId(const til::point location, std::vector<size_t>& ids) const override;
 
     std::pair<COLORREF, COLORREF> GetAttributeColors(const TextAttribute& attr) const noexcept override;
     std::vector<Microsoft::Console::Types::Viewport> GetSelectionRects() noexcept override;
@@ -219,6 +247,14 @@ public:
     void UpdatePatternsUnderLock();
     void ClearPatternTree();
 
+    void PersistMainBuffer(BufferSnapshot& snapshot) const;
+    void RestoreMainBuffer(const std::filesystem::path& path);
+
+    SearchIndex* GetSearchIndex() noexcept;
+    void SetSearchIndex(std::unique_ptr<SearchIndex> index) noexcept;
+    bool UpdateSearchIndexUnderLock(const til::CoordType maxRows);
+    bool FinishPendingReflowUnderLock(const til::CoordType maxRows) noexcept;
+
     const std::optional<til::color> GetTabColor() const;
 
     winrt::Microsoft::Terminal::Core::Scheme GetColorScheme() const;
@@ -288,6 +324,33 @@ public:
     const SelectionEndpoint SelectionEndpointTarget() const noexcept;
 
     const TextBuffer::TextAndColor RetrieveSelectedTextFromBuffer(bool trimTrailingWhitespace);
+
+    struct SelectionForClipboard
+    {
+        std::wstring plain;
+        std::string html;
+        std::string rtf;
+    };
+    SelectionForClipboard RetrieveSelectionForClipboard(bool singleLine, bool html, bool rtf, int fontHeightPoints, std::wstring_view fontFaceName);
+
+    // A copy of the selection, which can be turned into the clipboard formats without holding the lock.
+    struct SelectionSnapshot
+    {
+        std::wstring PlainText() const;
+        std::string Html(int fontHeightPoints, std::wstring_view fontFaceName) const;
+        std::string Rtf(int fontHeightPoints, std::wstring_view fontFaceName) const;
+
+        std::unique_ptr<TextBuffer> buffer;
+        std::vector<til::inclusive_rect> rects;
+        RenderSettings renderSettings;
+        bool includeCRLF = false;
+        bool trimTrailingWhitespace = false;
+        bool formatWrappedRows = false;
+
+    private:
+        TextBuffer::CopyRequest _request() const noexcept;
+    };
+    SelectionSnapshot SnapshotSelection(bool singleLine);
 #pragma endregion
 
 private:
@@ -302,7 +365,9 @@ private:
     //
     // But we can abuse the fact that the surrounding members rarely change and are huge
     // (std::function is like 64 bytes) to create some natural padding without wasting space.
-    til::recursive_ticket_lock _readWriteLock;
+    Microsoft::Terminal::Core::InstrumentedLock _readWriteLock;
+    // LockConsole() calls on this thread are attributed to LockSite::Renderer, all others to LockSite::Uia.
+    std::atomic<DWORD> _renderThreadId{ 0 };
 
     std::function<void(const int, const int, const int)> _pfnScrollPositionChanged;
     std::function<void()> _pfnCursorPositionChanged;
@@ -351,6 +416,7 @@ private:
     std::optional<SelectionAnchors> _selection;
     bool _blockSelection = false;
     std::wstring _wordDelimiters;
+    std::wstring _fastForwardBuffer;
     SelectionExpansion _multiClickSelectionMode = SelectionExpansion::Char;
     SelectionInteractionMode _selectionMode = SelectionInteractionMode::None;
     bool _selectionIsTargetingUrl = false;
@@ -358,8 +424,12 @@ private:
     bool _anchorInactiveSelectionEndpoint = false;
 #pragma endregion
 
-    std::unique_ptr<TextBuffer> _mainBuffer;
+    // Shared, since after a resize the new buffer holds on to the old one until it's done reflowing it.
+    // See TextBuffer::ReflowLazily().
+    std::shared_ptr<TextBuffer> _mainBuffer;
     std::unique_ptr<TextBuffer> _altBuffer;
+    // The alt buffer that was last left, kept around to be recycled by the next UseAlternateScreenBuffer().
+    std::unique_ptr<TextBuffer> _spareAltBuffer;
     Microsoft::Console::Types::Viewport _mutableViewport;
     til::CoordType _scrollbackLines = 0;
     bool _detectURLs = false;
@@ -384,6 +454,7 @@ private:
     //      Either way, we should make this behavior controlled by a setting.
 
     interval_tree::IntervalTree<til::point, size_t> _patternIntervalTree;
+    std::unique_ptr<SearchIndex> _searchIndex;
     void _InvalidatePatternTree(const interval_tree::IntervalTree<til::point, size_t>& tree);
     void _InvalidateFromCoords(const til::point start, const til::point end);
 
@@ -395,7 +466,15 @@ private:
     };
     std::optional<KeyEventCodes> _lastKeyEventCodes;
 
+    // The marks are sorted by their start. Their coordinates are stored offset by _scrollMarksOffset, the number
+    // of rows the buffer has been rotated by, so that NotifyBufferRotation() doesn't need to touch each of them.
+    // _scrollMarksView holds them in buffer coordinates and is rebuilt on demand by GetScrollMarks().
+    static constexpr size_t NoScrollMark = SIZE_MAX;
     std::vector<Microsoft::Console::VirtualTerminal::DispatchTypes::ScrollMark> _scrollMarks;
+    til::CoordType _scrollMarksOffset = 0;
+    size_t _currentScrollMark = NoScrollMark; // The last mark added via VT, which the FTCS sequences amend.
+    mutable std::vector<Microsoft::Console::VirtualTerminal::DispatchTypes::ScrollMark> _scrollMarksView;
+    mutable bool _scrollMarksViewDirty = false;
     enum class PromptState : uint32_t
     {
         None = 0,
@@ -425,6 +504,13 @@ private:
 
     void _NotifyTerminalCursorPositionChanged() noexcept;
 
+    static CommandBlock _commandBlockFromMark(const Microsoft::Console::VirtualTerminal::DispatchTypes::ScrollMark& mark) noexcept;
+    static void _offsetScrollMark(Microsoft::Console::VirtualTerminal::DispatchTypes::ScrollMark& mark, til::CoordType dy) noexcept;
+    Microsoft::Console::VirtualTerminal::DispatchTypes::ScrollMark* _currentMark() noexcept;
+
+    size_t _fastForwardLength(std::wstring_view str) const noexcept;
+    std::wstring_view _fastForwardPrefix(std::wstring_view prefix);
+
     bool _inAltBuffer() const noexcept;
     TextBuffer& _activeBuffer() const noexcept;
     void _updateUrlDetection();
@@ -448,5 +534,6 @@ private:
     friend class TerminalCoreUnitTests::TerminalApiTest;
     friend class TerminalCoreUnitTests::ConptyRoundtripTests;
     friend class TerminalCoreUnitTests::ScrollTest;
+    friend class TerminalCoreUnitTests::SelectionTest;
 #endif
 };
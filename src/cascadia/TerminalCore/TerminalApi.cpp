@@ -212,12 +212,21 @@ void Terminal::UseAlternateScreenBuffer()
     ClearSelection();
     _mainBuffer->ClearPatternRecognizers();
 
-    // Create a new alt buffer
-    _altBuffer = std::make_unique<TextBuffer>(_altBufferSize,
-                                              TextAttribute{},
-                                              cursorSize,
-                                              true,
-                                              _mainBuffer->GetRenderer());
+    // Reuse the alt buffer we had last time, or create a new one
+    if (_spareAltBuffer)
+    {
+        _spareAltBuffer->Recycle(_altBufferSize, TextAttribute{}, cursorSize);
+        _spareAltBuffer->SetAsActiveBuffer(true);
+        _altBuffer = std::move(_spareAltBuffer);
+    }
+    else
+    {
+        _altBuffer = std::make_unique<TextBuffer>(_altBufferSize,
+                                                  TextAttribute{},
+                                                  cursorSize,
+                                                  true,
+                                                  _mainBuffer->GetRenderer());
+    }
     _mainBuffer->SetAsActiveBuffer(false);
 
     // Copy our cursor state to the new buffer's cursor
@@ -279,8 +288,9 @@ void Terminal::UseMainScreenBuffer()
     }
 
     _mainBuffer->SetAsActiveBuffer(true);
-    // destroy the alt buffer
-    _altBuffer = nullptr;
+    // Keep the alt buffer for the next time an application switches to it.
+    _altBuffer->SetAsActiveBuffer(false);
+    _spareAltBuffer = std::move(_altBuffer);
 
     if (_deferredResize.has_value())
     {
@@ -335,9 +345,9 @@ void Terminal::MarkPrompt(const DispatchTypes::ScrollMark& mark)
 void Terminal::MarkCommandStart()
 {
     const til::point cursorPos{ _activeBuffer().GetCursor().GetPosition() };
+    auto current = _currentPromptState == PromptState::Prompt ? _currentMark() : nullptr;
 
-    if ((_currentPromptState == PromptState::Prompt) &&
-        (_scrollMarks.size() > 0))
+    if (current)
     {
         // We were in the right state, and there's a previous mark to work
         // with.
@@ -353,17 +363,21 @@ void Terminal::MarkCommandStart()
         DispatchTypes::ScrollMark mark;
         mark.category = DispatchTypes::MarkCategory::Prompt;
         AddMark(mark, cursorPos, cursorPos, false);
+        current = _currentMark();
+    }
+    if (current)
+    {
+        current->end = { cursorPos.x, cursorPos.y + _scrollMarksOffset };
     }
-    _scrollMarks.back().end = cursorPos;
     _currentPromptState = PromptState::Command;
 }
 
 void Terminal::MarkOutputStart()
 {
     const til::point cursorPos{ _activeBuffer().GetCursor().GetPosition() };
+    auto current = _currentPromptState == PromptState::Command ? _currentMark() : nullptr;
 
-    if ((_currentPromptState == PromptState::Command) &&
-        (_scrollMarks.size() > 0))
+    if (current)
     {
         // We were in the right state, and there's a previous mark to work
         // with.
@@ -379,8 +393,12 @@ void Terminal::MarkOutputStart()
         DispatchTypes::ScrollMark mark;
         mark.category = DispatchTypes::MarkCategory::Prompt;
         AddMark(mark, cursorPos, cursorPos, false);
+        current = _currentMark();
+    }
+    if (current)
+    {
+        current->commandEnd = til::point{ cursorPos.x, cursorPos.y + _scrollMarksOffset };
     }
-    _scrollMarks.back().commandEnd = cursorPos;
     _currentPromptState = PromptState::Output;
 }
 
@@ -395,8 +413,10 @@ void Terminal::MarkCommandFinish(std::optional<unsigned int> error)
                        DispatchTypes::MarkCategory::Error;
     }
 
-    if ((_currentPromptState == PromptState::Output) &&
-        (_scrollMarks.size() > 0))
+    const til::point markPos{ cursorPos.x, cursorPos.y + _scrollMarksOffset };
+    auto current = _currentPromptState == PromptState::Output ? _currentMark() : nullptr;
+
+    if (current)
     {
         // We were in the right state, and there's a previous mark to work
         // with.
@@ -413,10 +433,18 @@ void Terminal::MarkCommandFinish(std::optional<unsigned int> error)
         DispatchTypes::ScrollMark mark;
         mark.category = DispatchTypes::MarkCategory::Prompt;
         AddMark(mark, cursorPos, cursorPos, false);
-        _scrollMarks.back().commandEnd = cursorPos;
+        current = _currentMark();
+        if (current)
+        {
+            current->commandEnd = markPos;
+        }
+    }
+    if (current)
+    {
+        current->outputEnd = markPos;
+        current->exitCode = error;
+        current->category = category;
     }
-    _scrollMarks.back().outputEnd = cursorPos;
-    _scrollMarks.back().category = category;
     _currentPromptState = PromptState::None;
 }
 
@@ -478,26 +506,30 @@ void Terminal::NotifyBufferRotation(const int delta)
     const auto hasScrollMarks = _scrollMarks.size() > 0;
     if (hasScrollMarks)
     {
-        for (auto& mark : _scrollMarks)
+        // The marks are stored relative to _scrollMarksOffset, so moving them up only requires moving the offset.
+        _scrollMarksOffset += delta;
+        _scrollMarksViewDirty = true;
+
+        // Drop the marks that were rotated out of the buffer. Since they're sorted, they're all at the front.
+        const auto rotatedOut = std::lower_bound(_scrollMarks.begin(), _scrollMarks.end(), _scrollMarksOffset, [](const auto& m, const til::CoordType y) {
+            return m.start.y < y;
+        });
+        if (rotatedOut != _scrollMarks.begin())
         {
-            // Move the mark up
-            mark.start.y -= delta;
+            const auto count = gsl::narrow_cast<size_t>(rotatedOut - _scrollMarks.begin());
+            _scrollMarks.erase(_scrollMarks.begin(), rotatedOut);
+            _currentScrollMark = _currentScrollMark != NoScrollMark && _currentScrollMark >= count ? _currentScrollMark - count : NoScrollMark;
+        }
 
-            // If the mark had sub-regions, then move those pointers too
-            if (mark.commandEnd.has_value())
-            {
-                (*mark.commandEnd).y -= delta;
-            }
-            if (mark.outputEnd.has_value())
+        // Rebase the marks every now and then, so that the offset can't overflow in long-running sessions.
+        if (_scrollMarksOffset > 0x40000000)
+        {
+            for (auto& mark : _scrollMarks)
             {
-                (*mark.outputEnd).y -= delta;
+                _offsetScrollMark(mark, -_scrollMarksOffset);
             }
+            _scrollMarksOffset = 0;
         }
-
-        _scrollMarks.erase(std::remove_if(_scrollMarks.begin(),
-                                          _scrollMarks.end(),
-                                          [](const auto& m) { return m.start.y < 0; }),
-                           _scrollMarks.end());
     }
 
     const auto oldScrollOffset = _scrollOffset;
@@ -850,6 +850,105 @@ const TextBuffer::TextAndColor Terminal::RetrieveSelectedTextFromBuffer(bool sin
     return _activeBuffer().GetText(includeCRLF, trimTrailingWhitespace, selectionRects, GetAttributeColors, formatWrappedRows);
 }
 
+// Method Description:
+// - Get the highlighted portion of the text buffer in the formats that we copy to the clipboard.
+// - Unlike RetrieveSelectedTextFromBuffer(), this doesn't make a copy of the selection first,
+//   which matters when most of the scrollback is selected.
+// Arguments:
+// - singleLine: collapse all of the text to one line
+// - html, rtf: whether to generate the respective format
+// - fontHeightPoints, fontFaceName: the font used in the HTML and RTF
+// Return Value:
+// - The selection as plain text and (if requested) as HTML and RTF.
+Terminal::SelectionForClipboard Terminal::RetrieveSelectionForClipboard(bool singleLine, bool html, bool rtf, int fontHeightPoints, std::wstring_view fontFaceName)
+{
+    auto lock = LockForReading();
+
+    const auto selectionRects = _GetSelectionRects();
+
+    const auto GetAttributeColors = [&](const auto& attr) {
+        return _renderSettings.GetAttributeColors(attr);
+    };
+    const auto bgColor = _renderSettings.GetAttributeColors({}).second;
+
+    // See RetrieveSelectedTextFromBuffer() for how these are chosen.
+    TextBuffer::CopyRequest req;
+    req.selectionRects = selectionRects;
+    req.includeCRLF = !singleLine || _blockSelection;
+    req.trimTrailingWhitespace = !singleLine && (!_blockSelection || _trimBlockSelection);
+    req.formatWrappedRows = _blockSelection;
+
+    const auto& buffer = _activeBuffer();
+    SelectionForClipboard result;
+    result.plain = buffer.GetPlainText(req);
+    if (html)
+    {
+        buffer.GenHTML(req, result.html, fontHeightPoints, fontFaceName, bgColor, GetAttributeColors);
+    }
+    if (rtf)
+    {
+        buffer.GenRTF(req, result.rtf, fontHeightPoints, fontFaceName, bgColor, GetAttributeColors);
+    }
+    return result;
+}
+
+// Method Description:
+// - Copies the highlighted portion of the text buffer, so that it can be turned into
+//   the clipboard formats on another thread, while the terminal keeps running.
+// - Only the selected rows are copied, which is considerably cheaper than serializing them.
+// Arguments:
+// - singleLine: collapse all of the text to one line
+// Return Value:
+// - The snapshot of the selection.
+Terminal::SelectionSnapshot Terminal::SnapshotSelection(bool singleLine)
+{
+    auto lock = LockForReading();
+
+    const auto selectionRects = _GetSelectionRects();
+
+    SelectionSnapshot snapshot;
+    snapshot.buffer = _activeBuffer().SnapshotRows(selectionRects, snapshot.rects);
+    snapshot.renderSettings = _renderSettings;
+    // See RetrieveSelectedTextFromBuffer() for how these are chosen.
+    snapshot.includeCRLF = !singleLine || _blockSelection;
+    snapshot.trimTrailingWhitespace = !singleLine && (!_blockSelection || _trimBlockSelection);
+    snapshot.formatWrappedRows = _blockSelection;
+    return snapshot;
+}
+
+std::wstring Terminal::SelectionSnapshot::PlainText() const
+{
+    return buffer->GetPlainText(_request());
+}
+
+std::string Terminal::SelectionSnapshot::Html(int fontHeightPoints, std::wstring_view fontFaceName) const
+{
+    std::string html;
+    buffer->GenHTML(_request(), html, fontHeightPoints, fontFaceName, renderSettings.GetAttributeColors({}).second, [&](const auto& attr) {
+        return renderSettings.GetAttributeColors(attr);
+    });
+    return html;
+}
+
+std::string Terminal::SelectionSnapshot::Rtf(int fontHeightPoints, std::wstring_view fontFaceName) const
+{
+    std::string rtf;
+    buffer->GenRTF(_request(), rtf, fontHeightPoints, fontFaceName, renderSettings.GetAttributeColors({}).second, [&](const auto& attr) {
+        return renderSettings.GetAttributeColors(attr);
+    });
+    return rtf;
+}
+
+TextBuffer::CopyRequest Terminal::SelectionSnapshot::_request() const noexcept
+{
+    TextBuffer::CopyRequest req;
+    req.selectionRects = rects;
+    req.includeCRLF = includeCRLF;
+    req.trimTrailingWhitespace = trimTrailingWhitespace;
+    req.formatWrappedRows = formatWrappedRows;
+    return req;
+}
+
 // Method Description:
 // - convert viewport position to the corresponding location on the buffer
 // Arguments:
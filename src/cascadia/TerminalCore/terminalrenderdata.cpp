@@ -99,28 +99,18 @@ const std::wstring Microsoft::Terminal::Core::Terminal::GetHyperlinkCustomId(uin
 
 // Method Description:
 // - Gets the regex pattern ids of a location
+// - This is called for every cell the Renderer paints. The ids are returned via an
+//   out parameter, so that the Renderer can reuse its capacity from frame to frame.
 // Arguments:
-// - The location
-// Return value:
-// - The pattern IDs of the location
-const std::vector<size_t> Terminal::GetPatternId(const til::point location) const
+// - location - The location
+// - ids - Receives the pattern IDs of the location
+void Terminal::GetPatternId(const til::point location, std::vector<size_t>& ids) const
 {
+    ids.clear();
     // Look through our interval tree for this location
-    const auto intervals = _patternIntervalTree.findOverlapping({ location.x + 1, location.y }, location);
-    if (intervals.size() == 0)
-    {
-        return {};
-    }
-    else
-    {
-        std::vector<size_t> result{};
-        for (const auto& interval : intervals)
-        {
-            result.emplace_back(interval.value);
-        }
-        return result;
-    }
-    return {};
+    _patternIntervalTree.visit_overlapping({ location.x + 1, location.y }, location, [&](const auto& interval) {
+        ids.emplace_back(interval.value);
+    });
 }
 
 std::pair<COLORREF, COLORREF> Terminal::GetAttributeColors(const TextAttribute& attr) const noexcept
@@ -128,12 +118,43 @@ std::pair<COLORREF, COLORREF> Terminal::GetAttributeColors(const TextAttribute&
     return _renderSettings.GetAttributeColors(attr);
 }
 
+// Method Description:
+// - Returns the selected rows that are inside the visible viewport. The renderer calls this
+//   each time the selection changes, and it can't draw the remainder anyway. A selection over
+//   the entire scrollback would otherwise produce a rectangle for every single row in it.
 std::vector<Microsoft::Console::Types::Viewport> Terminal::GetSelectionRects() noexcept
 try
 {
     std::vector<Viewport> result;
 
-    for (const auto& lineRect : _GetSelectionRects())
+    if (!IsSelectionActive())
+    {
+        return result;
+    }
+
+    const auto& buffer = _activeBuffer();
+    const auto viewport = _GetVisibleViewport();
+    auto start = _selection->start;
+    auto end = _selection->end;
+
+    if (end.y < viewport.Top() || start.y > viewport.BottomInclusive())
+    {
+        return result;
+    }
+
+    // Block selections keep their columns on every row. Line selections
+    // cover all of the rows between the start and end, which is the same
+    // as starting at the left and ending at the right edge of the viewport.
+    if (start.y < viewport.Top())
+    {
+        start = { _blockSelection ? start.x : buffer.GetSize().Left(), viewport.Top() };
+    }
+    if (end.y > viewport.BottomInclusive())
+    {
+        end = { _blockSelection ? end.x : buffer.GetSize().RightInclusive(), viewport.BottomInclusive() };
+    }
+
+    for (const auto& lineRect : buffer.GetTextRects(start, end, _blockSelection, false))
     {
         result.emplace_back(Viewport::FromInclusive(lineRect));
     }
@@ -207,7 +228,10 @@ catch (...)
 //      they're done with any querying they need to do.
 void Terminal::LockConsole() noexcept
 {
-    _readWriteLock.lock();
+    // Only the renderer and UIA lock us through the IRenderData interface.
+    const auto renderThreadId = _renderThreadId.load(std::memory_order_relaxed);
+    const auto site = !renderThreadId || renderThreadId == GetCurrentThreadId() ? LockSite::Renderer : LockSite::Uia;
+    _readWriteLock.lock(site);
 }
 
 // Method Description:
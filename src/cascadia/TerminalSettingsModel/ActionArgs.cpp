@@ -32,6 +32,7 @@
 #include "ScrollToMarkArgs.g.cpp"
 #include "AddMarkArgs.g.cpp"
 #include "FindMatchArgs.g.cpp"
+#include "FindInAllPanesArgs.g.cpp"
 #include "ToggleCommandPaletteArgs.g.cpp"
 #include "NewWindowArgs.g.cpp"
 #include "PrevTabArgs.g.cpp"
@@ -701,6 +702,21 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
         return L"";
     }
 
+    winrt::hstring FindInAllPanesArgs::GenerateName() const
+    {
+        // The string will be similar to the following:
+        // * "Find in all panes"
+        // * "Find in all panes: "...query...""
+        if (Query().empty())
+        {
+            return RS_(L"FindInAllPanesCommandKey");
+        }
+        return winrt::hstring{
+            fmt::format(std::wstring_view(RS_(L"FindInAllPanesWithQueryCommandKey")),
+                        Query())
+        };
+    }
+
     winrt::hstring NewWindowArgs::GenerateName() const
     {
         winrt::hstring newTerminalArgsStr;
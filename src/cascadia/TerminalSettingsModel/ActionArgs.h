@@ -35,6 +35,7 @@
 #include "MoveTabArgs.g.h"
 #include "ToggleCommandPaletteArgs.g.h"
 #include "FindMatchArgs.g.h"
+#include "FindInAllPanesArgs.g.h"
 #include "NewWindowArgs.g.h"
 #include "PrevTabArgs.g.h"
 #include "NextTabArgs.g.h"
@@ -215,6 +216,12 @@ private:                                                                    \
 #define FIND_MATCH_ARGS(X) \
     X(FindMatchDirection, Direction, "direction", args->Direction() == FindMatchDirection::None, FindMatchDirection::None)
 
+////////////////////////////////////////////////////////////////////////////////
+#define FIND_IN_ALL_PANES_ARGS(X)                         \
+    X(winrt::hstring, Query, "query", false, L"")         \
+    X(bool, CaseSensitive, "caseSensitive", false, false) \
+    X(bool, RegularExpression, "regularExpression", false, false)
+
 ////////////////////////////////////////////////////////////////////////////////
 #define PREV_TAB_ARGS(X) \
     X(Windows::Foundation::IReference<TabSwitcherMode>, SwitcherMode, "tabSwitcherMode", false, nullptr)
@@ -240,8 +247,9 @@ private:                                                                    \
     X(uint32_t, Id, "id", false, 0u)
 
 ////////////////////////////////////////////////////////////////////////////////
-#define EXPORT_BUFFER_ARGS(X) \
-    X(winrt::hstring, Path, "path", false, L"")
+#define EXPORT_BUFFER_ARGS(X)                   \
+    X(winrt::hstring, Path, "path", false, L"") \
+    X(winrt::Microsoft::Terminal::Control::ExportBufferFormat, Format, "format", false, winrt::Microsoft::Terminal::Control::ExportBufferFormat::Text)
 
 ////////////////////////////////////////////////////////////////////////////////
 #define CLEAR_BUFFER_ARGS(X) \
@@ -301,6 +309,7 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
         ACTION_ARG(winrt::hstring, ColorScheme);
         ACTION_ARG(Windows::Foundation::IReference<bool>, Elevate, nullptr);
         ACTION_ARG(uint64_t, ContentId);
+        ACTION_ARG(winrt::guid, SessionId);
 
         static constexpr std::string_view CommandlineKey{ "commandline" };
         static constexpr std::string_view StartingDirectoryKey{ "startingDirectory" };
@@ -312,6 +321,7 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
         static constexpr std::string_view ColorSchemeKey{ "colorScheme" };
         static constexpr std::string_view ElevateKey{ "elevate" };
         static constexpr std::string_view ContentKey{ "__content" };
+        static constexpr std::string_view SessionIdKey{ "sessionId" };
 
     public:
         hstring GenerateName() const;
@@ -331,7 +341,8 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
                        otherAsUs->_SuppressApplicationTitle == _SuppressApplicationTitle &&
                        otherAsUs->_ColorScheme == _ColorScheme &&
                        otherAsUs->_Elevate == _Elevate &&
-                       otherAsUs->_ContentId == _ContentId;
+                       otherAsUs->_ContentId == _ContentId &&
+                       otherAsUs->_SessionId == _SessionId;
             }
             return false;
         };
@@ -349,6 +360,7 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
             JsonUtils::GetValueForKey(json, ColorSchemeKey, args->_ColorScheme);
             JsonUtils::GetValueForKey(json, ElevateKey, args->_Elevate);
             JsonUtils::GetValueForKey(json, ContentKey, args->_ContentId);
+            JsonUtils::GetValueForKey(json, SessionIdKey, args->_SessionId);
             return *args;
         }
         static Json::Value ToJson(const Model::NewTerminalArgs& val)
@@ -369,6 +381,7 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
             JsonUtils::SetValueForKey(json, ColorSchemeKey, args->_ColorScheme);
             JsonUtils::SetValueForKey(json, ElevateKey, args->_Elevate);
             JsonUtils::SetValueForKey(json, ContentKey, args->_ContentId);
+            JsonUtils::SetValueForKey(json, SessionIdKey, args->_SessionId);
             return json;
         }
         Model::NewTerminalArgs Copy() const
@@ -384,6 +397,7 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
             copy->_ColorScheme = _ColorScheme;
             copy->_Elevate = _Elevate;
             copy->_ContentId = _ContentId;
+            copy->_SessionId = _SessionId;
             return *copy;
         }
         size_t Hash() const
@@ -404,6 +418,7 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
             h.write(ColorScheme());
             h.write(Elevate());
             h.write(ContentId());
+            h.write(SessionId());
         }
     };
 }
@@ -705,6 +720,8 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
 
     ACTION_ARGS_STRUCT(FindMatchArgs, FIND_MATCH_ARGS);
 
+    ACTION_ARGS_STRUCT(FindInAllPanesArgs, FIND_IN_ALL_PANES_ARGS);
+
     ACTION_ARGS_STRUCT(PrevTabArgs, PREV_TAB_ARGS);
 
     ACTION_ARGS_STRUCT(NextTabArgs, NEXT_TAB_ARGS);
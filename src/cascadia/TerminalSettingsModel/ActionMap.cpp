@@ -429,9 +429,11 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
         }
 
         // invalidate caches
+        _AvailableActionsCache = nullptr;
         _NameMapCache = nullptr;
         _GlobalHotkeysCache = nullptr;
         _KeyBindingMapCache = nullptr;
+        _KeyChordLookupCache.reset();
 
         // Handle nested commands
         const auto cmdImpl{ get_self<Command>(cmd) };
@@ -724,6 +726,16 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
     // - nullopt if it was not bound in this layer
     std::optional<Model::Command> ActionMap::_GetActionByKeyChordInternal(const Control::KeyChord& keys) const
     {
+        // Use the flattened lookup table if the settings have been finalized.
+        if (_KeyChordLookupCache)
+        {
+            if (const auto it = _KeyChordLookupCache->find(keys); it != _KeyChordLookupCache->end())
+            {
+                return it->second;
+            }
+            return std::nullopt;
+        }
+
         // Check the current layer
         if (const auto actionIDPair = _KeyMap.find(keys); actionIDPair != _KeyMap.end())
         {
@@ -926,7 +938,55 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
         {
             _ExpandedCommandsCache.Append(command);
         }
+
+        // This is called once the settings have been loaded.
+        _RefreshKeyChordLookup();
+    }
+
+    // Method Description:
+    // - Builds the flattened key chord lookup table and the list of available
+    //   actions, so that neither has to walk the inheritance chain later on.
+    // - The table is invalidated whenever an action is added to this layer.
+    void ActionMap::_RefreshKeyChordLookup()
+    {
+        std::unordered_map<Control::KeyChord, std::optional<Model::Command>, KeyChordHash, KeyChordEquality> keyChordLookup;
+        _PopulateKeyChordLookup(keyChordLookup);
+        _KeyChordLookupCache = std::move(keyChordLookup);
+
+        // AvailableActions() caches its result.
+        std::ignore = AvailableActions();
+    }
+
+    // Method Description:
+    // - Populates the map with the result of _GetActionByKeyChordInternal for
+    //   every key chord that is bound in this layer or any of its parents.
+    // Arguments:
+    // - keyChordLookup: the key chord lookup table to populate
+    void ActionMap::_PopulateKeyChordLookup(std::unordered_map<Control::KeyChord, std::optional<Model::Command>, KeyChordHash, KeyChordEquality>& keyChordLookup) const
+    {
+        // Key chords bound in the current layer take precedence over our parents,
+        // even if they resolve to nullopt, just like in _GetActionByKeyChordInternal.
+        keyChordLookup.reserve(keyChordLookup.size() + _KeyMap.size());
+        for (const auto& [keys, actionID] : _KeyMap)
+        {
+            keyChordLookup.emplace(keys, _GetActionByID(actionID));
+        }
+
+        // Otherwise, the first parent with a binding wins.
+        for (const auto& parent : _parents)
+        {
+            std::unordered_map<Control::KeyChord, std::optional<Model::Command>, KeyChordHash, KeyChordEquality> parentLookup;
+            parent->_PopulateKeyChordLookup(parentLookup);
+            for (auto& [keys, cmd] : parentLookup)
+            {
+                if (cmd)
+                {
+                    keyChordLookup.emplace(keys, std::move(cmd));
+                }
+            }
+        }
     }
+
     IVector<Model::Command> ActionMap::ExpandedCommands()
     {
         return _ExpandedCommandsCache;
@@ -80,6 +80,7 @@
     ON_ALL_ACTIONS(EnablePaneReadOnly)      \
     ON_ALL_ACTIONS(DisablePaneReadOnly)     \
     ON_ALL_ACTIONS(FindMatch)               \
+    ON_ALL_ACTIONS(FindInAllPanes)          \
     ON_ALL_ACTIONS(NewWindow)               \
     ON_ALL_ACTIONS(IdentifyWindow)          \
     ON_ALL_ACTIONS(IdentifyWindows)         \
@@ -103,7 +104,8 @@
     ON_ALL_ACTIONS(SwitchSelectionEndpoint) \
     ON_ALL_ACTIONS(ColorSelection)          \
     ON_ALL_ACTIONS(ExpandSelectionToWord)   \
-    ON_ALL_ACTIONS(CloseOtherPanes)
+    ON_ALL_ACTIONS(CloseOtherPanes)         \
+    ON_ALL_ACTIONS(TogglePerformanceOverlay)
 
 #define ALL_SHORTCUT_ACTIONS_WITH_ARGS             \
     ON_ALL_ACTIONS_WITH_ARGS(AdjustFontSize)       \
@@ -113,6 +115,7 @@
     ON_ALL_ACTIONS_WITH_ARGS(CopyText)             \
     ON_ALL_ACTIONS_WITH_ARGS(ExecuteCommandline)   \
     ON_ALL_ACTIONS_WITH_ARGS(FindMatch)            \
+    ON_ALL_ACTIONS_WITH_ARGS(FindInAllPanes)       \
     ON_ALL_ACTIONS_WITH_ARGS(GlobalSummon)         \
     ON_ALL_ACTIONS_WITH_ARGS(MoveFocus)            \
     ON_ALL_ACTIONS_WITH_ARGS(MovePane)             \
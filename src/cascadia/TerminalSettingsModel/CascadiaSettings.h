@@ -83,11 +83,23 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
         std::span<const winrt::com_ptr<implementation::Profile>> _getNonUserOriginProfiles() const;
         void _parse(const OriginTag origin, const winrt::hstring& source, const std::string_view& content, ParsedSettings& settings);
         void _parseFragment(const winrt::hstring& source, const std::string_view& content, ParsedSettings& settings);
+        void _parseFragment(const winrt::hstring& source, const Json::Value& root, ParsedSettings& settings);
+        static std::shared_ptr<const Json::Value> _readFragment(const std::filesystem::directory_entry& entry);
         static JsonSettings _parseJson(const std::string_view& content);
         static winrt::com_ptr<implementation::Profile> _parseProfile(const OriginTag origin, const winrt::hstring& source, const Json::Value& profileJson);
         void _appendProfile(winrt::com_ptr<Profile>&& profile, const winrt::guid& guid, ParsedSettings& settings);
         void _addUserProfileParent(const winrt::com_ptr<implementation::Profile>& profile);
-        void _executeGenerator(const IDynamicProfileGenerator& generator);
+        struct GeneratorOutput
+        {
+            std::vector<winrt::com_ptr<implementation::Profile>> profiles;
+            std::string fingerprint;
+            bool cached = false;
+        };
+
+        GeneratorOutput _executeGenerator(const IDynamicProfileGenerator& generator) const;
+        void _addGeneratedProfiles(const IDynamicProfileGenerator& generator, GeneratorOutput&& output);
+        static bool _loadCachedProfiles(const std::wstring_view& generatorNamespace, const std::string& fingerprint, std::vector<winrt::com_ptr<implementation::Profile>>& profiles);
+        void _storeCachedProfiles(const std::wstring_view& generatorNamespace, const std::string& fingerprint, size_t offset);
 
         std::unordered_set<std::wstring_view> _ignoredNamespaces;
         // See _getNonUserOriginProfiles().
@@ -188,6 +200,18 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
         // GetProfileForArgs cache
         mutable std::once_flag _commandLinesCacheOnce;
         mutable std::vector<std::pair<std::wstring, Model::Profile>> _commandLinesCache;
+
+        // TerminalSettings::CreateWithProfile cache
+        // Each entry holds the settings resolved from a profile, which new panes
+        // inherit from. It lives as long as this settings generation does.
+        struct TerminalSettingsCacheEntry
+        {
+            winrt::Windows::UI::Xaml::ElementTheme requestedTheme;
+            Model::TerminalSettings settings;
+        };
+        mutable til::shared_mutex<std::unordered_map<Model::Profile, TerminalSettingsCacheEntry>> _terminalSettingsCache;
+
+        friend struct TerminalSettings;
     };
 }
 
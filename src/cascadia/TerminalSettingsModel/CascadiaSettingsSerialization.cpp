@@ -6,6 +6,7 @@
 
 #include <LibraryResources.h>
 #include <fmt/chrono.h>
+#include <future>
 #include <shlobj.h>
 #include <til/latch.h>
 
@@ -96,6 +97,17 @@ static auto extractValueFromTaskWithoutMainThreadAwait(TTask&& task) -> decltype
     return finalVal.value();
 }
 
+// Fragments are read again on every settings reload, even though most of them never change.
+// Their parsed contents are kept here and only read again if their timestamp or size changed.
+// Unlike opening the file, both of these come for free with the directory enumeration.
+struct FragmentCacheEntry
+{
+    std::filesystem::file_time_type lastWriteTime;
+    uintmax_t size = 0;
+    std::shared_ptr<const Json::Value> root;
+};
+static til::shared_mutex<std::unordered_map<std::wstring, FragmentCacheEntry>> s_fragmentCache;
+
 // Concatenates the two given strings (!) and returns them as a path.
 // You better make sure there's a path separator at the end of lhs or at the start of rhs.
 static std::filesystem::path buildPath(const std::wstring_view& lhs, const std::wstring_view& rhs)
@@ -162,13 +174,37 @@ SettingsLoader::SettingsLoader(const std::string_view& userJSON, const std::stri
 // (meaning profiles specified by the application rather by the user).
 void SettingsLoader::GenerateProfiles()
 {
-    _executeGenerator(PowershellCoreProfileGenerator{});
-    _executeGenerator(WslDistroGenerator{});
-    _executeGenerator(AzureCloudShellGenerator{});
-    _executeGenerator(VisualStudioGenerator{});
+    const PowershellCoreProfileGenerator powershellCoreGenerator;
+    const WslDistroGenerator wslDistroGenerator;
+    const AzureCloudShellGenerator azureCloudShellGenerator;
+    const VisualStudioGenerator visualStudioGenerator;
+    std::vector<const IDynamicProfileGenerator*> generators{
+        &powershellCoreGenerator,
+        &wslDistroGenerator,
+        &azureCloudShellGenerator,
+        &visualStudioGenerator,
+    };
 #if TIL_FEATURE_DYNAMICSSHPROFILES_ENABLED
-    _executeGenerator(SshHostGenerator{});
+    const SshHostGenerator sshHostGenerator;
+    generators.emplace_back(&sshHostGenerator);
 #endif
+
+    // The generators are independent of each other and spend most of their time waiting on the
+    // registry, the file system or COM servers, so they run concurrently. Their profiles are still
+    // added in the order above, because that's the order they'll have in a new settings.json.
+    std::vector<std::future<GeneratorOutput>> outputs;
+    outputs.reserve(generators.size());
+    for (const auto generator : generators)
+    {
+        outputs.emplace_back(std::async(std::launch::async, [this, generator]() {
+            return _executeGenerator(*generator);
+        }));
+    }
+
+    for (size_t i = 0; i < generators.size(); ++i)
+    {
+        _addGeneratedProfiles(*generators[i], outputs[i].get());
+    }
 }
 
 // A new settings.json gets a special treatment:
@@ -236,8 +272,8 @@ void SettingsLoader::FindFragmentsAndMergeIntoUserSettings()
             {
                 try
                 {
-                    const auto content = ReadUTF8File(fragmentExt.path());
-                    _parseFragment(source, content, fragmentSettings);
+                    const auto root = _readFragment(fragmentExt);
+                    _parseFragment(source, *root, fragmentSettings);
                 }
                 CATCH_LOG();
             }
@@ -618,14 +654,23 @@ void SettingsLoader::_parse(const OriginTag origin, const winrt::hstring& source
 // schemes and profiles. Additionally this function supports profiles which specify an "updates" key.
 void SettingsLoader::_parseFragment(const winrt::hstring& source, const std::string_view& content, ParsedSettings& settings)
 {
-    const auto json = _parseJson(content);
+    const auto root = content.empty() ? Json::Value{ Json::ValueType::objectValue } : _parseJSON(content);
+    _parseFragment(source, root, settings);
+}
+
+// Same as above, for a fragment that has already been parsed.
+void SettingsLoader::_parseFragment(const winrt::hstring& source, const Json::Value& root, ParsedSettings& settings)
+{
+    const auto& colorSchemes = _getJSONValue(root, SchemesKey);
+    const auto& profilesObject = _getJSONValue(root, ProfilesKey);
+    const auto& profilesList = profilesObject.isArray() ? profilesObject : _getJSONValue(profilesObject, ProfilesListKey);
 
     settings.clear();
 
     {
         settings.globals = winrt::make_self<GlobalAppSettings>();
 
-        for (const auto& schemeJson : json.colorSchemes)
+        for (const auto& schemeJson : colorSchemes)
         {
             try
             {
@@ -639,11 +684,11 @@ void SettingsLoader::_parseFragment(const winrt::hstring& source, const std::str
     }
 
     {
-        const auto size = json.profilesList.size();
+        const auto size = profilesList.size();
         settings.profiles.reserve(size);
         settings.profilesByGuid.reserve(size);
 
-        for (const auto& profileJson : json.profilesList)
+        for (const auto& profileJson : profilesList)
         {
             try
             {
@@ -683,6 +728,27 @@ void SettingsLoader::_parseFragment(const winrt::hstring& source, const std::str
     }
 }
 
+// Returns the parsed contents of the given fragment file, from s_fragmentCache if it hasn't changed.
+std::shared_ptr<const Json::Value> SettingsLoader::_readFragment(const std::filesystem::directory_entry& entry)
+{
+    const auto lastWriteTime = entry.last_write_time();
+    const auto size = entry.file_size();
+    const auto& key = entry.path().native();
+
+    {
+        const auto cache = s_fragmentCache.lock_shared();
+        if (const auto it = cache->find(key); it != cache->end() && it->second.lastWriteTime == lastWriteTime && it->second.size == size)
+        {
+            return it->second.root;
+        }
+    }
+
+    const auto content = ReadUTF8File(entry.path());
+    auto root = std::make_shared<const Json::Value>(content.empty() ? Json::Value{ Json::ValueType::objectValue } : _parseJSON(content));
+    s_fragmentCache.lock()->insert_or_assign(key, FragmentCacheEntry{ lastWriteTime, size, root });
+    return root;
+}
+
 SettingsLoader::JsonSettings SettingsLoader::_parseJson(const std::string_view& content)
 {
     auto root = content.empty() ? Json::Value{ Json::ValueType::objectValue } : _parseJSON(content);
@@ -780,37 +846,125 @@ void SettingsLoader::_addUserProfileParent(const winrt::com_ptr<implementation::
     }
 }
 
-// As the name implies it executes a generator.
-// Generated profiles are added to .inboxSettings. Used by GenerateProfiles().
-void SettingsLoader::_executeGenerator(const IDynamicProfileGenerator& generator)
+// As the name implies it executes a generator, or loads its cached profiles.
+// This runs concurrently for all generators and thus mustn't modify the loader. Used by GenerateProfiles().
+SettingsLoader::GeneratorOutput SettingsLoader::_executeGenerator(const IDynamicProfileGenerator& generator) const
 {
+    GeneratorOutput output;
+
     const auto generatorNamespace = generator.GetNamespace();
     if (_ignoredNamespaces.count(generatorNamespace))
     {
-        return;
+        return output;
     }
 
-    const auto previousSize = inboxSettings.profiles.size();
-
     try
     {
-        generator.GenerateProfiles(inboxSettings.profiles);
+        // We're on a thread pool thread, but the VisualStudioGenerator needs COM.
+        const auto coInit = wil::CoInitializeEx(COINIT_MULTITHREADED);
+
+        // The cached profiles are invalidated by updates of the application as well,
+        // since a newer version of the generator might produce different profiles.
+        if (const auto generatorFingerprint = generator.GetFingerprint(); !generatorFingerprint.empty())
+        {
+            output.fingerprint = fmt::format("{};{}", til::u16u8(CascadiaSettings::ApplicationVersion()), til::u16u8(generatorFingerprint));
+            output.cached = _loadCachedProfiles(generatorNamespace, output.fingerprint, output.profiles);
+        }
+
+        if (!output.cached)
+        {
+            generator.GenerateProfiles(output.profiles);
+        }
     }
     CATCH_LOG_MSG("Dynamic Profile Namespace: \"%.*s\"", gsl::narrow<int>(generatorNamespace.size()), generatorNamespace.data())
 
+    return output;
+}
+
+// Generated profiles are added to .inboxSettings. Used by GenerateProfiles().
+void SettingsLoader::_addGeneratedProfiles(const IDynamicProfileGenerator& generator, GeneratorOutput&& output)
+{
+    const auto generatorNamespace = generator.GetNamespace();
+    const auto previousSize = inboxSettings.profiles.size();
+
     // If the generator produced some profiles we're going to give them default attributes.
     // By setting the Origin/Source/etc. here, we deduplicate some code and ensure they aren't missing accidentally.
-    if (inboxSettings.profiles.size() > previousSize)
+    if (!output.profiles.empty())
     {
         const winrt::hstring source{ generatorNamespace };
 
-        for (const auto& profile : std::span(inboxSettings.profiles).subspan(previousSize))
+        for (auto& profile : output.profiles)
         {
             profile->Origin(OriginTag::Generated);
             profile->Source(source);
+            inboxSettings.profiles.emplace_back(std::move(profile));
         }
     }
+
+    if (!output.cached && !output.fingerprint.empty())
+    {
+        _storeCachedProfiles(generatorNamespace, output.fingerprint, previousSize);
+    }
+}
+
+// Loads the profiles a generator produced on a previous launch,
+// if its fingerprint still matches. Used by _executeGenerator().
+bool SettingsLoader::_loadCachedProfiles(const std::wstring_view& generatorNamespace, const std::string& fingerprint, std::vector<winrt::com_ptr<Profile>>& profiles)
+try
+{
+    const auto& state = winrt::get_self<ApplicationState>(ApplicationState::SharedInstance());
+    const auto cache = state->GeneratorCache();
+    if (!cache.isObject())
+    {
+        return false;
+    }
+
+    const auto& entry = cache[til::u16u8(generatorNamespace)];
+    if (!entry.isObject() || entry["fingerprint"] != fingerprint || !entry["profiles"].isArray())
+    {
+        return false;
+    }
+
+    // Parse all profiles first, so that a broken cache doesn't leave us with half of them.
+    std::vector<winrt::com_ptr<Profile>> cachedProfiles;
+    for (const auto& json : entry["profiles"])
+    {
+        cachedProfiles.emplace_back(Profile::FromJson(json));
+    }
+
+    profiles = std::move(cachedProfiles);
+    return true;
+}
+catch (...)
+{
+    LOG_CAUGHT_EXCEPTION();
+    return false;
+}
+
+// Saves the profiles in .inboxSettings starting at the given offset
+// as the cached output of the generator. Used by _addGeneratedProfiles().
+void SettingsLoader::_storeCachedProfiles(const std::wstring_view& generatorNamespace, const std::string& fingerprint, const size_t offset)
+try
+{
+    Json::Value profiles{ Json::arrayValue };
+    for (const auto& profile : std::span(inboxSettings.profiles).subspan(offset))
+    {
+        profiles.append(profile->ToJson());
+    }
+
+    const auto& state = winrt::get_self<ApplicationState>(ApplicationState::SharedInstance());
+    auto cache = state->GeneratorCache();
+    if (!cache.isObject())
+    {
+        cache = Json::Value{ Json::objectValue };
+    }
+
+    auto& entry = cache[til::u16u8(generatorNamespace)];
+    entry["fingerprint"] = fingerprint;
+    entry["profiles"] = std::move(profiles);
+    state->GeneratorCache(cache);
 }
+CATCH_LOG()
 
 // Method Description:
 // - Creates a CascadiaSettings from whatever's saved on disk, or instantiates
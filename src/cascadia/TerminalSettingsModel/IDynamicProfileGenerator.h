@@ -13,6 +13,10 @@ Abstract:
 - Each DPG must have a unique namespace to associate with itself. If the
   namespace is not unique, the generator risks affecting profiles from
   conflicting generators.
+- A DPG may provide a fingerprint of its inputs, which is cheap to compute
+  compared to generating the profiles. As long as it doesn't change, the
+  profiles it generated on a previous launch are loaded from the state file
+  instead of running the generator again.
 
 Author(s):
 - Mike Griese - August 2019
@@ -31,5 +35,10 @@ namespace winrt::Microsoft::Terminal::Settings::Model
         virtual ~IDynamicProfileGenerator() = default;
         virtual std::wstring_view GetNamespace() const noexcept = 0;
         virtual void GenerateProfiles(std::vector<winrt::com_ptr<implementation::Profile>>& profiles) const = 0;
+        // An empty fingerprint means that the generator's output can't be cached.
+        virtual std::wstring GetFingerprint() const
+        {
+            return {};
+        }
     };
 };
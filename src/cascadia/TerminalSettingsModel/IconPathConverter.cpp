@@ -245,9 +245,9 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
         return softwareBitmap;
     }
 
-    SoftwareBitmap _getBitmapFromIconFileAsync(const winrt::hstring& iconPath,
-                                               int32_t iconIndex,
-                                               uint32_t iconSize)
+    SoftwareBitmap _extractBitmapFromIconFile(const winrt::hstring& iconPath,
+                                              int32_t iconIndex,
+                                              uint32_t iconSize)
     {
         wil::unique_hicon hicon;
         LOG_IF_FAILED(SHDefExtractIcon(iconPath.c_str(), iconIndex, 0, &hicon, nullptr, iconSize));
@@ -266,6 +266,43 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
                                         wicImagingFactory.get());
     }
 
+    SoftwareBitmap _getBitmapFromIconFileAsync(const winrt::hstring& iconPath,
+                                               int32_t iconIndex,
+                                               uint32_t iconSize)
+    {
+        // Profile icons are shown in tab headers, the new tab menu, the command palette
+        // and so on, in every window. Extracting and converting them each time is
+        // wasteful, so we keep the decoded bitmaps around for the lifetime of the process.
+        // SoftwareBitmaps are agile, which allows us to share them between windows.
+        // The key includes the file's modification time, so that updated binaries get their new icon.
+        struct CacheEntry
+        {
+            uint64_t lastWriteTime;
+            SoftwareBitmap bitmap;
+        };
+        static til::shared_mutex<std::unordered_map<std::wstring, CacheEntry>> s_cache;
+
+        uint64_t lastWriteTime = 0;
+        WIN32_FILE_ATTRIBUTE_DATA data;
+        if (GetFileAttributesExW(iconPath.c_str(), GetFileExInfoStandard, &data))
+        {
+            lastWriteTime = til::bit_cast<uint64_t>(data.ftLastWriteTime);
+        }
+
+        auto key = fmt::format(L"{}|{}|{}", std::wstring_view{ iconPath }, iconIndex, iconSize);
+        {
+            const auto cache = s_cache.lock_shared();
+            if (const auto it = cache->find(key); it != cache->end() && it->second.lastWriteTime == lastWriteTime)
+            {
+                return it->second.bitmap;
+            }
+        }
+
+        auto bitmap = _extractBitmapFromIconFile(iconPath, iconIndex, iconSize);
+        s_cache.lock()->insert_or_assign(std::move(key), CacheEntry{ lastWriteTime, bitmap });
+        return bitmap;
+    }
+
     // Method Description:
     // - Attempt to get the icon index from the icon path provided
     // Arguments:
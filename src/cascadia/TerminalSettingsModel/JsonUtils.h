@@ -298,6 +298,31 @@ namespace Microsoft::Terminal::Settings::Model::JsonUtils
         }
     };
 
+    // Passes JSON through as is, for values whose structure is only known to their user.
+    template<>
+    struct ConversionTrait<Json::Value>
+    {
+        Json::Value FromJson(const Json::Value& json) const
+        {
+            return json;
+        }
+
+        bool CanConvert(const Json::Value&) const noexcept
+        {
+            return true;
+        }
+
+        Json::Value ToJson(const Json::Value& val)
+        {
+            return val;
+        }
+
+        std::string TypeDescription() const
+        {
+            return "any";
+        }
+    };
+
     template<>
     struct ConversionTrait<GUID>
     {
@@ -64,6 +64,7 @@ Author(s):
     X(bool, TrimPaste, "trimPaste", true)                                                                                                                                                             \
     X(bool, EnableColorSelection, "experimental.enableColorSelection", false)                                                                                                                         \
     X(winrt::Windows::Foundation::Collections::IVector<Model::NewTabMenuEntry>, NewTabMenu, "newTabMenu", winrt::single_threaded_vector<Model::NewTabMenuEntry>({ Model::RemainingProfilesEntry{} })) \
+    X(int32_t, WarmTabCount, "experimental.rendering.warmTabCount", 0)                                                                                                                                \
     X(bool, AllowHeadless, "compatibility.allowHeadless", false)                                                                                                                                      \
     X(bool, IsolatedMode, "compatibility.isolatedMode", false)
 
@@ -89,7 +90,12 @@ Author(s):
     X(bool, Elevate, "elevate", false)                                                                                                                         \
     X(bool, VtPassthrough, "experimental.connection.passthroughMode", false)                                                                                   \
     X(bool, AutoMarkPrompts, "experimental.autoMarkPrompts", false)                                                                                            \
-    X(bool, ShowMarks, "experimental.showMarksOnScrollbar", false)
+    X(bool, ShowMarks, "experimental.showMarksOnScrollbar", false)                                                                                             \
+    X(bool, DedicatedParserThread, "experimental.dedicatedParserThread", false)                                                                                \
+    X(bool, SpillScrollbackToDisk, "experimental.spillScrollbackToDisk", false)                                                                                \
+    X(int32_t, PixelShaderMaxFrameRate, "experimental.pixelShaderMaxFrameRate", 0)                                                                             \
+    X(bool, PixelShaderPauseWhenUnfocused, "experimental.pixelShaderPauseWhenUnfocused", false)                                                                \
+    X(hstring, RecordingDirectory, "experimental.connection.recordingDirectory")
 
 // Intentionally omitted Profile settings:
 // * Name
@@ -3,6 +3,7 @@
 
 #include "pch.h"
 #include "TerminalSettings.h"
+#include "CascadiaSettings.h"
 #include "../../types/inc/colorTable.hpp"
 
 #include "TerminalSettings.g.cpp"
@@ -62,6 +63,48 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
         return settings;
     }
 
+    // Method Description:
+    // - Returns the settings resolved from the given profile, which are shared by
+    //   all terminals of that profile until the settings are reloaded.
+    // - The returned object must not be modified. Callers create a child of it,
+    //   so that any per-terminal overrides only apply to that child.
+    // Arguments:
+    // - appSettings: the set of settings being used to construct the new terminal
+    // - profile: the profile to resolve the settings for
+    // Return Value:
+    // - the shared, resolved settings of the profile
+    winrt::com_ptr<implementation::TerminalSettings> TerminalSettings::_CreateWithProfileCached(const Model::CascadiaSettings& appSettings, const Model::Profile& profile)
+    {
+        const auto appSettingsImpl = winrt::get_self<implementation::CascadiaSettings>(appSettings);
+        // The color scheme may depend on whether the OS is in dark mode,
+        // which can change without the settings being reloaded.
+        const auto requestedTheme = _ResolveRequestedTheme(appSettings.GlobalSettings().CurrentTheme());
+
+        {
+            const auto cache = appSettingsImpl->_terminalSettingsCache.lock_shared();
+            if (const auto it = cache->find(profile); it != cache->end() && it->second.requestedTheme == requestedTheme)
+            {
+                return winrt::get_self<TerminalSettings>(it->second.settings)->get_strong();
+            }
+        }
+
+        const auto settings = _CreateWithProfileCommon(appSettings, profile);
+        appSettingsImpl->_terminalSettingsCache.lock()->insert_or_assign(profile, CascadiaSettings::TerminalSettingsCacheEntry{ requestedTheme, *settings });
+        return settings;
+    }
+
+    winrt::Windows::UI::Xaml::ElementTheme TerminalSettings::_ResolveRequestedTheme(const Model::Theme& currentTheme)
+    {
+        auto requestedTheme = currentTheme.RequestedTheme();
+        if (requestedTheme == winrt::Windows::UI::Xaml::ElementTheme::Default)
+        {
+            requestedTheme = Model::Theme::IsSystemInDarkTheme() ?
+                                 winrt::Windows::UI::Xaml::ElementTheme::Dark :
+                                 winrt::Windows::UI::Xaml::ElementTheme::Light;
+        }
+        return requestedTheme;
+    }
+
     Model::TerminalSettings TerminalSettings::CreateForPreview(const Model::CascadiaSettings& appSettings, const Model::Profile& profile)
     {
         const auto settings = _CreateWithProfileCommon(appSettings, profile);
@@ -83,7 +126,10 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
     //   one for when the terminal is focused and the other for when the terminal is unfocused
     Model::TerminalSettingsCreateResult TerminalSettings::CreateWithProfile(const Model::CascadiaSettings& appSettings, const Model::Profile& profile, const IKeyBindings& keybindings)
     {
-        const auto settings = _CreateWithProfileCommon(appSettings, profile);
+        // The profile's settings are resolved once per settings load and shared.
+        // Everything set below, as well as any overrides applied by our callers,
+        // only ends up in this child (copy-on-write).
+        const auto settings = _CreateWithProfileCached(appSettings, profile)->CreateChild();
         settings->_KeyBindings = keybindings;
 
         Model::TerminalSettings child{ nullptr };
@@ -190,13 +236,7 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
         _CursorShape = appearance.CursorShape();
         _CursorHeight = appearance.CursorHeight();
 
-        auto requestedTheme = currentTheme.RequestedTheme();
-        if (requestedTheme == winrt::Windows::UI::Xaml::ElementTheme::Default)
-        {
-            requestedTheme = Model::Theme::IsSystemInDarkTheme() ?
-                                 winrt::Windows::UI::Xaml::ElementTheme::Dark :
-                                 winrt::Windows::UI::Xaml::ElementTheme::Light;
-        }
+        const auto requestedTheme = _ResolveRequestedTheme(currentTheme);
 
         switch (requestedTheme)
         {
@@ -325,6 +365,10 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
         _ShowMarks = Feature_ScrollbarMarks::IsEnabled() && profile.ShowMarks();
 
         _RightClickContextMenu = profile.RightClickContextMenu();
+        _DedicatedParserThread = profile.DedicatedParserThread();
+        _SpillScrollbackToDisk = profile.SpillScrollbackToDisk();
+        _PixelShaderMaxFrameRate = profile.PixelShaderMaxFrameRate();
+        _PixelShaderPauseWhenUnfocused = profile.PixelShaderPauseWhenUnfocused();
     }
 
     // Method Description:
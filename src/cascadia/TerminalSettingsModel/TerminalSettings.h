@@ -164,12 +164,18 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
         INHERITABLE_SETTING(Model::TerminalSettings, bool, AutoMarkPrompts, false);
         INHERITABLE_SETTING(Model::TerminalSettings, bool, ShowMarks, false);
         INHERITABLE_SETTING(Model::TerminalSettings, bool, RightClickContextMenu, false);
+        INHERITABLE_SETTING(Model::TerminalSettings, bool, DedicatedParserThread, false);
+        INHERITABLE_SETTING(Model::TerminalSettings, bool, SpillScrollbackToDisk, false);
+        INHERITABLE_SETTING(Model::TerminalSettings, int32_t, PixelShaderMaxFrameRate, 0);
+        INHERITABLE_SETTING(Model::TerminalSettings, bool, PixelShaderPauseWhenUnfocused, false);
 
     private:
         std::optional<std::array<Microsoft::Terminal::Core::Color, COLOR_TABLE_SIZE>> _ColorTable;
         std::span<Microsoft::Terminal::Core::Color> _getColorTableImpl();
 
         static winrt::com_ptr<implementation::TerminalSettings> _CreateWithProfileCommon(const Model::CascadiaSettings& appSettings, const Model::Profile& profile);
+        static winrt::com_ptr<implementation::TerminalSettings> _CreateWithProfileCached(const Model::CascadiaSettings& appSettings, const Model::Profile& profile);
+        static winrt::Windows::UI::Xaml::ElementTheme _ResolveRequestedTheme(const Model::Theme& currentTheme);
         void _ApplyProfileSettings(const Model::Profile& profile);
 
         void _ApplyGlobalSettings(const Model::GlobalAppSettings& globalSettings) noexcept;
@@ -535,6 +535,14 @@ JSON_ENUM_MAPPER(::winrt::Microsoft::Terminal::Control::ClearBufferType)
     };
 };
 
+JSON_ENUM_MAPPER(::winrt::Microsoft::Terminal::Control::ExportBufferFormat)
+{
+    JSON_MAPPINGS(2) = {
+        pair_type{ "text", ValueType::Text },
+        pair_type{ "vt", ValueType::Vt },
+    };
+};
+
 JSON_FLAG_MAPPER(::winrt::Microsoft::Terminal::Settings::Model::IntenseStyle)
 {
     static constexpr std::array<pair_type, 4> mappings = {
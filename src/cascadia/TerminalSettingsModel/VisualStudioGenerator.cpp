@@ -7,6 +7,8 @@
 #include "VsDevCmdGenerator.h"
 #include "VsDevShellGenerator.h"
 
+#include <shlobj.h>
+
 using namespace winrt::Microsoft::Terminal::Settings::Model;
 
 std::wstring_view VisualStudioGenerator::GetNamespace() const noexcept
@@ -14,6 +16,37 @@ std::wstring_view VisualStudioGenerator::GetNamespace() const noexcept
     return std::wstring_view{ L"Windows.Terminal.VisualStudio" };
 }
 
+// The setup engine keeps the state of each instance in a state.json, which is rewritten whenever
+// the instance is installed, modified or updated. Checking their timestamps is a lot cheaper than
+// QueryInstances(), which needs to start its COM server before it can enumerate anything.
+std::wstring VisualStudioGenerator::GetFingerprint() const
+try
+{
+    wil::unique_cotaskmem_string programData;
+    THROW_IF_FAILED(SHGetKnownFolderPath(FOLDERID_ProgramData, 0, nullptr, &programData));
+    const auto instances = std::filesystem::path{ programData.get() } / L"Microsoft\\VisualStudio\\Packages\\_Instances";
+
+    std::wstring fingerprint;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator{ instances, ec })
+    {
+        const auto lastWriteTime = std::filesystem::last_write_time(entry.path() / L"state.json", ec);
+        if (!ec)
+        {
+            fingerprint.append(entry.path().filename().native());
+            fingerprint.push_back(L':');
+            fingerprint.append(std::to_wstring(lastWriteTime.time_since_epoch().count()));
+            fingerprint.push_back(L';');
+        }
+    }
+    return fingerprint;
+}
+catch (...)
+{
+    LOG_CAUGHT_EXCEPTION();
+    return {};
+}
+
 void VisualStudioGenerator::GenerateProfiles(std::vector<winrt::com_ptr<implementation::Profile>>& profiles) const
 {
     const auto instances = VsSetupConfiguration::QueryInstances();
@@ -4,6 +4,7 @@
 #include "pch.h"
 #include "../TerminalControl/EventArgs.h"
 #include "../TerminalControl/ControlCore.h"
+#include "../TerminalControl/BufferExporter.h"
 #include "MockControlSettings.h"
 #include "MockConnection.h"
 #include "../../inc/TestUtils.h"
@@ -37,6 +38,10 @@ namespace ControlUnitTests
         TEST_METHOD(TestClearScreen);
         TEST_METHOD(TestClearAll);
         TEST_METHOD(TestReadEntireBuffer);
+        TEST_METHOD(TestExportBuffer);
+        TEST_METHOD(TestFindAllMatches);
+        TEST_METHOD(TestOutputCoalescing);
+        TEST_METHOD(TestDedicatedParserThread);
 
         TEST_METHOD(TestSelectCommandSimple);
         TEST_METHOD(TestSelectOutputSimple);
@@ -361,6 +366,151 @@ namespace ControlUnitTests
         VERIFY_ARE_EQUAL(L"This is some text\r\nwith varying amounts\r\nof whitespace\r\n",
                          core->ReadEntireBuffer());
     }
+
+    void ControlCoreTests::TestExportBuffer()
+    {
+        auto [settings, conn] = _createSettingsAndConnection();
+        Log::Comment(L"Create ControlCore object");
+        auto core = createCore(*settings, *conn);
+        VERIFY_IS_NOT_NULL(core);
+        _standardInit(core);
+
+        Log::Comment(L"Print some text");
+        conn->WriteInput(L"This is some text     \r\n");
+        conn->WriteInput(L"\x1b[31mwith\x1b[m varying amounts  \r\n");
+        conn->WriteInput(L"of whitespace         \r\n");
+
+        wchar_t directory[MAX_PATH + 1];
+        VERIFY_WIN32_BOOL_SUCCEEDED(GetTempPathW(ARRAYSIZE(directory), &directory[0]));
+        wchar_t path[MAX_PATH];
+        VERIFY_WIN32_BOOL_SUCCEEDED(GetTempFileNameW(&directory[0], L"wte", 0, &path[0]));
+        const auto cleanup = wil::scope_exit([&]() {
+            DeleteFileW(&path[0]);
+        });
+
+        const auto readFile = [&]() {
+            const wil::unique_hfile file{ CreateFileW(&path[0], GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, 0, nullptr) };
+            VERIFY_IS_TRUE(file.is_valid());
+            std::string content(4096, '\0');
+            DWORD read = 0;
+            VERIFY_WIN32_BOOL_SUCCEEDED(ReadFile(file.get(), content.data(), gsl::narrow<DWORD>(content.size()), &read, nullptr));
+            content.resize(read);
+            return content;
+        };
+
+        Log::Comment(L"Export the buffer as plain text");
+        Control::implementation::BufferExporter{ core->_terminal, Control::ExportBufferFormat::Text }.Export(&path[0]);
+        VERIFY_ARE_EQUAL("This is some text\r\nwith varying amounts\r\nof whitespace\r\n", readFile());
+
+        Log::Comment(L"Export the buffer as VT");
+        Control::implementation::BufferExporter{ core->_terminal, Control::ExportBufferFormat::Vt }.Export(&path[0]);
+        VERIFY_ARE_EQUAL("\x1b[0mThis is some text\r\n\x1b[0;31mwith\x1b[0m varying amounts\r\nof whitespace\r\n\x1b[m", readFile());
+    }
+
+    void ControlCoreTests::TestFindAllMatches()
+    {
+        auto [settings, conn] = _createSettingsAndConnection();
+        Log::Comment(L"Create ControlCore object");
+        auto core = createCore(*settings, *conn);
+        VERIFY_IS_NOT_NULL(core);
+        _standardInit(core);
+
+        Log::Comment(L"Print some text");
+        conn->WriteInput(L"no problems here\r\n");
+        conn->WriteInput(L"  error: one\r\n");
+        conn->WriteInput(L"Error: two\r\n");
+
+        Log::Comment(L"Find all matches, ignoring the case");
+        const auto results = core->FindAllMatches(L"error", false, false).get();
+        VERIFY_ARE_EQUAL(2u, results.Size());
+        VERIFY_ARE_EQUAL(2, results.GetAt(0).Start.X);
+        VERIFY_ARE_EQUAL(1, results.GetAt(0).Start.Y);
+        VERIFY_ARE_EQUAL(L"  error: one", results.GetAt(0).Text);
+        VERIFY_ARE_EQUAL(0, results.GetAt(1).Start.X);
+        VERIFY_ARE_EQUAL(2, results.GetAt(1).Start.Y);
+        VERIFY_ARE_EQUAL(L"Error: two", results.GetAt(1).Text);
+
+        Log::Comment(L"Find all matches, case sensitively and as a regular expression");
+        VERIFY_ARE_EQUAL(1u, core->FindAllMatches(L"error", true, false).get().Size());
+        VERIFY_ARE_EQUAL(2u, core->FindAllMatches(L"^ *[eE]rror:", true, true).get().Size());
+
+        Log::Comment(L"Invalid regular expressions fail the search");
+        auto failed = false;
+        try
+        {
+            core->FindAllMatches(L"(", false, true).get();
+        }
+        catch (const winrt::hresult_invalid_argument&)
+        {
+            failed = true;
+        }
+        VERIFY_IS_TRUE(failed);
+
+        Log::Comment(L"Select a match after more output scrolled the buffer");
+        for (auto i = 0; i < 40; ++i)
+        {
+            conn->WriteInput(L"more output\r\n");
+        }
+        VERIFY_IS_TRUE(core->SelectSearchResult(results.GetAt(1)));
+        VERIFY_IS_TRUE(core->HasSelection());
+        VERIFY_ARE_EQUAL(L"Error", core->SelectedText(true).GetAt(0));
+    }
+
+    void ControlCoreTests::TestOutputCoalescing()
+    {
+        auto [settings, conn] = _createSettingsAndConnection();
+        Log::Comment(L"Create ControlCore object");
+        auto core = createCore(*settings, *conn);
+        VERIFY_IS_NOT_NULL(core);
+        _standardInit(core);
+
+        Log::Comment(L"Output is written immediately while the terminal lock is uncontended");
+        conn->WriteInput(L"Foo\r\n");
+        VERIFY_ARE_EQUAL(0u, core->OutputCoalescingStats().chunksMerged);
+
+        Log::Comment(L"Output is queued up while another thread holds the terminal lock");
+        {
+            auto lock = core->_terminal->LockForWriting();
+            std::thread{ [&]() {
+                conn->WriteInput(L"Bar\r\n");
+                conn->WriteInput(L"Baz\r\n");
+            } }.join();
+
+            const auto stats = core->OutputCoalescingStats();
+            VERIFY_ARE_EQUAL(2u, stats.chunksMerged);
+            VERIFY_ARE_EQUAL(2u, stats.queueDepth);
+            VERIFY_ARE_EQUAL(L"Foo\r\n", core->ReadEntireBuffer());
+        }
+
+        Log::Comment(L"The next chunk writes the queued up ones first, under the same lock");
+        conn->WriteInput(L"Qux\r\n");
+        const auto stats = core->OutputCoalescingStats();
+        VERIFY_ARE_EQUAL(0u, stats.queueDepth);
+        VERIFY_ARE_EQUAL(2u, stats.peakQueueDepth);
+        VERIFY_IS_GREATER_THAN_OR_EQUAL(stats.lockAcquisitionsSaved, 1u);
+        VERIFY_ARE_EQUAL(L"Foo\r\nBar\r\nBaz\r\nQux\r\n", core->ReadEntireBuffer());
+    }
+
+    void ControlCoreTests::TestDedicatedParserThread()
+    {
+        auto [settings, conn] = _createSettingsAndConnection();
+        settings->DedicatedParserThread(true);
+        Log::Comment(L"Create ControlCore object");
+        auto core = createCore(*settings, *conn);
+        VERIFY_IS_NOT_NULL(core);
+        _standardInit(core);
+
+        Log::Comment(L"Print some text, split in the middle of a VT sequence and a surrogate pair");
+        conn->WriteInput(L"Foo\r\n\x1b[");
+        conn->WriteInput(L"32mBar\xD83D");
+        conn->WriteInput(L"\xDE00\x1b[m\r\n");
+
+        Log::Comment(L"Closing the core joins the parser thread, which writes any remaining output");
+        core->Close();
+
+        VERIFY_ARE_EQUAL(L"Foo\r\nBar\xD83D\xDE00\r\n", core->ReadEntireBuffer());
+    }
+
     void _writePrompt(const winrt::com_ptr<MockConnection>& conn, const auto& path)
     {
         conn->WriteInput(L"\x1b]133;D\x7");
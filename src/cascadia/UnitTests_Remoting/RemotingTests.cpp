@@ -1125,7 +1125,9 @@ namespace RemotingUnitTests
 
         Log::Comment(L"Rename p2");
 
-        p2->WindowName(L"foo");
+        Remoting::RenameRequestArgs eventArgs{ L"foo" };
+        p2->RequestRename(eventArgs);
+        VERIFY_IS_TRUE(eventArgs.Succeeded());
 
         VERIFY_ARE_EQUAL(0, m0->_lookupPeasantIdForName(L"two"));
         VERIFY_ARE_EQUAL(p2->GetID(), m0->_lookupPeasantIdForName(L"foo"));
@@ -1209,15 +1211,17 @@ namespace RemotingUnitTests
         Log::Comment(L"Kill peasant 1. Make sure that it gets removed from the monarch.");
         RemotingTests::_killPeasant(m0, p1->GetID());
 
-        // By killing 1, then looking for "two", we happen to iterate over the
-        // corpse of 1 when looking for the peasant named "two". This causes us
-        // to remove 1 while looking for "two". Technically, we shouldn't be
-        // relying on any sort of ordering for an unordered_map iterator, but
-        // this one just so happens to work.
+        // Names are looked up in the monarch's own list, so looking for "two"
+        // doesn't need to ask (or trip over) the corpse of 1 anymore.
         VERIFY_ARE_EQUAL(p2->GetID(), m0->_lookupPeasantIdForName(L"two"));
+        VERIFY_ARE_EQUAL(2u, m0->_peasants.size());
+
+        // Looking for its name asks 1 if it's still alive, which prunes it.
+        VERIFY_ARE_EQUAL(0, m0->_lookupPeasantIdForName(L"one"));
 
         Log::Comment(L"Peasant 1 should have been pruned");
         VERIFY_ARE_EQUAL(1u, m0->_peasants.size());
+        VERIFY_ARE_EQUAL(p2->GetID(), m0->_lookupPeasantIdForName(L"two"));
     }
 
     void RemotingTests::LookupNamedPeasantWhenItDied()
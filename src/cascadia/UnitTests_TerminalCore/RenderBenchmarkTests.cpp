@@ -0,0 +1,318 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "pch.h"
+#include <WexTestClass.h>
+
+#include "../cascadia/TerminalCore/Terminal.hpp"
+#include "../renderer/atlas/AtlasEngine.h"
+#include "../renderer/inc/DummyRenderer.hpp"
+#include "../../inc/DefaultSettings.h"
+#include "consoletaeftemplates.hpp"
+
+using namespace WEX::Common;
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+
+using namespace Microsoft::Terminal::Core;
+using namespace Microsoft::Console::Render;
+using namespace Microsoft::Console::Render::Atlas;
+
+namespace
+{
+    struct Scenario
+    {
+        const wchar_t* name;
+        const wchar_t* fontFace;
+        // Written once before the first frame.
+        std::wstring (*setup)(til::size size);
+        // Written before each frame. Returns an empty string if the frame doesn't write anything.
+        std::wstring (*frame)(til::size size, uint32_t index);
+        bool selection = false;
+        bool retroEffect = false;
+        bool ligatures = false;
+    };
+
+    std::wstring fillScreen(const til::size size, const std::wstring_view pattern, const uint32_t offset)
+    {
+        std::wstring text{ L"\x1b[H" };
+        for (til::CoordType y = 0; y < size.height; ++y)
+        {
+            for (til::CoordType x = 0; x < size.width; ++x)
+            {
+                text.push_back(pattern[(offset + static_cast<size_t>(x) + static_cast<size_t>(y)) % pattern.size()]);
+            }
+            if (y + 1 < size.height)
+            {
+                text.append(L"\r\n");
+            }
+        }
+        return text;
+    }
+
+    std::wstring noSetup(const til::size /*size*/)
+    {
+        return {};
+    }
+
+    // 3 new lines per frame, so that the entire viewport scrolls every frame.
+    std::wstring scrollFrame(const til::size size, const uint32_t index)
+    {
+        std::wstring text;
+        for (uint32_t i = 0; i < 3; ++i)
+        {
+            const auto line = fmt::format(FMT_COMPILE(L"{:>8} The quick brown fox jumps over the lazy dog. 0123456789 "), index * 3 + i);
+            text.append(line, 0, std::min(line.size(), gsl::narrow_cast<size_t>(size.width)));
+            text.append(L"\r\n");
+        }
+        return text;
+    }
+
+    // Every cell of the viewport gets a different 256-color foreground and background, in every frame.
+    std::wstring rainbowFrame(const til::size size, const uint32_t index)
+    {
+        std::wstring text{ L"\x1b[H" };
+        for (til::CoordType y = 0; y < size.height; ++y)
+        {
+            for (til::CoordType x = 0; x < size.width; ++x)
+            {
+                const auto color = (index + static_cast<uint32_t>(x + y * 7)) % 256;
+                fmt::format_to(std::back_inserter(text), FMT_COMPILE(L"\x1b[38;5;{};48;5;{}m{}"), color, 255 - color, static_cast<wchar_t>(L'!' + (index + static_cast<uint32_t>(x)) % 90));
+            }
+            text.append(y + 1 < size.height ? L"\x1b[m\r\n" : L"\x1b[m");
+        }
+        return text;
+    }
+
+    std::wstring cjkFrame(const til::size size, const uint32_t index)
+    {
+        // Wide characters and emoji occupy 2 cells each. Shifting the text
+        // by a cluster each frame makes every row dirty.
+        static constexpr std::wstring_view clusters[]{
+            L"漢", L"字", L"か", L"한", L"국", L"語", L"\U0001F600", L"\U0001F44D\U0001F3FD", L"\U0001F469\u200D\U0001F469\u200D\U0001F467", L"\U0001F1FA\U0001F1F8"
+        };
+
+        std::wstring text{ L"\x1b[H" };
+        for (til::CoordType y = 0; y < size.height; ++y)
+        {
+            for (til::CoordType x = 0; x + 1 < size.width; x += 2)
+            {
+                text.append(clusters[(index + static_cast<uint32_t>(x / 2 + y)) % std::size(clusters)]);
+            }
+            text.append(y + 1 < size.height ? L"\x1b[K\r\n" : L"\x1b[K");
+        }
+        return text;
+    }
+
+    std::wstring ligatureFrame(const til::size size, const uint32_t index)
+    {
+        return fillScreen(size, L"if (a != b && c >= d) { x => y; p->q; r |> s; t === u; v <!-- w --> }; ", index);
+    }
+
+    std::wstring boxDrawingFrame(const til::size size, const uint32_t index)
+    {
+        return fillScreen(size, L"┌─┬─┐│├┼┤└┴┘═║╔╗╚╝░▒▓█▀▄▌▐⠿ ", index);
+    }
+
+    std::wstring staticSetup(const til::size size)
+    {
+        return fillScreen(size, L"The quick brown fox jumps over the lazy dog. ", 0);
+    }
+
+    std::wstring noFrame(const til::size /*size*/, const uint32_t /*index*/)
+    {
+        return {};
+    }
+
+    const Scenario scenarios[]{
+        { L"scroll", L"Cascadia Mono", &noSetup, &scrollFrame },
+        { L"rainbow", L"Cascadia Mono", &noSetup, &rainbowFrame },
+        { L"cjk", L"Cascadia Mono", &noSetup, &cjkFrame },
+        { L"ligatures", L"Cascadia Code", &noSetup, &ligatureFrame, false, false, true },
+        { L"boxdrawing", L"Cascadia Mono", &noSetup, &boxDrawingFrame },
+        { L"selection", L"Cascadia Mono", &staticSetup, &noFrame, true },
+        { L"shader", L"Cascadia Mono", &noSetup, &scrollFrame, false, true },
+    };
+
+    struct Pass
+    {
+        std::vector<double> cpuMilliseconds;
+        std::vector<double> gpuMilliseconds;
+        uint64_t glyphCacheMisses = 0;
+        uint32_t maxGlyphCacheMisses = 0;
+        uint64_t uploadedBytes = 0;
+    };
+}
+
+namespace TerminalCoreUnitTests
+{
+    // Paints scripted workloads through a Renderer and an AtlasEngine that presents into an
+    // offscreen composition swap chain, so that changes to the renderer can be judged by numbers:
+    //   te.exe Terminal.Core.Unit.Tests.dll /name:*AtlasFrameTimes* /select:"@Data:adapter='WARP'"
+    // Add /p:BenchmarkResults=<path> to append the results to that file as JSON lines.
+    //
+    // Every scenario is painted twice on a fresh Terminal: Once to measure the CPU time of
+    // Renderer::PaintFrame(), and once with GPU timestamp queries, which stall the pipeline after every frame.
+    // The glyph cache misses and uploaded bytes are counted during the first pass. Since the glyph atlas is
+    // shared by all engines on a device, the second pass is painted with the glyphs already cached.
+    class RenderBenchmarkTests
+    {
+        TEST_CLASS(RenderBenchmarkTests);
+
+        TEST_METHOD(AtlasFrameTimes);
+
+    private:
+        static constexpr til::size WindowSize{ 1280, 720 };
+        static constexpr uint32_t Frames = 300;
+
+        static Pass _paint(const Scenario& scenario, bool softwareRendering, bool gpuTiming);
+    };
+
+    void RenderBenchmarkTests::AtlasFrameTimes()
+    {
+        BEGIN_TEST_METHOD_PROPERTIES()
+            TEST_METHOD_PROPERTY(L"IsPerfTest", L"true")
+            TEST_METHOD_PROPERTY(L"Data:adapter", L"{Hardware, WARP}")
+            TEST_METHOD_PROPERTY(L"Data:scenario", L"{scroll, rainbow, cjk, ligatures, boxdrawing, selection, shader}")
+        END_TEST_METHOD_PROPERTIES()
+
+        String adapter;
+        String scenarioName;
+        VERIFY_SUCCEEDED(TestData::TryGetValue(L"adapter", adapter));
+        VERIFY_SUCCEEDED(TestData::TryGetValue(L"scenario", scenarioName));
+
+        const auto it = std::find_if(std::begin(scenarios), std::end(scenarios), [&](const Scenario& s) { return scenarioName.CompareNoCase(s.name) == 0; });
+        VERIFY_IS_TRUE(it != std::end(scenarios));
+        const auto& scenario = *it;
+        const auto softwareRendering = adapter.CompareNoCase(L"WARP") == 0;
+
+        auto cpu = _paint(scenario, softwareRendering, false);
+        auto gpu = _paint(scenario, softwareRendering, true);
+
+        const auto percentile = [](std::vector<double>& values, const size_t p) {
+            if (values.empty())
+            {
+                return -1.0;
+            }
+            std::sort(values.begin(), values.end());
+            return values[std::min(values.size() - 1, values.size() * p / 100)];
+        };
+
+        const auto frames = std::max<size_t>(1, cpu.cpuMilliseconds.size());
+        const auto cpuP50 = percentile(cpu.cpuMilliseconds, 50);
+        const auto cpuP95 = percentile(cpu.cpuMilliseconds, 95);
+        const auto cpuP99 = percentile(cpu.cpuMilliseconds, 99);
+        const auto gpuP50 = percentile(gpu.gpuMilliseconds, 50);
+        const auto gpuP95 = percentile(gpu.gpuMilliseconds, 95);
+        const auto gpuP99 = percentile(gpu.gpuMilliseconds, 99);
+        const auto missesPerFrame = static_cast<double>(cpu.glyphCacheMisses) / frames;
+        const auto uploadedPerFrame = static_cast<double>(cpu.uploadedBytes) / frames;
+
+        Log::Comment(NoThrowString().Format(L"%s on %s: %zu frames", scenario.name, static_cast<const wchar_t*>(adapter), cpu.cpuMilliseconds.size()));
+        Log::Comment(NoThrowString().Format(L"cpu: p50 %.3f ms, p95 %.3f ms, p99 %.3f ms", cpuP50, cpuP95, cpuP99));
+        Log::Comment(NoThrowString().Format(L"gpu: p50 %.3f ms, p95 %.3f ms, p99 %.3f ms (%zu frames measured)", gpuP50, gpuP95, gpuP99, gpu.gpuMilliseconds.size()));
+        Log::Comment(NoThrowString().Format(L"glyph cache: %llu misses, %.2f per frame, up to %u in a frame", cpu.glyphCacheMisses, missesPerFrame, cpu.maxGlyphCacheMisses));
+        Log::Comment(NoThrowString().Format(L"uploads: %.0f bytes per frame", uploadedPerFrame));
+
+        String path;
+        if (SUCCEEDED(RuntimeParameters::TryGetValue(L"BenchmarkResults", path)) && !path.IsEmpty())
+        {
+            std::wofstream file{ static_cast<const wchar_t*>(path), std::ios::app };
+            file << fmt::format(FMT_COMPILE(LR"({{"name":"atlas-{}-{}","frames":{},"cpuP50Ms":{:.3f},"cpuP95Ms":{:.3f},"cpuP99Ms":{:.3f},"gpuP50Ms":{:.3f},"gpuP95Ms":{:.3f},"gpuP99Ms":{:.3f},"glyphCacheMisses":{},"glyphCacheMissesPerFrame":{:.2f},"uploadedBytesPerFrame":{:.0f}}})"),
+                                scenario.name,
+                                softwareRendering ? L"warp" : L"hardware",
+                                cpu.cpuMilliseconds.size(),
+                                cpuP50,
+                                cpuP95,
+                                cpuP99,
+                                gpuP50,
+                                gpuP95,
+                                gpuP99,
+                                cpu.glyphCacheMisses,
+                                missesPerFrame,
+                                uploadedPerFrame)
+                 << L'\n';
+        }
+    }
+
+    Pass RenderBenchmarkTests::_paint(const Scenario& scenario, const bool softwareRendering, const bool gpuTiming)
+    {
+        Terminal term;
+        AtlasEngine engine;
+        DummyRenderer renderer{ &term };
+        renderer.AddRenderEngine(&engine);
+
+        // Without an HWND the engine creates a composition swap chain,
+        // which doesn't need to be shown anywhere to be presented.
+        engine.SetCallback([](HANDLE) {});
+        engine.SetSoftwareRendering(softwareRendering);
+        engine.SetRetroTerminalEffect(scenario.retroEffect);
+        engine.EnableGpuTiming(gpuTiming);
+
+        std::unordered_map<std::wstring_view, uint32_t> features;
+        if (scenario.ligatures)
+        {
+            features.emplace(L"calt", 1);
+            features.emplace(L"liga", 1);
+        }
+
+        const FontInfoDesired desiredFont{ scenario.fontFace, 0, DEFAULT_FONT_WEIGHT, 12.0f, CP_UTF8 };
+        FontInfo actualFont{ scenario.fontFace, 0, DEFAULT_FONT_WEIGHT, { 0, 12 }, CP_UTF8, false };
+        VERIFY_SUCCEEDED(engine.UpdateDpi(USER_DEFAULT_SCREEN_DPI));
+        VERIFY_SUCCEEDED(engine.UpdateFont(desiredFont, actualFont, features, {}));
+        VERIFY_SUCCEEDED(engine.SetWindowSize(WindowSize));
+
+        const auto viewport = engine.GetViewportInCharacters(Microsoft::Console::Types::Viewport::FromDimensions({ 0, 0 }, WindowSize));
+        const til::size size{ viewport.Width(), viewport.Height() };
+        term.Create(size, 9001, renderer);
+        term.SetFontInfo(actualFont);
+        VERIFY_SUCCEEDED(engine.Enable());
+
+        {
+            const auto lock = term.LockForWriting();
+            term.Write(scenario.setup(size));
+            if (scenario.selection)
+            {
+                term.SetSelectionAnchor({ 0, 0 });
+            }
+        }
+
+        // The first frame creates the device, the swap chain and compiles the shaders.
+        VERIFY_SUCCEEDED(renderer.PaintFrame());
+
+        Pass pass;
+        pass.cpuMilliseconds.reserve(Frames);
+        pass.gpuMilliseconds.reserve(Frames);
+
+        for (uint32_t index = 0; index < Frames; ++index)
+        {
+            {
+                const auto lock = term.LockForWriting();
+                term.Write(scenario.frame(size, index));
+                if (scenario.selection)
+                {
+                    // Like dragging the mouse back and forth across the entire viewport.
+                    const auto x = static_cast<til::CoordType>(index % static_cast<uint32_t>(size.width));
+                    const auto y = static_cast<til::CoordType>(index * static_cast<uint32_t>(size.height) / Frames);
+                    term.SetSelectionEnd({ x, y });
+                }
+            }
+
+            const auto beg = std::chrono::steady_clock::now();
+            VERIFY_SUCCEEDED(renderer.PaintFrame());
+            const auto end = std::chrono::steady_clock::now();
+
+            const auto counters = engine.LastFrameCounters();
+            pass.cpuMilliseconds.emplace_back(std::chrono::duration<double, std::milli>(end - beg).count());
+            if (counters.gpuMilliseconds >= 0)
+            {
+                pass.gpuMilliseconds.emplace_back(counters.gpuMilliseconds);
+            }
+            pass.glyphCacheMisses += counters.glyphCacheMisses;
+            pass.maxGlyphCacheMisses = std::max(pass.maxGlyphCacheMisses, counters.glyphCacheMisses);
+            pass.uploadedBytes += counters.uploadedBytes;
+        }
+
+        return pass;
+    }
+}
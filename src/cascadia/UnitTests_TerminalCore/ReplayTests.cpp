@@ -0,0 +1,340 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "pch.h"
+#include <WexTestClass.h>
+
+#include "../cascadia/TerminalCore/Terminal.hpp"
+#include "../cascadia/inc/SessionRecording.h"
+#include "../renderer/inc/DummyRenderer.hpp"
+#include "../renderer/inc/RenderEngineBase.hpp"
+#include "consoletaeftemplates.hpp"
+
+using namespace WEX::Common;
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+
+using namespace Microsoft::Terminal::Core;
+using namespace Microsoft::Console::Render;
+using namespace Microsoft::Terminal::SessionRecording;
+
+namespace
+{
+    // A render engine that doesn't draw anything, but keeps track of what's dirty like a real
+    // one would, so that the Renderer walks through the same rows and clusters it would otherwise.
+    class CountingRenderEngine final : public RenderEngineBase
+    {
+    public:
+        size_t lines = 0;
+        size_t clusters = 0;
+
+        HRESULT StartPaint() noexcept { return _dirty ? S_OK : S_FALSE; }
+        HRESULT EndPaint() noexcept
+        {
+            _dirty = {};
+            return S_OK;
+        }
+        HRESULT Present() noexcept { return S_OK; }
+        HRESULT PrepareForTeardown(_Out_ bool* pForcePaint) noexcept
+        {
+            *pForcePaint = false;
+            return S_OK;
+        }
+        HRESULT ScrollFrame() noexcept { return S_OK; }
+        HRESULT Invalidate(const til::rect* psrRegion) noexcept
+        {
+            _dirty |= *psrRegion & _viewport;
+            return S_OK;
+        }
+        HRESULT InvalidateCursor(const til::rect* psrRegion) noexcept { return Invalidate(psrRegion); }
+        HRESULT InvalidateSystem(const til::rect* /*prcDirtyClient*/) noexcept { return InvalidateAll(); }
+        HRESULT InvalidateSelection(const std::vector<til::rect>& rectangles) noexcept
+        {
+            for (const auto& rect : rectangles)
+            {
+                RETURN_IF_FAILED(Invalidate(&rect));
+            }
+            return S_OK;
+        }
+        HRESULT InvalidateScroll(const til::point* /*pcoordDelta*/) noexcept { return InvalidateAll(); }
+        HRESULT InvalidateAll() noexcept
+        {
+            _dirty = _viewport;
+            return S_OK;
+        }
+        HRESULT PaintBackground() noexcept { return S_OK; }
+        HRESULT PaintBufferLine(std::span<const Cluster> clusters, til::point /*coord*/, bool /*fTrimLeft*/, bool /*lineWrapped*/) noexcept
+        {
+            lines++;
+            this->clusters += clusters.size();
+            return S_OK;
+        }
+        HRESULT PaintBufferGridLines(GridLineSet /*lines*/, COLORREF /*color*/, size_t /*cchLine*/, til::point /*coordTarget*/) noexcept { return S_OK; }
+        HRESULT PaintSelection(const til::rect& /*rect*/) noexcept { return S_OK; }
+        HRESULT PaintCursor(const CursorOptions& /*options*/) noexcept { return S_OK; }
+        HRESULT UpdateDrawingBrushes(const TextAttribute& /*textAttributes*/, const RenderSettings& /*renderSettings*/, gsl::not_null<IRenderData*> /*pData*/, bool /*usingSoftFont*/, bool /*isSettingDefaultBrushes*/) noexcept { return S_OK; }
+        HRESULT UpdateFont(const FontInfoDesired& /*FontInfoDesired*/, _Out_ FontInfo& /*FontInfo*/) noexcept { return S_OK; }
+        HRESULT UpdateDpi(int /*iDpi*/) noexcept { return S_OK; }
+        HRESULT UpdateViewport(const til::inclusive_rect& srNewViewport) noexcept
+        {
+            _viewport = { 0, 0, srNewViewport.right - srNewViewport.left + 1, srNewViewport.bottom - srNewViewport.top + 1 };
+            return InvalidateAll();
+        }
+        HRESULT GetProposedFont(const FontInfoDesired& /*FontInfoDesired*/, _Out_ FontInfo& /*FontInfo*/, int /*iDpi*/) noexcept { return S_OK; }
+        HRESULT GetDirtyArea(std::span<const til::rect>& area) noexcept
+        {
+            area = { &_dirty, 1 };
+            return S_OK;
+        }
+        HRESULT GetFontSize(_Out_ til::size* pFontSize) noexcept
+        {
+            *pFontSize = { 1, 1 };
+            return S_OK;
+        }
+        HRESULT IsGlyphWideByFont(std::wstring_view /*glyph*/, _Out_ bool* pResult) noexcept
+        {
+            *pResult = false;
+            return S_OK;
+        }
+
+    protected:
+        HRESULT _DoUpdateTitle(const std::wstring_view /*newTitle*/) noexcept { return S_OK; }
+
+    private:
+        til::rect _viewport;
+        til::rect _dirty;
+    };
+}
+
+namespace TerminalCoreUnitTests
+{
+    // These replay session recordings (see SessionRecording.h) into a headless Terminal,
+    // which is how workloads get attached to performance bug reports. Record one by setting
+    // "experimental.connection.recordingDirectory" in a profile and replay it with:
+    //   te.exe Terminal.Core.Unit.Tests.dll /name:*ReplayRecording /p:Recording=<path to .wtrec>
+    // By default the recording is replayed as fast as possible. Add /p:ReplayRealTime=true
+    // to replay it at its original speed instead, which tells whether the terminal keeps up.
+    // Add /p:BenchmarkResults=<path> to append the results to that file as JSON lines.
+    class ReplayTests
+    {
+        TEST_CLASS(ReplayTests);
+
+        TEST_METHOD(RecordingRoundTrip);
+        TEST_METHOD(ReplayRecording);
+
+    private:
+        // The renderer paints at most once per this interval of the recording's timeline, like at 60 FPS.
+        static constexpr uint64_t FrameInterval = 16667;
+
+        static std::string _syntheticRecording();
+        static void _replay(const char* name, const FileHeader& header, const std::vector<Event>& events, bool realTime);
+    };
+
+    void ReplayTests::RecordingRoundTrip()
+    {
+        std::string data;
+        AppendHeader(data, 120, 30, 1234);
+        AppendEvent(data, EventType::Output, 10, "hello\r\n");
+        const ResizePayload resize{ 80, 24 };
+        AppendEvent(data, EventType::Resize, 20, { reinterpret_cast<const char*>(&resize), sizeof(resize) });
+        // Events of unknown types must be skipped, so that the format can be extended.
+        AppendEvent(data, static_cast<EventType>('?'), 25, "ignored");
+        AppendEvent(data, EventType::Output, 30, "");
+
+        FileHeader header;
+        auto events = Parse(data, header);
+        VERIFY_IS_TRUE(header.columns == 120);
+        VERIFY_IS_TRUE(header.rows == 30);
+        VERIFY_IS_TRUE(header.startTime == 1234);
+        VERIFY_ARE_EQUAL(3u, events.size());
+        VERIFY_ARE_EQUAL(uint64_t{ 10 }, events[0].microseconds);
+        VERIFY_IS_TRUE(events[0].type == EventType::Output);
+        VERIFY_IS_TRUE(events[0].payload == "hello\r\n");
+        VERIFY_IS_TRUE(events[1].type == EventType::Resize);
+        VERIFY_ARE_EQUAL(sizeof(ResizePayload), events[1].payload.size());
+        VERIFY_ARE_EQUAL(uint64_t{ 30 }, events[2].microseconds);
+        VERIFY_IS_TRUE(events[2].payload.empty());
+
+        // A recording that was cut off in the middle of an event is valid up to the event before it.
+        AppendEvent(data, EventType::Output, 40, "truncated");
+        data.resize(data.size() - 3);
+        events = Parse(data, header);
+        VERIFY_ARE_EQUAL(3u, events.size());
+
+        data[0] = 'X';
+        VERIFY_THROWS_SPECIFIC(Parse(data, header), wil::ResultException, [](const wil::ResultException& e) { return e.GetErrorCode() == E_INVALIDARG; });
+    }
+
+    void ReplayTests::ReplayRecording()
+    {
+        BEGIN_TEST_METHOD_PROPERTIES()
+            TEST_METHOD_PROPERTY(L"IsPerfTest", L"true")
+        END_TEST_METHOD_PROPERTIES()
+
+        String path;
+        String realTime;
+        std::ignore = RuntimeParameters::TryGetValue(L"Recording", path);
+        std::ignore = RuntimeParameters::TryGetValue(L"ReplayRealTime", realTime);
+
+        std::string data;
+        if (path.IsEmpty())
+        {
+            data = _syntheticRecording();
+        }
+        else
+        {
+            std::ifstream file{ static_cast<const wchar_t*>(path), std::ios::binary };
+            VERIFY_IS_TRUE(file.good());
+            data.assign(std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{});
+        }
+
+        FileHeader header;
+        const auto events = Parse(data, header);
+        _replay(path.IsEmpty() ? "synthetic" : "recording", header, events, realTime.CompareNoCase(L"true") == 0);
+    }
+
+    // 2 seconds of a full screen TUI that redraws itself every 4ms, and is resized half way through.
+    std::string ReplayTests::_syntheticRecording()
+    {
+        std::string data;
+        AppendHeader(data, 120, 30, 0);
+
+        std::string chunk;
+        for (uint64_t frame = 0; frame < 500; ++frame)
+        {
+            if (frame == 250)
+            {
+                const ResizePayload resize{ 100, 40 };
+                AppendEvent(data, EventType::Resize, frame * 4000, { reinterpret_cast<const char*>(&resize), sizeof(resize) });
+            }
+
+            chunk.clear();
+            for (auto y = 1; y <= 30; ++y)
+            {
+                fmt::format_to(std::back_inserter(chunk), FMT_COMPILE("\x1b[{};1H\x1b[{};{}m{:>6} {:<40}\x1b[m\x1b[K"), y, 30 + (frame + y) % 8, 40 + y % 8, frame * 30 + y, "process");
+            }
+            AppendEvent(data, EventType::Output, frame * 4000, chunk);
+        }
+
+        return data;
+    }
+
+    // Feeds the events to a fresh Terminal and paints a frame whenever the timeline of the recording
+    // crosses into a new FrameInterval, then logs how long parsing and painting took.
+    void ReplayTests::_replay(const char* name, const FileHeader& header, const std::vector<Event>& events, const bool realTime)
+    {
+        Terminal term;
+        CountingRenderEngine engine;
+        DummyRenderer renderer{ &term };
+        renderer.AddRenderEngine(&engine);
+        term.Create({ std::max<til::CoordType>(1, header.columns), std::max<til::CoordType>(1, header.rows) }, 9001, renderer);
+
+        std::wstring text;
+        til::u8state u8State;
+        size_t bytes = 0;
+        size_t resizes = 0;
+        std::chrono::steady_clock::duration parseTime{};
+        std::chrono::steady_clock::duration maxLag{};
+        std::vector<double> frameTimes;
+        uint64_t nextFrame = 0;
+
+        const auto paint = [&]() {
+            const auto beg = std::chrono::steady_clock::now();
+            VERIFY_SUCCEEDED(renderer.PaintFrame());
+            frameTimes.emplace_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - beg).count());
+        };
+
+        const auto start = std::chrono::steady_clock::now();
+
+        for (const auto& event : events)
+        {
+            if (event.microseconds >= nextFrame)
+            {
+                if (nextFrame)
+                {
+                    paint();
+                }
+                nextFrame = (event.microseconds / FrameInterval + 1) * FrameInterval;
+            }
+
+            if (realTime)
+            {
+                const auto due = start + std::chrono::microseconds{ event.microseconds };
+                const auto now = std::chrono::steady_clock::now();
+                if (now < due)
+                {
+                    std::this_thread::sleep_until(due);
+                }
+                else
+                {
+                    maxLag = std::max(maxLag, now - due);
+                }
+            }
+
+            const auto beg = std::chrono::steady_clock::now();
+            const auto lock = term.LockForWriting();
+
+            if (event.type == EventType::Resize)
+            {
+                ResizePayload resize;
+                memcpy(&resize, event.payload.data(), sizeof(resize));
+                VERIFY_SUCCEEDED(term.UserResize({ std::max<til::CoordType>(1, resize.columns), std::max<til::CoordType>(1, resize.rows) }));
+                resizes++;
+            }
+            else
+            {
+                THROW_IF_FAILED(til::u8u16(event.payload, text, u8State));
+                term.Write(text);
+                bytes += event.payload.size();
+            }
+
+            parseTime += std::chrono::steady_clock::now() - beg;
+        }
+
+        paint();
+
+        const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        const auto duration = events.empty() ? 0.0 : events.back().microseconds / 1e6;
+        const auto parseSeconds = std::chrono::duration<double>(parseTime).count();
+        const auto megabytesPerSecond = parseSeconds > 0 ? bytes / parseSeconds / 1e6 : 0.0;
+        const auto lagMilliseconds = std::chrono::duration<double, std::milli>(maxLag).count();
+
+        std::sort(frameTimes.begin(), frameTimes.end());
+        const auto percentile = [&](const size_t p) {
+            return frameTimes[std::min(frameTimes.size() - 1, frameTimes.size() * p / 100)];
+        };
+        const auto slowFrames = gsl::narrow_cast<size_t>(frameTimes.end() - std::upper_bound(frameTimes.begin(), frameTimes.end(), FrameInterval / 1e3));
+        const auto paintMilliseconds = std::accumulate(frameTimes.begin(), frameTimes.end(), 0.0);
+
+        Log::Comment(NoThrowString().Format(L"%hs: %zu events (%zu bytes, %zu resizes) spanning %.3f s, replayed in %.3f s%s", name, events.size(), bytes, resizes, duration, elapsed, realTime ? L" in real time" : L""));
+        Log::Comment(NoThrowString().Format(L"parse: %.3f s, %.1f MB/s", parseSeconds, megabytesPerSecond));
+        Log::Comment(NoThrowString().Format(L"render: %zu frames, %zu lines, %zu clusters, %.3f s", frameTimes.size(), engine.lines, engine.clusters, paintMilliseconds / 1e3));
+        Log::Comment(NoThrowString().Format(L"frames: p50 %.3f ms, p95 %.3f ms, p99 %.3f ms, max %.3f ms, %zu over %.1f ms", percentile(50), percentile(95), percentile(99), frameTimes.back(), slowFrames, FrameInterval / 1e3));
+        if (realTime)
+        {
+            Log::Comment(NoThrowString().Format(L"lag: fell up to %.3f ms behind the recording", lagMilliseconds));
+        }
+
+        String path;
+        if (SUCCEEDED(RuntimeParameters::TryGetValue(L"BenchmarkResults", path)) && !path.IsEmpty())
+        {
+            std::ofstream file{ static_cast<const wchar_t*>(path), std::ios::app };
+            file << fmt::format(FMT_COMPILE(R"({{"name":"replay-{}","realTime":{},"events":{},"bytes":{},"seconds":{:.6f},"parseSeconds":{:.6f},"mbPerSecond":{:.2f},"frames":{},"frameP50Ms":{:.3f},"frameP95Ms":{:.3f},"frameP99Ms":{:.3f},"frameMaxMs":{:.3f},"slowFrames":{},"maxLagMs":{:.3f}}})"),
+                                name,
+                                realTime,
+                                events.size(),
+                                bytes,
+                                elapsed,
+                                parseSeconds,
+                                megabytesPerSecond,
+                                frameTimes.size(),
+                                percentile(50),
+                                percentile(95),
+                                percentile(99),
+                                frameTimes.back(),
+                                slowFrames,
+                                lagMilliseconds)
+                 << '\n';
+        }
+    }
+}
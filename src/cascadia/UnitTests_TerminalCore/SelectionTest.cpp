@@ -16,6 +16,7 @@
 using namespace WEX::Logging;
 using namespace WEX::TestExecution;
 
+using namespace Microsoft::Console::Types;
 using namespace Microsoft::Terminal::Core;
 using namespace winrt::Microsoft::Terminal::Core;
 
@@ -34,12 +35,13 @@ namespace TerminalCoreUnitTests
         // - N/A
         void ValidateSingleRowSelection(Terminal& term, const til::inclusive_rect& expected)
         {
-            // Simulate renderer calling TriggerSelection and acquiring selection area
-            auto selectionRects = term.GetSelectionRects();
+            // Acquire the entire selection area. Unlike GetSelectionRects(),
+            // this isn't limited to the part inside the visible viewport.
+            auto selectionRects = term._GetSelectionRects();
 
             // Validate selection area
             VERIFY_ARE_EQUAL(selectionRects.size(), static_cast<size_t>(1));
-            auto selection = term.GetViewport().ConvertToOrigin(selectionRects[0]).ToInclusive();
+            auto selection = term.GetViewport().ConvertToOrigin(Viewport::FromInclusive(selectionRects[0])).ToInclusive();
 
             VERIFY_ARE_EQUAL(selection, expected);
         }
@@ -297,6 +299,56 @@ namespace TerminalCoreUnitTests
             }
         }
 
+        TEST_METHOD(SelectionRectsAreClippedToViewport)
+        {
+            Terminal term;
+            DummyRenderer renderer{ &term };
+            term.Create({ 10, 10 }, 20, renderer);
+
+            // The visible viewport spans rows 0 to 9 of the 30 rows in the buffer.
+            const auto viewport = term.GetViewport();
+            VERIFY_ARE_EQUAL(0, viewport.Top());
+            VERIFY_ARE_EQUAL(9, viewport.BottomInclusive());
+
+            Log::Comment(L"Line selection reaching beyond the bottom of the viewport");
+            term.SetSelectionAnchor({ 5, 5 });
+            term.SetSelectionEnd({ 3, 25 });
+            {
+                const auto selectionRects = term.GetSelectionRects();
+                VERIFY_ARE_EQUAL(static_cast<size_t>(5), selectionRects.size());
+
+                til::CoordType rowValue = 5;
+                for (const auto& selectionRect : selectionRects)
+                {
+                    const auto left = rowValue == 5 ? 5 : 0;
+                    VERIFY_ARE_EQUAL(til::inclusive_rect({ left, rowValue, 9, rowValue }), selectionRect.ToInclusive());
+                    rowValue++;
+                }
+            }
+
+            Log::Comment(L"Block selection reaching beyond the bottom of the viewport");
+            term.SetBlockSelection(true);
+            {
+                const auto selectionRects = term.GetSelectionRects();
+                VERIFY_ARE_EQUAL(static_cast<size_t>(5), selectionRects.size());
+
+                til::CoordType rowValue = 5;
+                for (const auto& selectionRect : selectionRects)
+                {
+                    VERIFY_ARE_EQUAL(til::inclusive_rect({ 3, rowValue, 5, rowValue }), selectionRect.ToInclusive());
+                    rowValue++;
+                }
+            }
+
+            Log::Comment(L"Selection entirely outside of the viewport");
+            term.SetSelectionAnchor({ 5, 15 });
+            term.SetSelectionEnd({ 3, 25 });
+            VERIFY_ARE_EQUAL(static_cast<size_t>(0), term.GetSelectionRects().size());
+
+            // The selection itself still covers all of its rows.
+            VERIFY_ARE_EQUAL(static_cast<size_t>(11), term._GetSelectionRects().size());
+        }
+
         TEST_METHOD(SelectBoxArea)
         {
             Terminal term;
@@ -4,6 +4,8 @@
 #include "pch.h"
 #include <WexTestClass.h>
 
+#include <future>
+
 #include "../cascadia/TerminalCore/Terminal.hpp"
 #include "MockTermSettings.h"
 #include "../renderer/inc/DummyRenderer.hpp"
@@ -41,6 +43,12 @@ namespace TerminalCoreUnitTests
 
         TEST_METHOD(SetTaskbarProgress);
         TEST_METHOD(SetWorkingDirectory);
+
+        TEST_METHOD(LockInstrumentation);
+        TEST_METHOD(SharedLock);
+
+        TEST_METHOD(ScrollMarksSurviveBufferRotation);
+        TEST_METHOD(CommandBlocks);
     };
 };
 
@@ -476,3 +484,202 @@ void TerminalCoreUnitTests::TerminalApiTest::SetWorkingDirectory()
     stateMachine.ProcessString(L"\x1b]9;9;D:\\中文\x1b\\");
     VERIFY_ARE_EQUAL(term.GetWorkingDirectory(), L"D:\\中文");
 }
+
+void TerminalApiTest::LockInstrumentation()
+{
+    Terminal term;
+    DummyRenderer renderer{ &term };
+    term.Create({ 100, 100 }, 0, renderer);
+
+    Log::Comment(L"Nothing is recorded while the instrumentation is disabled");
+    {
+        auto lock = term.LockForWriting(LockSite::Search);
+    }
+    VERIFY_ARE_EQUAL(0u, term.TakeLockSnapshot()[static_cast<size_t>(LockSite::Search)].count);
+
+    term.EnableLockInstrumentation(true);
+
+    Log::Comment(L"Only the outermost acquisition of the recursive lock is recorded, under its site");
+    {
+        auto outer = term.LockForWriting(LockSite::Selection);
+        auto inner = term.LockForReading(LockSite::Search);
+    }
+    term.Write(L"foo");
+
+    auto snapshot = term.TakeLockSnapshot();
+    VERIFY_ARE_EQUAL(1u, snapshot[static_cast<size_t>(LockSite::Selection)].count);
+    VERIFY_ARE_EQUAL(0u, snapshot[static_cast<size_t>(LockSite::Search)].count);
+    VERIFY_ARE_EQUAL(1u, snapshot[static_cast<size_t>(LockSite::Output)].count);
+    VERIFY_IS_FALSE(InstrumentedLock::FormatSnapshot(snapshot).empty());
+
+    Log::Comment(L"Taking a snapshot resets the statistics");
+    snapshot = term.TakeLockSnapshot();
+    VERIFY_ARE_EQUAL(0u, snapshot[static_cast<size_t>(LockSite::Selection)].count);
+    VERIFY_ARE_EQUAL(0u, snapshot[static_cast<size_t>(LockSite::Output)].count);
+}
+
+void TerminalApiTest::SharedLock()
+{
+    Terminal term;
+    DummyRenderer renderer{ &term };
+    term.Create({ 100, 100 }, 0, renderer);
+    term.EnableLockInstrumentation(true);
+
+    const auto onOtherThread = [](auto&& func) {
+        return std::async(std::launch::async, std::forward<decltype(func)>(func)).get();
+    };
+
+    Log::Comment(L"Any number of readers can hold the lock, but they keep the writers out");
+    {
+        auto reader = term.LockForSharedReading(LockSite::Search);
+        VERIFY_IS_TRUE(onOtherThread([&]() {
+            auto other = term.LockForSharedReading(LockSite::Search);
+            return other.owns_lock();
+        }));
+        VERIFY_IS_FALSE(onOtherThread([&]() {
+            return term.TryLockForWriting().owns_lock();
+        }));
+    }
+    VERIFY_IS_TRUE(onOtherThread([&]() {
+        return term.TryLockForWriting().owns_lock();
+    }));
+
+    auto snapshot = term.TakeLockSnapshot();
+    VERIFY_ARE_EQUAL(2u, snapshot[static_cast<size_t>(LockSite::Search)].sharedCount);
+    VERIFY_ARE_EQUAL(2u, snapshot[static_cast<size_t>(LockSite::Search)].maxReaders);
+
+    Log::Comment(L"A reader can nest its acquisitions even though a writer is waiting");
+    {
+        auto reader = term.LockForSharedReading();
+        auto writer = std::async(std::launch::async, [&]() {
+            auto lock = term.LockForWriting();
+            return term.GetViewportRelativeCursorPosition();
+        });
+        VERIFY_IS_TRUE(writer.wait_for(std::chrono::milliseconds(50)) == std::future_status::timeout);
+        {
+            auto nested = term.LockForSharedReading();
+        }
+        reader.unlock();
+        writer.get();
+    }
+
+    Log::Comment(L"Reading while writing is a recursive exclusive acquisition");
+    {
+        auto writer = term.LockForWriting(LockSite::Output);
+        {
+            auto reader = term.LockForSharedReading(LockSite::Search);
+        }
+        VERIFY_IS_FALSE(onOtherThread([&]() {
+            return term.TryLockForWriting().owns_lock();
+        }));
+    }
+    snapshot = term.TakeLockSnapshot();
+    VERIFY_ARE_EQUAL(1u, snapshot[static_cast<size_t>(LockSite::Output)].count);
+    VERIFY_ARE_EQUAL(0u, snapshot[static_cast<size_t>(LockSite::Search)].count);
+}
+
+void TerminalApiTest::ScrollMarksSurviveBufferRotation()
+{
+    using Microsoft::Console::VirtualTerminal::DispatchTypes::MarkCategory;
+    using Microsoft::Console::VirtualTerminal::DispatchTypes::ScrollMark;
+
+    // 10 rows of viewport and 10 rows of scrollback.
+    Terminal term;
+    DummyRenderer renderer{ &term };
+    term.Create({ 80, 10 }, 10, renderer);
+
+    // Put a prompt on every other row, for a total of 60 rows.
+    // The buffer thus gets rotated by 41 rows.
+    for (auto i = 0; i < 30; i++)
+    {
+        ScrollMark mark;
+        mark.category = MarkCategory::Prompt;
+        term.MarkPrompt(mark);
+        term.Write(L"$ ");
+        term.MarkCommandStart();
+        term.Write(L"cmd\r\n");
+        term.MarkOutputStart();
+        term.Write(L"out\r\n");
+        term.MarkCommandFinish(0);
+    }
+
+    // The prompts at rows 0 to 41 fell out of the buffer. The remaining ones moved up by 41 rows.
+    const auto& marks = term.GetScrollMarks();
+    VERIFY_ARE_EQUAL(9u, marks.size());
+    for (size_t i = 0; i < marks.size(); i++)
+    {
+        const auto& m = marks[i];
+        const auto y = gsl::narrow_cast<til::CoordType>(1 + 2 * i);
+        VERIFY_ARE_EQUAL((til::point{ 0, y }), m.start);
+        VERIFY_ARE_EQUAL((til::point{ 2, y }), m.end);
+        VERIFY_ARE_EQUAL((til::point{ 0, y + 1 }), *m.commandEnd);
+        VERIFY_ARE_EQUAL((til::point{ 0, y + 2 }), *m.outputEnd);
+        VERIFY_IS_TRUE(MarkCategory::Success == m.category);
+    }
+
+    VERIFY_ARE_EQUAL(2u, term.GetScrollMarks(0, 5).size());
+    VERIFY_ARE_EQUAL(0u, term.GetScrollMarks(18, 20).size());
+
+    // UI marks are sorted in as well and don't interfere with the prompt that FTCS sequences amend.
+    term.AddMark({}, { 0, 4 }, { 0, 4 }, true);
+    ScrollMark mark;
+    mark.category = MarkCategory::Prompt;
+    term.MarkPrompt(mark);
+    term.AddMark({}, { 0, 0 }, { 0, 0 }, true);
+    term.Write(L"$ ");
+    term.MarkCommandStart();
+
+    const auto& marksAfter = term.GetScrollMarks();
+    VERIFY_ARE_EQUAL(12u, marksAfter.size());
+    VERIFY_ARE_EQUAL((til::point{ 0, 0 }), marksAfter.front().start);
+    VERIFY_ARE_EQUAL((til::point{ 0, 19 }), marksAfter.back().start);
+    VERIFY_ARE_EQUAL((til::point{ 2, 19 }), marksAfter.back().end);
+}
+
+void TerminalApiTest::CommandBlocks()
+{
+    using Microsoft::Console::VirtualTerminal::DispatchTypes::MarkCategory;
+    using Microsoft::Console::VirtualTerminal::DispatchTypes::ScrollMark;
+
+    Terminal term;
+    DummyRenderer renderer{ &term };
+    term.Create({ 80, 10 }, 10, renderer);
+
+    const auto runCommand = [&](const std::wstring_view command, const std::wstring_view output, const unsigned int exitCode) {
+        ScrollMark mark;
+        mark.category = MarkCategory::Prompt;
+        term.MarkPrompt(mark);
+        term.Write(L"$ ");
+        term.MarkCommandStart();
+        term.Write(command);
+        term.Write(L"\r\n");
+        term.MarkOutputStart();
+        term.Write(output);
+        term.MarkCommandFinish(exitCode);
+    };
+
+    VERIFY_IS_FALSE(term.GetLastCommandBlock().has_value());
+
+    runCommand(L"true", L"", 0);
+    runCommand(L"ls", L"foo\r\nbar\r\n", 1);
+
+    // A prompt without a command yet.
+    ScrollMark mark;
+    mark.category = MarkCategory::Prompt;
+    term.MarkPrompt(mark);
+    term.Write(L"$ ");
+
+    VERIFY_ARE_EQUAL(3u, term.GetCommandBlocks(0, 10).size());
+    VERIFY_ARE_EQUAL(1u, term.GetCommandBlocks(1, 2).size());
+
+    const auto block = term.GetLastCommandBlock();
+    VERIFY_IS_TRUE(block.has_value());
+    VERIFY_ARE_EQUAL((til::point{ 0, 1 }), block->prompt.start);
+    VERIFY_ARE_EQUAL((til::point{ 2, 1 }), block->command.start);
+    VERIFY_ARE_EQUAL((til::point{ 0, 2 }), block->output.start);
+    VERIFY_ARE_EQUAL((til::point{ 0, 4 }), block->output.end);
+    VERIFY_ARE_EQUAL(1u, block->exitCode.value_or(0));
+
+    VERIFY_ARE_EQUAL(L"ls", term.GetCommandBlockText(block->command));
+    VERIFY_ARE_EQUAL(L"foo\r\nbar", term.GetCommandBlockText(block->output));
+}
@@ -53,6 +53,8 @@ class TerminalCoreUnitTests::TerminalBufferTests final
 
     TEST_METHOD(TestCursorNotifications);
 
+    TEST_METHOD(TestFastForwardLargeOutput);
+
     TEST_METHOD_SETUP(MethodSetup)
     {
         // STEP 1: Set up the Terminal
@@ -636,3 +638,47 @@ void TerminalBufferTests::TestCursorNotifications()
     VERIFY_ARE_EQUAL(0, expectedCallbacks);
     VERIFY_IS_TRUE(callbackWasCalled);
 }
+
+void TerminalBufferTests::TestFastForwardLargeOutput()
+{
+    // Enough lines to scroll the first half of them out of the 132 rows of buffer.
+    std::wstring output;
+    for (auto i = 0; i < 400; i++)
+    {
+        output.append(fmt::format(L"\x1b[{}mline {}\tfoo\x1b[m bar\r\n", 31 + i % 7, i));
+    }
+    output.append(L"\x1b[1;32mprompt> ");
+
+    Log::Comment(L"Write the output at once, which fast-forwards its beginning.");
+    VERIFY_ARE_NOT_EQUAL(0u, term->_fastForwardLength(output));
+    term->Write(output);
+
+    Log::Comment(L"Write the output in small chunks into another terminal, which doesn't.");
+    Terminal reference;
+    DummyRenderer referenceRenderer{ &reference };
+    reference.Create({ TerminalViewWidth, TerminalViewHeight }, TerminalHistoryLength, referenceRenderer);
+    for (size_t i = 0; i < output.size(); i += 64)
+    {
+        const auto chunk = std::wstring_view{ output }.substr(i, 64);
+        VERIFY_ARE_EQUAL(0u, reference._fastForwardLength(chunk));
+        reference.Write(chunk);
+    }
+
+    auto& termTb = *term->_mainBuffer;
+    auto& referenceTb = *reference._mainBuffer;
+    VERIFY_ARE_EQUAL(referenceTb.GetCursor().GetPosition(), termTb.GetCursor().GetPosition());
+    VERIFY_IS_TRUE(referenceTb.GetCurrentAttributes() == termTb.GetCurrentAttributes());
+    VERIFY_ARE_EQUAL(reference._mutableViewport.Top(), term->_mutableViewport.Top());
+
+    for (til::CoordType y = 0; y < termTb.GetSize().Height(); y++)
+    {
+        const auto& row = termTb.GetRowByOffset(y);
+        const auto& referenceRow = referenceTb.GetRowByOffset(y);
+        VERIFY_ARE_EQUAL(referenceRow.GetText(), row.GetText());
+        VERIFY_IS_TRUE(referenceRow.Attributes() == row.Attributes());
+    }
+
+    Log::Comment(L"Output with anything but text and SGR sequences isn't fast-forwarded.");
+    output.insert(0, L"\x1b[2J");
+    VERIFY_ARE_EQUAL(0u, term->_fastForwardLength(output));
+}
@@ -0,0 +1,292 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "pch.h"
+#include <WexTestClass.h>
+
+#include "../cascadia/TerminalCore/Terminal.hpp"
+#include "../renderer/inc/DummyRenderer.hpp"
+#include "consoletaeftemplates.hpp"
+
+using namespace WEX::Common;
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+
+using namespace Microsoft::Terminal::Core;
+
+// The benchmarks below report how many heap allocations processing their input caused.
+// To count them, this binary replaces the global operator new. Apart from an atomic
+// increment this doesn't affect any of the other tests in it.
+static std::atomic<size_t> s_allocationCount{ 0 };
+
+_Ret_notnull_ _Post_writable_byte_size_(size) void* __CRTDECL operator new(size_t size)
+{
+    s_allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (const auto p = malloc(size ? size : 1))
+    {
+        return p;
+    }
+    throw std::bad_alloc{};
+}
+
+void __CRTDECL operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void __CRTDECL operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+namespace TerminalCoreUnitTests
+{
+    // These run the entire output path (StateMachine, OutputStateMachineEngine, AdaptDispatch
+    // and TextBuffer) of a headless Terminal over a few typical kinds of output.
+    // Run them with: te.exe Terminal.Core.Unit.Tests.dll /select:"@IsPerfTest=true"
+    // Add /p:BenchmarkResults=<path> to append the results to that file as JSON lines.
+    class ThroughputTests
+    {
+        TEST_CLASS(ThroughputTests);
+
+        TEST_METHOD(AsciiThroughput);
+        TEST_METHOD(SgrDenseThroughput);
+        TEST_METHOD(CjkThroughput);
+        TEST_METHOD(EmojiThroughput);
+        TEST_METHOD(CursorAddressedTuiThroughput);
+        TEST_METHOD(DrcsThroughput);
+        TEST_METHOD(DisabledTracingOverhead);
+
+    private:
+        // The size of each corpus in UTF-16 code units.
+        static constexpr size_t CorpusSize = 2 * 1024 * 1024;
+        // How often each corpus is fed to the Terminal.
+        static constexpr auto iterations = 4;
+
+        static std::wstring _sgrCorpus();
+        static double _measure(const char* name, const std::wstring_view& input);
+    };
+
+    // Something that resembles colored compiler diagnostics or "ls --color".
+    std::wstring ThroughputTests::_sgrCorpus()
+    {
+        std::wstring input;
+        input.reserve(CorpusSize);
+        for (auto i = 0; input.size() < CorpusSize; ++i)
+        {
+            fmt::format_to(std::back_inserter(input), FMT_COMPILE(L"\x1b[{};{}mfoo.cpp\x1b[m:{}:\x1b[38;5;{}mwarning\x1b[m: \x1b[38;2;{};{};{}munused variable\x1b[K\r\n"), i % 2, 30 + i % 8, i, i % 256, i % 256, (i * 7) % 256, (i * 13) % 256);
+        }
+        return input;
+    }
+
+    // Feeds the input to a fresh Terminal a few times over and logs the throughput.
+    // Bytes are counted in UTF-8, because that's what applications write to the terminal.
+    // Returns the time it took to process all iterations in seconds.
+    double ThroughputTests::_measure(const char* name, const std::wstring_view& input)
+    {
+        Terminal term;
+        DummyRenderer renderer{ &term };
+        term.Create({ 120, 30 }, 9001, renderer);
+
+        std::string utf8;
+        THROW_IF_FAILED(til::u16u8(input, utf8));
+        const auto bytes = utf8.size() * iterations;
+
+        // Warm up, so that all rows of the buffer have been committed already.
+        term.Write(input);
+
+        const auto allocationsBefore = s_allocationCount.load(std::memory_order_relaxed);
+        const auto start = std::chrono::steady_clock::now();
+
+        for (auto i = 0; i < iterations; ++i)
+        {
+            term.Write(input);
+        }
+
+        const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        const auto allocations = s_allocationCount.load(std::memory_order_relaxed) - allocationsBefore;
+        const auto megabytesPerSecond = bytes / elapsed / 1e6;
+        const auto nanosecondsPerByte = elapsed * 1e9 / bytes;
+
+        Log::Comment(NoThrowString().Format(L"%hs: %.1f MB/s, %.2f ns/byte, %zu allocations (%.2f per MB)", name, megabytesPerSecond, nanosecondsPerByte, allocations, allocations / (bytes / 1e6)));
+
+        String path;
+        if (SUCCEEDED(RuntimeParameters::TryGetValue(L"BenchmarkResults", path)) && !path.IsEmpty())
+        {
+            std::ofstream file{ static_cast<const wchar_t*>(path), std::ios::app };
+            file << fmt::format(FMT_COMPILE(R"({{"name":"{}","bytes":{},"seconds":{:.6f},"mbPerSecond":{:.2f},"nsPerByte":{:.3f},"allocations":{}}})"), name, bytes, elapsed, megabytesPerSecond, nanosecondsPerByte, allocations) << '\n';
+        }
+
+        return elapsed;
+    }
+
+    void ThroughputTests::AsciiThroughput()
+    {
+        BEGIN_TEST_METHOD_PROPERTIES()
+            TEST_METHOD_PROPERTY(L"IsPerfTest", L"true")
+        END_TEST_METHOD_PROPERTIES()
+
+        // 78 column wide lines, similar to what you'd get from a build log.
+        std::wstring input;
+        input.reserve(CorpusSize);
+        for (auto i = 0; input.size() < CorpusSize; ++i)
+        {
+            for (auto x = 0; x < 78; ++x)
+            {
+                input.push_back(static_cast<wchar_t>(L'!' + (i + x) % 94));
+            }
+            input.append(L"\r\n");
+        }
+
+        _measure("ascii", input);
+    }
+
+    void ThroughputTests::SgrDenseThroughput()
+    {
+        BEGIN_TEST_METHOD_PROPERTIES()
+            TEST_METHOD_PROPERTY(L"IsPerfTest", L"true")
+        END_TEST_METHOD_PROPERTIES()
+
+        _measure("sgr", _sgrCorpus());
+    }
+
+    void ThroughputTests::CjkThroughput()
+    {
+        BEGIN_TEST_METHOD_PROPERTIES()
+            TEST_METHOD_PROPERTY(L"IsPerfTest", L"true")
+        END_TEST_METHOD_PROPERTIES()
+
+        // Lines of wide CJK ideographs, mixed with some ASCII like in source code comments.
+        std::wstring input;
+        input.reserve(CorpusSize);
+        for (auto i = 0; input.size() < CorpusSize; ++i)
+        {
+            input.append(L"// ");
+            for (auto x = 0; x < 36; ++x)
+            {
+                input.push_back(static_cast<wchar_t>(0x4e00 + (i * 36 + x) % 0x5000));
+            }
+            input.append(L"\r\n");
+        }
+
+        _measure("cjk", input);
+    }
+
+    void ThroughputTests::EmojiThroughput()
+    {
+        BEGIN_TEST_METHOD_PROPERTIES()
+            TEST_METHOD_PROPERTY(L"IsPerfTest", L"true")
+        END_TEST_METHOD_PROPERTIES()
+
+        // Surrogate pairs, some of them joined into sequences, as found in chat logs or fancy prompts.
+        std::wstring input;
+        input.reserve(CorpusSize);
+        for (auto i = 0; input.size() < CorpusSize; ++i)
+        {
+            for (auto x = 0; x < 24; ++x)
+            {
+                const auto ch = 0x1f600 + (i * 24 + x) % 0x50;
+                input.push_back(static_cast<wchar_t>(0xd800 + ((ch - 0x10000) >> 10)));
+                input.push_back(static_cast<wchar_t>(0xdc00 + ((ch - 0x10000) & 0x3ff)));
+                input.push_back(L' ');
+            }
+            input.append(L"\U0001F9D1\x200d\U0001F52C\r\n");
+        }
+
+        _measure("emoji", input);
+    }
+
+    void ThroughputTests::CursorAddressedTuiThroughput()
+    {
+        BEGIN_TEST_METHOD_PROPERTIES()
+            TEST_METHOD_PROPERTY(L"IsPerfTest", L"true")
+        END_TEST_METHOD_PROPERTIES()
+
+        // Full screen repaints with absolute cursor positioning, like htop or vim produce:
+        // Each frame scrolls a region with margins, then rewrites every line of the screen.
+        std::wstring input;
+        input.reserve(CorpusSize);
+        for (auto frame = 0; input.size() < CorpusSize; ++frame)
+        {
+            input.append(L"\x1b[2;29r\x1b[29;1H\n\x1b[r");
+            for (auto y = 1; y <= 30; ++y)
+            {
+                fmt::format_to(std::back_inserter(input), FMT_COMPILE(L"\x1b[{};1H\x1b[{};{}m{:>6} {:<40}\x1b[m\x1b[K"), y, 30 + (frame + y) % 8, 40 + y % 8, frame * 30 + y, L"process");
+                if (y % 4 == 0)
+                {
+                    input.append(L"\x1b[10X\x1b[3P\x1b[2@");
+                }
+            }
+        }
+
+        _measure("tui", input);
+    }
+
+    void ThroughputTests::DrcsThroughput()
+    {
+        BEGIN_TEST_METHOD_PROPERTIES()
+            TEST_METHOD_PROPERTY(L"IsPerfTest", L"true")
+        END_TEST_METHOD_PROPERTIES()
+
+        // Soft font downloads (DECDLD), whose sixel data is decoded by the FontBuffer, followed by text that uses them.
+        std::wstring glyphs;
+        for (auto ch = 0; ch < 94; ++ch)
+        {
+            if (ch)
+            {
+                glyphs.push_back(L';');
+            }
+            fmt::format_to(std::back_inserter(glyphs), FMT_COMPILE(L"{}~~{}~~??/??~~??~~??"), static_cast<wchar_t>(L'?' + ch % 64), static_cast<wchar_t>(L'?' + (ch * 3) % 64));
+        }
+
+        std::wstring input;
+        input.reserve(CorpusSize);
+        while (input.size() < CorpusSize)
+        {
+            input.append(L"\x1bP1;1;1;0;0;2;0;0{ @");
+            input.append(glyphs);
+            input.append(L"\x1b\\\x1b( @!\"#$%&'()*+,-./0123456789\x1b(B\r\n");
+        }
+
+        _measure("drcs", input);
+    }
+
+    void ThroughputTests::DisabledTracingOverhead()
+    {
+        BEGIN_TEST_METHOD_PROPERTIES()
+            TEST_METHOD_PROPERTY(L"IsPerfTest", L"true")
+        END_TEST_METHOD_PROPERTIES()
+
+        Microsoft::Console::VirtualTerminal::ParserTracing tracing;
+        tracing.Refresh();
+        if (tracing.IsEnabled())
+        {
+            Log::Result(TestResults::Skipped, L"A trace session is listening to the parser. This measures the cost of disabled tracing.");
+            return;
+        }
+
+        const auto input = _sgrCorpus();
+        const auto parseSeconds = _measure("sgr", input);
+
+        // Characters inside an escape sequence pass through at most one of each of these
+        // trace points. Hitting all of them for every character, including the ones that
+        // the parser prints in bulk, gives us an upper bound for what the gates cost it.
+        const auto start = std::chrono::steady_clock::now();
+        for (auto i = 0; i < iterations; ++i)
+        {
+            for (const auto wch : input)
+            {
+                tracing.TraceCharInput(wch);
+                tracing.TraceOnEvent(L"CsiParam");
+                tracing.TraceOnAction(L"Param");
+                tracing.TraceStateChange(L"CsiParam");
+                tracing.AddSequenceTrace(wch);
+            }
+            tracing.DispatchSequenceTrace(true);
+        }
+        const auto tracingSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        Log::Comment(NoThrowString().Format(L"disabled tracing: %.6fs out of %.6fs (%.3f%%)", tracingSeconds, parseSeconds, tracingSeconds / parseSeconds * 100));
+        VERIFY_IS_LESS_THAN(tracingSeconds, parseSeconds * 0.01);
+    }
+}
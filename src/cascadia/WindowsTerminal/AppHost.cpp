@@ -286,9 +286,23 @@ void AppHost::_HandleCommandlineArgs(const Remoting::WindowRequestedArgs& window
 // - <none>
 void AppHost::Initialize()
 {
+    TraceLoggingWrite(g_hWindowsTerminalProvider,
+                      "XamlIslandInitialize",
+                      TraceLoggingDescription("Creating the XAML island of a window"),
+                      TraceLoggingOpcode(WINEVENT_OPCODE_START),
+                      TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+                      TraceLoggingKeyword(TIL_KEYWORD_TRACE));
+
     // You aren't allowed to do ANY XAML before this line!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
     _window->Initialize();
 
+    TraceLoggingWrite(g_hWindowsTerminalProvider,
+                      "XamlIslandInitialize",
+                      TraceLoggingDescription("Creating the XAML island of a window"),
+                      TraceLoggingOpcode(WINEVENT_OPCODE_STOP),
+                      TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+                      TraceLoggingKeyword(TIL_KEYWORD_TRACE));
+
     if (auto withWindow{ _windowLogic.try_as<IInitializeWithWindow>() })
     {
         // You aren't allowed to do anything with the TerminalPage before this line!!!!!!!
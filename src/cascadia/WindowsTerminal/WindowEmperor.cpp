@@ -24,8 +24,7 @@ using VirtualKeyModifiers = winrt::Windows::System::VirtualKeyModifiers;
 #define TERMINAL_MESSAGE_CLASS_NAME L"TERMINAL_MESSAGE_CLASS"
 extern "C" IMAGE_DOS_HEADER __ImageBase;
 
-WindowEmperor::WindowEmperor() noexcept :
-    _app{}
+WindowEmperor::WindowEmperor() noexcept
 {
     _manager.FindTargetWindowRequested([this](const winrt::Windows::Foundation::IInspectable& /*sender*/,
                                               const winrt::Microsoft::Terminal::Remoting::FindTargetWindowArgs& findWindowArgs) {
@@ -35,14 +34,22 @@ WindowEmperor::WindowEmperor() noexcept :
             findWindowArgs.ResultTargetWindowName(targetWindow.WindowName());
         }
     });
-
-    _dispatcher = winrt::Windows::System::DispatcherQueue::GetForCurrentThread();
 }
 
 WindowEmperor::~WindowEmperor()
 {
-    _app.Close();
-    _app = nullptr;
+    if (_app)
+    {
+        _app.Close();
+        _app = nullptr;
+    }
+}
+
+// Initializes XAML on the main thread, which is required before any window thread can use it.
+void WindowEmperor::_initializeApp()
+{
+    _app = winrt::TerminalApp::App{};
+    _dispatcher = winrt::Windows::System::DispatcherQueue::GetForCurrentThread();
 }
 
 void _buildArgsFromCommandline(std::vector<winrt::hstring>& args)
@@ -83,19 +90,36 @@ bool WindowEmperor::HandleCommandlineArgs()
 
     Remoting::CommandlineArgs eventArgs{ { args }, { cwd }, showWindow };
 
-    const auto isolatedMode{ _app.Logic().IsolatedMode() };
+    // If another Terminal process is running, it'll handle the commandline with its
+    // own settings. Loading ours and initializing XAML would only slow down scripts
+    // that run `wt -w 0 nt` and the like, so we hand it off before doing either.
+    const auto forwarded = _manager.ProposeCommandlineToExistingMonarch(eventArgs);
+    auto shouldCreateWindow = false;
 
-    const auto result = _manager.ProposeCommandline(eventArgs, isolatedMode);
-
-    if (result.ShouldCreateWindow())
+    if (!forwarded)
     {
-        _createNewWindowThread(Remoting::WindowRequestedArgs{ result, eventArgs });
+        // Initializing XAML and loading the settings both take a while and don't depend
+        // on each other, so the settings are loaded in the background in the meantime.
+        winrt::TerminalApp::AppLogic::PreloadSettings();
+        _initializeApp();
+
+        const auto isolatedMode{ _app.Logic().IsolatedMode() };
+
+        const auto result = _manager.ProposeCommandline(eventArgs, isolatedMode);
+        shouldCreateWindow = result.ShouldCreateWindow();
+
+        if (shouldCreateWindow)
+        {
+            _createNewWindowThread(Remoting::WindowRequestedArgs{ result, eventArgs });
 
-        _becomeMonarch();
+            _becomeMonarch();
+        }
     }
-    else
+
+    if (!shouldCreateWindow)
     {
-        const auto res = _app.Logic().GetParseCommandlineMessage(eventArgs.Commandline());
+        // Parsing the commandline doesn't need the settings.
+        const auto res = winrt::TerminalApp::AppLogic::GetParseCommandlineMessage(eventArgs.Commandline());
         if (!res.Message.empty())
         {
             AppHost::s_DisplayMessageBox(res);
@@ -103,7 +127,7 @@ bool WindowEmperor::HandleCommandlineArgs()
         }
     }
 
-    return result.ShouldCreateWindow();
+    return shouldCreateWindow;
 }
 
 void WindowEmperor::WaitForWindows()
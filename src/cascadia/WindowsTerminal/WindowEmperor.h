@@ -30,13 +30,15 @@ public:
     bool HandleCommandlineArgs();
 
 private:
+    void _initializeApp();
     void _createNewWindowThread(const winrt::Microsoft::Terminal::Remoting::WindowRequestedArgs& args);
 
     [[nodiscard]] static LRESULT __stdcall _wndProc(HWND const window, UINT const message, WPARAM const wparam, LPARAM const lparam) noexcept;
     LRESULT _messageHandler(UINT const message, WPARAM const wParam, LPARAM const lParam) noexcept;
     wil::unique_hwnd _window;
 
-    winrt::TerminalApp::App _app;
+    // Only initialized if this process ends up hosting windows. See HandleCommandlineArgs().
+    winrt::TerminalApp::App _app{ nullptr };
     winrt::Windows::System::DispatcherQueue _dispatcher{ nullptr };
     winrt::Microsoft::Terminal::Remoting::WindowManager _manager;
 
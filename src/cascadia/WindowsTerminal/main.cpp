@@ -86,6 +86,11 @@ static void EnsureNativeArchitecture()
 int __stdcall wWinMain(HINSTANCE, HINSTANCE, LPWSTR, int)
 {
     TraceLoggingRegister(g_hWindowsTerminalProvider);
+    TraceLoggingWrite(g_hWindowsTerminalProvider,
+                      "ProcessStarted",
+                      TraceLoggingDescription("Logged when wWinMain is entered"),
+                      TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+                      TraceLoggingKeyword(TIL_KEYWORD_TRACE));
     ::Microsoft::Console::ErrorReporting::EnableFallbackFailureReporting(g_hWindowsTerminalProvider);
 
     // If Terminal is spawned by a shortcut that requests that it run in a new process group
@@ -114,8 +119,26 @@ int __stdcall wWinMain(HINSTANCE, HINSTANCE, LPWSTR, int)
     // doing that, we can safely init as STA before any WinRT dispatches.
     winrt::init_apartment(winrt::apartment_type::single_threaded);
 
+    // The startup stages are each bracketed by a pair of start/stop events.
+    // See the Startup profile in Terminal.wprp and tools/Measure-TerminalStartup.ps1.
+    TraceLoggingWrite(g_hWindowsTerminalProvider,
+                      "WindowEmperor",
+                      TraceLoggingDescription("Creating the WindowEmperor and handling the commandline"),
+                      TraceLoggingOpcode(WINEVENT_OPCODE_START),
+                      TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+                      TraceLoggingKeyword(TIL_KEYWORD_TRACE));
+
     const auto emperor = std::make_shared<::WindowEmperor>();
-    if (emperor->HandleCommandlineArgs())
+    const auto shouldCreateWindow = emperor->HandleCommandlineArgs();
+
+    TraceLoggingWrite(g_hWindowsTerminalProvider,
+                      "WindowEmperor",
+                      TraceLoggingDescription("Creating the WindowEmperor and handling the commandline"),
+                      TraceLoggingOpcode(WINEVENT_OPCODE_STOP),
+                      TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+                      TraceLoggingKeyword(TIL_KEYWORD_TRACE));
+
+    if (shouldCreateWindow)
     {
         emperor->WaitForWindows();
     }
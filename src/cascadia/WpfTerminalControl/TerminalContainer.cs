@@ -478,7 +478,7 @@ namespace Microsoft.Terminal.Wpf
                 return;
             }
 
-            NativeMethods.TerminalSendOutput(this.terminal, e.Data);
+            NativeMethods.TerminalSendOutputBuffer(this.terminal, e.Data, (UIntPtr)e.Data.Length);
         }
 
         private void OnScroll(int viewTop, int viewHeight, int bufferSize)
@@ -35,6 +35,15 @@ namespace Microsoft.Terminal.Wpf
             this.GotFocus += this.TerminalControl_GotFocus;
         }
 
+        /// <summary>
+        /// Sets a value indicating whether terminal controls created from now on render with AtlasEngine.
+        /// This setting applies to the entire process. Controls that already exist keep their renderer.
+        /// </summary>
+        public static bool UseAtlasEngine
+        {
+            set => NativeMethods.TerminalSetUseAtlasEngine(value);
+        }
+
         /// <summary>
         /// Gets the current character rows available to the terminal.
         /// </summary>
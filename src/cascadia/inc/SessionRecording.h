@@ -0,0 +1,122 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- SessionRecording.h
+
+Abstract:
+- The file format of the session recordings written by ConptyConnection
+  (see SessionRecorder.h) and replayed by the ReplayTests in UnitTests_TerminalCore.
+- Like asciicast it's a header followed by a stream of timestamped events,
+  but binary, so that recording doesn't have to escape or transcode anything:
+  Output events contain the raw (UTF-8) bytes as they were read from the pipe.
+- All integers are little endian. A recording that was cut short (for instance
+  because the terminal crashed) is still valid up to its last complete event.
+--*/
+
+#pragma once
+
+namespace Microsoft::Terminal::SessionRecording
+{
+    inline constexpr std::string_view Magic{ "WTREC\x1a\x01\x00", 8 };
+
+    enum class EventType : uint8_t
+    {
+        // The payload is a chunk of output.
+        Output = 'o',
+        // The payload is a ResizePayload.
+        Resize = 'r',
+    };
+
+#pragma pack(push, 1)
+    struct FileHeader
+    {
+        char magic[8];
+        uint16_t columns;
+        uint16_t rows;
+        uint32_t reserved;
+        // The UTC time at which the recording started, as a FILETIME.
+        uint64_t startTime;
+    };
+
+    struct EventHeader
+    {
+        // The time since the start of the recording.
+        uint64_t microseconds;
+        uint32_t size;
+        EventType type;
+        uint8_t reserved[3];
+    };
+
+    struct ResizePayload
+    {
+        uint16_t columns;
+        uint16_t rows;
+    };
+#pragma pack(pop)
+
+    static_assert(sizeof(FileHeader) == 24);
+    static_assert(sizeof(EventHeader) == 16);
+
+    struct Event
+    {
+        uint64_t microseconds;
+        EventType type;
+        std::string_view payload;
+    };
+
+    inline void AppendHeader(std::string& out, const uint16_t columns, const uint16_t rows, const uint64_t startTime)
+    {
+        FileHeader header{};
+        memcpy(&header.magic[0], Magic.data(), sizeof(header.magic));
+        header.columns = columns;
+        header.rows = rows;
+        header.startTime = startTime;
+        out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+
+    inline void AppendEvent(std::string& out, const EventType type, const uint64_t microseconds, const std::string_view payload)
+    {
+        EventHeader header{};
+        header.microseconds = microseconds;
+        header.size = gsl::narrow<uint32_t>(payload.size());
+        header.type = type;
+        out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.append(payload);
+    }
+
+    // Splits a recording into its events, which point into `data`.
+    // Throws E_INVALIDARG if `data` doesn't start with a valid header.
+    // Events of an unknown type are skipped and a truncated event at the end is ignored.
+    inline std::vector<Event> Parse(const std::string_view data, FileHeader& header)
+    {
+        THROW_HR_IF(E_INVALIDARG, data.size() < sizeof(FileHeader) || data.substr(0, Magic.size()) != Magic);
+        memcpy(&header, data.data(), sizeof(header));
+
+        std::vector<Event> events;
+        auto rest = data.substr(sizeof(FileHeader));
+
+        while (rest.size() >= sizeof(EventHeader))
+        {
+            EventHeader eventHeader;
+            memcpy(&eventHeader, rest.data(), sizeof(eventHeader));
+            rest = rest.substr(sizeof(EventHeader));
+
+            if (rest.size() < eventHeader.size)
+            {
+                break;
+            }
+
+            const auto payload = rest.substr(0, eventHeader.size);
+            rest = rest.substr(eventHeader.size);
+
+            if (eventHeader.type == EventType::Output || (eventHeader.type == EventType::Resize && payload.size() == sizeof(ResizePayload)))
+            {
+                events.push_back(Event{ eventHeader.microseconds, eventHeader.type, payload });
+            }
+        }
+
+        return events;
+    }
+}
@@ -9,6 +9,7 @@
 #include "cmdline.h"
 #include "misc.h"
 #include "_output.h"
+#include "output.h"
 #include "dbcs.h"
 #include "../types/inc/GlyphWidth.hpp"
 
@@ -153,6 +154,7 @@ void CommandListPopup::_setBottomIndex()
     {
         auto& history = cookedReadData.History();
         history.Remove(static_cast<short>(_currentCommand));
+        _jumpTableValid = false;
         _setBottomIndex();
 
         if (history.GetNumberOfCommands() == 0)
@@ -187,8 +189,11 @@ void CommandListPopup::_setBottomIndex()
             return STATUS_SUCCESS;
         }
         history.Swap(_currentCommand, _currentCommand - 1);
+        _jumpTableValid = false;
         _update(-1);
-        _drawList();
+        // Both of the swapped commands are visible now.
+        _drawItem(_currentCommand);
+        _drawItem(_currentCommand + 1);
     }
     CATCH_LOG();
     return STATUS_SUCCESS;
@@ -209,8 +214,11 @@ void CommandListPopup::_setBottomIndex()
             return STATUS_SUCCESS;
         }
         history.Swap(_currentCommand, _currentCommand + 1);
+        _jumpTableValid = false;
         _update(1);
-        _drawList();
+        // Both of the swapped commands are visible now.
+        _drawItem(_currentCommand - 1);
+        _drawItem(_currentCommand);
     }
     CATCH_LOG();
     return STATUS_SUCCESS;
@@ -266,16 +274,52 @@ void CommandListPopup::_handleReturn(COOKED_READ_DATA& cookedReadData)
     cookedReadData.SetReportedByteCount(NumBytes);
 }
 
-void CommandListPopup::_cycleSelectionToMatchingCommands(COOKED_READ_DATA& cookedReadData, const wchar_t wch)
+// Routine Description:
+// - Fills _jumpTable with the indices of the commands, by their first character.
+void CommandListPopup::_buildJumpTable()
 {
-    short Index = 0;
-    if (cookedReadData.History().FindMatchingCommand({ &wch, 1 },
-                                                     _currentCommand,
-                                                     Index,
-                                                     CommandHistory::MatchOptions::JustLooking))
+    _jumpTable.clear();
+
+    const auto count = gsl::narrow<SHORT>(_history.GetNumberOfCommands());
+    for (SHORT i = 0; i < count; ++i)
+    {
+        const auto command = _history.GetNth(i);
+        if (!command.empty())
+        {
+            _jumpTable[command.front()].push_back(i);
+        }
+    }
+
+    _jumpTableValid = true;
+}
+
+// Routine Description:
+// - Selects the closest command before the current one (wrapping around at the start) that
+//   starts with the given character, just like CommandHistory::FindMatchingCommand would.
+//   With the _jumpTable that's a binary search instead of going through the history.
+// Arguments:
+// - wch - the character that the command needs to start with
+void CommandListPopup::_cycleSelectionToMatchingCommands(const wchar_t wch)
+{
+    if (!_jumpTableValid)
     {
-        _update((SHORT)(Index - _currentCommand), true);
+        _buildJumpTable();
     }
+
+    const auto it = _jumpTable.find(wch);
+    if (it == _jumpTable.end())
+    {
+        return;
+    }
+
+    const auto& indices = it->second;
+    const auto count = gsl::narrow<SHORT>(_history.GetNumberOfCommands());
+    const auto start = gsl::narrow_cast<SHORT>((_currentCommand + count - 1) % count);
+    // The last index that's <= start, or the last one overall if there's none.
+    auto match = std::upper_bound(indices.begin(), indices.end(), start);
+    const auto index = match == indices.begin() ? indices.back() : *--match;
+
+    _update(gsl::narrow_cast<SHORT>(index - _currentCommand), true);
 }
 
 // Routine Description:
@@ -315,7 +359,7 @@ void CommandListPopup::_cycleSelectionToMatchingCommands(COOKED_READ_DATA& cooke
         else
         {
             // cycle through commands that start with the letter of the key pressed
-            _cycleSelectionToMatchingCommands(cookedReadData, wch);
+            _cycleSelectionToMatchingCommands(wch);
         }
     }
 }
@@ -325,119 +369,186 @@ void CommandListPopup::_DrawContent()
     _drawList();
 }
 
+// Routine Description:
+// - Returns the index of the command that's displayed on the first line of the popup.
+SHORT CommandListPopup::_topIndex() const noexcept
+{
+    return gsl::narrow_cast<SHORT>(std::max(_bottomIndex - Height() + 1, 0));
+}
+
 // Routine Description:
 // - Draws a list of commands for the user to choose from
 void CommandListPopup::_drawList()
 {
-    // draw empty popup
+    const auto topIndex = _topIndex();
+    for (auto i = topIndex; i <= _bottomIndex; i++)
+    {
+        _drawItem(i);
+    }
+
+    // Clear the lines below the last command, if there are any.
     til::point WriteCoord;
     WriteCoord.x = _region.left + 1;
-    WriteCoord.y = _region.top + 1;
+    WriteCoord.y = _region.top + 1 + _bottomIndex - topIndex + 1;
+    for (; WriteCoord.y <= _region.top + Height(); WriteCoord.y++)
+    {
+        const OutputCellIterator spaces(UNICODE_SPACE, _attributes, Width());
+        _screenInfo.Write(spaces, WriteCoord);
+    }
+}
+
+// Routine Description:
+// - Draws a single command on the line of the popup that it's displayed on, if it's visible.
+//   The current command is highlighted.
+// Arguments:
+// - index - the index of the command in the history
+void CommandListPopup::_drawItem(const SHORT index)
+{
+    const auto topIndex = _topIndex();
+    if (index < topIndex || index > _bottomIndex)
+    {
+        return;
+    }
+
+    til::point WriteCoord;
+    WriteCoord.x = _region.left + 1;
+    WriteCoord.y = _region.top + 1 + index - topIndex;
+
+    // clear the line
     size_t lStringLength = Width();
-    for (til::CoordType i = 0; i < Height(); ++i)
     {
         const OutputCellIterator spaces(UNICODE_SPACE, _attributes, lStringLength);
         const auto result = _screenInfo.Write(spaces, WriteCoord);
         lStringLength = result.GetCellDistance(spaces);
-        WriteCoord.y += 1;
     }
 
     auto api = Microsoft::Console::Interactivity::ServiceLocator::LocateGlobals().api;
 
-    WriteCoord.y = _region.top + 1;
-    auto i = gsl::narrow<SHORT>(std::max(_bottomIndex - Height() + 1, 0));
-    for (; i <= _bottomIndex; i++)
+    CHAR CommandNumber[COMMAND_NUMBER_SIZE];
+    // Write command number to screen.
+    if (0 != _itoa_s(index, CommandNumber, ARRAYSIZE(CommandNumber), 10))
     {
-        CHAR CommandNumber[COMMAND_NUMBER_SIZE];
-        // Write command number to screen.
-        if (0 != _itoa_s(i, CommandNumber, ARRAYSIZE(CommandNumber), 10))
-        {
-            return;
-        }
-
-        auto CommandNumberPtr = CommandNumber;
+        return;
+    }
 
-        size_t CommandNumberLength;
-        if (FAILED(StringCchLengthA(CommandNumberPtr, ARRAYSIZE(CommandNumber), &CommandNumberLength)))
-        {
-            return;
-        }
-        __assume_bound(CommandNumberLength);
+    auto CommandNumberPtr = CommandNumber;
 
-        if (CommandNumberLength + 1 >= ARRAYSIZE(CommandNumber))
-        {
-            return;
-        }
+    size_t CommandNumberLength;
+    if (FAILED(StringCchLengthA(CommandNumberPtr, ARRAYSIZE(CommandNumber), &CommandNumberLength)))
+    {
+        return;
+    }
+    __assume_bound(CommandNumberLength);
 
-        CommandNumber[CommandNumberLength] = ':';
-        CommandNumber[CommandNumberLength + 1] = ' ';
-        CommandNumberLength += 2;
-        if (CommandNumberLength > static_cast<ULONG>(Width()))
-        {
-            CommandNumberLength = static_cast<ULONG>(Width());
-        }
+    if (CommandNumberLength + 1 >= ARRAYSIZE(CommandNumber))
+    {
+        return;
+    }
 
-        WriteCoord.x = _region.left + 1;
+    CommandNumber[CommandNumberLength] = ':';
+    CommandNumber[CommandNumberLength + 1] = ' ';
+    CommandNumberLength += 2;
+    if (CommandNumberLength > static_cast<ULONG>(Width()))
+    {
+        CommandNumberLength = static_cast<ULONG>(Width());
+    }
 
-        LOG_IF_FAILED(api->WriteConsoleOutputCharacterAImpl(_screenInfo,
-                                                            { CommandNumberPtr, CommandNumberLength },
-                                                            WriteCoord,
-                                                            CommandNumberLength));
+    LOG_IF_FAILED(api->WriteConsoleOutputCharacterAImpl(_screenInfo,
+                                                        { CommandNumberPtr, CommandNumberLength },
+                                                        WriteCoord,
+                                                        CommandNumberLength));
 
-        // write command to screen
-        auto command = _history.GetNth(i);
-        lStringLength = command.size();
+    // write command to screen
+    auto command = _history.GetNth(index);
+    lStringLength = command.size();
+    {
+        auto lTmpStringLength = lStringLength;
+        auto lPopupLength = static_cast<LONG>(Width() - CommandNumberLength);
+        auto lpStr = command.data();
+        while (lTmpStringLength--)
         {
-            auto lTmpStringLength = lStringLength;
-            auto lPopupLength = static_cast<LONG>(Width() - CommandNumberLength);
-            auto lpStr = command.data();
-            while (lTmpStringLength--)
+            if (IsGlyphFullWidth(*lpStr++))
             {
-                if (IsGlyphFullWidth(*lpStr++))
-                {
-                    lPopupLength -= 2;
-                }
-                else
-                {
-                    lPopupLength--;
-                }
+                lPopupLength -= 2;
+            }
+            else
+            {
+                lPopupLength--;
+            }
 
-                if (lPopupLength <= 0)
+            if (lPopupLength <= 0)
+            {
+                lStringLength -= lTmpStringLength;
+                if (lPopupLength < 0)
                 {
-                    lStringLength -= lTmpStringLength;
-                    if (lPopupLength < 0)
-                    {
-                        lStringLength--;
-                    }
-
-                    break;
+                    lStringLength--;
                 }
+
+                break;
             }
         }
+    }
 
-        WriteCoord.x = gsl::narrow<til::CoordType>(WriteCoord.x + CommandNumberLength);
-        size_t used;
-        LOG_IF_FAILED(api->WriteConsoleOutputCharacterWImpl(_screenInfo,
-                                                            { command.data(), lStringLength },
-                                                            WriteCoord,
-                                                            used));
+    WriteCoord.x = gsl::narrow<til::CoordType>(WriteCoord.x + CommandNumberLength);
+    size_t used;
+    LOG_IF_FAILED(api->WriteConsoleOutputCharacterWImpl(_screenInfo,
+                                                        { command.data(), lStringLength },
+                                                        WriteCoord,
+                                                        used));
 
-        // write attributes to screen
-        if (i == _currentCommand)
-        {
-            WriteCoord.x = _region.left + 1;
-            // inverted attributes
-            lStringLength = Width();
-            auto inverted = _attributes;
-            inverted.Invert();
+    // write attributes to screen
+    if (index == _currentCommand)
+    {
+        WriteCoord.x = _region.left + 1;
+        // inverted attributes
+        auto inverted = _attributes;
+        inverted.Invert();
 
-            const OutputCellIterator it(inverted, lStringLength);
-            const auto done = _screenInfo.Write(it, WriteCoord);
+        const OutputCellIterator it(inverted, Width());
+        _screenInfo.Write(it, WriteCoord);
+    }
+}
 
-            lStringLength = done.GetCellDistance(it);
-        }
+// Routine Description:
+// - Brings the popup up to date after _bottomIndex changed. If most of the commands are still
+//   visible, the lines of the popup are moved by scrolling that part of the buffer, and only
+//   the lines that scrolled into view are drawn. Over ConPTY every drawn line turns into output,
+//   which makes this a lot cheaper than redrawing the entire list for every key press.
+// Arguments:
+// - oldBottomIndex - the _bottomIndex that the popup currently displays
+void CommandListPopup::_scrollList(const SHORT oldBottomIndex)
+{
+    const auto delta = _bottomIndex - oldBottomIndex;
+    if (delta == 0)
+    {
+        return;
+    }
+    // The popup only scrolls if it's full, so all of its lines are commands.
+    if (std::abs(delta) >= Height() || _bottomIndex - _topIndex() + 1 != Height())
+    {
+        _drawList();
+        return;
+    }
+
+    const til::inclusive_rect content{ _region.left + 1, _region.top + 1, _region.left + Width(), _region.top + Height() };
+    auto source = content;
+    til::point destination{ content.left, content.top };
+    if (delta > 0)
+    {
+        source.top += delta;
+    }
+    else
+    {
+        source.bottom += delta;
+        destination.y -= delta;
+    }
+    ScrollRegion(_screenInfo, source, content, destination, UNICODE_SPACE, _attributes);
 
-        WriteCoord.y += 1;
+    const auto first = delta > 0 ? gsl::narrow_cast<SHORT>(oldBottomIndex + 1) : _topIndex();
+    const auto last = delta > 0 ? _bottomIndex : gsl::narrow_cast<SHORT>(_topIndex() - delta - 1);
+    for (auto i = first; i <= last; i++)
+    {
+        _drawItem(i);
     }
 }
 
@@ -478,6 +589,7 @@ void CommandListPopup::_update(const SHORT originalDelta, const bool wrap)
     delta = NewCmdNum - CurCmdNum;
 
     auto Scroll = false;
+    const auto oldBottomIndex = _bottomIndex;
     // determine amount to scroll, if any
     if (NewCmdNum <= _bottomIndex - Size)
     {
@@ -502,7 +614,10 @@ void CommandListPopup::_update(const SHORT originalDelta, const bool wrap)
     if (Scroll)
     {
         _currentCommand = NewCmdNum;
-        _drawList();
+        _scrollList(oldBottomIndex);
+        // The previous selection may have scrolled along with the rest of the list.
+        _drawItem(CurCmdNum);
+        _drawItem(NewCmdNum);
     }
     else
     {
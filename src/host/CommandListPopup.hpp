@@ -29,11 +29,15 @@ protected:
 
 private:
     void _drawList();
+    void _drawItem(const SHORT index);
+    void _scrollList(const SHORT oldBottomIndex);
+    SHORT _topIndex() const noexcept;
     void _update(const SHORT delta, const bool wrap = false);
     void _updateHighlight(const SHORT oldCommand, const SHORT newCommand);
 
     void _handleReturn(COOKED_READ_DATA& cookedReadData);
-    void _cycleSelectionToMatchingCommands(COOKED_READ_DATA& cookedReadData, const wchar_t wch);
+    void _cycleSelectionToMatchingCommands(const wchar_t wch);
+    void _buildJumpTable();
     void _setBottomIndex();
     [[nodiscard]] NTSTATUS _handlePopupKeys(COOKED_READ_DATA& cookedReadData, const wchar_t wch, const DWORD modifiers) noexcept;
     [[nodiscard]] NTSTATUS _deleteSelection(COOKED_READ_DATA& cookedReadData) noexcept;
@@ -43,6 +47,10 @@ private:
     SHORT _currentCommand;
     SHORT _bottomIndex; // number of command displayed on last line of popup
     const CommandHistory& _history;
+    // The indices of the commands that start with a given character, in ascending order.
+    // It's built on the first letter key press and dropped whenever the history changes.
+    std::unordered_map<wchar_t, std::vector<SHORT>> _jumpTable;
+    bool _jumpTableValid = false;
 
 #ifdef UNIT_TESTING
     friend class CommandListPopupTests;
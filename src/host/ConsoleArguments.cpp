@@ -21,6 +21,10 @@ const std::wstring_view ConsoleArguments::HEIGHT_ARG = L"--height";
 const std::wstring_view ConsoleArguments::INHERIT_CURSOR_ARG = L"--inheritcursor";
 const std::wstring_view ConsoleArguments::RESIZE_QUIRK = L"--resizeQuirk";
 const std::wstring_view ConsoleArguments::WIN32_INPUT_MODE = L"--win32input";
+const std::wstring_view ConsoleArguments::REPEAT_CHARACTER_ARG = L"--repeatchar";
+const std::wstring_view ConsoleArguments::SHARED_BUFFER_HANDLE_ARG = L"--sharedbuffer";
+const std::wstring_view ConsoleArguments::VT_FRAME_INTERVAL_ARG = L"--vtframeinterval";
+const std::wstring_view ConsoleArguments::VT_IDLE_FLUSH_ARG = L"--vtidleflush";
 const std::wstring_view ConsoleArguments::FEATURE_ARG = L"--feature";
 const std::wstring_view ConsoleArguments::FEATURE_PTY_ARG = L"pty";
 const std::wstring_view ConsoleArguments::COM_SERVER_ARG = L"-Embedding";
@@ -150,6 +154,8 @@ ConsoleArguments& ConsoleArguments::operator=(const ConsoleArguments& other)
         _inheritCursor = other._inheritCursor;
         _runAsComServer = other._runAsComServer;
         _forceNoHandoff = other._forceNoHandoff;
+        _vtFrameInterval = other._vtFrameInterval;
+        _vtIdleFlush = other._vtIdleFlush;
     }
 
     return *this;
@@ -493,6 +499,22 @@ void ConsoleArguments::s_ConsumeArg(_Inout_ std::vector<std::wstring>& args, _In
         {
             hr = s_GetArgumentValue(args, i, &_height);
         }
+        else if (arg == VT_FRAME_INTERVAL_ARG)
+        {
+            hr = s_GetArgumentValue(args, i, &_vtFrameInterval);
+            if (SUCCEEDED(hr) && _vtFrameInterval < 0)
+            {
+                hr = E_INVALIDARG;
+            }
+        }
+        else if (arg == VT_IDLE_FLUSH_ARG)
+        {
+            hr = s_GetArgumentValue(args, i, &_vtIdleFlush);
+            if (SUCCEEDED(hr) && _vtIdleFlush < 0)
+            {
+                hr = E_INVALIDARG;
+            }
+        }
         else if (arg == FEATURE_ARG)
         {
             hr = s_HandleFeatureValue(args, i);
@@ -521,6 +543,22 @@ void ConsoleArguments::s_ConsumeArg(_Inout_ std::vector<std::wstring>& args, _In
             s_ConsumeArg(args, i);
             hr = S_OK;
         }
+        else if (arg == REPEAT_CHARACTER_ARG)
+        {
+            _repeatCharacter = true;
+            s_ConsumeArg(args, i);
+            hr = S_OK;
+        }
+        else if (arg == SHARED_BUFFER_HANDLE_ARG)
+        {
+            std::wstring sharedBufferHandleVal;
+            hr = s_GetArgumentValue(args, i, &sharedBufferHandleVal);
+
+            if (SUCCEEDED(hr))
+            {
+                hr = s_ParseHandleArg(sharedBufferHandleVal, _sharedBufferHandle);
+            }
+        }
         else if (arg == CLIENT_COMMANDLINE_ARG)
         {
             // Everything after this is the explicit commandline
@@ -681,6 +719,34 @@ bool ConsoleArguments::IsWin32InputModeEnabled() const
 {
     return _win32InputMode;
 }
+bool ConsoleArguments::IsRepeatCharacterEnabled() const
+{
+    return _repeatCharacter;
+}
+
+// Method Description:
+// - Returns the section that the VT renderer may move text through instead of the
+//   output pipe (see ConptySharedBuffer.hpp), or nullptr if we weren't given one.
+HANDLE ConsoleArguments::GetSharedBufferHandle() const
+{
+    return ULongToHandle(_sharedBufferHandle);
+}
+
+// Method Description:
+// - The minimum time in milliseconds between two frames of the VT renderer,
+//   as given by `--vtframeinterval`. 0 if frames aren't limited.
+short ConsoleArguments::GetVtFrameInterval() const
+{
+    return _vtFrameInterval;
+}
+
+// Method Description:
+// - How long in milliseconds the VT renderer waits for output to stop
+//   arriving before it paints, as given by `--vtidleflush`. 0 if it doesn't wait.
+short ConsoleArguments::GetVtIdleFlush() const
+{
+    return _vtIdleFlush;
+}
 
 #ifdef UNIT_TESTING
 // Method Description:
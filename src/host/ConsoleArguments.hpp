@@ -56,6 +56,10 @@ public:
     bool GetInheritCursor() const;
     bool IsResizeQuirkEnabled() const;
     bool IsWin32InputModeEnabled() const;
+    bool IsRepeatCharacterEnabled() const;
+    HANDLE GetSharedBufferHandle() const;
+    short GetVtFrameInterval() const;
+    short GetVtIdleFlush() const;
 
 #ifdef UNIT_TESTING
     void EnableConptyModeForTests();
@@ -75,6 +79,10 @@ public:
     static const std::wstring_view INHERIT_CURSOR_ARG;
     static const std::wstring_view RESIZE_QUIRK;
     static const std::wstring_view WIN32_INPUT_MODE;
+    static const std::wstring_view REPEAT_CHARACTER_ARG;
+    static const std::wstring_view SHARED_BUFFER_HANDLE_ARG;
+    static const std::wstring_view VT_FRAME_INTERVAL_ARG;
+    static const std::wstring_view VT_IDLE_FLUSH_ARG;
     static const std::wstring_view FEATURE_ARG;
     static const std::wstring_view FEATURE_PTY_ARG;
     static const std::wstring_view COM_SERVER_ARG;
@@ -145,6 +153,10 @@ private:
     bool _inheritCursor;
     bool _resizeQuirk{ false };
     bool _win32InputMode{ false };
+    bool _repeatCharacter{ false };
+    DWORD _sharedBufferHandle{ 0 };
+    short _vtFrameInterval{ 0 };
+    short _vtIdleFlush{ 0 };
 
     [[nodiscard]] HRESULT _GetClientCommandline(_Inout_ std::vector<std::wstring>& args,
                                                 const size_t index,
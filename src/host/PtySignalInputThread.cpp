@@ -137,6 +137,13 @@ try
                 return S_OK;
             }
 
+            // Dragging the terminal's window sends a burst of resizes, while each one costs us a
+            // reflow and the terminal a repaint. Any that queued up in the meantime are skipped,
+            // since only the latest size matters.
+            while (_TryGetQueuedResize(resizeMsg))
+            {
+            }
+
             _DoResizeWindow(resizeMsg);
             break;
         }
@@ -158,6 +165,44 @@ try
 }
 CATCH_LOG_RETURN_HR(S_OK)
 
+// Method Description:
+// - Reads the next message from the pipe, if it's a resize that has already arrived in full.
+//   ConptyResizePseudoConsole() writes the signal and its data in a single WriteFile() call.
+// Arguments:
+// - data - Receives the size of the queued resize message.
+// Return Value:
+// - true if a resize message was read. false if the next message is something else, or if
+//   there's none yet (or the handle isn't a pipe), in which case nothing was read.
+[[nodiscard]] bool PtySignalInputThread::_TryGetQueuedResize(ResizeWindowData& data)
+{
+    if (!_hFile)
+    {
+        return false;
+    }
+
+    std::array<std::byte, sizeof(PtySignal) + sizeof(ResizeWindowData)> packet;
+    DWORD read = 0;
+    if (!PeekNamedPipe(_hFile.get(), packet.data(), gsl::narrow_cast<DWORD>(packet.size()), &read, nullptr, nullptr) || read != packet.size())
+    {
+        return false;
+    }
+
+    PtySignal signalId;
+    memcpy(&signalId, packet.data(), sizeof(signalId));
+    if (signalId != PtySignal::ResizeWindow)
+    {
+        return false;
+    }
+
+    if (!_GetData(packet.data(), gsl::narrow_cast<DWORD>(packet.size())))
+    {
+        return false;
+    }
+
+    memcpy(&data, &til::at(packet, sizeof(signalId)), sizeof(data));
+    return true;
+}
+
 // Method Description:
 // - Dispatches a resize window message to the rest of the console code
 // Arguments:
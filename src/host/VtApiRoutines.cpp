@@ -8,30 +8,27 @@
 
 using namespace Microsoft::Console::Interactivity;
 
-// When someone attempts to use the console APIs to do a "read back"
-// of the console buffer, we have to give them **something**.
-// These two structures are just some gaudy-colored replacement character
-// text to give them data but represent they've done something that cannot
-// be supported under VT passthrough mode.
+// When someone attempts to use the console APIs to only change the attributes
+// of the console buffer, we have to write **something** to the terminal.
+// There's no VT sequence that changes the colors of existing text without
+// knowing the text, so this is just some gaudy-colored replacement character.
 // ----
-// They can't be supported because in passthrough we maintain no internal
-// buffer to answer these questions, and there is no VT sequence that lets
-// us query the final terminal's buffer state. Even if a VT sequence did exist
-// (and we personally believe it shouldn't), there's a possibility that it would
-// read a massive amount of data and cause severe perf issues as applications coded
-// to this old API are likely leaning on it heavily and asking for this data in a
-// loop via VT would be a nightmare of parsing and formatting and over-the-wire transmission.
-
-static constexpr CHAR_INFO s_readBackUnicode{
-    { UNICODE_REPLACEMENT },
-    FOREGROUND_INTENSITY | FOREGROUND_RED | BACKGROUND_GREEN
-};
+// "Read back" APIs on the other hand are answered from our own text buffer,
+// to which we apply the output that was passed through once one is called.
+// That's cheaper than asking the terminal, since applications coded to this
+// old API are likely leaning on it heavily and asking for this data in a loop
+// via VT would be a nightmare of parsing and formatting and over-the-wire transmission.
 
 static constexpr CHAR_INFO s_readBackAscii{
     { L'?' },
     FOREGROUND_INTENSITY | FOREGROUND_RED | BACKGROUND_GREEN
 };
 
+// Output of clients in VT mode is sent to the terminal as is. It's only applied to our own
+// text buffer once a console API needs to know its contents. This is the amount of pending
+// output after which we do that anyway, so that it doesn't grow without bounds.
+static constexpr size_t MaxPendingOutput = 1024 * 1024;
+
 VtApiRoutines::VtApiRoutines() :
     m_inputCodepage(ServiceLocator::LocateGlobals().getConsoleInformation().CP),
     m_outputCodepage(ServiceLocator::LocateGlobals().getConsoleInformation().OutputCP),
@@ -39,7 +36,11 @@ VtApiRoutines::VtApiRoutines() :
     m_outputMode(),
     m_pUsualRoutines(),
     m_pVtEngine(),
-    m_listeningForDSR(false)
+    m_listeningForDSR(false),
+    m_pendingOutput(),
+    m_pendingOutputContext(nullptr),
+    m_u8State(),
+    m_u16Buffer()
 {
 }
 
@@ -82,6 +83,9 @@ void VtApiRoutines::GetConsoleOutputModeImpl(SCREEN_INFORMATION& context,
 [[nodiscard]] HRESULT VtApiRoutines::SetConsoleOutputModeImpl(SCREEN_INFORMATION& context,
                                                               const ULONG Mode) noexcept
 {
+    // The pending output has to be interpreted with the mode it was written with.
+    _SynchronizeBuffer();
+    RETURN_IF_FAILED(m_pUsualRoutines->SetConsoleOutputModeImpl(context, Mode));
     m_outputMode = Mode;
     return S_OK;
 }
@@ -105,46 +109,106 @@ void VtApiRoutines::_SynchronizeCursor(std::unique_ptr<IWaitRoutine>& waiter) no
     }
 }
 
+// Routine Description:
+// - Remembers output that was passed through to the terminal, so that it can be applied to the
+//   text buffer later on. See _SynchronizeBuffer().
+// Arguments:
+// - context - the screen buffer the output was written to
+// - text - the output
+void VtApiRoutines::_AppendPendingOutput(IConsoleOutputObject& context, const std::wstring_view text) noexcept
+try
+{
+    if (m_pendingOutputContext != &context)
+    {
+        _SynchronizeBuffer();
+        m_pendingOutputContext = &context;
+    }
+
+    m_pendingOutput.append(text);
+
+    if (m_pendingOutput.size() >= MaxPendingOutput)
+    {
+        _SynchronizeBuffer();
+    }
+}
+CATCH_LOG()
+
+// Routine Description:
+// - Applies the output that was passed through to the terminal to our text buffer.
+//   This needs to happen before any console API reads from the buffer or writes to it.
+// - The terminal has already processed that output, so nothing this causes is sent to it
+//   again, not even responses to queries. See VtEngine::BeginBufferSync().
+void VtApiRoutines::_SynchronizeBuffer() noexcept
+try
+{
+    if (m_pendingOutput.empty() || !m_pendingOutputContext)
+    {
+        return;
+    }
+
+    auto& screenInfo = m_pendingOutputContext->GetActiveBuffer();
+    const auto outputMode = screenInfo.OutputMode;
+
+    m_pVtEngine->BeginBufferSync();
+    const auto endSync = wil::scope_exit([&]() noexcept {
+        screenInfo.OutputMode = outputMode;
+        m_pendingOutput.clear();
+
+        const auto cursor = screenInfo.GetTextBuffer().GetCursor().GetPosition() - screenInfo.GetViewport().Origin();
+        m_pVtEngine->EndBufferSync(cursor);
+    });
+
+    // The output was written while VT processing was enabled, and that's how the terminal interpreted it.
+    WI_SetFlag(screenInfo.OutputMode, ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+
+    // If output is suspended we'd get a waiter, which we drop (and the text with it).
+    // The terminal doesn't know about that suspension either.
+    size_t read = 0;
+    std::unique_ptr<IWaitRoutine> waiter;
+    LOG_IF_FAILED(m_pUsualRoutines->WriteConsoleWImpl(*m_pendingOutputContext, m_pendingOutput, read, false, waiter));
+}
+CATCH_LOG()
+
 [[nodiscard]] HRESULT VtApiRoutines::PeekConsoleInputAImpl(IConsoleInputObject& context,
-                                                           std::deque<std::unique_ptr<IInputEvent>>& outEvents,
-                                                           const size_t eventsToRead,
+                                                           std::span<INPUT_RECORD> outRecords,
+                                                           size_t& recordsRead,
                                                            INPUT_READ_HANDLE_DATA& readHandleState,
                                                            std::unique_ptr<IWaitRoutine>& waiter) noexcept
 {
-    const auto hr = m_pUsualRoutines->PeekConsoleInputAImpl(context, outEvents, eventsToRead, readHandleState, waiter);
+    const auto hr = m_pUsualRoutines->PeekConsoleInputAImpl(context, outRecords, recordsRead, readHandleState, waiter);
     _SynchronizeCursor(waiter);
     return hr;
 }
 
 [[nodiscard]] HRESULT VtApiRoutines::PeekConsoleInputWImpl(IConsoleInputObject& context,
-                                                           std::deque<std::unique_ptr<IInputEvent>>& outEvents,
-                                                           const size_t eventsToRead,
+                                                           std::span<INPUT_RECORD> outRecords,
+                                                           size_t& recordsRead,
                                                            INPUT_READ_HANDLE_DATA& readHandleState,
                                                            std::unique_ptr<IWaitRoutine>& waiter) noexcept
 {
-    const auto hr = m_pUsualRoutines->PeekConsoleInputWImpl(context, outEvents, eventsToRead, readHandleState, waiter);
+    const auto hr = m_pUsualRoutines->PeekConsoleInputWImpl(context, outRecords, recordsRead, readHandleState, waiter);
     _SynchronizeCursor(waiter);
     return hr;
 }
 
 [[nodiscard]] HRESULT VtApiRoutines::ReadConsoleInputAImpl(IConsoleInputObject& context,
-                                                           std::deque<std::unique_ptr<IInputEvent>>& outEvents,
-                                                           const size_t eventsToRead,
+                                                           std::span<INPUT_RECORD> outRecords,
+                                                           size_t& recordsRead,
                                                            INPUT_READ_HANDLE_DATA& readHandleState,
                                                            std::unique_ptr<IWaitRoutine>& waiter) noexcept
 {
-    const auto hr = m_pUsualRoutines->ReadConsoleInputAImpl(context, outEvents, eventsToRead, readHandleState, waiter);
+    const auto hr = m_pUsualRoutines->ReadConsoleInputAImpl(context, outRecords, recordsRead, readHandleState, waiter);
     _SynchronizeCursor(waiter);
     return hr;
 }
 
 [[nodiscard]] HRESULT VtApiRoutines::ReadConsoleInputWImpl(IConsoleInputObject& context,
-                                                           std::deque<std::unique_ptr<IInputEvent>>& outEvents,
-                                                           const size_t eventsToRead,
+                                                           std::span<INPUT_RECORD> outRecords,
+                                                           size_t& recordsRead,
                                                            INPUT_READ_HANDLE_DATA& readHandleState,
                                                            std::unique_ptr<IWaitRoutine>& waiter) noexcept
 {
-    const auto hr = m_pUsualRoutines->ReadConsoleInputWImpl(context, outEvents, eventsToRead, readHandleState, waiter);
+    const auto hr = m_pUsualRoutines->ReadConsoleInputWImpl(context, outRecords, recordsRead, readHandleState, waiter);
     _SynchronizeCursor(waiter);
     return hr;
 }
@@ -160,6 +224,7 @@ void VtApiRoutines::_SynchronizeCursor(std::unique_ptr<IWaitRoutine>& waiter) no
                                                       const DWORD controlWakeupMask,
                                                       DWORD& controlKeyState) noexcept
 {
+    _SynchronizeBuffer();
     const auto hr = m_pUsualRoutines->ReadConsoleAImpl(context, buffer, written, waiter, initialData, exeName, readHandleState, clientHandle, controlWakeupMask, controlKeyState);
     // If we're about to tell the caller to wait, let's synchronize the cursor we have with what
     // the terminal is presenting in case there's a cooked read going on.
@@ -184,6 +249,7 @@ void VtApiRoutines::_SynchronizeCursor(std::unique_ptr<IWaitRoutine>& waiter) no
                                                       const DWORD controlWakeupMask,
                                                       DWORD& controlKeyState) noexcept
 {
+    _SynchronizeBuffer();
     const auto hr = m_pUsualRoutines->ReadConsoleWImpl(context, buffer, written, waiter, initialData, exeName, readHandleState, clientHandle, controlWakeupMask, controlKeyState);
     // If we're about to tell the caller to wait, let's synchronize the cursor we have with what
     // the terminal is presenting in case there's a cooked read going on.
@@ -202,20 +268,33 @@ void VtApiRoutines::_SynchronizeCursor(std::unique_ptr<IWaitRoutine>& waiter) no
                                                        size_t& read,
                                                        bool requiresVtQuirk,
                                                        std::unique_ptr<IWaitRoutine>& waiter) noexcept
+try
 {
+    // Without VT processing the output means something else to us than to the terminal.
+    // It goes through our text buffer then and the VtEngine renders it.
+    if (WI_IsFlagClear(m_outputMode, ENABLE_VIRTUAL_TERMINAL_PROCESSING))
+    {
+        _SynchronizeBuffer();
+        return m_pUsualRoutines->WriteConsoleAImpl(context, buffer, read, requiresVtQuirk, waiter);
+    }
+
     if (CP_UTF8 == m_outputCodepage)
     {
         (void)m_pVtEngine->WriteTerminalUtf8(buffer);
+        RETURN_IF_FAILED(til::u8u16(buffer, m_u16Buffer, m_u8State));
     }
     else
     {
-        (void)m_pVtEngine->WriteTerminalW(ConvertToW(m_outputCodepage, buffer));
+        m_u16Buffer = ConvertToW(m_outputCodepage, buffer);
+        (void)m_pVtEngine->WriteTerminalW(m_u16Buffer);
     }
 
     (void)m_pVtEngine->_Flush();
+    _AppendPendingOutput(context, m_u16Buffer);
     read = buffer.size();
     return S_OK;
 }
+CATCH_RETURN()
 
 [[nodiscard]] HRESULT VtApiRoutines::WriteConsoleWImpl(IConsoleOutputObject& context,
                                                        const std::wstring_view buffer,
@@ -223,8 +302,15 @@ void VtApiRoutines::_SynchronizeCursor(std::unique_ptr<IWaitRoutine>& waiter) no
                                                        bool requiresVtQuirk,
                                                        std::unique_ptr<IWaitRoutine>& waiter) noexcept
 {
+    if (WI_IsFlagClear(m_outputMode, ENABLE_VIRTUAL_TERMINAL_PROCESSING))
+    {
+        _SynchronizeBuffer();
+        return m_pUsualRoutines->WriteConsoleWImpl(context, buffer, read, requiresVtQuirk, waiter);
+    }
+
     (void)m_pVtEngine->WriteTerminalW(buffer);
     (void)m_pVtEngine->_Flush();
+    _AppendPendingOutput(context, buffer);
     read = buffer.size();
     return S_OK;
 }
@@ -300,6 +386,7 @@ void VtApiRoutines::_SynchronizeCursor(std::unique_ptr<IWaitRoutine>& waiter) no
 
 void VtApiRoutines::SetConsoleActiveScreenBufferImpl(SCREEN_INFORMATION& newContext) noexcept
 {
+    _SynchronizeBuffer();
     return;
 }
 
@@ -343,6 +430,7 @@ void VtApiRoutines::GetConsoleScreenBufferInfoExImpl(const SCREEN_INFORMATION& c
                                                      CONSOLE_SCREEN_BUFFER_INFOEX& data) noexcept
 {
     // TODO GH10001: this is technically full of potentially incorrect data. do we care? should we store it in here with set?
+    _SynchronizeBuffer();
     return m_pUsualRoutines->GetConsoleScreenBufferInfoExImpl(context, data);
 }
 
@@ -436,9 +524,8 @@ void VtApiRoutines::GetLargestConsoleWindowSizeImpl(const SCREEN_INFORMATION& co
                                                                     std::span<WORD> buffer,
                                                                     size_t& written) noexcept
 {
-    std::fill_n(buffer.data(), buffer.size(), s_readBackUnicode.Attributes); // should be same as the ascii one.
-    written = buffer.size();
-    return S_OK;
+    _SynchronizeBuffer();
+    return m_pUsualRoutines->ReadConsoleOutputAttributeImpl(context, origin, buffer, written);
 }
 
 [[nodiscard]] HRESULT VtApiRoutines::ReadConsoleOutputCharacterAImpl(const SCREEN_INFORMATION& context,
@@ -446,9 +533,8 @@ void VtApiRoutines::GetLargestConsoleWindowSizeImpl(const SCREEN_INFORMATION& co
                                                                      std::span<char> buffer,
                                                                      size_t& written) noexcept
 {
-    std::fill_n(buffer.data(), buffer.size(), s_readBackAscii.Char.AsciiChar);
-    written = buffer.size();
-    return S_OK;
+    _SynchronizeBuffer();
+    return m_pUsualRoutines->ReadConsoleOutputCharacterAImpl(context, origin, buffer, written);
 }
 
 [[nodiscard]] HRESULT VtApiRoutines::ReadConsoleOutputCharacterWImpl(const SCREEN_INFORMATION& context,
@@ -456,9 +542,8 @@ void VtApiRoutines::GetLargestConsoleWindowSizeImpl(const SCREEN_INFORMATION& co
                                                                      std::span<wchar_t> buffer,
                                                                      size_t& written) noexcept
 {
-    std::fill_n(buffer.data(), buffer.size(), s_readBackUnicode.Char.UnicodeChar);
-    written = buffer.size();
-    return S_OK;
+    _SynchronizeBuffer();
+    return m_pUsualRoutines->ReadConsoleOutputCharacterWImpl(context, origin, buffer, written);
 }
 
 [[nodiscard]] HRESULT VtApiRoutines::WriteConsoleInputAImpl(InputBuffer& context,
@@ -581,9 +666,8 @@ extern HRESULT _ConvertCellsToWInplace(const UINT codepage,
                                                             const Microsoft::Console::Types::Viewport& sourceRectangle,
                                                             Microsoft::Console::Types::Viewport& readRectangle) noexcept
 {
-    std::fill_n(buffer.data(), buffer.size(), s_readBackAscii);
-    // TODO GH10001: do we need to constrict readRectangle to within the known buffer size... probably.
-    return S_OK;
+    _SynchronizeBuffer();
+    return m_pUsualRoutines->ReadConsoleOutputAImpl(context, buffer, sourceRectangle, readRectangle);
 }
 
 [[nodiscard]] HRESULT VtApiRoutines::ReadConsoleOutputWImpl(const SCREEN_INFORMATION& context,
@@ -591,9 +675,8 @@ extern HRESULT _ConvertCellsToWInplace(const UINT codepage,
                                                             const Microsoft::Console::Types::Viewport& sourceRectangle,
                                                             Microsoft::Console::Types::Viewport& readRectangle) noexcept
 {
-    std::fill_n(buffer.data(), buffer.size(), s_readBackUnicode);
-    // TODO GH10001: do we need to constrict readRectangle to within the known buffer size... probably.
-    return S_OK;
+    _SynchronizeBuffer();
+    return m_pUsualRoutines->ReadConsoleOutputWImpl(context, buffer, sourceRectangle, readRectangle);
 }
 
 [[nodiscard]] HRESULT VtApiRoutines::GetConsoleTitleAImpl(std::span<char> title,
@@ -53,26 +53,26 @@ public:
                                                             ULONG& events) noexcept override;
 
     [[nodiscard]] HRESULT PeekConsoleInputAImpl(IConsoleInputObject& context,
-                                                std::deque<std::unique_ptr<IInputEvent>>& outEvents,
-                                                const size_t eventsToRead,
+                                                std::span<INPUT_RECORD> outRecords,
+                                                size_t& recordsRead,
                                                 INPUT_READ_HANDLE_DATA& readHandleState,
                                                 std::unique_ptr<IWaitRoutine>& waiter) noexcept override;
 
     [[nodiscard]] HRESULT PeekConsoleInputWImpl(IConsoleInputObject& context,
-                                                std::deque<std::unique_ptr<IInputEvent>>& outEvents,
-                                                const size_t eventsToRead,
+                                                std::span<INPUT_RECORD> outRecords,
+                                                size_t& recordsRead,
                                                 INPUT_READ_HANDLE_DATA& readHandleState,
                                                 std::unique_ptr<IWaitRoutine>& waiter) noexcept override;
 
     [[nodiscard]] HRESULT ReadConsoleInputAImpl(IConsoleInputObject& context,
-                                                std::deque<std::unique_ptr<IInputEvent>>& outEvents,
-                                                const size_t eventsToRead,
+                                                std::span<INPUT_RECORD> outRecords,
+                                                size_t& recordsRead,
                                                 INPUT_READ_HANDLE_DATA& readHandleState,
                                                 std::unique_ptr<IWaitRoutine>& waiter) noexcept override;
 
     [[nodiscard]] HRESULT ReadConsoleInputWImpl(IConsoleInputObject& context,
-                                                std::deque<std::unique_ptr<IInputEvent>>& outEvents,
-                                                const size_t eventsToRead,
+                                                std::span<INPUT_RECORD> outRecords,
+                                                size_t& recordsRead,
                                                 INPUT_READ_HANDLE_DATA& readHandleState,
                                                 std::unique_ptr<IWaitRoutine>& waiter) noexcept override;
 
@@ -389,4 +389,12 @@ public:
 
 private:
     void _SynchronizeCursor(std::unique_ptr<IWaitRoutine>& waiter) noexcept;
+    void _AppendPendingOutput(IConsoleOutputObject& context, const std::wstring_view text) noexcept;
+    void _SynchronizeBuffer() noexcept;
+
+    // Output that was passed through to the terminal, but not applied to the text buffer yet.
+    std::wstring m_pendingOutput;
+    IConsoleOutputObject* m_pendingOutputContext;
+    til::u8state m_u8State;
+    std::wstring m_u16Buffer;
 };
@@ -13,10 +13,15 @@
 #include "server.h"
 #include "output.h"
 #include "handle.h"
+#include "../inc/ConptyBinaryInput.hpp"
 
 using namespace Microsoft::Console;
 using namespace Microsoft::Console::Interactivity;
 using namespace Microsoft::Console::VirtualTerminal;
+
+// Large enough for the whole of most pastes, which ConPTY can then handle in a single batch.
+static constexpr size_t ReadBufferSize = 64 * 1024;
+
 // Constructor Description:
 // - Creates the VT Input Thread.
 // Arguments:
@@ -34,6 +39,8 @@ VtInputThread::VtInputThread(_In_ wil::unique_hfile hPipe,
 {
     THROW_HR_IF(E_HANDLE, _hFile.get() == INVALID_HANDLE_VALUE);
 
+    _buffer = std::make_unique<char[]>(ReadBufferSize);
+
     auto dispatch = std::make_unique<InteractDispatch>();
 
     auto engine = std::make_unique<InputStateMachineEngine>(std::move(dispatch), inheritCursor);
@@ -53,7 +60,8 @@ VtInputThread::VtInputThread(_In_ wil::unique_hfile hPipe,
 // Method Description:
 // - Processes a string of input characters. The characters should be UTF-8
 //      encoded, and will get converted to wstring to be processed by the
-//      input state machine.
+//      input state machine. They may be interleaved with binary input frames
+//      (see ConptyBinaryInput.hpp), whose records are written to the input buffer as is.
 // Arguments:
 // - u8Str - the UTF-8 string received.
 // Return Value:
@@ -70,20 +78,133 @@ VtInputThread::VtInputThread(_In_ wil::unique_hfile hPipe,
 
     try
     {
-        std::wstring wstr{};
-        auto hr = til::u8u16(u8Str, wstr, _u8State);
-        // If we hit a parsing error, eat it. It's bad utf-8, we can't do anything with it.
-        if (FAILED(hr))
+        // Readers are woken up once for all of the input, instead of once per key event.
+        // This must happen before the console is unlocked, so it's declared after Unlock.
+        const auto inputBuffer = ServiceLocator::LocateGlobals().getConsoleInformation().GetActiveInputBuffer();
+        inputBuffer->BeginWriteBatch();
+        const auto endBatch = wil::scope_exit([&] { inputBuffer->EndWriteBatch(); });
+
+        auto rest = u8Str;
+        auto hr = S_OK;
+
+        while (!rest.empty())
         {
-            return S_FALSE;
+            // The introducer can't occur in UTF-8, so everything up to it is regular input.
+            if (_frame.empty())
+            {
+                const auto pos = rest.find(BinaryInput::FrameIntroducer);
+                if (pos != 0)
+                {
+                    const auto text = rest.substr(0, pos);
+                    hr = _HandleText(text);
+                    rest = rest.substr(text.size());
+                    continue;
+                }
+            }
+
+            rest = _HandleFrame(rest);
         }
-        _pInputStateMachine->ProcessString(wstr);
+
+        return hr;
     }
     CATCH_RETURN();
+}
 
+// Method Description:
+// - Converts the given UTF-8 input to UTF-16 and passes it to the input state machine.
+// Return Value:
+// - S_OK on success, S_FALSE if the input was invalid UTF-8.
+[[nodiscard]] HRESULT VtInputThread::_HandleText(const std::string_view u8Str)
+{
+    auto hr = til::u8u16(u8Str, _wstr, _u8State);
+    // If we hit a parsing error, eat it. It's bad utf-8, we can't do anything with it.
+    if (FAILED(hr))
+    {
+        return S_FALSE;
+    }
+    _pInputStateMachine->ProcessString(_wstr);
     return S_OK;
 }
 
+// Method Description:
+// - Appends the start of the given input to the current binary input frame, which may
+//   have been started by a previous read already. Once it's complete, its records get written.
+// Arguments:
+// - u8Str - input that starts with a frame introducer if no frame is in progress.
+// Return Value:
+// - The rest of the input, after the part that belongs to the frame.
+std::string_view VtInputThread::_HandleFrame(const std::string_view u8Str)
+{
+    auto rest = u8Str;
+    const auto append = [&](const size_t size) {
+        const auto n = std::min(size - _frame.size(), rest.size());
+        _frame.append(rest.substr(0, n));
+        rest = rest.substr(n);
+        return _frame.size() == size;
+    };
+
+    if (!append(BinaryInput::FrameHeaderSize))
+    {
+        return rest;
+    }
+
+    const auto count = static_cast<uint8_t>(_frame[1]);
+    if (!append(BinaryInput::FrameHeaderSize + count * sizeof(INPUT_RECORD)))
+    {
+        return rest;
+    }
+
+    // The payload isn't necessarily aligned, so the records are copied out of it.
+    // Only key events are accepted, just like win32-input-mode only supports those.
+    _records.clear();
+    for (size_t i = 0; i < count; ++i)
+    {
+        INPUT_RECORD record;
+        memcpy(&record, _frame.data() + BinaryInput::FrameHeaderSize + i * sizeof(INPUT_RECORD), sizeof(record));
+        if (record.EventType == KEY_EVENT)
+        {
+            _records.emplace_back(record);
+        }
+    }
+    _frame.clear();
+
+    _WriteKeyRecords(_records);
+    return rest;
+}
+
+// Method Description:
+// - Writes the given key events into the input buffer. Those that need to be handled
+//   by the console itself (like Ctrl+C) are sent through HandleGenericKeyEvent() like
+//   InteractDispatch::WriteCtrlKey() would, and everything in between in batches.
+void VtInputThread::_WriteKeyRecords(const std::span<const INPUT_RECORD> records)
+{
+    const auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+    size_t batchStart = 0;
+
+    for (size_t i = 0; i < records.size(); ++i)
+    {
+        const auto& key = til::at(records, i).Event.KeyEvent;
+        const auto ctrl = WI_IsAnyFlagSet(key.dwControlKeyState, CTRL_PRESSED);
+        const auto alt = WI_IsAnyFlagSet(key.dwControlKeyState, ALT_PRESSED);
+        const auto special = key.bKeyDown && ((ctrl && !alt && (key.wVirtualKeyCode == 'C' || key.wVirtualKeyCode == VK_CANCEL || key.wVirtualKeyCode == VK_ESCAPE)) ||
+                                              (alt && key.wVirtualKeyCode == VK_ESCAPE));
+        if (special)
+        {
+            if (i > batchStart)
+            {
+                gci.GetActiveInputBuffer()->Write(records.subspan(batchStart, i - batchStart));
+            }
+            HandleGenericKeyEvent(KeyEvent{ key }, false);
+            batchStart = i + 1;
+        }
+    }
+
+    if (batchStart < records.size())
+    {
+        gci.GetActiveInputBuffer()->Write(records.subspan(batchStart));
+    }
+}
+
 // Function Description:
 // - Static function used for initializing an instance's ThreadProc.
 // Arguments:
@@ -98,8 +219,9 @@ DWORD WINAPI VtInputThread::StaticVtInputThreadProc(_In_ LPVOID lpParameter)
 }
 
 // Method Description:
-// - Do a single ReadFile from our pipe, and try and handle it. If handling
-//      failed, throw or log, depending on what the caller wants.
+// - Do a single blocking ReadFile from our pipe, followed by reads of whatever
+//      else is already available in the pipe, and try and handle it all at once.
+//      If handling failed, throw or log, depending on what the caller wants.
 // Arguments:
 // - throwOnFail: If true, throw an exception if there was an error processing
 //      the input received. Otherwise, log the error.
@@ -107,9 +229,9 @@ DWORD WINAPI VtInputThread::StaticVtInputThreadProc(_In_ LPVOID lpParameter)
 // - <none>
 void VtInputThread::DoReadInput(const bool throwOnFail)
 {
-    char buffer[256];
+    const auto buffer = _buffer.get();
     DWORD dwRead = 0;
-    auto fSuccess = !!ReadFile(_hFile.get(), buffer, ARRAYSIZE(buffer), &dwRead, nullptr);
+    auto fSuccess = !!ReadFile(_hFile.get(), buffer, gsl::narrow_cast<DWORD>(ReadBufferSize), &dwRead, nullptr);
 
     if (!fSuccess)
     {
@@ -117,7 +239,25 @@ void VtInputThread::DoReadInput(const bool throwOnFail)
         return;
     }
 
-    auto hr = _HandleRunInput({ buffer, gsl::narrow_cast<size_t>(dwRead) });
+    // Terminals write large pastes into the pipe in many small pieces. Everything that has
+    // arrived by now is appended to this read, so that it's decoded, parsed and written into
+    // the input buffer in a single batch. The input pipe is usually an anonymous pipe opened
+    // without FILE_FLAG_OVERLAPPED, so we can't issue overlapped reads, but we can avoid
+    // ever blocking on these additional reads, by only reading what PeekNamedPipe() reports.
+    // If a read fails, the next blocking read will fail as well and end the thread.
+    size_t size = dwRead;
+    DWORD available = 0;
+    while (size < ReadBufferSize && PeekNamedPipe(_hFile.get(), nullptr, 0, nullptr, &available, nullptr) && available != 0)
+    {
+        const auto want = gsl::narrow_cast<DWORD>(std::min<size_t>(available, ReadBufferSize - size));
+        if (!ReadFile(_hFile.get(), buffer + size, want, &dwRead, nullptr))
+        {
+            break;
+        }
+        size += dwRead;
+    }
+
+    auto hr = _HandleRunInput({ buffer, size });
     if (FAILED(hr))
     {
         if (throwOnFail)
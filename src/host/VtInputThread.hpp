@@ -30,6 +30,9 @@ namespace Microsoft::Console
 
     private:
         [[nodiscard]] HRESULT _HandleRunInput(const std::string_view u8Str);
+        [[nodiscard]] HRESULT _HandleText(const std::string_view u8Str);
+        std::string_view _HandleFrame(const std::string_view u8Str);
+        void _WriteKeyRecords(const std::span<const INPUT_RECORD> records);
         void _InputThread();
 
         wil::unique_hfile _hFile;
@@ -42,5 +45,14 @@ namespace Microsoft::Console
 
         std::unique_ptr<Microsoft::Console::VirtualTerminal::StateMachine> _pInputStateMachine;
         til::u8state _u8State;
+
+        // The buffers that DoReadInput() reads into and _HandleText() decodes into. They're
+        // reused for every read, since large pastes easily make for thousands of them.
+        std::unique_ptr<char[]> _buffer;
+        std::wstring _wstr;
+
+        // A binary input frame (see ConptyBinaryInput.hpp) that's been read only partially so far.
+        std::string _frame;
+        std::vector<INPUT_RECORD> _records;
     };
 }
@@ -73,7 +73,15 @@ VtIo::VtIo() :
     _lookingForCursorPosition = pArgs->GetInheritCursor();
     _resizeQuirk = pArgs->IsResizeQuirkEnabled();
     _win32InputMode = pArgs->IsWin32InputModeEnabled();
+    _repeatCharacter = pArgs->IsRepeatCharacterEnabled();
     _passthroughMode = pArgs->IsPassthroughMode();
+    _frameInterval = std::chrono::milliseconds{ pArgs->GetVtFrameInterval() };
+    _idleFlush = std::chrono::milliseconds{ pArgs->GetVtIdleFlush() };
+
+    if (const auto sharedBuffer = pArgs->GetSharedBufferHandle(); sharedBuffer && sharedBuffer != INVALID_HANDLE_VALUE)
+    {
+        _hSharedBuffer.reset(sharedBuffer);
+    }
 
     // If we were already given VT handles, set up the VT IO engine to use those.
     if (pArgs->InConptyMode())
@@ -184,6 +192,14 @@ VtIo::VtIo() :
                     }
                 }
 
+                if constexpr (Feature_VtShadowBuffer::IsEnabled())
+                {
+                    if (!_passthroughMode)
+                    {
+                        xterm256Engine->SetShadowBufferMode(true);
+                    }
+                }
+
                 _pVtRenderEngine = std::move(xterm256Engine);
                 break;
             }
@@ -219,6 +235,27 @@ VtIo::VtIo() :
             {
                 _pVtRenderEngine->SetTerminalOwner(this);
                 _pVtRenderEngine->SetResizeQuirk(_resizeQuirk);
+                _pVtRenderEngine->SetRepeatCharacter(_repeatCharacter);
+                if (_hSharedBuffer)
+                {
+                    _sharedBufferView.reset(static_cast<std::byte*>(MapViewOfFile(_hSharedBuffer.get(), FILE_MAP_WRITE, 0, 0, SharedBuffer::SectionSize)));
+                    _hSharedBuffer.reset();
+                    if (_sharedBufferView)
+                    {
+                        _pVtRenderEngine->SetSharedBuffer({ _sharedBufferView.get(), SharedBuffer::SectionSize });
+                    }
+                    else
+                    {
+                        LOG_LAST_ERROR();
+                    }
+                }
+                // The engine skips frames while the terminal is busy reading earlier output.
+                _pVtRenderEngine->SetOutputDrainedCallback([]() {
+                    if (const auto pRender = ServiceLocator::LocateGlobals().pRender)
+                    {
+                        pRender->NotifyPaintFrame();
+                    }
+                });
             }
         }
     }
@@ -234,7 +271,8 @@ bool VtIo::IsUsingVt() const
 }
 
 // Routine Description:
-//  Potentially starts this VtIo's input thread and render engine.
+//  Potentially starts this VtIo's render engine and sends the initial requests
+//      to the terminal. The input thread is started later, by ConnectConsole.
 //      If the VtIo hasn't yet been given pipes, then this function will
 //      silently do nothing. It's the responsibility of the caller to make sure
 //      that the pipes are initialized first with VtIo::Initialize
@@ -257,12 +295,12 @@ bool VtIo::IsUsingVt() const
         try
         {
             g.pRender->AddRenderEngine(_pVtRenderEngine.get());
+            // Every VT frame is a diff that's written to the pipe. Limiting the frame rate
+            // and waiting for bursts of output to end makes for fewer and larger diffs.
+            g.pRender->SetMinimumFrameInterval(_frameInterval);
+            g.pRender->SetIdleFlushTimeout(_idleFlush);
             g.getConsoleInformation().GetActiveOutputBuffer().SetTerminalConnection(_pVtRenderEngine.get());
             g.getConsoleInformation().GetActiveInputBuffer()->SetTerminalConnection(_pVtRenderEngine.get());
-
-            // Force the whole window to be put together first.
-            // We don't really need the handle, we just want to leverage the setup steps.
-            ServiceLocator::LocatePseudoWindow();
         }
         CATCH_RETURN();
     }
@@ -279,8 +317,8 @@ bool VtIo::IsUsingVt() const
     // MSFT: 15813316
     // If the terminal application wants us to inherit the cursor position,
     //  we're going to emit a VT sequence to ask for the cursor position, then
-    //  read input until we get a response. Terminals who request this behavior
-    //  but don't respond will hang.
+    //  read input until we get a response (in ConnectConsole). Terminals who
+    //  request this behavior but don't respond will hang.
     // If we get a response, the InteractDispatch will call SetCursorPosition,
     //      which will call to our VtIo::SetCursorPosition method.
     // We need both handles for this initialization to work. If we don't have
@@ -289,6 +327,40 @@ bool VtIo::IsUsingVt() const
     if (_lookingForCursorPosition && _pVtRenderEngine && _pVtInputThread)
     {
         LOG_IF_FAILED(_pVtRenderEngine->RequestCursor());
+    }
+
+    return S_OK;
+}
+
+// Method Description:
+// - Finishes what StartIfNeeded started, once the rest of the console (in
+//   particular the pseudo window) is set up: waits for the response to the
+//   cursor position request, starts the input thread and connects the signal
+//   thread. The terminal answers the requests while the pseudo window is
+//   created, instead of us waiting for it to do so before even asking.
+// - Input mustn't be processed any earlier, because handling a focus event
+//   creates the pseudo window if it doesn't exist yet, on the wrong thread.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void VtIo::ConnectConsole()
+{
+    if (!_objectsCreated)
+    {
+        return;
+    }
+
+    // Usually ConsoleInputThreadProcWin32 has created the window by now. If the
+    // client doesn't get a (visible) window, there's no such thread and this
+    // creates it instead, with the owner the terminal might've already sent us.
+    if (_pVtRenderEngine)
+    {
+        CreatePseudoWindow();
+    }
+
+    if (_pVtRenderEngine && _pVtInputThread)
+    {
         while (_lookingForCursorPosition)
         {
             _pVtInputThread->DoReadInput(false);
@@ -310,8 +382,6 @@ bool VtIo::IsUsingVt() const
         // window don't end up hanging because the pty didn't also process it.
         _pPtySignalInputThread->ConnectConsole();
     }
-
-    return S_OK;
 }
 
 // Method Description:
@@ -535,6 +605,14 @@ bool VtIo::IsResizeQuirkEnabled() const
     return _resizeQuirk;
 }
 
+// Method Description:
+// - Returns true while passthrough output is applied to the text buffer after
+//   the fact. See VtEngine::BeginBufferSync().
+bool VtIo::IsSynchronizingBuffer() const noexcept
+{
+    return _pVtRenderEngine && _pVtRenderEngine->IsSynchronizingBuffer();
+}
+
 // Method Description:
 // - Manually tell the renderer that it should emit a "Erase Scrollback"
 //   sequence to the connected terminal. We need to do this in certain cases
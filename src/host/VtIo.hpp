@@ -30,6 +30,7 @@ namespace Microsoft::Console::VirtualTerminal
         bool IsUsingVt() const;
 
         [[nodiscard]] HRESULT StartIfNeeded();
+        void ConnectConsole();
 
         [[nodiscard]] static HRESULT ParseIoMode(const std::wstring& VtMode, _Out_ VtIoMode& ioMode);
         [[nodiscard]] HRESULT SuppressResizeRepaint();
@@ -48,6 +49,7 @@ namespace Microsoft::Console::VirtualTerminal
 #endif
 
         bool IsResizeQuirkEnabled() const;
+        bool IsSynchronizingBuffer() const noexcept;
 
         [[nodiscard]] HRESULT ManuallyClearScrollback() const noexcept;
 
@@ -69,8 +71,16 @@ namespace Microsoft::Console::VirtualTerminal
 
         bool _resizeQuirk{ false };
         bool _win32InputMode{ false };
+        bool _repeatCharacter{ false };
         bool _passthroughMode{ false };
         bool _closeEventSent{ false };
+        std::chrono::milliseconds _frameInterval{ 0 };
+        std::chrono::milliseconds _idleFlush{ 0 };
+
+        // After CreateIoHandlers is called, the handle will be invalid and the view, which the
+        // VtEngine writes to, will keep the section alive. See ConptySharedBuffer.hpp.
+        wil::unique_handle _hSharedBuffer;
+        wil::unique_mapview_ptr<std::byte> _sharedBufferView;
 
         std::unique_ptr<Microsoft::Console::Render::VtEngine> _pVtRenderEngine;
         std::unique_ptr<Microsoft::Console::VtInputThread> _pVtInputThread;
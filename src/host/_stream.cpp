@@ -28,6 +28,66 @@ using Microsoft::Console::VirtualTerminal::StateMachine;
 // Used by WriteCharsLegacy.
 #define IS_GLYPH_CHAR(wch) (((wch) >= L' ') && ((wch) != 0x007F))
 
+// Routine Description:
+// - Returns the length of the leading run of printable ASCII characters [0x20,0x7E] in the given string.
+//   Those are neither special-cased by WriteCharsLegacy nor ever wider than 1 column, which allows it
+//   to copy them in bulk. Since there's no unsigned 16-bit comparison in SSE2, the range is shifted
+//   down to [0x00,0x5E] and tested with a saturating subtraction: (x -sat k) == 0 is equivalent to x <= k.
+// Arguments:
+// - str - The string to scan.
+// Return Value:
+// - The offset of the first character that isn't printable ASCII, or str.size() if there's none.
+#pragma warning(push)
+#pragma warning(disable : 26481) // Don't use pointer arithmetic. Use span instead (bounds.1).
+#pragma warning(disable : 26490) // Don't use reinterpret_cast (type.1).
+static size_t _printableAsciiPrefixLength(const std::wstring_view str) noexcept
+{
+    auto it = str.data();
+    const auto end = it + str.size();
+
+#if defined(_M_AMD64) || defined(_M_IX86)
+    const auto first = _mm_set1_epi16(L' ');
+    const auto span = _mm_set1_epi16(L'~' - L' ');
+    const auto zero = _mm_setzero_si128();
+
+    for (; end - it >= 8; it += 8)
+    {
+        const auto vec = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+        const auto printable = _mm_cmpeq_epi16(_mm_subs_epu16(_mm_sub_epi16(vec, first), span), zero);
+        const auto mask = static_cast<unsigned long>(_mm_movemask_epi8(printable)) ^ 0xffff;
+        unsigned long index;
+        if (_BitScanForward(&index, mask))
+        {
+            // The mask contains 2 bits per wchar_t.
+            return static_cast<size_t>(it - str.data()) + index / 2;
+        }
+    }
+#elif defined(_M_ARM64)
+    const auto first = vdupq_n_u16(L' ');
+    const auto span = vdupq_n_u16(L'~' - L' ');
+
+    for (; end - it >= 8; it += 8)
+    {
+        const auto vec = vld1q_u16(reinterpret_cast<const uint16_t*>(it));
+        const auto special = vcgtq_u16(vsubq_u16(vec, first), span);
+        // Narrowing the 8 16-bit results to 8 bytes gives us a 64-bit mask with 8 bits per wchar_t.
+        const auto mask = vget_lane_u64(vreinterpret_u64_u8(vmovn_u16(special)), 0);
+        unsigned long index;
+        if (_BitScanForward64(&index, mask))
+        {
+            return static_cast<size_t>(it - str.data()) + index / 8;
+        }
+    }
+#endif
+
+    for (; it != end && *it >= L' ' && *it <= L'~'; ++it)
+    {
+    }
+
+    return static_cast<size_t>(it - str.data());
+}
+#pragma warning(pop)
+
 // Routine Description:
 // - This routine updates the cursor position.  Its input is the non-special
 //   cased new location of the cursor.  For example, if the cursor were being
@@ -192,6 +252,28 @@ using Microsoft::Console::VirtualTerminal::StateMachine;
         auto LocalBufPtr = LocalBuffer;
         while (*pcb < BufferSize && i < LOCAL_BUFFER_SIZE && XPosition < coordScreenBufferSize.width)
         {
+            // Fast path: Runs of printable ASCII are copied in one go, since each of them
+            // would take the IS_GLYPH_CHAR branch below and occupy exactly 1 column anyways.
+            // It's only attempted if the current character qualifies, so that text consisting
+            // mostly of other characters doesn't pay for a scan on every iteration.
+            if (*lpString >= L' ' && *lpString <= L'~')
+            {
+                const auto remaining = (BufferSize - *pcb) / sizeof(WCHAR);
+                const auto capacity = std::min(LOCAL_BUFFER_SIZE - i, coordScreenBufferSize.width - XPosition);
+                const auto run = std::min(_printableAsciiPrefixLength({ lpString, remaining }), gsl::narrow_cast<size_t>(capacity));
+                const auto runLength = gsl::narrow_cast<til::CoordType>(run);
+
+                std::copy_n(lpString, run, LocalBufPtr);
+                LocalBufPtr += run;
+                XPosition += runLength;
+                i += runLength;
+                pwchBuffer += run;
+                lpString += run;
+                pwchRealUnicode += run;
+                *pcb += run * sizeof(WCHAR);
+                continue;
+            }
+
 #pragma prefast(suppress : 26019, "Buffer is taken in multiples of 2. Validation is ok.")
             const auto Char = *lpString;
             // WCL-NOTE: We believe RealUnicodeChar to be identical to Char, because we believe pwchRealUnicode
@@ -1009,7 +1091,16 @@ using Microsoft::Console::VirtualTerminal::StateMachine;
             if (mbPtrLength != 0)
             {
                 // convert the remaining bytes in mbPtr to wide chars
-                mbPtrLength = sizeof(wchar_t) * MultiByteToWideChar(codepage, 0, mbPtr, mbPtrLength, wcPtr, mbPtrLength);
+                // Single-byte codepages produce exactly one wide char per byte via a lookup table.
+                const std::string_view remaining{ mbPtr, gsl::narrow_cast<size_t>(mbPtrLength) };
+                if (TryConvertSingleByteToW(codepage, remaining, { wcPtr, remaining.size() }))
+                {
+                    mbPtrLength = sizeof(wchar_t) * mbPtrLength;
+                }
+                else
+                {
+                    mbPtrLength = sizeof(wchar_t) * MultiByteToWideChar(codepage, 0, mbPtr, mbPtrLength, wcPtr, mbPtrLength);
+                }
             }
 
             wstr.resize((dbcsLength + mbPtrLength) / sizeof(wchar_t));
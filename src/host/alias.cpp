@@ -21,7 +21,9 @@ using Microsoft::Console::Interactivity::ServiceLocator;
 
 struct case_insensitive_hash
 {
-    std::size_t operator()(const std::wstring& key) const
+    using is_transparent = void;
+
+    std::size_t operator()(const std::wstring_view key) const
     {
         til::hasher h;
         for (const auto& ch : key)
@@ -34,15 +36,45 @@ struct case_insensitive_hash
 
 struct case_insensitive_equality
 {
-    bool operator()(const std::wstring& lhs, const std::wstring& rhs) const
+    using is_transparent = void;
+
+    bool operator()(const std::wstring_view lhs, const std::wstring_view rhs) const
     {
-        return 0 == _wcsicmp(lhs.data(), rhs.data());
+        return lhs.size() == rhs.size() && 0 == _wcsnicmp(lhs.data(), rhs.data(), lhs.size());
     }
 };
 
+// A piece of an alias expansion. Literal segments refer to a range in alias_target::literals,
+// argument segments to the n-th space separated token of the command line (0 is the alias itself).
+struct alias_segment
+{
+    enum class kind : uint8_t
+    {
+        literal,
+        argument,
+        all_arguments,
+    };
+
+    kind type;
+    uint8_t argument;
+    size_t offset;
+    size_t length;
+};
+
+// The target of an alias. Besides the text as it was given to us, it holds the target
+// parsed into a substitution template (see Alias::s_CompileTarget), which is what
+// cooked reads expand on every enter.
+struct alias_target
+{
+    std::wstring text;
+    std::wstring literals;
+    std::vector<alias_segment> segments;
+    size_t lineCount = 0;
+};
+
 std::unordered_map<std::wstring,
                    std::unordered_map<std::wstring,
-                                      std::wstring,
+                                      alias_target,
                                       case_insensitive_hash,
                                       case_insensitive_equality>,
                    case_insensitive_hash,
@@ -114,7 +146,7 @@ std::unordered_map<std::wstring,
         else
         {
             // Map will auto-create each level as necessary
-            g_aliasData[exeNameString][sourceString] = targetString;
+            g_aliasData[exeNameString][sourceString] = Alias::s_CompileTarget(std::move(targetString));
         }
     }
     CATCH_RETURN();
@@ -156,10 +188,10 @@ std::unordered_map<std::wstring,
     // We use .find for the iterators then dereference to search without creating entries.
     const auto exeIter = g_aliasData.find(exeNameString);
     RETURN_HR_IF(HRESULT_FROM_WIN32(ERROR_GEN_FAILURE), exeIter == g_aliasData.end());
-    const auto exeData = exeIter->second;
+    const auto& exeData = exeIter->second;
     const auto sourceIter = exeData.find(sourceString);
     RETURN_HR_IF(HRESULT_FROM_WIN32(ERROR_GEN_FAILURE), sourceIter == exeData.end());
-    const auto targetString = sourceIter->second;
+    const auto& targetString = sourceIter->second.text;
     RETURN_HR_IF(HRESULT_FROM_WIN32(ERROR_GEN_FAILURE), targetString.size() == 0);
 
     // TargetLength is a byte count, convert to characters.
@@ -333,18 +365,18 @@ static std::wstring aliasesSeparator(L"=");
         auto exeIter = g_aliasData.find(exeNameString);
         if (exeIter != g_aliasData.end())
         {
-            auto list = exeIter->second;
+            const auto& list = exeIter->second;
             for (auto& pair : list)
             {
                 // Alias stores lengths in bytes.
                 auto cchSource = pair.first.size();
-                auto cchTarget = pair.second.size();
+                auto cchTarget = pair.second.text.size();
 
                 // If we're counting how much multibyte space will be needed, trial convert the source and target strings before we add.
                 if (!countInUnicode)
                 {
                     cchSource = GetALengthFromW(codepage, pair.first);
-                    cchTarget = GetALengthFromW(codepage, pair.second);
+                    cchTarget = GetALengthFromW(codepage, pair.second.text);
                 }
 
                 // Accumulate all sizes to the final string count.
@@ -464,12 +496,12 @@ void Alias::s_ClearCmdExeAliases()
     auto exeIter = g_aliasData.find(exeNameString);
     if (exeIter != g_aliasData.end())
     {
-        auto list = exeIter->second;
+        const auto& list = exeIter->second;
         for (auto& pair : list)
         {
             // Alias stores lengths in bytes.
             const auto cchSource = pair.first.size();
-            const auto cchTarget = pair.second.size();
+            const auto cchTarget = pair.second.text.size();
 
             // Add up how many characters we will need for the full alias data.
             size_t cchNeeded = 0;
@@ -499,7 +531,7 @@ void Alias::s_ClearCmdExeAliases()
                 RETURN_IF_FAILED(SizeTSub(cchAliasBufferRemaining, aliasesSeparator.size(), &cchAliasBufferRemaining));
                 AliasesBufferPtrW += aliasesSeparator.size();
 
-                RETURN_IF_FAILED(StringCchCopyNW(AliasesBufferPtrW, cchAliasBufferRemaining, pair.second.data(), cchTarget));
+                RETURN_IF_FAILED(StringCchCopyNW(AliasesBufferPtrW, cchAliasBufferRemaining, pair.second.text.data(), cchTarget));
                 RETURN_IF_FAILED(SizeTSub(cchAliasBufferRemaining, cchTarget, &cchAliasBufferRemaining));
                 AliasesBufferPtrW += cchTarget;
 
@@ -1037,83 +1069,74 @@ void Alias::s_AppendCrLf(std::wstring& appendToStr,
 }
 
 // Routine Description:
-// - Searches through the given string for macros and replaces them
-//   with the matching action
+// - Parses an alias target into literal text and the argument substitutions between them,
+//   so that expanding the alias later on is a simple concatenation.
+// - All macros that don't depend on the command line ($L, $G, $B, $T and unknown ones)
+//   are resolved right away, including the CRLF that terminates every expansion.
 // Arguments:
-// - str - On input, the string to search. On output, the string is replaced.
-// - tokens - The tokenized command line input. 0 is the alias, 1-N are arguments.
-// - fullArgString - Shorthand to 1-N argument string in case of wildcard match.
+// - target - The target text of the alias, as it was given to us.
 // Return Value:
-// - The number of commands in the final string (line feeds, CRLFs)
-size_t Alias::s_ReplaceMacros(std::wstring& str,
-                              const std::deque<std::wstring>& tokens,
-                              const std::wstring& fullArgString)
+// - The alias target, holding both the original text and its substitution template.
+alias_target Alias::s_CompileTarget(std::wstring target)
 {
-    size_t lineCount = 0;
-    std::wstring finalText;
+    alias_target result;
+    result.text = std::move(target);
+
+    const auto& text = result.text;
+    auto& literals = result.literals;
+    auto& segments = result.segments;
+    auto literalStart = literals.size();
 
-    // The target text may contain substitution macros indicated by $.
-    // Walk through and substitute them as appropriate.
-    for (auto ch = str.cbegin(); ch < str.cend(); ch++)
+    const auto flushLiteral = [&]() {
+        if (literals.size() > literalStart)
+        {
+            segments.push_back({ alias_segment::kind::literal, 0, literalStart, literals.size() - literalStart });
+        }
+    };
+    const auto pushSubstitution = [&](const alias_segment::kind type, const uint8_t argument) {
+        flushLiteral();
+        segments.push_back({ type, argument, 0, 0 });
+        literalStart = literals.size();
+    };
+
+    for (size_t i = 0; i < text.size(); ++i)
     {
-        if (L'$' == *ch)
+        const auto ch = text[i];
+
+        // If it isn't the macro specifier $ or there's no read-ahead, just push the character.
+        if (L'$' != ch || i + 1 >= text.size())
         {
-            // Attempt to read ahead by one character.
-            const auto chNext = ch + 1;
+            literals.push_back(ch);
+            continue;
+        }
 
-            if (chNext < str.cend())
-            {
-                auto isProcessed = s_TryReplaceNumberedArgMacro(*chNext, finalText, tokens);
-                if (!isProcessed)
-                {
-                    isProcessed = s_TryReplaceWildcardArgMacro(*chNext, finalText, fullArgString);
-                }
-                if (!isProcessed)
-                {
-                    isProcessed = s_TryReplaceInputRedirMacro(*chNext, finalText);
-                }
-                if (!isProcessed)
-                {
-                    isProcessed = s_TryReplaceOutputRedirMacro(*chNext, finalText);
-                }
-                if (!isProcessed)
-                {
-                    isProcessed = s_TryReplacePipeRedirMacro(*chNext, finalText);
-                }
-                if (!isProcessed)
-                {
-                    isProcessed = s_TryReplaceNextCommandMacro(*chNext, finalText, lineCount);
-                }
-                if (!isProcessed)
-                {
-                    // If nothing matches, just push these two characters in.
-                    finalText.push_back(*ch);
-                    finalText.push_back(*chNext);
-                }
+        // Since we read ahead and use that character, the index advances one extra.
+        const auto chNext = text[++i];
 
-                // Since we read ahead and used that character,
-                // advance the iterator one extra to compensate.
-                ch++;
-            }
-            else
-            {
-                // If no read-ahead, just push this character and be done.
-                finalText.push_back(*ch);
-            }
+        if (chNext >= L'1' && chNext <= L'9')
+        {
+            pushSubstitution(alias_segment::kind::argument, gsl::narrow_cast<uint8_t>(chNext - L'0'));
         }
-        else
+        else if (L'*' == chNext)
         {
-            // If it didn't match the macro specifier $, push the character.
-            finalText.push_back(*ch);
+            pushSubstitution(alias_segment::kind::all_arguments, 0);
+        }
+        else if (!s_TryReplaceInputRedirMacro(chNext, literals) &&
+                 !s_TryReplaceOutputRedirMacro(chNext, literals) &&
+                 !s_TryReplacePipeRedirMacro(chNext, literals) &&
+                 !s_TryReplaceNextCommandMacro(chNext, literals, result.lineCount))
+        {
+            // If nothing matches, just push these two characters in.
+            literals.push_back(ch);
+            literals.push_back(chNext);
         }
     }
 
     // We always terminate with a CRLF to symbolize end of command.
-    s_AppendCrLf(finalText, lineCount);
+    s_AppendCrLf(literals, result.lineCount);
+    flushLiteral();
 
-    // Give back the final text and count.
-    str.swap(finalText);
-    return lineCount;
+    return result;
 }
 
 // Routine Description:
@@ -1121,68 +1144,98 @@ size_t Alias::s_ReplaceMacros(std::wstring& str,
 // Arguments:
 // - sourceText - The string to search for an alias
 // - exeName - The name of the EXE that has aliases associated
+// - targetText - Receives the processed data if we found a matching alias.
+//                The string is reused, so its capacity carries over between calls.
 // - lineCount - Number of lines worth of text processed.
 // Return Value:
-// - If we found a matching alias, this will be the processed data
+// - True if we found a matching alias. targetText contains the processed data
 //   and lineCount is updated to the new number of lines.
-// - If we didn't match and process an alias, return an empty string.
-std::wstring Alias::s_MatchAndCopyAlias(const std::wstring& sourceText,
-                                        const std::wstring& exeName,
-                                        size_t& lineCount)
+// - False if we didn't match and process an alias. targetText is left untouched.
+bool Alias::s_MatchAndCopyAlias(std::wstring_view sourceText,
+                                 const std::wstring& exeName,
+                                 std::wstring& targetText,
+                                 size_t& lineCount)
 {
-    // Copy source text into a local for manipulation.
-    auto sourceCopy = sourceText;
-
-    // Trim trailing \r\n off of sourceCopy if it has one.
-    s_TrimTrailingCrLf(sourceCopy);
-
-    // Check if we have an EXE in the list that matches the request first.
-    auto exeIter = g_aliasData.find(exeName);
-    if (exeIter == g_aliasData.end())
+    // Trim trailing \r\n off of the source text if it has one.
+    if (const auto trailingCrLfPos = sourceText.find_last_of(UNICODE_CARRIAGERETURN); std::wstring_view::npos != trailingCrLfPos)
     {
-        // We found no data for this exe. Give back an empty string.
-        return std::wstring();
+        sourceText = sourceText.substr(0, trailingCrLfPos);
     }
 
-    auto exeList = exeIter->second;
-    if (exeList.size() == 0)
+    // Check if we have an EXE in the list that matches the request first.
+    const auto exeIter = g_aliasData.find(exeName);
+    if (exeIter == g_aliasData.end())
     {
-        // If there's no match, give back an empty string.
-        return std::wstring();
+        return false;
     }
 
-    // Tokenize the text by spaces
-    const auto tokens = s_Tokenize(sourceCopy);
-
-    // If there are no tokens, return an empty string
-    if (tokens.size() == 0)
+    const auto& exeList = exeIter->second;
+    if (exeList.empty())
     {
-        return std::wstring();
+        return false;
     }
 
-    // Find alias. If there isn't one, return an empty string
-    const auto alias = tokens.front();
+    // The alias is everything up to the first space. Look it up without copying it.
+    const auto firstSpace = sourceText.find(L' ');
+    const auto alias = sourceText.substr(0, firstSpace);
     const auto aliasIter = exeList.find(alias);
     if (aliasIter == exeList.end())
     {
-        // We found no alias pair with this name. Give back an empty string.
-        return std::wstring();
+        return false;
     }
 
-    const auto target = aliasIter->second;
-    if (target.size() == 0)
+    const auto& target = aliasIter->second;
+    if (target.text.empty())
     {
-        return std::wstring();
+        return false;
     }
 
-    // Get the string of all parameters as a shorthand for $* later.
-    const auto allParams = s_GetArgString(sourceCopy);
+    // Tokenize the arguments by spaces. Only $1 through $9 can refer to individual
+    // tokens, so there's no need to look any further than that. Token 0 is the alias.
+    std::array<std::wstring_view, 10> tokens;
+    size_t tokenCount = 1;
+    std::wstring_view allArguments;
+    tokens[0] = alias;
+
+    if (std::wstring_view::npos != firstSpace)
+    {
+        allArguments = sourceText.substr(firstSpace + 1);
 
-    // The final text will be the target but with macros replaced.
-    auto finalText = target;
-    lineCount = s_ReplaceMacros(finalText, tokens, allParams);
+        auto remaining = allArguments;
+        while (tokenCount < tokens.size())
+        {
+            const auto spaceIndex = remaining.find(L' ');
+            tokens[tokenCount++] = remaining.substr(0, spaceIndex);
+            if (std::wstring_view::npos == spaceIndex)
+            {
+                break;
+            }
+            remaining = remaining.substr(spaceIndex + 1);
+        }
+    }
 
-    return finalText;
+    targetText.clear();
+    for (const auto& segment : target.segments)
+    {
+        switch (segment.type)
+        {
+        case alias_segment::kind::literal:
+            targetText.append(target.literals, segment.offset, segment.length);
+            break;
+        case alias_segment::kind::argument:
+            if (segment.argument < tokenCount)
+            {
+                targetText.append(til::at(tokens, segment.argument));
+            }
+            break;
+        case alias_segment::kind::all_arguments:
+            targetText.append(allArguments);
+            break;
+        }
+    }
+
+    lineCount = target.lineCount;
+    return true;
 }
 
 // Routine Description:
@@ -1208,13 +1261,16 @@ void Alias::s_MatchAndCopyAliasLegacy(_In_reads_bytes_(cbSource) PCWCH pwchSourc
 {
     try
     {
-        std::wstring sourceText(pwchSource, cbSource / sizeof(WCHAR));
-        size_t lineCount = lines;
+        // The source and target may point to the same memory, so the expansion has to be
+        // assembled elsewhere first. The buffer is reused across calls to avoid reallocating it
+        // on every enter. This is safe, because we're always called under the console lock.
+        static std::wstring targetText;
 
-        const auto targetText = s_MatchAndCopyAlias(sourceText, exeName, lineCount);
+        const std::wstring_view sourceText{ pwchSource, cbSource / sizeof(WCHAR) };
+        size_t lineCount = lines;
 
-        // Only return data if the reply was non-empty (we had a match).
-        if (!targetText.empty())
+        // Only return data if we had a match.
+        if (s_MatchAndCopyAlias(sourceText, exeName, targetText, lineCount))
         {
             const auto cchTargetSize = cbTargetSize / sizeof(wchar_t);
 
@@ -1243,7 +1299,7 @@ void Alias::s_TestAddAlias(std::wstring& exe,
                            std::wstring& alias,
                            std::wstring& target)
 {
-    g_aliasData[exe][alias] = target;
+    g_aliasData[exe][alias] = s_CompileTarget(target);
 }
 
 void Alias::s_TestClearAliases()
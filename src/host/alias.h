@@ -11,6 +11,8 @@ Abstract:
 --*/
 #pragma once
 
+struct alias_target;
+
 class Alias
 {
 public:
@@ -24,17 +26,17 @@ public:
                                           const std::wstring& exeName,
                                           DWORD& lines);
 
-    static std::wstring s_MatchAndCopyAlias(const std::wstring& sourceText,
-                                            const std::wstring& exeName,
-                                            size_t& lineCount);
+    static bool s_MatchAndCopyAlias(std::wstring_view sourceText,
+                                    const std::wstring& exeName,
+                                    std::wstring& targetText,
+                                    size_t& lineCount);
+
+    static alias_target s_CompileTarget(std::wstring target);
 
 private:
     static void s_TrimTrailingCrLf(std::wstring& str);
     static std::deque<std::wstring> s_Tokenize(const std::wstring& str);
     static std::wstring s_GetArgString(const std::wstring& str);
-    static size_t s_ReplaceMacros(std::wstring& str,
-                                  const std::deque<std::wstring>& tokens,
-                                  const std::wstring& fullArgString);
 
     static bool s_TryReplaceNumberedArgMacro(const wchar_t ch,
                                              std::wstring& appendToStr,
@@ -18,6 +18,9 @@
 using Microsoft::Console::Interactivity::ServiceLocator;
 using Microsoft::Console::VirtualTerminal::VtIo;
 
+// The number of times LockConsoleShared() was called on the current thread without a matching UnlockConsoleShared().
+static thread_local ULONG sharedLockDepth = 0;
+
 bool CONSOLE_INFORMATION::IsConsoleLocked() const noexcept
 {
     return _lock.is_locked();
@@ -26,13 +29,70 @@ bool CONSOLE_INFORMATION::IsConsoleLocked() const noexcept
 #pragma prefast(suppress : 26135, "Adding lock annotation spills into entire project. Future work.")
 void CONSOLE_INFORMATION::LockConsole() noexcept
 {
-    _lock.lock();
+    if constexpr (Feature_ConcurrentApiServer::IsEnabled())
+    {
+        // The read-only APIs that run under the shared lock still call LockConsole() internally.
+        // Their thread already excludes all writers, so there's nothing left to do here.
+        if (sharedLockDepth != 0)
+        {
+            return;
+        }
+
+        _lock.lock();
+        if (_lock.recursion_depth() == 1)
+        {
+            _sharedLock.lock();
+        }
+    }
+    else
+    {
+        _lock.lock();
+    }
 }
 
 #pragma prefast(suppress : 26135, "Adding lock annotation spills into entire project. Future work.")
 void CONSOLE_INFORMATION::UnlockConsole() noexcept
 {
-    _lock.unlock();
+    if constexpr (Feature_ConcurrentApiServer::IsEnabled())
+    {
+        if (sharedLockDepth != 0)
+        {
+            return;
+        }
+
+        if (_lock.recursion_depth() == 1)
+        {
+            _sharedLock.unlock();
+        }
+        _lock.unlock();
+    }
+    else
+    {
+        _lock.unlock();
+    }
+}
+
+// Routine Description:
+// - Locks the console for reading. Any number of threads may hold this lock at once,
+//   but none of them while another thread holds the lock via LockConsole().
+// - Calls to LockConsole() on a thread holding this lock turn into no-ops,
+//   so code running under it must not modify the console state.
+#pragma prefast(suppress : 26135, "Adding lock annotation spills into entire project. Future work.")
+void CONSOLE_INFORMATION::LockConsoleShared() noexcept
+{
+    if (sharedLockDepth++ == 0)
+    {
+        _sharedLock.lock_shared();
+    }
+}
+
+#pragma prefast(suppress : 26135, "Adding lock annotation spills into entire project. Future work.")
+void CONSOLE_INFORMATION::UnlockConsoleShared() noexcept
+{
+    if (--sharedLockDepth == 0)
+    {
+        _sharedLock.unlock_shared();
+    }
 }
 
 ULONG CONSOLE_INFORMATION::GetCSRecursionCount() const noexcept
@@ -130,8 +130,9 @@ void EventsToUnicode(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents,
 //   from the input buffer and in the peek case they are not.
 // Arguments:
 // - pInputBuffer - The input buffer to take records from to return to the client
-// - outEvents - The storage location to fill with input events
-// - eventReadCount - The number of events to read
+// - outRecords - The storage location to fill with input records. Usually
+// this is the output buffer of the API message. Its size is the number of records to read.
+// - recordsRead - On return, the number of records stored in outRecords
 // - pInputReadHandleData - A structure that will help us maintain
 // some input context across various calls on the same input
 // handle. Primarily used to restore the "other piece" of partially
@@ -150,8 +151,8 @@ void EventsToUnicode(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents,
 // block, this will be returned along with context in *ppWaiter.
 // - Or an out of memory/math/string error message in NTSTATUS format.
 [[nodiscard]] static NTSTATUS _DoGetConsoleInput(InputBuffer& inputBuffer,
-                                                 std::deque<std::unique_ptr<IInputEvent>>& outEvents,
-                                                 const size_t eventReadCount,
+                                                 const std::span<INPUT_RECORD> outRecords,
+                                                 size_t& recordsRead,
                                                  INPUT_READ_HANDLE_DATA& readHandleState,
                                                  const bool IsUnicode,
                                                  const bool IsPeek,
@@ -160,8 +161,9 @@ void EventsToUnicode(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents,
     try
     {
         waiter.reset();
+        recordsRead = 0;
 
-        if (eventReadCount == 0)
+        if (outRecords.empty())
         {
             return STATUS_SUCCESS;
         }
@@ -169,8 +171,8 @@ void EventsToUnicode(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents,
         LockConsole();
         auto Unlock = wil::scope_exit([&] { UnlockConsole(); });
 
-        const auto Status = inputBuffer.Read(outEvents,
-                                             eventReadCount,
+        const auto Status = inputBuffer.Read(outRecords,
+                                             recordsRead,
                                              IsPeek,
                                              true,
                                              IsUnicode,
@@ -182,8 +184,8 @@ void EventsToUnicode(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents,
             // to the read data object and send it back up to the server.
             waiter = std::make_unique<DirectReadData>(&inputBuffer,
                                                       &readHandleState,
-                                                      eventReadCount,
-                                                      std::move(outEvents));
+                                                      outRecords.size(),
+                                                      std::deque<std::unique_ptr<IInputEvent>>{});
         }
         return Status;
     }
@@ -199,8 +201,8 @@ void EventsToUnicode(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents,
 // - The A version will convert to W using the console's current Input codepage (see SetConsoleCP)
 // Arguments:
 // - context - The input buffer to take records from to return to the client
-// - outEvents - storage location for read events
-// - eventsToRead - The number of input events to read
+// - outRecords - storage location for read records. Its size is the number of records to read.
+// - recordsRead - on return, the number of records stored in outRecords
 // - readHandleState - A structure that will help us maintain
 // some input context across various calls on the same input
 // handle. Primarily used to restore the "other piece" of partially
@@ -210,16 +212,16 @@ void EventsToUnicode(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents,
 // buffer), this contains context that will allow the server to
 // restore this call later.
 [[nodiscard]] HRESULT ApiRoutines::PeekConsoleInputAImpl(IConsoleInputObject& context,
-                                                         std::deque<std::unique_ptr<IInputEvent>>& outEvents,
-                                                         const size_t eventsToRead,
+                                                         std::span<INPUT_RECORD> outRecords,
+                                                         size_t& recordsRead,
                                                          INPUT_READ_HANDLE_DATA& readHandleState,
                                                          std::unique_ptr<IWaitRoutine>& waiter) noexcept
 {
     try
     {
         auto Status = _DoGetConsoleInput(context,
-                                         outEvents,
-                                         eventsToRead,
+                                         outRecords,
+                                         recordsRead,
                                          readHandleState,
                                          false,
                                          true,
@@ -239,8 +241,8 @@ void EventsToUnicode(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents,
 // - The W version accepts UCS-2 formatted characters (wide characters)
 // Arguments:
 // - context - The input buffer to take records from to return to the client
-// - outEvents - storage location for read events
-// - eventsToRead - The number of input events to read
+// - outRecords - storage location for read records. Its size is the number of records to read.
+// - recordsRead - on return, the number of records stored in outRecords
 // - readHandleState - A structure that will help us maintain
 // some input context across various calls on the same input
 // handle. Primarily used to restore the "other piece" of partially
@@ -250,16 +252,16 @@ void EventsToUnicode(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents,
 // buffer), this contains context that will allow the server to
 // restore this call later.
 [[nodiscard]] HRESULT ApiRoutines::PeekConsoleInputWImpl(IConsoleInputObject& context,
-                                                         std::deque<std::unique_ptr<IInputEvent>>& outEvents,
-                                                         const size_t eventsToRead,
+                                                         std::span<INPUT_RECORD> outRecords,
+                                                         size_t& recordsRead,
                                                          INPUT_READ_HANDLE_DATA& readHandleState,
                                                          std::unique_ptr<IWaitRoutine>& waiter) noexcept
 {
     try
     {
         auto Status = _DoGetConsoleInput(context,
-                                         outEvents,
-                                         eventsToRead,
+                                         outRecords,
+                                         recordsRead,
                                          readHandleState,
                                          true,
                                          true,
@@ -279,8 +281,8 @@ void EventsToUnicode(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents,
 // - The A version will convert to W using the console's current Input codepage (see SetConsoleCP)
 // Arguments:
 // - context - The input buffer to take records from to return to the client
-// - outEvents - storage location for read events
-// - eventsToRead - The number of input events to read
+// - outRecords - storage location for read records. Its size is the number of records to read.
+// - recordsRead - on return, the number of records stored in outRecords
 // - readHandleState - A structure that will help us maintain
 // some input context across various calls on the same input
 // handle. Primarily used to restore the "other piece" of partially
@@ -290,16 +292,16 @@ void EventsToUnicode(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents,
 // buffer), this contains context that will allow the server to
 // restore this call later.
 [[nodiscard]] HRESULT ApiRoutines::ReadConsoleInputAImpl(IConsoleInputObject& context,
-                                                         std::deque<std::unique_ptr<IInputEvent>>& outEvents,
-                                                         const size_t eventsToRead,
+                                                         std::span<INPUT_RECORD> outRecords,
+                                                         size_t& recordsRead,
                                                          INPUT_READ_HANDLE_DATA& readHandleState,
                                                          std::unique_ptr<IWaitRoutine>& waiter) noexcept
 {
     try
     {
         auto Status = _DoGetConsoleInput(context,
-                                         outEvents,
-                                         eventsToRead,
+                                         outRecords,
+                                         recordsRead,
                                          readHandleState,
                                          false,
                                          false,
@@ -319,8 +321,8 @@ void EventsToUnicode(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents,
 // - The W version accepts UCS-2 formatted characters (wide characters)
 // Arguments:
 // - context - The input buffer to take records from to return to the client
-// - outEvents - storage location for read events
-// - eventsToRead - The number of input events to read
+// - outRecords - storage location for read records. Its size is the number of records to read.
+// - recordsRead - on return, the number of records stored in outRecords
 // - readHandleState - A structure that will help us maintain
 // some input context across various calls on the same input
 // handle. Primarily used to restore the "other piece" of partially
@@ -330,16 +332,16 @@ void EventsToUnicode(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents,
 // buffer), this contains context that will allow the server to
 // restore this call later.
 [[nodiscard]] HRESULT ApiRoutines::ReadConsoleInputWImpl(IConsoleInputObject& context,
-                                                         std::deque<std::unique_ptr<IInputEvent>>& outEvents,
-                                                         const size_t eventsToRead,
+                                                         std::span<INPUT_RECORD> outRecords,
+                                                         size_t& recordsRead,
                                                          INPUT_READ_HANDLE_DATA& readHandleState,
                                                          std::unique_ptr<IWaitRoutine>& waiter) noexcept
 {
     try
     {
         auto Status = _DoGetConsoleInput(context,
-                                         outEvents,
-                                         eventsToRead,
+                                         outRecords,
+                                         recordsRead,
                                          readHandleState,
                                          true,
                                          false,
@@ -364,7 +366,7 @@ void EventsToUnicode(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents,
 // Return Value:
 // - HRESULT indicating success or failure
 [[nodiscard]] static HRESULT _WriteConsoleInputWImplHelper(InputBuffer& context,
-                                                           std::deque<std::unique_ptr<IInputEvent>>& events,
+                                                           const std::span<const INPUT_RECORD> events,
                                                            size_t& written,
                                                            const bool append) noexcept
 {
@@ -426,7 +428,8 @@ void EventsToUnicode(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents,
             context.StoreWritePartialByteSequence(std::move(partialEvent));
         }
 
-        return _WriteConsoleInputWImplHelper(context, events, written, append);
+        const auto records = IInputEvent::ToInputRecords(events);
+        return _WriteConsoleInputWImplHelper(context, records, written, append);
     }
     CATCH_RETURN();
 }
@@ -451,13 +454,23 @@ void EventsToUnicode(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents,
     LockConsole();
     auto Unlock = wil::scope_exit([&] { UnlockConsole(); });
 
-    try
+    // The records are stored as they are. Reject the ones that IInputEvent::Create() wouldn't accept either.
+    for (const auto& record : buffer)
     {
-        auto events = IInputEvent::Create(buffer);
-
-        return _WriteConsoleInputWImplHelper(context, events, written, append);
+        switch (record.EventType)
+        {
+        case KEY_EVENT:
+        case MOUSE_EVENT:
+        case WINDOW_BUFFER_SIZE_EVENT:
+        case MENU_EVENT:
+        case FOCUS_EVENT:
+            break;
+        default:
+            return E_INVALIDARG;
+        }
     }
-    CATCH_RETURN();
+
+    return _WriteConsoleInputWImplHelper(context, buffer, written, append);
 }
 
 // Routine Description:
@@ -674,7 +687,6 @@ void EventsToUnicode(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents,
 {
     try
     {
-        const auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
         const auto& storageBuffer = context.GetActiveBuffer().GetTextBuffer();
         const auto storageSize = storageBuffer.GetSize().Dimensions();
 
@@ -712,40 +724,36 @@ void EventsToUnicode(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents,
         // We will start reading the buffer at the point of the top left corner (origin) of the (potentially adjusted) request
         const auto sourcePoint = clippedRequestRectangle.Origin();
 
-        // Get an iterator to the beginning of the return buffer
-        // We might have to seek this forward or skip around if we clipped the request.
-        auto targetIter = targetBuffer.begin();
-        til::point targetPos;
-        const auto targetLimit = Viewport::FromDimensions(targetPoint, clippedRequestRectangle.Dimensions());
-
-        // Get an iterator to the beginning of the request inside the screen buffer
-        // This should walk exactly along every cell of the clipped request.
-        auto sourceIter = storageBuffer.GetCellDataAt(sourcePoint, clippedRequestRectangle);
-
-        // Walk through every cell of the target, advancing the buffer.
-        // Validate that we always still have a valid iterator to the backing store,
-        // that we always are writing inside the user's buffer (before the end)
-        // and we're always targeting the user's buffer inside its original bounds.
-        while (sourceIter && targetIter < targetBuffer.end())
+        const auto width = clippedRequestRectangle.Width();
+        const auto height = clippedRequestRectangle.Height();
+
+        // Read each row of the clipped request directly, instead of walking the buffer with a TextBufferCellIterator.
+        // Converting the attributes into their legacy form is the expensive part, so it's only done once per run.
+        // The cells of the user's buffer outside of the clipped request are left untouched.
+        for (til::CoordType y = 0; y < height; ++y)
         {
-            // If the point we're trying to write is inside the limited buffer write zone...
-            if (targetLimit.IsInBounds(targetPos))
-            {
-                // Copy the data into position...
-                *targetIter = gci.AsCharInfo(*sourceIter);
-                // ... and advance the read iterator.
-                ++sourceIter;
-            }
+            const auto& row = storageBuffer.GetRowByOffset(sourcePoint.y + y);
+            auto attrIter = row.AttrBegin();
+            attrIter += sourcePoint.x;
 
-            // Always advance the write iterator, we might have skipped it due to clipping.
-            ++targetIter;
+            auto targetIndex = static_cast<size_t>(targetPoint.y + y) * targetSize.width + targetPoint.x;
+            TextAttribute lastAttr;
+            WORD legacyAttributes = 0;
 
-            // Increment the target
-            targetPos.x++;
-            if (targetPos.x >= targetSize.width)
+            // Validate that we're always writing inside the user's buffer (before the end).
+            for (til::CoordType x = 0; x < width && targetIndex < targetBuffer.size(); ++x, ++targetIndex, ++attrIter)
             {
-                targetPos.x = 0;
-                targetPos.y++;
+                const auto column = sourcePoint.x + x;
+                const auto& attr = *attrIter;
+                if (x == 0 || attr != lastAttr)
+                {
+                    lastAttr = attr;
+                    legacyAttributes = attr.GetLegacyAttributes();
+                }
+
+                auto& ci = til::at(targetBuffer, targetIndex);
+                ci.Char.UnicodeChar = Utf16ToUcs2(row.GlyphAt(column));
+                ci.Attributes = legacyAttributes | GeneratePublicApiAttributeFormat(row.DbcsAttrAt(column));
             }
         }
 
@@ -890,9 +898,13 @@ void EventsToUnicode(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents,
             // Convert to a CHAR_INFO view to fit into the iterator
             const auto charInfos = std::span<const CHAR_INFO>(subspan.data(), subspan.size());
 
-            // Make the iterator and write to the target position.
-            OutputCellIterator it(charInfos);
-            storageBuffer.Write(it, target);
+            // Write the entire row at once. Only if the DBCS leading/trailing bytes don't form proper
+            // pairs we need to write it cell by cell, which takes care of all their legacy quirks.
+            if (!storageBuffer.GetTextBuffer().WriteCharInfos(target, charInfos))
+            {
+                OutputCellIterator it(charInfos);
+                storageBuffer.Write(it, target);
+            }
         }
 
         // Since we've managed to write part of the request, return the clamped part that we actually used.
@@ -11,8 +11,92 @@
 #include "../../server/IoThread.h"
 #include "../_stream.h"
 #include "../getset.h"
+#include <til/hash.h>
 #include <til/u8u16convert.h>
 
+#include <filesystem>
+#include <fstream>
+
+// Performance-guided fuzzing
+// --------------------------
+// Crashes aren't the only bugs worth finding. If the CONHOST_FUZZ_PERF_THRESHOLD environment
+// variable is set to a cost in nanoseconds per input byte, every input is instead fed through
+// the VT state machine of the active screen buffer (StateMachine, AdaptDispatch and TextBuffer)
+// and timed. Inputs that are more expensive than that get saved as slow-<hash>.bin to the
+// directory in CONHOST_FUZZ_PERF_DIR (or the current one), so that algorithmic complexity
+// regressions can be reproduced from them. Inputs that take less than MinimumMeasurableTime
+// are never saved, because for those the cost per byte is dominated by timer resolution.
+//
+// When this is built without FUZZING_BUILD, main() runs a few known pathological inputs
+// through the same measurement and prints their cost.
+struct PerfFuzzingConfig
+{
+    static constexpr std::chrono::microseconds MinimumMeasurableTime{ 100 };
+
+    double thresholdNanosecondsPerByte = 0;
+    std::filesystem::path outputDirectory;
+
+    bool enabled() const noexcept
+    {
+        return thresholdNanosecondsPerByte > 0;
+    }
+};
+
+static std::wstring readEnvironmentVariable(const wchar_t* name)
+{
+    std::wstring value;
+    value.resize(GetEnvironmentVariableW(name, nullptr, 0));
+    if (!value.empty())
+    {
+        value.resize(GetEnvironmentVariableW(name, value.data(), gsl::narrow_cast<DWORD>(value.size())));
+    }
+    return value;
+}
+
+static const PerfFuzzingConfig& perfFuzzingConfig()
+{
+    static const auto config = []() {
+        PerfFuzzingConfig config;
+        if (const auto threshold = readEnvironmentVariable(L"CONHOST_FUZZ_PERF_THRESHOLD"); !threshold.empty())
+        {
+            config.thresholdNanosecondsPerByte = wcstod(threshold.c_str(), nullptr);
+        }
+        config.outputDirectory = readEnvironmentVariable(L"CONHOST_FUZZ_PERF_DIR");
+        return config;
+    }();
+    return config;
+}
+
+// Runs the input through the VT output path and returns the time it took, per input byte.
+// Saves the input if it exceeds the threshold in the given config.
+static double measureInput(const std::string_view input, const PerfFuzzingConfig& config)
+{
+    auto& gci = Microsoft::Console::Interactivity::ServiceLocator::LocateGlobals().getConsoleInformation();
+
+    const auto u16String{ til::u8u16(input) };
+
+    gci.LockConsole();
+    auto u = wil::scope_exit([&]() { gci.UnlockConsole(); });
+
+    auto& machine = gci.GetActiveOutputBuffer().GetStateMachine();
+    const auto start = std::chrono::steady_clock::now();
+    machine.ProcessString(u16String);
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    // Each input should start out from a clean slate, without any sequence half-way parsed.
+    machine.ResetState();
+
+    const auto nanosecondsPerByte = std::chrono::duration<double, std::nano>(elapsed).count() / std::max<size_t>(input.size(), 1);
+    if (config.enabled() && elapsed >= PerfFuzzingConfig::MinimumMeasurableTime && nanosecondsPerByte > config.thresholdNanosecondsPerByte)
+    {
+        const auto name = fmt::format(FMT_COMPILE(L"slow-{:016x}.bin"), til::hash(input.data(), input.size()));
+        std::ofstream file{ config.outputDirectory / name, std::ios::binary | std::ios::trunc };
+        file.write(input.data(), gsl::narrow_cast<std::streamsize>(input.size()));
+    }
+
+    return nanosecondsPerByte;
+}
+
 struct NullDeviceComm : public IDeviceComm
 {
     HRESULT SetServerInformation(CD_IO_SERVER_INFORMATION* const) const override
@@ -118,19 +202,86 @@ extern "C" __declspec(dllexport) HRESULT RunConhost()
 
 #ifdef FUZZING_BUILD
 extern "C" __declspec(dllexport) int LLVMFuzzerInitialize(int* /*argc*/, char*** /*argv*/)
+{
+    RETURN_IF_FAILED(RunConhost());
+    return 0;
+}
 #else
+// Inputs that have caused (or would cause) a VT implementation to spend a lot more
+// than linear time on them, or that hit particularly slow paths of our own.
+static std::vector<std::pair<const char*, std::string>> pathologicalInputs()
+{
+    std::vector<std::pair<const char*, std::string>> inputs;
+
+    // A parameter list far longer than anything we store.
+    auto& params = inputs.emplace_back("huge parameter list", "\x1b[").second;
+    for (auto i = 0; i < 65536; ++i)
+    {
+        params.append("1;");
+    }
+    params.push_back('m');
+
+    // A single OSC string of a megabyte.
+    auto& osc = inputs.emplace_back("deep OSC string", "\x1b]2;").second;
+    osc.append(1024 * 1024, 'a');
+    osc.push_back('\x07');
+
+    // Setting scroll margins and scrolling within them, over and over.
+    auto& scroll = inputs.emplace_back("repeated DECSTBM/scroll", "").second;
+    for (auto i = 0; i < 4096; ++i)
+    {
+        scroll.append("\x1b[2;24r\x1b[24H\n\n\x1b[S\x1b[T\x1b[r");
+    }
+
+    // REP with the largest count we accept.
+    auto& rep = inputs.emplace_back("REP with large counts", "").second;
+    for (auto i = 0; i < 64; ++i)
+    {
+        rep.append("a\x1b[32767b");
+    }
+
+    // Wide glyphs (U+4E00), which keep getting split in half by cursor movement.
+    auto& wide = inputs.emplace_back("wide glyph storm", "").second;
+    for (auto i = 0; i < 4096; ++i)
+    {
+        for (auto x = 0; x < 40; ++x)
+        {
+            wide.append("\xe4\xb8\x80");
+        }
+        wide.append("\x1b[1;2Hx\r\n");
+    }
+
+    return inputs;
+}
+
 int main(int /*argc*/, char** /*argv*/)
-#endif
 {
     RETURN_IF_FAILED(RunConhost());
+
+    const auto& config = perfFuzzingConfig();
+    for (const auto& [name, input] : pathologicalInputs())
+    {
+        const auto cost = measureInput(input, config);
+        printf("%-24s %10.2f ns/byte\n", name, cost);
+    }
+
     return 0;
 }
+#endif
 
 extern "C" __declspec(dllexport) int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
 {
+    const std::string_view input{ reinterpret_cast<const char*>(data), size };
+
+    if (const auto& config = perfFuzzingConfig(); config.enabled())
+    {
+        (void)measureInput(input, config);
+        return 0;
+    }
+
     auto& gci = Microsoft::Console::Interactivity::ServiceLocator::LocateGlobals().getConsoleInformation();
 
-    const auto u16String{ til::u8u16(std::string_view{ reinterpret_cast<const char*>(data), size }) };
+    const auto u16String{ til::u8u16(input) };
     til::CoordType scrollY{};
     auto sizeInBytes{ u16String.size() * 2 };
     gci.LockConsole();
@@ -5,6 +5,7 @@
 
 #include "../types/inc/viewport.hpp"
 
+#include <chrono>
 #include <thread>
 #include <vector>
 #include <algorithm>
@@ -29,6 +30,10 @@ class OutputTests
     TEST_METHOD(BasicWriteConsoleOutputWTest);
     TEST_METHOD(BasicWriteConsoleOutputATest);
 
+    BEGIN_TEST_METHOD(FullScreenWriteReadConsoleOutputWPerf)
+        TEST_METHOD_PROPERTY(L"IsPerfTest", L"true")
+    END_TEST_METHOD()
+
     TEST_METHOD(WriteConsoleOutputWOutsideBuffer);
     TEST_METHOD(WriteConsoleOutputWWithClipping);
     TEST_METHOD(WriteConsoleOutputWNegativePositions);
@@ -89,6 +94,51 @@ void OutputTests::BasicWriteConsoleOutputWTest()
     VERIFY_ARE_EQUAL(region, affected);
 }
 
+// Legacy full-screen applications redraw their entire window with WriteConsoleOutputW() every frame.
+// Run with: te.exe ConHost.Feature.Tests.dll /select:"@IsPerfTest=true"
+void OutputTests::FullScreenWriteReadConsoleOutputWPerf()
+{
+    static constexpr auto frames = 500;
+
+    const auto consoleOutputHandle = GetStdOutputHandle();
+    SetConsoleActiveScreenBuffer(consoleOutputHandle);
+
+    CONSOLE_SCREEN_BUFFER_INFOEX sbiex{ 0 };
+    sbiex.cbSize = sizeof(sbiex);
+    VERIFY_WIN32_BOOL_SUCCEEDED(GetConsoleScreenBufferInfoEx(consoleOutputHandle, &sbiex));
+
+    const auto& window = sbiex.srWindow;
+    const COORD regionDimensions{ window.Right - window.Left + 1, window.Bottom - window.Top + 1 };
+    const auto regionSize = regionDimensions.X * regionDimensions.Y;
+    const COORD regionOrigin{ 0, 0 };
+
+    // Runs of colored text, similar to what a file manager with 2 panels would draw.
+    std::vector<CHAR_INFO> buffer(regionSize);
+    for (auto i = 0; i < regionSize; ++i)
+    {
+        buffer[i].Char.UnicodeChar = static_cast<wchar_t>(L'!' + i % 94);
+        buffer[i].Attributes = static_cast<WORD>(0x1f + (i / 16) % 4 * 0x10);
+    }
+
+    const auto measure = [&](const wchar_t* name, auto&& func) {
+        const auto start = std::chrono::steady_clock::now();
+        for (auto i = 0; i < frames; ++i)
+        {
+            auto affected = window;
+            VERIFY_WIN32_BOOL_SUCCEEDED(func(affected));
+        }
+        const auto elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        Log::Comment(NoThrowString().Format(L"%s: %dx%d cells, %.1f us/frame", name, regionDimensions.X, regionDimensions.Y, elapsed / frames));
+    };
+
+    measure(L"WriteConsoleOutputW", [&](SMALL_RECT& affected) {
+        return WriteConsoleOutputW(consoleOutputHandle, buffer.data(), regionDimensions, regionOrigin, &affected);
+    });
+    measure(L"ReadConsoleOutputW", [&](SMALL_RECT& affected) {
+        return ReadConsoleOutputW(consoleOutputHandle, buffer.data(), regionDimensions, regionOrigin, &affected);
+    });
+}
+
 void OutputTests::BasicWriteConsoleOutputATest()
 {
     // Get output buffer information.
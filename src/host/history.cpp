@@ -31,6 +31,7 @@ using Microsoft::Console::Interactivity::ServiceLocator;
 // If CommandHistory::s_Allocate and friends stop shuffling elements
 // for maintaining LRU, then this datatype can be changed.
 std::list<CommandHistory> CommandHistory::s_historyLists;
+std::filesystem::path CommandHistory::s_persistentHistoryDirectory;
 
 CommandHistory* CommandHistory::s_Find(const HANDLE processHandle)
 {
@@ -55,6 +56,8 @@ void CommandHistory::s_Free(const HANDLE processHandle)
     const auto History = CommandHistory::s_Find(processHandle);
     if (History)
     {
+        History->_SavePersistentHistory();
+
         WI_ClearFlag(History->Flags, CLE_ALLOCATED);
         History->_processHandle = nullptr;
     }
@@ -119,7 +122,7 @@ void CommandHistory::_Reset()
             // find free record.  if all records are used, free the lru one.
             if ((SHORT)_commands.size() == _maxCommands)
             {
-                _commands.erase(_commands.cbegin());
+                _Erase(0);
                 // move LastDisplayed back one in order to stay synced with the
                 // command it referred to before erasing the lru one
                 --LastDisplayed;
@@ -128,12 +131,13 @@ void CommandHistory::_Reset()
             // add newCommand to array
             if (!reuse.empty())
             {
-                _commands.emplace_back(reuse);
+                _Append(std::move(reuse));
             }
             else
             {
-                _commands.emplace_back(newCommand);
+                _Append(std::wstring{ newCommand });
             }
+            _persistentHistoryChanged = true;
 
             if (LastDisplayed == -1 ||
                 _commands.at(LastDisplayed).size() != newCommand.size() ||
@@ -243,7 +247,8 @@ std::wstring_view CommandHistory::GetLastCommand() const
 
 void CommandHistory::Empty()
 {
-    _commands.clear();
+    _Clear();
+    _persistentHistoryChanged = true;
     LastDisplayed = -1;
     WI_SetFlag(Flags, CLE_RESET);
 }
@@ -277,13 +282,11 @@ void CommandHistory::Realloc(const size_t commands)
         return;
     }
 
-    const auto oldCommands = _commands;
     const auto newNumberOfCommands = gsl::narrow<SHORT>(std::min(_commands.size(), commands));
 
-    _commands.clear();
-    for (SHORT i = 0; i < newNumberOfCommands; i++)
+    while (_commands.size() > gsl::narrow_cast<size_t>(newNumberOfCommands))
     {
-        _commands.emplace_back(oldCommands[i]);
+        _Erase(_commands.size() - 1);
     }
 
     WI_SetFlag(Flags, CLE_RESET);
@@ -325,6 +328,16 @@ size_t CommandHistory::s_CountOfHistories()
     return s_historyLists.size();
 }
 
+// Routine Description:
+// - Enables persisting the command history of each executable in a file in the given directory.
+//   A history is loaded once the first client of its executable attaches and saved once one detaches.
+// Arguments:
+// - directory - The directory to store the files in. It's created if necessary.
+void CommandHistory::s_SetPersistentHistoryDirectory(std::filesystem::path directory)
+{
+    s_persistentHistoryDirectory = std::move(directory);
+}
+
 // Routine Description:
 // - This routine returns the LRU command history buffer, or the command history buffer that corresponds to the app name.
 // Arguments:
@@ -365,6 +378,7 @@ CommandHistory* CommandHistory::s_Allocate(const std::wstring_view appName, cons
         History.LastDisplayed = -1;
         History._maxCommands = gsl::narrow<SHORT>(gci.GetHistoryBufferSize());
         History._processHandle = processHandle;
+        History._LoadPersistentHistory();
         return &s_historyLists.emplace_front(History);
     }
 
@@ -396,9 +410,10 @@ CommandHistory* CommandHistory::s_Allocate(const std::wstring_view appName, cons
     {
         if (!SameApp)
         {
-            BestCandidate->_commands.clear();
+            BestCandidate->_Clear();
             BestCandidate->LastDisplayed = -1;
             BestCandidate->_appName = appName;
+            BestCandidate->_LoadPersistentHistory();
         }
 
         BestCandidate->_processHandle = processHandle;
@@ -479,7 +494,7 @@ std::wstring CommandHistory::Remove(const SHORT iDel)
 
         if (iDel < iLast)
         {
-            _commands.erase(_commands.cbegin() + iDel);
+            _Erase(iDel);
             if ((iDisp > iDel) && (iDisp <= iLast))
             {
                 _Dec(iDisp);
@@ -488,7 +503,7 @@ std::wstring CommandHistory::Remove(const SHORT iDel)
         }
         else if (iFirst <= iDel)
         {
-            _commands.erase(_commands.cbegin() + iDel);
+            _Erase(iDel);
             if ((iDisp >= iFirst) && (iDisp < iDel))
             {
                 _Inc(iDisp);
@@ -497,6 +512,7 @@ std::wstring CommandHistory::Remove(const SHORT iDel)
         }
 
         LastDisplayed = iDisp;
+        _persistentHistoryChanged = true;
         return str;
     }
     CATCH_LOG();
@@ -532,26 +548,177 @@ std::wstring CommandHistory::Remove(const SHORT iDel)
         return true;
     }
 
-    try
+    // The match we're looking for is the first one we'd encounter by going backwards
+    // from indexFound (wrapping around at the start), which is the one closest to it.
+    const auto size = _commands.size();
+    const auto start = gsl::narrow_cast<size_t>(indexFound);
+    auto bestDistance = size;
+    const auto consider = [&](const uint64_t id) noexcept {
+        const auto index = _IndexOfId(id);
+        const auto distance = (start + size - index) % size;
+        if (distance < bestDistance)
+        {
+            bestDistance = distance;
+            indexFound = gsl::narrow_cast<SHORT>(index);
+        }
+    };
+
+    // The index is sorted by the commands, so all commands that start with givenCommand are adjacent.
+    if (WI_IsFlagSet(options, MatchOptions::ExactMatch))
     {
-        for (size_t i = 0; i < _commands.size(); i++)
+        const auto [begin, end] = _index.equal_range(givenCommand);
+        for (auto it = begin; it != end; ++it)
         {
-            const auto& storedCommand = _commands.at(indexFound);
-            if ((WI_IsFlagClear(options, MatchOptions::ExactMatch) && (givenCommand.size() <= storedCommand.size())) || (givenCommand.size() == storedCommand.size()))
-            {
-                if (til::starts_with(storedCommand, givenCommand))
-                {
-                    return true;
-                }
-            }
+            consider(it->second);
+        }
+    }
+    else
+    {
+        for (auto it = _index.lower_bound(givenCommand); it != _index.end() && til::starts_with(it->first, givenCommand); ++it)
+        {
+            consider(it->second);
+        }
+    }
 
-            _Prev(indexFound);
+    if (bestDistance == size)
+    {
+        indexFound = gsl::narrow_cast<SHORT>(start);
+        return false;
+    }
+    return true;
+}
+
+void CommandHistory::_Append(std::wstring command)
+{
+    _index.emplace(command, _nextId);
+    _ids.emplace_back(_nextId);
+    _commands.emplace_back(std::move(command));
+    _nextId++;
+}
+
+void CommandHistory::_Erase(const size_t index)
+{
+    _index.erase(_FindInIndex(index));
+    _ids.erase(_ids.begin() + index);
+    _commands.erase(_commands.begin() + index);
+}
+
+void CommandHistory::_Clear() noexcept
+{
+    _commands.clear();
+    _ids.clear();
+    _index.clear();
+}
+
+// Returns the entry in _index that belongs to the command at the given index in _commands.
+std::multimap<std::wstring, uint64_t, std::less<>>::iterator CommandHistory::_FindInIndex(const size_t index)
+{
+    const auto id = _ids.at(index);
+    auto [it, end] = _index.equal_range(_commands.at(index));
+    while (it != end && it->second != id)
+    {
+        ++it;
+    }
+    FAIL_FAST_IF(it == end);
+    return it;
+}
+
+size_t CommandHistory::_IndexOfId(const uint64_t id) const noexcept
+{
+    return gsl::narrow_cast<size_t>(std::lower_bound(_ids.begin(), _ids.end(), id) - _ids.begin());
+}
+
+// Returns the path of the file that this executable's commands are persisted in,
+// or an empty path if persistence is disabled.
+std::filesystem::path CommandHistory::_PersistentHistoryPath() const
+{
+    if (s_persistentHistoryDirectory.empty() || _appName.empty())
+    {
+        return {};
+    }
+
+    auto path = s_persistentHistoryDirectory / _appName;
+    path += L".txt";
+    return path;
+}
+
+// Routine Description:
+// - Reads the commands persisted by _SavePersistentHistory() into this (empty) history.
+// - This happens only once the first client process of an executable attaches,
+//   instead of for all executables when the console starts.
+void CommandHistory::_LoadPersistentHistory()
+try
+{
+    const auto path = _PersistentHistoryPath();
+    if (path.empty())
+    {
+        return;
+    }
+
+    std::ifstream file{ path, std::ios::binary };
+    if (!file)
+    {
+        return;
+    }
+
+    const std::string content{ std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{} };
+    std::wstring text;
+    THROW_IF_FAILED(til::u8u16(content, text));
+
+    // Only the most recent commands fit in, which are at the end of the file.
+    std::vector<std::wstring_view> lines;
+    std::wstring_view remaining{ text };
+    while (!remaining.empty())
+    {
+        const auto end = std::min(remaining.find(L'\n'), remaining.size());
+        if (end != 0)
+        {
+            lines.emplace_back(remaining.substr(0, end));
         }
+        remaining = remaining.substr(std::min(end + 1, remaining.size()));
     }
-    CATCH_LOG();
 
-    return false;
+    const auto count = std::min(lines.size(), gsl::narrow_cast<size_t>(std::max<SHORT>(_maxCommands, 0)));
+    for (auto it = lines.end() - count; it != lines.end(); ++it)
+    {
+        _Append(std::wstring{ *it });
+    }
+
+    LastDisplayed = gsl::narrow<SHORT>(_commands.size()) - 1;
+    _persistentHistoryChanged = false;
+}
+CATCH_LOG()
+
+// Routine Description:
+// - Writes the commands to this executable's persistent history file, if they changed.
+void CommandHistory::_SavePersistentHistory() const
+try
+{
+    const auto path = _PersistentHistoryPath();
+    if (!_persistentHistoryChanged || path.empty())
+    {
+        return;
+    }
+
+    std::wstring text;
+    for (const auto& command : _commands)
+    {
+        // Commands are stored one per line, so those that span multiple lines can't be persisted.
+        if (command.find_first_of(L"\r\n") == std::wstring::npos)
+        {
+            text.append(command);
+            text.push_back(L'\n');
+        }
+    }
+
+    std::string content;
+    THROW_IF_FAILED(til::u16u8(text, content));
+
+    std::filesystem::create_directories(path.parent_path());
+    std::ofstream file{ path, std::ios::binary | std::ios::trunc };
+    file.write(content.data(), gsl::narrow<std::streamsize>(content.size()));
 }
+CATCH_LOG()
 
 #ifdef UNIT_TESTING
 void CommandHistory::s_ClearHistoryListStorage()
@@ -567,7 +734,18 @@ void CommandHistory::s_ClearHistoryListStorage()
 // - indexB - index of one history item to swap
 void CommandHistory::Swap(const short indexA, const short indexB)
 {
-    std::swap(_commands.at(indexA), _commands.at(indexB));
+    auto& commandA = _commands.at(indexA);
+    auto& commandB = _commands.at(indexB);
+    if (indexA == indexB)
+    {
+        return;
+    }
+
+    // The IDs stay where they are, so that _ids remains sorted.
+    // Instead, the commands trade their IDs in the index.
+    std::swap(_FindInIndex(indexA)->second, _FindInIndex(indexB)->second);
+    std::swap(commandA, commandB);
+    _persistentHistoryChanged = true;
 }
 
 // Routine Description:
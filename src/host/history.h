@@ -26,6 +26,7 @@ public:
     static void s_Free(const HANDLE processHandle);
     static void s_ResizeAll(const size_t commands);
     static size_t s_CountOfHistories();
+    static void s_SetPersistentHistoryDirectory(std::filesystem::path directory);
 
     enum class MatchOptions
     {
@@ -75,6 +76,16 @@ public:
 private:
     void _Reset();
 
+    void _Append(std::wstring command);
+    void _Erase(const size_t index);
+    void _Clear() noexcept;
+    std::multimap<std::wstring, uint64_t, std::less<>>::iterator _FindInIndex(const size_t index);
+    size_t _IndexOfId(const uint64_t id) const noexcept;
+
+    std::filesystem::path _PersistentHistoryPath() const;
+    void _LoadPersistentHistory();
+    void _SavePersistentHistory() const;
+
     // _Next and _Prev go to the next and prev command
     // _Inc  and _Dec go to the next and prev slots
     // Don't get the two confused - it matters when the cmd history is not full!
@@ -84,12 +95,22 @@ private:
     void _Inc(SHORT& ind) const;
 
     std::vector<std::wstring> _commands;
+    // Each command gets a unique ID that increases with every _Append(). Commands are only ever
+    // appended or erased and Swap() leaves the IDs in place (it swaps them in _index instead), so _ids is sorted.
+    std::vector<uint64_t> _ids;
+    uint64_t _nextId = 0;
+    // Maps each command to its ID, so that FindMatchingCommand() only needs to look at the matching ones.
+    std::multimap<std::wstring, uint64_t, std::less<>> _index;
     SHORT _maxCommands;
+    // Whether the commands changed since they were loaded from the persistent history file.
+    bool _persistentHistoryChanged = false;
 
     std::wstring _appName;
     HANDLE _processHandle;
 
     static std::list<CommandHistory> s_historyLists;
+    // If set, the commands of each executable are persisted in a file in this directory.
+    static std::filesystem::path s_persistentHistoryDirectory;
 
 public:
     DWORD Flags;
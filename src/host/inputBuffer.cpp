@@ -10,6 +10,7 @@
 #include <til/bytes.h>
 
 #include "misc.h"
+#include "../interactivity/inc/EventSynthesis.hpp"
 #include "../interactivity/inc/ServiceLocator.hpp"
 
 #define INPUT_BUFFER_DEFAULT_INPUT_MODE (ENABLE_LINE_INPUT | ENABLE_PROCESSED_INPUT | ENABLE_ECHO_INPUT | ENABLE_MOUSE_INPUT)
@@ -18,6 +19,34 @@ using Microsoft::Console::Interactivity::ServiceLocator;
 using Microsoft::Console::VirtualTerminal::TerminalInput;
 using namespace Microsoft::Console;
 
+// Converts events coming in through the IInputEvent based APIs into the records that we store.
+static std::vector<INPUT_RECORD> toRecords(std::deque<std::unique_ptr<IInputEvent>>& inEvents)
+{
+    std::vector<INPUT_RECORD> records;
+    records.reserve(inEvents.size());
+    for (const auto& event : inEvents)
+    {
+        records.push_back(event->ToInputRecord());
+    }
+    inEvents.clear();
+    return records;
+}
+
+// Synthesizes the key events that represent typing the given text.
+static std::vector<INPUT_RECORD> textToRecords(const std::wstring_view text, const unsigned int codepage)
+{
+    std::vector<INPUT_RECORD> records;
+    records.reserve(text.size() * 2);
+    for (const auto& wch : text)
+    {
+        for (const auto& keyEvent : Interactivity::CharToKeyEvents(wch, codepage))
+        {
+            records.push_back(keyEvent->ToInputRecord());
+        }
+    }
+    return records;
+}
+
 // Routine Description:
 // - This method creates an input buffer.
 // Arguments:
@@ -157,60 +186,6 @@ void InputBuffer::Cache(std::wstring_view source)
     _cachedTextReaderW = std::wstring_view{ _cachedTextW }.substr(off);
 }
 
-// Moves up to `count`, previously cached events into `target`.
-size_t InputBuffer::ConsumeCached(bool isUnicode, size_t count, InputEventQueue& target)
-{
-    _switchReadingMode(isUnicode ? ReadingMode::InputEventsW : ReadingMode::InputEventsA);
-
-    size_t i = 0;
-
-    while (i < count && !_cachedInputEvents.empty())
-    {
-        target.push_back(std::move(_cachedInputEvents.front()));
-        _cachedInputEvents.pop_front();
-        i++;
-    }
-
-    return i;
-}
-
-// Copies up to `count`, previously cached events into `target`.
-size_t InputBuffer::PeekCached(bool isUnicode, size_t count, InputEventQueue& target)
-{
-    _switchReadingMode(isUnicode ? ReadingMode::InputEventsW : ReadingMode::InputEventsA);
-
-    size_t i = 0;
-
-    for (const auto& e : _cachedInputEvents)
-    {
-        if (i >= count)
-        {
-            break;
-        }
-
-        target.push_back(IInputEvent::Create(e->ToInputRecord()));
-        i++;
-    }
-
-    return i;
-}
-
-// Trims `source` to have a size below or equal to `expectedSourceSize` by
-// storing any extra events in `_cachedInputEvents` for later retrieval.
-void InputBuffer::Cache(bool isUnicode, InputEventQueue& source, size_t expectedSourceSize)
-{
-    _switchReadingMode(isUnicode ? ReadingMode::InputEventsW : ReadingMode::InputEventsA);
-
-    if (source.size() > expectedSourceSize)
-    {
-        _cachedInputEvents.insert(
-            _cachedInputEvents.end(),
-            std::make_move_iterator(source.begin() + expectedSourceSize),
-            std::make_move_iterator(source.end()));
-        source.resize(expectedSourceSize);
-    }
-}
-
 void InputBuffer::_switchReadingMode(ReadingMode mode)
 {
     if (_readingMode != mode)
@@ -292,6 +267,8 @@ void InputBuffer::ReinitializeInputBuffer()
     ServiceLocator::LocateGlobals().hInputEvent.ResetEvent();
     InputMode = INPUT_BUFFER_DEFAULT_INPUT_MODE;
     _storage.clear();
+    _pendingText.clear();
+    _pendingTextReader = {};
 }
 
 // Routine Description:
@@ -302,9 +279,38 @@ void InputBuffer::ReinitializeInputBuffer()
 // - None
 void InputBuffer::WakeUpReadersWaitingForData()
 {
+    if (_writeBatchDepth)
+    {
+        _wakeUpPending = true;
+        return;
+    }
     WaitQueue.NotifyWaiters(false);
 }
 
+// Routine Description:
+// - Starts a batch of writes, for instance all the input of a single read from the ConPTY input pipe.
+//   Until the matching EndWriteBatch(), readers aren't woken up after every single write,
+//   which would otherwise make for one wake-up per key event during a large paste.
+// - Batches can be nested. Waking up the readers happens at the end of the outermost one.
+// Note:
+// - The console lock must be held for the whole batch.
+void InputBuffer::BeginWriteBatch() noexcept
+{
+    _writeBatchDepth++;
+}
+
+// Routine Description:
+// - Ends a batch of writes started by BeginWriteBatch() and wakes up
+//   the readers if anything was written during the batch.
+void InputBuffer::EndWriteBatch()
+{
+    FAIL_FAST_IF(_writeBatchDepth == 0);
+    if (--_writeBatchDepth == 0 && std::exchange(_wakeUpPending, false))
+    {
+        WaitQueue.NotifyWaiters(false);
+    }
+}
+
 // Routine Description:
 // - Wakes up any readers waiting for data when a ctrl-c or ctrl-break is input.
 // Arguments:
@@ -313,6 +319,12 @@ void InputBuffer::WakeUpReadersWaitingForData()
 // - None
 void InputBuffer::TerminateRead(_In_ WaitTerminationReason Flag)
 {
+    // The input that was written before the termination (like the text before a Ctrl+C)
+    // must still reach the readers first, like it would have without a write batch.
+    if (std::exchange(_wakeUpPending, false))
+    {
+        WaitQueue.NotifyWaiters(false);
+    }
     WaitQueue.NotifyWaiters(true, Flag);
 }
 
@@ -326,7 +338,9 @@ void InputBuffer::TerminateRead(_In_ WaitTerminationReason Flag)
 // - The console lock must be held when calling this routine.
 size_t InputBuffer::GetNumberOfReadyEvents() const noexcept
 {
-    return _storage.size();
+    // Pending text hasn't been turned into key events yet. Most characters
+    // become a key down and up, which is good enough for an estimate.
+    return _storage.size() + _pendingTextReader.size() * 2;
 }
 
 // Routine Description:
@@ -340,6 +354,8 @@ size_t InputBuffer::GetNumberOfReadyEvents() const noexcept
 void InputBuffer::Flush()
 {
     _storage.clear();
+    _pendingText.clear();
+    _pendingTextReader = {};
     ServiceLocator::LocateGlobals().hInputEvent.ResetEvent();
 }
 
@@ -353,10 +369,9 @@ void InputBuffer::Flush()
 // - The console lock must be held when calling this routine.
 void InputBuffer::FlushAllButKeys()
 {
-    auto newEnd = std::remove_if(_storage.begin(), _storage.end(), [](const std::unique_ptr<IInputEvent>& event) {
-        return event->EventType() != InputEventType::KeyEvent;
+    _storage.erase_if([](const INPUT_RECORD& record) {
+        return record.EventType != KEY_EVENT;
     });
-    _storage.erase(newEnd, _storage.end());
 }
 
 void InputBuffer::SetTerminalConnection(_In_ Render::VtEngine* const pTtyConnection)
@@ -406,47 +421,122 @@ try
 {
     assert(OutEvents.empty());
 
+    std::vector<INPUT_RECORD> records(AmountToRead);
+    size_t read = 0;
+    const auto Status = Read(records, read, Peek, WaitForData, Unicode, Stream);
+
+    for (size_t i = 0; i < read; ++i)
+    {
+        OutEvents.push_back(IInputEvent::Create(til::at(records, i)));
+    }
+
+    return Status;
+}
+catch (...)
+{
+    return NTSTATUS_FROM_HRESULT(wil::ResultFromCaughtException());
+}
+
+// Routine Description:
+// - Same as the Read() above, but the records are written straight into `target`, which is usually
+//   the output buffer of the API message. This avoids allocating an IInputEvent for every record,
+//   which is what makes a difference for clients that read thousands of records at once.
+// - If the last character doesn't fit into `target` as a whole, because it's converted into
+//   multiple DBCS bytes, the remaining bytes are returned by the next read.
+// Note:
+// - The console lock must be held when calling this routine.
+// Arguments:
+// - target - where the read records are stored. Its size is the amount of records to try to read.
+// - read - on return, the number of records that were stored in `target`
+// - Peek - If true, copy events to pInputRecord but don't remove them from the input buffer.
+// - WaitForData - if true, wait until an event is input (if there aren't enough to fill client buffer). if false, return immediately
+// - Unicode - true if the data in key events should be treated as unicode. false if they should be converted by the current input CP.
+// - Stream - true if read should unpack KeyEvents that have a >1 repeat count. AmountToRead must be 1 if Stream is true.
+// Return Value:
+// - STATUS_SUCCESS if records were read into the client buffer and everything is OK.
+// - CONSOLE_STATUS_WAIT if there weren't enough records to satisfy the request (and waits are allowed)
+// - otherwise a suitable memory/math/string error in NTSTATUS form.
+[[nodiscard]] NTSTATUS InputBuffer::Read(const std::span<INPUT_RECORD> target,
+                                         size_t& read,
+                                         const bool Peek,
+                                         const bool WaitForData,
+                                         const bool Unicode,
+                                         const bool Stream)
+try
+{
+    read = 0;
+
+    _MaterializePendingText();
+    _switchReadingMode(Unicode ? ReadingMode::InputEventsW : ReadingMode::InputEventsA);
+
     const auto cp = ServiceLocator::LocateGlobals().getConsoleInformation().CP;
+    const auto amountToRead = target.size();
 
+    // The bytes that didn't fit into the previous read are returned first.
     if (Peek)
     {
-        PeekCached(Unicode, AmountToRead, OutEvents);
+        for (const auto& e : _cachedInputEvents)
+        {
+            if (read >= amountToRead)
+            {
+                break;
+            }
+            til::at(target, read++) = e->ToInputRecord();
+        }
     }
     else
     {
-        ConsumeCached(Unicode, AmountToRead, OutEvents);
+        while (read < amountToRead && !_cachedInputEvents.empty())
+        {
+            til::at(target, read++) = _cachedInputEvents.front()->ToInputRecord();
+            _cachedInputEvents.pop_front();
+        }
     }
 
+    // Whatever doesn't fit into `target` anymore is cached for the next read.
+    const auto push = [&](const INPUT_RECORD& record) {
+        if (read < amountToRead)
+        {
+            til::at(target, read++) = record;
+        }
+        else
+        {
+            _cachedInputEvents.push_back(IInputEvent::Create(record));
+        }
+    };
+
     auto it = _storage.begin();
     const auto end = _storage.end();
 
-    while (it != end && OutEvents.size() < AmountToRead)
+    while (it != end && read < amountToRead)
     {
-        auto event = IInputEvent::Create((*it)->ToInputRecord());
+        auto record = *it;
 
-        if (event->EventType() == InputEventType::KeyEvent)
+        if (record.EventType == KEY_EVENT)
         {
-            const auto keyEvent = static_cast<KeyEvent*>(event.get());
+            auto& keyEvent = record.Event.KeyEvent;
+            // The records are returned the way an IInputEvent would have turned them back into one.
+            keyEvent.bKeyDown = !!keyEvent.bKeyDown;
             WORD repeat = 1;
 
             // for stream reads we need to split any key events that have been coalesced
             if (Stream)
             {
-                repeat = keyEvent->GetRepeatCount();
-                keyEvent->SetRepeatCount(1);
+                repeat = keyEvent.wRepeatCount;
+                keyEvent.wRepeatCount = 1;
             }
 
             if (Unicode)
             {
                 do
                 {
-                    OutEvents.push_back(std::make_unique<KeyEvent>(*keyEvent));
+                    push(record);
                     repeat--;
-                } while (repeat > 0 && OutEvents.size() < AmountToRead);
+                } while (repeat > 0 && read < amountToRead);
             }
             else
             {
-                const auto wch = keyEvent->GetCharData();
+                const auto wch = keyEvent.uChar.UnicodeChar;
 
                 char buffer[8];
                 const auto length = WideCharToMultiByte(cp, 0, &wch, 1, &buffer[0], sizeof(buffer), nullptr, nullptr);
@@ -458,24 +548,33 @@ try
                 {
                     for (const auto& ch : str)
                     {
-                        auto tempEvent = std::make_unique<KeyEvent>(*keyEvent);
-                        tempEvent->SetCharData(ch);
-                        OutEvents.push_back(std::move(tempEvent));
+                        // Like KeyEvent::SetCharData(char), this avoids sign extending the char.
+                        keyEvent.uChar.UnicodeChar = til::as_unsigned(ch);
+                        push(record);
                     }
                     repeat--;
-                } while (repeat > 0 && OutEvents.size() < AmountToRead);
+                } while (repeat > 0 && read < amountToRead);
             }
 
             if (repeat && !Peek)
             {
-                const auto originalKeyEvent = static_cast<KeyEvent*>((*it).get());
-                originalKeyEvent->SetRepeatCount(repeat);
+                it->Event.KeyEvent.wRepeatCount = repeat;
                 break;
             }
         }
+        else if (record.EventType == FOCUS_EVENT)
+        {
+            record.Event.FocusEvent.bSetFocus = !!record.Event.FocusEvent.bSetFocus;
+            push(record);
+        }
+        else if (record.EventType == MOUSE_EVENT || record.EventType == WINDOW_BUFFER_SIZE_EVENT || record.EventType == MENU_EVENT)
+        {
+            push(record);
+        }
         else
         {
-            OutEvents.push_back(std::move(event));
+            // IInputEvent::Create() would've failed the read for these as well.
+            THROW_HR(E_INVALIDARG);
         }
 
         ++it;
@@ -483,12 +582,10 @@ try
 
     if (!Peek)
     {
-        _storage.erase(_storage.begin(), it);
+        _storage.pop_front(gsl::narrow_cast<size_t>(it - _storage.begin()));
     }
 
-    Cache(Unicode, OutEvents, AmountToRead);
-
-    if (OutEvents.empty())
+    if (read == 0)
     {
         return WaitForData ? CONSOLE_STATUS_WAIT : STATUS_SUCCESS;
     }
@@ -528,16 +625,17 @@ catch (...)
     NTSTATUS Status;
     try
     {
-        std::deque<std::unique_ptr<IInputEvent>> outEvents;
-        Status = Read(outEvents,
-                      1,
+        INPUT_RECORD record;
+        size_t read = 0;
+        Status = Read({ &record, 1 },
+                      read,
                       Peek,
                       WaitForData,
                       Unicode,
                       Stream);
-        if (!outEvents.empty())
+        if (read != 0)
         {
-            outEvent.swap(outEvents.front());
+            outEvent = IInputEvent::Create(record);
         }
     }
     catch (...)
@@ -558,38 +656,64 @@ catch (...)
 // Note:
 // - The console lock must be held when calling this routine.
 size_t InputBuffer::Prepend(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents)
+{
+    try
+    {
+        const auto records = toRecords(inEvents);
+        return Prepend(records);
+    }
+    catch (...)
+    {
+        LOG_HR(wil::ResultFromCaughtException());
+        return 0;
+    }
+}
+
+// Routine Description:
+// -  Writes records to the beginning of the input buffer.
+// Arguments:
+// - inRecords - records to write to buffer.
+// Return Value:
+// - The number of records written to the buffer.
+// Note:
+// - The console lock must be held when calling this routine.
+size_t InputBuffer::Prepend(const std::span<const INPUT_RECORD> inRecords)
 {
     try
     {
         _vtInputShouldSuppress = true;
         auto resetVtInputSuppress = wil::scope_exit([&]() { _vtInputShouldSuppress = false; });
-        _HandleConsoleSuspensionEvents(inEvents);
-        if (inEvents.empty())
+        std::vector<INPUT_RECORD> scratch;
+        const auto records = _HandleConsoleSuspensionEvents(inRecords, scratch);
+        if (records.empty())
         {
             return STATUS_SUCCESS;
         }
+
+        // The pending text is part of the existing records below.
+        _MaterializePendingText();
         // read all of the records out of the buffer, then write the
         // prepend ones, then write the original set. We need to do it
         // this way to handle any coalescing that might occur.
 
         // get all of the existing records, "emptying" the buffer
-        std::deque<std::unique_ptr<IInputEvent>> existingStorage;
+        InputRecordQueue existingStorage;
         existingStorage.swap(_storage);
 
         // We will need this variable to pass to _WriteBuffer so it can attempt to determine wait status.
-        // However, because we swapped the storage out from under it with an empty deque, it will always
-        // return true after the first one (as it is filling the newly emptied backing deque.)
+        // However, because we swapped the storage out from under it with an empty queue, it will always
+        // return true after the first one (as it is filling the newly emptied backing queue.)
         // Then after the second one, because we've inserted some input, it will always say false.
         auto unusedWaitStatus = false;
 
         // write the prepend records
         size_t prependEventsWritten;
-        _WriteBuffer(inEvents, prependEventsWritten, unusedWaitStatus);
+        _WriteBuffer(records, prependEventsWritten, unusedWaitStatus);
         FAIL_FAST_IF(!(unusedWaitStatus));
 
         // write all previously existing records
         size_t existingEventsWritten;
-        _WriteBuffer(existingStorage, existingEventsWritten, unusedWaitStatus);
+        _WriteBuffer(existingStorage.span(), existingEventsWritten, unusedWaitStatus);
         FAIL_FAST_IF(!(!unusedWaitStatus));
 
         // We need to set the wait event if there were 0 events in the
@@ -629,9 +753,15 @@ size_t InputBuffer::Write(_Inout_ std::unique_ptr<IInputEvent> inEvent)
 {
     try
     {
-        std::deque<std::unique_ptr<IInputEvent>> inEvents;
-        inEvents.push_back(std::move(inEvent));
-        return Write(inEvents);
+        // GH#13238: Focus events that originate from the console window itself (and not from the API)
+        // are reported to VT applications. An INPUT_RECORD can't tell the two apart, so we handle them here.
+        if (inEvent->EventType() == InputEventType::FocusEvent && IsInVirtualTerminalInputMode() && _termInput.HandleKey(inEvent.get()))
+        {
+            return 1;
+        }
+
+        const auto record = inEvent->ToInputRecord();
+        return Write(std::span<const INPUT_RECORD>{ &record, 1 });
     }
     catch (...)
     {
@@ -650,13 +780,37 @@ size_t InputBuffer::Write(_Inout_ std::unique_ptr<IInputEvent> inEvent)
 // Note:
 // - The console lock must be held when calling this routine.
 size_t InputBuffer::Write(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents)
+{
+    try
+    {
+        const auto records = toRecords(inEvents);
+        return Write(records);
+    }
+    catch (...)
+    {
+        LOG_HR(wil::ResultFromCaughtException());
+        return 0;
+    }
+}
+
+// Routine Description:
+// - Writes records to the input buffer. Wakes up any readers that are
+// waiting for additional input events.
+// Arguments:
+// - inRecords - input records to store in the buffer.
+// Return Value:
+// - The number of records that were written to input buffer.
+// Note:
+// - The console lock must be held when calling this routine.
+size_t InputBuffer::Write(const std::span<const INPUT_RECORD> inRecords)
 {
     try
     {
         _vtInputShouldSuppress = true;
         auto resetVtInputSuppress = wil::scope_exit([&]() { _vtInputShouldSuppress = false; });
-        _HandleConsoleSuspensionEvents(inEvents);
-        if (inEvents.empty())
+        std::vector<INPUT_RECORD> scratch;
+        const auto records = _HandleConsoleSuspensionEvents(inRecords, scratch);
+        if (records.empty())
         {
             return 0;
         }
@@ -664,7 +818,7 @@ size_t InputBuffer::Write(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEv
         // Write to buffer.
         size_t EventsWritten;
         bool SetWaitEvent;
-        _WriteBuffer(inEvents, EventsWritten, SetWaitEvent);
+        _WriteBuffer(records, EventsWritten, SetWaitEvent);
 
         if (SetWaitEvent)
         {
@@ -683,9 +837,139 @@ size_t InputBuffer::Write(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEv
 }
 
 // Routine Description:
-// - Coalesces input events and transfers them to storage queue.
+// - Writes text to the end of the input buffer, as if it had been typed (for instance a paste).
+// - In VT input mode the text is stored as the key events that TerminalInput produces for it.
+// - Otherwise the text isn't turned into key events right away. A raw ReadConsole
+//   copies it over as a whole with ConsumeString(), while reading or writing records first turns
+//   it into the same key events that CharToKeyEvents() produces for each character.
+// - The text must not contain control characters, since those need the regular key handling.
 // Arguments:
-// - inRecords - The events to store.
+// - text - The text to write.
+// Note:
+// - The console lock must be held when calling this routine.
+void InputBuffer::WriteString(const std::wstring_view text)
+{
+    if (text.empty())
+    {
+        return;
+    }
+
+    try
+    {
+        const auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+
+        const auto vtInputMode = IsInVirtualTerminalInputMode();
+
+        // A key press resumes a suspended console and win32-input-mode encodes every single
+        // key event. Both need the records that the text would have been typed with.
+        if (WI_IsFlagSet(gci.Flags, CONSOLE_SUSPENDED) || (vtInputMode && _termInput.GetInputMode(TerminalInput::Mode::Win32)))
+        {
+            const auto records = textToRecords(text, gci.OutputCP);
+            Write(records);
+            return;
+        }
+
+        if (vtInputMode)
+        {
+            // Otherwise TerminalInput turns the key presses for plain text into key downs of the bare
+            // characters (see TerminalInput::_SendInputSequence). We can do that for the whole run at once.
+            _MaterializePendingText();
+
+            const auto wasEmpty = _storage.empty();
+            INPUT_RECORD record{ KEY_EVENT };
+            record.Event.KeyEvent.bKeyDown = TRUE;
+            record.Event.KeyEvent.wRepeatCount = 1;
+            for (const auto& wch : text)
+            {
+                record.Event.KeyEvent.uChar.UnicodeChar = wch;
+                _storage.push_back(record);
+            }
+
+            if (wasEmpty)
+            {
+                ServiceLocator::LocateGlobals().hInputEvent.SetEvent();
+            }
+            WakeUpReadersWaitingForData();
+            return;
+        }
+
+        const auto wasEmpty = _storage.empty() && _pendingTextReader.empty();
+
+        if (_pendingTextReader.empty())
+        {
+            _pendingText.assign(text);
+        }
+        else
+        {
+            // Drop what has been consumed already, so that the text doesn't grow forever.
+            _pendingText.erase(0, gsl::narrow_cast<size_t>(_pendingTextReader.data() - _pendingText.data()));
+            _pendingText.append(text);
+        }
+        _pendingTextReader = _pendingText;
+
+        if (wasEmpty)
+        {
+            ServiceLocator::LocateGlobals().hInputEvent.SetEvent();
+        }
+        WakeUpReadersWaitingForData();
+    }
+    catch (...)
+    {
+        LOG_HR(wil::ResultFromCaughtException());
+    }
+}
+
+// Routine Description:
+// - Copies text written by WriteString() over to `target`, the same way Consume() does.
+// - This only happens if the text isn't preceded by any records, since those need to be read first.
+// Arguments:
+// - isUnicode - true if `target` should receive UTF-16, false if it should be converted to the input codepage.
+// - target - The buffer to copy to. On return its start is offset by the amount of data copied over.
+// Return Value:
+// - true if any text was consumed.
+// Note:
+// - The console lock must be held when calling this routine.
+bool InputBuffer::ConsumeString(bool isUnicode, std::span<char>& target)
+{
+    if (_pendingTextReader.empty() || !_storage.empty())
+    {
+        return false;
+    }
+
+    const auto size = _pendingTextReader.size();
+    Consume(isUnicode, _pendingTextReader, target);
+
+    if (_pendingTextReader.empty())
+    {
+        _pendingText.clear();
+        ServiceLocator::LocateGlobals().hInputEvent.ResetEvent();
+    }
+    return _pendingTextReader.size() != size;
+}
+
+// Routine Description:
+// - Turns the text written by WriteString() into key events at the end of the storage queue.
+// Note:
+// - The console lock must be held when calling this routine.
+// - will throw on failure
+void InputBuffer::_MaterializePendingText()
+{
+    if (_pendingTextReader.empty())
+    {
+        return;
+    }
+
+    // Key events for pasted text aren't coalesced (each key down is followed by its key up), so they can be appended as is.
+    const auto records = textToRecords(_pendingTextReader, ServiceLocator::LocateGlobals().getConsoleInformation().OutputCP);
+    _storage.append(records);
+    _pendingText.clear();
+    _pendingTextReader = {};
+}
+
+// Routine Description:
+// - Coalesces input records and transfers them to storage queue.
+// Arguments:
+// - inRecords - The records to store.
 // - eventsWritten - The number of events written since this function
 // was called.
 // - setWaitEvent - on exit, true if buffer became non-empty.
@@ -694,29 +978,38 @@ size_t InputBuffer::Write(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEv
 // Note:
 // - The console lock must be held when calling this routine.
 // - will throw on failure
-void InputBuffer::_WriteBuffer(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents,
+void InputBuffer::_WriteBuffer(const std::span<const INPUT_RECORD> inRecords,
                                _Out_ size_t& eventsWritten,
                                _Out_ bool& setWaitEvent)
 {
     eventsWritten = 0;
     setWaitEvent = false;
+    // New records must come after any pending text.
+    _MaterializePendingText();
     const auto initiallyEmptyQueue = _storage.empty();
-    const auto initialInEventsSize = inEvents.size();
     const auto vtInputMode = IsInVirtualTerminalInputMode();
 
-    while (!inEvents.empty())
+    for (const auto& inRecord : inRecords)
     {
-        // Pop the next event.
         // If we're in vt mode, try and handle it with the vt input module.
         // If it was handled, do nothing else for it.
         // If there was one event passed in, try coalescing it with the previous event currently in the buffer.
         // If it's not coalesced, append it to the buffer.
-        auto inEvent = std::move(inEvents.front());
-        inEvents.pop_front();
         if (vtInputMode)
         {
-            // GH#11682: TerminalInput::HandleKey can handle both KeyEvents and Focus events seamlessly
-            const auto handled = _termInput.HandleKey(inEvent.get());
+            // GH#11682: TerminalInput::HandleKey can handle both KeyEvents and Focus events seamlessly.
+            // It ignores all other event types. The events are constructed on the stack to avoid allocating.
+            auto handled = false;
+            if (inRecord.EventType == KEY_EVENT)
+            {
+                const KeyEvent keyEvent{ inRecord.Event.KeyEvent };
+                handled = _termInput.HandleKey(&keyEvent);
+            }
+            else if (inRecord.EventType == FOCUS_EVENT)
+            {
+                const FocusEvent focusEvent{ inRecord.Event.FocusEvent };
+                handled = _termInput.HandleKey(&focusEvent);
+            }
             if (handled)
             {
                 eventsWritten++;
@@ -728,42 +1021,18 @@ void InputBuffer::_WriteBuffer(_Inout_ std::deque<std::unique_ptr<IInputEvent>>&
         // record at a time because this is the original behavior of
         // the input buffer. Changing this behavior may break stuff
         // that was depending on it.
-        if (initialInEventsSize == 1 && !_storage.empty())
+        if (inRecords.size() == 1 && !_storage.empty())
         {
-            // coalescing requires a deque of events, so push it back onto the front.
-            inEvents.push_front(std::move(inEvent));
-
-            auto coalesced = false;
             // this looks kinda weird but we don't want to coalesce a
             // mouse event and then try to coalesce a key event right after.
-            //
-            // we also pass the whole deque to the coalescing methods
-            // even though they only want one event because it should
-            // be their responsibility to maintain the correct state
-            // of the deque if they process any records in it.
-            if (_CoalesceMouseMovedEvents(inEvents))
-            {
-                coalesced = true;
-            }
-            else if (_CoalesceRepeatedKeyPressEvents(inEvents))
-            {
-                coalesced = true;
-            }
-            if (coalesced)
+            if (_CoalesceMouseMovedEvents(inRecord) || _CoalesceRepeatedKeyPressEvents(inRecord))
             {
                 eventsWritten = 1;
                 return;
             }
-            else
-            {
-                // We didn't coalesce the event. pull it from the queue again,
-                //  to keep the state consistent with the start of this block.
-                inEvent = std::move(inEvents.front());
-                inEvents.pop_front();
-            }
         }
         // At this point, the event was neither coalesced, nor processed by VT.
-        _storage.push_back(std::move(inEvent));
+        _storage.push_back(inRecord);
         ++eventsWritten;
     }
     if (initiallyEmptyQueue && !_storage.empty())
@@ -773,67 +1042,54 @@ void InputBuffer::_WriteBuffer(_Inout_ std::deque<std::unique_ptr<IInputEvent>>&
 }
 
 // Routine Description:
-// - Checks if the last saved event and the first event of inRecords are
-// both MOUSE_MOVED events. If they are, the last saved event is
-// updated with the new mouse position and the first event of inRecords is
-// dropped.
+// - Checks if the last saved event and the given record are both
+// MOUSE_MOVED events. If they are, the last saved event is
+// updated with the new mouse position and the given one is dropped.
 // Arguments:
-// - inRecords - The incoming records to process.
+// - inRecord - The incoming record to process.
 // Return Value:
 // true if events were coalesced, false if they were not.
 // Note:
-// - The size of inRecords must be 1.
+// - The storage must not be empty.
 // - Coalescing here means updating a record that already exists in
 // the buffer with updated values from an incoming event, instead of
 // storing the incoming event (which would make the original one
 // redundant/out of date with the most current state).
-bool InputBuffer::_CoalesceMouseMovedEvents(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents)
+bool InputBuffer::_CoalesceMouseMovedEvents(const INPUT_RECORD& inRecord) noexcept
 {
-    FAIL_FAST_IF(!(inEvents.size() == 1));
     FAIL_FAST_IF(_storage.empty());
-    const IInputEvent* const pFirstInEvent = inEvents.front().get();
-    const IInputEvent* const pLastStoredEvent = _storage.back().get();
-    if (pFirstInEvent->EventType() == InputEventType::MouseEvent &&
-        pLastStoredEvent->EventType() == InputEventType::MouseEvent)
+    auto& lastRecord = _storage.back();
+    if (inRecord.EventType == MOUSE_EVENT &&
+        lastRecord.EventType == MOUSE_EVENT &&
+        inRecord.Event.MouseEvent.dwEventFlags == MOUSE_MOVED &&
+        lastRecord.Event.MouseEvent.dwEventFlags == MOUSE_MOVED)
     {
-        const auto pInMouseEvent = static_cast<const MouseEvent* const>(pFirstInEvent);
-        const auto pLastMouseEvent = static_cast<const MouseEvent* const>(pLastStoredEvent);
-
-        if (pInMouseEvent->IsMouseMoveEvent() &&
-            pLastMouseEvent->IsMouseMoveEvent())
-        {
-            // update mouse moved position
-            const auto pMouseEvent = static_cast<MouseEvent* const>(_storage.back().release());
-            pMouseEvent->SetPosition(pInMouseEvent->GetPosition());
-            std::unique_ptr<IInputEvent> tempPtr(pMouseEvent);
-            tempPtr.swap(_storage.back());
-
-            inEvents.pop_front();
-            return true;
-        }
+        // update mouse moved position
+        lastRecord.Event.MouseEvent.dwMousePosition = inRecord.Event.MouseEvent.dwMousePosition;
+        return true;
     }
     return false;
 }
 
 // Routine Description:
-// - checks two KeyEvents to see if they're similar enough to be coalesced
+// - checks two key events to see if they're similar enough to be coalesced
 // Arguments:
-// - a - the first KeyEvent
-// - b - the other KeyEvent
+// - a - the first key event
+// - b - the other key event
 // Return Value:
 // - true if the events could be coalesced, false otherwise
-bool InputBuffer::_CanCoalesce(const KeyEvent& a, const KeyEvent& b) const noexcept
+bool InputBuffer::_CanCoalesce(const KEY_EVENT_RECORD& a, const KEY_EVENT_RECORD& b) const noexcept
 {
-    if (WI_IsFlagSet(a.GetActiveModifierKeys(), NLS_IME_CONVERSION) &&
-        a.GetCharData() == b.GetCharData() &&
-        a.GetActiveModifierKeys() == b.GetActiveModifierKeys())
+    if (WI_IsFlagSet(a.dwControlKeyState, NLS_IME_CONVERSION) &&
+        a.uChar.UnicodeChar == b.uChar.UnicodeChar &&
+        a.dwControlKeyState == b.dwControlKeyState)
     {
         return true;
     }
     // other key events check
-    else if (a.GetVirtualScanCode() == b.GetVirtualScanCode() &&
-             a.GetCharData() == b.GetCharData() &&
-             a.GetActiveModifierKeys() == b.GetActiveModifierKeys())
+    else if (a.wVirtualScanCode == b.wVirtualScanCode &&
+             a.uChar.UnicodeChar == b.uChar.UnicodeChar &&
+             a.dwControlKeyState == b.dwControlKeyState)
     {
         return true;
     }
@@ -841,44 +1097,36 @@ bool InputBuffer::_CanCoalesce(const KeyEvent& a, const KeyEvent& b) const noexc
 }
 
 // Routine Description::
-// - If the last input event saved and the first input event in inRecords
-// are both a keypress down event for the same key, update the repeat
-// count of the saved event and drop the first from inRecords.
+// - If the last input event saved and the given record are both a
+// keypress down event for the same key, update the repeat
+// count of the saved event and drop the given one.
 // Arguments:
-// - inRecords - The incoming records to process.
+// - inRecord - The incoming record to process.
 // Return Value:
 // true if events were coalesced, false if they were not.
 // Note:
-// - The size of inRecords must be 1.
+// - The storage must not be empty.
 // - Coalescing here means updating a record that already exists in
 // the buffer with updated values from an incoming event, instead of
 // storing the incoming event (which would make the original one
 // redundant/out of date with the most current state).
-bool InputBuffer::_CoalesceRepeatedKeyPressEvents(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents)
+bool InputBuffer::_CoalesceRepeatedKeyPressEvents(const INPUT_RECORD& inRecord) noexcept
 {
-    FAIL_FAST_IF(!(inEvents.size() == 1));
     FAIL_FAST_IF(_storage.empty());
-    const IInputEvent* const pFirstInEvent = inEvents.front().get();
-    const IInputEvent* const pLastStoredEvent = _storage.back().get();
-    if (pFirstInEvent->EventType() == InputEventType::KeyEvent &&
-        pLastStoredEvent->EventType() == InputEventType::KeyEvent)
+    auto& lastRecord = _storage.back();
+    if (inRecord.EventType == KEY_EVENT &&
+        lastRecord.EventType == KEY_EVENT)
     {
-        const auto pInKeyEvent = static_cast<const KeyEvent* const>(pFirstInEvent);
-        const auto pLastKeyEvent = static_cast<const KeyEvent* const>(pLastStoredEvent);
+        const auto& inKey = inRecord.Event.KeyEvent;
+        auto& lastKey = lastRecord.Event.KeyEvent;
 
-        if (pInKeyEvent->IsKeyDown() &&
-            pLastKeyEvent->IsKeyDown() &&
-            !IsGlyphFullWidth(pInKeyEvent->GetCharData()) &&
-            _CanCoalesce(*pInKeyEvent, *pLastKeyEvent))
+        if (inKey.bKeyDown &&
+            lastKey.bKeyDown &&
+            !IsGlyphFullWidth(inKey.uChar.UnicodeChar) &&
+            _CanCoalesce(inKey, lastKey))
         {
             // increment repeat count
-            const auto pKeyEvent = static_cast<KeyEvent* const>(_storage.back().release());
-            WORD repeatCount = pKeyEvent->GetRepeatCount() + pInKeyEvent->GetRepeatCount();
-            pKeyEvent->SetRepeatCount(repeatCount);
-            std::unique_ptr<IInputEvent> tempPtr(pKeyEvent);
-            tempPtr.swap(_storage.back());
-
-            inEvents.pop_front();
+            lastKey.wRepeatCount += inKey.wRepeatCount;
             return true;
         }
     }
@@ -888,42 +1136,61 @@ bool InputBuffer::_CoalesceRepeatedKeyPressEvents(_Inout_ std::deque<std::unique
 // Routine Description:
 // - Handles records that suspend/resume the console.
 // Arguments:
-// - records - records to check for pause/unpause events
+// - inRecords - records to check for pause/unpause events
+// - scratch - storage for the remaining records, if any had to be removed
 // Return Value:
-// - None
+// - The records that remain, either inRecords itself or a view of scratch.
 // Note:
 // - The console lock must be held when calling this routine.
 // - will throw exception on error
-void InputBuffer::_HandleConsoleSuspensionEvents(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents)
+std::span<const INPUT_RECORD> InputBuffer::_HandleConsoleSuspensionEvents(const std::span<const INPUT_RECORD> inRecords, std::vector<INPUT_RECORD>& scratch)
 {
     auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
 
-    std::deque<std::unique_ptr<IInputEvent>> outEvents;
-    while (!inEvents.empty())
-    {
-        auto currEvent = std::move(inEvents.front());
-        inEvents.pop_front();
-        if (currEvent->EventType() == InputEventType::KeyEvent)
+    // Returns true if the record was consumed for suspending/resuming the console.
+    const auto handle = [&](const INPUT_RECORD& record) {
+        if (record.EventType == KEY_EVENT && record.Event.KeyEvent.bKeyDown)
         {
-            const auto pKeyEvent = static_cast<const KeyEvent* const>(currEvent.get());
-            if (pKeyEvent->IsKeyDown())
+            const auto vkey = record.Event.KeyEvent.wVirtualKeyCode;
+            if (WI_IsFlagSet(gci.Flags, CONSOLE_SUSPENDED) &&
+                !IsSystemKey(vkey))
             {
-                if (WI_IsFlagSet(gci.Flags, CONSOLE_SUSPENDED) &&
-                    !IsSystemKey(pKeyEvent->GetVirtualKeyCode()))
-                {
-                    UnblockWriteConsole(CONSOLE_OUTPUT_SUSPENDED);
-                    continue;
-                }
-                else if (WI_IsFlagSet(InputMode, ENABLE_LINE_INPUT) && pKeyEvent->IsPauseKey())
-                {
-                    WI_SetFlag(gci.Flags, CONSOLE_SUSPENDED);
-                    continue;
-                }
+                UnblockWriteConsole(CONSOLE_OUTPUT_SUSPENDED);
+                return true;
             }
+            else if (WI_IsFlagSet(InputMode, ENABLE_LINE_INPUT) && vkey == VK_PAUSE)
+            {
+                WI_SetFlag(gci.Flags, CONSOLE_SUSPENDED);
+                return true;
+            }
+        }
+        return false;
+    };
+
+    // Usually nothing needs to be removed and we can avoid copying the records.
+    auto it = inRecords.begin();
+    const auto end = inRecords.end();
+    for (; it != end; ++it)
+    {
+        if (handle(*it))
+        {
+            break;
         }
-        outEvents.push_back(std::move(currEvent));
     }
-    inEvents.swap(outEvents);
+    if (it == end)
+    {
+        return inRecords;
+    }
+
+    scratch.assign(inRecords.begin(), it);
+    for (++it; it != end; ++it)
+    {
+        if (!handle(*it))
+        {
+            scratch.push_back(*it);
+        }
+    }
+    return scratch;
 }
 
 // Routine Description:
@@ -948,13 +1215,14 @@ void InputBuffer::_HandleTerminalInputCallback(std::deque<std::unique_ptr<IInput
 {
     try
     {
+        _MaterializePendingText();
+
         // add all input events to the storage queue
-        while (!inEvents.empty())
+        for (const auto& inEvent : inEvents)
         {
-            auto inEvent = std::move(inEvents.front());
-            inEvents.pop_front();
-            _storage.push_back(std::move(inEvent));
+            _storage.push_back(inEvent->ToInputRecord());
         }
+        inEvents.clear();
 
         if (!_vtInputShouldSuppress)
         {
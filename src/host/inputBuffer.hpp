@@ -33,6 +33,128 @@ namespace Microsoft::Console::Render
     class VtEngine;
 }
 
+// A FIFO of INPUT_RECORDs in a single contiguous vector. Records are pushed to the back
+// and popped from the front by advancing an offset, so that neither allocates once the
+// vector has grown large enough. (MSVC's std::deque would allocate once per record.)
+class InputRecordQueue
+{
+public:
+    size_t size() const noexcept
+    {
+        return _records.size() - _begin;
+    }
+
+    bool empty() const noexcept
+    {
+        return _records.size() == _begin;
+    }
+
+    INPUT_RECORD* begin() noexcept
+    {
+        return _records.data() + _begin;
+    }
+
+    INPUT_RECORD* end() noexcept
+    {
+        return _records.data() + _records.size();
+    }
+
+    const INPUT_RECORD* begin() const noexcept
+    {
+        return _records.data() + _begin;
+    }
+
+    const INPUT_RECORD* end() const noexcept
+    {
+        return _records.data() + _records.size();
+    }
+
+    INPUT_RECORD& operator[](const size_t i) noexcept
+    {
+        return til::at(_records, _begin + i);
+    }
+
+    const INPUT_RECORD& operator[](const size_t i) const noexcept
+    {
+        return til::at(_records, _begin + i);
+    }
+
+    INPUT_RECORD& front() noexcept
+    {
+        return til::at(_records, _begin);
+    }
+
+    INPUT_RECORD& back() noexcept
+    {
+        return _records.back();
+    }
+
+    const INPUT_RECORD& front() const noexcept
+    {
+        return til::at(_records, _begin);
+    }
+
+    const INPUT_RECORD& back() const noexcept
+    {
+        return _records.back();
+    }
+
+    std::span<const INPUT_RECORD> span() const noexcept
+    {
+        return { begin(), end() };
+    }
+
+    void push_back(const INPUT_RECORD& record)
+    {
+        _records.push_back(record);
+    }
+
+    void append(const std::span<const INPUT_RECORD> records)
+    {
+        _records.insert(_records.end(), records.begin(), records.end());
+    }
+
+    void pop_front(const size_t count) noexcept
+    {
+        _begin += count;
+        assert(_begin <= _records.size());
+
+        if (_begin == _records.size())
+        {
+            clear();
+        }
+        else if (_begin >= 1024 && _begin >= size())
+        {
+            // Reclaim the popped space once it makes up half the vector, so that a reader
+            // that never quite catches up doesn't make it grow forever. This is amortized O(1).
+            _records.erase(_records.begin(), _records.begin() + _begin);
+            _begin = 0;
+        }
+    }
+
+    template<typename Predicate>
+    void erase_if(Predicate&& predicate)
+    {
+        _records.erase(std::remove_if(_records.begin() + _begin, _records.end(), std::forward<Predicate>(predicate)), _records.end());
+    }
+
+    void clear() noexcept
+    {
+        _records.clear();
+        _begin = 0;
+    }
+
+    void swap(InputRecordQueue& other) noexcept
+    {
+        _records.swap(other._records);
+        std::swap(_begin, other._begin);
+    }
+
+private:
+    std::vector<INPUT_RECORD> _records;
+    size_t _begin = 0;
+};
+
 class InputBuffer final : public ConsoleObjectHeader
 {
 public:
@@ -46,10 +168,6 @@ public:
     void Consume(bool isUnicode, std::wstring_view& source, std::span<char>& target);
     void ConsumeCached(bool isUnicode, std::span<char>& target);
     void Cache(std::wstring_view source);
-    // INPUT_RECORD oriented APIs
-    size_t ConsumeCached(bool isUnicode, size_t count, InputEventQueue& target);
-    size_t PeekCached(bool isUnicode, size_t count, InputEventQueue& target);
-    void Cache(bool isUnicode, InputEventQueue& source, size_t expectedSourceSize);
 
     // storage API for partial dbcs bytes being written to the buffer
     bool IsWritePartialByteSequenceAvailable();
@@ -58,6 +176,8 @@ public:
 
     void ReinitializeInputBuffer();
     void WakeUpReadersWaitingForData();
+    void BeginWriteBatch() noexcept;
+    void EndWriteBatch();
     void TerminateRead(_In_ WaitTerminationReason Flag);
     size_t GetNumberOfReadyEvents() const noexcept;
     void Flush();
@@ -70,6 +190,13 @@ public:
                                 const bool Unicode,
                                 const bool Stream);
 
+    [[nodiscard]] NTSTATUS Read(const std::span<INPUT_RECORD> target,
+                                size_t& read,
+                                const bool Peek,
+                                const bool WaitForData,
+                                const bool Unicode,
+                                const bool Stream);
+
     [[nodiscard]] NTSTATUS Read(_Out_ std::unique_ptr<IInputEvent>& inEvent,
                                 const bool Peek,
                                 const bool WaitForData,
@@ -77,9 +204,13 @@ public:
                                 const bool Stream);
 
     size_t Prepend(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents);
+    size_t Prepend(const std::span<const INPUT_RECORD> inRecords);
 
     size_t Write(_Inout_ std::unique_ptr<IInputEvent> inEvent);
     size_t Write(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents);
+    size_t Write(const std::span<const INPUT_RECORD> inRecords);
+    void WriteString(const std::wstring_view text);
+    bool ConsumeString(bool isUnicode, std::span<char>& target);
 
     bool IsInVirtualTerminalInputMode() const;
     Microsoft::Console::VirtualTerminal::TerminalInput& GetTerminalInput();
@@ -102,7 +233,11 @@ private:
     std::deque<std::unique_ptr<IInputEvent>> _cachedInputEvents;
     ReadingMode _readingMode = ReadingMode::StringA;
 
-    std::deque<std::unique_ptr<IInputEvent>> _storage;
+    InputRecordQueue _storage;
+    // Text written by WriteString() that follows all of the records in _storage.
+    // It's turned into key events once records are read or written. See _MaterializePendingText().
+    std::wstring _pendingText;
+    std::wstring_view _pendingTextReader;
     std::unique_ptr<IInputEvent> _writePartialByteSequence;
     Microsoft::Console::VirtualTerminal::TerminalInput _termInput;
     Microsoft::Console::Render::VtEngine* _pTtyConnection;
@@ -113,17 +248,22 @@ private:
     // Otherwise, we should be calling them.
     bool _vtInputShouldSuppress{ false };
 
+    // See BeginWriteBatch(). While a batch is open, waking up readers is deferred until its end.
+    uint32_t _writeBatchDepth{ 0 };
+    bool _wakeUpPending{ false };
+
     void _switchReadingMode(ReadingMode mode);
     void _switchReadingModeSlowPath(ReadingMode mode);
 
-    void _WriteBuffer(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inRecords,
+    void _MaterializePendingText();
+    void _WriteBuffer(const std::span<const INPUT_RECORD> inRecords,
                       _Out_ size_t& eventsWritten,
                       _Out_ bool& setWaitEvent);
 
-    bool _CanCoalesce(const KeyEvent& a, const KeyEvent& b) const noexcept;
-    bool _CoalesceMouseMovedEvents(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents);
-    bool _CoalesceRepeatedKeyPressEvents(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents);
-    void _HandleConsoleSuspensionEvents(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents);
+    bool _CanCoalesce(const KEY_EVENT_RECORD& a, const KEY_EVENT_RECORD& b) const noexcept;
+    bool _CoalesceMouseMovedEvents(const INPUT_RECORD& inRecord) noexcept;
+    bool _CoalesceRepeatedKeyPressEvents(const INPUT_RECORD& inRecord) noexcept;
+    std::span<const INPUT_RECORD> _HandleConsoleSuspensionEvents(const std::span<const INPUT_RECORD> inRecords, std::vector<INPUT_RECORD>& scratch);
 
     void _HandleTerminalInputCallback(_In_ std::deque<std::unique_ptr<IInputEvent>>& inEvents);
 
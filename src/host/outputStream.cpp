@@ -27,12 +27,19 @@ ConhostInternalGetSet::ConhostInternalGetSet(_In_ IIoProvider& io) :
 // - Sends a string response to the input stream of the console.
 // - Used by various commands where the program attached would like a reply to one of the commands issued.
 // - This will generate two "key presses" (one down, one up) for every character in the string and place them into the head of the console's input stream.
+// - While VtApiRoutines synchronizes the buffer with output that was passed through, nothing is sent.
 // Arguments:
 // - response - The response string to transmit back to the input stream
 // Return Value:
 // - <none>
 void ConhostInternalGetSet::ReturnResponse(const std::wstring_view response)
 {
+    // In passthrough mode the terminal has already answered the client.
+    if (ServiceLocator::LocateGlobals().getConsoleInformation().GetVtIo()->IsSynchronizingBuffer())
+    {
+        return;
+    }
+
     std::deque<std::unique_ptr<IInputEvent>> inEvents;
 
     // generate a paired key down and key up event for every
@@ -302,7 +309,7 @@ void ConhostInternalGetSet::SetWorkingDirectory(const std::wstring_view /*uri*/)
 }
 
 // Routine Description:
-// - Plays a single MIDI note, blocking for the duration.
+// - Queues a single MIDI note to be played. This only blocks if too many notes are queued already.
 // Arguments:
 // - noteNumber - The MIDI note number to be played (0 - 127).
 // - velocity - The force with which the note should be played (0 - 127).
@@ -311,10 +318,10 @@ void ConhostInternalGetSet::SetWorkingDirectory(const std::wstring_view /*uri*/)
 // - true if successful. false otherwise.
 void ConhostInternalGetSet::PlayMidiNote(const int noteNumber, const int velocity, const std::chrono::microseconds duration)
 {
-    // Unlock the console, so the UI doesn't hang while we're busy.
+    // Unlock the console, so the UI doesn't hang if we have to wait for the queue.
     UnlockConsole();
 
-    // This call will block for the duration, unless shutdown early.
+    // This call only blocks if the queue is full, until space frees up or it's shutdown early.
     const auto windowHandle = ServiceLocator::LocateConsoleWindow()->GetWindowHandle();
     auto& midiAudio = ServiceLocator::LocateGlobals().getConsoleInformation().GetMidiAudio();
     midiAudio.PlayNote(windowHandle, noteNumber, velocity, std::chrono::duration_cast<std::chrono::milliseconds>(duration));
@@ -493,6 +493,12 @@ bool COOKED_READ_DATA::ProcessInput(const wchar_t wchOrig,
         return false;
     }
 
+    // This is how cmd.exe implements tab completion: it asks us to end the read on Tab,
+    // enumerates the matching files itself and then starts a new read with the completed
+    // line as its initial data. We never learn about the list of candidates, only about the
+    // one the client picked, so all completion state (and the cost of building it) lives
+    // in the client. Typeahead entered in the meantime stays queued in the input buffer and
+    // is echoed as soon as the next read begins.
     if (_ctrlWakeupMask != 0 && wch < L' ' && (_ctrlWakeupMask & (1 << wch)))
     {
         *_bufPtr = wch;
@@ -578,6 +584,8 @@ bool COOKED_READ_DATA::ProcessInput(const wchar_t wchOrig,
     else
     {
         auto CallWrite = true;
+        // The first character that changed. The line only needs to be redrawn from there on.
+        const wchar_t* redrawBegin = nullptr;
         const auto sScreenBufferSizeX = _screenInfo.GetBufferSize().Width();
 
         // processing in the middle of the line is more complex:
@@ -643,6 +651,7 @@ bool COOKED_READ_DATA::ProcessInput(const wchar_t wchOrig,
                         loop = true;
                     }
                 }
+                redrawBegin = _bufPtr;
             }
             else
             {
@@ -684,6 +693,7 @@ bool COOKED_READ_DATA::ProcessInput(const wchar_t wchOrig,
                             _bytesRead - (_currentPosition * sizeof(WCHAR)));
                     _bytesRead += sizeof(WCHAR);
                 }
+                redrawBegin = _bufPtr;
                 *_bufPtr = wch;
                 _bufPtr += 1;
                 _currentPosition += 1;
@@ -708,29 +718,37 @@ bool COOKED_READ_DATA::ProcessInput(const wchar_t wchOrig,
             CursorPosition = _screenInfo.GetTextBuffer().GetCursor().GetPosition();
             CursorPosition.x = (til::CoordType)(CursorPosition.x + NumSpaces);
 
-            // clear the current command line from the screen
-            // clang-format off
+            // The start of the line is still intact, unless it scrolled off the top of the screen.
+            if (redrawBegin && _originalCursorPosition.y >= 0)
+            {
+                status = _redrawFrom(redrawBegin, ScrollY);
+            }
+            else
+            {
+                // clear the current command line from the screen
+                // clang-format off
 #pragma prefast(suppress: __WARNING_BUFFER_OVERFLOW, "Not sure why prefast doesn't like this call.")
-            // clang-format on
-            DeleteCommandLine(*this, FALSE);
+                // clang-format on
+                DeleteCommandLine(*this, FALSE);
 
-            // write the new command line to the screen
-            NumToWrite = _bytesRead;
+                // write the new command line to the screen
+                NumToWrite = _bytesRead;
 
-            DWORD dwFlags = WC_DESTRUCTIVE_BACKSPACE | WC_PRINTABLE_CONTROL_CHARS;
-            if (wch == UNICODE_CARRIAGERETURN)
-            {
-                dwFlags |= WC_KEEP_CURSOR_VISIBLE;
+                DWORD dwFlags = WC_DESTRUCTIVE_BACKSPACE | WC_PRINTABLE_CONTROL_CHARS;
+                if (wch == UNICODE_CARRIAGERETURN)
+                {
+                    dwFlags |= WC_KEEP_CURSOR_VISIBLE;
+                }
+                status = WriteCharsLegacy(_screenInfo,
+                                          _backupLimit,
+                                          _backupLimit,
+                                          _backupLimit,
+                                          &NumToWrite,
+                                          &_visibleCharCount,
+                                          _originalCursorPosition.x,
+                                          dwFlags,
+                                          &ScrollY);
             }
-            status = WriteCharsLegacy(_screenInfo,
-                                      _backupLimit,
-                                      _backupLimit,
-                                      _backupLimit,
-                                      &NumToWrite,
-                                      &_visibleCharCount,
-                                      _originalCursorPosition.x,
-                                      dwFlags,
-                                      &ScrollY);
             if (FAILED_NTSTATUS(status))
             {
                 RIPMSG1(RIP_WARNING, "WriteCharsLegacy failed 0x%x", status);
@@ -992,6 +1010,55 @@ void COOKED_READ_DATA::SavePendingInput(const size_t index, const bool multiline
     return Status;
 }
 
+// Routine Description:
+// - Redraws the edit line starting at the given character, after the line was edited there.
+// - The cursor must be at the cell of that character and everything in front of it must still
+//   be up to date on the screen. This way editing the middle of a long line only costs as much
+//   as the part after the edit, instead of erasing and rewriting the whole line.
+// Arguments:
+// - begin - The first character in the buffer that changed.
+// - scrollY - On output, the number of rows the screen buffer was scrolled by.
+// Return Value:
+// - Status code from WriteCharsLegacy.
+[[nodiscard]] NTSTATUS COOKED_READ_DATA::_redrawFrom(const wchar_t* const begin, til::CoordType& scrollY) noexcept
+{
+    const auto width = _screenInfo.GetBufferSize().Width();
+    const auto cursor = _screenInfo.GetTextBuffer().GetCursor().GetPosition();
+    // The cells that the unchanged part of the line occupies, including any padding in front of wrapped wide glyphs.
+    const auto cellsBefore = gsl::narrow_cast<size_t>(std::max(0, (cursor.y - _originalCursorPosition.y) * width + cursor.x - _originalCursorPosition.x));
+    const auto previousCount = _visibleCharCount;
+
+    auto numBytes = _bytesRead - gsl::narrow_cast<size_t>(begin - _backupLimit) * sizeof(wchar_t);
+    size_t cellsAfter = 0;
+    const auto status = WriteCharsLegacy(_screenInfo,
+                                         _backupLimit,
+                                         begin,
+                                         begin,
+                                         &numBytes,
+                                         &cellsAfter,
+                                         _originalCursorPosition.x,
+                                         WC_DESTRUCTIVE_BACKSPACE | WC_PRINTABLE_CONTROL_CHARS,
+                                         &scrollY);
+    if (FAILED_NTSTATUS(status))
+    {
+        return status;
+    }
+
+    _visibleCharCount = cellsBefore + cellsAfter;
+
+    // If the line got shorter, the cells past its new end still show the old one.
+    if (_visibleCharCount < previousCount)
+    {
+        try
+        {
+            _screenInfo.Write(OutputCellIterator(UNICODE_SPACE, previousCount - _visibleCharCount), _screenInfo.GetTextBuffer().GetCursor().GetPosition());
+        }
+        CATCH_LOG();
+    }
+
+    return status;
+}
+
 // Routine Description:
 // - handles any tasks that need to be completed after the read input loop finishes
 // Arguments:
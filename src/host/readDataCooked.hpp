@@ -161,4 +161,6 @@ private:
     [[nodiscard]] NTSTATUS _readCharInputLoop(const bool isUnicode, size_t& numBytes) noexcept;
 
     [[nodiscard]] NTSTATUS _handlePostCharInputLoop(const bool isUnicode, size_t& numBytes, ULONG& controlKeyState) noexcept;
+
+    [[nodiscard]] NTSTATUS _redrawFrom(const wchar_t* const begin, til::CoordType& scrollY) noexcept;
 };
@@ -16,6 +16,57 @@
 
 using Microsoft::Console::Interactivity::ServiceLocator;
 
+// A copy of all the values of a registry key, read in a single pass.
+// We look up far more values than a console key usually holds (most title subkeys only hold a
+// handful), so enumerating what's actually there takes a fraction of the registry round trips
+// that querying every value we know of would.
+class Registry::KeySnapshot
+{
+public:
+    [[nodiscard]] NTSTATUS Read(const HKEY hKey);
+    [[nodiscard]] NTSTATUS QueryValue(_In_ PCWSTR const pwszValueName,
+                                      const DWORD cbValueLength,
+                                      const DWORD regType,
+                                      _Out_writes_bytes_(cbValueLength) BYTE* const pbData,
+                                      _Out_opt_ _Out_range_(0, cbValueLength) DWORD* const pcbDataLength) const noexcept;
+
+private:
+    struct Value
+    {
+        DWORD type;
+        std::vector<BYTE> data;
+    };
+
+    // Value names are case-insensitive, just like in the registry.
+    struct IgnoreCase
+    {
+        using is_transparent = void;
+
+        bool operator()(const std::wstring_view lhs, const std::wstring_view rhs) const noexcept
+        {
+            return CompareStringOrdinal(lhs.data(), gsl::narrow_cast<int>(lhs.size()), rhs.data(), gsl::narrow_cast<int>(rhs.size()), TRUE) == CSTR_LESS_THAN;
+        }
+    };
+
+    std::map<std::wstring, Value, IgnoreCase> _values;
+};
+
+// The snapshots of HKCU\Console and its title subkeys, which are kept for as long as
+// nothing below HKCU\Console changes. This way the settings are read from the registry
+// once per console, no matter how often they (or just the edit keys) are loaded.
+struct Registry::SnapshotCache
+{
+    std::mutex mutex;
+    wil::unique_hkey currentUserKey;
+    wil::unique_hkey consoleKey;
+    // Signaled by RegNotifyChangeKeyValue when anything below consoleKey changes.
+    wil::unique_event_nothrow changed;
+    bool watching = false;
+    std::shared_ptr<const KeySnapshot> console;
+    // The title subkeys that were asked for, including the ones that don't exist (nullptr).
+    std::unordered_map<std::wstring, std::shared_ptr<const KeySnapshot>> titles;
+};
+
 Registry::Registry(_In_ Settings* const pSettings) :
     _pSettings(pSettings)
 {
@@ -24,33 +75,268 @@ Registry::Registry(_In_ Settings* const pSettings) :
 Registry::~Registry() = default;
 
 // Routine Description:
-// - Reads extended edit keys and related registry information into the global state.
+// - Reads all values of the given key into the snapshot.
 // Arguments:
-// - hConsoleKey - The console subkey to use for querying.
+// - hKey - The key to read.
 // Return Value:
-// - <none>
-void Registry::GetEditKeys(_In_opt_ HKEY hConsoleKey) const
+// - STATUS_SUCCESSFUL or appropriate NTSTATUS reply for registry operations.
+[[nodiscard]] NTSTATUS Registry::KeySnapshot::Read(const HKEY hKey)
 {
-    auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
-    NTSTATUS Status;
-    HKEY hCurrentUserKey = nullptr;
-    if (hConsoleKey == nullptr)
+    DWORD cValues = 0;
+    DWORD cchMaxValueName = 0;
+    DWORD cbMaxValueData = 0;
+    const auto Status = NTSTATUS_FROM_WIN32(RegQueryInfoKeyW(hKey, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, &cValues, &cchMaxValueName, &cbMaxValueData, nullptr, nullptr));
+    if (FAILED_NTSTATUS(Status))
+    {
+        return Status;
+    }
+
+    // cchMaxValueName doesn't include the terminating null.
+    std::wstring name(cchMaxValueName + 1, UNICODE_NULL);
+    std::vector<BYTE> data(cbMaxValueData);
+
+    for (DWORD i = 0; i < cValues; i++)
+    {
+        auto cchName = gsl::narrow_cast<DWORD>(name.size());
+        auto cbData = gsl::narrow_cast<DWORD>(data.size());
+        DWORD type = 0;
+        const auto Result = RegEnumValueW(hKey, i, name.data(), &cchName, nullptr, &type, data.data(), &cbData);
+
+        // The key has been changed since we asked for its size. That'll invalidate this
+        // snapshot as soon as it's used, so there's no need to get these values right.
+        if (ERROR_NO_MORE_ITEMS == Result)
+        {
+            break;
+        }
+        if (ERROR_MORE_DATA == Result)
+        {
+            continue;
+        }
+        if (ERROR_SUCCESS != Result)
+        {
+            return NTSTATUS_FROM_WIN32(Result);
+        }
+
+        _values.insert_or_assign(std::wstring{ name.data(), cchName }, Value{ type, std::vector<BYTE>(data.begin(), data.begin() + cbData) });
+    }
+
+    return STATUS_SUCCESS;
+}
+
+// Routine Description:
+// - Reads a value from the snapshot, just like RegistrySerialization::s_QueryValue would from the key.
+// Arguments:
+// - pwszValueName - Name of the value to read.
+// - cbValueLength - Size of the pbData buffer.
+// - regType - The type that the value is expected to have.
+// - pbData - Receives the data of the value.
+// - pcbDataLength - Receives the size of the value.
+// Return Value:
+// - STATUS_SUCCESSFUL or the same NTSTATUS the registry would have returned.
+[[nodiscard]] NTSTATUS Registry::KeySnapshot::QueryValue(_In_ PCWSTR const pwszValueName,
+                                                         const DWORD cbValueLength,
+                                                         const DWORD regType,
+                                                         _Out_writes_bytes_(cbValueLength) BYTE* const pbData,
+                                                         _Out_opt_ _Out_range_(0, cbValueLength) DWORD* const pcbDataLength) const noexcept
+{
+    const auto it = _values.find(std::wstring_view{ pwszValueName });
+    if (it == _values.end())
+    {
+        return NTSTATUS_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+    }
+
+    const auto& value = it->second;
+    if (value.type != regType)
+    {
+        return STATUS_OBJECT_TYPE_MISMATCH;
+    }
+
+    const auto cbData = gsl::narrow_cast<DWORD>(value.data.size());
+    if (nullptr != pcbDataLength)
+    {
+        *pcbDataLength = cbData;
+    }
+
+    if (cbData > cbValueLength)
+    {
+        return NTSTATUS_FROM_WIN32(ERROR_MORE_DATA);
+    }
+
+    memcpy(pbData, value.data.data(), cbData);
+    return STATUS_SUCCESS;
+}
+
+// Routine Description:
+// - Gets the snapshots of HKCU\Console and of the subkey for the given console title.
+//   They're read from the registry the first time they're asked for, and then again only once
+//   anything below HKCU\Console has changed (for instance because the property sheet was used).
+// Arguments:
+// - pwszConsoleTitle - Name of the console subkey. Empty string for the default console settings,
+//                      or nullptr if only the console key is needed.
+// - consoleKey - Receives the snapshot of HKCU\Console.
+// - titleKey - Receives the snapshot of the title subkey, or nullptr if it doesn't exist.
+// Return Value:
+// - STATUS_SUCCESSFUL or appropriate NTSTATUS reply for registry operations.
+[[nodiscard]] NTSTATUS Registry::_GetSnapshots(_In_opt_ PCWSTR const pwszConsoleTitle,
+                                               std::shared_ptr<const KeySnapshot>& consoleKey,
+                                               std::shared_ptr<const KeySnapshot>& titleKey) noexcept
+{
+    try
+    {
+        static SnapshotCache cache;
+        const std::lock_guard lock{ cache.mutex };
+
+        if (!cache.watching || cache.changed.is_signaled())
+        {
+            cache.console.reset();
+            cache.titles.clear();
+            cache.watching = false;
+
+            // The console key might have been deleted and recreated, so we reopen it as well.
+            cache.consoleKey.reset();
+            cache.currentUserKey.reset();
+
+            HKEY hCurrentUserKey;
+            HKEY hConsoleKey;
+            const auto Status = RegistrySerialization::s_OpenConsoleKey(&hCurrentUserKey, &hConsoleKey);
+            if (FAILED_NTSTATUS(Status))
+            {
+                return Status;
+            }
+            cache.currentUserKey.reset(hCurrentUserKey);
+            cache.consoleKey.reset(hConsoleKey);
+
+            // The notification has to be (re)armed before the keys are read, or we'd
+            // miss the changes that happen while we read them. If it can't be armed,
+            // we'll simply read the keys every time, just like we used to.
+            if (!cache.changed)
+            {
+                LOG_IF_FAILED(cache.changed.create(wil::EventOptions::ManualReset));
+            }
+            if (cache.changed)
+            {
+                cache.changed.ResetEvent();
+                cache.watching = ERROR_SUCCESS == RegNotifyChangeKeyValue(cache.consoleKey.get(),
+                                                                          TRUE,
+                                                                          REG_NOTIFY_CHANGE_NAME | REG_NOTIFY_CHANGE_LAST_SET | REG_NOTIFY_THREAD_AGNOSTIC,
+                                                                          cache.changed.get(),
+                                                                          TRUE);
+            }
+        }
+
+        if (!cache.console)
+        {
+            auto snapshot = std::make_shared<KeySnapshot>();
+            const auto Status = snapshot->Read(cache.consoleKey.get());
+            if (FAILED_NTSTATUS(Status))
+            {
+                return Status;
+            }
+            cache.console = std::move(snapshot);
+        }
+
+        consoleKey = cache.console;
+        titleKey = nullptr;
+
+        if (pwszConsoleTitle != nullptr)
+        {
+            // The default settings are stored right in the console key.
+            if (*pwszConsoleTitle == UNICODE_NULL)
+            {
+                titleKey = cache.console;
+            }
+            else
+            {
+                std::wstring title{ pwszConsoleTitle };
+                auto it = cache.titles.find(title);
+                if (it == cache.titles.end())
+                {
+                    auto snapshot = _ReadTitleKey(cache.consoleKey.get(), pwszConsoleTitle);
+                    it = cache.titles.emplace(std::move(title), std::move(snapshot)).first;
+                }
+                titleKey = it->second;
+            }
+        }
+
+        return STATUS_SUCCESS;
+    }
+    catch (...)
+    {
+        return NTSTATUS_FROM_HRESULT(wil::ResultFromCaughtException());
+    }
+}
+
+// Routine Description:
+// - Reads the subkey of the console key for the given console title.
+// Arguments:
+// - hConsoleKey - The console key.
+// - pwszConsoleTitle - Name of the console subkey to read.
+// Return Value:
+// - The snapshot of the subkey, or nullptr if it doesn't exist or can't be read.
+std::shared_ptr<const Registry::KeySnapshot> Registry::_ReadTitleKey(const HKEY hConsoleKey, _In_ PCWSTR const pwszConsoleTitle)
+{
+    wil::unique_hkey titleKey;
+
+    // Open the console title subkey.
+    for (const auto fSubstitute : { TRUE, FALSE })
     {
-        Status = RegistrySerialization::s_OpenConsoleKey(&hCurrentUserKey, &hConsoleKey);
-        if (FAILED_NTSTATUS(Status))
+        const std::unique_ptr<WCHAR[]> TranslatedConsoleTitle{ TranslateConsoleTitle(pwszConsoleTitle, TRUE, fSubstitute) };
+        THROW_IF_NULL_ALLOC(TranslatedConsoleTitle);
+
+        HKEY hTitleKey;
+        if (SUCCEEDED_NTSTATUS(RegistrySerialization::s_OpenKey(hConsoleKey, TranslatedConsoleTitle.get(), &hTitleKey)))
         {
-            return;
+            titleKey.reset(hTitleKey);
+            break;
         }
     }
 
+    if (!titleKey)
+    {
+        return nullptr;
+    }
+
+    auto snapshot = std::make_shared<KeySnapshot>();
+    if (FAILED_NTSTATUS(snapshot->Read(titleKey.get())))
+    {
+        return nullptr;
+    }
+    return snapshot;
+}
+
+// Routine Description:
+// - Reads extended edit keys and related registry information into the global state.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void Registry::GetEditKeys() const
+{
+    std::shared_ptr<const KeySnapshot> consoleKey;
+    std::shared_ptr<const KeySnapshot> titleKey;
+    if (SUCCEEDED_NTSTATUS(_GetSnapshots(nullptr, consoleKey, titleKey)))
+    {
+        _GetEditKeys(*consoleKey);
+    }
+}
+
+// Routine Description:
+// - Reads extended edit keys and related registry information into the global state.
+// Arguments:
+// - consoleKey - The console key to use for querying.
+// Return Value:
+// - <none>
+void Registry::_GetEditKeys(const KeySnapshot& consoleKey) const
+{
+    auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+
     // determine whether the user wants to allow alt-f4 to close the console (global setting)
     DWORD dwValue;
-    Status = RegistrySerialization::s_QueryValue(hConsoleKey,
-                                                 CONSOLE_REGISTRY_ALLOW_ALTF4_CLOSE,
-                                                 sizeof(dwValue),
-                                                 REG_DWORD,
-                                                 (PBYTE)&dwValue,
-                                                 nullptr);
+    auto Status = consoleKey.QueryValue(CONSOLE_REGISTRY_ALLOW_ALTF4_CLOSE,
+                                        sizeof(dwValue),
+                                        REG_DWORD,
+                                        (PBYTE)&dwValue,
+                                        nullptr);
     if (SUCCEEDED_NTSTATUS(Status) && dwValue <= 1)
     {
         gci.SetAltF4CloseAllowed(!!dwValue);
@@ -75,24 +361,22 @@ void Registry::GetEditKeys(_In_opt_ HKEY hConsoleKey) const
     // Read word delimiters from registry
     auto& delimiters = ServiceLocator::LocateGlobals().WordDelimiters;
     delimiters.clear();
-    Status = RegistrySerialization::s_QueryValue(hConsoleKey,
-                                                 CONSOLE_REGISTRY_WORD_DELIM,
-                                                 sizeof(dwValue),
-                                                 REG_DWORD,
-                                                 reinterpret_cast<BYTE*>(&dwValue),
-                                                 nullptr);
+    Status = consoleKey.QueryValue(CONSOLE_REGISTRY_WORD_DELIM,
+                                   sizeof(dwValue),
+                                   REG_DWORD,
+                                   reinterpret_cast<BYTE*>(&dwValue),
+                                   nullptr);
     if (FAILED_NTSTATUS(Status))
     {
         // the key isn't a REG_DWORD, try to read it as a REG_SZ
         const size_t bufferSize = 64;
         WCHAR awchBuffer[bufferSize];
         DWORD cbWritten = 0;
-        Status = RegistrySerialization::s_QueryValue(hConsoleKey,
-                                                     CONSOLE_REGISTRY_WORD_DELIM,
-                                                     bufferSize * sizeof(WCHAR),
-                                                     REG_SZ,
-                                                     reinterpret_cast<BYTE*>(awchBuffer),
-                                                     &cbWritten);
+        Status = consoleKey.QueryValue(CONSOLE_REGISTRY_WORD_DELIM,
+                                       bufferSize * sizeof(WCHAR),
+                                       REG_SZ,
+                                       reinterpret_cast<BYTE*>(awchBuffer),
+                                       &cbWritten);
         if (SUCCEEDED_NTSTATUS(Status))
         {
             // we read something, set it as the word delimiters
@@ -114,16 +398,11 @@ void Registry::GetEditKeys(_In_opt_ HKEY hConsoleKey) const
     }
     // --- END LOAD BEARING CODE ---
 
-    if (hCurrentUserKey)
-    {
-        RegCloseKey((HKEY)hConsoleKey);
-        RegCloseKey((HKEY)hCurrentUserKey);
-    }
 }
 
 void Registry::_LoadMappedProperties(_In_reads_(cPropertyMappings) const RegistrySerialization::RegPropertyMap* const rgPropertyMappings,
                                      const size_t cPropertyMappings,
-                                     const HKEY hKey)
+                                     const KeySnapshot& key)
 {
     // Iterate through properties table and load each setting for common property types
     for (UINT iMapping = 0; iMapping < cPropertyMappings; iMapping++)
@@ -140,12 +419,36 @@ void Registry::_LoadMappedProperties(_In_reads_(cPropertyMappings) const Registr
         case RegistrySerialization::_RegPropertyType::Byte:
         case RegistrySerialization::_RegPropertyType::Coordinate:
         {
-            Status = RegistrySerialization::s_LoadRegDword(hKey, pPropMap, _pSettings);
+            DWORD dwValue;
+            Status = key.QueryValue(pPropMap->pwszValueName,
+                                    sizeof(dwValue),
+                                    RegistrySerialization::ToWin32RegistryType(pPropMap->propertyType),
+                                    (PBYTE)&dwValue,
+                                    nullptr);
+            if (SUCCEEDED_NTSTATUS(Status))
+            {
+                RegistrySerialization::s_ApplyRegDword(pPropMap, dwValue, _pSettings);
+            }
             break;
         }
         case RegistrySerialization::_RegPropertyType::String:
         {
-            Status = RegistrySerialization::s_LoadRegString(hKey, pPropMap, _pSettings);
+            // number of characters within the field
+            const auto cchField = pPropMap->cbFieldSize / sizeof(WCHAR);
+            std::wstring buffer(cchField, UNICODE_NULL);
+            Status = key.QueryValue(pPropMap->pwszValueName,
+                                    gsl::narrow_cast<DWORD>(cchField * sizeof(WCHAR)),
+                                    RegistrySerialization::ToWin32RegistryType(pPropMap->propertyType),
+                                    (PBYTE)buffer.data(),
+                                    nullptr);
+            if (SUCCEEDED_NTSTATUS(Status))
+            {
+                // ensure the string is null terminated
+                buffer[cchField - 1] = UNICODE_NULL;
+
+                const auto pwszField = (PWSTR)((PBYTE)_pSettings + pPropMap->dwFieldOffset);
+                Status = StringCchCopyW(pwszField, cchField, buffer.c_str());
+            }
             break;
         }
         }
@@ -166,16 +469,11 @@ void Registry::_LoadMappedProperties(_In_reads_(cPropertyMappings) const Registr
 // - <none>
 void Registry::LoadGlobalsFromRegistry()
 {
-    HKEY hCurrentUserKey;
-    HKEY hConsoleKey;
-    auto status = RegistrySerialization::s_OpenConsoleKey(&hCurrentUserKey, &hConsoleKey);
-
-    if (SUCCEEDED_NTSTATUS(status))
+    std::shared_ptr<const KeySnapshot> consoleKey;
+    std::shared_ptr<const KeySnapshot> titleKey;
+    if (SUCCEEDED_NTSTATUS(_GetSnapshots(nullptr, consoleKey, titleKey)))
     {
-        _LoadMappedProperties(RegistrySerialization::s_GlobalPropMappings, RegistrySerialization::s_GlobalPropMappingsSize, hConsoleKey);
-
-        RegCloseKey((HKEY)hConsoleKey);
-        RegCloseKey((HKEY)hCurrentUserKey);
+        _LoadMappedProperties(RegistrySerialization::s_GlobalPropMappings, RegistrySerialization::s_GlobalPropMappingsSize, *consoleKey);
     }
 }
 
@@ -198,59 +496,21 @@ void Registry::LoadDefaultFromRegistry()
 // - <none>
 void Registry::LoadFromRegistry(_In_ PCWSTR const pwszConsoleTitle)
 {
-    HKEY hCurrentUserKey;
-    HKEY hConsoleKey;
-    auto Status = RegistrySerialization::s_OpenConsoleKey(&hCurrentUserKey, &hConsoleKey);
-    if (FAILED_NTSTATUS(Status))
-    {
-        return;
-    }
-
-    // Open the console title subkey.
-    auto TranslatedConsoleTitle = TranslateConsoleTitle(pwszConsoleTitle, TRUE, TRUE);
-    if (TranslatedConsoleTitle == nullptr)
+    std::shared_ptr<const KeySnapshot> consoleKey;
+    std::shared_ptr<const KeySnapshot> titleKey;
+    if (FAILED_NTSTATUS(_GetSnapshots(pwszConsoleTitle, consoleKey, titleKey)) || !titleKey)
     {
-        RegCloseKey(hConsoleKey);
-        RegCloseKey(hCurrentUserKey);
-        return;
-    }
-
-    HKEY hTitleKey;
-    Status = RegistrySerialization::s_OpenKey(hConsoleKey, TranslatedConsoleTitle, &hTitleKey);
-    delete[] TranslatedConsoleTitle;
-    TranslatedConsoleTitle = nullptr;
-
-    if (FAILED_NTSTATUS(Status))
-    {
-        TranslatedConsoleTitle = TranslateConsoleTitle(pwszConsoleTitle, TRUE, FALSE);
-
-        if (TranslatedConsoleTitle == nullptr)
-        {
-            RegCloseKey(hConsoleKey);
-            RegCloseKey(hCurrentUserKey);
-            return;
-        }
-
-        Status = RegistrySerialization::s_OpenKey(hConsoleKey, TranslatedConsoleTitle, &hTitleKey);
-        delete[] TranslatedConsoleTitle;
-        TranslatedConsoleTitle = nullptr;
-    }
-
-    if (FAILED_NTSTATUS(Status))
-    {
-        RegCloseKey(hConsoleKey);
-        RegCloseKey(hCurrentUserKey);
         return;
     }
 
     // Iterate through properties table and load each setting for common property types
-    _LoadMappedProperties(RegistrySerialization::s_PropertyMappings, RegistrySerialization::s_PropertyMappingsSize, hTitleKey);
+    _LoadMappedProperties(RegistrySerialization::s_PropertyMappings, RegistrySerialization::s_PropertyMappingsSize, *titleKey);
 
     // Now load complex properties
     // Some properties shouldn't be filled by the registry if a copy already exists from the process start information.
-    const auto loadDWORD = [=](const auto valueName) {
+    const auto loadDWORD = [&](const auto valueName) {
         DWORD value;
-        const auto status = RegistrySerialization::s_QueryValue(hTitleKey, valueName, sizeof(value), REG_DWORD, (PBYTE)&value, nullptr);
+        const auto status = titleKey->QueryValue(valueName, sizeof(value), REG_DWORD, (PBYTE)&value, nullptr);
         return SUCCEEDED_NTSTATUS(status) ? std::optional{ value } : std::nullopt;
     };
 
@@ -310,16 +570,5 @@ void Registry::LoadFromRegistry(_In_ PCWSTR const pwszConsoleTitle)
         _pSettings->SetColorTableEntry(TextColor::CURSOR_COLOR, color.value());
     }
 
-    GetEditKeys(hConsoleKey);
-
-    // Close the registry keys
-    RegCloseKey(hTitleKey);
-
-    // These could be equal if there was no title. Don't try to double close.
-    if (hTitleKey != hConsoleKey)
-    {
-        RegCloseKey(hConsoleKey);
-    }
-
-    RegCloseKey(hCurrentUserKey);
+    _GetEditKeys(*consoleKey);
 }
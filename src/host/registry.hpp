@@ -30,12 +30,21 @@ public:
     void LoadDefaultFromRegistry();
     void LoadFromRegistry(_In_ PCWSTR const pwszConsoleTitle);
 
-    void GetEditKeys(_In_opt_ HKEY hConsoleKey) const;
+    void GetEditKeys() const;
 
 private:
+    class KeySnapshot;
+    struct SnapshotCache;
+
+    [[nodiscard]] static NTSTATUS _GetSnapshots(_In_opt_ PCWSTR const pwszConsoleTitle,
+                                                std::shared_ptr<const KeySnapshot>& consoleKey,
+                                                std::shared_ptr<const KeySnapshot>& titleKey) noexcept;
+    static std::shared_ptr<const KeySnapshot> _ReadTitleKey(const HKEY hConsoleKey, _In_ PCWSTR const pwszConsoleTitle);
+
+    void _GetEditKeys(const KeySnapshot& consoleKey) const;
     void _LoadMappedProperties(_In_reads_(cPropertyMappings) const RegistrySerialization::RegPropertyMap* const rgPropertyMappings,
                                const size_t cPropertyMappings,
-                               const HKEY hKey);
+                               const KeySnapshot& key);
 
     Settings* const _pSettings;
 };
@@ -313,9 +313,9 @@ const std::wstring RenderData::GetHyperlinkCustomId(uint16_t id) const
 }
 
 // For now, we ignore regex patterns in conhost
-const std::vector<size_t> RenderData::GetPatternId(const til::point /*location*/) const
+void RenderData::GetPatternId(const til::point /*location*/, std::vector<size_t>& ids) const
 {
-    return {};
+    ids.clear();
 }
 
 // Routine Description:
@@ -94,6 +94,21 @@ SCREEN_INFORMATION::~SCREEN_INFORMATION()
                                                           const TextAttribute popupAttributes,
                                                           const UINT uiCursorSize,
                                                           _Outptr_ SCREEN_INFORMATION** const ppScreen)
+{
+    return _CreateInstance(coordWindowSize, fontInfo, coordScreenBufferSize, defaultAttributes, popupAttributes, uiCursorSize, nullptr, ppScreen);
+}
+
+// Routine Description:
+// - Same as CreateInstance, but if recycledTextBuffer is given, it's reset and used
+//   instead of allocating a new TextBuffer. See TextBuffer::Recycle.
+[[nodiscard]] NTSTATUS SCREEN_INFORMATION::_CreateInstance(_In_ til::size coordWindowSize,
+                                                           const FontInfo fontInfo,
+                                                           _In_ til::size coordScreenBufferSize,
+                                                           const TextAttribute defaultAttributes,
+                                                           const TextAttribute popupAttributes,
+                                                           const UINT uiCursorSize,
+                                                           std::unique_ptr<TextBuffer> recycledTextBuffer,
+                                                           _Outptr_ SCREEN_INFORMATION** const ppScreen)
 {
     *ppScreen = nullptr;
 
@@ -114,11 +129,20 @@ SCREEN_INFORMATION::~SCREEN_INFORMATION()
         pScreen->UpdateBottom();
 
         // Set up text buffer
-        pScreen->_textBuffer = std::make_unique<TextBuffer>(coordScreenBufferSize,
-                                                            defaultAttributes,
-                                                            uiCursorSize,
-                                                            pScreen->IsActiveScreenBuffer(),
-                                                            *ServiceLocator::LocateGlobals().pRender);
+        if (recycledTextBuffer)
+        {
+            recycledTextBuffer->Recycle(coordScreenBufferSize, defaultAttributes, uiCursorSize);
+            recycledTextBuffer->SetAsActiveBuffer(pScreen->IsActiveScreenBuffer());
+            pScreen->_textBuffer = std::move(recycledTextBuffer);
+        }
+        else
+        {
+            pScreen->_textBuffer = std::make_unique<TextBuffer>(coordScreenBufferSize,
+                                                                defaultAttributes,
+                                                                uiCursorSize,
+                                                                pScreen->IsActiveScreenBuffer(),
+                                                                *ServiceLocator::LocateGlobals().pRender);
+        }
 
         const auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
         pScreen->_textBuffer->GetCursor().SetType(gci.GetCursorType());
@@ -1862,13 +1886,14 @@ const SCREEN_INFORMATION& SCREEN_INFORMATION::GetMainBuffer() const
     auto initAttributes = GetAttributes();
     initAttributes.SetStandardErase();
 
-    auto Status = SCREEN_INFORMATION::CreateInstance(WindowSize,
-                                                     existingFont,
-                                                     WindowSize,
-                                                     initAttributes,
-                                                     GetPopupAttributes(),
-                                                     Cursor::CURSOR_SMALL_SIZE,
-                                                     ppsiNewScreenBuffer);
+    auto Status = SCREEN_INFORMATION::_CreateInstance(WindowSize,
+                                                      existingFont,
+                                                      WindowSize,
+                                                      initAttributes,
+                                                      GetPopupAttributes(),
+                                                      Cursor::CURSOR_SMALL_SIZE,
+                                                      std::move(_spareAltTextBuffer),
+                                                      ppsiNewScreenBuffer);
     if (SUCCEEDED_NTSTATUS(Status))
     {
         // Update the alt buffer's cursor style, visibility, and position to match our own.
@@ -2052,6 +2077,10 @@ void SCREEN_INFORMATION::UseMainScreenBuffer()
         // Copy the alt buffer's output mode back to the main buffer.
         psiMain->OutputMode = psiAlt->OutputMode;
 
+        // Hold on to the alt buffer's text buffer, so that the next one doesn't need to allocate it again.
+        psiAlt->_textBuffer->SetAsActiveBuffer(false);
+        psiMain->_spareAltTextBuffer = std::move(psiAlt->_textBuffer);
+
         s_RemoveScreenBuffer(psiAlt); // this will also delete the alt buffer
         // deleting the alt buffer will give the GetSet back to its main
 
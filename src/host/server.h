@@ -109,6 +109,8 @@ public:
     void UnlockConsole() noexcept;
     bool IsConsoleLocked() const noexcept;
     ULONG GetCSRecursionCount() const noexcept;
+    void LockConsoleShared() noexcept;
+    void UnlockConsoleShared() noexcept;
 
     Microsoft::Console::VirtualTerminal::VtIo* GetVtIo();
 
@@ -152,6 +154,8 @@ public:
 
 private:
     til::recursive_ticket_lock _lock;
+    // Held exclusively by the outermost LockConsole() and shared by LockConsoleShared().
+    std::shared_mutex _sharedLock;
 
     std::wstring _Title;
     std::wstring _Prefix; // Eg Select, Mark - things that we manually prepend to the title.
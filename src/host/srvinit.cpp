@@ -252,6 +252,15 @@ static bool s_IsOnDesktop()
         settings.SetLaunchFaceName(settings.GetFaceName());
     }
 
+    if constexpr (Feature_PersistentCommandHistory::IsEnabled())
+    {
+        try
+        {
+            CommandHistory::s_SetPersistentHistoryDirectory(wil::ExpandEnvironmentStringsW<std::wstring>(L"%LOCALAPPDATA%\\Microsoft\\Console\\History"));
+        }
+        CATCH_LOG();
+    }
+
     // Allocate console will read the global ServiceLocator::LocateGlobals().getConsoleInformation
     // for the settings we just set.
     auto Status = CONSOLE_INFORMATION::AllocateConsole({ Title, TitleLength / sizeof(wchar_t) });
@@ -606,8 +615,8 @@ try
     // GH#13211 - Make sure we request win32input mode and that the terminal
     // obeys the resizing quirk. Otherwise, defterm connections to the Terminal
     // are going to have weird resizing, and aren't going to send full fidelity
-    // input messages.
-    const auto commandLine = fmt::format(FMT_COMPILE(L" --headless --resizeQuirk --win32input --signal {:#x}"),
+    // input messages. The Terminal also understands REP, like ConptyConnection tells us.
+    const auto commandLine = fmt::format(FMT_COMPILE(L" --headless --resizeQuirk --win32input --repeatchar --signal {:#x}"),
                                          (int64_t)signalPipeOurSide.release());
 
     ConsoleArguments consoleArgs(commandLine, inPipeOurSide.release(), outPipeOurSide.release());
@@ -912,6 +921,41 @@ PWSTR TranslateConsoleTitle(_In_ PCWSTR pwszConsoleTitle, const BOOL fUnexpand,
     // Allow the renderer to paint once the rest of the console is hooked up.
     g.pRender->EnablePainting();
 
+    // Potentially start the VT IO (if needed)
+    // Make sure to do this after the i/o buffers have been created.
+    // We'll need the size of the screen buffer in the vt i/o initialization
+    // In conpty mode this happens before the pseudo window gets created below,
+    // so that the terminal receives its first bytes (the mode requests) without
+    // waiting for the input thread to come up. The window isn't needed for VT
+    // I/O and the signal thread is only connected once it exists.
+    if (SUCCEEDED_NTSTATUS(Status))
+    {
+        auto hr = gci.GetVtIo()->CreateIoHandlers();
+        if (hr == S_FALSE)
+        {
+            // We're not in VT I/O mode, this is fine.
+        }
+        else if (SUCCEEDED(hr))
+        {
+            // Actually start the VT I/O threads
+            hr = gci.GetVtIo()->StartIfNeeded();
+            // Don't convert S_FALSE to an NTSTATUS - the equivalent NTSTATUS
+            //      is treated as an error
+            if (hr != S_FALSE)
+            {
+                Status = NTSTATUS_FROM_HRESULT(hr);
+            }
+            else
+            {
+                Status = ERROR_SUCCESS;
+            }
+        }
+        else
+        {
+            Status = NTSTATUS_FROM_HRESULT(hr);
+        }
+    }
+
     if (SUCCEEDED_NTSTATUS(Status) && ConsoleConnectionDeservesVisibleWindow(p))
     {
         HANDLE Thread = nullptr;
@@ -970,35 +1014,9 @@ PWSTR TranslateConsoleTitle(_In_ PCWSTR pwszConsoleTitle, const BOOL fUnexpand,
         }
     }
 
-    // Potentially start the VT IO (if needed)
-    // Make sure to do this after the i/o buffers have been created.
-    // We'll need the size of the screen buffer in the vt i/o initialization
     if (SUCCEEDED_NTSTATUS(Status))
     {
-        auto hr = gci.GetVtIo()->CreateIoHandlers();
-        if (hr == S_FALSE)
-        {
-            // We're not in VT I/O mode, this is fine.
-        }
-        else if (SUCCEEDED(hr))
-        {
-            // Actually start the VT I/O threads
-            hr = gci.GetVtIo()->StartIfNeeded();
-            // Don't convert S_FALSE to an NTSTATUS - the equivalent NTSTATUS
-            //      is treated as an error
-            if (hr != S_FALSE)
-            {
-                Status = NTSTATUS_FROM_HRESULT(hr);
-            }
-            else
-            {
-                Status = ERROR_SUCCESS;
-            }
-        }
-        else
-        {
-            Status = NTSTATUS_FROM_HRESULT(hr);
-        }
+        gci.GetVtIo()->ConnectConsole();
     }
 
     return Status;
@@ -1057,6 +1075,19 @@ DWORD WINAPI ConsoleIoThread(LPVOID lpParameter)
             continue;
         }
         ReceiveMsg._pApiRoutines = globals.api;
+
+        if constexpr (Feature_ConcurrentApiServer::IsEnabled())
+        {
+            // In passthrough mode even queries modify the buffer (see VtApiRoutines),
+            // so only the default routines may be called concurrently.
+            if (ReceiveMsg._pApiRoutines == &globals.defaultApiRoutines && IoSorter::TryServiceIoOperationConcurrently(&ReceiveMsg))
+            {
+                // The thread pool replies to the message on its own.
+                ReplyMsg = nullptr;
+                continue;
+            }
+        }
+
         IoSorter::ServiceIoOperation(&ReceiveMsg, &ReplyMsg);
     }
 
@@ -441,6 +441,13 @@ try
 
     while (writer.size() >= charSize)
     {
+        // Pasted text can be copied over as a whole, instead of one key event at a time.
+        if (inputBuffer.ConsumeString(unicode, writer))
+        {
+            noDataReadYet = false;
+            continue;
+        }
+
         wchar_t wch;
         // We don't need to wait for input if `ConsumeCached` read something already, which is
         // indicated by the writer having been advanced (= it's shorter than the original buffer).
@@ -50,6 +50,16 @@ class CodepointWidthDetectorTests
         }
     }
 
+    TEST_METHOD(CanMeasureNarrowPrefix)
+    {
+        VERIFY_ARE_EQUAL(0u, CodepointWidthDetector::NarrowPrefixLength(L""));
+        VERIFY_ARE_EQUAL(5u, CodepointWidthDetector::NarrowPrefixLength(L"abc\x414\x439"));
+        // Wide and ambiguous characters, as well as surrogate pairs, end the run.
+        VERIFY_ARE_EQUAL(2u, CodepointWidthDetector::NarrowPrefixLength(L"ab\x306A" L"c"));
+        VERIFY_ARE_EQUAL(1u, CodepointWidthDetector::NarrowPrefixLength(L"a\xA1"));
+        VERIFY_ARE_EQUAL(1u, CodepointWidthDetector::NarrowPrefixLength(L"a\xD83D\xDC7E"));
+    }
+
     static bool FallbackMethod(const std::wstring_view glyph)
     {
         if (glyph.size() < 1)
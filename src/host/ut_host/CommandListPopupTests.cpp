@@ -535,4 +535,43 @@ class CommandListPopupTests
         VERIFY_ARE_EQUAL(m_pHistory->GetLastCommand(), L"here is my handle");
         VERIFY_ARE_EQUAL(m_pHistory->GetNth(2), L"here is my spout");
     }
+
+    TEST_METHOD(LetterCyclesThroughMatchingCommands)
+    {
+        // function to simulate user pressing "W" six times, then escape
+        Popup::UserInputFunction fn = [](COOKED_READ_DATA& /*cookedReadData*/, bool& popupKey, DWORD& modifiers, wchar_t& wch) {
+            static unsigned int count = 0;
+            if (count < 6)
+            {
+                wch = L'W';
+                popupKey = false;
+            }
+            else
+            {
+                wch = VK_ESCAPE;
+                popupKey = true;
+            }
+            modifiers = 0;
+            ++count;
+            return STATUS_SUCCESS;
+        };
+
+        auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+        // prepare popup
+        PopupTestHelper::InitLongHistory(*m_pHistory);
+        CommandListPopup popup{ gci.GetActiveOutputBuffer(), *m_pHistory };
+        popup.SetUserInputFunction(fn);
+
+        // prepare cookedReadData
+        wchar_t buffer[BUFFER_SIZE];
+        std::fill(std::begin(buffer), std::end(buffer), UNICODE_SPACE);
+        auto& cookedReadData = gci.CookedReadData();
+        PopupTestHelper::InitReadData(cookedReadData, buffer, ARRAYSIZE(buffer), 0);
+        cookedReadData._commandHistory = m_pHistory;
+
+        // The commands starting with "W" are 5, 10, 12, 13 and 19. Going backwards
+        // from the end and wrapping around after 5, the sixth one is 19 again.
+        VERIFY_ARE_EQUAL(popup.Process(cookedReadData), static_cast<NTSTATUS>(CONSOLE_STATUS_WAIT_NO_BLOCK));
+        VERIFY_ARE_EQUAL(19, popup._currentCommand);
+    }
 };
@@ -89,6 +89,7 @@ class ConptyOutputTests
                                                                initialViewport);
         auto pfn = std::bind(&ConptyOutputTests::_writeCallback, this, std::placeholders::_1, std::placeholders::_2);
         vtRenderEngine->SetTestCallback(pfn);
+        _vtRenderEngine = vtRenderEngine.get();
 
         g.pRender->AddRenderEngine(vtRenderEngine.get());
         gci.GetActiveOutputBuffer().SetTerminalConnection(vtRenderEngine.get());
@@ -122,12 +123,14 @@ class ConptyOutputTests
     TEST_METHOD(InvalidateUntilOneBeforeEnd);
     TEST_METHOD(SetConsoleTitleWithControlChars);
     TEST_METHOD(IncludeBackgroundColorChangesInFirstFrame);
+    TEST_METHOD(ShadowBufferSkipsUnchangedCells);
 
 private:
     bool _writeCallback(const char* const pch, const size_t cch);
     void _flushFirstFrame();
     std::deque<std::string> expectedOutput;
     std::unique_ptr<CommonState> m_state;
+    Xterm256Engine* _vtRenderEngine = nullptr;
 };
 
 bool ConptyOutputTests::_writeCallback(const char* const pch, const size_t cch)
@@ -428,3 +431,58 @@ void ConptyOutputTests::IncludeBackgroundColorChangesInFirstFrame()
 
     VERIFY_SUCCEEDED(renderer.PaintFrame());
 }
+
+void ConptyOutputTests::ShadowBufferSkipsUnchangedCells()
+{
+    Log::Comment(NoThrowString().Format(
+        L"Repaint the same contents with and without the shadow buffer and "
+        L"compare the number of bytes that are emitted per frame"));
+
+    auto& g = ServiceLocator::LocateGlobals();
+    auto& renderer = *g.pRender;
+    auto& gci = g.getConsoleInformation();
+    auto& si = gci.GetActiveOutputBuffer();
+    auto& sm = si.GetStateMachine();
+
+    _flushFirstFrame();
+
+    size_t bytes = 0;
+    _vtRenderEngine->SetTestCallback([&](const char* const, const size_t cch) {
+        bytes += cch;
+        return true;
+    });
+    const auto paint = [&]() {
+        bytes = 0;
+        VERIFY_SUCCEEDED(renderer.PaintFrame());
+        return bytes;
+    };
+
+    for (auto i = 0; i < 10; ++i)
+    {
+        sm.ProcessString(L"\x1b[31mred \x1b[32mgreen \x1b[1;34mblue\x1b[m and some plain text after it\r\n");
+    }
+    paint();
+
+    renderer.TriggerRedrawAll();
+    const auto fullRepaint = paint();
+
+    _vtRenderEngine->SetShadowBufferMode(true);
+    renderer.TriggerRedrawAll();
+    paint();
+    renderer.TriggerRedrawAll();
+    const auto shadowRepaint = paint();
+
+    sm.ProcessString(L"\x1b[5;30Hx");
+    const auto shadowUpdate = paint();
+
+    Log::Comment(NoThrowString().Format(
+        L"Full repaint: %zu bytes, with the shadow buffer: %zu bytes, after changing a cell: %zu bytes",
+        fullRepaint,
+        shadowRepaint,
+        shadowUpdate));
+
+    VERIFY_IS_LESS_THAN(shadowRepaint * 10, fullRepaint);
+    VERIFY_IS_LESS_THAN(shadowUpdate * 10, fullRepaint);
+
+    _vtRenderEngine->SetTestCallback(std::bind(&ConptyOutputTests::_writeCallback, this, std::placeholders::_1, std::placeholders::_2));
+}
@@ -32,6 +32,7 @@ public:
     TEST_METHOD(HeadlessArgTests);
     TEST_METHOD(SignalHandleTests);
     TEST_METHOD(FeatureArgTests);
+    TEST_METHOD(VtFrameIntervalTests);
 };
 
 ConsoleArguments CreateAndParse(std::wstring& commandline, HANDLE hVtIn, HANDLE hVtOut)
@@ -1336,3 +1337,33 @@ void ConsoleArgumentsTests::FeatureArgTests()
                                     false), // passthroughMode
                    false); // successful parse?
 }
+
+void ConsoleArgumentsTests::VtFrameIntervalTests()
+{
+    std::wstring commandline;
+
+    commandline = L"conhost.exe --headless";
+    Log::Comment(L"#1 frames aren't limited by default");
+    {
+        const auto args = CreateAndParse(commandline, INVALID_HANDLE_VALUE, INVALID_HANDLE_VALUE);
+        VERIFY_ARE_EQUAL(short{ 0 }, args.GetVtFrameInterval());
+        VERIFY_ARE_EQUAL(short{ 0 }, args.GetVtIdleFlush());
+    }
+
+    commandline = L"conhost.exe --headless --vtframeinterval 16 --vtidleflush 4";
+    Log::Comment(L"#2 both values are given");
+    {
+        const auto args = CreateAndParse(commandline, INVALID_HANDLE_VALUE, INVALID_HANDLE_VALUE);
+        VERIFY_ARE_EQUAL(short{ 16 }, args.GetVtFrameInterval());
+        VERIFY_ARE_EQUAL(short{ 4 }, args.GetVtIdleFlush());
+        VERIFY_IS_TRUE(args.IsHeadless());
+    }
+
+    commandline = L"conhost.exe --vtidleflush -1";
+    Log::Comment(L"#3 negative values are rejected");
+    CreateAndParseUnsuccessfully(commandline, INVALID_HANDLE_VALUE, INVALID_HANDLE_VALUE);
+
+    commandline = L"conhost.exe --vtframeinterval 16ms";
+    Log::Comment(L"#4 values must be plain numbers");
+    CreateAndParseUnsuccessfully(commandline, INVALID_HANDLE_VALUE, INVALID_HANDLE_VALUE);
+}
@@ -242,6 +242,36 @@ class HistoryTests
         VERIFY_ARE_EQUAL(2ul, history->GetNumberOfCommands());
     }
 
+    TEST_METHOD(FindMatchingCommandFindsClosestPrecedingMatch)
+    {
+        auto history = CommandHistory::s_Allocate(_manyApps[0], _MakeHandle(0));
+        VERIFY_IS_NOT_NULL(history);
+
+        VERIFY_SUCCEEDED(history->Add(L"dir", false));
+        VERIFY_SUCCEEDED(history->Add(L"cd", false));
+        VERIFY_SUCCEEDED(history->Add(L"dir /w", false));
+        VERIFY_SUCCEEDED(history->Add(L"git push", false));
+
+        const auto find = [&](const std::wstring_view command, const SHORT startingIndex, const CommandHistory::MatchOptions options) {
+            SHORT index;
+            return history->FindMatchingCommand(command, startingIndex, index, options | CommandHistory::MatchOptions::JustLooking) ? index : SHORT{ -1 };
+        };
+
+        Log::Comment(L"The search starts before the given index and wraps around at the start");
+        VERIFY_ARE_EQUAL(2, find(L"dir", 3, CommandHistory::MatchOptions::None));
+        VERIFY_ARE_EQUAL(0, find(L"dir", 2, CommandHistory::MatchOptions::None));
+        VERIFY_ARE_EQUAL(2, find(L"dir", 0, CommandHistory::MatchOptions::None));
+        VERIFY_ARE_EQUAL(0, find(L"dir", 3, CommandHistory::MatchOptions::ExactMatch));
+        VERIFY_ARE_EQUAL(-1, find(L"dirt", 3, CommandHistory::MatchOptions::None));
+
+        Log::Comment(L"Matches are still found after commands were moved around or removed");
+        history->Swap(0, 1);
+        VERIFY_ARE_EQUAL(1, find(L"dir", 3, CommandHistory::MatchOptions::ExactMatch));
+        VERIFY_ARE_EQUAL(std::wstring{ L"dir" }, history->Remove(1));
+        VERIFY_ARE_EQUAL(-1, find(L"dir", 2, CommandHistory::MatchOptions::ExactMatch));
+        VERIFY_ARE_EQUAL(1, find(L"dir", 2, CommandHistory::MatchOptions::None));
+    }
+
 private:
     const std::array<std::wstring, 5> _manyApps = {
         L"foo.exe",
@@ -70,6 +70,26 @@ class InputBufferTests
         VERIFY_ARE_EQUAL(inputBuffer.GetNumberOfReadyEvents(), 2u);
     }
 
+    TEST_METHOD(WriteBatchDefersWakingUpReaders)
+    {
+        InputBuffer inputBuffer;
+        inputBuffer.BeginWriteBatch();
+        inputBuffer.BeginWriteBatch();
+        for (auto i = 0; i < 3; ++i)
+        {
+            VERIFY_IS_GREATER_THAN(inputBuffer.Write(IInputEvent::Create(MakeKeyEvent(true, 1, L'a' + i, 0, L'a' + i, 0))), 0u);
+        }
+        // The records are stored right away, only the readers are woken up later.
+        VERIFY_ARE_EQUAL(inputBuffer.GetNumberOfReadyEvents(), 3u);
+        VERIFY_IS_TRUE(inputBuffer._wakeUpPending);
+
+        inputBuffer.EndWriteBatch();
+        VERIFY_IS_TRUE(inputBuffer._wakeUpPending);
+        inputBuffer.EndWriteBatch();
+        VERIFY_IS_FALSE(inputBuffer._wakeUpPending);
+        VERIFY_ARE_EQUAL(inputBuffer.GetNumberOfReadyEvents(), 3u);
+    }
+
     TEST_METHOD(CanInsertIntoInputBufferIndividually)
     {
         InputBuffer inputBuffer;
@@ -78,7 +98,7 @@ class InputBufferTests
             INPUT_RECORD record;
             record.EventType = MENU_EVENT;
             VERIFY_IS_GREATER_THAN(inputBuffer.Write(IInputEvent::Create(record)), 0u);
-            VERIFY_ARE_EQUAL(record, inputBuffer._storage.back()->ToInputRecord());
+            VERIFY_ARE_EQUAL(record, inputBuffer._storage.back());
         }
         VERIFY_ARE_EQUAL(inputBuffer.GetNumberOfReadyEvents(), RECORD_INSERT_COUNT);
     }
@@ -98,8 +118,38 @@ class InputBufferTests
         // verify that the events are the same in storage
         for (size_t i = 0; i < RECORD_INSERT_COUNT; ++i)
         {
-            VERIFY_ARE_EQUAL(inputBuffer._storage[i]->ToInputRecord(), record);
+            VERIFY_ARE_EQUAL(inputBuffer._storage[i], record);
+        }
+    }
+
+    TEST_METHOD(CanStreamRecordsThroughInputBuffer)
+    {
+        Log::Comment(L"Records written in bulk must come out in order, "
+                     L"even if the reader consumes them slower than they're written.");
+
+        InputBuffer inputBuffer;
+        std::vector<INPUT_RECORD> records;
+        for (size_t i = 0; i < 4096; ++i)
+        {
+            records.push_back(MakeKeyEvent(true, 1, L'a', 0, static_cast<WCHAR>(L'a' + i % 26), 0));
         }
+
+        size_t read = 0;
+        for (size_t i = 0; i < 4; ++i)
+        {
+            VERIFY_ARE_EQUAL(inputBuffer.Write(records), records.size());
+
+            // Read back a bit less than we wrote, one event at a time.
+            for (size_t j = 0; j < records.size() - 100; ++j, ++read)
+            {
+                std::unique_ptr<IInputEvent> outEvent;
+                VERIFY_NT_SUCCESS(inputBuffer.Read(outEvent, false, false, true, false));
+                VERIFY_ARE_EQUAL(til::at(records, read % records.size()), outEvent->ToInputRecord());
+            }
+        }
+
+        VERIFY_ARE_EQUAL(400u, inputBuffer.GetNumberOfReadyEvents());
+        VERIFY_ARE_EQUAL(til::at(records, read % records.size()), inputBuffer._storage.front());
     }
 
     TEST_METHOD(InputBufferCoalescesMouseEvents)
@@ -121,10 +171,9 @@ class InputBufferTests
         // check that they coalesced
         VERIFY_ARE_EQUAL(inputBuffer.GetNumberOfReadyEvents(), 1u);
         // check that the mouse position is being updated correctly
-        const IInputEvent* const pOutEvent = inputBuffer._storage.front().get();
-        const auto pMouseEvent = static_cast<const MouseEvent* const>(pOutEvent);
-        VERIFY_ARE_EQUAL(pMouseEvent->GetPosition().x, static_cast<SHORT>(RECORD_INSERT_COUNT));
-        VERIFY_ARE_EQUAL(pMouseEvent->GetPosition().y, static_cast<SHORT>(RECORD_INSERT_COUNT * 2));
+        const auto& outRecord = inputBuffer._storage.front();
+        VERIFY_ARE_EQUAL(outRecord.Event.MouseEvent.dwMousePosition.X, static_cast<SHORT>(RECORD_INSERT_COUNT));
+        VERIFY_ARE_EQUAL(outRecord.Event.MouseEvent.dwMousePosition.Y, static_cast<SHORT>(RECORD_INSERT_COUNT * 2));
 
         // add a key event and another mouse event to make sure that
         // an event between two mouse events stopped the coalescing.
@@ -162,10 +211,10 @@ class InputBufferTests
         // no events should have been coalesced
         VERIFY_ARE_EQUAL(inputBuffer.GetNumberOfReadyEvents(), RECORD_INSERT_COUNT + 1);
         // check that the events stored match those inserted
-        VERIFY_ARE_EQUAL(inputBuffer._storage.front()->ToInputRecord(), mouseRecords[0]);
+        VERIFY_ARE_EQUAL(inputBuffer._storage.front(), mouseRecords[0]);
         for (size_t i = 0; i < RECORD_INSERT_COUNT; ++i)
         {
-            VERIFY_ARE_EQUAL(inputBuffer._storage[i + 1]->ToInputRecord(), mouseRecords[i]);
+            VERIFY_ARE_EQUAL(inputBuffer._storage[i + 1], mouseRecords[i]);
         }
     }
 
@@ -221,10 +270,10 @@ class InputBufferTests
         // no events should have been coalesced
         VERIFY_ARE_EQUAL(inputBuffer.GetNumberOfReadyEvents(), RECORD_INSERT_COUNT + 1);
         // check that the events stored match those inserted
-        VERIFY_ARE_EQUAL(inputBuffer._storage.front()->ToInputRecord(), keyRecords[0]);
+        VERIFY_ARE_EQUAL(inputBuffer._storage.front(), keyRecords[0]);
         for (size_t i = 0; i < RECORD_INSERT_COUNT; ++i)
         {
-            VERIFY_ARE_EQUAL(inputBuffer._storage[i + 1]->ToInputRecord(), keyRecords[i]);
+            VERIFY_ARE_EQUAL(inputBuffer._storage[i + 1], keyRecords[i]);
         }
     }
 
@@ -239,7 +288,7 @@ class InputBufferTests
         for (size_t i = 0; i < RECORD_INSERT_COUNT; ++i)
         {
             VERIFY_IS_GREATER_THAN(inputBuffer.Write(IInputEvent::Create(record)), 0u);
-            VERIFY_ARE_EQUAL(inputBuffer._storage.back()->ToInputRecord(), record);
+            VERIFY_ARE_EQUAL(inputBuffer._storage.back(), record);
         }
 
         // The events shouldn't be coalesced
@@ -459,6 +508,44 @@ class InputBufferTests
         }
     }
 
+    TEST_METHOD(CanReadIntoRecordSpan)
+    {
+        auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+        InputBuffer inputBuffer;
+
+        const INPUT_RECORD inRecords[]{
+            MakeKeyEvent(TRUE, 1, L'A', 0, L'a', 0),
+            MakeKeyEvent(TRUE, 1, L'B', 0, L'b', 0),
+            MakeKeyEvent(TRUE, 1, 0, 0, L'\x3042', 0),
+        };
+        VERIFY_ARE_EQUAL(inputBuffer.Write(inRecords), 3u);
+
+        // The records are written straight into the span and what doesn't fit stays in the buffer.
+        INPUT_RECORD outRecords[2]{};
+        size_t read = 0;
+        VERIFY_NT_SUCCESS(inputBuffer.Read(outRecords, read, false, false, true, false));
+        VERIFY_ARE_EQUAL(2u, read);
+        VERIFY_ARE_EQUAL(inRecords[0], outRecords[0]);
+        VERIFY_ARE_EQUAL(inRecords[1], outRecords[1]);
+        VERIFY_ARE_EQUAL(inputBuffer.GetNumberOfReadyEvents(), 1u);
+
+        // U+3042 is encoded as 2 bytes in codepage 932. If only the first one fits,
+        // the second one is returned by the next read.
+        const auto restoreCP = wil::scope_exit([&, cp = gci.CP]() { gci.CP = cp; });
+        gci.CP = 932;
+
+        VERIFY_NT_SUCCESS(inputBuffer.Read({ &outRecords[0], 1 }, read, false, false, false, false));
+        VERIFY_ARE_EQUAL(1u, read);
+        VERIFY_ARE_EQUAL(L'\x82', outRecords[0].Event.KeyEvent.uChar.UnicodeChar);
+
+        VERIFY_NT_SUCCESS(inputBuffer.Read({ &outRecords[0], 1 }, read, false, false, false, false));
+        VERIFY_ARE_EQUAL(1u, read);
+        VERIFY_ARE_EQUAL(L'\xa0', outRecords[0].Event.KeyEvent.uChar.UnicodeChar);
+
+        VERIFY_NT_SUCCESS(inputBuffer.Read({ &outRecords[0], 1 }, read, false, false, false, false));
+        VERIFY_ARE_EQUAL(0u, read);
+    }
+
     TEST_METHOD(CanPrependEvents)
     {
         InputBuffer inputBuffer;
@@ -633,7 +720,7 @@ class InputBufferTests
                                            true));
         VERIFY_ARE_EQUAL(outEvents.size(), 1u);
         VERIFY_ARE_EQUAL(inputBuffer._storage.size(), 1u);
-        VERIFY_ARE_EQUAL(static_cast<const KeyEvent&>(*inputBuffer._storage.front()).GetRepeatCount(), repeatCount - 1);
+        VERIFY_ARE_EQUAL(inputBuffer._storage.front().Event.KeyEvent.wRepeatCount, repeatCount - 1);
         VERIFY_ARE_EQUAL(static_cast<const KeyEvent&>(*outEvents.front()).GetRepeatCount(), 1u);
     }
 
@@ -653,7 +740,60 @@ class InputBufferTests
                                            true));
         VERIFY_ARE_EQUAL(outEvents.size(), 1u);
         VERIFY_ARE_EQUAL(inputBuffer._storage.size(), 1u);
-        VERIFY_ARE_EQUAL(static_cast<const KeyEvent&>(*inputBuffer._storage.front()).GetRepeatCount(), repeatCount);
+        VERIFY_ARE_EQUAL(inputBuffer._storage.front().Event.KeyEvent.wRepeatCount, repeatCount);
         VERIFY_ARE_EQUAL(static_cast<const KeyEvent&>(*outEvents.front()).GetRepeatCount(), 1u);
     }
+
+    TEST_METHOD(WrittenStringIsReadAsTextOrKeyEvents)
+    {
+        InputBuffer inputBuffer;
+        wchar_t buffer[8];
+        std::span<char> target{ reinterpret_cast<char*>(&buffer[0]), 2 * sizeof(wchar_t) };
+
+        Log::Comment(L"Text that isn't preceded by records is copied over as is");
+        inputBuffer.WriteString(L"abc");
+        VERIFY_IS_TRUE(inputBuffer.ConsumeString(true, target));
+        VERIFY_IS_TRUE(target.empty());
+        VERIFY_ARE_EQUAL(L"ab", (std::wstring_view{ &buffer[0], 2 }));
+
+        Log::Comment(L"Records written afterwards are ordered after the remaining text");
+        INPUT_RECORD record;
+        record.EventType = MENU_EVENT;
+        VERIFY_IS_GREATER_THAN(inputBuffer.Write(IInputEvent::Create(record)), 0u);
+        VERIFY_IS_TRUE(inputBuffer._pendingTextReader.empty());
+
+        std::deque<std::unique_ptr<IInputEvent>> outEvents;
+        VERIFY_NT_SUCCESS(inputBuffer.Read(outEvents, 3, false, false, true, false));
+        VERIFY_ARE_EQUAL(3u, outEvents.size());
+        VERIFY_ARE_EQUAL(InputEventType::KeyEvent, outEvents[0]->EventType());
+        VERIFY_IS_TRUE(static_cast<const KeyEvent&>(*outEvents[0]).IsKeyDown());
+        VERIFY_ARE_EQUAL(L'c', static_cast<const KeyEvent&>(*outEvents[0]).GetCharData());
+        VERIFY_ARE_EQUAL(InputEventType::KeyEvent, outEvents[1]->EventType());
+        VERIFY_IS_FALSE(static_cast<const KeyEvent&>(*outEvents[1]).IsKeyDown());
+        VERIFY_ARE_EQUAL(InputEventType::MenuEvent, outEvents[2]->EventType());
+
+        Log::Comment(L"Text that is preceded by records has to wait for them to be read");
+        VERIFY_IS_GREATER_THAN(inputBuffer.Write(IInputEvent::Create(record)), 0u);
+        inputBuffer.WriteString(L"d");
+        target = { reinterpret_cast<char*>(&buffer[0]), sizeof(buffer) };
+        VERIFY_IS_FALSE(inputBuffer.ConsumeString(true, target));
+        VERIFY_ARE_EQUAL(sizeof(buffer), target.size());
+        VERIFY_ARE_EQUAL(3u, inputBuffer.GetNumberOfReadyEvents());
+    }
+
+    TEST_METHOD(WrittenStringInVtInputModeIsStoredAsCharacters)
+    {
+        InputBuffer inputBuffer;
+        WI_SetFlag(inputBuffer.InputMode, ENABLE_VIRTUAL_TERMINAL_INPUT);
+
+        const std::wstring_view text{ L"Ab\x20ac" };
+        inputBuffer.WriteString(text);
+        VERIFY_IS_TRUE(inputBuffer._pendingTextReader.empty());
+        VERIFY_ARE_EQUAL(text.size(), inputBuffer._storage.size());
+
+        for (size_t i = 0; i < text.size(); ++i)
+        {
+            VERIFY_ARE_EQUAL(MakeKeyEvent(TRUE, 1, 0, 0, til::at(text, i), 0), inputBuffer._storage[i]);
+        }
+    }
 };
@@ -8,11 +8,13 @@
 #include "CommonState.hpp"
 
 #include "../buffer/out/search.h"
+#include "../buffer/out/SearchIndex.hpp"
 
 using namespace WEX::Common;
 using namespace WEX::Logging;
 using namespace WEX::TestExecution;
 using Microsoft::Console::Interactivity::ServiceLocator;
+using Microsoft::Console::Types::Viewport;
 
 class SearchTests
 {
@@ -158,4 +160,168 @@ class SearchTests
         Search s(gci.renderData, L"\x304b", Search::Direction::Backward, Search::Sensitivity::CaseInsensitive);
         DoFoundChecks(s, coordStartExpected, -1);
     }
+
+    TEST_METHOD(ForwardAcrossRows)
+    {
+        auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+
+        // The trailing whitespace of one row followed by the "A" at the start of the next one.
+        Search s(gci.renderData, L" A", Search::Direction::Forward, Search::Sensitivity::CaseSensitive);
+
+        VERIFY_IS_TRUE(s.FindNext());
+        VERIFY_ARE_EQUAL(til::point(79, 0), s._coordSelStart);
+        VERIFY_ARE_EQUAL(til::point(0, 1), s._coordSelEnd);
+    }
+
+    TEST_METHOD(ForwardSkipsPartialGlyphs)
+    {
+        auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+        auto& textBuffer = gci.GetActiveOutputBuffer().GetTextBuffer();
+
+        // "e" followed by a combining acute accent is a single glyph, which mustn't be matched by "e" alone.
+        auto& row = textBuffer.GetRowByOffset(0);
+        row.ReplaceCharacters(0, 1, L"e\u0301");
+        row.ReplaceCharacters(1, 1, L" ");
+        row.ReplaceCharacters(2, 1, L"e");
+
+        Search s(gci.renderData, L"e", Search::Direction::Forward, Search::Sensitivity::CaseSensitive);
+
+        VERIFY_IS_TRUE(s.FindNext());
+        VERIFY_ARE_EQUAL(til::point(2, 0), s._coordSelStart);
+        VERIFY_ARE_EQUAL(til::point(2, 0), s._coordSelEnd);
+    }
+
+    TEST_METHOD(ForwardRegularExpression)
+    {
+        auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+
+        // "." matches the wide glyph in between "B" and "C".
+        Search s(gci.renderData, L"b.c", Search::Direction::Forward, Search::Sensitivity::CaseInsensitive, Search::Mode::RegularExpression);
+        for (til::CoordType y = 0; y < 4; ++y)
+        {
+            VERIFY_IS_TRUE(s.FindNext());
+            VERIFY_ARE_EQUAL(til::point(1, y), s._coordSelStart);
+            VERIFY_ARE_EQUAL(til::point(4, y), s._coordSelEnd);
+        }
+        VERIFY_IS_FALSE(s.FindNext());
+    }
+
+    TEST_METHOD(RegularExpressionMatchesWrappedLines)
+    {
+        auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+        const auto& textBuffer = gci.GetActiveOutputBuffer().GetTextBuffer();
+
+        Log::Comment(L"Row 1 wraps into row 2, so they form a single line and only the latter ends with \"E\".");
+        SearchRegex lineStart{ L"^A", false };
+        auto matches = Search::FindAll(textBuffer, lineStart, 0, til::CoordTypeMax);
+        VERIFY_ARE_EQUAL(size_t{ 3 }, matches.size());
+        VERIFY_ARE_EQUAL(til::point(0, 0), matches[0].start);
+        VERIFY_ARE_EQUAL(til::point(0, 1), matches[1].start);
+        VERIFY_ARE_EQUAL(til::point(0, 3), matches[2].start);
+
+        SearchRegex lineEnd{ L"E$", false };
+        matches = Search::FindAll(textBuffer, lineEnd, 0, til::CoordTypeMax);
+        VERIFY_ARE_EQUAL(size_t{ 2 }, matches.size());
+        VERIFY_ARE_EQUAL(til::point(8, 0), matches[0].start);
+        VERIFY_ARE_EQUAL(til::point(8, 2), matches[1].start);
+
+        Log::Comment(L"Matches continue into the rows a row wraps into, but not past the end of the line.");
+        SearchRegex across{ L"E +A", false };
+        matches = Search::FindAll(textBuffer, across, 0, til::CoordTypeMax);
+        VERIFY_ARE_EQUAL(size_t{ 1 }, matches.size());
+        VERIFY_ARE_EQUAL(til::point(8, 1), matches[0].start);
+        VERIFY_ARE_EQUAL(til::point(0, 2), matches[0].end);
+
+        Log::Comment(L"Only the matches that start in the given rows are returned, even if the line begins above them.");
+        matches = Search::FindAll(textBuffer, lineStart, 2, 4);
+        VERIFY_ARE_EQUAL(size_t{ 1 }, matches.size());
+        VERIFY_ARE_EQUAL(til::point(0, 3), matches[0].start);
+
+        SearchIndex index{ L"[a-c]+", Search::Sensitivity::CaseInsensitive, Search::Mode::RegularExpression };
+        VERIFY_IS_TRUE(index.Update(gci.GetActiveOutputBuffer().GetTextBuffer(), til::CoordTypeMax));
+        VERIFY_ARE_EQUAL(size_t{ 8 }, index.Matches().size());
+        VERIFY_ARE_EQUAL(til::point(0, 0), index.Matches()[0].start);
+        VERIFY_ARE_EQUAL(til::point(1, 0), index.Matches()[0].end);
+        VERIFY_IS_FALSE(index.IsFor(L"[a-c]+", Search::Sensitivity::CaseInsensitive));
+
+        Log::Comment(L"Invalid patterns are rejected upfront.");
+        VERIFY_THROWS(SearchRegex(L"(A", false), wil::ResultException);
+        VERIFY_THROWS(SearchRegex(L"A{2,1}", false), wil::ResultException);
+    }
+
+    TEST_METHOD(SearchIndexUpdatesIncrementally)
+    {
+        auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+        auto& textBuffer = gci.GetActiveOutputBuffer().GetTextBuffer();
+        const auto width = textBuffer.GetSize().Width();
+
+        SearchIndex index{ L"AB", Search::Sensitivity::CaseSensitive };
+        VERIFY_IS_TRUE(index.Update(textBuffer, til::CoordTypeMax));
+        VERIFY_ARE_EQUAL(size_t{ 4 }, index.Matches().size());
+        VERIFY_ARE_EQUAL(til::point(0, 3), index.Matches().back().start);
+        VERIFY_ARE_EQUAL(til::point(1, 3), index.Matches().back().end);
+
+        Log::Comment(L"Only the modified row (and the one above it) is scanned again, one row at a time.");
+        auto& row = textBuffer.GetRowByOffset(10);
+        row.ReplaceCharacters(5, 1, L"A");
+        row.ReplaceCharacters(6, 1, L"B");
+        textBuffer.TriggerRedraw(Viewport::FromDimensions({ 0, 10 }, { width, 1 }));
+        VERIFY_IS_FALSE(index.Update(textBuffer, 1));
+        VERIFY_IS_TRUE(index.Update(textBuffer, 1));
+        VERIFY_ARE_EQUAL(size_t{ 5 }, index.Matches().size());
+        VERIFY_ARE_EQUAL(til::point(5, 10), index.Matches().back().start);
+
+        Log::Comment(L"Rows that scroll out of the buffer take their matches with them.");
+        textBuffer.IncrementCircularBuffer();
+        VERIFY_IS_TRUE(index.Update(textBuffer, til::CoordTypeMax));
+        VERIFY_ARE_EQUAL(size_t{ 4 }, index.Matches().size());
+        VERIFY_ARE_EQUAL(til::point(0, 0), index.Matches().front().start);
+        VERIFY_ARE_EQUAL(til::point(5, 9), index.Matches().back().start);
+
+        Log::Comment(L"Stepping through the matches wraps around at either end.");
+        VERIFY_ARE_EQUAL(til::point(0, 0), index.Step(std::nullopt, true)->start);
+        VERIFY_ARE_EQUAL(til::point(0, 1), index.Step(til::point(0, 0), true)->start);
+        VERIFY_ARE_EQUAL(til::point(0, 2), index.Step(til::point(3, 5), false)->start);
+        VERIFY_ARE_EQUAL(til::point(0, 0), index.Step(til::point(5, 9), true)->start);
+        VERIFY_ARE_EQUAL(til::point(5, 9), index.Step(til::point(0, 0), false)->start);
+    }
+
+    TEST_METHOD(SearchThroughput)
+    {
+        auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+        auto& textBuffer = gci.GetActiveOutputBuffer().GetTextBuffer();
+        const auto size = textBuffer.GetSize();
+
+        // Fill the entire buffer with text that almost, but not quite, contains the needle,
+        // which is the worst case for filtering candidates by their first and last character.
+        const auto line = fmt::format(L"{:<{}}", L"The quick brown fox jumps over the lazy dog. Needle-ish text: NEEDLxE", size.Width());
+        for (til::CoordType y = 0; y < size.Height(); ++y)
+        {
+            RowWriteState state{
+                .text = line,
+                .columnLimit = size.Width(),
+            };
+            textBuffer.GetRowByOffset(y).ReplaceText(state);
+        }
+
+        static constexpr auto iterations = 200;
+        const auto start = std::chrono::steady_clock::now();
+
+        for (auto i = 0; i < iterations; ++i)
+        {
+            Search s(gci.renderData, L"needle", Search::Direction::Forward, Search::Sensitivity::CaseInsensitive);
+            VERIFY_IS_FALSE(s.FindNext());
+        }
+
+        const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        const auto lines = static_cast<double>(size.Height()) * iterations;
+        Log::Comment(NoThrowString().Format(L"Searched %.0f lines in %.3fs (%.0f lines/s)", lines, elapsed, lines / elapsed));
+
+        // A pattern that takes exponential time with a backtracking engine like std::wregex.
+        const auto regexStart = std::chrono::steady_clock::now();
+        SearchRegex regex{ L"(\\w+\\s?)+NEEDLE", true };
+        VERIFY_ARE_EQUAL(size_t{ 0 }, Search::FindAll(textBuffer, regex, 0, size.Height()).size());
+        const auto regexElapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - regexStart).count();
+        Log::Comment(NoThrowString().Format(L"Searched %d lines for a regular expression in %.3fs", size.Height(), regexElapsed));
+    }
 };
@@ -134,10 +134,12 @@ class TextBufferTests
 
     TEST_METHOD(TestBackspaceStrings);
     TEST_METHOD(TestBackspaceStringsAPI);
+    TEST_METHOD(TestWriteCharsLegacyAsciiRuns);
 
     TEST_METHOD(TestRepeatCharacter);
 
     TEST_METHOD(ResizeTraditional);
+    TEST_METHOD(ResizeTraditionalHeightInPlace);
 
     TEST_METHOD(ResizeTraditionalRotationPreservesHighUnicode);
     TEST_METHOD(ScrollBufferRotationPreservesHighUnicode);
@@ -148,6 +150,16 @@ class TextBufferTests
     TEST_METHOD(TestBurrito);
     TEST_METHOD(TestOverwriteChars);
     TEST_METHOD(TestRowReplaceText);
+    TEST_METHOD(TestLazyRowMaterialization);
+    TEST_METHOD(TestColdRowCompaction);
+    TEST_METHOD(TestScrollbackSpill);
+    TEST_METHOD(TestTrimMemory);
+    TEST_METHOD(TestRowOverflowPool);
+    TEST_METHOD(TestGetPatterns);
+    TEST_METHOD(TestRowRevisions);
+    TEST_METHOD(TestFillAndCopyRect);
+    TEST_METHOD(TestWriteCharInfos);
+    TEST_METHOD(TestScrollRowsInCircularStorage);
 
     TEST_METHOD(TestAppendRTFText);
 
@@ -161,6 +173,11 @@ class TextBufferTests
 
     TEST_METHOD(HyperlinkTrim);
     TEST_METHOD(NoHyperlinkTrim);
+    TEST_METHOD(HyperlinkUriInterning);
+
+    TEST_METHOD(RecycleBuffer);
+
+    TEST_METHOD(ClearScrollbackDecommitsRows);
 };
 
 void TextBufferTests::TestBufferCreate()
@@ -1612,6 +1629,34 @@ void TextBufferTests::TestBackspaceStringsAPI()
     VERIFY_ARE_EQUAL(cursor.GetPosition().y, y0);
 }
 
+void TextBufferTests::TestWriteCharsLegacyAsciiRuns()
+{
+    auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+    auto& si = gci.GetActiveOutputBuffer().GetActiveBuffer();
+    const auto& tbi = si.GetTextBuffer();
+    auto& cursor = si.GetTextBuffer().GetCursor();
+    const auto width = tbi.GetSize().Width();
+
+    WI_ClearFlag(si.OutputMode, ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+    WI_SetFlag(si.OutputMode, ENABLE_PROCESSED_OUTPUT);
+    WI_SetFlag(si.OutputMode, ENABLE_WRAP_AT_EOL_OUTPUT);
+
+    cursor.SetXPosition(0);
+    cursor.SetYPosition(0);
+
+    Log::Comment(L"Printable ASCII runs are interrupted by a tab, wrap at the end of the row and are followed by non-ASCII text.");
+    const std::wstring input = L"abc\tx" + std::wstring(width, L'y') + L"\u00e9z";
+    auto cb = input.size() * sizeof(wchar_t);
+    VERIFY_NT_SUCCESS(WriteCharsLegacy(si, input.data(), input.data(), input.data(), &cb, nullptr, 0, 0, nullptr));
+    VERIFY_ARE_EQUAL(input.size() * sizeof(wchar_t), cb);
+
+    const auto expected0 = L"abc     x" + std::wstring(width - 9, L'y');
+    const auto expected1 = std::wstring(9, L'y') + L"\u00e9z";
+    VERIFY_ARE_EQUAL(std::wstring_view{ expected0 }, tbi.GetRowByOffset(0).GetText());
+    VERIFY_ARE_EQUAL(std::wstring_view{ expected1 }, tbi.GetRowByOffset(1).GetText().substr(0, expected1.size()));
+    VERIFY_ARE_EQUAL(til::point(11, 1), cursor.GetPosition());
+}
+
 void TextBufferTests::TestRepeatCharacter()
 {
     auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
@@ -2128,34 +2173,555 @@ void TextBufferTests::TestRowReplaceText()
 #undef complex
 }
 
+void TextBufferTests::TestLazyRowMaterialization()
+{
+    static constexpr til::size bufferSize{ 120, 9001 };
+    static constexpr UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    TextBuffer buffer{ bufferSize, attr, cursorSize, false, _renderer };
+
+    const auto initial = buffer.GetMemoryUsage();
+    Log::Comment(NoThrowString().Format(L"reserved: %zu, committed: %zu", initial.reservedBytes, initial.committedBytes));
+    VERIFY_IS_GREATER_THAN_OR_EQUAL(initial.reservedBytes, size_t{ 120 * 9001 * sizeof(wchar_t) });
+    VERIFY_ARE_EQUAL(size_t{ 4096 }, initial.committedBytes, L"Only the blank row template should be committed.");
+
+    Log::Comment(L"Reading a row doesn't materialize it.");
+    auto& row = buffer.GetRowByOffset(5000);
+    VERIFY_IS_FALSE(row.IsMaterialized());
+    VERIFY_ARE_EQUAL(std::wstring(120, L' '), row.GetText());
+    VERIFY_IS_FALSE(row.ContainsText());
+    row.SetAttrToEnd(0, TextAttribute{ 0x1f });
+    row.Reset(attr);
+    VERIFY_IS_FALSE(row.IsMaterialized());
+    VERIFY_ARE_EQUAL(initial.committedBytes, buffer.GetMemoryUsage().committedBytes);
+
+    Log::Comment(L"Writing to a row materializes only that row.");
+    row.ReplaceCharacters(3, 1, L"a");
+    VERIFY_IS_TRUE(row.IsMaterialized());
+    VERIFY_IS_FALSE(buffer.GetRowByOffset(4999).IsMaterialized());
+    VERIFY_IS_FALSE(buffer.GetRowByOffset(5001).IsMaterialized());
+    VERIFY_ARE_EQUAL(L"   a", row.GetText().substr(0, 4));
+    VERIFY_ARE_EQUAL(std::wstring(120, L' '), buffer.GetRowByOffset(5001).GetText());
+
+    const auto written = buffer.GetMemoryUsage();
+    VERIFY_ARE_EQUAL(initial.reservedBytes, written.reservedBytes);
+    VERIFY_IS_GREATER_THAN(written.committedBytes, initial.committedBytes);
+    VERIFY_IS_LESS_THAN_OR_EQUAL(written.committedBytes, initial.committedBytes + 2 * 4096);
+
+    Log::Comment(L"Resizing only materializes the rows that were written to.");
+    VERIFY_SUCCEEDED(buffer.ResizeTraditional({ 100, 9001 }));
+    VERIFY_IS_TRUE(buffer.GetRowByOffset(5000).IsMaterialized());
+    VERIFY_IS_FALSE(buffer.GetRowByOffset(0).IsMaterialized());
+    VERIFY_ARE_EQUAL(L"   a", buffer.GetRowByOffset(5000).GetText().substr(0, 4));
+    VERIFY_IS_LESS_THAN_OR_EQUAL(buffer.GetMemoryUsage().committedBytes, initial.committedBytes + 2 * 4096);
+}
+
+void TextBufferTests::TestColdRowCompaction()
+{
+    static constexpr til::size bufferSize{ 40, 1000 };
+    static constexpr UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    TextBuffer buffer{ bufferSize, attr, cursorSize, false, _renderer };
+
+    const std::wstring_view texts[]{
+        L"Hello, World!",
+        L"wide \u732B and \U0001F41B",
+        L"trailing whitespace    ",
+        std::wstring_view{},
+    };
+    std::vector<std::wstring> expected;
+
+    for (til::CoordType y = 0; y < 500; ++y)
+    {
+        auto& row = buffer.GetRowByOffset(y);
+        RowWriteState state{
+            .text = til::at(texts, y % std::size(texts)),
+            .columnLimit = bufferSize.width,
+        };
+        row.ReplaceText(state);
+        row.ReplaceAttributes(0, 5, TextAttribute{ 0x1f });
+        row.SetWrapForced(y % 2 == 0);
+        expected.emplace_back(row.GetText());
+    }
+
+    const auto before = buffer.GetMemoryUsage();
+    buffer._compactColdRows(499);
+    const auto after = buffer.GetMemoryUsage();
+    Log::Comment(NoThrowString().Format(L"committed: %zu -> %zu, cold: %zu", before.committedBytes, after.committedBytes, after.coldBytes));
+
+    // Even writing an empty string materializes a row, so all of the rows above 499 get frozen.
+    VERIFY_ARE_EQUAL(499, after.coldRows);
+    VERIFY_IS_LESS_THAN(after.committedBytes, before.committedBytes);
+    VERIFY_IS_LESS_THAN(after.coldBytes, before.committedBytes - after.committedBytes);
+    VERIFY_IS_FALSE(buffer._peekRowByOffset(499).IsCold());
+
+    Log::Comment(L"Attributes and flags survive without thawing the row.");
+    VERIFY_ARE_EQUAL(TextAttribute{ 0x1f }, buffer._peekRowByOffset(42).GetAttrByColumn(0));
+    VERIFY_IS_TRUE(buffer._peekRowByOffset(42).WasWrapForced());
+    VERIFY_IS_TRUE(buffer._peekRowByOffset(42).IsCold());
+
+    Log::Comment(L"Accessing the rows thaws them.");
+    for (til::CoordType y = 0; y < 500; ++y)
+    {
+        const auto& row = std::as_const(buffer).GetRowByOffset(y);
+        VERIFY_IS_FALSE(row.IsCold());
+        VERIFY_ARE_EQUAL(til::at(expected, y), row.GetText());
+        VERIFY_ARE_EQUAL(y % 2 == 0, row.WasWrapForced());
+    }
+    VERIFY_ARE_EQUAL(0, buffer.GetMemoryUsage().coldRows);
+
+    Log::Comment(L"Writing into a frozen row thaws it first.");
+    buffer._compactColdRows(10);
+    buffer._peekRowByOffset(1).ReplaceCharacters(0, 1, L"W");
+    VERIFY_ARE_EQUAL(L"Wide ", buffer.GetRowByOffset(1).GetText().substr(0, 5));
+    VERIFY_ARE_EQUAL(til::at(expected, 1).substr(1), buffer.GetRowByOffset(1).GetText().substr(1));
+
+    Log::Comment(L"Resetting a frozen row discards its contents.");
+    buffer._peekRowByOffset(2).Reset(attr);
+    VERIFY_IS_FALSE(buffer._peekRowByOffset(2).IsCold());
+    VERIFY_ARE_EQUAL(std::wstring(40, L' '), buffer.GetRowByOffset(2).GetText());
+}
+
+void TextBufferTests::TestTrimMemory()
+{
+    static constexpr til::size bufferSize{ 40, 1000 };
+    static constexpr UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    TextBuffer buffer{ bufferSize, attr, cursorSize, false, _renderer };
+
+    for (til::CoordType y = 0; y < 600; ++y)
+    {
+        auto& row = buffer.GetRowByOffset(y);
+        RowWriteState state{
+            .text = L"https://example.com",
+            .columnLimit = bufferSize.width,
+        };
+        row.ReplaceText(state);
+        row.ReplaceAttributes(0, 5, TextAttribute{ 0x1f });
+    }
+    buffer.GetCursor().SetPosition({ 0, 599 });
+
+    const auto before = buffer.GetMemoryUsage();
+    VERIFY_ARE_EQUAL(0, before.coldRows);
+    VERIFY_IS_GREATER_THAN(before.attributeBytes, 0u);
+
+    buffer.TrimMemory();
+
+    const auto after = buffer.GetMemoryUsage();
+    Log::Comment(NoThrowString().Format(L"committed: %zu -> %zu, cold: %zu", before.committedBytes, after.committedBytes, after.coldBytes));
+    VERIFY_ARE_EQUAL(599 - 256, after.coldRows);
+    VERIFY_IS_LESS_THAN(after.committedBytes, before.committedBytes);
+
+    Log::Comment(L"The contents are still there.");
+    VERIFY_ARE_EQUAL(L"https://example.com", buffer.GetRowByOffset(0).GetText().substr(0, 19));
+    VERIFY_ARE_EQUAL(TextAttribute{ 0x1f }, buffer.GetRowByOffset(0).GetAttrByColumn(0));
+}
+
+void TextBufferTests::TestRowOverflowPool()
+{
+    static constexpr til::size bufferSize{ 40, 100 };
+    static constexpr UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    TextBuffer buffer{ bufferSize, attr, cursorSize, false, _renderer };
+
+    VERIFY_ARE_EQUAL(0u, buffer.GetMemoryUsage().overflowBytes);
+
+    Log::Comment(L"Rows with more characters than columns store their text in the pool.");
+    std::wstring text;
+    for (til::CoordType x = 0; x < bufferSize.width; ++x)
+    {
+        text.append(L"e\u0301");
+    }
+    for (til::CoordType y = 0; y < 50; ++y)
+    {
+        RowWriteState state{
+            .text = text,
+            .columnLimit = bufferSize.width,
+        };
+        buffer.GetRowByOffset(y).ReplaceText(state);
+    }
+
+    const auto usage = buffer.GetMemoryUsage();
+    Log::Comment(NoThrowString().Format(L"overflow: %zu", usage.overflowBytes));
+    VERIFY_IS_GREATER_THAN(usage.overflowBytes, 0u);
+    VERIFY_IS_LESS_THAN(usage.overflowBytes, 50u * 4096u);
+    VERIFY_ARE_EQUAL(text, buffer.GetRowByOffset(49).GetText());
+
+    Log::Comment(L"Resetting a single row keeps the slabs for reuse.");
+    buffer.GetRowByOffset(0).Reset(attr);
+    VERIFY_ARE_EQUAL(usage.overflowBytes, buffer.GetMemoryUsage().overflowBytes);
+
+    Log::Comment(L"Resetting the buffer frees them.");
+    buffer.Reset();
+    VERIFY_ARE_EQUAL(0u, buffer.GetMemoryUsage().overflowBytes);
+}
+
+void TextBufferTests::TestScrollbackSpill()
+{
+    static constexpr til::size bufferSize{ 40, 300 };
+    static constexpr UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    TextBuffer buffer{ bufferSize, attr, cursorSize, false, _renderer };
+    buffer.EnableScrollbackSpill(true);
+
+    std::vector<std::wstring> expected;
+    for (til::CoordType y = 0; y < 200; ++y)
+    {
+        auto& row = buffer.GetRowByOffset(y);
+        const auto text = fmt::format(L"row {} \u732B", y);
+        RowWriteState state{
+            .text = text,
+            .columnLimit = bufferSize.width,
+        };
+        row.ReplaceText(state);
+        expected.emplace_back(row.GetText());
+    }
+
+    buffer._compactColdRows(150);
+    buffer._spillColdRows(100);
+
+    auto usage = buffer.GetMemoryUsage();
+    VERIFY_ARE_EQUAL(50, usage.coldRows);
+    VERIFY_ARE_EQUAL(100, usage.spilledRows);
+    VERIFY_IS_GREATER_THAN(usage.spilledBytes, size_t{ 0 });
+    VERIFY_IS_FALSE(buffer._peekRowByOffset(99).IsCold());
+    VERIFY_IS_FALSE(buffer._peekRowByOffset(99).IsMaterialized());
+
+    Log::Comment(L"Accessing spilled rows reads them back.");
+    for (til::CoordType y = 0; y < 200; y += 7)
+    {
+        VERIFY_ARE_EQUAL(til::at(expected, y), buffer.GetRowByOffset(y).GetText());
+    }
+    VERIFY_ARE_EQUAL(100 - 15, buffer.GetMemoryUsage().spilledRows);
+
+    Log::Comment(L"Recycling a spilled row discards its record.");
+    VERIFY_IS_TRUE(buffer.IncrementCircularBuffer());
+    VERIFY_ARE_EQUAL(100 - 15, buffer.GetMemoryUsage().spilledRows, L"Row 0 was read back already.");
+    VERIFY_IS_TRUE(buffer.IncrementCircularBuffer());
+    VERIFY_ARE_EQUAL(100 - 15 - 1, buffer.GetMemoryUsage().spilledRows);
+
+    Log::Comment(L"Disabling the spill reads everything back into memory.");
+    buffer.EnableScrollbackSpill(false);
+    usage = buffer.GetMemoryUsage();
+    VERIFY_ARE_EQUAL(0, usage.spilledRows);
+    VERIFY_ARE_EQUAL(size_t{ 0 }, usage.spilledBytes);
+    VERIFY_ARE_EQUAL(til::at(expected, 50), buffer.GetRowByOffset(48).GetText());
+}
+
+void TextBufferTests::TestGetPatterns()
+{
+    static constexpr til::size bufferSize{ 40, 10 };
+    static constexpr UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    TextBuffer buffer{ bufferSize, attr, cursorSize, false, _renderer };
+    const auto id = buffer.AddPatternRecognizer(linkPattern);
+
+    const auto write = [&](til::CoordType y, const std::wstring& text) {
+        RowWriteState state{
+            .text = text,
+            .columnLimit = bufferSize.width,
+        };
+        buffer.GetRowByOffset(y).ReplaceText(state);
+    };
+    write(0, L"https://ex.com/a, ftp://x. xhttp://no");
+    // This URL ends in the last column and continues in the next row.
+    write(1, std::wstring(33, L' ') + L"http://");
+    write(2, L"wrap.example ");
+    write(3, L"\u732B file:///tmp");
+
+    const auto getPatterns = [&]() {
+        auto intervals = buffer.GetPatterns(0, 3).findOverlapping({ 0, 0 }, { bufferSize.width, 3 });
+        std::sort(intervals.begin(), intervals.end(), [](const auto& a, const auto& b) { return a.start < b.start; });
+        return intervals;
+    };
+
+    auto intervals = getPatterns();
+    VERIFY_ARE_EQUAL(size_t{ 4 }, intervals.size());
+    VERIFY_ARE_EQUAL(til::point(0, 0), intervals[0].start);
+    VERIFY_ARE_EQUAL(til::point(16, 0), intervals[0].stop);
+    VERIFY_ARE_EQUAL(til::point(18, 0), intervals[1].start);
+    VERIFY_ARE_EQUAL(til::point(25, 0), intervals[1].stop);
+    VERIFY_ARE_EQUAL(til::point(33, 1), intervals[2].start);
+    VERIFY_ARE_EQUAL(til::point(12, 2), intervals[2].stop);
+    VERIFY_ARE_EQUAL(til::point(3, 3), intervals[3].start);
+    VERIFY_ARE_EQUAL(til::point(14, 3), intervals[3].stop);
+    for (const auto& interval : intervals)
+    {
+        VERIFY_ARE_EQUAL(id, interval.value);
+    }
+
+    Log::Comment(L"Unmodified rows are served from the cache.");
+    const auto cachedRuns = buffer._urlMatchCache.size();
+    VERIFY_ARE_EQUAL(size_t{ 4 }, getPatterns().size());
+    VERIFY_ARE_EQUAL(cachedRuns, buffer._urlMatchCache.size());
+
+    Log::Comment(L"Modified rows are matched again.");
+    write(0, L"nothing to see here");
+    intervals = getPatterns();
+    VERIFY_ARE_EQUAL(size_t{ 3 }, intervals.size());
+    VERIFY_ARE_EQUAL(til::point(33, 1), intervals[0].start);
+    VERIFY_ARE_EQUAL(cachedRuns + 1, buffer._urlMatchCache.size());
+}
+
+void TextBufferTests::ResizeTraditionalHeightInPlace()
+{
+    static constexpr til::size bufferSize{ 5, 5 };
+    const TextAttribute attr{ 0x7f };
+    TextBuffer buffer{ bufferSize, attr, 12, false, _renderer };
+
+    for (til::CoordType y = 0; y < bufferSize.height; ++y)
+    {
+        const auto ch = gsl::narrow_cast<wchar_t>(L'A' + y);
+        buffer.Write(OutputCellIterator{ ch, attr, bufferSize.width }, { 0, y });
+    }
+
+    const auto rowText = [&](const til::CoordType y) {
+        return std::wstring{ buffer.GetRowByOffset(y).GetText() };
+    };
+
+    Log::Comment(L"Shrinking the height keeps the rows up to the cursor in place.");
+    buffer.GetCursor().SetPosition({ 0, 4 });
+    const auto idOfC = buffer.GetRowByOffset(2).GetId();
+    VERIFY_SUCCEEDED(buffer.ResizeTraditional({ bufferSize.width, 3 }));
+    VERIFY_ARE_EQUAL(3, buffer.GetSize().Height());
+    VERIFY_ARE_EQUAL(L"CCCCC", rowText(0));
+    VERIFY_ARE_EQUAL(L"DDDDD", rowText(1));
+    VERIFY_ARE_EQUAL(L"EEEEE", rowText(2));
+    VERIFY_ARE_EQUAL(idOfC, buffer.GetRowByOffset(0).GetId());
+
+    Log::Comment(L"Growing the height again reuses the spare rows, which are blank.");
+    buffer.GetCursor().SetPosition({ 0, 2 });
+    VERIFY_SUCCEEDED(buffer.ResizeTraditional(bufferSize));
+    VERIFY_ARE_EQUAL(bufferSize, buffer.GetSize().Dimensions());
+    VERIFY_ARE_EQUAL(L"CCCCC", rowText(0));
+    VERIFY_ARE_EQUAL(L"EEEEE", rowText(2));
+    VERIFY_ARE_EQUAL(L"     ", rowText(3));
+    VERIFY_ARE_EQUAL(L"     ", rowText(4));
+    VERIFY_ARE_EQUAL(idOfC, buffer.GetRowByOffset(0).GetId());
+
+    Log::Comment(L"Growing past the allocated rows falls back to reallocating the buffer.");
+    VERIFY_SUCCEEDED(buffer.ResizeTraditional({ bufferSize.width, 8 }));
+    VERIFY_ARE_EQUAL(8, buffer.GetSize().Height());
+    VERIFY_ARE_EQUAL(L"CCCCC", rowText(0));
+    VERIFY_ARE_EQUAL(L"EEEEE", rowText(2));
+    VERIFY_ARE_EQUAL(L"     ", rowText(7));
+}
+
+void TextBufferTests::TestRowRevisions()
+{
+    static constexpr til::size bufferSize{ 10, 5 };
+    static constexpr UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    TextBuffer buffer{ bufferSize, attr, cursorSize, false, _renderer };
+
+    auto& row = buffer.GetRowByOffset(0);
+    auto revision = row.GetRevision();
+    const auto verifyBumped = [&](const wchar_t* what) {
+        Log::Comment(what);
+        VERIFY_IS_GREATER_THAN(row.GetRevision(), revision);
+        revision = row.GetRevision();
+    };
+
+    RowWriteState state{
+        .text = L"abc",
+        .columnLimit = bufferSize.width,
+    };
+    row.ReplaceText(state);
+    verifyBumped(L"ReplaceText");
+    row.ReplaceAttributes(0, 2, TextAttribute{ 0x1f });
+    verifyBumped(L"ReplaceAttributes");
+    row.ClearCell(1);
+    verifyBumped(L"ClearCell");
+    const auto attributes = std::as_const(row).Attributes();
+    revision = row.GetRevision();
+    row.TransferAttributes(attributes, bufferSize.width);
+    verifyBumped(L"TransferAttributes");
+    row.Reset(attr);
+    verifyBumped(L"Reset");
+
+    Log::Comment(L"Reading a row doesn't change its revision.");
+    std::ignore = row.GetText();
+    std::ignore = row.GetAttrByColumn(0);
+    std::ignore = std::as_const(row).Attributes();
+    VERIFY_ARE_EQUAL(revision, row.GetRevision());
+
+    Log::Comment(L"Row ids move along with the circular buffer.");
+    std::vector<uint64_t> ids;
+    for (til::CoordType y = 0; y < bufferSize.height; ++y)
+    {
+        ids.emplace_back(buffer.GetRowByOffset(y).GetId());
+    }
+    VERIFY_IS_TRUE(std::adjacent_find(ids.begin(), ids.end()) == ids.end());
+
+    buffer.IncrementCircularBuffer();
+    for (til::CoordType y = 0; y < bufferSize.height - 1; ++y)
+    {
+        VERIFY_ARE_EQUAL(til::at(ids, y + 1), buffer.GetRowByOffset(y).GetId());
+    }
+    const auto recycledId = buffer.GetRowByOffset(bufferSize.height - 1).GetId();
+    VERIFY_IS_GREATER_THAN(recycledId, *std::max_element(ids.begin(), ids.end()));
+}
+
+void TextBufferTests::TestFillAndCopyRect()
+{
+    static constexpr til::size bufferSize{ 10, 4 };
+    static constexpr UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    const TextAttribute fillAttr{ 0x1f };
+    TextBuffer buffer{ bufferSize, attr, cursorSize, false, _renderer };
+
+    Log::Comment(L"FillRect() fills each row and its attributes.");
+    buffer.FillRect({ 2, 1, 6, 3 }, L"x", fillAttr);
+    VERIFY_ARE_EQUAL(L"          ", buffer.GetRowByOffset(0).GetText());
+    VERIFY_ARE_EQUAL(L"  xxxx    ", buffer.GetRowByOffset(1).GetText());
+    VERIFY_ARE_EQUAL(L"  xxxx    ", buffer.GetRowByOffset(2).GetText());
+    VERIFY_ARE_EQUAL(attr, buffer.GetRowByOffset(1).GetAttrByColumn(1));
+    VERIFY_ARE_EQUAL(fillAttr, buffer.GetRowByOffset(1).GetAttrByColumn(2));
+    VERIFY_ARE_EQUAL(fillAttr, buffer.GetRowByOffset(1).GetAttrByColumn(5));
+    VERIFY_ARE_EQUAL(attr, buffer.GetRowByOffset(1).GetAttrByColumn(6));
+
+    Log::Comment(L"A wide glyph that doesn't fit is replaced with whitespace.");
+    buffer.FillRect({ 0, 3, 5, 4 }, L"\x304b", fillAttr);
+    VERIFY_ARE_EQUAL(L"\x304b\x304b      ", buffer.GetRowByOffset(3).GetText());
+
+    Log::Comment(L"CopyRect() can move a row onto itself, without wide glyphs erasing themselves.");
+    buffer.CopyRect({ 0, 3, 9, 4 }, { 1, 3 });
+    VERIFY_ARE_EQUAL(L" \x304b\x304b     ", buffer.GetRowByOffset(3).GetText());
+    VERIFY_ARE_EQUAL(DbcsAttribute::Leading, buffer.GetRowByOffset(3).DbcsAttrAt(1));
+    VERIFY_ARE_EQUAL(fillAttr, buffer.GetRowByOffset(3).GetAttrByColumn(5));
+    buffer.CopyRect({ 1, 3, 10, 4 }, { 0, 3 });
+    VERIFY_ARE_EQUAL(L"\x304b\x304b      ", buffer.GetRowByOffset(3).GetText());
+
+    Log::Comment(L"Wide glyphs that are cut off by the edges of the source are replaced with whitespace.");
+    buffer.CopyRect({ 1, 3, 3, 4 }, { 6, 2 });
+    VERIFY_ARE_EQUAL(L"  xxxx    ", buffer.GetRowByOffset(2).GetText());
+
+    Log::Comment(L"Overlapping rows are copied in the right order.");
+    buffer.CopyRect({ 0, 1, 10, 3 }, { 0, 2 });
+    VERIFY_ARE_EQUAL(L"  xxxx    ", buffer.GetRowByOffset(1).GetText());
+    VERIFY_ARE_EQUAL(L"  xxxx    ", buffer.GetRowByOffset(2).GetText());
+    VERIFY_ARE_EQUAL(L"  xxxx    ", buffer.GetRowByOffset(3).GetText());
+    VERIFY_ARE_EQUAL(fillAttr, buffer.GetRowByOffset(3).GetAttrByColumn(2));
+    VERIFY_ARE_EQUAL(attr, buffer.GetRowByOffset(3).GetAttrByColumn(0));
+}
+
+void TextBufferTests::TestWriteCharInfos()
+{
+    static constexpr til::size bufferSize{ 10, 2 };
+    static constexpr UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    TextBuffer buffer{ bufferSize, attr, cursorSize, false, _renderer };
+
+    const auto ci = [](wchar_t ch, WORD attributes) {
+        CHAR_INFO info{};
+        info.Char.UnicodeChar = ch;
+        info.Attributes = attributes;
+        return info;
+    };
+
+    Log::Comment(L"Text and attribute runs are written as far as they fit into the row.");
+    const CHAR_INFO simple[]{
+        ci(L'a', 0x1f),
+        ci(L'b', 0x1f),
+        ci(L'\x304b', 0x2f | COMMON_LVB_LEADING_BYTE),
+        ci(L'\x304b', 0x2f | COMMON_LVB_TRAILING_BYTE),
+        ci(L'c', 0x3f),
+        ci(L'd', 0x3f),
+    };
+    VERIFY_IS_TRUE(buffer.WriteCharInfos({ 6, 0 }, simple));
+    const auto& row = buffer.GetRowByOffset(0);
+    VERIFY_ARE_EQUAL(L"      ab\x304b", row.GetText());
+    VERIFY_ARE_EQUAL(attr, row.GetAttrByColumn(5));
+    VERIFY_ARE_EQUAL(TextAttribute{ 0x1f }, row.GetAttrByColumn(7));
+    VERIFY_ARE_EQUAL(TextAttribute{ 0x2f }, row.GetAttrByColumn(8));
+    VERIFY_ARE_EQUAL(TextAttribute{ 0x2f }, row.GetAttrByColumn(9));
+    VERIFY_ARE_EQUAL(DbcsAttribute::Trailing, row.DbcsAttrAt(9));
+
+    Log::Comment(L"Overwriting half of a wide glyph replaces the other half with whitespace.");
+    VERIFY_IS_TRUE(buffer.WriteCharInfos({ 9, 0 }, std::span{ &simple[0], 1 }));
+    VERIFY_ARE_EQUAL(L"      ab a", row.GetText());
+
+    Log::Comment(L"Unpaired DBCS bytes are left to WriteCells().");
+    const CHAR_INFO unpaired[]{
+        ci(L'\x304b', 0x2f | COMMON_LVB_TRAILING_BYTE),
+        ci(L'e', 0x1f),
+    };
+    VERIFY_IS_FALSE(buffer.WriteCharInfos({ 0, 1 }, unpaired));
+    VERIFY_ARE_EQUAL(L"          ", buffer.GetRowByOffset(1).GetText());
+}
+
+void TextBufferTests::TestScrollRowsInCircularStorage()
+{
+    static constexpr til::size bufferSize{ 4, 6 };
+    static constexpr UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    TextBuffer buffer{ bufferSize, attr, cursorSize, false, _renderer };
+
+    // Rotate the storage, so that the scrolled rows wrap around its end.
+    for (auto i = 0; i < 4; ++i)
+    {
+        buffer.IncrementCircularBuffer();
+    }
+    const auto firstRow = buffer._firstRow;
+    VERIFY_ARE_EQUAL(4, firstRow);
+
+    const auto fill = [&]() {
+        for (til::CoordType y = 0; y < bufferSize.height; ++y)
+        {
+            buffer.GetRowByOffset(y).ReplaceCharacters(0, 1, std::wstring(1, static_cast<wchar_t>(L'a' + y)));
+        }
+    };
+    const auto verify = [&](const std::wstring_view expected) {
+        std::wstring actual;
+        for (til::CoordType y = 0; y < bufferSize.height; ++y)
+        {
+            actual.push_back(buffer.GetRowByOffset(y).GetText().front());
+        }
+        VERIFY_ARE_EQUAL(expected, actual);
+    };
+
+    Log::Comment(L"Scroll the rows 1 to 4 up by 2.");
+    fill();
+    buffer.ScrollRows(3, 2, -2);
+    verify(L"adebcf");
+
+    Log::Comment(L"Scroll the rows 1 to 4 down by 1.");
+    fill();
+    buffer.ScrollRows(1, 3, 1);
+    verify(L"aebcdf");
+
+    Log::Comment(L"Only the affected rows were moved.");
+    VERIFY_ARE_EQUAL(firstRow, buffer._firstRow);
+}
+
 void TextBufferTests::TestAppendRTFText()
 {
     {
-        std::ostringstream contentStream;
+        std::string contentStream;
         const auto ascii = L"This is some Ascii \\ {}";
         TextBuffer::_AppendRTFText(contentStream, ascii);
-        VERIFY_ARE_EQUAL("This is some Ascii \\\\ \\{\\}", contentStream.str());
+        VERIFY_ARE_EQUAL("This is some Ascii \\\\ \\{\\}", contentStream);
     }
     {
-        std::ostringstream contentStream;
+        std::string contentStream;
         // "Low code units: á é í ó ú ⮁ ⮂" in UTF-16
         const auto lowCodeUnits = L"Low code units: \x00E1 \x00E9 \x00ED \x00F3 \x00FA \x2B81 \x2B82";
         TextBuffer::_AppendRTFText(contentStream, lowCodeUnits);
-        VERIFY_ARE_EQUAL("Low code units: \\u225? \\u233? \\u237? \\u243? \\u250? \\u11137? \\u11138?", contentStream.str());
+        VERIFY_ARE_EQUAL("Low code units: \\u225? \\u233? \\u237? \\u243? \\u250? \\u11137? \\u11138?", contentStream);
     }
     {
-        std::ostringstream contentStream;
+        std::string contentStream;
         // "High code units: ꞵ ꞷ" in UTF-16
         const auto highCodeUnits = L"High code units: \xA7B5 \xA7B7";
         TextBuffer::_AppendRTFText(contentStream, highCodeUnits);
-        VERIFY_ARE_EQUAL("High code units: \\u-22603? \\u-22601?", contentStream.str());
+        VERIFY_ARE_EQUAL("High code units: \\u-22603? \\u-22601?", contentStream);
     }
     {
-        std::ostringstream contentStream;
+        std::string contentStream;
         // "Surrogates: 🍦 👾 👀" in UTF-16
         const auto surrogates = L"Surrogates: \xD83C\xDF66 \xD83D\xDC7E \xD83D\xDC40";
         TextBuffer::_AppendRTFText(contentStream, surrogates);
-        VERIFY_ARE_EQUAL("Surrogates: \\u-10180?\\u-8346? \\u-10179?\\u-9090? \\u-10179?\\u-9152?", contentStream.str());
+        VERIFY_ARE_EQUAL("Surrogates: \\u-10180?\\u-8346? \\u-10179?\\u-9090? \\u-10179?\\u-9152?", contentStream);
     }
 }
 
@@ -2604,6 +3170,12 @@ void TextBufferTests::GetText()
 
         // Verify expected output and actual output are the same
         VERIFY_ARE_EQUAL(expectedText, result);
+
+        TextBuffer::CopyRequest req;
+        req.selectionRects = textRects;
+        req.includeCRLF = includeCRLF;
+        req.trimTrailingWhitespace = trimTrailingWhitespace;
+        VERIFY_ARE_EQUAL(expectedText, _buffer->GetPlainText(req));
     }
     else
     {
@@ -2736,6 +3308,13 @@ void TextBufferTests::GetText()
 
         // Verify expected output and actual output are the same
         VERIFY_ARE_EQUAL(expectedText, result);
+
+        TextBuffer::CopyRequest req;
+        req.selectionRects = textRects;
+        req.includeCRLF = includeCRLF;
+        req.trimTrailingWhitespace = trimTrailingWhitespace;
+        req.formatWrappedRows = formatWrappedRows;
+        VERIFY_ARE_EQUAL(expectedText, _buffer->GetPlainText(req));
     }
 }
 
@@ -2769,8 +3348,12 @@ void TextBufferTests::HyperlinkTrim()
     _buffer->GetRowByOffset(otherPos.y).SetAttrToEnd(otherPos.x, newAttr);
     _buffer->AddHyperlinkToMap(otherUrl, otherId);
 
-    // Increment the circular buffer
-    _buffer->IncrementCircularBuffer();
+    // Increment the circular buffer. Obsolete references are pruned in batches,
+    // once half of the buffer has circled. Row 5 is still around at that point.
+    for (auto i = 0; i < _buffer->TotalRowCount() / 2; ++i)
+    {
+        _buffer->IncrementCircularBuffer();
+    }
 
     const auto finalCustomId = fmt::format(L"{}%{}", customId, til::hash(url));
     const auto finalOtherCustomId = fmt::format(L"{}%{}", otherCustomId, til::hash(otherUrl));
@@ -2781,7 +3364,7 @@ void TextBufferTests::HyperlinkTrim()
     VERIFY_ARE_EQUAL(_buffer->_hyperlinkCustomIdMap.find(finalCustomId), _buffer->_hyperlinkCustomIdMap.end());
 
     // The other hyperlink reference should not be deleted
-    VERIFY_ARE_EQUAL(_buffer->_hyperlinkMap[otherId], otherUrl);
+    VERIFY_ARE_EQUAL(_buffer->GetHyperlinkUriFromId(otherId), otherUrl);
     VERIFY_ARE_EQUAL(_buffer->_hyperlinkCustomIdMap[finalOtherCustomId], otherId);
 }
 
@@ -2810,8 +3393,11 @@ void TextBufferTests::NoHyperlinkTrim()
     const til::point otherPos{ 70, 5 };
     _buffer->GetRowByOffset(otherPos.y).SetAttrToEnd(otherPos.x, newAttr);
 
-    // Increment the circular buffer
-    _buffer->IncrementCircularBuffer();
+    // Increment the circular buffer until the obsolete references get pruned
+    for (auto i = 0; i < _buffer->TotalRowCount() / 2; ++i)
+    {
+        _buffer->IncrementCircularBuffer();
+    }
 
     const auto finalCustomId = fmt::format(L"{}%{}", customId, til::hash(url));
 
@@ -2819,3 +3405,135 @@ void TextBufferTests::NoHyperlinkTrim()
     VERIFY_ARE_EQUAL(_buffer->GetHyperlinkUriFromId(id), url);
     VERIFY_ARE_EQUAL(_buffer->_hyperlinkCustomIdMap[finalCustomId], id);
 }
+
+// This tests that re-adding a hyperlink with a custom id doesn't grow the URI storage
+// and that the storage gets compacted once its hyperlinks were pruned
+void TextBufferTests::HyperlinkUriInterning()
+{
+    const til::size bufferSize{ 80, 10 };
+    const UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    auto _buffer = std::make_unique<TextBuffer>(bufferSize, attr, cursorSize, false, _renderer);
+
+    static constexpr std::wstring_view url{ L"test.url" };
+    static constexpr std::wstring_view otherUrl{ L"other.url" };
+    static constexpr std::wstring_view customId{ L"CustomId" };
+
+    const auto id = _buffer->GetHyperlinkId(url, customId);
+    _buffer->AddHyperlinkToMap(url, id);
+    const auto size = _buffer->_hyperlinkUris.size();
+
+    VERIFY_ARE_EQUAL(id, _buffer->GetHyperlinkId(url, customId));
+    _buffer->AddHyperlinkToMap(url, id);
+    VERIFY_ARE_EQUAL(size, _buffer->_hyperlinkUris.size());
+    VERIFY_ARE_EQUAL(_buffer->GetHyperlinkUriFromId(id), url);
+
+    // Put the other hyperlink on the first row only and let it circle out of the buffer.
+    const auto otherId = _buffer->GetHyperlinkId(otherUrl, {});
+    _buffer->AddHyperlinkToMap(otherUrl, otherId);
+    TextAttribute newAttr{ 0x7f };
+    newAttr.SetHyperlinkId(otherId);
+    _buffer->GetRowByOffset(0).SetAttrToEnd(0, newAttr);
+    newAttr.SetHyperlinkId(id);
+    _buffer->GetRowByOffset(5).SetAttrToEnd(0, newAttr);
+
+    for (auto i = 0; i < _buffer->TotalRowCount() / 2; ++i)
+    {
+        _buffer->IncrementCircularBuffer();
+    }
+
+    VERIFY_ARE_EQUAL(_buffer->_hyperlinkMap.find(otherId), _buffer->_hyperlinkMap.end());
+    VERIFY_ARE_EQUAL(_buffer->GetHyperlinkUriFromId(id), url);
+    VERIFY_ARE_EQUAL(url.size(), _buffer->_hyperlinkUris.size());
+}
+
+// This tests that a recycled buffer is indistinguishable from a new one, apart from its memory
+void TextBufferTests::RecycleBuffer()
+{
+    const til::size bufferSize{ 80, 10 };
+    const UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    auto _buffer = std::make_unique<TextBuffer>(bufferSize, attr, cursorSize, false, _renderer);
+
+    const auto id = _buffer->GetHyperlinkId(L"test.url", {});
+    _buffer->AddHyperlinkToMap(L"test.url", id);
+    TextAttribute linkAttr{ 0x1f };
+    linkAttr.SetHyperlinkId(id);
+    _buffer->SetCurrentAttributes(linkAttr);
+    _buffer->Write(OutputCellIterator{ L"hello" });
+    _buffer->GetRowByOffset(1).SetLineRendition(LineRendition::DoubleWidth);
+    _buffer->IncrementCircularBuffer();
+    auto& cursor = _buffer->GetCursor();
+    cursor.SetPosition({ 5, 7 });
+    cursor.DelayEOLWrap();
+    cursor.SetIsVisible(false);
+    cursor.SetStyle(50, CursorType::FullBox);
+
+    const til::size newSize{ 100, 20 };
+    const TextAttribute newAttr{ 0x07 };
+    _buffer->Recycle(newSize, newAttr, 25);
+
+    VERIFY_ARE_EQUAL(newSize, _buffer->GetSize().Dimensions());
+    VERIFY_ARE_EQUAL(newAttr, _buffer->GetCurrentAttributes());
+    const std::wstring blank(newSize.width, L' ');
+    for (til::CoordType y = 0; y < newSize.height; ++y)
+    {
+        const auto& row = _buffer->GetRowByOffset(y);
+        VERIFY_ARE_EQUAL(std::wstring_view{ blank }, row.GetText());
+        VERIFY_ARE_EQUAL(newAttr, row.GetAttrByColumn(0));
+        VERIFY_IS_TRUE(row.GetLineRendition() == LineRendition::SingleWidth);
+    }
+    VERIFY_IS_TRUE(_buffer->_hyperlinkMap.empty());
+    VERIFY_IS_TRUE(_buffer->_hyperlinkUris.empty());
+
+    VERIFY_ARE_EQUAL(til::point{}, cursor.GetPosition());
+    VERIFY_IS_FALSE(cursor.IsDelayedEOLWrap());
+    VERIFY_IS_TRUE(cursor.IsVisible());
+    VERIFY_ARE_EQUAL(25ul, cursor.GetSize());
+    VERIFY_IS_TRUE(cursor.GetType() == CursorType::Legacy);
+}
+
+void TextBufferTests::ClearScrollbackDecommitsRows()
+{
+    static constexpr til::size bufferSize{ 120, 9001 };
+    static constexpr UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    TextBuffer buffer{ bufferSize, attr, cursorSize, false, _renderer };
+    const auto initial = buffer.GetMemoryUsage();
+
+    // Let the circular buffer wrap around, so that the rotation below has to wrap as well.
+    for (auto i = 0; i < 100; ++i)
+    {
+        buffer.IncrementCircularBuffer();
+    }
+    for (til::CoordType y = 0; y < bufferSize.height; ++y)
+    {
+        buffer.GetRowByOffset(y).ReplaceCharacters(0, 1, y % 2 ? L"a" : L"b");
+        buffer.GetRowByOffset(y).SetLineRendition(LineRendition::DoubleWidth);
+    }
+    VERIFY_IS_GREATER_THAN(buffer.GetMemoryUsage().committedBytes, initial.committedBytes + size_t{ 120 * 9000 * sizeof(wchar_t) });
+
+    // Keep the 30 rows at 8950 as the new viewport.
+    const TextAttribute fill{ 0x1f };
+    buffer.ClearScrollback(8950, 30, fill);
+
+    for (til::CoordType y = 0; y < 30; ++y)
+    {
+        const auto& row = buffer.GetRowByOffset(y);
+        VERIFY_ARE_EQUAL((8950 + y) % 2 ? L'a' : L'b', row.GetText()[0]);
+        VERIFY_IS_TRUE(row.GetLineRendition() == LineRendition::DoubleWidth);
+    }
+    for (til::CoordType y = 30; y < bufferSize.height; ++y)
+    {
+        const auto& row = buffer.GetRowByOffset(y);
+        VERIFY_IS_FALSE(row.IsMaterialized());
+        VERIFY_IS_FALSE(row.ContainsText());
+        VERIFY_ARE_EQUAL(fill, row.GetAttrByColumn(119));
+        VERIFY_IS_TRUE(row.GetLineRendition() == LineRendition::SingleWidth);
+    }
+    VERIFY_IS_LESS_THAN_OR_EQUAL(buffer.GetMemoryUsage().committedBytes, initial.committedBytes + size_t{ 31 * 4096 });
+
+    // The cleared rows work just like new ones.
+    buffer.GetRowByOffset(5000).ReplaceCharacters(3, 1, L"c");
+    VERIFY_ARE_EQUAL(L"   c ", buffer.GetRowByOffset(5000).GetText().substr(0, 5));
+}
@@ -69,6 +69,26 @@ class Utf8ToWideCharParserTests
         }
     }
 
+    TEST_METHOD(ConvertsEncodedReplacementCharacterTest)
+    {
+        Log::Comment(L"Testing that an encoded U+FFFD isn't mistaken for an invalid sequence");
+        auto parser = Utf8ToWideCharParser{ utf8CodePage };
+        // "0123456789abcdef" (long enough to take the vectorized path), U+FFFD, "!"
+        const unsigned char input[20] = { '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f', 0xef, 0xbf, 0xbd, '!' };
+        const std::wstring_view expected{ L"0123456789abcdef\xfffd!" };
+        unsigned int count = 20;
+        unsigned int consumed = 0;
+        unsigned int generated = 0;
+        unique_ptr<wchar_t[]> output{ nullptr };
+
+        VERIFY_SUCCEEDED(parser.Parse(input, count, consumed, output, generated));
+        VERIFY_ARE_EQUAL(consumed, (unsigned int)20);
+        VERIFY_ARE_EQUAL(generated, (unsigned int)expected.size());
+        VERIFY_ARE_NOT_EQUAL(output.get(), nullptr);
+        VERIFY_ARE_EQUAL(expected, (std::wstring_view{ output.get(), generated }));
+        VERIFY_ARE_EQUAL(parser._currentState, Utf8ToWideCharParser::_State::Ready);
+    }
+
     TEST_METHOD(WaitsForAdditionalInputAfterPartialSequenceTest)
     {
         Log::Comment(L"Testing that nothing is returned when parsing a partial sequence until the sequence is complete");
@@ -392,9 +392,9 @@ public:
         return {};
     }
 
-    const std::vector<size_t> GetPatternId(const til::point /*location*/) const
+    void GetPatternId(const til::point /*location*/, std::vector<size_t>& ids) const
     {
-        return {};
+        ids.clear();
     }
 };
 
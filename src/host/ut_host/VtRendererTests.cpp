@@ -79,6 +79,10 @@ class Microsoft::Console::Render::VtRendererTest
 
     TEST_METHOD(TestWrapping);
 
+    TEST_METHOD(TestRepeatCharacter);
+
+    TEST_METHOD(TestSharedBuffer);
+
     TEST_METHOD(TestResize);
 
     TEST_METHOD(TestCursorVisibility);
@@ -1427,6 +1431,117 @@ void VtRendererTest::TestWrapping()
     });
 }
 
+void VtRendererTest::TestRepeatCharacter()
+{
+    auto hFile = wil::unique_hfile(INVALID_HANDLE_VALUE);
+    auto engine = std::make_unique<Xterm256Engine>(std::move(hFile), SetUpViewport());
+    auto pfn = std::bind(&VtRendererTest::WriteCallback, this, std::placeholders::_1, std::placeholders::_2);
+    engine->SetTestCallback(pfn);
+    engine->SetRepeatCharacter(true);
+
+    VerifyFirstPaint(*engine);
+
+    TestPaint(*engine, [&]() {
+        Log::Comment(NoThrowString().Format(
+            L"Make sure the cursor is at 0,0"));
+        qExpectedInput.push_back("\x1b[H");
+        VERIFY_SUCCEEDED(engine->_MoveCursor({ 0, 0 }));
+    });
+
+    TestPaint(*engine, [&]() {
+        Log::Comment(NoThrowString().Format(
+            L"Painting a line with a long run of the same character, which "
+            L"should be compressed with REP, and a short one, which shouldn't."));
+        qExpectedInput.push_back("ab-");
+        qExpectedInput.push_back("\x1b[7b");
+        qExpectedInput.push_back("cd==e");
+
+        const std::wstring_view line{ L"ab--------cd==e" };
+
+        std::vector<Cluster> clusters;
+        for (size_t i = 0; i < line.size(); i++)
+        {
+            clusters.emplace_back(line.substr(i, 1), 1);
+        }
+
+        VERIFY_SUCCEEDED(engine->PaintBufferLine({ clusters.data(), clusters.size() }, { 0, 0 }, false, false));
+    });
+}
+
+void VtRendererTest::TestSharedBuffer()
+{
+    auto hFile = wil::unique_hfile(INVALID_HANDLE_VALUE);
+    auto engine = std::make_unique<Xterm256Engine>(std::move(hFile), SetUpViewport());
+    auto pfn = std::bind(&VtRendererTest::WriteCallback, this, std::placeholders::_1, std::placeholders::_2);
+    engine->SetTestCallback(pfn);
+
+    // Not a real section, but the ring doesn't care where its memory comes from.
+    // It holds 32 code units, which is room for the first but not the second of the lines below.
+    std::vector<std::byte> section(sizeof(SharedBuffer::Header) + 32 * sizeof(wchar_t));
+    SharedBuffer::Ring::Initialize(section);
+    engine->SetSharedBuffer(section);
+
+    SharedBuffer::Ring reader;
+    VERIFY_IS_TRUE(reader.Attach(section, SharedBuffer::Ring::End::Reader));
+
+    VerifyFirstPaint(*engine);
+
+    TestPaint(*engine, [&]() {
+        Log::Comment(NoThrowString().Format(
+            L"Make sure the cursor is at 0,0"));
+        qExpectedInput.push_back("\x1b[H");
+        VERIFY_SUCCEEDED(engine->_MoveCursor({ 0, 0 }));
+    });
+
+    const auto paint = [&](const std::wstring_view line, const til::point target) {
+        std::vector<Cluster> clusters;
+        for (size_t i = 0; i < line.size(); i++)
+        {
+            clusters.emplace_back(line.substr(i, 1), 1);
+        }
+
+        VERIFY_SUCCEEDED(engine->PaintBufferLine({ clusters.data(), clusters.size() }, target, false, false));
+    };
+
+    TestPaint(*engine, [&]() {
+        Log::Comment(NoThrowString().Format(
+            L"A long run of text should be replaced with a frame and a short one shouldn't."));
+        qExpectedInput.push_back(std::string{ "\xfe\x14\0\0\0", 5 });
+        qExpectedInput.push_back("\r\n");
+        qExpectedInput.push_back("abc");
+
+        paint(L"abcdefghijklmnopqrst", { 0, 0 });
+        paint(L"abc", { 0, 1 });
+    });
+
+    TestPaint(*engine, [&]() {
+        Log::Comment(NoThrowString().Format(
+            L"Text that doesn't fit into the shared buffer should be written as usual."));
+        qExpectedInput.push_back("\r\n");
+        qExpectedInput.push_back("0123456789ABCDEF");
+
+        paint(L"0123456789ABCDEF", { 0, 2 });
+    });
+
+    std::wstring text;
+    VERIFY_IS_TRUE(reader.Read(20, text));
+    VERIFY_ARE_EQUAL(L"abcdefghijklmnopqrst", text);
+    VERIFY_IS_FALSE(reader.Read(1, text));
+
+    TestPaint(*engine, [&]() {
+        Log::Comment(NoThrowString().Format(
+            L"Once the terminal has read the text there's room again."));
+        qExpectedInput.push_back("\r\n");
+        qExpectedInput.push_back(std::string{ "\xfe\x10\0\0\0", 5 });
+
+        paint(L"0123456789ABCDEF", { 0, 3 });
+    });
+
+    text.clear();
+    VERIFY_IS_TRUE(reader.Read(16, text));
+    VERIFY_ARE_EQUAL(L"0123456789ABCDEF", text);
+}
+
 void VtRendererTest::TestResize()
 {
     auto view = SetUpViewport();
@@ -282,8 +282,12 @@ unsigned int Utf8ToWideCharParser::_Utf8SequenceSize(_In_ byte ch)
 // without using any saved partial byte sequences. On success,
 // _convertedWideChars will contain the converted wide char sequence
 // and _currentState will be set to _State::Finished. On failure,
-// _currentState will be set to either _State::Error or
-// _State::BeginPartialParse.
+// _currentState will be set to _State::BeginPartialParse.
+// - The input is decoded in a single pass with the vectorized decoder
+// shared with til::u8u16. It replaces ill-formed and trailing partial
+// sequences with U+FFFD, so if any U+FFFD shows up in the output, the
+// input is handed to _InvolvedParse instead. This also happens for an
+// encoded U+FFFD in the input, which _InvolvedParse converts just fine.
 // Arguments:
 // - pInputChars - The byte sequence to convert to wide chars.
 // - cb - The amount of bytes in pInputChars.
@@ -292,45 +296,20 @@ unsigned int Utf8ToWideCharParser::_Utf8SequenceSize(_In_ byte ch)
 // or 0 if pInputChars cannot be successfully converted.
 unsigned int Utf8ToWideCharParser::_ParseFullRange(_In_reads_(cb) const byte* const pInputChars, const unsigned int cb)
 {
-    auto bufferSize = MultiByteToWideChar(_currentCodePage,
-                                          MB_ERR_INVALID_CHARS,
-                                          reinterpret_cast<LPCCH>(pInputChars),
-                                          cb,
-                                          nullptr,
-                                          0);
-    if (bufferSize == 0)
-    {
-        auto err = GetLastError();
-        LOG_WIN32(err);
-        if (err == ERROR_NO_UNICODE_TRANSLATION)
-        {
-            _currentState = _State::BeginPartialParse;
-        }
-        else
-        {
-            _currentState = _State::Error;
-        }
-    }
-    else
+    // cb bytes of UTF-8 decode into at most cb wide chars.
+    auto converted = std::make_unique<wchar_t[]>(cb);
+    const auto length = til::details::u8u16(reinterpret_cast<const char*>(pInputChars), cb, converted.get());
+    const auto end = converted.get() + length;
+
+    if (std::find(converted.get(), end, UNICODE_REPLACEMENT) != end)
     {
-        _convertedWideChars = std::make_unique<wchar_t[]>(bufferSize);
-        bufferSize = MultiByteToWideChar(_currentCodePage,
-                                         0,
-                                         reinterpret_cast<LPCCH>(pInputChars),
-                                         cb,
-                                         _convertedWideChars.get(),
-                                         bufferSize);
-        if (bufferSize == 0)
-        {
-            LOG_LAST_ERROR();
-            _currentState = _State::Error;
-        }
-        else
-        {
-            _currentState = _State::Finished;
-        }
+        _currentState = _State::BeginPartialParse;
+        return 0;
     }
-    return bufferSize;
+
+    _convertedWideChars = std::move(converted);
+    _currentState = _State::Finished;
+    return gsl::narrow_cast<unsigned int>(length);
 }
 
 // Routine Description:
@@ -0,0 +1,34 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- ConptyBinaryInput.hpp
+
+Abstract:
+- A compact alternative to win32-input-mode for the input pipe between a terminal and ConPTY.
+- ConPTY offers it by sending DECSET 9002 right after DECSET 9001 (win32-input-mode).
+  While both are enabled, TerminalInput serializes each key event as RecordMarker
+  followed by the raw bytes of its INPUT_RECORD, instead of as a "CSI Vk;Sc;Uc;Kd;Cs;Rc _"
+  sequence that has to be formatted and parsed again.
+- ConptyConnection then packs runs of such records into frames on the pipe:
+  FrameIntroducer, a record count (1 byte) and that many INPUT_RECORDs.
+  FrameIntroducer is a byte that can't occur in UTF-8, so frames can be interleaved
+  with regular (UTF-8) input and VtInputThread passes their records to the InputBuffer as is.
+--*/
+
+#pragma once
+
+namespace Microsoft::Console::BinaryInput
+{
+    // A noncharacter, which Unicode reserves for internal use like this one.
+    inline constexpr wchar_t RecordMarker = 0xFDD0;
+    // The number of UTF-16 code units an INPUT_RECORD occupies after a RecordMarker.
+    inline constexpr size_t RecordLength = sizeof(INPUT_RECORD) / sizeof(wchar_t);
+
+    inline constexpr char FrameIntroducer = '\xff';
+    inline constexpr size_t FrameHeaderSize = 2;
+    inline constexpr size_t MaxRecordsPerFrame = 255;
+
+    static_assert(sizeof(INPUT_RECORD) == 20);
+}
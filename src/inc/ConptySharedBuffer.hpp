@@ -0,0 +1,149 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- ConptySharedBuffer.hpp
+
+Abstract:
+- An optional shared memory channel for the output of ConPTY, which a terminal
+  asks for with PSEUDOCONSOLE_SHARED_BUFFER. CreatePseudoConsole then creates a
+  section of SectionSize bytes, which OpenConsole gets via --sharedbuffer and
+  the terminal via ConptyGetSharedBuffer().
+- The section holds a ring of UTF-16 text. Instead of encoding a longer run of
+  text as UTF-8, VtEngine copies it into the ring and writes a frame to the
+  output pipe: FrameIntroducer followed by the number of code units as a
+  little-endian uint32_t. FrameIntroducer is a byte that can't occur in UTF-8,
+  so frames can be mixed with regular output and the terminal replaces each of
+  them with the next that many code units from the ring, before parsing.
+  Everything but the text itself, including its attributes and position, keeps
+  going through the pipe as VT, so the ordering between them is preserved.
+- If the ring is full, the text is written to the pipe as UTF-8 instead.
+  The reader never trusts the counters in the section beyond its capacity.
+--*/
+
+#pragma once
+
+namespace Microsoft::Console::SharedBuffer
+{
+    inline constexpr char FrameIntroducer = '\xfe';
+    inline constexpr size_t FrameSize = 5;
+    // Shorter runs of text aren't worth a frame.
+    inline constexpr size_t MinFrameLength = 16;
+    inline constexpr size_t SectionSize = 1024 * 1024;
+    inline constexpr uint32_t Magic = 0x42535457; // "WTSB"
+
+    struct Header
+    {
+        uint32_t magic;
+        // The number of code units the ring holds.
+        uint32_t capacity;
+        // The number of code units that have been written and read so far.
+        // They're on separate cache lines, since they're written by different processes.
+        alignas(64) std::atomic<uint64_t> written;
+        alignas(64) std::atomic<uint64_t> read;
+    };
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free);
+    static_assert(sizeof(Header) % sizeof(wchar_t) == 0);
+
+    // One end of the ring. A Ring either writes or reads, but never both.
+    class Ring
+    {
+    public:
+        enum class End
+        {
+            Writer,
+            Reader,
+        };
+
+        // Prepares a newly created section.
+        static void Initialize(const std::span<std::byte> section) noexcept
+        {
+            const auto header = new (section.data()) Header{};
+            header->magic = Magic;
+            header->capacity = gsl::narrow_cast<uint32_t>((section.size() - sizeof(Header)) / sizeof(wchar_t));
+        }
+
+        // Returns false if the section wasn't prepared by Initialize().
+        bool Attach(const std::span<std::byte> section, const End end) noexcept
+        {
+            _header = nullptr;
+
+            if (section.size() < sizeof(Header))
+            {
+                return false;
+            }
+
+            const auto header = reinterpret_cast<Header*>(section.data());
+            const auto capacity = (section.size() - sizeof(Header)) / sizeof(wchar_t);
+            if (header->magic != Magic || header->capacity == 0 || header->capacity > capacity)
+            {
+                return false;
+            }
+
+            _header = header;
+            _data = reinterpret_cast<wchar_t*>(section.data() + sizeof(Header));
+            _capacity = header->capacity;
+            _position = (end == End::Writer ? header->written : header->read).load(std::memory_order_acquire);
+            return true;
+        }
+
+        bool IsAttached() const noexcept
+        {
+            return _header != nullptr;
+        }
+
+        // Copies the text into the ring and returns true, or returns false if it doesn't fit.
+        bool Write(const std::wstring_view text) noexcept
+        {
+            const auto used = _position - _header->read.load(std::memory_order_acquire);
+            if (used > _capacity || text.size() > _capacity - used)
+            {
+                return false;
+            }
+
+            const auto [first, second] = _split(text.size());
+            memcpy(first.data(), text.data(), first.size_bytes());
+            memcpy(second.data(), text.data() + first.size(), second.size_bytes());
+            _position += text.size();
+            _header->written.store(_position, std::memory_order_release);
+            return true;
+        }
+
+        // Appends the next `length` code units of the ring to `out`.
+        // Returns false if the ring doesn't hold that many, in which case nothing is read.
+        bool Read(const size_t length, std::wstring& out)
+        {
+            const auto available = _header->written.load(std::memory_order_acquire) - _position;
+            if (available > _capacity || length > available)
+            {
+                return false;
+            }
+
+            const auto offset = out.size();
+            out.resize(offset + length);
+            const auto [first, second] = _split(length);
+            memcpy(out.data() + offset, first.data(), first.size_bytes());
+            memcpy(out.data() + offset + first.size(), second.data(), second.size_bytes());
+            _position += length;
+            _header->read.store(_position, std::memory_order_release);
+            return true;
+        }
+
+    private:
+        // The `length` code units of the ring at _position, which wrap around at its end.
+        std::pair<std::span<wchar_t>, std::span<wchar_t>> _split(const size_t length) const noexcept
+        {
+            const auto start = gsl::narrow_cast<size_t>(_position % _capacity);
+            const auto first = std::min<size_t>(length, _capacity - start);
+            return { { _data + start, first }, { _data, length - first } };
+        }
+
+        Header* _header = nullptr;
+        wchar_t* _data = nullptr;
+        uint32_t _capacity = 0;
+        // How much this end has written or read.
+        uint64_t _position = 0;
+    };
+}
@@ -0,0 +1,275 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include "unicode.h"
+#include "grapheme_table.h"
+
+// Grapheme cluster segmentation according to UAX #29 ("extended grapheme clusters").
+// The property lookup is a branchless 2-stage table (see grapheme_table.h) and the
+// segmenter is a small state machine, so that both are cheap enough for the VT write path.
+namespace til::grapheme
+{
+    // The Grapheme_Cluster_Break property plus Extended_Pictographic (for rule GB11).
+    // The order must match tools/Generate-GraphemeTable.py.
+    enum class cluster_break : uint8_t
+    {
+        other,
+        cr,
+        lf,
+        control,
+        extend,
+        zwj,
+        regional_indicator,
+        prepend,
+        spacing_mark,
+        l,
+        v,
+        t,
+        lv,
+        lvt,
+        extended_pictographic,
+    };
+
+    constexpr cluster_break property(const char32_t cp) noexcept
+    {
+        if (cp >= 0x110000)
+        {
+            return cluster_break::other;
+        }
+        const auto block = details::grapheme_stage1[cp >> details::grapheme_block_shift];
+        const auto offset = (size_t{ block } << (details::grapheme_block_shift - 1)) + ((cp & ((1 << details::grapheme_block_shift) - 1)) >> 1);
+        return static_cast<cluster_break>((details::grapheme_stage2[offset] >> ((cp & 1) * 4)) & 15);
+    }
+
+    namespace details
+    {
+        constexpr bool is_control(const cluster_break b) noexcept
+        {
+            return b == cluster_break::control || b == cluster_break::cr || b == cluster_break::lf;
+        }
+
+        // The rules that only depend on the pair of properties, as one bitmask of
+        // "next" properties that join with "prev", for each "prev" property.
+        inline constexpr auto joins = []() {
+            using enum cluster_break;
+            std::array<uint16_t, 15> table{};
+
+            for (uint8_t p = 0; p < table.size(); ++p)
+            {
+                for (uint8_t n = 0; n < table.size(); ++n)
+                {
+                    const auto prev = static_cast<cluster_break>(p);
+                    const auto next = static_cast<cluster_break>(n);
+                    bool join;
+
+                    // GB3
+                    if (prev == cr && next == lf)
+                    {
+                        join = true;
+                    }
+                    // GB4, GB5
+                    else if (is_control(prev) || is_control(next))
+                    {
+                        join = false;
+                    }
+                    // GB6, GB7, GB8
+                    else if (prev == l && (next == l || next == v || next == lv || next == lvt))
+                    {
+                        join = true;
+                    }
+                    else if ((prev == lv || prev == v) && (next == v || next == t))
+                    {
+                        join = true;
+                    }
+                    else if ((prev == lvt || prev == t) && next == t)
+                    {
+                        join = true;
+                    }
+                    // GB9, GB9a, GB9b
+                    else
+                    {
+                        join = next == extend || next == zwj || next == spacing_mark || prev == prepend;
+                    }
+
+                    table[p] |= static_cast<uint16_t>(join << n);
+                }
+            }
+
+            return table;
+        }();
+    }
+
+    // Feed it the property of each code point in order and it tells you whether
+    // there's a cluster boundary in front of it (rules GB3 to GB999).
+    class segmenter
+    {
+    public:
+        explicit constexpr segmenter(const cluster_break first) noexcept :
+            _prev{ first },
+            _emoji{ first == cluster_break::extended_pictographic ? emoji::pictographic : emoji::none },
+            _riOdd{ first == cluster_break::regional_indicator }
+        {
+        }
+
+        constexpr bool breaks_before(const cluster_break next) noexcept
+        {
+            const auto prev = _prev;
+            const auto brk = _breaks(prev, next);
+
+            // GB11 needs to know whether we're in the middle of "ExtPict Extend* ZWJ".
+            if (next == cluster_break::extended_pictographic)
+            {
+                _emoji = emoji::pictographic;
+            }
+            else if (next == cluster_break::zwj && _emoji == emoji::pictographic)
+            {
+                _emoji = emoji::pictographic_zwj;
+            }
+            else if (next != cluster_break::extend || _emoji != emoji::pictographic)
+            {
+                _emoji = emoji::none;
+            }
+
+            // GB12/13 only join pairs of regional indicators.
+            _riOdd = next == cluster_break::regional_indicator && !(prev == cluster_break::regional_indicator && _riOdd);
+            _prev = next;
+            return brk;
+        }
+
+    private:
+        enum class emoji : uint8_t
+        {
+            none,
+            pictographic,
+            pictographic_zwj,
+        };
+
+        constexpr bool _breaks(const cluster_break prev, const cluster_break next) const noexcept
+        {
+            if ((details::joins[static_cast<size_t>(prev)] >> static_cast<int>(next)) & 1)
+            {
+                return false;
+            }
+            // GB11
+            if (prev == cluster_break::zwj && next == cluster_break::extended_pictographic)
+            {
+                return _emoji != emoji::pictographic_zwj;
+            }
+            // GB12, GB13
+            if (prev == cluster_break::regional_indicator && next == cluster_break::regional_indicator)
+            {
+                return !_riOdd;
+            }
+            // GB999
+            return true;
+        }
+
+        cluster_break _prev;
+        emoji _emoji;
+        bool _riOdd;
+    };
+
+    namespace details
+    {
+        // Decodes the code point at `it` and advances it. Unpaired surrogates are returned as is,
+        // which is fine for segmentation purposes, since they're category Cs (= Control).
+        constexpr char32_t next_codepoint(const wchar_t*& it, const wchar_t* end) noexcept
+        {
+            const auto wch = *it++;
+            if (is_leading_surrogate(wch) && it != end && is_trailing_surrogate(*it))
+            {
+                return (static_cast<char32_t>(wch) << 10) + *it++ - ((0xD800 << 10) + 0xDC00 - 0x10000);
+            }
+            return wch;
+        }
+    }
+
+    // Returns the length of the first grapheme cluster in `text` in UTF-16 code units.
+    constexpr size_t next_cluster_length(const std::wstring_view text) noexcept
+    {
+        if (text.empty())
+        {
+            return 0;
+        }
+
+        const auto beg = text.data();
+        const auto end = beg + text.size();
+
+        // ASCII fast path: The only ASCII characters that join are "\r\n". Anything else can
+        // only be extended by non-ASCII characters (combining marks, ZWJ, variation selectors, ...).
+        if (text.size() >= 2 && beg[0] < 0x80 && beg[1] < 0x80)
+        {
+            return beg[0] == L'\r' && beg[1] == L'\n' ? 2 : 1;
+        }
+
+        auto it = beg;
+        segmenter seg{ property(details::next_codepoint(it, end)) };
+
+        while (it != end)
+        {
+            auto next = it;
+            if (seg.breaks_before(property(details::next_codepoint(next, end))))
+            {
+                break;
+            }
+            it = next;
+        }
+
+        return gsl::narrow_cast<size_t>(it - beg);
+    }
+
+    // Removes the first grapheme cluster off of `text` and returns the rest.
+    constexpr std::wstring_view cluster_pop(const std::wstring_view text) noexcept
+    {
+        return text.substr(next_cluster_length(text));
+    }
+
+    // Batch API: Appends the end offset of each grapheme cluster in `text` to `ends`.
+    // Compared to calling next_cluster_length() in a loop, this segments runs of
+    // ASCII without decoding them and keeps the segmenter state across clusters.
+    inline void cluster_ends(const std::wstring_view text, std::vector<size_t>& ends)
+    {
+        const auto beg = text.data();
+        const auto end = beg + text.size();
+        auto it = beg;
+
+        while (it != end)
+        {
+            // Each ASCII character is its own cluster, except for "\r\n" and except for the last
+            // one in a run, which may be extended by whatever non-ASCII character follows it.
+            while (end - it >= 2 && it[0] < 0x80 && it[1] < 0x80)
+            {
+                it += it[0] == L'\r' && it[1] == L'\n' ? 2 : 1;
+                ends.emplace_back(gsl::narrow_cast<size_t>(it - beg));
+            }
+            if (it == end)
+            {
+                break;
+            }
+
+            // After a boundary the segmenter is in the same state as a new one starting at that code point.
+            segmenter seg{ property(details::next_codepoint(it, end)) };
+            while (it != end)
+            {
+                auto next = it;
+                const auto cp = details::next_codepoint(next, end);
+                if (seg.breaks_before(property(cp)))
+                {
+                    ends.emplace_back(gsl::narrow_cast<size_t>(it - beg));
+                    // Back to the ASCII loop if a new cluster starts with an ASCII character.
+                    if (cp < 0x80)
+                    {
+                        break;
+                    }
+                }
+                it = next;
+            }
+            if (it == end)
+            {
+                ends.emplace_back(gsl::narrow_cast<size_t>(it - beg));
+            }
+        }
+    }
+}
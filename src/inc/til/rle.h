@@ -319,7 +319,7 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
         basic_rle& operator=(const basic_rle& other) = default;
 
         basic_rle(basic_rle&& other) noexcept :
-            _runs(std::move(other._runs)), _total_length(other._total_length)
+            _runs(std::move(other._runs)), _ends(std::move(other._ends)), _total_length(other._total_length)
         {
             // C++ fun fact:
             // "std::move" actually doesn't actually promise to _really_ move stuff from A to B,
@@ -340,6 +340,7 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
         basic_rle& operator=(basic_rle&& other) noexcept
         {
             _runs = std::move(other._runs);
+            _ends = std::move(other._ends);
             _total_length = other._total_length;
 
             // See basic_rle(basic_rle&&) for why this is necessary.
@@ -381,6 +382,7 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
         void swap(basic_rle& other) noexcept
         {
             std::swap(_runs, other._runs);
+            std::swap(_ends, other._ends);
             std::swap(_total_length, other._total_length);
         }
 
@@ -405,13 +407,9 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
         // Get the value at the position
         const_reference at(size_type position) const
         {
-            const auto begin = _runs.begin();
-            const auto end = _runs.end();
-
-            rle_scanner scanner(begin, end);
-            auto it = scanner.scan(position).first;
+            const auto it = _find(position).first;
 
-            if (it == end)
+            if (it == _runs.end())
             {
                 throw std::out_of_range("position out of range");
             }
@@ -440,9 +438,8 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
             //
             // --> It's safe to subtract 1 from end_index
 
-            rle_scanner scanner(_runs.begin(), _runs.end());
-            auto [begin_run, start_run_pos] = scanner.scan(start_index);
-            auto [end_run, end_run_pos] = scanner.scan(end_index - 1);
+            auto [begin_run, start_run_pos] = _find(start_index);
+            auto [end_run, end_run_pos] = _find(end_index - 1);
 
             container slice{ begin_run, end_run + 1 };
             slice.back().length = end_run_pos + 1;
@@ -499,6 +496,7 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
                 }
             }
 
+            _ends.clear();
             _compact();
         }
 
@@ -507,14 +505,15 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
         // If the size is being decreased, the trailing runs are cut off to fit.
         void resize_trailing_extent(const size_type new_size)
         {
+            const auto indexed = _index_valid();
+
             if (new_size == 0)
             {
                 _runs.clear();
             }
             else if (new_size < _total_length)
             {
-                rle_scanner scanner(_runs.begin(), _runs.end());
-                auto [run, pos] = scanner.scan(new_size - 1);
+                auto [run, pos] = indexed ? _find_indexed(_runs.begin(), new_size - 1) : rle_scanner(_runs.begin(), _runs.end()).scan(new_size - 1);
 
                 run->length = ++pos;
 
@@ -529,6 +528,16 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
             }
 
             _total_length = new_size;
+
+            // Only the last remaining run changed its length.
+            if (indexed && !_runs.empty())
+            {
+                _build_index(_runs.size() - 1);
+            }
+            else
+            {
+                _ends.clear();
+            }
         }
 
         constexpr bool operator==(const basic_rle& other) const noexcept
@@ -652,6 +661,74 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
         {
         }
 
+        // Vectors with at least this many runs get an index of the cumulative run lengths, which
+        // turns positional lookups into a binary search. It's built on demand by const lookups
+        // like at() and slice() and then kept up to date by replace() and resize_trailing_extent().
+        // Below this threshold a linear scan is at least as fast and this saves the memory.
+        static constexpr size_t index_threshold = 16;
+
+        bool _index_valid() const noexcept
+        {
+            // _ends is cleared by every modification that doesn't update it.
+            // As such it's either empty or correct if its size matches.
+            return _runs.size() >= index_threshold && _ends.size() == _runs.size();
+        }
+
+        // Recomputes the cumulative lengths of all runs starting at the given one.
+        void _update_index(size_t first) const
+        {
+            _ends.resize(_runs.size());
+            first = std::min(first, _ends.size());
+
+            auto total = first ? _ends[first - 1] : size_type{ 0 };
+            auto end = _ends.begin() + first;
+            for (auto it = _runs.begin() + first; it != _runs.end(); ++it, ++end)
+            {
+                total += it->length;
+                *end = total;
+            }
+        }
+
+        bool _build_index(size_t first = 0) const noexcept
+        {
+            try
+            {
+                _update_index(first);
+                return true;
+            }
+            catch (...)
+            {
+                // A linear scan will still do.
+                _ends.clear();
+                return false;
+            }
+        }
+
+        // Same as rle_scanner::scan(), but using the index. _index_valid() must be true.
+        template<typename It>
+        std::pair<It, size_type> _find_indexed(It begin, size_type index) const noexcept
+        {
+            const auto it = std::upper_bound(_ends.begin(), _ends.end(), index);
+            const auto i = it - _ends.begin();
+            if (it == _ends.end())
+            {
+                return { begin + i, size_type{ 0 } };
+            }
+            const auto run_begin = it == _ends.begin() ? size_type{ 0 } : *(it - 1);
+            return { begin + i, static_cast<size_type>(index - run_begin) };
+        }
+
+        // Returns the run containing the given index and the position within it, or the end
+        // of _runs if it's past the end. Builds the index if there are enough runs.
+        std::pair<typename container::const_iterator, size_type> _find(size_type index) const noexcept
+        {
+            if (_runs.size() >= index_threshold && (_ends.size() == _runs.size() || _build_index()))
+            {
+                return _find_indexed(_runs.begin(), index);
+            }
+            return rle_scanner(_runs.begin(), _runs.end()).scan(index);
+        }
+
         void _compact()
         {
             auto it = _runs.begin();
@@ -702,6 +779,34 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
 
         // Replace the range [start_index, end_index) with replacements.
         void _replace_unchecked(size_type start_index, size_type end_index, const std::span<const rle_type> replacements)
+        {
+            if (!_index_valid())
+            {
+                _ends.clear();
+                // The scan for end_index continues where the one for start_index stopped.
+                rle_scanner scanner{ _runs.begin(), _runs.end() };
+                const auto [begin, begin_pos] = scanner.scan(start_index);
+                const auto [end, end_pos] = scanner.scan(end_index);
+                _replace_runs(start_index, end_index, replacements, begin, begin_pos, end, end_pos);
+                return;
+            }
+
+            const auto [begin, begin_pos] = _find_indexed(_runs.begin(), start_index);
+            const auto [end, end_pos] = _find_indexed(_runs.begin(), end_index);
+            // _replace_runs() may extend the run preceding begin, but all runs before that one
+            // remain untouched and so does their part of the index. Writes usually happen near
+            // the end of a row, so this only needs to update a few trailing entries.
+            const auto first = static_cast<size_t>(std::max<ptrdiff_t>(0, begin - _runs.begin() - 1));
+
+            // In case _replace_runs() throws, the index must be invalid until it's been updated.
+            auto ends = std::exchange(_ends, {});
+            _replace_runs(start_index, end_index, replacements, begin, begin_pos, end, end_pos);
+            _ends = std::move(ends);
+            _build_index(first);
+        }
+
+        // The implementation of _replace_unchecked(), given the location of start_index and end_index in _runs.
+        void _replace_runs(size_type start_index, size_type end_index, const std::span<const rle_type> replacements, typename container::iterator begin, size_type begin_pos, typename container::iterator end, size_type end_pos)
         {
             //
             //
@@ -863,10 +968,6 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
 
             // TODO GH#10135: Ensure replacements contains no runs with .length == 0.
 
-            rle_scanner scanner{ _runs.begin(), _runs.end() };
-            auto [begin, begin_pos] = scanner.scan(start_index);
-            auto [end, end_pos] = scanner.scan(end_index);
-
             // This condition handles pure removals, where replacements.size() == 0.
             //
             // But this isn't just a shortcut optimization...
@@ -1019,6 +1120,8 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
         }
 
         container _runs;
+        // The cumulative length of _runs up to and including each run. See index_threshold.
+        mutable std::vector<size_type> _ends;
         S _total_length{ 0 };
 
 #ifdef UNIT_TESTING
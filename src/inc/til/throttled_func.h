@@ -79,6 +79,21 @@ namespace til
         private:
             std::atomic<bool> _isPending;
         };
+
+        // The tolerable delay in milliseconds for a throttled_func timer of the given duration.
+        //
+        // Every pane owns a handful of these timers (scrollbar updates, cursor, tooltips, ...)
+        // and without a tolerance each of them wakes the CPU up at its own precise due time.
+        // With a window the threadpool is free to fire all timers that are due within the
+        // same window in a single wakeup. A quarter of the delay keeps the effective
+        // throttling rate close to the requested one and capping it at one 60 Hz frame
+        // ensures that batched callbacks still land in the same or the next frame.
+        inline DWORD throttled_func_window(int64_t delay) noexcept
+        {
+            // delay is in units of 100ns.
+            const auto windowMs = delay / 4 / 10000;
+            return static_cast<DWORD>(std::clamp<int64_t>(windowMs, 0, 16));
+        }
     } // namespace details
 
     template<bool leading, typename... Args>
@@ -108,6 +123,7 @@ namespace til
             }
 
             memcpy(&_delay, &d, sizeof(d));
+            _window = details::throttled_func_window(delay.count());
         }
 
         // throttled_func uses its `this` pointer when creating _timer.
@@ -172,7 +188,7 @@ namespace til
                 _func();
             }
 
-            SetThreadpoolTimerEx(_timer.get(), &_delay, 0, 0);
+            SetThreadpoolTimerEx(_timer.get(), &_delay, 0, _window);
         }
 
         void _trailing_edge()
@@ -195,6 +211,7 @@ namespace til
         }
 
         FILETIME _delay;
+        DWORD _window;
         function _func;
         wil::unique_threadpool_timer _timer;
         details::throttled_func_storage<Args...> _storage;
@@ -35,6 +35,13 @@ namespace til
             }
         }
 
+        // Acquires the lock only if nobody else holds it or is waiting for it.
+        bool try_lock() noexcept
+        {
+            auto ticket = _now_serving.load(std::memory_order_acquire);
+            return _next_ticket.compare_exchange_strong(ticket, ticket + 1, std::memory_order_relaxed);
+        }
+
         void unlock() noexcept
         {
             _now_serving.fetch_add(1, std::memory_order_release);
@@ -108,6 +115,23 @@ namespace til
             _recursion++;
         }
 
+        bool try_lock() noexcept
+        {
+            const auto id = GetCurrentThreadId();
+
+            if (_owner.load(std::memory_order_relaxed) != id)
+            {
+                if (!_lock.try_lock())
+                {
+                    return false;
+                }
+                _owner.store(id, std::memory_order_relaxed);
+            }
+
+            _recursion++;
+            return true;
+        }
+
         void unlock() noexcept
         {
             if (--_recursion == 0)
@@ -9,11 +9,13 @@ Abstract:
 - Defines classes which hold the status of the current partials handling.
 - Defines functions for converting between UTF-8 and UTF-16 strings.
 
-Tests have been made in order to investigate whether or not own algorithms
-could overcome disadvantages of syscalls. Test results can be read up
-in PR #4093 and the test algorithms are available in src\tools\U8U16Test.
-Based on the results the decision was made to keep using the platform
-functions MultiByteToWideChar and WideCharToMultiByte.
+Tests had originally been made in PR #4093 in order to investigate whether or not
+own algorithms could overcome disadvantages of syscalls and the decision was made
+to keep using the platform functions MultiByteToWideChar and WideCharToMultiByte.
+Since then the conversion has been replaced with the vectorized transcoders below,
+which convert runs of ASCII 16 (or 8) characters at a time and fall back to a
+validating scalar decoder for everything else. src\tools\U8U16Test compares
+their throughput with the platform functions.
 
 Author(s):
 - Steffen Illhardt (german-one), Leonard Hecker (lhecker) 2020-2021
@@ -23,6 +25,193 @@ Author(s):
 
 namespace til // Terminal Implementation Library. Also: "Today I Learned"
 {
+    namespace details
+    {
+#pragma warning(push)
+#pragma warning(disable : 26429 26481 26490) // use not_null, pointer arithmetic, reinterpret_cast
+        // Converts UTF-8 to UTF-16, just like MultiByteToWideChar(CP_UTF8) would: Each maximal subpart of an
+        // ill-formed sequence is replaced with a single U+FFFD (see "U+FFFD Substitution of Maximal Subparts" in
+        // chapter 3.9 of the Unicode standard). `out` must have room for `len` characters, which is the most that
+        // `len` bytes of UTF-8 can produce. Returns the number of characters written to `out`.
+        inline size_t u8u16(const char* const in, const size_t len, wchar_t* const out) noexcept
+        {
+            auto it = reinterpret_cast<const uint8_t*>(in);
+            const auto end = it + len;
+            auto dst = out;
+
+            while (it != end)
+            {
+                // Every byte produces at most 1 character, so `dst` never outruns `it` and we can
+                // always store 16 characters, while only advancing by the length of the ASCII prefix.
+                if (end - it >= 16)
+                {
+#if defined(_M_AMD64) || defined(_M_IX86)
+                    const auto vec = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+                    const auto zero = _mm_setzero_si128();
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_unpacklo_epi8(vec, zero));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 8), _mm_unpackhi_epi8(vec, zero));
+                    const auto mask = static_cast<unsigned long>(_mm_movemask_epi8(vec));
+                    unsigned long index;
+                    const auto ascii = _BitScanForward(&index, mask) ? index : 16ul;
+#elif defined(_M_ARM64)
+                    const auto vec = vld1q_u8(it);
+                    vst1q_u16(reinterpret_cast<uint16_t*>(dst), vmovl_u8(vget_low_u8(vec)));
+                    vst1q_u16(reinterpret_cast<uint16_t*>(dst + 8), vmovl_high_u8(vec));
+                    // Narrowing the 16 8-bit results by 4 bits gives us a 64-bit mask with 4 bits per byte.
+                    const auto mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(vcgeq_u8(vec, vdupq_n_u8(0x80))), 4)), 0);
+                    unsigned long index;
+                    const auto ascii = _BitScanForward64(&index, mask) ? index / 4 : 16ul;
+#else
+                    const auto ascii = 0ul;
+#endif
+                    it += ascii;
+                    dst += ascii;
+                    if (ascii == 16)
+                    {
+                        continue;
+                    }
+                }
+
+                const auto lead = *it++;
+                if (lead < 0x80)
+                {
+                    *dst++ = lead;
+                    continue;
+                }
+
+                // The valid ranges of the 2nd byte depend on the lead byte. See table 3-7 in chapter 3.9 of the Unicode standard.
+                char32_t cp;
+                size_t trail;
+                uint8_t lo = 0x80;
+                uint8_t hi = 0xbf;
+                if (lead >= 0xc2 && lead <= 0xdf)
+                {
+                    cp = lead & 0x1f;
+                    trail = 1;
+                }
+                else if (lead >= 0xe0 && lead <= 0xef)
+                {
+                    cp = lead & 0x0f;
+                    trail = 2;
+                    lo = lead == 0xe0 ? 0xa0 : 0x80;
+                    hi = lead == 0xed ? 0x9f : 0xbf;
+                }
+                else if (lead >= 0xf0 && lead <= 0xf4)
+                {
+                    cp = lead & 0x07;
+                    trail = 3;
+                    lo = lead == 0xf0 ? 0x90 : 0x80;
+                    hi = lead == 0xf4 ? 0x8f : 0xbf;
+                }
+                else
+                {
+                    *dst++ = 0xfffd;
+                    continue;
+                }
+
+                for (; trail && it != end && *it >= lo && *it <= hi; --trail, ++it)
+                {
+                    cp = (cp << 6) | (*it & 0x3f);
+                    lo = 0x80;
+                    hi = 0xbf;
+                }
+
+                if (trail)
+                {
+                    // The offending byte (if any) isn't part of the ill-formed sequence and is decoded next.
+                    *dst++ = 0xfffd;
+                }
+                else if (cp < 0x10000)
+                {
+                    *dst++ = static_cast<wchar_t>(cp);
+                }
+                else
+                {
+                    cp -= 0x10000;
+                    *dst++ = static_cast<wchar_t>(0xd800 | (cp >> 10));
+                    *dst++ = static_cast<wchar_t>(0xdc00 | (cp & 0x3ff));
+                }
+            }
+
+            return static_cast<size_t>(dst - out);
+        }
+
+        // Converts UTF-16 to UTF-8, just like WideCharToMultiByte(CP_UTF8) would: Unpaired surrogates are
+        // replaced with U+FFFD. `out` must have room for `len * 3` bytes, which is the most that `len`
+        // characters of UTF-16 can produce. Returns the number of bytes written to `out`.
+        inline size_t u16u8(const wchar_t* const in, const size_t len, char* const out) noexcept
+        {
+            auto it = in;
+            const auto end = it + len;
+            auto dst = reinterpret_cast<uint8_t*>(out);
+
+            while (it != end)
+            {
+                // Just like in u8u16() above, we always store 8 bytes but only advance by the length of the ASCII prefix.
+                if (end - it >= 8)
+                {
+#if defined(_M_AMD64) || defined(_M_IX86)
+                    const auto vec = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+                    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst), _mm_packus_epi16(vec, vec));
+                    const auto nonAscii = _mm_set1_epi16(static_cast<short>(0xff80));
+                    const auto isAscii = _mm_cmpeq_epi16(_mm_and_si128(vec, nonAscii), _mm_setzero_si128());
+                    // The mask contains 2 bits per wchar_t.
+                    const auto mask = static_cast<unsigned long>(_mm_movemask_epi8(isAscii)) ^ 0xffff;
+                    unsigned long index;
+                    const auto ascii = _BitScanForward(&index, mask) ? index / 2 : 8ul;
+#elif defined(_M_ARM64)
+                    const auto vec = vld1q_u16(reinterpret_cast<const uint16_t*>(it));
+                    vst1_u8(dst, vmovn_u16(vec));
+                    // Narrowing the 8 16-bit results to 8 bytes gives us a 64-bit mask with 8 bits per wchar_t.
+                    const auto mask = vget_lane_u64(vreinterpret_u64_u8(vmovn_u16(vcgtq_u16(vec, vdupq_n_u16(0x7f)))), 0);
+                    unsigned long index;
+                    const auto ascii = _BitScanForward64(&index, mask) ? index / 8 : 8ul;
+#else
+                    const auto ascii = 0ul;
+#endif
+                    it += ascii;
+                    dst += ascii;
+                    if (ascii == 8)
+                    {
+                        continue;
+                    }
+                }
+
+                char32_t cp = *it++;
+                if (cp < 0x80)
+                {
+                    *dst++ = static_cast<uint8_t>(cp);
+                    continue;
+                }
+                if (cp < 0x800)
+                {
+                    *dst++ = static_cast<uint8_t>(0xc0 | (cp >> 6));
+                    *dst++ = static_cast<uint8_t>(0x80 | (cp & 0x3f));
+                    continue;
+                }
+                if (cp >= 0xd800 && cp <= 0xdfff)
+                {
+                    if (cp <= 0xdbff && it != end && *it >= 0xdc00 && *it <= 0xdfff)
+                    {
+                        cp = 0x10000 + ((cp & 0x3ff) << 10) + (*it++ & 0x3ff);
+                        *dst++ = static_cast<uint8_t>(0xf0 | (cp >> 18));
+                        *dst++ = static_cast<uint8_t>(0x80 | ((cp >> 12) & 0x3f));
+                        *dst++ = static_cast<uint8_t>(0x80 | ((cp >> 6) & 0x3f));
+                        *dst++ = static_cast<uint8_t>(0x80 | (cp & 0x3f));
+                        continue;
+                    }
+                    cp = 0xfffd;
+                }
+                *dst++ = static_cast<uint8_t>(0xe0 | (cp >> 12));
+                *dst++ = static_cast<uint8_t>(0x80 | ((cp >> 6) & 0x3f));
+                *dst++ = static_cast<uint8_t>(0x80 | (cp & 0x3f));
+            }
+
+            return static_cast<size_t>(dst - reinterpret_cast<uint8_t*>(out));
+        }
+#pragma warning(pop)
+    }
+
     // state structure for maintenance of UTF-8 partials
     struct u8state
     {
@@ -69,11 +258,9 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
             int lengthRequired{};
             // The worst ratio of UTF-8 code units to UTF-16 code units is 1 to 1 if UTF-8 consists of ASCII only.
             RETURN_HR_IF(E_ABORT, !base::MakeCheckedNum(in.length()).AssignIfValid(&lengthRequired));
-            out.resize(in.length()); // avoid to call MultiByteToWideChar twice only to get the required size
-            const int lengthOut = MultiByteToWideChar(CP_UTF8, 0ul, in.data(), lengthRequired, out.data(), lengthRequired);
-            out.resize(gsl::narrow_cast<size_t>(lengthOut));
-
-            return lengthOut == 0 ? E_UNEXPECTED : S_OK;
+            out.resize(in.length());
+            out.resize(details::u8u16(in.data(), in.length(), out.data()));
+            return S_OK;
         }
         CATCH_RETURN();
     }
@@ -120,8 +307,7 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
                     return S_OK;
                 }
 
-                len16 = MultiByteToWideChar(CP_UTF8, 0UL, &state.partials[0], gsl::narrow_cast<int>(state.have), out.data(), capa16);
-                RETURN_HR_IF(E_UNEXPECTED, !len16);
+                len16 = gsl::narrow_cast<int>(details::u8u16(&state.partials[0], state.have, out.data()));
 
                 capa16 -= len16;
                 len8 -= copyable;
@@ -158,10 +344,7 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
 
             if (len8)
             {
-                const auto convLen{ MultiByteToWideChar(CP_UTF8, 0UL, cursor8, len8, out.data() + len16, capa16) };
-                RETURN_HR_IF(E_UNEXPECTED, !convLen);
-
-                len16 += convLen;
+                len16 += gsl::narrow_cast<int>(details::u8u16(cursor8, gsl::narrow_cast<size_t>(len8), out.data() + len16));
             }
 
             out.resize(gsl::narrow_cast<size_t>(len16));
@@ -196,11 +379,9 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
             // Code Points >U+FFFF: 2 UTF-16 code units --> 4 UTF-8 code units.
             // Thus, the worst ratio of UTF-16 code units to UTF-8 code units is 1 to 3.
             RETURN_HR_IF(E_ABORT, !base::MakeCheckedNum(in.length()).AssignIfValid(&lengthIn) || !base::CheckMul(lengthIn, 3).AssignIfValid(&lengthRequired));
-            out.resize(gsl::narrow_cast<size_t>(lengthRequired)); // avoid to call WideCharToMultiByte twice only to get the required size
-            const int lengthOut = WideCharToMultiByte(CP_UTF8, 0ul, in.data(), lengthIn, out.data(), lengthRequired, nullptr, nullptr);
-            out.resize(gsl::narrow_cast<size_t>(lengthOut));
-
-            return lengthOut == 0 ? E_UNEXPECTED : S_OK;
+            out.resize(gsl::narrow_cast<size_t>(lengthRequired));
+            out.resize(details::u16u8(in.data(), in.length(), out.data()));
+            return S_OK;
         }
         CATCH_RETURN();
     }
@@ -238,8 +419,7 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
             if (state.partials[0])
             {
                 state.partials[1] = *cursor16;
-                len8 = WideCharToMultiByte(CP_UTF8, 0UL, &state.partials[0], 2, out.data(), capa8, nullptr, nullptr);
-                RETURN_HR_IF(E_UNEXPECTED, !len8);
+                len8 = gsl::narrow_cast<int>(details::u16u8(&state.partials[0], 2, out.data()));
 
                 state.reset();
                 capa8 -= len8;
@@ -259,10 +439,7 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
 
             if (len16)
             {
-                const auto convLen{ WideCharToMultiByte(CP_UTF8, 0UL, cursor16, len16, out.data() + len8, capa8, nullptr, nullptr) };
-                RETURN_HR_IF(E_UNEXPECTED, !convLen);
-
-                len8 += convLen;
+                len8 += gsl::narrow_cast<int>(details::u16u8(cursor16, gsl::narrow_cast<size_t>(len16), out.data() + len8));
             }
 
             out.resize(gsl::narrow_cast<size_t>(len8));
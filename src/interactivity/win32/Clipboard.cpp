@@ -237,39 +237,43 @@ void Clipboard::StoreSelectionToClipboard(const bool copyFormatting)
         return renderSettings.GetAttributeColors(attr);
     };
 
-    bool includeCRLF, trimTrailingWhitespace;
+    TextBuffer::CopyRequest req;
+    req.selectionRects = selectionRects;
     if (WI_IsFlagSet(OneCoreSafeGetKeyState(VK_SHIFT), KEY_PRESSED))
     {
         // When shift is held, put everything in one line
-        includeCRLF = trimTrailingWhitespace = false;
+        req.includeCRLF = req.trimTrailingWhitespace = false;
     }
     else
     {
-        includeCRLF = trimTrailingWhitespace = true;
+        req.includeCRLF = req.trimTrailingWhitespace = true;
     }
 
-    const auto text = buffer.GetText(includeCRLF,
-                                     trimTrailingWhitespace,
-                                     selectionRects,
-                                     GetAttributeColors);
+    // The formats are generated straight from the buffer, without copying the selection first.
+    const auto text = buffer.GetPlainText(req);
+    std::string html;
+    std::string rtf;
+    if (copyFormatting)
+    {
+        const auto& fontData = gci.GetActiveOutputBuffer().GetCurrentFont();
+        const auto iFontHeightPoints = fontData.GetUnscaledSize().height * 72 / ServiceLocator::LocateGlobals().dpi;
+        const auto bgColor = renderSettings.GetAttributeColors({}).second;
+
+        buffer.GenHTML(req, html, iFontHeightPoints, fontData.GetFaceName(), bgColor, GetAttributeColors);
+        buffer.GenRTF(req, rtf, iFontHeightPoints, fontData.GetFaceName(), bgColor, GetAttributeColors);
+    }
 
-    CopyTextToSystemClipboard(text, copyFormatting);
+    CopyTextToSystemClipboard(text, html, rtf);
 }
 
 // Routine Description:
 // - Copies the text given onto the global system clipboard.
 // Arguments:
-// - rows - Rows of text data to copy
-// - fAlsoCopyFormatting - true if the color and formatting should also be copied, false otherwise
-void Clipboard::CopyTextToSystemClipboard(const TextBuffer::TextAndColor& rows, const bool fAlsoCopyFormatting)
+// - text - The plain text to copy
+// - html, rtf - The formatted text to copy as well. Ignored if empty.
+void Clipboard::CopyTextToSystemClipboard(const std::wstring& text, const std::string& html, const std::string& rtf)
 {
-    std::wstring finalString;
-
-    // Concatenate strings into one giant string to put onto the clipboard.
-    for (const auto& str : rows.text)
-    {
-        finalString += str;
-    }
+    const auto& finalString = text;
 
     // allocate the final clipboard data
     const auto cchNeeded = finalString.size() + 1;
@@ -297,18 +301,13 @@ void Clipboard::CopyTextToSystemClipboard(const TextBuffer::TextAndColor& rows,
         THROW_LAST_ERROR_IF(!EmptyClipboard());
         THROW_LAST_ERROR_IF_NULL(SetClipboardData(CF_UNICODETEXT, globalHandle.get()));
 
-        if (fAlsoCopyFormatting)
+        if (!html.empty())
         {
-            const auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
-            const auto& fontData = gci.GetActiveOutputBuffer().GetCurrentFont();
-            const auto iFontHeightPoints = fontData.GetUnscaledSize().height * 72 / ServiceLocator::LocateGlobals().dpi;
-            const auto bgColor = gci.GetRenderSettings().GetAttributeColors({}).second;
-
-            auto HTMLToPlaceOnClip = TextBuffer::GenHTML(rows, iFontHeightPoints, fontData.GetFaceName(), bgColor);
-            CopyToSystemClipboard(HTMLToPlaceOnClip, L"HTML Format");
-
-            auto RTFToPlaceOnClip = TextBuffer::GenRTF(rows, iFontHeightPoints, fontData.GetFaceName(), bgColor);
-            CopyToSystemClipboard(RTFToPlaceOnClip, L"Rich Text Format");
+            CopyToSystemClipboard(html, L"HTML Format");
+        }
+        if (!rtf.empty())
+        {
+            CopyToSystemClipboard(rtf, L"Rich Text Format");
         }
     }
 
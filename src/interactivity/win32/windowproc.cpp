@@ -698,7 +698,7 @@ using namespace Microsoft::Console::Types;
     {
         // Re-read the edit key settings from registry.
         Registry reg(&gci);
-        reg.GetEditKeys(nullptr);
+        reg.GetEditKeys();
         break;
     }
 
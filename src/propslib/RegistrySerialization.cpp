@@ -95,9 +95,6 @@ const size_t RegistrySerialization::s_GlobalPropMappingsSize = ARRAYSIZE(s_Globa
 // - STATUS_SUCCESSFUL or appropriate NTSTATUS reply for registry operations.
 [[nodiscard]] NTSTATUS RegistrySerialization::s_LoadRegDword(const HKEY hKey, const _RegPropertyMap* const pPropMap, _In_ Settings* const pSettings)
 {
-    // find offset into destination structure for this numerical value
-    const auto pbField = (PBYTE)pSettings + pPropMap->dwFieldOffset;
-
     // attempt to load number into this field
     // If we're not successful, it's ok. Just don't fill it.
     DWORD dwValue;
@@ -109,43 +106,59 @@ const size_t RegistrySerialization::s_GlobalPropMappingsSize = ARRAYSIZE(s_Globa
                                nullptr);
     if (SUCCEEDED_NTSTATUS(Status))
     {
-        switch (pPropMap->propertyType)
-        {
-        case _RegPropertyType::Dword:
-        {
-            const auto pdField = (DWORD*)pbField;
-            *pdField = dwValue;
-            break;
-        }
-        case _RegPropertyType::Word:
-        {
-            const auto pwField = (WORD*)pbField;
-            *pwField = (WORD)dwValue;
-            break;
-        }
-        case _RegPropertyType::Boolean:
-        {
-            *pbField = !!dwValue;
-            break;
-        }
-        case _RegPropertyType::Byte:
-        {
-            *pbField = LOBYTE(dwValue);
-            break;
-        }
-        case _RegPropertyType::Coordinate:
-        {
-            auto pcoordField = (PCOORD)pbField;
-            pcoordField->X = LOWORD(dwValue);
-            pcoordField->Y = HIWORD(dwValue);
-            break;
-        }
-        }
+        s_ApplyRegDword(pPropMap, dwValue, pSettings);
     }
 
     return Status;
 }
 
+// Routine Description:
+// - Applies a number that was read from the registry to the given property.
+//   Supports: Dword, Word, Byte, Boolean, and Coordinate
+// Arguments:
+// - pPropMap - Contains property information to use in storing value data
+// - dwValue - The value that was read
+// Return Value:
+// - <none>
+void RegistrySerialization::s_ApplyRegDword(const _RegPropertyMap* const pPropMap, const DWORD dwValue, _In_ Settings* const pSettings)
+{
+    // find offset into destination structure for this numerical value
+    const auto pbField = (PBYTE)pSettings + pPropMap->dwFieldOffset;
+
+    switch (pPropMap->propertyType)
+    {
+    case _RegPropertyType::Dword:
+    {
+        const auto pdField = (DWORD*)pbField;
+        *pdField = dwValue;
+        break;
+    }
+    case _RegPropertyType::Word:
+    {
+        const auto pwField = (WORD*)pbField;
+        *pwField = (WORD)dwValue;
+        break;
+    }
+    case _RegPropertyType::Boolean:
+    {
+        *pbField = !!dwValue;
+        break;
+    }
+    case _RegPropertyType::Byte:
+    {
+        *pbField = LOBYTE(dwValue);
+        break;
+    }
+    case _RegPropertyType::Coordinate:
+    {
+        auto pcoordField = (PCOORD)pbField;
+        pcoordField->X = LOWORD(dwValue);
+        pcoordField->Y = HIWORD(dwValue);
+        break;
+    }
+    }
+}
+
 // Routine Description:
 // - Reads string from the registry and applies it to the given property if the value exists
 // Arguments:
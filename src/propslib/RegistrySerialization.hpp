@@ -93,5 +93,6 @@ public:
     static const size_t s_GlobalPropMappingsSize;
 
     [[nodiscard]] static NTSTATUS s_LoadRegDword(const HKEY hKey, const _RegPropertyMap* const pPropMap, _In_ Settings* const pSettings);
+    static void s_ApplyRegDword(const _RegPropertyMap* const pPropMap, const DWORD dwValue, _In_ Settings* const pSettings);
     [[nodiscard]] static NTSTATUS s_LoadRegString(const HKEY hKey, const _RegPropertyMap* const pPropMap, _In_ Settings* const pSettings);
 };
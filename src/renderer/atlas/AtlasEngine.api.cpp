@@ -40,15 +40,68 @@ constexpr HRESULT vec2_narrow(U x, U y, vec2<T>& out) noexcept
     return api_narrow(x, out.x) | api_narrow(y, out.y);
 }
 
+template<typename T>
+static bool vectorBitwiseEqual(const std::vector<T>& a, const std::vector<T>& b) noexcept
+{
+    return a.size() == b.size() && memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0;
+}
+
+// Returns true if the two settings result in the same glyphs and cell metrics. The font family is compared
+// by name, because DirectWrite doesn't guarantee to return the same IDWriteFontFamily object each time.
+static bool fontSettingsEqual(const FontSettings& a, const FontSettings& b) noexcept
+{
+    return a.fontCollection == b.fontCollection &&
+           a.fontName == b.fontName &&
+           vectorBitwiseEqual(a.fontFeatures, b.fontFeatures) &&
+           vectorBitwiseEqual(a.fontAxisValues, b.fontAxisValues) &&
+           a.fontSize == b.fontSize &&
+           a.cellSize == b.cellSize &&
+           a.fontWeight == b.fontWeight &&
+           a.advanceWidth == b.advanceWidth &&
+           a.baseline == b.baseline &&
+           a.descender == b.descender &&
+           a.thinLineWidth == b.thinLineWidth &&
+           a.gridTop == b.gridTop &&
+           a.gridBottom == b.gridBottom &&
+           a.gridLeft == b.gridLeft &&
+           a.gridRight == b.gridRight &&
+           a.underline == b.underline &&
+           a.strikethrough == b.strikethrough &&
+           a.doubleUnderline[0] == b.doubleUnderline[0] &&
+           a.doubleUnderline[1] == b.doubleUnderline[1] &&
+           a.overline == b.overline;
+}
+
 #pragma region IRenderEngine
 
+// Marks the rows [start, end) as invalid. The ranges are recorded individually
+// so that StartPaint() can skip any rows in between disjoint invalidations.
+void AtlasEngine::_invalidateRows(u16 start, u16 end) noexcept
+{
+    if (start >= end)
+    {
+        return;
+    }
+
+    _api.invalidatedRows.start = std::min(_api.invalidatedRows.start, start);
+    _api.invalidatedRows.end = std::max(_api.invalidatedRows.end, end);
+
+    if (_api.invalidatedRowRangesCount < _api.invalidatedRowRanges.size())
+    {
+        til::at(_api.invalidatedRowRanges, _api.invalidatedRowRangesCount++) = { start, end };
+    }
+    else
+    {
+        _api.invalidatedRowRangesOverflow = true;
+    }
+}
+
 [[nodiscard]] HRESULT AtlasEngine::Invalidate(const til::rect* const psrRegion) noexcept
 {
     //assert(psrRegion->top < psrRegion->bottom && psrRegion->top >= 0 && psrRegion->bottom <= _api.cellCount.y);
 
     // BeginPaint() protects against invalid out of bounds numbers.
-    _api.invalidatedRows.start = std::min(_api.invalidatedRows.start, gsl::narrow_cast<u16>(psrRegion->top));
-    _api.invalidatedRows.end = std::max(_api.invalidatedRows.end, gsl::narrow_cast<u16>(psrRegion->bottom));
+    _invalidateRows(gsl::narrow_cast<u16>(psrRegion->top), gsl::narrow_cast<u16>(psrRegion->bottom));
     return S_OK;
 }
 
@@ -89,8 +142,7 @@ constexpr HRESULT vec2_narrow(U x, U y, vec2<T>& out) noexcept
         // BeginPaint() protects against invalid out of bounds numbers.
         // TODO: rect can contain invalid out of bounds coordinates when the selection is being
         // dragged outside of the viewport (and the window begins scrolling automatically).
-        _api.invalidatedRows.start = gsl::narrow_cast<u16>(std::min<int>(_api.invalidatedRows.start, std::max<int>(0, rect.top)));
-        _api.invalidatedRows.end = gsl::narrow_cast<u16>(std::max<int>(_api.invalidatedRows.end, std::max<int>(0, rect.bottom)));
+        _invalidateRows(gsl::narrow_cast<u16>(clamp<int>(rect.top, u16min, u16max)), gsl::narrow_cast<u16>(clamp<int>(rect.bottom, u16min, u16max)));
     }
     return S_OK;
 }
@@ -107,10 +159,19 @@ constexpr HRESULT vec2_narrow(U x, U y, vec2<T>& out) noexcept
         _api.invalidatedCursorArea.right = gsl::narrow_cast<u16>(clamp<int>(_api.invalidatedCursorArea.right + delta, u16min, u16max));
 
         _api.invalidatedRows = invalidatedRowsAll;
+        _api.invalidatedRowRangesOverflow = true;
     }
 
     if (const auto delta = pcoordDelta->y)
     {
+        // StartPaint() invalidates the rows uncovered by scrolling.
+        for (u8 i = 0; i < _api.invalidatedRowRangesCount; ++i)
+        {
+            auto& r = til::at(_api.invalidatedRowRanges, i);
+            r.start = gsl::narrow_cast<u16>(clamp<int>(r.start + delta, u16min, u16max));
+            r.end = gsl::narrow_cast<u16>(clamp<int>(r.end + delta, u16min, u16max));
+        }
+
         _api.scrollOffset = gsl::narrow_cast<i16>(clamp<int>(_api.scrollOffset + delta, i16min, i16max));
 
         _api.invalidatedCursorArea.top = gsl::narrow_cast<u16>(clamp<int>(_api.invalidatedCursorArea.top + delta, u16min, u16max));
@@ -134,6 +195,7 @@ constexpr HRESULT vec2_narrow(U x, U y, vec2<T>& out) noexcept
 [[nodiscard]] HRESULT AtlasEngine::InvalidateAll() noexcept
 {
     _api.invalidatedRows = invalidatedRowsAll;
+    _api.invalidatedRowRangesOverflow = true;
     return S_OK;
 }
 
@@ -162,6 +224,13 @@ constexpr HRESULT vec2_narrow(U x, U y, vec2<T>& out) noexcept
 
 [[nodiscard]] HRESULT AtlasEngine::UpdateSoftFont(const std::span<const uint16_t> bitPattern, const til::size cellSize, const size_t centeringHint) noexcept
 {
+    // Changing the font settings resets the glyph atlas. Don't do that if the font didn't actually change.
+    const auto& font = *_api.s->font;
+    if (font.softFontCellSize == cellSize && std::equal(font.softFontPattern.begin(), font.softFontPattern.end(), bitPattern.begin(), bitPattern.end()))
+    {
+        return S_OK;
+    }
+
     const auto softFont = _api.s.write()->font.write();
     softFont->softFontPattern = std::vector(bitPattern.begin(), bitPattern.end());
     softFont->softFontCellSize = cellSize;
@@ -258,7 +327,7 @@ CATCH_RETURN()
 
 [[nodiscard]] HRESULT AtlasEngine::GetDirtyArea(std::span<const til::rect>& area) noexcept
 {
-    area = std::span{ &_api.dirtyRect, 1 };
+    area = _api.dirtyRects;
     return S_OK;
 }
 
@@ -310,6 +379,16 @@ HRESULT AtlasEngine::Enable() noexcept
     return S_OK;
 }
 
+[[nodiscard]] std::chrono::milliseconds AtlasEngine::GetContinuousRedrawInterval() noexcept
+{
+    // The frame rate limit only applies to animated pixel shaders. Font fallback results are picked up as soon as possible.
+    if (ATLAS_DEBUG_CONTINUOUS_REDRAW || !_api.fallbackPending.empty())
+    {
+        return {};
+    }
+    return _api.continuousRedrawInterval;
+}
+
 [[nodiscard]] std::wstring_view AtlasEngine::GetPixelShaderPath() noexcept
 {
     return _api.s->misc->customPixelShaderPath;
@@ -339,6 +418,39 @@ HRESULT AtlasEngine::Enable() noexcept
     return Types::Viewport::FromDimensions(viewInCharacters.Origin(), { viewInCharacters.Width() * _api.s->font->cellSize.x, viewInCharacters.Height() * _api.s->font->cellSize.y });
 }
 
+[[nodiscard]] bool AtlasEngine::SupportsUnlockedPainting() const noexcept
+{
+    return true;
+}
+
+[[nodiscard]] RenderEngineMemoryUsage AtlasEngine::GetMemoryUsage() const noexcept
+{
+    RenderEngineMemoryUsage usage;
+    usage.rowBytes = _rowBytes.load(std::memory_order_relaxed);
+    usage.cacheBytes = _shapingCacheBytes.load(std::memory_order_relaxed);
+    usage.glyphAtlasBytes = _glyphAtlasBytes.load(std::memory_order_relaxed);
+    return usage;
+}
+
+[[nodiscard]] RenderEngineDiagnostics AtlasEngine::GetDiagnostics() const noexcept
+{
+    RenderEngineDiagnostics diagnostics;
+    diagnostics.dirtyRows = _dirtyRows.load(std::memory_order_relaxed);
+    diagnostics.shapingCacheHits = _shapingCacheHits.load(std::memory_order_relaxed);
+    diagnostics.shapingCacheMisses = _shapingCacheMisses.load(std::memory_order_relaxed);
+    diagnostics.glyphLookups = _glyphLookups.load(std::memory_order_relaxed);
+    diagnostics.glyphCacheMisses = _glyphCacheMisses.load(std::memory_order_relaxed);
+    diagnostics.glyphAtlasOccupancy = _glyphAtlasOccupancy.load(std::memory_order_relaxed);
+    return diagnostics;
+}
+
+// Frees the shaping cache, while keeping its size. It fills up again as new text gets drawn.
+// The cache may be in use by a frame that's painted concurrently, so this is done by the next StartPaint().
+void AtlasEngine::TrimMemory() noexcept
+{
+    _trimMemoryPending.store(true, std::memory_order_relaxed);
+}
+
 void AtlasEngine::SetAntialiasingMode(const D2D1_TEXT_ANTIALIAS_MODE antialiasingMode) noexcept
 {
     const auto mode = static_cast<AntialiasingMode>(antialiasingMode);
@@ -376,6 +488,16 @@ void AtlasEngine::SetForceFullRepaintRendering(bool enable) noexcept
     return S_OK;
 }
 
+void AtlasEngine::SetPixelShaderAnimationPaused(bool paused) noexcept
+{
+    _api.pixelShaderAnimationPaused = paused;
+}
+
+void AtlasEngine::SetPixelShaderFrameInterval(std::chrono::milliseconds interval) noexcept
+{
+    _api.pixelShaderFrameInterval = interval;
+}
+
 void AtlasEngine::SetPixelShaderPath(std::wstring_view value) noexcept
 try
 {
@@ -485,7 +607,6 @@ void AtlasEngine::_resolveTransparencySettings() noexcept
         // An opaque background allows us to use true "independent" flips. See AtlasEngine::_createSwapChain().
         // We can't enable them if custom shaders are specified, because it's unknown, whether they support opaque inputs.
         s->target.write()->enableTransparentBackground = enableTransparentBackground;
-        _api.backgroundOpaqueMixin = enableTransparentBackground ? 0x00000000 : 0xff000000;
     }
 }
 
@@ -565,10 +686,17 @@ void AtlasEngine::_updateFont(const wchar_t* faceName, const FontInfoDesired& fo
         }
     }
 
-    const auto font = _api.s.write()->font.write();
-    _resolveFontMetrics(faceName, fontInfoDesired, fontInfo, font);
-    font->fontFeatures = std::move(fontFeatures);
-    font->fontAxisValues = std::move(fontAxisValues);
+    auto font = *_api.s->font;
+    _resolveFontMetrics(faceName, fontInfoDesired, fontInfo, &font);
+    font.fontFeatures = std::move(fontFeatures);
+    font.fontAxisValues = std::move(fontAxisValues);
+
+    // Settings reloads call this for every control, even when the font didn't change. Writing the
+    // settings would needlessly recreate the glyph atlas and all other font dependent resources.
+    if (!fontSettingsEqual(font, *_api.s->font))
+    {
+        *_api.s.write()->font.write() = std::move(font);
+    }
 }
 
 void AtlasEngine::_resolveFontMetrics(const wchar_t* requestedFaceName, const FontInfoDesired& fontInfoDesired, FontInfo& fontInfo, FontSettings* fontMetrics) const
@@ -596,24 +724,10 @@ void AtlasEngine::_resolveFontMetrics(const wchar_t* requestedFaceName, const Fo
         requestedWeight = DWRITE_FONT_WEIGHT_NORMAL;
     }
 
-    auto fontCollection = FontCache::GetCached();
-
-    u32 index = 0;
-    BOOL exists = false;
-    THROW_IF_FAILED(fontCollection->FindFamilyName(requestedFaceName, &index, &exists));
-    THROW_HR_IF(DWRITE_E_NOFONT, !exists);
-
-    wil::com_ptr<IDWriteFontFamily> fontFamily;
-    THROW_IF_FAILED(fontCollection->GetFontFamily(index, fontFamily.addressof()));
-
-    wil::com_ptr<IDWriteFont> font;
-    THROW_IF_FAILED(fontFamily->GetFirstMatchingFont(static_cast<DWRITE_FONT_WEIGHT>(requestedWeight), DWRITE_FONT_STRETCH_NORMAL, DWRITE_FONT_STYLE_NORMAL, font.addressof()));
-
-    wil::com_ptr<IDWriteFontFace> fontFace;
-    THROW_IF_FAILED(font->CreateFontFace(fontFace.addressof()));
-
-    DWRITE_FONT_METRICS metrics{};
-    fontFace->GetMetrics(&metrics);
+    // The font lookup is shared by all engines and independent of the font size and DPI.
+    // Only the cheap computations below are repeated when zooming.
+    const auto resolved = FontCache::Resolve(requestedFaceName, requestedWeight);
+    const auto& metrics = resolved->metrics;
 
     // Point sizes are commonly treated at a 72 DPI scale
     // (including by OpenType), whereas DirectWrite uses 96 DPI.
@@ -635,15 +749,9 @@ void AtlasEngine::_resolveFontMetrics(const wchar_t* requestedFaceName, const Fo
     // According to the CSS spec, if it's impossible to determine the advance width,
     // it must be assumed to be 0.5em wide. em in CSS refers to the computed font-size.
     auto advanceWidth = 0.5f * fontSizeInPx;
+    if (resolved->zeroAdvanceWidth >= 0)
     {
-        static constexpr u32 codePoint = '0';
-        u16 glyphIndex;
-        if (SUCCEEDED(fontFace->GetGlyphIndicesW(&codePoint, 1, &glyphIndex)))
-        {
-            DWRITE_GLYPH_METRICS glyphMetrics{};
-            THROW_IF_FAILED(fontFace->GetDesignGlyphMetrics(&glyphIndex, 1, &glyphMetrics, FALSE));
-            advanceWidth = static_cast<f32>(glyphMetrics.advanceWidth) * designUnitsPerPx;
-        }
+        advanceWidth = static_cast<f32>(resolved->zeroAdvanceWidth) * designUnitsPerPx;
     }
 
     auto adjustedWidth = std::roundf(fontInfoDesired.GetCellWidth().Resolve(advanceWidth, dpi, fontSizeInPx, advanceWidth));
@@ -724,8 +832,8 @@ void AtlasEngine::_resolveFontMetrics(const wchar_t* requestedFaceName, const Fo
         // NOTE: From this point onward no early returns or throwing code should exist,
         // as we might cause _api to be in an inconsistent state otherwise.
 
-        fontMetrics->fontCollection = std::move(fontCollection);
-        fontMetrics->fontFamily = std::move(fontFamily);
+        fontMetrics->fontCollection = resolved->fontCollection;
+        fontMetrics->fontFamily = resolved->fontFamily;
         fontMetrics->fontName = std::move(fontName);
         fontMetrics->fontSize = fontSizeInPx;
         fontMetrics->cellSize = { cellWidth, cellHeight };
@@ -6,6 +6,7 @@
 
 #include "Backend.h"
 #include "DWriteTextAnalysis.h"
+#include "dwrite.h"
 #include "../../interactivity/win32/CustomWindowMessages.h"
 
 // #### NOTE ####
@@ -40,6 +41,10 @@ AtlasEngine::AtlasEngine()
     THROW_IF_FAILED(_p.dwriteFactory->GetSystemFontFallback(_p.systemFontFallback.addressof()));
     _p.systemFontFallback1 = _p.systemFontFallback.try_query<IDWriteFontFallback1>();
 
+    _fontFallback.fontFallback = _p.systemFontFallback;
+    _fontFallback.work.reset(CreateThreadpoolWork(&_fontFallbackCallback, &_fontFallback, nullptr));
+    THROW_LAST_ERROR_IF(!_fontFallback.work);
+
     wil::com_ptr<IDWriteTextAnalyzer> textAnalyzer;
     THROW_IF_FAILED(_p.dwriteFactory->CreateTextAnalyzer(textAnalyzer.addressof()));
     _p.textAnalyzer = textAnalyzer.query<IDWriteTextAnalyzer1>();
@@ -65,14 +70,50 @@ try
         }
     }
 
+    if (_api.pendingCursor)
+    {
+        *_api.s.write()->cursor.write() = *_api.pendingCursor;
+        _api.pendingCursor.reset();
+    }
+
     if (_p.s != _api.s)
     {
         _handleSettingsUpdate();
     }
 
+    _api.continuousRedrawInterval = _api.pixelShaderFrameInterval;
+
+    if (_trimMemoryPending.exchange(false, std::memory_order_relaxed))
+    {
+        for (auto& entry : _api.shapingCache)
+        {
+            entry = {};
+        }
+    }
+
+    // Pick up the codepoints whose fallback font was loaded by _fontFallbackCallback()
+    // and redraw everything, so that the rows with their placeholders get shaped again.
+    if (!_api.fallbackPending.empty())
+    {
+        const std::lock_guard lock{ _fontFallback.mutex };
+
+        if (!_fontFallback.resolved.empty())
+        {
+            for (const auto cp : _fontFallback.resolved)
+            {
+                _api.fallbackResolved.insert(cp);
+                _api.fallbackPending.erase(cp);
+            }
+            _fontFallback.resolved.clear();
+            _api.invalidatedRows = invalidatedRowsAll;
+            _api.invalidatedRowRangesOverflow = true;
+        }
+    }
+
     if constexpr (ATLAS_DEBUG_DISABLE_PARTIAL_INVALIDATION)
     {
         _api.invalidatedRows = invalidatedRowsAll;
+        _api.invalidatedRowRangesOverflow = true;
         _api.scrollOffset = 0;
     }
 
@@ -120,6 +161,7 @@ try
                 const u16 begRow = _p.s->cellCount.y + offset;
                 _api.invalidatedRows.start = nothingInvalid ? begRow : std::min(_api.invalidatedRows.start, begRow);
                 _api.invalidatedRows.end = _p.s->cellCount.y;
+                _invalidateRows(begRow, _p.s->cellCount.y);
 
                 const auto dst = std::copy_n(_p.rows.begin() - offset, _p.rows.size() + offset, _p.rowsScratch.begin());
                 std::copy_n(_p.rows.begin(), -offset, dst);
@@ -135,6 +177,7 @@ try
                 const u16 endRow = offset;
                 _api.invalidatedRows.start = 0;
                 _api.invalidatedRows.end = nothingInvalid ? endRow : std::max(_api.invalidatedRows.end, endRow);
+                _invalidateRows(0, endRow);
 
                 const auto dst = std::copy_n(_p.rows.end() - offset, offset, _p.rowsScratch.begin());
                 std::copy_n(_p.rows.begin(), _p.rows.size() - offset, dst);
@@ -173,12 +216,58 @@ try
         }
     }
 
-    _api.dirtyRect = {
-        0,
-        _api.invalidatedRows.start,
-        _p.s->cellCount.x,
-        _api.invalidatedRows.end,
-    };
+    // A blinking cursor at the top and a clock at the bottom shouldn't result in every row in between
+    // being repainted. We thus only repaint the individually invalidated rows, if possible.
+    _p.invalidatedRowRanges.clear();
+    if (_api.invalidatedRows.non_empty())
+    {
+        if (_api.invalidatedRowRangesOverflow || allInvalid)
+        {
+            _p.invalidatedRowRanges.emplace_back(_api.invalidatedRows);
+        }
+        else
+        {
+            for (u8 i = 0; i < _api.invalidatedRowRangesCount; ++i)
+            {
+                auto r = til::at(_api.invalidatedRowRanges, i);
+                r.start = std::min(r.start, _p.s->cellCount.y);
+                r.end = clamp(r.end, r.start, _p.s->cellCount.y);
+                if (r.non_empty())
+                {
+                    _p.invalidatedRowRanges.emplace_back(r);
+                }
+            }
+
+            auto& ranges = _p.invalidatedRowRanges;
+            std::sort(ranges.begin(), ranges.end(), [](const auto& a, const auto& b) { return a.start < b.start; });
+
+            // Merge overlapping and adjacent ranges.
+            size_t count = 0;
+            for (const auto& r : ranges)
+            {
+                if (count && r.start <= ranges[count - 1].end)
+                {
+                    ranges[count - 1].end = std::max(ranges[count - 1].end, r.end);
+                }
+                else
+                {
+                    ranges[count++] = r;
+                }
+            }
+            ranges.resize(count);
+        }
+
+        for (const auto& r : _p.invalidatedRowRanges)
+        {
+            _api.dirtyRows += r.end - r.start;
+        }
+    }
+
+    _api.dirtyRects.clear();
+    for (const auto& r : _p.invalidatedRowRanges)
+    {
+        _api.dirtyRects.emplace_back(til::rect{ 0, r.start, _p.s->cellCount.x, r.end });
+    }
 
     _p.dirtyRectInPx = {
         til::CoordTypeMax,
@@ -187,14 +276,17 @@ try
         til::CoordTypeMin,
     };
     _p.invalidatedRows = _api.invalidatedRows;
+    _p.dirtySpansInPx.clear();
     _p.cursorRect = {};
     _p.scrollOffset = _api.scrollOffset;
+    _p.customShaderPaused = _api.pixelShaderAnimationPaused;
 
     if (_api.invalidatedRows.non_empty())
     {
         const auto deltaPx = _api.scrollOffset * _p.s->font->cellSize.y;
         const til::CoordType targetSizeX = _p.s->targetSize.x;
         const til::CoordType targetSizeY = _p.s->targetSize.y;
+        auto rowRange = _p.invalidatedRowRanges.begin();
         u16 y = 0;
 
         _p.dirtyRectInPx.left = 0;
@@ -207,7 +299,12 @@ try
             r->dirtyTop += deltaPx;
             r->dirtyBottom += deltaPx;
 
-            if (_api.invalidatedRows.contains(y))
+            while (rowRange != _p.invalidatedRowRanges.end() && y >= rowRange->end)
+            {
+                ++rowRange;
+            }
+
+            if (rowRange != _p.invalidatedRowRanges.end() && rowRange->contains(y))
             {
                 const auto clampedTop = clamp(r->dirtyTop, 0, targetSizeY);
                 const auto clampedBottom = clamp(r->dirtyBottom, 0, targetSizeY);
@@ -215,6 +312,7 @@ try
                 {
                     _p.dirtyRectInPx.top = std::min(_p.dirtyRectInPx.top, clampedTop);
                     _p.dirtyRectInPx.bottom = std::max(_p.dirtyRectInPx.bottom, clampedBottom);
+                    _p.dirtySpansInPx.emplace_back(range<til::CoordType>{ clampedTop, clampedBottom });
                 }
 
                 r->clear(y, _p.s->font->cellSize.y);
@@ -246,8 +344,21 @@ try
 {
     _flushBufferLine();
 
+#if ATLAS_DEBUG_SHAPING_CACHE_STATS
+    if (const auto lookups = _api.shapingCacheHits + _api.shapingCacheMisses)
+    {
+        wchar_t buffer[128];
+        swprintf_s(buffer, L"shaping cache: %zu hits, %zu misses (%.1f%%)\n", _api.shapingCacheHits, _api.shapingCacheMisses, 100.0 * _api.shapingCacheHits / lookups);
+        OutputDebugStringW(&buffer[0]);
+    }
+#endif
+
+    _publishStats();
+
     _api.invalidatedCursorArea = invalidatedAreaNone;
     _api.invalidatedRows = invalidatedRowsNone;
+    _api.invalidatedRowRangesCount = 0;
+    _api.invalidatedRowRangesOverflow = false;
     _api.scrollOffset = 0;
     return S_OK;
 }
@@ -283,6 +394,46 @@ CATCH_RETURN()
     return S_OK;
 }
 
+[[nodiscard]] HRESULT AtlasEngine::PaintImageSlice(const ImageSlice& imageSlice, const til::CoordType targetRow, const til::CoordType viewportLeft) noexcept
+try
+{
+    if (targetRow < 0 || targetRow >= _p.s->cellCount.y)
+    {
+        return S_FALSE;
+    }
+
+    const auto row = _p.rows[targetRow];
+    const auto from = std::max(imageSlice.ColumnOffset(), viewportLeft);
+    const auto to = std::min(imageSlice.ColumnEnd(), viewportLeft + _p.s->cellCount.x);
+
+    row->imagePixels.clear();
+    if (from >= to)
+    {
+        return S_FALSE;
+    }
+
+    const auto cellSize = imageSlice.CellSize();
+    const auto srcStride = static_cast<size_t>(imageSlice.PixelWidth());
+    const auto dstStride = static_cast<size_t>(to - from) * cellSize.width;
+    row->imagePixels.resize(dstStride * cellSize.height);
+
+    auto src = imageSlice.PixelsAt(from);
+    auto dst = row->imagePixels.data();
+    for (til::CoordType y = 0; y < cellSize.height; ++y)
+    {
+        memcpy(dst, src, dstStride * sizeof(u32));
+        src += srcStride;
+        dst += dstStride;
+    }
+
+    row->imageCellSize = { gsl::narrow_cast<u16>(cellSize.width), gsl::narrow_cast<u16>(cellSize.height) };
+    row->imageColumnFrom = gsl::narrow_cast<u16>(from - viewportLeft);
+    row->imageColumnTo = gsl::narrow_cast<u16>(to - viewportLeft);
+    row->imageGeneration = ++_api.imageGeneration;
+    return S_OK;
+}
+CATCH_RETURN()
+
 [[nodiscard]] HRESULT AtlasEngine::PaintBackground() noexcept
 {
     return S_OK;
@@ -392,6 +543,7 @@ try
     _p.dirtyRectInPx.top = std::min(_p.dirtyRectInPx.top, y * _p.s->font->cellSize.y);
     _p.dirtyRectInPx.right = std::max(_p.dirtyRectInPx.right, to * _p.s->font->cellSize.x);
     _p.dirtyRectInPx.bottom = std::max(_p.dirtyRectInPx.bottom, _p.dirtyRectInPx.top + _p.s->font->cellSize.y);
+    _p.dirtySpansInPx.emplace_back(range<til::CoordType>{ y * _p.s->font->cellSize.y, (y + 1) * _p.s->font->cellSize.y });
     return S_OK;
 }
 CATCH_RETURN()
@@ -410,10 +562,10 @@ try
             .cursorType = gsl::narrow_cast<u16>(options.cursorType),
             .heightPercentage = gsl::narrow_cast<u16>(options.ulCursorHeightPercent),
         };
-        if (*_api.s->cursor != cachedOptions)
+        if (*_p.s->cursor != cachedOptions)
         {
-            *_api.s.write()->cursor.write() = cachedOptions;
             *_p.s.write()->cursor.write() = cachedOptions;
+            _api.pendingCursor = cachedOptions;
         }
     }
 
@@ -424,6 +576,7 @@ try
         _p.dirtyRectInPx.top = std::min(_p.dirtyRectInPx.top, r.top * _p.s->font->cellSize.y);
         _p.dirtyRectInPx.right = std::max(_p.dirtyRectInPx.right, r.right * _p.s->font->cellSize.x);
         _p.dirtyRectInPx.bottom = std::max(_p.dirtyRectInPx.bottom, r.bottom * _p.s->font->cellSize.y);
+        _p.dirtySpansInPx.emplace_back(range<til::CoordType>{ r.top * _p.s->font->cellSize.y, r.bottom * _p.s->font->cellSize.y });
     }
 
     if (options.isOn)
@@ -452,6 +605,7 @@ try
         _p.dirtyRectInPx.top = std::min(_p.dirtyRectInPx.top, top * _p.s->font->cellSize.y);
         _p.dirtyRectInPx.right = std::max(_p.dirtyRectInPx.right, right * _p.s->font->cellSize.x);
         _p.dirtyRectInPx.bottom = std::max(_p.dirtyRectInPx.bottom, bottom * _p.s->font->cellSize.y);
+        _p.dirtySpansInPx.emplace_back(range<til::CoordType>{ top * _p.s->font->cellSize.y, bottom * _p.s->font->cellSize.y });
     }
 
     return S_OK;
@@ -463,7 +617,8 @@ try
 {
     auto [fg, bg] = renderSettings.GetAttributeColorsWithAlpha(textAttributes);
     fg |= 0xff000000;
-    bg |= _api.backgroundOpaqueMixin;
+    // An opaque background allows us to use true "independent" flips. See AtlasEngine::_createSwapChain().
+    bg |= _p.s->target->enableTransparentBackground ? 0x00000000 : 0xff000000;
 
     if (!isSettingDefaultBrushes)
     {
@@ -534,6 +689,29 @@ void AtlasEngine::_recreateFontDependentResources()
     _api.replacementCharacterGlyphIndex = 0;
     _api.replacementCharacterLookedUp = false;
 
+    _api.primaryFont.reset();
+    _api.placeholderFontFace.reset();
+    _api.placeholderGlyphIndex = 0;
+    if (const auto& fontFamily = _p.s->font->fontFamily)
+    {
+        static constexpr u32 space = L' ';
+        THROW_IF_FAILED(fontFamily->GetFirstMatchingFont(static_cast<DWRITE_FONT_WEIGHT>(_p.s->font->fontWeight), DWRITE_FONT_STRETCH_NORMAL, DWRITE_FONT_STYLE_NORMAL, _api.primaryFont.addressof()));
+        wil::com_ptr<IDWriteFontFace> fontFace;
+        THROW_IF_FAILED(_api.primaryFont->CreateFontFace(fontFace.addressof()));
+        _api.placeholderFontFace = fontFace.query<IDWriteFontFace2>();
+        THROW_IF_FAILED(_api.placeholderFontFace->GetGlyphIndicesW(&space, 1, &_api.placeholderGlyphIndex));
+    }
+
+    {
+        const std::lock_guard lock{ _fontFallback.mutex };
+        _fontFallback.fontCollection = _p.s->font->fontCollection;
+        _fontFallback.fontName = _p.s->font->fontName;
+    }
+
+    // The cached glyphs and advances depend on the font.
+    _invalidateShapingCache();
+    _api.substitutionTables.clear();
+
     if (_p.s->font->fontAxisValues.empty())
     {
         for (auto& axes : _api.textFormatAxes)
@@ -562,6 +740,99 @@ void AtlasEngine::_recreateFontDependentResources()
             _api.textFormatAxes[i] = { fontAxisValues.data(), fontAxisValues.size() };
         }
     }
+
+    _recreatePrewarmGlyphs();
+}
+
+// Publishes the numbers behind GetMemoryUsage() and GetDiagnostics(), which may be called while a frame is painted.
+void AtlasEngine::_publishStats() noexcept
+{
+    static constexpr auto bytes = [](const auto& vec) noexcept {
+        return vec.capacity() * sizeof(vec[0]);
+    };
+
+    size_t rowBytes = 0;
+    for (const auto& row : _p.unorderedRows)
+    {
+        rowBytes += sizeof(row) + bytes(row.mappings) + bytes(row.glyphIndices) + bytes(row.glyphAdvances) + bytes(row.glyphOffsets) + bytes(row.colors) + bytes(row.gridLineRanges) + bytes(row.imagePixels);
+    }
+
+    size_t cacheBytes = 0;
+    for (const auto& entry : _api.shapingCache)
+    {
+        cacheBytes += sizeof(entry) + bytes(entry.text) + bytes(entry.columns) + bytes(entry.mappings) + bytes(entry.glyphIndices) + bytes(entry.glyphAdvances) + bytes(entry.glyphOffsets) + bytes(entry.glyphColumns);
+    }
+
+    _rowBytes.store(rowBytes, std::memory_order_relaxed);
+    _shapingCacheBytes.store(cacheBytes, std::memory_order_relaxed);
+    _dirtyRows.store(_api.dirtyRows, std::memory_order_relaxed);
+    _shapingCacheHits.store(_api.shapingCacheHits, std::memory_order_relaxed);
+    _shapingCacheMisses.store(_api.shapingCacheMisses, std::memory_order_relaxed);
+}
+
+void AtlasEngine::_invalidateShapingCache() noexcept
+{
+    for (auto& entry : _api.shapingCache)
+    {
+        entry.text.clear();
+        entry.mappings.clear();
+    }
+}
+
+// Maps printable ASCII, box drawing characters, block elements and Powerline symbols to their glyphs. Almost every
+// shell prompt and TUI uses these and rasterizing them ahead of time removes most of the work from the first frames.
+void AtlasEngine::_recreatePrewarmGlyphs()
+{
+    _p.prewarmMappings.clear();
+    _p.prewarmGlyphIndices.clear();
+
+    if constexpr (ATLAS_DEBUG_DISABLE_GLYPH_PREWARMING)
+    {
+        return;
+    }
+
+    static constexpr std::pair<wchar_t, wchar_t> ranges[]{
+        { 0x0021, 0x007E }, // Printable ASCII, except for whitespace
+        { 0x2500, 0x259F }, // Box Drawing, Block Elements
+        { 0xE0A0, 0xE0A3 }, // Powerline
+        { 0xE0B0, 0xE0BF }, // Powerline Extra
+    };
+
+    std::wstring text;
+    for (const auto& [first, last] : ranges)
+    {
+        for (auto ch = first; ch <= last; ++ch)
+        {
+            text.push_back(ch);
+        }
+    }
+
+    // The prewarmed glyphs are the regular, upright ones.
+    const auto attributes = std::exchange(_api.attributes, FontRelevantAttributes::None);
+    const auto restoreAttributes = wil::scope_exit([&]() noexcept {
+        _api.attributes = attributes;
+    });
+
+    std::vector<u32> codepoints;
+    wil::com_ptr<IDWriteFontFace2> mappedFontFace;
+
+    for (u32 idx = 0, mappedLength = 0; idx < text.size(); idx += mappedLength)
+    {
+        _mapCharacters(text.data() + idx, gsl::narrow_cast<u32>(text.size()) - idx, &mappedLength, mappedFontFace.put());
+
+        // Most fonts don't contain the Powerline symbols and that's fine. They're drawn with the replacement character.
+        if (!mappedFontFace)
+        {
+            continue;
+        }
+
+        // All of these are in the BMP, so each UTF-16 code unit is a codepoint.
+        codepoints.assign(text.begin() + idx, text.begin() + idx + mappedLength);
+        const auto from = _p.prewarmGlyphIndices.size();
+        _p.prewarmGlyphIndices.resize(from + mappedLength);
+        THROW_IF_FAILED(mappedFontFace->GetGlyphIndicesW(codepoints.data(), mappedLength, _p.prewarmGlyphIndices.data() + from));
+        _p.prewarmMappings.emplace_back(std::move(mappedFontFace), gsl::narrow_cast<u32>(from), gsl::narrow_cast<u32>(_p.prewarmGlyphIndices.size()));
+    }
 }
 
 void AtlasEngine::_recreateCellCountDependentResources()
@@ -583,6 +854,11 @@ void AtlasEngine::_recreateCellCountDependentResources()
     _api.glyphProps = Buffer<DWRITE_SHAPING_GLYPH_PROPERTIES>{ projectedGlyphSize };
     _api.glyphAdvances = Buffer<f32>{ projectedGlyphSize };
     _api.glyphOffsets = Buffer<DWRITE_GLYPH_OFFSET>{ projectedGlyphSize };
+    _api.glyphColumns.reserve(projectedGlyphSize);
+
+    // The renderer flushes a buffer line for every run of attributes. 4 per row leaves some room for those,
+    // as well as for rows that scrolled out of the viewport and may scroll back in. The size must be a power of 2.
+    _api.shapingCache = Buffer<ShapingCacheEntry>{ std::bit_ceil(static_cast<size_t>(_p.s->cellCount.y) * 4) };
 
     _p.unorderedRows = Buffer<ShapedRow>(_p.s->cellCount.y);
     _p.rowsScratch = Buffer<ShapedRow*>(_p.s->cellCount.y);
@@ -623,14 +899,117 @@ void AtlasEngine::_flushBufferLine()
     Expects(_api.bufferLineColumn.size() == _api.bufferLine.size() + 1);
 
     auto& row = *_p.rows[_api.lastPaintBufferLineCoord.y];
+    const auto glyphsBegin = row.glyphIndices.size();
+
+    til::hasher hasher{ static_cast<size_t>(_api.attributes) };
+    hasher.write(_api.bufferLine.data(), _api.bufferLine.size());
+    hasher.write(_api.bufferLineColumn.data(), _api.bufferLineColumn.size());
+    const auto hash = hasher.finalize();
+    auto& entry = _api.shapingCache[hash & (_api.shapingCache.size() - 1)];
+
+    if (entry.hash == hash && entry.attributes == _api.attributes && entry.text == _api.bufferLine && entry.columns == _api.bufferLineColumn)
+    {
+        _api.shapingCacheHits++;
+
+        for (const auto& m : entry.mappings)
+        {
+            const auto from = gsl::narrow_cast<u32>(glyphsBegin + m.glyphsFrom);
+            const auto to = gsl::narrow_cast<u32>(glyphsBegin + m.glyphsTo);
+
+            // Same as in _shapeBufferLine(): The previous line on this row may have ended with the same font face.
+            if (row.mappings.empty() || row.mappings.back().fontFace != m.fontFace)
+            {
+                row.mappings.emplace_back(m.fontFace, from, to);
+            }
+            else
+            {
+                row.mappings.back().glyphsTo = to;
+            }
+        }
+
+        row.glyphIndices.insert(row.glyphIndices.end(), entry.glyphIndices.begin(), entry.glyphIndices.end());
+        row.glyphAdvances.insert(row.glyphAdvances.end(), entry.glyphAdvances.begin(), entry.glyphAdvances.end());
+        row.glyphOffsets.insert(row.glyphOffsets.end(), entry.glyphOffsets.begin(), entry.glyphOffsets.end());
+        _api.glyphColumns.assign(entry.glyphColumns.begin(), entry.glyphColumns.end());
+    }
+    else
+    {
+        _api.shapingCacheMisses++;
+        _api.glyphColumns.clear();
+        _api.deferredGlyphs = false;
+        _shapeBufferLine(row);
+
+        if (!_api.fallbackQueue.empty())
+        {
+            _submitFontFallback();
+        }
+
+        entry.hash = hash;
+        entry.attributes = _api.attributes;
+        entry.text.assign(_api.bufferLine.begin(), _api.bufferLine.end());
+        entry.columns.assign(_api.bufferLineColumn.begin(), _api.bufferLineColumn.end());
+        entry.mappings.clear();
+        for (const auto& m : row.mappings)
+        {
+            // The first mapping may have been extended from the previous line on this row.
+            if (m.glyphsTo > glyphsBegin)
+            {
+                const auto from = std::max<size_t>(m.glyphsFrom, glyphsBegin) - glyphsBegin;
+                entry.mappings.emplace_back(m.fontFace, gsl::narrow_cast<u32>(from), gsl::narrow_cast<u32>(m.glyphsTo - glyphsBegin));
+            }
+        }
+        entry.glyphIndices.assign(row.glyphIndices.begin() + glyphsBegin, row.glyphIndices.end());
+        entry.glyphAdvances.assign(row.glyphAdvances.begin() + glyphsBegin, row.glyphAdvances.end());
+        entry.glyphOffsets.assign(row.glyphOffsets.begin() + glyphsBegin, row.glyphOffsets.end());
+        entry.glyphColumns.assign(_api.glyphColumns.begin(), _api.glyphColumns.end());
+
+        // The placeholders must not end up in the cache, or the line would never be shaped properly.
+        if (_api.deferredGlyphs)
+        {
+            entry.text.clear();
+        }
+    }
+
+    // The colors aren't part of the cache key, as they're looked up from the foreground bitmap for each glyph.
+    const auto shift = gsl::narrow_cast<u8>(row.lineRendition != LineRendition::SingleWidth);
+    const auto colors = _p.foregroundBitmap.begin() + _p.colorBitmapRowStride * _api.lastPaintBufferLineCoord.y;
+    for (const auto col : _api.glyphColumns)
+    {
+        row.colors.emplace_back(colors[static_cast<size_t>(col) << shift]);
+    }
+}
 
+// Shapes the text in _api.bufferLine and appends the results to the given row.
+// The column of each glyph is appended to _api.glyphColumns.
+void AtlasEngine::_shapeBufferLine(ShapedRow& row)
+{
     wil::com_ptr<IDWriteFontFace2> mappedFontFace;
 
 #pragma warning(suppress : 26494) // Variable 'mappedEnd' is uninitialized. Always initialize an object (type.5).
     for (u32 idx = 0, mappedEnd; idx < _api.bufferLine.size(); idx = mappedEnd)
     {
+        if (_isBuiltinGlyphAt(idx))
+        {
+            mappedEnd = idx + 1;
+            while (mappedEnd < _api.bufferLine.size() && _isBuiltinGlyphAt(mappedEnd))
+            {
+                ++mappedEnd;
+            }
+            _mapBuiltinGlyphs(idx, mappedEnd, row);
+            continue;
+        }
+
+        u32 deferredLength = 0;
+        const auto resolvedLength = _resolvedFallbackLength(idx, &deferredLength);
+        if (!resolvedLength)
+        {
+            mappedEnd = idx + deferredLength;
+            _mapPlaceholder(idx, mappedEnd, row);
+            continue;
+        }
+
         u32 mappedLength = 0;
-        _mapCharacters(_api.bufferLine.data() + idx, gsl::narrow_cast<u32>(_api.bufferLine.size()) - idx, &mappedLength, mappedFontFace.put());
+        _mapCharacters(_api.bufferLine.data() + idx, resolvedLength, &mappedLength, mappedFontFace.put());
         mappedEnd = idx + mappedLength;
 
         if (!mappedFontFace)
@@ -657,21 +1036,24 @@ void AtlasEngine::_flushBufferLine()
             BOOL isTextSimple = FALSE;
             THROW_IF_FAILED(_p.textAnalyzer->GetTextComplexity(_api.bufferLine.data() + idx, mappedEnd - idx, mappedFontFace.get(), &isTextSimple, &complexityLength, _api.glyphIndices.data()));
 
-            if (isTextSimple)
+            // Fonts with ligatures (like Cascadia Code) make all text complex, but most of it
+            // contains nothing their substitutions apply to, and would be shaped for nothing.
+            if (!isTextSimple && _tryMapWithoutShaping(mappedFontFace.get(), idx, complexityLength))
             {
-                const auto shift = gsl::narrow_cast<u8>(row.lineRendition != LineRendition::SingleWidth);
-                const auto colors = _p.foregroundBitmap.begin() + _p.colorBitmapRowStride * _api.lastPaintBufferLineCoord.y;
+                isTextSimple = TRUE;
+            }
 
+            if (isTextSimple)
+            {
                 for (size_t i = 0; i < complexityLength; ++i)
                 {
-                    const size_t col1 = _api.bufferLineColumn[idx + i + 0];
-                    const size_t col2 = _api.bufferLineColumn[idx + i + 1];
+                    const auto col1 = _api.bufferLineColumn[idx + i + 0];
+                    const auto col2 = _api.bufferLineColumn[idx + i + 1];
                     const auto glyphAdvance = (col2 - col1) * _p.s->font->cellSize.x;
-                    const auto fg = colors[col1 << shift];
                     row.glyphIndices.emplace_back(_api.glyphIndices[i]);
                     row.glyphAdvances.emplace_back(static_cast<f32>(glyphAdvance));
                     row.glyphOffsets.emplace_back();
-                    row.colors.emplace_back(fg);
+                    _api.glyphColumns.emplace_back(col1);
                 }
             }
             else
@@ -697,6 +1079,116 @@ void AtlasEngine::_flushBufferLine()
     }
 }
 
+// Returns the length of the text at _api.bufferLine[idx] that _mapCharacters() can map without
+// having to load a fallback font. If that's 0, *deferredLength is the length of the text that
+// has to wait for _fontFallbackCallback() instead, which this function queues up.
+u32 AtlasEngine::_resolvedFallbackLength(const u32 idx, u32* deferredLength)
+{
+    const auto beg = _api.bufferLine.data();
+    const auto len = gsl::narrow_cast<u32>(_api.bufferLine.size());
+    auto pos = idx;
+    bool firstResolved = true;
+
+    while (pos < len)
+    {
+        // Builtin glyphs are mapped by _shapeBufferLine() itself.
+        if (pos != idx && _isBuiltinGlyphAt(pos))
+        {
+            break;
+        }
+
+        char32_t cp = beg[pos];
+        u32 cpLength = 1;
+
+        if (til::is_leading_surrogate(beg[pos]) && pos + 1 < len && til::is_trailing_surrogate(beg[pos + 1]))
+        {
+            cp = (cp - 0xD800) * 0x400 + (beg[pos + 1] - 0xDC00) + 0x10000;
+            cpLength = 2;
+        }
+
+        const auto resolved = _isFallbackResolved(cp);
+        if (pos == idx)
+        {
+            firstResolved = resolved;
+        }
+        else if (resolved != firstResolved)
+        {
+            break;
+        }
+
+        if (!resolved && _api.fallbackPending.emplace(cp).second)
+        {
+            _api.fallbackQueue.emplace_back(cp);
+        }
+
+        pos += cpLength;
+    }
+
+    if (firstResolved)
+    {
+        return pos - idx;
+    }
+
+    *deferredLength = pos - idx;
+    return 0;
+}
+
+bool AtlasEngine::_isFallbackResolved(const char32_t codepoint)
+{
+    // Without a placeholder we can't defer anything.
+    if (codepoint < 0x80 || !_api.placeholderFontFace || _api.fallbackResolved.contains(codepoint))
+    {
+        return true;
+    }
+
+    // Anything that's part of the primary font is cheap to map.
+    BOOL exists = FALSE;
+    if (SUCCEEDED(_api.primaryFont->HasCharacter(codepoint, &exists)) && exists)
+    {
+        _api.fallbackResolved.emplace(codepoint);
+        return true;
+    }
+
+    return false;
+}
+
+// Returns true if the character at _api.bufferLine[pos] is drawn by the backend itself.
+// That's only the case if it's a cluster of its own, as the backend can't draw combining marks on top of it.
+bool AtlasEngine::_isBuiltinGlyphAt(const u32 pos) const noexcept
+{
+    const auto col = _api.bufferLineColumn[pos];
+    return _p.builtinGlyphs &&
+           IsBuiltinGlyph(_api.bufferLine[pos]) &&
+           (pos == 0 || _api.bufferLineColumn[pos - 1] != col) &&
+           _api.bufferLineColumn[pos + 1] != col;
+}
+
+// Appends the builtin glyphs between from and to. See IsBuiltinGlyph().
+void AtlasEngine::_mapBuiltinGlyphs(u32 from, u32 to, ShapedRow& row)
+{
+    const auto initialIndicesCount = row.glyphIndices.size();
+
+    for (auto pos = from; pos < to; ++pos)
+    {
+        const auto col1 = _api.bufferLineColumn[pos];
+        const auto col2 = _api.bufferLineColumn[pos + 1];
+        row.glyphIndices.emplace_back(static_cast<u16>(_api.bufferLine[pos]));
+        row.glyphAdvances.emplace_back(static_cast<f32>((col2 - col1) * _p.s->font->cellSize.x));
+        row.glyphOffsets.emplace_back();
+        _api.glyphColumns.emplace_back(col1);
+    }
+
+    const auto indicesCount = gsl::narrow_cast<u32>(row.glyphIndices.size());
+    if (row.mappings.empty() || row.mappings.back().fontFace)
+    {
+        row.mappings.emplace_back(nullptr, gsl::narrow_cast<u32>(initialIndicesCount), indicesCount);
+    }
+    else
+    {
+        row.mappings.back().glyphsTo = indicesCount;
+    }
+}
+
 void AtlasEngine::_mapCharacters(const wchar_t* text, const u32 textLength, u32* mappedLength, IDWriteFontFace2** mappedFontFace) const
 {
     TextAnalysisSource analysisSource{ text, textLength };
@@ -750,6 +1242,94 @@ void AtlasEngine::_mapCharacters(const wchar_t* text, const u32 textLength, u32*
     assert(scale == 1);
 }
 
+// If none of the given text can be affected by the font's GSUB features, this writes the glyphs of the text into
+// _api.glyphIndices, the way GetTextComplexity() does for simple text, and returns true. Otherwise it returns false.
+// Any GSUB lookup starts at a glyph in its coverage table, so a run without such a glyph can't change when shaped.
+// The run isn't split up, since the glyphs around a candidate may be its context (e.g. for contextual alternates).
+bool AtlasEngine::_tryMapWithoutShaping(IDWriteFontFace2* mappedFontFace, const u32 idx, const u32 length)
+{
+    const auto text = _api.bufferLine.data() + idx;
+    if (!std::all_of(text, text + length, [](const wchar_t ch) { return ch < SubstitutionTableSize; }))
+    {
+        return false;
+    }
+
+    const SubstitutionTable* table = nullptr;
+    for (const auto& t : _api.substitutionTables)
+    {
+        if (t.fontFace.get() == mappedFontFace)
+        {
+            table = &t;
+            break;
+        }
+    }
+
+    if (!table)
+    {
+        // IDWriteFontFallback::MapCharacters() returns the same few font faces over and over,
+        // but this ensures that we can't accumulate tables for font faces that are long gone.
+        if (_api.substitutionTables.size() >= 16)
+        {
+            _api.substitutionTables.clear();
+        }
+
+        // The GSUB features DirectWrite applies by default to the scripts below SubstitutionTableSize (see _updateFont()),
+        // adjusted by fontFeatures. Erring on the side of too many features only means that more text gets shaped.
+        std::vector<u32> features{
+            DWRITE_FONT_FEATURE_TAG_GLYPH_COMPOSITION_DECOMPOSITION,
+            DWRITE_FONT_FEATURE_TAG_LOCALIZED_FORMS,
+            DWRITE_FONT_FEATURE_TAG_REQUIRED_LIGATURES,
+            DWRITE_MAKE_OPENTYPE_TAG('r', 'c', 'l', 't'),
+            DWRITE_FONT_FEATURE_TAG_STANDARD_LIGATURES,
+            DWRITE_FONT_FEATURE_TAG_CONTEXTUAL_LIGATURES,
+            DWRITE_FONT_FEATURE_TAG_CONTEXTUAL_ALTERNATES,
+        };
+        for (const auto& f : _p.s->font->fontFeatures)
+        {
+            if (f.parameter)
+            {
+                features.emplace_back(f.nameTag);
+            }
+            else
+            {
+                std::erase(features, static_cast<u32>(f.nameTag));
+            }
+        }
+
+        const auto substituted = DWrite_GetSubstitutedGlyphs(mappedFontFace, features.data(), features.size());
+
+        std::array<u32, SubstitutionTableSize> codepoints;
+        for (u32 i = 0; i < SubstitutionTableSize; ++i)
+        {
+            codepoints[i] = i;
+        }
+
+        auto& t = _api.substitutionTables.emplace_back();
+        t.fontFace = mappedFontFace;
+        THROW_IF_FAILED(mappedFontFace->GetGlyphIndicesW(codepoints.data(), SubstitutionTableSize, t.simpleGlyphs.data()));
+        for (auto& glyph : t.simpleGlyphs)
+        {
+            if (glyph < substituted.size() && substituted[glyph])
+            {
+                glyph = 0;
+            }
+        }
+        table = &t;
+    }
+
+    for (u32 i = 0; i < length; ++i)
+    {
+        const auto glyph = table->simpleGlyphs[text[i]];
+        if (!glyph)
+        {
+            return false;
+        }
+        _api.glyphIndices[i] = glyph;
+    }
+
+    return true;
+}
+
 void AtlasEngine::_mapComplex(IDWriteFontFace2* mappedFontFace, u32 idx, u32 length, ShapedRow& row)
 {
     _api.analysisResults.clear();
@@ -860,8 +1440,6 @@ void AtlasEngine::_mapComplex(IDWriteFontFace2* mappedFontFace, u32 idx, u32 len
 
         _api.clusterMap[a.textLength] = gsl::narrow_cast<u16>(actualGlyphCount);
 
-        const auto shift = gsl::narrow_cast<u8>(row.lineRendition != LineRendition::SingleWidth);
-        const auto colors = _p.foregroundBitmap.begin() + _p.colorBitmapRowStride * _api.lastPaintBufferLineCoord.y;
         auto prevCluster = _api.clusterMap[0];
         size_t beg = 0;
 
@@ -875,7 +1453,6 @@ void AtlasEngine::_mapComplex(IDWriteFontFace2* mappedFontFace, u32 idx, u32 len
 
             const size_t col1 = _api.bufferLineColumn[a.textPosition + beg];
             const size_t col2 = _api.bufferLineColumn[a.textPosition + i];
-            const auto fg = colors[col1 << shift];
 
             const auto expectedAdvance = (col2 - col1) * _p.s->font->cellSize.x;
             f32 actualAdvance = 0;
@@ -885,7 +1462,7 @@ void AtlasEngine::_mapComplex(IDWriteFontFace2* mappedFontFace, u32 idx, u32 len
             }
             _api.glyphAdvances[nextCluster - 1] += expectedAdvance - actualAdvance;
 
-            row.colors.insert(row.colors.end(), nextCluster - prevCluster, fg);
+            _api.glyphColumns.insert(_api.glyphColumns.end(), nextCluster - prevCluster, gsl::narrow_cast<u16>(col1));
 
             prevCluster = nextCluster;
             beg = i;
@@ -897,6 +1474,102 @@ void AtlasEngine::_mapComplex(IDWriteFontFace2* mappedFontFace, u32 idx, u32 len
     }
 }
 
+// Appends a blank glyph per cell for the text between from and to, which is waiting for its font fallback.
+void AtlasEngine::_mapPlaceholder(u32 from, u32 to, ShapedRow& row)
+{
+    const auto initialIndicesCount = row.glyphIndices.size();
+    auto col1 = _api.bufferLineColumn[from];
+
+    for (auto pos = from; pos < to;)
+    {
+        const auto col2 = _api.bufferLineColumn[++pos];
+        if (col1 == col2)
+        {
+            continue;
+        }
+
+        row.glyphIndices.emplace_back(_api.placeholderGlyphIndex);
+        row.glyphAdvances.emplace_back(static_cast<f32>((col2 - col1) * _p.s->font->cellSize.x));
+        row.glyphOffsets.emplace_back();
+        _api.glyphColumns.emplace_back(col1);
+        col1 = col2;
+    }
+
+    const auto indicesCount = row.glyphIndices.size();
+    if (indicesCount > initialIndicesCount)
+    {
+        row.mappings.emplace_back(_api.placeholderFontFace.get(), gsl::narrow_cast<u32>(initialIndicesCount), gsl::narrow_cast<u32>(indicesCount));
+    }
+
+    _api.deferredGlyphs = true;
+}
+
+void AtlasEngine::_submitFontFallback()
+{
+    {
+        const std::lock_guard lock{ _fontFallback.mutex };
+        _fontFallback.pending.insert(_fontFallback.pending.end(), _api.fallbackQueue.begin(), _api.fallbackQueue.end());
+    }
+    _api.fallbackQueue.clear();
+    SubmitThreadpoolWork(_fontFallback.work.get());
+}
+
+// Runs IDWriteFontFallback::MapCharacters() for the queued up codepoints, which loads their fallback font
+// into the shared DirectWrite factory. Once StartPaint() picks up the results, mapping them is cheap.
+void CALLBACK AtlasEngine::_fontFallbackCallback(PTP_CALLBACK_INSTANCE, void* context, PTP_WORK) noexcept
+{
+    auto& state = *static_cast<FontFallbackState*>(context);
+    std::vector<char32_t> pending;
+    wil::com_ptr<IDWriteFontFallback> fontFallback;
+    wil::com_ptr<IDWriteFontCollection> fontCollection;
+    std::wstring fontName;
+
+    for (;;)
+    {
+        {
+            const std::lock_guard lock{ state.mutex };
+            state.resolved.insert(state.resolved.end(), pending.begin(), pending.end());
+            pending.clear();
+            if (state.pending.empty())
+            {
+                return;
+            }
+            pending.swap(state.pending);
+            fontFallback = state.fontFallback;
+            fontCollection = state.fontCollection;
+            fontName = state.fontName;
+        }
+
+        for (const auto cp : pending)
+        {
+            wchar_t text[2];
+            u32 textLength = 1;
+            if (cp < 0x10000)
+            {
+                text[0] = static_cast<wchar_t>(cp);
+            }
+            else
+            {
+                text[0] = static_cast<wchar_t>(0xD800 + ((cp - 0x10000) >> 10));
+                text[1] = static_cast<wchar_t>(0xDC00 + ((cp - 0x10000) & 0x3FF));
+                textLength = 2;
+            }
+
+            // Failures are fine: The codepoint gets mapped on the render thread
+            // anyway, which will then turn it into a replacement character.
+            TextAnalysisSource analysisSource{ &text[0], textLength };
+            wil::com_ptr<IDWriteFont> font;
+            wil::com_ptr<IDWriteFontFace> fontFace;
+            u32 mappedLength = 0;
+            f32 scale = 1;
+            if (SUCCEEDED(fontFallback->MapCharacters(&analysisSource, 0, textLength, fontCollection.get(), fontName.c_str(), DWRITE_FONT_WEIGHT_NORMAL, DWRITE_FONT_STYLE_NORMAL, DWRITE_FONT_STRETCH_NORMAL, &mappedLength, font.addressof(), &scale)) && font)
+            {
+                LOG_IF_FAILED(font->CreateFontFace(fontFace.addressof()));
+            }
+        }
+    }
+}
+
 void AtlasEngine::_mapReplacementCharacter(u32 from, u32 to, ShapedRow& row)
 {
     if (!_api.replacementCharacterLookedUp)
@@ -937,8 +1610,6 @@ void AtlasEngine::_mapReplacementCharacter(u32 from, u32 to, ShapedRow& row)
     auto initialIndicesCount = row.glyphIndices.size();
     const auto softFontAvailable = !_p.s->font->softFontPattern.empty();
     auto currentlyMappingSoftFont = isSoftFontChar(_api.bufferLine[pos1]);
-    const auto shift = gsl::narrow_cast<u8>(row.lineRendition != LineRendition::SingleWidth);
-    const auto colors = _p.foregroundBitmap.begin() + _p.colorBitmapRowStride * _api.lastPaintBufferLineCoord.y;
 
     while (pos2 < to)
     {
@@ -955,7 +1626,7 @@ void AtlasEngine::_mapReplacementCharacter(u32 from, u32 to, ShapedRow& row)
         row.glyphIndices.emplace_back(nowMappingSoftFont ? ch : _api.replacementCharacterGlyphIndex);
         row.glyphAdvances.emplace_back(static_cast<f32>(cols * _p.s->font->cellSize.x));
         row.glyphOffsets.emplace_back();
-        row.colors.emplace_back(colors[col1 << shift]);
+        _api.glyphColumns.emplace_back(gsl::narrow_cast<u16>(col1));
 
         if (currentlyMappingSoftFont != nowMappingSoftFont)
         {
@@ -44,6 +44,7 @@ namespace Microsoft::Console::Render::Atlas
         [[nodiscard]] HRESULT PaintBackground() noexcept override;
         [[nodiscard]] HRESULT PaintBufferLine(std::span<const Cluster> clusters, til::point coord, bool fTrimLeft, bool lineWrapped) noexcept override;
         [[nodiscard]] HRESULT PaintBufferGridLines(GridLineSet lines, COLORREF color, size_t cchLine, til::point coordTarget) noexcept override;
+        [[nodiscard]] HRESULT PaintImageSlice(const ImageSlice& imageSlice, til::CoordType targetRow, til::CoordType viewportLeft) noexcept override;
         [[nodiscard]] HRESULT PaintSelection(const til::rect& rect) noexcept override;
         [[nodiscard]] HRESULT PaintCursor(const CursorOptions& options) noexcept override;
         [[nodiscard]] HRESULT UpdateDrawingBrushes(const TextAttribute& textAttributes, const RenderSettings& renderSettings, gsl::not_null<IRenderData*> pData, bool usingSoftFont, bool isSettingDefaultBrushes) noexcept override;
@@ -59,17 +60,28 @@ namespace Microsoft::Console::Render::Atlas
 
         // DxRenderer - getter
         HRESULT Enable() noexcept override;
+        [[nodiscard]] std::chrono::milliseconds GetContinuousRedrawInterval() noexcept override;
         [[nodiscard]] std::wstring_view GetPixelShaderPath() noexcept override;
         [[nodiscard]] bool GetRetroTerminalEffect() const noexcept override;
         [[nodiscard]] float GetScaling() const noexcept override;
         [[nodiscard]] Types::Viewport GetViewportInCharacters(const Types::Viewport& viewInPixels) const noexcept override;
         [[nodiscard]] Types::Viewport GetViewportInPixels(const Types::Viewport& viewInCharacters) const noexcept override;
+        [[nodiscard]] bool SupportsUnlockedPainting() const noexcept override;
+        [[nodiscard]] RenderEngineMemoryUsage GetMemoryUsage() const noexcept override;
+        [[nodiscard]] RenderEngineDiagnostics GetDiagnostics() const noexcept override;
+        void TrimMemory() noexcept override;
+        void ReleaseDeviceResources() noexcept override;
+        // For benchmarks: Measuring the GPU time stalls the pipeline after every frame.
+        void EnableGpuTiming(bool enable) noexcept;
+        [[nodiscard]] FrameCounters LastFrameCounters() const noexcept;
         // DxRenderer - setter
         void SetAntialiasingMode(D2D1_TEXT_ANTIALIAS_MODE antialiasingMode) noexcept override;
         void SetCallback(std::function<void(HANDLE)> pfn) noexcept override;
         void EnableTransparentBackground(const bool isTransparent) noexcept override;
         void SetForceFullRepaintRendering(bool enable) noexcept override;
         [[nodiscard]] HRESULT SetHwnd(HWND hwnd) noexcept override;
+        void SetPixelShaderAnimationPaused(bool paused) noexcept override;
+        void SetPixelShaderFrameInterval(std::chrono::milliseconds interval) noexcept override;
         void SetPixelShaderPath(std::wstring_view value) noexcept override;
         void SetRetroTerminalEffect(bool enable) noexcept override;
         void SetSelectionBackground(COLORREF color, float alpha = 0.5f) noexcept override;
@@ -83,11 +95,23 @@ namespace Microsoft::Console::Render::Atlas
         // AtlasEngine.cpp
         ATLAS_ATTR_COLD void _handleSettingsUpdate();
         void _recreateFontDependentResources();
+        void _publishStats() noexcept;
+        void _invalidateShapingCache() noexcept;
+        void _recreatePrewarmGlyphs();
         void _recreateCellCountDependentResources();
         void _flushBufferLine();
+        void _shapeBufferLine(ShapedRow& row);
+        u32 _resolvedFallbackLength(u32 idx, u32* deferredLength);
+        bool _isFallbackResolved(char32_t codepoint);
+        bool _isBuiltinGlyphAt(u32 pos) const noexcept;
+        void _mapBuiltinGlyphs(u32 from, u32 to, ShapedRow& row);
         void _mapCharacters(const wchar_t* text, u32 textLength, u32* mappedLength, IDWriteFontFace2** mappedFontFace) const;
+        bool _tryMapWithoutShaping(IDWriteFontFace2* mappedFontFace, u32 idx, u32 length);
         void _mapComplex(IDWriteFontFace2* mappedFontFace, u32 idx, u32 length, ShapedRow& row);
         ATLAS_ATTR_COLD void _mapReplacementCharacter(u32 from, u32 to, ShapedRow& row);
+        void _mapPlaceholder(u32 from, u32 to, ShapedRow& row);
+        void _submitFontFallback();
+        static void CALLBACK _fontFallbackCallback(PTP_CALLBACK_INSTANCE instance, void* context, PTP_WORK work) noexcept;
 
         // AtlasEngine.api.cpp
         void _resolveTransparencySettings() noexcept;
@@ -102,7 +126,11 @@ namespace Microsoft::Console::Render::Atlas
         void _resizeBuffers();
         void _updateMatrixTransform();
         void _waitUntilCanRender() noexcept;
+        void _invalidateRows(u16 start, u16 end) noexcept;
         void _present();
+        void _debugFrameStats(int64_t frameStart) noexcept;
+        void _beginGpuTiming();
+        f32 _endGpuTiming();
 
         static constexpr u16 u16min = 0x0000;
         static constexpr u16 u16max = 0xffff;
@@ -112,6 +140,33 @@ namespace Microsoft::Console::Render::Atlas
         static constexpr range<u16> invalidatedRowsNone{ u16max, u16min };
         static constexpr range<u16> invalidatedRowsAll{ u16min, u16max };
 
+        // _tryMapWithoutShaping() handles the characters below this limit. It covers the
+        // Latin scripts up to, but excluding, the combining diacritical marks at U+0300.
+        static constexpr u32 SubstitutionTableSize = 0x300;
+
+        // The glyph of each character below SubstitutionTableSize in the given font face, or 0 if the
+        // enabled GSUB features (ligatures, contextual alternates and so on) may substitute it.
+        struct SubstitutionTable
+        {
+            wil::com_ptr<IDWriteFontFace2> fontFace;
+            std::array<u16, SubstitutionTableSize> simpleGlyphs{};
+        };
+
+        // The result of shaping a _api.bufferLine with _shapeBufferLine(), so that it can be reused for identical
+        // text. The text, columns and attributes are the key. The rest is what _shapeBufferLine() appended to the row.
+        struct ShapingCacheEntry
+        {
+            size_t hash = 0;
+            FontRelevantAttributes attributes = FontRelevantAttributes::None;
+            std::vector<wchar_t> text; // empty if the entry is unused
+            std::vector<u16> columns;
+            std::vector<FontMapping> mappings; // glyphsFrom/glyphsTo are relative to the first glyph
+            std::vector<u16> glyphIndices;
+            std::vector<f32> glyphAdvances;
+            std::vector<DWRITE_GLYPH_OFFSET> glyphOffsets;
+            std::vector<u16> glyphColumns;
+        };
+
         std::unique_ptr<IBackend> _b;
         RenderingPayload _p;
 
@@ -127,6 +182,12 @@ namespace Microsoft::Console::Render::Atlas
             // turns the given settings into potentially different actual settings (which are then written into the Settings).
             bool enableTransparentBackground = false;
             AntialiasingMode antialiasingMode = DefaultAntialiasingMode;
+            // SetPixelShaderAnimationPaused() and SetPixelShaderFrameInterval()
+            bool pixelShaderAnimationPaused = false;
+            std::chrono::milliseconds pixelShaderFrameInterval{};
+            // The pixelShaderFrameInterval as of the last StartPaint(). It's what GetContinuousRedrawInterval()
+            // returns, because it's called after the frame, when the setters may run concurrently.
+            std::chrono::milliseconds continuousRedrawInterval{};
 
             std::vector<wchar_t> bufferLine;
             std::vector<u16> bufferLineColumn;
@@ -139,15 +200,42 @@ namespace Microsoft::Console::Render::Atlas
             Buffer<DWRITE_SHAPING_GLYPH_PROPERTIES> glyphProps;
             Buffer<f32> glyphAdvances;
             Buffer<DWRITE_GLYPH_OFFSET> glyphOffsets;
+            // The column of each glyph _shapeBufferLine() appended, which determines its foreground color.
+            std::vector<u16> glyphColumns;
+
+            // A direct-mapped cache of shaped buffer lines, indexed by ShapingCacheEntry::hash.
+            // When scrolling, most rows are identical to rows that were shaped in a previous frame.
+            Buffer<ShapingCacheEntry> shapingCache;
+            // One for each font face _shapeBufferLine() came across. Reset when the font changes.
+            std::vector<SubstitutionTable> substitutionTables;
+            size_t shapingCacheHits = 0;
+            size_t shapingCacheMisses = 0;
+            // The total number of rows that StartPaint() found to be invalidated.
+            size_t dirtyRows = 0;
 
             wil::com_ptr<IDWriteFontFace2> replacementCharacterFontFace;
             u16 replacementCharacterGlyphIndex = 0;
             bool replacementCharacterLookedUp = false;
 
+            // Codepoints outside the primary font are drawn with _placeholderFontFace (a blank glyph) until
+            // _fontFallback has run IDWriteFontFallback::MapCharacters() for them once, which loads the fallback
+            // font. That can take tens of milliseconds for a font that isn't cached yet and would stall the frame.
+            wil::com_ptr<IDWriteFont> primaryFont;
+            wil::com_ptr<IDWriteFontFace2> placeholderFontFace;
+            u16 placeholderGlyphIndex = 0;
+            std::unordered_set<char32_t> fallbackResolved;
+            std::unordered_set<char32_t> fallbackPending;
+            std::vector<char32_t> fallbackQueue; // the part of fallbackPending that wasn't submitted yet
+            bool deferredGlyphs = false; // set by _shapeBufferLine() if it used the placeholder
+
             // PrepareLineTransform()
             LineRendition lineRendition = LineRendition::SingleWidth;
+            // PaintImageSlice()
+            u64 imageGeneration = 0;
+            // PaintCursor() only updates _p.s, since it may run concurrently with the setters.
+            // The next StartPaint() applies it to `s` as well.
+            std::optional<CursorSettings> pendingCursor;
             // UpdateDrawingBrushes()
-            u32 backgroundOpaqueMixin = 0xff000000;
             u32 currentBackground = 0;
             u32 currentForeground = 0;
             FontRelevantAttributes attributes = FontRelevantAttributes::None;
@@ -155,13 +243,68 @@ namespace Microsoft::Console::Render::Atlas
             // UpdateHyperlinkHoveredId()
             u16 hyperlinkHoveredId = 0;
 
-            // dirtyRect is a computed value based on invalidatedRows.
-            til::rect dirtyRect;
+            // dirtyRects is a computed value based on invalidatedRows and invalidatedRowRanges.
+            std::vector<til::rect> dirtyRects;
             // These "invalidation" fields are reset in EndPaint()
             u16r invalidatedCursorArea = invalidatedAreaNone;
             range<u16> invalidatedRows = invalidatedRowsNone; // x is treated as "top" and y as "bottom"
+            // The individual ranges that make up invalidatedRows. If there are too many of them or if they
+            // can't be tracked individually (e.g. when scrolling), invalidatedRowRangesOverflow is set.
+            std::array<range<u16>, 8> invalidatedRowRanges{};
+            u8 invalidatedRowRangesCount = 0;
+            bool invalidatedRowRangesOverflow = false;
             i16 scrollOffset = 0;
         } _api;
+
+        // Only used if ATLAS_DEBUG_FRAME_STATS is set. See _debugFrameStats().
+        struct FrameStats
+        {
+            UINT presentCount = 0;
+            UINT syncRefreshCount = 0;
+            int64_t cpuTime = 0;
+            u32 frames = 0;
+        } _frameStats;
+
+        // Only used after EnableGpuTiming(true). The queries belong to the given device,
+        // which may change when the adapter or the backend is recreated.
+        struct GpuTiming
+        {
+            bool enabled = false;
+            wil::com_ptr<ID3D11Device> device;
+            wil::com_ptr<ID3D11Query> disjoint;
+            wil::com_ptr<ID3D11Query> begin;
+            wil::com_ptr<ID3D11Query> end;
+        } _gpuTiming;
+        FrameCounters _lastFrameCounters;
+
+        // Written by Present() and read by GetMemoryUsage(), which don't hold the same locks.
+        std::atomic<size_t> _glyphAtlasBytes{ 0 };
+        // The sums of the _lastFrameCounters of all frames so far. Written and read like _glyphAtlasBytes.
+        std::atomic<u64> _glyphLookups{ 0 };
+        std::atomic<u64> _glyphCacheMisses{ 0 };
+        std::atomic<f32> _glyphAtlasOccupancy{ -1.0f };
+        // Published by StartPaint() and EndPaint() for GetMemoryUsage() and GetDiagnostics(),
+        // since the frame may be painted without holding the console lock. See SupportsUnlockedPainting().
+        std::atomic<size_t> _rowBytes{ 0 };
+        std::atomic<size_t> _shapingCacheBytes{ 0 };
+        std::atomic<size_t> _dirtyRows{ 0 };
+        std::atomic<size_t> _shapingCacheHits{ 0 };
+        std::atomic<size_t> _shapingCacheMisses{ 0 };
+        // Set by TrimMemory() and honored by the next StartPaint().
+        std::atomic<bool> _trimMemoryPending{ false };
+
+        // The state shared with _fontFallbackCallback(), which runs on the threadpool.
+        // It's the last member, because destroying `work` waits for the callback to finish.
+        struct FontFallbackState
+        {
+            std::mutex mutex;
+            wil::com_ptr<IDWriteFontFallback> fontFallback;
+            wil::com_ptr<IDWriteFontCollection> fontCollection;
+            std::wstring fontName;
+            std::vector<char32_t> pending;
+            std::vector<char32_t> resolved;
+            wil::unique_threadpool_work work;
+        } _fontFallback;
     };
 }
 
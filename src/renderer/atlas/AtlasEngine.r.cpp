@@ -37,6 +37,11 @@ try
         return S_OK;
     }
 
+#if ATLAS_DEBUG_FRAME_STATS
+    LARGE_INTEGER frameStart{};
+    QueryPerformanceCounter(&frameStart);
+#endif
+
     if (!_p.dxgi.adapter || !_p.dxgi.factory->IsCurrent())
     {
         _recreateAdapter();
@@ -47,13 +52,36 @@ try
         _recreateBackend();
     }
 
+    // The immediate context is shared with the other engines on this adapter. See SharedDevice.
+    const std::lock_guard deviceLock{ _p.sharedDevice->mutex };
+
     if (_p.swapChain.generation != _p.s.generation())
     {
         _handleSwapChainUpdate();
     }
 
+    if (_gpuTiming.enabled)
+    {
+        _beginGpuTiming();
+    }
+
     _b->Render(_p);
+    _glyphAtlasBytes.store(_b->GlyphAtlasBytes(), std::memory_order_relaxed);
+    _lastFrameCounters = _b->LastFrameCounters();
+    _glyphLookups.fetch_add(_lastFrameCounters.glyphLookups, std::memory_order_relaxed);
+    _glyphCacheMisses.fetch_add(_lastFrameCounters.glyphCacheMisses, std::memory_order_relaxed);
+    _glyphAtlasOccupancy.store(_lastFrameCounters.glyphAtlasOccupancy, std::memory_order_relaxed);
+
+    if (_gpuTiming.enabled)
+    {
+        _lastFrameCounters.gpuMilliseconds = _endGpuTiming();
+    }
+
     _present();
+
+#if ATLAS_DEBUG_FRAME_STATS
+    _debugFrameStats(frameStart.QuadPart);
+#endif
     return S_OK;
 }
 catch (const wil::ResultException& exception)
@@ -80,9 +108,31 @@ catch (const wil::ResultException& exception)
 }
 CATCH_RETURN()
 
+// Called on the render thread, while the control is hidden and the system is low on memory.
+// The next Present() recreates the backend and the swap chain as if the device had been lost,
+// which also redraws the entire viewport from the ShapedRows that we keep around.
+void AtlasEngine::ReleaseDeviceResources() noexcept
+{
+    if (!_b)
+    {
+        return;
+    }
+
+    {
+        const std::lock_guard deviceLock{ _p.sharedDevice->mutex };
+        _b.reset();
+        _p.swapChain = {};
+        _p.deviceContext->ClearState();
+        _p.deviceContext->Flush();
+    }
+
+    _glyphAtlasBytes.store(0, std::memory_order_relaxed);
+}
+
 [[nodiscard]] bool AtlasEngine::RequiresContinuousRedraw() noexcept
 {
-    return ATLAS_DEBUG_CONTINUOUS_REDRAW || (_b && _b->RequiresContinuousRedraw());
+    // While _fontFallbackCallback() is running we need to keep polling StartPaint() for its results.
+    return ATLAS_DEBUG_CONTINUOUS_REDRAW || !_api.fallbackPending.empty() || (_b && _b->RequiresContinuousRedraw());
 }
 
 void AtlasEngine::WaitUntilCanRender() noexcept
@@ -153,11 +203,31 @@ void AtlasEngine::_recreateAdapter()
     }
 }
 
-void AtlasEngine::_recreateBackend()
+// Returns the SharedDevice for the adapter in p.dxgi, or creates a new one if there's none yet,
+// or if the existing one was lost. The other engines using a lost device will
+// run into the same error during their next frame and join the new device.
+static std::shared_ptr<SharedDevice> getSharedDevice(const RenderingPayload& p)
 {
+    static std::mutex mutex;
+    static std::vector<std::weak_ptr<SharedDevice>> devices;
+
+    const std::lock_guard lock{ mutex };
+    std::erase_if(devices, [](const auto& weak) { return weak.expired(); });
+
+    for (const auto& weak : devices)
+    {
+        if (auto shared = weak.lock(); shared && memcmp(&shared->adapterLuid, &p.dxgi.adapterLuid, sizeof(LUID)) == 0 && shared->device->GetDeviceRemovedReason() == S_OK)
+        {
+            return shared;
+        }
+    }
+
     auto d2dMode = ATLAS_DEBUG_FORCE_D2D_MODE;
+
+    // The device is used by the render threads of all engines on this adapter.
+    // It's thus created without D3D11_CREATE_DEVICE_SINGLETHREADED.
     auto deviceFlags =
-        D3D11_CREATE_DEVICE_SINGLETHREADED
+        D3D11_CREATE_DEVICE_BGRA_SUPPORT
 #ifndef NDEBUG
         | D3D11_CREATE_DEVICE_DEBUG
 #endif
@@ -165,11 +235,9 @@ void AtlasEngine::_recreateBackend()
         // that would be advantageous for games. For us this has only a minimal performance benefit,
         // but comes with a large memory usage overhead. At the time of writing the Nvidia
         // driver launches $cpu_thread_count more worker threads without this flag.
-        | D3D11_CREATE_DEVICE_PREVENT_INTERNAL_THREADING_OPTIMIZATIONS
-        // Direct2D support.
-        | D3D11_CREATE_DEVICE_BGRA_SUPPORT;
+        | D3D11_CREATE_DEVICE_PREVENT_INTERNAL_THREADING_OPTIMIZATIONS;
 
-    if (WI_IsFlagSet(_p.dxgi.adapterFlags, DXGI_ADAPTER_FLAG_SOFTWARE))
+    if (WI_IsFlagSet(p.dxgi.adapterFlags, DXGI_ADAPTER_FLAG_SOFTWARE))
     {
         WI_ClearFlag(deviceFlags, D3D11_CREATE_DEVICE_PREVENT_INTERNAL_THREADING_OPTIMIZATIONS);
         d2dMode = true;
@@ -190,7 +258,7 @@ void AtlasEngine::_recreateBackend()
     };
 
     THROW_IF_FAILED(D3D11CreateDevice(
-        /* pAdapter */ _p.dxgi.adapter.get(),
+        /* pAdapter */ p.dxgi.adapter.get(),
         /* DriverType */ D3D_DRIVER_TYPE_UNKNOWN,
         /* Software */ nullptr,
         /* Flags */ deviceFlags,
@@ -204,6 +272,13 @@ void AtlasEngine::_recreateBackend()
     auto device = device0.query<ID3D11Device2>();
     auto deviceContext = deviceContext0.query<ID3D11DeviceContext2>();
 
+    // Access to the immediate context is serialized with SharedDevice::mutex, but the single-threaded
+    // D2D factories of the engines may still touch it while releasing their resources.
+    if (const auto multithread = deviceContext.try_query<ID3D11Multithread>())
+    {
+        multithread->SetMultithreadProtected(TRUE);
+    }
+
 #ifndef NDEBUG
     if (IsDebuggerPresent())
     {
@@ -229,17 +304,47 @@ void AtlasEngine::_recreateBackend()
         d2dMode |= !options.ComputeShaders_Plus_RawAndStructuredBuffers_Via_Shader_4_x;
     }
 
+    auto shared = std::make_shared<SharedDevice>();
+    shared->adapterLuid = p.dxgi.adapterLuid;
+    shared->d2dMode = d2dMode;
+    shared->device = std::move(device);
+    shared->deviceContext = std::move(deviceContext);
+    devices.emplace_back(shared);
+    return shared;
+}
+
+void AtlasEngine::_recreateBackend()
+{
+    auto shared = getSharedDevice(_p);
+    const auto d2dMode = shared->d2dMode;
+
     _p.swapChain = {};
-    _p.device = std::move(device);
-    _p.deviceContext = std::move(deviceContext);
+    _p.device = shared->device;
+    _p.deviceContext = shared->deviceContext;
+    _p.sharedDevice = std::move(shared);
 
-    if (d2dMode)
     {
-        _b = std::make_unique<BackendD2D>();
+        // BackendD3D's constructor initializes SharedDevice::d3d.
+        const std::lock_guard lock{ _p.sharedDevice->mutex };
+
+        if (d2dMode)
+        {
+            _b = std::make_unique<BackendD2D>();
+        }
+        else
+        {
+            _b = std::make_unique<BackendD3D>(_p);
+        }
     }
-    else
+
+    // The shaping cache contains the mappings of builtin glyphs, which only BackendD3D can draw.
+    // The rows have to be shaped again, now that the backend does (or doesn't) draw them itself.
+    if (_p.builtinGlyphs == d2dMode)
     {
-        _b = std::make_unique<BackendD3D>(_p);
+        _p.builtinGlyphs = !d2dMode;
+        _invalidateShapingCache();
+        _api.invalidatedRows = invalidatedRowsAll;
+        _api.invalidatedRowRangesOverflow = true;
     }
 
     // !!! NOTE !!!
@@ -389,6 +494,7 @@ void AtlasEngine::_present()
     DXGI_PRESENT_PARAMETERS params{};
     RECT scrollRect{};
     POINT scrollOffset{};
+    til::small_vector<RECT, 8> dirtyRects;
 
     // Since rows might be taller than their cells, they might have drawn outside of the viewport.
     auto dirtyRect = _p.dirtyRectInPx;
@@ -418,9 +524,154 @@ void AtlasEngine::_present()
                 params.pScrollRect = &scrollRect;
                 params.pScrollOffset = &scrollOffset;
             }
+
+            if (_p.invalidatedRowRanges.size() > 1)
+            {
+                // If the invalidated rows are disjoint we can tell DWM about each of them individually,
+                // so that it composes less. The rows in between them may have been drawn as well, but they
+                // look exactly like they did in the previous frame (after applying the scroll rect, if any).
+                // Since rows might be taller than their cells, we need to consider their extent
+                // before (= dirtySpansInPx, already offset by the scroll delta) and after drawing.
+                auto& spans = _p.dirtySpansInPx;
+                for (const auto& r : _p.invalidatedRowRanges)
+                {
+                    for (auto y = r.start; y < r.end; ++y)
+                    {
+                        const auto row = _p.rows[y];
+                        spans.emplace_back(range<til::CoordType>{ row->dirtyTop, row->dirtyBottom });
+                    }
+                }
+
+                std::sort(spans.begin(), spans.end(), [](const auto& a, const auto& b) { return a.start < b.start; });
+
+                for (const auto& span : spans)
+                {
+                    const auto top = std::max(span.start, dirtyRect.top);
+                    const auto bottom = std::min(span.end, dirtyRect.bottom);
+                    if (top >= bottom)
+                    {
+                        continue;
+                    }
+
+                    if (!dirtyRects.empty() && top <= dirtyRects.back().bottom)
+                    {
+                        dirtyRects.back().bottom = std::max(dirtyRects.back().bottom, bottom);
+                    }
+                    else
+                    {
+                        dirtyRects.emplace_back(RECT{ dirtyRect.left, top, dirtyRect.right, bottom });
+                    }
+                }
+
+                if (dirtyRects.size() > 1)
+                {
+                    params.DirtyRectsCount = gsl::narrow_cast<UINT>(dirtyRects.size());
+                    params.pDirtyRects = dirtyRects.data();
+                }
+            }
         }
     }
 
     THROW_IF_FAILED(_p.swapChain.swapChain->Present1(1, 0, &params));
     _p.swapChain.waitForPresentation = true;
 }
+
+void AtlasEngine::EnableGpuTiming(const bool enable) noexcept
+{
+    _gpuTiming.enabled = enable;
+}
+
+// Returns what the backend did during the last Present() call.
+FrameCounters AtlasEngine::LastFrameCounters() const noexcept
+{
+    return _lastFrameCounters;
+}
+
+void AtlasEngine::_beginGpuTiming()
+{
+    if (_gpuTiming.device != _p.device)
+    {
+        D3D11_QUERY_DESC desc{ .Query = D3D11_QUERY_TIMESTAMP_DISJOINT };
+        THROW_IF_FAILED(_p.device->CreateQuery(&desc, _gpuTiming.disjoint.put()));
+        desc.Query = D3D11_QUERY_TIMESTAMP;
+        THROW_IF_FAILED(_p.device->CreateQuery(&desc, _gpuTiming.begin.put()));
+        THROW_IF_FAILED(_p.device->CreateQuery(&desc, _gpuTiming.end.put()));
+        _gpuTiming.device = _p.device;
+    }
+
+    _p.deviceContext->Begin(_gpuTiming.disjoint.get());
+    _p.deviceContext->End(_gpuTiming.begin.get());
+}
+
+// Waits for the GPU to finish the frame and returns how long it took in milliseconds,
+// or a negative value if the timestamps are unreliable (e.g. because the GPU clock changed).
+f32 AtlasEngine::_endGpuTiming()
+{
+    _p.deviceContext->End(_gpuTiming.end.get());
+    _p.deviceContext->End(_gpuTiming.disjoint.get());
+
+    const auto getData = [&](ID3D11Query* query, auto& data) {
+        for (;;)
+        {
+            const auto hr = _p.deviceContext->GetData(query, &data, sizeof(data), 0);
+            THROW_IF_FAILED(hr);
+            if (hr == S_OK)
+            {
+                return;
+            }
+            SwitchToThread();
+        }
+    };
+
+    D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint{};
+    UINT64 begin = 0;
+    UINT64 end = 0;
+    getData(_gpuTiming.disjoint.get(), disjoint);
+    getData(_gpuTiming.begin.get(), begin);
+    getData(_gpuTiming.end.get(), end);
+
+    if (disjoint.Disjoint || !disjoint.Frequency)
+    {
+        return -1.0f;
+    }
+    return static_cast<f32>(static_cast<double>(end - begin) * 1e3 / static_cast<double>(disjoint.Frequency));
+}
+
+// The frame latency waitable object limits us to presenting once per display refresh. This measures how well we
+// keep up with it: If the CPU time per frame approaches the refresh interval, or if refreshes pass by without a
+// present while output is arriving, the renderer is too slow. DXGI only reports any statistics once the swap
+// chain is displayed via independent flip or DWM, so this may print nothing until then.
+void AtlasEngine::_debugFrameStats(const int64_t frameStart) noexcept
+{
+    LARGE_INTEGER now{};
+    QueryPerformanceCounter(&now);
+    _frameStats.cpuTime += now.QuadPart - frameStart;
+    _frameStats.frames++;
+
+    if (_frameStats.frames < 60)
+    {
+        return;
+    }
+
+    DXGI_FRAME_STATISTICS stats{};
+    // This fails with DXGI_ERROR_FRAME_STATISTICS_DISJOINT whenever the statistics are interrupted,
+    // for instance when the window is moved to another display. We just start over in that case.
+    if (SUCCEEDED(_p.swapChain.swapChain->GetFrameStatistics(&stats)) && _frameStats.syncRefreshCount)
+    {
+        LARGE_INTEGER frequency{};
+        QueryPerformanceFrequency(&frequency);
+
+        const auto presents = stats.PresentCount - _frameStats.presentCount;
+        const auto refreshes = stats.SyncRefreshCount - _frameStats.syncRefreshCount;
+        const auto cpuTime = 1e3 * static_cast<double>(_frameStats.cpuTime) / static_cast<double>(frequency.QuadPart) / _frameStats.frames;
+
+        wchar_t buffer[128];
+        swprintf_s(buffer, L"frame stats: %.2fms CPU time per frame, %u presents over %u refreshes\n", cpuTime, presents, refreshes);
+        OutputDebugStringW(&buffer[0]);
+    }
+
+    _frameStats = {
+        .presentCount = stats.PresentCount,
+        .syncRefreshCount = stats.SyncRefreshCount,
+    };
+}
@@ -18,6 +18,9 @@ namespace Microsoft::Console::Render::Atlas
     // This helps with benchmarking the application as it'll run beyond display refresh rate.
 #define ATLAS_DEBUG_DISABLE_FRAME_LATENCY_WAITABLE_OBJECT 0
 
+    // Disables rasterizing common glyphs ahead of time after a font change. See AtlasEngine::_recreatePrewarmGlyphs().
+#define ATLAS_DEBUG_DISABLE_GLYPH_PREWARMING 0
+
     // Forces the use of Direct2D for text rendering (= BackendD2D).
 #define ATLAS_DEBUG_FORCE_D2D_MODE 0
 
@@ -32,6 +35,16 @@ namespace Microsoft::Console::Render::Atlas
 #define ATLAS_DEBUG_DUMP_RENDER_TARGET 0
 #define ATLAS_DEBUG_DUMP_RENDER_TARGET_PATH LR"(%USERPROFILE%\Downloads\AtlasEngine)"
 
+    // Prints the time spent in AtlasEngine::Present() and how many display refreshes
+    // were presented or missed with OutputDebugStringW() every 60 frames.
+#define ATLAS_DEBUG_FRAME_STATS 0
+
+    // Prints the hit rate of the shaping cache in AtlasEngine::_flushBufferLine() with OutputDebugStringW() after every frame.
+#define ATLAS_DEBUG_SHAPING_CACHE_STATS 0
+
+    // Prints the occupancy of the glyph atlas in BackendD3D with OutputDebugStringW() whenever a page is evicted or the atlas is reset.
+#define ATLAS_DEBUG_GLYPH_ATLAS_STATS 0
+
     template<typename T = D2D1_COLOR_F>
     constexpr T colorFromU32(u32 rgba)
     {
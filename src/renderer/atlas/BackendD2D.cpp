@@ -23,6 +23,10 @@ TIL_FAST_MATH_BEGIN
 
 using namespace Microsoft::Console::Render::Atlas;
 
+// If true, only the contents of p.dirtyRectInPx are drawn, because Present1() preserves the rest of the previous frame.
+// With WARP, which is what this backend is usually used with, drawing the entire frame is very costly.
+static constexpr bool drawDirtyOnly = !(ATLAS_DEBUG_SHOW_DIRTY || ATLAS_DEBUG_DUMP_RENDER_TARGET);
+
 void BackendD2D::ReleaseResources() noexcept
 {
     _renderTarget.reset();
@@ -43,11 +47,28 @@ void BackendD2D::Render(RenderingPayload& p)
     // Invalidating the render target helps with spotting Present1() bugs.
     _renderTarget->Clear();
 #endif
-    _drawBackground(p);
-    _drawCursorPart1(p);
-    _drawText(p);
-    _drawCursorPart2(p);
-    _drawSelection(p);
+    _measureInvalidatedRows(p);
+    {
+        // p.dirtyRectInPx is final at this point and everything outside of it will be discarded by Present1().
+        // Clipping to it means that only the rows that actually changed are drawn, instead of the entire frame.
+        D2D1_RECT_F clipRect{ 0, 0, static_cast<f32>(p.s->targetSize.x), static_cast<f32>(p.s->targetSize.y) };
+        if constexpr (drawDirtyOnly)
+        {
+            clipRect = {
+                static_cast<f32>(p.dirtyRectInPx.left),
+                static_cast<f32>(p.dirtyRectInPx.top),
+                static_cast<f32>(p.dirtyRectInPx.right),
+                static_cast<f32>(p.dirtyRectInPx.bottom),
+            };
+        }
+        _renderTarget->PushAxisAlignedClip(&clipRect, D2D1_ANTIALIAS_MODE_ALIASED);
+        _drawBackground(p, clipRect);
+        _drawCursorPart1(p);
+        _drawText(p);
+        _drawCursorPart2(p);
+        _drawSelection(p);
+        _renderTarget->PopAxisAlignedClip();
+    }
 #if ATLAS_DEBUG_SHOW_DIRTY
     _debugShowDirty(p);
 #endif
@@ -63,6 +84,18 @@ bool BackendD2D::RequiresContinuousRedraw() noexcept
     return false;
 }
 
+size_t BackendD2D::GlyphAtlasBytes() const noexcept
+{
+    // Direct2D caches the glyphs it draws internally.
+    return 0;
+}
+
+FrameCounters BackendD2D::LastFrameCounters() const noexcept
+{
+    // Direct2D doesn't tell us about its glyph cache or its uploads.
+    return {};
+}
+
 void BackendD2D::_handleSettingsUpdate(const RenderingPayload& p)
 {
     const auto renderTargetChanged = !_renderTarget;
@@ -147,7 +180,7 @@ void BackendD2D::_handleSettingsUpdate(const RenderingPayload& p)
     _cellCount = p.s->cellCount;
 }
 
-void BackendD2D::_drawBackground(const RenderingPayload& p) noexcept
+void BackendD2D::_drawBackground(const RenderingPayload& p, const D2D1_RECT_F& rect) noexcept
 {
     if (_backgroundBitmapGeneration != p.colorBitmapGenerations[0])
     {
@@ -157,17 +190,14 @@ void BackendD2D::_drawBackground(const RenderingPayload& p) noexcept
 
     // If the terminal was 120x30 cells and 1200x600 pixels large, this would draw the
     // background by upscaling a 120x30 pixel bitmap to fill the entire render target.
-    const D2D1_RECT_F rect{ 0, 0, static_cast<f32>(p.s->targetSize.x), static_cast<f32>(p.s->targetSize.y) };
+    // Only the given part of it is filled, which is usually just the dirty rows.
     _renderTarget->SetPrimitiveBlend(D2D1_PRIMITIVE_BLEND_COPY);
     _renderTarget->FillRectangle(&rect, _backgroundBrush.get());
     _renderTarget->SetPrimitiveBlend(D2D1_PRIMITIVE_BLEND_SOURCE_OVER);
 }
 
-void BackendD2D::_drawText(RenderingPayload& p)
+void BackendD2D::_drawText(const RenderingPayload& p)
 {
-    til::CoordType dirtyTop = til::CoordTypeMax;
-    til::CoordType dirtyBottom = til::CoordTypeMin;
-
     // It is possible to create a "_foregroundBrush" similar to how the `_backgroundBrush` is created and
     // use that as the brush for text rendering below. That way we wouldn't have to search `row->colors` for color
     // changes and could draw entire lines of text in a single call. Unfortunately Direct2D is not particularly
@@ -178,6 +208,104 @@ void BackendD2D::_drawText(RenderingPayload& p)
     u16 y = 0;
     for (const auto row : p.rows)
     {
+        // The rows that weren't invalidated look exactly like they did in the previous frame, only shifted by the
+        // scroll offset, and Present1() preserves them. Since everything is clipped to the dirty rect,
+        // they only need to be drawn where they overlap it. See Render().
+        if (!drawDirtyOnly || p.invalidatedRows.contains(y) || (row->dirtyTop < p.dirtyRectInPx.bottom && row->dirtyBottom > p.dirtyRectInPx.top))
+        {
+            _drawTextRow(p, row, y);
+        }
+
+        ++y;
+    }
+}
+
+void BackendD2D::_drawTextRow(const RenderingPayload& p, const ShapedRow* row, u16 y)
+{
+    auto baselineX = 0.0f;
+    auto baselineY = static_cast<f32>(p.s->font->cellSize.y * y + p.s->font->baseline);
+
+    if (row->lineRendition != LineRendition::SingleWidth)
+    {
+        baselineY = _drawTextPrepareLineRendition(p, row, baselineY);
+    }
+
+    for (const auto& m : row->mappings)
+    {
+        const auto colorsBegin = row->colors.begin();
+        auto it = colorsBegin + m.glyphsFrom;
+        const auto end = colorsBegin + m.glyphsTo;
+
+        while (it != end)
+        {
+            const auto beg = it;
+            const auto off = it - colorsBegin;
+            const auto fg = *it;
+
+            while (++it != end && *it == fg)
+            {
+            }
+
+            const auto count = it - beg;
+            const auto brush = _brushWithColor(fg);
+            const DWRITE_GLYPH_RUN glyphRun{
+                .fontFace = m.fontFace.get(),
+                .fontEmSize = p.s->font->fontSize,
+                .glyphCount = gsl::narrow_cast<UINT32>(count),
+                .glyphIndices = &row->glyphIndices[off],
+                .glyphAdvances = &row->glyphAdvances[off],
+                .glyphOffsets = &row->glyphOffsets[off],
+            };
+            const D2D1_POINT_2F baselineOrigin{
+                baselineX,
+                baselineY,
+            };
+
+            if (glyphRun.fontFace)
+            {
+                if (const auto enumerator = TranslateColorGlyphRun(p.dwriteFactory4.get(), baselineOrigin, &glyphRun))
+                {
+                    while (ColorGlyphRunMoveNext(enumerator.get()))
+                    {
+                        const auto colorGlyphRun = ColorGlyphRunGetCurrentRun(enumerator.get());
+                        ColorGlyphRunDraw(_renderTarget4.get(), _emojiBrush.get(), brush, colorGlyphRun);
+                    }
+                }
+                else
+                {
+                    _renderTarget->DrawGlyphRun(baselineOrigin, &glyphRun, brush, DWRITE_MEASURING_MODE_NATURAL);
+                }
+            }
+
+            for (UINT32 i = 0; i < glyphRun.glyphCount; ++i)
+            {
+                baselineX += glyphRun.glyphAdvances[i];
+            }
+        }
+    }
+
+    if (!row->gridLineRanges.empty())
+    {
+        _drawGridlineRow(p, row, y);
+    }
+
+    if (row->lineRendition != LineRendition::SingleWidth)
+    {
+        _drawTextResetLineRendition(row);
+    }
+}
+
+// The glyphs of the invalidated rows may extend past their cells. Unlike BackendD3D, which defers its
+// quads until the end of the frame, we draw immediately and so p.dirtyRectInPx must be final before
+// anything is drawn. This accumulates the bounds of those glyphs into the rows and the dirty rect.
+void BackendD2D::_measureInvalidatedRows(RenderingPayload& p)
+{
+    til::CoordType dirtyTop = til::CoordTypeMax;
+    til::CoordType dirtyBottom = til::CoordTypeMin;
+
+    for (auto y = p.invalidatedRows.start; y < p.invalidatedRows.end; ++y)
+    {
+        const auto row = p.rows[y];
         auto baselineX = 0.0f;
         auto baselineY = static_cast<f32>(p.s->font->cellSize.y * y + p.s->font->baseline);
 
@@ -186,80 +314,57 @@ void BackendD2D::_drawText(RenderingPayload& p)
             baselineY = _drawTextPrepareLineRendition(p, row, baselineY);
         }
 
+        // The colors of the glyphs don't affect their bounds, so unlike _drawTextRow()
+        // this can measure each mapping with a single glyph run.
         for (const auto& m : row->mappings)
         {
-            const auto colorsBegin = row->colors.begin();
-            auto it = colorsBegin + m.glyphsFrom;
-            const auto end = colorsBegin + m.glyphsTo;
+            const DWRITE_GLYPH_RUN glyphRun{
+                .fontFace = m.fontFace.get(),
+                .fontEmSize = p.s->font->fontSize,
+                .glyphCount = gsl::narrow_cast<UINT32>(m.glyphsTo - m.glyphsFrom),
+                .glyphIndices = &row->glyphIndices[m.glyphsFrom],
+                .glyphAdvances = &row->glyphAdvances[m.glyphsFrom],
+                .glyphOffsets = &row->glyphOffsets[m.glyphsFrom],
+            };
+            const D2D1_POINT_2F baselineOrigin{
+                baselineX,
+                baselineY,
+            };
 
-            while (it != end)
+            if (glyphRun.fontFace)
             {
-                const auto beg = it;
-                const auto off = it - colorsBegin;
-                const auto fg = *it;
+                D2D1_RECT_F bounds = GlyphRunEmptyBounds;
 
-                while (++it != end && *it == fg)
+                if (const auto enumerator = TranslateColorGlyphRun(p.dwriteFactory4.get(), baselineOrigin, &glyphRun))
                 {
+                    while (ColorGlyphRunMoveNext(enumerator.get()))
+                    {
+                        ColorGlyphRunAccumulateBounds(_renderTarget.get(), ColorGlyphRunGetCurrentRun(enumerator.get()), bounds);
+                    }
                 }
-
-                const auto count = it - beg;
-                const auto brush = _brushWithColor(fg);
-                const DWRITE_GLYPH_RUN glyphRun{
-                    .fontFace = m.fontFace.get(),
-                    .fontEmSize = p.s->font->fontSize,
-                    .glyphCount = gsl::narrow_cast<UINT32>(count),
-                    .glyphIndices = &row->glyphIndices[off],
-                    .glyphAdvances = &row->glyphAdvances[off],
-                    .glyphOffsets = &row->glyphOffsets[off],
-                };
-                const D2D1_POINT_2F baselineOrigin{
-                    baselineX,
-                    baselineY,
-                };
-
-                if (glyphRun.fontFace)
+                else
                 {
-                    D2D1_RECT_F bounds = GlyphRunEmptyBounds;
+                    GlyphRunAccumulateBounds(_renderTarget.get(), baselineOrigin, &glyphRun, bounds);
+                }
 
-                    if (const auto enumerator = TranslateColorGlyphRun(p.dwriteFactory4.get(), baselineOrigin, &glyphRun))
+                if (bounds.top < bounds.bottom)
+                {
+                    // Since we used SetUnitMode(D2D1_UNIT_MODE_PIXELS), bounds.top/bottom is in pixels already and requires no conversion/rounding.
+                    if (row->lineRendition != LineRendition::DoubleHeightTop)
                     {
-                        while (ColorGlyphRunMoveNext(enumerator.get()))
-                        {
-                            const auto colorGlyphRun = ColorGlyphRunGetCurrentRun(enumerator.get());
-                            ColorGlyphRunDraw(_renderTarget4.get(), _emojiBrush.get(), brush, colorGlyphRun);
-                            ColorGlyphRunAccumulateBounds(_renderTarget.get(), colorGlyphRun, bounds);
-                        }
+                        row->dirtyBottom = std::max(row->dirtyBottom, static_cast<i32>(lrintf(bounds.bottom)));
                     }
-                    else
+                    if (row->lineRendition != LineRendition::DoubleHeightBottom)
                     {
-                        _renderTarget->DrawGlyphRun(baselineOrigin, &glyphRun, brush, DWRITE_MEASURING_MODE_NATURAL);
-                        GlyphRunAccumulateBounds(_renderTarget.get(), baselineOrigin, &glyphRun, bounds);
-                    }
-
-                    if (bounds.top < bounds.bottom)
-                    {
-                        // Since we used SetUnitMode(D2D1_UNIT_MODE_PIXELS), bounds.top/bottom is in pixels already and requires no conversion/rounding.
-                        if (row->lineRendition != LineRendition::DoubleHeightTop)
-                        {
-                            row->dirtyBottom = std::max(row->dirtyBottom, static_cast<i32>(lrintf(bounds.bottom)));
-                        }
-                        if (row->lineRendition != LineRendition::DoubleHeightBottom)
-                        {
-                            row->dirtyTop = std::min(row->dirtyTop, static_cast<i32>(lrintf(bounds.top)));
-                        }
+                        row->dirtyTop = std::min(row->dirtyTop, static_cast<i32>(lrintf(bounds.top)));
                     }
                 }
-
-                for (UINT32 i = 0; i < glyphRun.glyphCount; ++i)
-                {
-                    baselineX += glyphRun.glyphAdvances[i];
-                }
             }
-        }
 
-        if (!row->gridLineRanges.empty())
-        {
-            _drawGridlineRow(p, row, y);
+            for (UINT32 i = 0; i < glyphRun.glyphCount; ++i)
+            {
+                baselineX += glyphRun.glyphAdvances[i];
+            }
         }
 
         if (row->lineRendition != LineRendition::SingleWidth)
@@ -267,13 +372,8 @@ void BackendD2D::_drawText(RenderingPayload& p)
             _drawTextResetLineRendition(row);
         }
 
-        if (p.invalidatedRows.contains(y))
-        {
-            dirtyTop = std::min(dirtyTop, row->dirtyTop);
-            dirtyBottom = std::max(dirtyBottom, row->dirtyBottom);
-        }
-
-        ++y;
+        dirtyTop = std::min(dirtyTop, row->dirtyTop);
+        dirtyBottom = std::max(dirtyBottom, row->dirtyBottom);
     }
 
     if (dirtyTop < dirtyBottom)
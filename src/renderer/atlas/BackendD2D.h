@@ -14,11 +14,15 @@ namespace Microsoft::Console::Render::Atlas
         void ReleaseResources() noexcept override;
         void Render(RenderingPayload& payload) override;
         bool RequiresContinuousRedraw() noexcept override;
+        size_t GlyphAtlasBytes() const noexcept override;
+        FrameCounters LastFrameCounters() const noexcept override;
 
     private:
         ATLAS_ATTR_COLD void _handleSettingsUpdate(const RenderingPayload& p);
-        void _drawBackground(const RenderingPayload& p) noexcept;
-        void _drawText(RenderingPayload& p);
+        void _drawBackground(const RenderingPayload& p, const D2D1_RECT_F& rect) noexcept;
+        void _drawText(const RenderingPayload& p);
+        void _drawTextRow(const RenderingPayload& p, const ShapedRow* row, u16 y);
+        void _measureInvalidatedRows(RenderingPayload& p);
         ATLAS_ATTR_COLD f32 _drawTextPrepareLineRendition(const RenderingPayload& p, const ShapedRow* row, f32 baselineY) const noexcept;
         ATLAS_ATTR_COLD void _drawTextResetLineRendition(const ShapedRow* row) const noexcept;
         ATLAS_ATTR_COLD f32r _getGlyphRunDesignBounds(const DWRITE_GLYPH_RUN& glyphRun, f32 baselineX, f32 baselineY);
@@ -70,55 +70,120 @@ struct ::std::hash<BackendD3D::AtlasFontFaceEntry>
 
 BackendD3D::BackendD3D(const RenderingPayload& p)
 {
-    THROW_IF_FAILED(p.device->CreateVertexShader(&shader_vs[0], sizeof(shader_vs), nullptr, _vertexShader.addressof()));
-    THROW_IF_FAILED(p.device->CreatePixelShader(&shader_ps[0], sizeof(shader_ps), nullptr, _pixelShader.addressof()));
-
+    // The shaders and other immutable objects only depend on the device and are thus
+    // created just once by the first instance on a SharedDevice. rasterizerState is created last.
+    auto& objects = p.sharedDevice->d3d;
+    if (!objects.rasterizerState)
     {
-        static constexpr D3D11_INPUT_ELEMENT_DESC layout[]{
-            { "SV_Position", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-            { "shadingType", 0, DXGI_FORMAT_R32_UINT, 1, offsetof(QuadInstance, shadingType), D3D11_INPUT_PER_INSTANCE_DATA, 1 },
-            { "position", 0, DXGI_FORMAT_R16G16_SINT, 1, offsetof(QuadInstance, position), D3D11_INPUT_PER_INSTANCE_DATA, 1 },
-            { "size", 0, DXGI_FORMAT_R16G16_UINT, 1, offsetof(QuadInstance, size), D3D11_INPUT_PER_INSTANCE_DATA, 1 },
-            { "texcoord", 0, DXGI_FORMAT_R16G16_UINT, 1, offsetof(QuadInstance, texcoord), D3D11_INPUT_PER_INSTANCE_DATA, 1 },
-            { "color", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 1, offsetof(QuadInstance, color), D3D11_INPUT_PER_INSTANCE_DATA, 1 },
-        };
-        THROW_IF_FAILED(p.device->CreateInputLayout(&layout[0], std::size(layout), &shader_vs[0], sizeof(shader_vs), _inputLayout.addressof()));
-    }
+        THROW_IF_FAILED(p.device->CreateVertexShader(&shader_vs[0], sizeof(shader_vs), nullptr, objects.vertexShader.addressof()));
+        THROW_IF_FAILED(p.device->CreatePixelShader(&shader_ps[0], sizeof(shader_ps), nullptr, objects.pixelShader.addressof()));
 
-    {
-        static constexpr f32x2 vertices[]{
-            { 0, 0 },
-            { 1, 0 },
-            { 1, 1 },
-            { 0, 1 },
-        };
-        static constexpr D3D11_SUBRESOURCE_DATA initialData{ &vertices[0] };
+        {
+            static constexpr D3D11_INPUT_ELEMENT_DESC layout[]{
+                { "SV_Position", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+                { "shadingType", 0, DXGI_FORMAT_R16G16_UINT, 1, offsetof(QuadInstance, shadingType), D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+                { "position", 0, DXGI_FORMAT_R16G16_SINT, 1, offsetof(QuadInstance, position), D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+                { "size", 0, DXGI_FORMAT_R16G16_UINT, 1, offsetof(QuadInstance, size), D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+                { "texcoord", 0, DXGI_FORMAT_R16G16_UINT, 1, offsetof(QuadInstance, texcoord), D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+                { "color", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 1, offsetof(QuadInstance, color), D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+            };
+            THROW_IF_FAILED(p.device->CreateInputLayout(&layout[0], std::size(layout), &shader_vs[0], sizeof(shader_vs), objects.inputLayout.addressof()));
+        }
 
-        D3D11_BUFFER_DESC desc{};
-        desc.ByteWidth = sizeof(vertices);
-        desc.Usage = D3D11_USAGE_IMMUTABLE;
-        desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-        THROW_IF_FAILED(p.device->CreateBuffer(&desc, &initialData, _vertexBuffer.addressof()));
-    }
+        {
+            static constexpr f32x2 vertices[]{
+                { 0, 0 },
+                { 1, 0 },
+                { 1, 1 },
+                { 0, 1 },
+            };
+            static constexpr D3D11_SUBRESOURCE_DATA initialData{ &vertices[0] };
 
-    {
-        static constexpr u16 indices[]{
-            0, // { 0, 0 }
-            1, // { 1, 0 }
-            2, // { 1, 1 }
-            2, // { 1, 1 }
-            3, // { 0, 1 }
-            0, // { 0, 0 }
-        };
-        static constexpr D3D11_SUBRESOURCE_DATA initialData{ &indices[0] };
+            D3D11_BUFFER_DESC desc{};
+            desc.ByteWidth = sizeof(vertices);
+            desc.Usage = D3D11_USAGE_IMMUTABLE;
+            desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+            THROW_IF_FAILED(p.device->CreateBuffer(&desc, &initialData, objects.vertexBuffer.addressof()));
+        }
 
-        D3D11_BUFFER_DESC desc{};
-        desc.ByteWidth = sizeof(indices);
-        desc.Usage = D3D11_USAGE_IMMUTABLE;
-        desc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-        THROW_IF_FAILED(p.device->CreateBuffer(&desc, &initialData, _indexBuffer.addressof()));
+        {
+            static constexpr u16 indices[]{
+                0, // { 0, 0 }
+                1, // { 1, 0 }
+                2, // { 1, 1 }
+                2, // { 1, 1 }
+                3, // { 0, 1 }
+                0, // { 0, 0 }
+            };
+            static constexpr D3D11_SUBRESOURCE_DATA initialData{ &indices[0] };
+
+            D3D11_BUFFER_DESC desc{};
+            desc.ByteWidth = sizeof(indices);
+            desc.Usage = D3D11_USAGE_IMMUTABLE;
+            desc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+            THROW_IF_FAILED(p.device->CreateBuffer(&desc, &initialData, objects.indexBuffer.addressof()));
+        }
+
+        {
+            // The final step of the ClearType blending algorithm is a lerp() between the premultiplied alpha
+            // background color and straight alpha foreground color given the 3 RGB weights in alphaCorrected:
+            //   lerp(background, foreground, weights)
+            // Which is equivalent to:
+            //   background * (1 - weights) + foreground * weights
+            //
+            // This COULD be implemented using dual source color blending like so:
+            //   .SrcBlend = D3D11_BLEND_SRC1_COLOR
+            //   .DestBlend = D3D11_BLEND_INV_SRC1_COLOR
+            //   .BlendOp = D3D11_BLEND_OP_ADD
+            // Because:
+            //   background * (1 - weights) + foreground * weights
+            //       ^             ^        ^     ^           ^
+            //      Dest     INV_SRC1_COLOR |    Src      SRC1_COLOR
+            //                            OP_ADD
+            //
+            // BUT we need simultaneous support for regular "source over" alpha blending
+            // (SHADING_TYPE_PASSTHROUGH)  like this:
+            //   background * (1 - alpha) + foreground
+            //
+            // This is why we set:
+            //   .SrcBlend = D3D11_BLEND_ONE
+            //
+            // --> We need to multiply the foreground with the weights ourselves.
+            static constexpr D3D11_BLEND_DESC desc{
+                .RenderTarget = { {
+                    .BlendEnable = TRUE,
+                    .SrcBlend = D3D11_BLEND_ONE,
+                    .DestBlend = D3D11_BLEND_INV_SRC1_COLOR,
+                    .BlendOp = D3D11_BLEND_OP_ADD,
+                    .SrcBlendAlpha = D3D11_BLEND_ONE,
+                    .DestBlendAlpha = D3D11_BLEND_INV_SRC1_ALPHA,
+                    .BlendOpAlpha = D3D11_BLEND_OP_ADD,
+                    .RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL,
+                } },
+            };
+            THROW_IF_FAILED(p.device->CreateBlendState(&desc, objects.blendState.addressof()));
+        }
+
+        {
+            // This is the default rasterizer state, but with the scissor test enabled. See _drawText().
+            static constexpr D3D11_RASTERIZER_DESC desc{
+                .FillMode = D3D11_FILL_SOLID,
+                .CullMode = D3D11_CULL_BACK,
+                .DepthClipEnable = TRUE,
+                .ScissorEnable = TRUE,
+            };
+            THROW_IF_FAILED(p.device->CreateRasterizerState(&desc, objects.rasterizerState.addressof()));
+        }
     }
 
+    _inputLayout = objects.inputLayout;
+    _vertexShader = objects.vertexShader;
+    _pixelShader = objects.pixelShader;
+    _blendState = objects.blendState;
+    _rasterizerState = objects.rasterizerState;
+    _vertexBuffer = objects.vertexBuffer;
+    _indexBuffer = objects.indexBuffer;
+
     {
         static constexpr D3D11_BUFFER_DESC desc{
             .ByteWidth = sizeof(VSConstBuffer),
@@ -137,46 +202,6 @@ BackendD3D::BackendD3D(const RenderingPayload& p)
         THROW_IF_FAILED(p.device->CreateBuffer(&desc, nullptr, _psConstantBuffer.addressof()));
     }
 
-    {
-        // The final step of the ClearType blending algorithm is a lerp() between the premultiplied alpha
-        // background color and straight alpha foreground color given the 3 RGB weights in alphaCorrected:
-        //   lerp(background, foreground, weights)
-        // Which is equivalent to:
-        //   background * (1 - weights) + foreground * weights
-        //
-        // This COULD be implemented using dual source color blending like so:
-        //   .SrcBlend = D3D11_BLEND_SRC1_COLOR
-        //   .DestBlend = D3D11_BLEND_INV_SRC1_COLOR
-        //   .BlendOp = D3D11_BLEND_OP_ADD
-        // Because:
-        //   background * (1 - weights) + foreground * weights
-        //       ^             ^        ^     ^           ^
-        //      Dest     INV_SRC1_COLOR |    Src      SRC1_COLOR
-        //                            OP_ADD
-        //
-        // BUT we need simultaneous support for regular "source over" alpha blending
-        // (SHADING_TYPE_PASSTHROUGH)  like this:
-        //   background * (1 - alpha) + foreground
-        //
-        // This is why we set:
-        //   .SrcBlend = D3D11_BLEND_ONE
-        //
-        // --> We need to multiply the foreground with the weights ourselves.
-        static constexpr D3D11_BLEND_DESC desc{
-            .RenderTarget = { {
-                .BlendEnable = TRUE,
-                .SrcBlend = D3D11_BLEND_ONE,
-                .DestBlend = D3D11_BLEND_INV_SRC1_COLOR,
-                .BlendOp = D3D11_BLEND_OP_ADD,
-                .SrcBlendAlpha = D3D11_BLEND_ONE,
-                .DestBlendAlpha = D3D11_BLEND_INV_SRC1_ALPHA,
-                .BlendOpAlpha = D3D11_BLEND_OP_ADD,
-                .RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL,
-            } },
-        };
-        THROW_IF_FAILED(p.device->CreateBlendState(&desc, _blendState.addressof()));
-    }
-
 #ifndef NDEBUG
     _sourceDirectory = std::filesystem::path{ __FILE__ }.parent_path();
     _sourceCodeWatcher = wil::make_folder_change_reader_nothrow(_sourceDirectory.c_str(), false, wil::FolderChangeEvents::FileName | wil::FolderChangeEvents::LastWriteTime, [this](wil::FolderChangeEvent, PCWSTR path) {
@@ -200,17 +225,81 @@ void BackendD3D::ReleaseResources() noexcept
 
 void BackendD3D::Render(RenderingPayload& p)
 {
+    _frameCounters = {};
+
     if (_generation != p.s.generation())
     {
         _handleSettingsUpdate(p);
     }
 
+    if (!_atlas)
+    {
+        _joinGlyphAtlas(p);
+    }
+
+    // Other instances may be drawing into (or evicting glyphs from) the same atlas. See SharedGlyphAtlas.
+    // The rendering of frames that use the same atlas is thus serialized, which is cheap compared to
+    // rasterizing the same glyphs for every pane, since most frames only draw glyphs that are already cached.
+    const std::lock_guard atlasLock{ _atlas->mutex };
+    if (_atlas->textureHandle && (!_glyphAtlas || _glyphAtlasGeneration != _atlas->textureGeneration))
+    {
+        _openGlyphAtlas(p);
+    }
+    if (_glyphAtlasKeyedMutex)
+    {
+        THROW_IF_FAILED(_glyphAtlasKeyedMutex->AcquireSync(0, INFINITE));
+    }
+    // NOTE: _resizeGlyphAtlas() may replace _glyphAtlasKeyedMutex during the frame. It's acquired in that case as well.
+    const auto releaseAtlas = wil::scope_exit([&]() noexcept {
+        if (_glyphAtlasKeyedMutex)
+        {
+            LOG_IF_FAILED(_glyphAtlasKeyedMutex->ReleaseSync(0));
+        }
+    });
+
+    _atlas->frame++;
+    // The texture is B8G8R8A8.
+    _glyphAtlasBytes = size_t{ _atlas->size.x } * _atlas->size.y * 4;
+    if (const auto totalArea = u64{ _atlas->size.x } * _atlas->size.y)
+    {
+        u64 usedArea = 0;
+        for (const auto& page : _atlas->pages)
+        {
+            usedArea += page.usedArea;
+        }
+        _frameCounters.glyphAtlasOccupancy = static_cast<f32>(static_cast<double>(usedArea) / static_cast<double>(totalArea));
+    }
+
 #ifndef NDEBUG
     _debugUpdateShaders(p);
 #endif
 
-    // After a Present() the render target becomes unbound.
-    p.deviceContext->OMSetRenderTargets(1, _customRenderTargetView ? _customRenderTargetView.addressof() : _renderTargetView.addressof(), nullptr);
+    if (p.customShaderPaused != _customShaderPaused)
+    {
+        // Shift the start time by the duration of the pause, so that the animation resumes where it left off.
+        const auto now = std::chrono::steady_clock::now();
+        if (p.customShaderPaused)
+        {
+            _customShaderPausedTime = now;
+        }
+        else
+        {
+            _customShaderStartTime += now - _customShaderPausedTime;
+        }
+        _customShaderPaused = p.customShaderPaused;
+        _customShaderNeedsFullFrame = true;
+    }
+
+    // The immediate context is shared with all other instances on the same SharedDevice, which
+    // leave their own state behind. After a Present() the render target becomes unbound as well.
+    _setupDeviceContextState(p);
+
+    // Quads that are flushed before the end of the frame (for instance, because the glyph atlas is full)
+    // are drawn without knowing the final dirty rect yet. Drawing more than needed is harmless.
+    {
+        const D3D11_RECT scissor{ 0, 0, p.s->targetSize.x, p.s->targetSize.y };
+        p.deviceContext->RSSetScissorRects(1, &scissor);
+    }
 
     // Invalidating the render target helps with spotting invalid quad instances and Present1() bugs.
 #if ATLAS_DEBUG_SHOW_DIRTY || ATLAS_DEBUG_DUMP_RENDER_TARGET
@@ -227,8 +316,24 @@ void BackendD3D::Render(RenderingPayload& p)
 #if ATLAS_DEBUG_SHOW_DIRTY
     _debugShowDirty(p);
 #endif
+
+    if (_drawDirtyOnly(p))
+    {
+        // p.dirtyRectInPx is final at this point and everything outside of it will be discarded by Present1().
+        // Clipping the quads to it means that the GPU only fills the rows that actually changed, which
+        // is particularly important for the background quad, as it otherwise covers the entire target.
+        const D3D11_RECT scissor{ p.dirtyRectInPx.left, p.dirtyRectInPx.top, p.dirtyRectInPx.right, p.dirtyRectInPx.bottom };
+        p.deviceContext->RSSetScissorRects(1, &scissor);
+    }
+
     _flushQuads(p);
 
+    if (_atlas->prewarmPosition < p.prewarmGlyphIndices.size() && _atlas->frame >= _atlas->prewarmStartFrame)
+    {
+        _prewarmGlyphs(p);
+        _d2dEndDrawing();
+    }
+
     if (_customPixelShader)
     {
         _executeCustomShader(p);
@@ -241,7 +346,18 @@ void BackendD3D::Render(RenderingPayload& p)
 
 bool BackendD3D::RequiresContinuousRedraw() noexcept
 {
-    return _requiresContinuousRedraw;
+    // A paused animation looks the same in every frame.
+    return _requiresContinuousRedraw && !_customShaderPaused;
+}
+
+size_t BackendD3D::GlyphAtlasBytes() const noexcept
+{
+    return _glyphAtlasBytes;
+}
+
+FrameCounters BackendD3D::LastFrameCounters() const noexcept
+{
+    return _frameCounters;
 }
 
 void BackendD3D::_handleSettingsUpdate(const RenderingPayload& p)
@@ -269,6 +385,12 @@ void BackendD3D::_handleSettingsUpdate(const RenderingPayload& p)
     {
         _recreateBackgroundColorBitmap(p);
     }
+    if (fontChanged || cellCountChanged)
+    {
+        // The image texture depends on both the cell size and count. It's recreated by the next _drawImageRow().
+        _imageTexture.reset();
+        _imageTextureView.reset();
+    }
 
     // Similar to _renderTargetView above, we might have to recreate the _customRenderTargetView whenever _swapChainManager
     // resets it. We only do it after calling _recreateCustomShader however, since that sets the _customPixelShader.
@@ -278,7 +400,6 @@ void BackendD3D::_handleSettingsUpdate(const RenderingPayload& p)
     }
 
     _recreateConstBuffer(p);
-    _setupDeviceContextState(p);
 
     _generation = p.s.generation();
     _fontGeneration = p.s->font.generation();
@@ -292,8 +413,6 @@ void BackendD3D::_updateFontDependents(const RenderingPayload& p)
     const auto& font = *p.s->font;
 
     DWrite_GetRenderParams(p.dwriteFactory.get(), &_gamma, &_cleartypeEnhancedContrast, &_grayscaleEnhancedContrast, _textRenderingParams.put());
-    // Clearing the atlas requires BeginDraw(), which is expensive. Defer this until we need Direct2D anyways.
-    _fontChangedResetGlyphAtlas = true;
     _textShadingType = font.antialiasingMode == AntialiasingMode::ClearType ? ShadingType::TextClearType : ShadingType::TextGrayscale;
 
     {
@@ -320,12 +439,28 @@ void BackendD3D::_updateFontDependents(const RenderingPayload& p)
         }
     }
 
-    if (_d2dRenderTarget)
-    {
-        _d2dRenderTargetUpdateFontSettings(p);
-    }
-
-    _softFontBitmap.reset();
+    // The glyphs in the atlas depend on these settings. Render() switches to the atlas for the new ones,
+    // which may already exist if another pane or tab uses the same font. See _joinGlyphAtlas().
+    {
+        til::hasher h;
+        h.write(font.fontName);
+        h.write(static_cast<const void*>(font.fontAxisValues.data()), font.fontAxisValues.size() * sizeof(DWRITE_FONT_AXIS_VALUE));
+        h.write(font.fontSize);
+        h.write(font.cellSize);
+        h.write(font.fontWeight);
+        h.write(font.advanceWidth);
+        h.write(font.baseline);
+        h.write(font.descender);
+        h.write(font.thinLineWidth);
+        h.write(font.dpi);
+        h.write(font.antialiasingMode);
+        h.write(font.softFontCellSize);
+        h.write(font.softFontPattern.data(), font.softFontPattern.size());
+        _glyphAtlasFontKey = h.finalize();
+    }
+
+    _releaseGlyphAtlasViews();
+    _atlas.reset();
 }
 
 void BackendD3D::_d2dRenderTargetUpdateFontSettings(const RenderingPayload& p) const noexcept
@@ -345,6 +480,10 @@ void BackendD3D::_recreateCustomShader(const RenderingPayload& p)
     _customShaderConstantBuffer.reset();
     _customShaderSamplerState.reset();
     _requiresContinuousRedraw = false;
+    _customShaderPixelLocal = false;
+    // Render() picks the pause up again with the new _customShaderStartTime.
+    _customShaderPaused = false;
+    _customShaderNeedsFullFrame = true;
 
     if (!p.s->misc->customPixelShaderPath.empty())
     {
@@ -412,6 +551,10 @@ void BackendD3D::_recreateCustomShader(const RenderingPayload& p)
                         }
                     }
                 }
+
+                // GetVariableByName() returns a dummy variable whose GetDesc() fails, if there's no such variable.
+                D3D11_SHADER_VARIABLE_DESC pixelLocalDescriptor;
+                _customShaderPixelLocal = SUCCEEDED(reflector->GetVariableByName("PixelLocal")->GetDesc(&pixelLocalDescriptor));
             }
         }
         else
@@ -486,6 +629,7 @@ void BackendD3D::_recreateCustomRenderTargetView(const RenderingPayload& p)
     THROW_IF_FAILED(p.device->CreateTexture2D(&desc, nullptr, _customOffscreenTexture.addressof()));
     THROW_IF_FAILED(p.device->CreateShaderResourceView(_customOffscreenTexture.get(), nullptr, _customOffscreenTextureView.addressof()));
     THROW_IF_FAILED(p.device->CreateRenderTargetView(_customOffscreenTexture.get(), nullptr, _customRenderTargetView.addressof()));
+    _customShaderNeedsFullFrame = true;
 }
 
 void BackendD3D::_recreateBackgroundColorBitmap(const RenderingPayload& p)
@@ -493,6 +637,8 @@ void BackendD3D::_recreateBackgroundColorBitmap(const RenderingPayload& p)
     // Avoid memory usage spikes by releasing memory first.
     _backgroundBitmap.reset();
     _backgroundBitmapView.reset();
+    _foregroundBitmap.reset();
+    _foregroundBitmapView.reset();
 
     const D3D11_TEXTURE2D_DESC desc{
         .Width = p.s->cellCount.x,
@@ -508,6 +654,9 @@ void BackendD3D::_recreateBackgroundColorBitmap(const RenderingPayload& p)
     THROW_IF_FAILED(p.device->CreateTexture2D(&desc, nullptr, _backgroundBitmap.addressof()));
     THROW_IF_FAILED(p.device->CreateShaderResourceView(_backgroundBitmap.get(), nullptr, _backgroundBitmapView.addressof()));
     _backgroundBitmapGeneration = {};
+    THROW_IF_FAILED(p.device->CreateTexture2D(&desc, nullptr, _foregroundBitmap.addressof()));
+    THROW_IF_FAILED(p.device->CreateShaderResourceView(_foregroundBitmap.get(), nullptr, _foregroundBitmapView.addressof()));
+    _foregroundBitmapGeneration = {};
 }
 
 void BackendD3D::_recreateConstBuffer(const RenderingPayload& p) const
@@ -549,12 +698,13 @@ void BackendD3D::_setupDeviceContextState(const RenderingPayload& p)
     viewport.Width = static_cast<f32>(p.s->targetSize.x);
     viewport.Height = static_cast<f32>(p.s->targetSize.y);
     p.deviceContext->RSSetViewports(1, &viewport);
+    p.deviceContext->RSSetState(_rasterizerState.get());
 
     // PS: Pixel Shader
-    ID3D11ShaderResourceView* resources[]{ _backgroundBitmapView.get(), _glyphAtlasView.get() };
+    ID3D11ShaderResourceView* resources[]{ _backgroundBitmapView.get(), _glyphAtlasView.get(), _foregroundBitmapView.get(), _imageTextureView.get() };
     p.deviceContext->PSSetShader(_pixelShader.get(), nullptr, 0);
     p.deviceContext->PSSetConstantBuffers(0, 1, _psConstantBuffer.addressof());
-    p.deviceContext->PSSetShaderResources(0, 2, &resources[0]);
+    p.deviceContext->PSSetShaderResources(0, 4, &resources[0]);
 
     // OM: Output Merger
     p.deviceContext->OMSetBlendState(_blendState.get(), nullptr, 0xffffffff);
@@ -666,6 +816,101 @@ void BackendD3D::_d2dEndDrawing()
     }
 }
 
+// Finds the SharedGlyphAtlas for our adapter and font settings, or creates a new one.
+void BackendD3D::_joinGlyphAtlas(const RenderingPayload& p)
+{
+    static std::mutex mutex;
+    static std::vector<std::weak_ptr<SharedGlyphAtlas>> atlases;
+
+    const std::lock_guard lock{ mutex };
+    std::erase_if(atlases, [](const auto& weak) { return weak.expired(); });
+
+    for (const auto& weak : atlases)
+    {
+        if (auto atlas = weak.lock(); atlas && atlas->fontKey == _glyphAtlasFontKey && memcmp(&atlas->adapterLuid, &p.dxgi.adapterLuid, sizeof(LUID)) == 0)
+        {
+            _atlas = std::move(atlas);
+            return;
+        }
+    }
+
+    _atlas = std::make_shared<SharedGlyphAtlas>();
+    _atlas->adapterLuid = p.dxgi.adapterLuid;
+    _atlas->fontKey = _glyphAtlasFontKey;
+    atlases.emplace_back(_atlas);
+}
+
+// Opens the texture of the SharedGlyphAtlas on our device after another instance created (or replaced) it.
+void BackendD3D::_openGlyphAtlas(const RenderingPayload& p)
+{
+    _releaseGlyphAtlasViews();
+    THROW_IF_FAILED(p.device->OpenSharedResource1(_atlas->textureHandle.get(), IID_PPV_ARGS(_glyphAtlas.addressof())));
+    _glyphAtlasGeneration = _atlas->textureGeneration;
+    _createGlyphAtlasViews(p);
+}
+
+// Creates everything we need to draw from and into _glyphAtlas.
+void BackendD3D::_createGlyphAtlasViews(const RenderingPayload& p)
+{
+    THROW_IF_FAILED(p.device->CreateShaderResourceView(_glyphAtlas.get(), nullptr, _glyphAtlasView.addressof()));
+    _glyphAtlasKeyedMutex = _glyphAtlas.query<IDXGIKeyedMutex>();
+
+    {
+        const auto surface = _glyphAtlas.query<IDXGISurface>();
+
+        static constexpr D2D1_RENDER_TARGET_PROPERTIES props{
+            .type = D2D1_RENDER_TARGET_TYPE_DEFAULT,
+            .pixelFormat = { DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED },
+        };
+        // ID2D1RenderTarget and ID2D1DeviceContext are the same and I'm tired of pretending they're not.
+        THROW_IF_FAILED(p.d2dFactory->CreateDxgiSurfaceRenderTarget(surface.get(), &props, reinterpret_cast<ID2D1RenderTarget**>(_d2dRenderTarget.addressof())));
+        _d2dRenderTarget.try_query_to(_d2dRenderTarget4.addressof());
+
+        _d2dRenderTarget->SetUnitMode(D2D1_UNIT_MODE_PIXELS);
+        // We don't really use D2D for anything except DWrite, but it
+        // can't hurt to ensure that everything it does is pixel aligned.
+        _d2dRenderTarget->SetAntialiasMode(D2D1_ANTIALIAS_MODE_ALIASED);
+        // Ensure that D2D uses the exact same gamma as our shader uses.
+        _d2dRenderTarget->SetTextRenderingParams(_textRenderingParams.get());
+
+        _d2dRenderTargetUpdateFontSettings(p);
+    }
+
+    // We have our own glyph cache so Direct2D's cache doesn't help much.
+    // This saves us 1MB of RAM, which is not much, but also not nothing.
+    {
+        wil::com_ptr<ID2D1Device> device;
+        _d2dRenderTarget4->GetDevice(device.addressof());
+
+        device->SetMaximumTextureMemory(0);
+        if (const auto device4 = device.try_query<ID2D1Device4>())
+        {
+            device4->SetMaximumColorGlyphCacheMemory(0);
+        }
+    }
+
+    {
+        static constexpr D2D1_COLOR_F color{ 1, 1, 1, 1 };
+        THROW_IF_FAILED(_d2dRenderTarget->CreateSolidColorBrush(&color, nullptr, _emojiBrush.put()));
+        THROW_IF_FAILED(_d2dRenderTarget->CreateSolidColorBrush(&color, nullptr, _brush.put()));
+    }
+
+    ID3D11ShaderResourceView* resources[]{ _backgroundBitmapView.get(), _glyphAtlasView.get(), _foregroundBitmapView.get(), _imageTextureView.get() };
+    p.deviceContext->PSSetShaderResources(0, 4, &resources[0]);
+}
+
+void BackendD3D::_releaseGlyphAtlasViews() noexcept
+{
+    _d2dRenderTarget.reset();
+    _d2dRenderTarget4.reset();
+    _emojiBrush.reset();
+    _brush.reset();
+    _softFontBitmap.reset();
+    _glyphAtlasKeyedMutex.reset();
+    _glyphAtlasView.reset();
+    _glyphAtlas.reset();
+}
+
 void BackendD3D::_resetGlyphAtlas(const RenderingPayload& p)
 {
     // The index returned by _BitScanReverse is undefined when the input is 0. We can simultaneously guard
@@ -677,8 +922,8 @@ void BackendD3D::_resetGlyphAtlas(const RenderingPayload& p)
     const auto cellArea = static_cast<u32>(p.s->font->cellSize.x) * p.s->font->cellSize.y;
     const auto targetArea = static_cast<u32>(p.s->targetSize.x) * p.s->targetSize.y;
 
-    const auto minAreaByFont = cellArea * 95; // Covers all printable ASCII characters
-    const auto minAreaByGrowth = static_cast<u32>(_rectPacker.width) * _rectPacker.height * 2;
+    const auto minAreaByFont = cellArea * std::max<u32>(95, gsl::narrow_cast<u32>(p.prewarmGlyphIndices.size())); // Covers all printable ASCII or prewarmed characters
+    const auto minAreaByGrowth = static_cast<u32>(_atlas->size.x) * _atlas->size.y * 2;
     const auto min = std::max(minArea, std::max(minAreaByFont, minAreaByGrowth));
 
     // It's hard to say what the max. size of the cache should be. Optimally I think we should use as much
@@ -688,7 +933,8 @@ void BackendD3D::_resetGlyphAtlas(const RenderingPayload& p)
     // we're locked into a state, where on every render pass we're starting with a half full atlas, drawing once,
     // filling it with the remaining half and drawing again, requiring two rendering passes on each frame.
     const auto maxAreaByFont = targetArea + targetArea / 4;
-    const auto area = std::min(maxArea, std::min(maxAreaByFont, min));
+    const auto maxAreaTotal = std::min(maxArea, maxAreaByFont);
+    const auto area = std::min(maxAreaTotal, min);
 
     // This block of code calculates the size of a power-of-2 texture that has an area larger than the given `area`.
     // For instance, for an area of 985x1946 = 1916810 it would result in a u/v of 2048x1024 (area = 2097152).
@@ -699,14 +945,38 @@ void BackendD3D::_resetGlyphAtlas(const RenderingPayload& p)
     const auto u = static_cast<u16>(1u << ((index + 2) / 2));
     const auto v = static_cast<u16>(1u << ((index + 1) / 2));
 
-    if (u != _rectPacker.width || v != _rectPacker.height)
+    if (u != _atlas->size.x || v != _atlas->size.y)
     {
         _resizeGlyphAtlas(p, u, v);
     }
 
-    stbrp_init_target(&_rectPacker, u, v, _rectPackerData.data(), _rectPackerData.size());
+    // Once the atlas can't grow anymore, _packGlyph() evicts pages instead of resetting the atlas.
+    _atlas->canGrow = static_cast<u32>(u) * v < maxAreaTotal;
 
-    for (auto& slot : _glyphAtlasMap.container())
+    // Each page should be tall enough to fit even large glyphs, like double-height emojis.
+    // With 8 pages at most, each eviction throws away no more than 1/8th of the atlas.
+    static constexpr u32 maxPages = 8;
+    const auto pageHeight = std::min<u32>(v, std::max<u32>(v / maxPages, std::bit_ceil(p.s->font->cellSize.y * 8u)));
+    const auto pageCount = v / pageHeight;
+    _atlas->pageShift = gsl::narrow_cast<u16>(std::countr_zero(pageHeight));
+    _atlas->currentPage = 0;
+
+    if (_atlas->pages.size() != pageCount)
+    {
+        _atlas->pages = Buffer<AtlasPage>{ pageCount };
+    }
+    for (auto& page : _atlas->pages)
+    {
+        if (page.nodes.size() != u)
+        {
+            page.nodes = Buffer<stbrp_node>{ u };
+        }
+        stbrp_init_target(&page.packer, u, pageHeight, page.nodes.data(), page.nodes.size());
+        page.lastUse = 0;
+        page.usedArea = 0;
+    }
+
+    for (auto& slot : _atlas->map.container())
     {
         slot.inner.reset();
     }
@@ -714,74 +984,226 @@ void BackendD3D::_resetGlyphAtlas(const RenderingPayload& p)
     _d2dBeginDrawing();
     _d2dRenderTarget->Clear();
 
-    _fontChangedResetGlyphAtlas = false;
+    // The first frame after a reset shouldn't be delayed by prewarming. It starts with the one after that.
+    _atlas->prewarmPosition = 0;
+    _atlas->prewarmStartFrame = _atlas->frame + 1;
+    _atlas->resets++;
+    _debugGlyphAtlasStats(L"reset");
 }
 
-void BackendD3D::_resizeGlyphAtlas(const RenderingPayload& p, const u16 u, const u16 v)
+// Finds room for the given rect in the glyph atlas and offsets it to its position within the texture.
+// Pages are filled in order. Once all of them are full and the atlas can't grow anymore, the least recently used
+// page is evicted, which is a lot cheaper than throwing away (and rasterizing again) every glyph we know of.
+// Returns false if the caller needs to start over, because glyphEntry may have been invalidated.
+bool BackendD3D::_packGlyph(const RenderingPayload& p, const AtlasGlyphEntry& glyphEntry, stbrp_rect& rect)
 {
-    _d2dRenderTarget.reset();
-    _d2dRenderTarget4.reset();
-    _glyphAtlas.reset();
-    _glyphAtlasView.reset();
+    auto& page = _atlas->pages[_atlas->currentPage];
+    if (stbrp_pack_rects(&page.packer, &rect, 1))
+    {
+        rect.y += _atlas->currentPage << _atlas->pageShift;
+        page.lastUse = _atlas->frame;
+        page.usedArea += static_cast<u32>(rect.w) * rect.h;
+        return true;
+    }
 
+    const auto next = _atlas->currentPage + 1;
+    if (next < _atlas->pages.size() && _atlas->pages[next].usedArea == 0)
     {
-        const D3D11_TEXTURE2D_DESC desc{
-            .Width = u,
-            .Height = v,
-            .MipLevels = 1,
-            .ArraySize = 1,
-            .Format = DXGI_FORMAT_B8G8R8A8_UNORM,
-            .SampleDesc = { 1, 0 },
-            .BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET,
-        };
-        THROW_IF_FAILED(p.device->CreateTexture2D(&desc, nullptr, _glyphAtlas.addressof()));
-        THROW_IF_FAILED(p.device->CreateShaderResourceView(_glyphAtlas.get(), nullptr, _glyphAtlasView.addressof()));
+        _atlas->currentPage = gsl::narrow_cast<u16>(next);
+        return _packGlyph(p, glyphEntry, rect);
     }
 
+    // Prewarming is only worth it as long as it doesn't push out any glyphs. See _prewarmGlyphs().
+    if (_prewarming)
     {
-        const auto surface = _glyphAtlas.query<IDXGISurface>();
+        return false;
+    }
 
-        static constexpr D2D1_RENDER_TARGET_PROPERTIES props{
-            .type = D2D1_RENDER_TARGET_TYPE_DEFAULT,
-            .pixelFormat = { DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED },
-        };
-        // ID2D1RenderTarget and ID2D1DeviceContext are the same and I'm tired of pretending they're not.
-        THROW_IF_FAILED(p.d2dFactory->CreateDxgiSurfaceRenderTarget(surface.get(), &props, reinterpret_cast<ID2D1RenderTarget**>(_d2dRenderTarget.addressof())));
-        _d2dRenderTarget.try_query_to(_d2dRenderTarget4.addressof());
+    // If the glyph doesn't even fit into an empty page, we need a larger atlas.
+    if (_atlas->canGrow || page.usedArea == 0)
+    {
+        _drawGlyphPrepareRetry(p);
+        return false;
+    }
 
-        _d2dRenderTarget->SetUnitMode(D2D1_UNIT_MODE_PIXELS);
-        // We don't really use D2D for anything except DWrite, but it
-        // can't hurt to ensure that everything it does is pixel aligned.
-        _d2dRenderTarget->SetAntialiasMode(D2D1_ANTIALIAS_MODE_ALIASED);
-        // Ensure that D2D uses the exact same gamma as our shader uses.
-        _d2dRenderTarget->SetTextRenderingParams(_textRenderingParams.get());
+    u16 victim = 0;
+    for (u16 i = 1; i < _atlas->pages.size(); ++i)
+    {
+        if (_atlas->pages[i].lastUse < _atlas->pages[victim].lastUse)
+        {
+            victim = i;
+        }
+    }
 
-        _d2dRenderTargetUpdateFontSettings(p);
+    _evictGlyphAtlasPage(p, glyphEntry, victim);
+    _atlas->currentPage = victim;
+    return false;
+}
+
+// Removes all glyphs on the given page from _atlas->map, so that they get rasterized again when they're needed.
+// glyphEntry is the entry that's currently being drawn. It's removed as well, since it isn't in the atlas yet.
+void BackendD3D::_evictGlyphAtlasPage(const RenderingPayload& p, const AtlasGlyphEntry& glyphEntry, const u16 index)
+{
+    auto& page = _atlas->pages[index];
+
+    // Quads that we've appended during this frame may still refer to glyphs on this page.
+    if (page.lastUse == _atlas->frame)
+    {
+        _d2dEndDrawing();
+        _flushQuads(p);
     }
 
-    // We have our own glyph cache so Direct2D's cache doesn't help much.
-    // This saves us 1MB of RAM, which is not much, but also not nothing.
+    _eraseGlyphs(glyphEntry, index);
+
+    const auto pageHeight = 1u << _atlas->pageShift;
+    stbrp_init_target(&page.packer, _atlas->size.x, pageHeight, page.nodes.data(), page.nodes.size());
+    page.lastUse = 0;
+    page.usedArea = 0;
+
+    const D2D1_RECT_F rect{
+        0,
+        static_cast<f32>(index * pageHeight),
+        static_cast<f32>(_atlas->size.x),
+        static_cast<f32>((index + 1) * pageHeight),
+    };
+    _d2dBeginDrawing();
+    _d2dRenderTarget->PushAxisAlignedClip(&rect, D2D1_ANTIALIAS_MODE_ALIASED);
+    _d2dRenderTarget->Clear();
+    _d2dRenderTarget->PopAxisAlignedClip();
+
+    _atlas->evictions++;
+    _debugGlyphAtlasStats(L"evicted page");
+}
+
+// Removes glyphEntry, as well as all glyphs on the given page, from _atlas->map.
+// Pass a page index of _atlas->pages.size() or larger to only remove glyphEntry.
+void BackendD3D::_eraseGlyphs(const AtlasGlyphEntry& glyphEntry, const size_t page)
+{
+    for (auto& slot : _atlas->map.container())
     {
-        wil::com_ptr<ID2D1Device> device;
-        _d2dRenderTarget4->GetDevice(device.addressof());
+        if (!slot)
+        {
+            continue;
+        }
 
-        device->SetMaximumTextureMemory(0);
-        if (const auto device4 = device.try_query<ID2D1Device4>())
+        // linear_flat_set doesn't support removal, so we build a new one with the remaining glyphs.
+        // Glyphs that have no quads (whitespace) aren't in the atlas and are kept.
+        auto& glyphs = slot.inner->glyphs;
+        til::linear_flat_set<AtlasGlyphEntry> remaining;
+
+        for (const auto& g : glyphs.container())
         {
-            device4->SetMaximumColorGlyphCacheMemory(0);
+            if (g && &g != &glyphEntry && (g.data.GetShadingType() == ShadingType::Default || (g.data.texcoord.y >> _atlas->pageShift) != page))
+            {
+                remaining.insert(g.glyphIndex).first.data = g.data;
+            }
         }
+
+        glyphs = std::move(remaining);
     }
+}
 
+// Rasterizes the glyphs in p.prewarmGlyphIndices into the atlas ahead of time, so that they don't need to be
+// rasterized on demand once they show up. The Direct3D device context can only be used on the render thread, so
+// instead of using a background thread this runs after a frame has been drawn, within a small time budget per frame.
+void BackendD3D::_prewarmGlyphs(const RenderingPayload& p)
+{
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(2);
+
+    _prewarming = true;
+    const auto cleanup = wil::scope_exit([&]() noexcept {
+        _prewarming = false;
+    });
+
+    for (const auto& m : p.prewarmMappings)
     {
-        static constexpr D2D1_COLOR_F color{ 1, 1, 1, 1 };
-        THROW_IF_FAILED(_d2dRenderTarget->CreateSolidColorBrush(&color, nullptr, _emojiBrush.put()));
-        THROW_IF_FAILED(_d2dRenderTarget->CreateSolidColorBrush(&color, nullptr, _brush.put()));
+        if (_atlas->prewarmPosition >= m.glyphsTo)
+        {
+            continue;
+        }
+
+        const AtlasFontFaceKey fontFaceKey{
+            .fontFace = m.fontFace.get(),
+            .lineRendition = LineRendition::SingleWidth,
+        };
+        auto& fontFaceEntry = *_atlas->map.insert(fontFaceKey).first.inner;
+
+        for (; _atlas->prewarmPosition < m.glyphsTo; ++_atlas->prewarmPosition)
+        {
+            if (std::chrono::steady_clock::now() >= deadline)
+            {
+                return;
+            }
+
+            // Glyph index 0 is the .notdef glyph of fonts that don't have the character.
+            const auto glyphIndex = p.prewarmGlyphIndices[_atlas->prewarmPosition];
+            if (!glyphIndex)
+            {
+                continue;
+            }
+
+            const auto [glyphEntry, inserted] = fontFaceEntry.glyphs.insert(glyphIndex);
+            if (inserted && !_drawGlyph(p, fontFaceEntry, glyphEntry))
+            {
+                // The atlas is full. The entry we inserted has no glyph data, so it needs to go.
+                _eraseGlyphs(glyphEntry, _atlas->pages.size());
+                _atlas->prewarmPosition = p.prewarmGlyphIndices.size();
+                return;
+            }
+        }
     }
+}
 
-    ID3D11ShaderResourceView* resources[]{ _backgroundBitmapView.get(), _glyphAtlasView.get() };
-    p.deviceContext->PSSetShaderResources(0, 2, &resources[0]);
+void BackendD3D::_debugGlyphAtlasStats([[maybe_unused]] const wchar_t* event) const noexcept
+{
+#if ATLAS_DEBUG_GLYPH_ATLAS_STATS
+    uint64_t usedArea = 0;
+    for (const auto& page : _atlas->pages)
+    {
+        usedArea += page.usedArea;
+    }
 
-    _rectPackerData = Buffer<stbrp_node>{ u };
+    const auto totalArea = static_cast<uint64_t>(_atlas->size.x) * _atlas->size.y;
+    wchar_t buffer[256];
+    swprintf_s(buffer, L"glyph atlas %s: %ux%u, %zu pages, %.1f%% occupied, %zu evictions, %zu resets\n", event, _atlas->size.x, _atlas->size.y, _atlas->pages.size(), 100.0 * usedArea / totalArea, _atlas->evictions, _atlas->resets);
+    OutputDebugStringW(&buffer[0]);
+#endif
+}
+
+void BackendD3D::_resizeGlyphAtlas(const RenderingPayload& p, const u16 u, const u16 v)
+{
+    // Render() acquired the keyed mutex of the old texture. It's released before it's gone.
+    if (_glyphAtlasKeyedMutex)
+    {
+        LOG_IF_FAILED(_glyphAtlasKeyedMutex->ReleaseSync(0));
+    }
+    _releaseGlyphAtlasViews();
+
+    {
+        const D3D11_TEXTURE2D_DESC desc{
+            .Width = u,
+            .Height = v,
+            .MipLevels = 1,
+            .ArraySize = 1,
+            .Format = DXGI_FORMAT_B8G8R8A8_UNORM,
+            .SampleDesc = { 1, 0 },
+            .BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET,
+            // The other instances that use the same SharedGlyphAtlas open the texture on their device via this handle.
+            .MiscFlags = D3D11_RESOURCE_MISC_SHARED_NTHANDLE | D3D11_RESOURCE_MISC_SHARED_KEYEDMUTEX,
+        };
+        THROW_IF_FAILED(p.device->CreateTexture2D(&desc, nullptr, _glyphAtlas.addressof()));
+
+        wil::unique_handle handle;
+        THROW_IF_FAILED(_glyphAtlas.query<IDXGIResource1>()->CreateSharedHandle(nullptr, DXGI_SHARED_RESOURCE_READ | DXGI_SHARED_RESOURCE_WRITE, nullptr, handle.addressof()));
+        _atlas->textureHandle = std::move(handle);
+        _atlas->textureGeneration.bump();
+        _glyphAtlasGeneration = _atlas->textureGeneration;
+    }
+
+    _createGlyphAtlasViews(p);
+    THROW_IF_FAILED(_glyphAtlasKeyedMutex->AcquireSync(0, INFINITE));
+
+    _atlas->size = { u, v };
 }
 
 BackendD3D::QuadInstance& BackendD3D::_getLastQuad() noexcept
@@ -835,11 +1257,24 @@ void BackendD3D::_flushQuads(const RenderingPayload& p)
         _recreateInstanceBuffers(p);
     }
 
+    // The instance buffer is used as a ring buffer: Each flush appends its instances after the previous ones with
+    // D3D11_MAP_WRITE_NO_OVERWRITE, which promises the driver that we won't touch any data the GPU may still be using.
+    // Only once the buffer is full do we start over with D3D11_MAP_WRITE_DISCARD, which makes the driver allocate
+    // a new buffer behind the scenes. Since most frames only draw a few dirty rows, this avoids renaming
+    // (and on some drivers, copying) the entire buffer during every single flush.
+    auto mapType = D3D11_MAP_WRITE_NO_OVERWRITE;
+    if (_instancesCount > _instanceBufferCapacity - _instanceBufferOffset)
+    {
+        mapType = D3D11_MAP_WRITE_DISCARD;
+        _instanceBufferOffset = 0;
+    }
+
     {
         D3D11_MAPPED_SUBRESOURCE mapped{};
-        THROW_IF_FAILED(p.deviceContext->Map(_instanceBuffer.get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped));
-        memcpy(mapped.pData, _instances.data(), _instancesCount * sizeof(QuadInstance));
+        THROW_IF_FAILED(p.deviceContext->Map(_instanceBuffer.get(), 0, mapType, 0, &mapped));
+        memcpy(static_cast<QuadInstance*>(mapped.pData) + _instanceBufferOffset, _instances.data(), _instancesCount * sizeof(QuadInstance));
         p.deviceContext->Unmap(_instanceBuffer.get(), 0);
+        _frameCounters.uploadedBytes += _instancesCount * sizeof(QuadInstance);
     }
 
     // I found 4 approaches to drawing lots of quads quickly. There are probably even more.
@@ -861,7 +1296,8 @@ void BackendD3D::_flushQuads(const RenderingPayload& p)
     //   Instead I found that packing instance data as tightly as possible made the biggest performance difference,
     //   and packing 16 bit integers with ID3D11InputLayout is quite a bit more convenient too.
 
-    p.deviceContext->DrawIndexedInstanced(6, static_cast<UINT>(_instancesCount), 0, 0, 0);
+    p.deviceContext->DrawIndexedInstanced(6, static_cast<UINT>(_instancesCount), 0, 0, static_cast<UINT>(_instanceBufferOffset));
+    _instanceBufferOffset += _instancesCount;
     _instancesCount = 0;
 }
 
@@ -896,6 +1332,8 @@ void BackendD3D::_recreateInstanceBuffers(const RenderingPayload& p)
     p.deviceContext->IASetVertexBuffers(0, 2, &vertexBuffers[0], &strides[0], &offsets[0]);
 
     _instanceBufferCapacity = newCapacity;
+    // A new buffer must initially be mapped with D3D11_MAP_WRITE_DISCARD. See _flushQuads().
+    _instanceBufferOffset = newCapacity;
 }
 
 void BackendD3D::_drawBackground(const RenderingPayload& p)
@@ -913,12 +1351,26 @@ void BackendD3D::_drawBackground(const RenderingPayload& p)
 }
 
 void BackendD3D::_uploadBackgroundBitmap(const RenderingPayload& p)
+{
+    _uploadColorBitmap(p, _backgroundBitmap.get(), p.backgroundBitmap);
+    _frameCounters.uploadedBytes += p.backgroundBitmap.size() * sizeof(u32);
+    _backgroundBitmapGeneration = p.colorBitmapGenerations[0];
+}
+
+void BackendD3D::_uploadForegroundBitmap(const RenderingPayload& p)
+{
+    _uploadColorBitmap(p, _foregroundBitmap.get(), p.foregroundBitmap);
+    _frameCounters.uploadedBytes += p.foregroundBitmap.size() * sizeof(u32);
+    _foregroundBitmapGeneration = p.colorBitmapGenerations[1];
+}
+
+void BackendD3D::_uploadColorBitmap(const RenderingPayload& p, ID3D11Texture2D* texture, std::span<const u32> bitmap) const
 {
     D3D11_MAPPED_SUBRESOURCE mapped{};
-    THROW_IF_FAILED(p.deviceContext->Map(_backgroundBitmap.get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped));
+    THROW_IF_FAILED(p.deviceContext->Map(texture, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped));
 
-    auto src = std::bit_cast<const char*>(p.backgroundBitmap.data());
-    const auto srcEnd = std::bit_cast<const char*>(p.backgroundBitmap.data() + p.backgroundBitmap.size());
+    auto src = std::bit_cast<const char*>(bitmap.data());
+    const auto srcEnd = std::bit_cast<const char*>(bitmap.data() + bitmap.size());
     const auto srcStride = p.colorBitmapRowStride * sizeof(u32);
     auto dst = static_cast<char*>(mapped.pData);
 
@@ -929,119 +1381,284 @@ void BackendD3D::_uploadBackgroundBitmap(const RenderingPayload& p)
         dst += mapped.RowPitch;
     }
 
-    p.deviceContext->Unmap(_backgroundBitmap.get(), 0);
-    _backgroundBitmapGeneration = p.colorBitmapGenerations[0];
+    p.deviceContext->Unmap(texture, 0);
 }
 
 void BackendD3D::_drawText(RenderingPayload& p)
 {
-    if (_fontChangedResetGlyphAtlas)
+    // Clearing the atlas requires BeginDraw(), which is expensive. After a font change, this is thus deferred until we
+    // draw text. If the atlas is shared and was already created by another instance, Render() opened it instead.
+    if (!_glyphAtlas)
     {
         _resetGlyphAtlas(p);
     }
 
     til::CoordType dirtyTop = til::CoordTypeMax;
     til::CoordType dirtyBottom = til::CoordTypeMin;
+    const auto dirtyOnly = _drawDirtyOnly(p);
 
+    // The rows that weren't invalidated look exactly like they did in the previous frame, only shifted by the scroll
+    // offset. Present1() copies them over from the previous frame (it blits the scrolled area, see AtlasEngine::_present()),
+    // so they only need to be drawn where they overlap the dirty rect. When scrolling this means that only the
+    // newly exposed rows are drawn, instead of all of them. The dirty rect is only known once the invalidated
+    // rows have been drawn, since their glyphs may extend past their cells, and so we need 2 passes.
     u16 y = 0;
     for (const auto row : p.rows)
     {
-        f32 baselineX = 0;
-        f32 baselineY = y * p.s->font->cellSize.y + p.s->font->baseline;
-        f32 scaleX = 1;
-        f32 scaleY = 1;
+        const auto invalidated = p.invalidatedRows.contains(y);
+
+        if (invalidated || !dirtyOnly)
+        {
+            _drawTextRow(p, y);
+        }
 
-        if (row->lineRendition != LineRendition::SingleWidth)
+        if (invalidated)
         {
-            scaleX = 2;
+            dirtyTop = std::min(dirtyTop, row->dirtyTop);
+            dirtyBottom = std::max(dirtyBottom, row->dirtyBottom);
+        }
+
+        ++y;
+    }
+
+    if (dirtyTop < dirtyBottom)
+    {
+        p.dirtyRectInPx.top = std::min(p.dirtyRectInPx.top, dirtyTop);
+        p.dirtyRectInPx.bottom = std::max(p.dirtyRectInPx.bottom, dirtyBottom);
+    }
 
-            if (row->lineRendition >= LineRendition::DoubleHeightTop)
+    if (dirtyOnly)
+    {
+        y = 0;
+        for (const auto row : p.rows)
+        {
+            if (!p.invalidatedRows.contains(y) && row->dirtyTop < p.dirtyRectInPx.bottom && row->dirtyBottom > p.dirtyRectInPx.top)
             {
-                scaleY = 2;
-                baselineY /= 2;
+                _drawTextRow(p, y);
             }
+
+            ++y;
         }
+    }
+
+    _d2dEndDrawing();
+}
+
+void BackendD3D::_drawTextRow(const RenderingPayload& p, u16 y)
+{
+    const auto row = p.rows[y];
+    f32 baselineX = 0;
+    f32 baselineY = y * p.s->font->cellSize.y + p.s->font->baseline;
+    f32 scaleX = 1;
+    f32 scaleY = 1;
+
+    if (row->lineRendition != LineRendition::SingleWidth)
+    {
+        scaleX = 2;
 
-        for (const auto& m : row->mappings)
+        if (row->lineRendition >= LineRendition::DoubleHeightTop)
         {
-            auto x = m.glyphsFrom;
-            const AtlasFontFaceKey fontFaceKey{
-                .fontFace = m.fontFace.get(),
-                .lineRendition = row->lineRendition,
-            };
+            scaleY = 2;
+            baselineY /= 2;
+        }
+    }
 
-        // This goto label exists to allow us to retry rendering a glyph if the glyph atlas was full.
-        // We need to goto here, because a retry will cause the atlas texture as well as the
-        // _glyphCache hashmap to be cleared, and so we'll have to call insert() again.
-        drawGlyphRetry:
-            auto& fontFaceEntry = *_glyphAtlasMap.insert(fontFaceKey).first.inner;
+    for (const auto& m : row->mappings)
+    {
+        auto x = m.glyphsFrom;
+        const AtlasFontFaceKey fontFaceKey{
+            .fontFace = m.fontFace.get(),
+            .lineRendition = row->lineRendition,
+        };
+
+    // This goto label exists to allow us to retry rendering a glyph if the glyph atlas was full.
+    // We need to goto here, because a retry will cause the atlas texture as well as the
+    // _glyphCache hashmap to be cleared, and so we'll have to call insert() again.
+    drawGlyphRetry:
+        auto& fontFaceEntry = *_atlas->map.insert(fontFaceKey).first.inner;
 
-            while (x < m.glyphsTo)
+        while (x < m.glyphsTo)
+        {
+            if (!m.fontFace && IsBuiltinGlyph(row->glyphIndices[x]))
             {
-                const auto [glyphEntry, inserted] = fontFaceEntry.glyphs.insert(row->glyphIndices[x]);
+                _drawBuiltinGlyph(p, *row, y, x, baselineX, scaleX);
+                baselineX += row->glyphAdvances[x];
+                ++x;
+                continue;
+            }
 
-                if (inserted && !_drawGlyph(p, fontFaceEntry, glyphEntry))
-                {
-                    // A deadlock in this retry loop is detected in _drawGlyphPrepareRetry.
-                    //
-                    // Yes, I agree, avoid goto. Sometimes. It's not my fault that C++ still doesn't
-                    // have a `continue outerloop;` like other languages had it for decades. :(
+            const auto [glyphEntry, inserted] = fontFaceEntry.glyphs.insert(row->glyphIndices[x]);
+            _frameCounters.glyphLookups++;
+
+            if (inserted && !_drawGlyph(p, fontFaceEntry, glyphEntry))
+            {
+                // A deadlock in this retry loop is detected in _drawGlyphPrepareRetry.
+                //
+                // Yes, I agree, avoid goto. Sometimes. It's not my fault that C++ still doesn't
+                // have a `continue outerloop;` like other languages had it for decades. :(
 #pragma warning(suppress : 26438) // Avoid 'goto' (es.76).
 #pragma warning(suppress : 26448) // Consider using gsl::finally if final action is intended (gsl.util).
-                    goto drawGlyphRetry;
-                }
+                goto drawGlyphRetry;
+            }
 
-                if (glyphEntry.data.GetShadingType() != ShadingType::Default)
-                {
-                    auto l = static_cast<til::CoordType>(lrintf((baselineX + row->glyphOffsets[x].advanceOffset) * scaleX));
-                    auto t = static_cast<til::CoordType>(lrintf((baselineY - row->glyphOffsets[x].ascenderOffset) * scaleY));
+            if (glyphEntry.data.GetShadingType() != ShadingType::Default)
+            {
+                _atlas->pages[glyphEntry.data.texcoord.y >> _atlas->pageShift].lastUse = _atlas->frame;
 
-                    l += glyphEntry.data.offset.x;
-                    t += glyphEntry.data.offset.y;
+                auto l = static_cast<til::CoordType>(lrintf((baselineX + row->glyphOffsets[x].advanceOffset) * scaleX));
+                auto t = static_cast<til::CoordType>(lrintf((baselineY - row->glyphOffsets[x].ascenderOffset) * scaleY));
 
-                    row->dirtyTop = std::min(row->dirtyTop, t);
-                    row->dirtyBottom = std::max(row->dirtyBottom, t + glyphEntry.data.size.y);
+                l += glyphEntry.data.offset.x;
+                t += glyphEntry.data.offset.y;
 
-                    _appendQuad() = {
-                        .shadingType = glyphEntry.data.GetShadingType(),
-                        .position = { static_cast<i16>(l), static_cast<i16>(t) },
-                        .size = glyphEntry.data.size,
-                        .texcoord = glyphEntry.data.texcoord,
-                        .color = row->colors[x],
-                    };
+                row->dirtyTop = std::min(row->dirtyTop, t);
+                row->dirtyBottom = std::max(row->dirtyBottom, t + glyphEntry.data.size.y);
 
-                    if (glyphEntry.data.overlapSplit)
-                    {
-                        _drawTextOverlapSplit(p, y);
-                    }
-                }
+                _appendQuad() = {
+                    .shadingType = glyphEntry.data.GetShadingType(),
+                    .position = { static_cast<i16>(l), static_cast<i16>(t) },
+                    .size = glyphEntry.data.size,
+                    .texcoord = glyphEntry.data.texcoord,
+                    .color = row->colors[x],
+                };
 
-                baselineX += row->glyphAdvances[x];
-                ++x;
+                if (glyphEntry.data.overlapSplit)
+                {
+                    _drawTextOverlapSplit(p, y);
+                }
             }
-        }
 
-        if (!row->gridLineRanges.empty())
-        {
-            _drawGridlines(p, y);
+            baselineX += row->glyphAdvances[x];
+            ++x;
         }
+    }
+
+    if (!row->gridLineRanges.empty())
+    {
+        _drawGridlines(p, y);
+    }
+
+    if (!row->imagePixels.empty())
+    {
+        _drawImageRow(p, y);
+    }
+}
+
+// Builtin glyphs take no space in the glyph atlas. The pixel shader draws them from the
+// descriptor in QuadInstance::builtinGlyph instead. Its layout is explained in builtin_glyphs.hlsl.
+void BackendD3D::_drawBuiltinGlyph(const RenderingPayload& p, const ShapedRow& row, u16 y, u32 x, f32 baselineX, f32 scaleX)
+{
+    const auto cellSize = p.s->font->cellSize;
+    const u32 ch = row.glyphIndices[x];
+    const u32 index = ch >= 0x2800 ? 160 + (ch - 0x2800) : ch - 0x2500;
+    const auto columns = clamp<u32>(static_cast<u32>(lrintf(row.glyphAdvances[x] * scaleX / cellSize.x)), 1, 7);
+    const u32 doubleHeight = row.lineRendition >= LineRendition::DoubleHeightTop;
+    // The bottom half of a double-height row draws the bottom half of the glyph.
+    const u32 top = row.lineRendition == LineRendition::DoubleHeightBottom ? cellSize.y : 0;
+
+    _appendQuad() = {
+        .shadingType = ShadingType::BuiltinGlyph,
+        .builtinGlyph = static_cast<u16>(index | columns << 9 | doubleHeight << 12),
+        .position = { static_cast<i16>(lrintf(baselineX * scaleX)), static_cast<i16>(y * cellSize.y) },
+        .size = { static_cast<u16>(columns * cellSize.x), cellSize.y },
+        .texcoord = { 0, static_cast<u16>(top) },
+        .color = row.colors[x],
+    };
+}
+
+void BackendD3D::_drawImageRow(const RenderingPayload& p, u16 y)
+{
+    const auto row = p.rows[y];
+    const auto cellSize = p.s->font->cellSize;
+
+    if (!_imageTexture)
+    {
+        _recreateImageTexture(p);
+    }
+
+    const u32 left = row->imageColumnFrom * cellSize.x;
+    const u32 top = y * cellSize.y;
+    const u32 width = (row->imageColumnTo - row->imageColumnFrom) * cellSize.x;
+    const u32 height = cellSize.y;
+
+    if (_imageRowGenerations[y] != row->imageGeneration)
+    {
+        // The image is stored at a virtual cell size and gets scaled to the font's cell size with nearest-neighbor
+        // sampling. Sixel images are pixel art more often than not and this keeps their edges crisp.
+        const u32 srcCellWidth = row->imageCellSize.x;
+        const u32 srcCellHeight = row->imageCellSize.y;
+        const u32 srcStride = (row->imageColumnTo - row->imageColumnFrom) * srcCellWidth;
+
+        _imageScratch.resize(static_cast<size_t>(width) * height);
+        auto dst = _imageScratch.data();
 
-        if (p.invalidatedRows.contains(y))
+        for (u32 dy = 0; dy < height; ++dy)
         {
-            dirtyTop = std::min(dirtyTop, row->dirtyTop);
-            dirtyBottom = std::max(dirtyBottom, row->dirtyBottom);
+            const auto src = &row->imagePixels[static_cast<size_t>(dy * srcCellHeight / height) * srcStride];
+            for (u32 dx = 0; dx < width; ++dx)
+            {
+                const auto column = dx / cellSize.x;
+                const auto sx = column * srcCellWidth + (dx % cellSize.x) * srcCellWidth / cellSize.x;
+                *dst++ = src[sx];
+            }
         }
 
-        ++y;
+        const D3D11_BOX box{ left, top, 0, left + width, top + height, 1 };
+        p.deviceContext->UpdateSubresource(_imageTexture.get(), 0, &box, _imageScratch.data(), width * sizeof(u32), 0);
+        _frameCounters.uploadedBytes += static_cast<u64>(width) * height * sizeof(u32);
+        _imageRowGenerations[y] = row->imageGeneration;
     }
 
-    if (dirtyTop < dirtyBottom)
+    row->dirtyTop = std::min(row->dirtyTop, static_cast<til::CoordType>(top));
+    row->dirtyBottom = std::max(row->dirtyBottom, static_cast<til::CoordType>(top + height));
+
+    _appendQuad() = {
+        .shadingType = ShadingType::Image,
+        .position = { static_cast<i16>(left), static_cast<i16>(top) },
+        .size = { static_cast<u16>(width), static_cast<u16>(height) },
+        .texcoord = { static_cast<u16>(left), static_cast<u16>(top) },
+    };
+}
+
+void BackendD3D::_recreateImageTexture(const RenderingPayload& p)
+{
+    const auto cellSize = p.s->font->cellSize;
+    const D3D11_TEXTURE2D_DESC desc{
+        .Width = static_cast<UINT>(p.s->cellCount.x) * cellSize.x,
+        .Height = static_cast<UINT>(p.s->cellCount.y) * cellSize.y,
+        .MipLevels = 1,
+        .ArraySize = 1,
+        .Format = DXGI_FORMAT_R8G8B8A8_UNORM,
+        .SampleDesc = { 1, 0 },
+        .BindFlags = D3D11_BIND_SHADER_RESOURCE,
+    };
+    THROW_IF_FAILED(p.device->CreateTexture2D(&desc, nullptr, _imageTexture.addressof()));
+    THROW_IF_FAILED(p.device->CreateShaderResourceView(_imageTexture.get(), nullptr, _imageTextureView.addressof()));
+    p.deviceContext->PSSetShaderResources(3, 1, _imageTextureView.addressof());
+
+    // Generation 0 is never handed out by AtlasEngine::PaintImageSlice(), so this forces every band to be uploaded.
+    _imageRowGenerations.assign(p.s->cellCount.y, 0);
+}
+
+// Returns true if only the contents of p.dirtyRectInPx need to be drawn, because
+// Present1() preserves the rest of the previous frame. See _drawText().
+bool BackendD3D::_drawDirtyOnly(const RenderingPayload& p) const noexcept
+{
+#if ATLAS_DEBUG_SHOW_DIRTY || ATLAS_DEBUG_DUMP_RENDER_TARGET
+    // The render target is cleared at the start of each frame.
+    std::ignore = p;
+    return false;
+#else
+    // Custom shaders read from an offscreen texture which isn't scrolled by Present1(). In general their output
+    // may depend on any pixel of it, or on the time, in which case _executeCustomShader() marks the entire target
+    // as dirty. Pixel-local shaders only need to be run where the offscreen texture changed, as long as it
+    // still holds the previous frame and the animation (if any) stands still.
+    if (_customPixelShader)
     {
-        p.dirtyRectInPx.top = std::min(p.dirtyRectInPx.top, dirtyTop);
-        p.dirtyRectInPx.bottom = std::max(p.dirtyRectInPx.bottom, dirtyBottom);
+        return _customShaderPixelLocal && (!_requiresContinuousRedraw || _customShaderPaused) && !_customShaderNeedsFullFrame && p.scrollOffset == 0;
     }
-
-    _d2dEndDrawing();
+    return true;
+#endif
 }
 
 // There are a number of coding-oriented fonts that feature ligatures which (for instance)
@@ -1055,9 +1672,13 @@ void BackendD3D::_drawText(RenderingPayload& p)
 //   < !--
 //   < ! --
 //   < ! - -
+//
+// If possible, the split is instead left to the pixel shader, which looks up the
+// color of each pixel from the foreground bitmap. This results in the exact same
+// colors, but keeps the cost of such glyphs independent of their coloring.
 void BackendD3D::_drawTextOverlapSplit(const RenderingPayload& p, u16 y)
 {
-    const auto& originalQuad = _getLastQuad();
+    auto& originalQuad = _getLastQuad();
 
     i32 columnAdvance = 1;
     i32 columnAdvanceInPx{ p.s->font->cellSize.x };
@@ -1082,6 +1703,25 @@ void BackendD3D::_drawTextOverlapSplit(const RenderingPayload& p, u16 y)
     const auto colors = &p.foregroundBitmap[p.colorBitmapRowStride * y];
     auto lastFg = originalQuad.color;
 
+    // The pixel shader colors the part of the glyph left of the first cell boundary with the color of the cell
+    // it's in, whereas the split below uses the glyph's own color. They're mostly identical, but not always.
+    // Since the pixel shader doesn't know about line renditions, this is also limited to single-width rows.
+    if (columnAdvance == 1 &&
+        originalLeft < originalRight &&
+        colors[originalLeft / columnAdvanceInPx] == lastFg &&
+        (originalQuad.shadingType == ShadingType::TextGrayscale || originalQuad.shadingType == ShadingType::TextClearType))
+    {
+        if (_foregroundBitmapGeneration != p.colorBitmapGenerations[1])
+        {
+            // NOTE: This doesn't invalidate originalQuad.
+            _uploadForegroundBitmap(p);
+        }
+
+        originalQuad.shadingType = originalQuad.shadingType == ShadingType::TextClearType ? ShadingType::TextClearTypeCellColor : ShadingType::TextGrayscaleCellColor;
+        originalQuad.color = y;
+        return;
+    }
+
     // We must ensure to exit the loop while `column` is less than `cellCount.x`,
     // otherwise we cause a potential out of bounds access into foregroundBitmap.
     // This may happen with glyphs that are severely overlapping their cells,
@@ -1118,6 +1758,8 @@ void BackendD3D::_drawTextOverlapSplit(const RenderingPayload& p, u16 y)
 
 bool BackendD3D::_drawGlyph(const RenderingPayload& p, const BackendD3D::AtlasFontFaceEntryInner& fontFaceEntry, BackendD3D::AtlasGlyphEntry& glyphEntry)
 {
+    _frameCounters.glyphCacheMisses++;
+
     if (!fontFaceEntry.fontFace)
     {
         return _drawSoftFontGlyph(p, fontFaceEntry, glyphEntry);
@@ -1280,9 +1922,8 @@ bool BackendD3D::_drawGlyph(const RenderingPayload& p, const BackendD3D::AtlasFo
         .w = br - bl,
         .h = bb - bt,
     };
-    if (!stbrp_pack_rects(&_rectPacker, &rect, 1))
+    if (!_packGlyph(p, glyphEntry, rect))
     {
-        _drawGlyphPrepareRetry(p);
         return false;
     }
 
@@ -1360,9 +2001,8 @@ bool BackendD3D::_drawSoftFontGlyph(const RenderingPayload& p, const AtlasFontFa
         baseline <<= heightShift;
     }
 
-    if (!stbrp_pack_rects(&_rectPacker, &rect, 1))
+    if (!_packGlyph(p, glyphEntry, rect))
     {
-        _drawGlyphPrepareRetry(p);
         return false;
     }
 
@@ -1436,7 +2076,7 @@ bool BackendD3D::_drawSoftFontGlyph(const RenderingPayload& p, const AtlasFontFa
 
 void BackendD3D::_drawGlyphPrepareRetry(const RenderingPayload& p)
 {
-    THROW_HR_IF_MSG(E_UNEXPECTED, _glyphAtlasMap.empty(), "BackendD3D::_drawGlyph deadlock");
+    THROW_HR_IF_MSG(E_UNEXPECTED, _atlas->map.empty(), "BackendD3D::_drawGlyph deadlock");
     _d2dEndDrawing();
     _flushQuads(p);
     _resetGlyphAtlas(p);
@@ -1458,7 +2098,7 @@ void BackendD3D::_splitDoubleHeightGlyph(const RenderingPayload& p, const AtlasF
         .lineRendition = isTop ? LineRendition::DoubleHeightBottom : LineRendition::DoubleHeightTop,
     };
 
-    auto& glyphCache = _glyphAtlasMap.insert(key2).first.inner->glyphs;
+    auto& glyphCache = _atlas->map.insert(key2).first.inner->glyphs;
     auto& entry2 = glyphCache.insert(glyphEntry.glyphIndex).first;
     entry2.data = glyphEntry.data;
 
@@ -1802,6 +2442,16 @@ size_t BackendD3D::_drawCursorForegroundSlowPath(const RenderingPayload& p, cons
         return 0;
     }
 
+    // The color of these is looked up by the pixel shader, but it's needed below to draw the glyph in the cursor color.
+    auto shadingType = it.shadingType;
+    auto color = it.color;
+    if (shadingType == ShadingType::TextGrayscaleCellColor || shadingType == ShadingType::TextClearTypeCellColor)
+    {
+        const auto column = clamp<int>(std::max(c.position.x, it.position.x) / p.s->font->cellSize.x, 0, p.s->cellCount.x - 1);
+        shadingType = shadingType == ShadingType::TextClearTypeCellColor ? ShadingType::TextClearType : ShadingType::TextGrayscale;
+        color = p.foregroundBitmap[p.colorBitmapRowStride * it.color + static_cast<size_t>(column)];
+    }
+
     const int cursorL = c.position.x;
     const int cursorT = c.position.y;
     const int cursorR = cursorL + c.size.x;
@@ -1877,6 +2527,7 @@ size_t BackendD3D::_drawCursorForegroundSlowPath(const RenderingPayload& p, cons
         auto& target = _instances[offset + i];
 
         target.shadingType = it.shadingType;
+        target.builtinGlyph = it.builtinGlyph;
         target.position.x = static_cast<i16>(cutout.left);
         target.position.y = static_cast<i16>(cutout.top);
         target.size.x = static_cast<u16>(cutout.right - cutout.left);
@@ -1891,14 +2542,15 @@ size_t BackendD3D::_drawCursorForegroundSlowPath(const RenderingPayload& p, cons
     // we don't append a new quad, but rather reuse the one that already exists (cutoutCount == 0).
     auto& target = cutoutCount ? _appendQuad() : _instances[offset];
 
-    target.shadingType = it.shadingType;
+    target.shadingType = shadingType;
+    target.builtinGlyph = it.builtinGlyph;
     target.position.x = static_cast<i16>(intersectionL);
     target.position.y = static_cast<i16>(intersectionT);
     target.size.x = static_cast<u16>(intersectionR - intersectionL);
     target.size.y = static_cast<u16>(intersectionB - intersectionT);
     target.texcoord.x = static_cast<u16>(it.texcoord.x + intersectionL - instanceL);
     target.texcoord.y = static_cast<u16>(it.texcoord.y + intersectionT - instanceT);
-    target.color = cursorColor == 0xffffffff ? it.color ^ 0xc0c0c0 : c.foreground;
+    target.color = cursorColor == 0xffffffff ? color ^ 0xc0c0c0 : c.foreground;
 
     return addedInstances;
 }
@@ -1989,19 +2641,21 @@ void BackendD3D::_executeCustomShader(RenderingPayload& p)
 {
     {
         const CustomConstBuffer data{
-            .time = std::chrono::duration<f32>(std::chrono::steady_clock::now() - _customShaderStartTime).count(),
+            .time = std::chrono::duration<f32>((_customShaderPaused ? _customShaderPausedTime : std::chrono::steady_clock::now()) - _customShaderStartTime).count(),
             .scale = static_cast<f32>(p.s->font->dpi) / static_cast<f32>(USER_DEFAULT_SCREEN_DPI),
             .resolution = {
                 static_cast<f32>(_cellCount.x * p.s->font->cellSize.x),
                 static_cast<f32>(_cellCount.y * p.s->font->cellSize.y),
             },
             .background = colorFromU32Premultiply<f32x4>(p.s->misc->backgroundColor),
+            .pixelLocal = _customShaderPixelLocal,
         };
 
         D3D11_MAPPED_SUBRESOURCE mapped{};
         THROW_IF_FAILED(p.deviceContext->Map(_customShaderConstantBuffer.get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped));
         memcpy(mapped.pData, &data, sizeof(data));
         p.deviceContext->Unmap(_customShaderConstantBuffer.get(), 0);
+        _frameCounters.uploadedBytes += sizeof(data);
     }
 
     {
@@ -2046,10 +2700,10 @@ void BackendD3D::_executeCustomShader(RenderingPayload& p)
         p.deviceContext->VSSetConstantBuffers(0, 1, _vsConstantBuffer.addressof());
 
         // PS: Pixel Shader
-        ID3D11ShaderResourceView* resources[]{ _backgroundBitmapView.get(), _glyphAtlasView.get() };
+        ID3D11ShaderResourceView* resources[]{ _backgroundBitmapView.get(), _glyphAtlasView.get(), _foregroundBitmapView.get(), _imageTextureView.get() };
         p.deviceContext->PSSetShader(_pixelShader.get(), nullptr, 0);
         p.deviceContext->PSSetConstantBuffers(0, 1, _psConstantBuffer.addressof());
-        p.deviceContext->PSSetShaderResources(0, 2, &resources[0]);
+        p.deviceContext->PSSetShaderResources(0, 4, &resources[0]);
         p.deviceContext->PSSetSamplers(0, 0, nullptr);
 
         // OM: Output Merger
@@ -2059,7 +2713,13 @@ void BackendD3D::_executeCustomShader(RenderingPayload& p)
 
     // With custom shaders, everything might be invalidated, so we have to
     // indirectly disable Present1() and its dirty rects this way.
-    p.dirtyRectInPx = { 0, 0, p.s->targetSize.x, p.s->targetSize.y };
+    // Pixel-local shaders were clipped to the dirty rect by the scissor set in Render().
+    if (!_drawDirtyOnly(p))
+    {
+        p.dirtyRectInPx = { 0, 0, p.s->targetSize.x, p.s->targetSize.y };
+    }
+
+    _customShaderNeedsFullFrame = false;
 }
 
 TIL_FAST_MATH_END
@@ -18,6 +18,8 @@ namespace Microsoft::Console::Render::Atlas
         void ReleaseResources() noexcept override;
         void Render(RenderingPayload& payload) override;
         bool RequiresContinuousRedraw() noexcept override;
+        size_t GlyphAtlasBytes() const noexcept override;
+        FrameCounters LastFrameCounters() const noexcept override;
 
         // NOTE: D3D constant buffers sizes must be a multiple of 16 bytes.
         struct alignas(16) VSConstBuffer
@@ -52,10 +54,11 @@ namespace Microsoft::Console::Render::Atlas
             alignas(sizeof(f32)) f32 scale = 0;
             alignas(sizeof(f32x2)) f32x2 resolution;
             alignas(sizeof(f32x4)) f32x4 background;
+            alignas(sizeof(u32)) u32 pixelLocal = 0;
 #pragma warning(suppress : 4324) // 'CustomConstBuffer': structure was padded due to alignment specifier
         };
 
-        enum class ShadingType : u32
+        enum class ShadingType : u16
         {
             Default = 0,
             Background = 0,
@@ -65,13 +68,22 @@ namespace Microsoft::Console::Render::Atlas
             TextGrayscale = 1,
             TextClearType = 2,
             TextPassthrough = 3,
-            DottedLine = 4,
-            DottedLineWide = 5,
+            // Like TextGrayscale/TextClearType, but the pixel shader looks up the foreground color of each
+            // pixel from the foreground bitmap. QuadInstance::color contains the glyph's row instead of a color.
+            TextGrayscaleCellColor = 4,
+            TextClearTypeCellColor = 5,
+            // Box-drawing, block and Braille characters drawn by the pixel shader. See builtin_glyphs.hlsl.
+            BuiltinGlyph = 6,
+            DottedLine = 7,
+            DottedLineWide = 8,
             // All items starting here will be drawing as a solid RGBA color
-            SolidLine = 6,
+            SolidLine = 9,
 
-            Cursor = 7,
-            Selection = 8,
+            Cursor = 10,
+            Selection = 11,
+
+            // Samples the sixel image texture at the texcoord and draws it as a premultiplied color.
+            Image = 12,
 
             TextDrawingFirst = TextGrayscale,
             TextDrawingLast = SolidLine,
@@ -87,6 +99,8 @@ namespace Microsoft::Console::Render::Atlas
             // appearance in the future, this should be changed to f32x2. But if you do so, please change
             // all other occurrences of i16x2 positions/offsets throughout the class to keep it consistent.
             alignas(u32) ShadingType shadingType;
+            // Only used by ShadingType::BuiltinGlyph. It shares the shading type's u32 slot and is thus free.
+            alignas(u16) u16 builtinGlyph;
             alignas(u32) i16x2 position;
             alignas(u32) u16x2 size;
             alignas(u32) u16x2 texcoord;
@@ -182,6 +196,45 @@ namespace Microsoft::Console::Render::Atlas
         };
 
     private:
+        // The glyph atlas is split into horizontal bands of equal height, each with its own rect packer.
+        // Once the atlas is full, the least recently used page is evicted instead of the entire atlas.
+        struct AtlasPage
+        {
+            stbrp_context packer{};
+            Buffer<stbrp_node> nodes;
+            // The value of SharedGlyphAtlas::frame when a glyph on this page was last drawn or rasterized.
+            size_t lastUse = 0;
+            u32 usedArea = 0;
+        };
+
+        // The glyph atlas is shared between all BackendD3D instances with the same adapter and font settings,
+        // so that panes and tabs with the same font don't rasterize and store the same glyphs over and over.
+        // The texture is shared via an NT handle and a keyed mutex, as each instance has its own device.
+        // Everything else is protected by `mutex`, which is held for the duration of a Render() call.
+        struct SharedGlyphAtlas
+        {
+            LUID adapterLuid{};
+            size_t fontKey = 0;
+
+            std::mutex mutex;
+            wil::unique_handle textureHandle;
+            // Bumped whenever the texture is replaced, so that the other instances know to open the new one.
+            til::generation_t textureGeneration;
+            u16x2 size{};
+            til::linear_flat_set<AtlasFontFaceEntry> map;
+            Buffer<AtlasPage> pages;
+            u16 pageShift = 0; // log2 of the height of each page
+            u16 currentPage = 0;
+            bool canGrow = false;
+            size_t evictions = 0;
+            size_t resets = 0;
+            // Incremented on every Render() call of any instance. Used as the timestamp for AtlasPage::lastUse.
+            size_t frame = 0;
+            // The position within RenderingPayload::prewarmGlyphIndices up to which glyphs have been rasterized.
+            size_t prewarmPosition = 0;
+            size_t prewarmStartFrame = 0;
+        };
+
         struct CursorRect
         {
             i16x2 position;
@@ -203,8 +256,17 @@ namespace Microsoft::Console::Render::Atlas
         void _debugDumpRenderTarget(const RenderingPayload& p);
         void _d2dBeginDrawing() noexcept;
         void _d2dEndDrawing();
+        ATLAS_ATTR_COLD void _joinGlyphAtlas(const RenderingPayload& p);
+        ATLAS_ATTR_COLD void _openGlyphAtlas(const RenderingPayload& p);
+        void _createGlyphAtlasViews(const RenderingPayload& p);
+        void _releaseGlyphAtlasViews() noexcept;
         ATLAS_ATTR_COLD void _resetGlyphAtlas(const RenderingPayload& p);
         ATLAS_ATTR_COLD void _resizeGlyphAtlas(const RenderingPayload& p, u16 u, u16 v);
+        [[nodiscard]] bool _packGlyph(const RenderingPayload& p, const AtlasGlyphEntry& glyphEntry, stbrp_rect& rect);
+        ATLAS_ATTR_COLD void _evictGlyphAtlasPage(const RenderingPayload& p, const AtlasGlyphEntry& glyphEntry, u16 index);
+        void _debugGlyphAtlasStats(const wchar_t* event) const noexcept;
+        void _eraseGlyphs(const AtlasGlyphEntry& glyphEntry, size_t page);
+        void _prewarmGlyphs(const RenderingPayload& p);
         QuadInstance& _getLastQuad() noexcept;
         QuadInstance& _appendQuad();
         ATLAS_ATTR_COLD void _bumpInstancesSize();
@@ -212,7 +274,14 @@ namespace Microsoft::Console::Render::Atlas
         ATLAS_ATTR_COLD void _recreateInstanceBuffers(const RenderingPayload& p);
         void _drawBackground(const RenderingPayload& p);
         void _uploadBackgroundBitmap(const RenderingPayload& p);
+        void _uploadForegroundBitmap(const RenderingPayload& p);
+        void _uploadColorBitmap(const RenderingPayload& p, ID3D11Texture2D* texture, std::span<const u32> bitmap) const;
         void _drawText(RenderingPayload& p);
+        void _drawTextRow(const RenderingPayload& p, u16 y);
+        void _drawBuiltinGlyph(const RenderingPayload& p, const ShapedRow& row, u16 y, u32 x, f32 baselineX, f32 scaleX);
+        void _drawImageRow(const RenderingPayload& p, u16 y);
+        ATLAS_ATTR_COLD void _recreateImageTexture(const RenderingPayload& p);
+        bool _drawDirtyOnly(const RenderingPayload& p) const noexcept;
         ATLAS_ATTR_COLD void _drawTextOverlapSplit(const RenderingPayload& p, u16 y);
         ATLAS_ATTR_COLD [[nodiscard]] bool _drawGlyph(const RenderingPayload& p, const AtlasFontFaceEntryInner& fontFaceEntry, AtlasGlyphEntry& glyphEntry);
         bool _drawSoftFontGlyph(const RenderingPayload& p, const AtlasFontFaceEntryInner& fontFaceEntry, AtlasGlyphEntry& glyphEntry);
@@ -230,12 +299,15 @@ namespace Microsoft::Console::Render::Atlas
         wil::com_ptr<ID3D11VertexShader> _vertexShader;
         wil::com_ptr<ID3D11PixelShader> _pixelShader;
         wil::com_ptr<ID3D11BlendState> _blendState;
+        wil::com_ptr<ID3D11RasterizerState> _rasterizerState;
         wil::com_ptr<ID3D11Buffer> _vsConstantBuffer;
         wil::com_ptr<ID3D11Buffer> _psConstantBuffer;
         wil::com_ptr<ID3D11Buffer> _vertexBuffer;
         wil::com_ptr<ID3D11Buffer> _indexBuffer;
         wil::com_ptr<ID3D11Buffer> _instanceBuffer;
         size_t _instanceBufferCapacity = 0;
+        // The position in _instanceBuffer at which the next _flushQuads() call writes its instances.
+        size_t _instanceBufferOffset = 0;
         Buffer<QuadInstance, 32> _instances;
         size_t _instancesCount = 0;
 
@@ -247,16 +319,40 @@ namespace Microsoft::Console::Render::Atlas
         wil::com_ptr<ID3D11Buffer> _customShaderConstantBuffer;
         wil::com_ptr<ID3D11SamplerState> _customShaderSamplerState;
         std::chrono::steady_clock::time_point _customShaderStartTime;
+        // The time at which the animation was paused, while _customShaderPaused is set.
+        std::chrono::steady_clock::time_point _customShaderPausedTime;
 
         wil::com_ptr<ID3D11Texture2D> _backgroundBitmap;
         wil::com_ptr<ID3D11ShaderResourceView> _backgroundBitmapView;
         til::generation_t _backgroundBitmapGeneration;
 
+        // The foreground bitmap is only uploaded if a frame contains TextGrayscaleCellColor/TextClearTypeCellColor quads.
+        wil::com_ptr<ID3D11Texture2D> _foregroundBitmap;
+        wil::com_ptr<ID3D11ShaderResourceView> _foregroundBitmapView;
+        til::generation_t _foregroundBitmapGeneration;
+
+        // Sixel images are drawn from a texture that's laid out like the viewport: Each row's image
+        // is scaled to the cell size and uploaded into the band of pixel rows of its target row.
+        // The texture is created once the first image is drawn, so that it costs nothing otherwise.
+        wil::com_ptr<ID3D11Texture2D> _imageTexture;
+        wil::com_ptr<ID3D11ShaderResourceView> _imageTextureView;
+        // The ShapedRow::imageGeneration whose pixels each band of the _imageTexture contains.
+        std::vector<u64> _imageRowGenerations;
+        std::vector<u32> _imageScratch;
+
         wil::com_ptr<ID3D11Texture2D> _glyphAtlas;
         wil::com_ptr<ID3D11ShaderResourceView> _glyphAtlasView;
-        til::linear_flat_set<AtlasFontFaceEntry> _glyphAtlasMap;
-        Buffer<stbrp_node> _rectPackerData;
-        stbrp_context _rectPacker{};
+        wil::com_ptr<IDXGIKeyedMutex> _glyphAtlasKeyedMutex;
+        std::shared_ptr<SharedGlyphAtlas> _atlas;
+        // The size of _atlas' texture, captured while holding its mutex. See GlyphAtlasBytes().
+        size_t _glyphAtlasBytes = 0;
+        // Reset at the start of every Render() call.
+        FrameCounters _frameCounters;
+        // The SharedGlyphAtlas::textureGeneration that _glyphAtlas was opened for.
+        til::generation_t _glyphAtlasGeneration;
+        // A hash of the font settings that affect how glyphs are rasterized. See _joinGlyphAtlas().
+        size_t _glyphAtlasFontKey = 0;
+        bool _prewarming = false;
         til::CoordType _ligatureOverhangTriggerLeft = 0;
         til::CoordType _ligatureOverhangTriggerRight = 0;
 
@@ -266,7 +362,6 @@ namespace Microsoft::Console::Render::Atlas
         wil::com_ptr<ID2D1SolidColorBrush> _brush;
         wil::com_ptr<ID2D1Bitmap1> _softFontBitmap;
         bool _d2dBeganDrawing = false;
-        bool _fontChangedResetGlyphAtlas = false;
 
         float _gamma = 0;
         float _cleartypeEnhancedContrast = 0;
@@ -287,6 +382,13 @@ namespace Microsoft::Console::Render::Atlas
         til::rect _cursorPosition;
 
         bool _requiresContinuousRedraw = false;
+        // Set if the custom shader declares a PixelLocal variable in its constant buffer, promising that its output
+        // at each pixel only depends on the same pixel of the offscreen texture. It then only runs over the dirty rect.
+        bool _customShaderPixelLocal = false;
+        // See RenderingPayload::customShaderPaused.
+        bool _customShaderPaused = false;
+        // Set until the offscreen texture holds a complete frame, drawn at the current time. See _drawDirtyOnly().
+        bool _customShaderNeedsFullFrame = true;
 
 #if ATLAS_DEBUG_SHOW_DIRTY
         til::rect _presentRects[9]{};
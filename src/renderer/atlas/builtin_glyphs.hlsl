@@ -0,0 +1,379 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+// Box-drawing characters (U+2500-U+257F), block elements (U+2580-U+259F) and Braille patterns (U+2800-U+28FF)
+// are drawn procedurally by the pixel shader instead of being rasterized into the glyph atlas. This way they
+// take up no space in the atlas and line up seamlessly with their neighbors, no matter the font's metrics.
+//
+// The glyph of a SHADING_TYPE_BUILTIN_GLYPH quad is described by QuadInstance::builtinGlyph:
+// * bits 0-8:  The index into builtinGlyphs[] below, or 160 + the dot pattern for Braille.
+// * bits 9-11: The width of the glyph in cells. This already accounts for double-width line renditions.
+// * bit 12:    Set if the glyph is twice as tall as a cell (double-height line renditions).
+// Its texcoord is the position of each pixel within the entire glyph. The quad itself only covers the
+// top or bottom half of double-height glyphs and may be cut into pieces while drawing the cursor.
+
+// clang-format off
+#define BUILTIN_KIND_LINES      0
+#define BUILTIN_KIND_DASHED     1
+#define BUILTIN_KIND_ARC        2
+#define BUILTIN_KIND_DIAGONAL   3
+#define BUILTIN_KIND_RECT       4
+#define BUILTIN_KIND_SHADE      5
+#define BUILTIN_KIND_QUADRANTS  6
+// clang-format on
+
+// The weight of each of the 4 arms (0 = none, 1 = light, 2 = heavy, 3 = double) that extend from the center of the cell.
+#define ARMS(up, right, down, left) ((up) | ((right) << 2) | ((down) << 4) | ((left) << 6))
+// Lines (given as ARMS) with the given number of dashes per cell.
+#define DASHED(dashes, arms) ((BUILTIN_KIND_DASHED << 28) | ((dashes) << 8) | (arms))
+// A light quarter circle connecting the 2 given (light) ARMS.
+#define ARC(arms) ((BUILTIN_KIND_ARC << 28) | (arms))
+// Bit 0 is a "/" diagonal, bit 1 a "\" diagonal.
+#define DIAGONAL(mask) ((BUILTIN_KIND_DIAGONAL << 28) | (mask))
+// A filled [left, right) x [top, bottom) rectangle in eighths of the cell.
+#define RECT(left, right, top, bottom) ((BUILTIN_KIND_RECT << 28) | (left) | ((right) << 4) | ((top) << 8) | ((bottom) << 12))
+// A uniform fill with a coverage of 25%, 50% or 75%.
+#define SHADE(level) ((BUILTIN_KIND_SHADE << 28) | (level))
+// Bit 0-3 fill the upper left, upper right, lower left and lower right quadrant respectively.
+#define QUADRANTS(mask) ((BUILTIN_KIND_QUADRANTS << 28) | (mask))
+
+static const uint builtinGlyphs[160] = {
+    ARMS(0, 1, 0, 1),            // U+2500 light horizontal
+    ARMS(0, 2, 0, 2),            // U+2501 heavy horizontal
+    ARMS(1, 0, 1, 0),            // U+2502 light vertical
+    ARMS(2, 0, 2, 0),            // U+2503 heavy vertical
+    DASHED(3, ARMS(0, 1, 0, 1)), // U+2504 light triple dash horizontal
+    DASHED(3, ARMS(0, 2, 0, 2)), // U+2505 heavy triple dash horizontal
+    DASHED(3, ARMS(1, 0, 1, 0)), // U+2506 light triple dash vertical
+    DASHED(3, ARMS(2, 0, 2, 0)), // U+2507 heavy triple dash vertical
+    DASHED(4, ARMS(0, 1, 0, 1)), // U+2508 light quadruple dash horizontal
+    DASHED(4, ARMS(0, 2, 0, 2)), // U+2509 heavy quadruple dash horizontal
+    DASHED(4, ARMS(1, 0, 1, 0)), // U+250A light quadruple dash vertical
+    DASHED(4, ARMS(2, 0, 2, 0)), // U+250B heavy quadruple dash vertical
+    ARMS(0, 1, 1, 0),            // U+250C light down and right
+    ARMS(0, 2, 1, 0),            // U+250D down light and right heavy
+    ARMS(0, 1, 2, 0),            // U+250E down heavy and right light
+    ARMS(0, 2, 2, 0),            // U+250F heavy down and right
+    ARMS(0, 0, 1, 1),            // U+2510 light down and left
+    ARMS(0, 0, 1, 2),            // U+2511 down light and left heavy
+    ARMS(0, 0, 2, 1),            // U+2512 down heavy and left light
+    ARMS(0, 0, 2, 2),            // U+2513 heavy down and left
+    ARMS(1, 1, 0, 0),            // U+2514 light up and right
+    ARMS(1, 2, 0, 0),            // U+2515 up light and right heavy
+    ARMS(2, 1, 0, 0),            // U+2516 up heavy and right light
+    ARMS(2, 2, 0, 0),            // U+2517 heavy up and right
+    ARMS(1, 0, 0, 1),            // U+2518 light up and left
+    ARMS(1, 0, 0, 2),            // U+2519 up light and left heavy
+    ARMS(2, 0, 0, 1),            // U+251A up heavy and left light
+    ARMS(2, 0, 0, 2),            // U+251B heavy up and left
+    ARMS(1, 1, 1, 0),            // U+251C light vertical and right
+    ARMS(1, 2, 1, 0),            // U+251D vertical light and right heavy
+    ARMS(2, 1, 1, 0),            // U+251E up heavy and right down light
+    ARMS(1, 1, 2, 0),            // U+251F down heavy and right up light
+    ARMS(2, 1, 2, 0),            // U+2520 vertical heavy and right light
+    ARMS(2, 2, 1, 0),            // U+2521 down light and right up heavy
+    ARMS(1, 2, 2, 0),            // U+2522 up light and right down heavy
+    ARMS(2, 2, 2, 0),            // U+2523 heavy vertical and right
+    ARMS(1, 0, 1, 1),            // U+2524 light vertical and left
+    ARMS(1, 0, 1, 2),            // U+2525 vertical light and left heavy
+    ARMS(2, 0, 1, 1),            // U+2526 up heavy and left down light
+    ARMS(1, 0, 2, 1),            // U+2527 down heavy and left up light
+    ARMS(2, 0, 2, 1),            // U+2528 vertical heavy and left light
+    ARMS(2, 0, 1, 2),            // U+2529 down light and left up heavy
+    ARMS(1, 0, 2, 2),            // U+252A up light and left down heavy
+    ARMS(2, 0, 2, 2),            // U+252B heavy vertical and left
+    ARMS(0, 1, 1, 1),            // U+252C light down and horizontal
+    ARMS(0, 1, 1, 2),            // U+252D left heavy and right down light
+    ARMS(0, 2, 1, 1),            // U+252E right heavy and left down light
+    ARMS(0, 2, 1, 2),            // U+252F down light and horizontal heavy
+    ARMS(0, 1, 2, 1),            // U+2530 down heavy and horizontal light
+    ARMS(0, 1, 2, 2),            // U+2531 right light and left down heavy
+    ARMS(0, 2, 2, 1),            // U+2532 left light and right down heavy
+    ARMS(0, 2, 2, 2),            // U+2533 heavy down and horizontal
+    ARMS(1, 1, 0, 1),            // U+2534 light up and horizontal
+    ARMS(1, 1, 0, 2),            // U+2535 left heavy and right up light
+    ARMS(1, 2, 0, 1),            // U+2536 right heavy and left up light
+    ARMS(1, 2, 0, 2),            // U+2537 up light and horizontal heavy
+    ARMS(2, 1, 0, 1),            // U+2538 up heavy and horizontal light
+    ARMS(2, 1, 0, 2),            // U+2539 right light and left up heavy
+    ARMS(2, 2, 0, 1),            // U+253A left light and right up heavy
+    ARMS(2, 2, 0, 2),            // U+253B heavy up and horizontal
+    ARMS(1, 1, 1, 1),            // U+253C light vertical and horizontal
+    ARMS(1, 1, 1, 2),            // U+253D left heavy and right vertical light
+    ARMS(1, 2, 1, 1),            // U+253E right heavy and left vertical light
+    ARMS(1, 2, 1, 2),            // U+253F vertical light and horizontal heavy
+    ARMS(2, 1, 1, 1),            // U+2540 up heavy and down horizontal light
+    ARMS(1, 1, 2, 1),            // U+2541 down heavy and up horizontal light
+    ARMS(2, 1, 2, 1),            // U+2542 vertical heavy and horizontal light
+    ARMS(2, 1, 1, 2),            // U+2543 left up heavy and right down light
+    ARMS(2, 2, 1, 1),            // U+2544 right up heavy and left down light
+    ARMS(1, 1, 2, 2),            // U+2545 left down heavy and right up light
+    ARMS(1, 2, 2, 1),            // U+2546 right down heavy and left up light
+    ARMS(2, 2, 1, 2),            // U+2547 down light and up horizontal heavy
+    ARMS(1, 2, 2, 2),            // U+2548 up light and down horizontal heavy
+    ARMS(2, 1, 2, 2),            // U+2549 right light and left vertical heavy
+    ARMS(2, 2, 2, 1),            // U+254A left light and right vertical heavy
+    ARMS(2, 2, 2, 2),            // U+254B heavy vertical and horizontal
+    DASHED(2, ARMS(0, 1, 0, 1)), // U+254C light double dash horizontal
+    DASHED(2, ARMS(0, 2, 0, 2)), // U+254D heavy double dash horizontal
+    DASHED(2, ARMS(1, 0, 1, 0)), // U+254E light double dash vertical
+    DASHED(2, ARMS(2, 0, 2, 0)), // U+254F heavy double dash vertical
+    ARMS(0, 3, 0, 3),            // U+2550 double horizontal
+    ARMS(3, 0, 3, 0),            // U+2551 double vertical
+    ARMS(0, 3, 1, 0),            // U+2552 down single and right double
+    ARMS(0, 1, 3, 0),            // U+2553 down double and right single
+    ARMS(0, 3, 3, 0),            // U+2554 double down and right
+    ARMS(0, 0, 1, 3),            // U+2555 down single and left double
+    ARMS(0, 0, 3, 1),            // U+2556 down double and left single
+    ARMS(0, 0, 3, 3),            // U+2557 double down and left
+    ARMS(1, 3, 0, 0),            // U+2558 up single and right double
+    ARMS(3, 1, 0, 0),            // U+2559 up double and right single
+    ARMS(3, 3, 0, 0),            // U+255A double up and right
+    ARMS(1, 0, 0, 3),            // U+255B up single and left double
+    ARMS(3, 0, 0, 1),            // U+255C up double and left single
+    ARMS(3, 0, 0, 3),            // U+255D double up and left
+    ARMS(1, 3, 1, 0),            // U+255E vertical single and right double
+    ARMS(3, 1, 3, 0),            // U+255F vertical double and right single
+    ARMS(3, 3, 3, 0),            // U+2560 double vertical and right
+    ARMS(1, 0, 1, 3),            // U+2561 vertical single and left double
+    ARMS(3, 0, 3, 1),            // U+2562 vertical double and left single
+    ARMS(3, 0, 3, 3),            // U+2563 double vertical and left
+    ARMS(0, 3, 1, 3),            // U+2564 down single and horizontal double
+    ARMS(0, 1, 3, 1),            // U+2565 down double and horizontal single
+    ARMS(0, 3, 3, 3),            // U+2566 double down and horizontal
+    ARMS(1, 3, 0, 3),            // U+2567 up single and horizontal double
+    ARMS(3, 1, 0, 1),            // U+2568 up double and horizontal single
+    ARMS(3, 3, 0, 3),            // U+2569 double up and horizontal
+    ARMS(1, 3, 1, 3),            // U+256A vertical single and horizontal double
+    ARMS(3, 1, 3, 1),            // U+256B vertical double and horizontal single
+    ARMS(3, 3, 3, 3),            // U+256C double vertical and horizontal
+    ARC(ARMS(0, 1, 1, 0)),       // U+256D light arc down and right
+    ARC(ARMS(0, 0, 1, 1)),       // U+256E light arc down and left
+    ARC(ARMS(1, 0, 0, 1)),       // U+256F light arc up and left
+    ARC(ARMS(1, 1, 0, 0)),       // U+2570 light arc up and right
+    DIAGONAL(1),                 // U+2571 light diagonal upper right to lower left
+    DIAGONAL(2),                 // U+2572 light diagonal upper left to lower right
+    DIAGONAL(3),                 // U+2573 light diagonal cross
+    ARMS(0, 0, 0, 1),            // U+2574 light left
+    ARMS(1, 0, 0, 0),            // U+2575 light up
+    ARMS(0, 1, 0, 0),            // U+2576 light right
+    ARMS(0, 0, 1, 0),            // U+2577 light down
+    ARMS(0, 0, 0, 2),            // U+2578 heavy left
+    ARMS(2, 0, 0, 0),            // U+2579 heavy up
+    ARMS(0, 2, 0, 0),            // U+257A heavy right
+    ARMS(0, 0, 2, 0),            // U+257B heavy down
+    ARMS(0, 2, 0, 1),            // U+257C light left and heavy right
+    ARMS(1, 0, 2, 0),            // U+257D light up and heavy down
+    ARMS(0, 1, 0, 2),            // U+257E heavy left and light right
+    ARMS(2, 0, 1, 0),            // U+257F heavy up and light down
+    RECT(0, 8, 0, 4),            // U+2580 upper half block
+    RECT(0, 8, 7, 8),            // U+2581 lower one eighth block
+    RECT(0, 8, 6, 8),            // U+2582 lower one quarter block
+    RECT(0, 8, 5, 8),            // U+2583 lower three eighths block
+    RECT(0, 8, 4, 8),            // U+2584 lower half block
+    RECT(0, 8, 3, 8),            // U+2585 lower five eighths block
+    RECT(0, 8, 2, 8),            // U+2586 lower three quarters block
+    RECT(0, 8, 1, 8),            // U+2587 lower seven eighths block
+    RECT(0, 8, 0, 8),            // U+2588 full block
+    RECT(0, 7, 0, 8),            // U+2589 left seven eighths block
+    RECT(0, 6, 0, 8),            // U+258A left three quarters block
+    RECT(0, 5, 0, 8),            // U+258B left five eighths block
+    RECT(0, 4, 0, 8),            // U+258C left half block
+    RECT(0, 3, 0, 8),            // U+258D left three eighths block
+    RECT(0, 2, 0, 8),            // U+258E left one quarter block
+    RECT(0, 1, 0, 8),            // U+258F left one eighth block
+    RECT(4, 8, 0, 8),            // U+2590 right half block
+    SHADE(1),                    // U+2591 light shade
+    SHADE(2),                    // U+2592 medium shade
+    SHADE(3),                    // U+2593 dark shade
+    RECT(0, 8, 0, 1),            // U+2594 upper one eighth block
+    RECT(7, 8, 0, 8),            // U+2595 right one eighth block
+    QUADRANTS(4),                // U+2596 quadrant lower left
+    QUADRANTS(8),                // U+2597 quadrant lower right
+    QUADRANTS(1),                // U+2598 quadrant upper left
+    QUADRANTS(13),               // U+2599 quadrant upper left and lower left and lower right
+    QUADRANTS(9),                // U+259A quadrant upper left and lower right
+    QUADRANTS(7),                // U+259B quadrant upper left and upper right and lower left
+    QUADRANTS(11),               // U+259C quadrant upper left and upper right and lower right
+    QUADRANTS(2),                // U+259D quadrant upper right
+    QUADRANTS(6),                // U+259E quadrant upper right and lower left
+    QUADRANTS(14),               // U+259F quadrant upper right and lower left and lower right
+};
+
+// Returns the [start, end) extent of a line with the given weight, centered in the given size.
+// Double lines consist of two light strokes (one at either end of the extent) with a light gap in between.
+float2 builtinBand(float size, uint weight, float light)
+{
+    const float thickness = light * (weight == 3 ? 3 : weight);
+    const float start = floor((size - thickness) * 0.5f);
+    return float2(start, start + thickness);
+}
+
+float builtinStroke(float2 pos, float2 along, float2 across)
+{
+    return pos.x >= along.x && pos.x < along.y && pos.y >= across.x && pos.y < across.y;
+}
+
+// Draws the two arms w0 (from 0 to the center) and w1 (from the center to size.x) along the x axis of pos/size.
+// p0 and p1 are the arms perpendicular to them on the side before and after the center along the y axis.
+// The arms of the vertical axis are drawn by calling this function with swapped coordinates.
+float builtinArms(float2 pos, float2 size, uint w0, uint w1, uint p0, uint p1, float light)
+{
+    // The extent of the perpendicular line along our axis. Without one, the arms meet in the center.
+    const uint pw = max(p0, p1);
+    const float2 perp = pw ? builtinBand(size.x, pw, light) : floor(size.x * 0.5f).xx;
+    float coverage = 0;
+
+    [unroll] for (uint i = 0; i < 2; ++i)
+    {
+        const uint w = i ? w1 : w0;
+        if (!w)
+        {
+            continue;
+        }
+
+        // Arms extend up to the far side of the perpendicular line, so that they join it without gaps,
+        // unless they run into the near stroke of a perpendicular double line (like the inner strokes of U+256C).
+        const float2 outer = i ? float2(perp.x, size.x) : float2(0, perp.y);
+        const float2 inner = i ? float2(perp.y - light, size.x) : float2(0, perp.x + light);
+        const float2 band = builtinBand(size.y, w, light);
+
+        if (w == 3)
+        {
+            coverage = max(coverage, builtinStroke(pos, p0 == 3 ? inner : outer, float2(band.x, band.x + light)));
+            coverage = max(coverage, builtinStroke(pos, p1 == 3 ? inner : outer, float2(band.y - light, band.y)));
+        }
+        else
+        {
+            coverage = max(coverage, builtinStroke(pos, p0 == 3 && p1 == 3 ? inner : outer, band));
+        }
+    }
+
+    return coverage;
+}
+
+float builtinDashes(float pos, float size, uint dashes, float light)
+{
+    const float segment = size / dashes;
+    const float gap = max(light, round(segment * 0.25f));
+    const float offset = fmod(pos, segment);
+    return offset >= gap * 0.5f && offset < segment - gap * 0.5f;
+}
+
+float builtinLines(float2 pos, float2 size, uint desc, float light)
+{
+    const uint up = desc & 3;
+    const uint right = (desc >> 2) & 3;
+    const uint down = (desc >> 4) & 3;
+    const uint left = (desc >> 6) & 3;
+    const uint dashes = (desc >> 8) & 15;
+
+    float horizontal = builtinArms(pos.xy, size.xy, left, right, up, down, light);
+    float vertical = builtinArms(pos.yx, size.yx, up, down, left, right, light);
+
+    if (dashes)
+    {
+        horizontal *= builtinDashes(pos.x, size.x, dashes, light);
+        vertical *= builtinDashes(pos.y, size.y, dashes, light);
+    }
+
+    return max(horizontal, vertical);
+}
+
+float builtinArc(float2 pos, float2 size, uint desc, float light)
+{
+    const float2 dir = float2((desc >> 2) & 3 ? 1 : -1, (desc >> 4) & 3 ? 1 : -1);
+    // The center of light lines as drawn by builtinBand.
+    const float2 center = floor((size - light) * 0.5f) + light * 0.5f;
+    const float2 room = dir > 0 ? size - center : center;
+    const float radius = min(room.x, room.y);
+    // rel is <= 0 in the quadrant of the arc and > 0 where the arms continue in a straight line towards the edge.
+    const float2 rel = (pos - (center + dir * radius)) * dir;
+
+    if (rel.x > 0)
+    {
+        return abs(pos.y - center.y) < light * 0.5f && rel.y <= 0;
+    }
+    if (rel.y > 0)
+    {
+        return abs(pos.x - center.x) < light * 0.5f;
+    }
+    return saturate(light * 0.5f + 0.5f - abs(length(rel) - radius));
+}
+
+float builtinDiagonal(float2 pos, float2 size, uint desc, float light)
+{
+    const float len = length(size);
+    float coverage = 0;
+    if (desc & 1)
+    {
+        coverage = max(coverage, saturate(light * 0.5f + 0.5f - abs(pos.x * size.y + pos.y * size.x - size.x * size.y) / len));
+    }
+    if (desc & 2)
+    {
+        coverage = max(coverage, saturate(light * 0.5f + 0.5f - abs(pos.x * size.y - pos.y * size.x) / len));
+    }
+    return coverage;
+}
+
+float builtinRect(float2 pos, float2 size, uint desc)
+{
+    const float4 eighths = float4(desc & 15, (desc >> 4) & 15, (desc >> 8) & 15, (desc >> 12) & 15);
+    const float4 edges = floor(eighths * size.xxyy / 8.0f + 0.5f);
+    return pos.x >= edges.x && pos.x < edges.y && pos.y >= edges.z && pos.y < edges.w;
+}
+
+float builtinQuadrants(float2 pos, float2 size, uint desc)
+{
+    const float2 mid = floor(size * 0.5f + 0.5f);
+    const uint quadrant = (pos.x >= mid.x ? 1 : 0) | (pos.y >= mid.y ? 2 : 0);
+    return (desc >> quadrant) & 1;
+}
+
+float builtinBraille(float2 pos, float2 size, uint pattern)
+{
+    const float2 cell = size / float2(2, 4);
+    const uint2 cellIndex = min(uint2(pos / cell), uint2(1, 3));
+    // Dots 1-3 and 4-6 are the upper 3 rows of the left and right column. Dots 7 and 8 are the bottom row.
+    const uint bit = cellIndex.y == 3 ? 6 + cellIndex.x : cellIndex.x * 3 + cellIndex.y;
+    if (!((pattern >> bit) & 1))
+    {
+        return 0;
+    }
+    const float2 center = (float2(cellIndex) + 0.5f) * cell;
+    const float radius = min(cell.x, cell.y) * 0.35f;
+    return saturate(radius + 0.5f - length(pos - center));
+}
+
+// Returns the coverage of the given builtin glyph at the given pixel position within the glyph.
+// light is the thickness of light lines in pixels.
+float builtinGlyph(float2 pos, uint glyph, float2 cellSize, float light)
+{
+    const uint index = glyph & 0x1ff;
+    const float2 size = cellSize * float2((glyph >> 9) & 7, ((glyph >> 12) & 1) + 1);
+
+    if (index >= 160)
+    {
+        return builtinBraille(pos, size, index - 160);
+    }
+
+    const uint desc = builtinGlyphs[index];
+    switch (desc >> 28)
+    {
+    case BUILTIN_KIND_LINES:
+    case BUILTIN_KIND_DASHED:
+        return builtinLines(pos, size, desc, light);
+    case BUILTIN_KIND_ARC:
+        return builtinArc(pos, size, desc, light);
+    case BUILTIN_KIND_DIAGONAL:
+        return builtinDiagonal(pos, size, desc, light);
+    case BUILTIN_KIND_RECT:
+        return builtinRect(pos, size, desc);
+    case BUILTIN_KIND_SHADE:
+        return (desc & 3) * 0.25f;
+    case BUILTIN_KIND_QUADRANTS:
+        return builtinQuadrants(pos, size, desc);
+    default:
+        return 0;
+    }
+}
@@ -328,6 +328,8 @@ namespace Microsoft::Console::Render::Atlas
 
     struct FontDecorationPosition
     {
+        ATLAS_POD_OPS(FontDecorationPosition)
+
         u16 position = 0;
         u16 height = 0;
     };
@@ -412,6 +414,14 @@ namespace Microsoft::Console::Render::Atlas
     };
     ATLAS_FLAG_OPS(FontRelevantAttributes, u8)
 
+    // Box-drawing characters, block elements and Braille patterns, which BackendD3D draws procedurally in its pixel
+    // shader (see builtin_glyphs.hlsl). AtlasEngine maps them to a null font face with their codepoint as their glyph
+    // index, just like soft font glyphs, if RenderingPayload::builtinGlyphs is set.
+    constexpr bool IsBuiltinGlyph(char32_t ch) noexcept
+    {
+        return (ch >= 0x2500 && ch <= 0x259F) || (ch >= 0x2800 && ch <= 0x28FF);
+    }
+
     struct FontMapping
     {
         wil::com_ptr<IDWriteFontFace2> fontFace;
@@ -437,6 +447,7 @@ namespace Microsoft::Console::Render::Atlas
             glyphOffsets.clear();
             colors.clear();
             gridLineRanges.clear();
+            imagePixels.clear();
             lineRendition = LineRendition::SingleWidth;
             selectionFrom = 0;
             selectionTo = 0;
@@ -450,6 +461,14 @@ namespace Microsoft::Console::Render::Atlas
         std::vector<DWRITE_GLYPH_OFFSET> glyphOffsets; // same size as glyphIndices
         std::vector<u32> colors; // same size as glyphIndices
         std::vector<GridLineRange> gridLineRanges;
+        // The visible part of the row's sixel image (if any) as 0xAABBGGRR, at imageCellSize per cell.
+        // Each line of pixels is (imageColumnTo - imageColumnFrom) * imageCellSize.x long.
+        std::vector<u32> imagePixels;
+        u16x2 imageCellSize{};
+        u16 imageColumnFrom = 0;
+        u16 imageColumnTo = 0;
+        // Unique for each PaintImageSlice() call, so that the backend knows when to upload the pixels again.
+        u64 imageGeneration = 0;
         LineRendition lineRendition = LineRendition::SingleWidth;
         u16 selectionFrom = 0;
         u16 selectionTo = 0;
@@ -457,6 +476,32 @@ namespace Microsoft::Console::Render::Atlas
         til::CoordType dirtyBottom = 0;
     };
 
+    // A D3D11 device and its immediate context, shared by all AtlasEngine instances that render
+    // on the same adapter. This avoids duplicating the driver's per-device memory for each pane and
+    // means that a lost device only needs to be recreated once. See AtlasEngine::_recreateBackend().
+    struct SharedDevice
+    {
+        LUID adapterLuid{};
+        bool d2dMode = false;
+        wil::com_ptr<ID3D11Device2> device;
+        wil::com_ptr<ID3D11DeviceContext2> deviceContext;
+        // The immediate context isn't thread-safe and its state is shared by all engines. An engine
+        // must hold this mutex from the moment it starts using the context until it has presented.
+        std::mutex mutex;
+
+        // Immutable objects that BackendD3D only needs to create once per device.
+        struct
+        {
+            wil::com_ptr<ID3D11InputLayout> inputLayout;
+            wil::com_ptr<ID3D11VertexShader> vertexShader;
+            wil::com_ptr<ID3D11PixelShader> pixelShader;
+            wil::com_ptr<ID3D11BlendState> blendState;
+            wil::com_ptr<ID3D11RasterizerState> rasterizerState;
+            wil::com_ptr<ID3D11Buffer> vertexBuffer;
+            wil::com_ptr<ID3D11Buffer> indexBuffer;
+        } d3d;
+    };
+
     struct RenderingPayload
     {
         //// Parameters which are constant across backends.
@@ -489,8 +534,12 @@ namespace Microsoft::Console::Render::Atlas
             u16x2 targetSize{};
             bool waitForPresentation = false;
         } swapChain;
+        std::shared_ptr<SharedDevice> sharedDevice;
+        // These are the same as the ones in sharedDevice.
         wil::com_ptr<ID3D11Device2> device;
         wil::com_ptr<ID3D11DeviceContext2> deviceContext;
+        // Set if the backend draws IsBuiltinGlyph() characters itself. BackendD2D doesn't.
+        bool builtinGlyphs = false;
 
         //// Parameters which change seldom.
         GenerationalSettings s;
@@ -498,6 +547,10 @@ namespace Microsoft::Console::Render::Atlas
         //// Parameters which change every frame.
         // This is the backing buffer for `rows`.
         Buffer<ShapedRow> unorderedRows;
+        // Glyphs that the backend may rasterize ahead of time, because they're likely needed
+        // soon after a font change. glyphsFrom/glyphsTo of each mapping index into prewarmGlyphIndices.
+        std::vector<FontMapping> prewarmMappings;
+        std::vector<u16> prewarmGlyphIndices;
         // This is used as a scratch buffer during scrolling.
         Buffer<ShapedRow*> rowsScratch;
         // This contains the rows in the right order from row 0 to N.
@@ -535,8 +588,17 @@ namespace Microsoft::Console::Render::Atlas
         til::rect dirtyRectInPx;
         // In rows.
         range<u16> invalidatedRows{};
+        // In rows. The sorted, non-overlapping ranges within invalidatedRows that were actually invalidated.
+        // The rows in between them are untouched, but the backends may still draw them, since they
+        // look exactly like they did in the previous frame.
+        std::vector<range<u16>> invalidatedRowRanges;
+        // In pixel. The vertical extent of everything that was drawn over in the previous frame,
+        // used to present disjoint invalidated rows as multiple dirty rects.
+        std::vector<range<til::CoordType>> dirtySpansInPx;
         // In pixel.
         i16 scrollOffset = 0;
+        // Set while the custom shader's animation should stand still, because the control isn't focused.
+        bool customShaderPaused = false;
 
         void MarkAllAsDirty() noexcept
         {
@@ -546,12 +608,31 @@ namespace Microsoft::Console::Render::Atlas
         }
     };
 
+    // What a backend did during a single Render() call. See AtlasEngine::LastFrameCounters().
+    struct FrameCounters
+    {
+        // The number of glyphs that were looked up in the glyph atlas.
+        u32 glyphLookups = 0;
+        // The number of glyphs that weren't in the glyph atlas yet and had to be rasterized.
+        u32 glyphCacheMisses = 0;
+        // The fraction of the glyph atlas that's in use at the start of the frame, or a negative value if there's none.
+        f32 glyphAtlasOccupancy = -1.0f;
+        // Instances, bitmaps, images and constant buffers copied to the GPU.
+        u64 uploadedBytes = 0;
+        // The GPU time spent on the frame, or a negative value if it wasn't measured.
+        f32 gpuMilliseconds = -1.0f;
+    };
+
     struct IBackend
     {
         virtual ~IBackend() = default;
         virtual void ReleaseResources() noexcept = 0;
         virtual void Render(RenderingPayload& payload) = 0;
         virtual bool RequiresContinuousRedraw() noexcept = 0;
+        // The size of the glyph atlas texture as of the last Render() call in bytes.
+        virtual size_t GlyphAtlasBytes() const noexcept = 0;
+        // The counters of the last Render() call.
+        virtual FrameCounters LastFrameCounters() const noexcept = 0;
     };
 
 }
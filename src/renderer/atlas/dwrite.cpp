@@ -169,3 +169,175 @@ bool DWrite_IsThinFontFamily(IDWriteFontCollection* fontCollection, const wchar_
 
     return DWrite_IsThinFontFamily(&enUsFamilyName[0]);
 }
+
+namespace
+{
+    // A bounds checked view of an OpenType table. All values are big endian.
+    // Reading out of bounds returns 0, which makes the callers skip the malformed part.
+    struct OpenTypeTable
+    {
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+
+        uint16_t u16(const size_t offset) const noexcept
+        {
+            return offset + 2 <= size ? static_cast<uint16_t>(data[offset] << 8 | data[offset + 1]) : 0;
+        }
+
+        uint32_t u32(const size_t offset) const noexcept
+        {
+            return static_cast<uint32_t>(u16(offset)) << 16 | u16(offset + 2);
+        }
+
+        // Returns the tag in the same byte order as DWRITE_MAKE_OPENTYPE_TAG.
+        uint32_t tag(const size_t offset) const noexcept
+        {
+            return offset + 4 <= size ? static_cast<uint32_t>(data[offset] | data[offset + 1] << 8 | data[offset + 2] << 16 | data[offset + 3] << 24) : 0;
+        }
+    };
+
+    void markCoverage(const OpenTypeTable& t, const size_t coverage, std::vector<bool>& glyphs)
+    {
+        const auto format = t.u16(coverage);
+        const auto count = t.u16(coverage + 2);
+
+        if (format == 1)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                const auto glyph = t.u16(coverage + 4 + i * 2);
+                if (glyph < glyphs.size())
+                {
+                    glyphs[glyph] = true;
+                }
+            }
+        }
+        else if (format == 2 && !glyphs.empty())
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                const auto record = coverage + 4 + i * 6;
+                const auto end = std::min<size_t>(t.u16(record + 2), glyphs.size() - 1);
+                for (size_t glyph = t.u16(record); glyph <= end; ++glyph)
+                {
+                    glyphs[glyph] = true;
+                }
+            }
+        }
+    }
+
+    // Marks the glyphs a GSUB subtable of the given lookup type may start substituting at.
+    void markSubtable(const OpenTypeTable& t, uint16_t type, size_t subtable, std::vector<bool>& glyphs)
+    {
+        // Extension substitutions point to a subtable of another type with a 32-bit offset.
+        if (type == 7)
+        {
+            if (t.u16(subtable) != 1)
+            {
+                return;
+            }
+            type = t.u16(subtable + 2);
+            subtable += t.u32(subtable + 4);
+            if (type == 7)
+            {
+                return;
+            }
+        }
+
+        const auto format = t.u16(subtable);
+        size_t coverage;
+
+        if (type == 5 && format == 3)
+        {
+            // Context substitutions list one coverage per input glyph. The first one is what matters.
+            coverage = t.u16(subtable + 2) ? t.u16(subtable + 6) : 0;
+        }
+        else if (type == 6 && format == 3)
+        {
+            // Same for chained context substitutions, whose input coverages follow the backtrack ones.
+            const size_t inputCount = subtable + 4 + t.u16(subtable + 2) * 2;
+            coverage = t.u16(inputCount) ? t.u16(inputCount + 2) : 0;
+        }
+        else
+        {
+            // All other subtables start with their format and the offset to their coverage.
+            coverage = t.u16(subtable + 2);
+        }
+
+        if (coverage)
+        {
+            markCoverage(t, subtable + coverage, glyphs);
+        }
+    }
+}
+
+// Returns a bitmap of the glyphs in the font, which the GSUB lookups of the given features may substitute
+// (or use as the first glyph of a ligature or context). Substitutions can't change a run of text without such glyphs.
+// The lookups of all scripts and languages are taken into account.
+std::vector<bool> DWrite_GetSubstitutedGlyphs(IDWriteFontFace* fontFace, const uint32_t* featureTags, const size_t featureTagCount)
+{
+    std::vector<bool> glyphs(fontFace->GetGlyphCount());
+
+    const void* tableData = nullptr;
+    UINT32 tableSize = 0;
+    void* tableContext = nullptr;
+    BOOL exists = FALSE;
+    THROW_IF_FAILED(fontFace->TryGetFontTable(DWRITE_MAKE_OPENTYPE_TAG('G', 'S', 'U', 'B'), &tableData, &tableSize, &tableContext, &exists));
+    if (!exists)
+    {
+        return glyphs;
+    }
+    const auto cleanup = wil::scope_exit([&]() noexcept {
+        fontFace->ReleaseFontTable(tableContext);
+    });
+
+    const OpenTypeTable t{ static_cast<const uint8_t*>(tableData), tableSize };
+    const size_t featureList = t.u16(4);
+    const size_t lookupList = t.u16(8);
+    if (!featureList || !lookupList)
+    {
+        return glyphs;
+    }
+
+    std::vector<bool> lookups(t.u16(lookupList));
+    const auto featureCount = t.u16(featureList);
+    const auto tagsEnd = featureTags + featureTagCount;
+
+    for (size_t i = 0; i < featureCount; ++i)
+    {
+        const auto record = featureList + 2 + i * 6;
+        if (std::find(featureTags, tagsEnd, t.tag(record)) == tagsEnd)
+        {
+            continue;
+        }
+
+        const auto feature = featureList + t.u16(record + 4);
+        const auto lookupCount = t.u16(feature + 2);
+        for (size_t j = 0; j < lookupCount; ++j)
+        {
+            const auto index = t.u16(feature + 4 + j * 2);
+            if (index < lookups.size())
+            {
+                lookups[index] = true;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < lookups.size(); ++i)
+    {
+        if (!lookups[i])
+        {
+            continue;
+        }
+
+        const auto lookup = lookupList + t.u16(lookupList + 2 + i * 2);
+        const auto type = t.u16(lookup);
+        const auto subtableCount = t.u16(lookup + 4);
+        for (size_t j = 0; j < subtableCount; ++j)
+        {
+            markSubtable(t, type, lookup + t.u16(lookup + 6 + j * 2), glyphs);
+        }
+    }
+
+    return glyphs;
+}
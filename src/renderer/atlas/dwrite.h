@@ -14,3 +14,4 @@ void DWrite_GetRenderParams(IDWriteFactory1* factory, float* gamma, float* clear
 void DWrite_GetGammaRatios(float gamma, float (&out)[4]) noexcept;
 bool DWrite_IsThinFontFamily(const wchar_t* canonicalFamilyName) noexcept;
 bool DWrite_IsThinFontFamily(IDWriteFontCollection* fontCollection, const wchar_t* familyName);
+std::vector<bool> DWrite_GetSubstitutedGlyphs(IDWriteFontFace* fontFace, const uint32_t* featureTags, size_t featureTagCount);
@@ -7,7 +7,9 @@
 #define WIN32_LEAN_AND_MEAN
 
 #include <array>
+#include <bit>
 #include <filesystem>
+#include <mutex>
 #include <optional>
 #include <span>
 #include <sstream>
@@ -2,18 +2,22 @@
 // Licensed under the MIT license.
 
 // clang-format off
-#define SHADING_TYPE_TEXT_BACKGROUND    0
-#define SHADING_TYPE_TEXT_GRAYSCALE     1
-#define SHADING_TYPE_TEXT_CLEARTYPE     2
-#define SHADING_TYPE_TEXT_PASSTHROUGH   3
-#define SHADING_TYPE_DOTTED_LINE        4
-#define SHADING_TYPE_DOTTED_LINE_WIDE   5
+#define SHADING_TYPE_TEXT_BACKGROUND            0
+#define SHADING_TYPE_TEXT_GRAYSCALE             1
+#define SHADING_TYPE_TEXT_CLEARTYPE             2
+#define SHADING_TYPE_TEXT_PASSTHROUGH           3
+#define SHADING_TYPE_TEXT_GRAYSCALE_CELL_COLOR  4
+#define SHADING_TYPE_TEXT_CLEARTYPE_CELL_COLOR  5
+#define SHADING_TYPE_BUILTIN_GLYPH              6
+#define SHADING_TYPE_DOTTED_LINE                7
+#define SHADING_TYPE_DOTTED_LINE_WIDE           8
+#define SHADING_TYPE_IMAGE                      12
 // clang-format on
 
 struct VSData
 {
     float2 vertex : SV_Position;
-    uint shadingType : shadingType;
+    uint2 shadingType : shadingType; // x = QuadInstance::shadingType, y = QuadInstance::builtinGlyph
     int2 position : position;
     uint2 size : size;
     uint2 texcoord : texcoord;
@@ -25,6 +29,7 @@ struct PSData
     float4 position : SV_Position;
     float2 texcoord : texcoord;
     nointerpolation uint shadingType : shadingType;
+    nointerpolation uint builtinGlyph : builtinGlyph;
     nointerpolation float4 color : color;
 };
 
@@ -3,6 +3,7 @@
 
 #include "dwrite.hlsl"
 #include "shader_common.hlsl"
+#include "builtin_glyphs.hlsl"
 
 cbuffer ConstBuffer : register(b0)
 {
@@ -16,6 +17,17 @@ cbuffer ConstBuffer : register(b0)
 
 Texture2D<float4> background : register(t0);
 Texture2D<float4> glyphAtlas : register(t1);
+Texture2D<float4> foregroundBitmap : register(t2);
+Texture2D<float4> imageTexture : register(t3);
+
+// For the *_CELL_COLOR shading types the color contains the glyph's row (the glyph may extend past it
+// vertically) and the foreground color is instead looked up from the cell each pixel is in.
+float4 cellForeground(PSData data)
+{
+    const uint row = uint(data.color.r * 255.0f + 0.5f) | (uint(data.color.g * 255.0f + 0.5f) << 8);
+    const uint column = uint(clamp(data.position.x / cellSize.x, 0.0f, cellCount.x - 1.0f));
+    return foregroundBitmap[uint2(column, row)];
+}
 
 struct Output
 {
@@ -40,11 +52,13 @@ Output main(PSData data) : SV_Target
         break;
     }
     case SHADING_TYPE_TEXT_GRAYSCALE:
+    case SHADING_TYPE_TEXT_GRAYSCALE_CELL_COLOR:
     {
+        const float4 fg = data.shadingType == SHADING_TYPE_TEXT_GRAYSCALE ? data.color : cellForeground(data);
         // These are independent of the glyph texture and could be moved to the vertex shader or CPU side of things.
-        const float4 foreground = premultiplyColor(data.color);
-        const float blendEnhancedContrast = DWrite_ApplyLightOnDarkContrastAdjustment(enhancedContrast, data.color.rgb);
-        const float intensity = DWrite_CalcColorIntensity(data.color.rgb);
+        const float4 foreground = premultiplyColor(fg);
+        const float blendEnhancedContrast = DWrite_ApplyLightOnDarkContrastAdjustment(enhancedContrast, fg.rgb);
+        const float intensity = DWrite_CalcColorIntensity(fg.rgb);
         // These aren't.
         const float4 glyph = glyphAtlas[data.texcoord];
         const float contrasted = DWrite_EnhanceContrast(glyph.a, blendEnhancedContrast);
@@ -54,15 +68,17 @@ Output main(PSData data) : SV_Target
         break;
     }
     case SHADING_TYPE_TEXT_CLEARTYPE:
+    case SHADING_TYPE_TEXT_CLEARTYPE_CELL_COLOR:
     {
+        const float4 fg = data.shadingType == SHADING_TYPE_TEXT_CLEARTYPE ? data.color : cellForeground(data);
         // These are independent of the glyph texture and could be moved to the vertex shader or CPU side of things.
-        const float blendEnhancedContrast = DWrite_ApplyLightOnDarkContrastAdjustment(enhancedContrast, data.color.rgb);
+        const float blendEnhancedContrast = DWrite_ApplyLightOnDarkContrastAdjustment(enhancedContrast, fg.rgb);
         // These aren't.
         const float4 glyph = glyphAtlas[data.texcoord];
         const float3 contrasted = DWrite_EnhanceContrast3(glyph.rgb, blendEnhancedContrast);
-        const float3 alphaCorrected = DWrite_ApplyAlphaCorrection3(contrasted, data.color.rgb, gammaRatios);
-        weights = float4(alphaCorrected * data.color.a, 1);
-        color = weights * data.color;
+        const float3 alphaCorrected = DWrite_ApplyAlphaCorrection3(contrasted, fg.rgb, gammaRatios);
+        weights = float4(alphaCorrected * fg.a, 1);
+        color = weights * fg;
         break;
     }
     case SHADING_TYPE_TEXT_PASSTHROUGH:
@@ -71,6 +87,20 @@ Output main(PSData data) : SV_Target
         weights = color.aaaa;
         break;
     }
+    case SHADING_TYPE_BUILTIN_GLYPH:
+    {
+        // underlineWidth is the thickness of the font's underline, which makes for good light lines.
+        const float light = max(1.0f, round(underlineWidth));
+        color = builtinGlyph(data.texcoord, data.builtinGlyph, cellSize, light) * premultiplyColor(data.color);
+        weights = color.aaaa;
+        break;
+    }
+    case SHADING_TYPE_IMAGE:
+    {
+        color = premultiplyColor(imageTexture[data.texcoord]);
+        weights = color.aaaa;
+        break;
+    }
     case SHADING_TYPE_DOTTED_LINE:
     {
         const bool on = frac(data.position.x / (2.0f * underlineWidth)) < 0.5f;
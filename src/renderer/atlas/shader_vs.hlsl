@@ -14,7 +14,8 @@ PSData main(VSData data)
 {
     PSData output;
     output.color = data.color;
-    output.shadingType = data.shadingType;
+    output.shadingType = data.shadingType.x;
+    output.builtinGlyph = data.shadingType.y;
     // positionScale is expected to be float2(2.0f / sizeInPixel.x, -2.0f / sizeInPixel.y). Together with the
     // addition below this will transform our "position" from pixel into normalized device coordinate (NDC) space.
     output.position.xy = (data.position + data.vertex.xy * data.size) * positionScale + float2(-1.0f, 1.0f);
@@ -3,8 +3,12 @@
 
 #pragma once
 
+#include <til/hash.h>
+
 namespace Microsoft::Console::Render::FontCache
 {
+    struct ResolvedFont;
+
     namespace details
     {
         inline const std::vector<wil::com_ptr<IDWriteFontFile>>& getNearbyFontFiles(IDWriteFactory5* factory5)
@@ -85,15 +89,133 @@ namespace Microsoft::Console::Render::FontCache
                 return systemFontCollection;
             }
         }
+
+        struct ResolvedFontKey
+        {
+            std::wstring faceName;
+            UINT32 weight = 0;
+
+            bool operator==(const ResolvedFontKey&) const = default;
+        };
+
+        struct ResolvedFontKeyHash
+        {
+            size_t operator()(const ResolvedFontKey& key) const noexcept
+            {
+                til::hasher h;
+                h.write(key.faceName);
+                h.write(key.weight);
+                return h.finalize();
+            }
+        };
+
+        // Building the collection with the nearby fonts is fairly expensive and
+        // every pane, every zoom step and every settings reload used to repeat it.
+        // The cache is shared by the entire process and replaced by GetFresh().
+        struct Cache
+        {
+            std::mutex mutex;
+            wil::com_ptr<IDWriteFontCollection> fontCollection;
+            std::unordered_map<ResolvedFontKey, std::shared_ptr<const ResolvedFont>, ResolvedFontKeyHash> fonts;
+        };
+
+        inline Cache& cache()
+        {
+            static Cache cache;
+            return cache;
+        }
     }
 
+    // The size independent results of looking up a font face in the font collection. The metrics
+    // for a specific font size and DPI are cheap to compute from these, which allows us to skip
+    // all DirectWrite queries when zooming or when opening a pane with an already known font.
+    struct ResolvedFont
+    {
+        wil::com_ptr<IDWriteFontCollection> fontCollection;
+        wil::com_ptr<IDWriteFontFamily> fontFamily;
+        wil::com_ptr<IDWriteFontFace> fontFace;
+        DWRITE_FONT_METRICS metrics{};
+        // The advance width of "0" in design units, or -1 if the font has no such glyph.
+        int32_t zeroAdvanceWidth = -1;
+    };
+
     inline wil::com_ptr<IDWriteFontCollection> GetCached()
     {
-        return details::getFontCollection(false);
+        auto& cache = details::cache();
+        const std::lock_guard lock{ cache.mutex };
+        if (!cache.fontCollection)
+        {
+            cache.fontCollection = details::getFontCollection(false);
+        }
+        return cache.fontCollection;
     }
 
     inline wil::com_ptr<IDWriteFontCollection> GetFresh()
     {
-        return details::getFontCollection(true);
+        auto fontCollection = details::getFontCollection(true);
+
+        auto& cache = details::cache();
+        const std::lock_guard lock{ cache.mutex };
+        if (cache.fontCollection != fontCollection)
+        {
+            // Fonts may have been installed or removed, which invalidates all resolved fonts.
+            cache.fontCollection = fontCollection;
+            cache.fonts.clear();
+        }
+        return fontCollection;
+    }
+
+    // Returns the font face with the given family name and weight from GetCached().
+    // Throws DWRITE_E_NOFONT if the family doesn't exist.
+    inline std::shared_ptr<const ResolvedFont> Resolve(const wchar_t* faceName, UINT32 weight)
+    {
+        auto fontCollection = GetCached();
+        details::ResolvedFontKey key{ faceName, weight };
+
+        auto& cache = details::cache();
+        {
+            const std::lock_guard lock{ cache.mutex };
+            if (const auto it = cache.fonts.find(key); it != cache.fonts.end() && it->second->fontCollection == fontCollection)
+            {
+                return it->second;
+            }
+        }
+
+        auto font = std::make_shared<ResolvedFont>();
+
+        UINT32 index = 0;
+        BOOL exists = false;
+        THROW_IF_FAILED(fontCollection->FindFamilyName(faceName, &index, &exists));
+        THROW_HR_IF(DWRITE_E_NOFONT, !exists);
+
+        THROW_IF_FAILED(fontCollection->GetFontFamily(index, font->fontFamily.addressof()));
+
+        wil::com_ptr<IDWriteFont> matchingFont;
+        THROW_IF_FAILED(font->fontFamily->GetFirstMatchingFont(static_cast<DWRITE_FONT_WEIGHT>(weight), DWRITE_FONT_STRETCH_NORMAL, DWRITE_FONT_STYLE_NORMAL, matchingFont.addressof()));
+        THROW_IF_FAILED(matchingFont->CreateFontFace(font->fontFace.addressof()));
+        font->fontFace->GetMetrics(&font->metrics);
+
+        {
+            static constexpr UINT32 codePoint = '0';
+            UINT16 glyphIndex;
+            if (SUCCEEDED(font->fontFace->GetGlyphIndicesW(&codePoint, 1, &glyphIndex)))
+            {
+                DWRITE_GLYPH_METRICS glyphMetrics{};
+                THROW_IF_FAILED(font->fontFace->GetDesignGlyphMetrics(&glyphIndex, 1, &glyphMetrics, FALSE));
+                font->zeroAdvanceWidth = gsl::narrow_cast<int32_t>(glyphMetrics.advanceWidth);
+            }
+        }
+
+        font->fontCollection = std::move(fontCollection);
+
+        const std::lock_guard lock{ cache.mutex };
+        auto& slot = cache.fonts[std::move(key)];
+        // Another thread may have resolved the same font in the meantime, or GetFresh() replaced
+        // the collection. Either way, the entry for the current collection wins.
+        if (!slot || slot->fontCollection != cache.fontCollection)
+        {
+            slot = std::move(font);
+        }
+        return slot;
     }
 }
@@ -259,13 +259,33 @@ std::pair<COLORREF, COLORREF> RenderSettings::GetAttributeColors(const TextAttri
             fg != bg &&
             GetRenderMode(Mode::AlwaysDistinguishableColors))
         {
-            fg = ColorFix::GetPerceivableColor(fg, bg);
+            fg = _getPerceivableColor(fg, bg);
         }
 
         return { fg, bg };
     }
 }
 
+// Routine Description:
+// - Returns ColorFix::GetPerceivableColor(fg, bg), but caches the result.
+//   Computing the color difference is expensive and truecolor output tends
+//   to repeat the same few color pairs over and over again.
+// Arguments:
+// - fg - The foreground color. Must not be equal to bg.
+// - bg - The background color.
+// Return Value:
+// - The foreground color, adjusted to be distinguishable from the background.
+COLORREF RenderSettings::_getPerceivableColor(const COLORREF fg, const COLORREF bg) const noexcept
+{
+    const auto hash = (fg * 0x9E3779B1u) ^ (bg * 0x85EBCA77u);
+    auto& entry = til::at(_perceivableColors, (hash >> 16) % PerceivableColorCacheSize);
+    if (entry.fg != fg || entry.bg != bg)
+    {
+        entry = { fg, bg, ColorFix::GetPerceivableColor(fg, bg) };
+    }
+    return entry.adjusted;
+}
+
 // Routine Description:
 // - Calculates the RGBA colors of a given text attribute, using the current
 //   color table configuration and active render settings. This differs from
@@ -4,8 +4,25 @@
 #include "precomp.h"
 #include "renderer.hpp"
 
+#include <execution>
+#include <winmeta.h>
+#include <TraceLoggingProvider.h>
+
 #pragma hdrstop
 
+// we need to disable a few warnings because
+// the TraceLogging code is out of our control
+#pragma warning(push)
+#pragma warning(disable : 26446 26447 26477 26482 26485 26494 26496)
+TRACELOGGING_DEFINE_PROVIDER(g_hConsoleRenderTraceProvider,
+                             "Microsoft.Windows.Console.Render",
+                             // tl:{41a35baf-cd55-5e23-782b-7323338b5283}
+                             (0x41a35baf, 0xcd55, 0x5e23, 0x78, 0x2b, 0x73, 0x23, 0x33, 0x8b, 0x52, 0x83));
+#pragma warning(pop)
+
+// The provider is shared by all Renderer instances and registered for as long as any of them exists.
+static std::atomic<size_t> s_traceProviderCount{ 0 };
+
 using namespace Microsoft::Console::Render;
 using namespace Microsoft::Console::Types;
 
@@ -14,6 +31,8 @@ using PointTree = interval_tree::IntervalTree<til::point, size_t>;
 static constexpr auto maxRetriesForRenderEngine = 3;
 // The renderer will wait this number of milliseconds * how many tries have elapsed before trying again.
 static constexpr auto renderBackoffBaseTimeMilliseconds{ 150 };
+// The number of dirty lines from which on they're prepared for painting in parallel. See _PaintBufferOutput().
+static constexpr size_t PrepareBufferLinesParallelMinRows = 32;
 
 #define FOREACH_ENGINE(var)   \
     for (auto var : _engines) \
@@ -37,6 +56,11 @@ Renderer::Renderer(const RenderSettings& renderSettings,
     _pData(pData),
     _pThread{ std::move(thread) }
 {
+    if (s_traceProviderCount.fetch_add(1) == 0)
+    {
+        TraceLoggingRegister(g_hConsoleRenderTraceProvider);
+    }
+
     for (size_t i = 0; i < cEngines; i++)
     {
         AddRenderEngine(rgpEngines[i]);
@@ -54,6 +78,11 @@ Renderer::~Renderer()
     // RenderThread blocks until it has shut down.
     _destructing = true;
     _pThread.reset();
+
+    if (s_traceProviderCount.fetch_sub(1) == 1)
+    {
+        TraceLoggingUnregister(g_hConsoleRenderTraceProvider);
+    }
 }
 
 // Routine Description:
@@ -114,6 +143,17 @@ try
     auto unlock = wil::scope_exit([&]() {
         _pData->UnlockConsole();
     });
+    // If the frame was painted without holding the lock, the engine calls that were deferred
+    // in the meantime are made now. This must happen after EndPaint(), which is why it's declared first.
+    auto relock = wil::scope_exit([&]() {
+        if (_deferEngineCalls)
+        {
+            _pData->LockConsole();
+            _deferEngineCalls = false;
+            _FlushDeferredEngineCalls();
+            _pData->UnlockConsole();
+        }
+    });
 
     // Last chance check if anything scrolled without an explicit invalidate notification since the last frame.
     _CheckViewportAndScroll();
@@ -135,13 +175,25 @@ try
 
         // If the engine tells us it really wants to redraw immediately,
         // tell the thread so it doesn't go to sleep and ticks again
-        // at the next opportunity.
+        // at the next opportunity. Engines with animated content may ask
+        // for a slower tick instead, which any other output still preempts.
         if (pEngine->RequiresContinuousRedraw())
         {
-            NotifyPaintFrame();
+            const auto interval = pEngine->GetContinuousRedrawInterval();
+            if (interval.count() > 0 && _pThread)
+            {
+                _pThread->NotifyPaintAfter(interval);
+            }
+            else
+            {
+                NotifyPaintFrame();
+            }
         }
     });
 
+    // The render settings are captured before anything else, as the brushes depend on them.
+    _frame.renderSettings = _renderSettings;
+
     // A. Prep Colors
     RETURN_IF_FAILED(_UpdateDrawingBrushes(pEngine, {}, false, true));
 
@@ -154,37 +206,166 @@ try
     // 1. Paint Background
     RETURN_IF_FAILED(_PaintBackground(pEngine));
 
-    // 2. Paint Rows of Text
-    _PaintBufferOutput(pEngine);
+    // 2. Copy the dirty rows, the selection, the cursor and so on out of the buffer.
+    _CaptureFrame(pEngine);
+
+    // Turning the rows into glyphs and drawing those is the bulk of the frame's cost, but the copy is all
+    // that needs the lock. Releasing it now allows the parser to continue writing in the meantime.
+    if (!_frame.hasOverlays && pEngine->SupportsUnlockedPainting())
+    {
+        _deferEngineCalls = true;
+        unlock.reset();
+    }
+
+    if (_frame.hasDirtyArea)
+    {
+        // 3. Paint Rows of Text
+        _PaintBufferOutput(pEngine);
 
-    // 3. Paint overlays that reside above the text buffer
-    _PaintOverlays(pEngine);
+        // 4. Paint overlays that reside above the text buffer
+        if (_frame.hasOverlays)
+        {
+            _PaintOverlays(pEngine);
+        }
 
-    // 4. Paint Selection
-    _PaintSelection(pEngine);
+        // 5. Paint Selection
+        _PaintSelection(pEngine);
+    }
 
-    // 5. Paint Cursor
+    // 6. Paint Cursor
     _PaintCursor(pEngine);
 
-    // 6. Paint window title
+    // 7. Paint window title
     RETURN_IF_FAILED(_PaintTitle(pEngine));
 
     // Force scope exit end paint to finish up collecting information and possibly painting
     endPaint.reset();
 
     // Force scope exit unlock to let go of global lock so other threads can run
+    relock.reset();
     unlock.reset();
 
+    // Together with the events emitted by the terminal and its connection, these two allow
+    // attributing output-to-present latency to the individual stages. See Terminal.wprp.
+#pragma warning(suppress : 26477 26485 26494 26482 26446) // We don't control TraceLoggingWrite
+    TraceLoggingWrite(g_hConsoleRenderTraceProvider,
+                      "PaintFrame",
+                      TraceLoggingDescription("A frame was painted and is about to be presented"),
+                      TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+                      TraceLoggingKeyword(TIL_KEYWORD_TRACE));
+
     // Trigger out-of-lock presentation for renderers that can support it
     RETURN_IF_FAILED(pEngine->Present());
 
+#pragma warning(suppress : 26477 26485 26494 26482 26446) // We don't control TraceLoggingWrite
+    TraceLoggingWrite(g_hConsoleRenderTraceProvider,
+                      "Present",
+                      TraceLoggingDescription("A frame was presented"),
+                      TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+                      TraceLoggingKeyword(TIL_KEYWORD_TRACE));
+
+    // Secondary engines like the UIA one don't put frames on the screen.
+    if (pEngine == _engines[0])
+    {
+        _framesPainted.fetch_add(1, std::memory_order_relaxed);
+        if (const auto requested = _oldestPaintRequest.exchange(0, std::memory_order_relaxed))
+        {
+            const auto now = std::chrono::steady_clock::now();
+            const auto latency = now - std::chrono::steady_clock::time_point{ std::chrono::steady_clock::duration{ requested } };
+            _latencyMicroseconds.fetch_add(gsl::narrow_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(latency).count()), std::memory_order_relaxed);
+
+            // The first frame that was requested after a keystroke and within its window is taken to contain
+            // the echo. Frames requested before the keystroke (like a cursor blink) or after the window don't count.
+            auto echoStart = _echoStart.load(std::memory_order_relaxed);
+            if (echoStart && requested >= echoStart && requested <= _echoDeadline.load(std::memory_order_relaxed) &&
+                _echoStart.compare_exchange_strong(echoStart, 0, std::memory_order_relaxed))
+            {
+                const auto echoLatency = now - std::chrono::steady_clock::time_point{ std::chrono::steady_clock::duration{ echoStart } };
+                _echoFrames.fetch_add(1, std::memory_order_relaxed);
+                _echoLatencyMicroseconds.fetch_add(gsl::narrow_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(echoLatency).count()), std::memory_order_relaxed);
+            }
+        }
+    }
+
     // As we leave the scope, EndPaint will be called (declared above)
     return S_OK;
 }
 CATCH_RETURN()
 
+// Routine Description:
+// - Calls the given function for each engine. While a frame is painted without holding the console lock
+//   the engines must not be modified, so the call is queued up instead and made once the frame is done.
+// - Like the Trigger*() functions that use it, this must be called while holding the console lock.
+// Arguments:
+// - func - Called with each IRenderEngine*. It must not refer to anything that may not outlive the call.
+// Return Value:
+// - <none>
+template<typename T>
+void Renderer::_CallEngines(T&& func)
+{
+    if (_deferEngineCalls)
+    {
+        _deferredEngineCalls.emplace_back(std::forward<T>(func));
+        return;
+    }
+
+    FOREACH_ENGINE(pEngine)
+    {
+        func(pEngine);
+    }
+}
+
+// Makes the engine calls that _CallEngines() queued up, in order. Must be called while holding the console lock.
+void Renderer::_FlushDeferredEngineCalls() noexcept
+try
+{
+    for (const auto& func : _deferredEngineCalls)
+    {
+        FOREACH_ENGINE(pEngine)
+        {
+            func(pEngine);
+        }
+    }
+    _deferredEngineCalls.clear();
+}
+CATCH_LOG()
+
+// Routine Description:
+// - Captures everything the remainder of the frame is painted from into _frame and _bufferLines,
+//   so that it can be painted without holding the console lock. See _PaintFrameForEngine().
+// Arguments:
+// - pEngine - The engine that's painting the frame.
+// Return Value:
+// - <none>
+void Renderer::_CaptureFrame(_In_ IRenderEngine* const pEngine)
+{
+    _frame.viewport = _pData->GetViewport();
+    _frame.cursor = _GetCursorInfo();
+    _frame.title = _pData->GetConsoleTitle();
+    _frame.hyperlinkHoveredId = _hyperlinkHoveredId;
+    _frame.hoveredInterval = _hoveredInterval;
+    _frame.gridLinesAllowed = _pData->IsGridLineDrawingAllowed();
+    _frame.hasOverlays = !_pData->GetOverlays().empty();
+    _frame.lineCount = 0;
+    _frame.selection.clear();
+
+    // A blinking cursor is tracked by engines like AtlasEngine separately from the dirty rows.
+    // If no rows are dirty the text, overlays and selection would be clipped away entirely,
+    // so we don't bother preparing them and only draw the cursor. This keeps idle terminals cheap.
+    _frame.hasDirtyArea = _HasDirtyArea(pEngine);
+    if (_frame.hasDirtyArea)
+    {
+        _PrepareBufferOutput(pEngine);
+        _PrepareSelection(pEngine);
+    }
+}
+
 void Renderer::NotifyPaintFrame() noexcept
 {
+    _paintRequests.fetch_add(1, std::memory_order_relaxed);
+    auto expected = int64_t{ 0 };
+    _oldestPaintRequest.compare_exchange_strong(expected, std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+
     // If we're running in the unittests, we might not have a render thread.
     if (_pThread)
     {
@@ -193,6 +374,20 @@ void Renderer::NotifyPaintFrame() noexcept
     }
 }
 
+// Routine Description:
+// - Returns how many frames were requested and painted and how long it took to present them.
+//   Can be called from any thread. See FrameStatistics.
+Renderer::FrameStatistics Renderer::GetFrameStatistics() const noexcept
+{
+    FrameStatistics stats;
+    stats.paintRequests = _paintRequests.load(std::memory_order_relaxed);
+    stats.framesPainted = _framesPainted.load(std::memory_order_relaxed);
+    stats.latencyMicroseconds = _latencyMicroseconds.load(std::memory_order_relaxed);
+    stats.echoFrames = _echoFrames.load(std::memory_order_relaxed);
+    stats.echoLatencyMicroseconds = _echoLatencyMicroseconds.load(std::memory_order_relaxed);
+    return stats;
+}
+
 // Routine Description:
 // - Called when the system has requested we redraw a portion of the console.
 // Arguments:
@@ -201,10 +396,10 @@ void Renderer::NotifyPaintFrame() noexcept
 // - <none>
 void Renderer::TriggerSystemRedraw(const til::rect* const prcDirtyClient)
 {
-    FOREACH_ENGINE(pEngine)
-    {
-        LOG_IF_FAILED(pEngine->InvalidateSystem(prcDirtyClient));
-    }
+    const auto dirtyClient = prcDirtyClient ? std::optional{ *prcDirtyClient } : std::nullopt;
+    _CallEngines([=](IRenderEngine* pEngine) {
+        LOG_IF_FAILED(pEngine->InvalidateSystem(dirtyClient ? &*dirtyClient : nullptr));
+    });
 
     NotifyPaintFrame();
 }
@@ -235,10 +430,9 @@ void Renderer::TriggerRedraw(const Viewport& region)
     if (view.TrimToViewport(&srUpdateRegion))
     {
         view.ConvertToOrigin(&srUpdateRegion);
-        FOREACH_ENGINE(pEngine)
-        {
+        _CallEngines([=](IRenderEngine* pEngine) {
             LOG_IF_FAILED(pEngine->Invalidate(&srUpdateRegion));
-        }
+        });
 
         NotifyPaintFrame();
     }
@@ -286,10 +480,9 @@ void Renderer::TriggerRedrawCursor(const til::point* const pcoord)
         if (view.TrimToViewport(&updateRect))
         {
             view.ConvertToOrigin(&updateRect);
-            FOREACH_ENGINE(pEngine)
-            {
+            _CallEngines([=](IRenderEngine* pEngine) {
                 LOG_IF_FAILED(pEngine->InvalidateCursor(&updateRect));
-            }
+            });
 
             NotifyPaintFrame();
         }
@@ -306,10 +499,9 @@ void Renderer::TriggerRedrawCursor(const til::point* const pcoord)
 // - <none>
 void Renderer::TriggerRedrawAll(const bool backgroundChanged, const bool frameChanged)
 {
-    FOREACH_ENGINE(pEngine)
-    {
+    _CallEngines([](IRenderEngine* pEngine) {
         LOG_IF_FAILED(pEngine->InvalidateAll());
-    }
+    });
 
     NotifyPaintFrame();
 
@@ -372,10 +564,18 @@ void Renderer::TriggerSelection()
             sr &= viewport;
         }
 
-        FOREACH_ENGINE(pEngine)
+        // Only the rows whose selected area changed need to be redrawn. While dragging a
+        // large selection that's usually just the row(s) around the end of the selection.
+        std::vector<til::rect> removed;
+        std::vector<til::rect> added;
+        _DiffSelectionRects(_previousSelection, rects, removed, added);
+
+        if (!removed.empty() || !added.empty())
         {
-            LOG_IF_FAILED(pEngine->InvalidateSelection(_previousSelection));
-            LOG_IF_FAILED(pEngine->InvalidateSelection(rects));
+            _CallEngines([removed = std::move(removed), added = std::move(added)](IRenderEngine* pEngine) {
+                LOG_IF_FAILED(pEngine->InvalidateSelection(removed));
+                LOG_IF_FAILED(pEngine->InvalidateSelection(added));
+            });
         }
 
         _previousSelection = std::move(rects);
@@ -408,11 +608,10 @@ bool Renderer::_CheckViewportAndScroll()
     coordDelta.x = srOldViewport.left - srNewViewport.left;
     coordDelta.y = srOldViewport.top - srNewViewport.top;
 
-    FOREACH_ENGINE(engine)
-    {
+    _CallEngines([=](IRenderEngine* engine) {
         LOG_IF_FAILED(engine->UpdateViewport(srNewViewport));
         LOG_IF_FAILED(engine->InvalidateScroll(&coordDelta));
-    }
+    });
 
     _ScrollPreviousSelection(coordDelta);
     return true;
@@ -444,16 +643,62 @@ void Renderer::TriggerScroll()
 // - <none>
 void Renderer::TriggerScroll(const til::point* const pcoordDelta)
 {
-    FOREACH_ENGINE(pEngine)
-    {
-        LOG_IF_FAILED(pEngine->InvalidateScroll(pcoordDelta));
-    }
+    _CallEngines([coordDelta = *pcoordDelta](IRenderEngine* pEngine) {
+        LOG_IF_FAILED(pEngine->InvalidateScroll(&coordDelta));
+    });
 
     _ScrollPreviousSelection(*pcoordDelta);
 
     NotifyPaintFrame();
 }
 
+// Routine Description:
+// - Splits the difference between two selections into the rectangles that are only
+//   part of the previous one and those that are only part of the new one.
+//   Rectangles which are part of both are sorted out, because their cells stay selected.
+// - The rectangles are expected to be given line by line, from top to bottom,
+//   as they're returned by _GetSelectionRects.
+// Arguments:
+// - previous - The previous selection rectangles
+// - current - The new selection rectangles
+// - removed - Receives the rectangles that are only in previous
+// - added - Receives the rectangles that are only in current
+// Return Value:
+// - <none>
+void Renderer::_DiffSelectionRects(const std::vector<til::rect>& previous,
+                                   const std::vector<til::rect>& current,
+                                   std::vector<til::rect>& removed,
+                                   std::vector<til::rect>& added)
+{
+    auto prev = previous.begin();
+    auto curr = current.begin();
+
+    while (prev != previous.end() && curr != current.end())
+    {
+        if (*prev == *curr)
+        {
+            ++prev;
+            ++curr;
+        }
+        else if (prev->top < curr->top)
+        {
+            removed.emplace_back(*prev++);
+        }
+        else if (curr->top < prev->top)
+        {
+            added.emplace_back(*curr++);
+        }
+        else
+        {
+            removed.emplace_back(*prev++);
+            added.emplace_back(*curr++);
+        }
+    }
+
+    removed.insert(removed.end(), prev, previous.end());
+    added.insert(added.end(), curr, current.end());
+}
+
 // Routine Description:
 // - Called when the text buffer is about to circle its backing buffer.
 //      A renderer might want to get painted before that happens.
@@ -463,7 +708,20 @@ void Renderer::TriggerScroll(const til::point* const pcoordDelta)
 // - <none>
 void Renderer::TriggerFlush(const bool circling)
 {
-    const auto rects = _GetSelectionRects();
+    auto rects = _GetSelectionRects();
+
+    // Engines can't be painted synchronously while they're busy with a frame. The flush then
+    // happens once that's done and a repaint, if any is needed, along with the next frame.
+    if (_deferEngineCalls)
+    {
+        _CallEngines([=, rects = std::move(rects)](IRenderEngine* pEngine) {
+            auto fEngineRequestsRepaint = false;
+            LOG_IF_FAILED(pEngine->InvalidateFlush(circling, &fEngineRequestsRepaint));
+            LOG_IF_FAILED(pEngine->InvalidateSelection(rects));
+        });
+        NotifyPaintFrame();
+        return;
+    }
 
     FOREACH_ENGINE(pEngine)
     {
@@ -489,16 +747,23 @@ void Renderer::TriggerFlush(const bool circling)
 // - <none>
 void Renderer::TriggerTitleChange()
 {
-    const auto newTitle = _pData->GetConsoleTitle();
-    FOREACH_ENGINE(pEngine)
-    {
+    _CallEngines([newTitle = std::wstring{ _pData->GetConsoleTitle() }](IRenderEngine* pEngine) {
         LOG_IF_FAILED(pEngine->InvalidateTitle(newTitle));
-    }
+    });
     NotifyPaintFrame();
 }
 
 void Renderer::TriggerNewTextNotification(const std::wstring_view newText)
 {
+    // This is called for every write. The text is only copied if it can't be handed to the engines right away.
+    if (_deferEngineCalls)
+    {
+        _CallEngines([newText = std::wstring{ newText }](IRenderEngine* pEngine) {
+            LOG_IF_FAILED(pEngine->NotifyNewText(newText));
+        });
+        return;
+    }
+
     FOREACH_ENGINE(pEngine)
     {
         LOG_IF_FAILED(pEngine->NotifyNewText(newText));
@@ -513,8 +778,7 @@ void Renderer::TriggerNewTextNotification(const std::wstring_view newText)
 // - the HRESULT of the underlying engine's UpdateTitle call.
 HRESULT Renderer::_PaintTitle(IRenderEngine* const pEngine)
 {
-    const auto newTitle = _pData->GetConsoleTitle();
-    return pEngine->UpdateTitle(newTitle);
+    return pEngine->UpdateTitle(_frame.title);
 }
 
 // Routine Description:
@@ -553,10 +817,9 @@ void Renderer::UpdateSoftFont(const std::span<const uint16_t> bitPattern, const
     const auto softFontCharCount = cellSize.height ? bitPattern.size() / cellSize.height : 0;
     _lastSoftFontChar = _firstSoftFontChar + softFontCharCount - 1;
 
-    FOREACH_ENGINE(pEngine)
-    {
+    _CallEngines([=, bitPattern = std::vector<uint16_t>{ bitPattern.begin(), bitPattern.end() }](IRenderEngine* pEngine) {
         LOG_IF_FAILED(pEngine->UpdateSoftFont(bitPattern, cellSize, centeringHint));
-    }
+    });
     TriggerRedrawAll();
 }
 
@@ -647,6 +910,107 @@ void Renderer::EnablePainting()
     }
 }
 
+// Routine Description:
+// - Limits the rate at which the render thread paints frames. See RenderThread::SetMinimumFrameInterval().
+// Arguments:
+// - interval - The minimum time between two frames. 0 disables the limit.
+// Return Value:
+// - <none>
+void Renderer::SetMinimumFrameInterval(const std::chrono::milliseconds interval) noexcept
+{
+    // When running the unit tests, we may be using a render without a render thread.
+    if (_pThread)
+    {
+        _pThread->SetMinimumFrameInterval(interval);
+    }
+}
+
+// Routine Description:
+// - Holds back frames until no paint was requested for the given timeout.
+//   See RenderThread::SetIdleFlushTimeout().
+// Arguments:
+// - timeout - How long the output must be idle before a frame is painted. 0 disables the wait.
+// Return Value:
+// - <none>
+void Renderer::SetIdleFlushTimeout(const std::chrono::milliseconds timeout) noexcept
+{
+    // When running the unit tests, we may be using a render without a render thread.
+    if (_pThread)
+    {
+        _pThread->SetIdleFlushTimeout(timeout);
+    }
+}
+
+// Routine Description:
+// - Called after a keystroke was sent to the connection. The frames requested within the given
+//   window, which usually contain the echo of the keystroke, skip the minimum frame interval.
+//   See RenderThread::ExpediteFrames(). How long it took to present the echo is tracked in the FrameStatistics.
+// - Can be called from any thread.
+// Arguments:
+// - window - How long to wait for the echo. Output arriving later is painted like any other.
+// Return Value:
+// - <none>
+void Renderer::ExpediteEcho(const std::chrono::milliseconds window) noexcept
+{
+    const auto now = std::chrono::steady_clock::now();
+    const auto previousDeadline = _echoDeadline.exchange((now + window).time_since_epoch().count(), std::memory_order_relaxed);
+    // If the previous keystroke's echo is still due, we keep measuring from that keystroke.
+    if (!_echoStart.load(std::memory_order_relaxed) || now.time_since_epoch().count() > previousDeadline)
+    {
+        _echoStart.store(now.time_since_epoch().count(), std::memory_order_relaxed);
+    }
+
+    // When running the unit tests, we may be using a render without a render thread.
+    if (_pThread)
+    {
+        _pThread->ExpediteFrames(window);
+    }
+}
+
+// Routine Description:
+// - Suspends or resumes painting. See RenderThread::SetOccluded().
+// Arguments:
+// - occluded - true if the output can't be seen right now.
+// Return Value:
+// - <none>
+void Renderer::SetOccluded(const bool occluded) noexcept
+{
+    // When running the unit tests, we may be using a render without a render thread.
+    if (_pThread)
+    {
+        _pThread->SetOccluded(occluded);
+    }
+}
+
+// Routine Description:
+// - Asks the render thread to release the GPU resources of the engines, even while it's occluded.
+//   See RenderThread::RequestDeviceResourceRelease(). They're recreated by the next frame.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void Renderer::RequestDeviceResourceRelease() noexcept
+{
+    if (_pThread)
+    {
+        _pThread->RequestDeviceResourceRelease();
+    }
+}
+
+// Routine Description:
+// - Called by the render thread in response to RequestDeviceResourceRelease().
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void Renderer::ReleaseDeviceResources() noexcept
+{
+    FOREACH_ENGINE(pEngine)
+    {
+        pEngine->ReleaseDeviceResources();
+    }
+}
+
 // Routine Description:
 // - Waits for the current paint operation to complete, if any, up to the specified timeout.
 // - Resets an event in the render thread that precludes it from advancing, thus disabling rendering.
@@ -672,29 +1036,32 @@ void Renderer::WaitForPaintCompletionAndDisable(const DWORD dwTimeoutMs)
 }
 
 // Routine Description:
-// - Paint helper to copy the primary console buffer text onto the screen.
+// - Helper to copy the primary console buffer text out of the buffer, so that _PaintBufferOutput() can put it onto the screen.
 // - This portion primarily handles figuring the current viewport, comparing it/trimming it versus the invalid portion of the frame, and queuing up, row by row, which pieces of text need to be further processed.
 // - See also: Helper functions that separate out each complexity of text rendering.
 // Arguments:
 // - <none>
 // Return Value:
 // - <none>
-void Renderer::_PaintBufferOutput(_In_ IRenderEngine* const pEngine)
+void Renderer::_PrepareBufferOutput(_In_ IRenderEngine* const pEngine)
 {
     // This is the subsection of the entire screen buffer that is currently being presented.
     // It can move left/right or top/bottom depending on how the viewport is scrolled
     // relative to the entire buffer.
-    const auto view = _pData->GetViewport();
+    const auto view = _frame.viewport;
 
     // This is effectively the number of cells on the visible screen that need to be redrawn.
     // The origin is always 0, 0 because it represents the screen itself, not the underlying buffer.
     std::span<const til::rect> dirtyAreas;
     LOG_IF_FAILED(pEngine->GetDirtyArea(dirtyAreas));
 
-    // This is to make sure any transforms are reset when this paint is finished.
-    auto resetLineTransform = wil::scope_exit([&]() {
-        LOG_IF_FAILED(pEngine->ResetLineTransform());
-    });
+    // Retrieve the text buffer so we can read information out of it.
+    const auto& buffer = _pData->GetTextBuffer();
+
+    // Turning the cells of a line into clusters and runs of identical attributes is the most expensive
+    // part of painting a large terminal. The lines are independent of each other, so we do this first
+    // for all of them (in parallel if there are many) and only then hand them to the engine in order.
+    size_t lineCount = 0;
 
     for (const auto& dirtyRect : dirtyAreas)
     {
@@ -714,43 +1081,114 @@ void Renderer::_PaintBufferOutput(_In_ IRenderEngine* const pEngine)
         // we need to walk through line-by-line and repaint onto the screen.
         const auto redraw = Viewport::Intersect(dirty, view);
 
-        // Retrieve the text buffer so we can read information out of it.
-        const auto& buffer = _pData->GetTextBuffer();
-
         // Now walk through each row of text that we need to redraw.
         for (auto row = redraw.Top(); row < redraw.BottomExclusive(); row++)
         {
+            if (lineCount >= _bufferLines.size())
+            {
+                _bufferLines.emplace_back();
+            }
+            auto& line = _bufferLines[lineCount++];
+
             // Calculate the boundaries of a single line. This is from the left to right edge of the dirty
             // area in width and exactly 1 tall.
             const auto screenLine = til::inclusive_rect{ redraw.Left(), row, redraw.RightInclusive(), row };
 
             // Convert the screen coordinates of the line to an equivalent
             // range of buffer cells, taking line rendition into account.
-            const auto lineRendition = buffer.GetLineRendition(row);
-            const auto bufferLine = Viewport::FromInclusive(ScreenToBufferLine(screenLine, lineRendition));
+            line.lineRendition = buffer.GetLineRendition(row);
+            line.bufferLine = Viewport::FromInclusive(ScreenToBufferLine(screenLine, line.lineRendition));
 
             // Find where on the screen we should place this line information. This requires us to re-map
             // the buffer-based origin of the line back onto the screen-based origin of the line.
             // For example, the screen might say we need to paint line 1 because it is dirty but the viewport
             // is actually looking at line 26 relative to the buffer. This means that we need line 27 out
             // of the backing buffer to fill in line 1 of the screen.
-            const auto screenPosition = bufferLine.Origin() - til::point{ 0, view.Top() };
-
-            // Retrieve the cell information iterator limited to just this line we want to redraw.
-            auto it = buffer.GetCellDataAt(bufferLine.Origin(), bufferLine);
+            line.screenPosition = line.bufferLine.Origin() - til::point{ 0, view.Top() };
 
             // Calculate if two things are true:
             // 1. this row wrapped
             // 2. We're painting the last col of the row.
-            // In that case, set lineWrapped=true for the _PaintBufferOutputHelper call.
-            const auto lineWrapped = (buffer.GetRowByOffset(bufferLine.Origin().y).WasWrapForced()) &&
-                                     (bufferLine.RightExclusive() == buffer.GetSize().Width());
+            // In that case, set lineWrapped=true for the PaintBufferLine call.
+            const auto& bufferRow = buffer.GetRowByOffset(line.bufferLine.Origin().y);
+            line.lineWrapped = bufferRow.WasWrapForced() &&
+                               (line.bufferLine.RightExclusive() == buffer.GetSize().Width());
+
+            // Sixel images are drawn on top of the text of the row they're anchored to.
+            if (const auto imageSlice = bufferRow.GetImageSlice())
+            {
+                if (line.imageSlice)
+                {
+                    *line.imageSlice = *imageSlice;
+                }
+                else
+                {
+                    line.imageSlice = std::make_unique<ImageSlice>(*imageSlice);
+                }
+            }
+            else
+            {
+                line.imageSlice.reset();
+            }
+        }
+    }
+
+    const std::span lines{ _bufferLines.data(), lineCount };
+    // Exceptions must not escape std::execution::par. They're rethrown below.
+    const auto prepare = [&](BufferLine& line) noexcept {
+        try
+        {
+            line.exception = nullptr;
+            _PrepareBufferLine(buffer, line);
+        }
+        catch (...)
+        {
+            line.exception = std::current_exception();
+        }
+    };
+    if (lineCount >= PrepareBufferLinesParallelMinRows)
+    {
+        std::for_each(std::execution::par, lines.begin(), lines.end(), prepare);
+    }
+    else
+    {
+        std::for_each(lines.begin(), lines.end(), prepare);
+    }
+
+    _frame.lineCount = lineCount;
+}
+
+// Routine Description:
+// - Paints the lines that _PrepareBufferOutput() prepared. Doesn't access the buffer.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void Renderer::_PaintBufferOutput(_In_ IRenderEngine* const pEngine)
+{
+    const auto& view = _frame.viewport;
+
+    // This is to make sure any transforms are reset when this paint is finished.
+    auto resetLineTransform = wil::scope_exit([&]() {
+        LOG_IF_FAILED(pEngine->ResetLineTransform());
+    });
 
-            // Prepare the appropriate line transform for the current row and viewport offset.
-            LOG_IF_FAILED(pEngine->PrepareLineTransform(lineRendition, screenPosition.y, view.Left()));
+    for (const auto& line : std::span{ _bufferLines.data(), _frame.lineCount })
+    {
+        if (line.exception)
+        {
+            std::rethrow_exception(line.exception);
+        }
 
-            // Ask the helper to paint through this specific line.
-            _PaintBufferOutputHelper(pEngine, it, screenPosition, lineWrapped);
+        // Prepare the appropriate line transform for the current row and viewport offset.
+        LOG_IF_FAILED(pEngine->PrepareLineTransform(line.lineRendition, line.screenPosition.y, view.Left()));
+
+        // Ask the helper to paint through this specific line.
+        _PaintBufferOutputHelper(pEngine, line);
+
+        if (line.imageSlice)
+        {
+            LOG_IF_FAILED(pEngine->PaintImageSlice(*line.imageSlice, line.screenPosition.y, view.Left()));
         }
     }
 }
@@ -761,154 +1199,198 @@ static bool _IsAllSpaces(const std::wstring_view v)
     return v.find_first_not_of(L' ') == decltype(v)::npos;
 }
 
-void Renderer::_PaintBufferOutputHelper(_In_ IRenderEngine* const pEngine,
-                                        TextBufferCellIterator it,
-                                        const til::point target,
-                                        const bool lineWrapped)
+// Routine Description:
+// - Splits the given line into runs of clusters that can be painted with the same brushes.
+// - This may be called concurrently for different lines and must thus not modify the Renderer.
+void Renderer::_PrepareBufferLine(const TextBuffer& buffer, BufferLine& line) const
 {
-    auto globalInvert{ _renderSettings.GetRenderMode(RenderSettings::Mode::ScreenReversed) };
+    line.clusters.clear();
+    line.runs.clear();
+    line.attrs.clear();
 
-    // If we have valid data, let's figure out how to draw it.
-    if (it)
-    {
-        // TODO: MSFT: 20961091 -  This is a perf issue. Instead of rebuilding this and allocing memory to hold the reinterpretation,
-        // we should have an iterator/view adapter for the rendering.
-        // That would probably also eliminate the RenderData needing to give us the entire TextBuffer as well...
-        // Retrieve the iterator for one line of information.
-        til::CoordType cols = 0;
+    const auto globalInvert{ _renderSettings.GetRenderMode(RenderSettings::Mode::ScreenReversed) };
+
+    // Walk the glyphs of just this line we want to redraw.
+    const auto left = line.bufferLine.Left();
+    const auto& row = buffer.GetRowByOffset(line.bufferLine.Origin().y);
+    RowGlyphIterator it{ row, left, line.bufferLine.RightExclusive() };
 
-        // Retrieve the first color.
-        auto color = it->TextAttr();
-        // Retrieve the first pattern id
-        auto patternIds = _pData->GetPatternId(target);
-        // Determine whether we're using a soft font.
-        auto usingSoftFont = s_IsSoftFontChar(it->Chars(), _firstSoftFontChar, _lastSoftFontChar);
+    // The run we're currently accumulating clusters for, if any.
+    BufferLineRun* run = nullptr;
+    TextAttribute color;
+    auto usingSoftFont = false;
+    til::CoordType cols = 0;
 
-        // And hold the point where we should start drawing.
-        auto screenPoint = target;
+    // And hold the point where we should start drawing.
+    auto screenPoint = line.screenPosition;
 
-        // This outer loop will continue until we reach the end of the text we are trying to draw.
-        while (it)
+    const auto finishRun = [&]() {
+        run->clustersEnd = line.clusters.size();
+        run->target = screenPoint;
+        run->columns = cols;
+
+        // See GH: 803. The grid lines of wide glyphs are painted column by column in _PaintBufferOutputHelper().
+        if (run->containsWideCharacter)
         {
-            // Hold onto the current run color right here for the length of the outer loop.
-            // We'll be changing the persistent one as we run through the inner loops to detect
-            // when a run changes, but we will still need to know this color at the bottom
-            // when we go to draw gridlines for the length of the run.
-            const auto currentRunColor = color;
+            const auto columnEnd = std::min<til::CoordType>(run->bufferStart.x + cols, row.size());
+            run->attrsBegin = line.attrs.size();
+            for (auto x = run->bufferStart.x; x < columnEnd; ++x)
+            {
+                line.attrs.emplace_back(row.GetAttrByColumn(x));
+            }
+            run->attrsEnd = line.attrs.size();
+        }
+    };
 
-            // Hold onto the current pattern id as well
-            const auto currentPatternId = patternIds;
+    // This loop will continue until we reach the end of the text we are trying to draw.
+    while (it.Next())
+    {
+        const til::point thisPoint{ line.screenPosition.x + it.Column() - left, line.screenPosition.y };
+        const auto thisUsingSoftFont = s_IsSoftFontChar(it.Text(), _firstSoftFontChar, _lastSoftFontChar);
+        const auto& newAttr = it.Attr();
 
-            // Update the drawing brushes with our color and font usage.
-            THROW_IF_FAILED(_UpdateDrawingBrushes(pEngine, currentRunColor, usingSoftFont, false));
+        if (!run)
+        {
+            // Retrieve the first color, pattern id and whether we're using a soft font.
+            color = newAttr;
+            _pData->GetPatternId(thisPoint, line.patternIds);
+            usingSoftFont = thisUsingSoftFont;
+        }
+        else
+        {
+            // We accumulate clusters until the color changes.
+            // When the color changes, we save the new color off and vend the run.
+            // We also accumulate clusters according to regex patterns
+            _pData->GetPatternId(thisPoint, line.nextPatternIds);
+            const auto changedPatternOrFont = line.patternIds != line.nextPatternIds || usingSoftFont != thisUsingSoftFont;
+            if (color != newAttr || changedPatternOrFont)
+            {
+                // foreground doesn't matter for runs of spaces (!)
+                // if we trick it . . . we call Paint far fewer times for cmatrix
+                if (!_IsAllSpaces(it.Text()) || !newAttr.HasIdenticalVisualRepresentationForBlankSpace(color, globalInvert) || changedPatternOrFont)
+                {
+                    finishRun();
+                    run = nullptr;
+                    color = newAttr;
+                    std::swap(line.patternIds, line.nextPatternIds);
+                    usingSoftFont = thisUsingSoftFont;
+                }
+            }
+        }
+
+        if (!run)
+        {
+            // Hold onto the current run color and font usage right here for the length of the run.
+            // We'll be changing the persistent ones as we run through the glyphs to detect
+            // when a run changes, but we will still need to know them when we paint the run.
+            run = &line.runs.emplace_back(BufferLineRun{
+                .color = color,
+                .usingSoftFont = usingSoftFont,
+                .inPattern = !line.patternIds.empty(),
+            });
 
             // Advance the point by however many columns we've just outputted and reset the accumulator.
             screenPoint.x += cols;
             cols = 0;
 
-            // Hold onto the start of this run iterator and the target location where we started
+            // Hold onto the start of this run and the target location where we started
             // in case we need to do some special work to paint the line drawing characters.
-            const auto currentRunItStart = it;
-            const auto currentRunTargetStart = screenPoint;
+            run->bufferStart = { it.Column(), line.bufferLine.Origin().y };
+            run->targetStart = screenPoint;
+            run->clustersBegin = line.clusters.size();
+        }
 
-            // Ensure that our cluster vector is clear.
-            _clusterBuffer.clear();
+        // Turn the glyph into a rendering cluster.
+        const auto columnCount = it.ColumnEnd() - it.ColumnBegin();
 
-            // Reset our flag to know when we're in the special circumstance
-            // of attempting to draw only the right-half of a two-column character
-            // as the first item in our run.
-            auto trimLeft = false;
+        // If the line starts with the trailing half of a wide glyph (a.k.a. the right half of a
+        // two column character), then we need some special handling.
+        if (it.ColumnBegin() < it.Column())
+        {
+            // Move left to the one so the whole character can be struck correctly.
+            screenPoint.x -= it.Column() - it.ColumnBegin();
+            // And tell the next function to trim off the left half of it.
+            run->trimLeft = true;
+        }
 
-            // Run contains wide character (>1 columns)
-            auto containsWideCharacter = false;
+        if (columnCount > 1)
+        {
+            run->containsWideCharacter = true;
+        }
 
-            // This inner loop will accumulate clusters until the color changes.
-            // When the color changes, it will save the new color off and break.
-            // We also accumulate clusters according to regex patterns
-            do
-            {
-                til::point thisPoint{ screenPoint.x + cols, screenPoint.y };
-                const auto thisPointPatterns = _pData->GetPatternId(thisPoint);
-                const auto thisUsingSoftFont = s_IsSoftFontChar(it->Chars(), _firstSoftFontChar, _lastSoftFontChar);
-                const auto changedPatternOrFont = patternIds != thisPointPatterns || usingSoftFont != thisUsingSoftFont;
-                if (color != it->TextAttr() || changedPatternOrFont)
-                {
-                    auto newAttr{ it->TextAttr() };
-                    // foreground doesn't matter for runs of spaces (!)
-                    // if we trick it . . . we call Paint far fewer times for cmatrix
-                    if (!_IsAllSpaces(it->Chars()) || !newAttr.HasIdenticalVisualRepresentationForBlankSpace(color, globalInvert) || changedPatternOrFont)
-                    {
-                        color = newAttr;
-                        patternIds = thisPointPatterns;
-                        usingSoftFont = thisUsingSoftFont;
-                        break; // vend this run
-                    }
-                }
+        // Advance the cluster and column counts.
+        line.clusters.emplace_back(it.Text(), columnCount);
+        cols += columnCount;
+    }
 
-                // Walk through the text data and turn it into rendering clusters.
-                // Keep the columnCount as we go to improve performance over digging it out of the vector at the end.
-                auto columnCount = it->Columns();
+    if (run)
+    {
+        finishRun();
+    }
 
-                // If we're on the first cluster to be added and it's marked as "trailing"
-                // (a.k.a. the right half of a two column character), then we need some special handling.
-                if (_clusterBuffer.empty() && it->DbcsAttr() == DbcsAttribute::Trailing)
-                {
-                    // Move left to the one so the whole character can be struck correctly.
-                    --screenPoint.x;
-                    // And tell the next function to trim off the left half of it.
-                    trimLeft = true;
-                    // And add one to the number of columns we expect it to take as we insert it.
-                    ++columnCount;
-                }
+    // The clusters point into the row, which may change as soon as the console lock is released.
+    // Copy their text into the line, so that it can be painted without holding the lock.
+    size_t textLength = 0;
+    for (const auto& cluster : line.clusters)
+    {
+        textLength += cluster.GetText().size();
+    }
 
-                if (columnCount > 1)
-                {
-                    containsWideCharacter = true;
-                }
+    line.text.clear();
+    line.text.reserve(textLength);
 
-                // Advance the cluster and column counts.
-                _clusterBuffer.emplace_back(it->Chars(), columnCount);
-                it += std::max(it->Columns(), 1); // prevent infinite loop for no visible columns
-                cols += columnCount;
+    for (auto& cluster : line.clusters)
+    {
+        const auto text = cluster.GetText();
+        const auto offset = line.text.size();
+        line.text.append(text);
+        cluster = Cluster{ std::wstring_view{ line.text }.substr(offset, text.size()), cluster.GetColumns() };
+    }
+}
 
-            } while (it);
+void Renderer::_PaintBufferOutputHelper(_In_ IRenderEngine* const pEngine, const BufferLine& line)
+{
+    for (const auto& run : line.runs)
+    {
+        // Update the drawing brushes with our color and font usage.
+        THROW_IF_FAILED(_UpdateDrawingBrushes(pEngine, run.color, run.usingSoftFont, false));
 
-            // Do the painting.
-            THROW_IF_FAILED(pEngine->PaintBufferLine({ _clusterBuffer.data(), _clusterBuffer.size() }, screenPoint, trimLeft, lineWrapped));
+        // Do the painting.
+        const std::span clusters{ line.clusters.data() + run.clustersBegin, run.clustersEnd - run.clustersBegin };
+        THROW_IF_FAILED(pEngine->PaintBufferLine(clusters, run.target, run.trimLeft, line.lineWrapped));
 
-            // If we're allowed to do grid drawing, draw that now too (since it will be coupled with the color data)
-            // We're only allowed to draw the grid lines under certain circumstances.
-            if (_pData->IsGridLineDrawingAllowed())
+        // If we're allowed to do grid drawing, draw that now too (since it will be coupled with the color data)
+        // We're only allowed to draw the grid lines under certain circumstances.
+        if (_frame.gridLinesAllowed)
+        {
+            // See GH: 803
+            // If we found a wide character while we looped above, it's possible we skipped over the right half
+            // attribute that could have contained different line information than the left half.
+            if (run.containsWideCharacter)
             {
-                // See GH: 803
-                // If we found a wide character while we looped above, it's possible we skipped over the right half
-                // attribute that could have contained different line information than the left half.
-                if (containsWideCharacter)
+                // Start from the attributes of the original position in this run.
+                const std::span attrs{ line.attrs.data() + run.attrsBegin, run.attrsEnd - run.attrsBegin };
+                // Start from the original target in this run.
+                auto lineTarget = run.targetStart;
+
+                // We need to go through the iterators again to ensure we get the lines associated with each
+                // exact column. The code above will condense two-column characters into one, but it is possible
+                // (like with the IME) that the line drawing characters will vary from the left to right half
+                // of a wider character.
+                // We could theoretically pre-pass for this in the loop above to be more efficient about walking
+                // the iterator, but I fear it would make the code even more confusing than it already is.
+                // Do that in the future if some WPR trace points you to this spot as super bad.
+                for (const auto& attr : attrs)
                 {
-                    // Start from the original position in this run.
-                    auto lineIt = currentRunItStart;
-                    // Start from the original target in this run.
-                    auto lineTarget = currentRunTargetStart;
-
-                    // We need to go through the iterators again to ensure we get the lines associated with each
-                    // exact column. The code above will condense two-column characters into one, but it is possible
-                    // (like with the IME) that the line drawing characters will vary from the left to right half
-                    // of a wider character.
-                    // We could theoretically pre-pass for this in the loop above to be more efficient about walking
-                    // the iterator, but I fear it would make the code even more confusing than it already is.
-                    // Do that in the future if some WPR trace points you to this spot as super bad.
-                    for (til::CoordType colsPainted = 0; colsPainted < cols; ++colsPainted, ++lineIt, ++lineTarget.x)
-                    {
-                        auto lines = lineIt->TextAttr();
-                        _PaintBufferOutputGridLineHelper(pEngine, lines, 1, lineTarget);
-                    }
-                }
-                else
-                {
-                    // If nothing exciting is going on, draw the lines in bulk.
-                    _PaintBufferOutputGridLineHelper(pEngine, currentRunColor, cols, screenPoint);
+                    _PaintBufferOutputGridLineHelper(pEngine, attr, 1, lineTarget, run.inPattern);
+                    ++lineTarget.x;
                 }
             }
+            else
+            {
+                // If nothing exciting is going on, draw the lines in bulk.
+                _PaintBufferOutputGridLineHelper(pEngine, run.color, run.columns, run.target, run.inPattern);
+            }
         }
     }
 }
@@ -975,18 +1457,20 @@ GridLineSet Renderer::s_GetGridlines(const TextAttribute& textAttribute) noexcep
 // - textAttribute - The line/box drawing attributes to use for this particular run.
 // - cchLine - The length of both pwsLine and pbKAttrsLine.
 // - coordTarget - The X/Y coordinate position in the buffer which we're attempting to start rendering from.
+// - inPattern - Whether the run is part of a pattern, like a URL.
 // Return Value:
 // - <none>
 void Renderer::_PaintBufferOutputGridLineHelper(_In_ IRenderEngine* const pEngine,
                                                 const TextAttribute textAttribute,
                                                 const size_t cchLine,
-                                                const til::point coordTarget)
+                                                const til::point coordTarget,
+                                                const bool inPattern)
 {
     // Convert console grid line representations into rendering engine enum representations.
     auto lines = Renderer::s_GetGridlines(textAttribute);
 
     // For now, we dash underline patterns and switch to regular underline on hover
-    if (_isHoveredHyperlink(textAttribute) || _isInHoveredInterval(coordTarget))
+    if (_isHoveredHyperlink(textAttribute) || _isInHoveredInterval(coordTarget, inPattern))
     {
         lines.reset(GridLines::HyperlinkUnderline);
         lines.set(GridLines::Underline);
@@ -996,7 +1480,7 @@ void Renderer::_PaintBufferOutputGridLineHelper(_In_ IRenderEngine* const pEngin
     if (lines.any())
     {
         // Get the current foreground color to render the lines.
-        const auto rgb = _renderSettings.GetAttributeColors(textAttribute).first;
+        const auto rgb = _frame.renderSettings.GetAttributeColors(textAttribute).first;
         // Draw the lines
         LOG_IF_FAILED(pEngine->PaintBufferGridLines(lines, rgb, cchLine, coordTarget));
     }
@@ -1004,14 +1488,13 @@ void Renderer::_PaintBufferOutputGridLineHelper(_In_ IRenderEngine* const pEngin
 
 bool Renderer::_isHoveredHyperlink(const TextAttribute& textAttribute) const noexcept
 {
-    return _hyperlinkHoveredId && _hyperlinkHoveredId == textAttribute.GetHyperlinkId();
+    return _frame.hyperlinkHoveredId && _frame.hyperlinkHoveredId == textAttribute.GetHyperlinkId();
 }
 
-bool Renderer::_isInHoveredInterval(const til::point coordTarget) const noexcept
+bool Renderer::_isInHoveredInterval(const til::point coordTarget, const bool inPattern) const noexcept
 {
-    return _hoveredInterval &&
-           _hoveredInterval->start <= coordTarget && coordTarget <= _hoveredInterval->stop &&
-           _pData->GetPatternId(coordTarget).size() > 0;
+    const auto& interval = _frame.hoveredInterval;
+    return inPattern && interval && !(coordTarget < interval->start || interval->stop < coordTarget);
 }
 
 // Routine Description:
@@ -1086,10 +1569,9 @@ bool Renderer::_isInHoveredInterval(const til::point coordTarget) const noexcept
 // - <none>
 void Renderer::_PaintCursor(_In_ IRenderEngine* const pEngine)
 {
-    const auto cursorInfo = _GetCursorInfo();
-    if (cursorInfo.has_value())
+    if (_frame.cursor.has_value())
     {
-        LOG_IF_FAILED(pEngine->PaintCursor(cursorInfo.value()));
+        LOG_IF_FAILED(pEngine->PaintCursor(_frame.cursor.value()));
     }
 }
 
@@ -1111,6 +1593,23 @@ void Renderer::_PaintCursor(_In_ IRenderEngine* const pEngine)
     return pEngine->PrepareRenderInfo(info);
 }
 
+// Routine Description:
+// - Checks whether the engine has anything besides the cursor to repaint this frame.
+// Arguments:
+// - engine - The render engine that we're targeting.
+// Return Value:
+// - true if at least one of the engine's dirty rects is non-empty.
+bool Renderer::_HasDirtyArea(_In_ IRenderEngine* const pEngine) const noexcept
+{
+    std::span<const til::rect> dirtyAreas;
+    if (FAILED(pEngine->GetDirtyArea(dirtyAreas)))
+    {
+        // Err on the side of painting everything.
+        return true;
+    }
+    return std::any_of(dirtyAreas.begin(), dirtyAreas.end(), [](const til::rect& r) noexcept { return !r.empty(); });
+}
+
 // Routine Description:
 // - Paint helper to draw text that overlays the main buffer to provide user interactivity regions
 // - This supports IME composition.
@@ -1176,12 +1675,12 @@ void Renderer::_PaintOverlays(_In_ IRenderEngine* const pEngine)
 }
 
 // Routine Description:
-// - Paint helper to draw the selected area of the window.
+// - Collects the parts of the selected area of the window that need to be redrawn into _frame.selection.
 // Arguments:
 // - <none>
 // Return Value:
 // - <none>
-void Renderer::_PaintSelection(_In_ IRenderEngine* const pEngine)
+void Renderer::_PrepareSelection(_In_ IRenderEngine* const pEngine)
 {
     try
     {
@@ -1196,7 +1695,7 @@ void Renderer::_PaintSelection(_In_ IRenderEngine* const pEngine)
             {
                 if (const auto rectCopy = rect & dirtyRect)
                 {
-                    LOG_IF_FAILED(pEngine->PaintSelection(rectCopy));
+                    _frame.selection.emplace_back(rectCopy);
                 }
             }
         }
@@ -1204,6 +1703,20 @@ void Renderer::_PaintSelection(_In_ IRenderEngine* const pEngine)
     CATCH_LOG();
 }
 
+// Routine Description:
+// - Paint helper to draw the selected area of the window.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void Renderer::_PaintSelection(_In_ IRenderEngine* const pEngine)
+{
+    for (const auto& rect : _frame.selection)
+    {
+        LOG_IF_FAILED(pEngine->PaintSelection(rect));
+    }
+}
+
 // Routine Description:
 // - Helper to convert the text attributes to actual RGB colors and update the rendering pen/brush within the rendering engine before the next draw operation.
 // Arguments:
@@ -1223,7 +1736,7 @@ void Renderer::_PaintSelection(_In_ IRenderEngine* const pEngine)
 {
     // The last color needs to be each engine's responsibility. If it's local to this function,
     //      then on the next engine we might not update the color.
-    return pEngine->UpdateDrawingBrushes(textAttributes, _renderSettings, _pData, usingSoftFont, isSettingDefaultBrushes);
+    return pEngine->UpdateDrawingBrushes(textAttributes, _frame.renderSettings, _pData, usingSoftFont, isSettingDefaultBrushes);
 }
 
 // Routine Description:
@@ -1369,10 +1882,13 @@ void Renderer::ResetErrorStateAndResume()
 void Renderer::UpdateHyperlinkHoveredId(uint16_t id) noexcept
 {
     _hyperlinkHoveredId = id;
-    FOREACH_ENGINE(pEngine)
+    try
     {
-        pEngine->UpdateHyperlinkHoveredId(id);
+        _CallEngines([=](IRenderEngine* pEngine) {
+            pEngine->UpdateHyperlinkHoveredId(id);
+        });
     }
+    CATCH_LOG();
 }
 
 void Renderer::UpdateLastHoveredInterval(const std::optional<PointTree::interval>& newInterval)
@@ -80,6 +80,23 @@ namespace Microsoft::Console::Render
         void EnablePainting();
         void WaitForPaintCompletionAndDisable(const DWORD dwTimeoutMs);
         void WaitUntilCanRender();
+        void SetMinimumFrameInterval(const std::chrono::milliseconds interval) noexcept;
+        void SetIdleFlushTimeout(const std::chrono::milliseconds timeout) noexcept;
+        void ExpediteEcho(const std::chrono::milliseconds window) noexcept;
+        void SetOccluded(const bool occluded) noexcept;
+        void RequestDeviceResourceRelease() noexcept;
+
+        // All counters are cumulative since the Renderer was created.
+        struct FrameStatistics
+        {
+            uint64_t paintRequests = 0; // The number of NotifyPaintFrame() calls.
+            uint64_t framesPainted = 0; // The number of frames the primary engine presented.
+            uint64_t latencyMicroseconds = 0; // The sum over all frames of the time from the oldest paint request to Present() returning.
+            uint64_t echoFrames = 0; // The number of frames that presented output which arrived within the window of an ExpediteEcho() call.
+            uint64_t echoLatencyMicroseconds = 0; // The sum over all echoFrames of the time from ExpediteEcho() to Present() returning.
+        };
+        FrameStatistics GetFrameStatistics() const noexcept;
+        void ReleaseDeviceResources() noexcept;
 
         void AddRenderEngine(_In_ IRenderEngine* const pEngine);
         void RemoveRenderEngine(_In_ IRenderEngine* const pEngine);
@@ -93,26 +110,100 @@ namespace Microsoft::Console::Render
         void UpdateLastHoveredInterval(const std::optional<interval_tree::IntervalTree<til::point, size_t>::interval>& newInterval);
 
     private:
+        // A run of clusters within a BufferLine that's painted with the same brushes.
+        struct BufferLineRun
+        {
+            TextAttribute color;
+            bool usingSoftFont = false;
+            bool trimLeft = false;
+            bool containsWideCharacter = false;
+            // Whether the run is part of a pattern (e.g. a URL). See _isInHoveredInterval().
+            bool inPattern = false;
+            size_t clustersBegin = 0;
+            size_t clustersEnd = 0;
+            // If the run containsWideCharacter, BufferLine::attrs holds the attributes of its columns in this range.
+            size_t attrsBegin = 0;
+            size_t attrsEnd = 0;
+            til::CoordType columns = 0;
+            // Where PaintBufferLine() should paint the run. This is one column to the left
+            // of targetStart, if the run starts with the trailing half of a wide glyph.
+            til::point target;
+            // The first cell of the run in the buffer and its location on the screen.
+            til::point bufferStart;
+            til::point targetStart;
+        };
+
+        // A dirty line prepared for painting by _PrepareBufferLine().
+        struct BufferLine
+        {
+            Microsoft::Console::Types::Viewport bufferLine;
+            til::point screenPosition;
+            LineRendition lineRendition = LineRendition::SingleWidth;
+            bool lineWrapped = false;
+            std::vector<Cluster> clusters;
+            std::vector<BufferLineRun> runs;
+            // The clusters refer to this copy of the row's text, so that the line can be painted without
+            // holding the console lock. For the same reason the attributes and image are copied as well.
+            std::wstring text;
+            std::vector<TextAttribute> attrs;
+            ImageSlice::Pointer imageSlice;
+            // Scratch space for the pattern ids of the current run and the next cell.
+            std::vector<size_t> patternIds;
+            std::vector<size_t> nextPatternIds;
+            std::exception_ptr exception;
+        };
+
+        // Everything a frame is painted from, besides the engine's own state and _bufferLines. It's captured
+        // while holding the console lock. If the engine SupportsUnlockedPainting(), the lock is released
+        // after that and the rest of the frame is painted from here. See _PaintFrameForEngine().
+        struct FrameSnapshot
+        {
+            RenderSettings renderSettings;
+            Microsoft::Console::Types::Viewport viewport;
+            // The number of _bufferLines prepared for this frame.
+            size_t lineCount = 0;
+            // The selection rectangles, already intersected with the dirty area.
+            std::vector<til::rect> selection;
+            std::optional<CursorOptions> cursor;
+            std::wstring title;
+            uint16_t hyperlinkHoveredId = 0;
+            std::optional<interval_tree::IntervalTree<til::point, size_t>::interval> hoveredInterval;
+            bool gridLinesAllowed = false;
+            bool hasDirtyArea = false;
+            // Overlays are painted straight from the IRenderData,
+            // which requires holding onto the lock for the entire frame.
+            bool hasOverlays = false;
+        };
+
         static GridLineSet s_GetGridlines(const TextAttribute& textAttribute) noexcept;
         static bool s_IsSoftFontChar(const std::wstring_view& v, const size_t firstSoftFontChar, const size_t lastSoftFontChar);
 
         [[nodiscard]] HRESULT _PaintFrameForEngine(_In_ IRenderEngine* const pEngine) noexcept;
+        template<typename T>
+        void _CallEngines(T&& func);
+        void _FlushDeferredEngineCalls() noexcept;
+        void _CaptureFrame(_In_ IRenderEngine* const pEngine);
         bool _CheckViewportAndScroll();
         [[nodiscard]] HRESULT _PaintBackground(_In_ IRenderEngine* const pEngine);
+        void _PrepareBufferOutput(_In_ IRenderEngine* const pEngine);
         void _PaintBufferOutput(_In_ IRenderEngine* const pEngine);
-        void _PaintBufferOutputHelper(_In_ IRenderEngine* const pEngine, TextBufferCellIterator it, const til::point target, const bool lineWrapped);
-        void _PaintBufferOutputGridLineHelper(_In_ IRenderEngine* const pEngine, const TextAttribute textAttribute, const size_t cchLine, const til::point coordTarget);
+        void _PrepareBufferLine(const TextBuffer& buffer, BufferLine& line) const;
+        void _PaintBufferOutputHelper(_In_ IRenderEngine* const pEngine, const BufferLine& line);
+        void _PaintBufferOutputGridLineHelper(_In_ IRenderEngine* const pEngine, const TextAttribute textAttribute, const size_t cchLine, const til::point coordTarget, const bool inPattern);
         bool _isHoveredHyperlink(const TextAttribute& textAttribute) const noexcept;
+        void _PrepareSelection(_In_ IRenderEngine* const pEngine);
         void _PaintSelection(_In_ IRenderEngine* const pEngine);
         void _PaintCursor(_In_ IRenderEngine* const pEngine);
         void _PaintOverlays(_In_ IRenderEngine* const pEngine);
+        bool _HasDirtyArea(_In_ IRenderEngine* const pEngine) const noexcept;
         void _PaintOverlay(IRenderEngine& engine, const RenderOverlay& overlay);
         [[nodiscard]] HRESULT _UpdateDrawingBrushes(_In_ IRenderEngine* const pEngine, const TextAttribute attr, const bool usingSoftFont, const bool isSettingDefaultBrushes);
         [[nodiscard]] HRESULT _PerformScrolling(_In_ IRenderEngine* const pEngine);
         std::vector<til::rect> _GetSelectionRects() const;
+        static void _DiffSelectionRects(const std::vector<til::rect>& previous, const std::vector<til::rect>& current, std::vector<til::rect>& removed, std::vector<til::rect>& added);
         void _ScrollPreviousSelection(const til::point delta);
         [[nodiscard]] HRESULT _PaintTitle(IRenderEngine* const pEngine);
-        bool _isInHoveredInterval(til::point coordTarget) const noexcept;
+        bool _isInHoveredInterval(til::point coordTarget, const bool inPattern) const noexcept;
         [[nodiscard]] std::optional<CursorOptions> _GetCursorInfo();
         [[nodiscard]] HRESULT _PrepareRenderInfo(_In_ IRenderEngine* const pEngine);
 
@@ -125,12 +216,29 @@ namespace Microsoft::Console::Render
         uint16_t _hyperlinkHoveredId = 0;
         std::optional<interval_tree::IntervalTree<til::point, size_t>::interval> _hoveredInterval;
         Microsoft::Console::Types::Viewport _viewport;
-        std::vector<Cluster> _clusterBuffer;
+        // Reused between frames to avoid reallocating the cluster and run arrays. See _PaintBufferOutput().
+        std::vector<BufferLine> _bufferLines;
         std::vector<til::rect> _previousSelection;
+        FrameSnapshot _frame;
+        // Set while a frame is painted without holding the console lock. The engine calls made by the
+        // Trigger*() functions in the meantime are queued up in _deferredEngineCalls. See _CallEngines().
+        bool _deferEngineCalls = false;
+        std::vector<std::function<void(IRenderEngine*)>> _deferredEngineCalls;
         std::function<void()> _pfnBackgroundColorChanged;
         std::function<void()> _pfnFrameColorChanged;
         std::function<void()> _pfnRendererEnteredErrorState;
         bool _destructing = false;
+        std::atomic<uint64_t> _paintRequests{ 0 };
+        std::atomic<uint64_t> _framesPainted{ 0 };
+        std::atomic<uint64_t> _latencyMicroseconds{ 0 };
+        // The steady_clock time of the first paint request since the last presented frame, or 0 if there's none.
+        std::atomic<int64_t> _oldestPaintRequest{ 0 };
+        // The steady_clock time of the last ExpediteEcho() call whose echo wasn't presented yet and
+        // the end of its window, or 0 if there's none. Written by any thread, consumed by Present().
+        std::atomic<int64_t> _echoStart{ 0 };
+        std::atomic<int64_t> _echoDeadline{ 0 };
+        std::atomic<uint64_t> _echoFrames{ 0 };
+        std::atomic<uint64_t> _echoLatencyMicroseconds{ 0 };
         bool _forceUpdateViewport = false;
 
 #ifdef UNIT_TESTING
@@ -6,10 +6,71 @@
 
 #include "renderer.hpp"
 
+#include <condition_variable>
+
 #pragma hdrstop
 
 using namespace Microsoft::Console::Render;
 
+namespace
+{
+    // Every Renderer owns its own RenderThread, which keeps their frame pacing, their
+    // lifetime and the render thread ID that the Terminal relies on independent of each
+    // other. But with dozens of panes all of these threads would otherwise paint at
+    // the same time during an output flood, competing for the cores and the GPU queue
+    // with the pane the user is actually looking at.
+    //
+    // FrameSlots limits how many frames are painted concurrently across the whole process
+    // to the number of cores. Renderers without a frame rate limit (the focused ones) are
+    // admitted first, while throttled background renderers wait for them. Occluded renderers
+    // don't request frames at all, so they never compete for a slot in the first place.
+    class FrameSlots
+    {
+    public:
+        static FrameSlots& Instance()
+        {
+            static FrameSlots slots;
+            return slots;
+        }
+
+        void Acquire(const bool foreground)
+        {
+            std::unique_lock guard{ _lock };
+            if (foreground)
+            {
+                _foregroundWaiting++;
+                _changed.wait(guard, [&]() { return _available != 0; });
+                _foregroundWaiting--;
+            }
+            else
+            {
+                _changed.wait(guard, [&]() { return _available != 0 && _foregroundWaiting == 0; });
+            }
+            _available--;
+        }
+
+        void Release()
+        {
+            {
+                std::lock_guard guard{ _lock };
+                _available++;
+            }
+            _changed.notify_all();
+        }
+
+    private:
+        FrameSlots() :
+            _available{ std::max(1u, std::thread::hardware_concurrency()) }
+        {
+        }
+
+        std::mutex _lock;
+        std::condition_variable _changed;
+        unsigned int _available;
+        unsigned int _foregroundWaiting = 0;
+    };
+}
+
 RenderThread::RenderThread() :
     _pRenderer(nullptr),
     _hThread(nullptr),
@@ -17,6 +78,8 @@ RenderThread::RenderThread() :
     _hPaintCompletedEvent(nullptr),
     _fKeepRunning(true),
     _hPaintEnabledEvent(nullptr),
+    _hVisibleEvent(nullptr),
+    _hReleaseEvent(nullptr),
     _fNextFrameRequested(false),
     _fWaiting(false)
 {
@@ -28,6 +91,7 @@ RenderThread::~RenderThread()
     {
         _fKeepRunning = false; // stop loop after final run
         EnablePainting(); // if we want to get the last frame out, we need to make sure it's enabled
+        SetOccluded(false);
         SignalObjectAndWait(_hEvent, _hThread, INFINITE, FALSE); // signal final paint and wait for thread to finish.
 
         CloseHandle(_hThread);
@@ -51,6 +115,18 @@ RenderThread::~RenderThread()
         CloseHandle(_hPaintCompletedEvent);
         _hPaintCompletedEvent = nullptr;
     }
+
+    if (_hVisibleEvent)
+    {
+        CloseHandle(_hVisibleEvent);
+        _hVisibleEvent = nullptr;
+    }
+
+    if (_hReleaseEvent)
+    {
+        CloseHandle(_hReleaseEvent);
+        _hReleaseEvent = nullptr;
+    }
 }
 
 // Method Description:
@@ -120,6 +196,40 @@ RenderThread::~RenderThread()
         }
     }
 
+    if (SUCCEEDED(hr))
+    {
+        auto hVisibleEvent = CreateEventW(nullptr,
+                                          TRUE, // manual reset event
+                                          TRUE, // initially signaled
+                                          nullptr);
+
+        if (hVisibleEvent == nullptr)
+        {
+            hr = HRESULT_FROM_WIN32(GetLastError());
+        }
+        else
+        {
+            _hVisibleEvent = hVisibleEvent;
+        }
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        auto hReleaseEvent = CreateEventW(nullptr,
+                                          FALSE, // auto reset event
+                                          FALSE, // initially unsignaled
+                                          nullptr);
+
+        if (hReleaseEvent == nullptr)
+        {
+            hr = HRESULT_FROM_WIN32(GetLastError());
+        }
+        else
+        {
+            _hReleaseEvent = hReleaseEvent;
+        }
+    }
+
     if (SUCCEEDED(hr))
     {
         auto hThread = CreateThread(nullptr, // non-inheritable security attributes
@@ -170,6 +280,19 @@ DWORD WINAPI RenderThread::_ThreadProc()
     while (_fKeepRunning)
     {
         WaitForSingleObject(_hPaintEnabledEvent, INFINITE);
+        // While we're occluded, NotifyPaint() only sets _fNextFrameRequested. The engines keep accumulating
+        // the invalidated regions in the meantime, which get painted in a single frame once we're visible again.
+        // RequestDeviceResourceRelease() is served in the meantime, since it's meant for occluded controls.
+        const HANDLE gates[]{ _hVisibleEvent, _hReleaseEvent };
+        while (WaitForMultipleObjects(2, &gates[0], FALSE, INFINITE) == WAIT_OBJECT_0 + 1)
+        {
+            if (_fReleaseRequested.exchange(false, std::memory_order_relaxed))
+            {
+                _pRenderer->ReleaseDeviceResources();
+            }
+        }
+        // We're about to paint, which would create the resources again right away.
+        _fReleaseRequested.store(false, std::memory_order_relaxed);
 
         if (!_fNextFrameRequested.exchange(false, std::memory_order_acq_rel))
         {
@@ -183,8 +306,8 @@ DWORD WINAPI RenderThread::_ThreadProc()
             // check again now (see comment above)
             if (!_fNextFrameRequested.exchange(false, std::memory_order_acq_rel))
             {
-                // Wait until a next frame is requested.
-                WaitForSingleObject(_hEvent, INFINITE);
+                // Wait until a next frame is requested, or until a delayed frame is due.
+                WaitForSingleObject(_hEvent, _timeUntilDelayedPaint());
             }
 
             // <--
@@ -208,10 +331,37 @@ DWORD WINAPI RenderThread::_ThreadProc()
             ResetEvent(_hEvent);
         }
 
+        // Output that arrives while we're throttled is coalesced into the next frame,
+        // since PaintFrame() always draws the newest state of the buffer.
+        // The echo of a keystroke is painted right away though. See ExpediteFrames().
+        const auto expedited = std::chrono::steady_clock::now().time_since_epoch().count() < _expediteDeadline.load(std::memory_order_relaxed);
+        const std::chrono::milliseconds interval{ expedited ? 0 : _minimumFrameInterval.load(std::memory_order_relaxed) };
+        const std::chrono::milliseconds idleFlush{ expedited ? 0 : _idleFlushTimeout.load(std::memory_order_relaxed) };
+        if (idleFlush.count() > 0)
+        {
+            _waitForIdle(idleFlush, interval);
+        }
+        if (interval.count() > 0)
+        {
+            const auto elapsed = std::chrono::steady_clock::now() - _lastPaint;
+            if (elapsed < interval)
+            {
+                Sleep(gsl::narrow_cast<DWORD>(std::chrono::ceil<std::chrono::milliseconds>(interval - elapsed).count()));
+            }
+        }
+
         ResetEvent(_hPaintCompletedEvent);
 
+        _lastPaint = std::chrono::steady_clock::now();
+        // Any frame satisfies a pending NotifyPaintAfter().
+        _delayedPaintDeadline.store(0, std::memory_order_relaxed);
+        // Wait for the swap chain before taking a slot, so that no slot is held while
+        // we're idle. A renderer without a frame interval belongs to the focused control.
         _pRenderer->WaitUntilCanRender();
+        auto& slots = FrameSlots::Instance();
+        slots.Acquire(interval.count() == 0);
         LOG_IF_FAILED(_pRenderer->PaintFrame());
+        slots.Release();
 
         SetEvent(_hPaintCompletedEvent);
     }
@@ -231,6 +381,76 @@ void RenderThread::NotifyPaint() noexcept
     }
 }
 
+// Method Description:
+// - Like NotifyPaint(), but the frame is only painted once the delay has passed,
+//   unless something else requests a frame in the meantime. This allows engines
+//   with animated content to limit their frame rate without delaying text output.
+// - If multiple delayed frames are requested, the earliest one wins.
+// Arguments:
+// - delay: the time until the frame should be painted.
+void RenderThread::NotifyPaintAfter(const std::chrono::milliseconds delay) noexcept
+{
+    const auto deadline = (std::chrono::steady_clock::now() + delay).time_since_epoch().count();
+    auto expected = _delayedPaintDeadline.load(std::memory_order_relaxed);
+    while ((expected == 0 || deadline < expected) && !_delayedPaintDeadline.compare_exchange_weak(expected, deadline, std::memory_order_relaxed))
+    {
+    }
+}
+
+// Method Description:
+// - Returns how long _ThreadProc() may wait for NotifyPaint() until
+//   the frame requested by NotifyPaintAfter() is due, if any.
+DWORD RenderThread::_timeUntilDelayedPaint() const noexcept
+{
+    const auto deadline = _delayedPaintDeadline.load(std::memory_order_relaxed);
+    if (deadline == 0)
+    {
+        return INFINITE;
+    }
+
+    const auto remaining = std::chrono::steady_clock::duration{ deadline } - std::chrono::steady_clock::now().time_since_epoch();
+    return gsl::narrow_cast<DWORD>(std::max<std::chrono::milliseconds::rep>(0, std::chrono::ceil<std::chrono::milliseconds>(remaining).count()));
+}
+
+// Method Description:
+// - Waits until no frame was requested for the given timeout, so that a burst of
+//   output that arrives in several pieces is painted as a single frame.
+// - To bound the latency of an output flood that never pauses, this gives up after
+//   the minimum frame interval (or the timeout, if that's longer) has passed.
+// Arguments:
+// - timeout: how long NotifyPaint() must not have been called before we paint.
+// - interval: the current minimum frame interval.
+void RenderThread::_waitForIdle(const std::chrono::milliseconds timeout, const std::chrono::milliseconds interval) noexcept
+{
+    const auto deadline = std::chrono::steady_clock::now() + std::max(timeout, interval);
+
+    // While _fWaiting is set, NotifyPaint() signals _hEvent instead of setting
+    // _fNextFrameRequested, which lets us wait for the next request with a timeout.
+    _fWaiting.store(true, std::memory_order_release);
+
+    for (;;)
+    {
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= deadline)
+        {
+            break;
+        }
+
+        const auto remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline - now);
+        const auto wait = gsl::narrow_cast<DWORD>(std::min(timeout, remaining).count());
+        // A request that came in before _fWaiting was set counts just as much as one we were woken up for.
+        if (WaitForSingleObject(_hEvent, wait) != WAIT_OBJECT_0 && !_fNextFrameRequested.exchange(false, std::memory_order_acq_rel))
+        {
+            break;
+        }
+    }
+
+    _fWaiting.store(false, std::memory_order_release);
+    // Whatever was requested in the meantime is part of the frame we're about to paint.
+    ResetEvent(_hEvent);
+    _fNextFrameRequested.store(false, std::memory_order_relaxed);
+}
+
 void RenderThread::EnablePainting() noexcept
 {
     SetEvent(_hPaintEnabledEvent);
@@ -241,6 +461,73 @@ void RenderThread::DisablePainting() noexcept
     ResetEvent(_hPaintEnabledEvent);
 }
 
+// Method Description:
+// - Limits how often frames are painted, no matter how quickly NotifyPaint() is called.
+//   This allows background panes and hidden windows to skip the intermediate states
+//   of an output flood, instead of consuming CPU and GPU time for frames nobody looks at.
+// Arguments:
+// - interval: the minimum time between the start of two frames. 0 disables the limit.
+void RenderThread::SetMinimumFrameInterval(const std::chrono::milliseconds interval) noexcept
+{
+    _minimumFrameInterval.store(interval.count(), std::memory_order_relaxed);
+}
+
+// Method Description:
+// - Makes the render thread hold back a requested frame until no further frame was requested
+//   for the given timeout. This is meant for the VT renderer of ConPTY, whose every frame is
+//   a diff that's written to the pipe: output that's written in quick succession (like a shell
+//   prompt that's printed piece by piece) is consolidated into one diff instead of several.
+// Arguments:
+// - timeout: how long the output must be idle before a frame is painted. 0 disables the wait.
+void RenderThread::SetIdleFlushTimeout(const std::chrono::milliseconds timeout) noexcept
+{
+    _idleFlushTimeout.store(timeout.count(), std::memory_order_relaxed);
+}
+
+// Method Description:
+// - Makes the frames requested within the given duration skip the minimum frame interval and
+//   take precedence over other renderers for a frame slot. This is used after a keystroke
+//   was sent to the connection, so that its echo appears as soon as possible.
+// Arguments:
+// - duration: how long to expedite frames for, starting now.
+void RenderThread::ExpediteFrames(const std::chrono::milliseconds duration) noexcept
+{
+    _expediteDeadline.store((std::chrono::steady_clock::now() + duration).time_since_epoch().count(), std::memory_order_relaxed);
+}
+
+// Method Description:
+// - Suspends painting while nobody can see the output, for instance while the
+//   window is minimized, or while the control is in a background tab.
+// - Unlike DisablePainting(), this is independent of the renderer's error state.
+// Arguments:
+// - occluded: true to suspend painting, false to resume it.
+void RenderThread::SetOccluded(const bool occluded) noexcept
+{
+    if (occluded)
+    {
+        ResetEvent(_hVisibleEvent);
+    }
+    else
+    {
+        SetEvent(_hVisibleEvent);
+    }
+}
+
+// Method Description:
+// - Makes the render thread call Renderer::ReleaseDeviceResources() before it paints its next
+//   frame, or right away if it's occluded. Since the next frame recreates the resources,
+//   the request is dropped if the thread isn't occluded by the time it gets to it.
+void RenderThread::RequestDeviceResourceRelease() noexcept
+{
+    _fReleaseRequested.store(true, std::memory_order_relaxed);
+    SetEvent(_hReleaseEvent);
+}
+
+DWORD RenderThread::GetThreadId() const noexcept
+{
+    return _hThread ? ::GetThreadId(_hThread) : 0;
+}
+
 void RenderThread::WaitForPaintCompletionAndDisable(const DWORD dwTimeoutMs) noexcept
 {
     // When rendering takes place via DirectX, and a console application
@@ -27,18 +27,29 @@ namespace Microsoft::Console::Render
         [[nodiscard]] HRESULT Initialize(Renderer* const pRendererParent) noexcept;
 
         void NotifyPaint() noexcept;
+        void NotifyPaintAfter(const std::chrono::milliseconds delay) noexcept;
         void EnablePainting() noexcept;
         void DisablePainting() noexcept;
         void WaitForPaintCompletionAndDisable(const DWORD dwTimeoutMs) noexcept;
+        void SetMinimumFrameInterval(const std::chrono::milliseconds interval) noexcept;
+        void SetIdleFlushTimeout(const std::chrono::milliseconds timeout) noexcept;
+        void ExpediteFrames(const std::chrono::milliseconds duration) noexcept;
+        void SetOccluded(const bool occluded) noexcept;
+        void RequestDeviceResourceRelease() noexcept;
+        DWORD GetThreadId() const noexcept;
 
     private:
         static DWORD WINAPI s_ThreadProc(_In_ LPVOID lpParameter);
         DWORD WINAPI _ThreadProc();
+        DWORD _timeUntilDelayedPaint() const noexcept;
+        void _waitForIdle(const std::chrono::milliseconds timeout, const std::chrono::milliseconds interval) noexcept;
 
         HANDLE _hThread;
         HANDLE _hEvent;
 
         HANDLE _hPaintEnabledEvent;
+        HANDLE _hVisibleEvent;
+        HANDLE _hReleaseEvent;
         HANDLE _hPaintCompletedEvent;
 
         Renderer* _pRenderer; // Non-ownership pointer
@@ -46,5 +57,17 @@ namespace Microsoft::Console::Render
         bool _fKeepRunning;
         std::atomic<bool> _fNextFrameRequested;
         std::atomic<bool> _fWaiting;
+        std::atomic<bool> _fReleaseRequested{ false };
+
+        // See SetMinimumFrameInterval(). 0 means that frames are painted as fast as the engines allow.
+        std::atomic<std::chrono::milliseconds::rep> _minimumFrameInterval{ 0 };
+        std::chrono::steady_clock::time_point _lastPaint;
+        // See SetIdleFlushTimeout(). 0 means that frames are painted as soon as they're requested.
+        std::atomic<std::chrono::milliseconds::rep> _idleFlushTimeout{ 0 };
+        // See ExpediteFrames(). The steady_clock time until which frames skip the frame interval.
+        std::atomic<std::chrono::steady_clock::rep> _expediteDeadline{ 0 };
+
+        // See NotifyPaintAfter(). The steady_clock time at which the next frame is due, or 0 if none is.
+        std::atomic<std::chrono::steady_clock::rep> _delayedPaintDeadline{ 0 };
     };
 }
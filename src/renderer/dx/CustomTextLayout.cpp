@@ -12,6 +12,8 @@
 
 #include "BoxDrawingEffect.h"
 
+#include <til/hash.h>
+
 using namespace Microsoft::Console::Render;
 
 // Routine Description:
@@ -89,6 +91,82 @@ try
 }
 CATCH_RETURN()
 
+// Routine Description:
+// - Hashes everything the shaping results of this layout depend on:
+//   the text, the columns of its clusters and the font it is drawn with.
+// Arguments:
+// - <none> - Uses the text and font currently in use.
+// Return Value:
+// - The key of this layout in the layout cache.
+[[nodiscard]] size_t CustomTextLayout::_HashLayoutKey() const noexcept
+{
+    til::hasher h;
+    h.write(std::wstring_view{ _text });
+    h.write(static_cast<const void*>(_textClusterColumns.data()), _textClusterColumns.size() * sizeof(UINT16));
+    h.write(static_cast<const void*>(&_formatInUse), sizeof(_formatInUse));
+    h.write(static_cast<const void*>(&_fontInUse), sizeof(_fontInUse));
+    return h.finalize();
+}
+
+// Routine Description:
+// - Replaces the analysis and shaping results with the ones cached under the given key,
+//   provided they were computed for the very same text and font.
+// Arguments:
+// - key - The key returned by _HashLayoutKey.
+// Return Value:
+// - True if the cached results were restored and are ready to be drawn.
+[[nodiscard]] bool CustomTextLayout::_RestoreCachedLayout(const size_t key)
+{
+    const auto it = _layoutCache.find(key);
+    if (it == _layoutCache.end())
+    {
+        return false;
+    }
+
+    const auto& entry = it->second;
+    if (entry.format != _formatInUse || entry.font != _fontInUse || entry.text != _text || entry.textClusterColumns != _textClusterColumns)
+    {
+        return false;
+    }
+
+    // assign() keeps the capacity of our vectors around, just like Reset() does.
+    _isEntireTextSimple = entry.isEntireTextSimple;
+    _runs.assign(entry.runs.begin(), entry.runs.end());
+    _glyphOffsets.assign(entry.glyphOffsets.begin(), entry.glyphOffsets.end());
+    _glyphClusters.assign(entry.glyphClusters.begin(), entry.glyphClusters.end());
+    _glyphIndices.assign(entry.glyphIndices.begin(), entry.glyphIndices.end());
+    _glyphAdvances.assign(entry.glyphAdvances.begin(), entry.glyphAdvances.end());
+    return true;
+}
+
+// Routine Description:
+// - Stores the results of the analysis and shaping steps in the layout cache.
+// - The cache is simply flushed once it's full. Its working set is the visible
+//   rows of the viewport, which fit into it comfortably.
+// Arguments:
+// - key - The key returned by _HashLayoutKey.
+// Return Value:
+// - <none>
+void CustomTextLayout::_StoreCachedLayout(const size_t key)
+{
+    if (_layoutCache.size() >= _layoutCacheCapacity)
+    {
+        _layoutCache.clear();
+    }
+
+    auto& entry = _layoutCache[key];
+    entry.text = _text;
+    entry.textClusterColumns = _textClusterColumns;
+    entry.format = _formatInUse;
+    entry.font = _fontInUse;
+    entry.isEntireTextSimple = _isEntireTextSimple;
+    entry.runs = _runs;
+    entry.glyphOffsets = _glyphOffsets;
+    entry.glyphClusters = _glyphClusters;
+    entry.glyphIndices = _glyphIndices;
+    entry.glyphAdvances = _glyphAdvances;
+}
+
 // Routine Description:
 // - Figures out how many columns this layout should take. This will use the analyze step only.
 // Arguments:
@@ -162,14 +240,22 @@ try
     _formatInUse = _fontRenderData->TextFormatWithAttribute(weight, style, stretch).Get();
     _fontInUse = _fontRenderData->FontFaceWithAttribute(weight, style, stretch).Get();
 
-    RETURN_IF_FAILED(_AnalyzeTextComplexity());
-    RETURN_IF_FAILED(_AnalyzeRuns());
-    RETURN_IF_FAILED(_ShapeGlyphRuns());
-    RETURN_IF_FAILED(_CorrectGlyphRuns());
-    // Correcting box drawing has to come after both font fallback and
-    // the glyph run advance correction (which will apply a font size scaling factor).
-    // We need to know all the proposed X and Y dimension metrics to get this right.
-    RETURN_IF_FAILED(_CorrectBoxDrawing());
+    // Most rows are drawn with the exact same text and font as in the previous frame.
+    // Their shaping results don't change, so we can skip straight to drawing them.
+    const auto key = _HashLayoutKey();
+    if (!_RestoreCachedLayout(key))
+    {
+        RETURN_IF_FAILED(_AnalyzeTextComplexity());
+        RETURN_IF_FAILED(_AnalyzeRuns());
+        RETURN_IF_FAILED(_ShapeGlyphRuns());
+        RETURN_IF_FAILED(_CorrectGlyphRuns());
+        // Correcting box drawing has to come after both font fallback and
+        // the glyph run advance correction (which will apply a font size scaling factor).
+        // We need to know all the proposed X and Y dimension metrics to get this right.
+        RETURN_IF_FAILED(_CorrectBoxDrawing());
+
+        _StoreCachedLayout(key);
+    }
 
     RETURN_IF_FAILED(_DrawGlyphRuns(clientDrawingContext, renderer, { originX, originY }));
 
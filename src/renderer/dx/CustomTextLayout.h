@@ -148,6 +148,10 @@ namespace Microsoft::Console::Render
 
         [[nodiscard]] static constexpr UINT32 _EstimateGlyphCount(const UINT32 textLength) noexcept;
 
+        [[nodiscard]] size_t _HashLayoutKey() const noexcept;
+        [[nodiscard]] bool _RestoreCachedLayout(const size_t key);
+        void _StoreCachedLayout(const size_t key);
+
     private:
         // DirectWrite font render data
         DxFontRenderData* _fontRenderData;
@@ -206,6 +210,27 @@ namespace Microsoft::Console::Render
         // These are used to further break the runs apart and adjust the font size so glyphs fit inside the cells.
         std::vector<ScaleCorrection> _glyphScaleCorrections;
 
+        // The shaping results of recently drawn text, keyed by the text, its cluster columns and the font in use.
+        // Rows that didn't change between frames are drawn again straight from here without being re-analyzed.
+        // The layout is recreated whenever the font changes, which invalidates the cache along with it.
+        struct CachedLayout
+        {
+            std::wstring text;
+            std::vector<UINT16> textClusterColumns;
+            IDWriteTextFormat* format = nullptr;
+            IDWriteFontFace1* font = nullptr;
+
+            bool isEntireTextSimple = false;
+            std::vector<LinkedRun> runs;
+            std::vector<DWRITE_GLYPH_OFFSET> glyphOffsets;
+            std::vector<UINT16> glyphClusters;
+            std::vector<UINT16> glyphIndices;
+            std::vector<float> glyphAdvances;
+        };
+
+        static constexpr size_t _layoutCacheCapacity = 512;
+        std::unordered_map<size_t, CachedLayout> _layoutCache;
+
 #ifdef UNIT_TESTING
     public:
         CustomTextLayout() = default;
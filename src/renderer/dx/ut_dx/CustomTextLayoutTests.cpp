@@ -97,4 +97,52 @@ class Microsoft::Console::Render::CustomTextLayoutTests
         VERIFY_ARE_EQUAL(1u, layout._runs.at(1).glyphStart);
         VERIFY_ARE_EQUAL(3u, layout._runs.at(1).glyphCount);
     }
+
+    TEST_METHOD(LayoutCacheRestoresShapingResults)
+    {
+        CustomTextLayout layout;
+        layout._formatInUse = nullptr;
+        layout._fontInUse = nullptr;
+
+        layout._text = L"ab";
+        layout._textClusterColumns = { 1, 1 };
+        layout._isEntireTextSimple = true;
+        layout._glyphIndices = { 68, 69 };
+        layout._glyphClusters = { 0, 1 };
+        layout._glyphAdvances = { 8.0f, 8.0f };
+        layout._glyphOffsets.resize(2);
+
+        CustomTextLayout::LinkedRun run;
+        run.textLength = 2;
+        run.glyphCount = 2;
+        layout._runs.push_back(run);
+
+        const auto key = layout._HashLayoutKey();
+        layout._StoreCachedLayout(key);
+
+        // Drawing the same text again restores the results shaped before.
+        VERIFY_SUCCEEDED(layout.Reset());
+        layout._text = L"ab";
+        layout._textClusterColumns = { 1, 1 };
+        VERIFY_ARE_EQUAL(key, layout._HashLayoutKey());
+        VERIFY_IS_TRUE(layout._RestoreCachedLayout(key));
+        VERIFY_IS_TRUE(layout._isEntireTextSimple);
+        VERIFY_ARE_EQUAL(size_t{ 1 }, layout._runs.size());
+        VERIFY_ARE_EQUAL(2u, layout._runs.at(0).glyphCount);
+        VERIFY_ARE_EQUAL(size_t{ 2 }, layout._glyphIndices.size());
+        VERIFY_ARE_EQUAL(UINT16{ 69 }, layout._glyphIndices.at(1));
+        VERIFY_ARE_EQUAL(size_t{ 2 }, layout._glyphAdvances.size());
+
+        // Text that merely collides with the key must not be drawn from the cache.
+        VERIFY_SUCCEEDED(layout.Reset());
+        layout._text = L"ac";
+        layout._textClusterColumns = { 1, 1 };
+        VERIFY_IS_FALSE(layout._RestoreCachedLayout(key));
+        VERIFY_IS_FALSE(layout._RestoreCachedLayout(layout._HashLayoutKey()));
+
+        // The same text in another font isn't a match either.
+        layout._text = L"ab";
+        layout._fontInUse = reinterpret_cast<IDWriteFontFace1*>(&layout);
+        VERIFY_IS_FALSE(layout._RestoreCachedLayout(key));
+    }
 };
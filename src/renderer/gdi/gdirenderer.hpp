@@ -104,9 +104,16 @@ namespace Microsoft::Console::Render
         TEXTMETRICW _tmFontMetrics;
         FontResource _softFont;
 
-        static const size_t s_cPolyTextCache = 80;
-        POLYTEXTW _pPolyText[s_cPolyTextCache];
-        size_t _cPolyText;
+        // A line queued up by PaintBufferLine() for _FlushBufferLines(). The text and widths
+        // are stored at the same index in _polyStrings and _polyWidths respectively.
+        struct PolyTextRun
+        {
+            int x;
+            int y;
+            RECT rcl;
+            COLORREF foreground;
+            COLORREF background;
+        };
         [[nodiscard]] HRESULT _FlushBufferLines() noexcept;
 
         std::vector<RECT> cursorInvertRects;
@@ -136,8 +143,13 @@ namespace Microsoft::Console::Render
         til::rect _rcInvalid;
         bool _fInvalidRectUsed;
 
+        // The colors currently selected into _hdcMemoryContext.
         COLORREF _lastFg;
         COLORREF _lastBg;
+        // The colors requested by the last UpdateDrawingBrushes() call. Queued up lines
+        // are grouped by color, so they're only selected into the DC when flushing.
+        COLORREF _runFg;
+        COLORREF _runBg;
 
         enum class FontType : uint8_t
         {
@@ -158,6 +170,8 @@ namespace Microsoft::Console::Render
         std::pmr::unsynchronized_pool_resource _pool;
         std::pmr::vector<std::pmr::wstring> _polyStrings;
         std::pmr::vector<std::pmr::basic_string<int>> _polyWidths;
+        std::pmr::vector<PolyTextRun> _polyText;
+        std::pmr::vector<uint32_t> _polyTextOrder;
 
         [[nodiscard]] HRESULT _InvalidCombine(const til::rect* const prc) noexcept;
         [[nodiscard]] HRESULT _InvalidOffset(const til::point* const ppt) noexcept;
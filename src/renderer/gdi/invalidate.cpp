@@ -155,12 +155,24 @@ HRESULT GdiEngine::_InvalidOffset(const til::point* ppt) noexcept
         rcInvalidNew.top = _rcInvalid.top + ppt->y;
         rcInvalidNew.bottom = _rcInvalid.bottom + ppt->y;
 
-        // Add the scrolled invalid rectangle to what was left behind to get the new invalid area.
-        // This is the equivalent of adding in the "update rectangle" that we would get out of ScrollWindowEx/ScrollDC.
-        _rcInvalid |= rcInvalidNew;
+        // ScrollFrame() moves the memory surface and the window in sync, so the invalid pixels move
+        // along with the scroll. The area they leave behind receives pixels that were already valid.
+        // The only other area that needs painting is the newly exposed one, which ScrollFrame() adds
+        // from the update rectangle of ScrollDC. Keeping the area that was left behind as well
+        // would make the invalid rectangle span the entire window whenever the viewport is
+        // scrolled away from the dirty rows, for instance the cursor's.
+        _rcInvalid = rcInvalidNew;
 
         // Ensure invalid areas remain within bounds of window.
         RETURN_IF_FAILED(_InvalidRestrict());
+
+        // If the invalid area was scrolled out of the window entirely, there's nothing left to repaint.
+        // Otherwise the empty rectangle would still be combined with the newly exposed area.
+        if (_rcInvalid.empty())
+        {
+            _rcInvalid = {};
+            _fInvalidRectUsed = false;
+        }
     }
 
     return S_OK;
@@ -40,7 +40,9 @@ bool GdiEngine::FontHasWesternScript(HDC hdc)
     RETURN_HR_IF(S_FALSE, (!IsWindowVisible(_hwndTargetWindow) && !_titleChanged));
 
     // At the beginning of a new frame, we have 0 lines ready for painting in PolyTextOut
-    _cPolyText = 0;
+    _polyText.clear();
+    _polyStrings.clear();
+    _polyWidths.clear();
 
     // Prepare our in-memory bitmap for double-buffered composition.
     RETURN_IF_FAILED(_PrepareMemoryBitmap(_hwndTargetWindow));
@@ -306,7 +308,8 @@ bool GdiEngine::FontHasWesternScript(HDC hdc)
 
 // Routine Description:
 // - Draws one line of the buffer to the screen.
-// - This will now be cached in a PolyText buffer and flushed periodically instead of drawing every individual segment. Note this means that the PolyText buffer must be flushed before some operations (changing the brush color, drawing lines on top of the characters, inverting for cursor/selection, etc.)
+// - This will now be cached in a PolyText buffer and flushed periodically instead of drawing every individual segment. Note this means that the PolyText buffer must be flushed before some operations (changing the font or transform, drawing lines on top of the characters, inverting for cursor/selection, etc.)
+// - Changing the brush colors doesn't require a flush, because each buffered line remembers its colors.
 // Arguments:
 // - clusters - text to be written and columns expected per cluster
 // - coord - character coordinate target to render within viewport
@@ -336,8 +339,6 @@ bool GdiEngine::FontHasWesternScript(HDC hdc)
 
         const auto ptDraw = coord * _GetFontSize();
 
-        const auto pPolyTextLine = &_pPolyText[_cPolyText];
-
         auto& polyString = _polyStrings.emplace_back();
         polyString.reserve(cchLine);
 
@@ -411,27 +412,19 @@ bool GdiEngine::FontHasWesternScript(HDC hdc)
         const auto topOffset = _currentLineRendition == LineRendition::DoubleHeightBottom ? halfHeight : 0;
         const auto bottomOffset = _currentLineRendition == LineRendition::DoubleHeightTop ? halfHeight : 0;
 
-        pPolyTextLine->lpstr = polyString.data();
-        pPolyTextLine->n = gsl::narrow<UINT>(polyString.size());
-        pPolyTextLine->x = ptDraw.x;
-        pPolyTextLine->y = ptDraw.y;
-        pPolyTextLine->uiFlags = ETO_OPAQUE | ETO_CLIPPED;
-        pPolyTextLine->rcl.left = pPolyTextLine->x;
-        pPolyTextLine->rcl.top = pPolyTextLine->y + topOffset;
-        pPolyTextLine->rcl.right = pPolyTextLine->rcl.left + (til::CoordType)cchCharWidths;
-        pPolyTextLine->rcl.bottom = pPolyTextLine->y + coordFontSize.height - bottomOffset;
-        pPolyTextLine->pdx = polyWidth.data();
+        auto& polyTextLine = _polyText.emplace_back();
+        polyTextLine.x = ptDraw.x;
+        polyTextLine.y = ptDraw.y;
+        polyTextLine.rcl.left = polyTextLine.x;
+        polyTextLine.rcl.top = polyTextLine.y + topOffset;
+        polyTextLine.rcl.right = polyTextLine.rcl.left + (til::CoordType)cchCharWidths;
+        polyTextLine.rcl.bottom = polyTextLine.y + coordFontSize.height - bottomOffset;
+        polyTextLine.foreground = _runFg;
+        polyTextLine.background = _runBg;
 
         if (trimLeft)
         {
-            pPolyTextLine->rcl.left += coordFontSize.width;
-        }
-
-        _cPolyText++;
-
-        if (_cPolyText >= s_cPolyTextCache)
-        {
-            LOG_IF_FAILED(_FlushBufferLines());
+            polyTextLine.rcl.left += coordFontSize.width;
         }
 
         return S_OK;
@@ -441,6 +434,9 @@ bool GdiEngine::FontHasWesternScript(HDC hdc)
 
 // Routine Description:
 // - Flushes any buffer lines in the PolyTextOut cache by drawing them and freeing the strings.
+// - The lines are drawn grouped by their colors, so that SetTextColor/SetBkColor are only called
+//   once per color pair, instead of once per change in color. Since each line is clipped to its
+//   own cells (ETO_CLIPPED) and those don't overlap, the order they're drawn in doesn't matter.
 // - See also: PaintBufferLine
 // Arguments:
 // - <none>
@@ -450,11 +446,48 @@ bool GdiEngine::FontHasWesternScript(HDC hdc)
 {
     auto hr = S_OK;
 
-    if (_cPolyText > 0)
+    if (!_polyText.empty())
     {
-        for (size_t i = 0; i != _cPolyText; ++i)
+        _polyTextOrder.resize(_polyText.size());
+        std::iota(_polyTextOrder.begin(), _polyTextOrder.end(), 0u);
+        std::stable_sort(_polyTextOrder.begin(), _polyTextOrder.end(), [&](const uint32_t a, const uint32_t b) noexcept {
+            const auto& lhs = til::at(_polyText, a);
+            const auto& rhs = til::at(_polyText, b);
+            return std::tie(lhs.foreground, lhs.background) < std::tie(rhs.foreground, rhs.background);
+        });
+
+        for (const auto i : _polyTextOrder)
         {
-            const auto& t = _pPolyText[i];
+            const auto& run = til::at(_polyText, i);
+            const auto& text = til::at(_polyStrings, i);
+
+            if (run.foreground != _lastFg)
+            {
+                if (CLR_INVALID == SetTextColor(_hdcMemoryContext, run.foreground))
+                {
+                    hr = E_FAIL;
+                    break;
+                }
+                _lastFg = run.foreground;
+            }
+            if (run.background != _lastBg)
+            {
+                if (CLR_INVALID == SetBkColor(_hdcMemoryContext, run.background))
+                {
+                    hr = E_FAIL;
+                    break;
+                }
+                _lastBg = run.background;
+            }
+
+            POLYTEXTW t{};
+            t.x = run.x;
+            t.y = run.y;
+            t.n = gsl::narrow_cast<UINT>(text.size());
+            t.lpstr = text.data();
+            t.uiFlags = ETO_OPAQUE | ETO_CLIPPED;
+            t.rcl = run.rcl;
+            t.pdx = til::at(_polyWidths, i).data();
 
             // The following if/else replicates the essentials of how ExtTextOutW() without ETO_IGNORELANGUAGE works.
             // See InternalTextOut().
@@ -494,12 +527,9 @@ bool GdiEngine::FontHasWesternScript(HDC hdc)
             }
         }
 
+        _polyText.clear();
         _polyStrings.clear();
         _polyWidths.clear();
-
-        ZeroMemory(_pPolyText, sizeof(_pPolyText));
-
-        _cPolyText = 0;
     }
 
     RETURN_HR(hr);
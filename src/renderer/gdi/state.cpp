@@ -25,10 +25,11 @@ GdiEngine::GdiEngine() :
 #endif
     _iCurrentDpi(s_iBaseDpi),
     _hbitmapMemorySurface(nullptr),
-    _cPolyText(0),
     _fInvalidRectUsed(false),
     _lastFg(INVALID_COLOR),
     _lastBg(INVALID_COLOR),
+    _runFg(INVALID_COLOR),
+    _runBg(INVALID_COLOR),
     _lastFontType(FontType::Undefined),
     _currentLineTransform(IDENTITY_XFORM),
     _currentLineRendition(LineRendition::SingleWidth),
@@ -38,10 +39,10 @@ GdiEngine::GdiEngine() :
     _hfontItalic(nullptr),
     _pool{ til::pmr::get_default_resource() }, // It's important the pool is first so it can be given to the others on construction.
     _polyStrings{ &_pool },
-    _polyWidths{ &_pool }
+    _polyWidths{ &_pool },
+    _polyText{ &_pool },
+    _polyTextOrder{ &_pool }
 {
-    ZeroMemory(_pPolyText, sizeof(POLYTEXTW) * s_cPolyTextCache);
-
     _hdcMemoryContext = CreateCompatibleDC(nullptr);
     THROW_HR_IF_NULL(E_FAIL, _hdcMemoryContext);
 
@@ -76,14 +77,6 @@ GdiEngine::GdiEngine() :
 // - <none>
 GdiEngine::~GdiEngine()
 {
-    for (size_t iPoly = 0; iPoly < _cPolyText; iPoly++)
-    {
-        if (_pPolyText[iPoly].lpstr != nullptr)
-        {
-            delete[] _pPolyText[iPoly].lpstr;
-        }
-    }
-
     if (_hbitmapMemorySurface != nullptr)
     {
         LOG_HR_IF(E_FAIL, !(DeleteObject(_hbitmapMemorySurface)));
@@ -269,23 +262,13 @@ GdiEngine::~GdiEngine()
                                                       const bool usingSoftFont,
                                                       const bool isSettingDefaultBrushes) noexcept
 {
-    RETURN_IF_FAILED(_FlushBufferLines());
-
     RETURN_HR_IF_NULL(HRESULT_FROM_WIN32(ERROR_INVALID_STATE), _hdcMemoryContext);
 
-    // Set the colors for painting text
+    // Set the colors for painting text. They're only selected into the DC by _FlushBufferLines(),
+    // which allows it to batch up all lines of the same color, no matter the order they arrived in.
     const auto [colorForeground, colorBackground] = renderSettings.GetAttributeColors(textAttributes);
-
-    if (colorForeground != _lastFg)
-    {
-        RETURN_HR_IF(E_FAIL, CLR_INVALID == SetTextColor(_hdcMemoryContext, colorForeground));
-        _lastFg = colorForeground;
-    }
-    if (colorBackground != _lastBg)
-    {
-        RETURN_HR_IF(E_FAIL, CLR_INVALID == SetBkColor(_hdcMemoryContext, colorBackground));
-        _lastBg = colorBackground;
-    }
+    _runFg = colorForeground;
+    _runBg = colorBackground;
 
     if (isSettingDefaultBrushes)
     {
@@ -303,6 +286,9 @@ GdiEngine::~GdiEngine()
                                             FontType::Default;
     if (fontType != _lastFontType)
     {
+        // Flush any buffer lines which would be expecting to use the current font.
+        RETURN_IF_FAILED(_FlushBufferLines());
+
         switch (fontType)
         {
         case FontType::Soft:
@@ -21,6 +21,7 @@ Author(s):
 #include "FontInfoDesired.hpp"
 #include "IRenderData.hpp"
 #include "RenderSettings.hpp"
+#include "../../buffer/out/ImageSlice.hpp"
 #include "../../buffer/out/LineRendition.hpp"
 
 #pragma warning(push)
@@ -32,6 +33,29 @@ namespace Microsoft::Console::Render
         std::optional<CursorOptions> cursorInfo;
     };
 
+    // See IRenderEngine::GetMemoryUsage(). All sizes are in bytes.
+    struct RenderEngineMemoryUsage
+    {
+        // The retained, already shaped contents of the viewport.
+        size_t rowBytes = 0;
+        // Caches that merely speed up drawing the same text again.
+        size_t cacheBytes = 0;
+        // The glyph atlas texture, which may be shared with other engines.
+        size_t glyphAtlasBytes = 0;
+    };
+
+    // See IRenderEngine::GetDiagnostics(). All counters are cumulative since the engine was created.
+    struct RenderEngineDiagnostics
+    {
+        uint64_t dirtyRows = 0;
+        uint64_t shapingCacheHits = 0;
+        uint64_t shapingCacheMisses = 0;
+        uint64_t glyphLookups = 0;
+        uint64_t glyphCacheMisses = 0;
+        // The fraction of the glyph atlas in use, or a negative value if the engine has none.
+        float glyphAtlasOccupancy = -1.0f;
+    };
+
     enum class GridLines
     {
         None,
@@ -74,6 +98,7 @@ namespace Microsoft::Console::Render
         [[nodiscard]] virtual HRESULT PaintBackground() noexcept = 0;
         [[nodiscard]] virtual HRESULT PaintBufferLine(std::span<const Cluster> clusters, til::point coord, bool fTrimLeft, bool lineWrapped) noexcept = 0;
         [[nodiscard]] virtual HRESULT PaintBufferGridLines(GridLineSet lines, COLORREF color, size_t cchLine, til::point coordTarget) noexcept = 0;
+        [[nodiscard]] virtual HRESULT PaintImageSlice(const ImageSlice& imageSlice, til::CoordType targetRow, til::CoordType viewportLeft) noexcept = 0;
         [[nodiscard]] virtual HRESULT PaintSelection(const til::rect& rect) noexcept = 0;
         [[nodiscard]] virtual HRESULT PaintCursor(const CursorOptions& options) noexcept = 0;
         [[nodiscard]] virtual HRESULT UpdateDrawingBrushes(const TextAttribute& textAttributes, const RenderSettings& renderSettings, gsl::not_null<IRenderData*> pData, bool usingSoftFont, bool isSettingDefaultBrushes) noexcept = 0;
@@ -92,17 +117,31 @@ namespace Microsoft::Console::Render
 
         // DxRenderer - getter
         virtual HRESULT Enable() noexcept { return S_OK; }
+        [[nodiscard]] virtual std::chrono::milliseconds GetContinuousRedrawInterval() noexcept { return {}; }
         [[nodiscard]] virtual std::wstring_view GetPixelShaderPath() noexcept { return {}; }
         [[nodiscard]] virtual bool GetRetroTerminalEffect() const noexcept { return false; }
         [[nodiscard]] virtual float GetScaling() const noexcept { return 1; }
         [[nodiscard]] virtual Types::Viewport GetViewportInCharacters(const Types::Viewport& viewInPixels) const noexcept { return Types::Viewport::Empty(); }
         [[nodiscard]] virtual Types::Viewport GetViewportInPixels(const Types::Viewport& viewInCharacters) const noexcept { return Types::Viewport::Empty(); }
+        // If true, the Renderer releases the console lock after capturing the frame and makes the
+        // paint calls up to and including EndPaint() without it. The Renderer holds back its own
+        // Invalidate*() and Update*() calls until the frame is done, but the setters below and
+        // UpdateFont(), UpdateDpi(), GetProposedFont() and IsGlyphWideByFont() may still be called concurrently.
+        [[nodiscard]] virtual bool SupportsUnlockedPainting() const noexcept { return false; }
+        // GetMemoryUsage(), GetDiagnostics() and TrimMemory() must be called while holding the console lock.
+        // ReleaseDeviceResources() may only be called on the render thread. See Renderer::RequestDeviceResourceRelease().
+        [[nodiscard]] virtual RenderEngineMemoryUsage GetMemoryUsage() const noexcept { return {}; }
+        [[nodiscard]] virtual RenderEngineDiagnostics GetDiagnostics() const noexcept { return {}; }
+        virtual void TrimMemory() noexcept {}
+        virtual void ReleaseDeviceResources() noexcept {}
         // DxRenderer - setter
         virtual void SetAntialiasingMode(const D2D1_TEXT_ANTIALIAS_MODE antialiasingMode) noexcept {}
         virtual void SetCallback(std::function<void(HANDLE)> pfn) noexcept {}
         virtual void EnableTransparentBackground(const bool isTransparent) noexcept {}
         virtual void SetForceFullRepaintRendering(bool enable) noexcept {}
         [[nodiscard]] virtual HRESULT SetHwnd(const HWND hwnd) noexcept { return E_NOTIMPL; }
+        virtual void SetPixelShaderAnimationPaused(bool paused) noexcept {}
+        virtual void SetPixelShaderFrameInterval(std::chrono::milliseconds interval) noexcept {}
         virtual void SetPixelShaderPath(std::wstring_view value) noexcept {}
         virtual void SetRetroTerminalEffect(bool enable) noexcept {}
         virtual void SetSelectionBackground(const COLORREF color, const float alpha = 0.5f) noexcept {}
@@ -45,11 +45,24 @@ namespace Microsoft::Console::Render
         void ToggleBlinkRendition(class Renderer& renderer) noexcept;
 
     private:
+        // A direct-mapped cache of ColorFix::GetPerceivableColor results for arbitrary RGB colors.
+        // Entries with fg == bg are never looked up, so a zero-initialized entry is always a miss.
+        struct PerceivableColor
+        {
+            COLORREF fg;
+            COLORREF bg;
+            COLORREF adjusted;
+        };
+        static constexpr size_t PerceivableColorCacheSize = 512;
+
+        COLORREF _getPerceivableColor(const COLORREF fg, const COLORREF bg) const noexcept;
+
         til::enumset<Mode> _renderMode{ Mode::BlinkAllowed, Mode::IntenseIsBright };
         std::array<COLORREF, TextColor::TABLE_SIZE> _colorTable;
         std::array<size_t, static_cast<size_t>(ColorAlias::ENUM_COUNT)> _colorAliasIndices;
         std::array<std::array<COLORREF, 19>, 19> _adjustedForegroundColors;
         size_t _blinkCycle = 0;
+        mutable std::array<PerceivableColor, PerceivableColorCacheSize> _perceivableColors{};
         mutable bool _blinkIsInUse = false;
         bool _blinkShouldBeFaint = false;
     };
@@ -10,6 +10,10 @@
 using namespace Microsoft::Console::Render;
 using namespace Microsoft::Console::Types;
 
+// Assistive technology processes every event it gets, whereas changes may occur every frame.
+// Events are thus coalesced and dispatched at most once per interval. See Present().
+static constexpr auto DispatchInterval = std::chrono::milliseconds(100);
+
 // Routine Description:
 // - Constructs a UIA engine for console text
 //   which primarily notifies automation clients of any activity
@@ -136,8 +140,8 @@ CATCH_RETURN();
         CATCH_LOG_RETURN_HR(E_FAIL);
     }
 
-    // assume selection has not changed
-    _selectionChanged = false;
+    // The selection has not changed since the last call. We don't reset
+    // _selectionChanged though, because Present() may not have dispatched it yet.
     return S_OK;
 }
 
@@ -171,7 +175,9 @@ CATCH_RETURN();
 [[nodiscard]] HRESULT UiaEngine::NotifyNewText(const std::wstring_view newText) noexcept
 try
 {
-    if (!newText.empty())
+    // Disabled engines belong to controls that are unfocused or hidden.
+    // Their output is dropped instead of being queued up indefinitely.
+    if (_isEnabled && !newText.empty())
     {
         _newOutput.append(newText);
         _newOutput.push_back(L'\n');
@@ -203,7 +209,16 @@ CATCH_LOG_RETURN_HR(E_FAIL);
 // - S_OK if we started to paint. S_FALSE if we didn't need to paint.
 [[nodiscard]] HRESULT UiaEngine::StartPaint() noexcept
 {
-    RETURN_HR_IF(S_FALSE, !_isEnabled);
+    if (!_isEnabled)
+    {
+        // Drop any events that were pending when we got disabled. They're outdated by the time we get enabled again.
+        _selectionChanged = false;
+        _textBufferChanged = false;
+        _cursorChanged = false;
+        _newOutput.clear();
+        _queuedOutput.clear();
+        return S_FALSE;
+    }
 
     // add more events here
     const auto somethingToDo = _selectionChanged || _textBufferChanged || _cursorChanged || !_queuedOutput.empty();
@@ -229,12 +244,36 @@ CATCH_LOG_RETURN_HR(E_FAIL);
     // Snap this now while we're still under lock
     // so present can work on the copy while another
     // thread might start filling the next "frame"
-    // worth of text data.
-    std::swap(_queuedOutput, _newOutput);
+    // worth of text data. If Present() didn't get to
+    // notify about the previous frames yet, we append.
+    if (_queuedOutput.empty())
+    {
+        std::swap(_queuedOutput, _newOutput);
+    }
+    else
+    {
+        try
+        {
+            _queuedOutput.append(_newOutput);
+        }
+        CATCH_LOG();
+    }
     _newOutput.clear();
     return S_OK;
 }
 
+// Routine Description:
+// - Keeps the renderer painting while Present() holds back events,
+//   so that they're eventually dispatched even if nothing else changes.
+// Arguments:
+// - <none>
+// Return Value:
+// - True if there are pending events.
+[[nodiscard]] bool UiaEngine::RequiresContinuousRedraw() noexcept
+{
+    return _isEnabled && (_selectionChanged || _textBufferChanged || _cursorChanged || !_queuedOutput.empty());
+}
+
 // RenderEngineBase defines a WaitUntilCanRender() that sleeps for 8ms to throttle rendering.
 // But UiaEngine is never the only engine running. Overriding this function prevents
 // us from sleeping 16ms per frame, when the other engine also sleeps for 8ms.
@@ -254,6 +293,18 @@ void UiaEngine::WaitUntilCanRender() noexcept
 {
     RETURN_HR_IF(S_FALSE, !_isEnabled);
 
+    _isPainting = false;
+
+    // Events are batched up across frames until the interval has passed, which merges repeated events into one.
+    // This ensures that slow automation clients can't drive up our frame time, because the dispatch
+    // is synchronous. RequiresContinuousRedraw() ensures that we'll get called again in the meantime.
+    const auto now = std::chrono::steady_clock::now();
+    if (now - _lastDispatch < DispatchInterval)
+    {
+        return S_OK;
+    }
+    _lastDispatch = now;
+
     // Fire UIA Events here
     if (_selectionChanged)
     {
@@ -296,7 +347,6 @@ void UiaEngine::WaitUntilCanRender() noexcept
     _selectionChanged = false;
     _textBufferChanged = false;
     _cursorChanged = false;
-    _isPainting = false;
     _queuedOutput.clear();
 
     return S_OK;
@@ -36,6 +36,7 @@ namespace Microsoft::Console::Render
         // IRenderEngine Members
         [[nodiscard]] HRESULT StartPaint() noexcept override;
         [[nodiscard]] HRESULT EndPaint() noexcept override;
+        [[nodiscard]] bool RequiresContinuousRedraw() noexcept override;
         void WaitUntilCanRender() noexcept override;
         [[nodiscard]] HRESULT Present() noexcept override;
         [[nodiscard]] HRESULT PrepareForTeardown(_Out_ bool* const pForcePaint) noexcept override;
@@ -72,6 +73,8 @@ namespace Microsoft::Console::Render
         bool _cursorChanged;
         std::wstring _newOutput;
         std::wstring _queuedOutput;
+        // Events are dispatched at most once per interval. See Present().
+        std::chrono::steady_clock::time_point _lastDispatch{};
 
         Microsoft::Console::Types::IUiaEventDispatcher* _dispatcher;
 
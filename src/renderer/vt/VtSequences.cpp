@@ -86,6 +86,17 @@ using namespace Microsoft::Console::Render;
     return _WriteFormatted(FMT_COMPILE("\x1b[{}X"), chars);
 }
 
+// Method Description:
+// - Formats and writes a sequence to repeat the last printed character (REP).
+// Arguments:
+// - count: how many more times to print the character.
+// Return Value:
+// - S_OK if we succeeded, else an appropriate HRESULT for failing to allocate or write.
+[[nodiscard]] HRESULT VtEngine::_RepeatCharacter(const size_t count) noexcept
+{
+    return _WriteFormatted(FMT_COMPILE("\x1b[{}b"), count);
+}
+
 // Method Description:
 // - Moves the cursor forward (right) a number of characters.
 // Arguments:
@@ -434,6 +445,19 @@ using namespace Microsoft::Console::Render;
     return _Write("\x1b[?9001h");
 }
 
+// Method Description:
+// - Send a sequence to the connected terminal to offer it binary input records
+//   as a more compact alternative to win32-input-mode. See ConptyBinaryInput.hpp.
+//   Terminals that don't know this mode will just ignore it.
+// Arguments:
+// - <none>
+// Return Value:
+// - S_OK if we succeeded, else an appropriate HRESULT for failing to allocate or write.
+[[nodiscard]] HRESULT VtEngine::_RequestBinaryInput() noexcept
+{
+    return _Write("\x1b[?9002h");
+}
+
 [[nodiscard]] HRESULT VtEngine::_RequestFocusEventMode() noexcept
 {
     return _Write("\x1b[?1004h");
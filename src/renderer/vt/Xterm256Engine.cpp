@@ -34,6 +34,50 @@ Xterm256Engine::Xterm256Engine(_In_ wil::unique_hfile hPipe,
 {
     RETURN_HR_IF(S_FALSE, _passthrough && isSettingDefaultBrushes);
 
+    _shadowTextAttributes = textAttributes;
+    _shadowSoftFont = usingSoftFont;
+
+    // In shadow buffer mode the text that follows may already be shown by the terminal,
+    // in which case we won't write it and don't need to change the attributes either.
+    if (_shadowBufferMode && !isSettingDefaultBrushes)
+    {
+        _pendingRenderData = pData;
+        return S_OK;
+    }
+
+    _pendingRenderData = nullptr;
+    return _ApplyDrawingBrushes(textAttributes, pData, usingSoftFont, isSettingDefaultBrushes);
+}
+
+// Routine Description:
+// - Emits the attributes that UpdateDrawingBrushes() deferred in shadow buffer mode.
+// Arguments:
+// - <none>
+// Return Value:
+// - S_OK if we succeeded, else an appropriate HRESULT for failing to allocate or write.
+[[nodiscard]] HRESULT Xterm256Engine::_FlushPendingBrushes() noexcept
+{
+    if (!_pendingRenderData)
+    {
+        return S_OK;
+    }
+
+    const gsl::not_null<IRenderData*> pData{ _pendingRenderData };
+    _pendingRenderData = nullptr;
+    return _ApplyDrawingBrushes(_shadowTextAttributes, pData, _shadowSoftFont, false);
+}
+
+// Routine Description:
+// - Writes the VT sequences for UpdateDrawingBrushes().
+// Arguments:
+// - See UpdateDrawingBrushes().
+// Return Value:
+// - S_OK if we succeeded, else an appropriate HRESULT for failing to allocate or write.
+[[nodiscard]] HRESULT Xterm256Engine::_ApplyDrawingBrushes(const TextAttribute& textAttributes,
+                                                           const gsl::not_null<IRenderData*> pData,
+                                                           const bool usingSoftFont,
+                                                           const bool isSettingDefaultBrushes) noexcept
+{
     RETURN_IF_FAILED(VtEngine::_RgbUpdateDrawingBrushes(textAttributes));
 
     RETURN_IF_FAILED(_UpdateHyperlinkAttr(textAttributes, pData));
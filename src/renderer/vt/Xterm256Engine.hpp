@@ -40,11 +40,21 @@ namespace Microsoft::Console::Render
 
         friend class ::VtApiRoutines;
 
+    protected:
+        [[nodiscard]] HRESULT _FlushPendingBrushes() noexcept override;
+
     private:
+        [[nodiscard]] HRESULT _ApplyDrawingBrushes(const TextAttribute& textAttributes,
+                                                   const gsl::not_null<IRenderData*> pData,
+                                                   const bool usingSoftFont,
+                                                   const bool isSettingDefaultBrushes) noexcept;
         [[nodiscard]] HRESULT _UpdateExtendedAttrs(const TextAttribute& textAttributes) noexcept;
         [[nodiscard]] HRESULT _UpdateHyperlinkAttr(const TextAttribute& textAttributes,
                                                    const gsl::not_null<IRenderData*> pData) noexcept;
 
+        // Set while UpdateDrawingBrushes() has deferred emitting _shadowTextAttributes.
+        IRenderData* _pendingRenderData{ nullptr };
+
 #ifdef UNIT_TESTING
         friend class VtRendererTest;
         friend class ConptyOutputTests;
@@ -37,6 +37,15 @@ XtermEngine::XtermEngine(_In_ wil::unique_hfile hPipe,
 //      the pipe.
 [[nodiscard]] HRESULT XtermEngine::StartPaint() noexcept
 {
+    // If the terminal hasn't caught up with our previous output yet, skip this frame.
+    // The invalid regions keep accumulating, so the next frame sends the latest state.
+    // When we're about to circle the buffer, we mustn't skip it, or the
+    // rows that scroll out of the buffer never reach the terminal.
+    if (!_circled && _IsOutputBacklogged())
+    {
+        return S_FALSE;
+    }
+
     RETURN_IF_FAILED(VtEngine::StartPaint());
 
     _trace.TraceLastText(_lastText);
@@ -64,6 +73,7 @@ XtermEngine::XtermEngine(_In_ wil::unique_hfile hPipe,
         //      the screen on the first paint, just to make sure that the
         //      terminal's state is consistent with what we'll be rendering.
         RETURN_IF_FAILED(_ClearScreen());
+        _InvalidateShadowBuffer();
         _clearedAllThisFrame = true;
         _firstPaint = false;
     }
@@ -150,6 +160,8 @@ XtermEngine::XtermEngine(_In_ wil::unique_hfile hPipe,
                                                         const bool /*usingSoftFont*/,
                                                         const bool /*isSettingDefaultBrushes*/) noexcept
 {
+    _shadowTextAttributes = textAttributes;
+
     // The base xterm mode only knows about 16 colors
     RETURN_IF_FAILED(VtEngine::_16ColorUpdateDrawingBrushes(textAttributes));
 
@@ -397,6 +409,7 @@ try
         RETURN_IF_FAILED(_MoveCursor({ 0, 0 }));
         RETURN_IF_FAILED(_InsertLine(absDy));
     }
+    _ScrollShadowBuffer(dy);
 
     // Restore our wrap state.
     _wrappedRow = oldWrappedRow;
@@ -509,9 +522,36 @@ CATCH_RETURN();
                                                    const bool /*trimLeft*/,
                                                    const bool lineWrapped) noexcept
 {
-    return _fUseAsciiOnly ?
-               VtEngine::_PaintAsciiBufferLine(clusters, coord) :
-               VtEngine::_PaintUtf8BufferLine(clusters, coord, lineWrapped);
+    if (_fUseAsciiOnly)
+    {
+        return VtEngine::_PaintAsciiBufferLine(clusters, coord);
+    }
+
+    auto remaining = clusters;
+    auto target = coord;
+
+    // In shadow buffer mode we skip the leading clusters that the terminal already shows.
+    // We don't do this for wrapped lines or for the line after one, since only
+    // writing the whole line again preserves the wrap state in the terminal.
+    // A partial skip has to save more than the cursor movement it costs.
+    const auto previousLineWrapped = _wrappedRow.has_value() && coord.x == 0 && coord.y == _wrappedRow.value() + 1;
+    if (_shadowBufferMode && !_usingLineRenditions && !lineWrapped && !previousLineWrapped)
+    {
+        til::CoordType columns = 0;
+        const auto unchanged = _CountUnchangedClusters(clusters, coord, columns);
+        if (unchanged == clusters.size())
+        {
+            return S_OK;
+        }
+        if (columns > gsl::narrow_cast<til::CoordType>(ERASE_CHARACTER_STRING_LENGTH))
+        {
+            remaining = clusters.subspan(unchanged);
+            target.x += columns;
+        }
+    }
+
+    RETURN_IF_FAILED(_FlushPendingBrushes());
+    return VtEngine::_PaintUtf8BufferLine(remaining, target, lineWrapped);
 }
 
 // Method Description:
@@ -526,6 +566,8 @@ CATCH_RETURN();
     RETURN_IF_FAILED(_fUseAsciiOnly ?
                          VtEngine::_WriteTerminalAscii(wstr) :
                          VtEngine::_WriteTerminalUtf8(wstr));
+    // We can't tell what this string did to the terminal's contents.
+    _InvalidateShadowBuffer();
     // GH#4106, GH#2011 - WriteTerminalW is only ever called by the
     // StateMachine, when we've encountered a string we don't understand. When
     // this happens, we usually don't actually trigger another frame, but we
@@ -7,6 +7,8 @@
 #include "../../inc/conattrs.hpp"
 #include "../../types/inc/convert.hpp"
 
+#include <til/hash.h>
+
 #pragma hdrstop
 using namespace Microsoft::Console::Render;
 using namespace Microsoft::Console::Types;
@@ -542,11 +544,30 @@ using namespace Microsoft::Console::Types;
     {
         RETURN_IF_FAILED(VtEngine::_WriteTerminalDrcs({ _bufferLine.data(), cchActual }));
     }
+    else if (_repeatCharacter)
+    {
+        RETURN_IF_FAILED(VtEngine::_WriteTerminalUtf8Repeated(clusters, cchActual));
+    }
     else
     {
         RETURN_IF_FAILED(VtEngine::_WriteTerminalUtf8({ _bufferLine.data(), cchActual }));
     }
 
+    // Remember what the terminal displays now. The trailing spaces that we
+    // erase or skip below might not match the attributes of this run.
+    if (_shadowBufferMode)
+    {
+        if (_usingLineRenditions)
+        {
+            _InvalidateShadowCells({ 0, coord.y }, _lastViewport.Width());
+        }
+        else
+        {
+            _UpdateShadowCells(clusters, coord, columnsActual);
+            _InvalidateShadowCells({ coord.x + columnsActual, coord.y }, totalWidth - columnsActual);
+        }
+    }
+
     // GH#4415, GH#5181
     // If the renderer told us that this was a wrapped line, then mark
     // that we've wrapped this line. The next time we attempt to move the
@@ -655,3 +676,190 @@ using namespace Microsoft::Console::Types;
 {
     return S_OK;
 }
+
+// Routine Description:
+// - Emits the attributes that UpdateDrawingBrushes() may have deferred in
+//      shadow buffer mode, right before text is written with them.
+// Arguments:
+// - <none>
+// Return Value:
+// - S_OK if we succeeded, else an appropriate HRESULT for failing to allocate or write.
+[[nodiscard]] HRESULT VtEngine::_FlushPendingBrushes() noexcept
+{
+    return S_OK;
+}
+
+// Routine Description:
+// - Returns the shadow buffer cells of the given viewport row, after making sure
+//      that the shadow buffer matches the size of the viewport.
+// Arguments:
+// - row - the row within the viewport
+// Return Value:
+// - The cells of the row or an empty span if the row is outside the viewport.
+std::span<size_t> VtEngine::_GetShadowRow(const til::CoordType row) noexcept
+{
+    const auto width = gsl::narrow_cast<size_t>(_lastViewport.Width());
+    const auto height = gsl::narrow_cast<size_t>(_lastViewport.Height());
+
+    if (_shadowBuffer.size() != width * height)
+    {
+        try
+        {
+            _shadowBuffer.assign(width * height, 0);
+        }
+        catch (...)
+        {
+            LOG_CAUGHT_EXCEPTION();
+            _shadowBuffer.clear();
+            return {};
+        }
+    }
+
+    if (row < 0 || gsl::narrow_cast<size_t>(row) >= height)
+    {
+        return {};
+    }
+
+    return std::span{ _shadowBuffer }.subspan(gsl::narrow_cast<size_t>(row) * width, width);
+}
+
+// Routine Description:
+// - Forgets everything we know about the contents of the terminal.
+void VtEngine::_InvalidateShadowBuffer() noexcept
+{
+    std::fill(_shadowBuffer.begin(), _shadowBuffer.end(), size_t{ 0 });
+}
+
+// Routine Description:
+// - Forgets what we know about the given cells of a row.
+// Arguments:
+// - coord - the first cell
+// - count - the number of cells. May extend past the end of the row.
+void VtEngine::_InvalidateShadowCells(const til::point coord, const til::CoordType count) noexcept
+{
+    const auto row = _GetShadowRow(coord.y);
+    const auto width = gsl::narrow_cast<til::CoordType>(row.size());
+    const auto begin = std::clamp(coord.x, 0, width);
+    const auto end = std::clamp(coord.x + std::max(count, 0), begin, width);
+    std::fill(row.begin() + begin, row.begin() + end, size_t{ 0 });
+}
+
+// Routine Description:
+// - Shifts the shadow buffer in the same way that ScrollFrame() scrolled the
+//      terminal. The rows that it scrolled in are blank, but we don't know
+//      their attributes, so we mark them as unknown.
+// Arguments:
+// - delta - the number of rows the contents moved down (or up, if negative).
+void VtEngine::_ScrollShadowBuffer(const til::CoordType delta) noexcept
+{
+    // Make sure the buffer has the size of the viewport.
+    std::ignore = _GetShadowRow(0);
+
+    const auto width = gsl::narrow_cast<size_t>(_lastViewport.Width());
+    const auto count = std::min(gsl::narrow_cast<size_t>(std::abs(delta)) * width, _shadowBuffer.size());
+    if (delta < 0)
+    {
+        std::move(_shadowBuffer.begin() + count, _shadowBuffer.end(), _shadowBuffer.begin());
+        std::fill(_shadowBuffer.end() - count, _shadowBuffer.end(), size_t{ 0 });
+    }
+    else if (delta > 0)
+    {
+        std::move_backward(_shadowBuffer.begin(), _shadowBuffer.end() - count, _shadowBuffer.end());
+        std::fill(_shadowBuffer.begin(), _shadowBuffer.begin() + count, size_t{ 0 });
+    }
+}
+
+// Routine Description:
+// - Hashes the given cluster together with the attributes it's painted with.
+//      The hash of the n-th column of the cluster is the returned value + 2 * n.
+//      The hash is always odd, so that it's never 0, which means "unknown".
+// Arguments:
+// - cluster - the cluster to hash
+// Return Value:
+// - The hash of the first column of the cluster.
+size_t VtEngine::_HashCluster(const Cluster& cluster) const noexcept
+{
+    til::hasher h;
+    h.write(cluster.GetText());
+    h.write(static_cast<const void*>(&_shadowTextAttributes), sizeof(_shadowTextAttributes));
+    h.write(static_cast<const void*>(&_shadowSoftFont), sizeof(_shadowSoftFont));
+    return h.finalize() | 1;
+}
+
+// Routine Description:
+// - Counts how many of the leading clusters the terminal already displays
+//      at the given position with the current attributes.
+// Arguments:
+// - clusters - the clusters that are about to be painted
+// - coord - the position of the first cluster
+// - columns - receives the number of columns the unchanged clusters cover
+// Return Value:
+// - The number of unchanged clusters.
+size_t VtEngine::_CountUnchangedClusters(const std::span<const Cluster> clusters, const til::point coord, til::CoordType& columns) noexcept
+{
+    const auto row = _GetShadowRow(coord.y);
+    const auto width = gsl::narrow_cast<til::CoordType>(row.size());
+    auto x = coord.x;
+    size_t count = 0;
+
+    columns = 0;
+    if (x < 0)
+    {
+        return 0;
+    }
+
+    for (const auto& cluster : clusters)
+    {
+        const auto clusterColumns = cluster.GetColumns();
+        if (clusterColumns <= 0 || x + clusterColumns > width)
+        {
+            break;
+        }
+
+        const auto hash = _HashCluster(cluster);
+        for (til::CoordType i = 0; i < clusterColumns; ++i)
+        {
+            if (til::at(row, x + i) != hash + gsl::narrow_cast<size_t>(i) * 2)
+            {
+                return count;
+            }
+        }
+
+        x += clusterColumns;
+        columns += clusterColumns;
+        ++count;
+    }
+
+    return count;
+}
+
+// Routine Description:
+// - Records that the terminal now displays the given clusters.
+// Arguments:
+// - clusters - the clusters that were painted
+// - coord - the position of the first cluster
+// - columns - the number of columns that were actually written
+void VtEngine::_UpdateShadowCells(const std::span<const Cluster> clusters, const til::point coord, const til::CoordType columns) noexcept
+{
+    const auto row = _GetShadowRow(coord.y);
+    const auto width = gsl::narrow_cast<til::CoordType>(row.size());
+    const auto end = std::min(coord.x + columns, width);
+    auto x = coord.x;
+
+    for (const auto& cluster : clusters)
+    {
+        if (x >= end)
+        {
+            break;
+        }
+
+        const auto hash = _HashCluster(cluster);
+        for (til::CoordType i = 0; i < cluster.GetColumns() && x < end; ++i, ++x)
+        {
+            if (x >= 0)
+            {
+                til::at(row, x) = hash + gsl::narrow_cast<size_t>(i) * 2;
+            }
+        }
+    }
+}
@@ -108,6 +108,12 @@ CATCH_RETURN();
 // - S_OK or suitable HRESULT error from writing pipe.
 [[nodiscard]] HRESULT VtEngine::_Write(std::string_view const str) noexcept
 {
+    // The terminal has already seen whatever causes output while we synchronize the buffer.
+    if (_synchronizingBuffer)
+    {
+        return S_OK;
+    }
+
     _trace.TraceString(str);
 #ifdef UNIT_TESTING
     if (_usingTestCallback)
@@ -136,31 +142,144 @@ CATCH_RETURN();
     CATCH_RETURN();
 }
 
+VtEngine::~VtEngine()
+{
+    // Give the writer a chance to send the remaining output.
+    _StopWriter();
+}
+
+// Routine Description:
+// - Queues the contents of _buffer to be written to the pipe by _WriterThread().
+//      If one of the previous writes failed, this closes the pipe instead.
+// Arguments:
+// - <none>
+// Return Value:
+// - S_OK or suitable HRESULT error from writing pipe.
 [[nodiscard]] HRESULT VtEngine::_Flush() noexcept
 {
-    if (_hFile)
+    if (!_hFile)
+    {
+        return S_OK;
+    }
+
+    if (const auto hr = _writerResult.load(std::memory_order_relaxed); FAILED(hr))
     {
-        auto fSuccess = !!WriteFile(_hFile.get(), _buffer.data(), gsl::narrow_cast<DWORD>(_buffer.size()), nullptr, nullptr);
+        _StopWriter();
         _buffer.clear();
-        if (!fSuccess)
+        _exitResult = hr;
+        _hFile.reset();
+        if (_terminalOwner)
+        {
+            _terminalOwner->CloseOutput();
+        }
+        return _exitResult;
+    }
+
+    if (_buffer.empty())
+    {
+        return S_OK;
+    }
+
+    try
+    {
+        if (!_writer.joinable())
         {
-            _exitResult = HRESULT_FROM_WIN32(GetLastError());
-            _hFile.reset();
-            if (_terminalOwner)
+            _writer = std::thread{ [this]() noexcept { _WriterThread(); } };
+        }
+
+        {
+            const std::lock_guard lock{ _writerMutex };
+            if (_writerQueue.empty())
+            {
+                _writerQueue.swap(_buffer);
+            }
+            else
             {
-                _terminalOwner->CloseOutput();
+                _writerQueue.append(_buffer);
             }
-            return _exitResult;
         }
+
+        _writerCV.notify_one();
+        _buffer.clear();
+        return S_OK;
     }
+    CATCH_RETURN();
+}
 
-    return S_OK;
+// Routine Description:
+// - The body of the thread that writes the output that _Flush() queued to the pipe.
+//      It exits once _StopWriter() was called and the queue is empty, or if a write failed.
+void VtEngine::_WriterThread() noexcept
+{
+    const auto file = _hFile.get();
+    std::string buffer;
+
+    for (;;)
+    {
+        {
+            std::unique_lock lock{ _writerMutex };
+            _writerCV.wait(lock, [&]() noexcept { return !_writerQueue.empty() || _writerExit; });
+            if (_writerQueue.empty())
+            {
+                return;
+            }
+            buffer.swap(_writerQueue);
+            _writerQueue.clear();
+        }
+
+        // The queue is empty again. If we skipped painting a frame for that, it can go ahead now.
+        if (_pfnOutputDrained)
+        {
+            _pfnOutputDrained();
+        }
+
+        if (!WriteFile(file, buffer.data(), gsl::narrow_cast<DWORD>(buffer.size()), nullptr, nullptr))
+        {
+            _writerResult.store(HRESULT_FROM_WIN32(GetLastError()), std::memory_order_relaxed);
+            // The next _Flush() closes the pipe.
+            if (_pfnOutputDrained)
+            {
+                _pfnOutputDrained();
+            }
+            return;
+        }
+
+        buffer.clear();
+    }
+}
+
+// Routine Description:
+// - Waits for the writer thread to write the remaining output and to exit.
+void VtEngine::_StopWriter() noexcept
+{
+    if (!_writer.joinable())
+    {
+        return;
+    }
+
+    {
+        const std::lock_guard lock{ _writerMutex };
+        _writerExit = true;
+    }
+    _writerCV.notify_one();
+    _writer.join();
+}
+
+// Routine Description:
+// - Returns true if output from an earlier frame is still waiting behind the one
+//      that's currently being written. Painting another frame now would only
+//      make the queue longer, so we wait until the writer catches up.
+bool VtEngine::_IsOutputBacklogged() noexcept
+{
+    const std::lock_guard lock{ _writerMutex };
+    return !_writerQueue.empty();
 }
 
 // Method Description:
 // - Wrapper for _Write.
 [[nodiscard]] HRESULT VtEngine::WriteTerminalUtf8(const std::string_view str) noexcept
 {
+    _InvalidateShadowBuffer();
     return _Write(str);
 }
 
@@ -173,10 +292,96 @@ CATCH_RETURN();
 // - S_OK or suitable HRESULT error from either conversion or writing pipe.
 [[nodiscard]] HRESULT VtEngine::_WriteTerminalUtf8(const std::wstring_view wstr) noexcept
 {
+    if (wstr.size() >= SharedBuffer::MinFrameLength && _sharedBuffer.IsAttached() && !_synchronizingBuffer)
+    {
+        if (const auto hr = _WriteSharedBufferFrame(wstr); hr != S_FALSE)
+        {
+            return hr;
+        }
+    }
+
     RETURN_IF_FAILED(til::u16u8(wstr, _conversionBuffer));
     return _Write(_conversionBuffer);
 }
 
+// Method Description:
+// - Copies the string into the shared buffer and writes a frame that refers to it
+//   in its place, so that the terminal doesn't have to decode it. See SetSharedBuffer().
+// Arguments:
+// - wstr - wstring of text to be written
+// Return Value:
+// - S_OK if the frame was written, S_FALSE if the shared buffer is full,
+//   or a suitable HRESULT error from writing pipe.
+[[nodiscard]] HRESULT VtEngine::_WriteSharedBufferFrame(const std::wstring_view wstr) noexcept
+{
+    if (!_sharedBuffer.Write(wstr))
+    {
+        return S_FALSE;
+    }
+
+    const auto length = gsl::narrow_cast<uint32_t>(wstr.size());
+    char frame[SharedBuffer::FrameSize];
+    frame[0] = SharedBuffer::FrameIntroducer;
+    memcpy(&frame[1], &length, sizeof(length));
+
+    const auto hr = _Write({ &frame[0], sizeof(frame) });
+    if (FAILED(hr))
+    {
+        // The terminal would take the text we just wrote for the next frame.
+        // Without any further frames, it simply never reads it.
+        _sharedBuffer = {};
+    }
+    return hr;
+}
+
+// Method Description:
+// - Writes the first `cch` characters of _bufferLine, which holds the text of the given
+//   clusters, like _WriteTerminalUtf8 would. Runs of at least REPEAT_CHARACTER_MIN_COUNT
+//   identical clusters after the first one are written as that first one followed by REP.
+// - REP repeats the last graphic character and not the last grapheme cluster,
+//   so only clusters that consist of a single, non-surrogate code unit qualify.
+// Arguments:
+// - clusters - the clusters whose text is stored in _bufferLine
+// - cch - the number of characters of _bufferLine to write
+// Return Value:
+// - S_OK or suitable HRESULT error from writing pipe.
+[[nodiscard]] HRESULT VtEngine::_WriteTerminalUtf8Repeated(const std::span<const Cluster> clusters, const size_t cch) noexcept
+{
+    const std::wstring_view line{ _bufferLine.data(), cch };
+    // The part of the line that has been written already, and the start of the current cluster.
+    size_t written = 0;
+    size_t pos = 0;
+
+    for (size_t i = 0; i < clusters.size() && pos < cch;)
+    {
+        const auto text = til::at(clusters, i).GetText();
+        if (text.size() != 1 || til::is_surrogate(text.front()) || text.front() < L' ')
+        {
+            pos += text.size();
+            ++i;
+            continue;
+        }
+
+        size_t count = 1;
+        while (i + count < clusters.size() && pos + count < cch && til::at(clusters, i + count).GetText() == text)
+        {
+            ++count;
+        }
+
+        if (count - 1 >= REPEAT_CHARACTER_MIN_COUNT)
+        {
+            RETURN_IF_FAILED(_WriteTerminalUtf8(line.substr(written, pos + 1 - written)));
+            RETURN_IF_FAILED(_RepeatCharacter(count - 1));
+            written = pos + count;
+        }
+
+        pos += count;
+        i += count;
+    }
+
+    return _WriteTerminalUtf8(line.substr(written));
+}
+
 // Method Description:
 // - Writes a wstring to the tty, encoded as "utf-8" where characters that are
 //      outside the ASCII range are encoded as '?'
@@ -269,6 +474,9 @@ CATCH_RETURN();
 
     if (oldSize != newSize)
     {
+        // The terminal might reflow its contents. We can't predict how.
+        _InvalidateShadowBuffer();
+
         // Don't emit a resize event if we've requested it be suppressed
         if (!_suppressResizeRepaint)
         {
@@ -503,11 +711,117 @@ void VtEngine::SetPassthroughMode(const bool passthrough) noexcept
     _passthrough = passthrough;
 }
 
+// Method Description:
+// - Allows the renderer to compress runs of the same character with REP
+//   (CSI n b), because the attached terminal told us that it supports it.
+//   Box drawing borders, separators and colored spaces of TUI applications
+//   are then written in a fraction of the bytes.
+// Arguments:
+// - enabled - True if the terminal supports REP. False otherwise.
+// Return Value:
+// - <none>
+void VtEngine::SetRepeatCharacter(const bool enabled) noexcept
+{
+    _repeatCharacter = enabled;
+}
+
+// Method Description:
+// - Lets the renderer move longer runs of text through the given section instead of
+//   the pipe, because the terminal asked for it with PSEUDOCONSOLE_SHARED_BUFFER.
+//   Copying them into the section and having the terminal splice them back into
+//   the output is cheaper than encoding them as UTF-8 and decoding them again.
+//   See ConptySharedBuffer.hpp for the details.
+// Arguments:
+// - section - The mapped section. It has to outlive this engine.
+// Return Value:
+// - <none>
+void VtEngine::SetSharedBuffer(const std::span<std::byte> section) noexcept
+{
+    if (!_sharedBuffer.Attach(section, SharedBuffer::Ring::End::Writer))
+    {
+        LOG_HR(E_INVALIDARG);
+    }
+}
+
+// Method Description:
+// - Turns shadow buffer mode on or off. In this mode we keep track of what the
+//   attached terminal displays, and only emit the parts of the invalidated
+//   regions that actually differ from it. Unchanged cells are skipped with
+//   cursor movements and attributes aren't emitted for text that's skipped.
+//   This greatly reduces the amount of output for full repaints over slow
+//   connections, at the cost of some memory and hashing per painted cell.
+// Arguments:
+// - enabled - True to turn on shadow buffer mode. False otherwise.
+// Return Value:
+// - <none>
+void VtEngine::SetShadowBufferMode(const bool enabled) noexcept
+{
+    _shadowBufferMode = enabled;
+    _shadowBuffer = {};
+}
+
+// Method Description:
+// - In passthrough mode, output that the client wrote with VT processing enabled
+//   is sent to the terminal directly and only applied to the text buffer
+//   when a console API needs it. Between BeginBufferSync() and EndBufferSync()
+//   that output is written to the buffer: we drop anything we'd send to the
+//   terminal in the meantime, since the terminal already processed it.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void VtEngine::BeginBufferSync() noexcept
+{
+    _synchronizingBuffer = true;
+}
+
+// Method Description:
+// - Ends a BeginBufferSync() pass. The terminal already shows everything that
+//   was invalidated in the meantime, so we forget about it.
+// Arguments:
+// - cursor - the cursor position within the viewport, as the terminal has it now.
+// Return Value:
+// - <none>
+void VtEngine::EndBufferSync(const til::point cursor) noexcept
+{
+    _synchronizingBuffer = false;
+    _invalidMap.reset_all();
+    _scrollDelta = {};
+    _cursorMoved = false;
+    _circled = false;
+    _InvalidateShadowBuffer();
+
+    // We don't know whether the terminal is in the delayed EOL wrap state,
+    // so the next cursor movement mustn't be relative.
+    _lastText = cursor;
+    _wrappedRow = std::nullopt;
+    _delayedEolWrap = true;
+}
+
+bool VtEngine::IsSynchronizingBuffer() const noexcept
+{
+    return _synchronizingBuffer;
+}
+
 void VtEngine::SetLookingForDSRCallback(std::function<void(bool)> pfnLooking) noexcept
 {
     _pfnSetLookingForDSR = pfnLooking;
 }
 
+// Method Description:
+// - Sets the function that's called (on a background thread) when the output
+//   that was queued for the pipe has been picked up for writing. While that
+//   hasn't happened, StartPaint() skips frames, so this should trigger a paint.
+//   Must be called before any output is written.
+// Arguments:
+// - pfnOutputDrained - the callback
+// Return Value:
+// - <none>
+void VtEngine::SetOutputDrainedCallback(std::function<void()> pfnOutputDrained) noexcept
+{
+    _pfnOutputDrained = std::move(pfnOutputDrained);
+}
+
 void VtEngine::SetTerminalCursorTextPosition(const til::point cursor) noexcept
 {
     _lastText = cursor;
@@ -542,6 +856,7 @@ void VtEngine::SetTerminalCursorTextPosition(const til::point cursor) noexcept
 HRESULT VtEngine::RequestWin32Input() noexcept
 {
     RETURN_IF_FAILED(_RequestWin32Input());
+    RETURN_IF_FAILED(_RequestBinaryInput());
     RETURN_IF_FAILED(_RequestFocusEventMode());
     RETURN_IF_FAILED(_Flush());
     return S_OK;
@@ -551,5 +866,6 @@ HRESULT VtEngine::SwitchScreenBuffer(const bool useAltBuffer) noexcept
 {
     RETURN_IF_FAILED(_SwitchScreenBuffer(useAltBuffer));
     RETURN_IF_FAILED(_Flush());
+    _InvalidateShadowBuffer();
     return S_OK;
 }
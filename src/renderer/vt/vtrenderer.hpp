@@ -18,6 +18,8 @@ Author(s):
 #include "../inc/RenderEngineBase.hpp"
 #include "../../types/inc/Viewport.hpp"
 #include "tracing.hpp"
+#include "../../inc/ConptySharedBuffer.hpp"
+#include <condition_variable>
 #include <string>
 #include <functional>
 
@@ -42,10 +44,13 @@ namespace Microsoft::Console::Render
     public:
         // See _PaintUtf8BufferLine for explanation of this value.
         static const size_t ERASE_CHARACTER_STRING_LENGTH = 8;
+        // See _WriteTerminalUtf8Repeated. "\x1b[5b" is shorter than 5 characters in any encoding.
+        static const size_t REPEAT_CHARACTER_MIN_COUNT = 5;
         static const til::point INVALID_COORDS;
 
         VtEngine(_In_ wil::unique_hfile hPipe,
                  const Microsoft::Console::Types::Viewport initialViewport);
+        ~VtEngine() override;
 
         // IRenderEngine
         [[nodiscard]] HRESULT StartPaint() noexcept override;
@@ -84,7 +89,14 @@ namespace Microsoft::Console::Render
         void EndResizeRequest();
         void SetResizeQuirk(const bool resizeQuirk);
         void SetPassthroughMode(const bool passthrough) noexcept;
+        void SetRepeatCharacter(const bool enabled) noexcept;
+        void SetSharedBuffer(const std::span<std::byte> section) noexcept;
+        void SetShadowBufferMode(const bool enabled) noexcept;
+        void BeginBufferSync() noexcept;
+        void EndBufferSync(const til::point cursor) noexcept;
+        bool IsSynchronizingBuffer() const noexcept;
         void SetLookingForDSRCallback(std::function<void(bool)> pfnLooking) noexcept;
+        void SetOutputDrainedCallback(std::function<void()> pfnOutputDrained) noexcept;
         void SetTerminalCursorTextPosition(const til::point coordCursor) noexcept;
         [[nodiscard]] virtual HRESULT ManuallyClearScrollback() noexcept;
         [[nodiscard]] HRESULT RequestWin32Input() noexcept;
@@ -139,11 +151,39 @@ namespace Microsoft::Console::Render
 
         bool _resizeQuirk{ false };
         bool _passthrough{ false };
+        bool _repeatCharacter{ false };
+        // See SetSharedBuffer(). Detached unless the terminal gave us one.
+        SharedBuffer::Ring _sharedBuffer;
+        bool _synchronizingBuffer{ false };
         std::optional<TextColor> _newBottomLineBG{ std::nullopt };
 
+        // See SetShadowBufferMode(). Holds a hash of the contents of every cell of the viewport,
+        // as we believe the terminal displays it. 0 means that we don't know what's in that cell.
+        bool _shadowBufferMode{ false };
+        std::vector<size_t> _shadowBuffer;
+        // The attributes that were last passed to UpdateDrawingBrushes(). Unlike _lastTextAttributes
+        // this isn't limited to what we've emitted so far, since that may be deferred. See _FlushPendingBrushes().
+        TextAttribute _shadowTextAttributes;
+        bool _shadowSoftFont{ false };
+
+        // _Flush() hands _buffer over to a background thread, which writes it to the pipe.
+        // That way a terminal that reads slowly can't block us while we hold the console lock.
+        // While the writer is still busy with earlier output, we don't paint new frames, so
+        // that they merge into one frame with the latest state. See _IsOutputBacklogged().
+        std::thread _writer;
+        std::mutex _writerMutex;
+        std::condition_variable _writerCV;
+        std::string _writerQueue; // guarded by _writerMutex
+        bool _writerExit{ false }; // guarded by _writerMutex
+        std::atomic<HRESULT> _writerResult{ S_OK };
+        std::function<void()> _pfnOutputDrained;
+
         [[nodiscard]] HRESULT _WriteFill(const size_t n, const char c) noexcept;
         [[nodiscard]] HRESULT _Write(std::string_view const str) noexcept;
         [[nodiscard]] HRESULT _Flush() noexcept;
+        void _WriterThread() noexcept;
+        void _StopWriter() noexcept;
+        bool _IsOutputBacklogged() noexcept;
 
         template<typename S, typename... Args>
         [[nodiscard]] HRESULT _WriteFormatted(S&& format, Args&&... args)
@@ -168,6 +208,7 @@ namespace Microsoft::Console::Render
         [[nodiscard]] HRESULT _InsertLine(const til::CoordType sLines) noexcept;
         [[nodiscard]] HRESULT _CursorForward(const til::CoordType chars) noexcept;
         [[nodiscard]] HRESULT _EraseCharacter(const til::CoordType chars) noexcept;
+        [[nodiscard]] HRESULT _RepeatCharacter(const size_t count) noexcept;
         [[nodiscard]] HRESULT _CursorPosition(const til::point coord) noexcept;
         [[nodiscard]] HRESULT _CursorHome() noexcept;
         [[nodiscard]] HRESULT _ClearScreen() noexcept;
@@ -203,6 +244,7 @@ namespace Microsoft::Console::Render
         [[nodiscard]] HRESULT _ListenForDSR() noexcept;
 
         [[nodiscard]] HRESULT _RequestWin32Input() noexcept;
+        [[nodiscard]] HRESULT _RequestBinaryInput() noexcept;
         [[nodiscard]] HRESULT _SwitchScreenBuffer(const bool useAltBuffer) noexcept;
 
         [[nodiscard]] HRESULT _RequestFocusEventMode() noexcept;
@@ -213,6 +255,15 @@ namespace Microsoft::Console::Render
 
         bool _WillWriteSingleChar() const;
 
+        [[nodiscard]] virtual HRESULT _FlushPendingBrushes() noexcept;
+        std::span<size_t> _GetShadowRow(const til::CoordType row) noexcept;
+        void _InvalidateShadowBuffer() noexcept;
+        void _InvalidateShadowCells(const til::point coord, const til::CoordType count) noexcept;
+        void _ScrollShadowBuffer(const til::CoordType delta) noexcept;
+        size_t _HashCluster(const Cluster& cluster) const noexcept;
+        size_t _CountUnchangedClusters(const std::span<const Cluster> clusters, const til::point coord, til::CoordType& columns) noexcept;
+        void _UpdateShadowCells(const std::span<const Cluster> clusters, const til::point coord, const til::CoordType columns) noexcept;
+
         // buffer space for these two functions to build their lines
         // so they don't have to alloc/free in a tight loop
         std::wstring _bufferLine;
@@ -224,6 +275,8 @@ namespace Microsoft::Console::Render
                                                     const til::point coord) noexcept;
 
         [[nodiscard]] HRESULT _WriteTerminalUtf8(const std::wstring_view str) noexcept;
+        [[nodiscard]] HRESULT _WriteSharedBufferFrame(const std::wstring_view str) noexcept;
+        [[nodiscard]] HRESULT _WriteTerminalUtf8Repeated(const std::span<const Cluster> clusters, const size_t cch) noexcept;
         [[nodiscard]] HRESULT _WriteTerminalAscii(const std::wstring_view str) noexcept;
         [[nodiscard]] HRESULT _WriteTerminalDrcs(const std::wstring_view str) noexcept;
 
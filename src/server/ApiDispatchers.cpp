@@ -152,23 +152,24 @@
 
     std::unique_ptr<IWaitRoutine> waiter;
     HRESULT hr;
-    std::deque<std::unique_ptr<IInputEvent>> outEvents;
-    const auto eventsToRead = cRecords;
+    // The records are read straight into the output buffer of the message.
+    const std::span outRecords{ rgRecords, cRecords };
+    size_t recordsRead = 0;
     if (a->Unicode)
     {
         if (fIsPeek)
         {
             hr = m->_pApiRoutines->PeekConsoleInputWImpl(*pInputBuffer,
-                                                         outEvents,
-                                                         eventsToRead,
+                                                         outRecords,
+                                                         recordsRead,
                                                          *pInputReadHandleData,
                                                          waiter);
         }
         else
         {
             hr = m->_pApiRoutines->ReadConsoleInputWImpl(*pInputBuffer,
-                                                         outEvents,
-                                                         eventsToRead,
+                                                         outRecords,
+                                                         recordsRead,
                                                          *pInputReadHandleData,
                                                          waiter);
         }
@@ -178,16 +179,16 @@
         if (fIsPeek)
         {
             hr = m->_pApiRoutines->PeekConsoleInputAImpl(*pInputBuffer,
-                                                         outEvents,
-                                                         eventsToRead,
+                                                         outRecords,
+                                                         recordsRead,
                                                          *pInputReadHandleData,
                                                          waiter);
         }
         else
         {
             hr = m->_pApiRoutines->ReadConsoleInputAImpl(*pInputBuffer,
-                                                         outEvents,
-                                                         eventsToRead,
+                                                         outRecords,
+                                                         recordsRead,
                                                          *pInputReadHandleData,
                                                          waiter);
         }
@@ -195,10 +196,10 @@
 
     // We must return the number of records in the message payload (to alert the client)
     // as well as in the message headers (below in SetReplyInformation) to alert the driver.
-    LOG_IF_FAILED(SizeTToULong(outEvents.size(), &a->NumRecords));
+    LOG_IF_FAILED(SizeTToULong(recordsRead, &a->NumRecords));
 
     size_t cbWritten;
-    LOG_IF_FAILED(SizeTMult(outEvents.size(), sizeof(INPUT_RECORD), &cbWritten));
+    LOG_IF_FAILED(SizeTMult(recordsRead, sizeof(INPUT_RECORD), &cbWritten));
 
     if (nullptr != waiter.get())
     {
@@ -226,22 +227,6 @@
             hr = S_OK;
         }
     }
-    else
-    {
-        try
-        {
-            for (size_t i = 0; i < cRecords; ++i)
-            {
-                if (outEvents.empty())
-                {
-                    break;
-                }
-                rgRecords[i] = outEvents.front()->ToInputRecord();
-                outEvents.pop_front();
-            }
-        }
-        CATCH_RETURN();
-    }
 
     if (SUCCEEDED(hr))
     {
@@ -10,6 +10,41 @@
 
 constexpr size_t structPacketDataSize = sizeof(_CONSOLE_API_MSG) - offsetof(_CONSOLE_API_MSG, Descriptor);
 
+// Buffers up to this size are always kept around for the next message.
+constexpr size_t bufferRetainSize = 16 * 1024;
+// Larger buffers are only released once this many consecutive messages needed less than half of it.
+// Clients commonly alternate between large and small calls (e.g. a large WriteConsoleW followed
+// by a GetConsoleScreenBufferInfo), and releasing the buffer right away would mean
+// that we reallocate it for every other message.
+constexpr ULONG bufferRetainMessages = 64;
+
+// Routine Description:
+// - Resizes the given buffer to the given size, while keeping the existing allocation around unless
+//   it has been excessively large for a while. The IO thread reuses its message for every request,
+//   so this makes its buffers act like a pool for all messages of similar size.
+// Arguments:
+// - buffer - The message buffer to resize.
+// - oversizedCount - The number of consecutive calls for which the buffer was oversized.
+// - size - The new size of the buffer.
+static void _reserveBuffer(til::small_vector<BYTE, 128>& buffer, ULONG& oversizedCount, const size_t size)
+{
+    if (buffer.capacity() > bufferRetainSize && (buffer.capacity() >> 1) > size)
+    {
+        if (++oversizedCount >= bufferRetainMessages)
+        {
+            buffer.clear();
+            buffer.shrink_to_fit();
+            oversizedCount = 0;
+        }
+    }
+    else
+    {
+        oversizedCount = 0;
+    }
+
+    buffer.resize(size);
+}
+
 _CONSOLE_API_MSG::_CONSOLE_API_MSG()
 {
     // A union cannot have more than one initializer,
@@ -29,6 +64,7 @@ _CONSOLE_API_MSG& _CONSOLE_API_MSG::operator=(const _CONSOLE_API_MSG& other)
     State = other.State;
     _pDeviceComm = other._pDeviceComm;
     _pApiRoutines = other._pApiRoutines;
+    _cbReceived = other._cbReceived;
     _inputBuffer = other._inputBuffer;
     _outputBuffer = other._outputBuffer;
 
@@ -39,7 +75,17 @@ _CONSOLE_API_MSG& _CONSOLE_API_MSG::operator=(const _CONSOLE_API_MSG& other)
 
     if (State.InputBuffer)
     {
-        State.InputBuffer = _inputBuffer.data();
+        // The input buffer either points at our _inputBuffer, or directly at the inline data in the packet.
+        const auto otherInline = other._inlineInput();
+        const auto otherInput = static_cast<const BYTE*>(other.State.InputBuffer);
+        if (otherInput >= otherInline && otherInput < reinterpret_cast<const BYTE*>(&other) + sizeof(other))
+        {
+            State.InputBuffer = const_cast<BYTE*>(_inlineInput()) + (otherInput - otherInline);
+        }
+        else
+        {
+            State.InputBuffer = _inputBuffer.data();
+        }
     }
 
     if (State.OutputBuffer)
@@ -55,6 +101,11 @@ _CONSOLE_API_MSG& _CONSOLE_API_MSG::operator=(const _CONSOLE_API_MSG& other)
     return *this;
 }
 
+const BYTE* _CONSOLE_API_MSG::_inlineInput() const noexcept
+{
+    return reinterpret_cast<const BYTE*>(&Descriptor) + sizeof(Descriptor);
+}
+
 ConsoleProcessHandle* _CONSOLE_API_MSG::GetProcessHandle() const
 {
     return reinterpret_cast<ConsoleProcessHandle*>(_pDeviceComm->GetHandle(Descriptor.Process));
@@ -106,18 +157,20 @@ try
 
         const auto cbReadSize = Descriptor.InputSize - State.ReadOffset;
 
-        // If we were previously called with a huge buffer we have an equally large _inputBuffer.
-        // We shouldn't just keep this huge buffer around, if no one needs it anymore.
-        if (_inputBuffer.capacity() > 16 * 1024 && (_inputBuffer.capacity() >> 1) > cbReadSize)
+        // The input starts right after the descriptor. If the driver already gave us all of it in ReadIo(),
+        // we can use it right where it is, without allocating or copying anything.
+        const auto cbInline = _cbReceived > sizeof(Descriptor) ? _cbReceived - sizeof(Descriptor) : 0;
+        if (State.ReadOffset + cbReadSize <= cbInline)
         {
-            _inputBuffer.shrink_to_fit();
+            State.InputBuffer = const_cast<BYTE*>(_inlineInput()) + State.ReadOffset;
+        }
+        else
+        {
+            _reserveBuffer(_inputBuffer, _inputBufferOversizedCount, cbReadSize);
+            RETURN_IF_FAILED(ReadMessageInput(0, _inputBuffer.data(), cbReadSize));
+            State.InputBuffer = _inputBuffer.data();
         }
 
-        _inputBuffer.resize(cbReadSize);
-
-        RETURN_IF_FAILED(ReadMessageInput(0, _inputBuffer.data(), cbReadSize));
-
-        State.InputBuffer = _inputBuffer.data();
         State.InputBufferSize = cbReadSize;
     }
 
@@ -149,14 +202,7 @@ try
 
         auto cbWriteSize = Descriptor.OutputSize - State.WriteOffset;
 
-        // If we were previously called with a huge buffer we have an equally large _outputBuffer.
-        // We shouldn't just keep this huge buffer around, if no one needs it anymore.
-        if (_outputBuffer.capacity() > 16 * 1024 && (_outputBuffer.capacity() >> 1) > cbWriteSize)
-        {
-            _outputBuffer.shrink_to_fit();
-        }
-
-        _outputBuffer.resize(cbWriteSize);
+        _reserveBuffer(_outputBuffer, _outputBufferOversizedCount, cbWriteSize);
 
         // 0 it out.
         std::fill_n(_outputBuffer.data(), _outputBuffer.size(), BYTE(0));
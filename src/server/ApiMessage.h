@@ -46,6 +46,9 @@ typedef struct _CONSOLE_API_MSG
 
     [[nodiscard]] HRESULT ReleaseMessageBuffers();
 
+    // Returns the (partial) payload the driver copied into the packet along with the descriptor.
+    const BYTE* _inlineInput() const noexcept;
+
     void SetReplyStatus(const NTSTATUS Status);
     void SetReplyInformation(const ULONG_PTR pInformation);
 
@@ -61,9 +64,17 @@ typedef struct _CONSOLE_API_MSG
     IDeviceComm* _pDeviceComm{ nullptr };
     IApiRoutines* _pApiRoutines{ nullptr };
 
+    // The number of bytes the driver copied into the packet data below, starting at Descriptor.
+    ULONG _cbReceived{ 0 };
+
     til::small_vector<BYTE, 128> _inputBuffer;
     til::small_vector<BYTE, 128> _outputBuffer;
 
+    // The number of consecutive messages that needed a much smaller buffer than the one we have.
+    // See _reserveBuffer() in ApiMessage.cpp.
+    ULONG _inputBufferOversizedCount{ 0 };
+    ULONG _outputBufferOversizedCount{ 0 };
+
     // From here down is the actual packet data sent/received.
     CD_IO_DESCRIPTOR Descriptor;
     union
@@ -84,6 +95,9 @@ typedef struct _CONSOLE_API_MSG
             } u;
         };
     };
+    // Receives the beginning of the message payload (for instance the text of a WriteConsole call)
+    // along with the packet, so that small payloads don't need a separate IOCTL_CONDRV_READ_INPUT.
+    BYTE _readAhead[2048];
     // End packet data
 
     // DO NOT PUT MORE FIELDS DOWN HERE.
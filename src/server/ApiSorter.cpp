@@ -11,20 +11,26 @@
 
 #define CONSOLE_API_STRUCT(Routine, Struct, TraceName) \
     {                                                  \
-        Routine, sizeof(Struct), TraceName             \
+        Routine, sizeof(Struct), TraceName, false      \
+    }
+// Same as CONSOLE_API_STRUCT, but for APIs that don't modify the console state
+// and may thus be served concurrently under the shared console lock.
+#define CONSOLE_API_STRUCT_READONLY(Routine, Struct, TraceName) \
+    {                                                           \
+        Routine, sizeof(Struct), TraceName, true                \
     }
 #define CONSOLE_API_NO_PARAMETER(Routine, TraceName) \
     {                                                \
-        Routine, 0, TraceName                        \
+        Routine, 0, TraceName, false                 \
     }
 
-#define CONSOLE_API_DEPRECATED(Struct)                                    \
-    {                                                                     \
-        ApiDispatchers::ServerDeprecatedApi, sizeof(Struct), "Deprecated" \
+#define CONSOLE_API_DEPRECATED(Struct)                                           \
+    {                                                                            \
+        ApiDispatchers::ServerDeprecatedApi, sizeof(Struct), "Deprecated", false \
     }
-#define CONSOLE_API_DEPRECATED_NO_PARAM()                    \
-    {                                                        \
-        ApiDispatchers::ServerDeprecatedApi, 0, "Deprecated" \
+#define CONSOLE_API_DEPRECATED_NO_PARAM()                           \
+    {                                                               \
+        ApiDispatchers::ServerDeprecatedApi, 0, "Deprecated", false \
     }
 
 typedef struct _CONSOLE_API_DESCRIPTOR
@@ -32,6 +38,7 @@ typedef struct _CONSOLE_API_DESCRIPTOR
     PCONSOLE_API_ROUTINE Routine;
     ULONG RequiredSize;
     PCSTR TraceName;
+    bool ReadOnly;
 } CONSOLE_API_DESCRIPTOR, *PCONSOLE_API_DESCRIPTOR;
 
 typedef struct _CONSOLE_API_LAYER_DESCRIPTOR
@@ -41,15 +48,15 @@ typedef struct _CONSOLE_API_LAYER_DESCRIPTOR
 } CONSOLE_API_LAYER_DESCRIPTOR, *PCONSOLE_API_LAYER_DESCRIPTOR;
 
 const CONSOLE_API_DESCRIPTOR ConsoleApiLayer1[] = {
-    CONSOLE_API_STRUCT(ApiDispatchers::ServerGetConsoleCP, CONSOLE_GETCP_MSG, "GetConsoleCP"),
-    CONSOLE_API_STRUCT(ApiDispatchers::ServerGetConsoleMode, CONSOLE_MODE_MSG, "GetConsoleMode"),
+    CONSOLE_API_STRUCT_READONLY(ApiDispatchers::ServerGetConsoleCP, CONSOLE_GETCP_MSG, "GetConsoleCP"),
+    CONSOLE_API_STRUCT_READONLY(ApiDispatchers::ServerGetConsoleMode, CONSOLE_MODE_MSG, "GetConsoleMode"),
     CONSOLE_API_STRUCT(ApiDispatchers::ServerSetConsoleMode, CONSOLE_MODE_MSG, "SetConsoleMode"),
-    CONSOLE_API_STRUCT(ApiDispatchers::ServerGetNumberOfInputEvents, CONSOLE_GETNUMBEROFINPUTEVENTS_MSG, "GetNumberOfConsoleInputEvents"),
+    CONSOLE_API_STRUCT_READONLY(ApiDispatchers::ServerGetNumberOfInputEvents, CONSOLE_GETNUMBEROFINPUTEVENTS_MSG, "GetNumberOfConsoleInputEvents"),
     CONSOLE_API_STRUCT(ApiDispatchers::ServerGetConsoleInput, CONSOLE_GETCONSOLEINPUT_MSG, "GetConsoleInput"),
     CONSOLE_API_STRUCT(ApiDispatchers::ServerReadConsole, CONSOLE_READCONSOLE_MSG, "ReadConsole"),
     CONSOLE_API_STRUCT(ApiDispatchers::ServerWriteConsole, CONSOLE_WRITECONSOLE_MSG, "WriteConsole"),
     CONSOLE_API_DEPRECATED_NO_PARAM(), // ApiDispatchers::ServerConsoleNotifyLastClose
-    CONSOLE_API_STRUCT(ApiDispatchers::ServerGetConsoleLangId, CONSOLE_LANGID_MSG, "GetConsoleLangId"),
+    CONSOLE_API_STRUCT_READONLY(ApiDispatchers::ServerGetConsoleLangId, CONSOLE_LANGID_MSG, "GetConsoleLangId"),
     CONSOLE_API_DEPRECATED(CONSOLE_MAPBITMAP_MSG),
 };
 
@@ -59,9 +66,9 @@ const CONSOLE_API_DESCRIPTOR ConsoleApiLayer2[] = {
     CONSOLE_API_NO_PARAMETER(ApiDispatchers::ServerSetConsoleActiveScreenBuffer, "SetConsoleActiveScreenBuffer"),
     CONSOLE_API_NO_PARAMETER(ApiDispatchers::ServerFlushConsoleInputBuffer, "FlushConsoleInputBuffer"),
     CONSOLE_API_STRUCT(ApiDispatchers::ServerSetConsoleCP, CONSOLE_SETCP_MSG, "SetConsoleCP"),
-    CONSOLE_API_STRUCT(ApiDispatchers::ServerGetConsoleCursorInfo, CONSOLE_GETCURSORINFO_MSG, "GetConsoleCursorInfo"),
+    CONSOLE_API_STRUCT_READONLY(ApiDispatchers::ServerGetConsoleCursorInfo, CONSOLE_GETCURSORINFO_MSG, "GetConsoleCursorInfo"),
     CONSOLE_API_STRUCT(ApiDispatchers::ServerSetConsoleCursorInfo, CONSOLE_SETCURSORINFO_MSG, "SetConsoleCursorInfo"),
-    CONSOLE_API_STRUCT(ApiDispatchers::ServerGetConsoleScreenBufferInfo, CONSOLE_SCREENBUFFERINFO_MSG, "GetConsoleScreenBufferInfo"),
+    CONSOLE_API_STRUCT_READONLY(ApiDispatchers::ServerGetConsoleScreenBufferInfo, CONSOLE_SCREENBUFFERINFO_MSG, "GetConsoleScreenBufferInfo"),
     CONSOLE_API_STRUCT(ApiDispatchers::ServerSetConsoleScreenBufferInfo, CONSOLE_SCREENBUFFERINFO_MSG, "SetConsoleScreenBufferInfo"),
     CONSOLE_API_STRUCT(ApiDispatchers::ServerSetConsoleScreenBufferSize, CONSOLE_SETSCREENBUFFERSIZE_MSG, "SetConsoleScreenBufferSize"),
     CONSOLE_API_STRUCT(ApiDispatchers::ServerSetConsoleCursorPosition, CONSOLE_SETCURSORPOSITION_MSG, "SetConsoleCursorPosition"),
@@ -74,13 +81,13 @@ const CONSOLE_API_DESCRIPTOR ConsoleApiLayer2[] = {
     CONSOLE_API_STRUCT(ApiDispatchers::ServerWriteConsoleOutput, CONSOLE_WRITECONSOLEOUTPUT_MSG, "WriteConsoleOutput"),
     CONSOLE_API_STRUCT(ApiDispatchers::ServerWriteConsoleOutputString, CONSOLE_WRITECONSOLEOUTPUTSTRING_MSG, "WriteConsoleOutputString"),
     CONSOLE_API_STRUCT(ApiDispatchers::ServerReadConsoleOutput, CONSOLE_READCONSOLEOUTPUT_MSG, "ReadConsoleOutput"),
-    CONSOLE_API_STRUCT(ApiDispatchers::ServerGetConsoleTitle, CONSOLE_GETTITLE_MSG, "GetConsoleTitle"),
+    CONSOLE_API_STRUCT_READONLY(ApiDispatchers::ServerGetConsoleTitle, CONSOLE_GETTITLE_MSG, "GetConsoleTitle"),
     CONSOLE_API_STRUCT(ApiDispatchers::ServerSetConsoleTitle, CONSOLE_SETTITLE_MSG, "SetConsoleTitle"),
 };
 
 const CONSOLE_API_DESCRIPTOR ConsoleApiLayer3[] = {
     CONSOLE_API_DEPRECATED(CONSOLE_GETNUMBEROFFONTS_MSG),
-    CONSOLE_API_STRUCT(ApiDispatchers::ServerGetConsoleMouseInfo, CONSOLE_GETMOUSEINFO_MSG, "GetNumberOfConsoleMouseButtons"),
+    CONSOLE_API_STRUCT_READONLY(ApiDispatchers::ServerGetConsoleMouseInfo, CONSOLE_GETMOUSEINFO_MSG, "GetNumberOfConsoleMouseButtons"),
     CONSOLE_API_DEPRECATED(CONSOLE_GETFONTINFO_MSG),
     CONSOLE_API_STRUCT(ApiDispatchers::ServerGetConsoleFontSize, CONSOLE_GETFONTSIZE_MSG, "GetConsoleFontSize"),
     CONSOLE_API_STRUCT(ApiDispatchers::ServerGetConsoleCurrentFont, CONSOLE_CURRENTFONT_MSG, "GetCurrentConsoleFont"),
@@ -96,7 +103,7 @@ const CONSOLE_API_DESCRIPTOR ConsoleApiLayer3[] = {
     CONSOLE_API_DEPRECATED(CONSOLE_REGISTERVDM_MSG),
     CONSOLE_API_DEPRECATED(CONSOLE_GETHARDWARESTATE_MSG),
     CONSOLE_API_DEPRECATED(CONSOLE_SETHARDWARESTATE_MSG),
-    CONSOLE_API_STRUCT(ApiDispatchers::ServerGetConsoleDisplayMode, CONSOLE_GETDISPLAYMODE_MSG, "GetConsoleDisplayMode"),
+    CONSOLE_API_STRUCT_READONLY(ApiDispatchers::ServerGetConsoleDisplayMode, CONSOLE_GETDISPLAYMODE_MSG, "GetConsoleDisplayMode"),
     CONSOLE_API_STRUCT(ApiDispatchers::ServerAddConsoleAlias, CONSOLE_ADDALIAS_MSG, "AddConsoleAlias"),
     CONSOLE_API_STRUCT(ApiDispatchers::ServerGetConsoleAlias, CONSOLE_GETALIAS_MSG, "GetConsoleAlias"),
     CONSOLE_API_STRUCT(ApiDispatchers::ServerGetConsoleAliasesLength, CONSOLE_GETALIASESLENGTH_MSG, "GetConsoleAliasesLength"),
@@ -110,7 +117,7 @@ const CONSOLE_API_DESCRIPTOR ConsoleApiLayer3[] = {
     CONSOLE_API_DEPRECATED(CONSOLE_SETKEYSHORTCUTS_MSG),
     CONSOLE_API_DEPRECATED(CONSOLE_SETMENUCLOSE_MSG),
     CONSOLE_API_DEPRECATED(CONSOLE_GETKEYBOARDLAYOUTNAME_MSG),
-    CONSOLE_API_STRUCT(ApiDispatchers::ServerGetConsoleWindow, CONSOLE_GETCONSOLEWINDOW_MSG, "GetConsoleWindow"),
+    CONSOLE_API_STRUCT_READONLY(ApiDispatchers::ServerGetConsoleWindow, CONSOLE_GETCONSOLEWINDOW_MSG, "GetConsoleWindow"),
     CONSOLE_API_DEPRECATED(CONSOLE_CHAR_TYPE_MSG),
     CONSOLE_API_DEPRECATED(CONSOLE_LOCAL_EUDC_MSG),
     CONSOLE_API_DEPRECATED(CONSOLE_CURSOR_MODE_MSG),
@@ -119,9 +126,9 @@ const CONSOLE_API_DESCRIPTOR ConsoleApiLayer3[] = {
     CONSOLE_API_DEPRECATED(CONSOLE_SETOS2OEMFORMAT_MSG),
     CONSOLE_API_DEPRECATED(CONSOLE_NLS_MODE_MSG),
     CONSOLE_API_DEPRECATED(CONSOLE_NLS_MODE_MSG),
-    CONSOLE_API_STRUCT(ApiDispatchers::ServerGetConsoleSelectionInfo, CONSOLE_GETSELECTIONINFO_MSG, "GetConsoleSelectionInfo"),
+    CONSOLE_API_STRUCT_READONLY(ApiDispatchers::ServerGetConsoleSelectionInfo, CONSOLE_GETSELECTIONINFO_MSG, "GetConsoleSelectionInfo"),
     CONSOLE_API_STRUCT(ApiDispatchers::ServerGetConsoleProcessList, CONSOLE_GETCONSOLEPROCESSLIST_MSG, "GetConsoleProcessList"),
-    CONSOLE_API_STRUCT(ApiDispatchers::ServerGetConsoleHistory, CONSOLE_HISTORY_MSG, "GetConsoleHistory"),
+    CONSOLE_API_STRUCT_READONLY(ApiDispatchers::ServerGetConsoleHistory, CONSOLE_HISTORY_MSG, "GetConsoleHistory"),
     CONSOLE_API_STRUCT(ApiDispatchers::ServerSetConsoleHistory, CONSOLE_HISTORY_MSG, "SetConsoleHistory"),
     CONSOLE_API_STRUCT(ApiDispatchers::ServerSetConsoleCurrentFont, CONSOLE_CURRENTFONT_MSG, "SetConsoleCurrentFont")
 };
@@ -138,20 +145,29 @@ const CONSOLE_API_LAYER_DESCRIPTOR ConsoleApiLayerTable[] = {
 // - Message - Supplies the message representing the user IO.
 // Return Value:
 // - A pointer to the reply message, if this message is to be completed inline; nullptr if this message will pend now and complete later.
+static const CONSOLE_API_DESCRIPTOR* LookupDescriptor(const ULONG ApiNumber) noexcept
+{
+    const auto LayerNumber = (ApiNumber >> 24) - 1;
+    const auto Index = ApiNumber & 0xffffff;
+
+    if ((LayerNumber >= std::size(ConsoleApiLayerTable)) || (Index >= ConsoleApiLayerTable[LayerNumber].Count))
+    {
+        return nullptr;
+    }
+
+    return &ConsoleApiLayerTable[LayerNumber].Descriptor[Index];
+}
+
 PCONSOLE_API_MSG ApiSorter::ConsoleDispatchRequest(_Inout_ PCONSOLE_API_MSG Message)
 {
     // Make sure the indices are valid and retrieve the API descriptor.
-    const auto LayerNumber = (Message->msgHeader.ApiNumber >> 24) - 1;
-    const auto ApiNumber = Message->msgHeader.ApiNumber & 0xffffff;
-
-    if ((LayerNumber >= std::size(ConsoleApiLayerTable)) || (ApiNumber >= ConsoleApiLayerTable[LayerNumber].Count))
+    const auto Descriptor = LookupDescriptor(Message->msgHeader.ApiNumber);
+    if (!Descriptor)
     {
         Message->SetReplyStatus(STATUS_ILLEGAL_FUNCTION);
         return Message;
     }
 
-    auto Descriptor = &ConsoleApiLayerTable[LayerNumber].Descriptor[ApiNumber];
-
     // Validate the argument size and call the API.
     if ((Message->Descriptor.InputSize < sizeof(CONSOLE_MSG_HEADER)) ||
         (Message->msgHeader.ApiDescriptorSize > sizeof(Message->u)) ||
@@ -190,3 +206,22 @@ PCONSOLE_API_MSG ApiSorter::ConsoleDispatchRequest(_Inout_ PCONSOLE_API_MSG Mess
 
     return nullptr;
 }
+
+// Routine Description:
+// - Checks whether the given user IO calls an API that only reads the console state.
+// - Such calls may be dispatched concurrently from multiple threads while holding the shared console lock.
+// Arguments:
+// - Message - Supplies the message representing the user IO.
+// Return Value:
+// - True if the message may be dispatched under the shared console lock.
+bool ApiSorter::IsReadOnlyRequest(const CONSOLE_API_MSG* const Message) noexcept
+{
+    if (Message->Descriptor.Function != CONSOLE_IO_USER_DEFINED)
+    {
+        return false;
+    }
+
+    // Invalid requests are rejected by ConsoleDispatchRequest(), which doesn't need a concurrent dispatch.
+    const auto Descriptor = LookupDescriptor(Message->msgHeader.ApiNumber);
+    return Descriptor && Descriptor->ReadOnly;
+}
@@ -41,4 +41,6 @@ public:
     // Return Value:
     // - A pointer to the reply message, if this message is to be completed inline; nullptr if this message will pend now and complete later.
     static PCONSOLE_API_MSG ConsoleDispatchRequest(_Inout_ PCONSOLE_API_MSG Message);
+
+    static bool IsReadOnlyRequest(const CONSOLE_API_MSG* const Message) noexcept;
 };
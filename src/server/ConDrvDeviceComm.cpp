@@ -31,6 +31,8 @@ ConDrvDeviceComm::~ConDrvDeviceComm() = default;
 
 // Routine Description:
 // - Retrieves a packet message from the driver representing the next action/activity that should be performed.
+// - The driver copies as much of the client's input into the packet as fits. The number of bytes it did copy
+//   is stored in pMessage->_cbReceived, which allows GetInputBuffer() to skip IOCTL_CONDRV_READ_INPUT for small payloads.
 // Arguments:
 // - pCompletion - Optional completion structure from the previous activity (can be used in lieu of calling CompleteIo separately.)
 // - pMessage - A structure to hold the message data retrieved from the driver.
@@ -39,11 +41,14 @@ ConDrvDeviceComm::~ConDrvDeviceComm() = default;
 [[nodiscard]] HRESULT ConDrvDeviceComm::ReadIo(_In_opt_ PCONSOLE_API_MSG const pReplyMsg,
                                                _Out_ CONSOLE_API_MSG* const pMessage) const
 {
+    DWORD cbReceived = 0;
     auto hr = _CallIoctl(IOCTL_CONDRV_READ_IO,
                          pReplyMsg == nullptr ? nullptr : &pReplyMsg->Complete,
                          pReplyMsg == nullptr ? 0 : sizeof(pReplyMsg->Complete),
                          &pMessage->Descriptor,
-                         sizeof(CONSOLE_API_MSG) - FIELD_OFFSET(CONSOLE_API_MSG, Descriptor));
+                         sizeof(CONSOLE_API_MSG) - FIELD_OFFSET(CONSOLE_API_MSG, Descriptor),
+                         &cbReceived);
+    pMessage->_cbReceived = SUCCEEDED(hr) ? cbReceived : 0;
 
     if (hr == HRESULT_FROM_WIN32(ERROR_IO_PENDING))
     {
@@ -126,16 +131,18 @@ ConDrvDeviceComm::~ConDrvDeviceComm() = default;
 // - cbInBufferSize - The length in bytes of the optional input buffer.
 // - pOutBuffer - An optional buffer to send as output with the verb. Usage depends on the control code.
 // - cbOutBufferSize - The length in bytes of the optional output buffer.
+// - pcbWritten - Optionally receives the number of bytes the driver wrote to the output buffer.
 // Return Value:
 // - HRESULT S_OK or suitable error.
 [[nodiscard]] HRESULT ConDrvDeviceComm::_CallIoctl(_In_ DWORD dwIoControlCode,
                                                    _In_reads_bytes_opt_(cbInBufferSize) PVOID pInBuffer,
                                                    _In_ DWORD cbInBufferSize,
                                                    _Out_writes_bytes_opt_(cbOutBufferSize) PVOID pOutBuffer,
-                                                   _In_ DWORD cbOutBufferSize) const
+                                                   _In_ DWORD cbOutBufferSize,
+                                                   _Out_opt_ DWORD* pcbWritten) const
 {
     // See: https://msdn.microsoft.com/en-us/library/windows/desktop/aa363216(v=vs.85).aspx
-    // Written is unused but cannot be nullptr because we aren't using overlapped.
+    // Written cannot be nullptr because we aren't using overlapped.
     DWORD cbWritten = 0;
     RETURN_IF_WIN32_BOOL_FALSE(DeviceIoControl(_Server.get(),
                                                dwIoControlCode,
@@ -146,6 +153,10 @@ ConDrvDeviceComm::~ConDrvDeviceComm() = default;
                                                &cbWritten,
                                                nullptr));
 
+    if (pcbWritten)
+    {
+        *pcbWritten = cbWritten;
+    }
     return S_OK;
 }
 
@@ -47,7 +47,8 @@ private:
                                      _In_reads_bytes_opt_(cbInBufferSize) PVOID pInBuffer,
                                      _In_ DWORD cbInBufferSize,
                                      _Out_writes_bytes_opt_(cbOutBufferSize) PVOID pOutBuffer,
-                                     _In_ DWORD cbOutBufferSize) const;
+                                     _In_ DWORD cbOutBufferSize,
+                                     _Out_opt_ DWORD* pcbWritten = nullptr) const;
 
     wil::unique_handle _Server;
 };
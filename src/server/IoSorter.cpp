@@ -15,6 +15,10 @@
 #include "../host/getset.h"
 #include "../host/stream.h"
 
+#include "../interactivity/inc/ServiceLocator.hpp"
+
+using Microsoft::Console::Interactivity::ServiceLocator;
+
 void IoSorter::ServiceIoOperation(_In_ CONSOLE_API_MSG* const pMsg,
                                   _Out_ CONSOLE_API_MSG** ReplyMsg)
 {
@@ -50,6 +54,9 @@ void IoSorter::ServiceIoOperation(_In_ CONSOLE_API_MSG* const pMsg,
         break;
 
     case CONSOLE_IO_RAW_WRITE:
+        // Raw writes have no API descriptor. Their payload starts right where we're about to put one,
+        // which means that the read-ahead data in the packet is overwritten and can't be used.
+        pMsg->_cbReceived = 0;
         ZeroMemory(&pMsg->u.consoleMsgL1.WriteConsole, sizeof(CONSOLE_WRITECONSOLE_MSG));
         pMsg->msgHeader.ApiNumber = API_NUMBER_WRITECONSOLE; // Required for Wait blocks to identify the right callback.
         ReplyPending = FALSE;
@@ -67,6 +74,7 @@ void IoSorter::ServiceIoOperation(_In_ CONSOLE_API_MSG* const pMsg,
         break;
 
     case CONSOLE_IO_RAW_READ:
+        pMsg->_cbReceived = 0;
         ZeroMemory(&pMsg->u.consoleMsgL1.ReadConsole, sizeof(CONSOLE_READCONSOLE_MSG));
         pMsg->msgHeader.ApiNumber = API_NUMBER_READCONSOLE; // Required for Wait blocks to identify the right callback.
         pMsg->u.consoleMsgL1.ReadConsole.ProcessControlZ = TRUE;
@@ -98,3 +106,58 @@ void IoSorter::ServiceIoOperation(_In_ CONSOLE_API_MSG* const pMsg,
         *ReplyMsg = pMsg;
     }
 }
+
+// Routine Description:
+// - Hands a read-only API call off to the thread pool, where it's serviced under the shared
+//   console lock and completed. This prevents queries like GetConsoleMode from being queued up
+//   behind bulk writes of other clients, which are still serviced in order by the IO thread.
+// Arguments:
+// - pMsg - The message that was just read by the IO thread. It's copied if it's handed off.
+// Return Value:
+// - True if the message was handed off and the caller must not reply to it.
+//   False if the caller should service it with ServiceIoOperation() instead.
+bool IoSorter::TryServiceIoOperationConcurrently(_In_ CONSOLE_API_MSG* const pMsg)
+{
+    if (!ApiSorter::IsReadOnlyRequest(pMsg))
+    {
+        return false;
+    }
+
+    std::unique_ptr<CONSOLE_API_MSG> msg;
+    try
+    {
+        msg = std::make_unique<CONSOLE_API_MSG>(*pMsg);
+    }
+    catch (...)
+    {
+        LOG_CAUGHT_EXCEPTION();
+        return false;
+    }
+
+    if (!TrySubmitThreadpoolCallback(&s_ConcurrentIoCallback, msg.get(), nullptr))
+    {
+        LOG_LAST_ERROR();
+        return false;
+    }
+
+    msg.release();
+    return true;
+}
+
+void CALLBACK IoSorter::s_ConcurrentIoCallback(PTP_CALLBACK_INSTANCE /*instance*/, void* context) noexcept
+{
+    const std::unique_ptr<CONSOLE_API_MSG> msg{ static_cast<CONSOLE_API_MSG*>(context) };
+    auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+
+    CONSOLE_API_MSG* ReplyMsg = nullptr;
+    gci.LockConsoleShared();
+    ServiceIoOperation(msg.get(), &ReplyMsg);
+    gci.UnlockConsoleShared();
+
+    // None of the read-only APIs wait, so there's always a reply.
+    if (ReplyMsg)
+    {
+        LOG_IF_FAILED(ReplyMsg->ReleaseMessageBuffers());
+        LOG_IF_FAILED(ReplyMsg->_pDeviceComm->CompleteIo(&ReplyMsg->Complete));
+    }
+}
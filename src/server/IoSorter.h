@@ -25,4 +25,9 @@ public:
     // TODO: MSFT: 9115192 - probably not void.
     static void ServiceIoOperation(_In_ CONSOLE_API_MSG* const pMsg,
                                    _Out_ CONSOLE_API_MSG** ReplyMsg);
+
+    static bool TryServiceIoOperationConcurrently(_In_ CONSOLE_API_MSG* const pMsg);
+
+private:
+    static void CALLBACK s_ConcurrentIoCallback(PTP_CALLBACK_INSTANCE instance, void* context) noexcept;
 };
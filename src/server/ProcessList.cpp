@@ -41,6 +41,11 @@ using namespace Microsoft::Console::Interactivity;
     {
         pProcessData = std::make_unique<ConsoleProcessHandle>(dwProcessId, dwThreadId, ulProcessGroupId);
         _processes.emplace_back(pProcessData.get());
+
+        // If the index can't grow, undo the append so that both containers stay in sync.
+        auto popProcess = wil::scope_exit([&]() noexcept { _processes.pop_back(); });
+        _processesById.emplace(dwProcessId, pProcessData.get());
+        popProcess.release();
     }
     CATCH_RETURN();
 
@@ -59,10 +64,18 @@ void ConsoleProcessList::FreeProcessData(_In_ ConsoleProcessHandle* const pProce
 {
     assert(ServiceLocator::LocateGlobals().getConsoleInformation().IsConsoleLocked());
 
-    const auto it = std::ranges::find(_processes, pProcessData);
-    if (it != _processes.end())
+    // The PID index tells us in constant time whether we know this pointer,
+    // without having to walk the entire list for it first.
+    const auto indexIt = _processesById.find(pProcessData->dwProcessId);
+    if (indexIt != _processesById.end() && indexIt->second == pProcessData)
     {
-        _processes.erase(it);
+        _processesById.erase(indexIt);
+
+        // Newly attached processes are usually the first ones to go away again,
+        // so we search from the back. The erase itself only moves a few pointers.
+        const auto it = std::find(_processes.rbegin(), _processes.rend(), pProcessData);
+        assert(it != _processes.rend());
+        _processes.erase(std::next(it).base());
         delete pProcessData;
     }
     else
@@ -84,15 +97,8 @@ ConsoleProcessHandle* ConsoleProcessList::FindProcessInList(const DWORD dwProces
 {
     assert(ServiceLocator::LocateGlobals().getConsoleInformation().IsConsoleLocked());
 
-    for (const auto& p : _processes)
-    {
-        if (p->dwProcessId == dwProcessId)
-        {
-            return p;
-        }
-    }
-
-    return nullptr;
+    const auto it = _processesById.find(dwProcessId);
+    return it != _processesById.end() ? it->second : nullptr;
 }
 
 // Routine Description:
@@ -58,7 +58,10 @@ public:
     bool IsEmpty() const;
 
 private:
+    // _processes is kept in the order the clients attached in (oldest first),
+    // while _processesById indexes the same handles for lookups by PID.
     std::vector<ConsoleProcessHandle*> _processes;
+    std::unordered_map<DWORD, ConsoleProcessHandle*> _processesById;
 
     void _ModifyProcessForegroundRights(const HANDLE hProcess, const bool fForeground) const;
 };
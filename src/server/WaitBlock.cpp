@@ -16,7 +16,7 @@
 // Routine Description:
 // - Initializes a ConsoleWaitBlock
 // - ConsoleWaitBlocks will mostly self-manage their position in their two queues.
-// - They will be pushed into the tail and the resulting iterator stored for constant deletion time later.
+// - They will be pushed into the tail, with intrusive links for constant deletion time later.
 // Arguments:
 // - pProcessQueue - The queue attached to the client process ID that requested this action
 // - pObjectQueue - The queue attached to the console object that will service the action when data arrives
@@ -31,6 +31,9 @@ ConsoleWaitBlock::ConsoleWaitBlock(_In_ ConsoleWaitQueue* const pProcessQueue,
     _WaitReplyMessage(*pWaitReplyMessage),
     _pWaiter(THROW_HR_IF_NULL(E_INVALIDARG, pWaiter))
 {
+    _processQueueLink.block = this;
+    _objectQueueLink.block = this;
+
     // MSFT-33127449, GH#9692
     // Until there's a "Wait", there's only one API message inflight at a time. In our
     // quest for performance, we put that single API message in charge of its own
@@ -66,12 +69,12 @@ ConsoleWaitBlock::ConsoleWaitBlock(_In_ ConsoleWaitQueue* const pProcessQueue,
 
 // Routine Description:
 // - Destroys a ConsolewaitBlock
-// - On deletion, ConsoleWaitBlocks will erase themselves from the process and object queues in
-//   constant time with the iterator acquired on construction.
+// - On deletion, ConsoleWaitBlocks will unlink themselves from the process and object queues in
+//   constant time.
 ConsoleWaitBlock::~ConsoleWaitBlock()
 {
-    _pProcessQueue->_blocks.erase(_itProcessQueue);
-    _pObjectQueue->_blocks.erase(_itObjectQueue);
+    ConsoleWaitQueue::_Unlink(_processQueueLink);
+    ConsoleWaitQueue::_Unlink(_objectQueueLink);
     delete _pWaiter;
 }
 
@@ -106,9 +109,10 @@ ConsoleWaitBlock::~ConsoleWaitBlock()
                                           pWaitReplyMessage,
                                           pWaiter);
 
-        // Set the iterators on the wait block so that it can remove itself later.
-        pWaitBlock->_itProcessQueue = pProcessQueue->_blocks.insert(pProcessQueue->_blocks.end(), pWaitBlock);
-        pWaitBlock->_itObjectQueue = pObjectQueue->_blocks.insert(pObjectQueue->_blocks.end(), pWaitBlock);
+        // Link the wait block into both queues. It will unlink itself later.
+        // Unlike the allocation above, this can't fail.
+        pProcessQueue->_PushBack(pWaitBlock->_processQueueLink);
+        pObjectQueue->_PushBack(pWaitBlock->_objectQueueLink);
     }
     catch (...)
     {
@@ -21,9 +21,17 @@ Revision History:
 #include "IWaitRoutine.h"
 #include "WaitTerminationReason.h"
 
-#include <list>
-
 class ConsoleWaitQueue;
+class ConsoleWaitBlock;
+
+// An intrusive link in a ConsoleWaitQueue. Each block embeds one for each of
+// the two queues it lives in, so that neither enqueuing nor removing it allocates.
+struct ConsoleWaitLink
+{
+    ConsoleWaitLink* prev = nullptr;
+    ConsoleWaitLink* next = nullptr;
+    ConsoleWaitBlock* block = nullptr;
+};
 
 class ConsoleWaitBlock
 {
@@ -42,10 +50,10 @@ private:
                      _In_ IWaitRoutine* const pWaiter);
 
     ConsoleWaitQueue* const _pProcessQueue;
-    std::_List_const_iterator<std::_List_val<std::_List_simple_types<ConsoleWaitBlock*>>> _itProcessQueue;
+    ConsoleWaitLink _processQueueLink;
 
     ConsoleWaitQueue* const _pObjectQueue;
-    std::_List_const_iterator<std::_List_val<std::_List_simple_types<ConsoleWaitBlock*>>> _itObjectQueue;
+    ConsoleWaitLink _objectQueueLink;
 
     CONSOLE_API_MSG _WaitReplyMessage;
 
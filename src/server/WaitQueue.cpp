@@ -11,9 +11,10 @@
 
 // Routine Description:
 // - Instantiates a new ConsoleWaitQueue
-ConsoleWaitQueue::ConsoleWaitQueue() :
-    _blocks()
+ConsoleWaitQueue::ConsoleWaitQueue()
 {
+    _head.prev = &_head;
+    _head.next = &_head;
 }
 
 // Routine Description:
@@ -76,16 +77,16 @@ bool ConsoleWaitQueue::NotifyWaiters(const bool fNotifyAll,
 {
     auto fResult = false;
 
-    auto it = _blocks.cbegin();
-    while (!_blocks.empty() && it != _blocks.cend())
+    auto link = _head.next;
+    while (link != &_head)
     {
-        const auto WaitBlock = (*it);
+        const auto WaitBlock = link->block;
         if (nullptr == WaitBlock)
         {
             break;
         }
 
-        const auto nextIt = std::next(it); // we have to capture next before it is potentially erased
+        const auto next = link->next; // we have to capture next before it is potentially unlinked
 
         if (_NotifyBlock(WaitBlock, TerminationReason))
         {
@@ -97,12 +98,39 @@ bool ConsoleWaitQueue::NotifyWaiters(const bool fNotifyAll,
             break;
         }
 
-        it = nextIt;
+        link = next;
     }
 
     return fResult;
 }
 
+// Routine Description:
+// - Appends the given link (embedded in a ConsoleWaitBlock) to the end of this queue.
+// Arguments:
+// - link - The unlinked link to append.
+void ConsoleWaitQueue::_PushBack(ConsoleWaitLink& link) noexcept
+{
+    link.prev = _head.prev;
+    link.next = &_head;
+    _head.prev->next = &link;
+    _head.prev = &link;
+}
+
+// Routine Description:
+// - Removes the given link from whichever queue it's in, in constant time.
+// Arguments:
+// - link - The link to remove. Does nothing if it isn't in a queue.
+void ConsoleWaitQueue::_Unlink(ConsoleWaitLink& link) noexcept
+{
+    if (link.next)
+    {
+        link.prev->next = link.next;
+        link.next->prev = link.prev;
+        link.prev = nullptr;
+        link.next = nullptr;
+    }
+}
+
 // Routine Description:
 // - A helper to delete successfully notified callbacks
 // Arguments:
@@ -17,8 +17,6 @@ Revision History:
 
 #pragma once
 
-#include <list>
-
 #include "../host/conapi.h"
 
 #include "IWaitRoutine.h"
@@ -32,6 +30,9 @@ public:
 
     ~ConsoleWaitQueue();
 
+    ConsoleWaitQueue(const ConsoleWaitQueue&) = delete;
+    ConsoleWaitQueue& operator=(const ConsoleWaitQueue&) = delete;
+
     bool NotifyWaiters(const bool fNotifyAll);
 
     bool NotifyWaiters(const bool fNotifyAll,
@@ -44,7 +45,11 @@ private:
     bool _NotifyBlock(_In_ ConsoleWaitBlock* pWaitBlock,
                       const WaitTerminationReason TerminationReason);
 
-    std::list<ConsoleWaitBlock*> _blocks;
+    void _PushBack(ConsoleWaitLink& link) noexcept;
+    static void _Unlink(ConsoleWaitLink& link) noexcept;
+
+    // The sentinel of a circular, doubly linked list of the links embedded in each ConsoleWaitBlock.
+    ConsoleWaitLink _head;
 
     friend class ConsoleWaitBlock; // Blocks live in multiple queues so we let them manage the lifetime.
 };
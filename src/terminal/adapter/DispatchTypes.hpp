@@ -440,6 +440,7 @@ namespace Microsoft::Console::VirtualTerminal::DispatchTypes
         ASB_AlternateScreenBuffer = DECPrivateMode(1049),
         XTERM_BracketedPasteMode = DECPrivateMode(2004),
         W32IM_Win32InputMode = DECPrivateMode(9001),
+        W32IM_Win32BinaryInputMode = DECPrivateMode(9002),
     };
 
     enum CharacterSets : uint64_t
@@ -533,6 +534,13 @@ namespace Microsoft::Console::VirtualTerminal::DispatchTypes
         Size96 = 1
     };
 
+    enum class SixelBackground : VTInt
+    {
+        Default = 0,
+        Transparent = 1,
+        Opaque = 2
+    };
+
     enum class MacroDeleteControl : VTInt
     {
         DeleteId = 0,
@@ -576,6 +584,7 @@ namespace Microsoft::Console::VirtualTerminal::DispatchTypes
         til::point end; // exclusive
         std::optional<til::point> commandEnd;
         std::optional<til::point> outputEnd;
+        std::optional<unsigned int> exitCode; // As reported by FTCS_COMMAND_FINISHED, if any.
 
         MarkCategory category{ MarkCategory::Info };
         // Other things we may want to think about in the future are listed in
@@ -300,6 +300,7 @@ void FontBuffer::_prepareNextCharacter()
     _currentCharBuffer = std::next(_buffer.begin(), gsl::narrow_cast<size_t>(_currentChar * _fullHeight));
     _sixelColumn = 0;
     _sixelRow = 0;
+    _sixelBand = {};
 
     // If the buffer hasn't been cleared, we'll need to clear each character
     // position individually, before adding any new sixel data.
@@ -313,24 +314,60 @@ void FontBuffer::_addSixelValue(const VTInt value) noexcept
 {
     if (_currentChar < MAX_CHARS && _sixelColumn < _textWidth)
     {
-        // Each sixel updates six pixels of a single column, so we setup a bit
-        // mask for the column we want to update, and then set that bit in each
-        // row for which there is a corresponding "on" bit in the input value.
-        const auto outputColumnBit = (0x8000 >> (_sixelColumn + _textOffset));
-        auto outputIterator = _currentCharBuffer;
-        auto inputValueMask = 1;
-        for (VTInt i = 0; i < 6 && _sixelRow + i < _fullHeight; i++)
+        // Each sixel updates six pixels of a single column. Rather than setting
+        // those bits one by one, we collect the sixels of the current line, and
+        // transpose them into the six scanlines once the line is complete. The
+        // columns are stored in reverse, since the leftmost column of a scanline
+        // is its most significant bit.
+        til::at(_sixelBand, MAX_WIDTH - 1 - (_sixelColumn + _textOffset)) |= gsl::narrow_cast<uint8_t>(value);
+    }
+    _sixelColumn++;
+}
+
+void FontBuffer::_flushSixelBand() noexcept
+{
+    if (_currentChar >= MAX_CHARS)
+    {
+        return;
+    }
+
+    const auto rows = std::min(6, _fullHeight - _sixelRow);
+    auto outputIterator = _currentCharBuffer;
+
+#pragma warning(push)
+#pragma warning(disable : 26490) // Don't use reinterpret_cast (type.1).
+#if defined(_M_AMD64)
+    // Shifting each 16-bit lane left by 7-i moves bit i of both of its bytes
+    // into their most significant bit, which _mm_movemask_epi8 then gathers
+    // into a single 16-bit scanline, one bit per column.
+    const auto band = _mm_loadu_si128(reinterpret_cast<const __m128i*>(_sixelBand.data()));
+    for (VTInt i = 0; i < rows; i++)
+    {
+        const auto shifted = _mm_sll_epi16(band, _mm_cvtsi32_si128(7 - i));
+        *outputIterator |= gsl::narrow_cast<uint16_t>(_mm_movemask_epi8(shifted));
+        ++outputIterator;
+    }
+#else
+    for (VTInt i = 0; i < rows; i++)
+    {
+        uint16_t scanline = 0;
+        for (VTInt column = 0; column < MAX_WIDTH; column++)
         {
-            *outputIterator |= (value & inputValueMask) ? outputColumnBit : 0;
-            ++outputIterator;
-            inputValueMask <<= 1;
+            scanline |= gsl::narrow_cast<uint16_t>(((til::at(_sixelBand, column) >> i) & 1) << column);
         }
+        *outputIterator |= scanline;
+        ++outputIterator;
     }
-    _sixelColumn++;
+#endif
+#pragma warning(pop)
 }
 
 void FontBuffer::_endOfSixelLine()
 {
+    // Transfer the sixels of the line we just finished into the bit patterns.
+    _flushSixelBand();
+    _sixelBand = {};
+
     // Move down six rows to the get to the next sixel position.
     std::advance(_currentCharBuffer, 6);
     _sixelRow += 6;
@@ -496,15 +533,19 @@ void FontBuffer::_packAndCenterBitPatterns() noexcept
     // Initially the characters are written to the buffer assuming the maximum
     // cell height, but now that we know the true height, we need to pack the
     // buffer data so that each character occupies the exact number of scanlines
-    // that are required.
-    for (size_t srcLine = 0, dstLine = 0; srcLine < _buffer.size(); srcLine++)
+    // that are required. We process a whole character at a time, since that's
+    // a contiguous run of scanlines that the compiler can vectorize, and the
+    // destination never overtakes the source, so this can be done in place.
+    const auto height = gsl::narrow_cast<size_t>(_fullHeight);
+    const auto mask = gsl::narrow_cast<uint16_t>(textClippingMask);
+    for (size_t ch = 0; ch < MAX_CHARS; ch++)
     {
-        if (gsl::narrow_cast<VTInt>(srcLine % MAX_HEIGHT) < _fullHeight)
+        const auto srcLine = ch * MAX_HEIGHT;
+        const auto dstLine = ch * height;
+        for (size_t line = 0; line < height; line++)
         {
-            auto characterScanline = til::at(_buffer, srcLine);
-            characterScanline &= textClippingMask;
-            characterScanline >>= _textOffset;
-            til::at(_buffer, dstLine++) = characterScanline;
+            const auto characterScanline = til::at(_buffer, srcLine + line) & mask;
+            til::at(_buffer, dstLine + line) = gsl::narrow_cast<uint16_t>(characterScanline >> _textOffset);
         }
     }
 }
@@ -44,6 +44,7 @@ namespace Microsoft::Console::VirtualTerminal
         void _prepareCharacterBuffer();
         void _prepareNextCharacter();
         void _addSixelValue(const VTInt value) noexcept;
+        void _flushSixelBand() noexcept;
         void _endOfSixelLine();
         void _endOfCharacter();
 
@@ -91,5 +92,7 @@ namespace Microsoft::Console::VirtualTerminal
         bool _bufferCleared;
         VTInt _sixelColumn;
         VTInt _sixelRow;
+        // The sixel values of the current line, indexed by MAX_WIDTH - 1 - column.
+        std::array<uint8_t, MAX_WIDTH> _sixelBand{};
     };
 }
@@ -141,6 +141,10 @@ public:
                                        const VTParameter cellHeight,
                                        const DispatchTypes::DrcsCharsetSize charsetSize) = 0; // DECDLD
 
+    virtual StringHandler DefineSixelImage(const VTInt aspectRatio,
+                                           const DispatchTypes::SixelBackground backgroundSelect,
+                                           const VTParameter backgroundColor) = 0; // SIXEL
+
     virtual StringHandler DefineMacro(const VTInt macroId,
                                       const DispatchTypes::MacroDeleteControl deleteControl,
                                       const DispatchTypes::MacroEncoding encoding) = 0; // DECDMAC
@@ -8,6 +8,71 @@
 
 using namespace Microsoft::Console::VirtualTerminal;
 
+// These are the characters that StateMachine::ProcessString() can't print as part
+// of a run of text in the ground state: C0 and C1 controls, and DEL.
+static constexpr bool _isActionable(const wchar_t ch) noexcept
+{
+    return ch <= AsciiChars::US || (ch >= AsciiChars::DEL && ch <= L'\x9F');
+}
+
+// Returns the end of the sequence (or control character) starting at the given
+// offset. This is only an estimate of how the state machine will parse it, so
+// the text runs can be split off. It doesn't need to be exact, because text
+// runs that turn out to be part of a sequence are still processed as such.
+static size_t _findSequenceEnd(const std::wstring_view macro, size_t i) noexcept
+{
+    if (til::at(macro, i++) != AsciiChars::ESC || i >= macro.size())
+    {
+        return i;
+    }
+
+    const auto inRange = [&](const wchar_t lo, const wchar_t hi) noexcept {
+        return i < macro.size() && til::at(macro, i) >= lo && til::at(macro, i) <= hi;
+    };
+
+    switch (til::at(macro, i))
+    {
+    case L'[':
+        i++;
+        while (inRange(L' ', L'?'))
+        {
+            i++;
+        }
+        if (inRange(L'@', L'~'))
+        {
+            i++;
+        }
+        return i;
+    case L']':
+    case L'P':
+    case L'X':
+    case L'^':
+    case L'_':
+        for (i++; i < macro.size(); i++)
+        {
+            if (til::at(macro, i) == AsciiChars::BEL)
+            {
+                return i + 1;
+            }
+            if (til::at(macro, i) == AsciiChars::ESC && i + 1 < macro.size() && til::at(macro, i + 1) == L'\\')
+            {
+                return i + 2;
+            }
+        }
+        return i;
+    default:
+        while (inRange(L' ', L'/'))
+        {
+            i++;
+        }
+        if (inRange(L'0', L'~'))
+        {
+            i++;
+        }
+        return i;
+    }
+}
+
 size_t MacroBuffer::GetSpaceAvailable() const noexcept
 {
     return MAX_SPACE - _spaceUsed;
@@ -53,7 +118,32 @@ void MacroBuffer::InvokeMacro(const size_t macroId, StateMachine& stateMachine)
                     _invokedSequenceLength = 0;
                 }
             });
-            stateMachine.ProcessString(macroSequence);
+
+            // Macros are typically invoked over and over again, so they're split
+            // into text runs and sequences once, and the text runs can then be
+            // printed without the state machine having to scan them each time.
+            auto& segments = til::at(_segments, macroId);
+            if (segments.empty() && !macroSequence.empty())
+            {
+                _buildSegments(macroSequence, segments);
+            }
+
+            // The segments are accessed by index, because ClearMacrosIfInUse()
+            // may modify them while we're still playing them back. It never
+            // resizes them, though, and they can't be redefined until we're done.
+            for (size_t i = 0; i < segments.size(); i++)
+            {
+                const auto segment = til::at(segments, i);
+                const auto text = std::wstring_view{ macroSequence }.substr(segment.offset, segment.length);
+                if (segment.printable)
+                {
+                    stateMachine.ProcessPrintableString(text);
+                }
+                else
+                {
+                    stateMachine.ProcessString(text);
+                }
+            }
         }
     }
 }
@@ -70,6 +160,15 @@ void MacroBuffer::ClearMacrosIfInUse()
         {
             std::fill(macro.begin(), macro.end(), AsciiChars::NUL);
         }
+        // The NULs mustn't be printed, so the text runs need to be processed
+        // by the state machine like the rest of the sequence now.
+        for (auto& segments : _segments)
+        {
+            for (auto& segment : segments)
+            {
+                segment.printable = false;
+            }
+        }
     }
 }
 
@@ -83,6 +182,17 @@ bool MacroBuffer::InitParser(const size_t macroId, const DispatchTypes::MacroDel
         _decodedChar = 0;
         _repeatPending = false;
 
+        // Any previously cached segments are no longer valid once the macro
+        // is redefined, or all of them for that matter if they're deleted.
+        if (deleteControl == DispatchTypes::MacroDeleteControl::DeleteAll)
+        {
+            for (auto& segments : _segments)
+            {
+                segments.clear();
+            }
+        }
+        til::at(_segments, macroId).clear();
+
         switch (encoding)
         {
         case DispatchTypes::MacroEncoding::HexPair:
@@ -244,6 +354,33 @@ void MacroBuffer::_deleteMacro(std::wstring& macro) noexcept
     std::wstring{}.swap(macro);
 }
 
+void MacroBuffer::_buildSegments(const std::wstring_view macro, std::vector<Segment>& segments)
+{
+    size_t i = 0;
+    while (i < macro.size())
+    {
+        const auto begin = i;
+        const auto printable = !_isActionable(til::at(macro, i));
+        if (printable)
+        {
+            while (i < macro.size() && !_isActionable(til::at(macro, i)))
+            {
+                i++;
+            }
+        }
+        else
+        {
+            // Consecutive sequences are combined into a single segment,
+            // since they're processed the same way anyway.
+            while (i < macro.size() && _isActionable(til::at(macro, i)))
+            {
+                i = _findSequenceEnd(macro, i);
+            }
+        }
+        segments.push_back({ begin, i - begin, printable });
+    }
+}
+
 bool MacroBuffer::_applyPendingRepeat()
 {
     if (_repeatCount > 1)
@@ -15,6 +15,7 @@ Abstract:
 #include <array>
 #include <bitset>
 #include <string>
+#include <vector>
 
 // fwdecl unittest classes
 #ifdef UNIT_TESTING
@@ -53,6 +54,16 @@ namespace Microsoft::Console::VirtualTerminal
         void _deleteMacro(std::wstring& macro) noexcept;
         bool _applyPendingRepeat();
 
+        struct Segment
+        {
+            size_t offset;
+            size_t length;
+            // True if the segment is a run of text without any control characters.
+            bool printable;
+        };
+
+        static void _buildSegments(const std::wstring_view macro, std::vector<Segment>& segments);
+
         enum class State
         {
             ExpectingText,
@@ -67,6 +78,8 @@ namespace Microsoft::Console::VirtualTerminal
         size_t _repeatCount{ 0 };
         size_t _repeatStart{ 0 };
         std::array<std::wstring, 64> _macros;
+        // The cached segments of each macro, built on its first invocation.
+        std::array<std::vector<Segment>, 64> _segments;
         size_t _activeMacroId{ 0 };
         size_t _spaceUsed{ 0 };
         size_t _invokedDepth{ 0 };
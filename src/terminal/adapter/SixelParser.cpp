@@ -0,0 +1,260 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include "SixelParser.hpp"
+#include "../../types/inc/utils.hpp"
+
+using namespace Microsoft::Console::Utils;
+using namespace Microsoft::Console::VirtualTerminal;
+
+// The default color table of a VT340.
+static constexpr std::array<til::color, 16> defaultColors{
+    til::color{ 0, 0, 0 },
+    til::color{ 51, 51, 204 },
+    til::color{ 204, 36, 36 },
+    til::color{ 51, 204, 51 },
+    til::color{ 204, 51, 204 },
+    til::color{ 51, 204, 204 },
+    til::color{ 204, 204, 51 },
+    til::color{ 120, 120, 120 },
+    til::color{ 69, 69, 69 },
+    til::color{ 87, 87, 153 },
+    til::color{ 153, 69, 69 },
+    til::color{ 87, 153, 87 },
+    til::color{ 153, 87, 153 },
+    til::color{ 87, 153, 153 },
+    til::color{ 153, 153, 87 },
+    til::color{ 204, 204, 204 },
+};
+
+SixelParser::SixelParser(const VTInt aspectRatio, const DispatchTypes::SixelBackground backgroundSelect) noexcept :
+    _transparentBackground{ backgroundSelect == DispatchTypes::SixelBackground::Transparent }
+{
+    // The first parameter of the sequence selects the aspect ratio. 2:1 is the default.
+    switch (aspectRatio)
+    {
+    case 2:
+        _pixelHeight = 5;
+        break;
+    case 3:
+    case 4:
+        _pixelHeight = 3;
+        break;
+    case 7:
+    case 8:
+    case 9:
+        _pixelHeight = 1;
+        break;
+    default:
+        _pixelHeight = 2;
+        break;
+    }
+
+    for (size_t i = 0; i < _colorTable.size(); ++i)
+    {
+        _colorTable.at(i) = defaultColors.at(i % defaultColors.size()).abgr;
+    }
+}
+
+void SixelParser::AddData(const wchar_t ch)
+{
+    if (_state != State::Data)
+    {
+        if (ch >= L'0' && ch <= L'9')
+        {
+            auto& param = til::at(_params, std::min(_paramCount, _params.size() - 1));
+            param = std::min(param * 10 + (ch - L'0'), 99999);
+            return;
+        }
+        if (ch == L';')
+        {
+            _paramCount = std::min(_paramCount + 1, _params.size());
+            return;
+        }
+
+        // Any other character terminates the command, but it's then processed as usual.
+        _executeCommand();
+    }
+
+    switch (ch)
+    {
+    case L'!':
+    case L'#':
+    case L'"':
+        _state = ch == L'!' ? State::Repeat : (ch == L'#' ? State::Color : State::Raster);
+        _params = {};
+        _paramCount = 0;
+        break;
+    case L'$':
+        _x = 0;
+        break;
+    case L'-':
+        _x = 0;
+        _y += 6 * _pixelHeight;
+        break;
+    default:
+        if (ch >= L'?' && ch <= L'~')
+        {
+            _addSixel(ch - L'?');
+        }
+        break;
+    }
+}
+
+// Called once the data string has been received. If the image
+// doesn't have a transparent background, this fills it in.
+void SixelParser::Finalize()
+{
+    if (_state != State::Data)
+    {
+        _executeCommand();
+    }
+
+    _resize(_usedWidth, _usedHeight);
+
+    if (!_transparentBackground)
+    {
+        const auto background = _colorTable.front();
+        for (auto& pixel : _pixels)
+        {
+            if (!pixel)
+            {
+                pixel = background;
+            }
+        }
+    }
+}
+
+til::size SixelParser::GetSize() const noexcept
+{
+    return { _usedWidth, _usedHeight };
+}
+
+// The pixels of the image as 0xAABBGGRR, GetSize().width pixels per line. Only valid after Finalize().
+std::span<const uint32_t> SixelParser::GetPixels() const noexcept
+{
+    return _pixels;
+}
+
+void SixelParser::_executeCommand() noexcept
+{
+    const auto count = std::min(_paramCount + 1, _params.size());
+
+    switch (_state)
+    {
+    case State::Repeat:
+        _repeatCount = std::max(_params.front(), 1);
+        break;
+    case State::Color:
+        if (count >= 5)
+        {
+            _defineColor();
+        }
+        _colorIndex = static_cast<size_t>(_params.front()) % _colorTable.size();
+        break;
+    case State::Raster:
+        // "Pan;Pad;Ph;Pv: The aspect ratio overrides the one of the DCS parameters,
+        // and the width and height declare the size of the background.
+        if (count >= 2 && _params.at(0) && _params.at(1))
+        {
+            _pixelHeight = std::clamp((_params.at(0) + _params.at(1) / 2) / _params.at(1), 1, 10);
+        }
+        if (count >= 4)
+        {
+            _usedWidth = std::clamp(_params.at(2), _usedWidth, MaxWidth);
+            _usedHeight = std::clamp(_params.at(3), _usedHeight, MaxHeight);
+        }
+        break;
+    default:
+        break;
+    }
+
+    _state = State::Data;
+}
+
+void SixelParser::_defineColor() noexcept
+{
+    const auto index = static_cast<size_t>(_params.at(0)) % _colorTable.size();
+    const auto x = _params.at(2);
+    const auto y = _params.at(3);
+    const auto z = _params.at(4);
+
+    switch (static_cast<DispatchTypes::ColorModel>(_params.at(1)))
+    {
+    case DispatchTypes::ColorModel::HLS:
+        _colorTable.at(index) = ColorFromHLS(x, y, z).abgr;
+        break;
+    case DispatchTypes::ColorModel::RGB:
+        _colorTable.at(index) = ColorFromRGB100(x, y, z).abgr;
+        break;
+    default:
+        break;
+    }
+}
+
+// Draws the 6 vertical dots of a sixel, _repeatCount times.
+void SixelParser::_addSixel(const VTInt value)
+{
+    const auto repeat = std::exchange(_repeatCount, 1);
+    const auto x1 = std::min(_x, MaxWidth);
+    const auto x2 = std::min(_x + repeat, MaxWidth);
+    _x += repeat;
+
+    if (x1 >= x2 || _y >= MaxHeight)
+    {
+        return;
+    }
+
+    const auto y2 = std::min(_y + 6 * _pixelHeight, MaxHeight);
+    _usedWidth = std::max(_usedWidth, x2);
+    _usedHeight = std::max(_usedHeight, y2);
+
+    // Grow the buffer by at least 50% at a time to amortize the copies.
+    if (x2 > _width || y2 > _height)
+    {
+        const auto width = x2 > _width ? std::min(std::max(x2, _width + _width / 2), MaxWidth) : _width;
+        const auto height = y2 > _height ? std::min(std::max(y2, _height + _height / 2), MaxHeight) : _height;
+        _resize(width, height);
+    }
+
+    const auto color = til::at(_colorTable, _colorIndex);
+
+    for (VTInt bit = 0; bit < 6; ++bit)
+    {
+        if (!(value & (1 << bit)))
+        {
+            continue;
+        }
+
+        const auto top = _y + bit * _pixelHeight;
+        const auto bottom = std::min(top + _pixelHeight, MaxHeight);
+        for (auto y = top; y < bottom; ++y)
+        {
+            const auto line = _pixels.begin() + static_cast<size_t>(y) * _width;
+            std::fill(line + x1, line + x2, color);
+        }
+    }
+}
+
+void SixelParser::_resize(const VTInt width, const VTInt height)
+{
+    if (width == _width && height == _height)
+    {
+        return;
+    }
+
+    std::vector<uint32_t> pixels(static_cast<size_t>(width) * height);
+    const auto copyWidth = std::min(width, _width);
+    const auto copyHeight = std::min(height, _height);
+
+    for (VTInt y = 0; y < copyHeight; ++y)
+    {
+        const auto src = _pixels.begin() + static_cast<size_t>(y) * _width;
+        std::copy(src, src + copyWidth, pixels.begin() + static_cast<size_t>(y) * width);
+    }
+
+    _pixels = std::move(pixels);
+    _width = width;
+    _height = height;
+}
@@ -0,0 +1,71 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- SixelParser.hpp
+
+Abstract:
+- This decodes the data string of the sixel graphics DCS sequence into an image.
+- The image is decoded incrementally as the data string is received and is
+  then written into the rows of the TextBuffer (see ImageSlice) by AdaptDispatch.
+--*/
+
+#pragma once
+
+#include "DispatchTypes.hpp"
+
+namespace Microsoft::Console::VirtualTerminal
+{
+    class SixelParser
+    {
+    public:
+        // The image is stored at the cell size of a VT340, which is what most sixel applications expect.
+        static constexpr til::size CellSize{ 10, 20 };
+        // Anything beyond this is clipped. This keeps a single image below 64 MiB.
+        static constexpr VTInt MaxWidth = 4096;
+        static constexpr VTInt MaxHeight = 4096;
+
+        SixelParser(const VTInt aspectRatio, const DispatchTypes::SixelBackground backgroundSelect) noexcept;
+
+        void AddData(const wchar_t ch);
+        void Finalize();
+
+        til::size GetSize() const noexcept;
+        std::span<const uint32_t> GetPixels() const noexcept;
+
+    private:
+        enum class State
+        {
+            Data,
+            Repeat,
+            Color,
+            Raster
+        };
+
+        void _executeCommand() noexcept;
+        void _defineColor() noexcept;
+        void _addSixel(const VTInt value);
+        void _resize(const VTInt width, const VTInt height);
+
+        State _state = State::Data;
+        std::array<VTInt, 5> _params{};
+        size_t _paramCount = 0;
+
+        // The number of pixels each sixel is tall, as given by the aspect ratio.
+        VTInt _pixelHeight = 2;
+        bool _transparentBackground = false;
+        VTInt _repeatCount = 1;
+        size_t _colorIndex = 0;
+        std::array<uint32_t, 256> _colorTable{};
+
+        VTInt _x = 0;
+        VTInt _y = 0;
+        // The size of _pixels and the declared or used size of the image.
+        VTInt _width = 0;
+        VTInt _height = 0;
+        VTInt _usedWidth = 0;
+        VTInt _usedHeight = 0;
+        std::vector<uint32_t> _pixels;
+    };
+}
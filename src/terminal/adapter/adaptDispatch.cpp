@@ -11,6 +11,8 @@
 #include "../../inc/unicode.hpp"
 #include "../parser/ascii.hpp"
 
+#include <til/hash.h>
+
 using namespace Microsoft::Console::Types;
 using namespace Microsoft::Console::Render;
 using namespace Microsoft::Console::VirtualTerminal;
@@ -25,6 +27,13 @@ AdaptDispatch::AdaptDispatch(ITerminalApi& api, Renderer& renderer, RenderSettin
 {
 }
 
+// Routine Description:
+// - Returns true if DECSTBM restricted scrolling to a part of the page.
+bool AdaptDispatch::AreScrollMarginsSet() const noexcept
+{
+    return _scrollMargins.top < _scrollMargins.bottom;
+}
+
 // Routine Description:
 // - Translates and displays a single character
 // Arguments:
@@ -556,27 +565,11 @@ void AdaptDispatch::_ScrollRectHorizontally(TextBuffer& textBuffer, const til::r
     if (absoluteDelta < scrollRect.width())
     {
         const auto left = delta > 0 ? scrollRect.left : (scrollRect.left + absoluteDelta);
-        const auto top = scrollRect.top;
         const auto width = scrollRect.width() - absoluteDelta;
-        const auto height = scrollRect.height();
         const auto actualDelta = delta > 0 ? absoluteDelta : -absoluteDelta;
-
-        const auto source = Viewport::FromDimensions({ left, top }, width, height);
-        const auto target = Viewport::Offset(source, { actualDelta, 0 });
-        const auto walkDirection = Viewport::DetermineWalkDirection(source, target);
-        auto sourcePos = source.GetWalkOrigin(walkDirection);
-        auto targetPos = target.GetWalkOrigin(walkDirection);
-        // Note that we read two cells from the source before we start writing
-        // to the target, so a two-cell DBCS character can't accidentally delete
-        // itself when moving one cell horizontally.
-        auto next = OutputCell(*textBuffer.GetCellDataAt(sourcePos));
-        do
-        {
-            const auto current = next;
-            source.WalkInBounds(sourcePos, walkDirection);
-            next = OutputCell(*textBuffer.GetCellDataAt(sourcePos));
-            textBuffer.WriteLine(OutputCellIterator({ &current, 1 }), targetPos);
-        } while (target.WalkInBounds(targetPos, walkDirection));
+        // CopyRect() takes care of the overlap, so a two-cell DBCS character
+        // can't accidentally delete itself when moving one cell horizontally.
+        textBuffer.CopyRect({ left, scrollRect.top, left + width, scrollRect.bottom }, { left + actualDelta, scrollRect.top });
     }
 
     // Columns revealed by the scroll are filled with standard erase attributes.
@@ -645,13 +638,7 @@ void AdaptDispatch::_FillRect(TextBuffer& textBuffer, const til::rect& fillRect,
 {
     if (fillRect.left < fillRect.right && fillRect.top < fillRect.bottom)
     {
-        const auto fillWidth = gsl::narrow_cast<size_t>(fillRect.right - fillRect.left);
-        const auto fillData = OutputCellIterator{ fillChar, fillAttrs, fillWidth };
-        const auto col = fillRect.left;
-        for (auto row = fillRect.top; row < fillRect.bottom; row++)
-        {
-            textBuffer.WriteLine(fillData, { col, row }, false);
-        }
+        textBuffer.FillRect(fillRect, { &fillChar, 1 }, fillAttrs);
         _api.NotifyAccessibilityChange(fillRect);
     }
 }
@@ -894,10 +881,16 @@ void AdaptDispatch::_ChangeRectAttributes(TextBuffer& textBuffer, const til::rec
     {
         for (auto row = changeRect.top; row < changeRect.bottom; row++)
         {
-            auto& rowBuffer = textBuffer.GetRowByOffset(row);
-            for (auto col = changeRect.left; col < changeRect.right; col++)
+            // The attributes are changed run by run, instead of cell by cell.
+            auto& attributes = textBuffer.GetRowByOffset(row).Attributes();
+            const auto left = gsl::narrow_cast<uint16_t>(std::clamp<til::CoordType>(changeRect.left, 0, attributes.size()));
+            const auto right = gsl::narrow_cast<uint16_t>(std::clamp<til::CoordType>(changeRect.right, left, attributes.size()));
+            // Replacing one run at a time joins those that end up being identical.
+            const auto runs = attributes.slice(left, right).runs();
+            auto col = left;
+            for (const auto& run : runs)
             {
-                auto attr = rowBuffer.GetAttrByColumn(col);
+                auto attr = run.value;
                 auto characterAttributes = attr.GetCharacterAttributes();
                 characterAttributes &= changeOps.andAttrMask;
                 characterAttributes ^= changeOps.xorAttrMask;
@@ -910,7 +903,8 @@ void AdaptDispatch::_ChangeRectAttributes(TextBuffer& textBuffer, const til::rec
                 {
                     attr.SetBackground(*changeOps.background);
                 }
-                rowBuffer.ReplaceAttributes(col, col + 1, attr);
+                attributes.replace(col, gsl::narrow_cast<uint16_t>(col + run.length), attr);
+                col = gsl::narrow_cast<uint16_t>(col + run.length);
             }
         }
         textBuffer.TriggerRedraw(Viewport::FromExclusive(changeRect));
@@ -1124,28 +1118,10 @@ bool AdaptDispatch::CopyRectangularArea(const VTInt top, const VTInt left, const
     {
         // If the source is bigger than the available space at the destination
         // it needs to be clipped, so we only care about the destination size.
-        const auto srcView = Viewport::FromDimensions(srcRect.origin(), dstRect.size());
-        const auto dstView = Viewport::FromDimensions(dstRect.origin(), dstRect.size());
-        const auto walkDirection = Viewport::DetermineWalkDirection(srcView, dstView);
-        auto srcPos = srcView.GetWalkOrigin(walkDirection);
-        auto dstPos = dstView.GetWalkOrigin(walkDirection);
-        // Note that we read two cells from the source before we start writing
-        // to the target, so a two-cell DBCS character can't accidentally delete
-        // itself when moving one cell horizontally.
-        auto next = OutputCell(*textBuffer.GetCellDataAt(srcPos));
-        do
-        {
-            const auto current = next;
-            const auto currentSrcPos = srcPos;
-            srcView.WalkInBounds(srcPos, walkDirection);
-            next = OutputCell(*textBuffer.GetCellDataAt(srcPos));
-            // If the source position is offscreen (which can occur on double
-            // width lines), then we shouldn't copy anything to the destination.
-            if (currentSrcPos.x < textBuffer.GetLineWidth(currentSrcPos.y))
-            {
-                textBuffer.WriteLine(OutputCellIterator({ &current, 1 }), dstPos);
-            }
-        } while (dstView.WalkInBounds(dstPos, walkDirection));
+        // Source positions that are offscreen (which can occur on double width
+        // lines) aren't copied. CopyRect() takes care of that, as well as of
+        // overlapping areas and DBCS characters.
+        textBuffer.CopyRect({ srcRect.origin(), dstRect.size() }, dstRect.origin());
         _api.NotifyAccessibilityChange(dstRect);
     }
 
@@ -1281,47 +1257,21 @@ bool AdaptDispatch::RequestChecksumRectangularArea(const VTInt id, const VTInt p
             defaultFgIndex = defaultFgIndex < 16 ? defaultFgIndex : 7;
             defaultBgIndex = defaultBgIndex < 16 ? defaultBgIndex : 0;
 
+            // The cached row checksums depend on the default color indices.
+            if (defaultFgIndex != _checksumDefaultFgIndex || defaultBgIndex != _checksumDefaultBgIndex)
+            {
+                _checksumCache.clear();
+                _checksumDefaultFgIndex = defaultFgIndex;
+                _checksumDefaultBgIndex = defaultBgIndex;
+            }
+
+            // The checksum of an area is simply the sum of the checksums of its
+            // row spans, so we can reuse those of the rows that haven't changed.
             const auto& textBuffer = _api.GetTextBuffer();
             const auto eraseRect = _CalculateRectArea(top, left, bottom, right, textBuffer.GetSize().Dimensions());
             for (auto row = eraseRect.top; row < eraseRect.bottom; row++)
             {
-                for (auto col = eraseRect.left; col < eraseRect.right; col++)
-                {
-                    // The algorithm we're using here should match the DEC terminals
-                    // for the ASCII and Latin-1 range. Their other character sets
-                    // predate Unicode, though, so we'd need a custom mapping table
-                    // to lookup the correct checksums. Considering this is only for
-                    // testing at the moment, that doesn't seem worth the effort.
-                    const auto cell = textBuffer.GetCellDataAt({ col, row });
-                    for (auto ch : cell->Chars())
-                    {
-                        // That said, I've made a special allowance for U+2426,
-                        // since that is widely used in a lot of character sets.
-                        checksum -= (ch == L'\u2426' ? 0x1B : ch);
-                    }
-
-                    // Since we're attempting to match the DEC checksum algorithm,
-                    // the only attributes affecting the checksum are the ones that
-                    // were supported by DEC terminals.
-                    const auto attr = cell->TextAttr();
-                    checksum -= attr.IsProtected() ? 0x04 : 0;
-                    checksum -= attr.IsInvisible() ? 0x08 : 0;
-                    checksum -= attr.IsUnderlined() ? 0x10 : 0;
-                    checksum -= attr.IsReverseVideo() ? 0x20 : 0;
-                    checksum -= attr.IsBlinking() ? 0x40 : 0;
-                    checksum -= attr.IsIntense() ? 0x80 : 0;
-
-                    // For the same reason, we only care about the eight basic ANSI
-                    // colors, although technically we also report the 8-16 index
-                    // range. Everything else gets mapped to the default colors.
-                    const auto colorIndex = [](const auto color, const auto defaultIndex) {
-                        return color.IsLegacy() ? color.GetIndex() : defaultIndex;
-                    };
-                    const auto fgIndex = colorIndex(attr.GetForeground(), defaultFgIndex);
-                    const auto bgIndex = colorIndex(attr.GetBackground(), defaultBgIndex);
-                    checksum -= gsl::narrow_cast<uint16_t>(fgIndex << 4);
-                    checksum -= gsl::narrow_cast<uint16_t>(bgIndex);
-                }
+                checksum += _RowChecksum(textBuffer.GetRowByOffset(row), row, eraseRect.left, eraseRect.right);
             }
         }
     }
@@ -1330,6 +1280,92 @@ bool AdaptDispatch::RequestChecksumRectangularArea(const VTInt id, const VTInt p
     return true;
 }
 
+// Routine Description:
+// - Calculates the DECRQCRA checksum of a span of cells in the given row, or
+//   returns the cached value if the row hasn't changed since the last time.
+// Arguments:
+// - row - The row to calculate the checksum for.
+// - y - The offset of the row in the buffer.
+// - left - The first column of the span.
+// - right - The column following the last column of the span.
+// Return Value:
+// - The checksum of the span.
+uint16_t AdaptDispatch::_RowChecksum(const ROW& row, const til::CoordType y, const til::CoordType left, const til::CoordType right)
+{
+    if (gsl::narrow_cast<size_t>(y) >= _checksumCache.size())
+    {
+        _checksumCache.resize(gsl::narrow_cast<size_t>(y) + 1);
+    }
+
+    auto& entry = til::at(_checksumCache, y);
+    if (entry.rowId == row.GetId() && entry.revision == row.GetRevision() && entry.left == left && entry.right == right)
+    {
+        return entry.checksum;
+    }
+
+    uint16_t checksum = 0;
+    for (auto col = left; col < right; col++)
+    {
+        // The algorithm we're using here should match the DEC terminals
+        // for the ASCII and Latin-1 range. Their other character sets
+        // predate Unicode, though, so we'd need a custom mapping table
+        // to lookup the correct checksums. Considering this is only for
+        // testing at the moment, that doesn't seem worth the effort.
+        for (auto ch : row.GlyphAt(col))
+        {
+            // That said, I've made a special allowance for U+2426,
+            // since that is widely used in a lot of character sets.
+            checksum -= (ch == L'\u2426' ? 0x1B : ch);
+        }
+    }
+
+    // The attributes contribute the same value for every cell they're applied
+    // to, so they can be accounted for one run at a time instead of per cell.
+    til::CoordType runEnd = 0;
+    for (const auto& run : row.Attributes().runs())
+    {
+        const auto runBegin = runEnd;
+        runEnd += run.length;
+        const auto cellCount = std::min(runEnd, right) - std::max(runBegin, left);
+        if (cellCount <= 0)
+        {
+            if (runBegin >= right)
+            {
+                break;
+            }
+            continue;
+        }
+
+        // Since we're attempting to match the DEC checksum algorithm,
+        // the only attributes affecting the checksum are the ones that
+        // were supported by DEC terminals.
+        const auto& attr = run.value;
+        uint16_t cellChecksum = 0;
+        cellChecksum += attr.IsProtected() ? 0x04 : 0;
+        cellChecksum += attr.IsInvisible() ? 0x08 : 0;
+        cellChecksum += attr.IsUnderlined() ? 0x10 : 0;
+        cellChecksum += attr.IsReverseVideo() ? 0x20 : 0;
+        cellChecksum += attr.IsBlinking() ? 0x40 : 0;
+        cellChecksum += attr.IsIntense() ? 0x80 : 0;
+
+        // For the same reason, we only care about the eight basic ANSI
+        // colors, although technically we also report the 8-16 index
+        // range. Everything else gets mapped to the default colors.
+        const auto colorIndex = [](const auto color, const auto defaultIndex) {
+            return color.IsLegacy() ? color.GetIndex() : defaultIndex;
+        };
+        const auto fgIndex = colorIndex(attr.GetForeground(), _checksumDefaultFgIndex);
+        const auto bgIndex = colorIndex(attr.GetBackground(), _checksumDefaultBgIndex);
+        cellChecksum += gsl::narrow_cast<uint16_t>(fgIndex << 4);
+        cellChecksum += gsl::narrow_cast<uint16_t>(bgIndex);
+
+        checksum -= gsl::narrow_cast<uint16_t>(cellChecksum * cellCount);
+    }
+
+    entry = { row.GetId(), row.GetRevision(), left, right, checksum };
+    return checksum;
+}
+
 // Routine Description:
 // - DECSWL/DECDWL/DECDHL - Sets the line rendition attribute for the current line.
 // Arguments:
@@ -1395,6 +1431,7 @@ bool AdaptDispatch::DeviceAttributes()
     //
     // 1 = 132 column mode (ConHost only)
     // 6 = Selective erase
+    // 4 = Sixel graphics
     // 7 = Soft fonts
     // 22 = Color text
     // 23 = Greek character sets
@@ -1405,11 +1442,11 @@ bool AdaptDispatch::DeviceAttributes()
 
     if (_api.IsConsolePty())
     {
-        _api.ReturnResponse(L"\x1b[?61;6;7;22;23;24;28;32;42c");
+        _api.ReturnResponse(L"\x1b[?61;4;6;7;22;23;24;28;32;42c");
     }
     else
     {
-        _api.ReturnResponse(L"\x1b[?61;1;6;7;22;23;24;28;32;42c");
+        _api.ReturnResponse(L"\x1b[?61;1;4;6;7;22;23;24;28;32;42c");
     }
     return true;
 }
@@ -1776,6 +1813,9 @@ bool AdaptDispatch::_ModeParamsHelper(const DispatchTypes::ModeParams param, con
     case DispatchTypes::ModeParams::W32IM_Win32InputMode:
         _terminalInput.SetInputMode(TerminalInput::Mode::Win32, enable);
         return !_PassThroughInputModes();
+    case DispatchTypes::ModeParams::W32IM_Win32BinaryInputMode:
+        _terminalInput.SetInputMode(TerminalInput::Mode::Win32Binary, enable);
+        return !_PassThroughInputModes();
     default:
         // If no functions to call, overall dispatch was a failure.
         return false;
@@ -1894,6 +1934,9 @@ bool AdaptDispatch::RequestMode(const DispatchTypes::ModeParams param)
     case DispatchTypes::ModeParams::W32IM_Win32InputMode:
         enabled = _terminalInput.GetInputMode(TerminalInput::Mode::Win32);
         break;
+    case DispatchTypes::ModeParams::W32IM_Win32BinaryInputMode:
+        enabled = _terminalInput.GetInputMode(TerminalInput::Mode::Win32Binary);
+        break;
     default:
         enabled = std::nullopt;
         break;
@@ -2160,6 +2203,7 @@ void AdaptDispatch::_DoLineFeed(TextBuffer& textBuffer, const bool withReturn, c
             eraseAttributes.SetStandardErase();
             textBuffer.GetRowByOffset(newPosition.y).Reset(eraseAttributes);
         }
+        textBuffer.CompactColdRows();
     }
     else
     {
@@ -2678,6 +2722,7 @@ bool AdaptDispatch::HardReset()
     // Clear the soft font in the renderer and delete the font buffer.
     _renderer.UpdateSoftFont({}, {}, false);
     _fontBuffer = nullptr;
+    _softFontHash = 0;
 
     // Reset internal modes to their initial state
     _modes = {};
@@ -2750,12 +2795,11 @@ bool AdaptDispatch::_EraseScrollback()
     auto& cursor = textBuffer.GetCursor();
     const auto row = cursor.GetPosition().y;
 
-    // Scroll the viewport content to the top of the buffer.
-    textBuffer.ScrollRows(top, height, -top);
-    // Clear everything after the viewport.
-    _FillRect(textBuffer, { 0, height, bufferSize.width, bufferSize.height }, L' ', {});
-    // Also reset the line rendition for all of the cleared rows.
-    textBuffer.ResetLineRenditionRange(height, bufferSize.height);
+    // Scroll the viewport content to the top of the buffer and clear everything
+    // after it. This neither moves nor writes to any rows, so it's cheap even
+    // for a large scrollback.
+    textBuffer.ClearScrollback(top, height, {});
+    _api.NotifyAccessibilityChange({ 0, height, bufferSize.width, bufferSize.height });
     // Move the viewport
     _api.SetViewportPosition({ viewport.left, 0 });
     // Move the cursor to the same relative location.
@@ -3421,12 +3465,124 @@ ITermDispatch::StringHandler AdaptDispatch::DownloadDRCS(const VTInt fontNumber,
             const auto bitPattern = _fontBuffer->GetBitPattern();
             const auto cellSize = _fontBuffer->GetCellSize();
             const auto centeringHint = _fontBuffer->GetTextCenteringHint();
-            _renderer.UpdateSoftFont(bitPattern, cellSize, centeringHint);
+
+            // Some applications redefine the same font every time they repaint
+            // the screen. Passing it on would make the renderers rasterize and
+            // upload all of its glyphs again, so identical fonts are skipped.
+            til::hasher hasher;
+            hasher.write(bitPattern.data(), bitPattern.size());
+            hasher.write(cellSize);
+            hasher.write(centeringHint);
+            const auto softFontHash = hasher.finalize();
+            if (softFontHash != _softFontHash)
+            {
+                _softFontHash = softFontHash;
+                _renderer.UpdateSoftFont(bitPattern, cellSize, centeringHint);
+            }
         }
         return true;
     };
 }
 
+// Method Description:
+// - SIXEL - Defines a sixel image, which is drawn at the cursor position once
+//   the data string has been received. The image is stored in the rows it
+//   covers, so that it scrolls along with the text.
+// Arguments:
+// - aspectRatio - the pixel aspect ratio, unless overridden by the data string.
+// - backgroundSelect - whether the background of the image is transparent.
+// - backgroundColor - the horizontal grid size, which is ignored.
+// Return Value:
+// - a function to receive the sixel data.
+ITermDispatch::StringHandler AdaptDispatch::DefineSixelImage(const VTInt aspectRatio,
+                                                             const DispatchTypes::SixelBackground backgroundSelect,
+                                                             const VTParameter /*backgroundColor*/)
+{
+    // If we're a conpty, the image is drawn by the connected terminal.
+    if (_api.IsConsolePty())
+    {
+        return _CreatePassthroughHandler();
+    }
+
+    auto parser = std::make_shared<SixelParser>(aspectRatio, backgroundSelect);
+    return [=](const auto ch) {
+        if (ch != AsciiChars::ESC)
+        {
+            parser->AddData(ch);
+        }
+        else
+        {
+            parser->Finalize();
+            _WriteSixelImage(*parser);
+        }
+        return true;
+    };
+}
+
+// Routine Description:
+// - Writes a decoded sixel image into the image slices of the rows below the
+//   cursor, one row per SixelParser::CellSize.height lines of pixels, scrolling
+//   the buffer if necessary. The cursor is left on the line below the image.
+// Arguments:
+// - parser - the finalized parser of the image.
+// Return Value:
+// - <none>
+void AdaptDispatch::_WriteSixelImage(const SixelParser& parser)
+{
+    const auto size = parser.GetSize();
+    if (size.width <= 0 || size.height <= 0)
+    {
+        return;
+    }
+
+    auto& textBuffer = _api.GetTextBuffer();
+    auto& cursor = textBuffer.GetCursor();
+    const auto column = cursor.GetPosition().x;
+    const auto cellSize = SixelParser::CellSize;
+    const auto columns = std::min((size.width + cellSize.width - 1) / cellSize.width, textBuffer.GetSize().Width() - column);
+    const auto rows = (size.height + cellSize.height - 1) / cellSize.height;
+    const auto copyWidth = std::min(size.width, columns * cellSize.width);
+    const auto pixels = parser.GetPixels();
+
+    for (til::CoordType r = 0; r < rows; ++r)
+    {
+        if (r)
+        {
+            _DoLineFeed(textBuffer, false, false);
+        }
+
+        const auto y = cursor.GetPosition().y;
+        auto& slice = textBuffer.GetRowByOffset(y).GetOrCreateImageSlice(cellSize);
+        const auto target = slice.MutablePixels(column, column + columns);
+        const auto stride = slice.PixelWidth();
+
+        for (til::CoordType py = 0; py < cellSize.height; ++py)
+        {
+            const auto sourceY = r * cellSize.height + py;
+            if (sourceY >= size.height)
+            {
+                break;
+            }
+
+            // Transparent pixels leave anything that was drawn there before intact.
+            const auto src = pixels.subspan(static_cast<size_t>(sourceY) * size.width, copyWidth);
+            const auto dst = target + static_cast<size_t>(py) * stride;
+            for (til::CoordType px = 0; px < copyWidth; ++px)
+            {
+                if (const auto pixel = til::at(src, px))
+                {
+                    dst[px] = pixel;
+                }
+            }
+        }
+
+        textBuffer.TriggerRedraw(Viewport::FromDimensions({ column, y }, { columns, 1 }));
+    }
+
+    _DoLineFeed(textBuffer, false, false);
+    textBuffer.EnforceImageMemoryLimit();
+}
+
 // Routine Description:
 // - Helper method to create a string handler that can be used to pass through
 //   DECDLD sequences when in conpty mode. This patches the original sequence
@@ -18,6 +18,7 @@ Author(s):
 #include "ITerminalApi.hpp"
 #include "FontBuffer.hpp"
 #include "MacroBuffer.hpp"
+#include "SixelParser.hpp"
 #include "terminalOutput.hpp"
 #include "../input/terminalInput.hpp"
 #include "../../types/inc/sgrStack.hpp"
@@ -37,6 +38,8 @@ namespace Microsoft::Console::VirtualTerminal
     public:
         AdaptDispatch(ITerminalApi& api, Renderer& renderer, RenderSettings& renderSettings, TerminalInput& terminalInput);
 
+        bool AreScrollMarginsSet() const noexcept;
+
         void Print(const wchar_t wchPrintable) override;
         void PrintString(const std::wstring_view string) override;
 
@@ -142,6 +145,10 @@ namespace Microsoft::Console::VirtualTerminal
                                    const VTParameter cellHeight,
                                    const DispatchTypes::DrcsCharsetSize charsetSize) override; // DECDLD
 
+        StringHandler DefineSixelImage(const VTInt aspectRatio,
+                                       const DispatchTypes::SixelBackground backgroundSelect,
+                                       const VTParameter backgroundColor) override; // SIXEL
+
         StringHandler DefineMacro(const VTInt macroId,
                                   const DispatchTypes::MacroDeleteControl deleteControl,
                                   const DispatchTypes::MacroEncoding encoding) override; // DECDMAC
@@ -191,6 +198,15 @@ namespace Microsoft::Console::VirtualTerminal
             static constexpr Offset Backward(const VTInt value) { return { -value, false }; };
             static constexpr Offset Unchanged() { return Forward(0); };
         };
+        struct ChecksumCacheEntry
+        {
+            // The ROW::GetId() and ROW::GetRevision() the checksum was calculated for.
+            uint64_t rowId = 0;
+            uint64_t revision = 0;
+            til::CoordType left = 0;
+            til::CoordType right = 0;
+            uint16_t checksum = 0;
+        };
         struct ChangeOps
         {
             CharacterAttributes andAttrMask = CharacterAttributes::All;
@@ -224,6 +240,7 @@ namespace Microsoft::Console::VirtualTerminal
         void _CursorPositionReport(const bool extendedReport);
         void _MacroSpaceReport() const;
         void _MacroChecksumReport(const VTParameter id) const;
+        uint16_t _RowChecksum(const ROW& row, const til::CoordType y, const til::CoordType left, const til::CoordType right);
 
         void _SetColumnMode(const bool enable);
         void _SetAlternateScreenBufferMode(const bool enable);
@@ -250,6 +267,7 @@ namespace Microsoft::Console::VirtualTerminal
 
         StringHandler _CreateDrcsPassthroughHandler(const DispatchTypes::DrcsCharsetSize charsetSize);
         StringHandler _CreatePassthroughHandler();
+        void _WriteSixelImage(const SixelParser& parser);
 
         std::vector<bool> _tabStopColumns;
         bool _initDefaultTabStops = true;
@@ -260,7 +278,12 @@ namespace Microsoft::Console::VirtualTerminal
         TerminalInput& _terminalInput;
         TerminalOutput _termOutput;
         std::unique_ptr<FontBuffer> _fontBuffer;
+        size_t _softFontHash = 0; // of the font last passed to Renderer::UpdateSoftFont()
         std::shared_ptr<MacroBuffer> _macroBuffer;
+        // DECRQCRA checksums of each buffer row, so that polling an unchanged area is cheap.
+        std::vector<ChecksumCacheEntry> _checksumCache;
+        size_t _checksumDefaultFgIndex = 0;
+        size_t _checksumDefaultBgIndex = 0;
         std::optional<unsigned int> _initialCodePage;
 
         // We have two instances of the saved cursor state, because we need
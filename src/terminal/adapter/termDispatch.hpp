@@ -134,6 +134,10 @@ public:
                                const VTParameter /*cellHeight*/,
                                const DispatchTypes::DrcsCharsetSize /*charsetSize*/) override { return nullptr; } // DECDLD
 
+    StringHandler DefineSixelImage(const VTInt /*aspectRatio*/,
+                                   const DispatchTypes::SixelBackground /*backgroundSelect*/,
+                                   const VTParameter /*backgroundColor*/) override { return nullptr; } // SIXEL
+
     StringHandler DefineMacro(const VTInt /*macroId*/,
                               const DispatchTypes::MacroDeleteControl /*deleteControl*/,
                               const DispatchTypes::MacroEncoding /*encoding*/) override { return nullptr; } // DECDMAC
@@ -1534,7 +1534,7 @@ public:
         _testGetSet->PrepData();
         VERIFY_IS_TRUE(_pDispatch->DeviceAttributes());
 
-        auto pwszExpectedResponse = L"\x1b[?61;1;6;7;22;23;24;28;32;42c";
+        auto pwszExpectedResponse = L"\x1b[?61;1;4;6;7;22;23;24;28;32;42c";
         _testGetSet->ValidateInputEvent(pwszExpectedResponse);
 
         Log::Comment(L"Test 2: Verify failure when ReturnResponse doesn't work.");
@@ -1897,6 +1897,14 @@ public:
             attr.SetIndexedBackground(TextColor::DARK_BLUE);
         });
         verifyChecksumReport(L"FF8B");
+
+        Log::Comment(L"Test 6: Cached row checksums");
+        outputText(L"ABC"sv);
+        verifyChecksumReport(L"FDEA");
+        requestChecksumReport(3);
+        verifyChecksumReport(L"FDEA");
+        requestChecksumReport(1);
+        verifyChecksumReport(L"FF4F");
     }
 
     TEST_METHOD(TabulationStopReportTests)
@@ -2677,6 +2685,64 @@ public:
         VERIFY_IS_TRUE(decdld(CellMatrix::Default, 0, FontSet::Size132x24, FontUsage::FullCell, bitmapOf6x18));
     }
 
+    TEST_METHOD(SoftFontBitPatterns)
+    {
+        using FontSet = DispatchTypes::DrcsFontSet;
+        using FontUsage = DispatchTypes::DrcsFontUsage;
+
+        Log::Comment(L"10x20 full cell font with a single character");
+        FontBuffer fontBuffer;
+        VERIFY_IS_TRUE(fontBuffer.SetEraseControl(DispatchTypes::DrcsEraseControl::AllChars));
+        VERIFY_IS_TRUE(fontBuffer.SetAttributes(static_cast<DispatchTypes::DrcsCellMatrix>(10), 20, FontSet::Size80x24, FontUsage::FullCell));
+        VERIFY_IS_TRUE(fontBuffer.SetStartChar(1, DispatchTypes::DrcsCharsetSize::Size94));
+        for (const auto ch : std::wstring_view{ L"B?~@/~" })
+        {
+            fontBuffer.AddSixelData(ch);
+        }
+        VERIFY_IS_TRUE(fontBuffer.FinalizeSixelData());
+        VERIFY_ARE_EQUAL(til::size(10, 20), fontBuffer.GetCellSize());
+
+        Log::Comment(L"Each sixel sets six scanlines of its column, starting with the least significant bit");
+        const auto bitPattern = fontBuffer.GetBitPattern().subspan(20, 20);
+        VERIFY_ARE_EQUAL(uint16_t{ 0b0110'0000'0000'0000 }, bitPattern[0]);
+        for (size_t line = 1; line < 6; line++)
+        {
+            VERIFY_ARE_EQUAL(uint16_t{ 0b0100'0000'0000'0000 }, bitPattern[line]);
+        }
+        for (size_t line = 6; line < 12; line++)
+        {
+            VERIFY_ARE_EQUAL(uint16_t{ 0b1000'0000'0000'0000 }, bitPattern[line]);
+        }
+        for (size_t line = 12; line < 20; line++)
+        {
+            VERIFY_ARE_EQUAL(uint16_t{ 0 }, bitPattern[line]);
+        }
+    }
+
+    TEST_METHOD(SixelImageWrite)
+    {
+        _testGetSet->PrepData();
+        auto& textBuffer = _testGetSet->GetTextBuffer();
+        const auto start = textBuffer.GetCursor().GetPosition();
+
+        Log::Comment(L"A 10x6 red image fills a single cell");
+        _stateMachine->ProcessString(L"\033Pq#1;2;100;0;0#1!10~\033\\");
+
+        const auto slice = textBuffer.GetRowByOffset(start.y).GetImageSlice();
+        VERIFY_IS_NOT_NULL(slice);
+        VERIFY_ARE_EQUAL(start.x, slice->ColumnOffset());
+        VERIFY_ARE_EQUAL(start.x + 1, slice->ColumnEnd());
+        VERIFY_ARE_EQUAL(0xff0000ffu, slice->PixelsAt(start.x)[0]);
+
+        Log::Comment(L"The cursor is moved below the image");
+        VERIFY_ARE_EQUAL(til::point(start.x, start.y + 1), textBuffer.GetCursor().GetPosition());
+
+        Log::Comment(L"Writing text over the image erases it");
+        textBuffer.GetCursor().SetPosition(start);
+        _stateMachine->ProcessString(L"A");
+        VERIFY_IS_NULL(textBuffer.GetRowByOffset(start.y).GetImageSlice());
+    }
+
     TEST_METHOD(TogglingC1ParserMode)
     {
         _stateMachine->SetParserMode(StateMachine::Mode::AcceptC1, false);
@@ -2797,6 +2863,7 @@ public:
 
         const auto setMacroText = [&](const auto id, const auto value) {
             _pDispatch->_macroBuffer->_macros.at(id) = value;
+            _pDispatch->_macroBuffer->_segments.at(id).clear();
         };
 
         setMacroText(0, L"Macro 0");
@@ -2835,6 +2902,19 @@ public:
         _stateMachine->ProcessString(L"\033[2;0;1*z");
         VERIFY_ARE_EQUAL(L"Macro 2", getBufferOutput());
 
+        Log::Comment(L"Text runs and sequences are played back in order");
+        setMacroText(3, L"A\033[1mB\033[mC\033[D\033[CD");
+        _testGetSet->PrepData();
+        _stateMachine->ProcessString(L"\033[3*z");
+        VERIFY_ARE_EQUAL(L"ABCD", getBufferOutput());
+        const auto& macroRow = _testGetSet->GetTextBuffer().GetRowByOffset(_testGetSet->GetTextBuffer().GetCursor().GetPosition().y);
+        VERIFY_IS_TRUE(macroRow.GetAttrByColumn(1).IsIntense());
+        VERIFY_IS_FALSE(macroRow.GetAttrByColumn(2).IsIntense());
+
+        Log::Comment(L"Invoking a macro again reuses its segments");
+        _stateMachine->ProcessString(L"\033[3*z");
+        VERIFY_ARE_EQUAL(L"ABCDABCD", getBufferOutput());
+
         Log::Comment(L"DECDMAC ignored when inside a macro");
         setMacroText(10, L"[\033P1;0;0!zReplace Macro 1\033\\]");
         _testGetSet->PrepData();
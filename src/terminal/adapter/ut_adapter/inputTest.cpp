@@ -8,6 +8,7 @@
 #include "../../inc/consoletaeftemplates.hpp"
 
 #include "../../input/terminalInput.hpp"
+#include "../../../inc/ConptyBinaryInput.hpp"
 
 #include "../../../interactivity/inc/VtApiRedirection.hpp"
 
@@ -47,6 +48,7 @@ public:
     TEST_METHOD(CtrlNumTest);
     TEST_METHOD(BackarrowKeyModeTest);
     TEST_METHOD(AutoRepeatModeTest);
+    TEST_METHOD(BinaryInputModeTest);
 
     wchar_t GetModifierChar(const bool fShift, const bool fAlt, const bool fCtrl)
     {
@@ -907,3 +909,48 @@ void InputTest::AutoRepeatModeTest()
     repeatKey('C', L'c', 5);
     VERIFY_ARE_EQUAL(L"aaaaabbbbbccccc", receivedChars);
 }
+
+void InputTest::BinaryInputModeTest()
+{
+    auto receivedChars = std::wstring{};
+    TerminalInput input{ [&](auto& inEvents) {
+        for (auto& record : IInputEvent::ToInputRecords(inEvents))
+        {
+            receivedChars.push_back(record.Event.KeyEvent.uChar.UnicodeChar);
+        }
+    } };
+
+    auto irTest = INPUT_RECORD{ 0 };
+    irTest.EventType = KEY_EVENT;
+    irTest.Event.KeyEvent.bKeyDown = TRUE;
+    irTest.Event.KeyEvent.wRepeatCount = 1;
+    irTest.Event.KeyEvent.wVirtualKeyCode = 'A';
+    irTest.Event.KeyEvent.wVirtualScanCode = 30;
+    irTest.Event.KeyEvent.uChar.UnicodeChar = L'a';
+    irTest.Event.KeyEvent.dwControlKeyState = LEFT_ALT_PRESSED;
+    const auto keyEvent = IInputEvent::Create(irTest);
+
+    input.SetInputMode(TerminalInput::Mode::Win32, true);
+    input.SetInputMode(TerminalInput::Mode::Win32Binary, true);
+
+    Log::Comment(L"Without support for binary input records, win32-input-mode sequences are sent.");
+    VERIFY_IS_TRUE(input.HandleKey(keyEvent.get()));
+    VERIFY_ARE_EQUAL(L"\x1b[65;30;97;1;2;1_", receivedChars);
+
+    Log::Comment(L"With it, the key is sent as a marker followed by its INPUT_RECORD.");
+    input.SetBinaryInputSupported(true);
+    receivedChars.clear();
+    VERIFY_IS_TRUE(input.HandleKey(keyEvent.get()));
+    VERIFY_ARE_EQUAL(1 + Microsoft::Console::BinaryInput::RecordLength, receivedChars.size());
+    VERIFY_ARE_EQUAL(Microsoft::Console::BinaryInput::RecordMarker, receivedChars[0]);
+
+    INPUT_RECORD irActual;
+    memcpy(&irActual, &receivedChars[1], sizeof(irActual));
+    VERIFY_ARE_EQUAL(irTest, irActual);
+
+    Log::Comment(L"Binary input records are only a variant of win32-input-mode.");
+    input.SetInputMode(TerminalInput::Mode::Win32, false);
+    receivedChars.clear();
+    VERIFY_IS_TRUE(input.HandleKey(keyEvent.get()));
+    VERIFY_ARE_EQUAL(L"\x1ba", receivedChars);
+}
@@ -275,6 +275,27 @@ static constexpr til::CoordType _encodeDefaultCoordinate(const til::CoordType sC
     return sCoordinateValue + 32;
 }
 
+// Routine Description:
+// - Writes a default (or utf-8) encoded mouse sequence "\x1b[Mbxy" into the given buffer.
+// Parameters:
+// - xbutton - the X encoding of the button.
+// - encodedX, encodedY - the encoded coordinates.
+// - buffer - storage for the sequence.
+// Return value:
+// - the sequence, pointing into buffer.
+template<size_t N>
+static std::wstring_view _encodeXSequence(const int xbutton, const til::CoordType encodedX, const til::CoordType encodedY, std::array<wchar_t, N>& buffer) noexcept
+{
+    static_assert(N >= 6);
+    til::at(buffer, 0) = L'\x1b';
+    til::at(buffer, 1) = L'[';
+    til::at(buffer, 2) = L'M';
+    til::at(buffer, 3) = gsl::narrow_cast<wchar_t>(L' ' + xbutton);
+    til::at(buffer, 4) = gsl::narrow_cast<wchar_t>(encodedX);
+    til::at(buffer, 5) = gsl::narrow_cast<wchar_t>(encodedY);
+    return { buffer.data(), 6 };
+}
+
 // Routine Description:
 // - Relays if we are tracking mouse input
 // Parameters:
@@ -367,14 +388,18 @@ bool TerminalInput::HandleMouse(const til::point position,
 
             if (success)
             {
-                std::wstring sequence;
+                // The sequence is encoded into this stack buffer, so that the
+                // flood of hover events in any-event tracking doesn't allocate.
+                MouseSequenceBuffer buffer;
+                std::wstring_view sequence;
                 if (_inputMode.test(Mode::Utf8MouseEncoding))
                 {
                     sequence = _GenerateUtf8Sequence(position,
                                                      realButton,
                                                      isHover,
                                                      modifierKeyState,
-                                                     delta);
+                                                     delta,
+                                                     buffer);
                 }
                 else if (_inputMode.test(Mode::SgrMouseEncoding))
                 {
@@ -387,7 +412,8 @@ bool TerminalInput::HandleMouse(const til::point position,
                                                     _isButtonDown(realButton), // Use realButton here, to properly get the up/down state
                                                     isHover,
                                                     modifierKeyState,
-                                                    delta);
+                                                    delta,
+                                                    buffer);
                 }
                 else
                 {
@@ -395,7 +421,8 @@ bool TerminalInput::HandleMouse(const til::point position,
                                                         realButton,
                                                         isHover,
                                                         modifierKeyState,
-                                                        delta);
+                                                        delta,
+                                                        buffer);
                 }
                 success = !sequence.empty();
 
@@ -425,13 +452,15 @@ bool TerminalInput::HandleMouse(const til::point position,
 // - isHover - true if the sequence is generated in response to a mouse hover
 // - modifierKeyState - the modifier keys pressed with this button
 // - delta - the amount that the scroll wheel changed (should be 0 unless button is a WM_MOUSE*WHEEL)
+// - buffer - storage for the generated sequence
 // Return value:
-// - The generated sequence. Will be empty if we couldn't generate.
-std::wstring TerminalInput::_GenerateDefaultSequence(const til::point position,
-                                                     const unsigned int button,
-                                                     const bool isHover,
-                                                     const short modifierKeyState,
-                                                     const short delta)
+// - The generated sequence, pointing into buffer. Will be empty if we couldn't generate.
+std::wstring_view TerminalInput::_GenerateDefaultSequence(const til::point position,
+                                                          const unsigned int button,
+                                                          const bool isHover,
+                                                          const short modifierKeyState,
+                                                          const short delta,
+                                                          MouseSequenceBuffer& buffer) noexcept
 {
     // In the default, non-extended encoding scheme, coordinates above 94 shouldn't be supported,
     //   because (95+32+1)=128, which is not an ASCII character.
@@ -443,11 +472,7 @@ std::wstring TerminalInput::_GenerateDefaultSequence(const til::point position,
         const auto encodedX = _encodeDefaultCoordinate(vtCoords.x);
         const auto encodedY = _encodeDefaultCoordinate(vtCoords.y);
 
-        std::wstring format{ L"\x1b[Mbxy" };
-        til::at(format, 3) = gsl::narrow_cast<wchar_t>(L' ' + _windowsButtonToXEncoding(button, isHover, modifierKeyState, delta));
-        til::at(format, 4) = gsl::narrow_cast<wchar_t>(encodedX);
-        til::at(format, 5) = gsl::narrow_cast<wchar_t>(encodedY);
-        return format;
+        return _encodeXSequence(_windowsButtonToXEncoding(button, isHover, modifierKeyState, delta), encodedX, encodedY, buffer);
     }
 
     return {};
@@ -462,13 +487,15 @@ std::wstring TerminalInput::_GenerateDefaultSequence(const til::point position,
 // - isHover - true if the sequence is generated in response to a mouse hover
 // - modifierKeyState - the modifier keys pressed with this button
 // - delta - the amount that the scroll wheel changed (should be 0 unless button is a WM_MOUSE*WHEEL)
+// - buffer - storage for the generated sequence
 // Return value:
-// - The generated sequence. Will be empty if we couldn't generate.
-std::wstring TerminalInput::_GenerateUtf8Sequence(const til::point position,
-                                                  const unsigned int button,
-                                                  const bool isHover,
-                                                  const short modifierKeyState,
-                                                  const short delta)
+// - The generated sequence, pointing into buffer. Will be empty if we couldn't generate.
+std::wstring_view TerminalInput::_GenerateUtf8Sequence(const til::point position,
+                                                       const unsigned int button,
+                                                       const bool isHover,
+                                                       const short modifierKeyState,
+                                                       const short delta,
+                                                       MouseSequenceBuffer& buffer) noexcept
 {
     // So we have some complications here.
     // The windows input stream is typically encoded as UTF16.
@@ -489,12 +516,8 @@ std::wstring TerminalInput::_GenerateUtf8Sequence(const til::point position,
         const auto vtCoords = _winToVTCoord(position);
         const auto encodedX = _encodeDefaultCoordinate(vtCoords.x);
         const auto encodedY = _encodeDefaultCoordinate(vtCoords.y);
-        std::wstring format{ L"\x1b[Mbxy" };
         // The short cast is safe because we know s_WindowsButtonToXEncoding  never returns more than xff
-        til::at(format, 3) = gsl::narrow_cast<wchar_t>(L' ' + _windowsButtonToXEncoding(button, isHover, modifierKeyState, delta));
-        til::at(format, 4) = gsl::narrow_cast<wchar_t>(encodedX);
-        til::at(format, 5) = gsl::narrow_cast<wchar_t>(encodedY);
-        return format;
+        return _encodeXSequence(_windowsButtonToXEncoding(button, isHover, modifierKeyState, delta), encodedX, encodedY, buffer);
     }
 
     return {};
@@ -510,25 +533,24 @@ std::wstring TerminalInput::_GenerateUtf8Sequence(const til::point position,
 // - isHover - true if the sequence is generated in response to a mouse hover
 // - modifierKeyState - the modifier keys pressed with this button
 // - delta - the amount that the scroll wheel changed (should be 0 unless button is a WM_MOUSE*WHEEL)
-// - ppwchSequence - On success, where to put the pointer to the generated sequence
-// - pcchLength - On success, where to put the length of the generated sequence
+// - buffer - storage for the generated sequence
 // Return value:
-// - true if we were able to successfully generate a sequence.
-// On success, caller is responsible for delete[]ing *ppwchSequence.
-std::wstring TerminalInput::_GenerateSGRSequence(const til::point position,
-                                                 const unsigned int button,
-                                                 const bool isDown,
-                                                 const bool isHover,
-                                                 const short modifierKeyState,
-                                                 const short delta)
+// - The generated sequence, pointing into buffer.
+std::wstring_view TerminalInput::_GenerateSGRSequence(const til::point position,
+                                                      const unsigned int button,
+                                                      const bool isDown,
+                                                      const bool isHover,
+                                                      const short modifierKeyState,
+                                                      const short delta,
+                                                      MouseSequenceBuffer& buffer) noexcept
 {
     // Format for SGR events is:
     // "\x1b[<%d;%d;%d;%c", xButton, x+1, y+1, fButtonDown? 'M' : 'm'
     const auto xbutton = _windowsButtonToSGREncoding(button, isHover, modifierKeyState, delta);
 
-    auto format = wil::str_printf<std::wstring>(L"\x1b[<%d;%d;%d%c", xbutton, position.x + 1, position.y + 1, isDown ? L'M' : L'm');
-
-    return format;
+    // buffer is sized for the longest possible sequence, so this can't be truncated.
+    const auto result = fmt::format_to_n(buffer.data(), buffer.size(), FMT_COMPILE(L"\x1b[<{};{};{}{}"), xbutton, position.x + 1, position.y + 1, isDown ? L'M' : L'm');
+    return { buffer.data(), std::min(result.size, buffer.size()) };
 }
 
 // Routine Description:
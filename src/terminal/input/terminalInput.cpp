@@ -12,6 +12,7 @@
 
 #include "../../interactivity/inc/VtApiRedirection.hpp"
 #include "../../inc/unicode.hpp"
+#include "../../inc/ConptyBinaryInput.hpp"
 
 using namespace Microsoft::Console::VirtualTerminal;
 
@@ -278,47 +279,40 @@ void TerminalInput::ForceDisableWin32InputMode(const bool win32InputMode) noexce
     _forceDisableWin32InputMode = win32InputMode;
 }
 
-static const std::span<const TermKeyMap> _getKeyMapping(const KeyEvent& keyEvent,
-                                                        const bool ansiMode,
-                                                        const bool cursorApplicationMode,
-                                                        const bool keypadApplicationMode) noexcept
+// Binary input records can only be used by whoever writes our output into a ConPTY input pipe
+// via a ConptyConnection, which is the only thing that knows how to frame them. Everyone else
+// (like conhost for its own VT input mode) must keep sending them as win32-input-mode sequences.
+void TerminalInput::SetBinaryInputSupported(const bool supported) noexcept
 {
-    if (ansiMode)
-    {
-        if (keyEvent.IsCursorKey())
-        {
-            if (cursorApplicationMode)
-            {
-                return { s_cursorKeysApplicationMapping.data(), s_cursorKeysApplicationMapping.size() };
-            }
-            else
-            {
-                return { s_cursorKeysNormalMapping.data(), s_cursorKeysNormalMapping.size() };
-            }
-        }
-        else
-        {
-            if (keypadApplicationMode)
-            {
-                return { s_keypadApplicationMapping.data(), s_keypadApplicationMapping.size() };
-            }
-            else
-            {
-                return { s_keypadNumericMapping.data(), s_keypadNumericMapping.size() };
-            }
-        }
-    }
-    else
-    {
-        if (keyEvent.IsCursorKey())
-        {
-            return { s_cursorKeysVt52Mapping.data(), s_cursorKeysVt52Mapping.size() };
-        }
-        else
-        {
-            return { s_keypadVt52Mapping.data(), s_keypadVt52Mapping.size() };
-        }
-    }
+    _binaryInputSupported = supported;
+}
+
+// The default key mappings for every combination of the input modes that affect them,
+// indexed by _keyMappingIndex, so that HandleKey doesn't have to branch on each mode.
+static constexpr std::array<std::span<const TermKeyMap>, 8> s_keyMappingsByMode{
+    s_keypadVt52Mapping, // VT52, keypad
+    s_keypadVt52Mapping, // VT52, keypad (application mode has no effect)
+    s_cursorKeysVt52Mapping, // VT52, cursor keys
+    s_cursorKeysVt52Mapping, // VT52, cursor keys (application mode has no effect)
+    s_keypadNumericMapping, // ANSI, keypad
+    s_keypadApplicationMapping, // ANSI, keypad, DECKPAM
+    s_cursorKeysNormalMapping, // ANSI, cursor keys
+    s_cursorKeysApplicationMapping, // ANSI, cursor keys, DECCKM
+};
+
+static constexpr size_t _keyMappingIndex(const bool ansiMode, const bool cursorKey, const bool applicationMode) noexcept
+{
+    return (ansiMode ? 4 : 0) | (cursorKey ? 2 : 0) | (applicationMode ? 1 : 0);
+}
+
+static std::span<const TermKeyMap> _getKeyMapping(const KeyEvent& keyEvent,
+                                                  const bool ansiMode,
+                                                  const bool cursorApplicationMode,
+                                                  const bool keypadApplicationMode) noexcept
+{
+    const auto cursorKey = keyEvent.IsCursorKey();
+    const auto applicationMode = cursorKey ? cursorApplicationMode : keypadApplicationMode;
+    return til::at(s_keyMappingsByMode, _keyMappingIndex(ansiMode, cursorKey, applicationMode));
 }
 
 // Routine Description:
@@ -383,12 +377,15 @@ static bool _searchWithModifier(const KeyEvent& keyEvent, InputSender sender)
         const auto& v = match.value();
         if (!v.sequence.empty())
         {
-            std::wstring modified{ v.sequence }; // Make a copy so we can modify it.
+            // Make a copy on the stack so we can modify it. The longest of these is "\x1b[24;m~".
+            std::array<wchar_t, 8> modified;
+            const auto length = std::min(v.sequence.size(), modified.size());
+            std::copy_n(v.sequence.begin(), length, modified.begin());
             const auto shift = keyEvent.IsShiftPressed();
             const auto alt = keyEvent.IsAltPressed();
             const auto ctrl = keyEvent.IsCtrlPressed();
-            modified.at(modified.size() - 2) = L'1' + (shift ? 1 : 0) + (alt ? 2 : 0) + (ctrl ? 4 : 0);
-            sender(modified);
+            til::at(modified, length - 2) = L'1' + (shift ? 1 : 0) + (alt ? 2 : 0) + (ctrl ? 4 : 0);
+            sender({ modified.data(), length });
             success = true;
         }
     }
@@ -552,6 +549,13 @@ bool TerminalInput::HandleKey(const IInputEvent* const pInEvent)
     // Only do this if win32-input-mode support isn't manually disabled.
     if (_inputMode.test(Mode::Win32) && !_forceDisableWin32InputMode)
     {
+        if (_binaryInputSupported && _inputMode.test(Mode::Win32Binary))
+        {
+            const auto record = _GenerateBinaryKeyRecord(keyEvent);
+            _SendInputSequence({ record.data(), record.size() });
+            return true;
+        }
+
         const auto seq = _GenerateWin32KeySequence(keyEvent);
         _SendInputSequence(seq);
         return true;
@@ -857,3 +861,21 @@ std::wstring TerminalInput::_GenerateWin32KeySequence(const KeyEvent& key)
                        key.GetActiveModifierKeys(),
                        key.GetRepeatCount());
 }
+
+// Method Description:
+// - Serializes the given keyevent as a binary input record (see ConptyBinaryInput.hpp):
+//   A RecordMarker followed by the bytes of its INPUT_RECORD.
+// Arguments:
+// - key: the KeyEvent to serialize.
+// Return Value:
+// - the binary input record
+std::array<wchar_t, 11> TerminalInput::_GenerateBinaryKeyRecord(const KeyEvent& key) noexcept
+{
+    static_assert(1 + Microsoft::Console::BinaryInput::RecordLength == std::tuple_size_v<std::array<wchar_t, 11>>);
+
+    const auto record = key.ToInputRecord();
+    std::array<wchar_t, 11> seq;
+    seq[0] = Microsoft::Console::BinaryInput::RecordMarker;
+    memcpy(&seq[1], &record, sizeof(record));
+    return seq;
+}
@@ -44,6 +44,9 @@ namespace Microsoft::Console::VirtualTerminal
             CursorKey,
             BackarrowKey,
             Win32,
+            // Only has an effect together with Win32 and if SetBinaryInputSupported(true) was called.
+            // See ConptyBinaryInput.hpp.
+            Win32Binary,
 
             Utf8MouseEncoding,
             SgrMouseEncoding,
@@ -61,6 +64,7 @@ namespace Microsoft::Console::VirtualTerminal
         bool GetInputMode(const Mode mode) const noexcept;
         void ResetInputModes() noexcept;
         void ForceDisableWin32InputMode(const bool win32InputMode) noexcept;
+        void SetBinaryInputSupported(const bool supported) noexcept;
 
 #pragma region MouseInput
         // These methods are defined in mouseInput.cpp
@@ -98,12 +102,14 @@ namespace Microsoft::Console::VirtualTerminal
 
         til::enumset<Mode> _inputMode{ Mode::Ansi, Mode::AutoRepeat };
         bool _forceDisableWin32InputMode{ false };
+        bool _binaryInputSupported{ false };
 
         void _SendChar(const wchar_t ch);
         void _SendNullInputSequence(const DWORD dwControlKeyState) const;
         void _SendInputSequence(const std::wstring_view sequence) const noexcept;
         void _SendEscapedInputSequence(const wchar_t wch) const;
         static std::wstring _GenerateWin32KeySequence(const KeyEvent& key);
+        static std::array<wchar_t, 11> _GenerateBinaryKeyRecord(const KeyEvent& key) noexcept;
 
 #pragma region MouseInputState Management
         // These methods are defined in mouseInputState.cpp
@@ -119,22 +125,28 @@ namespace Microsoft::Console::VirtualTerminal
 #pragma endregion
 
 #pragma region MouseInput
-        static std::wstring _GenerateDefaultSequence(const til::point position,
-                                                     const unsigned int button,
-                                                     const bool isHover,
-                                                     const short modifierKeyState,
-                                                     const short delta);
-        static std::wstring _GenerateUtf8Sequence(const til::point position,
-                                                  const unsigned int button,
-                                                  const bool isHover,
-                                                  const short modifierKeyState,
-                                                  const short delta);
-        static std::wstring _GenerateSGRSequence(const til::point position,
-                                                 const unsigned int button,
-                                                 const bool isDown,
-                                                 const bool isHover,
-                                                 const short modifierKeyState,
-                                                 const short delta);
+        // Large enough for the longest SGR sequence: "\x1b[<" + 3 numbers of up to 11 digits + 2 separators + final.
+        using MouseSequenceBuffer = std::array<wchar_t, 48>;
+
+        static std::wstring_view _GenerateDefaultSequence(const til::point position,
+                                                          const unsigned int button,
+                                                          const bool isHover,
+                                                          const short modifierKeyState,
+                                                          const short delta,
+                                                          MouseSequenceBuffer& buffer) noexcept;
+        static std::wstring_view _GenerateUtf8Sequence(const til::point position,
+                                                       const unsigned int button,
+                                                       const bool isHover,
+                                                       const short modifierKeyState,
+                                                       const short delta,
+                                                       MouseSequenceBuffer& buffer) noexcept;
+        static std::wstring_view _GenerateSGRSequence(const til::point position,
+                                                      const unsigned int button,
+                                                      const bool isDown,
+                                                      const bool isHover,
+                                                      const short modifierKeyState,
+                                                      const short delta,
+                                                      MouseSequenceBuffer& buffer) noexcept;
 
         bool _SendAlternateScroll(const short delta) const noexcept;
 
@@ -21,6 +21,10 @@ namespace Microsoft::Console::VirtualTerminal
     {
     public:
         using StringHandler = std::function<bool(const wchar_t)>;
+        // Receives the contents of an OSC string in chunks, as they're parsed.
+        // It's called with an empty string once the OSC string is terminated,
+        // and the return value of that last call is the result of the dispatch.
+        using OscStringHandler = std::function<bool(const std::wstring_view)>;
 
         virtual ~IStateMachineEngine() = 0;
         IStateMachineEngine(const IStateMachineEngine&) = default;
@@ -44,6 +48,7 @@ namespace Microsoft::Console::VirtualTerminal
 
         virtual bool ActionIgnore() = 0;
 
+        virtual OscStringHandler ActionOscStringStart(const size_t parameter) = 0;
         virtual bool ActionOscDispatch(const wchar_t wch,
                                        const size_t parameter,
                                        const std::wstring_view string) = 0;
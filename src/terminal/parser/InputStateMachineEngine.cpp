@@ -525,6 +525,18 @@ bool InputStateMachineEngine::ActionIgnore() noexcept
     return true;
 }
 
+// Method Description:
+// - Gives the engine a chance to receive an OSC string while it's being parsed.
+//   Input never contains OSC strings we're interested in.
+// Arguments:
+// - parameter - identifier of the OSC action to perform
+// Return Value:
+// - nullptr, so that the string is collected and passed to ActionOscDispatch.
+IStateMachineEngine::OscStringHandler InputStateMachineEngine::ActionOscStringStart(const size_t /*parameter*/) noexcept
+{
+    return nullptr;
+}
+
 // Method Description:
 // - Triggers the OscDispatch action to indicate that the listener should handle a control sequence.
 //   These sequences perform various API-type commands that can include many parameters.
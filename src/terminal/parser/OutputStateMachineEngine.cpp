@@ -762,6 +762,11 @@ IStateMachineEngine::StringHandler OutputStateMachineEngine::ActionDcsDispatch(c
                                           parameters.at(6),
                                           parameters.at(7));
         break;
+    case DcsActionCodes::SIXEL_DefineImage:
+        handler = _dispatch->DefineSixelImage(parameters.at(0),
+                                              parameters.at(1),
+                                              parameters.at(2));
+        break;
     case DcsActionCodes::DECDMAC_DefineMacro:
         handler = _dispatch->DefineMacro(parameters.at(0).value_or(0), parameters.at(1), parameters.at(2));
         break;
@@ -810,6 +815,96 @@ bool OutputStateMachineEngine::ActionIgnore() noexcept
     return true;
 }
 
+// Routine Description:
+// - Called when the string of an OSC sequence starts. OSC 52 clipboard payloads
+//   can be many MB large, which is why they're base64 decoded as they arrive,
+//   instead of being collected and passed to ActionOscDispatch in one piece.
+//   The strings of OSC sequences that we don't support are skipped right away.
+//   When there's a TTY attached to us we can't do either, because the whole
+//   sequence needs to be flushed to the terminal if we don't handle it.
+// Arguments:
+// - parameter - identifier of the OSC action to perform
+// Return Value:
+// - The handler for the OSC string, or nullptr to have it collected.
+IStateMachineEngine::OscStringHandler OutputStateMachineEngine::ActionOscStringStart(const size_t parameter)
+{
+    if (_pfnFlushToTerminal != nullptr)
+    {
+        return nullptr;
+    }
+
+    switch (parameter)
+    {
+    // These need to match the ones that ActionOscDispatch handles.
+    case OscActionCodes::SetIconAndWindowTitle:
+    case OscActionCodes::SetWindowIcon:
+    case OscActionCodes::SetWindowTitle:
+    case OscActionCodes::SetColor:
+    case OscActionCodes::SetForegroundColor:
+    case OscActionCodes::SetBackgroundColor:
+    case OscActionCodes::SetCursorColor:
+    case OscActionCodes::ResetCursorColor:
+    case OscActionCodes::Hyperlink:
+    case OscActionCodes::ConEmuAction:
+    case OscActionCodes::ITerm2Action:
+    case OscActionCodes::FinalTermAction:
+        return nullptr;
+    case OscActionCodes::SetClipboard:
+        break;
+    default:
+        // Just like ActionOscDispatch would, fail the dispatch once the string ends.
+        return [this](const std::wstring_view chunk) {
+            if (chunk.empty())
+            {
+                _ClearLastChar();
+                return false;
+            }
+            return true;
+        };
+    }
+
+    // The format is `Pc;Pd`, where Pc is ignored and Pd is base64 or `?`. See _GetOscSetClipboard.
+    return [this, decoder = Base64::Decoder{}, hasPayload = false, payloadSize = size_t{ 0 }, queryClipboard = false](const std::wstring_view chunk) mutable {
+        if (chunk.empty())
+        {
+            auto success = false;
+            if (queryClipboard)
+            {
+                success = true;
+            }
+            else if (hasPayload)
+            {
+                std::wstring setClipboardContent;
+                success = SUCCEEDED_LOG(decoder.Finish(setClipboardContent)) && _dispatch->SetClipboard(setClipboardContent);
+            }
+            TermTelemetry::Instance().Log(TermTelemetry::Codes::OSCSCB);
+            _ClearLastChar();
+            return success;
+        }
+
+        auto data = chunk;
+        if (!hasPayload)
+        {
+            const auto pos = data.find(L';');
+            if (pos == std::wstring_view::npos)
+            {
+                return true;
+            }
+            hasPayload = true;
+            data = data.substr(pos + 1);
+        }
+
+        if (!data.empty())
+        {
+            // A "?" isn't valid base64, so if more follows, the decoder will fail as it should.
+            queryClipboard = payloadSize == 0 && data == L"?";
+            payloadSize += data.size();
+            decoder.Feed(data);
+        }
+        return true;
+    };
+}
+
 // Routine Description:
 // - Triggers the OscDispatch action to indicate that the listener should handle a control sequence.
 //   These sequences perform various API-type commands that can include many parameters.
@@ -10,6 +10,7 @@
 #pragma warning(disable : 26447) // The function is declared 'noexcept' but calls function '...' which may throw exceptions (f.6).
 #pragma warning(disable : 26481) // Don't use pointer arithmetic. Use span instead (bounds.1).
 #pragma warning(disable : 26482) // Only index into arrays using constant expressions (bounds.2).
+#pragma warning(disable : 26490) // Don't use reinterpret_cast (type.1).
 
 using namespace Microsoft::Console::VirtualTerminal;
 
@@ -26,133 +27,215 @@ static constexpr uint8_t decodeTable[128] = {
 };
 // clang-format on
 
-// Decodes an UTF8 string encoded with RFC 4648 (Base64) and returns it as UTF16 in dst.
-// It supports both variants of the RFC (base64 and base64url), but
-// throws an error for non-alphabet characters, including newlines.
-// * Throws an exception for all invalid base64 inputs.
-// * Doesn't support whitespace and will throw an exception for such strings.
-// * Doesn't validate the number of trailing "=". Those are basically ignored.
-//   Strings like "YQ===" will be accepted as valid input and simply result in "a".
-HRESULT Base64::Decode(const std::wstring_view& src, std::wstring& dst) noexcept
+// Translates 16 base64 characters into their 6-bit values in out.
+// Returns false if any of them isn't part of the alphabet, including "=",
+// in which case the caller needs to decode them one by one instead.
+// For the valid characters this computes the same as decodeTable, but 16 at a time:
+// 'A'-'Z' are offset by -65, 'a'-'z' by -71, '0'-'9' by +4 and "+-" and "/_" map to 62 and 63.
+static bool translate16(const wchar_t* in, uint8_t* out) noexcept
+{
+#if defined(_M_AMD64) || defined(_M_IX86)
+    // packus saturates [0x100,0x7fff] to 0xff and [0x8000,0xffff] to 0, both of which are invalid.
+    const auto ch = _mm_packus_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 8)));
+    // There are only signed 8-bit comparisons in SSE2, but [0x80,0xff] is invalid anyways and
+    // as negative numbers those are never in any of the (positive) ranges we're testing for.
+    const auto inRange = [&](const char lo, const char hi) noexcept {
+        return _mm_and_si128(_mm_cmpgt_epi8(ch, _mm_set1_epi8(lo - 1)), _mm_cmplt_epi8(ch, _mm_set1_epi8(hi + 1)));
+    };
+    const auto isChar = [&](const char c) noexcept {
+        return _mm_cmpeq_epi8(ch, _mm_set1_epi8(c));
+    };
+
+    const auto upper = inRange('A', 'Z');
+    const auto lower = inRange('a', 'z');
+    const auto digit = inRange('0', '9');
+    const auto is62 = _mm_or_si128(isChar('+'), isChar('-'));
+    const auto is63 = _mm_or_si128(isChar('/'), isChar('_'));
+
+    const auto alpha = _mm_or_si128(_mm_or_si128(upper, lower), digit);
+    const auto valid = _mm_or_si128(alpha, _mm_or_si128(is62, is63));
+    if (_mm_movemask_epi8(valid) != 0xffff)
+    {
+        return false;
+    }
+
+    auto offset = _mm_and_si128(upper, _mm_set1_epi8(-65));
+    offset = _mm_or_si128(offset, _mm_and_si128(lower, _mm_set1_epi8(-71)));
+    offset = _mm_or_si128(offset, _mm_and_si128(digit, _mm_set1_epi8(4)));
+
+    auto values = _mm_and_si128(alpha, _mm_add_epi8(ch, offset));
+    values = _mm_or_si128(values, _mm_and_si128(is62, _mm_set1_epi8(62)));
+    values = _mm_or_si128(values, _mm_and_si128(is63, _mm_set1_epi8(63)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), values);
+    return true;
+#elif defined(_M_ARM64)
+    // vqmovn saturates [0x100,0xffff] to 0xff, which is invalid.
+    const auto ch = vcombine_u8(vqmovn_u16(vld1q_u16(reinterpret_cast<const uint16_t*>(in))), vqmovn_u16(vld1q_u16(reinterpret_cast<const uint16_t*>(in + 8))));
+    // NEON has proper unsigned comparisons, so (ch - lo) <= (hi - lo) tests for lo <= ch <= hi.
+    const auto inRange = [&](const uint8_t lo, const uint8_t hi) noexcept {
+        return vcleq_u8(vsubq_u8(ch, vdupq_n_u8(lo)), vdupq_n_u8(hi - lo));
+    };
+    const auto isChar = [&](const uint8_t c) noexcept {
+        return vceqq_u8(ch, vdupq_n_u8(c));
+    };
+
+    const auto upper = inRange('A', 'Z');
+    const auto lower = inRange('a', 'z');
+    const auto digit = inRange('0', '9');
+    const auto is62 = vorrq_u8(isChar('+'), isChar('-'));
+    const auto is63 = vorrq_u8(isChar('/'), isChar('_'));
+
+    const auto alpha = vorrq_u8(vorrq_u8(upper, lower), digit);
+    const auto valid = vorrq_u8(alpha, vorrq_u8(is62, is63));
+    if (vminvq_u8(valid) != 0xff)
+    {
+        return false;
+    }
+
+    auto offset = vandq_u8(upper, vdupq_n_u8(static_cast<uint8_t>(-65)));
+    offset = vorrq_u8(offset, vandq_u8(lower, vdupq_n_u8(static_cast<uint8_t>(-71))));
+    offset = vorrq_u8(offset, vandq_u8(digit, vdupq_n_u8(4)));
+
+    auto values = vandq_u8(alpha, vaddq_u8(ch, offset));
+    values = vorrq_u8(values, vandq_u8(is62, vdupq_n_u8(62)));
+    values = vorrq_u8(values, vandq_u8(is63, vdupq_n_u8(63)));
+    vst1q_u8(out, values);
+    return true;
+#else
+    UNREFERENCED_PARAMETER(in);
+    UNREFERENCED_PARAMETER(out);
+    return false;
+#endif
+}
+
+// Capturing r/error by reference produces less optimal assembly.
+static constexpr auto accumulate = [](auto& r, auto& error, auto ch) {
+    // n will be in the range [0, 0x3f] for valid ch
+    // and exactly 0xff for invalid ch.
+    const auto n = decodeTable[ch & 0x7f];
+    // Both ch > 0x7f, as well as n > 0x7f are invalid values and count as an error.
+    // We can add the error state by checking if any bits ~0x7f are set (which is 0xff80).
+    error |= (ch | n) & 0xff80;
+    r = r << 6 | n;
+};
+
+// Decodes the next chunk of an UTF8 string encoded with RFC 4648 (Base64).
+// The chunks can be split anywhere, even in the middle of a group of 4 characters.
+// Errors are only reported once the whole string has been fed, by Finish().
+void Base64::Decoder::Feed(const std::wstring_view& src) noexcept
 {
-    std::string result;
-    result.resize(((src.size() + 3) / 4) * 3);
+    // Every group of 4 characters, including the ones left over
+    // from the previous chunk, decodes into 3 bytes.
+    const auto offset = _result.size();
+    _result.resize(offset + (_ri + src.size()) / 4 * 3);
 
     // in and inEnd may be nullptr if src.empty().
     // The remaining code in this function ensures not to read from in if src.empty().
 #pragma warning(suppress : 26429) // Symbol 'in' is never tested for nullness, it can be marked as not_null (f.23).
     auto in = src.data();
     const auto inEnd = in + src.size();
-    // Sometimes in programming you have to ask yourself what the right offset for a pointer is.
-    // Is 4 enough? Certainly not. 6 on the other hand is just way too much. Clearly 5 is just right.
-    //
-    // In all seriousness however the offset is 5, because the batched loop reads 4 characters at a time,
-    // a base64 string can end with two "=" and the batched loop doesn't handle any such "=".
-    // Additionally the while() condition of the batched loop would make a lot more sense if it were using <=,
-    // but for reasons outlined below it needs to use < so we need to add 1 back again.
-    // We thus get -4-2+1 which is -5.
-    //
-    // There's a special reason we need to use < and not <= for the loop:
-    // In C++ it's undefined behavior to perform any pointer arithmetic that leads to unallocated memory,
-    // which is why we can't just write `inEnd - 6` as that might be UB if `src.size()` is less than 6.
-    // We thus would need write `inEnd - min(6, src.size())` in combination with `<=` for the batched loop.
-    // But if `src.size()` is actually less than 6 then `inEnd` is equal to the initial `in`, aka: an empty range.
-    // In such cases we'd enter the batched loop and read from `in` despite us not wanting to enter the loop.
-    // We can fix the issue by using < instead and adding +1 to the offset.
-    //
-    // Yes this works.
-    const auto inEndBatched = inEnd - std::min<size_t>(5, src.size());
-
-    // outBeg and out may be nullptr if src.empty().
-    // The remaining code in this function ensures not to write to out if src.empty().
-    const auto outBeg = result.data();
+    const auto outBeg = _result.data();
 #pragma warning(suppress : 26429) // Symbol 'out' is never tested for nullness, it can be marked as not_null (f.23).
-    auto out = outBeg;
-
-    // r is just a generic "remainder" we use to accumulate 4 base64 chars into 3 output bytes.
-    uint_fast32_t r = 0;
-    // error is treated as a boolean. If it's not 0 we had an invalid input character.
-    uint_fast16_t error = 0;
-
-    // Capturing r/error by reference produces less optimal assembly.
-    static constexpr auto accumulate = [](auto& r, auto& error, auto ch) {
-        // n will be in the range [0, 0x3f] for valid ch
-        // and exactly 0xff for invalid ch.
-        const auto n = decodeTable[ch & 0x7f];
-        // Both ch > 0x7f, as well as n > 0x7f are invalid values and count as an error.
-        // We can add the error state by checking if any bits ~0x7f are set (which is 0xff80).
-        error |= (ch | n) & 0xff80;
-        r = r << 6 | n;
-    };
+    auto out = outBeg + offset;
 
-    // If src.empty() then `in == inEndBatched == nullptr` and this is skipped.
-    while (in < inEndBatched)
-    {
-        const auto ch0 = *in++;
-        const auto ch1 = *in++;
-        const auto ch2 = *in++;
-        const auto ch3 = *in++;
-
-        // Most other base64 libraries do something like this:
-        //   const auto n0 = decodeTable[a];
-        //   const auto n1 = decodeTable[b];
-        //   const auto n2 = decodeTable[c];
-        //   const auto n3 = decodeTable[d];
-        //   *out++ = n0 << 2 | n1 >> 4;
-        //   *out++ = (n1 & 0xf) << 4 | n2 >> 2;
-        //   *out++ = (n2 & 0x3) << 6 | n3;
-        //
-        // But on all modern CPUs I tested (well even those 10 years old at this point) shifting base64
-        // characters into a single register (here: r) is faster than the traditional approach.
-        // I believe this is due to reducing the dependency of instructions on prior calculations.
-        accumulate(r, error, ch0);
-        accumulate(r, error, ch1);
-        accumulate(r, error, ch2);
-        accumulate(r, error, ch3);
-
-        *out++ = gsl::narrow_cast<char>(r >> 16);
-        *out++ = gsl::narrow_cast<char>(r >> 8);
-        *out++ = gsl::narrow_cast<char>(r >> 0);
-    }
+    auto r = _r;
+    auto ri = _ri;
+    auto error = _error;
+    auto padding = _padding;
 
+    while (in != inEnd)
     {
-        uint_fast8_t ri = 0;
-
-        // If src.empty() then `in == inEnd == nullptr` and this is skipped.
-        for (; in < inEnd; ++in)
+        // The vectorized path only runs at the start of a group and before any padding,
+        // which are both true for all but the end of a valid base64 string.
+        if (ri == 0 && !padding && inEnd - in >= 16)
         {
-            if (const auto ch = *in; ch != '=')
+            uint8_t values[16];
+            if (translate16(in, &values[0]))
             {
-                accumulate(r, error, ch);
-                ri++;
+                for (size_t i = 0; i < 16; i += 4)
+                {
+                    const auto group = static_cast<uint32_t>(values[i]) << 18 | static_cast<uint32_t>(values[i + 1]) << 12 | static_cast<uint32_t>(values[i + 2]) << 6 | values[i + 3];
+                    *out++ = gsl::narrow_cast<char>(group >> 16);
+                    *out++ = gsl::narrow_cast<char>(group >> 8);
+                    *out++ = gsl::narrow_cast<char>(group >> 0);
+                }
+                in += 16;
+                continue;
             }
         }
 
-        switch (ri)
+        const auto ch = *in++;
+        if (ch == '=')
+        {
+            padding = true;
+            continue;
+        }
+
+        // Nothing but more padding may follow a "=".
+        error |= padding;
+        accumulate(r, error, ch);
+
+        if (++ri == 4)
         {
-        case 2:
-            *out++ = gsl::narrow_cast<char>(r >> 4);
-            break;
-        case 3:
-            *out++ = gsl::narrow_cast<char>(r >> 10);
-            *out++ = gsl::narrow_cast<char>(r >> 2);
-            break;
-        case 4:
             *out++ = gsl::narrow_cast<char>(r >> 16);
             *out++ = gsl::narrow_cast<char>(r >> 8);
             *out++ = gsl::narrow_cast<char>(r >> 0);
-            break;
-        default:
-            error |= ri;
-            break;
+            ri = 0;
         }
     }
 
+    // The "=" were counted as if they were part of a group.
+    _result.resize(out - outBeg);
+    _r = r;
+    _ri = ri;
+    _error = error;
+    _padding = padding;
+}
+
+// Decodes the remaining characters and returns everything that was fed to this decoder as UTF16 in dst.
+// Afterwards the decoder is reset and can be used for the next string.
+// * Returns an error for all invalid base64 inputs.
+// * Doesn't support whitespace and will return an error for such strings.
+// * Doesn't validate the number of trailing "=". Those are basically ignored.
+//   Strings like "YQ===" will be accepted as valid input and simply result in "a".
+HRESULT Base64::Decoder::Finish(std::wstring& dst) noexcept
+{
+    auto result = std::move(_result);
+    auto error = _error;
+
+    switch (_ri)
+    {
+    case 0:
+        break;
+    case 2:
+        result.push_back(gsl::narrow_cast<char>(_r >> 4));
+        break;
+    case 3:
+        result.push_back(gsl::narrow_cast<char>(_r >> 10));
+        result.push_back(gsl::narrow_cast<char>(_r >> 2));
+        break;
+    default:
+        error |= _ri;
+        break;
+    }
+
+    *this = {};
+
     if (error)
     {
         return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
     }
 
-    result.resize(out - outBeg);
     return til::u8u16(result, dst);
 }
+
+// Decodes an UTF8 string encoded with RFC 4648 (Base64) and returns it as UTF16 in dst.
+// It supports both variants of the RFC (base64 and base64url), but
+// returns an error for non-alphabet characters, including newlines.
+// See Decoder::Finish() for the details.
+HRESULT Base64::Decode(const std::wstring_view& src, std::wstring& dst) noexcept
+{
+    Decoder decoder;
+    decoder.Feed(src);
+    return decoder.Finish(dst);
+}
@@ -7,6 +7,8 @@ Module Name:
 
 Abstract:
 - This declares standard base64 encoding and decoding, with paddings when needed.
+- Base64::Decoder decodes a payload that arrives in chunks, like the OSC 52
+  clipboard payloads that are fed to it while they're being parsed.
 */
 
 #pragma once
@@ -16,6 +18,25 @@ namespace Microsoft::Console::VirtualTerminal
     class Base64
     {
     public:
+        class Decoder
+        {
+        public:
+            void Feed(const std::wstring_view& src) noexcept;
+            HRESULT Finish(std::wstring& dst) noexcept;
+
+        private:
+            // The decoded bytes so far. They're only converted to UTF-16 in Finish(),
+            // because a chunk may end in the middle of a UTF-8 sequence.
+            std::string _result;
+            // The accumulator for the current group of 4 characters and how many of them we have.
+            uint_fast32_t _r = 0;
+            uint_fast8_t _ri = 0;
+            // Set once we've seen a "=", after which only more "=" are allowed.
+            bool _padding = false;
+            // Treated as a boolean. If it's not 0 we had an invalid input character.
+            uint_fast16_t _error = 0;
+        };
+
         static HRESULT Decode(const std::wstring_view& src, std::wstring& dst) noexcept;
     };
 }
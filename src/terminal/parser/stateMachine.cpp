@@ -9,6 +9,10 @@
 
 using namespace Microsoft::Console::VirtualTerminal;
 
+// Most OSC strings are short, but the buffer of an unusually long
+// one is freed once it's been dispatched, instead of being retained.
+static constexpr size_t OSC_STRING_RETAINED_CAPACITY = 4096;
+
 //Takes ownership of the pEngine.
 StateMachine::StateMachine(std::unique_ptr<IStateMachineEngine> engine, const bool isEngineForInput) :
     _engine(std::move(engine)),
@@ -34,6 +38,17 @@ bool StateMachine::GetParserMode(const Mode mode) const noexcept
     return _parserMode.test(mode);
 }
 
+// Routine Description:
+// - Sets the maximum length of an OSC string. Longer ones are ignored.
+// Arguments:
+// - limit - The maximum number of characters. The default is DEFAULT_OSC_STRING_LIMIT.
+// Return Value:
+// - <none>
+void StateMachine::SetOscStringLimit(const size_t limit) noexcept
+{
+    _oscStringLimit = limit;
+}
+
 const IStateMachineEngine& StateMachine::Engine() const noexcept
 {
     return *_engine;
@@ -379,6 +394,112 @@ static constexpr bool _isActionableFromGround(const wchar_t wch) noexcept
 
 #pragma warning(pop)
 
+// Routine Description:
+// - Finds the first character in the given string for which _isActionableFromGround() is true.
+//   This is the hot path for printable text in the ground state, which is why it's vectorized.
+//   The actionable characters are [0x00,0x1F] and [0x7F,0x9F]. Since there's no unsigned 16-bit
+//   comparison in SSE2, we use saturating subtraction instead: (x -sat k) == 0 is equivalent to x <= k.
+//   The second range is tested by first shifting it down to [0x00,0x20] with a wrapping subtraction.
+// Arguments:
+// - string - The string to scan.
+// Return Value:
+// - The offset of the first actionable character, or string.size() if there's none.
+#pragma warning(push)
+#pragma warning(disable : 26481) // Don't use pointer arithmetic. Use span instead (bounds.1).
+#pragma warning(disable : 26490) // Don't use reinterpret_cast (type.1).
+static size_t _findActionableFromGround(const std::wstring_view string) noexcept
+{
+    auto it = string.data();
+    const auto end = it + string.size();
+
+#if defined(__AVX2__)
+    const auto c0Max = _mm256_set1_epi16(AsciiChars::US);
+    const auto c1Min = _mm256_set1_epi16(AsciiChars::DEL);
+    const auto c1Span = _mm256_set1_epi16(0x9F - AsciiChars::DEL);
+    const auto zero = _mm256_setzero_si256();
+
+    for (; end - it >= 16; it += 16)
+    {
+        const auto vec = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(it));
+        const auto c0 = _mm256_cmpeq_epi16(_mm256_subs_epu16(vec, c0Max), zero);
+        const auto c1 = _mm256_cmpeq_epi16(_mm256_subs_epu16(_mm256_sub_epi16(vec, c1Min), c1Span), zero);
+        const auto mask = static_cast<unsigned long>(_mm256_movemask_epi8(_mm256_or_si256(c0, c1)));
+        unsigned long index;
+        if (_BitScanForward(&index, mask))
+        {
+            // The mask contains 2 bits per wchar_t.
+            return static_cast<size_t>(it - string.data()) + index / 2;
+        }
+    }
+#elif defined(_M_AMD64) || defined(_M_IX86)
+    const auto c0Max = _mm_set1_epi16(AsciiChars::US);
+    const auto c1Min = _mm_set1_epi16(AsciiChars::DEL);
+    const auto c1Span = _mm_set1_epi16(0x9F - AsciiChars::DEL);
+    const auto zero = _mm_setzero_si128();
+
+    for (; end - it >= 8; it += 8)
+    {
+        const auto vec = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+        const auto c0 = _mm_cmpeq_epi16(_mm_subs_epu16(vec, c0Max), zero);
+        const auto c1 = _mm_cmpeq_epi16(_mm_subs_epu16(_mm_sub_epi16(vec, c1Min), c1Span), zero);
+        const auto mask = static_cast<unsigned long>(_mm_movemask_epi8(_mm_or_si128(c0, c1)));
+        unsigned long index;
+        if (_BitScanForward(&index, mask))
+        {
+            // The mask contains 2 bits per wchar_t.
+            return static_cast<size_t>(it - string.data()) + index / 2;
+        }
+    }
+#elif defined(_M_ARM64)
+    // NEON has proper unsigned comparisons, so this is a straightforward translation.
+    const auto c0Max = vdupq_n_u16(AsciiChars::US);
+    const auto c1Min = vdupq_n_u16(AsciiChars::DEL);
+    const auto c1Span = vdupq_n_u16(0x9F - AsciiChars::DEL);
+
+    for (; end - it >= 8; it += 8)
+    {
+        const auto vec = vld1q_u16(reinterpret_cast<const uint16_t*>(it));
+        const auto c0 = vcleq_u16(vec, c0Max);
+        const auto c1 = vcleq_u16(vsubq_u16(vec, c1Min), c1Span);
+        // Narrowing the 8 16-bit results to 8 bytes gives us a 64-bit mask with 8 bits per wchar_t.
+        const auto mask = vget_lane_u64(vreinterpret_u64_u8(vmovn_u16(vorrq_u16(c0, c1))), 0);
+        unsigned long index;
+        if (_BitScanForward64(&index, mask))
+        {
+            return static_cast<size_t>(it - string.data()) + index / 8;
+        }
+    }
+#endif
+
+    for (; it != end; ++it)
+    {
+        if (_isActionableFromGround(*it))
+        {
+            break;
+        }
+    }
+
+    return static_cast<size_t>(it - string.data());
+}
+#pragma warning(pop)
+
+// Routine Description:
+// - Finds the first character in the given OSC, SOS, PM or APC string (or ignored DCS string)
+//   that the state machine would do anything with, other than adding it to or ignoring it as part of
+//   the string. Those are the C0 controls (including BEL and ESC), as well as the C1 controls,
+//   since they might be an ST.
+// Arguments:
+// - string - The string to scan.
+// Return Value:
+// - The offset of the first such character, or string.size() if there's none.
+static size_t _findControlInString(const std::wstring_view string) noexcept
+{
+    const auto it = std::find_if(string.begin(), string.end(), [](const auto wch) {
+        return wch < L' ' || (wch >= L'\x80' && wch <= L'\x9f');
+    });
+    return static_cast<size_t>(it - string.begin());
+}
+
 // Routine Description:
 // - Triggers the Execute action to indicate that the listener should immediately respond to a C0 control character.
 // Arguments:
@@ -561,8 +682,18 @@ void StateMachine::_ActionClear()
     _parameters.clear();
     _parameterLimitReached = false;
 
-    _oscString.clear();
+    if (_oscString.capacity() > OSC_STRING_RETAINED_CAPACITY)
+    {
+        _oscString = std::wstring{};
+    }
+    else
+    {
+        _oscString.clear();
+    }
     _oscParameter = 0;
+    _oscStringHandler = nullptr;
+    _oscStringSize = 0;
+    _oscStringOverflow = false;
 
     _dcsStringHandler = nullptr;
 
@@ -622,7 +753,60 @@ void StateMachine::_ActionOscPut(const wchar_t wch)
 {
     _trace.TraceOnAction(L"OscPut");
 
-    _oscString.push_back(wch);
+    _AppendOscString({ &wch, 1 });
+}
+
+// Routine Description:
+// - Stores a run of characters as part of the OSC string. This is how ProcessString()
+//   passes the bulk of an OSC string on, without going through the state machine
+//   one character at a time.
+// Arguments:
+// - string - Characters to store.
+// Return Value:
+// - <none>
+void StateMachine::_ActionOscPutString(const std::wstring_view string)
+{
+    _trace.TraceOnAction(L"OscPutString");
+
+    _AppendOscString(string);
+}
+
+// Routine Description:
+// - Passes the given part of the OSC string to the _oscStringHandler, or collects it
+//   in _oscString if there's none. Once the string exceeds the _oscStringLimit, it's
+//   discarded, together with what we've got so far, and the rest of it is ignored.
+// Arguments:
+// - string - Characters to store.
+// Return Value:
+// - <none>
+void StateMachine::_AppendOscString(const std::wstring_view string)
+{
+    if (_oscStringOverflow)
+    {
+        return;
+    }
+
+    _oscStringSize += string.size();
+    if (_oscStringSize > _oscStringLimit)
+    {
+        _oscStringOverflow = true;
+        _oscStringHandler = nullptr;
+        _oscString = std::wstring{};
+        // There's no point in flushing the start of a sequence that we'll never finish.
+        _cachedSequence.reset();
+        return;
+    }
+
+    if (_oscStringHandler)
+    {
+        _SafeExecute([=]() {
+            return _oscStringHandler(string);
+        });
+    }
+    else
+    {
+        _oscString.append(string);
+    }
 }
 
 // Routine Description:
@@ -635,6 +819,21 @@ void StateMachine::_ActionOscPut(const wchar_t wch)
 void StateMachine::_ActionOscDispatch(const wchar_t wch)
 {
     _trace.TraceOnAction(L"OscDispatch");
+    if (_oscStringOverflow)
+    {
+        _trace.DispatchSequenceTrace(false);
+        return;
+    }
+    if (_oscStringHandler)
+    {
+        // We need to take ownership of the handler, so that it's called only once.
+        const auto handler = std::move(_oscStringHandler);
+        _oscStringHandler = nullptr;
+        _trace.DispatchSequenceTrace(_SafeExecuteWithLog(wch, [&]() {
+            return handler({});
+        }));
+        return;
+    }
     _trace.DispatchSequenceTrace(_SafeExecuteWithLog(wch, [=]() {
         return _engine->ActionOscDispatch(wch, _oscParameter, _oscString);
     }));
@@ -700,6 +899,7 @@ void StateMachine::_EnterGround() noexcept
 {
     _state = VTStates::Ground;
     _cachedSequence.reset(); // entering ground means we've completed the pending sequence
+    _oscStringHandler = nullptr; // ...or that it was cancelled
     _trace.TraceStateChange(L"Ground");
 }
 
@@ -814,10 +1014,15 @@ void StateMachine::_EnterOscParam() noexcept
 // - <none>
 // Return Value:
 // - <none>
-void StateMachine::_EnterOscString() noexcept
+void StateMachine::_EnterOscString()
 {
     _state = VTStates::OscString;
     _trace.TraceStateChange(L"OscString");
+
+    _SafeExecute([=]() {
+        _oscStringHandler = _engine->ActionOscStringStart(_oscParameter);
+        return true;
+    });
 }
 
 // Routine Description:
@@ -1821,6 +2026,101 @@ bool StateMachine::FlushToTerminal()
     return success;
 }
 
+
+// Routine Description:
+// - A fast path for the most common control sequences in output: SGR, CUP, ED and EL.
+//   Colored compiler diagnostics, "ls --color" and TUI repaints consist mostly of these,
+//   and parsing them character by character through the state transitions is expensive.
+//   If the current string contains a complete "CSI Pn;...;Pn m/H/J/K" sequence at the given
+//   offset, this parses the parameters in one go and dispatches it just like the regular
+//   CsiParam state would. Anything more complicated (private markers, intermediates, C0
+//   controls within the sequence, too many parameters, or a sequence that is split across
+//   writes) is left to the regular state machine, by returning 0.
+// Arguments:
+// - offset - The offset of the ESC character in _currentString.
+// Return Value:
+// - The length of the sequence that was dispatched or 0 if the fast path didn't apply.
+size_t StateMachine::_TryDispatchSimpleCsi(const size_t offset)
+{
+    const auto sequence = _currentString.substr(offset);
+    if (sequence.size() < 3 || til::at(sequence, 1) != L'[')
+    {
+        return 0;
+    }
+
+    size_t parameterCount = 0;
+    auto end = sequence.size();
+    for (size_t i = 2; i < sequence.size(); ++i)
+    {
+        const auto wch = til::at(sequence, i);
+        if (_isNumericParamValue(wch))
+        {
+            parameterCount = std::max<size_t>(parameterCount, 1);
+        }
+        else if (_isParameterDelimiter(wch))
+        {
+            // An initial delimiter counts as 2 parameters, just like in _ActionParam.
+            parameterCount = std::max<size_t>(parameterCount, 1) + 1;
+        }
+        else
+        {
+            end = i;
+            break;
+        }
+    }
+
+    if (end == sequence.size() || parameterCount > MAX_PARAMETER_COUNT)
+    {
+        return 0;
+    }
+
+    const auto finalChar = til::at(sequence, end);
+    if (finalChar != L'm' && finalChar != L'H' && finalChar != L'J' && finalChar != L'K')
+    {
+        return 0;
+    }
+
+    const auto length = end + 1;
+
+    // This replicates the tracing of the regular path, which starts the sequence trace after the ESC.
+    _trace.TraceCharInput(AsciiChars::ESC);
+    _trace.ClearSequenceTrace();
+    for (const auto wch : sequence.substr(1, end))
+    {
+        _trace.TraceCharInput(wch);
+    }
+
+    _EnterCsiEntry();
+
+    if (parameterCount)
+    {
+        _parameters.push_back({});
+        for (const auto wch : sequence.substr(2, end - 2))
+        {
+            if (_isParameterDelimiter(wch))
+            {
+                _parameters.push_back({});
+            }
+            else
+            {
+                auto currentParameter = _parameters.back().value_or(0);
+                _AccumulateTo(wch, currentParameter);
+                _parameters.back() = currentParameter;
+            }
+        }
+    }
+
+    // If the engine decides to pass the sequence through, it'll use the current run.
+    _runOffset = offset;
+    _runSize = length;
+    _processingLastCharacter = offset + length >= _currentString.size();
+
+    _ActionCsiDispatch(finalChar);
+    _EnterGround();
+    _ExecuteCsiCompleteCallback();
+    return length;
+}
+
 // Routine Description:
 // - Helper for entry to the state machine. Will take an array of characters
 //     and print as many as it can without encountering a character indicating
@@ -1835,6 +2135,9 @@ void StateMachine::ProcessString(const std::wstring_view string)
     size_t start = 0;
     auto current = start;
 
+    // Check once whether anyone is tracing us before we get to the per-character work.
+    _trace.Refresh();
+
     _currentString = string;
     _runOffset = 0;
     _runSize = 0;
@@ -1847,6 +2150,23 @@ void StateMachine::ProcessString(const std::wstring_view string)
         _runOffset = start;
         _runSize = current - start + 1;
 
+        if (_processingIndividually && (_state == VTStates::OscString || _state == VTStates::DcsIgnore || _state == VTStates::SosPmApcString))
+        {
+            // The bulk of a string skips the state machine until the next control
+            // character, which is the only thing that could end it. In the OscString
+            // state it's stored in one go, and in the others it's simply ignored.
+            const auto length = _findControlInString(string.substr(current));
+            if (length)
+            {
+                if (_state == VTStates::OscString)
+                {
+                    _ActionOscPutString(string.substr(current, length));
+                }
+                current += length;
+                continue;
+            }
+        }
+
         if (_processingIndividually)
         {
             // Note whether we're dealing with the last character in the buffer.
@@ -1873,13 +2193,27 @@ void StateMachine::ProcessString(const std::wstring_view string)
                     _ActionPrintString(_CurrentRun()); // ... print all the chars leading up to it as part of the run...
                 }
 
+                // The most common control sequences don't need to go through the state machine at all.
+                if (_isEscape(til::at(string, current)) && !_isEngineForInput && _parserMode.test(Mode::Ansi))
+                {
+                    if (const auto consumed = _TryDispatchSimpleCsi(current))
+                    {
+                        current += consumed;
+                        start = current;
+                        continue;
+                    }
+                }
+
                 _processingIndividually = true; // begin processing future characters individually...
                 start = current;
                 continue;
             }
             else
             {
-                ++current; // Otherwise, add this char to the current run to be printed.
+                // Otherwise, add this char to the current run to be printed,
+                // along with all of the printable characters that follow it.
+                ++current;
+                current += _findActionableFromGround(string.substr(current));
             }
         }
     }
@@ -1968,13 +2302,14 @@ void StateMachine::ProcessString(const std::wstring_view string)
             // after dispatching the characters
             _EnterGround();
         }
-        else if (_state != VTStates::SosPmApcString && _state != VTStates::DcsPassThrough && _state != VTStates::DcsIgnore)
+        else if (_state != VTStates::SosPmApcString && _state != VTStates::DcsPassThrough && _state != VTStates::DcsIgnore && !_oscStringHandler && !_oscStringOverflow)
         {
             // If the engine doesn't require flushing at the end of the string, we
             // want to cache the partial sequence in case we have to flush the whole
             // thing to the terminal later. There is no need to do this if we've
             // reached one of the string processing states, though, since that data
-            // will be dealt with as soon as it is received.
+            // will be dealt with as soon as it is received. The same applies to
+            // OSC strings that are passed to an _oscStringHandler or are ignored.
             if (!_cachedSequence)
             {
                 _cachedSequence.emplace(std::wstring{});
@@ -1986,6 +2321,33 @@ void StateMachine::ProcessString(const std::wstring_view string)
     }
 }
 
+// Routine Description:
+// - Processes a string that's known to contain no characters that are actionable
+//   from the ground state, like the precomputed text runs of a macro. In the
+//   ground state it can be printed directly, without scanning it first. In any
+//   other state it's part of a sequence and is processed like any other string.
+// Arguments:
+// - string - Characters to operate upon
+// Return Value:
+// - <none>
+void StateMachine::ProcessPrintableString(const std::wstring_view string)
+{
+    if (_state != VTStates::Ground)
+    {
+        ProcessString(string);
+        return;
+    }
+
+    if (!string.empty())
+    {
+        _currentString = string;
+        _runOffset = 0;
+        _runSize = string.size();
+        _ActionPrintString(string);
+        _runSize = 0;
+    }
+}
+
 // Routine Description:
 // - Determines whether the character being processed is the last in the
 //   current output fragment, or there are more still to come. Other parts
@@ -1999,6 +2361,14 @@ bool StateMachine::IsProcessingLastCharacter() const noexcept
     return _processingLastCharacter;
 }
 
+// Routine Description:
+// - Returns true if the state machine isn't in the middle of a control sequence,
+//   i.e. the next character will be parsed as if it was the start of the input.
+bool StateMachine::IsInGroundState() const noexcept
+{
+    return _state == VTStates::Ground;
+}
+
 // Routine Description:
 // - Registers a function that will be called once the current CSI action is
 //   complete and the state machine has returned to the ground state.
@@ -32,6 +32,11 @@ namespace Microsoft::Console::VirtualTerminal
     // that number.
     constexpr size_t MAX_PARAMETER_COUNT = 32;
 
+    // OSC strings that are longer than this are ignored, so that a runaway
+    // sequence can't make us use an unbounded amount of memory. This still
+    // leaves room for OSC 52 clipboard payloads that are several MB large.
+    constexpr size_t DEFAULT_OSC_STRING_LIMIT = 8 * 1024 * 1024;
+
     class StateMachine final
     {
 #ifdef UNIT_TESTING
@@ -56,10 +61,13 @@ namespace Microsoft::Console::VirtualTerminal
 
         void SetParserMode(const Mode mode, const bool enabled) noexcept;
         bool GetParserMode(const Mode mode) const noexcept;
+        void SetOscStringLimit(const size_t limit) noexcept;
 
         void ProcessCharacter(const wchar_t wch);
         void ProcessString(const std::wstring_view string);
+        void ProcessPrintableString(const std::wstring_view string);
         bool IsProcessingLastCharacter() const noexcept;
+        bool IsInGroundState() const noexcept;
 
         void OnCsiComplete(const std::function<void()> callback);
 
@@ -89,6 +97,8 @@ namespace Microsoft::Console::VirtualTerminal
         void _ActionCsiDispatch(const wchar_t wch);
         void _ActionOscParam(const wchar_t wch) noexcept;
         void _ActionOscPut(const wchar_t wch);
+        void _ActionOscPutString(const std::wstring_view string);
+        void _AppendOscString(const std::wstring_view string);
         void _ActionOscDispatch(const wchar_t wch);
         void _ActionSs3Dispatch(const wchar_t wch);
         void _ActionDcsDispatch(const wchar_t wch);
@@ -105,7 +115,7 @@ namespace Microsoft::Console::VirtualTerminal
         void _EnterCsiIgnore() noexcept;
         void _EnterCsiIntermediate() noexcept;
         void _EnterOscParam() noexcept;
-        void _EnterOscString() noexcept;
+        void _EnterOscString();
         void _EnterOscTermination() noexcept;
         void _EnterSs3Entry();
         void _EnterSs3Param() noexcept;
@@ -145,6 +155,7 @@ namespace Microsoft::Console::VirtualTerminal
         bool _SafeExecuteWithLog(const wchar_t wch, TLambda&& lambda);
 
         void _ExecuteCsiCompleteCallback();
+        size_t _TryDispatchSimpleCsi(const size_t offset);
 
         enum class VTStates
         {
@@ -197,6 +208,13 @@ namespace Microsoft::Console::VirtualTerminal
 
         std::wstring _oscString;
         VTInt _oscParameter;
+        // If set, the OSC string is passed to this handler as it arrives instead of being collected in _oscString.
+        IStateMachineEngine::OscStringHandler _oscStringHandler;
+        // The length of the current OSC string so far, whether it was collected or not.
+        size_t _oscStringSize = 0;
+        size_t _oscStringLimit = DEFAULT_OSC_STRING_LIMIT;
+        // Set once the current OSC string exceeded _oscStringLimit. The rest of it is ignored.
+        bool _oscStringOverflow = false;
 
         IStateMachineEngine::StringHandler _dcsStringHandler;
 
@@ -34,19 +34,98 @@ namespace Microsoft::Console::VirtualTerminal
         // C-strings is more ergonomic instead and fits the need for
         // high performance in this particular code.
 
-        void TraceStateChange(_In_z_ const wchar_t* name) const noexcept;
-        void TraceOnAction(_In_z_ const wchar_t* name) const noexcept;
-        void TraceOnExecute(const wchar_t wch) const noexcept;
-        void TraceOnExecuteFromEscape(const wchar_t wch) const noexcept;
-        void TraceOnEvent(_In_z_ const wchar_t* name) const noexcept;
-        void TraceCharInput(const wchar_t wch);
-
-        void AddSequenceTrace(const wchar_t wch);
-        void DispatchSequenceTrace(const bool fSuccess) noexcept;
-        void ClearSequenceTrace() noexcept;
-        void DispatchPrintRunTrace(const std::wstring_view& string) const;
+        //
+        // Most of these are called for every character and state transition.
+        // Asking TraceLogging whether anyone is listening each time costs a
+        // function call and a few loads, which adds up in the parser's hot
+        // path. Instead, the answer is cached in _enabled by Refresh(), which
+        // StateMachine calls once per ProcessString(), and the inline wrappers
+        // below only test that flag. A trace session started in the middle of
+        // a string will thus pick up with the next one.
+
+        void Refresh() noexcept;
+        bool IsEnabled() const noexcept { return _enabled; }
+
+        void TraceStateChange(_In_z_ const wchar_t* name) const noexcept
+        {
+            if (_enabled)
+            {
+                _TraceStateChange(name);
+            }
+        }
+        void TraceOnAction(_In_z_ const wchar_t* name) const noexcept
+        {
+            if (_enabled)
+            {
+                _TraceOnAction(name);
+            }
+        }
+        void TraceOnExecute(const wchar_t wch) const noexcept
+        {
+            if (_enabled)
+            {
+                _TraceOnExecute(wch);
+            }
+        }
+        void TraceOnExecuteFromEscape(const wchar_t wch) const noexcept
+        {
+            if (_enabled)
+            {
+                _TraceOnExecuteFromEscape(wch);
+            }
+        }
+        void TraceOnEvent(_In_z_ const wchar_t* name) const noexcept
+        {
+            if (_enabled)
+            {
+                _TraceOnEvent(name);
+            }
+        }
+        void TraceCharInput(const wchar_t wch)
+        {
+            if (_enabled)
+            {
+                _TraceCharInput(wch);
+            }
+        }
+        void AddSequenceTrace(const wchar_t wch)
+        {
+            if (_enabled)
+            {
+                _sequenceTrace.push_back(wch);
+            }
+        }
+        void DispatchSequenceTrace(const bool fSuccess) noexcept
+        {
+            if (_enabled)
+            {
+                _DispatchSequenceTrace(fSuccess);
+            }
+            ClearSequenceTrace();
+        }
+        void ClearSequenceTrace() noexcept
+        {
+            _sequenceTrace.clear();
+        }
+        void DispatchPrintRunTrace(const std::wstring_view& string) const
+        {
+            if (_enabled)
+            {
+                _DispatchPrintRunTrace(string);
+            }
+        }
 
     private:
+        void _TraceStateChange(_In_z_ const wchar_t* name) const noexcept;
+        void _TraceOnAction(_In_z_ const wchar_t* name) const noexcept;
+        void _TraceOnExecute(const wchar_t wch) const noexcept;
+        void _TraceOnExecuteFromEscape(const wchar_t wch) const noexcept;
+        void _TraceOnEvent(_In_z_ const wchar_t* name) const noexcept;
+        void _TraceCharInput(const wchar_t wch);
+        void _DispatchSequenceTrace(const bool fSuccess) const noexcept;
+        void _DispatchPrintRunTrace(const std::wstring_view& string) const;
+
         std::wstring _sequenceTrace;
+        bool _enabled = false;
     };
 }
@@ -103,6 +103,52 @@ class Microsoft::Console::VirtualTerminal::Base64Test
         }
     }
 
+    TEST_METHOD(DecodeInChunks)
+    {
+        // Long enough for the vectorized path, with a multibyte
+        // character that gets split across two of the chunks.
+        std::wstring encoded;
+        std::wstring expected;
+        for (auto i = 0; i < 16; ++i)
+        {
+            // U+306b U+307b U+3093 U+3054 U+6c49 U+8bed U+d55c U+ad6d
+            encoded.append(L"44Gr44G744KT44GU5rGJ6K+t7ZWc6rWt");
+            expected.append(L"にほんご汉语한국");
+        }
+        encoded.append(L"YQ==");
+        expected.append(L"a");
+
+        for (const size_t chunkSize : { 1, 3, 5, 16, 17, 64 })
+        {
+            Base64::Decoder decoder;
+            for (size_t i = 0; i < encoded.size(); i += chunkSize)
+            {
+                decoder.Feed(std::wstring_view{ encoded }.substr(i, chunkSize));
+            }
+
+            std::wstring result;
+            VERIFY_SUCCEEDED(decoder.Finish(result));
+            VERIFY_ARE_EQUAL(expected, result);
+        }
+
+        // Invalid characters are reported once the string is finished, wherever they are.
+        std::wstring result;
+        Base64::Decoder decoder;
+        decoder.Feed(encoded);
+        decoder.Feed(L"Zm9v\r\nZm9v");
+        VERIFY_FAILED(decoder.Finish(result));
+
+        // Nothing but padding may follow a "=".
+        decoder.Feed(L"YQ==");
+        decoder.Feed(L"YQ==");
+        VERIFY_FAILED(decoder.Finish(result));
+
+        // Finish() resets the decoder.
+        decoder.Feed(L"Zm9v");
+        VERIFY_SUCCEEDED(decoder.Finish(result));
+        VERIFY_ARE_EQUAL(L"foo", result);
+    }
+
     TEST_METHOD(DecodeUTF8)
     {
         std::wstring result;
@@ -548,6 +548,52 @@ class Microsoft::Console::VirtualTerminal::OutputEngineTest final
         VERIFY_ARE_EQUAL(mach._state, StateMachine::VTStates::Ground);
     }
 
+    TEST_METHOD(TestOscStringLimit)
+    {
+        auto dispatch = std::make_unique<DummyDispatch>();
+        auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
+        StateMachine mach(std::move(engine));
+        mach.SetOscStringLimit(10);
+
+        Log::Comment(L"A string within the limit is collected, even if it arrives in pieces.");
+        mach.ProcessString(L"\x1b]0;some ");
+        mach.ProcessString(L"text");
+        VERIFY_ARE_EQUAL(mach._state, StateMachine::VTStates::OscString);
+        VERIFY_ARE_EQUAL(L"some text", mach._oscString);
+        mach.ProcessString(L"\x07");
+        VERIFY_ARE_EQUAL(mach._state, StateMachine::VTStates::Ground);
+
+        Log::Comment(L"A longer string is discarded and the rest of it is ignored.");
+        mach.ProcessString(L"\x1b]0;some more t");
+        VERIFY_IS_TRUE(mach._oscStringOverflow);
+        VERIFY_IS_TRUE(mach._oscString.empty());
+        mach.ProcessString(L"ext");
+        VERIFY_IS_TRUE(mach._oscString.empty());
+        mach.ProcessString(L"\x1b\\");
+        VERIFY_ARE_EQUAL(mach._state, StateMachine::VTStates::Ground);
+
+        Log::Comment(L"The next string starts from scratch.");
+        mach.ProcessString(L"\x1b]0;text");
+        VERIFY_IS_FALSE(mach._oscStringOverflow);
+        VERIFY_ARE_EQUAL(L"text", mach._oscString);
+        mach.ProcessString(L"\x07");
+        VERIFY_ARE_EQUAL(mach._state, StateMachine::VTStates::Ground);
+    }
+
+    TEST_METHOD(TestUnsupportedOscStringIsSkipped)
+    {
+        auto dispatch = std::make_unique<DummyDispatch>();
+        auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
+        StateMachine mach(std::move(engine));
+
+        // OSC 1234 doesn't exist, so there's no need to collect its string.
+        mach.ProcessString(L"\x1b]1234;a long string that we'll never look at");
+        VERIFY_ARE_EQUAL(mach._state, StateMachine::VTStates::OscString);
+        VERIFY_IS_TRUE(mach._oscString.empty());
+        mach.ProcessString(L"\x07");
+        VERIFY_ARE_EQUAL(mach._state, StateMachine::VTStates::Ground);
+    }
+
     TEST_METHOD(NormalTestOscParam)
     {
         auto dispatch = std::make_unique<DummyDispatch>();
@@ -3014,6 +3060,58 @@ class StateMachineExternalTest final
         pDispatch->ClearState();
     }
 
+    TEST_METHOD(TestSetClipboardInChunks)
+    {
+        auto dispatch = std::make_unique<StatefulDispatch>();
+        auto pDispatch = dispatch.get();
+        auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
+        StateMachine mach(std::move(engine));
+
+        // The payload is decoded as it arrives, so it may be split anywhere, even inside the `Pc` param or the ST.
+        mach.ProcessString(L"\x1b]52;s");
+        mach.ProcessString(L"0;Zm9");
+        mach.ProcessString(L"vDQpi");
+        mach.ProcessString(L"YXI=\x1b");
+        mach.ProcessString(L"\\");
+        VERIFY_ARE_EQUAL(L"foo\r\nbar", pDispatch->_copyContent);
+
+        pDispatch->ClearState();
+
+        // A large payload in uneven chunks.
+        std::wstring expected;
+        std::wstring encoded;
+        for (auto i = 0; i < 4096; ++i)
+        {
+            expected.append(L"abc");
+            encoded.append(L"YWJj");
+        }
+        mach.ProcessString(L"\x1b]52;;");
+        for (size_t i = 0; i < encoded.size(); i += 23)
+        {
+            mach.ProcessString(std::wstring_view{ encoded }.substr(i, 23));
+        }
+        mach.ProcessString(L"\x07");
+        VERIFY_ARE_EQUAL(expected, pDispatch->_copyContent);
+
+        pDispatch->ClearState();
+
+        pDispatch->_copyContent = L"UNCHANGED";
+        // A payload that gets cancelled with a CAN won't change the content.
+        mach.ProcessString(L"\x1b]52;;Zm9v");
+        mach.ProcessString(L"\x18");
+        VERIFY_ARE_EQUAL(L"UNCHANGED", pDispatch->_copyContent);
+
+        pDispatch->ClearState();
+
+        pDispatch->_copyContent = L"UNCHANGED";
+        // A payload that turns out to be invalid in a later chunk won't change the content.
+        mach.ProcessString(L"\x1b]52;;Zm9v");
+        mach.ProcessString(L"Zm9v!\x07");
+        VERIFY_ARE_EQUAL(L"UNCHANGED", pDispatch->_copyContent);
+
+        pDispatch->ClearState();
+    }
+
     TEST_METHOD(TestAddHyperlink)
     {
         auto dispatch = std::make_unique<StatefulDispatch>();
@@ -68,6 +68,8 @@ public:
 
     bool ActionIgnore() override { return true; };
 
+    IStateMachineEngine::OscStringHandler ActionOscStringStart(const size_t /* parameter */) override { return nullptr; };
+
     bool ActionOscDispatch(const wchar_t /* wch */,
                            const size_t /* parameter */,
                            const std::wstring_view /* string */) override
@@ -154,6 +156,10 @@ class Microsoft::Console::VirtualTerminal::StateMachineTest
     TEST_METHOD(PassThroughUnhandled);
     TEST_METHOD(RunStorageBeforeEscape);
     TEST_METHOD(BulkTextPrint);
+    TEST_METHOD(BulkTextPrintFindsEveryActionableCharacter);
+    TEST_METHOD(BulkTextPrintThroughput);
+    TEST_METHOD(SimpleCsiFastPathMatchesStateMachine);
+    TEST_METHOD(SgrDenseThroughput);
     TEST_METHOD(PassThroughUnhandledSplitAcrossWrites);
 
     TEST_METHOD(DcsDataStringsReceivedByHandler);
@@ -231,6 +237,200 @@ void StateMachineTest::BulkTextPrint()
     VERIFY_ARE_EQUAL(String(L"12345 Hello World"), String(engine.printed.c_str()));
 }
 
+void StateMachineTest::BulkTextPrintFindsEveryActionableCharacter()
+{
+    auto enginePtr{ std::make_unique<TestStateMachineEngine>() };
+    // this dance is required because StateMachine presumes to take ownership of its engine.
+    auto& engine{ *enginePtr.get() };
+    StateMachine machine{ std::move(enginePtr) };
+
+    // The ground state scanner processes the input in blocks of 8 or 16 characters.
+    // This test places an actionable character at every offset of strings of various lengths,
+    // to ensure that neither the vectorized loop nor the scalar tail loop ever misses one.
+    // The filler contains the printable neighbors of the actionable ranges (0x20, 0x7E and 0xA0).
+    static constexpr std::wstring_view filler{ L"ab ~\xa0_ghijklmnopqrstuvw~ \xa0 yz0123456789" };
+    // US and DEL are executed. C1 controls are ignored by default, but must still end the printable run.
+    static constexpr std::wstring_view actionable{ L"\x1f\x7f\x9f" };
+
+    for (size_t length = 1; length <= filler.size(); ++length)
+    {
+        for (size_t offset = 0; offset < length; ++offset)
+        {
+            for (const auto ch : actionable)
+            {
+                std::wstring input{ filler.substr(0, length) };
+                input[offset] = ch;
+
+                std::wstring expectedPrinted{ input };
+                expectedPrinted.erase(offset, 1);
+                const auto expectedExecuted = ch == L'\x9f' ? std::wstring{} : std::wstring{ ch };
+
+                engine.ResetTestState();
+                machine.ProcessString(input);
+
+                VERIFY_ARE_EQUAL(expectedPrinted, engine.printed);
+                VERIFY_ARE_EQUAL(expectedExecuted, engine.executed);
+            }
+        }
+    }
+}
+
+void StateMachineTest::BulkTextPrintThroughput()
+{
+    BEGIN_TEST_METHOD_PROPERTIES()
+        TEST_METHOD_PROPERTY(L"IsPerfTest", L"true")
+    END_TEST_METHOD_PROPERTIES()
+
+    auto enginePtr{ std::make_unique<TestStateMachineEngine>() };
+    // this dance is required because StateMachine presumes to take ownership of its engine.
+    auto& engine{ *enginePtr.get() };
+    StateMachine machine{ std::move(enginePtr) };
+
+    // ~8 MiB of 78 column wide lines, similar to what you'd get from a build log.
+    std::wstring line(78, L'x');
+    line.append(L"\r\n");
+    std::wstring input;
+    input.reserve(4 * 1024 * 1024);
+    while (input.size() < 4 * 1024 * 1024)
+    {
+        input.append(line);
+    }
+
+    static constexpr auto iterations = 8;
+    const auto start = std::chrono::steady_clock::now();
+
+    for (auto i = 0; i < iterations; ++i)
+    {
+        engine.ResetTestState();
+        machine.ProcessString(input);
+    }
+
+    const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const auto megabytes = static_cast<double>(input.size() * sizeof(wchar_t) * iterations) / (1024.0 * 1024.0);
+    Log::Comment(NoThrowString().Format(L"Processed %.1f MiB in %.3f s (%.1f MiB/s)", megabytes, elapsed, megabytes / elapsed));
+
+    VERIFY_ARE_EQUAL(input.size() / line.size() * 2, engine.executed.size());
+}
+
+void StateMachineTest::SimpleCsiFastPathMatchesStateMachine()
+{
+    auto fastEnginePtr{ std::make_unique<TestStateMachineEngine>() };
+    // this dance is required because StateMachine presumes to take ownership of its engine.
+    auto& fastEngine{ *fastEnginePtr.get() };
+    StateMachine fastMachine{ std::move(fastEnginePtr) };
+
+    auto slowEnginePtr{ std::make_unique<TestStateMachineEngine>() };
+    auto& slowEngine{ *slowEnginePtr.get() };
+    StateMachine slowMachine{ std::move(slowEnginePtr) };
+
+    // ProcessString() dispatches SGR, CUP, ED and EL without going through the individual
+    // state transitions. Feeding the same input through ProcessCharacter() never takes
+    // that shortcut, so both need to produce identical dispatches.
+    const std::wstring_view inputs[] = {
+        L"\x1b[m",
+        L"\x1b[0m",
+        L"\x1b[1;31m",
+        L"\x1b[;m",
+        L"\x1b[;;5m",
+        L"\x1b[38;2;255;128;0m",
+        L"\x1b[99999999m",
+        L"\x1b[1;2;3;4;5;6;7;8;9;10;11;12;13;14;15;16;17;18;19;20;21;22;23;24;25;26;27;28;29;30;31;32;33;34m",
+        L"\x1b[12;34H",
+        L"\x1b[H",
+        L"\x1b[2J",
+        L"\x1b[K",
+        L"\x1b[?25h",
+        L"\x1b[?1J",
+        L"\x1b[1 q",
+        L"\x1b[1;\x07" L"2m",
+        L"\x1b[1:2m",
+        L"\x1b[3;4r",
+        L"\x1b[1m\x1b[2J\x1b[3;4H\x1b[K\x1b[m",
+    };
+
+    for (const auto input : inputs)
+    {
+        Log::Comment(NoThrowString().Format(L"Input: \"%s\"", std::wstring{ input.substr(1) }.c_str()));
+
+        fastEngine.ResetTestState();
+        slowEngine.ResetTestState();
+
+        fastMachine.ProcessString(input);
+        for (const auto wch : input)
+        {
+            slowMachine.ProcessCharacter(wch);
+        }
+
+        VERIFY_ARE_EQUAL(slowEngine.csiId, fastEngine.csiId);
+        VERIFY_ARE_EQUAL(slowEngine.csiParams, fastEngine.csiParams);
+        VERIFY_ARE_EQUAL(slowEngine.executed, fastEngine.executed);
+    }
+
+    Log::Comment(L"Sequences split across writes still work");
+    fastEngine.ResetTestState();
+    fastMachine.ProcessString(L"text\x1b[1;3");
+    fastMachine.ProcessString(L"1mtext");
+    VERIFY_ARE_EQUAL(VTID("m"), fastEngine.csiId);
+    VERIFY_ARE_EQUAL(std::vector<size_t>({ 1, 31 }), fastEngine.csiParams);
+    VERIFY_ARE_EQUAL(L"texttext", fastEngine.printed);
+
+    Log::Comment(L"Text around sequences is printed in runs");
+    fastEngine.ResetTestState();
+    fastMachine.ProcessString(L"ab\x1b[31mcd\x1b[mef");
+    VERIFY_ARE_EQUAL(std::vector<size_t>({ 31, 0 }), fastEngine.csiParams);
+    VERIFY_ARE_EQUAL(L"abcdef", fastEngine.printed);
+}
+
+void StateMachineTest::SgrDenseThroughput()
+{
+    BEGIN_TEST_METHOD_PROPERTIES()
+        TEST_METHOD_PROPERTY(L"IsPerfTest", L"true")
+    END_TEST_METHOD_PROPERTIES()
+
+    auto enginePtr{ std::make_unique<TestStateMachineEngine>() };
+    // this dance is required because StateMachine presumes to take ownership of its engine.
+    auto& engine{ *enginePtr.get() };
+    StateMachine machine{ std::move(enginePtr) };
+
+    // Something that resembles colored compiler diagnostics or "ls --color":
+    // short runs of text separated by SGR sequences and the occasional cursor movement.
+    std::wstring input;
+    input.reserve(2 * 1024 * 1024);
+    for (auto i = 0; input.size() < 2 * 1024 * 1024; ++i)
+    {
+        fmt::format_to(std::back_inserter(input), FMT_COMPILE(L"\x1b[{};{}mfoo.cpp\x1b[m:{}:\x1b[38;5;{}mwarning\x1b[K\r\n"), i % 2, 30 + i % 8, i, i % 256);
+        if (i % 64 == 0)
+        {
+            input.append(L"\x1b[2J\x1b[1;1H");
+        }
+    }
+
+    const auto measure = [&](auto&& func) {
+        static constexpr auto iterations = 8;
+        const auto start = std::chrono::steady_clock::now();
+        for (auto i = 0; i < iterations; ++i)
+        {
+            engine.ResetTestState();
+            func();
+        }
+        const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return static_cast<double>(input.size() * sizeof(wchar_t) * iterations) / (1024.0 * 1024.0) / elapsed;
+    };
+
+    const auto fast = measure([&]() {
+        machine.ProcessString(input);
+    });
+    const auto slow = measure([&]() {
+        for (const auto wch : input)
+        {
+            machine.ProcessCharacter(wch);
+        }
+    });
+
+    Log::Comment(NoThrowString().Format(L"ProcessString: %.1f MiB/s", fast));
+    Log::Comment(NoThrowString().Format(L"ProcessCharacter: %.1f MiB/s", slow));
+}
+
 void StateMachineTest::PassThroughUnhandledSplitAcrossWrites()
 {
     auto enginePtr{ std::make_unique<TestStateMachineEngine>() };
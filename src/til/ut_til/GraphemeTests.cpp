@@ -0,0 +1,164 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include "WexTestClass.h"
+
+#include <til/grapheme.h>
+
+using namespace WEX::Common;
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+
+using cluster_break = til::grapheme::cluster_break;
+
+class GraphemeTests
+{
+    TEST_CLASS(GraphemeTests);
+
+    TEST_METHOD(Property)
+    {
+        VERIFY_ARE_EQUAL(cluster_break::other, til::grapheme::property(U'a'));
+        VERIFY_ARE_EQUAL(cluster_break::cr, til::grapheme::property(U'\r'));
+        VERIFY_ARE_EQUAL(cluster_break::lf, til::grapheme::property(U'\n'));
+        VERIFY_ARE_EQUAL(cluster_break::control, til::grapheme::property(U'\x1b'));
+        VERIFY_ARE_EQUAL(cluster_break::extend, til::grapheme::property(0x0301)); // COMBINING ACUTE ACCENT
+        VERIFY_ARE_EQUAL(cluster_break::extend, til::grapheme::property(0xFE0F)); // VARIATION SELECTOR-16
+        VERIFY_ARE_EQUAL(cluster_break::extend, til::grapheme::property(0x1F3FD)); // EMOJI MODIFIER FITZPATRICK TYPE-4
+        VERIFY_ARE_EQUAL(cluster_break::zwj, til::grapheme::property(0x200D));
+        VERIFY_ARE_EQUAL(cluster_break::regional_indicator, til::grapheme::property(0x1F1FA));
+        VERIFY_ARE_EQUAL(cluster_break::prepend, til::grapheme::property(0x0600)); // ARABIC NUMBER SIGN
+        VERIFY_ARE_EQUAL(cluster_break::spacing_mark, til::grapheme::property(0x093F)); // DEVANAGARI VOWEL SIGN I
+        VERIFY_ARE_EQUAL(cluster_break::l, til::grapheme::property(0x1100));
+        VERIFY_ARE_EQUAL(cluster_break::v, til::grapheme::property(0x1161));
+        VERIFY_ARE_EQUAL(cluster_break::t, til::grapheme::property(0x11A8));
+        VERIFY_ARE_EQUAL(cluster_break::lv, til::grapheme::property(0xAC00));
+        VERIFY_ARE_EQUAL(cluster_break::lvt, til::grapheme::property(0xAC01));
+        VERIFY_ARE_EQUAL(cluster_break::extended_pictographic, til::grapheme::property(0x1F469)); // WOMAN
+        VERIFY_ARE_EQUAL(cluster_break::other, til::grapheme::property(0x10FFFF));
+        VERIFY_ARE_EQUAL(cluster_break::other, til::grapheme::property(0x110000));
+    }
+
+    TEST_METHOD(Segmentation)
+    {
+        struct Test
+        {
+            std::wstring_view input;
+            til::some<size_t, 6> expected;
+        };
+
+        static constexpr std::array tests{
+            Test{ L"", {} },
+            Test{ L"abc", { 1, 2, 3 } },
+            Test{ L"\r\n\n\r", { 2, 3, 4 } },
+            // a + COMBINING ACUTE ACCENT
+            Test{ L"a\u0301b", { 2, 3 } },
+            // Family: WOMAN ZWJ WOMAN ZWJ GIRL
+            Test{ L"\U0001F469\u200D\U0001F469\u200D\U0001F467x", { 8, 9 } },
+            // A ZWJ only joins pictographs with each other.
+            Test{ L"a\u200D\U0001F469", { 2, 4 } },
+            // THUMBS UP SIGN + skin tone modifier
+            Test{ L"\U0001F44D\U0001F3FD.", { 4, 5 } },
+            // HEAVY BLACK HEART + VS16
+            Test{ L"\u2764\uFE0F!", { 2, 3 } },
+            // Flags: US, DE and a lone regional indicator
+            Test{ L"\U0001F1FA\U0001F1F8\U0001F1E9\U0001F1EA\U0001F1EB", { 4, 8, 10 } },
+            // Hangul: conjoining jamo L V T, followed by a precomposed LV and a V
+            Test{ L"\u1100\u1161\u11A8\uAC00\u1161a", { 3, 5, 6 } },
+            // Devanagari "kshi": KA VIRAMA | SSA VOWEL SIGN I
+            Test{ L"\u0915\u094D\u0937\u093F", { 2, 4 } },
+            // ARABIC NUMBER SIGN prepends to the following character, even if it's ASCII.
+            Test{ L"\u0600 1", { 2, 3 } },
+            // Unpaired surrogates are clusters of their own.
+            Test{ L"\xD801" L"a\xDC01", { 1, 2, 3 } },
+        };
+
+        for (const auto& t : tests)
+        {
+            std::vector<size_t> actual;
+            til::grapheme::cluster_ends(t.input, actual);
+            VERIFY_ARE_EQUAL(t.expected.size(), actual.size());
+            VERIFY_IS_TRUE(std::equal(t.expected.begin(), t.expected.end(), actual.begin(), actual.end()));
+
+            // The single-cluster API must agree with the batch API.
+            auto it = t.expected.begin();
+            size_t offset = 0;
+            while (offset < t.input.size())
+            {
+                offset += til::grapheme::next_cluster_length(t.input.substr(offset));
+                VERIFY_ARE_EQUAL(*it, offset);
+                ++it;
+            }
+            VERIFY_ARE_EQUAL(t.expected.end(), it);
+        }
+    }
+
+    // Compares the cost of segmenting text into grapheme clusters with splitting it into code points.
+    // The batch API shouldn't cost noticeably more than that for ASCII, which is the common case.
+    TEST_METHOD(Throughput)
+    {
+        BEGIN_TEST_METHOD_PROPERTIES()
+            TEST_METHOD_PROPERTY(L"IsPerfTest", L"true")
+        END_TEST_METHOD_PROPERTIES()
+
+        struct Corpus
+        {
+            const wchar_t* name;
+            std::wstring_view pattern;
+        };
+
+        static constexpr std::array corpora{
+            Corpus{ L"ASCII", L"The quick brown fox jumps over the lazy dog 0123456789\r\n" },
+            Corpus{ L"Emoji", L"\U0001F469\u200D\U0001F469\u200D\U0001F467 \U0001F44D\U0001F3FD\U0001F1FA\U0001F1F8\u2764\uFE0F " },
+            Corpus{ L"Indic", L"\u0928\u092E\u0938\u094D\u0924\u0947 \u0915\u094D\u0937\u093F " },
+        };
+
+        static constexpr size_t textSize = 1024 * 1024;
+        static constexpr int iterations = 20;
+
+        const auto measure = [](auto&& func) {
+            const auto beg = std::chrono::steady_clock::now();
+            for (auto i = 0; i < iterations; ++i)
+            {
+                func();
+            }
+            return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - beg).count() / iterations / textSize;
+        };
+
+        for (const auto& corpus : corpora)
+        {
+            std::wstring text;
+            text.reserve(textSize + corpus.pattern.size());
+            while (text.size() < textSize)
+            {
+                text.append(corpus.pattern);
+            }
+            text.resize(textSize);
+
+            std::vector<size_t> ends;
+            ends.reserve(textSize);
+            size_t sink = 0;
+
+            const auto codepoints = measure([&]() {
+                for (std::wstring_view rest{ text }; !rest.empty(); rest = til::utf16_pop(rest))
+                {
+                    sink++;
+                }
+            });
+            const auto batch = measure([&]() {
+                ends.clear();
+                til::grapheme::cluster_ends(text, ends);
+                sink += ends.size();
+            });
+            const auto single = measure([&]() {
+                for (std::wstring_view rest{ text }; !rest.empty(); rest = til::grapheme::cluster_pop(rest))
+                {
+                    sink++;
+                }
+            });
+
+            VERIFY_ARE_NOT_EQUAL(0u, sink);
+            Log::Comment(NoThrowString().Format(L"%s: utf16_pop %.2f ns/unit, cluster_ends %.2f ns/unit, cluster_pop %.2f ns/unit", corpus.name, codepoints, batch, single));
+        }
+    }
+};
@@ -601,4 +601,87 @@ class RunLengthEncodingTests
             VERIFY_ARE_EQUAL(-static_cast<difference_type>(1), lower - upper);
         }
     }
+
+    TEST_METHOD(IndexedLookup)
+    {
+        // With this many runs the positional lookups use the index of the cumulative run lengths.
+        // Compare all operations against a plain decoded copy while the index is in use.
+        static constexpr size_type width = 64;
+        rle_vector rle(width, 0);
+        basic_container expected(width, 0);
+
+        const auto verify = [&]() {
+            for (size_type i = 0; i < width; ++i)
+            {
+                VERIFY_ARE_EQUAL(expected[i], rle.at(i));
+            }
+            VERIFY_IS_TRUE(expected == rle_decode(rle.runs()));
+        };
+
+        // One run per cell.
+        for (size_type i = 0; i < width; ++i)
+        {
+            rle.replace(i, i + 1, static_cast<value_type>(i % 7 + 1));
+            expected[i] = static_cast<value_type>(i % 7 + 1);
+        }
+        verify();
+        VERIFY_ARE_EQUAL(size_t{ width }, rle.runs().size());
+
+        // Replacements within a run, across runs and merging with their neighbors.
+        const std::tuple<size_type, size_type, value_type> replacements[]{
+            { 10, 11, 9 },
+            { 20, 30, 2 },
+            { 5, 40, 8 },
+            { 40, 41, 8 },
+            { 0, 3, 4 },
+            { 60, 64, 1 },
+        };
+        for (const auto& [begin, end, value] : replacements)
+        {
+            rle.replace(begin, end, value);
+            std::fill(expected.begin() + begin, expected.begin() + end, value);
+            verify();
+        }
+
+        const auto slice = rle.slice(7, 50);
+        VERIFY_IS_TRUE(expected.substr(7, 43) == rle_decode(slice.runs()));
+
+        rle.resize_trailing_extent(50);
+        expected.resize(50);
+        VERIFY_IS_TRUE(expected == rle_decode(rle.runs()));
+        for (size_type i = 0; i < 50; ++i)
+        {
+            VERIFY_ARE_EQUAL(expected[i], rle.at(i));
+        }
+        VERIFY_THROWS(rle.at(50), std::out_of_range);
+    }
+
+    TEST_METHOD(RainbowThroughput)
+    {
+        // A rainbow colored row (lolcat, etc.) has one run per cell. This measures
+        // the cost of coloring and then reading back such a row cell by cell.
+        static constexpr size_type width = 240;
+        static constexpr auto iterations = 10000;
+
+        rle_vector rle(width, 0);
+        size_t sum = 0;
+
+        const auto start = std::chrono::steady_clock::now();
+        for (auto n = 0; n < iterations; ++n)
+        {
+            for (size_type i = 0; i < width; ++i)
+            {
+                rle.replace(i, i + 1, static_cast<value_type>((i + n) % 7 + 1));
+            }
+            for (size_type i = 0; i < width; ++i)
+            {
+                sum += rle.at(i);
+            }
+        }
+        const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        Log::Comment(NoThrowString().Format(L"%d rows in %.3fs (%.1f ns per cell)", iterations, elapsed, elapsed * 1e9 / iterations / width));
+
+        VERIFY_ARE_EQUAL(size_t{ width }, rle.runs().size());
+        VERIFY_ARE_NOT_EQUAL(size_t{ 0 }, sum);
+    }
 };
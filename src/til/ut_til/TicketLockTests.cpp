@@ -0,0 +1,55 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include "til/ticket_lock.h"
+
+using namespace WEX::Common;
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+
+class TicketLockTests
+{
+    BEGIN_TEST_CLASS(TicketLockTests)
+        TEST_CLASS_PROPERTY(L"TestTimeout", L"0:0:10") // 10s timeout
+    END_TEST_CLASS()
+
+    TEST_METHOD(TryLock)
+    {
+        til::ticket_lock lock;
+
+        VERIFY_IS_TRUE(lock.try_lock());
+        VERIFY_IS_FALSE(lock.try_lock());
+        lock.unlock();
+
+        // try_lock() must not have taken a ticket when it failed,
+        // or else this would deadlock.
+        lock.lock();
+        lock.unlock();
+        VERIFY_IS_TRUE(lock.try_lock());
+        lock.unlock();
+    }
+
+    TEST_METHOD(RecursiveTryLock)
+    {
+        til::recursive_ticket_lock lock;
+
+        VERIFY_IS_TRUE(lock.try_lock());
+        VERIFY_IS_TRUE(lock.try_lock());
+        VERIFY_ARE_EQUAL(2u, lock.recursion_depth());
+
+        std::thread{ [&]() {
+            VERIFY_IS_FALSE(lock.try_lock());
+        } }.join();
+
+        lock.unlock();
+        lock.unlock();
+        VERIFY_ARE_EQUAL(0u, lock.recursion_depth());
+
+        std::thread{ [&]() {
+            VERIFY_IS_TRUE(lock.try_lock());
+            lock.unlock();
+        } }.join();
+    }
+};
@@ -39,4 +39,23 @@ class ThrottledFuncTests
 
         latch.wait();
     }
+
+    TEST_METHOD(CoalescingWindow)
+    {
+        using namespace std::chrono_literals;
+        using filetime_duration = til::throttled_func_trailing<>::filetime_duration;
+
+        const auto window = [](auto d) {
+            return til::details::throttled_func_window(std::chrono::duration_cast<filetime_duration>(d).count());
+        };
+
+        // Short delays must not be stretched noticeably.
+        VERIFY_ARE_EQUAL(0u, window(1ms));
+        VERIFY_ARE_EQUAL(0u, window(3ms));
+        VERIFY_ARE_EQUAL(2u, window(8ms));
+        VERIFY_ARE_EQUAL(12u, window(50ms));
+        // Long delays are capped at one frame.
+        VERIFY_ARE_EQUAL(16u, window(100ms));
+        VERIFY_ARE_EQUAL(16u, window(1s));
+    }
 };
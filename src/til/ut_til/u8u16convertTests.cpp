@@ -17,6 +17,9 @@ class Utf8Utf16ConvertTests
     TEST_METHOD(TestU8ToU16Partials);
     TEST_METHOD(TestU16ToU8Partials);
     TEST_METHOD(TestU8ToU16OneByOne);
+    TEST_METHOD(TestU8ToU16IllFormed);
+    TEST_METHOD(TestU16ToU8IllFormed);
+    TEST_METHOD(TestMixedRuns);
 };
 
 void Utf8Utf16ConvertTests::TestU8ToU16()
@@ -191,3 +194,62 @@ void Utf8Utf16ConvertTests::TestU8ToU16OneByOne()
     VERIFY_SUCCEEDED(til::u8u16(u8String1_4, u16Out1, state));
     VERIFY_ARE_EQUAL(u16StringComp1, u16Out1);
 }
+
+void Utf8Utf16ConvertTests::TestU8ToU16IllFormed()
+{
+    // Each maximal subpart of an ill-formed sequence is replaced with a single U+FFFD.
+    // These are the examples from table 3-8 in chapter 3.9 of the Unicode standard.
+    const std::string u8String{ "a\x80\xBF\xC0\xAF\xE0\x80\xBF\xF4\x90\x80\x80\xED\xA0\x80\xF0\x9F\x93z\xE2" };
+    const std::wstring u16StringComp{ L"a\xFFFD\xFFFD\xFFFD\xFFFD\xFFFD\xFFFD\xFFFD\xFFFD\xFFFD\xFFFD\xFFFD\xFFFD\xFFFD\xFFFD\xFFFDz\xFFFD" };
+
+    std::wstring u16Out{};
+    VERIFY_SUCCEEDED(til::u8u16(u8String, u16Out));
+    VERIFY_ARE_EQUAL(u16StringComp, u16Out);
+}
+
+void Utf8Utf16ConvertTests::TestU16ToU8IllFormed()
+{
+    // Unpaired surrogates are replaced with U+FFFD.
+    const std::wstring u16String{ L"a\xDF5C\xD853z\xD853" };
+    const std::string u8StringComp{ "a\xEF\xBF\xBD\xEF\xBF\xBDz\xEF\xBF\xBD" };
+
+    std::string u8Out{};
+    VERIFY_SUCCEEDED(til::u16u8(u16String, u8Out));
+    VERIFY_ARE_EQUAL(u8StringComp, u8Out);
+}
+
+void Utf8Utf16ConvertTests::TestMixedRuns()
+{
+    // The transcoders process runs of ASCII in blocks of 8 or 16 characters.
+    // Non-ASCII characters at varying offsets test the transitions in and out of those runs.
+    std::string u8String;
+    std::wstring u16String;
+    for (auto i = 0; i < 100; ++i)
+    {
+        u8String.append(i % 37, 'x');
+        u16String.append(i % 37, L'x');
+        switch (i % 3)
+        {
+        case 0:
+            u8String.append("\xC3\xB6");
+            u16String.push_back(L'\x00F6');
+            break;
+        case 1:
+            u8String.append("\xE2\x82\xAC");
+            u16String.push_back(L'\x20AC');
+            break;
+        default:
+            u8String.append("\xF0\xA4\xBD\x9C");
+            u16String.append(L"\xD853\xDF5C");
+            break;
+        }
+    }
+
+    std::wstring u16Out{};
+    VERIFY_SUCCEEDED(til::u8u16(u8String, u16Out));
+    VERIFY_ARE_EQUAL(u16String, u16Out);
+
+    std::string u8Out{};
+    VERIFY_SUCCEEDED(til::u16u8(u16String, u8Out));
+    VERIFY_ARE_EQUAL(u8String, u8Out);
+}
@@ -3,6 +3,8 @@
 // NOTE The functions u8u16 and u16u8 contain own algorithms. Tests have shown that they perform
 // worse than the platform API functions.
 // Thus, these functions are *unrelated* to the til::u8u16 and til::u16u8 implementation.
+// The natural language tests additionally measure the throughput of til::u8u16 and til::u16u8
+// (which use their own vectorized transcoders) in comparison to the platform API functions.
 
 #include <iostream>
 #include <memory>
@@ -13,6 +15,8 @@
 
 #include "U8U16Test.hpp"
 
+#include <LibraryIncludes.h>
+
 typedef NTSTATUS(WINAPI* t_RtlUTF8ToUnicodeN)(PWSTR, ULONG, PULONG, PCCH, ULONG);
 typedef NTSTATUS(WINAPI* t_RtlUnicodeToUTF8N)(PCHAR, ULONG, PULONG, PCWSTR, ULONG);
 NTSTATUS(WINAPI* p_RtlUTF8ToUnicodeN)
@@ -34,6 +38,7 @@ NTSTATUS(WINAPI* p_RtlUnicodeToUTF8N)
 double GetDuration();
 ptrdiff_t RandomIndex(ptrdiff_t length);
 void PrintHeader(const char* const funcName);
+void PrintThroughput(const char* const funcName, size_t length, size_t bytes, double duration);
 
 // test functions
 void WideCharToMultiByte_WholeString(std::wstring_view testU16)
@@ -346,26 +351,46 @@ void CompNaturalLang_WholeString(const std::string& fileName)
     int length = MultiByteToWideChar(65001, 0, u8Str.data(), static_cast<int>(u8Str.length()), u16Buffer.get(), static_cast<int>(u8Str.length()));
     double duration = GetDuration();
     u16Buffer.reset();
-    std::cout << " MultiByteToWideChar length " << length << " elapsed " << duration << std::endl;
+    PrintThroughput("MultiByteToWideChar", length, u8Str.length(), duration);
 
     GetDuration();
     std::wstring u16Str{};
     HRESULT hRes = u8u16_ptr(u8Str, u16Str);
     duration = GetDuration();
-    std::cout << " u8u16_ptr           length " << u16Str.length() << " elapsed " << duration << std::endl;
+    PrintThroughput("u8u16_ptr", u16Str.length(), u8Str.length(), duration);
+
+    GetDuration();
+    std::wstring u16StrTil{};
+    hRes = til::u8u16(u8Str, u16StrTil);
+    duration = GetDuration();
+    PrintThroughput("til::u8u16", u16StrTil.length(), u8Str.length(), duration);
+    if (u16StrTil != u16Str)
+    {
+        std::cerr << " til::u8u16 result differs!" << std::endl;
+    }
 
     GetDuration();
     std::unique_ptr<char[]> u8Buffer{ std::make_unique<char[]>(u16Str.length() * 3) };
     length = WideCharToMultiByte(65001, 0, u16Str.data(), static_cast<int>(u16Str.length()), u8Buffer.get(), static_cast<int>(u16Str.length()) * 3, nullptr, nullptr);
     duration = GetDuration();
     u8Buffer.reset();
-    std::cout << " WideCharToMultiByte length " << length << " elapsed " << duration << std::endl;
+    PrintThroughput("WideCharToMultiByte", length, u16Str.length() * sizeof(wchar_t), duration);
 
     GetDuration();
     std::string u8StrOut{};
     hRes = u16u8_ptr(u16Str, u8StrOut);
     duration = GetDuration();
-    std::cout << " u16u8_ptr           length " << u8StrOut.length() << " elapsed " << duration << std::endl;
+    PrintThroughput("u16u8_ptr", u8StrOut.length(), u16Str.length() * sizeof(wchar_t), duration);
+
+    GetDuration();
+    std::string u8StrTil{};
+    hRes = til::u16u8(u16Str, u8StrTil);
+    duration = GetDuration();
+    PrintThroughput("til::u16u8", u8StrTil.length(), u16Str.length() * sizeof(wchar_t), duration);
+    if (u8StrTil != u8Str)
+    {
+        std::cerr << " til::u16u8 result differs!" << std::endl;
+    }
 }
 
 void CompNaturalLang_Chunks(const std::string& fileName)
@@ -391,10 +416,16 @@ void CompNaturalLang_Chunks(const std::string& fileName)
     int lenTotalWC2MB{};
     size_t lenTotalU8U16{};
     size_t lenTotalU16U8{};
+    size_t lenTotalTilU8U16{};
+    size_t lenTotalTilU16U8{};
     double durTotalMB2WC{};
     double durTotalWC2MB{};
     double durTotalU8U16{};
     double durTotalU16U8{};
+    double durTotalTilU8U16{};
+    double durTotalTilU16U8{};
+    til::u8state tilU8State{};
+    til::u16state tilU16State{};
 
     GetDuration();
     std::unique_ptr<wchar_t[]> u16Buffer{ std::make_unique<wchar_t[]>(chunkSize) };
@@ -426,6 +457,11 @@ void CompNaturalLang_Chunks(const std::string& fileName)
         durTotalU8U16 += GetDuration();
         lenTotalU8U16 += u16StrOut.length();
 
+        GetDuration();
+        hRes = til::u8u16(u8Chunk, u16StrOut, tilU8State);
+        durTotalTilU8U16 += GetDuration();
+        lenTotalTilU8U16 += u16StrOut.length();
+
         GetDuration();
         lenTotalWC2MB += WideCharToMultiByte(65001, 0, u16Chunk.data(), static_cast<int>(u16Chunk.length()), u8Buffer.get(), static_cast<int>(u16Chunk.length()) * 3, nullptr, nullptr);
         durTotalWC2MB += GetDuration();
@@ -434,12 +470,21 @@ void CompNaturalLang_Chunks(const std::string& fileName)
         hRes = u16u8_ptr(u16Chunk, u8StrOut);
         durTotalU16U8 += GetDuration();
         lenTotalU16U8 += u8StrOut.length();
+
+        GetDuration();
+        hRes = til::u16u8(u16Chunk, u8StrOut, tilU16State);
+        durTotalTilU16U8 += GetDuration();
+        lenTotalTilU16U8 += u8StrOut.length();
     }
 
-    std::cout << " MultiByteToWideChar length " << lenTotalMB2WC << " elapsed " << durTotalMB2WC << std::endl;
-    std::cout << " u8u16_ptr           length " << lenTotalU8U16 << " elapsed " << durTotalU8U16 << std::endl;
-    std::cout << " WideCharToMultiByte length " << lenTotalWC2MB << " elapsed " << durTotalWC2MB << std::endl;
-    std::cout << " u16u8_ptr           length " << lenTotalU16U8 << " elapsed " << durTotalU16U8 << std::endl;
+    const auto u8Bytes = u8Str.length();
+    const auto u16Bytes = u16Str.length() * sizeof(wchar_t);
+    PrintThroughput("MultiByteToWideChar", lenTotalMB2WC, u8Bytes, durTotalMB2WC);
+    PrintThroughput("u8u16_ptr", lenTotalU8U16, u8Bytes, durTotalU8U16);
+    PrintThroughput("til::u8u16", lenTotalTilU8U16, u8Bytes, durTotalTilU8U16);
+    PrintThroughput("WideCharToMultiByte", lenTotalWC2MB, u16Bytes, durTotalWC2MB);
+    PrintThroughput("u16u8_ptr", lenTotalU16U8, u16Bytes, durTotalU16U8);
+    PrintThroughput("til::u16u8", lenTotalTilU16U8, u16Bytes, durTotalTilU16U8);
 }
 
 int main()
@@ -556,3 +601,11 @@ void PrintHeader(const char* const funcName)
 {
     std::cout << "\n~~~\ntest \"" << funcName << "\"" << std::endl;
 }
+
+// print the length and elapsed time of a conversion of the given number of input bytes, as well as its throughput in MB/s
+void PrintThroughput(const char* const funcName, size_t length, size_t bytes, double duration)
+{
+    std::cout << ' ' << std::left << std::setw(20) << funcName
+              << "length " << length << " elapsed " << duration
+              << " (" << (duration > 0 ? bytes / duration / 1e6 : 0.0) << " MB/s)" << std::endl;
+}
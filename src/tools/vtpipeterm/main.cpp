@@ -7,10 +7,15 @@
 #include <wil/resource.h>
 #include <wil/wistd_functional.h>
 #include <wil/wistd_memory.h>
+#include <winmeta.h>
+#include <TraceLoggingProvider.h>
 #include <cstdlib> /* srand, rand */
 #include <ctime> /* time */
 
+#include <algorithm>
+#include <atomic>
 #include <deque>
+#include <mutex>
 #include <memory>
 #include <vector>
 #include <string>
@@ -19,6 +24,11 @@
 
 #include "VtConsole.hpp"
 
+TRACELOGGING_DEFINE_PROVIDER(g_hVtPipeTermProvider,
+                             "Microsoft.Windows.Console.Tools.VtPipeTerm",
+                             // tl:{a08196fa-390a-553c-0297-c1f895fdde7d}
+                             (0xa08196fa, 0x390a, 0x553c, 0x02, 0x97, 0xc1, 0xf8, 0x95, 0xfd, 0xde, 0x7d));
+
 using namespace std;
 ////////////////////////////////////////////////////////////////////////////////
 // "Do Unicode" strings - C-b, u, then one of these characters to emit a string
@@ -51,6 +61,14 @@ bool g_useConpty = false;
 bool g_useOutfile = false;
 std::wstring outfile = L"vtpt.out";
 HANDLE hOutFile = INVALID_HANDLE_VALUE;
+
+// --latency: Measures the time from writing input into the console until its echo is read back.
+// C-b, l prints the percentiles of all measurements so far.
+bool g_measureLatency = false;
+// The QPC timestamp of the oldest input that hasn't been echoed yet, or 0 if there's none.
+std::atomic<int64_t> g_pendingInputTime{ 0 };
+std::mutex g_latencyLock;
+std::vector<int64_t> g_latencySamples;
 ////////////////////////////////////////////////////////////////////////////////
 // Forward decls
 std::string toPrintableString(std::string& inString);
@@ -60,10 +78,33 @@ void PrintInputToDebug(std::string& rawInput);
 void PrintOutputToDebug(std::string& rawOutput);
 ////////////////////////////////////////////////////////////////////////////////
 
+int64_t queryPerformanceCounter()
+{
+    LARGE_INTEGER li;
+    QueryPerformanceCounter(&li);
+    return li.QuadPart;
+}
+
 void ReadCallback(BYTE* buffer, DWORD dwRead)
 {
+    // When we're running inside a terminal, this is the first stage of its output latency.
+    // The terminal's own stages are traced by its providers. See src/Terminal.wprp.
+    TraceLoggingWrite(g_hVtPipeTermProvider,
+                      "ClientWrite",
+                      TraceLoggingDescription("Output is about to be written to the console"),
+                      TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+                      TraceLoggingUInt32(dwRead, "Bytes"));
+
     // We already set the console to UTF-8 CP, so we can just write straight to it
     bool fSuccess = !!WriteFile(hOut, buffer, dwRead, nullptr, nullptr);
+    if (fSuccess && g_measureLatency)
+    {
+        if (const auto start = g_pendingInputTime.exchange(0))
+        {
+            std::lock_guard guard{ g_latencyLock };
+            g_latencySamples.emplace_back(queryPerformanceCounter() - start);
+        }
+    }
     if (fSuccess && g_useOutfile)
     {
         fSuccess = !!WriteFile(hOutFile, buffer, dwRead, nullptr, nullptr);
@@ -85,6 +126,36 @@ void DebugReadCallback(BYTE* /*buffer*/, DWORD /*dwRead*/)
     // do nothing.
 }
 
+void printLatency()
+{
+    std::vector<int64_t> samples;
+    {
+        std::lock_guard guard{ g_latencyLock };
+        samples = g_latencySamples;
+    }
+
+    char text[256];
+    if (samples.empty())
+    {
+        sprintf_s(text, "\r\nNo latency measurements yet. Use --latency and type something.\r\n");
+    }
+    else
+    {
+        std::sort(samples.begin(), samples.end());
+
+        LARGE_INTEGER frequency;
+        QueryPerformanceFrequency(&frequency);
+        const auto percentile = [&](double p) {
+            const auto i = std::min(samples.size() - 1, static_cast<size_t>(p * samples.size()));
+            return samples[i] * 1000.0 / frequency.QuadPart;
+        };
+
+        sprintf_s(text, "\r\nInput to echo latency over %zu samples: p50 %.2fms, p90 %.2fms, p99 %.2fms, max %.2fms\r\n", samples.size(), percentile(0.5), percentile(0.9), percentile(0.99), percentile(1.0));
+    }
+
+    WriteFile(hOut, text, static_cast<DWORD>(strlen(text)), nullptr, nullptr);
+}
+
 VtConsole* getConsole()
 {
     return consoles[0];
@@ -357,6 +428,9 @@ void handleManyEvents(const INPUT_RECORD* const inputBuffer, int cEvents)
                     case 'r':
                         signalConsole();
                         break;
+                    case 'l':
+                        printLatency();
+                        break;
                     default:
                         *nextBuffer = c;
                         nextBuffer++;
@@ -382,6 +456,13 @@ void handleManyEvents(const INPUT_RECORD* const inputBuffer, int cEvents)
         std::string vtseq = std::string(buffer, bufferCch);
         std::string printSeq = std::string(printableBuffer, printableCch);
 
+        if (g_measureLatency)
+        {
+            // If earlier input hasn't been echoed yet, we keep measuring from that one.
+            int64_t expected = 0;
+            g_pendingInputTime.compare_exchange_strong(expected, queryPerformanceCounter());
+        }
+
         getConsole()->WriteInput(vtseq);
         PrintInputToDebug(vtseq);
     }
@@ -531,6 +612,8 @@ int __cdecl wmain(int argc, WCHAR* argv[])
     hOut = GetStdHandle(STD_OUTPUT_HANDLE);
     hIn = GetStdHandle(STD_INPUT_HANDLE);
 
+    TraceLoggingRegister(g_hVtPipeTermProvider);
+
     bool fUseDebug = false;
 
     if (argc > 1)
@@ -550,6 +633,10 @@ int __cdecl wmain(int argc, WCHAR* argv[])
             {
                 fUseDebug = true;
             }
+            else if (arg == std::wstring(L"--latency"))
+            {
+                g_measureLatency = true;
+            }
             else if (arg == std::wstring(L"--out") && i + 1 < argc)
             {
                 g_useOutfile = true;
@@ -4,6 +4,8 @@
 #include "precomp.h"
 #include "inc/CodepointWidthDetector.hpp"
 
+#include <til/unicode.h>
+
 namespace
 {
     // used to store range data in CodepointWidthDetector's internal map
@@ -14,11 +16,6 @@ namespace
         char32_t isAmbiguous : 1;
     };
 
-    static bool operator<(const UnicodeRange& range, const unsigned int searchTerm) noexcept
-    {
-        return range.upperBound < searchTerm;
-    }
-
     // Generated by Generate-CodepointWidthsFromUCD.ps1 -Pack:True -Full: -NoOverrides:False
     // on 2022-11-15 19:54:23Z from Unicode 15.0.0.
     // 321149 (0x4E67D) codepoints covered.
@@ -323,6 +320,122 @@ namespace
         UnicodeRange{ 0xf0000, 0xffffd, 1 },
         UnicodeRange{ 0x100000, 0x10fffd, 1 },
     };
+
+    // s_wideAndAmbiguousTable is turned into a two-stage lookup table at compile time, so that the width of a
+    // codepoint can be looked up in O(1). The codepoint space is split into blocks of s_blockSize codepoints.
+    // s_widthTable.stage1 maps each block to one of the blocks in s_widthTable.stage2, which in turn hold
+    // the WidthClass of each codepoint in the block. Most blocks contain only a single WidthClass and share
+    // the first 3 blocks in stage2. Only blocks that contain the start or end of a range get one of their own.
+    enum WidthClass : uint8_t
+    {
+        Narrow,
+        Wide,
+        Ambiguous,
+    };
+
+    static constexpr size_t s_blockShift = 8;
+    static constexpr size_t s_blockSize = size_t{ 1 } << s_blockShift;
+    static constexpr size_t s_blockCount = size_t{ 0x110000 } >> s_blockShift;
+
+    // Calls func(block) for each block that contains the start or end of a range, in ascending order.
+    template<typename T>
+    constexpr void forEachMixedBlock(T&& func)
+    {
+        auto last = SIZE_MAX;
+        const auto visit = [&](const size_t boundary) {
+            const auto block = boundary >> s_blockShift;
+            if (boundary % s_blockSize != 0 && block != last)
+            {
+                func(block);
+                last = block;
+            }
+        };
+
+        for (const auto& range : s_wideAndAmbiguousTable)
+        {
+            visit(range.lowerBound);
+            visit(size_t{ range.upperBound } + 1);
+        }
+    }
+
+    static constexpr size_t s_mixedBlockCount = [] {
+        size_t count = 0;
+        forEachMixedBlock([&](size_t) { ++count; });
+        return count;
+    }();
+    static_assert(3 + s_mixedBlockCount <= 256, "stage1 indices must fit into uint8_t");
+
+    struct WidthTable
+    {
+        std::array<uint8_t, s_blockCount> stage1{};
+        std::array<std::array<uint8_t, s_blockSize>, 3 + s_mixedBlockCount> stage2{};
+    };
+
+    static constexpr auto s_widthTable = [] {
+        WidthTable table;
+
+        // The first 3 blocks in stage2 are uniformly Narrow, Wide and Ambiguous respectively.
+        for (auto& v : table.stage2[Wide])
+        {
+            v = Wide;
+        }
+        for (auto& v : table.stage2[Ambiguous])
+        {
+            v = Ambiguous;
+        }
+
+        // Blocks that are entirely covered by a range point to the matching uniform block...
+        for (const auto& range : s_wideAndAmbiguousTable)
+        {
+            const auto cls = range.isAmbiguous ? Ambiguous : Wide;
+            const auto beg = (size_t{ range.lowerBound } + s_blockSize - 1) >> s_blockShift;
+            const auto end = (size_t{ range.upperBound } + 1) >> s_blockShift;
+            for (auto block = beg; block < end; ++block)
+            {
+                table.stage1[block] = cls;
+            }
+        }
+
+        // ...and all others get their own block.
+        uint8_t next = 3;
+        forEachMixedBlock([&](size_t block) {
+            table.stage1[block] = next++;
+        });
+
+        for (const auto& range : s_wideAndAmbiguousTable)
+        {
+            const auto cls = range.isAmbiguous ? Ambiguous : Wide;
+            const size_t upper = range.upperBound;
+            for (size_t cp = range.lowerBound; cp <= upper;)
+            {
+                const auto block = cp >> s_blockShift;
+                const auto index = table.stage1[block];
+                if (index < 3)
+                {
+                    // This is one of the uniform blocks we've already handled above.
+                    cp = (block + 1) << s_blockShift;
+                    continue;
+                }
+                table.stage2[index][cp % s_blockSize] = cls;
+                ++cp;
+            }
+        }
+
+        return table;
+    }();
+
+    constexpr WidthClass lookupWidthClass(const char32_t codepoint) noexcept
+    {
+        const auto block = til::at(s_widthTable.stage1, codepoint >> s_blockShift);
+        return static_cast<WidthClass>(til::at(til::at(s_widthTable.stage2, block), codepoint % s_blockSize));
+    }
+
+    static_assert(lookupWidthClass(0x7f) == Narrow);
+    static_assert(lookupWidthClass(0xa1) == Ambiguous);
+    static_assert(lookupWidthClass(0x306a) == Wide);
+    static_assert(lookupWidthClass(0x1f47e) == Wide);
+    static_assert(lookupWidthClass(0x10fffd) == Ambiguous);
+    static_assert(lookupWidthClass(0x10ffff) == Narrow);
 }
 
 // Routine Description:
@@ -374,23 +487,41 @@ bool CodepointWidthDetector::IsWide(const std::wstring_view& glyph) noexcept
     return GetWidth(glyph) == CodepointWidth::Wide;
 }
 
-// GetWidth's slow-path for non-ASCII characters. Returns the number of columns the codepoint takes up in the terminal.
-uint8_t CodepointWidthDetector::_lookupGlyphWidth(const char32_t codepoint, const std::wstring_view& glyph) noexcept
+// Routine Description:
+// - returns the length of the leading run of characters in the text that are each a
+//   single, narrow codepoint. Unlike GetWidth() this never calls the fallback method,
+//   which means that ambiguous characters and surrogate pairs end the run.
+// - This allows callers like ROW::ReplaceText() to measure whole runs of text at once.
+// Arguments:
+// - text - the utf16 encoded text to measure
+// Return Value:
+// - the number of characters, all of which are 1 column wide
+size_t CodepointWidthDetector::NarrowPrefixLength(const std::wstring_view& text) noexcept
 {
-#pragma warning(suppress : 26447) // The function is declared 'noexcept' but calls function 'lower_bound<...>()' which may throw exceptions (f.6).
-    const auto it = std::lower_bound(s_wideAndAmbiguousTable.begin(), s_wideAndAmbiguousTable.end(), codepoint);
-    uint8_t width = 1;
-
-    if (it != s_wideAndAmbiguousTable.end() && codepoint >= it->lowerBound && codepoint <= it->upperBound)
+    size_t length = 0;
+    for (const auto ch : text)
     {
-        width = 2;
-        if (it->isAmbiguous)
+        if (til::is_surrogate(ch) || lookupWidthClass(ch) != Narrow)
         {
-            width = _checkFallbackViaCache(codepoint, glyph);
+            break;
         }
+        ++length;
     }
+    return length;
+}
 
-    return width;
+// GetWidth's slow-path for non-ASCII characters. Returns the number of columns the codepoint takes up in the terminal.
+uint8_t CodepointWidthDetector::_lookupGlyphWidth(const char32_t codepoint, const std::wstring_view& glyph) noexcept
+{
+    switch (lookupWidthClass(codepoint))
+    {
+    case Wide:
+        return 2;
+    case Ambiguous:
+        return _checkFallbackViaCache(codepoint, glyph);
+    default:
+        return 1;
+    }
 }
 
 // Call the function specified via SetFallbackMethod() to turn CodepointWidth::Ambiguous into Narrow/Wide.
@@ -25,6 +25,14 @@ bool IsGlyphFullWidth(const wchar_t wch) noexcept
     return wch < 0x80 ? false : IsGlyphFullWidth({ &wch, 1 });
 }
 
+// Function Description:
+// - returns the length of the leading run of characters that are each a single
+//      narrow codepoint. See CodepointWidthDetector::NarrowPrefixLength
+size_t GlyphNarrowPrefixLength(const std::wstring_view& text) noexcept
+{
+    return CodepointWidthDetector::NarrowPrefixLength(text);
+}
+
 // Function Description:
 // - Sets a function that should be used by the global CodepointWidthDetector
 //      as the fallback mechanism for determining a particular glyph's width,
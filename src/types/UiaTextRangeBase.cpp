@@ -7,6 +7,8 @@
 #include "../buffer/out/search.h"
 #include "UiaTracing.h"
 
+#include <til/hash.h>
+
 using namespace Microsoft::Console::Types;
 
 // Foreground/Background text color doesn't care about the alpha.
@@ -838,54 +840,22 @@ IFACEMETHODIMP UiaTextRangeBase::GetBoundingRectangles(_Outptr_result_maybenull_
 
     try
     {
-        // vector to put coords into. they go in as four doubles in the
-        // order: left, top, width, height. each line will have its own
-        // set of coords.
-        std::vector<double> coords;
-
-        // GH#6402: Get the actual buffer size here, instead of the one
-        //          constrained by the virtual bottom.
-        const auto& buffer = _pData->GetTextBuffer();
-        const auto bufferSize = buffer.GetSize();
-
-        // these viewport vars are converted to the buffer coordinate space
-        const auto viewport = bufferSize.ConvertToOrigin(_pData->GetViewport());
-        const auto viewportOrigin = viewport.Origin();
-        const auto viewportEnd = viewport.EndExclusive();
-
-        // startAnchor: the earliest til::point we will get a bounding rect for; at least the viewport origin
-        const auto startAnchor = std::max(GetEndpoint(TextPatternRangeEndpoint_Start), viewportOrigin);
-
-        // endAnchor: the latest til::point we will get a bounding rect for; at most the viewport end
-        auto endAnchor = std::min(GetEndpoint(TextPatternRangeEndpoint_End), viewportEnd);
-
-        // _end is exclusive, let's be inclusive so we don't have to think about it anymore for bounding rects
-        bufferSize.DecrementInBounds(endAnchor, true);
-
-        if (IsDegenerate() || _start > viewportEnd || _end < viewportOrigin)
+        // The rectangles additionally depend on the viewport, the font size and the window position.
+        til::point screenOrigin;
+        _TranslatePointToScreen(&screenOrigin);
+        const auto viewportRect = _pData->GetViewport().ToInclusive();
+        const auto fontSize = _getScreenFontSize();
+        const auto cacheKey = til::hasher{ _getContentKey() }.write(&screenOrigin, 1).write(&viewportRect, 1).write(&fontSize, 1).finalize();
+        if (!_rectsCache || _rectsCacheKey != cacheKey)
         {
-            // An empty array is returned for a degenerate (empty) text range.
-            // reference: https://docs.microsoft.com/en-us/windows/win32/api/uiautomationclient/nf-uiautomationclient-iuiautomationtextrange-getboundingrectangles
-
-            // Remember, start cannot be past end, so
-            //   if start is past the viewport end,
-            //   or end is past the viewport origin
-            //   draw nothing
+            _rectsCache = _getBoundingRects();
+            _rectsCacheKey = cacheKey;
         }
-        else
-        {
-            const auto textRects = buffer.GetTextRects(startAnchor, endAnchor, _blockRange, true);
 
-            for (const auto& rect : textRects)
-            {
-                // Convert the buffer coordinates to an equivalent range of
-                // screen cells, taking line rendition into account.
-                const auto lineRendition = buffer.GetLineRendition(rect.top);
-                til::rect r{ BufferToScreenLine(rect, lineRendition) };
-                r -= viewportOrigin;
-                _getBoundingRect(r, coords);
-            }
-        }
+        // vector to put coords into. they go in as four doubles in the
+        // order: left, top, width, height. each line will have its own
+        // set of coords.
+        auto& coords = *_rectsCache;
 
         // convert to a safearray
         *ppRetVal = SafeArrayCreateVector(VT_R8, 0, gsl::narrow<ULONG>(coords.size()));
@@ -912,6 +882,61 @@ IFACEMETHODIMP UiaTextRangeBase::GetBoundingRectangles(_Outptr_result_maybenull_
     return S_OK;
 }
 
+// Computes the coordinates for GetBoundingRectangles(), which caches them.
+std::vector<double> UiaTextRangeBase::_getBoundingRects() const
+{
+    // vector to put coords into. they go in as four doubles in the
+    // order: left, top, width, height. each line will have its own
+    // set of coords.
+    std::vector<double> coords;
+
+    // GH#6402: Get the actual buffer size here, instead of the one
+    //          constrained by the virtual bottom.
+    const auto& buffer = _pData->GetTextBuffer();
+    const auto bufferSize = buffer.GetSize();
+
+    // these viewport vars are converted to the buffer coordinate space
+    const auto viewport = bufferSize.ConvertToOrigin(_pData->GetViewport());
+    const auto viewportOrigin = viewport.Origin();
+    const auto viewportEnd = viewport.EndExclusive();
+
+    // startAnchor: the earliest til::point we will get a bounding rect for; at least the viewport origin
+    const auto startAnchor = std::max(GetEndpoint(TextPatternRangeEndpoint_Start), viewportOrigin);
+
+    // endAnchor: the latest til::point we will get a bounding rect for; at most the viewport end
+    auto endAnchor = std::min(GetEndpoint(TextPatternRangeEndpoint_End), viewportEnd);
+
+    // _end is exclusive, let's be inclusive so we don't have to think about it anymore for bounding rects
+    bufferSize.DecrementInBounds(endAnchor, true);
+
+    if (IsDegenerate() || _start > viewportEnd || _end < viewportOrigin)
+    {
+        // An empty array is returned for a degenerate (empty) text range.
+        // reference: https://docs.microsoft.com/en-us/windows/win32/api/uiautomationclient/nf-uiautomationclient-iuiautomationtextrange-getboundingrectangles
+
+        // Remember, start cannot be past end, so
+        //   if start is past the viewport end,
+        //   or end is past the viewport origin
+        //   draw nothing
+    }
+    else
+    {
+        const auto textRects = buffer.GetTextRects(startAnchor, endAnchor, _blockRange, true);
+
+        for (const auto& rect : textRects)
+        {
+            // Convert the buffer coordinates to an equivalent range of
+            // screen cells, taking line rendition into account.
+            const auto lineRendition = buffer.GetLineRendition(rect.top);
+            til::rect r{ BufferToScreenLine(rect, lineRendition) };
+            r -= viewportOrigin;
+            _getBoundingRect(r, coords);
+        }
+    }
+
+    return coords;
+}
+
 IFACEMETHODIMP UiaTextRangeBase::GetEnclosingElement(_Outptr_result_maybenull_ IRawElementProviderSimple** ppRetVal) noexcept
 try
 {
@@ -958,6 +983,12 @@ CATCH_RETURN();
 #pragma warning(disable : 26447) // compiler isn't filtering throws inside the try/catch
 std::wstring UiaTextRangeBase::_getTextValue(til::CoordType maxLength) const
 {
+    const auto cacheKey = til::hasher{ _getContentKey() }.write(&maxLength, 1).finalize();
+    if (_textCache && _textCacheKey == cacheKey)
+    {
+        return *_textCache;
+    }
+
     std::wstring textData{};
     if (!IsDegenerate())
     {
@@ -1001,8 +1032,40 @@ std::wstring UiaTextRangeBase::_getTextValue(til::CoordType maxLength) const
         }
     }
 
+    _textCache = textData;
+    _textCacheKey = cacheKey;
     return textData;
 }
+
+// Routine Description:
+// - Returns a key that identifies the current contents of this range, for caching the
+//   results of _getTextValue() and GetBoundingRectangles().
+// - Instead of comparing the text itself, this hashes this range's endpoints and the
+//   ROW::GetId() and ROW::GetRevision() of each row it covers. This is a lot cheaper and
+//   changes whenever a row is modified, or scrolled in or out of the range.
+// Arguments:
+// - <none>
+// Return Value:
+// - The key for the current contents
+size_t UiaTextRangeBase::_getContentKey() const noexcept
+{
+    const auto& buffer = _pData->GetTextBuffer();
+    const auto bufferPtr = &buffer;
+    const uint8_t blockRange = _blockRange;
+
+    til::hasher h;
+    h.write(&bufferPtr, 1).write(&_start, 1).write(&_end, 1).write(&blockRange, 1);
+
+    const auto end = std::min(_end.y, buffer.GetSize().BottomInclusive());
+    for (auto y = std::max(_start.y, 0); y <= end; ++y)
+    {
+        const auto& row = buffer.GetRowByOffset(y);
+        const uint64_t state[]{ row.GetId(), row.GetRevision() };
+        h.write(&state[0], 2);
+    }
+
+    return h.finalize();
+}
 #pragma warning(pop)
 
 IFACEMETHODIMP UiaTextRangeBase::Move(_In_ TextUnit unit,
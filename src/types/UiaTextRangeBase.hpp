@@ -144,6 +144,14 @@ namespace Microsoft::Console::Types
         // GetText() cannot be used as it's not const
         std::wstring _getTextValue(til::CoordType maxLength = -1) const;
 
+        // Screen readers call GetText() and GetBoundingRectangles() constantly, mostly for
+        // ranges whose contents haven't changed in the meantime. See _getContentKey().
+        size_t _getContentKey() const noexcept;
+        mutable size_t _textCacheKey{};
+        mutable std::optional<std::wstring> _textCache;
+        size_t _rectsCacheKey{};
+        std::optional<std::vector<double>> _rectsCache;
+
         til::rect _getTerminalRect() const;
 
         virtual til::size _getScreenFontSize() const noexcept;
@@ -153,6 +161,7 @@ namespace Microsoft::Console::Types
         til::point _getDocumentEnd() const;
 
         void _getBoundingRect(const til::rect& textRect, _Inout_ std::vector<double>& coords) const;
+        std::vector<double> _getBoundingRects() const;
 
         void _expandToEnclosingUnit(TextUnit unit);
 
@@ -8,6 +8,113 @@
 
 #pragma hdrstop
 
+namespace
+{
+    // A lookup table for a single-byte codepage (like 437, 850 or 1252), in which every byte maps to exactly one wchar_t.
+    struct SingleByteCodepage
+    {
+        // CP_UTF8 is never a single-byte codepage, which makes it a safe initial value.
+        UINT codePage = CP_UTF8;
+        bool valid = false;
+        // True if the bytes [0x00,0x7F] map to [U+0000,U+007F], which allows us to widen them with SIMD.
+        bool asciiIdentity = false;
+        std::array<wchar_t, 256> table{};
+    };
+}
+
+// Routine Description:
+// - Returns the lookup table for the given codepage, building it if the codepage changed since the last call.
+//   The console rarely uses more than a single codepage at a time, so caching the most recent one is sufficient.
+//   Being thread-local, the cache doesn't need any locking.
+// Arguments:
+// - codePage - Windows Code Page to return the table for
+// Return Value:
+// - The lookup table or nullptr if the codepage isn't a single-byte codepage. DBCS codepages for instance.
+static const SingleByteCodepage* getSingleByteCodepage(const UINT codePage) noexcept
+{
+    static thread_local SingleByteCodepage cache;
+
+    if (cache.codePage != codePage)
+    {
+        cache.codePage = codePage;
+        cache.valid = false;
+        cache.asciiIdentity = false;
+
+        CPINFO info{};
+        if (codePage != CP_UTF8 && GetCPInfo(codePage, &info) && info.MaxCharSize == 1)
+        {
+            std::array<char, 256> bytes;
+            for (size_t i = 0; i < bytes.size(); ++i)
+            {
+                til::at(bytes, i) = static_cast<char>(i);
+            }
+
+            cache.valid = MultiByteToWideChar(codePage, 0, bytes.data(), 256, cache.table.data(), 256) == 256;
+            cache.asciiIdentity = cache.valid;
+            for (size_t i = 0; i < 128 && cache.asciiIdentity; ++i)
+            {
+                cache.asciiIdentity = til::at(cache.table, i) == static_cast<wchar_t>(i);
+            }
+        }
+    }
+
+    return cache.valid ? &cache : nullptr;
+}
+
+// Routine Description:
+// - Maps each byte in source to a wchar_t in target using the lookup table. If the lower half of the codepage
+//   is ASCII, blocks of 16 ASCII bytes are widened with SIMD, since that's what the vast majority of text is.
+// Arguments:
+// - codepage - The lookup table to use
+// - source - The bytes to convert
+// - target - The output buffer, which must be at least as long as source
+#pragma warning(push)
+#pragma warning(disable : 26481) // Don't use pointer arithmetic. Use span instead (bounds.1).
+#pragma warning(disable : 26490) // Don't use reinterpret_cast (type.1).
+static void mapSingleByteCodepage(const SingleByteCodepage& codepage, const std::string_view source, wchar_t* target) noexcept
+{
+    auto it = reinterpret_cast<const uint8_t*>(source.data());
+    const auto end = it + source.size();
+    const auto& table = codepage.table;
+
+#if defined(_M_AMD64) || defined(_M_IX86) || defined(_M_ARM64)
+    if (codepage.asciiIdentity)
+    {
+        for (; end - it >= 16; it += 16, target += 16)
+        {
+#if defined(_M_ARM64)
+            const auto vec = vld1q_u8(it);
+            if (vmaxvq_u8(vec) < 0x80)
+            {
+                vst1q_u16(reinterpret_cast<uint16_t*>(target), vmovl_u8(vget_low_u8(vec)));
+                vst1q_u16(reinterpret_cast<uint16_t*>(target + 8), vmovl_high_u8(vec));
+                continue;
+            }
+#else
+            const auto vec = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+            if (_mm_movemask_epi8(vec) == 0)
+            {
+                const auto zero = _mm_setzero_si128();
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(target), _mm_unpacklo_epi8(vec, zero));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(target + 8), _mm_unpackhi_epi8(vec, zero));
+                continue;
+            }
+#endif
+            for (size_t i = 0; i < 16; ++i)
+            {
+                target[i] = til::at(table, it[i]);
+            }
+        }
+    }
+#endif
+
+    for (; it != end; ++it, ++target)
+    {
+        *target = til::at(table, *it);
+    }
+}
+#pragma warning(pop)
+
 // Routine Description:
 // - Takes a multibyte string, allocates the appropriate amount of memory for the conversion, performs the conversion,
 //   and returns the Unicode UTF-16 result in the smart pointer (and the length).
@@ -25,6 +132,15 @@
         return {};
     }
 
+    // Single-byte codepages are converted with a lookup table instead of calling into the OS.
+    if (const auto codepage = getSingleByteCodepage(codePage))
+    {
+        std::wstring out;
+        out.resize(source.size());
+        mapSingleByteCodepage(*codepage, source, out.data());
+        return out;
+    }
+
     int iSource; // convert to int because Mb2Wc requires it.
     THROW_IF_FAILED(SizeTToInt(source.size(), &iSource));
 
@@ -53,6 +169,34 @@
     return out;
 }
 
+// Routine Description:
+// - Converts a multibyte string into the given buffer, if the codepage is a single-byte codepage (like 437, 850
+//   or 1252). Those map every byte to exactly one wchar_t, which is done with a cached lookup table.
+// Arguments:
+// - codepage - Windows Code Page representing the multibyte source text
+// - source - View of multibyte characters of source text
+// - target - The output buffer. It must be at least as long as source.
+// Return Value:
+// - true if source was converted into the first source.size() characters of target.
+// - false if the codepage isn't a single-byte codepage or target is too small. The caller should fall back to
+//   MultiByteToWideChar in that case.
+[[nodiscard]] bool TryConvertSingleByteToW(const UINT codepage, const std::string_view source, const std::span<wchar_t> target) noexcept
+{
+    if (target.size() < source.size())
+    {
+        return false;
+    }
+
+    const auto table = getSingleByteCodepage(codepage);
+    if (!table)
+    {
+        return false;
+    }
+
+    mapSingleByteCodepage(*table, source, target.data());
+    return true;
+}
+
 // Routine Description:
 // - Takes a wide string, allocates the appropriate amount of memory for the conversion, performs the conversion,
 //   and returns the Multibyte result
@@ -14,6 +14,7 @@ Author:
 --*/
 
 #pragma once
+#include <span>
 #include <string>
 #include <string_view>
 
@@ -27,6 +28,10 @@ enum class CodepointWidth : BYTE
 [[nodiscard]] std::wstring ConvertToW(const UINT codepage,
                                       const std::string_view source);
 
+[[nodiscard]] bool TryConvertSingleByteToW(const UINT codepage,
+                                           const std::string_view source,
+                                           const std::span<wchar_t> target) noexcept;
+
 [[nodiscard]] std::string ConvertToA(const UINT codepage,
                                      const std::wstring_view source);
 
@@ -15,6 +15,7 @@
 #include <wil/resource.h>
 #else
 #include "device.h"
+#include "../inc/ConptySharedBuffer.hpp"
 #include <filesystem>
 #endif // __INSIDE_WINDOWS
 
@@ -132,22 +133,52 @@ HRESULT _CreatePseudoConsole(const HANDLE hToken,
     RETURN_IF_WIN32_BOOL_FALSE(CreatePipe(signalPipeConhostSide.addressof(), signalPipeOurSide.addressof(), &sa, 0));
     RETURN_IF_WIN32_BOOL_FALSE(SetHandleInformation(signalPipeConhostSide.get(), HANDLE_FLAG_INHERIT, HANDLE_FLAG_INHERIT));
 
+    // The shared buffer is an optimization. If it can't be set up, conhost writes all of its output to the pipe.
+    wil::unique_handle sharedBuffer;
+    const BOOL bSharedBuffer = (dwFlags & PSEUDOCONSOLE_SHARED_BUFFER) == PSEUDOCONSOLE_SHARED_BUFFER;
+    if (bSharedBuffer)
+    {
+        using namespace Microsoft::Console::SharedBuffer;
+        sharedBuffer.reset(CreateFileMappingW(INVALID_HANDLE_VALUE, &sa, PAGE_READWRITE, 0, gsl::narrow_cast<DWORD>(SectionSize), nullptr));
+        if (sharedBuffer)
+        {
+            const wil::unique_mapview_ptr<std::byte> view{ static_cast<std::byte*>(MapViewOfFile(sharedBuffer.get(), FILE_MAP_WRITE, 0, 0, SectionSize)) };
+            if (view && SetHandleInformation(sharedBuffer.get(), HANDLE_FLAG_INHERIT, HANDLE_FLAG_INHERIT))
+            {
+                Ring::Initialize({ view.get(), SectionSize });
+            }
+            else
+            {
+                sharedBuffer.reset();
+            }
+        }
+    }
+
+    wchar_t sharedBufferArg[32]{};
+    if (sharedBuffer)
+    {
+        swprintf_s(sharedBufferArg, L"--sharedbuffer 0x%x ", sharedBuffer.get());
+    }
+
     // GH4061: Ensure that the path to executable in the format is escaped so C:\Program.exe cannot collide with C:\Program Files
-    auto pwszFormat = L"\"%s\" --headless %s%s%s%s--width %hu --height %hu --signal 0x%x --server 0x%x";
+    auto pwszFormat = L"\"%s\" --headless %s%s%s%s%s%s--width %hu --height %hu --signal 0x%x --server 0x%x";
     // This is plenty of space to hold the formatted string
-    wchar_t cmd[MAX_PATH]{};
+    wchar_t cmd[2 * MAX_PATH]{};
     const BOOL bInheritCursor = (dwFlags & PSEUDOCONSOLE_INHERIT_CURSOR) == PSEUDOCONSOLE_INHERIT_CURSOR;
     const BOOL bResizeQuirk = (dwFlags & PSEUDOCONSOLE_RESIZE_QUIRK) == PSEUDOCONSOLE_RESIZE_QUIRK;
     const BOOL bWin32InputMode = (dwFlags & PSEUDOCONSOLE_WIN32_INPUT_MODE) == PSEUDOCONSOLE_WIN32_INPUT_MODE;
     const BOOL bPassthroughMode = (dwFlags & PSEUDOCONSOLE_PASSTHROUGH_MODE) == PSEUDOCONSOLE_PASSTHROUGH_MODE;
+    const BOOL bRepeatCharacter = (dwFlags & PSEUDOCONSOLE_REPEAT_CHARACTER) == PSEUDOCONSOLE_REPEAT_CHARACTER;
     swprintf_s(cmd,
-               MAX_PATH,
+               ARRAYSIZE(cmd),
                pwszFormat,
                _ConsoleHostPath(),
                bInheritCursor ? L"--inheritcursor " : L"",
                bWin32InputMode ? L"--win32input " : L"",
                bResizeQuirk ? L"--resizeQuirk " : L"",
                bPassthroughMode ? L"--passthrough " : L"",
+               bRepeatCharacter ? L"--repeatchar " : L"",
+               sharedBufferArg,
                size.X,
                size.Y,
                signalPipeConhostSide.get(),
@@ -161,12 +192,16 @@ HRESULT _CreatePseudoConsole(const HANDLE hToken,
     siEx.StartupInfo.dwFlags |= STARTF_USESTDHANDLES;
 
     // Only pass the handles we actually want the conhost to know about to it:
-    const size_t INHERITED_HANDLES_COUNT = 4;
-    HANDLE inheritedHandles[INHERITED_HANDLES_COUNT];
-    inheritedHandles[0] = serverHandle.get();
-    inheritedHandles[1] = hInput;
-    inheritedHandles[2] = hOutput;
-    inheritedHandles[3] = signalPipeConhostSide.get();
+    HANDLE inheritedHandles[5];
+    size_t inheritedHandlesCount = 0;
+    inheritedHandles[inheritedHandlesCount++] = serverHandle.get();
+    inheritedHandles[inheritedHandlesCount++] = hInput;
+    inheritedHandles[inheritedHandlesCount++] = hOutput;
+    inheritedHandles[inheritedHandlesCount++] = signalPipeConhostSide.get();
+    if (sharedBuffer)
+    {
+        inheritedHandles[inheritedHandlesCount++] = sharedBuffer.get();
+    }
 
     // Get the size of the attribute list. We need one attribute, the handle list.
     SIZE_T listSize = 0;
@@ -189,7 +224,7 @@ HRESULT _CreatePseudoConsole(const HANDLE hToken,
                                                          0,
                                                          PROC_THREAD_ATTRIBUTE_HANDLE_LIST,
                                                          inheritedHandles,
-                                                         (INHERITED_HANDLES_COUNT * sizeof(HANDLE)),
+                                                         (inheritedHandlesCount * sizeof(HANDLE)),
                                                          nullptr,
                                                          nullptr));
     wil::unique_process_information pi;
@@ -237,6 +272,7 @@ HRESULT _CreatePseudoConsole(const HANDLE hToken,
     pPty->hSignal = signalPipeOurSide.release();
     pPty->hPtyReference = referenceHandle.release();
     pPty->hConPtyProcess = std::exchange(pi.hProcess, nullptr);
+    pPty->hSharedBuffer = sharedBuffer.release();
 
     return S_OK;
 }
@@ -383,6 +419,11 @@ void _ClosePseudoConsoleMembers(_In_ PseudoConsole* pPty, _In_ DWORD dwMilliseco
             CloseHandle(pPty->hConPtyProcess);
             pPty->hConPtyProcess = nullptr;
         }
+        if (_HandleIsValid(pPty->hSharedBuffer))
+        {
+            CloseHandle(pPty->hSharedBuffer);
+            pPty->hSharedBuffer = nullptr;
+        }
     }
 }
 
@@ -603,4 +644,23 @@ extern "C" HRESULT WINAPI ConptyPackPseudoConsole(_In_ HANDLE hProcess,
     return S_OK;
 }
 
+// Function Description:
+// - Returns a new handle to the section that the conpty writes its text to, if it
+//   was created with PSEUDOCONSOLE_SHARED_BUFFER. See ConptySharedBuffer.hpp.
+//   The caller is responsible for closing it.
+// - Fails with E_NOT_VALID_STATE if the conpty doesn't have a shared buffer, which is
+//   also the case if it couldn't be created. The output pipe then carries all of the output.
+extern "C" HRESULT WINAPI ConptyGetSharedBuffer(_In_ HPCON hPC, _Out_ HANDLE* phSection)
+{
+    RETURN_HR_IF(E_INVALIDARG, nullptr == phSection);
+    *phSection = nullptr;
+
+    const auto pPty = (PseudoConsole*)hPC;
+    RETURN_HR_IF(E_INVALIDARG, nullptr == pPty);
+    RETURN_HR_IF(E_NOT_VALID_STATE, !_HandleIsValid(pPty->hSharedBuffer));
+
+    RETURN_IF_WIN32_BOOL_FALSE(DuplicateHandle(GetCurrentProcess(), pPty->hSharedBuffer, GetCurrentProcess(), phSection, 0, FALSE, DUPLICATE_SAME_ACCESS));
+    return S_OK;
+}
+
 #pragma warning(pop)
@@ -38,6 +38,9 @@ typedef struct _PseudoConsole
     HANDLE hPtyReference;
     // hConPtyProcess is a process handle to the conhost instance that we've spawned for ConPTY.
     HANDLE hConPtyProcess;
+    // hSharedBuffer is the section OpenConsole writes text to if PSEUDOCONSOLE_SHARED_BUFFER
+    // was given. See ConptySharedBuffer.hpp. It's null otherwise.
+    HANDLE hSharedBuffer;
 } PseudoConsole;
 
 // Signals
@@ -61,6 +64,12 @@ typedef struct _PseudoConsole
 #ifndef PSEUDOCONSOLE_PASSTHROUGH_MODE
 #define PSEUDOCONSOLE_PASSTHROUGH_MODE (0x8)
 #endif
+#ifndef PSEUDOCONSOLE_REPEAT_CHARACTER
+#define PSEUDOCONSOLE_REPEAT_CHARACTER (0x10)
+#endif
+#ifndef PSEUDOCONSOLE_SHARED_BUFFER
+#define PSEUDOCONSOLE_SHARED_BUFFER (0x20)
+#endif
 
 // Implementations of the various PseudoConsole functions.
 HRESULT _CreatePseudoConsole(const HANDLE hToken,
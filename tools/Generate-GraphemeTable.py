@@ -0,0 +1,125 @@
+# Copyright (c) Microsoft Corporation.
+# Licensed under the MIT license.
+
+################################################################################
+# This script generates src/inc/til/grapheme_table.h, the Grapheme_Cluster_Break
+# property table used by til/grapheme.h, from the Unicode Character Database[1].
+#
+# It reads GraphemeBreakProperty.txt (from ucd/auxiliary/) and emoji-data.txt
+# (from ucd/emoji/) and packs the property of every code point into a 2-stage
+# lookup table: stage 1 maps each block of 128 code points to a deduplicated
+# block in stage 2, which stores the 4-bit property of each code point.
+#
+# Invoke this script from the root of this repository as:
+#   python .\tools\Generate-GraphemeTable.py path\to\ucd > .\src\inc\til\grapheme_table.h
+#
+# [1]: https://www.unicode.org/Public/UCD/latest/ucd/
+
+import argparse
+import re
+import sys
+
+# The order must match til::grapheme::cluster_break.
+PROPERTIES = [
+    None,
+    "CR",
+    "LF",
+    "Control",
+    "Extend",
+    "ZWJ",
+    "Regional_Indicator",
+    "Prepend",
+    "SpacingMark",
+    "L",
+    "V",
+    "T",
+    "LV",
+    "LVT",
+    "Extended_Pictographic",
+]
+
+BLOCK_SHIFT = 7
+BLOCK_SIZE = 1 << BLOCK_SHIFT
+CODEPOINT_COUNT = 0x110000
+
+
+def parse_ucd_file(path, props, only=None):
+    version = None
+    with open(path, encoding="utf-8") as f:
+        for line in f:
+            if version is None:
+                match = re.match(r"#\s*\S+-(\d+\.\d+\.\d+)\.txt", line)
+                if match:
+                    version = match.group(1)
+            line = line.split("#", 1)[0].strip()
+            if not line:
+                continue
+            codepoints, value = (s.strip() for s in line.split(";")[:2])
+            if only is not None and value != only:
+                continue
+            first, _, last = codepoints.partition("..")
+            first = int(first, 16)
+            last = int(last, 16) if last else first
+            index = PROPERTIES.index(value)
+            for cp in range(first, last + 1):
+                props[cp] = index
+    return version
+
+
+def format_array(name, values):
+    lines = [f"    inline constexpr uint8_t {name}[{len(values)}]{{"]
+    for i in range(0, len(values), 32):
+        lines.append("        " + " ".join(f"0x{v:02x}," for v in values[i : i + 32]))
+    lines.append("    };")
+    return "\n".join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("ucd", help="directory containing GraphemeBreakProperty.txt and emoji-data.txt")
+    parser.add_argument("--unicode-version", help="overrides the version parsed from the file headers")
+    args = parser.parse_args()
+
+    props = [0] * CODEPOINT_COUNT
+    version = parse_ucd_file(f"{args.ucd}/GraphemeBreakProperty.txt", props)
+    # Extended_Pictographic isn't a Grapheme_Cluster_Break value, but no code point has both.
+    parse_ucd_file(f"{args.ucd}/emoji-data.txt", props, "Extended_Pictographic")
+    version = args.unicode_version or version or "unknown"
+
+    stage1 = []
+    stage2 = []
+    blocks = {}
+    for base in range(0, CODEPOINT_COUNT, BLOCK_SIZE):
+        block = tuple(props[base : base + BLOCK_SIZE])
+        index = blocks.get(block)
+        if index is None:
+            index = blocks[block] = len(blocks)
+            # Pack 2 properties per byte, the even code point in the low nibble.
+            stage2.extend(block[i] | (block[i + 1] << 4) for i in range(0, BLOCK_SIZE, 2))
+        stage1.append(index)
+
+    if len(blocks) > 256:
+        sys.exit(f"{len(blocks)} unique blocks don't fit into a uint8_t stage 1 table")
+
+    out = sys.stdout
+    out.write("// Copyright (c) Microsoft Corporation.\n")
+    out.write("// Licensed under the MIT license.\n")
+    out.write("\n")
+    out.write("#pragma once\n")
+    out.write("\n")
+    out.write(f"// Generated by Generate-GraphemeTable.py from Unicode {version}.\n")
+    out.write(f"// {len(blocks)} unique blocks of {BLOCK_SIZE} code points. See til/grapheme.h.\n")
+    out.write("// clang-format off\n")
+    out.write("namespace til::details\n")
+    out.write("{\n")
+    out.write(f"    inline constexpr int grapheme_block_shift = {BLOCK_SHIFT};\n")
+    out.write("\n")
+    out.write(format_array("grapheme_stage1", stage1) + "\n")
+    out.write("\n")
+    out.write(format_array("grapheme_stage2", stage2) + "\n")
+    out.write("}\n")
+    out.write("// clang-format on\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,142 @@
+# Copyright (c) Microsoft Corporation.
+# Licensed under the MIT license.
+
+################################
+# This script measures the cold start of Windows Terminal.
+#
+# It records the Startup profile of src\Terminal.wprp while launching the
+# terminal, waits for it to paint its first frame and closes it again.
+# The startup markers (see Terminal.wprp) are then extracted from each trace
+# and the median of each stage's duration across all iterations reported.
+#
+# wpr.exe requires this to be run from an elevated prompt.
+
+[CmdletBinding()]
+Param(
+    [int]$Iterations = 5,
+    [string]$Executable = "wt.exe",
+    [string]$Arguments = "",
+    [int]$TimeoutSeconds = 30,
+    [string]$OutputDirectory = (Join-Path ([System.IO.Path]::GetTempPath()) "TerminalStartup")
+)
+
+$ErrorActionPreference = "Stop"
+
+$WprProfile = Join-Path $PSScriptRoot "..\src\Terminal.wprp"
+$Stages = "WindowEmperor", "SettingsLoad", "XamlIslandInitialize", "TerminalPageCreate"
+$Milestones = "ReceivedFirstByte", "Present"
+
+# Returns the startup events of the WindowsTerminal process in the given trace,
+# sorted by their timestamp, as objects with a Name, Opcode and Time.
+Function Get-StartupEvents([string]$Etl) {
+    $xmlPath = [System.IO.Path]::ChangeExtension($Etl, ".xml")
+    & tracerpt.exe $Etl -o $xmlPath -of XML -y | Out-Null
+    If ($LASTEXITCODE -Ne 0) {
+        Throw "tracerpt failed to convert $Etl"
+    }
+
+    [xml]$xml = Get-Content $xmlPath
+    $events = $xml.Events.Event | % {
+        [PSCustomObject]@{
+            # TraceLogging events have no task, so their name is used instead.
+            Name = $_.RenderingInfo.Task
+            Opcode = [int]$_.System.Opcode
+            ProcessId = [int]$_.System.Execution.ProcessID
+            Time = [DateTime]::Parse($_.System.TimeCreated.SystemTime, $null, [System.Globalization.DateTimeStyles]::RoundtripKind)
+        }
+    }
+
+    # wt.exe is only a launcher. The ProcessStarted event is emitted by WindowsTerminal.exe itself.
+    $started = $events | ? Name -Eq "ProcessStarted" | Select -First 1
+    If (-Not $started) {
+        Throw "$Etl doesn't contain a ProcessStarted event"
+    }
+    $events | ? ProcessId -Eq $started.ProcessId | Sort Time
+}
+
+# Returns the duration of each stage and the time from the process start until
+# each milestone was reached, in milliseconds.
+Function Measure-Startup($Events) {
+    $start = ($Events | ? Name -Eq "ProcessStarted" | Select -First 1).Time
+    $result = [ordered]@{}
+
+    ForEach ($stage in $Stages) {
+        $begin = $Events | ? { $_.Name -Eq $stage -And $_.Opcode -Eq 1 } | Select -First 1
+        $end = $Events | ? { $_.Name -Eq $stage -And $_.Opcode -Eq 2 -And $_.Time -Ge $begin.Time } | Select -First 1
+        If ($begin -And $end) {
+            $result[$stage] = ($end.Time - $begin.Time).TotalMilliseconds
+        }
+    }
+
+    ForEach ($milestone in $Milestones) {
+        $first = $Events | ? Name -Eq $milestone | Select -First 1
+        If ($first) {
+            $result["First$milestone"] = ($first.Time - $start).TotalMilliseconds
+        }
+    }
+
+    $result
+}
+
+Function Get-Median([double[]]$Values) {
+    $sorted = $Values | Sort
+    $mid = [Math]::Floor($sorted.Count / 2)
+    If ($sorted.Count % 2) {
+        Return $sorted[$mid]
+    }
+    Return ($sorted[$mid - 1] + $sorted[$mid]) / 2
+}
+
+If (Get-Process -Name WindowsTerminal -ErrorAction SilentlyContinue) {
+    Throw "Windows Terminal is already running. Close all of its windows to measure a cold start."
+}
+
+New-Item -ItemType Directory -Force $OutputDirectory | Out-Null
+$measurements = @()
+
+For ($i = 0; $i -Lt $Iterations; $i++) {
+    $etl = Join-Path $OutputDirectory "startup_$i.etl"
+    Write-Verbose "Iteration $i, recording to $etl"
+
+    & wpr.exe -start "$WprProfile!Startup" -filemode
+    Try {
+        If ($Arguments) {
+            Start-Process $Executable -ArgumentList $Arguments
+        } Else {
+            Start-Process $Executable
+        }
+
+        # Wait for the terminal to come up and display its first frame.
+        $deadline = (Get-Date).AddSeconds($TimeoutSeconds)
+        Do {
+            Start-Sleep -Milliseconds 250
+            $process = Get-Process -Name WindowsTerminal -ErrorAction SilentlyContinue | ? MainWindowHandle -Ne 0
+        } Until ($process -Or (Get-Date) -Gt $deadline)
+
+        # Give the shell some time to print its prompt.
+        Start-Sleep -Seconds 2
+    } Finally {
+        & wpr.exe -stop $etl | Out-Null
+        Get-Process -Name WindowsTerminal -ErrorAction SilentlyContinue | Stop-Process -Force
+    }
+
+    # Let the system settle down before starting again.
+    Start-Sleep -Seconds 2
+
+    $measurements += Measure-Startup (Get-StartupEvents $etl)
+}
+
+$names = $Stages + ($Milestones | % { "First$_" })
+$names | % {
+    $name = $_
+    $values = @($measurements | ? { $_.Contains($name) } | % { $_[$name] })
+    If ($values.Count) {
+        [PSCustomObject]@{
+            Stage = $name
+            MedianMs = [Math]::Round((Get-Median $values), 2)
+            MinMs = [Math]::Round(($values | Measure -Minimum).Minimum, 2)
+            MaxMs = [Math]::Round(($values | Measure -Maximum).Maximum, 2)
+            Samples = $values.Count
+        }
+    }
+}